@@ -124,6 +124,10 @@ lockstat_probe_t lockstat_probes[] =
 	LOCKSTAT_PROBE(LS_LCK_RW_LOCK_SHARED_TO_EXCL, LSR_SPIN, LS_LCK_RW_LOCK_SHARED_TO_EXCL_SPIN, "lck_rw_t", "uint64_t"),
 	LOCKSTAT_PROBE(LS_LCK_RW_LOCK_SHARED_TO_EXCL, LSR_BLOCK, LS_LCK_RW_LOCK_SHARED_TO_EXCL_BLOCK, "lck_rw_t", "uint64_t", "_Bool", "_Bool", "int"),
 	LOCKSTAT_PROBE(LS_LCK_RW_LOCK_EXCL_TO_SHARED, LSR_DOWNGRADE, LS_LCK_RW_LOCK_EXCL_TO_SHARED_DOWNGRADE, "lck_rw_t"),
+	LOCKSTAT_PROBE(LS_LCK_RM_LOCK_SHARED, LSR_ACQUIRE, LS_LCK_RM_LOCK_SHARED_ACQUIRE, "lck_rm_t", "_Bool"),
+	LOCKSTAT_PROBE(LS_LCK_RM_LOCK_EXCL, LSR_ACQUIRE, LS_LCK_RM_LOCK_EXCL_ACQUIRE, "lck_rm_t"),
+	LOCKSTAT_PROBE(LS_LCK_RM_LOCK_EXCL, LSR_BLOCK, LS_LCK_RM_LOCK_EXCL_BLOCK, "lck_rm_t", "uint64_t"),
+	LOCKSTAT_PROBE(LS_LCK_RM_DONE, LSR_RELEASE, LS_LCK_RM_DONE_RELEASE, "lck_rm_t", "_Bool"),
 	//TODO : Separate the probes for the hw_bit from the probe for the normal hw locks
 	LOCKSTAT_PROBE(LS_LCK_SPIN_LOCK, LSS_ACQUIRE, LS_LCK_SPIN_LOCK_ACQUIRE, "hw_lock_t"),
 	LOCKSTAT_PROBE(LS_LCK_SPIN_LOCK, LSS_SPIN, LS_LCK_SPIN_LOCK_SPIN, "hw_lock_t", "uint64_t", "uint64_t"),
@@ -156,6 +160,10 @@ lockstat_probe_t lockstat_probes[] =
 	LOCKSTAT_PROBE(LS_LCK_RW_LOCK_SHARED_TO_EXCL, LSR_SPIN, LS_LCK_RW_LOCK_SHARED_TO_EXCL_SPIN, "lck_rw_t", "uint64_t"),
 	LOCKSTAT_PROBE(LS_LCK_RW_LOCK_SHARED_TO_EXCL, LSR_BLOCK, LS_LCK_RW_LOCK_SHARED_TO_EXCL_BLOCK, "lck_rw_t", "uint64_t", "_Bool", "_Bool", "int"),
 	LOCKSTAT_PROBE(LS_LCK_RW_LOCK_EXCL_TO_SHARED, LSR_DOWNGRADE, LS_LCK_RW_LOCK_EXCL_TO_SHARED_DOWNGRADE, "lck_rw_t"),
+	LOCKSTAT_PROBE(LS_LCK_RM_LOCK_SHARED, LSR_ACQUIRE, LS_LCK_RM_LOCK_SHARED_ACQUIRE, "lck_rm_t", "_Bool"),
+	LOCKSTAT_PROBE(LS_LCK_RM_LOCK_EXCL, LSR_ACQUIRE, LS_LCK_RM_LOCK_EXCL_ACQUIRE, "lck_rm_t"),
+	LOCKSTAT_PROBE(LS_LCK_RM_LOCK_EXCL, LSR_BLOCK, LS_LCK_RM_LOCK_EXCL_BLOCK, "lck_rm_t", "uint64_t"),
+	LOCKSTAT_PROBE(LS_LCK_RM_DONE, LSR_RELEASE, LS_LCK_RM_DONE_RELEASE, "lck_rm_t", "_Bool"),
 	//TODO : Separate the probes for the hw_bit from the probe for the normal hw locks
 	LOCKSTAT_PROBE(LS_LCK_SPIN_LOCK, LSS_ACQUIRE, LS_LCK_SPIN_LOCK_ACQUIRE, "hw_lock_t"),
 	LOCKSTAT_PROBE(LS_LCK_SPIN_LOCK, LSS_SPIN, LS_LCK_SPIN_LOCK_SPIN, "hw_lock_t", "uint64_t", "uint64_t"),
@@ -746,6 +746,8 @@ uint64_t pmap_pv_hashlist_cnts;
 uint32_t pmap_pv_hashlist_max;
 uint32_t pmap_kernel_text_ps = PAGE_SIZE;
 extern uint32_t pv_hashed_kern_low_water_mark;
+extern uint64_t pmap_remove_flushes;
+extern uint64_t pmap_remove_flushes_coalesced;
 
 /*extern struct sysctl_oid_list sysctl__machdep_pmap_children;*/
 
@@ -757,6 +759,23 @@ SYSCTL_QUAD    (_machdep_pmap, OID_AUTO, hashcnts, CTLFLAG_RD | CTLFLAG_KERN | C
 SYSCTL_INT     (_machdep_pmap, OID_AUTO, hashmax, CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED, &pmap_pv_hashlist_max, 0, "");
 SYSCTL_INT     (_machdep_pmap, OID_AUTO, kernel_text_ps, CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED, &pmap_kernel_text_ps, 0, "");
 SYSCTL_INT     (_machdep_pmap, OID_AUTO, kern_pv_reserve, CTLFLAG_RW | CTLFLAG_KERN | CTLFLAG_LOCKED, &pv_hashed_kern_low_water_mark, 0, "");
+SYSCTL_QUAD    (_machdep_pmap, OID_AUTO, remove_flushes, CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED, &pmap_remove_flushes, "");
+SYSCTL_QUAD    (_machdep_pmap, OID_AUTO, remove_flushes_coalesced, CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED, &pmap_remove_flushes_coalesced, "");
+
+extern void pmap_pcid_stats(uint64_t *, uint64_t *, uint64_t *);
+
+static int
+pmap_pcid_stat(__unused struct sysctl_oid *oidp, __unused void *arg1, int arg2, struct sysctl_req *req)
+{
+	uint64_t stats[3];
+
+	pmap_pcid_stats(&stats[0], &stats[1], &stats[2]);
+	return SYSCTL_OUT(req, &stats[arg2], sizeof(stats[arg2]));
+}
+
+SYSCTL_PROC    (_machdep_pmap, OID_AUTO, pcid_allocations, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED, 0, 0, pmap_pcid_stat, "Q", "PCIDs assigned to an address space");
+SYSCTL_PROC    (_machdep_pmap, OID_AUTO, pcid_recycles, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED, 0, 1, pmap_pcid_stat, "Q", "PCIDs taken back from a live address space");
+SYSCTL_PROC    (_machdep_pmap, OID_AUTO, pcid_flushes, CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED, 0, 2, pmap_pcid_stat, "Q", "TLB flushes on address space dispatch");
 
 SYSCTL_NODE(_machdep, OID_AUTO, memmap, CTLFLAG_RD|CTLFLAG_LOCKED, NULL, "physical memory map");
 
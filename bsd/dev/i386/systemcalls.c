@@ -263,6 +263,81 @@ unix_syscall(x86_saved_state_t *state)
 	/* NOTREACHED */
 }
 
+static inline void
+unix_syscall64_set_rval(x86_saved_state64_t *regs, struct sysent *callp, struct uthread *uthread)
+{
+	switch (callp->sy_return_type) {
+	case _SYSCALL_RET_INT_T:
+		regs->rax = uthread->uu_rval[0];
+		regs->rdx = uthread->uu_rval[1];
+		break;
+	case _SYSCALL_RET_UINT_T:
+		regs->rax = ((u_int)uthread->uu_rval[0]);
+		regs->rdx = ((u_int)uthread->uu_rval[1]);
+		break;
+	case _SYSCALL_RET_OFF_T:
+	case _SYSCALL_RET_ADDR_T:
+	case _SYSCALL_RET_SIZE_T:
+	case _SYSCALL_RET_SSIZE_T:
+	case _SYSCALL_RET_UINT64_T:
+	        regs->rax = *((uint64_t *)(&uthread->uu_rval[0]));
+		regs->rdx = 0;
+		break;
+	case _SYSCALL_RET_NONE:
+		break;
+	default:
+		panic("unix_syscall: unknown return type");
+		break;
+	}
+	regs->isf.rflags &= ~EFL_CF;
+}
+
+/*
+ * Dispatch of the system calls of syscall_is_light(): they take no
+ * arguments, don't use the credential and neither block nor issue I/O,
+ * so there is no credential to bind, cancellation point to mask, audit
+ * record to open (this is only called with auditing off) or I/O
+ * throttling window to honor.
+ */
+__attribute__((noreturn))
+static void
+unix_syscall64_light(x86_saved_state64_t *regs, struct uthread *uthread,
+    struct proc *p, unsigned int code, struct sysent *callp)
+{
+	int error;
+
+	assert(callp->sy_narg == 0);
+
+	KERNEL_DEBUG_CONSTANT_IST(KDEBUG_TRACE,
+		BSDDBG_CODE(DBG_BSD_EXCP_SC, code) | DBG_FUNC_START,
+		0, 0, 0, 0, 0);
+
+	uthread->uu_rval[0] = 0;
+	uthread->uu_rval[1] = 0;
+	uthread->syscall_code = code;
+
+	error = (*(callp->sy_call))((void *) p, (void *)uthread->uu_arg, &(uthread->uu_rval[0]));
+	assert(error != ERESTART && error != EJUSTRETURN);
+
+#if CONFIG_DTRACE
+	uthread->t_dtrace_errno = error;
+#endif /* CONFIG_DTRACE */
+
+	if (__improbable(error)) {
+		regs->rax = error;
+		regs->isf.rflags |= EFL_CF;	/* carry bit */
+	} else {
+		unix_syscall64_set_rval(regs, callp, uthread);
+	}
+
+	KERNEL_DEBUG_CONSTANT_IST(KDEBUG_TRACE,
+		BSDDBG_CODE(DBG_BSD_EXCP_SC, code) | DBG_FUNC_END,
+		error, uthread->uu_rval[0], uthread->uu_rval[1], proc_pid(p), 0);
+
+	thread_exception_return();
+	/* NOTREACHED */
+}
+
 __attribute__((noreturn))
 void
 unix_syscall64(x86_saved_state_t *state)
@@ -327,6 +402,11 @@ unix_syscall64(x86_saved_state_t *state)
 		args_in_regs = 6;
 	}
 
+	if (__probable(syscall_is_light(code)) && !AUDIT_ENABLED()) {
+		unix_syscall64_light(regs, uthread, p, code, callp);
+		/* NOTREACHED */
+	}
+
 	if (callp->sy_narg != 0) {
 		assert(callp->sy_narg <= 8); /* size of uu_arg */
 
@@ -404,30 +484,7 @@ unix_syscall64(x86_saved_state_t *state)
 			regs->isf.rflags |= EFL_CF;	/* carry bit */
 		} else { /* (not error) */
 
-			switch (callp->sy_return_type) {
-			case _SYSCALL_RET_INT_T:
-				regs->rax = uthread->uu_rval[0];
-				regs->rdx = uthread->uu_rval[1];
-				break;
-			case _SYSCALL_RET_UINT_T:
-				regs->rax = ((u_int)uthread->uu_rval[0]);
-				regs->rdx = ((u_int)uthread->uu_rval[1]);
-				break;
-			case _SYSCALL_RET_OFF_T:
-			case _SYSCALL_RET_ADDR_T:
-			case _SYSCALL_RET_SIZE_T:
-			case _SYSCALL_RET_SSIZE_T:
-			case _SYSCALL_RET_UINT64_T:
-			        regs->rax = *((uint64_t *)(&uthread->uu_rval[0]));
-				regs->rdx = 0;
-				break;
-			case _SYSCALL_RET_NONE:
-				break;
-			default:
-				panic("unix_syscall: unknown return type");
-				break;
-			}
-			regs->isf.rflags &= ~EFL_CF;
+			unix_syscall64_set_rval(regs, callp, uthread);
 		} 
 	}
 
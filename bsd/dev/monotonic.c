@@ -27,6 +27,9 @@
  */
 
 #include <kern/monotonic.h>
+#if KPC
+#include <kern/kpc.h>
+#endif /* KPC */
 #include <machine/machine_routines.h>
 #include <machine/monotonic.h>
 #include <pexpert/pexpert.h>
@@ -317,6 +320,28 @@ int thread_selfcounts(__unused struct proc *p,
 
 		return copyout(counts, uap->buf, MIN(sizeof(counts), uap->nbytes));
 	}
+#if KPC
+	case 2: {
+		/*
+		 * The counters kpc is counting for threads, which a thread can read for
+		 * itself without the access needed to configure them.
+		 */
+		uint64_t counts[KPC_MAX_COUNTERS];
+		uint32_t count = KPC_MAX_COUNTERS;
+
+		if (!kpc_threads_counting) {
+			return ENOTSUP;
+		}
+
+		int error = kpc_get_curthread_counters(&count, counts);
+		if (error) {
+			return error;
+		}
+
+		return copyout(counts, uap->buf,
+				MIN(count * sizeof(counts[0]), uap->nbytes));
+	}
+#endif /* KPC */
 	default:
 		return EINVAL;
 	}
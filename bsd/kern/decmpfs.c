@@ -67,8 +67,11 @@ UNUSED_SYMBOL(decmpfs_validate_compressed_file)
 #include <sys/ubc.h>
 #include <sys/decmpfs.h>
 #include <sys/uio_internal.h>
+#include <sys/sysctl.h>
 #include <libkern/OSByteOrder.h>
+#include <libkern/OSAtomic.h>
 #include <libkern/section_keywords.h>
+#include <kern/thread_call.h>
 
 #pragma mark --- debugging ---
 
@@ -1074,6 +1077,153 @@ compression_type_valid(vnode_t vp, decmpfs_header *hdr)
 
 #pragma mark --- compression/decompression routines ---
 
+/*
+ * Large single buffer fetches (cluster reads and big pageins) are split into
+ * pieces aligned on decmpfs_fetch_piece_size, which is kept a multiple of the
+ * 64K chunks the compressors work in, and the pieces are decompressed
+ * concurrently by up to decmpfs_fetch_workers thread calls.  The requesting
+ * thread takes pieces as well, so the fetch still completes if no thread
+ * call gets to run.
+ */
+#define DECMPFS_FETCH_PIECE_ALIGN   (64 * 1024)
+#define DECMPFS_FETCH_MAX_PIECES    32
+#define DECMPFS_FETCH_MAX_WORKERS   8
+
+static uint32_t decmpfs_fetch_workers = 3;
+SYSCTL_UINT(_kern, OID_AUTO, decmpfs_fetch_workers, CTLFLAG_RW | CTLFLAG_LOCKED,
+    &decmpfs_fetch_workers, 0, "thread calls helping decompress a large fetch");
+
+static uint32_t decmpfs_fetch_piece_size = 128 * 1024;
+SYSCTL_UINT(_kern, OID_AUTO, decmpfs_fetch_piece_size, CTLFLAG_RW | CTLFLAG_LOCKED,
+    &decmpfs_fetch_piece_size, 0, "size of the pieces a large fetch is split into");
+
+static uint64_t decmpfs_fetch_parallel = 0;
+SYSCTL_QUAD(_kern, OID_AUTO, decmpfs_fetch_parallel, CTLFLAG_RD | CTLFLAG_LOCKED,
+    &decmpfs_fetch_parallel, "fetches decompressed in parallel pieces");
+
+typedef struct {
+    vnode_t vp;
+    decmpfs_header *hdr;
+    decmpfs_fetch_uncompressed_data_func fetch;
+    off_t offset;           /* start of the fetch */
+    off_t end;              /* end of the fetch */
+    off_t base;             /* offset rounded down to a piece */
+    off_t piece;            /* piece size */
+    char *buf;
+    int npieces;
+    volatile SInt32 next;   /* next piece to decompress */
+    volatile SInt32 err;    /* first error seen */
+    uint64_t did_read[DECMPFS_FETCH_MAX_PIECES];
+} decmpfs_fetch_job;
+
+static void
+decmpfs_fetch_job_run(decmpfs_fetch_job *job)
+{
+    SInt32 i;
+
+    while ((i = OSIncrementAtomic(&job->next)) < job->npieces) {
+        off_t start = MAX(job->offset, job->base + i * job->piece);
+        off_t end = MIN(job->end, job->base + (i + 1) * job->piece);
+        decmpfs_vector vec = {
+            .buf = job->buf + (start - job->offset),
+            .size = (user_ssize_t)(end - start),
+        };
+        int err;
+
+        if (job->err != 0) {
+            /* the fetch already failed, don't bother */
+            continue;
+        }
+        DECMPFS_EMIT_TRACE_ENTRY(DECMPDBG_FETCH_PIECE, job->vp->v_id,
+            (int)start, (int)vec.size, i);
+        err = job->fetch(job->vp, decmpfs_ctx, job->hdr, start, vec.size,
+            1, &vec, &job->did_read[i]);
+        DECMPFS_EMIT_TRACE_RETURN(DECMPDBG_FETCH_PIECE, job->vp->v_id,
+            (int)job->did_read[i], err);
+        if (err != 0) {
+            (void)OSCompareAndSwap(0, err, (volatile UInt32 *)&job->err);
+        }
+    }
+}
+
+static void
+decmpfs_fetch_job_worker(thread_call_param_t param0, __unused thread_call_param_t param1)
+{
+    decmpfs_fetch_job_run((decmpfs_fetch_job *)param0);
+}
+
+/*
+ * Fetch [offset, offset + size) into buf in parallel pieces.  Called, like
+ * the compressor's fetch, with decompressorsLock held shared; the lock stays
+ * held until all the workers are done with the job.  Returns -1 if the fetch
+ * isn't worth splitting, in which case the caller does it in one go.
+ */
+static int
+decmpfs_fetch_parallel_pieces(vnode_t vp, decmpfs_header *hdr,
+    decmpfs_fetch_uncompressed_data_func fetch, off_t offset, user_ssize_t size,
+    char *buf, uint64_t *bytes_read)
+{
+    thread_call_t workers[DECMPFS_FETCH_MAX_WORKERS];
+    decmpfs_fetch_job job;
+    uint32_t nworkers = MIN(decmpfs_fetch_workers, DECMPFS_FETCH_MAX_WORKERS);
+    off_t piece = decmpfs_fetch_piece_size & ~(DECMPFS_FETCH_PIECE_ALIGN - 1);
+    uint32_t i, started = 0;
+    int p;
+
+    if (nworkers == 0 || piece == 0 || size < 2 * piece) {
+        return -1;
+    }
+
+    if (size > DECMPFS_FETCH_MAX_PIECES / 2 * piece) {
+        /* grow the pieces rather than splitting a big fetch too finely */
+        piece = roundup(size / (DECMPFS_FETCH_MAX_PIECES / 2), DECMPFS_FETCH_PIECE_ALIGN);
+    }
+
+    bzero(&job, sizeof(job));
+    job.vp = vp;
+    job.hdr = hdr;
+    job.fetch = fetch;
+    job.offset = offset;
+    job.end = offset + size;
+    job.base = offset - (offset % piece);
+    job.piece = piece;
+    job.buf = buf;
+    job.npieces = (int)((job.end - job.base + piece - 1) / piece);
+    nworkers = MIN(nworkers, (uint32_t)job.npieces - 1);
+
+    for (i = 0; i < nworkers; i++) {
+        workers[i] = thread_call_allocate_with_priority(decmpfs_fetch_job_worker,
+            &job, THREAD_CALL_PRIORITY_USER);
+        if (workers[i] == NULL) {
+            break;
+        }
+        thread_call_enter(workers[i]);
+        started++;
+    }
+    OSIncrementAtomic64((SInt64 *)&decmpfs_fetch_parallel);
+
+    decmpfs_fetch_job_run(&job);
+
+    /* pieces are all taken; drop the workers that didn't get to run */
+    for (i = 0; i < started; i++) {
+        thread_call_cancel_wait(workers[i]);
+        thread_call_free(workers[i]);
+    }
+
+    /* report what was read contiguously from the start of the fetch */
+    *bytes_read = 0;
+    for (p = 0; p < job.npieces; p++) {
+        off_t start = MAX(job.offset, job.base + p * piece);
+        off_t end = MIN(job.end, job.base + (p + 1) * piece);
+
+        *bytes_read += job.did_read[p];
+        if (job.did_read[p] < (uint64_t)(end - start)) {
+            break;
+        }
+    }
+    return job.err;
+}
+
 static int
 decmpfs_fetch_uncompressed_data(vnode_t vp, decmpfs_cnode *cp, decmpfs_header *hdr, off_t offset, user_ssize_t size, int nvec, decmpfs_vector *vec, uint64_t *bytes_read)
 {
@@ -1119,7 +1269,14 @@ decmpfs_fetch_uncompressed_data(vnode_t vp, decmpfs_cnode *cp, decmpfs_header *h
     lck_rw_lock_shared(decompressorsLock);
     decmpfs_fetch_uncompressed_data_func fetch = decmp_get_func(vp, hdr->compression_type, fetch);
     if (fetch) {
-		err = fetch(vp, decmpfs_ctx, hdr, offset, size, nvec, vec, bytes_read);
+		err = -1;
+		if (nvec == 1 && vec[0].size >= size) {
+			err = decmpfs_fetch_parallel_pieces(vp, hdr, fetch, offset, size,
+			    vec[0].buf, bytes_read);
+		}
+		if (err == -1) {
+			err = fetch(vp, decmpfs_ctx, hdr, offset, size, nvec, vec, bytes_read);
+		}
 		lck_rw_unlock_shared(decompressorsLock);
         if (err == 0) {
             uint64_t decompression_flags = decmpfs_cnode_get_decompression_flags(cp);
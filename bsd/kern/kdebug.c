@@ -267,11 +267,13 @@ int kdbg_control(int *, u_int, user_addr_t, size_t *);
 
 static int kdbg_read(user_addr_t, size_t *, vnode_t, vfs_context_t, uint32_t);
 static int kdbg_readcpumap(user_addr_t, size_t *);
+static int kdbg_readcpulost(user_addr_t, size_t *);
 static int kdbg_readthrmap_v3(user_addr_t, size_t, int);
 static int kdbg_readcurthrmap(user_addr_t, size_t *);
 static int kdbg_setreg(kd_regtype *);
 static int kdbg_setpidex(kd_regtype *);
 static int kdbg_setpid(kd_regtype *);
+static int kdbg_setpidverbose(kd_regtype *);
 static void kdbg_thrmap_init(void);
 static int kdbg_reinit(boolean_t);
 static int kdbg_bootstrap(boolean_t);
@@ -387,6 +389,7 @@ struct kd_bufinfo {
 	uint32_t _pad;
 	uint64_t kd_prev_timebase;
 	uint32_t num_bufs;
+	uint64_t kd_lost;		/* events overwritten or dropped on this CPU */
 } __attribute__(( aligned(MAX_CPU_CACHE_LINE_SIZE) ));
 
 
@@ -882,6 +885,7 @@ allocate_storage_unit(int cpu)
 		if (kd_ctrl_page.kdebug_flags & KDBG_NOWRAP) {
 			kd_ctrl_page.kdebug_slowcheck |= SLOW_NOLOG;
 			kdbp->kd_lostevents = TRUE;
+			kdbp->kd_lost++;
 			retval = FALSE;
 			goto out;
 		}
@@ -933,6 +937,7 @@ allocate_storage_unit(int cpu)
 		kdsp = kdbp_vict->kd_list_head;
 		kdsp_actual = POINTER_FROM_KDS_PTR(kdsp);
 		kdbp_vict->kd_list_head = kdsp_actual->kds_next;
+		kdbp_vict->kd_lost += kdsp_actual->kds_bufcnt - kdsp_actual->kds_readlast;
 
 		if (kdbp_vict->kd_list_head.raw != KDS_PTR_NULL) {
 			kdsp_next_actual = POINTER_FROM_KDS_PTR(kdbp_vict->kd_list_head);
@@ -1190,6 +1195,27 @@ kdebug_debugid_procfilt_allowed(uint32_t debugid)
 	}
 }
 
+/*
+ * Check if the current process is marked to be traced at full verbosity,
+ * regardless of the typefilter, range or value filters.
+ *
+ * Returns true if every event of the current process should be recorded.
+ */
+static inline bool
+kdebug_current_proc_verbose(void)
+{
+	if (__probable(!(kd_ctrl_page.kdebug_flags & KDBG_PIDVERBOSE))) {
+		return false;
+	}
+
+	if (ml_at_interrupt_context()) {
+		return false;
+	}
+
+	struct proc *curproc = current_proc();
+	return curproc && curproc->p_kdebug;
+}
+
 static void
 kernel_debug_internal(
 	uint32_t debugid,
@@ -1222,6 +1248,10 @@ kernel_debug_internal(
 			goto out1;
 		}
 
+		if (observe_procfilt && kdebug_current_proc_verbose()) {
+			goto record_event;
+		}
+
 		if (kd_ctrl_page.kdebug_flags & KDBG_TYPEFILTER_CHECK) {
 			if (typefilter_is_debugid_allowed(kdbg_typefilter, debugid))
 				goto record_event;
@@ -1787,6 +1817,10 @@ kdebug_debugid_enabled(uint32_t debugid)
 		return TRUE;
 	}
 
+	if (kdebug_current_proc_verbose()) {
+		return TRUE;
+	}
+
 	return kdebug_debugid_explicitly_enabled(debugid);
 }
 
@@ -2284,7 +2318,7 @@ kdbg_clear(void)
 	IOSleep(100);
 
 	/* reset kdebug state for each process */
-	if (kd_ctrl_page.kdebug_flags & (KDBG_PIDCHECK | KDBG_PIDEXCLUDE)) {
+	if (kd_ctrl_page.kdebug_flags & (KDBG_PIDCHECK | KDBG_PIDEXCLUDE | KDBG_PIDVERBOSE)) {
 		proc_list_lock();
 		proc_t p;
 		ALLPROC_FOREACH(p) {
@@ -2295,7 +2329,7 @@ kdbg_clear(void)
 
 	kd_ctrl_page.kdebug_flags &= (unsigned int)~KDBG_CKTYPES;
 	kd_ctrl_page.kdebug_flags &= ~(KDBG_NOWRAP | KDBG_RANGECHECK | KDBG_VALCHECK);
-	kd_ctrl_page.kdebug_flags &= ~(KDBG_PIDCHECK | KDBG_PIDEXCLUDE);
+	kd_ctrl_page.kdebug_flags &= ~(KDBG_PIDCHECK | KDBG_PIDEXCLUDE | KDBG_PIDVERBOSE);
 
 	kd_ctrl_page.oldest_time = 0;
 
@@ -2394,8 +2428,9 @@ kdbg_setpidex(kd_regtype *kdr)
 				 * turn on pid exclusion
 				 */
 				kd_ctrl_page.kdebug_flags |= KDBG_PIDEXCLUDE;
-				kd_ctrl_page.kdebug_flags &= ~KDBG_PIDCHECK;
+				kd_ctrl_page.kdebug_flags &= ~(KDBG_PIDCHECK | KDBG_PIDVERBOSE);
 				kdbg_set_flags(SLOW_CHECKS, 0, TRUE);
+				commpage_update_kdebug_state();
 
 				p->p_kdebug = 1;
 			}
@@ -2416,6 +2451,50 @@ kdbg_setpidex(kd_regtype *kdr)
 	return(ret);
 }
 
+/*
+ * Trace the marked processes at full verbosity, while every other process
+ * is still subject to the typefilter, range or value filters.  Can be
+ * combined with the pid check to trace only the marked processes.
+ */
+int
+kdbg_setpidverbose(kd_regtype *kdr)
+{
+	pid_t pid;
+	int flag, ret=0;
+	struct proc *p;
+
+	pid = (pid_t)kdr->value1;
+	flag = (int)kdr->value2;
+
+	if (pid >= 0) {
+		if ((p = proc_find(pid)) == NULL)
+			ret = ESRCH;
+		else {
+			if (flag == 1) {
+				/*
+				 * turn on full verbosity for this and all marked pids
+				 */
+				kd_ctrl_page.kdebug_flags |= KDBG_PIDVERBOSE;
+				kd_ctrl_page.kdebug_flags &= ~KDBG_PIDEXCLUDE;
+				kdbg_set_flags(SLOW_CHECKS, 0, TRUE);
+				commpage_update_kdebug_state();
+
+				p->p_kdebug = 1;
+			} else {
+				/*
+				 * turn off full verbosity for this pid value
+				 * Don't turn it off for all pids though
+				 */
+				p->p_kdebug = 0;
+			}
+			proc_rele(p);
+		}
+	} else
+		ret = EINVAL;
+
+	return(ret);
+}
+
 /*
  * The following functions all operate on the "global" typefilter singleton.
  */
@@ -2524,7 +2603,7 @@ kdbg_disable_typefilter(void)
 	bool notify_iops = kd_ctrl_page.kdebug_flags & KDBG_TYPEFILTER_CHECK;
 	kd_ctrl_page.kdebug_flags &= ~KDBG_TYPEFILTER_CHECK;
 
-	if ((kd_ctrl_page.kdebug_flags & (KDBG_PIDCHECK | KDBG_PIDEXCLUDE))) {
+	if ((kd_ctrl_page.kdebug_flags & (KDBG_PIDCHECK | KDBG_PIDEXCLUDE | KDBG_PIDVERBOSE))) {
 		kdbg_set_flags(SLOW_CHECKS, 0, TRUE);
 	} else {
 		kdbg_set_flags(SLOW_CHECKS, 0, FALSE);
@@ -2547,7 +2626,12 @@ uint32_t
 kdebug_commpage_state(void)
 {
 	if (kdebug_enable) {
-		if (kd_ctrl_page.kdebug_flags & KDBG_TYPEFILTER_CHECK) {
+		/*
+		 * User space can't tell whether it is traced at full verbosity,
+		 * so it has to leave the typefilter to the kernel.
+		 */
+		if ((kd_ctrl_page.kdebug_flags & KDBG_TYPEFILTER_CHECK) &&
+		    !(kd_ctrl_page.kdebug_flags & KDBG_PIDVERBOSE)) {
 			return KDEBUG_COMMPAGE_ENABLE_TYPEFILTER | KDEBUG_COMMPAGE_ENABLE_TRACE;
 		}
 
@@ -2608,7 +2692,7 @@ kdbg_setreg(kd_regtype * kdr)
 
 		if ( (kd_ctrl_page.kdebug_flags & (KDBG_RANGECHECK | KDBG_VALCHECK   | 
 						   KDBG_PIDCHECK   | KDBG_PIDEXCLUDE | 
-						   KDBG_TYPEFILTER_CHECK)) )
+						   KDBG_PIDVERBOSE | KDBG_TYPEFILTER_CHECK)) )
 			kdbg_set_flags(SLOW_CHECKS, 0, TRUE);
 		else
 			kdbg_set_flags(SLOW_CHECKS, 0, FALSE);
@@ -2939,6 +3023,44 @@ kdbg_readcpumap(user_addr_t user_cpumap, size_t *user_cpumap_size)
 	return (ret);
 }
 
+/*
+ * Copies out the number of events each CPU has lost since the buffers were
+ * set up, as an array of uint64_t indexed like the CPU map.
+ */
+static int
+kdbg_readcpulost(user_addr_t user_lost, size_t *user_lost_size)
+{
+	uint64_t lost[32];
+	unsigned int cpu, count;
+	size_t offset = 0;
+	int ret = 0;
+
+	if (!(kd_ctrl_page.kdebug_flags & KDBG_BUFINIT))
+		return (EINVAL);
+
+	if (!user_lost) {
+		*user_lost_size = kd_ctrl_page.kdebug_cpus * sizeof(uint64_t);
+		return (0);
+	}
+	if (*user_lost_size < kd_ctrl_page.kdebug_cpus * sizeof(uint64_t))
+		return (EINVAL);
+
+	/* read without kds_spin_lock, a count may miss the storage unit being stolen */
+	for (cpu = 0; cpu < kd_ctrl_page.kdebug_cpus; cpu += count) {
+		count = MIN(kd_ctrl_page.kdebug_cpus - cpu, sizeof(lost) / sizeof(lost[0]));
+		for (unsigned int i = 0; i < count; i++)
+			lost[i] = kdbip[cpu + i].kd_lost;
+		if (copyout(lost, user_lost + offset, count * sizeof(uint64_t))) {
+			ret = EFAULT;
+			break;
+		}
+		offset += count * sizeof(uint64_t);
+	}
+	*user_lost_size = offset;
+
+	return (ret);
+}
+
 int
 kdbg_readcurthrmap(user_addr_t buffer, size_t *bufsize)
 {
@@ -3372,7 +3494,8 @@ kdbg_control(int *name, u_int namelen, user_addr_t where, size_t *sizep)
 	 */
 	if (name[0] != KERN_KDGETBUF &&
 	    name[0] != KERN_KDGETREG &&
-	    name[0] != KERN_KDREADCURTHRMAP)
+	    name[0] != KERN_KDREADCURTHRMAP &&
+	    name[0] != KERN_KDCPULOST)
 	{
 		if ((ret = ktrace_configure(KTRACE_KDEBUG))) {
 			goto out;
@@ -3599,10 +3722,27 @@ kdbg_control(int *name, u_int namelen, user_addr_t where, size_t *sizep)
 			ret = kdbg_setpidex(&kd_Reg);
 			break;
 
+		case KERN_KDPIDVERBOSE:
+			if (size < sizeof(kd_regtype)) {
+				ret = EINVAL;
+				break;
+			}
+			if (copyin(where, &kd_Reg, sizeof(kd_regtype))) {
+				ret = EINVAL;
+				break;
+			}
+
+			ret = kdbg_setpidverbose(&kd_Reg);
+			break;
+
 		case KERN_KDCPUMAP:
 			ret = kdbg_readcpumap(where, sizep);
 			break;
 
+		case KERN_KDCPULOST:
+			ret = kdbg_readcpulost(where, sizep);
+			break;
+
 		case KERN_KDTHRMAP:
 			ret = kdbg_copyout_thread_map(where, sizep);
 			break;
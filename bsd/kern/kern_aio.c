@@ -226,6 +226,8 @@ static aio_workq_entry *aio_create_queue_entry(proc_t procp,
 static user_addr_t *aio_copy_in_list(proc_t procp, user_addr_t aiocblist, int nent);
 static void		free_lio_context(aio_lio_context* context);
 static void 		aio_enqueue_work( proc_t procp, aio_workq_entry *entryp, int proc_locked);
+static void		aio_enqueue_inline_locked( proc_t procp, aio_workq_entry *entryp );
+static void		aio_perform_request( aio_workq_entry *entryp );
 
 #define ASSERT_AIO_PROC_LOCK_OWNED(p)	lck_mtx_assert(aio_proc_mutex((p)), LCK_MTX_ASSERT_OWNED)
 #define ASSERT_AIO_WORKQ_LOCK_OWNED(q)	lck_mtx_assert(aio_workq_mutex((q)), LCK_MTX_ASSERT_OWNED)
@@ -253,6 +255,13 @@ extern int aio_max_requests;  			/* AIO_MAX - configurable */
 extern int aio_max_requests_per_process;	/* AIO_PROCESS_MAX - configurable */
 extern int aio_worker_threads;			/* AIO_THREAD_COUNT - configurable */
 
+/*
+ * When set, lio_listio(LIO_WAIT) performs its reads and writes on the
+ * calling thread, which would otherwise only sleep until the worker
+ * threads are done, saving two context switches per request.
+ */
+int aio_listio_inline = 1;
+
 
 /*
  * aio static variables.
@@ -1387,9 +1396,7 @@ aio_enqueue_work( proc_t procp, aio_workq_entry *entryp, int proc_locked)
 	ASSERT_AIO_PROC_LOCK_OWNED(procp);
 
 	/* Onto proc queue */
-	TAILQ_INSERT_TAIL(&procp->p_aio_activeq, entryp,  aio_proc_link);
-	procp->p_aio_active_count++;
-	procp->p_aio_total_count++;
+	aio_enqueue_inline_locked(procp, entryp);
 
 	/* And work queue */
 	aio_workq_lock_spin(queue);
@@ -1444,6 +1451,26 @@ aio_enqueue_work( proc_t procp, aio_workq_entry *entryp, int proc_locked)
 }
 
 
+/*
+ * aio_enqueue_inline_locked - account for a request on the proc's active
+ * queue without handing it to the worker threads.  The caller is then
+ * responsible for running it with aio_perform_request().  Requests that
+ * are not on a work queue cannot be cancelled, exactly like the ones a
+ * worker thread has already picked up.
+ *
+ * Called with proc locked.
+ */
+static void
+aio_enqueue_inline_locked( proc_t procp, aio_workq_entry *entryp )
+{
+	ASSERT_AIO_PROC_LOCK_OWNED(procp);
+
+	TAILQ_INSERT_TAIL(&procp->p_aio_activeq, entryp,  aio_proc_link);
+	procp->p_aio_active_count++;
+	procp->p_aio_total_count++;
+}
+
+
 /*
  * lio_listio - initiate a list of IO requests.  We process the list of
  * aiocbs either synchronously (mode == LIO_WAIT) or asynchronously
@@ -1460,6 +1487,7 @@ lio_listio(proc_t p, struct lio_listio_args *uap, int *retval )
 	int				call_result;
 	int				result;
 	int				old_count;
+	int				inline_count = 0;
 	aio_workq_entry			**entryp_listp;
 	user_addr_t			*aiocbpp;
 	struct user_sigevent		aiosigev;
@@ -1597,7 +1625,15 @@ lio_listio(proc_t p, struct lio_listio_args *uap, int *retval )
 		}
 		
 		lck_mtx_convert_spin(aio_proc_mutex(p));
-		aio_enqueue_work(p, entryp, 1);
+		if ( uap->mode == LIO_WAIT && aio_listio_inline &&
+			 (entryp->flags & (AIO_READ | AIO_WRITE)) != 0 ) {
+			/* performed below, once the whole list is accounted for */
+			aio_enqueue_inline_locked(p, entryp);
+			inline_count++;
+		} else {
+			aio_enqueue_work(p, entryp, 1);
+			entryp_listp[i] = NULL;
+		}
 		aio_proc_unlock(p);
 		
         KERNEL_DEBUG_CONSTANT( (BSDDBG_CODE(DBG_BSD_AIO, AIO_work_queued)) | DBG_FUNC_START,
@@ -1612,6 +1648,22 @@ lio_listio(proc_t p, struct lio_listio_args *uap, int *retval )
 
 	switch(uap->mode) {
 	case LIO_WAIT:
+		/*
+		 * Run the requests we kept for ourselves; the rest are being
+		 * serviced by the worker threads meanwhile.
+		 */
+		for ( i = 0; inline_count > 0 && i < uap->nent; i++ ) {
+			aio_workq_entry		 		*entryp = entryp_listp[i];
+
+			if ( entryp == NULL )
+				continue;
+
+			aio_entry_ref(entryp);
+			OSIncrementAtomic(&aio_anchor.aio_inflight_count);
+			aio_perform_request(entryp);
+			inline_count--;
+		}
+
 		aio_proc_lock_spin(p);
 		while (lio_context->io_completed < lio_context->io_issued) {
 			result = msleep(lio_context, aio_proc_mutex(p), PCATCH | PRIBIO | PSPIN, "lio_listio", 0);
@@ -1669,11 +1721,6 @@ static void
 aio_work_thread(void)
 {
 	aio_workq_entry		 	*entryp;
-	int 			error;
-	vm_map_t 		currentmap;
-	vm_map_t 		oldmap = VM_MAP_NULL;
-	task_t			oldaiotask = TASK_NULL;
-	struct uthread	*uthreadp = NULL;
 	
 	for( ;; ) {
 		/* 
@@ -1682,81 +1729,99 @@ aio_work_thread(void)
 		 */
 		entryp = aio_get_some_work();         
 
-		KERNEL_DEBUG( (BSDDBG_CODE(DBG_BSD_AIO, AIO_worker_thread)) | DBG_FUNC_START,
-				(int)entryp->procp, (int)entryp->uaiocbp, entryp->flags, 0, 0 );
+		aio_perform_request( entryp );
+	} /* for ( ;; ) */
 
-		/*
-		 * Assume the target's address space identity for the duration
-		 * of the IO.  Note: don't need to have the entryp locked,
-		 * because the proc and map don't change until it's freed.
-		 */
-		currentmap = get_task_map( (current_proc())->task );
-		if ( currentmap != entryp->aio_map ) {
-			uthreadp = (struct uthread *) get_bsdthread_info(current_thread());
-			oldaiotask = uthreadp->uu_aio_task;
-			uthreadp->uu_aio_task = entryp->procp->task;
-			oldmap = vm_map_switch( entryp->aio_map );
-		}
+	/* NOT REACHED */
+	
+} /* aio_work_thread */
 
-		if ( (entryp->flags & AIO_READ) != 0 ) {
-			error = do_aio_read( entryp );
-		}
-		else if ( (entryp->flags & AIO_WRITE) != 0 ) {
-			error = do_aio_write( entryp );
-		}
-		else if ( (entryp->flags & (AIO_FSYNC | AIO_DSYNC)) != 0 ) {
-			error = do_aio_fsync( entryp );
-		}
-		else {
-			printf( "%s - unknown aio request - flags 0x%02X \n", 
-					__FUNCTION__, entryp->flags );
-			error = EINVAL;
-		}
 
-		/* Restore old map */
-		if ( currentmap != entryp->aio_map ) {
-			(void) vm_map_switch( oldmap );
-			uthreadp->uu_aio_task = oldaiotask;
-		}
+/*
+ * aio_perform_request - do the IO described by a ref'ed entry, move it to
+ * the done queue and provide notifications.  Called from the worker
+ * threads, and from lio_listio() for requests it runs on the caller.
+ */
+static void
+aio_perform_request( aio_workq_entry *entryp )
+{
+	int 			error;
+	vm_map_t 		currentmap;
+	vm_map_t 		oldmap = VM_MAP_NULL;
+	task_t			oldaiotask = TASK_NULL;
+	struct uthread	*uthreadp = NULL;
 
-		KERNEL_DEBUG( (BSDDBG_CODE(DBG_BSD_AIO, AIO_worker_thread)) | DBG_FUNC_END,
-				(int)entryp->procp, (int)entryp->uaiocbp, entryp->errorval, 
-				entryp->returnval, 0 );
+	KERNEL_DEBUG( (BSDDBG_CODE(DBG_BSD_AIO, AIO_worker_thread)) | DBG_FUNC_START,
+			(int)entryp->procp, (int)entryp->uaiocbp, entryp->flags, 0, 0 );
 
-		
-		/* XXX COUNTS */
-		aio_entry_lock_spin(entryp);
-		entryp->errorval = error;	
-		aio_entry_unlock(entryp);
+	/*
+	 * Assume the target's address space identity for the duration
+	 * of the IO.  Note: don't need to have the entryp locked,
+	 * because the proc and map don't change until it's freed.
+	 */
+	currentmap = get_task_map( (current_proc())->task );
+	if ( currentmap != entryp->aio_map ) {
+		uthreadp = (struct uthread *) get_bsdthread_info(current_thread());
+		oldaiotask = uthreadp->uu_aio_task;
+		uthreadp->uu_aio_task = entryp->procp->task;
+		oldmap = vm_map_switch( entryp->aio_map );
+	}
 
-		/* we're done with the IO request so pop it off the active queue and */
-		/* push it on the done queue */
-		aio_proc_lock(entryp->procp);
-		aio_proc_move_done_locked(entryp->procp, entryp);
-		aio_proc_unlock(entryp->procp);
+	if ( (entryp->flags & AIO_READ) != 0 ) {
+		error = do_aio_read( entryp );
+	}
+	else if ( (entryp->flags & AIO_WRITE) != 0 ) {
+		error = do_aio_write( entryp );
+	}
+	else if ( (entryp->flags & (AIO_FSYNC | AIO_DSYNC)) != 0 ) {
+		error = do_aio_fsync( entryp );
+	}
+	else {
+		printf( "%s - unknown aio request - flags 0x%02X \n", 
+				__FUNCTION__, entryp->flags );
+		error = EINVAL;
+	}
 
-		OSDecrementAtomic(&aio_anchor.aio_inflight_count);
+	/* Restore old map */
+	if ( currentmap != entryp->aio_map ) {
+		(void) vm_map_switch( oldmap );
+		uthreadp->uu_aio_task = oldaiotask;
+	}
 
-		/* remove our reference to the user land map. */
-		if ( VM_MAP_NULL != entryp->aio_map ) {
-			vm_map_t 		my_map;
+	KERNEL_DEBUG( (BSDDBG_CODE(DBG_BSD_AIO, AIO_worker_thread)) | DBG_FUNC_END,
+			(int)entryp->procp, (int)entryp->uaiocbp, entryp->errorval, 
+			entryp->returnval, 0 );
 
-			my_map = entryp->aio_map;
-			entryp->aio_map = VM_MAP_NULL;
-			vm_map_deallocate( my_map );
-		}
+	
+	/* XXX COUNTS */
+	aio_entry_lock_spin(entryp);
+	entryp->errorval = error;	
+	aio_entry_unlock(entryp);
 
-		/* Provide notifications */
-		do_aio_completion( entryp );
+	/* we're done with the IO request so pop it off the active queue and */
+	/* push it on the done queue */
+	aio_proc_lock(entryp->procp);
+	aio_proc_move_done_locked(entryp->procp, entryp);
+	aio_proc_unlock(entryp->procp);
 
-		/* Will free if needed */
-		aio_entry_unref(entryp);
+	OSDecrementAtomic(&aio_anchor.aio_inflight_count);
 
-	} /* for ( ;; ) */
+	/* remove our reference to the user land map. */
+	if ( VM_MAP_NULL != entryp->aio_map ) {
+		vm_map_t 		my_map;
 
-	/* NOT REACHED */
-	
-} /* aio_work_thread */
+		my_map = entryp->aio_map;
+		entryp->aio_map = VM_MAP_NULL;
+		vm_map_deallocate( my_map );
+	}
+
+	/* Provide notifications */
+	do_aio_completion( entryp );
+
+	/* Will free if needed */
+	aio_entry_unref(entryp);
+
+} /* aio_perform_request */
 
 
 /*
@@ -63,6 +63,7 @@
 #include <mach/mach_vm.h>	/* mach_vm_region_recurse() */
 #include <mach/task.h>		/* task_suspend() */
 #include <kern/task.h>		/* get_task_numacts() */
+#include <kern/kalloc.h>
 
 #include <security/audit/audit.h>
 
@@ -124,6 +125,10 @@ __XNU_PRIVATE_EXTERN int do_coredump = 0;	/* default: don't dump cores */
 __XNU_PRIVATE_EXTERN int do_coredump = 1;	/* default: dump cores */
 #endif
 __XNU_PRIVATE_EXTERN int sugid_coredump = 0; /* default: but not SGUID binaries */
+__XNU_PRIVATE_EXTERN int sparse_coredump = 1; /* default: leave untouched memory out */
+
+/* number of pages whose disposition is looked up at a time */
+#define	CORE_QUERY_PAGES	256
 
 
 /* cpu_type returns only the most generic indication of the current CPU. */
@@ -209,6 +214,78 @@ collectth_state(thread_t th_act, void *tirp)
 		t->hoffset = hoffset;
 }
 
+/*
+ * coredump_write_segment
+ *
+ * Description:	Write out the contents of one segment of a core image.
+ *		When sparse, anonymous memory that is neither resident
+ *		nor compressed has never been touched and reads as
+ *		zeroes, so it is left as a hole in the file and only
+ *		the runs of populated pages are written.
+ *
+ * Parameters:	info				Scratch array of
+ *									CORE_QUERY_PAGES entries, or
+ *									NULL to write the whole segment
+ */
+static int
+coredump_write_segment(proc_t core_proc, vnode_t vp, kauth_cred_t cred,
+    vm_map_t map, mach_vm_offset_t vmoffset, mach_vm_size_t vmsize,
+    off_t foffset, vm_page_info_basic_t info)
+{
+	enum uio_seg	segflg;
+	int		ioflags = IO_NOCACHE|IO_NODELOCKED|IO_UNIT;
+	mach_vm_size_t	off, chunk, run_start = 0, run_len = 0;
+	mach_msg_type_number_t count;
+	kern_return_t	kret;
+	unsigned int	i;
+	int		error;
+
+	segflg = IS_64BIT_PROCESS(core_proc) ? UIO_USERSPACE64 : UIO_USERSPACE32;
+
+	if (info == NULL) {
+		return vn_rdwr_64(UIO_WRITE, vp, vmoffset, vmsize, foffset,
+				segflg, ioflags, cred, (int64_t *) 0, core_proc);
+	}
+
+	for (off = 0; off < vmsize; off += chunk) {
+		chunk = MIN(vmsize - off, (mach_vm_size_t)CORE_QUERY_PAGES * PAGE_SIZE);
+		count = VM_PAGE_INFO_BASIC_COUNT;
+		kret = vm_map_page_range_info_internal(map, vmoffset + off,
+				vmoffset + off + chunk, VM_PAGE_INFO_BASIC,
+				(vm_page_info_t)info, &count);
+		if (kret != KERN_SUCCESS) {
+			/* can't tell what's populated, write the rest out */
+			if (run_len == 0)
+				run_start = off;
+			run_len = vmsize - run_start;
+			break;
+		}
+		for (i = 0; i < (chunk >> PAGE_SHIFT); i++) {
+			if (info[i].disposition &
+			    (VM_PAGE_QUERY_PAGE_PRESENT | VM_PAGE_QUERY_PAGE_PAGED_OUT)) {
+				if (run_len == 0)
+					run_start = off + ptoa_64(i);
+				run_len += PAGE_SIZE;
+				continue;
+			}
+			if (run_len != 0) {
+				error = vn_rdwr_64(UIO_WRITE, vp, vmoffset + run_start,
+						run_len, foffset + run_start, segflg, ioflags,
+						cred, (int64_t *) 0, core_proc);
+				if (error)
+					return (error);
+				run_len = 0;
+			}
+		}
+	}
+	if (run_len != 0) {
+		return vn_rdwr_64(UIO_WRITE, vp, vmoffset + run_start, run_len,
+				foffset + run_start, segflg, ioflags, cred,
+				(int64_t *) 0, core_proc);
+	}
+	return (0);
+}
+
 /*
  * coredump
  *
@@ -267,6 +344,8 @@ coredump(proc_t core_proc, uint32_t reserve_mb, int coredump_flags)
 	int		is_64 = 0;
 	size_t		mach_header_sz = sizeof(struct mach_header);
 	size_t		segment_command_sz = sizeof(struct segment_command);
+	vm_page_info_basic_t page_info = NULL;
+	size_t		page_info_sz = CORE_QUERY_PAGES * sizeof(vm_page_info_basic_data_t);
 	
 	if (current_proc() != core_proc) {
 		panic("coredump() called against proc that is not current_proc: %p", core_proc);
@@ -397,6 +476,10 @@ coredump(proc_t core_proc, uint32_t reserve_mb, int coredump_flags)
 		mh->sizeofcmds = command_size;
 	}
 
+	/* without the scratch array, fall back to dumping everything */
+	if (sparse_coredump)
+		page_info = (vm_page_info_basic_t)kalloc(page_info_sz);
+
 	hoffset = mach_header_sz;	/* offset into header */
 	foffset = round_page(header_size);	/* offset into file */
 	vmoffset = MACH_VM_MIN_ADDRESS;		/* offset into VM */
@@ -495,9 +578,13 @@ coredump(proc_t core_proc, uint32_t reserve_mb, int coredump_flags)
 			&& vbr.user_tag != VM_MEMORY_IOKIT
 			&& coredumpok(map,vmoffset)) {
 			
-			error = vn_rdwr_64(UIO_WRITE, vp, vmoffset, vmsize, foffset,
-					(IS_64BIT_PROCESS(core_proc) ? UIO_USERSPACE64 : UIO_USERSPACE32), 
-					IO_NOCACHE|IO_NODELOCKED|IO_UNIT, cred, (int64_t *) 0, core_proc);
+			/*
+			 * Only anonymous memory can be elided: pages of
+			 * a file that aren't resident still have data.
+			 */
+			error = coredump_write_segment(core_proc, vp, cred, map,
+					vmoffset, vmsize, foffset,
+					vbr.external_pager ? NULL : page_info);
 
 		}
 
@@ -528,6 +615,12 @@ coredump(proc_t core_proc, uint32_t reserve_mb, int coredump_flags)
 	tir1.tstate_size = tstate_size;
 	task_act_iterate_wth_args(task, collectth_state,&tir1);
 
+	if (page_info != NULL) {
+		kfree(page_info, page_info_sz);
+		/* trailing holes still have to be covered by the file */
+		(void) vnode_setsize(vp, foffset, 0, ctx);
+	}
+
 	/*
 	 *	Write out the Mach header at the beginning of the
 	 *	file.  OK to use a 32 bit write for this.
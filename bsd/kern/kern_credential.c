@@ -59,6 +59,7 @@
 #include <mach/host_security.h>
 
 #include <libkern/OSAtomic.h>
+#include <machine/atomic.h>
 
 #include <kern/task.h>
 #include <kern/locks.h>
@@ -285,7 +286,17 @@ static void	kauth_groups_trimcache(int newsize);
 #define KAUTH_CRED_TABLE_SIZE 97
 
 TAILQ_HEAD(kauth_cred_entry_head, ucred);
-static struct kauth_cred_entry_head * kauth_cred_table_anchor = NULL;
+
+/*
+ * Each bucket of the credential hash has its own lock, so that processes
+ * switching to unrelated credentials don't serialize on a single mutex.
+ */
+struct kauth_cred_bucket {
+	lck_mtx_t			kcb_lock;
+	struct kauth_cred_entry_head	kcb_creds;
+	u_int				kcb_count;	/* credentials in the bucket */
+};
+static struct kauth_cred_bucket * kauth_cred_table_anchor = NULL;
 
 #define KAUTH_CRED_HASH_DEBUG	0
 
@@ -293,8 +304,12 @@ static int kauth_cred_add(kauth_cred_t new_cred);
 static boolean_t kauth_cred_remove(kauth_cred_t cred);
 static inline u_long kauth_cred_hash(const uint8_t *datap, int data_len, u_long start_key);
 static u_long kauth_cred_get_hashkey(kauth_cred_t cred);
+static struct kauth_cred_bucket *kauth_cred_get_bucket(kauth_cred_t cred);
+static kauth_cred_t kauth_cred_find_bucket(struct kauth_cred_bucket *bucket, kauth_cred_t cred);
 static kauth_cred_t kauth_cred_update(kauth_cred_t old_cred, kauth_cred_t new_cred, boolean_t retain_auditinfo);
-static boolean_t kauth_cred_unref_hashlocked(kauth_cred_t *credp);
+static boolean_t kauth_cred_unref_fast(kauth_cred_t cred);
+static boolean_t kauth_cred_unref_hashlocked(struct kauth_cred_bucket *bucket, kauth_cred_t *credp);
+static int sysctl_cred_hash_stats(struct sysctl_oid *oidp, void *arg1, int arg2, struct sysctl_req *req);
 
 #if KAUTH_CRED_HASH_DEBUG
 static int	kauth_cred_count = 0;
@@ -3453,14 +3468,13 @@ kauth_cred_issuser(kauth_cred_t cred)
  * Credential KPI
  */
 
-/* lock protecting credential hash table */
-static lck_mtx_t *kauth_cred_hash_mtx;
-#define KAUTH_CRED_HASH_LOCK()		lck_mtx_lock(kauth_cred_hash_mtx);
-#define KAUTH_CRED_HASH_UNLOCK()	lck_mtx_unlock(kauth_cred_hash_mtx);
+/* locks protecting the buckets of the credential hash table */
+#define KAUTH_CRED_HASH_LOCK(b)		lck_mtx_lock(&(b)->kcb_lock);
+#define KAUTH_CRED_HASH_UNLOCK(b)	lck_mtx_unlock(&(b)->kcb_lock);
 #if KAUTH_CRED_HASH_DEBUG
-#define KAUTH_CRED_HASH_LOCK_ASSERT()	lck_mtx_assert(kauth_cred_hash_mtx, LCK_MTX_ASSERT_OWNED)
+#define KAUTH_CRED_HASH_LOCK_ASSERT(b)	lck_mtx_assert(&(b)->kcb_lock, LCK_MTX_ASSERT_OWNED)
 #else	/* !KAUTH_CRED_HASH_DEBUG */
-#define KAUTH_CRED_HASH_LOCK_ASSERT()
+#define KAUTH_CRED_HASH_LOCK_ASSERT(b)
 #endif	/* !KAUTH_CRED_HASH_DEBUG */
 
 
@@ -3487,7 +3501,9 @@ static lck_mtx_t *kauth_cred_hash_mtx;
  *		credential in the process of having it's last non-hash
  *		reference released.  This would otherwise result in the
  *		possibility of a freed credential that was still in uses due
- *		a race.  This use is protected by the KAUTH_CRED_HASH_LOCK.
+ *		a race.  This use is protected by the KAUTH_CRED_HASH_LOCK
+ *		of the bucket the credential hashes to; no path holds more
+ *		than one bucket lock at a time.
  *
  *		On final release, the hash reference is droped, and the
  *		credential is freed back to the system.
@@ -3500,16 +3516,15 @@ kauth_cred_init(void)
 {
 	int		i;
 	
-	kauth_cred_hash_mtx = lck_mtx_alloc_init(kauth_lck_grp, 0/*LCK_ATTR_NULL*/);
-
 	/*allocate credential hash table */
-	MALLOC(kauth_cred_table_anchor, struct kauth_cred_entry_head *, 
-			(sizeof(struct kauth_cred_entry_head) * KAUTH_CRED_TABLE_SIZE),
+	MALLOC(kauth_cred_table_anchor, struct kauth_cred_bucket *, 
+			(sizeof(struct kauth_cred_bucket) * KAUTH_CRED_TABLE_SIZE),
 			M_KAUTH, M_WAITOK | M_ZERO);
 	if (kauth_cred_table_anchor == NULL)
 		panic("startup: kauth_cred_init");
 	for (i = 0; i < KAUTH_CRED_TABLE_SIZE; i++) {
-		TAILQ_INIT(&kauth_cred_table_anchor[i]);
+		lck_mtx_init(&kauth_cred_table_anchor[i].kcb_lock, kauth_lck_grp, 0/*LCK_ATTR_NULL*/);
+		TAILQ_INIT(&kauth_cred_table_anchor[i].kcb_creds);
 	}
 }
 
@@ -3869,10 +3884,9 @@ kauth_cred_create(kauth_cred_t cred)
 {
 	kauth_cred_t 	found_cred, new_cred = NULL;
 	posix_cred_t	pcred = posix_cred_get(cred);
+	struct kauth_cred_bucket *bucket;
 	int is_member = 0;
 
-	KAUTH_CRED_HASH_LOCK_ASSERT();
-
 	if (pcred->cr_flags & CRF_NOMEMBERD) {
 		pcred->cr_gmuid = KAUTH_UID_NONE;
 	} else {
@@ -3913,19 +3927,20 @@ kauth_cred_create(kauth_cred_t cred)
 	if (pcred->cr_ngroups < 1)
 		return(NULL);
 	
+	bucket = kauth_cred_get_bucket(cred);
 	for (;;) {
-		KAUTH_CRED_HASH_LOCK();
-		found_cred = kauth_cred_find(cred);
+		KAUTH_CRED_HASH_LOCK(bucket);
+		found_cred = kauth_cred_find_bucket(bucket, cred);
 		if (found_cred != NULL) {
 			/*
 			 * Found an existing credential so we'll bump
 			 * reference count and return
 			 */
 			kauth_cred_ref(found_cred);
-			KAUTH_CRED_HASH_UNLOCK();
+			KAUTH_CRED_HASH_UNLOCK(bucket);
 			return(found_cred);
 		}
-		KAUTH_CRED_HASH_UNLOCK();
+		KAUTH_CRED_HASH_UNLOCK(bucket);
 	
 		/*
 		 * No existing credential found.  Create one and add it to
@@ -3949,9 +3964,7 @@ kauth_cred_create(kauth_cred_t cred)
 #endif
 			new_pcred->cr_flags = pcred->cr_flags;
 			
-			KAUTH_CRED_HASH_LOCK();
 			err = kauth_cred_add(new_cred);
-			KAUTH_CRED_HASH_UNLOCK();
 			
 			/* Retry if kauth_cred_add returns non zero value */
 			if (err == 0)
@@ -4801,13 +4814,46 @@ kauth_cred_ref(kauth_cred_t cred)
 }
 
 
+/*
+ * kauth_cred_unref_fast
+ *
+ * Description:	Release a credential reference without the credential hash
+ *		lock, if it isn't the last reference besides the one held by
+ *		the credential hash.
+ *
+ * Parameters:	cred				The credential
+ *
+ * Returns:	TRUE if the reference was released.
+ *		FALSE if the caller must release it with the hash lock held.
+ *
+ * Notes:	Only the transition to the hash's own reference races with a
+ *		lookup finding the credential, and kauth_cred_remove() relies
+ *		on the hash lock for it; any count above that can be dropped
+ *		atomically.
+ */
+static boolean_t
+kauth_cred_unref_fast(kauth_cred_t cred)
+{
+	u_long	old_value, new_value;
+
+	return (os_atomic_rmw_loop(&cred->cr_ref, old_value, new_value, release, {
+		if (old_value < 3) {
+			os_atomic_rmw_loop_give_up(return (FALSE));
+		}
+		new_value = old_value - 1;
+	}));
+}
+
+
 /*
  * kauth_cred_unref_hashlocked
  *
  * Description:	release a credential reference; when the last reference is
  *		released, the credential will be freed.
  *
- * Parameters:	credp				Pointer to address containing
+ * Parameters:	bucket				The locked bucket of the
+ *						credential
+ *		credp				Pointer to address containing
  *						credential to be freed
  *
  * Returns:	TRUE if the credential must be destroyed by the caller.
@@ -4816,7 +4862,8 @@ kauth_cred_ref(kauth_cred_t cred)
  * Implicit returns:
  *		*credp				Set to NOCRED
  *
- * Notes:	This function assumes the credential hash lock is held.
+ * Notes:	This function assumes the hash lock of the credential's bucket
+ *		is held.
  *
  *		This function is internal use only, since the hash lock is
  *		scoped to this compilation unit.
@@ -4831,12 +4878,12 @@ kauth_cred_ref(kauth_cred_t cred)
  *		the credential hash, which is released at the same time.
  */
 static boolean_t
-kauth_cred_unref_hashlocked(kauth_cred_t *credp)
+kauth_cred_unref_hashlocked(__unused struct kauth_cred_bucket *bucket, kauth_cred_t *credp)
 {
 	int		old_value;
 	boolean_t	destroy_it = FALSE;
 
-	KAUTH_CRED_HASH_LOCK_ASSERT();
+	KAUTH_CRED_HASH_LOCK_ASSERT(bucket);
 	NULLCRED_CHECK(*credp);
 
 	old_value = OSAddAtomicLong(-1, (long*)&(*credp)->cr_ref);
@@ -4874,9 +4921,8 @@ kauth_cred_unref_hashlocked(kauth_cred_t *credp)
 /*
  * kauth_cred_unref
  *
- * Description:	Release a credential reference while holding the credential
- *		hash lock; when the last reference is released, the credential
- *		will be freed.
+ * Description:	Release a credential reference; when the last reference is
+ *		released, the credential will be freed.
  *
  * Parameters:	credp				Pointer to address containing
  *						credential to be freed
@@ -4886,17 +4932,27 @@ kauth_cred_unref_hashlocked(kauth_cred_t *credp)
  * Implicit returns:
  *		*credp				Set to NOCRED
  *
- * Notes:	See kauth_cred_unref_hashlocked() for more information.
+ * Notes:	Only the release of the last reference besides the one held
+ *		by the credential hash takes the hash lock, see
+ *		kauth_cred_unref_fast() and kauth_cred_unref_hashlocked().
  *
  */
 void
 kauth_cred_unref(kauth_cred_t *credp)
 {
+	struct kauth_cred_bucket *bucket;
 	boolean_t destroy_it;
 
-	KAUTH_CRED_HASH_LOCK();
-	destroy_it = kauth_cred_unref_hashlocked(credp);
-	KAUTH_CRED_HASH_UNLOCK();
+	NULLCRED_CHECK(*credp);
+	if (kauth_cred_unref_fast(*credp)) {
+		*credp = NOCRED;
+		return;
+	}
+
+	bucket = kauth_cred_get_bucket(*credp);
+	KAUTH_CRED_HASH_LOCK(bucket);
+	destroy_it = kauth_cred_unref_hashlocked(bucket, credp);
+	KAUTH_CRED_HASH_UNLOCK(bucket);
 
 	if (destroy_it == TRUE) {
 		assert(*credp != NOCRED);
@@ -5024,6 +5080,7 @@ kauth_cred_t
 kauth_cred_copy_real(kauth_cred_t cred)
 {
 	kauth_cred_t newcred = NULL, found_cred;
+	struct kauth_cred_bucket *bucket;
 	struct ucred temp_cred;
 	posix_cred_t temp_pcred = posix_cred_get(&temp_cred);
 	posix_cred_t pcred = posix_cred_get(cred);
@@ -5053,14 +5110,15 @@ kauth_cred_copy_real(kauth_cred_t cred)
 	if (temp_pcred->cr_gmuid != KAUTH_UID_NONE)
 		temp_pcred->cr_gmuid = pcred->cr_ruid;
 
+	bucket = kauth_cred_get_bucket(&temp_cred);
 	for (;;) {
 		int		err;
 		
-		KAUTH_CRED_HASH_LOCK();
-		found_cred = kauth_cred_find(&temp_cred);
+		KAUTH_CRED_HASH_LOCK(bucket);
+		found_cred = kauth_cred_find_bucket(bucket, &temp_cred);
 		if (found_cred == cred) {
 			/* same cred so just bail */
-			KAUTH_CRED_HASH_UNLOCK();
+			KAUTH_CRED_HASH_UNLOCK(bucket);
 			return(cred); 
 		}
 		if (found_cred != NULL) {
@@ -5069,9 +5127,10 @@ kauth_cred_copy_real(kauth_cred_t cred)
 			 * one.  We leave the old one alone.
 			 */
 			kauth_cred_ref(found_cred);
-			KAUTH_CRED_HASH_UNLOCK();
+			KAUTH_CRED_HASH_UNLOCK(bucket);
 			return(found_cred);
 		}
+		KAUTH_CRED_HASH_UNLOCK(bucket);
 	
 		/*
 		 * Must allocate a new credential, copy in old credential
@@ -5079,7 +5138,6 @@ kauth_cred_copy_real(kauth_cred_t cred)
 		 */
 		newcred = kauth_cred_dup(&temp_cred);
 		err = kauth_cred_add(newcred);
-		KAUTH_CRED_HASH_UNLOCK();
 
 		/* Retry if kauth_cred_add() fails */
 		if (err == 0)
@@ -5131,6 +5189,7 @@ kauth_cred_update(kauth_cred_t old_cred, kauth_cred_t model_cred,
 	boolean_t retain_auditinfo)
 {	
 	kauth_cred_t found_cred, new_cred = NULL;
+	struct kauth_cred_bucket *bucket;
 	
 	/*
 	 * Make sure we carry the auditinfo forward to the new credential
@@ -5141,41 +5200,31 @@ kauth_cred_update(kauth_cred_t old_cred, kauth_cred_t model_cred,
 		    sizeof(model_cred->cr_audit));
 	}
 	
+	bucket = kauth_cred_get_bucket(model_cred);
 	for (;;) {
 		int		err;
 
-		KAUTH_CRED_HASH_LOCK();
-		found_cred = kauth_cred_find(model_cred);
+		KAUTH_CRED_HASH_LOCK(bucket);
+		found_cred = kauth_cred_find_bucket(bucket, model_cred);
 		if (found_cred == old_cred) {
 			/* same cred so just bail */
-			KAUTH_CRED_HASH_UNLOCK();
+			KAUTH_CRED_HASH_UNLOCK(bucket);
 			return(old_cred); 
 		}
 		if (found_cred != NULL) {
-			boolean_t destroy_it;
-
 			DEBUG_CRED_CHANGE("kauth_cred_update(cache hit): %p -> %p\n", old_cred, found_cred);
 			/*
 			 * Found a match so we bump reference count on new
-			 * one and decrement reference count on the old one.
+			 * one and decrement reference count on the old one;
+			 * the old one hashes to a different bucket, so it is
+			 * released once this bucket is unlocked.
 			 */
 			kauth_cred_ref(found_cred);
-			destroy_it = kauth_cred_unref_hashlocked(&old_cred);
-			KAUTH_CRED_HASH_UNLOCK();
-			if (destroy_it == TRUE) {
-				assert(old_cred != NOCRED);
-#if CONFIG_MACF
-				mac_cred_label_destroy(old_cred);
-#endif
-				AUDIT_SESSION_UNREF(old_cred);
-
-				old_cred->cr_ref = 0;
-				FREE_ZONE(old_cred, sizeof(*old_cred), M_CRED);
-				old_cred = NOCRED;
-
-			}
+			KAUTH_CRED_HASH_UNLOCK(bucket);
+			kauth_cred_unref(&old_cred);
 			return(found_cred);
 		}
+		KAUTH_CRED_HASH_UNLOCK(bucket);
 
 		/*
 		 * Must allocate a new credential using the model.  also
@@ -5183,7 +5232,6 @@ kauth_cred_update(kauth_cred_t old_cred, kauth_cred_t model_cred,
 		 */
 		new_cred = kauth_cred_dup(model_cred);
 		err = kauth_cred_add(new_cred);
-		KAUTH_CRED_HASH_UNLOCK();
 
 		/* retry if kauth_cred_add returns non zero value */
 		if (err == 0)
@@ -5217,26 +5265,26 @@ kauth_cred_update(kauth_cred_t old_cred, kauth_cred_t model_cred,
  *		-1				Hash insertion failed: caller
  *						should retry
  *
- * Locks:	Caller is expected to hold KAUTH_CRED_HASH_LOCK
+ * Locks:	Takes the KAUTH_CRED_HASH_LOCK of the bucket of 'new_cred';
+ *		the caller must not hold any bucket lock
  *
  * Notes:	The 'new_cred' MUST NOT already be in the cred hash cache
  */
 static int
 kauth_cred_add(kauth_cred_t new_cred)
 {
-	u_long			hash_key;
+	struct kauth_cred_bucket *bucket;
 
-	KAUTH_CRED_HASH_LOCK_ASSERT();
-
-	hash_key = kauth_cred_get_hashkey(new_cred);
-	hash_key %= KAUTH_CRED_TABLE_SIZE;
+	bucket = kauth_cred_get_bucket(new_cred);
+	KAUTH_CRED_HASH_LOCK(bucket);
 
 	/* race fix - there is a window where another matching credential 
 	 * could have been inserted between the time this one was created and we
 	 * got the hash lock.  If we find a match return an error and have the 
 	 * the caller retry.
 	 */
-	if (kauth_cred_find(new_cred) != NULL) {
+	if (kauth_cred_find_bucket(bucket, new_cred) != NULL) {
+		KAUTH_CRED_HASH_UNLOCK(bucket);
 		return(-1);
 	}
 	
@@ -5244,7 +5292,9 @@ kauth_cred_add(kauth_cred_t new_cred)
 	kauth_cred_ref(new_cred);
 
 	/* insert the credential into the hash table */
-	TAILQ_INSERT_HEAD(&kauth_cred_table_anchor[hash_key], new_cred, cr_link);
+	TAILQ_INSERT_HEAD(&bucket->kcb_creds, new_cred, cr_link);
+	bucket->kcb_count++;
+	KAUTH_CRED_HASH_UNLOCK(bucket);
 	
 	return(0);
 }
@@ -5260,7 +5310,8 @@ kauth_cred_add(kauth_cred_t new_cred)
  *
  * Returns:	TRUE if the cred was found & removed from the hash; FALSE if not.
  *
- * Locks:	Caller is expected to hold KAUTH_CRED_HASH_LOCK
+ * Locks:	Caller is expected to hold the KAUTH_CRED_HASH_LOCK of the
+ *		bucket of 'cred'
  *
  * Notes:	The check for the reference increment after entry is generally
  *		agree to be safe, since we use atomic operations, and the
@@ -5270,11 +5321,11 @@ kauth_cred_add(kauth_cred_t new_cred)
 static boolean_t
 kauth_cred_remove(kauth_cred_t cred)
 {
-	u_long			hash_key;
+	struct kauth_cred_bucket *bucket;
 	kauth_cred_t	found_cred;
 
-	hash_key = kauth_cred_get_hashkey(cred);
-	hash_key %= KAUTH_CRED_TABLE_SIZE;
+	bucket = kauth_cred_get_bucket(cred);
+	KAUTH_CRED_HASH_LOCK_ASSERT(bucket);
 
 	/* Avoid race */
 	if (cred->cr_ref < 1)
@@ -5283,12 +5334,13 @@ kauth_cred_remove(kauth_cred_t cred)
 		return (FALSE);		/* someone else got a ref */
 		
 	/* Find cred in the credential hash table */
-	TAILQ_FOREACH(found_cred, &kauth_cred_table_anchor[hash_key], cr_link) {
+	TAILQ_FOREACH(found_cred, &bucket->kcb_creds, cr_link) {
 		if (found_cred == cred) {
 			/* found a match, remove it from the hash table */
-			TAILQ_REMOVE(&kauth_cred_table_anchor[hash_key], found_cred, cr_link);
+			TAILQ_REMOVE(&bucket->kcb_creds, found_cred, cr_link);
+			bucket->kcb_count--;
 #if KAUTH_CRED_HASH_DEBUG
-			kauth_cred_count--;
+			OSDecrementAtomic(&kauth_cred_count);
 #endif
 			return (TRUE);
 		}
@@ -5313,16 +5365,40 @@ kauth_cred_remove(kauth_cred_t cred)
  *		!NULL				Matching credential already in
  *						cred hash cache
  *
- * Locks:	Caller is expected to hold KAUTH_CRED_HASH_LOCK
+ * Locks:	Caller is expected to hold the KAUTH_CRED_HASH_LOCK of the
+ *		bucket of 'cred'
  */
 kauth_cred_t
 kauth_cred_find(kauth_cred_t cred)
 {
-	u_long			hash_key;
+	return (kauth_cred_find_bucket(kauth_cred_get_bucket(cred), cred));
+}
+
+
+/* 
+ * kauth_cred_find_bucket
+ *
+ * Description:	Look for a match of the given credential data in the given
+ *		bucket of our credential hash table
+ *
+ * Parameters:	bucket				The bucket 'cred' hashes to
+ *		cred				Credential to lookup in cred
+ *						hash cache
+ *
+ * Returns:	NULL				Not found
+ *		!NULL				Matching credential already in
+ *						cred hash cache
+ *
+ * Locks:	Caller is expected to hold the KAUTH_CRED_HASH_LOCK of
+ *		'bucket'
+ */
+static kauth_cred_t
+kauth_cred_find_bucket(struct kauth_cred_bucket *bucket, kauth_cred_t cred)
+{
 	kauth_cred_t	found_cred;
 	posix_cred_t pcred = posix_cred_get(cred);
 
-	KAUTH_CRED_HASH_LOCK_ASSERT();
+	KAUTH_CRED_HASH_LOCK_ASSERT(bucket);
 
 #if KAUTH_CRED_HASH_DEBUG
 	static int		test_count = 0; 
@@ -5333,11 +5409,8 @@ kauth_cred_find(kauth_cred_t cred)
 	}
 #endif
 
-	hash_key = kauth_cred_get_hashkey(cred);
-	hash_key %= KAUTH_CRED_TABLE_SIZE;
-
 	/* Find cred in the credential hash table */
-	TAILQ_FOREACH(found_cred, &kauth_cred_table_anchor[hash_key], cr_link) {
+	TAILQ_FOREACH(found_cred, &bucket->kcb_creds, cr_link) {
 		boolean_t match;
 		posix_cred_t found_pcred = posix_cred_get(found_cred);
 
@@ -5438,6 +5511,57 @@ kauth_cred_get_hashkey(kauth_cred_t cred)
 }
 
 
+/*
+ * kauth_cred_get_bucket
+ *
+ * Description:	Find the bucket of our credential hash table the given
+ *		credential data hashes to
+ *
+ * Parameters:	cred				Credential for which the bucket
+ *						is desired
+ *
+ * Returns:	(struct kauth_cred_bucket *)	The bucket
+ */
+static struct kauth_cred_bucket *
+kauth_cred_get_bucket(kauth_cred_t cred)
+{
+	return (&kauth_cred_table_anchor[kauth_cred_get_hashkey(cred) % KAUTH_CRED_TABLE_SIZE]);
+}
+
+
+/*
+ * sysctl_cred_hash_stats
+ *
+ * Description:	Report the number of credentials in our credential hash
+ *		table (arg2 == 0) or the length of its longest chain
+ *		(arg2 == 1)
+ *
+ * Notes:	The bucket counts are read without their locks, the result is
+ *		a snapshot for tuning purposes only.
+ */
+static int
+sysctl_cred_hash_stats(__unused struct sysctl_oid *oidp, __unused void *arg1, int arg2, struct sysctl_req *req)
+{
+	u_int	count = 0, maxchain = 0, chain;
+	int	i, value;
+
+	for (i = 0; i < KAUTH_CRED_TABLE_SIZE; i++) {
+		chain = os_atomic_load(&kauth_cred_table_anchor[i].kcb_count, relaxed);
+		count += chain;
+		if (chain > maxchain)
+			maxchain = chain;
+	}
+	value = (arg2 == 0) ? (int)count : (int)maxchain;
+
+	return (SYSCTL_OUT(req, &value, sizeof(value)));
+}
+
+SYSCTL_PROC(_kern, OID_AUTO, cred_hash_count, CTLTYPE_INT | CTLFLAG_RD | CTLFLAG_LOCKED,
+    NULL, 0, sysctl_cred_hash_stats, "I", "Number of credentials in the cred hash");
+SYSCTL_PROC(_kern, OID_AUTO, cred_hash_maxchain, CTLTYPE_INT | CTLFLAG_RD | CTLFLAG_LOCKED,
+    NULL, 1, sysctl_cred_hash_stats, "I", "Longest chain of the cred hash");
+
+
 #if KAUTH_CRED_HASH_DEBUG
 /*
  * kauth_cred_hash_print
@@ -5462,7 +5586,7 @@ kauth_cred_hash_print(void)
 	for (i = 0; i < KAUTH_CRED_TABLE_SIZE; i++) {
 		printf("[%02d] ", i);
 		j = 0;
-		TAILQ_FOREACH(found_cred, &kauth_cred_table_anchor[i], cr_link) {
+		TAILQ_FOREACH(found_cred, &kauth_cred_table_anchor[i].kcb_creds, cr_link) {
 			if (j > 0) {
 				printf("---- ");
 			}
@@ -5645,7 +5769,7 @@ sysctl_dump_creds( __unused struct sysctl_oid *oidp, __unused void *arg1, __unus
 
 	/* calculate space needed */
 	for (i = 0; i < KAUTH_CRED_TABLE_SIZE; i++) {
-		TAILQ_FOREACH(found_cred, &kauth_cred_table_anchor[i], cr_link) {
+		TAILQ_FOREACH(found_cred, &kauth_cred_table_anchor[i].kcb_creds, cr_link) {
 			counter++;
 		}
 	}
@@ -5666,7 +5790,7 @@ sysctl_dump_creds( __unused struct sysctl_oid *oidp, __unused void *arg1, __unus
 	nextp = cred_listp;
 	space = 0;
 	for (i = 0; i < KAUTH_CRED_TABLE_SIZE; i++) {
-		TAILQ_FOREACH(found_cred, &kauth_cred_table_anchor[i], cr_link) {
+		TAILQ_FOREACH(found_cred, &kauth_cred_table_anchor[i].kcb_creds, cr_link) {
 			nextp->credp = found_cred;
 			nextp->cr_ref = found_cred->cr_ref;
 			nextp->cr_uid = found_cred->cr_uid;
@@ -112,6 +112,7 @@
 #include <kern/kalloc.h>
 #include <kern/waitq.h>
 #include <libkern/OSAtomic.h>
+#include <machine/atomic.h>
 
 #include <sys/ubc_internal.h>
 
@@ -1375,6 +1376,50 @@ fcntl_nocancel(proc_t p, struct fcntl_nocancel_args *uap, int32_t *retval)
 
 		goto outdrop;
 	}
+	case F_GETRAHEADSTATS: {
+		fraheadstats_t stats;
+
+		if (fp->f_type != DTYPE_VNODE) {
+			error = EBADF;
+			goto out;
+		}
+
+		vp = (struct vnode *)fp->f_data;
+		proc_fdunlock(p);
+
+		if ((error = vnode_getwithref(vp))) {
+			goto outdrop;
+		}
+
+		cluster_get_rahead_stats(vp, &stats);
+		(void)vnode_put(vp);
+
+		error = copyout((caddr_t)&stats, argp, sizeof(stats));
+
+		goto outdrop;
+	}
+	case F_GETWBSTATS: {
+		fwbstats_t stats;
+
+		if (fp->f_type != DTYPE_VNODE) {
+			error = EBADF;
+			goto out;
+		}
+
+		vp = (struct vnode *)fp->f_data;
+		proc_fdunlock(p);
+
+		if ((error = vnode_getwithref(vp))) {
+			goto outdrop;
+		}
+
+		cluster_get_wbehind_stats(vp, &stats);
+		(void)vnode_put(vp);
+
+		error = copyout((caddr_t)&stats, argp, sizeof(stats));
+
+		goto outdrop;
+	}
 	case F_SETSIZE:
 		if (fp->f_type != DTYPE_VNODE) {
 			error = EBADF;
@@ -3517,7 +3562,7 @@ fp_getfvp(proc_t p, int fd, struct fileproc **resultfp, struct vnode **resultvp)
 		proc_fdunlock(p);
 		return(ENOTSUP);
 	}
-	fp->f_iocount++;
+	os_atomic_inc(&fp->f_iocount, relaxed);
 
 	if (resultfp)
 		*resultfp = fp;
@@ -3576,7 +3621,7 @@ fp_getfvpandvid(proc_t p, int fd, struct fileproc **resultfp,
 		proc_fdunlock(p);
 		return(ENOTSUP);
 	}
-	fp->f_iocount++;
+	os_atomic_inc(&fp->f_iocount, relaxed);
 
 	if (resultfp)
 		*resultfp = fp;
@@ -3633,7 +3678,7 @@ fp_getfsock(proc_t p, int fd, struct fileproc **resultfp,
 		proc_fdunlock(p);
 		return(EOPNOTSUPP);
 	}
-	fp->f_iocount++;
+	os_atomic_inc(&fp->f_iocount, relaxed);
 
 	if (resultfp)
 		*resultfp = fp;
@@ -3688,7 +3733,7 @@ fp_getfkq(proc_t p, int fd, struct fileproc **resultfp,
 		proc_fdunlock(p);
 		return(EBADF);
 	}
-	fp->f_iocount++;
+	os_atomic_inc(&fp->f_iocount, relaxed);
 
 	if (resultfp)
 		*resultfp = fp;
@@ -3746,7 +3791,7 @@ fp_getfpshm(proc_t p, int fd, struct fileproc **resultfp,
 		proc_fdunlock(p);
 		return(EBADF);
 	}
-	fp->f_iocount++;
+	os_atomic_inc(&fp->f_iocount, relaxed);
 
 	if (resultfp)
 		*resultfp = fp;
@@ -3812,7 +3857,7 @@ fp_getfpsem(proc_t p, int fd, struct fileproc **resultfp,
 		proc_fdunlock(p);
 		return(EBADF);
 	}
-	fp->f_iocount++;
+	os_atomic_inc(&fp->f_iocount, relaxed);
 
 	if (resultfp)
 		*resultfp = fp;
@@ -3867,7 +3912,7 @@ fp_getfpipe(proc_t p, int fd, struct fileproc **resultfp,
 		proc_fdunlock(p);
 		return(EBADF);
 	}
-	fp->f_iocount++;
+	os_atomic_inc(&fp->f_iocount, relaxed);
 
 	if (resultfp)
 		*resultfp = fp;
@@ -3918,7 +3963,7 @@ fp_lookup(proc_t p, int fd, struct fileproc **resultfp, int locked)
 			proc_fdunlock(p);
 		return (EBADF);
 	}
-	fp->f_iocount++;
+	os_atomic_inc(&fp->f_iocount, relaxed);
 
 	if (resultfp)
 		*resultfp = fp;
@@ -3929,6 +3974,26 @@ fp_lookup(proc_t p, int fd, struct fileproc **resultfp, int locked)
 }
 
 
+/*
+ * fp_set_drainwait
+ *
+ * Description:	Ask for a wakeup when an f_iocount drops to zero.
+ *
+ * Locks:	The proc_fdlock must be held.
+ *
+ * Notes:	fp_drop() lets go of a reference without the proc_fdlock,
+ *		so the caller must look at f_iocount again after this and
+ *		before sleeping: either it sees the decrement, or fp_drop()
+ *		sees p_fpdrainwait and takes the lock to issue the wakeup.
+ */
+static inline void
+fp_set_drainwait(proc_t p)
+{
+	p->p_fpdrainwait = 1;
+	os_atomic_thread_fence(seq_cst);
+}
+
+
 /*
  * fp_tryswap
  *
@@ -3978,9 +4043,10 @@ fp_tryswap(proc_t p, int fd, struct fileproc *nfp)
 		/*
 		 * Wait for all other active references to evaporate.
 		 */
-		p->p_fpdrainwait = 1;
-		error = msleep(&p->p_fpdrainwait, &p->p_fdmlock,
-		    PRIBIO | PCATCH, "tryswap fpdrain", NULL);
+		fp_set_drainwait(p);
+		if (os_atomic_load(&fp->f_iocount, acquire) > 2)
+			error = msleep(&p->p_fpdrainwait, &p->p_fdmlock,
+			    PRIBIO | PCATCH, "tryswap fpdrain", NULL);
 		if (0 == error) {
 			/*
 			 * Return an "internal" errno to trigger a full
@@ -4019,6 +4085,10 @@ fp_drop_written(proc_t p, int fd, struct fileproc *fp)
 {
         int error;
 
+	/* only the first write needs the lock to set the flag */
+	if (fp->f_flags & FP_WRITTEN)
+		return (fp_drop(p, fd, fp, 0));
+
 	proc_fdlock_spin(p);
 
 	fp->f_flags |= FP_WRITTEN;
@@ -4089,6 +4159,10 @@ fp_drop_event(proc_t p, int fd, struct fileproc *fp)
  *		the caller already holds this lock if 'locked' is non-zero.
  *
  * Notes:	The fileproc must correspond to the fd in the supplied proc
+ *
+ *		When the fileproc is supplied and 'locked' is zero, the
+ *		reference is usually dropped with an atomic decrement, without
+ *		taking the proc_fdlock; see fp_set_drainwait().
  */
 int
 fp_drop(proc_t p, int fd, struct fileproc *fp, int locked)
@@ -4096,6 +4170,31 @@ fp_drop(proc_t p, int fd, struct fileproc *fp, int locked)
 	struct filedesc *fdp = p->p_fd;
 	int	needwakeup = 0;
 
+	/*
+	 * The caller's reference keeps fp around until the decrement,
+	 * which is all this needs the lock for unless the last reference
+	 * has to clear FP_SELCONFLICT.  fp must not be touched past it:
+	 * a close may be waiting to free it.
+	 */
+	if (!locked && fp != FILEPROC_NULL &&
+	    (fp->f_flags & FP_SELCONFLICT) == 0) {
+		if (os_atomic_dec(&fp->f_iocount, release) == 0) {
+			/* pairs with fp_set_drainwait() */
+			os_atomic_thread_fence(seq_cst);
+			if (p->p_fpdrainwait) {
+				proc_fdlock_spin(p);
+				if (p->p_fpdrainwait) {
+					p->p_fpdrainwait = 0;
+					needwakeup = 1;
+				}
+				proc_fdunlock(p);
+			}
+		}
+		if (needwakeup)
+			wakeup(&p->p_fpdrainwait);
+		return (0);
+	}
+
 	if (!locked)
 		proc_fdlock_spin(p);
 	 if ((fp == FILEPROC_NULL) && (fd < 0 || fd >= fdp->fd_nfiles ||
@@ -4106,9 +4205,8 @@ fp_drop(proc_t p, int fd, struct fileproc *fp, int locked)
 			proc_fdunlock(p);
 		return (EBADF);
 	}
-	fp->f_iocount--;
 
-	if (fp->f_iocount == 0) {
+	if (os_atomic_dec(&fp->f_iocount, release) == 0) {
 		if (fp->f_flags & FP_SELCONFLICT)
 			fp->f_flags &= ~FP_SELCONFLICT;
 
@@ -4406,9 +4504,7 @@ file_drop(int fd)
 		proc_fdunlock(p);
 		return (EBADF);
 	}
-	fp->f_iocount --;
-
-	if (fp->f_iocount == 0) {
+	if (os_atomic_dec(&fp->f_iocount, release) == 0) {
 		if (fp->f_flags & FP_SELCONFLICT)
 			fp->f_flags &= ~FP_SELCONFLICT;
 
@@ -4744,8 +4840,10 @@ fdexec(proc_t p, short flags, int self_exec)
 			 * Wait for any third party viewers (e.g., lsof)
 			 * to release their references to this fileproc.
 			 */
-			while (fp->f_iocount > 0) {
-				p->p_fpdrainwait = 1;
+			while (os_atomic_load(&fp->f_iocount, acquire) > 0) {
+				fp_set_drainwait(p);
+				if (os_atomic_load(&fp->f_iocount, acquire) == 0)
+					break;
 				msleep(&p->p_fpdrainwait, &p->p_fdmlock, PRIBIO,
 				    "fpdrain", NULL);
 			}
@@ -5233,9 +5331,9 @@ fileproc_drain(proc_t p, struct fileproc * fp)
 	context.vc_thread = proc_thread(p);	/* XXX */
 	context.vc_ucred = fp->f_fglob->fg_cred;
 
-	fp->f_iocount-- ; /* (the one the close holds) */
+	os_atomic_dec(&fp->f_iocount, relaxed); /* (the one the close holds) */
 
-	while (fp->f_iocount) {
+	while (os_atomic_load(&fp->f_iocount, acquire)) {
 
 	        lck_mtx_convert_spin(&p->p_fdmlock);
 
@@ -5252,7 +5350,9 @@ fileproc_drain(proc_t p, struct fileproc * fp)
 					       THREAD_INTERRUPTED, WAITQ_ALL_PRIORITIES) == KERN_INVALID_ARGUMENT)
 				panic("bad select_conflict_queue");
 		}
-		p->p_fpdrainwait = 1;
+		fp_set_drainwait(p);
+		if (os_atomic_load(&fp->f_iocount, acquire) == 0)
+			break;
 
 		msleep(&p->p_fpdrainwait, &p->p_fdmlock, PRIBIO, "fpdrain", NULL);
 
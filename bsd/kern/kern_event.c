@@ -103,6 +103,10 @@
 #include <kern/thread.h>
 #include <kern/kcdata.h>
 
+#include <mach/mach_vm.h>
+#include <vm/vm_kern.h>
+#include <vm/vm_protos.h>
+
 #include <pthread/priority_private.h>
 #include <pthread/workqueue_syscalls.h>
 #include <pthread/workqueue_internal.h>
@@ -1711,6 +1715,7 @@ filt_userprocess(
 
 SECURITY_READ_ONLY_EARLY(static struct filterops) user_filtops = {
 	.f_extended_codes = true,
+	.f_ring_safe = true,
 	.f_attach  = filt_userattach,
 	.f_detach  = filt_userdetach,
 	.f_event   = filt_badevent,
@@ -2816,6 +2821,12 @@ kqueue_dealloc(struct kqueue *kq)
 		struct kqworkloop *kqwl = (struct kqworkloop *)kq;
 
 		assert(kqwl->kqwl_retains == 0);
+		if (kqwl->kqwl_ring) {
+			/* the user mapping keeps its own reference on the pages */
+			kmem_free(kernel_map, (vm_offset_t)kqwl->kqwl_ring,
+					kqwl->kqwl_ring_size);
+			kqwl->kqwl_ring = NULL;
+		}
 		lck_mtx_destroy(&kqwl->kqwl_statelock, kq_lck_grp);
 		zfree(kqworkloop_zone, kqwl);
 	} else {
@@ -2823,6 +2834,34 @@ kqueue_dealloc(struct kqueue *kq)
 	}
 }
 
+/*
+ * kqueue_pollcache_begin - mark a kqueue as caching a poll() set
+ *
+ *	poll() keeps the knotes of a thread's last set registered across
+ *	calls.  Once marked, dropping any knote (the descriptor was closed)
+ *	makes the kqueue stale, and kqueue_pollcache_valid() tells poll()
+ *	to register the set again.
+ */
+void
+kqueue_pollcache_begin(struct kqueue *kq)
+{
+	kqlock(kq);
+	kq->kq_state |= KQ_POLLCACHE;
+	kq->kq_state &= ~KQ_POLLSTALE;
+	kqunlock(kq);
+}
+
+boolean_t
+kqueue_pollcache_valid(struct kqueue *kq)
+{
+	boolean_t valid;
+
+	kqlock(kq);
+	valid = (kq->kq_state & (KQ_POLLCACHE | KQ_POLLSTALE)) == KQ_POLLCACHE;
+	kqunlock(kq);
+	return valid;
+}
+
 static inline void
 kqueue_retain(struct kqueue *kq)
 {
@@ -5216,6 +5255,172 @@ kqfile_end_processing(struct kqueue *kq)
 	}
 }
 
+#define KQWL_RING_MIN_ENTRIES	16
+#define KQWL_RING_MAX_ENTRIES	65536
+
+/*
+ * kqworkloop_ring_attach - allocate the shared delivery ring of a workloop
+ *
+ *	The ring is wired kernel memory so that knote_activate() can post into
+ *	it with the kqueue spinlock held, and is mapped read/write into the
+ *	calling process.  The kernel only ever trusts its own copies of the
+ *	mask and tail, kr_head is the only field it reads back from userspace.
+ */
+static int
+kqworkloop_ring_attach(struct kqworkloop *kqwl, uint32_t entries,
+		mach_vm_address_t *user_addrp)
+{
+	struct kevent_ring *ring = NULL;
+	mach_vm_address_t user_addr = 0;
+	memory_object_size_t size;
+	ipc_port_t mem_entry = IPC_PORT_NULL;
+	kern_return_t kr;
+
+	if (entries < KQWL_RING_MIN_ENTRIES || entries > KQWL_RING_MAX_ENTRIES ||
+			(entries & (entries - 1)) != 0) {
+		return EINVAL;
+	}
+
+	if (kqwl->kqwl_ring != NULL) {
+		return EBUSY;
+	}
+
+	size = round_page(sizeof(struct kevent_ring) +
+			entries * sizeof(struct kevent_qos_s));
+
+	kr = kmem_alloc(kernel_map, (vm_offset_t *)&ring, (vm_size_t)size,
+			VM_KERN_MEMORY_BSD);
+	if (kr != KERN_SUCCESS) {
+		return ENOMEM;
+	}
+	bzero(ring, (vm_size_t)size);
+	ring->kr_mask = entries - 1;
+
+	kr = mach_make_memory_entry_64(kernel_map, &size,
+			(mach_vm_offset_t)ring, MAP_MEM_VM_SHARE | VM_PROT_DEFAULT,
+			&mem_entry, IPC_PORT_NULL);
+	if (kr == KERN_SUCCESS) {
+		kr = mach_vm_map_kernel(current_map(), &user_addr, size, 0,
+				VM_FLAGS_ANYWHERE, VM_MAP_KERNEL_FLAGS_NONE,
+				VM_KERN_MEMORY_NONE, mem_entry, 0, FALSE,
+				VM_PROT_DEFAULT, VM_PROT_DEFAULT, VM_INHERIT_NONE);
+		mach_memory_entry_port_release(mem_entry);
+	}
+	if (kr != KERN_SUCCESS) {
+		kmem_free(kernel_map, (vm_offset_t)ring, (vm_size_t)size);
+		return ENOMEM;
+	}
+
+	kqlock(kqwl);
+	if (kqwl->kqwl_ring != NULL) {
+		kqunlock(kqwl);
+		(void)mach_vm_deallocate(current_map(), user_addr, size);
+		kmem_free(kernel_map, (vm_offset_t)ring, (vm_size_t)size);
+		return EBUSY;
+	}
+	kqwl->kqwl_ring_size = (vm_size_t)size;
+	kqwl->kqwl_ring_mask = entries - 1;
+	kqwl->kqwl_ring_tail = 0;
+	kqwl->kqwl_ring = ring;
+	kqunlock(kqwl);
+
+	*user_addrp = user_addr;
+	return 0;
+}
+
+/*
+ * kqworkloop_ring_wait - block until the shared ring has entries to consume
+ */
+static int
+kqworkloop_ring_wait(struct kqworkloop *kqwl)
+{
+	wait_result_t wr;
+	int error = 0;
+
+	kqlock(kqwl);
+	if (kqwl->kqwl_ring == NULL) {
+		kqunlock(kqwl);
+		return EINVAL;
+	}
+	while (kqwl->kqwl_ring->kr_head == kqwl->kqwl_ring_tail) {
+		kqwl->kqwl_ring_waiters++;
+		assert_wait(&kqwl->kqwl_ring, THREAD_ABORTSAFE);
+		kqunlock(kqwl);
+		wr = thread_block(THREAD_CONTINUE_NULL);
+		kqlock(kqwl);
+		if (wr != THREAD_AWAKENED) {
+			error = EINTR;
+			break;
+		}
+	}
+	kqunlock(kqwl);
+	return error;
+}
+
+/*
+ * knote_ring_post - deliver an activation straight into the workloop ring
+ *
+ *	Only EV_CLEAR knotes of filters that can be processed under the kqueue
+ *	lock are eligible: each activation produces exactly one ring entry and
+ *	the knote is left inactive, the way knote_process() would leave it
+ *	after delivering a cleared event.
+ *
+ *	Returns true if the event was posted, false if the knote has to be
+ *	queued on the workloop (ineligible, or the ring is full).
+ *
+ *	called with kqueue lock held
+ */
+static bool
+knote_ring_post(struct kqworkloop *kqwl, struct knote *kn)
+{
+	struct kevent_ring *ring = kqwl->kqwl_ring;
+	struct kevent_internal_s kev;
+	struct kevent_qos_s *slot;
+	uint32_t tail = kqwl->kqwl_ring_tail;
+	int result;
+
+	if (!knote_fops(kn)->f_ring_safe ||
+			(kn->kn_flags & (EV_ONESHOT | EV_DISPATCH | EV_CLEAR)) != EV_CLEAR ||
+			(kn->kn_status & (KN_DISABLED | KN_SUPPRESSED | KN_DROPPING |
+			KN_STAYACTIVE | KN_QUEUED)) != 0) {
+		return false;
+	}
+
+	if (tail - ring->kr_head > kqwl->kqwl_ring_mask) {
+		ring->kr_overflows++;
+		return false;
+	}
+
+	result = filter_call(knote_fops(kn), f_process(kn, NULL, &kev));
+	if ((result & FILTER_ACTIVE) == 0) {
+		/* nothing to report, the cleared knote just stays inactive */
+		return true;
+	}
+
+	slot = &ring->kr_events[tail & kqwl->kqwl_ring_mask];
+	slot->ident = kev.ident;
+	slot->filter = kev.filter;
+	slot->flags = kev.flags;
+	slot->qos = kev.qos;
+	slot->udata = kev.udata;
+	slot->fflags = kev.fflags;
+	slot->xflags = 0;
+	slot->data = (int64_t)kev.data;
+	slot->ext[0] = kev.ext[0];
+	slot->ext[1] = kev.ext[1];
+	slot->ext[2] = kev.ext[2];
+	slot->ext[3] = kev.ext[3];
+
+	kqwl->kqwl_ring_tail = tail + 1;
+	os_atomic_store(&ring->kr_tail, tail + 1, release);
+
+	if (kqwl->kqwl_ring_waiters) {
+		kqwl->kqwl_ring_waiters = 0;
+		thread_wakeup(&kqwl->kqwl_ring);
+	}
+	return true;
+}
+
 static int
 kqueue_workloop_ctl_internal(proc_t p, uintptr_t cmd, uint64_t __unused options,
 		struct kqueue_workloop_params *params, int *retval)
@@ -5307,6 +5512,29 @@ kqueue_workloop_ctl_internal(proc_t p, uintptr_t cmd, uint64_t __unused options,
 		kqunlock(kq);
 		kqueue_release_last(p, kq);
 		break;
+	case KQ_WORKLOOP_RING_ATTACH:
+	case KQ_WORKLOOP_RING_WAIT:
+		error = kevent_get_kq(p, params->kqwlp_id, NULL,
+				KEVENT_FLAG_DYNAMIC_KQUEUE | KEVENT_FLAG_WORKLOOP |
+				KEVENT_FLAG_DYNAMIC_KQ_MUST_EXIST , &fp, &fd, &kq);
+		if (error) {
+			break;
+		}
+		kqwl = (struct kqworkloop *)kq;
+		if (cmd == KQ_WORKLOOP_RING_ATTACH) {
+			mach_vm_address_t user_addr = 0;
+
+			error = kqworkloop_ring_attach(kqwl,
+					params->kqwlp_ring_entries, &user_addr);
+			params->kqwlp_ring_addr = (uint64_t)user_addr;
+		} else {
+			error = kqworkloop_ring_wait(kqwl);
+		}
+		kqueue_release_last(p, kq);
+		break;
+	default:
+		error = EINVAL;
+		break;
 	}
 	*retval = 0;
 	return error;
@@ -5332,8 +5560,16 @@ kqueue_workloop_ctl(proc_t p, struct kqueue_workloop_ctl_args *uap, int *retval)
 		return EINVAL;
 	}
 
-	return kqueue_workloop_ctl_internal(p, uap->cmd, uap->options, &params,
+	if (uap->cmd == KQ_WORKLOOP_RING_ATTACH && copyin_sz < sizeof(params)) {
+		return EINVAL;
+	}
+
+	rv = kqueue_workloop_ctl_internal(p, uap->cmd, uap->options, &params,
 			retval);
+	if (rv == 0 && uap->cmd == KQ_WORKLOOP_RING_ATTACH) {
+		rv = copyout(&params, uap->addr, sizeof(params));
+	}
+	return rv;
 }
 
 /*
@@ -7532,6 +7768,8 @@ knote_drop(struct kqueue *kq, struct knote *kn, struct knote_lock_ctx *knlc)
 		assert((kn->kn_status & KN_LOCKED) == 0);
 	}
 	kn->kn_status |= KN_DROPPING;
+	if (kq->kq_state & KQ_POLLCACHE)
+		kq->kq_state |= KQ_POLLSTALE;
 
 	knote_unsuppress(kn);
 	knote_dequeue(kn);
@@ -7561,6 +7799,13 @@ knote_activate(struct knote *kn)
 	              kn->kn_udata, kn->kn_status | (kn->kn_id << 32),
 	              kn->kn_filtid);
 
+	if (knote_get_kq(kn)->kq_state & KQ_WORKLOOP) {
+		struct kqworkloop *kqwl = (struct kqworkloop *)knote_get_kq(kn);
+
+		if (kqwl->kqwl_ring && knote_ring_post(kqwl, kn))
+			return;
+	}
+
 	kn->kn_status |= KN_ACTIVE;
 	if (knote_enqueue(kn))
 		knote_wakeup(kn);
@@ -976,7 +976,11 @@ grade:
 	/*
 	 * Actually load the image file we previously decided to load.
 	 */
+	KERNEL_DEBUG_CONSTANT(BSDDBG_CODE(DBG_BSD_PROC, BSD_PROC_EXEC_LOAD) | DBG_FUNC_START,
+			      p->p_pid, 0, 0, 0, 0);
 	lret = load_machfile(imgp, mach_header, thread, &map, &load_result);
+	KERNEL_DEBUG_CONSTANT(BSDDBG_CODE(DBG_BSD_PROC, BSD_PROC_EXEC_LOAD) | DBG_FUNC_END,
+			      p->p_pid, lret, 0, 0, 0);
 	if (lret != LOAD_SUCCESS) {
 		error = load_return_to_errno(lret);
 
@@ -1058,6 +1058,7 @@ skipcheck:
 	LIST_INSERT_HEAD(&zombproc, p, p_list);	/* Place onto zombproc. */
 	/* will not be visible via proc_find */
 	p->p_listflag |= P_LIST_EXITED;
+	proc_ref_update_locked(p);
 
 	proc_list_unlock();
 
@@ -1772,7 +1773,7 @@ reap_child_locked(proc_t parent, proc_t child, int deadparent, int reparentedtoi
 	lck_spin_destroy(&child->p_slock, proc_lck_grp);
 #endif /* CONFIG_FINE_LOCK_GROUPS */
 
-	FREE_ZONE(child, sizeof *child, M_PROC);
+	proc_free(child);
 	if ((locked == 1) && (droplock == 0))
 		proc_list_lock();
 
@@ -2382,6 +2383,7 @@ vfork_exit_internal(proc_t p, int rv, int forceexit)
 	LIST_INSERT_HEAD(&zombproc, p, p_list);	/* Place onto zombproc. */
 	/* will not be visible via proc_find */
 	p->p_listflag |= P_LIST_EXITED;
+	proc_ref_update_locked(p);
 
 	proc_list_unlock();
 
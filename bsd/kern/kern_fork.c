@@ -167,6 +167,7 @@ thread_t fork_create_child(task_t parent_task,
 						   int in_exec);
 void proc_vfork_begin(proc_t parent_proc);
 void proc_vfork_end(proc_t parent_proc);
+extern void poll_cache_free(struct uthread *);
 
 #define	DOFORK	0x1	/* fork() system call */
 #define	DOVFORK	0x2	/* vfork() system call */
@@ -1146,7 +1147,7 @@ forkproc_free(proc_t p)
 	p->p_stats = NULL;
 
 	proc_checkdeadrefs(p);
-	FREE_ZONE(p, sizeof *p, M_PROC);
+	proc_free(p);
 }
 
 
@@ -1263,7 +1264,8 @@ retry:
 #endif
 	/* Insert in the hash */
 	child_proc->p_listflag |= (P_LIST_INHASH | P_LIST_INCREATE);
-	LIST_INSERT_HEAD(PIDHASH(child_proc->p_pid), child_proc, p_hash);
+	proc_ref_update_locked(child_proc);
+	pidhash_insert_locked(child_proc);
 	proc_list_unlock();
 
 	if (child_proc->p_uniqueid == startup_serial_num_procs) {
@@ -1708,6 +1710,8 @@ uthread_cleanup(task_t task, void *uthread, void * bsd_info)
 		uth->uu_wqstate_sz = 0;
 	}
 
+	poll_cache_free(uth);
+
 	os_reason_free(uth->uu_exit_reason);
 
 	if ((task != kernel_task) && p) {
@@ -144,6 +144,7 @@ static int	 lf_getlock(struct lockf *, struct flock *, pid_t);
 static int	 lf_setlock(struct lockf *, struct timespec *);
 static int	 lf_split(struct lockf *, struct lockf *);
 static void	 lf_wakelock(struct lockf *, boolean_t);
+static void	 lf_wakelock_shrunk(struct lockf *);
 #if IMPORTANCE_INHERITANCE
 static void	 lf_hold_assertion(task_t, struct lockf *);
 static void	 lf_jump_to_queue_head(struct lockf *, struct lockf *);
@@ -774,7 +775,7 @@ lf_setlock(struct lockf *lock, struct timespec *timeout)
 					return (ENOLCK);
 				}
 			}
-			lf_wakelock(overlap, TRUE);
+			lf_wakelock_shrunk(overlap);
 			break;
 
 		case OVERLAP_CONTAINED_BY_LOCK:
@@ -816,7 +817,7 @@ lf_setlock(struct lockf *lock, struct timespec *timeout)
 			overlap->lf_next = lock;
 			overlap->lf_end = lock->lf_start - 1;
 			prev = &lock->lf_next;
-			lf_wakelock(overlap, TRUE);
+			lf_wakelock_shrunk(overlap);
 			needtolink = 0;
 			continue;
 
@@ -829,7 +830,7 @@ lf_setlock(struct lockf *lock, struct timespec *timeout)
 				lock->lf_next = overlap;
 			}
 			overlap->lf_start = lock->lf_end + 1;
-			lf_wakelock(overlap, TRUE);
+			lf_wakelock_shrunk(overlap);
 			break;
 		}
 		break;
@@ -881,14 +882,19 @@ lf_clearlock(struct lockf *unlock)
 	prev = head;
 	while ((ovcase = lf_findoverlap(lf, unlock, SELF, &prev, &overlap)) != OVERLAP_NONE) {
 		/*
-		 * Wakeup the list of locks to be retried.
+		 * Wakeup the list of locks to be retried, if the lock goes
+		 * away; if it only shrinks, the waiters it no longer blocks
+		 * are woken once it has.
 		 */
-	        lf_wakelock(overlap, FALSE);
+		if (ovcase == OVERLAP_EQUALS_LOCK ||
+		    ovcase == OVERLAP_CONTAINED_BY_LOCK) {
+			lf_wakelock(overlap, FALSE);
 #if IMPORTANCE_INHERITANCE
-		if (overlap->lf_boosted == LF_BOOSTED) {
-			lf_drop_assertion(overlap);
-		}
+			if (overlap->lf_boosted == LF_BOOSTED) {
+				lf_drop_assertion(overlap);
+			}
 #endif /* IMPORTANCE_INHERITANCE */
+		}
 
 		switch (ovcase) {
 		case OVERLAP_NONE:	/* satisfy compiler enum/switch */
@@ -902,6 +908,7 @@ lf_clearlock(struct lockf *unlock)
 		case OVERLAP_CONTAINS_LOCK: /* split it */
 			if (overlap->lf_start == unlock->lf_start) {
 				overlap->lf_start = unlock->lf_end + 1;
+				lf_wakelock_shrunk(overlap);
 				break;
 			}
 			/*
@@ -911,6 +918,7 @@ lf_clearlock(struct lockf *unlock)
 			if (lf_split(overlap, unlock))
 				return (ENOLCK);
 			overlap->lf_next = unlock->lf_next;
+			lf_wakelock_shrunk(overlap);
 			break;
 
 		case OVERLAP_CONTAINED_BY_LOCK:
@@ -921,12 +929,14 @@ lf_clearlock(struct lockf *unlock)
 
 		case OVERLAP_STARTS_BEFORE_LOCK:
 			overlap->lf_end = unlock->lf_start - 1;
+			lf_wakelock_shrunk(overlap);
 			prev = &overlap->lf_next;
 			lf = overlap->lf_next;
 			continue;
 
 		case OVERLAP_ENDS_AFTER_LOCK:
 			overlap->lf_start = unlock->lf_end + 1;
+			lf_wakelock_shrunk(overlap);
 			break;
 		}
 		break;
@@ -1237,6 +1247,10 @@ lf_split(struct lockf *lock1, struct lockf *lock2)
 	bcopy(lock1, splitlock, sizeof *splitlock);
 	splitlock->lf_start = lock2->lf_end + 1;
 	TAILQ_INIT(&splitlock->lf_blkhd);
+#if IMPORTANCE_INHERITANCE
+	/* the assertion, if any, stays with lock1 and its waiters */
+	splitlock->lf_boosted = LF_NOT_BOOSTED;
+#endif /* IMPORTANCE_INHERITANCE */
 	lock1->lf_end = lock2->lf_start - 1;
 	/*
 	 * OK, now link it in
@@ -1263,9 +1277,9 @@ lf_split(struct lockf *lock1, struct lockf *lock2)
  * Notes:	This function iterates a list of locks and wakes all waiters,
  *		rather than only waiters for the contended regions.  Because
  *		of this, for heavily contended files, this can result in a
- *		"thundering herd" situation.  Refactoring the code could make
- *		this operation more efficient, if heavy contention ever results
- *		in a real-world performance problem.
+ *		"thundering herd" situation.  Locks that only shrink use
+ *		lf_wakelock_shrunk() instead, which limits the wakeups to the
+ *		waiters for the released regions.
  */
 static void
 lf_wakelock(struct lockf *listhead, boolean_t force_all)
@@ -1313,6 +1327,53 @@ lf_wakelock(struct lockf *listhead, boolean_t force_all)
 }
 
 
+/*
+ * lf_wakelock_shrunk
+ *
+ * Wakeup the waiters that a lock no longer blocks, after its range was
+ * reduced by an unlock or by a change of type of part of the range.
+ *
+ * Parameters:	lock			Lock whose range was reduced; its type
+ *					is unchanged
+ *
+ * Returns:	<void>
+ *
+ * Notes:	A waiter still overlapping the remaining range of the lock is
+ *		still blocked by it, so it is left asleep instead of being
+ *		woken only to block on the lock again.  This includes waiters
+ *		that overlapped the released range as well.
+ */
+static void
+lf_wakelock_shrunk(struct lockf *lock)
+{
+	struct lockf *wakelock, *next;
+
+	for (wakelock = TAILQ_FIRST(&lock->lf_blkhd); wakelock != NOLOCKF;
+	    wakelock = next) {
+		next = TAILQ_NEXT(wakelock, lf_block);
+
+		if ((lock->lf_end == -1 || wakelock->lf_start <= lock->lf_end) &&
+		    (wakelock->lf_end == -1 || lock->lf_start <= wakelock->lf_end))
+			continue;
+
+		TAILQ_REMOVE(&lock->lf_blkhd, wakelock, lf_block);
+		wakelock->lf_next = NOLOCKF;
+#ifdef LOCKF_DEBUGGING
+		if (lockf_debug & LF_DBG_LOCKOP)
+			lf_print("lf_wakelock_shrunk: awakening", wakelock);
+#endif /* LOCKF_DEBUGGING */
+		wakeup(wakelock);
+	}
+
+#if IMPORTANCE_INHERITANCE
+	/*
+	 * The waiters that are left may not be the ones that boosted us.
+	 */
+	lf_adjust_assertion(lock);
+#endif /* IMPORTANCE_INHERITANCE */
+}
+
+
 #ifdef LOCKF_DEBUGGING
 #define GET_LF_OWNER_PID(lf)	(proc_pid((lf)->lf_owner))
 
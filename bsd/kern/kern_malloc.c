@@ -445,7 +445,7 @@ struct kmzones {
 	{ SOS(specinfo),KMZ_CREATEZONE, TRUE },		/* 93 M_SPECINFO */
 	{ SOS(kqueue),	KMZ_CREATEZONE, FALSE },	/* 94 M_KQUEUE */
 	{ 0,		KMZ_MALLOC, FALSE },		/* 95 unused */
-	{ SOS(cl_readahead),  KMZ_CREATEZONE, TRUE },	/* 96 M_CLRDAHEAD */
+	{ SOS(cl_rastreams),  KMZ_CREATEZONE, TRUE },	/* 96 M_CLRDAHEAD */
 	{ SOS(cl_writebehind),KMZ_CREATEZONE, TRUE },	/* 97 M_CLWRBEHIND */
 	{ SOS(user64_iovec),	KMZ_LOOKUPZONE, FALSE },/* 98 M_IOV64 */
 	{ SOS(fileglob),	KMZ_CREATEZONE, TRUE },	/* 99 M_FILEGLOB */
@@ -787,6 +787,32 @@ sysctl_zone_map_jetsam_limit SYSCTL_HANDLER_ARGS
 SYSCTL_PROC(_kern, OID_AUTO, zone_map_jetsam_limit, CTLTYPE_INT|CTLFLAG_RW, 0, 0,
 		sysctl_zone_map_jetsam_limit, "I", "Zone map jetsam limit");
 
+extern unsigned int zone_map_warning_limit;
+
+static int
+sysctl_zone_map_warning_limit SYSCTL_HANDLER_ARGS
+{
+#pragma unused(oidp, arg1, arg2)
+	int oldval = 0, val = 0, error = 0;
+
+	oldval = zone_map_warning_limit;
+	error = sysctl_io_number(req, oldval, sizeof(int), &val, NULL);
+	if (error || !req->newptr) {
+		return (error);
+	}
+
+	if (val <= 0 || val > 100) {
+		printf("sysctl_zone_map_warning_limit: new warning limit value is invalid.\n");
+		return EINVAL;
+	}
+
+	zone_map_warning_limit = val;
+	return (0);
+}
+
+SYSCTL_PROC(_kern, OID_AUTO, zone_map_warning_limit, CTLTYPE_INT|CTLFLAG_RW, 0, 0,
+		sysctl_zone_map_warning_limit, "I", "Zone map warning limit, as a percentage of the jetsam limit");
+
 
 extern void get_zone_map_size(uint64_t *current_size, uint64_t *capacity);
 
@@ -953,3 +979,46 @@ sysctl_zones_collectable_bytes SYSCTL_HANDLER_ARGS
 SYSCTL_PROC(_kern, OID_AUTO, zones_collectable_bytes,
 	CTLTYPE_QUAD | CTLFLAG_RD | CTLFLAG_MASKED | CTLFLAG_LOCKED,
 	0, 0, &sysctl_zones_collectable_bytes, "Q", "Collectable memory in zones");
+
+#if CONFIG_ZCACHE
+
+/*
+ * kern.zcache_stats
+ *
+ * Returns an array of struct zcache_zone_stats, one for every zone that
+ * currently has per-cpu caching enabled.
+ */
+static int
+sysctl_zcache_stats SYSCTL_HANDLER_ARGS
+{
+#pragma unused(oidp, arg1, arg2)
+	struct zcache_zone_stats *stats;
+	unsigned int count, max_count;
+	vm_size_t size;
+	int error;
+
+	max_count = get_zcache_zone_count();
+	if (req->oldptr == USER_ADDR_NULL) {
+		/* leave some room for zones that get cached in the meantime */
+		return SYSCTL_OUT(req, NULL, (max_count + 8) * sizeof(*stats));
+	}
+	if (max_count == 0)
+		return 0;
+
+	size = max_count * sizeof(*stats);
+	stats = kalloc(size);
+	if (stats == NULL)
+		return ENOMEM;
+
+	count = get_zcache_stats(stats, max_count);
+	error = SYSCTL_OUT(req, stats, count * sizeof(*stats));
+
+	kfree(stats, size);
+	return error;
+}
+
+SYSCTL_PROC(_kern, OID_AUTO, zcache_stats,
+	CTLTYPE_STRUCT | CTLFLAG_RD | CTLFLAG_MASKED | CTLFLAG_LOCKED,
+	0, 0, &sysctl_zcache_stats, "S,zcache_zone_stats", "Per-zone CPU cache hit and miss counts");
+
+#endif	/* CONFIG_ZCACHE */
@@ -528,6 +528,9 @@ SYSCTL_INT(_kern, OID_AUTO, memorystatus_level, CTLFLAG_RD|CTLFLAG_LOCKED, &memo
 
 #endif /* CONFIG_EMBEDDED */
 
+static unsigned int memorystatus_zone_map_warnings = 0;
+SYSCTL_UINT(_kern, OID_AUTO, memorystatus_zone_map_warnings, CTLFLAG_RD|CTLFLAG_LOCKED, &memorystatus_zone_map_warnings, 0, "");
+
 int
 memorystatus_get_level(__unused struct proc *p, struct memorystatus_get_level_args *args, __unused int *ret)
 {
@@ -6579,6 +6582,19 @@ memorystatus_kill_on_zone_map_exhaustion(pid_t pid) {
 	return res;
 }
 
+/*
+ * Called by the zone reclaim thread when the zone map stays past its warning limit
+ * after giving back its free pages. Idle-exitable processes are let go first, so
+ * that the zone memory they hold comes back before zone-map-exhaustion jetsams.
+ */
+void
+memorystatus_on_zone_map_warning(void)
+{
+	/* Only ever called from the zone reclaim thread */
+	memorystatus_zone_map_warnings++;
+	(void)kill_idle_exit_proc();
+}
+
 #if CONFIG_FREEZE
 
 __private_extern__ void
@@ -8495,6 +8511,11 @@ SYSCTL_PROC(_kern, OID_AUTO, memorystatus_vm_pressure_level, CTLTYPE_INT|CTLFLAG
 
 #endif /* DEBUG || DEVELOPMENT */
 
+extern uint32_t vm_pressure_forecast_horizon_secs;
+
+SYSCTL_UINT(_kern, OID_AUTO, memorystatus_pressure_forecast_horizon, CTLFLAG_RW|CTLFLAG_LOCKED,
+    &vm_pressure_forecast_horizon_secs, 0, "");
+
 
 static int
 sysctl_memorypressure_manual_trigger SYSCTL_HANDLER_ARGS
@@ -9618,6 +9639,58 @@ memorystatus_cmd_get_pressure_status(int32_t *retval) {
 	return error;
 }
 
+#if VM_PRESSURE_EVENTS
+extern uint32_t	vm_pressure_forecast_horizon_secs;
+extern int64_t	vm_pressure_forecast_trend;
+extern uint32_t	vm_pressure_forecast_secs_to_critical;
+extern uint32_t	vm_pressure_forecast_refault_rate;
+extern uint32_t	vm_pressure_forecast_early_warnings;
+extern uint64_t	vm_pressure_forecast_available_pages;
+extern uint64_t	vm_pressure_forecast_critical_pages;
+#endif /* VM_PRESSURE_EVENTS */
+
+static int
+memorystatus_cmd_get_pressure_forecast(user_addr_t buffer, size_t buffer_size, __unused int32_t *retval) {
+#if VM_PRESSURE_EVENTS
+	memorystatus_pressure_forecast_t forecast;
+	int error;
+
+	if ((buffer == USER_ADDR_NULL) || (buffer_size != sizeof(forecast))) {
+		return EINVAL;
+	}
+
+	error = priv_check_cred(kauth_cred_get(), PRIV_VM_PRESSURE, 0);
+	if (error) {
+		return (error);
+	}
+
+	/* Inherently racy, so it's not worth taking a lock here */
+	bzero(&forecast, sizeof(forecast));
+	forecast.level = convert_internal_pressure_level_to_dispatch_level(memorystatus_vm_pressure_level);
+	forecast.trend = vm_pressure_forecast_trend;
+	forecast.secs_to_critical = vm_pressure_forecast_secs_to_critical;
+	forecast.horizon_secs = vm_pressure_forecast_horizon_secs;
+	forecast.refault_rate = vm_pressure_forecast_refault_rate;
+	forecast.early_warnings = vm_pressure_forecast_early_warnings;
+
+	forecast.available_pages = vm_pressure_forecast_available_pages;
+	forecast.critical_pages = vm_pressure_forecast_critical_pages;
+
+	if (forecast.secs_to_critical == 0) {
+		forecast.forecast_level = NOTE_MEMORYSTATUS_PRESSURE_CRITICAL;
+	} else if (forecast.horizon_secs != 0 && forecast.secs_to_critical < forecast.horizon_secs) {
+		forecast.forecast_level = NOTE_MEMORYSTATUS_PRESSURE_WARN;
+	} else {
+		forecast.forecast_level = forecast.level;
+	}
+
+	return copyout(&forecast, buffer, sizeof(forecast));
+#else /* VM_PRESSURE_EVENTS */
+#pragma unused(buffer, buffer_size)
+	return ENOTSUP;
+#endif /* VM_PRESSURE_EVENTS */
+}
+
 int
 memorystatus_get_pressure_status_kdp() {
 	return (kVMPressureNormal != memorystatus_vm_pressure_level) ? 1 : 0;
@@ -9974,6 +10047,9 @@ memorystatus_control(struct proc *p __unused, struct memorystatus_control_args *
 	case MEMORYSTATUS_CMD_GET_PRESSURE_STATUS:
 		error = memorystatus_cmd_get_pressure_status(ret);
 		break;
+	case MEMORYSTATUS_CMD_GET_PRESSURE_FORECAST:
+		error = memorystatus_cmd_get_pressure_forecast(args->buffer, args->buffersize, ret);
+		break;
 #if CONFIG_JETSAM
 	case MEMORYSTATUS_CMD_SET_JETSAM_HIGH_WATER_MARK:
 		/*
@@ -167,6 +167,7 @@ mmap(proc_t p, struct mmap_args *uap, user_addr_t *retval)
 	int error =0;
 	int fd = uap->fd;
 	int num_retries = 0;
+	int superpage_flags;
 
 	/*
 	 * Note that for UNIX03 conformance, there is additional parameter checking for
@@ -525,6 +526,26 @@ mmap(proc_t p, struct mmap_args *uap, user_addr_t *retval)
 		if (maxprot & (VM_PROT_EXECUTE | VM_PROT_WRITE))
 			maxprot |= VM_PROT_READ;
 #endif	/* radar 3777787 */
+		superpage_flags = 0;
+		if (!(flags & MAP_SHARED) && !vmk_flags.vmkf_map_jit)
+			superpage_flags = vm_map_transparent_superpage_flags(user_map,
+			    user_size, alloc_flags);
+		if (superpage_flags) {
+			vm_map_offset_t sp_addr = user_addr;
+
+			result = vm_map_enter_mem_object(user_map,
+							 &sp_addr, user_size,
+							 0, alloc_flags | superpage_flags,
+							 vmk_flags, tag,
+							 IPC_PORT_NULL, 0, FALSE,
+							 prot, maxprot,
+							 VM_INHERIT_DEFAULT);
+			vm_map_transparent_superpage_result(user_size, result);
+			if (result == KERN_SUCCESS) {
+				user_addr = sp_addr;
+				goto map_anon_done;
+			}
+		}
 map_anon_retry:
 		result = vm_map_enter_mem_object(user_map,
 						 &user_addr, user_size,
@@ -545,6 +566,8 @@ map_anon_retry:
 			user_addr = vm_map_page_size(user_map);
 			goto map_anon_retry;
 		}
+map_anon_done:
+		;
 	} else {
 		if (vnode_isswap(vp)) {
 			/*
@@ -966,6 +989,9 @@ madvise(__unused proc_t p, struct madvise_args *uap, __unused int32_t *retval)
 		case MADV_CAN_REUSE:
 			new_behavior = VM_BEHAVIOR_CAN_REUSE;
 			break;
+		case MADV_FAULTAROUND:
+			new_behavior = VM_BEHAVIOR_FAULTAROUND;
+			break;
 		case MADV_PAGEOUT:
 #if MACH_ASSERT
 			new_behavior = VM_BEHAVIOR_PAGEOUT;
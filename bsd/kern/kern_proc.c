@@ -102,6 +102,8 @@
 #include <kern/coalition.h>
 #include <sys/coalition.h>
 #include <kern/assert.h>
+#include <kern/smr.h>
+#include <machine/atomic.h>
 #include <vm/vm_protos.h>
 #include <vm/vm_map.h>		/* vm_map_switch_protect() */
 #include <vm/vm_pageout.h>
@@ -359,9 +361,63 @@ proc_isinferior(int pid1, int pid2)
 	return(retval);
 }
 
+/*
+ * Look a pid up and take a reference on its process without the
+ * proc_list_lock.  The pid hash is walked in a smr_system read section,
+ * since processes taken out of it are only freed once such sections are
+ * over (see proc_free()), and the reference is taken with a compare and
+ * swap that fails while P_REF_LOCKED is set, i.e. while proc_ref_locked()
+ * could refuse it or have to wait.  Returns PROC_NULL with *lockedp set
+ * when the locked lookup has to decide.
+ */
+static proc_t
+proc_find_lockless(int pid, boolean_t *lockedp)
+{
+	proc_t p;
+	uint32_t ref, nref;
+
+	*lockedp = FALSE;
+	if (!pid) {
+		*lockedp = TRUE;
+		return (PROC_NULL);
+	}
+
+	smr_enter(&smr_system);
+	for (p = os_atomic_load(&PIDHASH(pid)->lh_first, acquire); p != PROC_NULL;
+	    p = os_atomic_load(&p->p_hash.le_next, acquire)) {
+		if (p->p_pid == pid)
+			break;
+	}
+	if (p != PROC_NULL) {
+		os_atomic_rmw_loop(&p->p_refcount, ref, nref, acquire, {
+			if ((ref & P_REF_LOCKED) != 0) {
+				os_atomic_rmw_loop_give_up({
+					p = PROC_NULL;
+					*lockedp = TRUE;
+					goto out;
+				});
+			}
+			nref = ref + 1;
+		});
+	}
+out:
+	smr_leave(&smr_system);
+
+	if (p != PROC_NULL)
+		record_procref(p, 1);
+	return (p);
+}
+
 proc_t
 proc_find(int pid)
 {
+	proc_t p;
+	boolean_t locked;
+
+	p = proc_find_lockless(pid, &locked);
+	if (!locked)
+		return (p);
+
 	return(proc_findinternal(pid, 0));
 }
 
@@ -475,6 +531,23 @@ uthread_needs_to_wait_in_proc_refwait(void) {
 int 
 proc_rele(proc_t p)
 {
+	uint32_t ref, nref;
+
+	/*
+	 * Only the release of the last reference may have to wake up
+	 * proc_refdrain(), which needs the proc_list_lock; others are
+	 * dropped atomically.
+	 */
+	os_atomic_rmw_loop(&p->p_refcount, ref, nref, release, {
+		if ((ref & P_REF_COUNT_MASK) <= 1) {
+			os_atomic_rmw_loop_give_up(goto locked);
+		}
+		nref = ref - 1;
+	});
+	record_procref(p, -1);
+	return(0);
+
+locked:
 	proc_list_lock();
 	proc_rele_locked(p);
 	proc_list_unlock();
@@ -533,7 +606,7 @@ retry:
 			p = pfind_locked(pid);
 			goto retry;
 		}
-		p->p_refcount++;
+		os_atomic_inc(&p->p_refcount, relaxed);
 		record_procref(p, 1);
 	}
 	else 
@@ -545,11 +618,12 @@ retry:
 void
 proc_rele_locked(proc_t p)
 {
+	uint32_t ref;
 
-	if (p->p_refcount > 0) {
-		p->p_refcount--;
+	if ((os_atomic_load(&p->p_refcount, relaxed) & P_REF_COUNT_MASK) > 0) {
+		ref = os_atomic_dec(&p->p_refcount, release);
 		record_procref(p, -1);
-		if ((p->p_refcount == 0) && ((p->p_listflag & P_LIST_DRAINWAIT) == P_LIST_DRAINWAIT)) {
+		if (((ref & P_REF_COUNT_MASK) == 0) && ((p->p_listflag & P_LIST_DRAINWAIT) == P_LIST_DRAINWAIT)) {
 			p->p_listflag &= ~P_LIST_DRAINWAIT;
 			wakeup(&p->p_refcount);
 		}
@@ -558,6 +632,21 @@ proc_rele_locked(proc_t p)
 
 }
 
+/*
+ * Set P_REF_LOCKED when one of P_LIST_REF_LOCKED was just set, so that
+ * proc_find() no longer takes references without the proc_list_lock, or
+ * clear it once none is.  Since the bit shares the word with the count, a
+ * lockless reference is either counted by the time this returns or fails.
+ */
+void
+proc_ref_update_locked(proc_t p)
+{
+	if ((p->p_listflag & P_LIST_REF_LOCKED) != 0 || p->p_stat == SZOMB)
+		os_atomic_or(&p->p_refcount, P_REF_LOCKED, relaxed);
+	else
+		os_atomic_and(&p->p_refcount, ~P_REF_LOCKED, relaxed);
+}
+
 proc_t
 proc_find_zombref(int pid)
 {
@@ -626,9 +715,10 @@ proc_refdrain_with_refwait(proc_t p, boolean_t get_ref_and_allow_wait)
 			initexec = TRUE;
 		}
 	}
+	proc_ref_update_locked(p);
 
 	/* Do not wait in ref drain for launchd exec */
-	while (p->p_refcount && !initexec) {
+	while ((os_atomic_load(&p->p_refcount, relaxed) & P_REF_COUNT_MASK) && !initexec) {
 		p->p_listflag |= P_LIST_DRAINWAIT;
 		msleep(&p->p_refcount, proc_list_mlock, 0, "proc_refdrain", 0) ;
 	}
@@ -638,7 +728,7 @@ proc_refdrain_with_refwait(proc_t p, boolean_t get_ref_and_allow_wait)
 		p->p_listflag |= P_LIST_DEAD;
 	} else {
 		/* Return a ref to the caller */
-		p->p_refcount++;
+		os_atomic_inc(&p->p_refcount, relaxed);
 		record_procref(p, 1);
 	}
 
@@ -655,6 +745,7 @@ proc_refwake(proc_t p)
 {
 	proc_list_lock();
 	p->p_listflag &= ~P_LIST_REFWAIT;
+	proc_ref_update_locked(p);
 	wakeup(&p->p_listflag);
 	proc_list_unlock();
 }
@@ -754,8 +845,8 @@ proc_checkdeadrefs(__unused proc_t p)
 		panic("proc being freed and still in hash %p: %u\n", p, p->p_listflag);
 	if (p->p_childrencnt != 0)
 		panic("proc being freed and pending children cnt %p:%d\n", p, p->p_childrencnt);
-	if (p->p_refcount != 0)
-		panic("proc being freed and pending refcount %p:%d\n", p, p->p_refcount);
+	if ((p->p_refcount & P_REF_COUNT_MASK) != 0)
+		panic("proc being freed and pending refcount %p:%d\n", p, p->p_refcount & P_REF_COUNT_MASK);
 	if (p->p_parentref != 0)
 		panic("proc being freed and pending parentrefs %p:%d\n", p, p->p_parentref);
 #endif
@@ -1197,6 +1288,41 @@ IS_64BIT_PROCESS(proc_t p)
 }
 #endif
 
+/*
+ * Insert a process in the pid hash; the process must be fully initialized,
+ * since proc_find() walks the hash without the proc_list_lock.
+ */
+void
+pidhash_insert_locked(proc_t p)
+{
+	struct pidhashhead *head = PIDHASH(p->p_pid);
+	proc_t next = LIST_FIRST(head);
+
+	p->p_hash.le_next = next;
+	p->p_hash.le_prev = &LIST_FIRST(head);
+	if (next != PROC_NULL)
+		next->p_hash.le_prev = &p->p_hash.le_next;
+	os_atomic_store(&LIST_FIRST(head), p, release);
+}
+
+static void
+proc_free_smr(struct smr_node *node)
+{
+	proc_t p = __container_of(node, struct proc, p_smr);
+
+	FREE_ZONE(p, sizeof *p, M_PROC);
+}
+
+/*
+ * Free a process taken out of the pid hash, once the lockless lookups in
+ * proc_find() that could still see it are over.
+ */
+void
+proc_free(proc_t p)
+{
+	smr_call(&smr_system, &p->p_smr, proc_free_smr);
+}
+
 /*
  * Locate a process by number
  */
@@ -1355,6 +1481,7 @@ pinsertchild(proc_t parent, proc_t child)
 	LIST_INSERT_HEAD(&allproc, child, p_list);
 	/* mark the completion of proc creation */
 	child->p_listflag &= ~P_LIST_INCREATE;
+	proc_ref_update_locked(child);
 
 	proc_list_unlock();
 }
@@ -120,6 +120,7 @@
 #include <kern/task.h>
 #include <kern/thread.h>
 #include <kern/thread_group.h>
+#include <kern/thread_call.h>
 #include <kern/processor.h>
 #include <kern/cpu_number.h>
 #include <kern/cpu_quiesce.h>
@@ -169,6 +170,7 @@
 extern int aio_max_requests;  				
 extern int aio_max_requests_per_process;	
 extern int aio_worker_threads;				
+extern int aio_listio_inline;
 extern int lowpri_IO_window_msecs;
 extern int lowpri_IO_delay_msecs;
 extern int nx_enabled;
@@ -339,6 +341,7 @@ fill_loadavg32(struct loadavg *la, struct user32_loadavg *la32)
 extern char corefilename[MAXPATHLEN+1];
 extern int do_coredump;
 extern int sugid_coredump;
+extern int sparse_coredump;
 #endif
 
 #if COUNT_SYSCALLS
@@ -415,6 +418,30 @@ sysctl_handle_kern_threadname(	__unused struct sysctl_oid *oidp, __unused void *
 
 SYSCTL_PROC(_kern, KERN_THREADNAME, threadname, CTLFLAG_ANYBODY | CTLTYPE_STRING | CTLFLAG_RW | CTLFLAG_LOCKED, 0, 0, sysctl_handle_kern_threadname,"A","");
 
+/*
+ * Per-thread opt-in to publishing the runtime of the calling thread in the
+ * commpage, so it can read it without a syscall.
+ */
+STATIC int
+sysctl_handle_kern_thread_commpage_usage(__unused struct sysctl_oid *oidp,
+	__unused void *arg1, __unused int arg2, struct sysctl_req *req)
+{
+	int error, changed;
+	int value = thread_get_commpage_usage();
+
+	error = sysctl_io_number(req, value, sizeof(value), &value, &changed);
+	if (error || !changed)
+		return error;
+
+	if (value != 0 && value != 1)
+		return EINVAL;
+
+	thread_set_commpage_usage(value ? TRUE : FALSE);
+	return 0;
+}
+
+SYSCTL_PROC(_kern, OID_AUTO, thread_commpage_usage, CTLFLAG_ANYBODY | CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_LOCKED, 0, 0, sysctl_handle_kern_thread_commpage_usage, "I", "");
+
 #define BSD_HOST 1
 STATIC int
 sysctl_sched_stats(__unused struct sysctl_oid *oidp, __unused void *arg1, __unused int arg2, struct sysctl_req *req)
@@ -1843,6 +1870,10 @@ SYSCTL_INT(_kern, OID_AUTO, namecache_disabled,
 		CTLFLAG_RW | CTLFLAG_LOCKED, 
 		&nc_disabled, 0, ""); 
 
+SYSCTL_INT(_kern, OID_AUTO, namecache_lockless,
+		CTLFLAG_RW | CTLFLAG_LOCKED,
+		&nc_lockless_lookup, 0, "Walk paths in the name cache without the namecache lock");
+
 SYSCTL_PROC(_kern, KERN_MAXVNODES, maxvnodes,
 		CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_LOCKED,
 		0, 0, sysctl_maxvnodes, "I", "");
@@ -1863,6 +1894,10 @@ SYSCTL_PROC(_kern, KERN_AIOTHREADS, aiothreads,
 		CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_LOCKED,
 		0, 0, sysctl_aiothreads, "I", "");
 
+SYSCTL_INT(_kern, OID_AUTO, aio_listio_inline,
+		CTLFLAG_RW | CTLFLAG_LOCKED,
+		&aio_listio_inline, 0, "lio_listio(LIO_WAIT) does its IO on the calling thread");
+
 #if (DEVELOPMENT || DEBUG)
 extern int sched_smt_balance;
 SYSCTL_INT(_kern, OID_AUTO, sched_smt_balance, 
@@ -2313,6 +2348,37 @@ SYSCTL_PROC(_kern_timer_longterm, OID_AUTO, latency_max,
 		(void *) LATENCY_MAX, 0, sysctl_timer, "Q", "");
 #endif /* DEBUG */
 
+/*
+ * Time thread calls spend pending before they run: THREAD_CALL_LATENCY_BUCKETS
+ * counters for each thread call group, see thread_call_latency_histograms()
+ */
+STATIC int
+sysctl_thread_call_latency
+(__unused struct sysctl_oid *oidp, __unused void *arg1, __unused int arg2, struct sysctl_req *req)
+{
+	size_t count = thread_call_latency_histograms(NULL, 0);
+	size_t size = count * sizeof(uint64_t);
+	uint64_t *hist;
+	int error;
+
+	if (req->oldptr == USER_ADDR_NULL)
+		return SYSCTL_OUT(req, NULL, size);
+
+	hist = kalloc(size);
+	if (hist == NULL)
+		return ENOMEM;
+
+	count = thread_call_latency_histograms(hist, count);
+	error = SYSCTL_OUT(req, hist, count * sizeof(uint64_t));
+
+	kfree(hist, size);
+	return error;
+}
+
+SYSCTL_PROC(_kern_timer, OID_AUTO, thread_call_latency,
+		CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_LOCKED,
+		0, 0, sysctl_thread_call_latency, "Q", "");
+
 STATIC int
 sysctl_usrstack
 (__unused struct sysctl_oid *oidp, __unused void *arg1, __unused int arg2, struct sysctl_req *req)
@@ -2389,6 +2455,10 @@ SYSCTL_PROC(_kern, KERN_SUGID_COREDUMP, sugid_coredump,
 		CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_LOCKED,
 		0, 0, sysctl_suid_coredump, "I", "");
 
+SYSCTL_INT(_kern, OID_AUTO, sparse_coredump,
+		CTLFLAG_RW | CTLFLAG_LOCKED,
+		&sparse_coredump, 0, "leave memory that was never touched out of core files");
+
 #endif /* CONFIG_COREDUMP */
 
 STATIC int
@@ -2999,6 +3069,10 @@ sysctl_freeze_enabled SYSCTL_HANDLER_ARGS
 }
 
 SYSCTL_PROC(_vm, OID_AUTO, freeze_enabled, CTLTYPE_INT|CTLFLAG_RW|CTLFLAG_ANYBODY, &memorystatus_freeze_enabled, 0, sysctl_freeze_enabled, "I", "");
+
+extern uint64_t c_freezer_relocations_skipped;
+
+SYSCTL_QUAD(_vm, OID_AUTO, freeze_relocations_skipped, CTLFLAG_RD | CTLFLAG_LOCKED, &c_freezer_relocations_skipped, "");
 #endif /* CONFIG_FREEZE */
 
 #if DEVELOPMENT || DEBUG
@@ -3242,6 +3316,21 @@ extern uint32_t	compressor_sample_max_in_msecs;
 extern uint32_t	compressor_thrashing_threshold_per_10msecs;
 extern uint32_t	compressor_thrashing_min_per_10msecs;
 extern uint32_t vm_compressor_time_thread;
+extern uint64_t	vm_compressor_refaults;
+extern uint64_t	vm_compressor_refaults_workingset;
+extern boolean_t vm_compressor_workingset_thrashing;
+extern uint64_t	vm_compressor_minor_compaction_bytes_reclaimed;
+extern uint64_t	vm_compressor_minor_compaction_lock_hold_ns;
+extern uint64_t	vm_compressor_minor_compaction_lock_hold_max_ns;
+extern uint64_t	vm_compressor_minor_compaction_skipped_busy;
+extern uint32_t	vm_compactor_helpers_max;
+extern uint32_t	vm_run_compactor_helped;
+extern uint32_t	vm_run_compactor_already_running;
+extern uint32_t	vm_compressor_dup_scan;
+extern uint64_t	vm_compressor_dup_checks;
+extern uint64_t	vm_compressor_dup_candidates;
+extern uint64_t	vm_compressor_dup_candidate_bytes;
+extern uint64_t	vm_compressor_dup_check_ns;
 
 #if DEVELOPMENT || DEBUG
 extern uint32_t	vm_compressor_minorcompact_threshold_divisor;
@@ -3346,11 +3435,30 @@ SYSCTL_INT(_vm, OID_AUTO, compressor_sample_min_in_msecs, CTLFLAG_RW | CTLFLAG_L
 SYSCTL_INT(_vm, OID_AUTO, compressor_sample_max_in_msecs, CTLFLAG_RW | CTLFLAG_LOCKED, &compressor_sample_max_in_msecs, 0, "");
 SYSCTL_INT(_vm, OID_AUTO, compressor_thrashing_threshold_per_10msecs, CTLFLAG_RW | CTLFLAG_LOCKED, &compressor_thrashing_threshold_per_10msecs, 0, "");
 SYSCTL_INT(_vm, OID_AUTO, compressor_thrashing_min_per_10msecs, CTLFLAG_RW | CTLFLAG_LOCKED, &compressor_thrashing_min_per_10msecs, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_refaults, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_refaults, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_refaults_workingset, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_refaults_workingset, "");
+SYSCTL_INT(_vm, OID_AUTO, compressor_workingset_thrashing, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_workingset_thrashing, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_minor_compaction_bytes_reclaimed, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_minor_compaction_bytes_reclaimed, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_minor_compaction_lock_hold_ns, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_minor_compaction_lock_hold_ns, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_minor_compaction_lock_hold_max_ns, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_minor_compaction_lock_hold_max_ns, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_minor_compaction_skipped_busy, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_minor_compaction_skipped_busy, "");
+SYSCTL_UINT(_vm, OID_AUTO, compactor_helpers_max, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_compactor_helpers_max, 0, "");
+SYSCTL_UINT(_vm, OID_AUTO, compactor_helped, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_run_compactor_helped, 0, "");
+SYSCTL_UINT(_vm, OID_AUTO, compactor_already_running, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_run_compactor_already_running, 0, "");
+SYSCTL_UINT(_vm, OID_AUTO, compressor_dup_scan, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_compressor_dup_scan, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_dup_checks, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_dup_checks, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_dup_candidates, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_dup_candidates, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_dup_candidate_bytes, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_dup_candidate_bytes, "");
+SYSCTL_QUAD(_vm, OID_AUTO, compressor_dup_check_ns, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_dup_check_ns, "");
 
 SYSCTL_STRING(_vm, OID_AUTO, swapfileprefix, CTLFLAG_RW | CTLFLAG_KERN | CTLFLAG_LOCKED, swapfilename, sizeof(swapfilename) - SWAPFILENAME_INDEX_LEN, "");
 
 SYSCTL_INT(_vm, OID_AUTO, compressor_timing_enabled, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_compressor_time_thread, 0, "");
 
+SYSCTL_INT(_vm, OID_AUTO, compressor_thread_count, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_pageout_state.vm_compressor_thread_count, 0, "");
+SYSCTL_OPAQUE(_vm, OID_AUTO, compressor_worker_stats, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_compressor_worker_stats,
+    sizeof(vm_compressor_worker_stats), "S,vmcw_stats", "per compressor worker compression/decompression counters");
+
 #if DEVELOPMENT || DEBUG
 SYSCTL_QUAD(_vm, OID_AUTO, compressor_thread_runtime0, CTLFLAG_RD | CTLFLAG_LOCKED, &vmct_stats.vmct_runtimes[0], "");
 SYSCTL_QUAD(_vm, OID_AUTO, compressor_thread_runtime1, CTLFLAG_RD | CTLFLAG_LOCKED, &vmct_stats.vmct_runtimes[1], "");
@@ -3417,6 +3525,13 @@ SYSCTL_QUAD(_vm, OID_AUTO, wks_decompressions, CTLFLAG_RD | CTLFLAG_LOCKED, &com
 SYSCTL_QUAD(_vm, OID_AUTO, wk_decompressed_bytes, CTLFLAG_RD | CTLFLAG_LOCKED, &compressor_stats.wk_decompressed_bytes, "");
 SYSCTL_QUAD(_vm, OID_AUTO, wk_sv_decompressions, CTLFLAG_RD | CTLFLAG_LOCKED, &compressor_stats.wk_sv_decompressions, "");
 
+SYSCTL_QUAD(_vm, OID_AUTO, cclass_scans, CTLFLAG_RD | CTLFLAG_LOCKED, &compressor_stats.cclass_scans, "");
+SYSCTL_QUAD(_vm, OID_AUTO, cclass_sv, CTLFLAG_RD | CTLFLAG_LOCKED, &compressor_stats.cclass_sv, "");
+SYSCTL_QUAD(_vm, OID_AUTO, cclass_raw, CTLFLAG_RD | CTLFLAG_LOCKED, &compressor_stats.cclass_raw, "");
+SYSCTL_QUAD(_vm, OID_AUTO, cclass_lz4, CTLFLAG_RD | CTLFLAG_LOCKED, &compressor_stats.cclass_lz4, "");
+SYSCTL_QUAD(_vm, OID_AUTO, cclass_lz4_failures, CTLFLAG_RD | CTLFLAG_LOCKED, &compressor_stats.cclass_lz4_failures, "");
+SYSCTL_QUAD(_vm, OID_AUTO, cclass_undecided, CTLFLAG_RD | CTLFLAG_LOCKED, &compressor_stats.cclass_undecided, "");
+
 SYSCTL_INT(_vm, OID_AUTO, lz4_threshold, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.lz4_threshold, 0, "");
 SYSCTL_INT(_vm, OID_AUTO, wkdm_reeval_threshold, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.wkdm_reeval_threshold, 0, "");
 SYSCTL_INT(_vm, OID_AUTO, lz4_max_failure_skips, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.lz4_max_failure_skips, 0, "");
@@ -3425,6 +3540,9 @@ SYSCTL_INT(_vm, OID_AUTO, lz4_max_preselects, CTLFLAG_RW | CTLFLAG_LOCKED, &vmct
 SYSCTL_INT(_vm, OID_AUTO, lz4_run_preselection_threshold, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.lz4_run_preselection_threshold, 0, "");
 SYSCTL_INT(_vm, OID_AUTO, lz4_run_continue_bytes, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.lz4_run_continue_bytes, 0, "");
 SYSCTL_INT(_vm, OID_AUTO, lz4_profitable_bytes, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.lz4_profitable_bytes, 0, "");
+SYSCTL_INT(_vm, OID_AUTO, cclass_enabled, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.cclass_enabled, 0, "");
+SYSCTL_INT(_vm, OID_AUTO, cclass_raw_collision_pct, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.cclass_raw_collision_pct, 0, "");
+SYSCTL_INT(_vm, OID_AUTO, cclass_text_pct, CTLFLAG_RW | CTLFLAG_LOCKED, &vmctune.cclass_text_pct, 0, "");
 #if DEVELOPMENT || DEBUG
 extern int vm_compressor_current_codec;
 extern int vm_compressor_test_seg_wp;
@@ -3445,11 +3563,19 @@ SYSCTL_INT(_vm, OID_AUTO, vm_ktrace, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_ktrace_ena
 extern uint32_t phantom_cache_thrashing_threshold;
 extern uint32_t phantom_cache_eval_period_in_msecs;
 extern uint32_t phantom_cache_thrashing_threshold_ssd;
+extern uint32_t phantom_cache_workingset_activate;
+extern uint64_t phantom_cache_refaults;
+extern uint64_t phantom_cache_refaults_workingset;
+extern uint64_t phantom_cache_refault_distance;
 
 
 SYSCTL_INT(_vm, OID_AUTO, phantom_cache_eval_period_in_msecs, CTLFLAG_RW | CTLFLAG_LOCKED, &phantom_cache_eval_period_in_msecs, 0, "");
 SYSCTL_INT(_vm, OID_AUTO, phantom_cache_thrashing_threshold, CTLFLAG_RW | CTLFLAG_LOCKED, &phantom_cache_thrashing_threshold, 0, "");
 SYSCTL_INT(_vm, OID_AUTO, phantom_cache_thrashing_threshold_ssd, CTLFLAG_RW | CTLFLAG_LOCKED, &phantom_cache_thrashing_threshold_ssd, 0, "");
+SYSCTL_INT(_vm, OID_AUTO, phantom_cache_workingset_activate, CTLFLAG_RW | CTLFLAG_LOCKED, &phantom_cache_workingset_activate, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, phantom_cache_refaults, CTLFLAG_RD | CTLFLAG_LOCKED, &phantom_cache_refaults, "");
+SYSCTL_QUAD(_vm, OID_AUTO, phantom_cache_refaults_workingset, CTLFLAG_RD | CTLFLAG_LOCKED, &phantom_cache_refaults_workingset, "");
+SYSCTL_QUAD(_vm, OID_AUTO, phantom_cache_refault_distance, CTLFLAG_RD | CTLFLAG_LOCKED, &phantom_cache_refault_distance, "");
 #endif
 
 #if CONFIG_BACKGROUND_QUEUE
@@ -3539,6 +3665,11 @@ extern uint32_t oslog_s_metadata_msgcount;
 extern uint32_t oslog_s_error_count;
 extern uint32_t oslog_s_streamed_msgcount;
 extern uint32_t oslog_s_dropped_msgcount;
+extern uint32_t oslog_s_lock_wait_count;
+
+/* log lock and msgbuf counters */
+extern uint32_t bsd_log_lock_wait_count;
+extern uint32_t oslog_msgbuf_locked_format_count;
 
 SYSCTL_UINT(_debug, OID_AUTO, oslog_p_total_msgcount, CTLFLAG_ANYBODY | CTLFLAG_RD | CTLFLAG_LOCKED, &oslog_p_total_msgcount, 0, "");
 SYSCTL_UINT(_debug, OID_AUTO, oslog_p_metadata_saved_msgcount, CTLFLAG_ANYBODY | CTLFLAG_RD | CTLFLAG_LOCKED, &oslog_p_metadata_saved_msgcount, 0, "");
@@ -3553,6 +3684,10 @@ SYSCTL_UINT(_debug, OID_AUTO, oslog_s_metadata_msgcount, CTLFLAG_ANYBODY | CTLFL
 SYSCTL_UINT(_debug, OID_AUTO, oslog_s_error_count, CTLFLAG_ANYBODY | CTLFLAG_RD | CTLFLAG_LOCKED, &oslog_s_error_count, 0, "");
 SYSCTL_UINT(_debug, OID_AUTO, oslog_s_streamed_msgcount, CTLFLAG_ANYBODY | CTLFLAG_RD | CTLFLAG_LOCKED, &oslog_s_streamed_msgcount, 0, "");
 SYSCTL_UINT(_debug, OID_AUTO, oslog_s_dropped_msgcount, CTLFLAG_ANYBODY | CTLFLAG_RD | CTLFLAG_LOCKED, &oslog_s_dropped_msgcount, 0, "");
+SYSCTL_UINT(_debug, OID_AUTO, oslog_s_lock_wait_count, CTLFLAG_ANYBODY | CTLFLAG_RD | CTLFLAG_LOCKED, &oslog_s_lock_wait_count, 0, "");
+
+SYSCTL_UINT(_debug, OID_AUTO, bsd_log_lock_wait_count, CTLFLAG_ANYBODY | CTLFLAG_RD | CTLFLAG_LOCKED, &bsd_log_lock_wait_count, 0, "");
+SYSCTL_UINT(_debug, OID_AUTO, oslog_msgbuf_locked_format_count, CTLFLAG_ANYBODY | CTLFLAG_RD | CTLFLAG_LOCKED, &oslog_msgbuf_locked_format_count, 0, "");
 
 
 #endif /* DEVELOPMENT || DEBUG */
@@ -3565,6 +3700,23 @@ extern uint32_t ipc_voucher_trace_contents;
 SYSCTL_INT (_kern, OID_AUTO, ipc_voucher_trace_contents,
 	    CTLFLAG_RW | CTLFLAG_LOCKED, &ipc_voucher_trace_contents, 0, "Enable tracing voucher contents");
 
+#if IMPORTANCE_INHERITANCE
+/*
+ * Importance lock acquisitions (sample twice for a rate) and the receive
+ * vouchers that didn't need to be created
+ */
+extern uint64_t ipc_importance_lock_count;
+extern uint64_t ipc_importance_lock_contended;
+extern uint64_t ipc_importance_voucher_reused;
+
+SYSCTL_QUAD(_kern, OID_AUTO, ipc_importance_lock_count,
+	    CTLFLAG_RD | CTLFLAG_LOCKED, &ipc_importance_lock_count, "");
+SYSCTL_QUAD(_kern, OID_AUTO, ipc_importance_lock_contended,
+	    CTLFLAG_RD | CTLFLAG_LOCKED, &ipc_importance_lock_contended, "");
+SYSCTL_QUAD(_kern, OID_AUTO, ipc_importance_voucher_reused,
+	    CTLFLAG_RD | CTLFLAG_LOCKED, &ipc_importance_voucher_reused, "");
+#endif /* IMPORTANCE_INHERITANCE */
+
 /*
  * Kernel stack size and depth
  */
@@ -3577,6 +3729,27 @@ extern unsigned int kern_feature_overrides;
 SYSCTL_INT (_kern, OID_AUTO, kern_feature_overrides,
 	    CTLFLAG_RD | CTLFLAG_LOCKED, &kern_feature_overrides, 0, "Kernel feature override mask");
 
+/*
+ * Out-of-line memory descriptor transfer strategies
+ */
+extern int ipc_ool_steal;
+extern uint64_t ipc_ool_physical_count;
+extern uint64_t ipc_ool_cow_count;
+extern uint64_t ipc_ool_steal_count;
+
+SYSCTL_INT(_kern, OID_AUTO, ipc_ool_steal,
+		CTLFLAG_RW | CTLFLAG_LOCKED,
+		&ipc_ool_steal, 0, "Move whole deallocated pages instead of copying them");
+SYSCTL_QUAD(_kern, OID_AUTO, ipc_ool_physical_count,
+		CTLFLAG_RD | CTLFLAG_LOCKED,
+		&ipc_ool_physical_count, "Out-of-line regions copied into kernel buffers");
+SYSCTL_QUAD(_kern, OID_AUTO, ipc_ool_cow_count,
+		CTLFLAG_RD | CTLFLAG_LOCKED,
+		&ipc_ool_cow_count, "Out-of-line regions copied on write");
+SYSCTL_QUAD(_kern, OID_AUTO, ipc_ool_steal_count,
+		CTLFLAG_RD | CTLFLAG_LOCKED,
+		&ipc_ool_steal_count, "Out-of-line regions moved from the sender");
+
 /*
  * enable back trace for port allocations
  */
@@ -4101,6 +4274,17 @@ SYSCTL_PROC(_kern, OID_AUTO, grade_cputype,
             0, 0, &sysctl_grade_cputype, "S",
             "grade value of cpu_type_t+cpu_sub_type_t");
 
+extern uint64_t corpse_footprint_inflight;
+extern uint64_t corpse_footprint_budget;
+extern uint64_t corpse_footprint_over_budget;
+
+SYSCTL_QUAD(_kern, OID_AUTO, corpse_footprint_inflight, CTLFLAG_RD | CTLFLAG_LOCKED,
+	&corpse_footprint_inflight, "footprint of the task maps held by corpses in flight");
+SYSCTL_QUAD(_kern, OID_AUTO, corpse_footprint_budget, CTLFLAG_RW | CTLFLAG_LOCKED,
+	&corpse_footprint_budget, "bound on the footprint of the task maps held by corpses");
+SYSCTL_QUAD(_kern, OID_AUTO, corpse_footprint_over_budget, CTLFLAG_RD | CTLFLAG_LOCKED,
+	&corpse_footprint_over_budget, "corpses generated without a map to stay within budget");
+
 
 #if DEVELOPMENT || DEBUG
 
@@ -4449,6 +4633,27 @@ SYSCTL_PROC(_kern, OID_AUTO, test_mtx_contended, CTLTYPE_STRING | CTLFLAG_MASKED
 SYSCTL_PROC(_kern, OID_AUTO, test_mtx_uncontended, CTLTYPE_STRING | CTLFLAG_MASKED | CTLFLAG_RW | CTLFLAG_KERN | CTLFLAG_LOCKED,
 	0, 0, sysctl_test_mtx_uncontended, "A", "get statistics for uncontended mtx test");
 
+extern int lck_mtx_adaptive_spin;
+extern uint64_t lck_mtx_spin_avg;
+
+SYSCTL_INT(_kern, OID_AUTO, lck_mtx_adaptive_spin, CTLFLAG_RW | CTLFLAG_KERN | CTLFLAG_LOCKED,
+	&lck_mtx_adaptive_spin, 0, "bound contended mutex spinning by observed wait times");
+SYSCTL_QUAD(_kern, OID_AUTO, lck_mtx_spin_avg, CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED,
+	&lck_mtx_spin_avg, "average contended mutex spin time (abs time)");
+
+static int
+sysctl_lck_mtx_contention_hist SYSCTL_HANDLER_ARGS
+{
+#pragma unused(oidp, arg1, arg2)
+	return SYSCTL_OUT(req, lck_mtx_contention_hist,
+	    sizeof(lck_mtx_contention_hist[0]) * LCK_MTX_CONTENTION_BUCKETS);
+}
+
+SYSCTL_UINT(_kern, OID_AUTO, lck_mtx_contention_rate, CTLFLAG_RW | CTLFLAG_KERN | CTLFLAG_LOCKED,
+	&lck_mtx_contention_rate, 0, "time one in this many mutex waits, 0 to disable");
+SYSCTL_PROC(_kern, OID_AUTO, lck_mtx_contention_hist, CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED,
+	0, 0, sysctl_lck_mtx_contention_hist, "Q", "log2 histogram of sampled mutex wait times (ns)");
+
 #if defined (__x86_64__)
 
 semaphore_t sysctl_test_panic_with_thread_sem;
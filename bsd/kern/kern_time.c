@@ -571,7 +571,7 @@ proc_free_realitimer(proc_t p)
 	proc_spinlock(p);
 
 	assert(p->p_rcall != NULL);
-	assert(p->p_refcount == 0);
+	assert((p->p_refcount & P_REF_COUNT_MASK) == 0);
 
 	timerclear(&p->p_realtimer.it_interval);
 
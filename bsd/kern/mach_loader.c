@@ -1040,6 +1040,8 @@ parse_machfile(
 				   load signatures & store in uip
 				   set VM object "signed_pages"
 				*/
+				KERNEL_DEBUG_CONSTANT(BSDDBG_CODE(DBG_BSD_PROC, BSD_PROC_EXEC_CODESIGN) | DBG_FUNC_START,
+						      p->p_pid, depth, 0, 0, 0);
 				ret = load_code_signature(
 					(struct linkedit_data_command *) lcp,
 					vp,
@@ -1048,6 +1050,8 @@ parse_machfile(
 					header->cputype,
 					result,
 					imgp);
+				KERNEL_DEBUG_CONSTANT(BSDDBG_CODE(DBG_BSD_PROC, BSD_PROC_EXEC_CODESIGN) | DBG_FUNC_END,
+						      p->p_pid, depth, ret, 0, 0);
 				if (ret != LOAD_SUCCESS) {
 					printf("proc %d: load code signature error %d "
 					       "for file \"%s\"\n",
@@ -1179,8 +1183,12 @@ parse_machfile(
 			 * load the dylinker, and slide it by the independent DYLD ASLR
 			 * offset regardless of the PIE-ness of the main binary.
 			 */
+			KERNEL_DEBUG_CONSTANT(BSDDBG_CODE(DBG_BSD_PROC, BSD_PROC_EXEC_DYLD) | DBG_FUNC_START,
+					      p->p_pid, 0, 0, 0, 0);
 			ret = load_dylinker(dlp, dlarchbits, map, thread, depth,
 					    dyld_aslr_offset, result, imgp);
+			KERNEL_DEBUG_CONSTANT(BSDDBG_CODE(DBG_BSD_PROC, BSD_PROC_EXEC_DYLD) | DBG_FUNC_END,
+					      p->p_pid, ret, 0, 0, 0);
 		}
 
 		if ((ret == LOAD_SUCCESS) && (depth == 1)) {
@@ -146,6 +146,8 @@ static unsigned int mcache_slab_alloc(void *, mcache_obj_t ***,
 static void mcache_slab_free(void *, mcache_obj_t *, boolean_t);
 static void mcache_slab_audit(void *, mcache_obj_t *, boolean_t);
 static void mcache_cpu_refill(mcache_cpu_t *, mcache_bkt_t *, int);
+static unsigned int mcache_slab_batch_alloc(mcache_t *, mcache_obj_t ***,
+    unsigned int, int);
 static mcache_bkt_t *mcache_bkt_alloc(mcache_t *, mcache_bktlist_t *,
     mcache_bkttype_t **);
 static void mcache_bkt_free(mcache_t *, mcache_bktlist_t *, mcache_bkt_t *);
@@ -458,6 +460,7 @@ mcache_alloc_ext(mcache_t *cp, mcache_obj_t **list, unsigned int num, int wait)
 	mcache_bkt_t *bkt;
 	unsigned int need = num;
 	boolean_t nwretry = FALSE;
+	boolean_t batch;
 
 	/* MCR_NOSLEEP and MCR_FAILOK are mutually exclusive */
 	VERIFY((wait & (MCR_NOSLEEP|MCR_FAILOK)) != (MCR_NOSLEEP|MCR_FAILOK));
@@ -471,6 +474,7 @@ mcache_alloc_ext(mcache_t *cp, mcache_obj_t **list, unsigned int num, int wait)
 retry_alloc:
 	/* We may not always be running in the same CPU in case of retries */
 	ccp = MCACHE_CPU(cp);
+	batch = FALSE;
 
 	MCACHE_LOCK(&ccp->cc_lock);
 	for (;;) {
@@ -545,13 +549,20 @@ retry_alloc:
 
 		/*
 		 * The bucket layer has no full buckets; allocate the
-		 * object(s) directly from the slab layer.
+		 * object(s) directly from the slab layer, along with
+		 * a bucket's worth of objects for this CPU if the
+		 * cache allows for it.
 		 */
+		batch = ((cp->mc_flags & (MCF_BATCHREFILL | MCF_DEBUG)) ==
+		    MCF_BATCHREFILL);
 		break;
 	}
 	MCACHE_UNLOCK(&ccp->cc_lock);
 
-	need -= (*cp->mc_slab_alloc)(cp->mc_private, &list, need, wait);
+	if (batch)
+		need -= mcache_slab_batch_alloc(cp, &list, need, wait);
+	else
+		need -= (*cp->mc_slab_alloc)(cp->mc_private, &list, need, wait);
 
 	/*
 	 * If this is a blocking allocation, or if it is non-blocking and
@@ -1045,6 +1056,83 @@ mcache_cpu_refill(mcache_cpu_t *ccp, mcache_bkt_t *bkt, int objs)
 	ccp->cc_objs = objs;
 }
 
+/*
+ * Allocate the requested objects from the slab layer along with enough
+ * extra objects to fill a bucket, all in a single slab layer request.
+ * The extra objects are used to refill the current CPU, so that the
+ * allocations which follow are satisfied by the CPU layer rather than
+ * going down to the slab layer (and its lock) one request at a time.
+ */
+static unsigned int
+mcache_slab_batch_alloc(mcache_t *cp, mcache_obj_t ***plist,
+    unsigned int need, int wait)
+{
+	mcache_obj_t *blist = NULL, **list = &blist, *o = NULL;
+	mcache_bkttype_t *btp;
+	mcache_cpu_t *ccp;
+	mcache_bkt_t *bkt;
+	unsigned int got, i, n;
+	int bktsize;
+
+	bkt = mcache_bkt_alloc(cp, &cp->mc_empty, &btp);
+	if (bkt == NULL &&
+	    (bkt = mcache_alloc(btp->bt_cache, MCR_NOSLEEP)) == NULL)
+		return ((*cp->mc_slab_alloc)(cp->mc_private, plist, need, wait));
+
+	bktsize = btp->bt_bktsize;
+	got = (*cp->mc_slab_alloc)(cp->mc_private, &list,
+	    need + bktsize, wait | MCR_BATCH);
+
+	/* Hand the caller its share of the objects */
+	n = MIN(got, need);
+	if (n > 0) {
+		**plist = blist;
+		for (i = 0; i < n; i++) {
+			o = blist;
+			blist = o->obj_next;
+		}
+		o->obj_next = NULL;
+		*plist = &o->obj_next;
+	}
+
+	/*
+	 * If there's exactly a bucket's worth left, link the objects
+	 * in the bucket the way the CPU layer expects them to be, and
+	 * refill the current CPU with it, provided that the bucket size
+	 * hasn't changed and that the CPU is still out of objects.
+	 */
+	if (got - n == (unsigned int)bktsize) {
+		for (i = 0; i < (unsigned int)bktsize; i++) {
+			o = blist;
+			blist = o->obj_next;
+			o->obj_next = (i == 0) ? NULL : bkt->bkt_obj[i - 1];
+			bkt->bkt_obj[i] = o;
+		}
+
+		ccp = MCACHE_CPU(cp);
+		MCACHE_LOCK(&ccp->cc_lock);
+		if (ccp->cc_bktsize == bktsize && ccp->cc_objs <= 0 &&
+		    ccp->cc_pobjs <= 0) {
+			if (ccp->cc_pfilled != NULL)
+				mcache_bkt_free(cp, &cp->mc_empty,
+				    ccp->cc_pfilled);
+			mcache_cpu_refill(ccp, bkt, bktsize);
+			MCACHE_UNLOCK(&ccp->cc_lock);
+			atomic_add_32(&cp->mc_batch_cnt, 1);
+			return (n);
+		}
+		MCACHE_UNLOCK(&ccp->cc_lock);
+		blist = bkt->bkt_obj[bktsize - 1];
+	}
+
+	/* Otherwise give the extra objects back to the slab layer */
+	if (blist != NULL)
+		(*cp->mc_slab_free)(cp->mc_private, blist, FALSE);
+	mcache_free(btp->bt_cache, bkt);
+
+	return (n);
+}
+
 /*
  * Allocate a bucket from the bucket layer.
  */
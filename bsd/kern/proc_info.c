@@ -60,6 +60,7 @@
 #include <kern/kalloc.h>
 #include <kern/assert.h>
 #include <kern/policy_internal.h>
+#include <kern/kern_cdata.h>
 
 #include <vm/vm_kern.h>
 #include <vm/vm_map.h>
@@ -149,6 +150,7 @@ int __attribute__ ((noinline)) proc_pid_rusage(int pid, int flavor, user_addr_t
 int __attribute__ ((noinline)) proc_pidoriginatorinfo(int pid, int flavor, user_addr_t buffer, uint32_t buffersize, int32_t * retval);
 int __attribute__ ((noinline)) proc_listcoalitions(int flavor, int coaltype, user_addr_t buffer, uint32_t buffersize, int32_t *retval);
 int __attribute__ ((noinline)) proc_can_use_foreground_hw(int pid, user_addr_t reason, uint32_t resonsize, int32_t *retval);
+int __attribute__ ((noinline)) proc_snapshot(uint32_t type, uint32_t typeinfo, uint64_t flags, user_addr_t buffer, uint32_t buffersize, int32_t * retval);
 
 /* protos for procpidinfo calls */
 int __attribute__ ((noinline)) proc_pidfdlist(proc_t p, user_addr_t buffer, uint32_t buffersize, int32_t *retval);
@@ -197,10 +199,12 @@ void  fill_fileinfo(struct fileproc * fp, proc_t proc, int fd, struct proc_filei
 int proc_security_policy(proc_t targetp, int callnum, int flavor, boolean_t check_same_user);
 static void munge_vinfo_stat(struct stat64 *sbp, struct vinfo_stat *vsbp);
 static int proc_piduuidinfo(pid_t pid, uuid_t uuid_buf, uint32_t buffersize);
+static uint32_t proc_listpids_fill(uint32_t type, uint32_t typeinfo, int *pids, uint32_t numprocs);
 int proc_pidpathinfo_internal(proc_t p, __unused uint64_t arg, char *buf, uint32_t buffersize, __unused int32_t *retval);
 
 extern int cansignal(struct proc *, kauth_cred_t, struct proc *, int);
 extern int proc_get_rusage(proc_t proc, int flavor, user_addr_t buffer, int is_zombie);
+extern int threads_count;
 
 #define CHECK_SAME_USER         TRUE
 #define NO_CHECK_SAME_USER      FALSE
@@ -281,6 +285,9 @@ proc_info_internal(int callnum, int pid, int flavor, uint64_t arg, user_addr_t b
 		case PROC_INFO_CALL_UDATA_INFO:
 			return proc_udata_info(pid, flavor, buffer, buffersize, retval);
 #endif /* !CONFIG_EMBEDDED */
+		case PROC_INFO_CALL_SNAPSHOT:
+			/* pid contains type, flavor contains typeinfo and arg the flags */
+			return proc_snapshot(pid, flavor, arg, buffer, buffersize, retval);
 		default:
 			return EINVAL;
 	}
@@ -297,11 +304,7 @@ proc_listpids(uint32_t type, uint32_t typeinfo, user_addr_t buffer, uint32_t  bu
 	char * kbuf;
 	int * ptr;
 	uint32_t n;
-	int skip;
-	struct proc * p;
-	struct tty * tp;
 	int error = 0;
-	struct proclist *current_list;
 
 	/* Do we have permission to look into this? */
 	if ((error = proc_security_policy(PROC_NULL, PROC_INFO_CALL_LISTPIDS, type, NO_CHECK_SAME_USER)))
@@ -330,11 +333,36 @@ proc_listpids(uint32_t type, uint32_t typeinfo, user_addr_t buffer, uint32_t  bu
 	}
 	bzero(kbuf, sizeof(int));
 
+	n = proc_listpids_fill(type, typeinfo, (int *)kbuf, numprocs);
+
+	ptr = (int *)kbuf;
+	error = copyout((caddr_t)ptr, buffer, n * sizeof(int));
+	if (error == 0)
+		*retval = (n * sizeof(int));
+	kfree((void *)kbuf, (vm_size_t)(numprocs * sizeof(int)));
+
+	return(error);
+}
+
+
+/*
+ * Fill pids with up to numprocs pids of the processes, live then zombies,
+ * matching type and typeinfo; returns the number of pids filled.
+ */
+static uint32_t
+proc_listpids_fill(uint32_t type, uint32_t typeinfo, int *pids, uint32_t numprocs)
+{
+	uint32_t n;
+	int * ptr;
+	int skip;
+	struct proc * p;
+	struct tty * tp;
+	struct proclist *current_list;
+
 	proc_list_lock();
 
-	
 	n = 0;
-	ptr = (int *)kbuf;
+	ptr = pids;
 	current_list = &allproc;
 proc_loop:
 	LIST_FOREACH(p, current_list, p_list) {
@@ -413,13 +441,224 @@ proc_loop:
 
 	proc_list_unlock();
 
-	ptr = (int *)kbuf;
-	error = copyout((caddr_t)ptr, buffer, n * sizeof(int));
+	return(n);
+}
+
+
+/******************* proc_snapshot routines ****************/
+
+/*
+ * Size of a buffer likely to hold the snapshot of numprocs processes with
+ * the information selected by flags.
+ */
+static uint32_t
+proc_snapshot_estimate(uint32_t numprocs, uint64_t flags)
+{
+	uint32_t items_per_proc = 2;
+	uint32_t size_per_proc = 2 * sizeof(uint64_t);
+	uint32_t numthreads = 0;
+	uint64_t estimate;
+
+	if (flags & PROC_SNAPSHOT_BSDSHORTINFO) {
+		items_per_proc++;
+		size_per_proc += sizeof(struct proc_bsdshortinfo);
+	}
+	if (flags & PROC_SNAPSHOT_UNIQIDENTIFIERINFO) {
+		items_per_proc++;
+		size_per_proc += sizeof(struct proc_uniqidentifierinfo);
+	}
+	if (flags & PROC_SNAPSHOT_TASKINFO) {
+		items_per_proc++;
+		size_per_proc += sizeof(struct proc_taskinfo);
+	}
+	if (flags & PROC_SNAPSHOT_THREADINFO) {
+		items_per_proc += 2;
+		numthreads = (uint32_t)threads_count + 10 * numprocs;
+	}
+
+	estimate = kcdata_estimate_required_buffer_size(1 + numprocs * items_per_proc,
+	    sizeof(uint64_t) + numprocs * size_per_proc) +
+	    (uint64_t)numthreads * (sizeof(uint64_t) + sizeof(struct proc_threadinfo));
+
+	return (uint32_t)MIN(estimate, PROC_SNAPSHOT_MAXSIZE);
+}
+
+/*
+ * Add the information selected by flags, and allowed by the security
+ * policy, about p to the snapshot in a PROCINFO_KCCONTAINER_PROC
+ * container.  Returns KERN_RESOURCE_SHORTAGE, having added nothing, when
+ * the container doesn't fit in the buffer.
+ */
+static kern_return_t
+proc_snapshot_proc(kcdata_descriptor_t kcd, proc_t p, uint64_t flags)
+{
+	mach_vm_address_t out_addr;
+	mach_vm_address_t mark;
+	struct proc_threadinfo * pthinfo;
+	uint64_t * tids = NULL;
+	uint32_t tidssize = 0;
+	uint32_t numtids = 0;
+	uint32_t i;
+	kern_return_t kr;
+	int num;
+
+	if ((flags & (PROC_SNAPSHOT_TASKINFO | PROC_SNAPSHOT_THREADINFO)) &&
+	    proc_security_policy(p, PROC_INFO_CALL_PIDINFO, PROC_PIDTASKINFO, CHECK_SAME_USER))
+		flags &= ~(uint64_t)(PROC_SNAPSHOT_TASKINFO | PROC_SNAPSHOT_THREADINFO);
+	if ((flags & (PROC_SNAPSHOT_BSDSHORTINFO | PROC_SNAPSHOT_UNIQIDENTIFIERINFO)) &&
+	    proc_security_policy(p, PROC_INFO_CALL_PIDINFO, PROC_PIDT_SHORTBSDINFO, NO_CHECK_SAME_USER))
+		flags &= ~(uint64_t)(PROC_SNAPSHOT_BSDSHORTINFO | PROC_SNAPSHOT_UNIQIDENTIFIERINFO);
+	if (flags == 0)
+		return (KERN_SUCCESS);
+
+	if (flags & PROC_SNAPSHOT_THREADINFO) {
+		num = get_numthreads(p->task) + 10;
+		tidssize = num * sizeof(uint64_t);
+		tids = (uint64_t *)kalloc(tidssize);
+		if (tids == NULL)
+			return (KERN_RESOURCE_SHORTAGE);
+		numtids = fill_taskthreadlist(p->task, tids, num, true) / sizeof(uint64_t);
+	}
+
+	mark = kcd->kcd_addr_end;
+
+	kr = kcdata_add_container_marker(kcd, KCDATA_TYPE_CONTAINER_BEGIN, PROCINFO_KCCONTAINER_PROC, p->p_pid);
+	if (kr != KERN_SUCCESS)
+		goto out;
+
+	if (flags & PROC_SNAPSHOT_BSDSHORTINFO) {
+		kr = kcdata_get_memory_addr(kcd, PROCINFO_KCTYPE_BSDSHORTINFO, sizeof(struct proc_bsdshortinfo), &out_addr);
+		if (kr != KERN_SUCCESS)
+			goto out;
+		(void)proc_pidshortbsdinfo(p, (struct proc_bsdshortinfo *)out_addr, 0);
+	}
+
+	if (flags & PROC_SNAPSHOT_UNIQIDENTIFIERINFO) {
+		kr = kcdata_get_memory_addr(kcd, PROCINFO_KCTYPE_UNIQIDENTIFIERINFO, sizeof(struct proc_uniqidentifierinfo), &out_addr);
+		if (kr != KERN_SUCCESS)
+			goto out;
+		bzero((void *)out_addr, sizeof(struct proc_uniqidentifierinfo));
+		proc_piduniqidentifierinfo(p, (struct proc_uniqidentifierinfo *)out_addr);
+	}
+
+	if (flags & PROC_SNAPSHOT_TASKINFO) {
+		kr = kcdata_get_memory_addr(kcd, PROCINFO_KCTYPE_TASKINFO, sizeof(struct proc_taskinfo), &out_addr);
+		if (kr != KERN_SUCCESS)
+			goto out;
+		(void)proc_pidtaskinfo(p, (struct proc_taskinfo *)out_addr);
+	}
+
+	if (numtids != 0) {
+		kr = kcdata_get_memory_addr_for_array(kcd, PROCINFO_KCTYPE_THREADIDS, sizeof(uint64_t), numtids, &out_addr);
+		if (kr != KERN_SUCCESS)
+			goto out;
+		bcopy(tids, (void *)out_addr, numtids * sizeof(uint64_t));
+
+		kr = kcdata_get_memory_addr_for_array(kcd, PROCINFO_KCTYPE_THREADINFO, sizeof(struct proc_threadinfo), numtids, &out_addr);
+		if (kr != KERN_SUCCESS)
+			goto out;
+		pthinfo = (struct proc_threadinfo *)out_addr;
+		for (i = 0; i < numtids; i++) {
+			/* a thread that went away since it was listed is left zeroed */
+			(void)proc_pidthreadinfo(p, tids[i], true, &pthinfo[i]);
+		}
+	}
+
+	kr = kcdata_add_container_marker(kcd, KCDATA_TYPE_CONTAINER_END, PROCINFO_KCCONTAINER_PROC, p->p_pid);
+
+out:
+	if (kr != KERN_SUCCESS) {
+		/* drop what was added of the container */
+		kcd->kcd_addr_end = mark;
+		(void)kcdata_write_buffer_end(kcd);
+	}
+	if (tids != NULL)
+		kfree(tids, tidssize);
+	return (kr);
+}
+
+/*
+ * Return in one call, in a KCDATA_BUFFER_BEGIN_PROCINFO kcdata buffer, the
+ * information selected by flags about every live process proc_listpids()
+ * would list for type and typeinfo.  Processes the caller may not look
+ * into are left out, or only get the flavors that don't need it.  When
+ * the buffer is too small PROCINFO_SNAPSHOT_TRUNCATED is set in the
+ * PROCINFO_KCTYPE_SNAPSHOT_FLAGS of the snapshot, which holds the
+ * processes that fit.  With a NULL buffer, returns the size of buffer
+ * likely to be needed.
+ */
+int
+proc_snapshot(uint32_t type, uint32_t typeinfo, uint64_t flags, user_addr_t buffer, uint32_t buffersize, int32_t * retval)
+{
+	struct kcdata_descriptor kcd;
+	mach_vm_address_t flags_addr;
+	uint64_t snapshot_flags = 0;
+	uint32_t numprocs = 0;
+	uint32_t kbufsize;
+	uint32_t n, i;
+	char * kbuf = NULL;
+	int * pids = NULL;
+	proc_t p;
+	int error = 0;
+
+	if (flags == 0 || (flags & ~(uint64_t)PROC_SNAPSHOT_ALL) != 0)
+		return (EINVAL);
+
+	/* Do we have permission to look into this? */
+	if ((error = proc_security_policy(PROC_NULL, PROC_INFO_CALL_LISTPIDS, type, NO_CHECK_SAME_USER)))
+		return (error);
+
+	if ((nprocs + 20) > 0) {
+		numprocs = (uint32_t)(nprocs + 20);
+	}
+
+	if (buffer == (user_addr_t)0) {
+		*retval = proc_snapshot_estimate(numprocs, flags);
+		return (0);
+	}
+
+	if (buffersize < kcdata_estimate_required_buffer_size(1, sizeof(uint64_t)))
+		return (ENOMEM);
+
+	kbufsize = MIN(buffersize, PROC_SNAPSHOT_MAXSIZE);
+	kbuf = (char *)kalloc(kbufsize);
+	pids = (int *)kalloc(numprocs * sizeof(int));
+	if (kbuf == NULL || pids == NULL) {
+		error = ENOMEM;
+		goto out;
+	}
+
+	if (kcdata_memory_static_init(&kcd, (mach_vm_address_t)kbuf, KCDATA_BUFFER_BEGIN_PROCINFO,
+	    kbufsize, KCFLAG_USE_MEMCOPY) != KERN_SUCCESS ||
+	    kcdata_get_memory_addr(&kcd, PROCINFO_KCTYPE_SNAPSHOT_FLAGS, sizeof(uint64_t), &flags_addr) != KERN_SUCCESS) {
+		error = ENOMEM;
+		goto out;
+	}
+
+	n = proc_listpids_fill(type, typeinfo, pids, numprocs);
+
+	for (i = 0; i < n; i++) {
+		/* gone, or a zombie without a task to report on */
+		if ((p = proc_find(pids[i])) == PROC_NULL)
+			continue;
+		if (proc_snapshot_proc(&kcd, p, flags) != KERN_SUCCESS)
+			snapshot_flags |= PROCINFO_SNAPSHOT_TRUNCATED;
+		proc_rele(p);
+		if (snapshot_flags & PROCINFO_SNAPSHOT_TRUNCATED)
+			break;
+	}
+	bcopy(&snapshot_flags, (void *)flags_addr, sizeof(snapshot_flags));
+
+	error = copyout(kbuf, buffer, (uint32_t)kcdata_memory_get_used_bytes(&kcd));
 	if (error == 0)
-		*retval = (n * sizeof(int));
-	kfree((void *)kbuf, (vm_size_t)(numprocs * sizeof(int)));
+		*retval = (int32_t)kcdata_memory_get_used_bytes(&kcd);
 
-	return(error);
+out:
+	if (pids != NULL)
+		kfree(pids, numprocs * sizeof(int));
+	if (kbuf != NULL)
+		kfree(kbuf, kbufsize);
+	return (error);
 }
 
 
@@ -932,6 +932,27 @@ log_putc_locked(struct msgbuf *mbp, char c)
 		mbp->msg_bufx = 0;
 }
 
+/*
+ * log_puts_locked
+ *
+ * Decription:	Output an already formatted message to the log, dropping the
+ *		characters the log doesn't keep; assumes the LOG_LOCK() is
+ *		held by the caller.
+ *
+ * Parameters:	s				Message to output
+ *		len				Length of the message
+ *
+ * Returns:	(void)
+ */
+void
+log_puts_locked(struct msgbuf *mbp, const char *s, size_t len)
+{
+	for (; len > 0; s++, len--) {
+		if (*s != '\0' && *s != '\r' && *s != 0177)
+			log_putc_locked(mbp, *s);
+	}
+}
+
 static oslog_stream_buf_entry_t
 oslog_stream_find_free_buf_entry_locked(void)
 {
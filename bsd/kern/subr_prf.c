@@ -392,6 +392,25 @@ vprintf_log_locked(const char *fmt, va_list ap)
 	return 0;
 }
 
+/*
+ * Format a log message into a buffer the way vprintf_log_locked() would, so
+ * that it can be copied into the log with log_puts_locked() while holding the
+ * log lock only for the copy.  Returns the untruncated length.
+ */
+int
+vsnprintf_log(char *str, size_t size, const char *format, va_list ap)
+{
+	struct snprintf_arg info;
+	int retval;
+
+	info.str = str;
+	info.remain = size;
+	retval = __doprnt(format, ap, snprintf_func, &info, 10, TRUE);
+	if (info.remain >= 1)
+		*info.str++ = '\0';
+	return retval;
+}
+
 #if !CONFIG_EMBEDDED
 
 /*
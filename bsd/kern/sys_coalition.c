@@ -7,6 +7,7 @@
 
 #include <sys/coalition.h>
 #include <sys/errno.h>
+#include <sys/kauth.h>
 #include <sys/kernel.h>
 #include <sys/sysproto.h>
 #include <sys/systm.h>
@@ -254,6 +255,30 @@ coalition_info_efficiency(coalition_t coal, user_addr_t buffer, user_size_t bufs
 	return error;
 }
 
+static int
+coalition_info_cpu_quota(coalition_t coal, user_addr_t buffer, user_size_t bufsize)
+{
+	struct coalition_cpu_quota ccq = {};
+	int error;
+
+	if (!kauth_cred_issuser(kauth_cred_get()))
+		return EPERM;
+	if (bufsize < sizeof(ccq))
+		return EINVAL;
+	error = copyin(buffer, &ccq, sizeof(ccq));
+	if (error)
+		return error;
+
+	switch (coalition_set_cpu_quota(coal, ccq.quota_ns, ccq.period_ns)) {
+	case KERN_SUCCESS:
+		return 0;
+	case KERN_INVALID_ARGUMENT:
+		return EINVAL;
+	default:
+		return EIO;
+	}
+}
+
 int coalition_info(proc_t p, struct coalition_info_args *uap, __unused int32_t *retval)
 {
 	user_addr_t cidp = uap->cid;
@@ -299,6 +324,9 @@ int coalition_info(proc_t p, struct coalition_info_args *uap, __unused int32_t *
 	case COALITION_INFO_SET_EFFICIENCY:
 		error = coalition_info_efficiency(coal, buffer, bufsize);
 		break;
+	case COALITION_INFO_SET_CPU_QUOTA:
+		error = coalition_info_cpu_quota(coal, buffer, bufsize);
+		break;
 	default:
 		error = EINVAL;
 	}
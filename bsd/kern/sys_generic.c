@@ -98,6 +98,7 @@
 #include <sys/kauth.h>
 
 #include <machine/smp.h>
+#include <machine/atomic.h>
 #include <mach/mach_types.h>
 #include <kern/kern_types.h>
 #include <kern/assert.h>
@@ -1648,6 +1649,7 @@ selscan(struct proc *p, struct _select *sel, struct _select_data * seldata,
 }
 
 int poll_callback(struct kqueue *, struct kevent_internal_s *, void *);
+void poll_cache_free(struct uthread *);
 
 struct poll_continue_args {
 	user_addr_t pca_fds;
@@ -1655,6 +1657,51 @@ struct poll_continue_args {
 	u_int pca_rfds;
 };
 
+/*
+ * Registering a knote per descriptor, and tearing the kqueue down, cost
+ * poll() time in the number of descriptors on every call.  Instead a
+ * thread's last poll() kqueue is kept, along with the set it was
+ * registered for, with level triggered knotes: a call on the same set
+ * only scans the knotes that are active.  Any knote dropped from it,
+ * e.g. by a close(), invalidates the cache.  Sets with the vnode
+ * extension events are not cached, those fire once.
+ */
+static int poll_cache = 1;
+SYSCTL_INT(_kern, OID_AUTO, poll_cache, CTLFLAG_RW | CTLFLAG_LOCKED,
+    &poll_cache, 0, "Keep the knotes of a thread's last poll() set");
+
+static boolean_t
+poll_cache_match(struct uthread *ut, struct proc *p, struct pollfd *fds,
+    u_int nfds)
+{
+	u_int i;
+
+	if (ut->uu_pollkq == NULL || ut->uu_pollnfds != nfds ||
+	    ut->uu_pollkq->kq_p != p || !kqueue_pollcache_valid(ut->uu_pollkq))
+		return (FALSE);
+
+	for (i = 0; i < nfds; i++) {
+		if (fds[i].fd != ut->uu_pollset[i].fd ||
+		    fds[i].events != ut->uu_pollset[i].events)
+			return (FALSE);
+	}
+	return (TRUE);
+}
+
+void
+poll_cache_free(struct uthread *ut)
+{
+	if (ut->uu_pollkq != NULL) {
+		kqueue_dealloc(ut->uu_pollkq);
+		ut->uu_pollkq = NULL;
+	}
+	if (ut->uu_pollset != NULL) {
+		FREE(ut->uu_pollset, M_TEMP);
+		ut->uu_pollset = NULL;
+		ut->uu_pollnfds = 0;
+	}
+}
+
 int
 poll(struct proc *p, struct poll_args *uap, int32_t *retval)
 {
@@ -1666,15 +1713,17 @@ poll(struct proc *p, struct poll_args *uap, int32_t *retval)
 int
 poll_nocancel(struct proc *p, struct poll_nocancel_args *uap, int32_t *retval)
 {
-	struct poll_continue_args *cont;
+	struct poll_continue_args *cont = NULL;
+	struct uthread *ut = get_bsdthread_info(current_thread());
 	struct pollfd *fds;
-	struct kqueue *kq;
+	struct kqueue *kq = NULL;
 	struct timeval atv;
 	int ncoll, error = 0;
 	u_int nfds = uap->nfds;
 	u_int rfds = 0;
 	u_int i;
 	size_t ni;
+	boolean_t cacheable, cached = FALSE;
 
 	/*
 	 * This is kinda bogus.  We have fd limits, but that is not
@@ -1687,10 +1736,6 @@ poll_nocancel(struct proc *p, struct poll_nocancel_args *uap, int32_t *retval)
 	    (nfds > p->p_rlimit[RLIMIT_NOFILE].rlim_cur && (proc_suser(p) || nfds > FD_SETSIZE)))
 		return (EINVAL);
 
-	kq = kqueue_alloc(p, 0);
-	if (kq == NULL)
-		return (EAGAIN);
-
 	ni = nfds * sizeof(struct pollfd) + sizeof(struct poll_continue_args);
 	MALLOC(cont, struct poll_continue_args *, ni, M_TEMP, M_WAITOK);
 	if (NULL == cont) {
@@ -1719,6 +1764,24 @@ poll_nocancel(struct proc *p, struct poll_nocancel_args *uap, int32_t *retval)
 		atv.tv_usec = 0;
 	}
 
+	/* a vfork child's descriptors go away with it */
+	cacheable = poll_cache && nfds > 0 && !(ut->uu_flag & UT_VFORK);
+	for (i = 0; cacheable && i < nfds; i++) {
+		if (fds[i].events & ( POLLEXTEND | POLLATTRIB | POLLNLINK | POLLWRITE ))
+			cacheable = FALSE;
+	}
+
+	if (cacheable && poll_cache_match(ut, p, fds, nfds)) {
+		kq = ut->uu_pollkq;
+		cached = TRUE;
+	} else {
+		kq = kqueue_alloc(p, 0);
+		if (kq == NULL) {
+			error = EAGAIN;
+			goto out;
+		}
+	}
+
 	/* JMM - all this P_SELECT stuff is bogus */
 	ncoll = nselcoll;
 	OSBitOrAtomic(P_SELECT, &p->p_flag);
@@ -1728,16 +1791,19 @@ poll_nocancel(struct proc *p, struct poll_nocancel_args *uap, int32_t *retval)
 		__assert_only int rc;
 
 		/* per spec, ignore fd values below zero */
-		if (fds[i].fd < 0) {
+		if (fds[i].fd < 0 || cached) {
 			fds[i].revents = 0;
 			continue;
 		}
 
-		/* convert the poll event into a kqueue kevent */
+		/*
+		 * convert the poll event into a kqueue kevent, udata is the
+		 * index of the entry so that cached knotes stay valid
+		 */
 		struct kevent_internal_s kev = {
 			.ident = fds[i].fd,
-			.flags = EV_ADD | EV_ONESHOT | EV_POLL,
-			.udata = CAST_USER_ADDR_T(&fds[i]) };
+			.flags = EV_ADD | EV_POLL | (cacheable ? 0 : EV_ONESHOT),
+			.udata = i };
 
 		/* Handle input events */
 		if (events & ( POLLIN | POLLRDNORM | POLLPRI | POLLRDBAND | POLLHUP )) {
@@ -1791,6 +1857,22 @@ poll_nocancel(struct proc *p, struct poll_nocancel_args *uap, int32_t *retval)
 	if (nfds && (rfds == nfds))
 		goto done;
 
+	/* keep the set if all of it registered, replacing the previous one */
+	if (cacheable && !cached && rfds == 0) {
+		struct pollfd *set;
+
+		MALLOC(set, struct pollfd *, nfds * sizeof(struct pollfd),
+		    M_TEMP, M_WAITOK);
+		if (set != NULL) {
+			poll_cache_free(ut);
+			bcopy(fds, set, nfds * sizeof(struct pollfd));
+			kqueue_pollcache_begin(kq);
+			ut->uu_pollkq = kq;
+			ut->uu_pollset = set;
+			ut->uu_pollnfds = nfds;
+		}
+	}
+
 	/*
 	 * If any events have trouble registering, an event has fired and we
 	 * shouldn't wait for events in kqueue_scan -- use the current time as
@@ -1822,7 +1904,8 @@ poll_nocancel(struct proc *p, struct poll_nocancel_args *uap, int32_t *retval)
 	if (NULL != cont)
 		FREE(cont, M_TEMP);
 
-	kqueue_dealloc(kq);
+	if (kq != ut->uu_pollkq)
+		kqueue_dealloc(kq);
 	return (error);
 }
 
@@ -1830,7 +1913,7 @@ int
 poll_callback(__unused struct kqueue *kq, struct kevent_internal_s *kevp, void *data)
 {
 	struct poll_continue_args *cont = (struct poll_continue_args *)data;
-	struct pollfd *fds = CAST_DOWN(struct pollfd *, kevp->udata);
+	struct pollfd *fds = (struct pollfd *)&cont[1] + kevp->udata;
 	short prev_revents = fds->revents;
 	short mask = 0;
 
@@ -1949,7 +2032,7 @@ selcount(struct proc *p, u_int32_t *ibits, int nfd, int *countp)
 						error = EBADF;
 						goto bad;
 				}
-				fp->f_iocount++;
+				os_atomic_inc(&fp->f_iocount, relaxed);
 				n++;
 			}
 		}
@@ -2012,6 +2095,7 @@ seldrop_locked(struct proc *p, u_int32_t *ibits, int nfd, int lim, int *need_wak
 	u_int nw;
 	int error = 0;
 	int dropcount = 0;
+	int iocount;
 	uthread_t uth = get_bsdthread_info(current_thread());
 	struct _select_data *seldata;
 
@@ -2060,11 +2144,11 @@ seldrop_locked(struct proc *p, u_int32_t *ibits, int nfd, int lim, int *need_wak
 					continue;
 				}
 
-				fp->f_iocount--;
-				if (fp->f_iocount < 0)
+				iocount = os_atomic_dec(&fp->f_iocount, release);
+				if (iocount < 0)
 					panic("f_iocount overdecrement!");
 
-				if (fp->f_iocount == 0) {
+				if (iocount == 0) {
 					/*
 					 * The last iocount is responsible for clearing
 					 * selconfict flag - even if we didn't set it -
@@ -3701,6 +3785,55 @@ sysctl_waitq_set_nelem SYSCTL_HANDLER_ARGS
 SYSCTL_PROC(_kern, OID_AUTO, n_ltable_entries, CTLFLAG_RD | CTLFLAG_LOCKED,
                 0, 0, sysctl_waitq_set_nelem, "I", "ltable elementis currently used");
 
+static int
+sysctl_waitq_table_stats SYSCTL_HANDLER_ARGS
+{
+#pragma unused(oidp, arg2)
+	char buf[160];
+	int len;
+
+	/* Read only  */
+	if (req->newptr != USER_ADDR_NULL)
+		return (EPERM);
+
+	len = sysctl_helper_waitq_table_stats((int)(uintptr_t)arg1, buf, sizeof(buf));
+	if (len >= (int)sizeof(buf))
+		len = sizeof(buf) - 1;
+
+	return SYSCTL_OUT(req, buf, len + 1);
+}
+
+SYSCTL_PROC(_kern, OID_AUTO, wql_table_stats, CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_LOCKED,
+	(void *)0, 0, sysctl_waitq_table_stats, "A", "waitq link table occupancy and cache hit rate");
+SYSCTL_PROC(_kern, OID_AUTO, wqp_table_stats, CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_LOCKED,
+	(void *)1, 0, sysctl_waitq_table_stats, "A", "waitq prepost table occupancy and cache hit rate");
+
+extern int waitq_lockless_wakeup;
+
+SYSCTL_INT(_kern, OID_AUTO, waitq_lockless_wakeup, CTLFLAG_RW | CTLFLAG_LOCKED,
+	&waitq_lockless_wakeup, 0, "skip wakeups of empty global waitqs without locking them");
+
+static int
+sysctl_waitq_wakeup_test SYSCTL_HANDLER_ARGS
+{
+#pragma unused(oidp, arg1, arg2)
+	int error, iter = 0;
+	uint64_t ns;
+
+	error = SYSCTL_IN(req, &iter, sizeof(iter));
+	if (error)
+		return error;
+	if (iter <= 0 || iter > 10000000)
+		return EINVAL;
+
+	ns = sysctl_helper_waitq_wakeup_test(iter);
+
+	return SYSCTL_OUT(req, &ns, sizeof(ns));
+}
+
+SYSCTL_PROC(_kern, OID_AUTO, waitq_wakeup_test, CTLTYPE_QUAD | CTLFLAG_RW | CTLFLAG_MASKED | CTLFLAG_LOCKED,
+	0, 0, sysctl_waitq_wakeup_test, "Q", "time wakeups of an event nobody waits on (ns)");
+
 
 #endif /* DEVELOPMENT || DEBUG */
 
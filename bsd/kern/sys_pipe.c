@@ -115,6 +115,12 @@
  * Memory usage may be monitored through the sysctls
  * kern.ipc.pipes, kern.ipc.pipekva.
  *
+ * Large blocking writes from user space skip the pipe buffer: the writer's
+ * data is copied-on-write into the kernel map with vm_map_copyin() and
+ * vm_map_copyout(), the reader copies out of that mapping directly, and the
+ * writer waits until it has all been read (PIPE_DIRECTW).  This saves the
+ * copy into the pipe buffer; kern.ipc.pipe_direct turns it off.
+ *
  */
 
 #include <sys/param.h>
@@ -145,6 +151,7 @@
 #include <kern/zalloc.h>
 #include <kern/kalloc.h>
 #include <vm/vm_kern.h>
+#include <vm/vm_map.h>
 #include <libkern/OSAtomic.h>
 #include <libkern/section_keywords.h>
 
@@ -217,6 +224,7 @@ static int amountpipes;   /* total number of pipes in system */
 static int amountpipekva; /* total memory used by pipes */
 
 int maxpipekva __attribute__((used)) = PIPE_KVAMAX;  /* allowing 16MB max. */
+static int pipe_direct = 1; /* hand large writes to the reader, see pipe_direct_write() */
 
 #if PIPE_SYSCTLS
 SYSCTL_DECL(_kern_ipc);
@@ -233,6 +241,8 @@ SYSCTL_INT(_kern_ipc, OID_AUTO, pipekva, CTLFLAG_RD|CTLFLAG_LOCKED,
 	   &amountpipekva, 0, "Pipe KVA usage");
 SYSCTL_INT(_kern_ipc, OID_AUTO, pipekvawired, CTLFLAG_RD|CTLFLAG_LOCKED,
 	   &amountpipekvawired, 0, "Pipe wired KVA usage");
+SYSCTL_INT(_kern_ipc, OID_AUTO, pipe_direct, CTLFLAG_RW|CTLFLAG_LOCKED,
+	   &pipe_direct, 0, "Hand large writes to the reader without buffering");
 #endif
 
 static void pipeclose(struct pipe *cpipe);
@@ -244,6 +254,7 @@ static int expand_pipespace(struct pipe *p, int target_size);
 static void pipeselwakeup(struct pipe *cpipe, struct pipe *spipe);
 static __inline int pipeio_lock(struct pipe *cpipe, int catch);
 static __inline void pipeio_unlock(struct pipe *cpipe);
+static int pipe_direct_write(struct pipe *wpipe, struct uio *uio);
 
 extern int postpipeevent(struct pipe *, int);
 extern void evpipefree(struct pipe *cpipe);
@@ -533,12 +544,16 @@ pipe_stat(struct pipe *cpipe, void *ub, int isstat64)
 		        /* the peer still exists, use it's info */
 		        pipe_size  = MAX_PIPESIZE(cpipe->pipe_peer);
 			pipe_count = cpipe->pipe_peer->pipe_buffer.cnt;
+			if (cpipe->pipe_peer->pipe_state & PIPE_DIRECTW)
+				pipe_count += cpipe->pipe_peer->pipe_map.cnt;
 		} else {
 			pipe_count = 0;
 		}
 	} else {
 	        pipe_size  = MAX_PIPESIZE(cpipe);
 		pipe_count = cpipe->pipe_buffer.cnt;
+		if (cpipe->pipe_state & PIPE_DIRECTW)
+			pipe_count += cpipe->pipe_map.cnt;
 	}
 	/*
 	 * since peer's buffer is setup ouside of lock
@@ -796,6 +811,36 @@ pipe_read(struct fileproc *fp, struct uio *uio, __unused int flags,
 				rpipe->pipe_buffer.out = 0;
 			}
 			nread += size;
+		} else if ((rpipe->pipe_state & PIPE_DIRECTW) &&
+		    rpipe->pipe_map.cnt > 0) {
+			/*
+			 * direct write receive, the writer's data
+			 * stays mapped while we hold the io lock
+			 */
+			size = rpipe->pipe_map.cnt;
+			if (size > (u_int) uio_resid(uio))
+				size = (u_int) uio_resid(uio);
+
+			PIPE_UNLOCK(rpipe); /* we still hold io lock.*/
+			error = uiomove(
+			    (caddr_t)rpipe->pipe_map.kva + rpipe->pipe_map.pos,
+			    size, uio);
+			PIPE_LOCK(rpipe);
+			if (error)
+				break;
+
+			rpipe->pipe_map.pos += size;
+			rpipe->pipe_map.cnt -= size;
+			nread += size;
+
+			/*
+			 * The writer is waiting for all of it to be read.
+			 */
+			if (rpipe->pipe_map.cnt == 0 &&
+			    (rpipe->pipe_state & PIPE_WANTW)) {
+				rpipe->pipe_state &= ~PIPE_WANTW;
+				wakeup(rpipe);
+			}
 		} else {
 			/*
 			 * detect EOF condition
@@ -879,6 +924,101 @@ unlocked_error:
 	return (error);
 }
 
+/*
+ * Hand the data of the current user iovec, up to PIPE_DIRECT_MAX bytes,
+ * to the reader through a copy-on-write mapping in the kernel map, and
+ * wait until it has all been read, the pipe is closed or we are
+ * interrupted.  The uio is advanced by what the reader consumed.
+ *
+ * Called and returns with the pipe mutex held.
+ */
+static int
+pipe_direct_write(struct pipe *wpipe, struct uio *uio)
+{
+	vm_map_copy_t copy;
+	vm_map_address_t kva;
+	vm_size_t size, done;
+	kern_return_t kr;
+	int error;
+
+	if ((error = pipeio_lock(wpipe, 1)) != 0)
+		return (error);
+
+	if (wpipe->pipe_state & (PIPE_DRAIN | PIPE_EOF)) {
+		pipeio_unlock(wpipe);
+		return (EPIPE);
+	}
+	if ((wpipe->pipe_state & PIPE_DIRECTW) || wpipe->pipe_buffer.cnt != 0) {
+		/* another writer got there first, let pipe_write() retry */
+		pipeio_unlock(wpipe);
+		return (0);
+	}
+
+	size = MIN(uio_curriovlen(uio), PIPE_DIRECT_MAX);
+
+	PIPE_UNLOCK(wpipe);
+	kr = vm_map_copyin(current_map(), (vm_map_address_t)uio_curriovbase(uio),
+	    (vm_map_size_t)size, FALSE, &copy);
+	if (kr == KERN_SUCCESS) {
+		kr = vm_map_copyout(kernel_map, &kva, copy);
+		if (kr != KERN_SUCCESS)
+			vm_map_copy_discard(copy);
+	}
+	PIPE_LOCK(wpipe);
+
+	if (kr != KERN_SUCCESS) {
+		pipeio_unlock(wpipe);
+		return (kr == KERN_RESOURCE_SHORTAGE ? ENOMEM : EFAULT);
+	}
+	OSAddAtomic(size, &amountpipekva);
+
+	wpipe->pipe_map.kva = (vm_offset_t)kva;
+	wpipe->pipe_map.size = size;
+	wpipe->pipe_map.cnt = size;
+	wpipe->pipe_map.pos = 0;
+	wpipe->pipe_state |= PIPE_DIRECTW;
+	pipeio_unlock(wpipe);
+
+	if (wpipe->pipe_state & PIPE_WANTR) {
+		wpipe->pipe_state &= ~PIPE_WANTR;
+		wakeup(wpipe);
+	}
+	pipeselwakeup(wpipe, wpipe);
+
+	while (wpipe->pipe_map.cnt > 0 &&
+	    (wpipe->pipe_state & (PIPE_DRAIN | PIPE_EOF)) == 0) {
+		wpipe->pipe_state |= PIPE_WANTW;
+		error = msleep(wpipe, PIPE_MTX(wpipe), PRIBIO | PCATCH, "pipdwt", 0);
+		if (error != 0)
+			break;
+	}
+
+	/* the reader may still be copying out of the mapping */
+	(void)pipeio_lock(wpipe, 0);
+	done = wpipe->pipe_map.size - wpipe->pipe_map.cnt;
+	wpipe->pipe_state &= ~PIPE_DIRECTW;
+	bzero(&wpipe->pipe_map, sizeof(wpipe->pipe_map));
+	pipeio_unlock(wpipe);
+
+	PIPE_UNLOCK(wpipe);
+	kmem_free(kernel_map, vm_map_trunc_page(kva, PAGE_MASK),
+	    vm_map_round_page(kva + size, PAGE_MASK) -
+	    vm_map_trunc_page(kva, PAGE_MASK));
+	PIPE_LOCK(wpipe);
+	OSAddAtomic(-(int)size, &amountpipekva);
+
+	/* wake up the writers waiting for the direct write to be read */
+	if (wpipe->pipe_state & PIPE_WANTW) {
+		wpipe->pipe_state &= ~PIPE_WANTW;
+		wakeup(wpipe);
+	}
+
+	uio_update(uio, done);
+	if (error == 0 && done < size)
+		error = EPIPE;
+	return (error);
+}
+
 /*
  * perform a write of n bytes into the read side of buffer. Since 
  * pipes are unidirectional a write is meant to be read by the otherside only.
@@ -966,6 +1106,37 @@ pipe_write(struct fileproc *fp, struct uio *uio, __unused int flags,
 
 	while (uio_resid(uio)) {
 
+		/*
+		 * Wait for a direct write in progress to be read, the
+		 * pipe buffer must not get ahead of it.
+		 */
+		if (wpipe->pipe_state & PIPE_DIRECTW) {
+			if (fp->f_flag & FNONBLOCK) {
+				error = EAGAIN;
+				break;
+			}
+			wpipe->pipe_state |= PIPE_WANTW;
+			error = msleep(wpipe, PIPE_MTX(wpipe), PRIBIO | PCATCH, "pipdww", 0);
+			if (error != 0)
+				break;
+			if (wpipe->pipe_state & (PIPE_DRAIN | PIPE_EOF)) {
+				error = EPIPE;
+				break;
+			}
+			continue;
+		}
+
+		if (pipe_direct && (fp->f_flag & FNONBLOCK) == 0 &&
+		    wpipe->pipe_buffer.cnt == 0 &&
+		    UIO_SEG_IS_USER_SPACE(uio->uio_segflg) &&
+		    uio_curriovlen(uio) >= PIPE_DIRECT_MIN &&
+		    amountpipekva + PIPE_DIRECT_MAX <= maxpipekva) {
+			error = pipe_direct_write(wpipe, uio);
+			if (error)
+				break;
+			continue;
+		}
+
 	retrywrite:
 		space = wpipe->pipe_buffer.size - wpipe->pipe_buffer.cnt;
 
@@ -984,6 +1155,14 @@ pipe_write(struct fileproc *fp, struct uio *uio, __unused int flags,
 				        error = EPIPE;
 					break;
 				}
+				/*
+				 * A direct write started while we were
+				 * blocked in pipeio_lock, wait for it.
+				 */
+				if (wpipe->pipe_state & PIPE_DIRECTW) {
+					pipeio_unlock(wpipe);
+					continue;
+				}
 				/* 
 				 * If a process blocked in pipeio_lock, our
 				 * value for space might be bad... the mutex
@@ -1179,6 +1358,8 @@ pipe_ioctl(struct fileproc *fp, u_long cmd, caddr_t data,
 
 	case FIONREAD:
 		*(int *)data = mpipe->pipe_buffer.cnt;
+		if (mpipe->pipe_state & PIPE_DIRECTW)
+			*(int *)data += mpipe->pipe_map.cnt;
 		PIPE_UNLOCK(mpipe);
 		return (0);
 
@@ -1394,6 +1575,8 @@ filt_piperead_common(struct knote *kn, struct pipe *rpipe)
 
 	wpipe = rpipe->pipe_peer;
 	kn->kn_data = rpipe->pipe_buffer.cnt;
+	if (rpipe->pipe_state & PIPE_DIRECTW)
+		kn->kn_data += rpipe->pipe_map.cnt;
 	if ((rpipe->pipe_state & (PIPE_DRAIN | PIPE_EOF)) ||
 	    (wpipe == NULL) || (wpipe->pipe_state & (PIPE_DRAIN | PIPE_EOF))) {
 		kn->kn_flags |= EV_EOF;
@@ -1478,7 +1661,10 @@ filt_pipewrite_common(struct knote *kn, struct pipe *rpipe)
 		kn->kn_flags |= EV_EOF; 
 		return (1);
 	}
-	kn->kn_data = MAX_PIPESIZE(wpipe) - wpipe->pipe_buffer.cnt;
+	if (wpipe->pipe_state & PIPE_DIRECTW)
+		kn->kn_data = 0;
+	else
+		kn->kn_data = MAX_PIPESIZE(wpipe) - wpipe->pipe_buffer.cnt;
 
 	int64_t lowwat = PIPE_BUF;
 	if (kn->kn_sfflags & NOTE_LOWAT) {
@@ -1659,12 +1845,16 @@ fill_pipeinfo(struct pipe * cpipe, struct pipe_info * pinfo)
 			 */
 		        pipe_size  = MAX_PIPESIZE(cpipe->pipe_peer);
 			pipe_count = cpipe->pipe_peer->pipe_buffer.cnt;
+			if (cpipe->pipe_peer->pipe_state & PIPE_DIRECTW)
+				pipe_count += cpipe->pipe_peer->pipe_map.cnt;
 		} else {
 			pipe_count = 0;
 		}
 	} else {
 	        pipe_size  = MAX_PIPESIZE(cpipe);
 		pipe_count = cpipe->pipe_buffer.cnt;
+		if (cpipe->pipe_state & PIPE_DIRECTW)
+			pipe_count += cpipe->pipe_map.cnt;
 	}
 	/*
 	 * since peer's buffer is setup ouside of lock
@@ -58,6 +58,7 @@
 #include <kern/debug.h>
 
 #include <pexpert/pexpert.h>
+#include <machine/machine_routines.h>
 
 #define XNU_TEST_BITMAP
 #include <kern/bits.h>
@@ -85,6 +86,22 @@
  * ownership/priority boost to the new thread.  Instead, it selects the
  * waiting thread with the highest base priority to be woken next, and
  * relies on that thread to carry the torch for the other waiting threads.
+ *
+ * How ulock requeue works:
+ *
+ * The wait queues can't move a blocked thread from one event to another, so
+ * ULF_WAKE_REQUEUE instead links the woken ulock (the condition) to the
+ * ulock its waiters want next (the mutex).  The mutex ulock remembers the key
+ * of the condition and how many of its waiters have been deferred; every
+ * time the mutex is woken without having waiters of its own, one deferred
+ * waiter of the condition is released instead.  Both ulocks only refer to
+ * each other by key, never by pointer, so a stale link at worst causes a
+ * spurious wakeup, which ulock users must tolerate anyway.
+ *
+ * The link holds a reference on the mutex ulock and keeps it in the hash
+ * until it is torn down, which happens when the pending count drains, when
+ * the condition turns out to have no waiters left, or when the last waiter
+ * of the condition goes away.
  */
 
 static lck_grp_t *ull_lck_grp;
@@ -128,6 +145,9 @@ typedef struct ull {
 	uint8_t		ull_opcode;
 	struct turnstile *ull_turnstile;
 	queue_chain_t	ull_hash_link;
+	ulk_t		ull_requeue_src;	/* condition whose deferred waiters we release */
+	ulk_t		ull_requeue_dst;	/* mutex our deferred waiters are waiting for */
+	int32_t		ull_requeue_pending;	/* deferred waiters left on ull_requeue_src */
 } ull_t;
 
 extern void ulock_initialize(void);
@@ -135,6 +155,7 @@ extern void ulock_initialize(void);
 #define ULL_MUST_EXIST	0x0001
 static ull_t *ull_get(ulk_t *, uint32_t, ull_t **);
 static void ull_put(ull_t *);
+static void ull_requeue_cancel(ulk_t *, ulk_t *);
 
 #if DEVELOPMENT || DEBUG
 static int ull_simulate_copyin_fault = 0;
@@ -151,6 +172,9 @@ ull_dump(ull_t *ull)
 	kprintf("ull_max_nwaiters\t%d\n", ull->ull_max_nwaiters);
 	kprintf("ull_refcount\t%d\n", ull->ull_refcount);
 	kprintf("ull_opcode\t%d\n\n", ull->ull_opcode);
+	kprintf("ull_requeue_src.ulk_addr\t%p\n", (void *)(ull->ull_requeue_src.ulk_addr));
+	kprintf("ull_requeue_dst.ulk_addr\t%p\n", (void *)(ull->ull_requeue_dst.ulk_addr));
+	kprintf("ull_requeue_pending\t%d\n", ull->ull_requeue_pending);
 	kprintf("ull_owner\t0x%llx\n\n", thread_tid(ull->ull_owner));
 	kprintf("ull_turnstile\t%p\n\n", ull->ull_turnstile);
 }
@@ -187,19 +211,29 @@ static_assert(sizeof(ulk_t) == sizeof(user_addr_t) + sizeof(pid_t));
 
 #define ULL_INDEX(keyp)	ull_hash_index((char *)keyp, sizeof *keyp)
 
+/* keep the chains short when many cores contend on unrelated ulocks */
+#define ULL_BUCKETS_PER_CPU	256
+#define ULL_BUCKETS_MAX		(1 << 20)
+
 void
 ulock_initialize(void)
 {
+	uint32_t buckets;
+
 	ull_lck_grp = lck_grp_alloc_init("ulocks", NULL);
 
 	assert(thread_max > 16);
-	/* Size ull_hash_buckets based on thread_max.
-	 * Round up to nearest power of 2, then divide by 4
+	/* Size ull_hash_buckets based on thread_max, maxproc and the number
+	 * of cpus, then round up to the nearest power of 2.
+	 * Can be overridden with the ulock_hash_buckets boot-arg.
 	 */
-	ull_hash_buckets = (1 << (bit_ceiling(thread_max) - 2));
+	buckets = MAX((uint32_t)thread_max / 4, (uint32_t)maxproc);
+	buckets = MAX(buckets, (uint32_t)ml_get_max_cpus() * ULL_BUCKETS_PER_CPU);
+	PE_parse_boot_argn("ulock_hash_buckets", &buckets, sizeof(buckets));
+	buckets = MIN(MAX(buckets, 16), ULL_BUCKETS_MAX);
+	ull_hash_buckets = (1 << bit_ceiling(buckets));
 
 	kprintf("%s>thread_max=%d, ull_hash_buckets=%d\n", __FUNCTION__, thread_max, ull_hash_buckets);
-	assert(ull_hash_buckets >= thread_max/4);
 
 	ull_bucket = (ull_bucket_t *)kalloc(sizeof(ull_bucket_t) * ull_hash_buckets);
 	assert(ull_bucket != NULL);
@@ -269,6 +303,12 @@ ull_alloc(ulk_t *key)
 	ull->ull_owner = THREAD_NULL;
 	ull->ull_turnstile = TURNSTILE_NULL;
 
+	ull->ull_requeue_src.ulk_pid = 0;
+	ull->ull_requeue_src.ulk_addr = 0;
+	ull->ull_requeue_dst.ulk_pid = 0;
+	ull->ull_requeue_dst.ulk_addr = 0;
+	ull->ull_requeue_pending = 0;
+
 	ull_lock_init(ull);
 
 	ull_nzalloc++;
@@ -364,6 +404,149 @@ ull_put(ull_t *ull)
 	ull_free(ull);
 }
 
+/*
+ * Tear down the requeue link of a mutex ulock.
+ * Must be called with ull_lock held, and a reference other than
+ * the one held by the link.
+ */
+static void
+ull_requeue_unlink_locked(ull_t *ull)
+{
+	ull_assert_owned(ull);
+	assert(ull->ull_requeue_src.ulk_addr != 0);
+
+	ull->ull_requeue_src.ulk_pid = 0;
+	ull->ull_requeue_src.ulk_addr = 0;
+	ull->ull_requeue_pending = 0;
+
+	if (ull->ull_nwaiters == 0) {
+		/* the last waiter left the key in place for us */
+		ull->ull_key.ulk_pid = 0;
+		ull->ull_key.ulk_addr = 0;
+		ull->ull_refcount--;
+	}
+
+	/* drop the reference held by the link */
+	ull->ull_refcount--;
+	assert(ull->ull_refcount > 0);
+}
+
+/*
+ * Link the mutex ulock 'dst' to the condition ulock 'src', creating 'dst'
+ * if needed.  Returns false if 'dst' can't take deferred waiters, because
+ * it isn't a UL_COMPARE_AND_WAIT ulock or already serves another condition.
+ */
+static bool
+ull_requeue_link(ulk_t *dst, ulk_t *src)
+{
+	ull_t *unused_ull = NULL;
+	bool linked = false;
+
+	ull_t *ull = ull_get(dst, 0, &unused_ull);
+	if (ull == NULL) {
+		return false;
+	}
+	/* ull is locked */
+
+	if (ull->ull_opcode == 0) {
+		ull->ull_opcode = UL_COMPARE_AND_WAIT;
+	}
+
+	if (ull->ull_opcode == UL_COMPARE_AND_WAIT) {
+		if (ull->ull_requeue_src.ulk_addr == 0) {
+			ull->ull_requeue_src = *src;
+			ull->ull_requeue_pending = 0;
+			ull->ull_refcount++; /* held by the link */
+			linked = true;
+		} else if (ull_key_match(&ull->ull_requeue_src, src)) {
+			linked = true;
+		}
+	}
+
+	ull_put(ull);
+
+	if (unused_ull) {
+		ull_free(unused_ull);
+	}
+
+	return linked;
+}
+
+/*
+ * Account for 'deferred' more waiters of 'src' on the mutex ulock 'dst'
+ * after ull_requeue_link() succeeded, or tear the link down if there
+ * is nothing to release.
+ */
+static void
+ull_requeue_commit(ulk_t *dst, ulk_t *src, int32_t deferred)
+{
+	ull_t *ull = ull_get(dst, ULL_MUST_EXIST, NULL);
+	if (ull == NULL) {
+		return;
+	}
+	/* ull is locked */
+
+	if (ull_key_match(&ull->ull_requeue_src, src)) {
+		ull->ull_requeue_pending += deferred;
+		if (ull->ull_requeue_pending == 0) {
+			ull_requeue_unlink_locked(ull);
+		}
+	}
+
+	ull_put(ull);
+}
+
+/*
+ * Tear down the link from the mutex ulock 'dst' to 'src', if it's still there.
+ */
+static void
+ull_requeue_cancel(ulk_t *dst, ulk_t *src)
+{
+	ull_t *ull = ull_get(dst, ULL_MUST_EXIST, NULL);
+	if (ull == NULL) {
+		return;
+	}
+	/* ull is locked */
+
+	if (ull_key_match(&ull->ull_requeue_src, src)) {
+		ull_requeue_unlink_locked(ull);
+	}
+
+	ull_put(ull);
+}
+
+/*
+ * Release one deferred waiter of the condition ulock 'src'.
+ * Returns false if there was nobody left to wake up.
+ */
+static bool
+ull_requeue_wake_one(ulk_t *src)
+{
+	kern_return_t kr = KERN_NOT_WAITING;
+	struct turnstile *ts;
+
+	ull_t *ull = ull_get(src, ULL_MUST_EXIST, NULL);
+	if (ull == NULL) {
+		return false;
+	}
+	/* ull is locked */
+
+	if (ull->ull_opcode == UL_COMPARE_AND_WAIT) {
+		ts = turnstile_prepare((uintptr_t)ull, &ull->ull_turnstile,
+		                       TURNSTILE_NULL, TURNSTILE_ULOCK);
+		kr = waitq_wakeup64_one(&ts->ts_waitq, CAST_EVENT64_T(ULOCK_TO_EVENT(ull)),
+			THREAD_AWAKENED, WAITQ_SELECT_MAX_PRI);
+		turnstile_complete((uintptr_t)ull, &ull->ull_turnstile, NULL);
+	}
+
+	ull_put(ull);
+
+	/* Need to be called after dropping the interlock */
+	turnstile_cleanup();
+
+	return kr == KERN_SUCCESS;
+}
+
 static void ulock_wait_continue(void *, wait_result_t);
 static void ulock_wait_cleanup(ull_t *, thread_t, thread_t, int32_t *);
 
@@ -612,6 +795,8 @@ ulock_wait_cleanup(ull_t *ull, thread_t owner_thread, thread_t old_owner, int32_
 	ull_assert_owned(ull);
 
 	thread_t old_lingering_owner = THREAD_NULL;
+	ulk_t requeue_dst = { .ulk_pid = 0, .ulk_addr = 0 };
+	ulk_t requeue_src = { .ulk_pid = 0, .ulk_addr = 0 };
 
 	*retval = --ull->ull_nwaiters;
 	if (ull->ull_nwaiters == 0) {
@@ -623,16 +808,31 @@ ulock_wait_cleanup(ull_t *ull, thread_t owner_thread, thread_t old_owner, int32_
 		old_lingering_owner = ull->ull_owner;
 		ull->ull_owner = THREAD_NULL;
 
-		ull->ull_key.ulk_pid = 0;
-		ull->ull_key.ulk_addr = 0;
-		ull->ull_refcount--;
-		assert(ull->ull_refcount > 0);
+		/* Nobody is left to be deferred onto our mutex */
+		if (ull->ull_requeue_dst.ulk_addr != 0) {
+			requeue_dst = ull->ull_requeue_dst;
+			requeue_src = ull->ull_key;
+			ull->ull_requeue_dst.ulk_pid = 0;
+			ull->ull_requeue_dst.ulk_addr = 0;
+		}
+
+		/* A requeue link keeps us in the hash, it will clear the key */
+		if (ull->ull_requeue_src.ulk_addr == 0) {
+			ull->ull_key.ulk_pid = 0;
+			ull->ull_key.ulk_addr = 0;
+			ull->ull_refcount--;
+			assert(ull->ull_refcount > 0);
+		}
 	}
 	ull_put(ull);
 
 	/* Need to be called after dropping the interlock */
 	turnstile_cleanup();
 
+	if (requeue_dst.ulk_addr != 0) {
+		ull_requeue_cancel(&requeue_dst, &requeue_src);
+	}
+
 	if (owner_thread != THREAD_NULL) {
 		thread_deallocate(owner_thread);
 	}
@@ -689,6 +889,13 @@ ulock_wake(struct proc *p, struct ulock_wake_args *args, __unused int32_t *retva
 	thread_t wake_thread    = THREAD_NULL;
 	thread_t old_owner      = THREAD_NULL;
 
+	/* requeue state, see "How ulock requeue works" */
+	ulk_t requeue_dst = { .ulk_pid = 0, .ulk_addr = 0 };
+	ulk_t requeue_src = { .ulk_pid = 0, .ulk_addr = 0 };
+	bool requeue = false;
+	int32_t requeue_deferred = 0;
+	kern_return_t wake_kr = KERN_NOT_WAITING;
+
 	if ((flags & ULF_WAKE_MASK) != flags) {
 		ret = EINVAL;
 		goto munge_retval;
@@ -728,11 +935,34 @@ ulock_wake(struct proc *p, struct ulock_wake_args *args, __unused int32_t *retva
 	key.ulk_pid = p->p_pid;
 	key.ulk_addr = args->addr;
 
+	if (flags & ULF_WAKE_REQUEUE) {
+		if ((flags & (ULF_WAKE_ALL | ULF_WAKE_THREAD)) ||
+		    opcode != UL_COMPARE_AND_WAIT ||
+		    args->wake_value == 0 || args->wake_value == args->addr ||
+		    (args->wake_value % _Alignof(_Atomic(uint32_t)))) {
+			ret = EINVAL;
+			goto munge_retval;
+		}
+
+		requeue_dst.ulk_pid = p->p_pid;
+		requeue_dst.ulk_addr = (user_addr_t)args->wake_value;
+
+		/* Must not hold the condition's ull lock while linking */
+		requeue = ull_requeue_link(&requeue_dst, &key);
+		if (!requeue) {
+			/* Can't defer anyone, fall back to a broadcast */
+			flags |= ULF_WAKE_ALL;
+		}
+	}
+
 	ull_t *ull = ull_get(&key, ULL_MUST_EXIST, NULL);
 	if (ull == NULL) {
 		if (wake_thread != THREAD_NULL) {
 			thread_deallocate(wake_thread);
 		}
+		if (requeue) {
+			ull_requeue_commit(&requeue_dst, &key, 0);
+		}
 		ret = ENOENT;
 		goto munge_retval;
 	}
@@ -765,7 +995,7 @@ ulock_wake(struct proc *p, struct ulock_wake_args *args, __unused int32_t *retva
 	                       TURNSTILE_NULL, TURNSTILE_ULOCK);
 
 	if (flags & ULF_WAKE_ALL) {
-		waitq_wakeup64_all(&ts->ts_waitq, CAST_EVENT64_T(ULOCK_TO_EVENT(ull)),
+		wake_kr = waitq_wakeup64_all(&ts->ts_waitq, CAST_EVENT64_T(ULOCK_TO_EVENT(ull)),
 			THREAD_AWAKENED, 0);
 	} else if (flags & ULF_WAKE_THREAD) {
 		kern_return_t kr = waitq_wakeup64_thread(&ts->ts_waitq, CAST_EVENT64_T(ULOCK_TO_EVENT(ull)),
@@ -782,10 +1012,30 @@ ulock_wake(struct proc *p, struct ulock_wake_args *args, __unused int32_t *retva
 		 * TODO: 'owner is not current_thread (or null)' likely means we can avoid this wakeup
 		 * <rdar://problem/25487001>
 		 */
-		waitq_wakeup64_one(&ts->ts_waitq, CAST_EVENT64_T(ULOCK_TO_EVENT(ull)),
+		wake_kr = waitq_wakeup64_one(&ts->ts_waitq, CAST_EVENT64_T(ULOCK_TO_EVENT(ull)),
 			THREAD_AWAKENED, WAITQ_SELECT_MAX_PRI);
 	}
 
+	if (requeue) {
+		/*
+		 * Everybody else waits for the mutex, ulock_wait_cleanup() undoes
+		 * the link if they all go away before that.
+		 */
+		requeue_deferred = ull->ull_nwaiters - (wake_kr == KERN_SUCCESS ? 1 : 0);
+		if (requeue_deferred > 0) {
+			ull->ull_requeue_dst = requeue_dst;
+		} else {
+			requeue_deferred = 0;
+		}
+	} else if (wake_kr != KERN_SUCCESS && !(flags & ULF_WAKE_THREAD) &&
+	    ull->ull_requeue_pending > 0) {
+		/* No waiters of our own: release a waiter deferred onto us instead */
+		requeue_src = ull->ull_requeue_src;
+		if (--ull->ull_requeue_pending == 0) {
+			ull_requeue_unlink_locked(ull);
+		}
+	}
+
 	/*
 	 * Reaching this point means I previously moved the lock to 'unowned' state in userspace.
 	 * Therefore I need to relinquish my promotion.
@@ -812,6 +1062,15 @@ out_locked:
 	/* Need to be called after dropping the interlock */
 	turnstile_cleanup();
 
+	if (requeue) {
+		ull_requeue_commit(&requeue_dst, &key, requeue_deferred);
+	} else if (requeue_src.ulk_addr != 0) {
+		if (!ull_requeue_wake_one(&requeue_src)) {
+			/* The condition ran out of waiters, stop deferring to it */
+			ull_requeue_cancel(&key, &requeue_src);
+		}
+	}
+
 	if (wake_thread != THREAD_NULL) {
 		thread_deallocate(wake_thread);
 	}
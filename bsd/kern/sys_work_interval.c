@@ -49,6 +49,8 @@ work_interval_ctl(__unused proc_t p, struct work_interval_ctl_args *uap,
 
 	struct work_interval_create_params create_params;
 	struct kern_work_interval_create_args create_args;
+	struct work_interval_budget budget;
+	uint64_t overruns;
 
 	switch (operation) {
 		case WORK_INTERVAL_OPERATION_CREATE:
@@ -157,6 +159,45 @@ work_interval_ctl(__unused proc_t p, struct work_interval_ctl_args *uap,
 				return EINVAL;
 
 			break;
+		case WORK_INTERVAL_OPERATION_SET_BUDGET:
+			if (uap->arg == USER_ADDR_NULL || uap->work_interval_id == 0)
+				return EINVAL;
+
+			if (uap->len < sizeof(budget))
+				return EINVAL;
+
+			/*
+			 * No privilege check, only the creator of the work interval,
+			 * which needed the privilege, may set its budget.
+			 */
+			if ((error = copyin(uap->arg, &budget, sizeof(budget))))
+				return error;
+
+			kret = kern_work_interval_set_budget(current_thread(), uap->work_interval_id,
+			                                     budget.wib_period, budget.wib_budget);
+
+			/* admission control turned the budget down */
+			if (kret == KERN_RESOURCE_SHORTAGE)
+				return EBUSY;
+
+			if (kret != KERN_SUCCESS)
+				return EINVAL;
+
+			break;
+		case WORK_INTERVAL_OPERATION_GET_OVERRUNS:
+			if (uap->arg == USER_ADDR_NULL || uap->work_interval_id == 0)
+				return EINVAL;
+
+			if (uap->len < sizeof(overruns))
+				return EINVAL;
+
+			kret = kern_work_interval_get_overruns(current_thread(), uap->work_interval_id,
+			                                       &overruns);
+			if (kret != KERN_SUCCESS)
+				return EINVAL;
+
+			error = copyout(&overruns, uap->arg, sizeof(overruns));
+			break;
 
 		default:
 			return ENOTSUP;
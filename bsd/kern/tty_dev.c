@@ -621,7 +621,7 @@ ptcread(dev_t dev, struct uio *uio, int flag)
 {
 	struct ptmx_ioctl *pti = pty_get_ioctl(dev, 0, NULL);
 	struct tty *tp;
-	char buf[BUFSIZ];
+	user_ssize_t resid;
 	int error = 0, cc;
 
 	if (pti == NULL)
@@ -672,11 +672,17 @@ ptcread(dev_t dev, struct uio *uio, int flag)
 	}
 	if (pti->pt_flags & (PF_PKT|PF_UCNTL))
 		error = ureadc(0, uio);
-	while (uio_resid(uio) > 0 && error == 0) {
-		cc = q_to_b(&tp->t_outq, (u_char *)buf, MIN((int)uio_resid(uio), BUFSIZ));
+	/*
+	 * Copy out of the output queue in place, one contiguous run of
+	 * the ring at a time, and only drop what actually got copied.
+	 */
+	while ((resid = uio_resid(uio)) > 0 && error == 0) {
+		cc = ndqb(&tp->t_outq, 0);
 		if (cc <= 0)
 			break;
-		error = uiomove(buf, cc, uio);
+		cc = (int)MIN(resid, cc);
+		error = uiomove((caddr_t)tp->t_outq.c_cf, cc, uio);
+		ndflush(&tp->t_outq, (int)(resid - uio_resid(uio)));
 	}
 	(*linesw[tp->t_line].l_start)(tp);
 
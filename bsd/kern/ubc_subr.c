@@ -65,6 +65,7 @@
 #include <kern/kalloc.h>
 #include <kern/zalloc.h>
 #include <kern/thread.h>
+#include <kern/clock.h>
 #include <vm/pmap.h>
 #include <vm/vm_kern.h>
 #include <vm/vm_protos.h> /* last */
@@ -3869,6 +3870,11 @@ ubc_get_cs_mtime(
 
 unsigned long cs_validate_page_no_hash = 0;
 unsigned long cs_validate_page_bad_hash = 0;
+/* what validating pages costs, e.g. during an app launch */
+static uint64_t cs_validate_hash_count = 0;
+static uint64_t cs_validate_hash_time = 0;	/* mach absolute time units */
+SYSCTL_QUAD(_vm, OID_AUTO, cs_validate_hash_count, CTLFLAG_RD | CTLFLAG_LOCKED, &cs_validate_hash_count, "Number of code signing hash pages hashed");
+SYSCTL_QUAD(_vm, OID_AUTO, cs_validate_hash_time, CTLFLAG_RD | CTLFLAG_LOCKED, &cs_validate_hash_time, "Mach time spent hashing code signing hash pages");
 static boolean_t
 cs_validate_hash(
 	struct cs_blob		*blobs,
@@ -3960,6 +3966,7 @@ cs_validate_hash(
 		validated = FALSE;
 		*tainted = 0;
 	} else {
+		uint64_t hash_start = mach_absolute_time();
 
 		*tainted = 0;
 
@@ -3998,6 +4005,9 @@ cs_validate_hash(
 		}
 		hashtype->cs_final(actual_hash, &mdctx);
 
+		cs_validate_hash_count++;
+		cs_validate_hash_time += mach_absolute_time() - hash_start;
+
 		asha1 = (const uint32_t *) actual_hash;
 		esha1 = (const uint32_t *) expected_hash;
 
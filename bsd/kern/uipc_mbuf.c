@@ -651,8 +651,20 @@ typedef struct {
 #define	m_ctotal(c)	mbuf_table[c].mtbl_stats->mbcl_ctotal
 #define	m_peak(c)	mbuf_table[c].mtbl_stats->mbcl_peak_reported
 #define	m_release_cnt(c) mbuf_table[c].mtbl_stats->mbcl_release_cnt
+#define	m_slab_contention(c) mbuf_table[c].mtbl_stats->mbcl_slab_contention
 #define	m_region_expand(c)	mbuf_table[c].mtbl_expand
 
+/*
+ * Acquire mbuf_mlock on behalf of the slab layer of class c, counting
+ * the times it was found to be held by someone else.
+ */
+#define	MBUF_SLAB_LOCK(c) do {						\
+	if (!lck_mtx_try_lock(mbuf_mlock)) {				\
+		lck_mtx_lock(mbuf_mlock);				\
+		m_slab_contention(c)++;					\
+	}								\
+} while (0)
+
 static mbuf_table_t mbuf_table[] = {
 	/*
 	 * The caches for mbufs, regular clusters and big clusters.
@@ -1130,6 +1142,8 @@ mbuf_stat_sync(void)
 		sp->mbcl_mc_waiter_cnt = cp->mc_waiter_cnt;
 		sp->mbcl_mc_wretry_cnt = cp->mc_wretry_cnt;
 		sp->mbcl_mc_nwretry_cnt = cp->mc_nwretry_cnt;
+		sp->mbcl_mc_bkt_contention = cp->mc_bkt_contention;
+		sp->mbcl_mc_batch_cnt = cp->mc_batch_cnt;
 
 		/* Calculate total count specific to each class */
 		sp->mbcl_ctotal = sp->mbcl_total;
@@ -1719,6 +1733,13 @@ mbinit(void)
 			freefunc = mbuf_slab_free;
 			auditfunc = mbuf_slab_audit;
 			logfunc = mleak_logger;
+			/*
+			 * Refill the CPU layer of the rudimentary classes
+			 * a bucket at a time, such that a stream of single
+			 * allocations doesn't take mbuf_mlock every time
+			 * the bucket layer runs dry.
+			 */
+			flags |= MCF_BATCHREFILL;
 		}
 
 		/*
@@ -2174,7 +2195,7 @@ mbuf_slab_alloc(void *arg, mcache_obj_t ***plist, unsigned int num, int wait)
 	ASSERT(MBUF_CLASS_VALID(class) && !MBUF_CLASS_COMPOSITE(class));
 	ASSERT(need > 0);
 
-	lck_mtx_lock(mbuf_mlock);
+	MBUF_SLAB_LOCK(class);
 
 	for (;;) {
 		if ((*list = slab_alloc(class, wait)) != NULL) {
@@ -2198,6 +2219,13 @@ mbuf_slab_alloc(void *arg, mcache_obj_t ***plist, unsigned int num, int wait)
 		} else {
 			VERIFY(m_infree(class) == 0 || class == MC_CL);
 
+			/*
+			 * The extra objects asked for by a batched refill
+			 * of the CPU layer only come from the freelist.
+			 */
+			if ((wait & MCR_BATCH) && need < num)
+				break;
+
 			(void) freelist_populate(class, 1,
 			    (wait & MCR_NOSLEEP) ? M_DONTWAIT : M_WAIT);
 
@@ -2256,7 +2284,7 @@ mbuf_slab_free(void *arg, mcache_obj_t *list, __unused int purged)
 
 	ASSERT(MBUF_CLASS_VALID(class) && !MBUF_CLASS_COMPOSITE(class));
 
-	lck_mtx_lock(mbuf_mlock);
+	MBUF_SLAB_LOCK(class);
 
 	for (;;) {
 		nlist = list->obj_next;
@@ -2585,7 +2613,7 @@ mbuf_cslab_alloc(void *arg, mcache_obj_t ***plist, unsigned int needed,
 	    m_slablist(class).tqh_first == NULL &&
 	    m_slablist(class).tqh_last == NULL);
 
-	lck_mtx_lock(mbuf_mlock);
+	MBUF_SLAB_LOCK(class);
 
 	/* Try using the freelist first */
 	num = cslab_alloc(class, plist, needed);
@@ -2765,7 +2793,7 @@ mbuf_cslab_free(void *arg, mcache_obj_t *list, int purged)
 
 	ASSERT(MBUF_CLASS_VALID(class) && MBUF_CLASS_COMPOSITE(class));
 
-	lck_mtx_lock(mbuf_mlock);
+	MBUF_SLAB_LOCK(class);
 
 	num = cslab_free(class, list, purged);
 	m_free_cnt(class) += num;
@@ -4105,6 +4133,7 @@ m_classifier_init(struct mbuf *m, uint32_t pktf_mask)
 	m->m_pkthdr.pkt_proto = 0;
 	m->m_pkthdr.pkt_flowsrc = 0;
 	m->m_pkthdr.pkt_flowid = 0;
+	m->m_pkthdr.pkt_txtime = 0;
 	m->m_pkthdr.pkt_flags &= pktf_mask;	/* caller-defined mask */
 	/* preserve service class and interface info for loopback packets */
 	if (!(m->m_pkthdr.pkt_flags & PKTF_LOOP))
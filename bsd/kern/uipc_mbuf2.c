@@ -947,3 +947,49 @@ m_sum16(struct mbuf *m, uint32_t off, uint32_t len)
 
 	return (os_cpu_in_cksum_mbuf(m, len, off, 0));
 }
+
+/*
+ * Copy len bytes starting off bytes into the chain to the buffer at vp,
+ * like m_copydata(), and return the 16-bit 1's complement sum of the
+ * copied data; the sum is computed while copying, sparing the caller a
+ * second pass over the data.
+ */
+uint16_t
+m_copydata_sum(struct mbuf *m, uint32_t off, uint32_t len, void *vp)
+{
+	uint8_t *cp = vp;
+	uint32_t count, done = 0, psum;
+	uint64_t sum = 0;
+	int mlen;
+
+	if ((mlen = m_length2(m, NULL)) < (off + len)) {
+		panic("%s: mbuf %p len (%d) < off+len (%d+%d)\n", __func__,
+		    m, mlen, off, len);
+		/* NOTREACHED */
+	}
+
+	while (len > 0 && off >= (uint32_t)m->m_len) {
+		off -= m->m_len;
+		m = m->m_next;
+	}
+	for (; len > 0; m = m->m_next, off = 0) {
+		count = MIN(m->m_len - off, len);
+		psum = os_cpu_copy_in_cksum(mtod(m, uint8_t *) + off, cp,
+		    count, 0);
+		/* a span starting at an odd offset is summed byte swapped */
+		if (done & 1)
+			psum = ((psum << 8) | (psum >> 8)) & 0xffff;
+		sum += psum;
+		done += count;
+		cp += count;
+		len -= count;
+	}
+
+	/* fold 64-bit to 16-bit */
+	sum = (sum >> 32) + (sum & 0xffffffff);	/* 33-bit */
+	sum = (sum >> 16) + (sum & 0xffff);	/* 17-bit + carry */
+	sum = (sum >> 16) + (sum & 0xffff);	/* 16-bit + carry */
+	sum = (sum >> 16) + (sum & 0xffff);	/* final carry */
+
+	return (sum & 0xffff);
+}
@@ -100,9 +100,16 @@
 #include <net/route.h>
 #include <netinet/in_pcb.h>
 
-#if CONFIG_MACF_SOCKET_SUBSET
+#if CONFIG_MACF_SOCKET_SUBSET || CONFIG_MACF
 #include <security/mac_framework.h>
-#endif /* MAC_SOCKET_SUBSET */
+#endif /* MAC_SOCKET_SUBSET || CONFIG_MACF */
+
+#if SENDFILE
+#include <sys/ubc_internal.h>
+#include <kern/thread_call.h>
+#include <vm/vm_map.h>
+#include <vm/vm_kern.h>
+#endif /* SENDFILE */
 
 #define	f_flag f_fglob->fg_flag
 #define	f_type f_fglob->fg_ops->fo_type
@@ -184,6 +191,10 @@ SYSCTL_UINT(_kern_ipc, OID_AUTO, maxsendmsgx,
 static u_int somaxrecvmsgx = 100;
 SYSCTL_UINT(_kern_ipc, OID_AUTO, maxrecvmsgx,
 	CTLFLAG_RW | CTLFLAG_LOCKED, &somaxrecvmsgx, 0, "");
+/* hand whole batches to the protocols that take packet lists */
+static u_int somsgxlist = 1;
+SYSCTL_UINT(_kern_ipc, OID_AUTO, msgx_use_list,
+	CTLFLAG_RW | CTLFLAG_LOCKED, &somsgxlist, 0, "");
 
 /*
  * System call interface to the socket abstraction.
@@ -1624,7 +1635,7 @@ sendmsg_x(struct proc *p, struct sendmsg_x_args *uap, user_ssize_t *retval)
 	 */
 	if (so->so_proto->pr_usrreqs->pru_sosend_list !=
 	    pru_sosend_list_notsupp &&
-	    has_addr_or_ctl == 0 && somaxsendmsgx == 0) {
+	    has_addr_or_ctl == 0 && somsgxlist != 0) {
 		error = so->so_proto->pr_usrreqs->pru_sosend_list(so, uiop,
 		    uap->cnt, uap->flags);
 	} else {
@@ -2227,7 +2238,7 @@ recvmsg_x(struct proc *p, struct recvmsg_x_args *uap, user_ssize_t *retval)
 
 	if (so->so_proto->pr_usrreqs->pru_soreceive_list !=
 	    pru_soreceive_list_notsupp &&
-	    somaxrecvmsgx == 0) {
+	    somsgxlist != 0) {
 		error = so->so_proto->pr_usrreqs->pru_soreceive_list(so,
 		    recv_msg_array, uap->cnt, &uap->flags);
 	} else {
@@ -3163,6 +3174,145 @@ recv_msg_array_is_valid(struct recv_msg_elem *recv_msg_array, u_int count)
 #define	SENDFILE_MAX_16K	HOWMANY_16K(SENDFILE_MAX_BYTES)
 #define	SENDFILE_MAX_4K		HOWMANY_4K(SENDFILE_MAX_BYTES)
 
+/*
+ * Zero-copy sendfile.
+ *
+ * When enabled, file data is not read into mbuf clusters: the range is
+ * mapped read-only in the kernel map straight from the UBC, wired, and
+ * attached to a single mbuf as external storage.  The pages stay wired
+ * for as long as that storage is referenced, i.e. until TCP has had the
+ * data acknowledged and every driver holding a copy of the mbuf has
+ * freed it; the unwire and unmap are then done from a thread call since
+ * mbufs can be freed in contexts that can't block.
+ *
+ * Because the storage is not part of the mbuf map, it must only be used
+ * with interfaces whose drivers don't rely on mbuf_data_to_physical(),
+ * which is why this is off by default.
+ */
+static int sendfile_zerocopy = 0;
+SYSCTL_INT(_kern_ipc, OID_AUTO, sendfile_zerocopy,
+	CTLFLAG_RW | CTLFLAG_LOCKED, &sendfile_zerocopy, 0, "");
+
+static uint64_t sendfile_zerocopy_bytes = 0;
+SYSCTL_QUAD(_kern_ipc, OID_AUTO, sendfile_zerocopy_bytes,
+	CTLFLAG_RD | CTLFLAG_LOCKED, &sendfile_zerocopy_bytes, "");
+
+struct sendfile_loan {
+	vm_map_offset_t	sfl_addr;	/* kernel mapping of the file range */
+	vm_map_size_t	sfl_size;
+	vnode_t		sfl_vp;		/* holds a usecount */
+	thread_call_t	sfl_call;
+};
+
+static void
+sendfile_loan_reclaim(thread_call_param_t arg0, __unused thread_call_param_t arg1)
+{
+	struct sendfile_loan *sfl = arg0;
+
+	(void) vm_map_unwire(kernel_map, sfl->sfl_addr,
+	    sfl->sfl_addr + sfl->sfl_size, FALSE);
+	(void) vm_map_remove(kernel_map, sfl->sfl_addr,
+	    sfl->sfl_addr + sfl->sfl_size, VM_MAP_REMOVE_NO_FLAGS);
+	vnode_rele(sfl->sfl_vp);
+
+	thread_call_free(sfl->sfl_call);
+	FREE(sfl, M_TEMP);
+}
+
+static void
+sendfile_loan_free(__unused caddr_t buf, __unused u_int size, caddr_t arg)
+{
+	struct sendfile_loan *sfl = (struct sendfile_loan *)(void *)arg;
+
+	thread_call_enter(sfl->sfl_call);
+}
+
+/*
+ * Returns a packet whose data is the wired UBC range [off, off + len),
+ * or NULL if the range can't be loaned and has to be copied instead.
+ */
+static struct mbuf *
+sendfile_loan_pages(vfs_context_t ctx, struct fileproc *fp, vnode_t vp,
+    off_t off, off_t len)
+{
+	memory_object_control_t control;
+	struct sendfile_loan *sfl;
+	vm_map_offset_t addr = 0;
+	vm_object_offset_t map_off;
+	vm_map_size_t map_size;
+	kern_return_t kr;
+	struct mbuf *m;
+
+	map_off = trunc_page_64(off);
+	map_size = round_page_64(off + len) - map_off;
+
+	MALLOC(sfl, struct sendfile_loan *, sizeof (*sfl), M_TEMP, M_WAITOK);
+	if (sfl == NULL)
+		return (NULL);
+
+	if (vnode_getwithref(vp) != 0) {
+		FREE(sfl, M_TEMP);
+		return (NULL);
+	}
+
+#if CONFIG_MACF
+	/* this doesn't go through fo_read() and its checks */
+	if (mac_vnode_check_read(ctx, fp->f_fglob->fg_cred, vp) != 0)
+		goto fail_iocount;
+#else
+#pragma unused(ctx, fp)
+#endif
+
+	control = ubc_getobject(vp, UBC_FLAGS_NONE);
+	if (control == MEMORY_OBJECT_CONTROL_NULL)
+		goto fail_iocount;
+
+	kr = vm_map_enter_mem_object_control(kernel_map, &addr, map_size,
+	    0, VM_FLAGS_ANYWHERE, VM_MAP_KERNEL_FLAGS_NONE, VM_KERN_MEMORY_FILE,
+	    control, map_off, FALSE, VM_PROT_READ, VM_PROT_READ,
+	    VM_INHERIT_NONE);
+	if (kr != KERN_SUCCESS)
+		goto fail_iocount;
+
+	/* faults the pages in from the UBC, or the file system */
+	kr = vm_map_wire_kernel(kernel_map, addr, addr + map_size,
+	    VM_PROT_READ, VM_KERN_MEMORY_FILE, FALSE);
+	if (kr != KERN_SUCCESS)
+		goto fail_map;
+
+	sfl->sfl_call = thread_call_allocate(sendfile_loan_reclaim, sfl);
+	if (sfl->sfl_call == NULL)
+		goto fail_wire;
+
+	m = m_clattach(NULL, MT_DATA, (caddr_t)(addr + (off - map_off)),
+	    sendfile_loan_free, (u_int)len, (caddr_t)sfl, M_WAIT, 0);
+	if (m == NULL) {
+		thread_call_free(sfl->sfl_call);
+		goto fail_wire;
+	}
+	m->m_len = (int32_t)len;
+	m->m_pkthdr.len = (int32_t)len;
+
+	sfl->sfl_addr = addr;
+	sfl->sfl_size = map_size;
+	sfl->sfl_vp = vp;
+	vnode_ref(vp);
+	vnode_put(vp);
+
+	OSAddAtomic64(len, (volatile SInt64 *)&sendfile_zerocopy_bytes);
+	return (m);
+
+fail_wire:
+	(void) vm_map_unwire(kernel_map, addr, addr + map_size, FALSE);
+fail_map:
+	(void) vm_map_remove(kernel_map, addr, addr + map_size,
+	    VM_MAP_REMOVE_NO_FLAGS);
+fail_iocount:
+	vnode_put(vp);
+	FREE(sfl, M_TEMP);
+	return (NULL);
+}
+
 static void
 alloc_sendpkt(int how, size_t pktlen, unsigned int *maxchunks,
     struct mbuf **m, boolean_t jumbocl)
@@ -3229,6 +3379,7 @@ sendfile(struct proc *p, struct sendfile_args *uap, __unused int *retval)
 	int error = 0;
 	size_t sizeof_hdtr;
 	off_t file_size;
+	boolean_t zerocopy;
 	struct vfs_context context = *vfs_context_current();
 
 	KERNEL_DEBUG_CONSTANT((DBG_FNC_SENDFILE | DBG_FUNC_START), uap->s,
@@ -3352,10 +3503,12 @@ sendfile(struct proc *p, struct sendfile_args *uap, __unused int *retval)
 		goto done2;
 	}
 
+	zerocopy = (sendfile_zerocopy != 0);
+
 	/*
-	 * Simply read file data into a chain of mbufs that used with scatter
-	 * gather reads. We're not (yet?) setup to use zero copy external
-	 * mbufs that point to the file pages.
+	 * Read file data into a chain of mbufs that used with scatter
+	 * gather reads, unless zero-copy is enabled, in which case the
+	 * mbufs point to the file pages (see sendfile_loan_pages()).
 	 */
 	socket_lock(so, 1);
 	error = sblock(&so->so_snd, SBL_WAIT);
@@ -3419,6 +3572,13 @@ sendfile(struct proc *p, struct sendfile_args *uap, __unused int *retval)
 		    ((so->so_flags & SOF_MULTIPAGES) || sosendjcl_ignore_capab);
 
 		socket_unlock(so, 0);
+
+		if (zerocopy && xfsize >= PAGE_SIZE_64 &&
+		    (m0 = sendfile_loan_pages(&context, fp, vp, off, xfsize)) != NULL) {
+			socket_lock(so, 0);
+			goto retry_space;
+		}
+
 		alloc_sendpkt(M_WAIT, xfsize, &nbufs, &m0, jumbocl);
 		pktlen = mbuf_pkthdr_maxlen(m0);
 		if (pktlen < (size_t)xfsize)
@@ -185,6 +185,19 @@ unp_get_locks_in_order(struct socket *so, struct socket *conn_so)
 {
 	if (so < conn_so) {
 		socket_lock(conn_so, 1);
+	} else if (lck_mtx_try_lock(&sotounpcb(conn_so)->unp_mtx)) {
+		/*
+		 * The peer's lock is usually free: taking it without
+		 * blocking cannot deadlock, so keep ours rather than
+		 * dropping and retaking it on every send and receive.
+		 * Account for it as unp_lock() would.
+		 */
+		VERIFY(conn_so->so_usecount > 0);
+		conn_so->so_usecount++;
+		conn_so->lock_lr[conn_so->next_lock_lr] =
+		    __builtin_return_address(0);
+		conn_so->next_lock_lr = (conn_so->next_lock_lr + 1) %
+		    SO_LCKDBG_MAX;
 	} else {
 		struct unpcb *unp = sotounpcb(so);
 		unp->unp_flags |= UNP_DONTDISCONNECT;
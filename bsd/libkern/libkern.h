@@ -204,6 +204,7 @@ extern int	vsnprintf(char *, size_t, const char *, va_list) __printflike(3,0);
 
 #if XNU_KERNEL_PRIVATE
 extern int	vprintf_log_locked(const char *, va_list) __printflike(1,0);
+extern int	vsnprintf_log(char *, size_t, const char *, va_list) __printflike(3,0);
 extern void	osobject_retain(void * object);
 extern void	osobject_release(void * object);
 #endif
@@ -202,6 +202,14 @@ int	throttle_io_period_ssd_msecs[THROTTLE_LEVEL_END + 1] = {
 
 int	throttled_count[THROTTLE_LEVEL_END + 1];
 
+/*
+ * log2 histograms (in usecs) of the time tracked I/Os of each tier
+ * spent at the device, from spec_strategy to throttle_info_end_io
+ */
+#define	THROTTLE_IO_LATENCY_BUCKETS	24
+
+uint64_t throttle_io_latency_hist[THROTTLE_LEVEL_END + 1][THROTTLE_IO_LATENCY_BUCKETS];
+
 struct _throttle_io_info_t {
         lck_mtx_t       throttle_lock;
 
@@ -238,6 +246,7 @@ int	lowpri_throttle_enabled = 1;
 
 
 static void throttle_info_end_io_internal(struct _throttle_io_info_t *info, int throttle_level);
+static void throttle_info_record_latency(buf_t bp, int throttle_level);
 static int throttle_info_update_internal(struct _throttle_io_info_t *info, uthread_t ut, int flags, boolean_t isssd, boolean_t inflight, struct bufattr *bap);
 static int throttle_get_thread_throttle_level(uthread_t ut);
 static int throttle_get_thread_throttle_level_internal(uthread_t ut, int io_tier);
@@ -841,6 +850,16 @@ SYSCTL_INT(_debug, OID_AUTO, lowpri_throttle_tier3_io_period_ssd_msecs, CTLFLAG_
 
 SYSCTL_INT(_debug, OID_AUTO, lowpri_throttle_enabled, CTLFLAG_RW | CTLFLAG_LOCKED, &lowpri_throttle_enabled, 0, "");
 
+static int
+sysctl_lowpri_throttle_latency_hist SYSCTL_HANDLER_ARGS
+{
+#pragma unused(oidp, arg1, arg2)
+	return SYSCTL_OUT(req, throttle_io_latency_hist, sizeof(throttle_io_latency_hist));
+}
+
+SYSCTL_PROC(_debug, OID_AUTO, lowpri_throttle_latency_hist, CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_LOCKED,
+	0, 0, sysctl_lowpri_throttle_latency_hist, "Q", "per-tier log2 histograms of tracked I/O latency (usecs)");
+
 
 static lck_grp_t        *throttle_lock_grp;
 static lck_attr_t       *throttle_lock_attr;
@@ -1995,9 +2014,38 @@ void throttle_info_end_io(buf_t bp) {
 		io_tier--;
 	}
 
+	throttle_info_record_latency(bp, io_tier);
 	throttle_info_end_io_internal(info, io_tier);
 }
 
+/*
+ * Account the time a tracked I/O took since it was handed to the driver
+ * in the histogram of its tier
+ */
+static void
+throttle_info_record_latency(buf_t bp, int throttle_level)
+{
+	struct timeval elapsed;
+	uint64_t usecs = 0;
+	unsigned int bucket = 0;
+
+	if (throttle_level < THROTTLE_LEVEL_START || throttle_level > THROTTLE_LEVEL_END) {
+		return;
+	}
+
+	microuptime(&elapsed);
+	timevalsub(&elapsed, &bp->b_timestamp_tv);
+	/* the I/O may complete before spec_strategy stamps it */
+	if (elapsed.tv_sec >= 0) {
+		usecs = elapsed.tv_sec * USEC_PER_SEC + elapsed.tv_usec;
+	}
+	while (usecs >>= 1)
+		bucket++;
+	if (bucket >= THROTTLE_IO_LATENCY_BUCKETS)
+		bucket = THROTTLE_IO_LATENCY_BUCKETS - 1;
+	OSAddAtomic64(1, &throttle_io_latency_hist[throttle_level][bucket]);
+}
+
 /*
  * Decrement inflight count initially incremented by throttle_info_update_internal
  */
@@ -987,10 +987,31 @@ bpf_finalize_pktap(struct bpf_hdr *hp, struct pktap_header *pktaphdr)
 	(d)->bd_hbuf = (d)->bd_sbuf; \
 	(d)->bd_hlen = (d)->bd_slen; \
 	(d)->bd_hcnt = (d)->bd_scnt; \
+	(d)->bd_htime = (d)->bd_stime; \
 	(d)->bd_sbuf = (d)->bd_fbuf; \
 	(d)->bd_slen = 0; \
 	(d)->bd_scnt = 0; \
 	(d)->bd_fbuf = NULL;
+/*
+ * Account for the hold buffer being handed to read: the delay is how
+ * long its oldest packet waited in the kernel.
+ */
+static void
+bpf_account_read(struct bpf_d *d)
+{
+	struct timeval tv;
+	u_int64_t now, delay;
+
+	microtime(&tv);
+	now = (u_int64_t)tv.tv_sec * USEC_PER_SEC + tv.tv_usec;
+	delay = now > d->bd_htime ? now - d->bd_htime : 0;
+
+	d->bd_nreads++;
+	d->bd_delay_total += delay;
+	if (delay > d->bd_delay_max)
+		d->bd_delay_max = delay;
+}
+
 /*
  *  bpfread - read next chunk of packets from buffers
  */
@@ -1161,6 +1182,8 @@ bpfread(dev_t dev, struct uio *uio, int ioflag)
 	hbuf = d->bd_hbuf;
 	hbuf_len = d->bd_hlen;
 	flags = d->bd_flags;
+	if (hbuf_len != 0)
+		bpf_account_read(d);
 	lck_mtx_unlock(bpf_mlock);
 
 #ifdef __APPLE__
@@ -1437,6 +1460,12 @@ reset_d(struct bpf_d *d)
 	d->bd_hcnt = 0;
 	d->bd_rcount = 0;
 	d->bd_dcount = 0;
+	d->bd_dcount_reading = 0;
+	d->bd_dcount_full = 0;
+	d->bd_dcount_headdrop = 0;
+	d->bd_nreads = 0;
+	d->bd_delay_total = 0;
+	d->bd_delay_max = 0;
 }
 
 static struct bpf_d *
@@ -1592,6 +1621,7 @@ done:
  *  BIOCSRTIMEOUT	Set read timeout.
  *  BIOCGRTIMEOUT	Get read timeout.
  *  BIOCGSTATS		Get packet stats.
+ *  BIOCGSTATSEXT	Get detailed packet drop and read delay stats.
  *  BIOCIMMEDIATE	Set immediate mode.
  *  BIOCVERSION		Get filter language version.
  *  BIOCGHDRCMPLT	Get "header already complete" flag
@@ -1915,6 +1945,23 @@ bpfioctl(dev_t dev, u_long cmd, caddr_t addr, __unused int flags,
 		break;
 	}
 
+	case BIOCGSTATSEXT: {		/* struct bpf_stat_ext */
+		struct bpf_stat_ext bse;
+
+		bzero(&bse, sizeof (bse));
+		bse.bse_recv = d->bd_rcount;
+		bse.bse_drop = d->bd_dcount;
+		bse.bse_drop_reading = d->bd_dcount_reading;
+		bse.bse_drop_full = d->bd_dcount_full;
+		bse.bse_drop_headdrop = d->bd_dcount_headdrop;
+		bse.bse_reads = d->bd_nreads;
+		if (d->bd_nreads != 0)
+			bse.bse_delay_avg = d->bd_delay_total / d->bd_nreads;
+		bse.bse_delay_max = d->bd_delay_max;
+		bcopy(&bse, addr, sizeof (bse));
+		break;
+	}
+
 	/*
 	 * Set immediate mode.
 	 */
@@ -3221,6 +3268,7 @@ catchpacket(struct bpf_d *d, struct bpf_packet * pkt,
 		 */
 		if (d->bd_hbuf_read != 0) {
 			++d->bd_dcount;
+			++d->bd_dcount_reading;
 			return;
 		}
 
@@ -3231,12 +3279,14 @@ catchpacket(struct bpf_d *d, struct bpf_packet * pkt,
 				 * so drop the packet.
 				 */
 				++d->bd_dcount;
+				++d->bd_dcount_full;
 				return;
 			}
 			/*
 			 * Drop the hold buffer as it contains older packets
 			 */
 			d->bd_dcount += d->bd_hcnt;
+			d->bd_dcount_headdrop += d->bd_hcnt;
 			d->bd_fbuf = d->bd_hbuf;
 			ROTATE_BUFFERS(d);
 		} else {
@@ -3256,6 +3306,8 @@ catchpacket(struct bpf_d *d, struct bpf_packet * pkt,
 	 * Append the bpf header.
 	 */
 	microtime(&tv);
+	if (curlen == 0)
+		d->bd_stime = (u_int64_t)tv.tv_sec * USEC_PER_SEC + tv.tv_usec;
 	if (d->bd_flags & BPF_EXTENDED_HDR) {
 		struct mbuf *m;
 
@@ -169,6 +169,23 @@ struct bpf_stat {
 	u_int bs_drop;		/* number of packets dropped */
 };
 
+#ifdef PRIVATE
+/*
+ * Struct returned by BIOCGSTATSEXT.  The delays are measured from the
+ * capture of the first packet of a buffer to the read that returns it.
+ */
+struct bpf_stat_ext {
+	u_int64_t bse_recv;		/* number of packets received */
+	u_int64_t bse_drop;		/* number of packets dropped */
+	u_int64_t bse_drop_reading;	/* dropped while a read was in progress */
+	u_int64_t bse_drop_full;	/* dropped as the buffers were full */
+	u_int64_t bse_drop_headdrop;	/* dropped to make room, in head-drop mode */
+	u_int64_t bse_reads;		/* number of buffers returned by read */
+	u_int64_t bse_delay_avg;	/* average read delay, usec */
+	u_int64_t bse_delay_max;	/* maximum read delay, usec */
+};
+#endif /* PRIVATE */
+
 /*
  * Struct return by BIOCVERSION.  This represents the version number of
  * the filter language described by the instruction encodings below.
@@ -249,6 +266,7 @@ struct bpf_version {
 #define	BIOCSETUP	_IOW('B', 131, struct bpf_setup_args)
 #define	BIOCSPKTHDRV2	_IOW('B', 132, int)
 #define	BIOCGPKTHDRV2	_IOW('B', 133, int)
+#define	BIOCGSTATSEXT	_IOR('B', 134, struct bpf_stat_ext)
 #endif /* PRIVATE */
 /*
  * Structure prepended to each packet.
@@ -111,6 +111,14 @@ struct bpf_d {
 	struct bpf_insn *bd_filter; 	/* filter code */
 	u_int32_t	bd_rcount;	/* number of packets received */
 	u_int32_t	bd_dcount;	/* number of packets dropped */
+	u_int64_t	bd_dcount_reading; /* dropped during a read */
+	u_int64_t	bd_dcount_full;	/* dropped for lack of a free buffer */
+	u_int64_t	bd_dcount_headdrop; /* dropped from the hold buffer */
+	u_int64_t	bd_stime;	/* capture time of store buffer, usec */
+	u_int64_t	bd_htime;	/* capture time of hold buffer, usec */
+	u_int64_t	bd_nreads;	/* number of buffers read */
+	u_int64_t	bd_delay_total;	/* sum of read delays, usec */
+	u_int64_t	bd_delay_max;	/* largest read delay, usec */
 
 	u_char		bd_promisc;	/* true if listening promiscuously */
 	u_char		bd_state;	/* idle, waiting, or timed out */
@@ -57,6 +57,7 @@ typedef struct flowq {
 #define	FQF_NEW_FLOW	0x04	/* Currently on new flows queue */
 #define	FQF_OLD_FLOW	0x08	/* Currently on old flows queue */
 #define	FQF_FLOWCTL_ON	0x10	/* Currently flow controlled */
+#define	FQF_PACED	0x20	/* Head packet is not due yet */
 	u_int8_t	fq_flags;	/* flags */
 	u_int8_t	fq_sc_index; /* service_class index */
 	int16_t		fq_deficit;	/* Deficit for scheduling */
@@ -33,6 +33,7 @@
 #include <sys/random.h>
 #include <sys/kernel_types.h>
 #include <sys/sysctl.h>
+#include <sys/mcache.h>
 
 #include <kern/zalloc.h>
 
@@ -53,6 +54,8 @@ static errno_t ifclassq_dequeue_common(struct ifclassq *, mbuf_svc_class_t,
     boolean_t, classq_pkt_type_t *);
 static void *ifclassq_tbr_dequeue_common(struct ifclassq *, mbuf_svc_class_t,
     boolean_t, classq_pkt_type_t *);
+static boolean_t ifclassq_enqueue_defer(struct ifclassq *, struct mbuf *);
+static void ifclassq_enqueue_deferred(struct ifclassq *);
 
 static u_int64_t ifclassq_target_qdelay = 0;
 SYSCTL_QUAD(_net_classq, OID_AUTO, target_qdelay, CTLFLAG_RW|CTLFLAG_LOCKED,
@@ -63,6 +66,19 @@ SYSCTL_QUAD(_net_classq, OID_AUTO, update_interval,
     CTLFLAG_RW|CTLFLAG_LOCKED, &ifclassq_update_interval,
     "update interval in nanoseconds");
 
+/*
+ * When enabled, an FQ-CoDel enqueue that finds the ifclassq lock held
+ * does not wait for it; the packet is pushed onto a lock-free list and
+ * moved into the scheduler by whoever holds the lock next.
+ */
+static u_int32_t ifclassq_defer_enqueue = 0;
+SYSCTL_UINT(_net_classq, OID_AUTO, defer_enqueue, CTLFLAG_RW|CTLFLAG_LOCKED,
+    &ifclassq_defer_enqueue, 0, "defer enqueue on lock contention");
+
+static u_int64_t ifclassq_deferred_cnt = 0;
+SYSCTL_QUAD(_net_classq, OID_AUTO, deferred_cnt, CTLFLAG_RD|CTLFLAG_LOCKED,
+    &ifclassq_deferred_cnt, "number of packets with deferred enqueue");
+
 static int32_t ifclassq_sched_fq_codel;
 
 void
@@ -78,6 +94,9 @@ classq_init(void)
 	if (!PE_parse_boot_argn("fq_codel", &ifclassq_sched_fq_codel,
 	    sizeof (ifclassq_sched_fq_codel)))
 		ifclassq_sched_fq_codel = 1;
+
+	(void) PE_parse_boot_argn("ifcq_defer_enqueue", &ifclassq_defer_enqueue,
+	    sizeof (ifclassq_defer_enqueue));
 }
 
 int
@@ -136,6 +155,8 @@ ifclassq_teardown(struct ifnet *ifp)
 
 	IFCQ_LOCK(ifq);
 
+	/* move deferred packets into the scheduler so they get purged */
+	ifclassq_enqueue_deferred(ifq);
 	if (IFCQ_IS_READY(ifq)) {
 		if (IFCQ_TBR_IS_ENABLED(ifq)) {
 			struct tb_profile tb = { 0, 0, 0 };
@@ -146,6 +167,8 @@ ifclassq_teardown(struct ifnet *ifp)
 	}
 	ifq->ifcq_sflags = 0;
 
+	/* anything deferred since is freed, as the queue is now disabled */
+	ifclassq_enqueue_deferred(ifq);
 	VERIFY(IFCQ_IS_EMPTY(ifq));
 	VERIFY(!IFCQ_TBR_IS_ENABLED(ifq));
 	VERIFY(ifq->ifcq_type == PKTSCHEDT_NONE);
@@ -230,6 +253,7 @@ ifclassq_get_len(struct ifclassq *ifq, mbuf_svc_class_t sc, u_int32_t *packets,
 	int err = 0;
 
 	IFCQ_LOCK(ifq);
+	ifclassq_enqueue_deferred(ifq);
 	if (sc == MBUF_SC_UNSPEC) {
 		VERIFY(packets != NULL);
 		*packets = IFCQ_LEN(ifq);
@@ -266,6 +290,88 @@ ifclassq_set_packet_metadata(struct ifclassq *ifq, struct ifnet *ifp,
 	}
 }
 
+/*
+ * Try to take the ifclassq lock for an enqueue; if it is contended, push
+ * the packet onto the deferred list instead and return TRUE, in which case
+ * the lock is not held.  At most IFCQ_MAXLEN packets are ever deferred;
+ * beyond that the caller blocks on the lock as usual, which also bounds
+ * the work done by whoever drains the list.
+ */
+static boolean_t
+ifclassq_enqueue_defer(struct ifclassq *ifq, struct mbuf *m)
+{
+	void *head;
+
+	if (ifclassq_defer_enqueue == 0 ||
+	    ifq->ifcq_type != PKTSCHEDT_FQ_CODEL) {
+		IFCQ_LOCK_SPIN(ifq);
+		return (FALSE);
+	}
+
+	if (lck_mtx_try_lock_spin(&ifq->ifcq_lock))
+		return (FALSE);
+
+	if (atomic_add_32_ov(&ifq->ifcq_defer_cnt, 1) >= IFCQ_MAXLEN(ifq)) {
+		atomic_add_32(&ifq->ifcq_defer_cnt, -1);
+		IFCQ_LOCK_SPIN(ifq);
+		return (FALSE);
+	}
+
+	do {
+		head = ifq->ifcq_defer_head;
+		m->m_nextpkt = head;
+	} while (!atomic_test_set_ptr(&ifq->ifcq_defer_head, head, m));
+
+	atomic_add_64(&ifclassq_deferred_cnt, 1);
+	return (TRUE);
+}
+
+/*
+ * Move the packets deferred by ifclassq_enqueue_defer() into the scheduler,
+ * in their order of arrival.  Called with the ifclassq lock held, before
+ * the lock holder does its own enqueue or dequeue.
+ */
+static void
+ifclassq_enqueue_deferred(struct ifclassq *ifq)
+{
+	struct mbuf *m, *n, *list = NULL;
+	boolean_t pdrop;
+	u_int32_t cnt = 0;
+	errno_t err;
+#pragma unused(err)
+
+	IFCQ_LOCK_ASSERT_HELD(ifq);
+
+	if (ifq->ifcq_defer_head == NULL)
+		return;
+
+	do {
+		m = ifq->ifcq_defer_head;
+	} while (!atomic_test_set_ptr(&ifq->ifcq_defer_head, m, NULL));
+
+	/* producers push at the head; reverse to restore the FIFO order */
+	while (m != NULL) {
+		n = m->m_nextpkt;
+		m->m_nextpkt = list;
+		list = m;
+		m = n;
+		cnt++;
+	}
+	atomic_add_32(&ifq->ifcq_defer_cnt, -(int32_t)cnt);
+
+	while ((m = list) != NULL) {
+		list = m->m_nextpkt;
+		m->m_nextpkt = NULL;
+		if (!IFCQ_IS_ENABLED(ifq)) {
+			IFCQ_CONVERT_LOCK(ifq);
+			m_freem(m);
+			continue;
+		}
+		/* the scheduler accounts for and frees dropped packets */
+		IFCQ_ENQUEUE(ifq, m, QP_MBUF, err, &pdrop);
+	}
+}
+
 errno_t
 ifclassq_enqueue(struct ifclassq *ifq, void *p, classq_pkt_type_t ptype,
     boolean_t *pdrop)
@@ -274,7 +380,10 @@ ifclassq_enqueue(struct ifclassq *ifq, void *p, classq_pkt_type_t ptype,
 
 	switch (ptype) {
 	case QP_MBUF:
-		IFCQ_LOCK_SPIN(ifq);
+		if (ifclassq_enqueue_defer(ifq, p)) {
+			*pdrop = FALSE;
+			return (0);
+		}
 		break;
 
 	default:
@@ -282,6 +391,7 @@ ifclassq_enqueue(struct ifclassq *ifq, void *p, classq_pkt_type_t ptype,
 		break;
 	}
 
+	ifclassq_enqueue_deferred(ifq);
 	IFCQ_ENQUEUE(ifq, p, ptype, err, pdrop);
 	IFCQ_UNLOCK(ifq);
 	return (err);
@@ -334,6 +444,7 @@ ifclassq_dequeue_common(struct ifclassq *ifq, mbuf_svc_class_t sc,
 			IFCQ_LOCK_SPIN(ifq);
 		else
 			IFCQ_LOCK(ifq);
+		ifclassq_enqueue_deferred(ifq);
 		err = ifq->ifcq_dequeue_sc_multi(ifq, sc, pkt_limit,
 		    byte_limit, head, tail, cnt, len, ptype);
 		IFCQ_UNLOCK(ifq);
@@ -348,6 +459,7 @@ ifclassq_dequeue_common(struct ifclassq *ifq, mbuf_svc_class_t sc,
 			IFCQ_LOCK_SPIN(ifq);
 		else
 			IFCQ_LOCK(ifq);
+		ifclassq_enqueue_deferred(ifq);
 
 		err = ifq->ifcq_dequeue_multi(ifq, pkt_limit, byte_limit,
 		    head, tail, cnt, len, ptype);
@@ -367,6 +479,7 @@ dequeue_loop:
 		IFCQ_LOCK_SPIN(ifq);
 	else
 		IFCQ_LOCK(ifq);
+	ifclassq_enqueue_deferred(ifq);
 
 	while (i < pkt_limit && l < byte_limit) {
 		classq_pkt_type_t tmp_ptype;
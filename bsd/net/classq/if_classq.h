@@ -130,6 +130,18 @@ struct ifclassq {
 	u_int32_t	ifcq_target_qdelay; /* target queue delay */
 	u_int32_t	ifcq_bytes;	/* bytes count */
 	u_int32_t	ifcq_pkt_drop_limit;
+	/*
+	 * Earliest departure time (uptime nsec) of the packets the
+	 * scheduler held back during the last dequeue, 0 if none.
+	 */
+	u_int64_t	ifcq_next_txtime;
+	/*
+	 * Packets handed to ifclassq_enqueue() while the lock is contended
+	 * are pushed onto this singly linked (m_nextpkt) list without taking
+	 * the lock; the next lock holder moves them into the scheduler.
+	 */
+	void * volatile	ifcq_defer_head;
+	volatile u_int32_t ifcq_defer_cnt; 	/* packets on ifcq_defer_head */
 	void		*ifcq_disc;	/* for scheduler-specific use */
 	/*
 	 * ifcq_disc_slots[] represents the leaf classes configured for the
@@ -331,6 +343,10 @@ struct if_ifclassq_stats {
 
 #define	IFCQ_PKT_DROP_LIMIT(_ifcq)	((_ifcq)->ifcq_pkt_drop_limit)
 
+/* scheduler holds packets until their pkt_txtime */
+#define	IFCQ_TXTIME_CAPABLE(_ifcq)	\
+	((_ifcq)->ifcq_type == PKTSCHEDT_FQ_CODEL)
+
 extern int ifclassq_setup(struct ifnet *, u_int32_t, boolean_t);
 extern void ifclassq_teardown(struct ifnet *);
 extern int ifclassq_pktsched_setup(struct ifclassq *);
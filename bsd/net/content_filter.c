@@ -1532,39 +1532,20 @@ done:
 	return (so);
 }
 
+/*
+ * Carry out one action message from a filter agent; the message is
+ * contiguous and at least as long as its header.
+ */
 static errno_t
-cfil_ctl_send(kern_ctl_ref kctlref, u_int32_t kcunit, void *unitinfo, mbuf_t m,
-		int flags)
+cfil_ctl_action(u_int32_t kcunit, struct content_filter *cfc,
+		struct cfil_msg_hdr *msghdr)
 {
-#pragma unused(kctlref, flags)
 	errno_t	error = 0;
-	struct cfil_msg_hdr *msghdr;
-	struct content_filter *cfc = (struct content_filter *)unitinfo;
 	struct socket *so;
 	struct cfil_msg_action *action_msg;
 	struct cfil_entry *entry;
 	struct cfil_info *cfil_info = NULL;
 
-	CFIL_LOG(LOG_INFO, "");
-
-	if (content_filters == NULL) {
-		CFIL_LOG(LOG_ERR, "no content filter");
-		error = EINVAL;
-		goto done;
-	}
-	if (kcunit > MAX_CONTENT_FILTER) {
-		CFIL_LOG(LOG_ERR, "kcunit %u > MAX_CONTENT_FILTER (%d)",
-			kcunit, MAX_CONTENT_FILTER);
-		error = EINVAL;
-		goto done;
-	}
-
-	if (m_length(m) < sizeof(struct cfil_msg_hdr)) {
-		CFIL_LOG(LOG_ERR, "too short %u", m_length(m));
-		error = EINVAL;
-		goto done;
-	}
-	msghdr = (struct cfil_msg_hdr *)mbuf_data(m);
 	if (msghdr->cfm_version != CFM_VERSION_CURRENT) {
 		CFIL_LOG(LOG_ERR, "bad version %u", msghdr->cfm_version);
 		error = EINVAL;
@@ -1702,6 +1683,101 @@ cfil_ctl_send(kern_ctl_ref kctlref, u_int32_t kcunit, void *unitinfo, mbuf_t m,
 	}
 unlock:
 	socket_unlock(so, 1);
+done:
+	return (error);
+}
+
+/*
+ * Carry out the action messages packed in a CFM_OP_BATCH message, in
+ * order; a bad message does not prevent the others from being handled.
+ * Returns the error of the last message that failed.
+ */
+static errno_t
+cfil_ctl_batch(u_int32_t kcunit, struct content_filter *cfc, mbuf_t m,
+		uint32_t len)
+{
+	union {
+		struct cfil_msg_hdr		hdr;
+		struct cfil_msg_action		action;
+		struct cfil_msg_bless_client	bless;
+	} msg;
+	uint32_t off;
+	errno_t	error = 0, err;
+
+	OSIncrementAtomic(&cfil_stats.cfs_ctl_action_batch);
+
+	for (off = sizeof(struct cfil_msg_hdr); off < len; off += msg.hdr.cfm_len) {
+		if (len - off < sizeof(struct cfil_msg_hdr)) {
+			OSIncrementAtomic(&cfil_stats.cfs_ctl_action_bad_len);
+			CFIL_LOG(LOG_ERR, "batch truncated at %u", off);
+			return (EINVAL);
+		}
+		mbuf_copydata(m, off, sizeof(struct cfil_msg_hdr), &msg.hdr);
+		if (msg.hdr.cfm_len < sizeof(struct cfil_msg_hdr) ||
+			msg.hdr.cfm_len > sizeof(msg) ||
+			msg.hdr.cfm_len > len - off) {
+			OSIncrementAtomic(&cfil_stats.cfs_ctl_action_bad_len);
+			CFIL_LOG(LOG_ERR, "bad len: %u in batch at %u",
+				msg.hdr.cfm_len, off);
+			return (EINVAL);
+		}
+		mbuf_copydata(m, off, msg.hdr.cfm_len, &msg);
+		if (msg.hdr.cfm_op == CFM_OP_BATCH) {
+			OSIncrementAtomic(&cfil_stats.cfs_ctl_action_bad_op);
+			CFIL_LOG(LOG_ERR, "nested batch at %u", off);
+			error = EINVAL;
+			continue;
+		}
+		err = cfil_ctl_action(kcunit, cfc, &msg.hdr);
+		if (err != 0)
+			error = err;
+	}
+	return (error);
+}
+
+static errno_t
+cfil_ctl_send(kern_ctl_ref kctlref, u_int32_t kcunit, void *unitinfo, mbuf_t m,
+		int flags)
+{
+#pragma unused(kctlref, flags)
+	errno_t	error = 0;
+	struct cfil_msg_hdr *msghdr;
+	struct content_filter *cfc = (struct content_filter *)unitinfo;
+
+	CFIL_LOG(LOG_INFO, "");
+
+	if (content_filters == NULL) {
+		CFIL_LOG(LOG_ERR, "no content filter");
+		error = EINVAL;
+		goto done;
+	}
+	if (kcunit > MAX_CONTENT_FILTER) {
+		CFIL_LOG(LOG_ERR, "kcunit %u > MAX_CONTENT_FILTER (%d)",
+			kcunit, MAX_CONTENT_FILTER);
+		error = EINVAL;
+		goto done;
+	}
+
+	if (m_length(m) < sizeof(struct cfil_msg_hdr)) {
+		CFIL_LOG(LOG_ERR, "too short %u", m_length(m));
+		error = EINVAL;
+		goto done;
+	}
+	msghdr = (struct cfil_msg_hdr *)mbuf_data(m);
+	if (msghdr->cfm_op == CFM_OP_BATCH &&
+		msghdr->cfm_version == CFM_VERSION_CURRENT &&
+		msghdr->cfm_type == CFM_TYPE_ACTION) {
+		if (msghdr->cfm_len > m_length(m)) {
+			OSIncrementAtomic(&cfil_stats.cfs_ctl_action_bad_len);
+			CFIL_LOG(LOG_ERR, "bad len: %u for batch of %u",
+				msghdr->cfm_len, m_length(m));
+			error = EINVAL;
+			goto done;
+		}
+		error = cfil_ctl_batch(kcunit, cfc, m, msghdr->cfm_len);
+	} else {
+		error = cfil_ctl_action(kcunit, cfc, msghdr);
+	}
 done:
 	mbuf_freem(m);
 
@@ -120,6 +120,7 @@ struct cfil_opt_sock_info {
 #define	CFM_OP_DATA_UPDATE 16		/* update pass or peek offsets */
 #define	CFM_OP_DROP 17			/* shutdown socket, no more data */
 #define	CFM_OP_BLESS_CLIENT 18		/* mark a client flow as already filtered, passes a uuid */
+#define	CFM_OP_BATCH 19			/* several actions in one message */
 
 /*
  * struct cfil_msg_hdr
@@ -244,6 +245,20 @@ struct cfil_msg_bless_client {
 	uuid_t cfb_client_uuid;
 };
 
+/*
+ * CFM_OP_BATCH
+ *
+ * Lets a filter act on many sockets with a single send: the header is
+ * followed by complete action messages, each with its own header and
+ * length, packed back to back up to cfm_len.  They are carried out in
+ * order as if sent one by one; cfm_sock_id of the batch header is
+ * ignored.  A batch may not contain another batch.
+ *
+ * Valid Type: CFM_TYPE_ACTION
+ *
+ * Valid Ops: CFM_OP_BATCH
+ */
+
 #define	CFM_MAX_OFFSET	UINT64_MAX
 
 /*
@@ -312,6 +327,7 @@ struct cfil_stats {
 	int32_t	cfs_ctl_action_drop;
 	int32_t	cfs_ctl_action_bad_op;
 	int32_t	cfs_ctl_action_bad_len;
+	int32_t	cfs_ctl_action_batch;
 
 	int32_t	cfs_sock_id_not_found;
 
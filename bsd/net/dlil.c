@@ -93,6 +93,7 @@
 #include <netinet/ip.h>
 #include <netinet/ip_icmp.h>
 #include <netinet/icmp_var.h>
+#include <netinet/lro_ext.h>
 #endif /* INET */
 
 #if INET6
@@ -271,7 +272,7 @@ static lck_grp_t *ifnet_head_lock_group;
 static lck_grp_t *ifnet_snd_lock_group;
 static lck_grp_t *ifnet_rcv_lock_group;
 lck_attr_t *ifnet_lock_attr;
-decl_lck_rw_data(static, ifnet_head_lock);
+decl_lck_rm_data(static, ifnet_head_lock);
 decl_lck_mtx_data(static, dlil_ifnet_lock);
 u_int32_t dlil_filter_disable_tso_count = 0;
 
@@ -325,6 +326,9 @@ static struct dlil_main_threading_info dlil_main_input_thread_info;
 __private_extern__ struct dlil_threading_info *dlil_main_input_thread =
     (struct dlil_threading_info *)&dlil_main_input_thread_info;
 
+/* input threads for packets steered by their driver flow ID */
+static struct dlil_threading_info dlil_rxq_input_thread_info[DLIL_RXQ_MAX];
+
 static int dlil_event_internal(struct ifnet *ifp, struct kev_msg *msg, bool update_generation);
 static int dlil_detach_filter_internal(interface_filter_t filter, int detached);
 static void dlil_if_trace(struct dlil_ifnet *, int);
@@ -392,6 +396,7 @@ static __inline void ifp_inc_traffic_class_in(struct ifnet *, struct mbuf *);
 static __inline void ifp_inc_traffic_class_out(struct ifnet *, struct mbuf *);
 
 static void dlil_main_input_thread_func(void *, wait_result_t);
+static void dlil_rxq_input_thread_func(void *, wait_result_t);
 static void dlil_input_thread_func(void *, wait_result_t);
 static void dlil_rxpoll_input_thread_func(void *, wait_result_t);
 static int dlil_create_input_thread(ifnet_t, struct dlil_threading_info *);
@@ -399,6 +404,8 @@ static void dlil_terminate_input_thread(struct dlil_threading_info *);
 static void dlil_input_stats_add(const struct ifnet_stat_increment_param *,
     struct dlil_threading_info *, boolean_t);
 static void dlil_input_stats_sync(struct ifnet *, struct dlil_threading_info *);
+static errno_t dlil_input_steer(struct ifnet *, struct mbuf *,
+    const struct ifnet_stat_increment_param *);
 static void dlil_input_packet_list_common(struct ifnet *, struct mbuf *,
     u_int32_t, ifnet_model_t, boolean_t);
 static errno_t ifnet_input_common(struct ifnet *, struct mbuf *, struct mbuf *,
@@ -620,6 +627,25 @@ SYSCTL_UINT(_net_link_generic_system, OID_AUTO, dlil_input_threads,
     CTLFLAG_RD | CTLFLAG_LOCKED, &cur_dlil_input_threads, 0,
     "Current number of DLIL input threads");
 
+/*
+ * Input steering threads, sized at boot with the "dlil_rxq_threads"
+ * boot-arg and capped at the number of CPUs; 0 (the default) disables
+ * steering.  Drivers with multiple receive queues tag each inbound
+ * packet with its RSS hash or queue index via mbuf_set_flowid(), and
+ * chains of tagged packets are spread across these threads by that tag,
+ * rather than all going through the interface's single input thread.
+ * Each flow stays on one thread, so its packets remain in order.
+ */
+static u_int32_t dlil_rxq_threads = 0;
+SYSCTL_UINT(_net_link_generic_system, OID_AUTO, rxq_threads,
+    CTLFLAG_RD | CTLFLAG_LOCKED, &dlil_rxq_threads, 0,
+    "Number of DLIL input steering threads");
+
+static u_int32_t dlil_rxq_steering = 1;
+SYSCTL_UINT(_net_link_generic_system, OID_AUTO, rxq_steering,
+    CTLFLAG_RW | CTLFLAG_LOCKED, &dlil_rxq_steering, 1,
+    "steer flow-tagged input packets across the steering threads");
+
 #if IFNET_INPUT_SANITY_CHK
 SYSCTL_UINT(_net_link_generic_system, OID_AUTO, dlil_input_sanity_check,
     CTLFLAG_RW | CTLFLAG_LOCKED, &dlil_input_sanity_check, 0,
@@ -1029,25 +1055,25 @@ if_inet6data_lock_done(struct ifnet *ifp)
 __private_extern__ void
 ifnet_head_lock_shared(void)
 {
-	lck_rw_lock_shared(&ifnet_head_lock);
+	lck_rm_lock_shared(&ifnet_head_lock);
 }
 
 __private_extern__ void
 ifnet_head_lock_exclusive(void)
 {
-	lck_rw_lock_exclusive(&ifnet_head_lock);
+	lck_rm_lock_exclusive(&ifnet_head_lock);
 }
 
 __private_extern__ void
 ifnet_head_done(void)
 {
-	lck_rw_done(&ifnet_head_lock);
+	lck_rm_done(&ifnet_head_lock);
 }
 
 __private_extern__ void
 ifnet_head_assert_exclusive(void)
 {
-	LCK_RW_ASSERT(&ifnet_head_lock, LCK_RW_ASSERT_EXCLUSIVE);
+	LCK_RM_ASSERT(&ifnet_head_lock, LCK_RM_ASSERT_EXCLUSIVE);
 }
 
 /*
@@ -1251,12 +1277,20 @@ dlil_create_input_thread(ifnet_t ifp, struct dlil_threading_info *inp)
 	u_int32_t limit;
 	int error;
 
-	/* NULL ifp indicates the main input thread, called at dlil_init time */
-	if (ifp == NULL) {
+	/*
+	 * NULL ifp indicates the main input thread or one of the input
+	 * steering threads, called at dlil_init time
+	 */
+	if (ifp == NULL && inp == dlil_main_input_thread) {
 		func = dlil_main_input_thread_func;
-		VERIFY(inp == dlil_main_input_thread);
 		(void) strlcat(inp->input_name,
 		    "main_input", DLIL_THREADNAME_LEN);
+	} else if (ifp == NULL) {
+		func = dlil_rxq_input_thread_func;
+		VERIFY(inp >= dlil_rxq_input_thread_info &&
+		    inp < &dlil_rxq_input_thread_info[DLIL_RXQ_MAX]);
+		(void) snprintf(inp->input_name, DLIL_THREADNAME_LEN,
+		    "rxq%d_input", (int)(inp - dlil_rxq_input_thread_info));
 	} else if (net_rxpoll && (ifp->if_eflags & IFEF_RXPOLL)) {
 		func = dlil_rxpoll_input_thread_func;
 		VERIFY(inp != dlil_main_input_thread);
@@ -1328,6 +1362,10 @@ dlil_create_input_thread(ifnet_t ifp, struct dlil_threading_info *inp)
 	} else if (inp == dlil_main_input_thread) {
 		panic_plain("%s: couldn't create main input thread", __func__);
 		/* NOTREACHED */
+	} else if (ifp == NULL) {
+		panic_plain("%s: couldn't create %s thread", __func__,
+		    inp->input_name);
+		/* NOTREACHED */
 	} else {
 		panic_plain("%s: couldn't create %s input thread", __func__,
 		    if_name(ifp));
@@ -1452,6 +1490,7 @@ void
 dlil_init(void)
 {
 	thread_t thread = THREAD_NULL;
+	u_int32_t i;
 
 	/*
 	 * The following fields must be 64-bit aligned for atomic operations.
@@ -1471,6 +1510,7 @@ dlil_init(void)
 	IF_DATA_REQUIRE_ALIGNED_64(ifi_dt_bytes);
 	IF_DATA_REQUIRE_ALIGNED_64(ifi_fpackets);
 	IF_DATA_REQUIRE_ALIGNED_64(ifi_fbytes);
+	IF_DATA_REQUIRE_ALIGNED_64(ifi_rxq_packets);
 
 	IFNET_IF_DATA_REQUIRE_ALIGNED_64(ifi_ipackets);
 	IFNET_IF_DATA_REQUIRE_ALIGNED_64(ifi_ierrors);
@@ -1487,6 +1527,7 @@ dlil_init(void)
 	IFNET_IF_DATA_REQUIRE_ALIGNED_64(ifi_dt_bytes);
 	IFNET_IF_DATA_REQUIRE_ALIGNED_64(ifi_fpackets);
 	IFNET_IF_DATA_REQUIRE_ALIGNED_64(ifi_fbytes);
+	IFNET_IF_DATA_REQUIRE_ALIGNED_64(ifi_rxq_packets);
 
 	/*
 	 * These IF_HWASSIST_ flags must be equal to their IFNET_* counterparts.
@@ -1569,6 +1610,11 @@ dlil_init(void)
 
 	PE_parse_boot_argn("net_rxpoll", &net_rxpoll, sizeof (net_rxpoll));
 
+	PE_parse_boot_argn("dlil_rxq_threads", &dlil_rxq_threads,
+	    sizeof (dlil_rxq_threads));
+	dlil_rxq_threads = MIN(dlil_rxq_threads,
+	    MIN((u_int32_t)ml_get_max_cpus(), DLIL_RXQ_MAX));
+
 	PE_parse_boot_argn("net_rtref", &net_rtref, sizeof (net_rtref));
 
 	PE_parse_boot_argn("ifnet_debug", &ifnet_debug, sizeof (ifnet_debug));
@@ -1682,7 +1728,7 @@ dlil_init(void)
 
 	ifnet_lock_attr = lck_attr_alloc_init();
 
-	lck_rw_init(&ifnet_head_lock, ifnet_head_lock_group,
+	lck_rm_init(&ifnet_head_lock, ifnet_head_lock_group,
 	    dlil_lck_attributes);
 	lck_mtx_init(&dlil_ifnet_lock, dlil_lock_group, dlil_lck_attributes);
 
@@ -1742,6 +1788,8 @@ dlil_init(void)
 	 * detacher threads once everything is initialized.
 	 */
 	dlil_create_input_thread(NULL, dlil_main_input_thread);
+	for (i = 0; i < dlil_rxq_threads; i++)
+		dlil_create_input_thread(NULL, &dlil_rxq_input_thread_info[i]);
 
 	if (kernel_thread_start(ifnet_detacher_thread_func,
 	    NULL, &thread) != KERN_SUCCESS) {
@@ -2043,6 +2091,62 @@ dlil_main_input_thread_func(void *v, wait_result_t w)
 	VERIFY(0);	/* we should never get here */
 }
 
+/*
+ * Input steering thread.  Like the main input thread it is shared by
+ * all interfaces, and takes packets that were steered to it by their
+ * driver flow ID (see dlil_input_steer.)
+ */
+__attribute__((noreturn))
+static void
+dlil_rxq_input_thread_func(void *v, wait_result_t w)
+{
+#pragma unused(w)
+	struct dlil_threading_info *inp = v;
+
+	VERIFY(inp != dlil_main_input_thread);
+	VERIFY(inp->ifp == NULL);
+	VERIFY(inp->mode == IFNET_MODEL_INPUT_POLL_OFF);
+
+	while (1) {
+		struct mbuf *m = NULL;
+		u_int32_t m_cnt;
+
+		lck_mtx_lock_spin(&inp->input_lck);
+
+		/* Wait until there is work to be done */
+		while (!(inp->input_waiting & ~DLIL_INPUT_RUNNING)) {
+			inp->input_waiting &= ~DLIL_INPUT_RUNNING;
+			(void) msleep(&inp->input_waiting, &inp->input_lck,
+			    (PZERO - 1) | PSPIN, inp->input_name, NULL);
+		}
+
+		inp->input_waiting |= DLIL_INPUT_RUNNING;
+		inp->input_waiting &= ~DLIL_INPUT_WAITING;
+
+		/*
+		 * Steering threads are never terminated, and protocol
+		 * registration and injection always use the main input
+		 * thread.
+		 */
+		VERIFY(!(inp->input_waiting & (DLIL_INPUT_TERMINATE |
+		    DLIL_PROTO_WAITING | DLIL_PROTO_REGISTER)));
+
+		m_cnt = qlen(&inp->rcvq_pkts);
+		m = _getq_all(&inp->rcvq_pkts, NULL, NULL, NULL);
+
+		inp->wtot = 0;
+
+		lck_mtx_unlock(&inp->input_lck);
+
+		if (m != NULL)
+			dlil_input_packet_list_extended(NULL, m,
+			    m_cnt, inp->mode);
+	}
+
+	/* NOTREACHED */
+	VERIFY(0);	/* we should never get here */
+}
+
 /*
  * Input thread for interfaces with legacy input model.
  */
@@ -2657,6 +2761,16 @@ dlil_input_handler(struct ifnet *ifp, struct mbuf *m_head,
 	u_int32_t m_cnt = s->packets_in;
 	u_int32_t m_size = s->bytes_in;
 
+	/*
+	 * Chains that the driver tagged with a flow ID bypass the
+	 * interface's input thread when steering is enabled; the
+	 * opportunistic polling model relies on its own thread.
+	 */
+	if (dlil_rxq_threads != 0 && dlil_rxq_steering && m_head != NULL &&
+	    !poll && ifp != lo_ifp && !(ifp->if_eflags & IFEF_RXPOLL) &&
+	    (m_head->m_pkthdr.pkt_flags & PKTF_DRIVER_MTAG))
+		return (dlil_input_steer(ifp, m_head, s));
+
 	if ((inp = ifp->if_inp) == NULL)
 		inp = dlil_main_input_thread;
 
@@ -2767,6 +2881,73 @@ dlil_input_handler(struct ifnet *ifp, struct mbuf *m_head,
 	return (0);
 }
 
+/*
+ * Split a chain of flow-tagged packets by flow ID across the input
+ * steering threads.  Packets of the chain without a tag go to the first
+ * steering thread.  The interface statistics are synchronized right
+ * away, as is done for the main input thread, since the steering threads
+ * are shared by all interfaces.
+ */
+static errno_t
+dlil_input_steer(struct ifnet *ifp, struct mbuf *m_head,
+    const struct ifnet_stat_increment_param *s)
+{
+	struct mbuf *heads[DLIL_RXQ_MAX], *tails[DLIL_RXQ_MAX];
+	u_int32_t cnts[DLIL_RXQ_MAX], sizes[DLIL_RXQ_MAX];
+	struct dlil_threading_info *inp;
+	u_int32_t nq = dlil_rxq_threads, q;
+	boolean_t stats = TRUE;
+	struct mbuf *m, *n;
+
+	bzero(heads, sizeof (heads));
+	bzero(cnts, sizeof (cnts));
+	bzero(sizes, sizeof (sizes));
+
+	for (m = m_head; m != NULL; m = n) {
+		n = mbuf_nextpkt(m);
+		mbuf_setnextpkt(m, NULL);
+
+		/* drv_flowid is 16 bits wide; scale it to the queue count */
+		if (m->m_pkthdr.pkt_flags & PKTF_DRIVER_MTAG)
+			q = ((u_int32_t)m->m_pkthdr.drv_flowid * nq) >> 16;
+		else
+			q = 0;
+
+		if (heads[q] == NULL)
+			heads[q] = m;
+		else
+			mbuf_setnextpkt(tails[q], m);
+		tails[q] = m;
+		cnts[q]++;
+		sizes[q] += m_pktlen(m);
+	}
+
+	for (q = 0; q < nq; q++) {
+		if (heads[q] == NULL)
+			continue;
+
+		inp = &dlil_rxq_input_thread_info[q];
+		lck_mtx_lock_spin(&inp->input_lck);
+		_addq_multi(&inp->rcvq_pkts, heads[q], tails[q],
+		    cnts[q], sizes[q]);
+		if (stats) {
+			dlil_input_stats_add(s, inp, FALSE);
+			dlil_input_stats_sync(ifp, inp);
+			stats = FALSE;
+		}
+		inp->input_waiting |= DLIL_INPUT_WAITING;
+		if (!(inp->input_waiting & DLIL_INPUT_RUNNING)) {
+			inp->wtot++;
+			wakeup_one((caddr_t)&inp->input_waiting);
+		}
+		lck_mtx_unlock(&inp->input_lck);
+
+		atomic_add_64(&ifp->if_data.ifi_rxq_packets[q], cnts[q]);
+	}
+
+	return (0);
+}
+
 
 static void
 ifnet_start_common(struct ifnet *ifp, boolean_t resetfc)
@@ -2813,7 +2994,7 @@ ifnet_start_thread_fn(void *v, wait_result_t w)
 	char thread_name[MAXTHREADNAMESIZE];
 	struct timespec *ts = NULL;
 	struct ifclassq *ifq = &ifp->if_snd;
-	struct timespec delay_start_ts;
+	struct timespec delay_start_ts, txtime_ts;
 
 	/* Construct the name for this thread, and then apply it. */
 	bzero(thread_name, sizeof(thread_name));
@@ -2943,6 +3124,23 @@ ifnet_start_thread_fn(void *v, wait_result_t w)
 			ts = &delay_start_ts;
 		}
 
+		/*
+		 * If the scheduler held paced packets back, wake up when
+		 * the earliest of them is due to leave.
+		 */
+		if (ts == NULL && ifq->ifcq_next_txtime != 0 &&
+		    !IFCQ_IS_EMPTY(ifq)) {
+			struct timespec now;
+			u_int64_t now_nsec, wait_nsec = 1;
+
+			nanouptime(&now);
+			net_timernsec(&now, &now_nsec);
+			if (ifq->ifcq_next_txtime > now_nsec)
+				wait_nsec = ifq->ifcq_next_txtime - now_nsec;
+			net_nsectimer(&wait_nsec, &txtime_ts);
+			ts = &txtime_ts;
+		}
+
 		if (ts != NULL && ts->tv_sec == 0 && ts->tv_nsec == 0)
 			ts = NULL;
 	}
@@ -4080,6 +4278,12 @@ next:
 			ifnet_decr_iorefcnt(ifp);
 	}
 
+#if INET
+	/* push up whatever TCP coalesced out of this batch */
+	if (sw_lro)
+		tcp_lro_flush();
+#endif /* INET */
+
 	KERNEL_DEBUG(DBG_FNC_DLIL_INPUT | DBG_FUNC_END, 0, 0, 0, 0, 0);
 }
 
@@ -5559,7 +5763,7 @@ ifnet_lookup(struct ifnet *ifp)
 {
 	struct ifnet *_ifp;
 
-	LCK_RW_ASSERT(&ifnet_head_lock, LCK_RW_ASSERT_HELD);
+	LCK_RM_ASSERT(&ifnet_head_lock, LCK_RM_ASSERT_HELD);
 	TAILQ_FOREACH(_ifp, &ifnet_head, if_link) {
 		if (_ifp == ifp)
 			break;
@@ -6039,7 +6243,7 @@ ifnet_attach(ifnet_t ifp, const struct sockaddr_dl *ll_addr)
 	struct dlil_ifnet *dl_if = (struct dlil_ifnet *)ifp;
 	struct dlil_threading_info *dl_inp;
 	u_int32_t sflags = 0;
-	int err;
+	int err, i;
 
 	if (ifp == NULL)
 		return (EINVAL);
@@ -6399,8 +6603,9 @@ ifnet_attach(ifnet_t ifp, const struct sockaddr_dl *ll_addr)
 	/* Enable forwarding cached route */
 	ifp->if_fwd_cacheok = 1;
 	/* Clean up any existing cached routes */
-	ROUTE_RELEASE(&ifp->if_fwd_route);
-	bzero(&ifp->if_fwd_route, sizeof (ifp->if_fwd_route));
+	for (i = 0; i < IF_FWD_ROUTE_CACHE_SIZE; i++)
+		ROUTE_RELEASE(&ifp->if_fwd_route[i]);
+	bzero(ifp->if_fwd_route, sizeof (ifp->if_fwd_route));
 	ROUTE_RELEASE(&ifp->if_src_route);
 	bzero(&ifp->if_src_route, sizeof (ifp->if_src_route));
 	ROUTE_RELEASE(&ifp->if_src_route6);
@@ -7102,8 +7307,9 @@ ifnet_detach_final(struct ifnet *ifp)
 	/* Last chance to cleanup any cached route */
 	lck_mtx_lock(&ifp->if_cached_route_lock);
 	VERIFY(!ifp->if_fwd_cacheok);
-	ROUTE_RELEASE(&ifp->if_fwd_route);
-	bzero(&ifp->if_fwd_route, sizeof (ifp->if_fwd_route));
+	for (i = 0; i < IF_FWD_ROUTE_CACHE_SIZE; i++)
+		ROUTE_RELEASE(&ifp->if_fwd_route[i]);
+	bzero(ifp->if_fwd_route, sizeof (ifp->if_fwd_route));
 	ROUTE_RELEASE(&ifp->if_src_route);
 	bzero(&ifp->if_src_route, sizeof (ifp->if_src_route));
 	ROUTE_RELEASE(&ifp->if_src_route6);
@@ -9140,6 +9346,8 @@ static struct {
 };
 #define	SUMTBL_MAX	((int)sizeof (sumtbl) / (int)sizeof (sumtbl[0]))
 
+static uint8_t sumcopy[sizeof (sumdata) + sizeof (uint64_t)];
+
 static void
 dlil_verify_sum16(void)
 {
@@ -9210,6 +9418,19 @@ dlil_verify_sum16(void)
 				    __func__, len, i, sum, sumr);
 				/* NOTREACHED */
 			}
+
+			/* Copy and sum test by offset (fixed data pointer) */
+			bzero(sumcopy, sizeof (sumcopy));
+			sum = m_copydata_sum(m, i, len, sumcopy + i);
+
+			/* Something is horribly broken; stop now */
+			if (sum != sumr || bcmp(sumcopy + i, c, len) != 0) {
+				panic_plain("\n%s: broken m_copydata_sum() for "
+				    "len=%d offset=%d sum=0x%04x "
+				    "[expected=0x%04x]\n", __func__, len, i,
+				    sum, sumr);
+				/* NOTREACHED */
+			}
 #if INET
 			/* Simple sum16 contiguous buffer test by aligment */
 			sum = b_sum16(c, len);
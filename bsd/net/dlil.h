@@ -144,6 +144,7 @@ struct sockaddr_dl;
 struct iff_filter;
 
 #define	DLIL_THREADNAME_LEN	32
+#define	DLIL_RXQ_MAX		IF_RXQ_MAX	/* max input steering threads */
 
 /*
  * DLIL input thread info
@@ -4856,6 +4856,8 @@ if_copy_traffic_class(struct ifnet *ifp,
 void
 if_copy_data_extended(struct ifnet *ifp, struct if_data_extended *if_de)
 {
+	int i;
+
 #define	COPY_IF_DE_FIELD64_ATOMIC(fld) do {			\
 	atomic_get_64(if_de->fld,				\
 	    (u_int64_t *)(void *)(uintptr_t)&ifp->if_data.fld);	\
@@ -4866,6 +4868,8 @@ if_copy_data_extended(struct ifnet *ifp, struct if_data_extended *if_de)
 	COPY_IF_DE_FIELD64_ATOMIC(ifi_dt_bytes);
 	COPY_IF_DE_FIELD64_ATOMIC(ifi_fpackets);
 	COPY_IF_DE_FIELD64_ATOMIC(ifi_fbytes);
+	for (i = 0; i < IF_RXQ_MAX; i++)
+		COPY_IF_DE_FIELD64_ATOMIC(ifi_rxq_packets[i]);
 
 #undef COPY_IF_DE_FIELD64_ATOMIC
 }
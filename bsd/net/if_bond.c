@@ -1360,6 +1360,62 @@ S_mbuf_copy_uint32(struct mbuf * m, int32_t offset, uint32_t * val)
 #define IP_SRC_OFFSET (offsetof(struct ip, ip_src) - offsetof(struct ip, ip_p))
 #define IP_DST_OFFSET (offsetof(struct ip, ip_dst) - offsetof(struct ip, ip_p))
 
+/*
+ * Fold the TCP/UDP ports into the hash so that the flows between a
+ * single pair of hosts, e.g. a file server and a busy client, spread
+ * across the links instead of all hashing to the same port.  Packets
+ * without ports, including all IP fragments, contribute 0 so that every
+ * packet of a flow still lands on the same link.
+ */
+static uint32_t
+ip_ports_hash(struct mbuf * m)
+{
+    uint32_t		hl_word;
+    uint32_t		off_word;
+    int32_t		offset;
+    uint32_t		ports;
+
+    offset = sizeof(struct ether_header);
+    if (S_mbuf_copy_uint32(m, offset, &hl_word)
+	|| S_mbuf_copy_uint32(m, offset + sizeof(uint32_t), &off_word)) {
+	return (0);
+    }
+    if ((ntohl(off_word) & (IP_MF | IP_OFFMASK)) != 0) {
+	return (0);
+    }
+    offset += ((ntohl(hl_word) >> 24) & 0x0f) << 2;
+    if (S_mbuf_copy_uint32(m, offset, &ports)) {
+	return (0);
+    }
+    ports = ntohl(ports);
+    /* bond_output() keeps the low bits; mix in the source port */
+    return (ports ^ (ports >> 16));
+}
+
+static uint32_t
+ipv6_ports_hash(struct mbuf * m)
+{
+    uint32_t		nxt_word;
+    uint32_t		ports;
+    u_char		nxt;
+
+    if (S_mbuf_copy_uint32(m, sizeof(struct ether_header)
+			   + offsetof(struct ip6_hdr, ip6_plen), &nxt_word)) {
+	return (0);
+    }
+    nxt = (ntohl(nxt_word) >> 8) & 0xff;
+    if (nxt != IPPROTO_TCP && nxt != IPPROTO_UDP) {
+	return (0);
+    }
+    if (S_mbuf_copy_uint32(m, sizeof(struct ether_header)
+			   + sizeof(struct ip6_hdr), &ports)) {
+	return (0);
+    }
+    ports = ntohl(ports);
+    /* bond_output() keeps the low bits; mix in the source port */
+    return (ports ^ (ports >> 16));
+}
+
 static uint32_t
 ip_header_hash(struct mbuf * m)
 {
@@ -1396,6 +1452,10 @@ ip_header_hash(struct mbuf * m)
 	    goto bad_ip_packet;
 	}
     }
+    if (ip_p == IPPROTO_TCP || ip_p == IPPROTO_UDP) {
+	return (ntohl(ip_dst.s_addr) ^ ntohl(ip_src.s_addr) ^ ((uint32_t)ip_p)
+		^ ip_ports_hash(orig_m));
+    }
     return (ntohl(ip_dst.s_addr) ^ ntohl(ip_src.s_addr) ^ ((uint32_t)ip_p));
 
  bad_ip_packet:
@@ -1439,7 +1499,7 @@ ipv6_header_hash(struct mbuf * m)
 	    val ^= tmp;
 	}
     }
-    return (ntohl(val));
+    return (ntohl(val) ^ ipv6_ports_hash(orig_m));
 
  bad_ipv6_packet:
     return (ether_header_hash(mtod(orig_m, struct ether_header *)));
@@ -1777,7 +1777,11 @@ bridge_set_tso(struct bridge_softc *sc)
 	tso_v4_mtu = IP_MAXPACKET;
 	tso_v6_mtu = IP_MAXPACKET;
 
-	/* Use the lowest common denominator of the members */
+	/*
+	 * Use the lowest common denominator of the members; those without
+	 * TSO get their frames segmented in software by bridge_enqueue(),
+	 * unless that is disabled.
+	 */
 	TAILQ_FOREACH(bif, &sc->sc_iflist, bif_next) {
 		ifnet_t ifp = bif->bif_ifp;
 
@@ -1788,7 +1792,7 @@ bridge_set_tso(struct bridge_softc *sc)
 			if (ifp->if_hwassist & IFNET_TSO_IPV4) {
 				if (tso_v4_mtu > ifp->if_tso_v4_mtu)
 					tso_v4_mtu = ifp->if_tso_v4_mtu;
-			} else {
+			} else if (!sw_offload_tx) {
 				offload &= ~IFNET_TSO_IPV4;
 				tso_v4_mtu = 0;
 			}
@@ -1797,7 +1801,7 @@ bridge_set_tso(struct bridge_softc *sc)
 			if (ifp->if_hwassist & IFNET_TSO_IPV6) {
 				if (tso_v6_mtu > ifp->if_tso_v6_mtu)
 					tso_v6_mtu = ifp->if_tso_v6_mtu;
-			} else {
+			} else if (!sw_offload_tx) {
 				offload &= ~IFNET_TSO_IPV6;
 				tso_v6_mtu = 0;
 			}
@@ -3801,6 +3805,26 @@ bridge_enqueue(struct bridge_softc *sc, struct ifnet *dst_ifp, struct mbuf *m)
 		m0 = m->m_nextpkt;
 		m->m_nextpkt = NULL;
 
+		/*
+		 * The bridge advertises TSO even when this member lacks it;
+		 * segment here and send the segments ahead of the rest.
+		 */
+		if (TSO_IPV4_NOTOK(dst_ifp, m) || TSO_IPV6_NOTOK(dst_ifp, m)) {
+			struct mbuf *n;
+
+			m = if_sw_offload(m, sizeof (struct ether_header));
+			if (m == NULL) {
+				(void) ifnet_stat_increment_out(sc->sc_ifp,
+				    0, 0, 1);
+				continue;
+			}
+			for (n = m; n->m_nextpkt != NULL; n = n->m_nextpkt)
+				;
+			n->m_nextpkt = m0;
+			m0 = m->m_nextpkt;
+			m->m_nextpkt = NULL;
+		}
+
 		len = m->m_pkthdr.len;
 		mflags = m->m_flags;
 		m->m_flags |= M_PROTO1; /* set to avoid loops */
@@ -4694,7 +4718,7 @@ bridge_broadcast(struct bridge_softc *sc, struct ifnet *src_if,
 	struct bridge_iflist *dbif, *sbif;
 	struct mbuf *mc;
 	struct ifnet *dst_if;
-	int error = 0, used = 0;
+	int error = 0, used = 0, shared = 1;
 
 	sbif = bridge_lookup_member_if(sc, src_if);
 
@@ -4712,8 +4736,24 @@ bridge_broadcast(struct bridge_softc *sc, struct ifnet *src_if,
 		if (m == NULL)
 			goto out;
 	}
+
+	/* The output filters may rewrite the frame; give each its own copy */
+	if (runfilt && (PFIL_HOOKED(&inet_pfil_hook) || PFIL_HOOKED_INET6))
+		shared = 0;
 #endif /* PFIL_HOOKS */
 
+	/*
+	 * Members share the frame's clusters rather than each getting a
+	 * deep copy.  bridge_enqueue() would otherwise finalize checksums
+	 * into the shared data according to each member's offload
+	 * capabilities, so compute them in software once, up front.
+	 * TSO frames are left to be segmented per member.
+	 */
+	if (m->m_pkthdr.csum_flags & (CSUM_TSO_IPV4 | CSUM_TSO_IPV6))
+		shared = 0;
+	if (shared)
+		bridge_finalize_cksum(NULL, m);
+
 	TAILQ_FOREACH(dbif, &sc->sc_iflist, bif_next) {
 		dst_if = dbif->bif_ifp;
 		if (dst_if == src_if)
@@ -4743,7 +4783,10 @@ bridge_broadcast(struct bridge_softc *sc, struct ifnet *src_if,
 			mc = m;
 			used = 1;
 		} else {
-			mc = m_dup(m, M_DONTWAIT);
+			if (shared)
+				mc = m_copypacket(m, M_DONTWAIT);
+			else
+				mc = m_dup(m, M_DONTWAIT);
 			if (mc == NULL) {
 				(void) ifnet_stat_increment_out(sc->sc_ifp,
 				    0, 0, 1);
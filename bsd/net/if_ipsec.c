@@ -34,6 +34,7 @@
 #include <sys/socket.h>
 #include <sys/socketvar.h>
 #include <net/if.h>
+#include <net/if_var.h>
 #include <net/if_types.h>
 #include <net/bpf.h>
 #include <net/if_ipsec.h>
@@ -77,6 +78,7 @@ static errno_t	ipsec_ctl_setopt(kern_ctl_ref kctlref, u_int32_t unit, void *unit
 /* Network Interface functions */
 static void     ipsec_start(ifnet_t	interface);
 static errno_t	ipsec_output(ifnet_t interface, mbuf_t data);
+static errno_t	ipsec_output_list(ifnet_t interface, mbuf_t data);
 static errno_t	ipsec_demux(ifnet_t interface, mbuf_t data, char *frame_header,
 							protocol_family_t *protocol);
 static errno_t	ipsec_add_proto(ifnet_t interface, protocol_family_t protocol,
@@ -2320,6 +2322,16 @@ ipsec_ctl_connect(kern_ctl_ref kctlref,
 		}
 		ipsec_ifnet_set_attrs(pcb->ipsec_ifp);
 
+		/*
+		 * Take TSO sized frames and deferred checksums from the stack;
+		 * ipsec_output() segments and checksums them ahead of encryption.
+		 */
+		if (sw_offload_tx) {
+			ifnet_set_offload(pcb->ipsec_ifp, IF_SW_OFFLOAD_FLAGS);
+			ifnet_set_tso_mtu(pcb->ipsec_ifp, AF_INET, IP_MAXPACKET);
+			ifnet_set_tso_mtu(pcb->ipsec_ifp, AF_INET6, IP_MAXPACKET);
+		}
+
 		/* Attach the interface */
 		result = ifnet_attach(pcb->ipsec_ifp, NULL);
 		if (result != 0) {
@@ -3075,6 +3087,16 @@ ipsec_output(ifnet_t interface,
     int flags = 0;
     struct flowadv *adv = NULL;
     
+	// Segment TSO frames and fill in deferred checksums before encryption
+	data = if_sw_offload(data, 0);
+	if (data == NULL) {
+		error = ENOBUFS;
+		goto ipsec_output_err;
+	}
+	if (mbuf_nextpkt(data) != NULL) {
+		return ipsec_output_list(interface, data);
+	}
+
 	// Make sure this packet isn't looping through the interface
 	if (necp_get_last_interface_index_from_packet(data) == interface->if_index) {
 		error = EINVAL;
@@ -3247,6 +3269,29 @@ ipsec_output_err:
 	goto done;
 }
 
+/*
+ * Encrypt and send the segments of a TSO frame back to back; a flow
+ * control advisory on one of them does not hold back the others.
+ */
+static errno_t
+ipsec_output_list(ifnet_t interface,
+				  mbuf_t data)
+{
+	mbuf_t next;
+	errno_t error = 0, result;
+
+	for (; data != NULL; data = next) {
+		next = mbuf_nextpkt(data);
+		mbuf_setnextpkt(data, NULL);
+		result = ipsec_output(interface, data);
+		if (result != 0) {
+			error = result;
+		}
+	}
+
+	return error;
+}
+
 static void
 ipsec_start(ifnet_t	interface)
 {
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+/*
+ * Software transmit offload for virtual interfaces.
+ *
+ * Interfaces such as utun and ipsec hand their packets to a user space
+ * client or to the encryption code rather than to a NIC, and bridge
+ * members may lack TSO.  Such interfaces can still advertise TSO and
+ * checksum offload: the stack then builds one large frame per burst,
+ * and the interface segments and checksums it here, once and late,
+ * right before the packets leave.  Headers are rebuilt per segment
+ * while the payload is shared by reference with the original frame,
+ * and checksums are computed with m_sum16(), which is backed by the
+ * optimized cpu_in_cksum() routines.
+ */
+
+#define	_IP_VHL
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/kernel.h>
+#include <sys/mbuf.h>
+#include <sys/sysctl.h>
+
+#include <libkern/OSAtomic.h>
+
+#include <net/if.h>
+#include <net/if_var.h>
+
+#include <netinet/in.h>
+#include <netinet/in_systm.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#if INET6
+#include <netinet/ip6.h>
+#endif /* INET6 */
+
+SYSCTL_DECL(_net_link_generic_system);
+
+uint32_t sw_offload_tx = 1;
+SYSCTL_UINT(_net_link_generic_system, OID_AUTO, sw_offload_tx,
+    CTLFLAG_RW | CTLFLAG_LOCKED, &sw_offload_tx, 0,
+    "advertise software TSO and checksum offload on virtual interfaces");
+
+static uint64_t sw_offload_tso_frames = 0;
+SYSCTL_QUAD(_net_link_generic_system, OID_AUTO, sw_offload_tso_frames,
+    CTLFLAG_RD | CTLFLAG_LOCKED, &sw_offload_tso_frames,
+    "TSO frames segmented in software");
+
+static uint64_t sw_offload_tso_segments = 0;
+SYSCTL_QUAD(_net_link_generic_system, OID_AUTO, sw_offload_tso_segments,
+    CTLFLAG_RD | CTLFLAG_LOCKED, &sw_offload_tso_segments,
+    "segments produced by software TSO");
+
+static struct mbuf *if_sw_cksum(struct mbuf *, uint32_t, int);
+static struct mbuf *if_sw_tso(struct mbuf *, uint32_t, int);
+
+/*
+ * Fill in the checksums deferred on a packet that needs no segmenting.
+ */
+static struct mbuf *
+if_sw_cksum(struct mbuf *m, uint32_t hoff, int af)
+{
+	if (af == AF_INET) {
+		(void) in_finalize_cksum(m, hoff,
+		    CSUM_DELAY_IP | CSUM_DELAY_DATA);
+	}
+#if INET6
+	else {
+		(void) in6_finalize_cksum(m, hoff, -1, -1,
+		    CSUM_DELAY_IPV6_DATA);
+	}
+#endif /* INET6 */
+	m->m_pkthdr.csum_flags &= ~(CSUM_TSO_IPV4 | CSUM_TSO_IPV6);
+
+	return (m);
+}
+
+/*
+ * Split a TCP frame marked for TSO into tso_segsz sized segments,
+ * starting hoff bytes into the frame (link or tunnel header, copied
+ * as is into every segment.)  The segments are fully checksummed and
+ * returned as a list linked through m_nextpkt; the original frame is
+ * consumed.  Returns NULL if memory could not be allocated.
+ */
+static struct mbuf *
+if_sw_tso(struct mbuf *m, uint32_t hoff, int af)
+{
+	struct mbuf *head = NULL, **tail = &head, *n;
+	struct tcphdr th, *thp;
+	uint32_t iphlen = 0, thlen, hdrlen, segsz, off, len, pad;
+	uint16_t ip_id = 0, sum;
+	tcp_seq seq;
+	int i;
+
+	if (af == AF_INET) {
+		struct ip ip;
+
+		if (m->m_pkthdr.len < (int32_t)(hoff + sizeof (ip)))
+			goto bad;
+		m_copydata(m, hoff, sizeof (ip), (caddr_t)&ip);
+		iphlen = IP_VHL_HL(ip.ip_vhl) << 2;
+		if (ip.ip_p != IPPROTO_TCP || iphlen < sizeof (ip))
+			goto bad;
+		ip_id = ntohs(ip.ip_id);
+	}
+#if INET6
+	else {
+		struct ip6_hdr ip6;
+
+		if (m->m_pkthdr.len < (int32_t)(hoff + sizeof (ip6)))
+			goto bad;
+		m_copydata(m, hoff, sizeof (ip6), (caddr_t)&ip6);
+		if (ip6.ip6_nxt != IPPROTO_TCP)
+			goto bad;
+		iphlen = sizeof (ip6);
+	}
+#endif /* INET6 */
+
+	if (m->m_pkthdr.len < (int32_t)(hoff + iphlen + sizeof (th)))
+		goto bad;
+	m_copydata(m, hoff + iphlen, sizeof (th), (caddr_t)&th);
+	thlen = th.th_off << 2;
+	hdrlen = hoff + iphlen + thlen;
+	if (thlen < sizeof (th) || m->m_pkthdr.len < (int32_t)hdrlen)
+		goto bad;
+
+	segsz = m->m_pkthdr.tso_segsz;
+	if (m->m_pkthdr.len - hdrlen <= segsz)
+		return (if_sw_cksum(m, hoff, af));
+
+	/* keep the IP header of every segment 32-bit aligned */
+	pad = (4 - (hoff & 3)) & 3;
+	seq = ntohl(th.th_seq);
+
+	for (off = hdrlen, i = 0; off < (uint32_t)m->m_pkthdr.len;
+	    off += len, i++) {
+		len = min(segsz, m->m_pkthdr.len - off);
+
+		if (pad + hdrlen <= MHLEN)
+			n = m_gethdr(M_DONTWAIT, MT_HEADER);
+		else
+			n = m_getcl(M_DONTWAIT, MT_DATA, M_PKTHDR);
+		if (n == NULL)
+			goto nobufs;
+		n->m_data += pad;
+		m_copydata(m, 0, hdrlen, mtod(n, caddr_t));
+		n->m_len = hdrlen;
+		n->m_next = m_copym(m, off, len, M_DONTWAIT);
+		if (n->m_next == NULL) {
+			(void) m_free(n);
+			goto nobufs;
+		}
+		n->m_pkthdr.len = hdrlen + len;
+		n->m_pkthdr.rcvif = NULL;
+		n->m_pkthdr.csum_flags = 0;
+		M_COPY_CLASSIFIER(n, m);
+		M_COPY_PFTAG(n, m);
+		n->m_pkthdr.necp_mtag = m->m_pkthdr.necp_mtag;
+
+		thp = (struct tcphdr *)(void *)(mtod(n, caddr_t) +
+		    hoff + iphlen);
+		thp->th_seq = htonl(seq + (off - hdrlen));
+		if (i != 0)
+			thp->th_flags &= ~TH_CWR;
+		if (off + len < (uint32_t)m->m_pkthdr.len)
+			thp->th_flags &= ~(TH_FIN | TH_PUSH);
+		thp->th_sum = 0;
+
+		if (af == AF_INET) {
+			struct ip *ip;
+
+			ip = (struct ip *)(void *)(mtod(n, caddr_t) + hoff);
+			ip->ip_len = htons(iphlen + thlen + len);
+			ip->ip_id = htons(ip_id + i);
+			ip->ip_sum = 0;
+			ip->ip_sum = in_cksum_hdr_opt(ip);
+			sum = in_pseudo(ip->ip_src.s_addr, ip->ip_dst.s_addr,
+			    htonl(thlen + len + IPPROTO_TCP));
+		}
+#if INET6
+		else {
+			struct ip6_hdr *ip6;
+
+			ip6 = (struct ip6_hdr *)(void *)(mtod(n, caddr_t) +
+			    hoff);
+			ip6->ip6_plen = htons(thlen + len);
+			sum = in6_pseudo(&ip6->ip6_src, &ip6->ip6_dst,
+			    htonl(thlen + len + IPPROTO_TCP));
+		}
+#endif /* INET6 */
+		sum = in_addword(sum, m_sum16(n, hoff + iphlen, thlen + len));
+		thp->th_sum = ~sum & 0xffff;
+
+		*tail = n;
+		tail = &n->m_nextpkt;
+	}
+
+	OSIncrementAtomic64((SInt64 *)&sw_offload_tso_frames);
+	OSAddAtomic64(i, (SInt64 *)&sw_offload_tso_segments);
+	m_freem(m);
+	return (head);
+
+nobufs:
+	if (head != NULL)
+		m_freem_list(head);
+bad:
+	m_freem(m);
+	return (NULL);
+}
+
+/*
+ * Complete in software the transmit offload work the stack deferred
+ * to an interface advertising IF_SW_OFFLOAD_FLAGS.  The IP header
+ * starts hoff bytes into the packet.  Returns either the packet with
+ * its checksums filled in, or, for a TSO frame, the list of segments
+ * linked through m_nextpkt; NULL if the packet had to be dropped.
+ */
+struct mbuf *
+if_sw_offload(struct mbuf *m, uint32_t hoff)
+{
+	uint32_t csum_flags = m->m_pkthdr.csum_flags;
+	uint8_t vhl;
+
+	if (!(csum_flags & (CSUM_DELAY_IP | CSUM_DELAY_DATA |
+	    CSUM_DELAY_IPV6_DATA | CSUM_TSO_IPV4 | CSUM_TSO_IPV6)))
+		return (m);
+	if (m->m_pkthdr.len < (int32_t)(hoff + sizeof (vhl)))
+		return (m);
+
+	m_copydata(m, hoff, sizeof (vhl), (caddr_t)&vhl);
+	switch (vhl >> 4) {
+	case IPVERSION:
+		if ((csum_flags & CSUM_TSO_IPV4) && m->m_pkthdr.tso_segsz != 0)
+			return (if_sw_tso(m, hoff, AF_INET));
+		return (if_sw_cksum(m, hoff, AF_INET));
+#if INET6
+	case (IPV6_VERSION >> 4):
+		if ((csum_flags & CSUM_TSO_IPV6) && m->m_pkthdr.tso_segsz != 0)
+			return (if_sw_tso(m, hoff, AF_INET6));
+		return (if_sw_cksum(m, hoff, AF_INET6));
+#endif /* INET6 */
+	default:
+		break;
+	}
+	m->m_pkthdr.csum_flags &= ~(CSUM_TSO_IPV4 | CSUM_TSO_IPV6);
+
+	return (m);
+}
@@ -42,6 +42,7 @@ This kernel control will register an interface for every client that connects.
 #include <net/kpi_interface.h>
 #include <sys/socket.h>
 #include <net/if.h>
+#include <net/if_var.h>
 #include <net/if_types.h>
 #include <net/bpf.h>
 #include <net/if_utun.h>
@@ -140,6 +141,7 @@ static errno_t	utun_framer(ifnet_t interface, mbuf_t *packet,
 							const struct sockaddr *dest, const char *desk_linkaddr,
 							const char *frame_type, u_int32_t *prepend_len, u_int32_t *postpend_len);
 static errno_t	utun_output(ifnet_t interface, mbuf_t data);
+static errno_t	utun_output_list(struct utun_pcb *pcb, ifnet_t interface, mbuf_t data);
 static errno_t	utun_demux(ifnet_t interface, mbuf_t data, char *frame_header,
 						   protocol_family_t *protocol);
 static errno_t	utun_add_proto(ifnet_t interface, protocol_family_t protocol,
@@ -1614,6 +1616,16 @@ utun_ctl_connect(kern_ctl_ref kctlref,
 		ifnet_set_mtu(pcb->utun_ifp, UTUN_DEFAULT_MTU);
 		ifnet_set_flags(pcb->utun_ifp, IFF_UP | IFF_MULTICAST | IFF_POINTOPOINT, 0xffff);
 
+		/*
+		 * Take TSO sized frames and deferred checksums from the stack;
+		 * utun_output() segments and checksums them in software.
+		 */
+		if (sw_offload_tx) {
+			ifnet_set_offload(pcb->utun_ifp, IF_SW_OFFLOAD_FLAGS);
+			ifnet_set_tso_mtu(pcb->utun_ifp, AF_INET, IP_MAXPACKET);
+			ifnet_set_tso_mtu(pcb->utun_ifp, AF_INET6, IP_MAXPACKET);
+		}
+
 		/* The interface must generate its own IPv6 LinkLocal address,
 		 * if possible following the recommendation of RFC2472 to the 64bit interface ID
 		 */
@@ -2453,6 +2465,20 @@ utun_output(ifnet_t	interface,
 	if (pcb->utun_ctlref) {
 		int	length;
 
+		data = if_sw_offload(data, UTUN_HEADER_SIZE(pcb));
+		if (data == NULL) {
+#if UTUN_NEXUS
+			if (!pcb->utun_use_netif)
+#endif // UTUN_NEXUS
+			{
+				ifnet_stat_increment_out(interface, 0, 0, 1);
+			}
+			return 0;
+		}
+		if (mbuf_nextpkt(data) != NULL) {
+			return utun_output_list(pcb, interface, data);
+		}
+
 		/*
 		 * The ABI requires the protocol in network byte order
 		 */
@@ -2488,6 +2514,54 @@ utun_output(ifnet_t	interface,
 	return 0;
 }
 
+/*
+ * Hand the segments of a TSO frame to the client as one batch, taking
+ * the socket lock and waking up the reader once for all of them.
+ */
+static errno_t
+utun_output_list(struct utun_pcb *pcb,
+				 ifnet_t interface,
+				 mbuf_t data)
+{
+	mbuf_t m, remain = NULL;
+	u_int32_t packets = 0, bytes = 0, drops = 0;
+	errno_t result;
+
+	for (m = data; m != NULL; m = mbuf_nextpkt(m)) {
+		/*
+		 * The ABI requires the protocol in network byte order
+		 */
+		*(u_int32_t *)mbuf_data(m) = htonl(*(u_int32_t *)mbuf_data(m));
+		packets++;
+		bytes += mbuf_pkthdr_len(m);
+	}
+
+	result = ctl_enqueuembuf_list(pcb->utun_ctlref, pcb->utun_unit, data, 0, &remain);
+	if (result != 0) {
+		printf("utun_output_list - ctl_enqueuembuf_list failed: %d\n", result);
+	}
+	for (m = remain; m != NULL; m = mbuf_nextpkt(m)) {
+		packets--;
+		bytes -= mbuf_pkthdr_len(m);
+		drops++;
+	}
+	if (remain != NULL) {
+		mbuf_freem_list(remain);
+	}
+
+#if UTUN_NEXUS
+	if (!pcb->utun_use_netif)
+#endif // UTUN_NEXUS
+	{
+		if (pcb->utun_ext_ifdata_stats) {
+			packets = bytes = 0;
+		}
+		ifnet_stat_increment_out(interface, packets, bytes, drops);
+	}
+
+	return 0;
+}
+
 static errno_t
 utun_demux(__unused ifnet_t interface,
 		   mbuf_t data,
@@ -249,12 +249,15 @@ struct if_traffic_class {
 	u_int64_t		ifi_opvbytes;	/* TC priv bytes sent on interface */
 };
 
+#define	IF_RXQ_MAX	8	/* max input steering queues */
+
 struct if_data_extended {
 	u_int64_t	ifi_alignerrs;	/* unaligned (32-bit) input pkts */
 	u_int64_t	ifi_dt_bytes;	/* Data threshold counter */
 	u_int64_t	ifi_fpackets;	/* forwarded packets on interface */
 	u_int64_t	ifi_fbytes;	/* forwarded bytes on interface */
-	u_int64_t	reserved[12];	/* for future */
+	u_int64_t	ifi_rxq_packets[IF_RXQ_MAX]; /* pkts per steering queue */
+	u_int64_t	reserved[12 - IF_RXQ_MAX];	/* for future */
 };
 
 struct if_packet_stats {
@@ -689,6 +692,7 @@ struct if_data_internal {
 	u_int64_t	ifi_dt_bytes;	/* Data threshold counter */
 	u_int64_t	ifi_fpackets;	/* forwarded packets on interface */
 	u_int64_t	ifi_fbytes;	/* forwarded bytes on interface */
+	u_int64_t	ifi_rxq_packets[IF_RXQ_MAX]; /* pkts per steering queue */
 	struct	timeval ifi_lastchange;	/* time of last administrative change */
 	struct	timeval ifi_lastupdown;	/* time of last up/down event */
 	u_int32_t	ifi_hwassist;	/* HW offload capabilities */
@@ -819,6 +823,13 @@ typedef errno_t (*dlil_input_func)(ifnet_t ifp, mbuf_t m_head,
 typedef errno_t (*dlil_output_func)(ifnet_t interface, mbuf_t data);
 
 #define	if_name(ifp)	ifp->if_xname
+
+/*
+ * Number of IPv4 forwarding routes cached per receiving interface;
+ * ip_forward() picks the slot by hashing the destination address.
+ */
+#define	IF_FWD_ROUTE_CACHE_SIZE	16
+
 /*
  * Structure defining a network interface.
  *
@@ -953,7 +964,8 @@ struct ifnet {
 
 	decl_lck_mtx_data(, if_cached_route_lock);
 	u_int32_t		if_fwd_cacheok;
-	struct route		if_fwd_route;	/* cached forwarding route */
+	struct route		if_fwd_route[IF_FWD_ROUTE_CACHE_SIZE];
+						/* cached forwarding routes */
 	struct route		if_src_route;	/* cached ipv4 source route */
 	struct route_in6	if_src_route6;	/* cached ipv6 source route */
 
@@ -1826,6 +1838,18 @@ extern int if_low_power_restricted;
 extern void if_low_power_evhdlr_init(void);
 extern int if_set_low_power(struct ifnet *, bool);
 
+/*
+ * Transmit offload that virtual interfaces advertise and complete in
+ * software with if_sw_offload(); see if_sw_offload.c.
+ */
+#define	IF_SW_OFFLOAD_FLAGS						\
+	(IFNET_CSUM_IP | IFNET_CSUM_TCP | IFNET_CSUM_UDP |		\
+	IFNET_CSUM_TCPIPV6 | IFNET_CSUM_UDPIPV6 |			\
+	IFNET_TSO_IPV4 | IFNET_TSO_IPV6)
+
+extern uint32_t sw_offload_tx;
+extern struct mbuf *if_sw_offload(struct mbuf *, uint32_t);
+
 #endif /* BSD_KERNEL_PRIVATE */
 #ifdef XNU_KERNEL_PRIVATE
 /* for uuid.c */
@@ -141,6 +141,11 @@ u_int32_t necp_debug = 0; // 0=None, 1=Basic, 2=EveryMatch
 
 u_int32_t necp_session_count = 0;
 
+// Socket policy matching statistics, updated under the shared policy lock
+static u_int64_t necp_socket_policy_evaluations = 0;
+static u_int64_t necp_socket_policy_checks = 0;
+static u_int64_t necp_socket_policy_cache_hits = 0;
+
 #define	LIST_INSERT_SORTED_ASCENDING(head, elm, field, sortfield, tmpelm) do {		\
 	if (LIST_EMPTY((head)) || (LIST_FIRST(head)->sortfield >= (elm)->sortfield)) {	\
 		LIST_INSERT_HEAD((head), elm, field);										\
@@ -444,6 +449,9 @@ SYSCTL_LONG(_net_necp, NECPCTL_SOCKET_POLICY_COUNT, socket_policy_count, CTLFLAG
 SYSCTL_LONG(_net_necp, NECPCTL_SOCKET_NON_APP_POLICY_COUNT, socket_non_app_policy_count, CTLFLAG_LOCKED | CTLFLAG_RD, &necp_kernel_socket_policies_non_app_count, "");
 SYSCTL_LONG(_net_necp, NECPCTL_IP_POLICY_COUNT, ip_policy_count, CTLFLAG_LOCKED | CTLFLAG_RD, &necp_kernel_ip_output_policies_count, "");
 SYSCTL_INT(_net_necp, NECPCTL_SESSION_COUNT, session_count, CTLFLAG_LOCKED | CTLFLAG_RD, &necp_session_count, 0, "");
+SYSCTL_QUAD(_net_necp, NECPCTL_SOCKET_POLICY_EVALUATIONS, socket_policy_evaluations, CTLFLAG_LOCKED | CTLFLAG_RD, &necp_socket_policy_evaluations, "");
+SYSCTL_QUAD(_net_necp, NECPCTL_SOCKET_POLICY_CHECKS, socket_policy_checks, CTLFLAG_LOCKED | CTLFLAG_RD, &necp_socket_policy_checks, "");
+SYSCTL_QUAD(_net_necp, NECPCTL_SOCKET_POLICY_CACHE_HITS, socket_policy_cache_hits, CTLFLAG_LOCKED | CTLFLAG_RD, &necp_socket_policy_cache_hits, "");
 
 // Session order allocation
 static u_int32_t
@@ -7297,7 +7305,7 @@ necp_socket_find_policy_match_with_info_locked(struct necp_kernel_socket_policy
 	u_int32_t skip_session_order = 0;
 	u_int32_t route_rule_id_array[MAX_AGGREGATE_ROUTE_RULES];
 	size_t route_rule_id_count = 0;
-	int i;
+	int i = 0;
 	size_t netagent_cursor = 0;
 
 	// Pre-process domain for quick matching
@@ -7414,6 +7422,9 @@ necp_socket_find_policy_match_with_info_locked(struct necp_kernel_socket_policy
 		}
 	}
 
+	OSIncrementAtomic64((SInt64 *)&necp_socket_policy_evaluations);
+	OSAddAtomic64(i + (matched_policy != NULL), (SInt64 *)&necp_socket_policy_checks);
+
 	if (route_rule_id_count == 1) {
 		*return_route_rule_id = route_rule_id_array[0];
 	} else if (route_rule_id_count > 1) {
@@ -7569,6 +7580,7 @@ necp_socket_find_policy_match(struct inpcb *inp, struct sockaddr *override_local
 		inp->inp_policyresult.policy_gencount == necp_kernel_socket_policies_gencount &&
 		inp->inp_policyresult.flowhash == flowhash) {
 		// If already matched this socket on this generation of table, skip
+		OSIncrementAtomic64((SInt64 *)&necp_socket_policy_cache_hits);
 
 		// Unlock
 		lck_rw_done(&necp_kernel_policy_lock);
@@ -8812,6 +8824,7 @@ necp_socket_is_allowed_to_send_recv_internal(struct inpcb *inp, struct sockaddr
 	if (inp->inp_policyresult.policy_id != NECP_KERNEL_POLICY_ID_NONE &&
 		inp->inp_policyresult.policy_gencount == necp_kernel_socket_policies_gencount &&
 		inp->inp_policyresult.flowhash == flowhash) {
+		OSIncrementAtomic64((SInt64 *)&necp_socket_policy_cache_hits);
 		if (inp->inp_policyresult.results.result == NECP_KERNEL_POLICY_RESULT_DROP ||
 			inp->inp_policyresult.results.result == NECP_KERNEL_POLICY_RESULT_SOCKET_DIVERT ||
 			(inp->inp_policyresult.results.result == NECP_KERNEL_POLICY_RESULT_IP_TUNNEL && interface &&
@@ -758,6 +758,9 @@ extern int necp_buffer_find_tlv(u_int8_t *buffer, u_int32_t buffer_length, int o
 #define	NECPCTL_OBSERVER_FD_COUNT			15	/* Count of NECP observer fds */
 #define	NECPCTL_OBSERVER_MESSAGE_LIMIT		16	/* Number of of NECP observer messages allowed to be queued */
 #define	NECPCTL_SYSCTL_ARENA_COUNT			17	/* Count of sysctl arenas */
+#define	NECPCTL_SOCKET_POLICY_EVALUATIONS	18	/* Count of socket policy table walks */
+#define	NECPCTL_SOCKET_POLICY_CHECKS		19	/* Count of socket policies checked during table walks */
+#define	NECPCTL_SOCKET_POLICY_CACHE_HITS	20	/* Count of socket matches answered from the cached result */
 
 #define	NECPCTL_NAMES {					\
 	{ 0, 0 },							\
@@ -214,6 +214,7 @@ typedef struct nstat_src
 	nstat_provider_cookie_t		cookie;
 	uint32_t			filter;
 	uint64_t			seq;
+	uint64_t			ns_reported;		// Activity of the counts last reported, 0 if none
 } nstat_src;
 
 static errno_t		nstat_control_send_counts(nstat_control_state *,
@@ -3979,10 +3980,47 @@ nstat_control_send_counts(
 	return result;
 }
 
+/*
+ * The counters summed here only ever grow, so the sum changes whenever
+ * any of them does; it is offset by one so that 0 means never reported.
+ */
+static u_int64_t
+nstat_counts_activity(
+	const nstat_counts	*counts)
+{
+	return (1 + counts->nstat_rxpackets + counts->nstat_rxbytes +
+	    counts->nstat_txpackets + counts->nstat_txbytes +
+	    counts->nstat_txretransmit + counts->nstat_connectattempts +
+	    counts->nstat_connectsuccesses);
+}
+
+/*
+ * For a query made with NSTAT_MSG_HDR_FLAG_CHANGED_ONLY, tell whether
+ * a source can be skipped because its counts are those last reported
+ * to the client; a source that is gone is always reported.
+ */
+static boolean_t
+nstat_control_counts_unchanged(
+	nstat_src			*src,
+	const nstat_counts	*counts,
+	boolean_t			changed_only,
+	int					gone)
+{
+	u_int64_t activity = nstat_counts_activity(counts);
+
+	if (changed_only && !gone && src->ns_reported == activity)
+	{
+		return TRUE;
+	}
+	src->ns_reported = activity;
+	return FALSE;
+}
+
 static errno_t
 nstat_control_append_counts(
 	nstat_control_state	*state,
 	nstat_src			*src,
+	boolean_t			changed_only,
 	int					*gone)
 {
 	/* Some providers may not have any counts to send */
@@ -4008,7 +4046,17 @@ nstat_control_append_counts(
 		return EAGAIN;
 	}
 
-	return nstat_accumulate_msg(state, &counts.hdr, counts.hdr.length);
+	if (nstat_control_counts_unchanged(src, &counts.counts, changed_only, *gone))
+	{
+		return EAGAIN;
+	}
+
+	result = nstat_accumulate_msg(state, &counts.hdr, counts.hdr.length);
+	if (result != 0)
+	{
+		src->ns_reported = 0;
+	}
+	return result;
 }
 
 static int
@@ -4184,6 +4232,7 @@ static errno_t
 nstat_control_append_update(
 	nstat_control_state	*state,
 	nstat_src			*src,
+	boolean_t			changed_only,
 	int					*gone)
 {
 	size_t	size = offsetof(nstat_msg_src_update, data) + src->provider->nstat_descriptor_length;
@@ -4206,21 +4255,7 @@ nstat_control_append_update(
 	desc->provider = src->provider->nstat_provider_id;
 
 	errno_t	result = 0;
-	// Fill in the description
-	if (src->provider->nstat_descriptor_length != 0 && src->provider->nstat_copy_descriptor)
-	{
-		// Query the provider for the provider specific bits
-		result = src->provider->nstat_copy_descriptor(src->cookie, desc->data,
-					src->provider->nstat_descriptor_length);
-		if (result != 0)
-		{
-			nstat_stats.nstat_copy_descriptor_failures++;
-			if (nstat_debug != 0)
-				printf("%s: src->provider->nstat_copy_descriptor: %d\n", __func__, result);
-			return result;
-		}
-	}
-
+	// Get the counts first, so that unchanged sources don't need a description
 	if (src->provider->nstat_counts)
 	{
 		result = src->provider->nstat_counts(src->cookie, &desc->counts, gone);
@@ -4237,9 +4272,35 @@ nstat_control_append_update(
 		{
 			return EAGAIN;
 		}
+
+		if (nstat_control_counts_unchanged(src, &desc->counts, changed_only, *gone))
+		{
+			return EAGAIN;
+		}
 	}
 
-	return nstat_accumulate_msg(state, &desc->hdr, size);
+	// Fill in the description
+	if (src->provider->nstat_descriptor_length != 0 && src->provider->nstat_copy_descriptor)
+	{
+		// Query the provider for the provider specific bits
+		result = src->provider->nstat_copy_descriptor(src->cookie, desc->data,
+					src->provider->nstat_descriptor_length);
+		if (result != 0)
+		{
+			nstat_stats.nstat_copy_descriptor_failures++;
+			if (nstat_debug != 0)
+				printf("%s: src->provider->nstat_copy_descriptor: %d\n", __func__, result);
+			src->ns_reported = 0;
+			return result;
+		}
+	}
+
+	result = nstat_accumulate_msg(state, &desc->hdr, size);
+	if (result != 0)
+	{
+		src->ns_reported = 0;
+	}
+	return result;
 }
 
 static errno_t
@@ -4452,6 +4513,7 @@ nstat_control_source_add(
 	src->cookie = cookie;
 	src->filter = src_filter;
 	src->seq = 0;
+	src->ns_reported = 0;
 
 	if (msg)
 	{
@@ -4534,6 +4596,8 @@ nstat_control_handle_query_request(
 	}
 
 	const boolean_t all_srcs = (req.srcref == NSTAT_SRC_REF_ALL);
+	const boolean_t changed_only =
+	    (req.hdr.flags & NSTAT_MSG_HDR_FLAG_CHANGED_ONLY) != 0;
 	TAILQ_INIT(&dead_list);
 
 	lck_mtx_lock(&state->ncs_mtx);
@@ -4566,7 +4630,8 @@ nstat_control_handle_query_request(
 				if (all_srcs &&
 					(req.hdr.flags & NSTAT_MSG_HDR_FLAG_SUPPORTS_AGGREGATE) != 0)
 				{
-					result = nstat_control_append_counts(state, src, &gone);
+					result = nstat_control_append_counts(state, src,
+					    changed_only, &gone);
 				}
 				else
 				{
@@ -4590,10 +4655,13 @@ nstat_control_handle_query_request(
 				{
 					/*
 					 * We skip over hard errors and
-					 * filtered sources.
+					 * filtered sources.  Unchanged
+					 * sources cost no message, and so
+					 * don't count towards the batch.
 					 */
 					src->seq = state->ncs_seq;
-					src_count++;
+					if (!changed_only || result != EAGAIN)
+						src_count++;
 				}
 			}
 		}
@@ -4878,6 +4946,8 @@ nstat_control_handle_get_update(
 	tailq_head_nstat_src dead_list;
 	u_int64_t src_count = 0;
 	boolean_t partial = FALSE;
+	const boolean_t changed_only =
+	    (req.hdr.flags & NSTAT_MSG_HDR_FLAG_CHANGED_ONLY) != 0;
 	TAILQ_INIT(&dead_list);
 
 	/*
@@ -4899,7 +4969,8 @@ nstat_control_handle_get_update(
 			if (req.srcref == NSTAT_SRC_REF_ALL
 			    && (FALSE == partial || src->seq != state->ncs_seq))
 			{
-				result = nstat_control_append_update(state, src, &gone);
+				result = nstat_control_append_update(state, src,
+				    changed_only, &gone);
 				if (ENOMEM == result || ENOBUFS == result)
 				{
 					/*
@@ -4912,10 +4983,13 @@ nstat_control_handle_get_update(
 				{
 					/*
 					 * We skip over hard errors and
-					 * filtered sources.
+					 * filtered sources.  Unchanged
+					 * sources cost no message, and so
+					 * don't count towards the batch.
 					 */
 					src->seq = state->ncs_seq;
-					src_count++;
+					if (!changed_only || result != EAGAIN)
+						src_count++;
 				}
 			}
 			else if (src->srcref == req.srcref)
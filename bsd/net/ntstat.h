@@ -768,6 +768,12 @@ enum
 	NSTAT_MSG_HDR_FLAG_SUPPORTS_AGGREGATE	= 1 << 0,
 	NSTAT_MSG_HDR_FLAG_CONTINUATION		= 1 << 1,
 	NSTAT_MSG_HDR_FLAG_CLOSING		= 1 << 2,
+	/*
+	 * Set on an aggregate query or update request for all sources to
+	 * only hear about the sources whose counts changed since they were
+	 * last reported to this client.
+	 */
+	NSTAT_MSG_HDR_FLAG_CHANGED_ONLY		= 1 << 3,
 };
 
 typedef struct nstat_msg_hdr
@@ -132,6 +132,7 @@
  * Note that random() returns a 31 bits value, see rdar://11159750
  */
 #include <dev/random/randomdev.h>
+#include <pexpert/pexpert.h>
 
 #define DPFPRINTF(n, x)	(pf_status.debug >= (n) ? printf x : ((void)0))
 
@@ -487,6 +488,33 @@ RB_GENERATE(pf_state_tree_id, pf_state,
 #define	PF_DT_SKIP_LANEXT	0x01
 #define	PF_DT_SKIP_EXTGWY	0x02
 
+/*
+ * The state key trees are shadowed by hash tables, which is what the
+ * per-packet state lookups go through; the trees remain authoritative
+ * for ordering and for detecting collisions on insertion.  Only fields
+ * that the tree comparators always check for equality may go into the
+ * hash, so that keys comparing equal always land in the same bucket.
+ */
+#define	PF_STATEHASH_SIZE	32768	/* default; must be a power of 2 */
+
+struct pf_state_hash_key {
+	struct pf_addr	addr;
+	struct pf_addr	ext_addr;
+	u_int32_t	xport;
+	u_int32_t	ext_xport;
+	u_int8_t	af;
+	u_int8_t	proto;
+	u_int8_t	proto_variant;
+	u_int8_t	pad;
+};
+
+LIST_HEAD(pf_state_hashhead, pf_state_key);
+
+static struct pf_state_hashhead	*pf_statehash_lan_ext;
+static struct pf_state_hashhead	*pf_statehash_ext_gwy;
+static u_int32_t		 pf_statehash_size = PF_STATEHASH_SIZE;
+static u_int32_t		 pf_statehash_seed;
+
 static const u_int16_t PF_PPTP_PORT = 1723;
 static const u_int32_t PF_PPTP_MAGIC_NUMBER = 0x1A2B3C4D;
 
@@ -1058,6 +1086,188 @@ pf_find_state_byid(struct pf_state_cmp *key)
 	    (struct pf_state *)(void *)key));
 }
 
+void
+pf_statehash_init(void)
+{
+	u_int32_t size;
+
+	if (PE_parse_boot_argn("pf_statehash", &size, sizeof (size)) &&
+	    size > 0 && (size & (size - 1)) == 0)
+		pf_statehash_size = size;
+
+	pf_statehash_lan_ext = _MALLOC(pf_statehash_size *
+	    sizeof (*pf_statehash_lan_ext), M_DEVBUF, M_WAITOK | M_ZERO);
+	pf_statehash_ext_gwy = _MALLOC(pf_statehash_size *
+	    sizeof (*pf_statehash_ext_gwy), M_DEVBUF, M_WAITOK | M_ZERO);
+	if (pf_statehash_lan_ext == NULL || pf_statehash_ext_gwy == NULL)
+		panic("%s: failed to allocate state hash tables", __func__);
+
+	pf_statehash_seed = RandomULong();
+}
+
+static u_int32_t
+pf_state_hash(struct pf_state_hash_key *hk, sa_family_t af,
+    struct pf_addr *addr, struct pf_addr *ext_addr, int extfilter)
+{
+	hk->af = af;
+	PF_ACPY(&hk->addr, addr, af);
+	if (extfilter < PF_EXTFILTER_EI)
+		PF_ACPY(&hk->ext_addr, ext_addr, af);
+
+	return (net_flowhash(hk, sizeof (*hk), pf_statehash_seed) &
+	    (pf_statehash_size - 1));
+}
+
+/* keep in sync with pf_state_compare_lan_ext() */
+static u_int32_t
+pf_state_hash_lan_ext(struct pf_state_key *sk)
+{
+	struct pf_state_hash_key hk;
+	int extfilter = PF_EXTFILTER_APD;
+
+	bzero(&hk, sizeof (hk));
+	hk.proto = sk->proto;
+
+	switch (sk->proto) {
+	case IPPROTO_ICMP:
+	case IPPROTO_ICMPV6:
+		hk.xport = sk->lan.xport.port;
+		break;
+
+	case IPPROTO_TCP:
+		hk.xport = sk->lan.xport.port;
+		hk.ext_xport = sk->ext_lan.xport.port;
+		break;
+
+	case IPPROTO_UDP:
+		hk.proto_variant = sk->proto_variant;
+		extfilter = sk->proto_variant;
+		hk.xport = sk->lan.xport.port;
+		if (extfilter < PF_EXTFILTER_AD)
+			hk.ext_xport = sk->ext_lan.xport.port;
+		break;
+
+	case IPPROTO_ESP:
+		hk.ext_xport = sk->ext_lan.xport.spi;
+		break;
+
+	default:
+		break;
+	}
+
+	return (pf_state_hash(&hk, sk->af_lan, &sk->lan.addr,
+	    &sk->ext_lan.addr, extfilter));
+}
+
+/* keep in sync with pf_state_compare_ext_gwy() */
+static u_int32_t
+pf_state_hash_ext_gwy(struct pf_state_key *sk)
+{
+	struct pf_state_hash_key hk;
+	int extfilter = PF_EXTFILTER_APD;
+
+	bzero(&hk, sizeof (hk));
+	hk.proto = sk->proto;
+
+	switch (sk->proto) {
+	case IPPROTO_ICMP:
+	case IPPROTO_ICMPV6:
+		hk.xport = sk->gwy.xport.port;
+		break;
+
+	case IPPROTO_TCP:
+		hk.xport = sk->gwy.xport.port;
+		hk.ext_xport = sk->ext_gwy.xport.port;
+		break;
+
+	case IPPROTO_UDP:
+		hk.proto_variant = sk->proto_variant;
+		extfilter = sk->proto_variant;
+		hk.xport = sk->gwy.xport.port;
+		if (extfilter < PF_EXTFILTER_AD)
+			hk.ext_xport = sk->ext_gwy.xport.port;
+		break;
+
+	case IPPROTO_ESP:
+		hk.xport = sk->gwy.xport.spi;
+		break;
+
+	default:
+		break;
+	}
+
+	return (pf_state_hash(&hk, sk->af_gwy, &sk->gwy.addr,
+	    &sk->ext_gwy.addr, extfilter));
+}
+
+static struct pf_state_key *
+pf_statehash_find_lan_ext(struct pf_state_key_cmp *key)
+{
+	struct pf_state_key *sk;
+
+	LIST_FOREACH(sk, &pf_statehash_lan_ext[pf_state_hash_lan_ext(
+	    (struct pf_state_key *)key)], hash_lan_ext) {
+		if (pf_state_compare_lan_ext((struct pf_state_key *)key,
+		    sk) == 0)
+			break;
+	}
+	return (sk);
+}
+
+static struct pf_state_key *
+pf_statehash_find_ext_gwy(struct pf_state_key_cmp *key)
+{
+	struct pf_state_key *sk;
+
+	LIST_FOREACH(sk, &pf_statehash_ext_gwy[pf_state_hash_ext_gwy(
+	    (struct pf_state_key *)key)], hash_ext_gwy) {
+		if (pf_state_compare_ext_gwy((struct pf_state_key *)key,
+		    sk) == 0)
+			break;
+	}
+	return (sk);
+}
+
+static struct pf_state_key *
+pf_state_key_insert_lan_ext(struct pf_state_key *sk)
+{
+	struct pf_state_key *cur;
+
+	if ((cur = RB_INSERT(pf_state_tree_lan_ext, &pf_statetbl_lan_ext,
+	    sk)) == NULL) {
+		LIST_INSERT_HEAD(&pf_statehash_lan_ext[
+		    pf_state_hash_lan_ext(sk)], sk, hash_lan_ext);
+	}
+	return (cur);
+}
+
+static struct pf_state_key *
+pf_state_key_insert_ext_gwy(struct pf_state_key *sk)
+{
+	struct pf_state_key *cur;
+
+	if ((cur = RB_INSERT(pf_state_tree_ext_gwy, &pf_statetbl_ext_gwy,
+	    sk)) == NULL) {
+		LIST_INSERT_HEAD(&pf_statehash_ext_gwy[
+		    pf_state_hash_ext_gwy(sk)], sk, hash_ext_gwy);
+	}
+	return (cur);
+}
+
+static void
+pf_state_key_remove_lan_ext(struct pf_state_key *sk)
+{
+	RB_REMOVE(pf_state_tree_lan_ext, &pf_statetbl_lan_ext, sk);
+	LIST_REMOVE(sk, hash_lan_ext);
+}
+
+static void
+pf_state_key_remove_ext_gwy(struct pf_state_key *sk)
+{
+	RB_REMOVE(pf_state_tree_ext_gwy, &pf_statetbl_ext_gwy, sk);
+	LIST_REMOVE(sk, hash_ext_gwy);
+}
+
 static struct pf_state *
 pf_find_state(struct pfi_kif *kif, struct pf_state_key_cmp *key, u_int dir)
 {
@@ -1068,20 +1278,16 @@ pf_find_state(struct pfi_kif *kif, struct pf_state_key_cmp *key, u_int dir)
 
 	switch (dir) {
 	case PF_OUT:
-		sk = RB_FIND(pf_state_tree_lan_ext, &pf_statetbl_lan_ext,
-		    (struct pf_state_key *)key);
+		sk = pf_statehash_find_lan_ext(key);
 		break;
 	case PF_IN:
-		sk = RB_FIND(pf_state_tree_ext_gwy, &pf_statetbl_ext_gwy,
-		    (struct pf_state_key *)key);
+		sk = pf_statehash_find_ext_gwy(key);
 		/*
 		 * NAT64 is done only on input, for packets coming in from
 		 * from the LAN side, need to lookup the lan_ext tree.
 		 */
 		if (sk == NULL) {
-			sk = RB_FIND(pf_state_tree_lan_ext,
-				     &pf_statetbl_lan_ext,
-				     (struct pf_state_key *)key);
+			sk = pf_statehash_find_lan_ext(key);
 			if (sk && sk->af_lan == sk->af_gwy)
 				sk = NULL;
 		}
@@ -1109,20 +1315,16 @@ pf_find_state_all(struct pf_state_key_cmp *key, u_int dir, int *more)
 
 	switch (dir) {
 	case PF_OUT:
-		sk = RB_FIND(pf_state_tree_lan_ext,
-		    &pf_statetbl_lan_ext, (struct pf_state_key *)key);
+		sk = pf_statehash_find_lan_ext(key);
 		break;
 	case PF_IN:
-		sk = RB_FIND(pf_state_tree_ext_gwy,
-		    &pf_statetbl_ext_gwy, (struct pf_state_key *)key);
+		sk = pf_statehash_find_ext_gwy(key);
 		/*
 		 * NAT64 is done only on input, for packets coming in from
 		 * from the LAN side, need to lookup the lan_ext tree.
 		 */
 		if ((sk == NULL) && pf_nat64_configured) {
-			sk = RB_FIND(pf_state_tree_lan_ext,
-					&pf_statetbl_lan_ext,
-					(struct pf_state_key *)key);
+			sk = pf_statehash_find_lan_ext(key);
 			if (sk && sk->af_lan == sk->af_gwy)
 				sk = NULL;
 		}
@@ -1388,8 +1590,7 @@ pf_insert_state(struct pfi_kif *kif, struct pf_state *s)
 	VERIFY(s->state_key != NULL);
 	s->kif = kif;
 
-	if ((cur = RB_INSERT(pf_state_tree_lan_ext, &pf_statetbl_lan_ext,
-	    s->state_key)) != NULL) {
+	if ((cur = pf_state_key_insert_lan_ext(s->state_key)) != NULL) {
 		/* key exists. check for same kif, if none, add to key */
 		TAILQ_FOREACH(sp, &cur->states, next)
 			if (sp->kif == kif) {	/* collision! */
@@ -1403,8 +1604,8 @@ pf_insert_state(struct pfi_kif *kif, struct pf_state *s)
 	}
 
 	/* if cur != NULL, we already found a state key and attached to it */
-	if (cur == NULL && (cur = RB_INSERT(pf_state_tree_ext_gwy,
-	    &pf_statetbl_ext_gwy, s->state_key)) != NULL) {
+	if (cur == NULL &&
+	    (cur = pf_state_key_insert_ext_gwy(s->state_key)) != NULL) {
 		/* must not happen. we must have found the sk above! */
 		pf_stateins_err("tree_ext_gwy", s, kif);
 		pf_detach_state(s, PF_DT_SKIP_EXTGWY);
@@ -4120,11 +4321,9 @@ pf_detach_state(struct pf_state *s, int flags)
 	TAILQ_REMOVE(&sk->states, s, next);
 	if (--sk->refcnt == 0) {
 		if (!(flags & PF_DT_SKIP_EXTGWY))
-			RB_REMOVE(pf_state_tree_ext_gwy,
-			    &pf_statetbl_ext_gwy, sk);
+			pf_state_key_remove_ext_gwy(sk);
 		if (!(flags & PF_DT_SKIP_LANEXT))
-			RB_REMOVE(pf_state_tree_lan_ext,
-			    &pf_statetbl_lan_ext, sk);
+			pf_state_key_remove_lan_ext(sk);
 		if (sk->app_state)
 			pool_put(&pf_app_state_pl, sk->app_state);
 		pool_put(&pf_state_key_pl, sk);
@@ -8364,13 +8563,11 @@ pf_test_state_esp(struct pf_state **state, int direction, struct pfi_kif *kif,
 			if (s) {
 				struct pf_state_key *sk = s->state_key;
 
-				RB_REMOVE(pf_state_tree_ext_gwy,
-				    &pf_statetbl_ext_gwy, sk);
+				pf_state_key_remove_ext_gwy(sk);
 				sk->lan.xport.spi = sk->gwy.xport.spi =
 				    esp->spi;
 
-				if (RB_INSERT(pf_state_tree_ext_gwy,
-				    &pf_statetbl_ext_gwy, sk))
+				if (pf_state_key_insert_ext_gwy(sk))
 					pf_detach_state(s, PF_DT_SKIP_EXTGWY);
 				else
 					*state = s;
@@ -8382,12 +8579,10 @@ pf_test_state_esp(struct pf_state **state, int direction, struct pfi_kif *kif,
 			if (s) {
 				struct pf_state_key *sk = s->state_key;
 
-				RB_REMOVE(pf_state_tree_lan_ext,
-				    &pf_statetbl_lan_ext, sk);
+				pf_state_key_remove_lan_ext(sk);
 				sk->ext_lan.xport.spi = esp->spi;
 
-				if (RB_INSERT(pf_state_tree_lan_ext,
-				    &pf_statetbl_lan_ext, sk))
+				if (pf_state_key_insert_lan_ext(sk))
 					pf_detach_state(s, PF_DT_SKIP_LANEXT);
 				else
 					*state = s;
@@ -434,6 +434,7 @@ pfinit(void)
 	    "pfappstatepl", NULL);
 	pool_init(&pf_pooladdr_pl, sizeof (struct pf_pooladdr), 0, 0, 0,
 	    "pfpooladdrpl", NULL);
+	pf_statehash_init();
 	pfr_initialize();
 	pfi_initialize();
 	pf_osfp_initialize();
@@ -1007,6 +1007,8 @@ struct pf_state_key {
 
 	RB_ENTRY(pf_state_key)	 entry_lan_ext;
 	RB_ENTRY(pf_state_key)	 entry_ext_gwy;
+	LIST_ENTRY(pf_state_key) hash_lan_ext;
+	LIST_ENTRY(pf_state_key) hash_ext_gwy;
 	struct pf_statelist	 states;
 	u_int32_t	 refcnt;
 };
@@ -2186,6 +2188,7 @@ extern struct pool pf_app_state_pl;
 extern struct thread *pf_purge_thread;
 
 __private_extern__ void pfinit(void);
+__private_extern__ void pf_statehash_init(void);
 __private_extern__ void pf_purge_thread_fn(void *, wait_result_t);
 __private_extern__ void pf_purge_expired_src_nodes(void);
 __private_extern__ void pf_purge_expired_states(u_int32_t);
@@ -52,7 +52,7 @@ static void *fq_if_dequeue_sc_classq(struct ifclassq *, mbuf_svc_class_t,
 static int fq_if_dequeue_sc_classq_multi(struct ifclassq *,
     mbuf_svc_class_t, u_int32_t, u_int32_t, void **,
     void **, u_int32_t *, u_int32_t *, classq_pkt_type_t *);
-static void fq_if_dequeue(fq_if_t *, fq_if_classq_t *, u_int32_t,
+static boolean_t fq_if_dequeue(fq_if_t *, fq_if_classq_t *, u_int32_t,
     u_int32_t, void **, void **, u_int32_t *, u_int32_t *,
     boolean_t drvmgmt, classq_pkt_type_t *);
 static int fq_if_request_classq(struct ifclassq *ifq, cqrq_t op, void *arg);
@@ -100,9 +100,34 @@ fq_getq_flow_mbuf(fq_if_t *fqs, fq_if_classq_t *fq_cl, fq_t *fq,
 	boolean_t limit_reached = FALSE;
 	struct ifclassq *ifq = fqs->fqs_ifq;
 	struct ifnet *ifp = ifq->ifcq_ifp;
+	u_int64_t txtime, now = 0;
 
+	fq->fq_flags &= ~FQF_PACED;
 	while (fq->fq_deficit > 0 && limit_reached == FALSE &&
 	    !MBUFQ_EMPTY(&fq->fq_mbufq)) {
+		/*
+		 * A paced sender stamps its packets with the earliest time
+		 * they may leave; hold the flow until its head packet is
+		 * due, and remember when that is so that the starter thread
+		 * can come back for it.
+		 */
+		txtime = MBUFQ_FIRST(&fq->fq_mbufq)->m_pkthdr.pkt_txtime;
+		if (txtime != 0) {
+			if (now == 0) {
+				struct timespec now_ts;
+
+				nanouptime(&now_ts);
+				now = (now_ts.tv_sec * NSEC_PER_SEC) +
+				    now_ts.tv_nsec;
+			}
+			if (txtime > now) {
+				fq->fq_flags |= FQF_PACED;
+				if (ifq->ifcq_next_txtime == 0 ||
+				    txtime < ifq->ifcq_next_txtime)
+					ifq->ifcq_next_txtime = txtime;
+				break;
+			}
+		}
 
 		_PKTSCHED_PKT_INIT(&pkt);
 		m = fq_getq_flow(fqs, fq, &pkt);
@@ -378,8 +403,9 @@ fq_if_dequeue_sc_classq(struct ifclassq *ifq, mbuf_svc_class_t svc,
 
 	pri = fq_if_service_to_priority(fqs, svc);
 	fq_cl = &fqs->fqs_classq[pri];
+	ifq->ifcq_next_txtime = 0;
 
-	fq_if_dequeue(fqs, fq_cl, 1, CLASSQ_DEQUEUE_MAX_BYTE_LIMIT,
+	(void) fq_if_dequeue(fqs, fq_cl, 1, CLASSQ_DEQUEUE_MAX_BYTE_LIMIT,
 	    &top, NULL, NULL, NULL, TRUE, ptype);
 	return (top);
 }
@@ -395,11 +421,14 @@ fq_if_dequeue_classq_multi(struct ifclassq *ifq, u_int32_t maxpktcnt,
 	fq_if_t *fqs;
 	fq_if_classq_t *fq_cl;
 	int pri;
+	pktsched_bitmap_t held = 0;
+	boolean_t paced;
 	fq_if_append_pkt_t append_pkt;
 
 	IFCQ_LOCK_ASSERT_HELD(ifq);
 
 	fqs = (fq_if_t *)ifq->ifcq_disc;
+	ifq->ifcq_next_txtime = 0;
 
 	switch (fqs->fqs_ptype) {
 	case QP_MBUF:
@@ -450,9 +479,19 @@ fq_if_dequeue_classq_multi(struct ifclassq *ifq, u_int32_t maxpktcnt,
 			if (fq_cl->fcl_budget <= 0)
 				goto state_change;
 		}
-		fq_if_dequeue(fqs, fq_cl, (maxpktcnt - total_pktcnt),
+		paced = fq_if_dequeue(fqs, fq_cl, (maxpktcnt - total_pktcnt),
 		    (maxbytecnt - total_bytecnt), &top, &tail, &pktcnt,
 		    &bytecnt, FALSE, &tmp_ptype);
+		if (top == NULL && paced) {
+			/*
+			 * Everything this class could send is waiting for
+			 * its departure time; set it aside for the rest of
+			 * this round so that the other classes get served.
+			 */
+			pktsched_bit_clr(pri, &fqs->fqs_bitmaps[FQ_IF_ER]);
+			pktsched_bit_set(pri, &held);
+			continue;
+		}
 		if (top != NULL) {
 			ASSERT(tmp_ptype == *ptype);
 			ASSERT(pktcnt > 0 && bytecnt > 0);
@@ -495,6 +534,7 @@ state_change:
 		if (total_pktcnt >= maxpktcnt || total_bytecnt >= maxbytecnt)
 			break;
 	}
+	fqs->fqs_bitmaps[FQ_IF_EB] |= held;
 	if (first != NULL) {
 		if (first_packet != NULL)
 			*first_packet = first;
@@ -545,6 +585,7 @@ fq_if_dequeue_sc_classq_multi(struct ifclassq *ifq, mbuf_svc_class_t svc,
 
 	pri = fq_if_service_to_priority(fqs, svc);
 	fq_cl = &fqs->fqs_classq[pri];
+	ifq->ifcq_next_txtime = 0;
 
 	/*
 	 * Now we have the queue for a particular service class. We need
@@ -555,9 +596,17 @@ fq_if_dequeue_sc_classq_multi(struct ifclassq *ifq, mbuf_svc_class_t svc,
 	    fq_cl->fcl_stat.fcl_pkt_cnt > 0) {
 		void *top, *tail;
 		u_int32_t pktcnt = 0, bytecnt = 0;
-		fq_if_dequeue(fqs, fq_cl, (maxpktcnt - total_pktcnt),
+		boolean_t paced;
+
+		paced = fq_if_dequeue(fqs, fq_cl, (maxpktcnt - total_pktcnt),
 		    (maxbytecnt - total_bytecnt), &top, &tail, &pktcnt,
 		    &bytecnt, TRUE, ptype);
+		if (top == NULL) {
+			/* the rest is waiting for its departure time */
+			if (paced)
+				break;
+			continue;
+		}
 		if (first == NULL) {
 			first = top;
 			total_pktcnt = pktcnt;
@@ -1081,7 +1130,11 @@ fq_if_flow_feedback(fq_if_t *fqs, fq_t *fq, fq_if_classq_t *fq_cl)
 	fq->fq_flags &= ~FQF_FLOWCTL_ON;
 }
 
-void
+/*
+ * Returns TRUE if some flow of the class was held back because its head
+ * packet is not due yet.
+ */
+boolean_t
 fq_if_dequeue(fq_if_t *fqs, fq_if_classq_t *fq_cl, u_int32_t pktlimit,
     u_int32_t bytelimit, void **top, void **tail,
     u_int32_t *retpktcnt, u_int32_t *retbytecnt, boolean_t drvmgmt,
@@ -1090,7 +1143,7 @@ fq_if_dequeue(fq_if_t *fqs, fq_if_classq_t *fq_cl, u_int32_t pktlimit,
 	fq_t *fq = NULL, *tfq = NULL;
 	flowq_stailq_t temp_stailq;
 	u_int32_t pktcnt, bytecnt;
-	boolean_t qempty, limit_reached = FALSE;
+	boolean_t qempty, limit_reached = FALSE, paced = FALSE;
 	void *last = NULL;
 	fq_getq_flow_t fq_getq_flow_fn;
 
@@ -1127,9 +1180,15 @@ fq_if_dequeue(fq_if_t *fqs, fq_if_classq_t *fq_cl, u_int32_t pktlimit,
 		    pktlimit, top, &last, &bytecnt, &pktcnt, &qempty,
 		    PKTF_NEW_FLOW);
 
-		if (fq->fq_deficit <= 0 || qempty)
+		if (fq->fq_deficit <= 0 || qempty) {
 			fq_if_empty_new_flow(fq, fq_cl, true);
-		fq->fq_deficit += fq_cl->fcl_quantum;
+			fq->fq_deficit += fq_cl->fcl_quantum;
+		} else if (fq->fq_flags & FQF_PACED) {
+			/* keep its place and deficit until it is due */
+			paced = TRUE;
+		} else {
+			fq->fq_deficit += fq_cl->fcl_quantum;
+		}
 		if (limit_reached)
 			goto done;
 	}
@@ -1153,6 +1212,8 @@ fq_if_dequeue(fq_if_t *fqs, fq_if_classq_t *fq_cl, u_int32_t pktlimit,
 			 */
 			STAILQ_INSERT_TAIL(&temp_stailq, fq, fq_actlink);
 			fq->fq_deficit += fq_cl->fcl_quantum;
+		} else if (fq->fq_flags & FQF_PACED) {
+			paced = TRUE;
 		}
 		if (limit_reached)
 			break;
@@ -1174,6 +1235,7 @@ done:
 		if (retbytecnt != NULL)
 			*retbytecnt = bytecnt;
 	}
+	return (paced);
 }
 
 int
@@ -448,6 +448,7 @@ route_init(void)
 	rn_init();	/* initialize all zeroes, all ones, mask table */
 	lck_mtx_unlock(rnh_lock);
 	rtable_init((void **)rt_tables);
+	fib_init();
 
 	if (rte_debug & RTD_DEBUG)
 		size = sizeof (struct rtentry_dbg);
@@ -903,6 +904,10 @@ void
 rtalloc_ign(struct route *ro, uint32_t ignore)
 {
 	LCK_MTX_ASSERT(rnh_lock, LCK_MTX_ASSERT_NOTOWNED);
+	/* Try the lockless forwarding table first */
+	if (ro->ro_rt == NULL &&
+	    (ro->ro_rt = fib_lookup(&ro->ro_dst, ignore)) != NULL)
+		return;
 	lck_mtx_lock(rnh_lock);
 	rtalloc_ign_common_locked(ro, ignore, IFSCOPE_NONE);
 	lck_mtx_unlock(rnh_lock);
@@ -912,6 +917,9 @@ void
 rtalloc_scoped_ign(struct route *ro, uint32_t ignore, unsigned int ifscope)
 {
 	LCK_MTX_ASSERT(rnh_lock, LCK_MTX_ASSERT_NOTOWNED);
+	if (ifscope == IFSCOPE_NONE && ro->ro_rt == NULL &&
+	    (ro->ro_rt = fib_lookup(&ro->ro_dst, ignore)) != NULL)
+		return;
 	lck_mtx_lock(rnh_lock);
 	rtalloc_ign_common_locked(ro, ignore, ifscope);
 	lck_mtx_unlock(rnh_lock);
@@ -1828,6 +1836,7 @@ rtrequest_common_locked(int req, struct sockaddr *dst0,
 			/* NOTREACHED */
 		}
 		rt = (struct rtentry *)rn;
+		fib_rtdel(rt);
 
 		RT_LOCK(rt);
 		old_rt_refcnt = rt->rt_refcnt;
@@ -2295,6 +2304,7 @@ makeroute:
 		}
 
 		nstat_route_new_entry(rt);
+		fib_rtadd(rt);
 		break;
 	}
 bad:
@@ -3616,6 +3626,16 @@ rt_lock(struct rtentry *rt, boolean_t spin)
 		rte_lock_debug((struct rtentry_dbg *)rt);
 }
 
+boolean_t
+rt_lock_try_spin(struct rtentry *rt)
+{
+	if (!lck_mtx_try_lock_spin(&rt->rt_lock))
+		return (FALSE);
+	if (rte_debug & RTD_DEBUG)
+		rte_lock_debug((struct rtentry_dbg *)rt);
+	return (TRUE);
+}
+
 void
 rt_unlock(struct rtentry *rt)
 {
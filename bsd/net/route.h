@@ -582,6 +582,10 @@ struct ifmultiaddr;
 struct proc;
 
 extern void route_init(void);
+extern void fib_init(void);
+extern struct rtentry *fib_lookup(struct sockaddr *, uint32_t);
+extern void fib_rtadd(struct rtentry *);
+extern void fib_rtdel(struct rtentry *);
 extern void routegenid_update(void);
 extern void routegenid_inet_update(void);
 extern void routegenid_inet6_update(void);
@@ -633,6 +637,7 @@ extern void sin_set_ifscope(struct sockaddr *, unsigned int);
 extern unsigned int sin_get_ifscope(struct sockaddr *);
 extern unsigned int sin6_get_ifscope(struct sockaddr *);
 extern void rt_lock(struct rtentry *, boolean_t);
+extern boolean_t rt_lock_try_spin(struct rtentry *);
 extern void rt_unlock(struct rtentry *);
 extern struct sockaddr *rtm_scrub(int, int, struct sockaddr *,
     struct sockaddr *, void *, uint32_t, kauth_cred_t *);
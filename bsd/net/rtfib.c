@@ -0,0 +1,709 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+/*
+ * Lockless forwarding table.
+ *
+ * This is a read-mostly copy of the AF_INET and AF_INET6 routing tables,
+ * organized as a multibit trie with a 16-bit root stride followed by 8-bit
+ * strides (16-8-8 for IPv4), with prefixes expanded into the entries they
+ * cover.  A lookup is a handful of dependent loads without any lock; the
+ * radix trees stay authoritative for everything else, and this table is
+ * only ever used as a shortcut for non-scoped route allocations.
+ *
+ * Each trie entry is a 32-bit value which either refers to a child node
+ * (FIB_CHILD) or to the record of the longest prefix covering the entry
+ * (0 means none).  Records live in a hash keyed by prefix and length,
+ * which is used to find the covering prefix when one gets removed.
+ *
+ * Two tries are kept per address family: one holding the non-scoped
+ * routes, and one holding the prefixes of the scoped non-default routes.
+ * The latter is only used to tell whether a destination is covered by
+ * any scoped route, in which case the scoped lookup rules implemented
+ * by rt_lookup_common() may yield a different answer; these lookups,
+ * along with the ones resolving to a default route or to a route that
+ * needs to be cloned, are left to the radix tree.
+ *
+ * Updates are made by the routing code with rnh_lock held.  Readers run
+ * with preemption disabled and mark themselves on their CPU; before a
+ * route or a record referred to by the trie can go away the updater
+ * waits for the readers that might have seen it to be done.  Nodes are
+ * never freed.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/kernel.h>
+#include <sys/malloc.h>
+#include <sys/mcache.h>
+#include <sys/socket.h>
+#include <sys/sysctl.h>
+
+#include <kern/clock.h>
+#include <kern/cpu_data.h>
+#include <kern/cpu_number.h>
+#include <kern/locks.h>
+
+#include <libkern/OSAtomic.h>
+#include <machine/machine_routines.h>
+#include <pexpert/pexpert.h>
+
+#include <net/flowhash.h>
+#include <net/route.h>
+
+#include <netinet/in.h>
+
+#include <dev/random/randomdev.h>
+
+#define	FIB_ROOT_BITS	16			/* stride of the root node */
+#define	FIB_ROOT_SIZE	(1 << FIB_ROOT_BITS)
+#define	FIB_NODE_BITS	8			/* stride of the other nodes */
+#define	FIB_NODE_SIZE	(1 << FIB_NODE_BITS)
+#define	FIB_MAXKEYLEN	16			/* in bytes */
+
+#define	FIB_CHILD	0x80000000		/* entry refers to a node */
+
+/* Number of key bits resolved past a given level */
+#define	FIB_LEVEL_BITS(l)	(FIB_ROOT_BITS + ((l) * FIB_NODE_BITS))
+
+/*
+ * Nodes and records are allocated in chunks, which get published in
+ * fixed size directories so that readers never see them move.
+ */
+#define	FIB_NCHUNK_SHIFT	8		/* 256 nodes per chunk */
+#define	FIB_NCHUNK_MAX		16384
+#define	FIB_RCHUNK_SHIFT	12		/* 4096 records per chunk */
+#define	FIB_RCHUNK_MAX		4096
+
+#define	FIB_HASH_SIZE		65536		/* must be a power of 2 */
+
+#define	FIB_NODE(ft, i)							\
+	(&(ft)->ft_nodes[(i) >> FIB_NCHUNK_SHIFT]			\
+	[((i) & ((1 << FIB_NCHUNK_SHIFT) - 1)) << FIB_NODE_BITS])
+
+#define	FIB_REC(ft, i)							\
+	(&(ft)->ft_recs[(i) >> FIB_RCHUNK_SHIFT]			\
+	[(i) & ((1 << FIB_RCHUNK_SHIFT) - 1)])
+
+struct fib_rec {
+	uint32_t	fr_next;		/* hash or free list linkage */
+	uint32_t	fr_refcnt;		/* # of routes for the prefix */
+	struct rtentry	*fr_rt;			/* non-scoped route */
+	uint8_t		fr_len;			/* prefix length in bits */
+	uint8_t		fr_key[FIB_MAXKEYLEN];	/* prefix */
+};
+
+struct fib_table {
+	uint32_t	*ft_root;		/* root node */
+	uint32_t	**ft_nodes;		/* node chunks */
+	struct fib_rec	**ft_recs;		/* record chunks */
+	uint32_t	*ft_hash;		/* prefix hash buckets */
+	uint32_t	ft_nnodes;		/* # of nodes allocated */
+	uint32_t	ft_nrecs;		/* # of records allocated */
+	uint32_t	ft_free;		/* free records */
+	uint32_t	ft_nprefixes;		/* # of prefixes */
+	uint8_t		ft_keylen;		/* key length in bytes */
+	boolean_t	ft_broken;		/* out of sync; unusable */
+};
+
+struct fib {
+	struct fib_table f_routes;		/* non-scoped routes */
+	struct fib_table f_scoped;		/* scoped route prefixes */
+	size_t		f_keyoff;		/* key offset in sockaddr */
+};
+
+struct fib_pcpu {
+	volatile uint32_t fp_gen;		/* odd while in a lookup */
+} __attribute__((aligned(MAX_CPU_CACHE_LINE_SIZE)));
+
+static struct fib fib_inet;
+#if INET6
+static struct fib fib_inet6;
+#endif /* INET6 */
+static struct fib_pcpu *fib_pcpu;
+static unsigned int fib_ncpu;
+static u_int32_t fib_hash_seed;
+
+static int fib_enabled = 0;
+
+SYSCTL_DECL(_net_route);
+SYSCTL_INT(_net_route, OID_AUTO, fib, CTLFLAG_RD | CTLFLAG_LOCKED,
+	&fib_enabled, 0, "Lockless forwarding table is in use");
+SYSCTL_UINT(_net_route, OID_AUTO, fib_inet_prefixes,
+	CTLFLAG_RD | CTLFLAG_LOCKED, &fib_inet.f_routes.ft_nprefixes, 0,
+	"Number of IPv4 prefixes in the forwarding table");
+#if INET6
+SYSCTL_UINT(_net_route, OID_AUTO, fib_inet6_prefixes,
+	CTLFLAG_RD | CTLFLAG_LOCKED, &fib_inet6.f_routes.ft_nprefixes, 0,
+	"Number of IPv6 prefixes in the forwarding table");
+#endif /* INET6 */
+
+static void fib_table_init(struct fib_table *, uint8_t);
+static struct fib *fib_get(int);
+static uint32_t fib_match(struct fib_table *, const uint8_t *);
+static int fib_prefixlen(struct sockaddr *, size_t, uint8_t);
+static void fib_maskkey(uint8_t *, const uint8_t *, uint8_t, uint8_t);
+static uint32_t fib_hash(struct fib_table *, const uint8_t *, uint8_t);
+static uint32_t fib_rec_lookup(struct fib_table *, const uint8_t *, uint8_t);
+static uint32_t fib_rec_alloc(struct fib_table *);
+static void fib_rec_free(struct fib_table *, uint32_t);
+static uint32_t *fib_descend(struct fib_table *, const uint8_t *, int,
+    boolean_t);
+static void fib_set(struct fib_table *, uint32_t *, uint32_t, uint32_t,
+    uint8_t);
+static void fib_replace(struct fib_table *, uint32_t *, uint32_t, uint32_t,
+    uint32_t);
+static int fib_insert(struct fib_table *, const uint8_t *, uint8_t,
+    struct rtentry *);
+static uint32_t fib_remove(struct fib_table *, const uint8_t *, uint8_t,
+    struct rtentry *);
+static void fib_synchronize(void);
+
+static inline int
+fib_level(uint8_t len)
+{
+	if (len <= FIB_ROOT_BITS)
+		return (0);
+	return ((len - FIB_ROOT_BITS + FIB_NODE_BITS - 1) / FIB_NODE_BITS);
+}
+
+static inline uint32_t
+fib_index(const uint8_t *key, int level)
+{
+	if (level == 0)
+		return ((key[0] << 8) | key[1]);
+	return (key[level + 1]);
+}
+
+void
+fib_init(void)
+{
+	char *buf;
+
+	PE_parse_boot_argn("rt_fib", &fib_enabled, sizeof (fib_enabled));
+	if (!fib_enabled)
+		return;
+
+	fib_ncpu = ml_get_max_cpus();
+	buf = _MALLOC(fib_ncpu * sizeof (struct fib_pcpu) +
+	    MAX_CPU_CACHE_LINE_SIZE, M_RTABLE, M_WAITOK | M_ZERO);
+	if (buf == NULL) {
+		fib_enabled = 0;
+		return;
+	}
+	fib_pcpu = (struct fib_pcpu *)P2ROUNDUP((intptr_t)buf,
+	    MAX_CPU_CACHE_LINE_SIZE);
+
+	fib_hash_seed = RandomULong();
+
+	fib_inet.f_keyoff = offsetof(struct sockaddr_in, sin_addr);
+	fib_table_init(&fib_inet.f_routes, sizeof (struct in_addr));
+	fib_table_init(&fib_inet.f_scoped, sizeof (struct in_addr));
+#if INET6
+	fib_inet6.f_keyoff = offsetof(struct sockaddr_in6, sin6_addr);
+	fib_table_init(&fib_inet6.f_routes, sizeof (struct in6_addr));
+	fib_table_init(&fib_inet6.f_scoped, sizeof (struct in6_addr));
+#endif /* INET6 */
+}
+
+static void
+fib_table_init(struct fib_table *ft, uint8_t keylen)
+{
+	ft->ft_keylen = keylen;
+	/* record 0 stands for "no route" */
+	ft->ft_nrecs = 1;
+
+	ft->ft_root = _MALLOC(FIB_ROOT_SIZE * sizeof (uint32_t), M_RTABLE,
+	    M_WAITOK | M_ZERO);
+	ft->ft_nodes = _MALLOC(FIB_NCHUNK_MAX * sizeof (uint32_t *),
+	    M_RTABLE, M_WAITOK | M_ZERO);
+	ft->ft_recs = _MALLOC(FIB_RCHUNK_MAX * sizeof (struct fib_rec *),
+	    M_RTABLE, M_WAITOK | M_ZERO);
+	ft->ft_hash = _MALLOC(FIB_HASH_SIZE * sizeof (uint32_t), M_RTABLE,
+	    M_WAITOK | M_ZERO);
+
+	if (ft->ft_root == NULL || ft->ft_nodes == NULL ||
+	    ft->ft_recs == NULL || ft->ft_hash == NULL)
+		ft->ft_broken = TRUE;
+}
+
+static struct fib *
+fib_get(int af)
+{
+	if (!fib_enabled)
+		return (NULL);
+	if (af == AF_INET)
+		return (&fib_inet);
+#if INET6
+	if (af == AF_INET6)
+		return (&fib_inet6);
+#endif /* INET6 */
+	return (NULL);
+}
+
+/*
+ * Return the record of the longest prefix matching the key.
+ */
+static uint32_t
+fib_match(struct fib_table *ft, const uint8_t *key)
+{
+	uint32_t e;
+	int l;
+
+	e = ((volatile uint32_t *)ft->ft_root)[fib_index(key, 0)];
+	for (l = 1; e & FIB_CHILD; l++)
+		e = ((volatile uint32_t *)FIB_NODE(ft, e & ~FIB_CHILD))
+		    [fib_index(key, l)];
+
+	return (e);
+}
+
+/*
+ * Look up a non-scoped route for dst, without taking rnh_lock.  Returns
+ * the route with a reference held, or NULL if the lookup needs to go
+ * through the radix tree, where ignflags has the same meaning as for
+ * rtalloc1().
+ */
+struct rtentry *
+fib_lookup(struct sockaddr *dst, uint32_t ignflags)
+{
+	struct rtentry *rt = NULL;
+	struct fib_pcpu *fp;
+	struct fib_rec *fr;
+	const uint8_t *key;
+	struct fib *f;
+	uint32_t ri;
+
+	if ((f = fib_get(dst->sa_family)) == NULL ||
+	    f->f_routes.ft_broken || f->f_scoped.ft_broken)
+		return (NULL);
+
+#if INET6
+	if (dst->sa_family == AF_INET6 &&
+	    (IN6_IS_SCOPE_EMBED(&SIN6(dst)->sin6_addr) ||
+	    IN6_IS_ADDR_MULTICAST(&SIN6(dst)->sin6_addr)))
+		return (NULL);
+#endif /* INET6 */
+
+	key = (const uint8_t *)dst + f->f_keyoff;
+
+	disable_preemption();
+	fp = &fib_pcpu[cpu_number()];
+	fp->fp_gen++;
+	OSMemoryBarrier();
+
+	if (fib_match(&f->f_scoped, key) == 0 &&
+	    (ri = fib_match(&f->f_routes, key)) != 0) {
+		fr = FIB_REC(&f->f_routes, ri);
+		rt = fr->fr_rt;
+
+		/*
+		 * Leave default routes to the radix tree, since a scoped
+		 * default route may take precedence over them.  A route
+		 * whose first reference may need to unexpire it or take
+		 * an interface reference is also left alone, as is one
+		 * that is busy, since we can't block here.
+		 */
+		if (fr->fr_len == 0 || rt == NULL || !rt_lock_try_spin(rt)) {
+			rt = NULL;
+		} else {
+			if ((rt->rt_flags & (RTF_UP | RTF_CONDEMNED)) ==
+			    RTF_UP && ((rt->rt_flags & ~ignflags) &
+			    (RTF_CLONING | RTF_PRCLONING)) == 0 &&
+			    (rt->rt_refcnt > 0 || !(rt->rt_flags &
+			    (RTF_WASCLONED | RTPRF_OURS)))) {
+				RT_ADDREF_LOCKED(rt);
+				RT_GENID_SYNC(rt);
+				RT_UNLOCK(rt);
+			} else {
+				RT_UNLOCK(rt);
+				rt = NULL;
+			}
+		}
+	}
+
+	OSMemoryBarrier();
+	fp->fp_gen++;
+	enable_preemption();
+
+	return (rt);
+}
+
+/*
+ * Wait for the lookups in progress to be done with whatever they may
+ * have found before the table got updated.
+ */
+static void
+fib_synchronize(void)
+{
+	uint32_t gen;
+	unsigned int i;
+
+	OSMemoryBarrier();
+	for (i = 0; i < fib_ncpu; i++) {
+		gen = fib_pcpu[i].fp_gen;
+		if (!(gen & 1))
+			continue;
+		while (fib_pcpu[i].fp_gen == gen)
+			delay(1);
+	}
+}
+
+/*
+ * Return the prefix length of the mask, or -1 if it isn't contiguous.
+ */
+static int
+fib_prefixlen(struct sockaddr *mask, size_t off, uint8_t keylen)
+{
+	const uint8_t *m;
+	uint8_t b;
+	int i, len = 0;
+
+	if (mask == NULL)
+		return (keylen * NBBY);
+
+	/* Radix masks are shortened by dropping the trailing zeroes */
+	m = (const uint8_t *)mask;
+	for (i = 0; i < keylen; i++) {
+		b = (off + i < mask->sa_len) ? m[off + i] : 0;
+		if (b == 0xff) {
+			len += NBBY;
+			continue;
+		}
+		while (b & 0x80) {
+			len++;
+			b = (uint8_t)(b << 1);
+		}
+		if (b != 0)
+			return (-1);
+		for (i++; i < keylen; i++) {
+			if (off + i < mask->sa_len && m[off + i] != 0)
+				return (-1);
+		}
+		break;
+	}
+	return (len);
+}
+
+static void
+fib_maskkey(uint8_t *dst, const uint8_t *src, uint8_t len, uint8_t keylen)
+{
+	int i;
+
+	for (i = 0; i < keylen; i++, len = (len > NBBY) ? len - NBBY : 0) {
+		if (len >= NBBY)
+			dst[i] = src[i];
+		else
+			dst[i] = src[i] & (uint8_t)(0xff << (NBBY - len));
+	}
+}
+
+static uint32_t
+fib_hash(struct fib_table *ft, const uint8_t *key, uint8_t len)
+{
+	return (net_flowhash(key, ft->ft_keylen, fib_hash_seed + len) &
+	    (FIB_HASH_SIZE - 1));
+}
+
+static uint32_t
+fib_rec_lookup(struct fib_table *ft, const uint8_t *key, uint8_t len)
+{
+	struct fib_rec *fr;
+	uint32_t ri;
+
+	for (ri = ft->ft_hash[fib_hash(ft, key, len)]; ri != 0;
+	    ri = fr->fr_next) {
+		fr = FIB_REC(ft, ri);
+		if (fr->fr_len == len && bcmp(fr->fr_key, key,
+		    ft->ft_keylen) == 0)
+			break;
+	}
+	return (ri);
+}
+
+static uint32_t
+fib_rec_alloc(struct fib_table *ft)
+{
+	struct fib_rec *chunk;
+	uint32_t ri, c;
+
+	if ((ri = ft->ft_free) != 0) {
+		ft->ft_free = FIB_REC(ft, ri)->fr_next;
+		return (ri);
+	}
+
+	ri = ft->ft_nrecs;
+	if ((c = ri >> FIB_RCHUNK_SHIFT) >= FIB_RCHUNK_MAX)
+		return (0);
+	if (ft->ft_recs[c] == NULL) {
+		chunk = _MALLOC(sizeof (struct fib_rec) << FIB_RCHUNK_SHIFT,
+		    M_RTABLE, M_NOWAIT | M_ZERO);
+		if (chunk == NULL)
+			return (0);
+		ft->ft_recs[c] = chunk;
+	}
+	ft->ft_nrecs++;
+
+	return (ri);
+}
+
+static void
+fib_rec_free(struct fib_table *ft, uint32_t ri)
+{
+	struct fib_rec *fr = FIB_REC(ft, ri);
+
+	fr->fr_rt = NULL;
+	fr->fr_next = ft->ft_free;
+	ft->ft_free = ri;
+}
+
+/*
+ * Return the node at the given level on the path to key; nodes on the
+ * way are created as needed, inheriting the entry they replace.
+ */
+static uint32_t *
+fib_descend(struct fib_table *ft, const uint8_t *key, int level,
+    boolean_t create)
+{
+	uint32_t *node = ft->ft_root, *ent, *child, e, ni, c;
+	int l, i;
+
+	for (l = 0; l < level; l++) {
+		ent = &node[fib_index(key, l)];
+		if (!((e = *ent) & FIB_CHILD)) {
+			if (!create)
+				return (NULL);
+
+			ni = ft->ft_nnodes;
+			if ((c = ni >> FIB_NCHUNK_SHIFT) >= FIB_NCHUNK_MAX)
+				return (NULL);
+			if (ft->ft_nodes[c] == NULL) {
+				ft->ft_nodes[c] = _MALLOC(
+				    (sizeof (uint32_t) * FIB_NODE_SIZE) <<
+				    FIB_NCHUNK_SHIFT, M_RTABLE, M_NOWAIT);
+				if (ft->ft_nodes[c] == NULL)
+					return (NULL);
+			}
+			ft->ft_nnodes++;
+
+			child = FIB_NODE(ft, ni);
+			for (i = 0; i < FIB_NODE_SIZE; i++)
+				child[i] = e;
+			OSMemoryBarrier();
+			*ent = FIB_CHILD | ni;
+		}
+		node = FIB_NODE(ft, *ent & ~FIB_CHILD);
+	}
+	return (node);
+}
+
+/*
+ * Point the entries, and those of the nodes below, to record ri unless
+ * they already refer to a more specific prefix.
+ */
+static void
+fib_set(struct fib_table *ft, uint32_t *ent, uint32_t n, uint32_t ri,
+    uint8_t len)
+{
+	uint32_t e, i;
+
+	for (i = 0; i < n; i++) {
+		e = ent[i];
+		if (e & FIB_CHILD)
+			fib_set(ft, FIB_NODE(ft, e & ~FIB_CHILD),
+			    FIB_NODE_SIZE, ri, len);
+		else if (e == 0 || FIB_REC(ft, e)->fr_len < len)
+			ent[i] = ri;
+	}
+}
+
+/*
+ * Point the entries referring to record ri, and those of the nodes
+ * below, to record nri instead.
+ */
+static void
+fib_replace(struct fib_table *ft, uint32_t *ent, uint32_t n, uint32_t ri,
+    uint32_t nri)
+{
+	uint32_t e, i;
+
+	for (i = 0; i < n; i++) {
+		e = ent[i];
+		if (e & FIB_CHILD)
+			fib_replace(ft, FIB_NODE(ft, e & ~FIB_CHILD),
+			    FIB_NODE_SIZE, ri, nri);
+		else if (e == ri)
+			ent[i] = nri;
+	}
+}
+
+static int
+fib_insert(struct fib_table *ft, const uint8_t *key, uint8_t len,
+    struct rtentry *rt)
+{
+	struct fib_rec *fr;
+	uint32_t *node, ri, h;
+	int level;
+
+	if ((ri = fib_rec_lookup(ft, key, len)) != 0) {
+		/* There's only one non-scoped route per prefix */
+		if (rt != NULL)
+			return (EEXIST);
+		FIB_REC(ft, ri)->fr_refcnt++;
+		return (0);
+	}
+
+	level = fib_level(len);
+	if ((ri = fib_rec_alloc(ft)) == 0 ||
+	    (node = fib_descend(ft, key, level, TRUE)) == NULL)
+		return (ENOBUFS);
+
+	fr = FIB_REC(ft, ri);
+	bcopy(key, fr->fr_key, ft->ft_keylen);
+	fr->fr_len = len;
+	fr->fr_refcnt = 1;
+	fr->fr_rt = rt;
+	h = fib_hash(ft, key, len);
+	fr->fr_next = ft->ft_hash[h];
+	ft->ft_hash[h] = ri;
+
+	/* Publish the record before the entries referring to it */
+	OSMemoryBarrier();
+	fib_set(ft, &node[fib_index(key, level)],
+	    1 << (FIB_LEVEL_BITS(level) - len), ri, len);
+	ft->ft_nprefixes++;
+
+	return (0);
+}
+
+/*
+ * Remove a reference to the prefix; returns the record to free once
+ * the lookups in progress are done, if this was the last one.
+ */
+static uint32_t
+fib_remove(struct fib_table *ft, const uint8_t *key, uint8_t len,
+    struct rtentry *rt)
+{
+	uint8_t ckey[FIB_MAXKEYLEN];
+	struct fib_rec *fr;
+	uint32_t *node, *rp, ri, cri = 0;
+	int level, l;
+
+	if ((ri = fib_rec_lookup(ft, key, len)) == 0)
+		return (0);
+	fr = FIB_REC(ft, ri);
+	if ((rt != NULL && fr->fr_rt != rt) || --fr->fr_refcnt > 0)
+		return (0);
+
+	for (rp = &ft->ft_hash[fib_hash(ft, key, len)]; *rp != ri;
+	    rp = &FIB_REC(ft, *rp)->fr_next)
+		;
+	*rp = fr->fr_next;
+
+	/* The entries go to the covering prefix, if any */
+	for (l = len - 1; l >= 0 && cri == 0; l--) {
+		fib_maskkey(ckey, key, l, ft->ft_keylen);
+		cri = fib_rec_lookup(ft, ckey, l);
+	}
+
+	level = fib_level(len);
+	node = fib_descend(ft, key, level, FALSE);
+	VERIFY(node != NULL);
+	fib_replace(ft, &node[fib_index(key, level)],
+	    1 << (FIB_LEVEL_BITS(level) - len), ri, cri);
+	ft->ft_nprefixes--;
+
+	return (ri);
+}
+
+/*
+ * Routing table hooks, called with rnh_lock held after a route has been
+ * added to, or right after it has been removed from, the radix tree.
+ */
+void
+fib_rtadd(struct rtentry *rt)
+{
+	uint8_t key[FIB_MAXKEYLEN];
+	struct fib_table *ft;
+	struct fib *f;
+	int len;
+
+	LCK_MTX_ASSERT(rnh_lock, LCK_MTX_ASSERT_OWNED);
+
+	if ((f = fib_get(rt_key(rt)->sa_family)) == NULL)
+		return;
+
+	ft = (rt->rt_flags & RTF_IFSCOPE) ? &f->f_scoped : &f->f_routes;
+	if (ft->ft_broken)
+		return;
+
+	len = fib_prefixlen(rt_mask(rt), f->f_keyoff, ft->ft_keylen);
+	if (len < 0) {
+		ft->ft_broken = TRUE;
+		return;
+	}
+	/* Scoped default routes are handled by the radix tree */
+	if (len == 0 && ft == &f->f_scoped)
+		return;
+
+	fib_maskkey(key, (uint8_t *)rt_key(rt) + f->f_keyoff, len,
+	    ft->ft_keylen);
+	if (fib_insert(ft, key, len, (ft == &f->f_routes) ? rt : NULL) != 0)
+		ft->ft_broken = TRUE;
+}
+
+void
+fib_rtdel(struct rtentry *rt)
+{
+	uint8_t key[FIB_MAXKEYLEN];
+	struct fib_table *ft;
+	struct fib *f;
+	uint32_t ri;
+	int len;
+
+	LCK_MTX_ASSERT(rnh_lock, LCK_MTX_ASSERT_OWNED);
+
+	if ((f = fib_get(rt_key(rt)->sa_family)) == NULL)
+		return;
+
+	ft = (rt->rt_flags & RTF_IFSCOPE) ? &f->f_scoped : &f->f_routes;
+	if (ft->ft_broken)
+		return;
+
+	len = fib_prefixlen(rt_mask(rt), f->f_keyoff, ft->ft_keylen);
+	if (len <= 0 && ft == &f->f_scoped)
+		return;
+
+	fib_maskkey(key, (uint8_t *)rt_key(rt) + f->f_keyoff, len,
+	    ft->ft_keylen);
+	if ((ri = fib_remove(ft, key, len,
+	    (ft == &f->f_routes) ? rt : NULL)) != 0) {
+		fib_synchronize();
+		fib_rec_free(ft, ri);
+	}
+}
@@ -103,6 +103,18 @@ struct _mbuf {
 
 extern uint32_t os_cpu_in_cksum(const void *, uint32_t, uint32_t);
 extern uint32_t os_cpu_in_cksum_mbuf(struct _mbuf *, int, int, uint32_t);
+extern uint32_t os_cpu_copy_in_cksum(const void *, void *, uint32_t, uint32_t);
+
+/*
+ * Add a 64-bit word to a 64-bit one's complement accumulator, folding
+ * the carry out back in (end-around carry.)  The result is congruent
+ * to the 16-bit one's complement sum, since 2^16-1 divides 2^64-1.
+ */
+#define	ADDC64(acc, w) do {						\
+	uint64_t _w = (w);						\
+	(acc) += _w;							\
+	(acc) += ((acc) < _w);						\
+} while (0)
 
 uint32_t
 os_cpu_in_cksum(const void *data, uint32_t len, uint32_t initial_sum)
@@ -172,6 +184,66 @@ os_cpu_in_cksum(const void *data, uint32_t len, uint32_t initial_sum)
 	return (os_cpu_in_cksum_mbuf(&m, len, 0, initial_sum));
 }
 
+/*
+ * Copy len bytes from src to dst and return the 16-bit one's complement
+ * sum of the data, computed on the fly so that the data is only brought
+ * into the cache once.  As with os_cpu_in_cksum(), the sum is over
+ * 16-bit words starting at src, the result is not complemented, and
+ * initial_sum is added in.  The buffers may not overlap.
+ */
+uint32_t
+os_cpu_copy_in_cksum(const void *src, void *dst, uint32_t len,
+    uint32_t initial_sum)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	uint64_t sum0 = 0, sum1 = 0, w0, w1, w2, w3;
+
+	while (len >= 32) {
+		__builtin_memcpy(&w0, s, sizeof (w0));
+		__builtin_memcpy(&w1, s + 8, sizeof (w1));
+		__builtin_memcpy(&w2, s + 16, sizeof (w2));
+		__builtin_memcpy(&w3, s + 24, sizeof (w3));
+		__builtin_memcpy(d, &w0, sizeof (w0));
+		__builtin_memcpy(d + 8, &w1, sizeof (w1));
+		__builtin_memcpy(d + 16, &w2, sizeof (w2));
+		__builtin_memcpy(d + 24, &w3, sizeof (w3));
+		/* two independent carry chains */
+		ADDC64(sum0, w0);
+		ADDC64(sum1, w1);
+		ADDC64(sum0, w2);
+		ADDC64(sum1, w3);
+		s += 32;
+		d += 32;
+		len -= 32;
+	}
+	while (len >= 8) {
+		__builtin_memcpy(&w0, s, sizeof (w0));
+		__builtin_memcpy(d, &w0, sizeof (w0));
+		ADDC64(sum0, w0);
+		s += 8;
+		d += 8;
+		len -= 8;
+	}
+	if (len != 0) {
+		/* trailing bytes keep their position within the word */
+		w0 = 0;
+		__builtin_memcpy(&w0, s, len);
+		__builtin_memcpy(d, s, len);
+		ADDC64(sum0, w0);
+	}
+	ADDC64(sum0, sum1);
+
+	/* fold 64-bit to 16-bit */
+	sum0 = (sum0 >> 32) + (sum0 & 0xffffffff);	/* 33-bit */
+	sum0 += initial_sum;				/* 34-bit */
+	sum0 = (sum0 >> 16) + (sum0 & 0xffff);		/* 19-bit */
+	sum0 = (sum0 >> 16) + (sum0 & 0xffff);		/* 16-bit + carry */
+	sum0 = (sum0 >> 16) + (sum0 & 0xffff);		/* final carry */
+
+	return (sum0 & 0xffff);
+}
+
 #if defined(__i386__) || defined(__x86_64__)
 
 /*
@@ -192,6 +264,12 @@ os_cpu_in_cksum(const void *data, uint32_t len, uint32_t initial_sum)
  * Both versions are unrolled to handle 32 Byte / 64 Byte fragments as core
  * of the inner loop. After each iteration of the inner loop, a partial
  * reduction is done to avoid carry in long packets.
+ *
+ * On 64-bit, the 64 Byte inner loop instead adds 64-bit operands into
+ * two accumulators with end-around carry; this halves the number of
+ * additions, and the independent carry chains keep both ALUs busy.
+ * Vector units are not used, as they would require saving the FPU
+ * state of the interrupted thread.
  */
 
 #if !defined(__LP64__)
@@ -409,35 +487,26 @@ post_initial_offset:
 			data += 2;
 			mlen -= 2;
 		}
-		while (mlen >= 64) {
-			__builtin_prefetch(data + 32);
-			__builtin_prefetch(data + 64);
-			partial += *(uint32_t *)(void *)data;
-			partial += *(uint32_t *)(void *)(data + 4);
-			partial += *(uint32_t *)(void *)(data + 8);
-			partial += *(uint32_t *)(void *)(data + 12);
-			partial += *(uint32_t *)(void *)(data + 16);
-			partial += *(uint32_t *)(void *)(data + 20);
-			partial += *(uint32_t *)(void *)(data + 24);
-			partial += *(uint32_t *)(void *)(data + 28);
-			partial += *(uint32_t *)(void *)(data + 32);
-			partial += *(uint32_t *)(void *)(data + 36);
-			partial += *(uint32_t *)(void *)(data + 40);
-			partial += *(uint32_t *)(void *)(data + 44);
-			partial += *(uint32_t *)(void *)(data + 48);
-			partial += *(uint32_t *)(void *)(data + 52);
-			partial += *(uint32_t *)(void *)(data + 56);
-			partial += *(uint32_t *)(void *)(data + 60);
-			data += 64;
-			mlen -= 64;
-			if (PREDICT_FALSE(partial & (3ULL << 62))) {
-				if (needs_swap)
-					partial = (partial << 8) +
-					    (partial >> 56);
-				sum += (partial >> 32);
-				sum += (partial & 0xffffffff);
-				partial = 0;
-			}
+		if (mlen >= 64) {
+			uint64_t acc0 = 0, acc1 = 0;
+
+			do {
+				__builtin_prefetch(data + 64);
+				__builtin_prefetch(data + 128);
+				ADDC64(acc0, *(uint64_t *)(void *)data);
+				ADDC64(acc1, *(uint64_t *)(void *)(data + 8));
+				ADDC64(acc0, *(uint64_t *)(void *)(data + 16));
+				ADDC64(acc1, *(uint64_t *)(void *)(data + 24));
+				ADDC64(acc0, *(uint64_t *)(void *)(data + 32));
+				ADDC64(acc1, *(uint64_t *)(void *)(data + 40));
+				ADDC64(acc0, *(uint64_t *)(void *)(data + 48));
+				ADDC64(acc1, *(uint64_t *)(void *)(data + 56));
+				data += 64;
+				mlen -= 64;
+			} while (mlen >= 64);
+			ADDC64(acc0, acc1);
+			/* 33-bit; partial is at most 17-bit at this point */
+			partial += (acc0 >> 32) + (acc0 & 0xffffffff);
 		}
 		/*
 		 * mlen is not updated below as the remaining tests
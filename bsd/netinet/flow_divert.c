@@ -984,6 +984,58 @@ flow_divert_send_packet(struct flow_divert_pcb *fd_cb, mbuf_t packet, Boolean en
 	return error;
 }
 
+/*
+ * Batched flow_divert_send_packet(): enqueue a list of packets linked through
+ * m_nextpkt with a single ctl_enqueuembuf_list() call, so that a burst of
+ * data costs one control socket lock and one wakeup rather than one per packet.
+ * The packets that could not be enqueued are returned in *remain, unless
+ * enqueue is set, in which case they are queued on the group send queue.
+ */
+static int
+flow_divert_send_packet_list(struct flow_divert_pcb *fd_cb, mbuf_t packets, Boolean enqueue, mbuf_t *remain)
+{
+	int		error;
+
+	*remain = NULL;
+
+	if (fd_cb->group == NULL) {
+		fd_cb->so->so_error = ECONNABORTED;
+		flow_divert_disconnect_socket(fd_cb->so);
+		*remain = packets;
+		return ECONNABORTED;
+	}
+
+	lck_rw_lock_shared(&fd_cb->group->lck);
+
+	if (MBUFQ_EMPTY(&fd_cb->group->send_queue)) {
+		error = ctl_enqueuembuf_list(g_flow_divert_kctl_ref, fd_cb->group->ctl_unit, packets, 0, remain);
+	} else {
+		*remain = packets;
+		error = ENOBUFS;
+	}
+
+	if (error == ENOBUFS) {
+		if (enqueue && *remain != NULL) {
+			mbuf_t last = *remain;
+
+			while (MBUFQ_NEXT(last) != NULL) {
+				last = MBUFQ_NEXT(last);
+			}
+			if (!lck_rw_lock_shared_to_exclusive(&fd_cb->group->lck)) {
+				lck_rw_lock_exclusive(&fd_cb->group->lck);
+			}
+			MBUFQ_ENQUEUE_MULTI(&fd_cb->group->send_queue, *remain, last);
+			*remain = NULL;
+			error = 0;
+		}
+		OSTestAndSet(GROUP_BIT_CTL_ENQUEUE_BLOCKED, &fd_cb->group->atomic_bits);
+	}
+
+	lck_rw_done(&fd_cb->group->lck);
+
+	return error;
+}
+
 static int
 flow_divert_create_connect_packet(struct flow_divert_pcb *fd_cb, struct sockaddr *to, struct socket *so, proc_t p, mbuf_t *out_connect_packet)
 {
@@ -1348,10 +1400,9 @@ flow_divert_send_close_if_needed(struct flow_divert_pcb *fd_cb)
 }
 
 static errno_t
-flow_divert_send_data_packet(struct flow_divert_pcb *fd_cb, mbuf_t data, size_t data_len, struct sockaddr *toaddr, Boolean force)
+flow_divert_create_data_packet(struct flow_divert_pcb *fd_cb, mbuf_t data, size_t data_len, struct sockaddr *toaddr, mbuf_t *out_packet)
 {
 	mbuf_t	packet;
-	mbuf_t	last;
 	int		error	= 0;
 
 	error = flow_divert_packet_init(fd_cb, FLOW_DIVERT_PKT_DATA, &packet);
@@ -1364,20 +1415,50 @@ flow_divert_send_data_packet(struct flow_divert_pcb *fd_cb, mbuf_t data, size_t
 		error = flow_divert_append_target_endpoint_tlv(packet, toaddr);
 		if (error) {
 			FDLOG(LOG_ERR, fd_cb, "flow_divert_append_target_endpoint_tlv() failed: %d", error);
+			mbuf_freem(packet);
 			return error;
 		}
 	}
 
 	if (data_len > 0 && data != NULL) {
-		last = m_last(packet);
-		mbuf_setnext(last, data);
+		mbuf_setnext(m_last(packet), data);
 		mbuf_pkthdr_adjustlen(packet, data_len);
 	}
+
+	*out_packet = packet;
+	return 0;
+}
+
+/*
+ * Detach the payload of a data packet created by flow_divert_create_data_packet()
+ * without a target endpoint, and free the packet header.
+ */
+static mbuf_t
+flow_divert_packet_detach_data(mbuf_t packet)
+{
+	mbuf_t	data	= mbuf_next(packet);
+
+	mbuf_setnext(packet, NULL);
+	mbuf_freem(packet);
+
+	return data;
+}
+
+static errno_t
+flow_divert_send_data_packet(struct flow_divert_pcb *fd_cb, mbuf_t data, size_t data_len, struct sockaddr *toaddr, Boolean force)
+{
+	mbuf_t	packet;
+	int		error	= 0;
+
+	error = flow_divert_create_data_packet(fd_cb, data, data_len, toaddr, &packet);
+	if (error) {
+		return error;
+	}
+
 	error = flow_divert_send_packet(fd_cb, packet, force);
 
 	if (error) {
-		mbuf_setnext(last, NULL);
-		mbuf_freem(packet);
+		(void) flow_divert_packet_detach_data(packet);
 	} else {
 		fd_cb->bytes_sent += data_len;
 		flow_divert_add_data_statistics(fd_cb, data_len, TRUE);
@@ -1386,6 +1467,34 @@ flow_divert_send_data_packet(struct flow_divert_pcb *fd_cb, mbuf_t data, size_t
 	return error;
 }
 
+/*
+ * Send a list of data packets linked through m_nextpkt, created by
+ * flow_divert_create_data_packet() without a target endpoint and carrying
+ * data_len bytes of payload in total, in one pass through the kernel control.
+ * The packets that could not be sent are returned in *unsent, in order.
+ * Returns the number of payload bytes sent.
+ */
+static size_t
+flow_divert_send_data_packet_list(struct flow_divert_pcb *fd_cb, mbuf_t packets, size_t data_len, Boolean force, mbuf_t *unsent)
+{
+	size_t	sent	= data_len;
+	mbuf_t	packet;
+
+	(void) flow_divert_send_packet_list(fd_cb, packets, force, unsent);
+
+	/* The packets that were sent now belong to the control socket */
+	for (packet = *unsent; packet != NULL; packet = MBUFQ_NEXT(packet)) {
+		sent -= mbuf_pkthdr_len(packet) - sizeof(struct flow_divert_packet_header);
+	}
+
+	if (sent > 0) {
+		fd_cb->bytes_sent += sent;
+		flow_divert_add_data_statistics(fd_cb, sent, TRUE);
+	}
+
+	return sent;
+}
+
 static void
 flow_divert_send_buffered_data(struct flow_divert_pcb *fd_cb, Boolean force)
 {
@@ -1408,28 +1517,43 @@ flow_divert_send_buffered_data(struct flow_divert_pcb *fd_cb, Boolean force)
 	}
 
 	if (SOCK_TYPE(fd_cb->so) == SOCK_STREAM) {
-		while (sent < to_send) {
+		mbuf_t	packets	= NULL;
+		mbuf_t	*tail	= &packets;
+		mbuf_t	unsent	= NULL;
+		size_t	queued	= 0;
+
+		while (queued < to_send) {
 			mbuf_t	data;
+			mbuf_t	packet;
 			size_t	data_len;
 
-			data_len = to_send - sent;
+			data_len = to_send - queued;
 			if (data_len > FLOW_DIVERT_CHUNK_SIZE) {
 				data_len = FLOW_DIVERT_CHUNK_SIZE;
 			}
 
-			error = mbuf_copym(buffer, sent, data_len, MBUF_DONTWAIT, &data);
+			error = mbuf_copym(buffer, queued, data_len, MBUF_DONTWAIT, &data);
 			if (error) {
 				FDLOG(LOG_ERR, fd_cb, "mbuf_copym failed: %d", error);
 				break;
 			}
 
-			error = flow_divert_send_data_packet(fd_cb, data, data_len, NULL, force);
+			error = flow_divert_create_data_packet(fd_cb, data, data_len, NULL, &packet);
 			if (error) {
 				mbuf_freem(data);
 				break;
 			}
 
-			sent += data_len;
+			*tail = packet;
+			tail = &MBUFQ_NEXT(packet);
+			queued += data_len;
+		}
+
+		if (packets != NULL) {
+			sent = flow_divert_send_data_packet_list(fd_cb, packets, queued, force, &unsent);
+			if (unsent != NULL) {
+				mbuf_freem_list(unsent);
+			}
 		}
 		sbdrop(&fd_cb->so->so_snd, sent);
 		sowwakeup(fd_cb->so);
@@ -1505,17 +1629,22 @@ flow_divert_send_app_data(struct flow_divert_pcb *fd_cb, mbuf_t data, struct soc
 
 	if (SOCK_TYPE(fd_cb->so) == SOCK_STREAM) {
 		size_t	sent		= 0;
+		size_t	queued		= 0;
 		mbuf_t	remaining_data	= data;
 		mbuf_t	pkt_data	= NULL;
-		while (sent < to_send && remaining_data != NULL) {
+		mbuf_t	packets		= NULL;
+		mbuf_t	*tail		= &packets;
+		mbuf_t	unsent		= NULL;
+		while (queued < to_send && remaining_data != NULL) {
 			size_t	pkt_data_len;
+			mbuf_t	packet;
 
 			pkt_data = remaining_data;
 
-			if ((to_send - sent) > FLOW_DIVERT_CHUNK_SIZE) {
+			if ((to_send - queued) > FLOW_DIVERT_CHUNK_SIZE) {
 				pkt_data_len = FLOW_DIVERT_CHUNK_SIZE;
 			} else {
-				pkt_data_len = to_send - sent;
+				pkt_data_len = to_send - queued;
 			}
 
 			if (pkt_data_len < mbuf_pkthdr_len(pkt_data)) {
@@ -1529,20 +1658,48 @@ flow_divert_send_app_data(struct flow_divert_pcb *fd_cb, mbuf_t data, struct soc
 				remaining_data = NULL;
 			}
 
-			error = flow_divert_send_data_packet(fd_cb, pkt_data, pkt_data_len, NULL, FALSE);
+			error = flow_divert_create_data_packet(fd_cb, pkt_data, pkt_data_len, NULL, &packet);
 
 			if (error) {
 				break;
 			}
 
+			*tail = packet;
+			tail = &MBUFQ_NEXT(packet);
 			pkt_data = NULL;
-			sent += pkt_data_len;
+			queued += pkt_data_len;
+		}
+
+		if (packets != NULL) {
+			sent = flow_divert_send_data_packet_list(fd_cb, packets, queued, FALSE, &unsent);
 		}
 
 		fd_cb->send_window -= sent;
 
 		error = 0;
 
+		/* Put the data of the packets that could not be sent back in the send buffer, in order */
+		while (unsent != NULL) {
+			mbuf_t	packet		= unsent;
+			mbuf_t	unsent_data;
+
+			unsent = MBUFQ_NEXT(packet);
+			MBUFQ_NEXT(packet) = NULL;
+			unsent_data = flow_divert_packet_detach_data(packet);
+			if (unsent_data == NULL) {
+				continue;
+			}
+			if (sbspace(&fd_cb->so->so_snd) > 0) {
+				if (!sbappendstream(&fd_cb->so->so_snd, unsent_data)) {
+					FDLOG(LOG_ERR, fd_cb, "sbappendstream failed with unsent data, send buffer size = %u, send_window = %u\n",
+							fd_cb->so->so_snd.sb_cc, fd_cb->send_window);
+				}
+			} else {
+				mbuf_freem(unsent_data);
+				error = ENOBUFS;
+			}
+		}
+
 		if (pkt_data != NULL) {
 			if (sbspace(&fd_cb->so->so_snd) > 0) {
 				if (!sbappendstream(&fd_cb->so->so_snd, pkt_data)) {
@@ -3707,19 +3864,24 @@ flow_divert_kctl_rcvd(kern_ctl_ref kctlref __unused, uint32_t unit __unused, voi
 		lck_rw_lock_shared(&g_flow_divert_group_lck);
 		lck_rw_lock_exclusive(&group->lck);
 
-		while (!MBUFQ_EMPTY(&group->send_queue)) {
-			mbuf_t next_packet;
-			FDLOG0(LOG_DEBUG, &nil_pcb, "trying ctl_enqueuembuf again");
-			next_packet = MBUFQ_FIRST(&group->send_queue);
-			int error = ctl_enqueuembuf(g_flow_divert_kctl_ref, group->ctl_unit, next_packet, CTL_DATA_EOR);
+		if (!MBUFQ_EMPTY(&group->send_queue)) {
+			mbuf_t remain = NULL;
+			FDLOG0(LOG_DEBUG, &nil_pcb, "trying ctl_enqueuembuf_list again");
+			int error = ctl_enqueuembuf_list(g_flow_divert_kctl_ref, group->ctl_unit, MBUFQ_FIRST(&group->send_queue), 0, &remain);
 			if (error) {
-				FDLOG(LOG_DEBUG, &nil_pcb, "ctl_enqueuembuf returned an error: %d", error);
+				FDLOG(LOG_DEBUG, &nil_pcb, "ctl_enqueuembuf_list returned an error: %d", error);
+				/* The packets left over are the tail of the queue, so mq_last is still valid */
+				if (remain != NULL) {
+					MBUFQ_FIRST(&group->send_queue) = remain;
+				} else {
+					MBUFQ_INIT(&group->send_queue);
+				}
 				OSTestAndSet(GROUP_BIT_CTL_ENQUEUE_BLOCKED, &group->atomic_bits);
 				lck_rw_done(&group->lck);
 				lck_rw_done(&g_flow_divert_group_lck);
 				return;
 			}
-			MBUFQ_DEQUEUE(&group->send_queue, next_packet);
+			MBUFQ_INIT(&group->send_queue);
 		}
 
 		SLIST_INIT(&tmp_list);
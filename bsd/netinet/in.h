@@ -868,6 +868,8 @@ extern u_int32_t in_netof(struct in_addr);
 
 extern uint32_t os_cpu_in_cksum_mbuf(struct mbuf *m, int len, int off,
     uint32_t initial_sum);
+extern uint32_t os_cpu_copy_in_cksum(const void *src, void *dst,
+    uint32_t len, uint32_t initial_sum);
 
 extern uint16_t inet_cksum(struct mbuf *, uint32_t, uint32_t, uint32_t);
 extern uint16_t inet_cksum_buffer(const void *, uint32_t, uint32_t, uint32_t);
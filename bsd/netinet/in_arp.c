@@ -1341,6 +1341,15 @@ arp_lookup_ip(ifnet_t ifp, const struct sockaddr_in *net_dest,
 		lr = llinfo->la_llreach;
 		if (lr == NULL)
 			goto release;
+
+		/*
+		 * Normal case where peer is still reachable and we're
+		 * not probing; this is what nearly every packet sees, so
+		 * leave the route lock a spin lock and don't bother with
+		 * the llreach lock.
+		 */
+		if (!unreachable && !(llinfo->la_flags & LLINFO_PROBING))
+			goto release;
 		rt_ifa = route->rt_ifa;
 
 		/* Become a regular mutex, just in case */
@@ -1394,15 +1403,6 @@ arp_lookup_ip(ifnet_t ifp, const struct sockaddr_in *net_dest,
 			goto release;
 		} else {
 			IFLR_UNLOCK(lr);
-			if (!unreachable &&
-			    !(llinfo->la_flags & LLINFO_PROBING)) {
-				/*
-				 * Normal case where peer is still reachable,
-				 * we're not probing and if_addrlen is anything
-				 * but IF_LLREACH_MAXLEN.
-				 */
-				goto release;
-			}
 		}
 	}
 
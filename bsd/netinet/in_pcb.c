@@ -253,6 +253,17 @@ struct inp_flowhash_key {
 
 static u_int32_t inp_hash_seed = 0;
 
+/*
+ * SO_REUSEPORT load balancing: new connections to a local address and
+ * port shared by several listening TCP sockets with SO_REUSEPORT are
+ * spread across them, rather than all going to the same one.
+ */
+static int inp_reuseport_lb = 1;
+SYSCTL_INT(_net_inet_ip, OID_AUTO, reuseport_lb, CTLFLAG_RW | CTLFLAG_LOCKED,
+    &inp_reuseport_lb, 0, "Spread connections across SO_REUSEPORT listeners");
+
+static u_int32_t inp_reuseport_lb_seed = 0;
+
 static int infc_cmp(const struct inpcb *, const struct inpcb *);
 
 /* Flags used by inp_fc_getinp */
@@ -2181,6 +2192,77 @@ in_pcblookup_hash_exists(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 	return (found);
 }
 
+/*
+ * Hash of a connection, to pick the SO_REUSEPORT listener it goes to.
+ */
+u_int32_t
+inp_reuseport_lb_hash(int af, const void *faddr, u_short fport,
+    const void *laddr, u_short lport)
+{
+	struct inp_flowhash_key fh __attribute__((aligned(8)));
+	size_t len = (af == AF_INET6) ? sizeof (struct in6_addr) :
+	    sizeof (struct in_addr);
+
+	if (inp_reuseport_lb_seed == 0)
+		inp_reuseport_lb_seed = RandomULong();
+
+	bzero(&fh, sizeof (fh));
+	bcopy(laddr, &fh.infh_laddr, len);
+	bcopy(faddr, &fh.infh_faddr, len);
+	fh.infh_lport = lport;
+	fh.infh_fport = fport;
+	fh.infh_af = af;
+
+	return (net_flowhash(&fh, sizeof (fh), inp_reuseport_lb_seed));
+}
+
+boolean_t
+inp_reuseport_lb_member(struct inpcb *inp)
+{
+	struct socket *so = inp->inp_socket;
+
+	return (inp_reuseport_lb &&
+	    SOCK_PROTO(so) == IPPROTO_TCP &&
+	    (so->so_options & (SO_REUSEPORT | SO_ACCEPTCONN)) ==
+	    (SO_REUSEPORT | SO_ACCEPTCONN));
+}
+
+static u_int32_t
+inp_reuseport_lb_weight(struct inpcb *inp, u_int32_t hash)
+{
+	struct {
+		u_int64_t	inp;
+		u_int32_t	hash;
+		u_int32_t	pad;
+	} key __attribute__((aligned(8)));
+
+	key.inp = (u_int64_t)(uintptr_t)inp;
+	key.hash = hash;
+	key.pad = 0;
+
+	return (net_flowhash(&key, sizeof (key), inp_reuseport_lb_seed));
+}
+
+/*
+ * Of two PCBs matching a lookup equally well, return the one that gets
+ * the connection: the later one in the hash chain, as the lookups always
+ * did, unless both are SO_REUSEPORT listeners.  These are picked by
+ * highest random weight, so that each connection consistently goes to
+ * one of them and adding or closing one only moves its own share.
+ */
+struct inpcb *
+inp_reuseport_lb_select(struct inpcb *cur, struct inpcb *inp, u_int32_t hash)
+{
+	if (cur == NULL ||
+	    !inp_reuseport_lb_member(cur) || !inp_reuseport_lb_member(inp))
+		return (inp);
+
+	if (inp_reuseport_lb_weight(inp, hash) >
+	    inp_reuseport_lb_weight(cur, hash))
+		return (inp);
+	return (cur);
+}
+
 /*
  * Lookup PCB in hash list.
  */
@@ -2192,10 +2274,12 @@ in_pcblookup_hash(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 	struct inpcbhead *head;
 	struct inpcb *inp;
 	u_short fport = fport_arg, lport = lport_arg;
+	struct inpcb *local_exact = NULL;
 	struct inpcb *local_wild = NULL;
 #if INET6
 	struct inpcb *local_wild_mapped = NULL;
 #endif /* INET6 */
+	u_int32_t lb_hash;
 
 	/*
 	 * We may have found the pcb in the last lookup - check this first.
@@ -2243,6 +2327,7 @@ in_pcblookup_hash(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 		return (NULL);
 	}
 
+	lb_hash = inp_reuseport_lb_hash(AF_INET, &faddr, fport, &laddr, lport);
 	head = &pcbinfo->ipi_hashbase[INP_PCBHASH(INADDR_ANY, lport, 0,
 	    pcbinfo->ipi_hashmask)];
 	LIST_FOREACH(inp, head, inp_hash) {
@@ -2256,6 +2341,11 @@ in_pcblookup_hash(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 		if (inp->inp_faddr.s_addr == INADDR_ANY &&
 		    inp->inp_lport == lport) {
 			if (inp->inp_laddr.s_addr == laddr.s_addr) {
+				if (inp_reuseport_lb_member(inp)) {
+					local_exact = inp_reuseport_lb_select(
+					    local_exact, inp, lb_hash);
+					continue;
+				}
 				if (in_pcb_checkstate(inp, WNT_ACQUIRE, 0) !=
 				    WNT_STOPUSING) {
 					lck_rw_done(pcbinfo->ipi_lock);
@@ -2268,13 +2358,26 @@ in_pcblookup_hash(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 			} else if (inp->inp_laddr.s_addr == INADDR_ANY) {
 #if INET6
 				if (SOCK_CHECK_DOM(inp->inp_socket, PF_INET6))
-					local_wild_mapped = inp;
+					local_wild_mapped =
+					    inp_reuseport_lb_select(
+					    local_wild_mapped, inp, lb_hash);
 				else
 #endif /* INET6 */
-					local_wild = inp;
+					local_wild = inp_reuseport_lb_select(
+					    local_wild, inp, lb_hash);
 			}
 		}
 	}
+	if (local_exact != NULL) {
+		if (in_pcb_checkstate(local_exact, WNT_ACQUIRE, 0) !=
+		    WNT_STOPUSING) {
+			lck_rw_done(pcbinfo->ipi_lock);
+			return (local_exact);
+		}
+		/* it's dead; say it isn't found */
+		lck_rw_done(pcbinfo->ipi_lock);
+		return (NULL);
+	}
 	if (local_wild == NULL) {
 #if INET6
 		if (local_wild_mapped != NULL) {
@@ -819,6 +819,11 @@ extern void inp_set_want_app_policy(struct inpcb *);
 extern void inp_clear_want_app_policy(struct inpcb *);
 #endif /* NECP */
 extern u_int32_t inp_calc_flowhash(struct inpcb *);
+extern u_int32_t inp_reuseport_lb_hash(int, const void *, u_short,
+    const void *, u_short);
+extern boolean_t inp_reuseport_lb_member(struct inpcb *);
+extern struct inpcb *inp_reuseport_lb_select(struct inpcb *, struct inpcb *,
+    u_int32_t);
 extern void inp_reset_fc_state(struct inpcb *);
 extern int inp_set_fc_state(struct inpcb *, int advcode);
 extern void inp_fc_unthrottle_tcp(struct inpcb *);
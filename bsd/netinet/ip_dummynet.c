@@ -90,6 +90,7 @@
 #include <sys/socketvar.h>
 #include <sys/time.h>
 #include <sys/sysctl.h>
+#include <kern/thread_call.h>
 #include <net/if.h>
 #include <net/route.h>
 #include <net/kpi_protocol.h>
@@ -120,6 +121,8 @@ static dn_key curr_time = 0 ; /* current simulation time */
 /* this is for the timer that fires to call dummynet() - we only enable the timer when
 	there are packets to process, otherwise it's disabled */
 static int timer_enabled = 0;
+static dn_key timer_deadline;		/* when the timer is due, if enabled */
+static thread_call_t dn_timer_call;
 
 static int dn_hash_size = 64 ;	/* default hash size */
 
@@ -219,7 +222,8 @@ static lck_mtx_t         *dn_mutex = &dn_mutex_data;
 static int config_pipe(struct dn_pipe *p);
 static int ip_dn_ctl(struct sockopt *sopt);
 
-static void dummynet(void *);
+static void dummynet(thread_call_param_t, thread_call_param_t);
+static void dummynet_schedule(void);
 static void dummynet_flush(void);
 void dummynet_drain(void);
 static ip_dn_io_t dummynet_io;
@@ -1007,11 +1011,52 @@ ready_event_wfq(struct dn_pipe *p, struct mbuf **head, struct mbuf **tail)
 }
 
 /*
- * This is called every 1ms. It is used to
+ * Arm the timer for the earliest event in the heaps, unless it is
+ * already due by then.  Events are kept in milliseconds, so the timer
+ * fires at most every 1ms, but a pipe whose next packet is due in
+ * 100ms no longer wakes up dummynet() a hundred times in between.
+ * dn_timer_call is a single thread call, so re-entering it only moves
+ * the pending deadline earlier.
+ */
+static void
+dummynet_schedule(void)
+{
+	struct dn_heap *heaps[3] = { &ready_heap, &wfq_ready_heap,
+	    &extract_heap };
+	uint64_t deadline;
+	dn_key next = 0;
+	int i, found = 0;
+
+	LCK_MTX_ASSERT(dn_mutex, LCK_MTX_ASSERT_OWNED);
+
+	for (i = 0; i < 3; i++) {
+		if (heaps[i]->elements > 0 &&
+		    (!found || DN_KEY_LT(heaps[i]->p[0].key, next))) {
+			next = heaps[i]->p[0].key;
+			found = 1;
+		}
+	}
+	if (!found)
+		return;
+
+	if (DN_KEY_LEQ(next, curr_time))
+		next = curr_time + 1;
+	if (timer_enabled && DN_KEY_LEQ(timer_deadline, next))
+		return;
+
+	clock_interval_to_deadline((uint32_t)(next - curr_time),
+	    NSEC_PER_MSEC, &deadline);
+	thread_call_enter_delayed(dn_timer_call, deadline);
+	timer_deadline = next;
+	timer_enabled = 1;
+}
+
+/*
+ * This is called when the earliest event is due. It is used to
  * increment the current tick counter and schedule expired events.
  */
 static void
-dummynet(__unused void * unused)
+dummynet(__unused thread_call_param_t arg0, __unused thread_call_param_t arg1)
 {
     void *p ; /* generic parameter to handler */
     struct dn_heap *h ;
@@ -1019,7 +1064,6 @@ dummynet(__unused void * unused)
     struct mbuf *head = NULL, *tail = NULL;
     int i;
     struct dn_pipe *pe ;
-    struct timespec ts;
     struct timeval	tv;
 
     heaps[0] = &ready_heap ;		/* fixed-rate queues */
@@ -1069,20 +1113,9 @@ dummynet(__unused void * unused)
 	    pe->sum -= q->fs->weight ;
 	}
 
-	/* check the heaps to see if there's still stuff in there, and
-	 * only set the timer if there are packets to process
-	 */
+	/* only set the timer if there are packets to process */
 	timer_enabled = 0;
-	for (i=0; i < 3 ; i++) {
-		h = heaps[i];
-		if (h->elements > 0) { // set the timer
-			ts.tv_sec = 0;
-			ts.tv_nsec = 1 * 1000000;	// 1ms
-			timer_enabled = 1;
-			bsd_timeout(dummynet, NULL, &ts);
-			break;
-		}
-	}
+	dummynet_schedule();
 
 	if (head != NULL)
 		serialize++;
@@ -1482,7 +1515,6 @@ dummynet_io(struct mbuf *m, int pipe_nr, int dir, struct ip_fw_args *fwa, int cl
     u_int64_t len = m->m_pkthdr.len ;
     struct dn_flow_queue *q = NULL ;
     int is_pipe = 0;
-    struct timespec ts;
     struct timeval	tv;
 
     DPRINTF(("dummynet_io m: 0x%llx pipe: %d dir: %d client: %d\n",
@@ -1716,13 +1748,7 @@ dummynet_io(struct mbuf *m, int pipe_nr, int dir, struct ip_fw_args *fwa, int cl
 	}
     }
 done:
-	/* start the timer and set global if not already set */
-	if (!timer_enabled) {
-		ts.tv_sec = 0;
-		ts.tv_nsec = 1 * 1000000;	// 1ms
-		timer_enabled = 1;
-		bsd_timeout(dummynet, NULL, &ts);
-	}
+	dummynet_schedule();
 
 	lck_mtx_unlock(dn_mutex);
 
@@ -2541,6 +2567,10 @@ ip_dn_init(void)
 	dn_mutex_attr = lck_attr_alloc_init();
 	lck_mtx_init(dn_mutex, dn_mutex_grp, dn_mutex_attr);
 
+	dn_timer_call = thread_call_allocate(dummynet, NULL);
+	if (dn_timer_call == NULL)
+		panic("%s: thread_call_allocate failed", __func__);
+
 	ready_heap.size = ready_heap.elements = 0 ;
 	ready_heap.offset = 0 ;
 
@@ -385,8 +385,11 @@ static struct mbuf *ip_reass(struct mbuf *, u_int16_t *, u_int16_t *);
 #else /* !IPDIVERT */
 static struct mbuf *ip_reass(struct mbuf *);
 #endif /* !IPDIVERT */
-static void ip_fwd_route_copyout(struct ifnet *, struct route *);
-static void ip_fwd_route_copyin(struct ifnet *, struct route *);
+static struct route *ip_fwd_route_slot(struct ifnet *, struct in_addr);
+static void ip_fwd_route_copyout(struct ifnet *, struct in_addr,
+    struct route *);
+static void ip_fwd_route_copyin(struct ifnet *, struct in_addr,
+    struct route *);
 static inline u_short ip_cksum(struct mbuf *, int);
 
 int ip_use_randomid = 1;
@@ -3741,7 +3744,7 @@ static int
 sysctl_ipforwarding SYSCTL_HANDLER_ARGS
 {
 #pragma unused(arg1, arg2)
-	int i, was_ipforwarding = ipforwarding;
+	int i, j, was_ipforwarding = ipforwarding;
 
 	i = sysctl_handle_int(oidp, oidp->oid_arg1, oidp->oid_arg2, req);
 	if (i != 0 || req->newptr == USER_ADDR_NULL)
@@ -3754,8 +3757,9 @@ sysctl_ipforwarding SYSCTL_HANDLER_ARGS
 			struct ifnet *ifp = ifindex2ifnet[i];
 			if (ifp != NULL) {
 				lck_mtx_lock(&ifp->if_cached_route_lock);
-				ROUTE_RELEASE(&ifp->if_fwd_route);
-				bzero(&ifp->if_fwd_route,
+				for (j = 0; j < IF_FWD_ROUTE_CACHE_SIZE; j++)
+					ROUTE_RELEASE(&ifp->if_fwd_route[j]);
+				bzero(ifp->if_fwd_route,
 				    sizeof (ifp->if_fwd_route));
 				lck_mtx_unlock(&ifp->if_cached_route_lock);
 			}
@@ -3766,15 +3770,34 @@ sysctl_ipforwarding SYSCTL_HANDLER_ARGS
 	return (0);
 }
 
+/*
+ * Each receiving interface caches IF_FWD_ROUTE_CACHE_SIZE forwarding
+ * routes, one per destination hash bucket, so that traffic forwarded to
+ * a handful of destinations doesn't keep evicting a single cached route
+ * and falling back to a full routing table lookup for every packet.
+ * The cached route also carries the next hop's llinfo (ro_lle), which
+ * saves ip_output() the ARP lookup as well.
+ */
+static struct route *
+ip_fwd_route_slot(struct ifnet *ifp, struct in_addr dst)
+{
+	u_int32_t hash = dst.s_addr;
+
+	hash ^= hash >> 16;
+	hash ^= hash >> 8;
+	return (&ifp->if_fwd_route[hash % IF_FWD_ROUTE_CACHE_SIZE]);
+}
+
 /*
  * Similar to inp_route_{copyout,copyin} routines except that these copy
  * out the cached IPv4 forwarding route from struct ifnet instead of the
  * inpcb.  See comments for those routines for explanations.
  */
 static void
-ip_fwd_route_copyout(struct ifnet *ifp, struct route *dst)
+ip_fwd_route_copyout(struct ifnet *ifp, struct in_addr pkt_dst,
+    struct route *dst)
 {
-	struct route *src = &ifp->if_fwd_route;
+	struct route *src = ip_fwd_route_slot(ifp, pkt_dst);
 
 	lck_mtx_lock_spin(&ifp->if_cached_route_lock);
 	lck_mtx_convert_spin(&ifp->if_cached_route_lock);
@@ -3789,9 +3812,10 @@ ip_fwd_route_copyout(struct ifnet *ifp, struct route *dst)
 }
 
 static void
-ip_fwd_route_copyin(struct ifnet *ifp, struct route *src)
+ip_fwd_route_copyin(struct ifnet *ifp, struct in_addr pkt_dst,
+    struct route *src)
 {
-	struct route *dst = &ifp->if_fwd_route;
+	struct route *dst = ip_fwd_route_slot(ifp, pkt_dst);
 
 	lck_mtx_lock_spin(&ifp->if_cached_route_lock);
 	lck_mtx_convert_spin(&ifp->if_cached_route_lock);
@@ -3894,7 +3918,7 @@ ip_forward(struct mbuf *m, int srcrt, struct sockaddr_in *next_hop)
 	}
 #endif /* PF */
 
-	ip_fwd_route_copyout(rcvifp, &fwd_rt);
+	ip_fwd_route_copyout(rcvifp, pkt_dst, &fwd_rt);
 
 	sin = SIN(&fwd_rt.ro_dst);
 	if (ROUTE_UNUSABLE(&fwd_rt) || pkt_dst.s_addr != sin->sin_addr.s_addr) {
@@ -4169,7 +4193,7 @@ ip_forward(struct mbuf *m, int srcrt, struct sockaddr_in *next_hop)
 
 	icmp_error(mcopy, type, code, dest, nextmtu);
 done:
-	ip_fwd_route_copyin(rcvifp, &fwd_rt);
+	ip_fwd_route_copyin(rcvifp, pkt_dst, &fwd_rt);
 }
 
 int
@@ -49,6 +49,9 @@ void tcp_lro_init(void);
 /* When doing LRO in IP call this function */
 struct mbuf* tcp_lro(struct mbuf *m, unsigned int hlen);
 
+/* DLIL calls this at the end of an input batch */
+void tcp_lro_flush(void);
+
 /* TCP calls this to start coalescing a flow */
 int tcp_start_coalescing(struct ip *, struct tcphdr *, int tlen);
 
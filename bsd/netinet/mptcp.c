@@ -613,7 +613,7 @@ mptcp_output(struct mptses *mpte)
 	struct mptsub *mpts_tried = NULL;
 	struct socket *mp_so;
 	struct mptsub *preferred_mpts = NULL;
-	uint64_t old_snd_nxt;
+	uint64_t old_snd_nxt, sndnxt;
 	int error = 0;
 
 	mpte_lock_assert_held(mpte);
@@ -681,6 +681,7 @@ mptcp_output(struct mptses *mpte)
 
 		DTRACE_MPTCP3(output, struct mptses *, mpte, struct mptsub *, mpts,
 		    struct socket *, mp_so);
+		sndnxt = mp_tp->mpt_sndnxt;
 		error = mptcp_subflow_output(mpte, mpts, 0);
 		if (error) {
 			/* can be a temporary loss of source address or other error */
@@ -693,6 +694,11 @@ mptcp_output(struct mptses *mpte)
 					 MPTCP_SENDER_DBG, MPTCP_LOGLVL_ERR);
 			break;
 		}
+		if (MPTCP_SCHED(mpte)->sent != NULL &&
+		    MPTCP_SEQ_GT(mp_tp->mpt_sndnxt, sndnxt))
+			MPTCP_SCHED(mpte)->sent(mpte, mpts, sndnxt,
+			    (uint32_t)(mp_tp->mpt_sndnxt - sndnxt));
+
 		/* The model is to have only one active flow at a time */
 		mpts->mpts_flags |= MPTSF_ACTIVE;
 		mpts->mpts_probesoon = mpts->mpts_probecnt = 0;
@@ -784,10 +790,12 @@ mptcp_return_subflow(struct mptsub *mpts)
 }
 
 /*
- * Return the most eligible subflow to be used for sending data.
+ * Return the most eligible subflow to be used for sending data, according
+ * to the service type of the session.
  */
-struct mptsub *
-mptcp_get_subflow(struct mptses *mpte, struct mptsub *ignore, struct mptsub **preferred)
+static struct mptsub *
+mptcp_default_get_subflow(struct mptses *mpte, struct mptsub *ignore,
+    struct mptsub **preferred)
 {
 	struct tcpcb *besttp, *secondtp;
 	struct inpcb *bestinp, *secondinp;
@@ -967,6 +975,11 @@ mptcp_get_subflow(struct mptses *mpte, struct mptsub *ignore, struct mptsub **pr
 	return (NULL);
 }
 
+struct mptcp_sched_algo mptcp_sched_default = {
+	.name = "default",
+	.get_subflow = mptcp_default_get_subflow,
+};
+
 static const char *
 mptcp_event_to_str(uint32_t event)
 {
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+/*
+ * MPTCP subflow schedulers.
+ *
+ * The default scheduler (in mptcp.c) picks a subflow according to the
+ * service type of the session.  The ones here ignore the service type:
+ *
+ *   lowrtt	send on the subflow with the lowest smoothed RTT that has
+ *		room in its congestion window.
+ *   redundant	send new data on the lowest RTT subflow, and a copy of it
+ *		on another subflow through the reinject-queue, trading
+ *		capacity for latency.
+ *   rr		share the data between the subflows in proportion to their
+ *		rate (cwnd / srtt), with a deficit round-robin.
+ *
+ * The scheduler of a session is chosen when it is created, from
+ * net.inet.mptcp.scheduler.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/kernel.h>
+#include <sys/mbuf.h>
+#include <sys/socket.h>
+#include <sys/socketvar.h>
+#include <sys/sysctl.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/in_pcb.h>
+#include <netinet/tcp.h>
+#include <netinet/tcp_fsm.h>
+#include <netinet/tcp_var.h>
+#include <netinet/mptcp_var.h>
+#include <netinet/mptcp_seq.h>
+#include <libkern/OSAtomic.h>
+
+extern struct mptcp_sched_algo mptcp_sched_default;
+static struct mptcp_sched_algo mptcp_sched_lowrtt;
+static struct mptcp_sched_algo mptcp_sched_redundant;
+static struct mptcp_sched_algo mptcp_sched_rr;
+
+struct mptcp_sched_algo *mptcp_sched_list[MPTCP_SCHED_COUNT] = {
+	[MPTCP_SCHED_DEFAULT_INDEX] = &mptcp_sched_default,
+	[MPTCP_SCHED_LOWRTT_INDEX] = &mptcp_sched_lowrtt,
+	[MPTCP_SCHED_REDUNDANT_INDEX] = &mptcp_sched_redundant,
+	[MPTCP_SCHED_RR_INDEX] = &mptcp_sched_rr,
+};
+
+static int mptcp_sched_index = MPTCP_SCHED_DEFAULT_INDEX;
+
+static int
+mptcp_sysctl_scheduler SYSCTL_HANDLER_ARGS
+{
+#pragma unused(arg1, arg2)
+	char name[MPTCP_SCHED_NAME_MAX];
+	int error, i;
+
+	strlcpy(name, mptcp_sched_list[mptcp_sched_index]->name, sizeof(name));
+	error = sysctl_handle_string(oidp, name, sizeof(name), req);
+	if (error != 0 || req->newptr == USER_ADDR_NULL)
+		return (error);
+
+	for (i = 0; i < MPTCP_SCHED_COUNT; i++) {
+		if (strncmp(mptcp_sched_list[i]->name, name,
+		    MPTCP_SCHED_NAME_MAX) == 0) {
+			mptcp_sched_index = i;
+			return (0);
+		}
+	}
+	return (EINVAL);
+}
+
+SYSCTL_PROC(_net_inet_mptcp, OID_AUTO, scheduler,
+    CTLTYPE_STRING | CTLFLAG_RW | CTLFLAG_LOCKED, 0, 0,
+    mptcp_sysctl_scheduler, "A", "Subflow scheduler of new MPTCP sessions");
+
+SYSCTL_UINT(_net_inet_mptcp, OID_AUTO, lowrtt_sessions,
+    CTLFLAG_RD | CTLFLAG_LOCKED, &mptcp_sched_lowrtt.num_sessions, 0,
+    "Number of sessions using the lowest RTT scheduler");
+
+SYSCTL_UINT(_net_inet_mptcp, OID_AUTO, redundant_sessions,
+    CTLFLAG_RD | CTLFLAG_LOCKED, &mptcp_sched_redundant.num_sessions, 0,
+    "Number of sessions using the redundant scheduler");
+
+SYSCTL_UINT(_net_inet_mptcp, OID_AUTO, rr_sessions,
+    CTLFLAG_RD | CTLFLAG_LOCKED, &mptcp_sched_rr.num_sessions, 0,
+    "Number of sessions using the round-robin scheduler");
+
+static uint32_t mptcp_sched_rr_round = 10;
+SYSCTL_UINT(_net_inet_mptcp, OID_AUTO, rr_round, CTLFLAG_RW | CTLFLAG_LOCKED,
+    &mptcp_sched_rr_round, 0,
+    "Length of a round-robin round in ms, at the rate of each subflow");
+
+void
+mptcp_sched_attach(struct mptses *mpte)
+{
+	mpte->mpte_sched_index = mptcp_sched_index;
+	OSIncrementAtomic((volatile SInt32 *)&MPTCP_SCHED(mpte)->num_sessions);
+}
+
+void
+mptcp_sched_detach(struct mptses *mpte)
+{
+	OSDecrementAtomic((volatile SInt32 *)&MPTCP_SCHED(mpte)->num_sessions);
+}
+
+struct mptsub *
+mptcp_get_subflow(struct mptses *mpte, struct mptsub *ignore,
+    struct mptsub **preferred)
+{
+	return (MPTCP_SCHED(mpte)->get_subflow(mpte, ignore, preferred));
+}
+
+/*
+ * Whether a subflow can carry data at the MPTCP level; these are the hard
+ * conditions of the default scheduler.
+ */
+static boolean_t
+mptcp_sched_usable(struct mptsub *mpts, struct mptsub *ignore)
+{
+	struct socket *so = mpts->mpts_socket;
+	struct tcpcb *tp = sototcpcb(so);
+	struct inpcb *inp = sotoinpcb(so);
+
+	if (mpts == ignore || inp->inp_last_outifp == NULL ||
+	    INP_WAIT_FOR_IF_FEEDBACK(inp))
+		return (FALSE);
+
+	if (!(mpts->mpts_flags & MPTSF_MP_CAPABLE))
+		return (FALSE);
+
+	if ((so->so_state & SS_ISDISCONNECTED) ||
+	    !(so->so_state & SS_ISCONNECTED) ||
+	    !TCPS_HAVEESTABLISHED(tp->t_state) ||
+	    tp->t_state > TCPS_CLOSE_WAIT)
+		return (FALSE);
+
+	return (TRUE);
+}
+
+/*
+ * A degraded subflow, or one still waiting to send its preconnect data,
+ * has to be used no matter what; leave those cases to the default
+ * scheduler.
+ */
+static boolean_t
+mptcp_sched_needs_default(struct mptses *mpte, struct mptsub *ignore)
+{
+	struct mptsub *mpts;
+
+	TAILQ_FOREACH(mpts, &mpte->mpte_subflows, mpts_entry) {
+		struct inpcb *inp = sotoinpcb(mpts->mpts_socket);
+
+		if (mpts == ignore || inp->inp_last_outifp == NULL ||
+		    INP_WAIT_FOR_IF_FEEDBACK(inp))
+			continue;
+
+		if ((mpts->mpts_flags & MPTSF_MP_DEGRADED) ||
+		    (mpts->mpts_socket->so_flags1 & SOF1_PRECONNECT_DATA))
+			return (TRUE);
+	}
+	return (FALSE);
+}
+
+/* Subflows without an RTT sample yet come after all the others */
+static int
+mptcp_sched_srtt(struct mptsub *mpts)
+{
+	struct tcpcb *tp = sototcpcb(mpts->mpts_socket);
+
+	return (tp->t_srtt != 0 ? tp->t_srtt : INT_MAX);
+}
+
+static struct mptsub *
+mptcp_sched_lowrtt_get_subflow(struct mptses *mpte, struct mptsub *ignore,
+    struct mptsub **preferred)
+{
+	struct mptsub *mpts, *best = NULL;
+
+	if (mptcp_sched_needs_default(mpte, ignore))
+		return (mptcp_sched_default.get_subflow(mpte, ignore,
+		    preferred));
+
+	TAILQ_FOREACH(mpts, &mpte->mpte_subflows, mpts_entry) {
+		if (!mptcp_sched_usable(mpts, ignore) ||
+		    mptcp_subflow_cwnd_space(mpts->mpts_socket) <= 0)
+			continue;
+
+		if (best == NULL ||
+		    mptcp_sched_srtt(mpts) < mptcp_sched_srtt(best))
+			best = mpts;
+	}
+	return (best);
+}
+
+static struct mptsub *
+mptcp_sched_redundant_get_subflow(struct mptses *mpte, struct mptsub *ignore,
+    struct mptsub **preferred)
+{
+	struct mptsub *mpts;
+
+	if (mptcp_sched_needs_default(mpte, ignore))
+		return (mptcp_sched_default.get_subflow(mpte, ignore,
+		    preferred));
+
+	if (mpte->mpte_reinjectq != NULL) {
+		/* Send the copies on a subflow that does not have them yet */
+		TAILQ_FOREACH(mpts, &mpte->mpte_subflows, mpts_entry) {
+			if (mptcp_sched_usable(mpts, ignore) &&
+			    mptcp_subflow_cwnd_space(mpts->mpts_socket) > 0 &&
+			    !mptcp_search_seq_in_sub(mpte->mpte_reinjectq,
+			    mpts->mpts_socket))
+				return (mpts);
+		}
+
+		/*
+		 * None can take them right now; hold off unless there is
+		 * new data to send.
+		 */
+		if (!mptcp_can_send_more(mpte->mpte_mptcb, TRUE))
+			return (NULL);
+	}
+
+	return (mptcp_sched_lowrtt_get_subflow(mpte, ignore, preferred));
+}
+
+static void
+mptcp_sched_redundant_sent(struct mptses *mpte, struct mptsub *mpts,
+    uint64_t dsn, uint32_t len)
+{
+#pragma unused(len)
+	struct mptsub *other;
+
+	TAILQ_FOREACH(other, &mpte->mpte_subflows, mpts_entry) {
+		if (other != mpts && mptcp_sched_usable(other, NULL)) {
+			mptcp_subflow_duplicate(mpte, mpts, dsn);
+			return;
+		}
+	}
+}
+
+/* Bytes a subflow gets per round: what it delivers in mptcp_sched_rr_round */
+static int32_t
+mptcp_sched_rr_quantum(struct mptsub *mpts)
+{
+	struct tcpcb *tp = sototcpcb(mpts->mpts_socket);
+	uint32_t srtt = tp->t_srtt >> TCP_RTT_SHIFT;
+	uint64_t quantum = tp->snd_cwnd;
+
+	if (srtt != 0)
+		quantum = (quantum * mptcp_sched_rr_round) / srtt;
+	if (quantum < tp->t_maxseg)
+		quantum = tp->t_maxseg;
+	if (quantum > (INT_MAX >> 1))
+		quantum = (INT_MAX >> 1);
+	return ((int32_t)quantum);
+}
+
+static struct mptsub *
+mptcp_sched_rr_pick(struct mptses *mpte, struct mptsub *ignore)
+{
+	struct mptsub *mpts, *best = NULL;
+
+	TAILQ_FOREACH(mpts, &mpte->mpte_subflows, mpts_entry) {
+		if (!mptcp_sched_usable(mpts, ignore) ||
+		    mptcp_subflow_cwnd_space(mpts->mpts_socket) <= 0)
+			continue;
+
+		if (best == NULL ||
+		    mpts->mpts_sched_credit > best->mpts_sched_credit)
+			best = mpts;
+	}
+	return (best);
+}
+
+static struct mptsub *
+mptcp_sched_rr_get_subflow(struct mptses *mpte, struct mptsub *ignore,
+    struct mptsub **preferred)
+{
+	struct mptsub *mpts, *best;
+
+	if (mptcp_sched_needs_default(mpte, ignore))
+		return (mptcp_sched_default.get_subflow(mpte, ignore,
+		    preferred));
+
+	best = mptcp_sched_rr_pick(mpte, ignore);
+	if (best == NULL || best->mpts_sched_credit > 0)
+		return (best);
+
+	/*
+	 * Every subflow that can send has used up its share; start a new
+	 * round. Overdrafts are carried over, the unused credit of the
+	 * subflows that had no room to send is not.
+	 */
+	TAILQ_FOREACH(mpts, &mpte->mpte_subflows, mpts_entry) {
+		if (!mptcp_sched_usable(mpts, ignore))
+			continue;
+
+		if (mpts->mpts_sched_credit > 0)
+			mpts->mpts_sched_credit = 0;
+		mpts->mpts_sched_credit += mptcp_sched_rr_quantum(mpts);
+	}
+	return (mptcp_sched_rr_pick(mpte, ignore));
+}
+
+static void
+mptcp_sched_rr_sent(struct mptses *mpte, struct mptsub *mpts, uint64_t dsn,
+    uint32_t len)
+{
+#pragma unused(mpte, dsn)
+	mpts->mpts_sched_credit -= (int32_t)len;
+}
+
+static struct mptcp_sched_algo mptcp_sched_lowrtt = {
+	.name = "lowrtt",
+	.get_subflow = mptcp_sched_lowrtt_get_subflow,
+};
+
+static struct mptcp_sched_algo mptcp_sched_redundant = {
+	.name = "redundant",
+	.get_subflow = mptcp_sched_redundant_get_subflow,
+	.sent = mptcp_sched_redundant_sent,
+};
+
+static struct mptcp_sched_algo mptcp_sched_rr = {
+	.name = "rr",
+	.get_subflow = mptcp_sched_rr_get_subflow,
+	.sent = mptcp_sched_rr_sent,
+};
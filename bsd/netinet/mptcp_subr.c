@@ -499,6 +499,8 @@ mptcp_sescreate(struct mppcb *mpp)
 	mpte->mpte_itfinfo = &mpte->_mpte_itfinfo[0];
 	mpte->mpte_itfinfo_size = MPTE_ITFINFO_SIZE;
 
+	mptcp_sched_attach(mpte);
+
 	if (mptcp_alternate_port)
 		mpte->mpte_alternate_port = htons(mptcp_alternate_port);
 
@@ -671,6 +673,7 @@ mptcp_session_destroy(struct mptses *mpte)
 	VERIFY(mp_tp != NULL);
 
 	mptcpstats_session_wrapup(mpte);
+	mptcp_sched_detach(mpte);
 
 	mptcp_unset_cellicon();
 
@@ -2475,7 +2478,7 @@ mptcp_subflow_wupcall(struct socket *so, void *arg, int waitf)
 	mptcp_output(mpte);
 }
 
-static boolean_t
+boolean_t
 mptcp_search_seq_in_sub(struct mbuf *m, struct socket *so)
 {
 	struct mbuf *so_m = so->so_snd.sb_mb;
@@ -3123,6 +3126,43 @@ next:
 	}
 }
 
+/*
+ * Queue a copy of the data a subflow just sent, starting at dsn, on the
+ * reinject-queue so that another subflow sends it as well.
+ */
+void
+mptcp_subflow_duplicate(struct mptses *mpte, struct mptsub *mpts, uint64_t dsn)
+{
+	struct mptcb *mp_tp = mpte->mpte_mptcb;
+	struct mbuf *m = mpts->mpts_socket->so_snd.sb_mb;
+
+	while (m) {
+		struct mbuf *n, *orig = m;
+
+		VERIFY((m->m_flags & M_PKTHDR) && (m->m_pkthdr.pkt_flags & PKTF_MPTCP));
+
+		if (MPTCP_SEQ_LT(m->m_pkthdr.mp_dsn, dsn) ||
+		    (m->m_pkthdr.pkt_flags & PKTF_MPTCP_REINJ) ||
+		    MPTCP_SEQ_GEQ(mp_tp->mpt_snduna, m->m_pkthdr.mp_dsn + m->m_pkthdr.mp_rlen)) {
+			m = m->m_next;
+			continue;
+		}
+
+		n = mptcp_copy_mbuf_list(m, m->m_pkthdr.mp_rlen);
+		if (n == NULL)
+			break;
+
+		VERIFY(n->m_nextpkt == NULL);
+		mptcp_add_reinjectq(mpte, n);
+
+		/* mp_rlen can cover multiple mbufs, mark all of them */
+		while (m && m->m_pkthdr.mp_dsn == orig->m_pkthdr.mp_dsn) {
+			m->m_pkthdr.pkt_flags |= PKTF_MPTCP_REINJ;
+			m = m->m_next;
+		}
+	}
+}
+
 void
 mptcp_clean_reinjectq(struct mptses *mpte)
 {
@@ -5524,6 +5564,10 @@ fill_mptcp_subflow(struct socket *so, mptcp_flow_t *flow, struct mptsub *mpts)
 	flow->flow_relseq = mpts->mpts_rel_seq;
 	flow->flow_soerror = mpts->mpts_socket->so_error;
 	flow->flow_probecnt = mpts->mpts_probecnt;
+	flow->flow_sndq_cc = so->so_snd.sb_cc;
+	flow->flow_srtt = sototcpcb(so)->t_srtt >> TCP_RTT_SHIFT;
+	flow->flow_rttvar = sototcpcb(so)->t_rttvar >> TCP_RTTVAR_SHIFT;
+	flow->flow_sched_credit = mpts->mpts_sched_credit;
 }
 
 static int
@@ -5580,6 +5624,8 @@ mptcp_pcblist SYSCTL_HANDLER_ARGS
 		mptcpci.mptcpci_nflows = mpte->mpte_numflows;
 		mptcpci.mptcpci_mpte_flags = mpte->mpte_flags;
 		mptcpci.mptcpci_mpte_addrid = mpte->mpte_addrid_last;
+		strlcpy(mptcpci.mptcpci_sched, MPTCP_SCHED(mpte)->name,
+		    sizeof(mptcpci.mptcpci_sched));
 		mptcpci.mptcpci_flow_offset =
 		    offsetof(conninfo_mptcp_t, mptcpci_flows);
 
@@ -32,6 +32,8 @@
 #ifdef PRIVATE
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+
+#define	MPTCP_SCHED_NAME_MAX	16	/* length of a subflow scheduler name */
 #endif
 
 #ifdef BSD_KERNEL_PRIVATE
@@ -94,6 +96,7 @@ struct mptses {
 	uint8_t	mpte_svctype;			/* MPTCP Service type */
 	uint8_t	mpte_lost_aid;			/* storing lost address id */
 	uint8_t	mpte_addrid_last;		/* storing address id parm */
+	uint8_t	mpte_sched_index;		/* subflow scheduler */
 
 #define	MPTE_ITFINFO_SIZE	4
 	uint32_t	mpte_itfinfo_size;
@@ -280,8 +283,39 @@ struct mptsub {
 	uint32_t		mpts_probesoon;	/* send probe after probeto */
 	uint32_t		mpts_probecnt;	/* number of probes sent */
 	uint32_t		mpts_maxseg;	/* cached value of t_maxseg */
+	int32_t			mpts_sched_credit; /* bytes left in the scheduling round */
 };
 
+/*
+ * MPTCP subflow schedulers
+ *
+ * The scheduler of a session picks the subflow that sends the next chunk
+ * of data, just like the congestion control algorithm of a connection is
+ * picked from tcp_cc_algo_list.  get_subflow returns the subflow to send
+ * on, NULL if none can take more data, and may return in *preferred the
+ * subflow it would rather use, which then gets probed to keep its RTT
+ * estimate current.  sent, if set, is called after new data (starting at
+ * dsn) went out on a subflow.
+ */
+struct mptcp_sched_algo {
+	char		name[MPTCP_SCHED_NAME_MAX];
+	uint32_t	num_sessions;
+	struct mptsub	*(*get_subflow)(struct mptses *mpte,
+			    struct mptsub *ignore, struct mptsub **preferred);
+	void		(*sent)(struct mptses *mpte, struct mptsub *mpts,
+			    uint64_t dsn, uint32_t len);
+} __attribute__((aligned(4)));
+
+#define	MPTCP_SCHED_DEFAULT_INDEX	0 /* by service type */
+#define	MPTCP_SCHED_LOWRTT_INDEX	1 /* lowest RTT first */
+#define	MPTCP_SCHED_REDUNDANT_INDEX	2 /* duplicate on all subflows */
+#define	MPTCP_SCHED_RR_INDEX		3 /* rate weighted round-robin */
+#define	MPTCP_SCHED_COUNT		4
+
+extern struct mptcp_sched_algo *mptcp_sched_list[MPTCP_SCHED_COUNT];
+
+#define	MPTCP_SCHED(_mpte)	(mptcp_sched_list[(_mpte)->mpte_sched_index])
+
 /*
  * Valid values for mpts_flags.  In particular:
  *
@@ -641,6 +675,11 @@ extern void mptcp_output_getm_dsnmap64(struct socket *so, int off,
 extern void mptcp_act_on_txfail(struct socket *);
 extern struct mptsub *mptcp_get_subflow(struct mptses *, struct mptsub *,
     struct mptsub **);
+extern void mptcp_sched_attach(struct mptses *);
+extern void mptcp_sched_detach(struct mptses *);
+extern boolean_t mptcp_search_seq_in_sub(struct mbuf *, struct socket *);
+extern void mptcp_subflow_duplicate(struct mptses *, struct mptsub *,
+    uint64_t);
 extern int mptcp_get_map_for_dsn(struct socket *, u_int64_t, u_int32_t *);
 extern int32_t mptcp_adj_sendlen(struct socket *so, int32_t off);
 extern void mptcp_sbrcv_grow(struct mptcb *mp_tp);
@@ -682,6 +721,10 @@ typedef struct mptcp_flow {
 	uint32_t		flow_relseq;	/* last subflow rel seq# */
 	int32_t			flow_soerror;	/* subflow level error */
 	uint32_t		flow_probecnt;	/* number of probes sent */
+	uint32_t		flow_sndq_cc;	/* bytes in subflow send queue */
+	uint32_t		flow_srtt;	/* smoothed RTT, in ms */
+	uint32_t		flow_rttvar;	/* RTT variance, in ms */
+	int32_t			flow_sched_credit; /* scheduler round credit */
 	conninfo_tcp_t		flow_ci;	/* must be the last field */
 } mptcp_flow_t;
 
@@ -710,6 +753,7 @@ typedef struct conninfo_mptcp {
 	uint32_t	mptcpci_rcvwnd;		/* Receive window */
 
 	uint8_t		mptcpci_mpte_addrid;	/* last addr id */
+	char		mptcpci_sched[MPTCP_SCHED_NAME_MAX]; /* subflow scheduler */
 
 	mptcp_flow_t	mptcpci_flows[1];
 } conninfo_mptcp_t;
@@ -300,6 +300,14 @@ struct tcp_notify_ack_complete {
 
 #define MPTCP_ALTERNATE_PORT		0x216
 
+/*
+ * Congestion control algorithm used by the connection, by name: "newreno",
+ * "cubic" or "bbr". At most TCP_CC_NAME_MAX characters including the
+ * terminating NUL.
+ */
+#define	TCP_CONGESTION_ALGO		0x217
+#define	TCP_CC_NAME_MAX			16
+
 /*
  * The TCP_INFO socket option is a private API and is subject to change
  */
@@ -428,6 +436,11 @@ struct tcp_info {
 	u_int32_t	tcpi_flowhash;		/* Unique id for the connection */
 
 	u_int64_t	tcpi_txretransmitpackets __attribute__((aligned(8)));
+
+	u_int32_t	tcpi_snd_sbhiwat;	/* send socket buffer size */
+	u_int32_t	tcpi_snd_sbideal;	/* send buffer size autotuning aims for */
+	u_int32_t	tcpi_rcv_sbhiwat;	/* receive socket buffer size */
+	u_int32_t	tcpi_rcv_sbideal;	/* receive buffer size autotuning aims for */
 };
 
 struct tcp_measure_bw_burst {
@@ -0,0 +1,464 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+/*
+ * Model based congestion control, after BBR (draft-cardwell-iccrg-bbr).
+ *
+ * Instead of reacting to loss, the connection keeps an estimate of the
+ * bottleneck bandwidth (the max delivery rate over the last
+ * TCP_BBR_BW_ROUNDS round trips) and of the propagation delay (the min
+ * rtt over the last tcp_bbr_min_rtt_win). It paces at a gain of the
+ * bandwidth estimate and caps the congestion window at a gain of their
+ * product.
+ *
+ * The delivery rate is sampled once per round trip, from the bytes
+ * cumulatively acknowledged during that round. Rounds in which the
+ * sender did not have enough data to fill the window are only used when
+ * they raise the estimate.
+ */
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/kernel.h>
+#include <sys/protosw.h>
+#include <sys/socketvar.h>
+
+#include <netinet/in.h>
+#include <netinet/in_systm.h>
+#include <netinet/ip.h>
+#include <netinet/in_pcb.h>
+#include <netinet/tcp.h>
+#include <netinet/tcp_fsm.h>
+#include <netinet/tcp_seq.h>
+#include <netinet/tcp_timer.h>
+#include <netinet/tcp_var.h>
+#include <netinet/tcp_cc.h>
+#include <libkern/OSAtomic.h>
+
+static int tcp_bbr_init(struct tcpcb *tp);
+static int tcp_bbr_cleanup(struct tcpcb *tp);
+static void tcp_bbr_cwnd_init(struct tcpcb *tp);
+static void tcp_bbr_ack_rcvd(struct tcpcb *tp, struct tcphdr *th);
+static void tcp_bbr_pre_fr(struct tcpcb *tp);
+static void tcp_bbr_post_fr(struct tcpcb *tp, struct tcphdr *th);
+static void tcp_bbr_after_idle(struct tcpcb *tp);
+static void tcp_bbr_after_timeout(struct tcpcb *tp);
+static int tcp_bbr_delay_ack(struct tcpcb *tp, struct tcphdr *th);
+static void tcp_bbr_switch_cc(struct tcpcb *tp, u_int16_t old_index);
+
+struct tcp_cc_algo tcp_cc_bbr = {
+	.name = "bbr",
+	.init = tcp_bbr_init,
+	.cleanup = tcp_bbr_cleanup,
+	.cwnd_init = tcp_bbr_cwnd_init,
+	.congestion_avd = tcp_bbr_ack_rcvd,
+	.ack_rcvd = tcp_bbr_ack_rcvd,
+	.pre_fr = tcp_bbr_pre_fr,
+	.post_fr = tcp_bbr_post_fr,
+	.after_idle = tcp_bbr_after_idle,
+	.after_timeout = tcp_bbr_after_timeout,
+	.delay_ack = tcp_bbr_delay_ack,
+	.switch_to = tcp_bbr_switch_cc
+};
+
+#define	TCP_BBR_STARTUP		0	/* grow the rate exponentially */
+#define	TCP_BBR_DRAIN		1	/* drain the queue built in startup */
+#define	TCP_BBR_PROBE_BW	2	/* cycle around the bandwidth estimate */
+#define	TCP_BBR_PROBE_RTT	3	/* shrink the window to measure min rtt */
+
+/* Gains are in units of 1/TCP_BBR_UNIT */
+#define	TCP_BBR_UNIT		256
+#define	TCP_BBR_HIGH_GAIN	739	/* 2/ln(2), doubles rate each round */
+#define	TCP_BBR_DRAIN_GAIN	89	/* 1/TCP_BBR_HIGH_GAIN */
+#define	TCP_BBR_CWND_GAIN	512
+#define	TCP_BBR_CYCLE_LEN	8
+
+static const u_int16_t tcp_bbr_pacing_cycle[TCP_BBR_CYCLE_LEN] = {
+	320, 192, 256, 256, 256, 256, 256, 256
+};
+
+#define	TCP_BBR_FULL_BW_ROUNDS	3	/* rounds below 25% growth to leave startup */
+#define	TCP_BBR_MIN_CWND_SEGS	4
+#define	TCP_BBR_PROBE_RTT_TIME	(TCP_RETRANSHZ / 5)
+
+SYSCTL_SKMEM_TCP_INT(OID_AUTO, bbr_min_rtt_win, CTLFLAG_RW | CTLFLAG_LOCKED,
+	static int, tcp_bbr_min_rtt_win, 10 * TCP_RETRANSHZ,
+	"Time in ms after which bbr measures the min rtt again");
+
+static inline u_int32_t
+tcp_bbr_bdp(struct tcpcb *tp, u_int32_t gain)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+
+	return ((u_int32_t)(((u_int64_t)cs->bbr_max_bw * cs->bbr_min_rtt *
+	    gain) / (TCP_RETRANSHZ * TCP_BBR_UNIT)));
+}
+
+static inline u_int32_t
+tcp_bbr_target_cwnd(struct tcpcb *tp)
+{
+	/* leave room for acks that are delayed or aggregated */
+	return (tcp_bbr_bdp(tp, tp->t_ccstate->bbr_cwnd_gain) +
+	    3 * tp->t_maxseg);
+}
+
+static void
+tcp_bbr_set_mode(struct tcpcb *tp, u_int8_t mode)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+
+	cs->bbr_mode = mode;
+	switch (mode) {
+	case TCP_BBR_STARTUP:
+		cs->bbr_pacing_gain = TCP_BBR_HIGH_GAIN;
+		cs->bbr_cwnd_gain = TCP_BBR_HIGH_GAIN;
+		break;
+	case TCP_BBR_DRAIN:
+		cs->bbr_pacing_gain = TCP_BBR_DRAIN_GAIN;
+		cs->bbr_cwnd_gain = TCP_BBR_HIGH_GAIN;
+		break;
+	case TCP_BBR_PROBE_BW:
+		/* start anywhere in the cycle but in the draining phase */
+		cs->bbr_cycle_idx = (tcp_now % (TCP_BBR_CYCLE_LEN - 1));
+		if (cs->bbr_cycle_idx > 0)
+			cs->bbr_cycle_idx++;
+		cs->bbr_cycle_ts = tcp_now;
+		cs->bbr_pacing_gain = tcp_bbr_pacing_cycle[cs->bbr_cycle_idx];
+		cs->bbr_cwnd_gain = TCP_BBR_CWND_GAIN;
+		break;
+	case TCP_BBR_PROBE_RTT:
+		cs->bbr_pacing_gain = TCP_BBR_UNIT;
+		cs->bbr_cwnd_gain = TCP_BBR_UNIT;
+		cs->bbr_probe_rtt_done = 0;
+		cs->bbr_prior_cwnd = max(cs->bbr_prior_cwnd, tp->snd_cwnd);
+		break;
+	}
+}
+
+static void
+tcp_bbr_clear_state(struct tcpcb *tp)
+{
+	bzero(tp->t_ccstate, sizeof(*tp->t_ccstate));
+	tp->t_ccstate->bbr_round_end = tp->snd_max;
+	tp->t_ccstate->bbr_round_una = tp->snd_una;
+	tp->t_ccstate->bbr_round_ts = tcp_now;
+	tp->t_ccstate->bbr_min_rtt_ts = tcp_now;
+	tcp_bbr_set_mode(tp, TCP_BBR_STARTUP);
+}
+
+static int
+tcp_bbr_init(struct tcpcb *tp)
+{
+	OSIncrementAtomic((volatile SInt32 *)&tcp_cc_bbr.num_sockets);
+
+	VERIFY(tp->t_ccstate != NULL);
+	tcp_bbr_clear_state(tp);
+	return (0);
+}
+
+static int
+tcp_bbr_cleanup(struct tcpcb *tp)
+{
+	tp->t_pacing_rate = 0;
+	tp->t_timer[TCPT_PACE] = 0;
+	OSDecrementAtomic((volatile SInt32 *)&tcp_cc_bbr.num_sockets);
+	return (0);
+}
+
+static void
+tcp_bbr_cwnd_init(struct tcpcb *tp)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+
+	tcp_cc_cwnd_init_or_reset(tp);
+
+	/* the sequence space is known now, start counting rounds */
+	cs->bbr_round_end = tp->snd_max;
+	cs->bbr_round_una = tp->snd_una;
+	cs->bbr_round_ts = tcp_now;
+}
+
+/* Track the min rtt, and go measure it again when it gets too old */
+static void
+tcp_bbr_update_min_rtt(struct tcpcb *tp)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+	boolean_t expired;
+
+	expired = (cs->bbr_min_rtt > 0 && TSTMP_GT(tcp_now,
+	    cs->bbr_min_rtt_ts + tcp_bbr_min_rtt_win));
+
+	if (tp->t_rttupdated != cs->bbr_rttupdated && tp->t_rttcur > 0) {
+		cs->bbr_rttupdated = tp->t_rttupdated;
+		if (cs->bbr_min_rtt == 0 || expired ||
+		    tp->t_rttcur <= cs->bbr_min_rtt) {
+			cs->bbr_min_rtt = tp->t_rttcur;
+			cs->bbr_min_rtt_ts = tcp_now;
+		}
+	}
+
+	if (expired && cs->bbr_mode != TCP_BBR_PROBE_RTT) {
+		cs->bbr_prior_cwnd = tp->snd_cwnd;
+		tcp_bbr_set_mode(tp, TCP_BBR_PROBE_RTT);
+	}
+}
+
+/*
+ * Take a delivery rate sample at the end of each round trip, and keep the
+ * max of the last TCP_BBR_BW_ROUNDS samples. Returns TRUE when a round
+ * ended with this ack.
+ */
+static boolean_t
+tcp_bbr_update_bw(struct tcpcb *tp, struct tcphdr *th)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+	u_int32_t elapsed, bw, slot;
+	u_int64_t rate;
+	int i;
+
+	elapsed = tcp_now - cs->bbr_round_ts;
+	if (SEQ_LT(th->th_ack, cs->bbr_round_end) || elapsed == 0)
+		return (FALSE);
+
+	rate = ((u_int64_t)(th->th_ack - cs->bbr_round_una) * TCP_RETRANSHZ) /
+	    elapsed;
+	bw = (rate > UINT32_MAX) ? UINT32_MAX : (u_int32_t)rate;
+
+	slot = cs->bbr_round % TCP_BBR_BW_ROUNDS;
+	if (!cs->bbr_app_limited || bw > cs->bbr_max_bw)
+		cs->bbr_bw[slot] = max(cs->bbr_bw[slot], bw);
+
+	/* start the next round, forgetting the oldest sample */
+	cs->bbr_round++;
+	cs->bbr_bw[cs->bbr_round % TCP_BBR_BW_ROUNDS] = 0;
+	cs->bbr_round_end = tp->snd_max;
+	cs->bbr_round_una = th->th_ack;
+	cs->bbr_round_ts = tcp_now;
+	cs->bbr_app_limited = 0;
+
+	cs->bbr_max_bw = 0;
+	for (i = 0; i < TCP_BBR_BW_ROUNDS; i++)
+		cs->bbr_max_bw = max(cs->bbr_max_bw, cs->bbr_bw[i]);
+	return (TRUE);
+}
+
+static void
+tcp_bbr_update_mode(struct tcpcb *tp, boolean_t round_end, u_int32_t inflight)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+	u_int32_t min_cwnd = TCP_BBR_MIN_CWND_SEGS * tp->t_maxseg;
+
+	switch (cs->bbr_mode) {
+	case TCP_BBR_STARTUP:
+		if (!round_end || cs->bbr_app_limited)
+			break;
+		if (cs->bbr_max_bw >= cs->bbr_full_bw +
+		    (cs->bbr_full_bw >> 2)) {
+			cs->bbr_full_bw = cs->bbr_max_bw;
+			cs->bbr_full_bw_cnt = 0;
+		} else if (++cs->bbr_full_bw_cnt >= TCP_BBR_FULL_BW_ROUNDS) {
+			tcp_bbr_set_mode(tp, TCP_BBR_DRAIN);
+		}
+		break;
+	case TCP_BBR_DRAIN:
+		if (inflight <= tcp_bbr_bdp(tp, TCP_BBR_UNIT))
+			tcp_bbr_set_mode(tp, TCP_BBR_PROBE_BW);
+		break;
+	case TCP_BBR_PROBE_BW:
+		if ((tcp_now - cs->bbr_cycle_ts) > max(cs->bbr_min_rtt, 1)) {
+			cs->bbr_cycle_idx = (cs->bbr_cycle_idx + 1) %
+			    TCP_BBR_CYCLE_LEN;
+			cs->bbr_cycle_ts = tcp_now;
+			cs->bbr_pacing_gain =
+			    tcp_bbr_pacing_cycle[cs->bbr_cycle_idx];
+		}
+		break;
+	case TCP_BBR_PROBE_RTT:
+		if (cs->bbr_probe_rtt_done == 0) {
+			if (inflight <= min_cwnd)
+				cs->bbr_probe_rtt_done = tcp_now +
+				    max(TCP_BBR_PROBE_RTT_TIME, cs->bbr_min_rtt);
+		} else if (TSTMP_GEQ(tcp_now, cs->bbr_probe_rtt_done)) {
+			cs->bbr_min_rtt_ts = tcp_now;
+			tp->snd_cwnd = max(tp->snd_cwnd, cs->bbr_prior_cwnd);
+			cs->bbr_prior_cwnd = 0;
+			tcp_bbr_set_mode(tp,
+			    (cs->bbr_full_bw_cnt >= TCP_BBR_FULL_BW_ROUNDS) ?
+			    TCP_BBR_PROBE_BW : TCP_BBR_STARTUP);
+		}
+		break;
+	}
+}
+
+static void
+tcp_bbr_update_cwnd(struct tcpcb *tp, u_int32_t acked)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+	u_int32_t cwnd = tp->snd_cwnd, target;
+
+	if (cs->bbr_max_bw == 0 || cs->bbr_min_rtt == 0) {
+		/* no model yet, slow start */
+		cwnd += acked;
+	} else {
+		target = tcp_bbr_target_cwnd(tp);
+		if (cs->bbr_full_bw_cnt >= TCP_BBR_FULL_BW_ROUNDS)
+			cwnd = min(cwnd + acked, target);
+		else if (cwnd < target)
+			cwnd += acked;
+	}
+
+	cwnd = max(cwnd, TCP_BBR_MIN_CWND_SEGS * tp->t_maxseg);
+	if (cs->bbr_mode == TCP_BBR_PROBE_RTT)
+		cwnd = min(cwnd, TCP_BBR_MIN_CWND_SEGS * tp->t_maxseg);
+	tp->snd_cwnd = min(cwnd, TCP_MAXWIN << tp->snd_scale);
+}
+
+static void
+tcp_bbr_update_pacing(struct tcpcb *tp)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+	u_int32_t srtt = tp->t_srtt >> TCP_RTT_SHIFT;
+	u_int64_t rate;
+
+	if (cs->bbr_max_bw > 0) {
+		rate = ((u_int64_t)cs->bbr_max_bw * cs->bbr_pacing_gain) /
+		    TCP_BBR_UNIT;
+	} else if (srtt > 0) {
+		/* before the first sample, pace the window over an rtt */
+		rate = ((u_int64_t)tp->snd_cwnd * TCP_RETRANSHZ *
+		    TCP_BBR_HIGH_GAIN) / (srtt * TCP_BBR_UNIT);
+	} else {
+		rate = 0;
+	}
+	tp->t_pacing_rate = (rate > UINT32_MAX) ? UINT32_MAX : (u_int32_t)rate;
+}
+
+/*
+ * Called on every valid ack outside of recovery, before snd_una has been
+ * updated.
+ */
+static void
+tcp_bbr_ack_rcvd(struct tcpcb *tp, struct tcphdr *th)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+	struct socket *so = tp->t_inpcb->inp_socket;
+	u_int32_t acked = BYTES_ACKED(th, tp);
+	u_int32_t inflight = tp->snd_max - th->th_ack;
+	boolean_t round_end;
+
+	/* the sender ran out of data before filling the window */
+	if (so->so_snd.sb_cc <= (tp->snd_max - tp->snd_una) &&
+	    (tp->snd_max - tp->snd_una) < tp->snd_cwnd)
+		cs->bbr_app_limited = 1;
+
+	tcp_bbr_update_min_rtt(tp);
+	round_end = tcp_bbr_update_bw(tp, th);
+	tcp_bbr_update_mode(tp, round_end, inflight);
+	tcp_bbr_update_cwnd(tp, acked);
+	tcp_bbr_update_pacing(tp);
+}
+
+/*
+ * Loss is not a signal of congestion here. Remember the window so that
+ * it can be restored when recovery is done, and let recovery keep up to
+ * the estimated bandwidth-delay product in flight.
+ */
+static void
+tcp_bbr_pre_fr(struct tcpcb *tp)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+
+	if (cs->bbr_mode != TCP_BBR_PROBE_RTT)
+		cs->bbr_prior_cwnd = tp->snd_cwnd;
+	tp->snd_ssthresh = max(tcp_bbr_bdp(tp, TCP_BBR_UNIT),
+	    2 * tp->t_maxseg);
+}
+
+static void
+tcp_bbr_post_fr(struct tcpcb *tp, struct tcphdr *th)
+{
+#pragma unused(th)
+	struct tcp_ccstate *cs = tp->t_ccstate;
+
+	tp->snd_cwnd = max(cs->bbr_prior_cwnd, tp->snd_ssthresh);
+	if (cs->bbr_mode != TCP_BBR_PROBE_RTT)
+		cs->bbr_prior_cwnd = 0;
+	tp->snd_ssthresh = TCP_MAXWIN << TCP_MAX_WINSHIFT;
+	tp->t_bytes_acked = 0;
+}
+
+/*
+ * After idle, keep the model and pace at the estimated bandwidth, there
+ * is no ack clock to protect.
+ */
+static void
+tcp_bbr_after_idle(struct tcpcb *tp)
+{
+	struct tcp_ccstate *cs = tp->t_ccstate;
+
+	if (cs->bbr_mode == TCP_BBR_PROBE_BW) {
+		cs->bbr_pacing_gain = TCP_BBR_UNIT;
+		cs->bbr_cycle_ts = tcp_now;
+	}
+	tp->t_pacing_tokens = 0;
+	tp->t_pacing_ts = tcp_now;
+	tcp_bbr_update_pacing(tp);
+}
+
+static void
+tcp_bbr_after_timeout(struct tcpcb *tp)
+{
+	if (tp->t_state < TCPS_ESTABLISHED)
+		return;
+
+	/* the window grows back towards the model as acks come in */
+	tp->snd_ssthresh = max(tcp_bbr_bdp(tp, TCP_BBR_UNIT),
+	    2 * tp->t_maxseg);
+	tp->snd_cwnd = tp->t_maxseg;
+	tp->t_bytes_acked = 0;
+}
+
+static int
+tcp_bbr_delay_ack(struct tcpcb *tp, struct tcphdr *th)
+{
+	return (tcp_cc_delay_ack(tp, th));
+}
+
+/*
+ * Switch to bbr from a different CC. The window is kept, the model is
+ * built from scratch in startup.
+ */
+static void
+tcp_bbr_switch_cc(struct tcpcb *tp, u_int16_t old_index)
+{
+#pragma unused(old_index)
+	tcp_bbr_clear_state(tp);
+	tp->snd_ssthresh = TCP_MAXWIN << TCP_MAX_WINSHIFT;
+	tp->t_bytes_acked = 0;
+
+	OSIncrementAtomic((volatile SInt32 *)&tcp_cc_bbr.num_sockets);
+}
@@ -35,6 +35,8 @@
 #include <sys/kern_control.h>
 #include <sys/domain.h>
 
+#include <net/if_var.h>
+
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <netinet/tcp_var.h>
@@ -73,6 +75,14 @@ struct tcp_cc_debug_state {
 		struct {
 			u_int32_t led_base_rtt;
 		} ledbat_state;
+		struct {
+			uint32_t ccd_max_bw;
+			uint32_t ccd_min_rtt;
+			uint32_t ccd_pacing_rate;
+			uint16_t ccd_pacing_gain;
+			uint8_t ccd_mode;
+			uint8_t ccd_unused__;
+		} bbr_state;
 	} u;
 };
 
@@ -94,10 +104,31 @@ SYSCTL_INT(_net_inet_tcp, OID_AUTO, cubic_sockets,
 	CTLFLAG_RD | CTLFLAG_LOCKED,&tcp_cc_cubic.num_sockets, 
 	0, "Number of sockets using cubic");
 
+extern struct tcp_cc_algo tcp_cc_bbr;
+SYSCTL_INT(_net_inet_tcp, OID_AUTO, bbr_sockets,
+	CTLFLAG_RD | CTLFLAG_LOCKED, &tcp_cc_bbr.num_sockets,
+	0, "Number of sockets using bbr");
+
 SYSCTL_SKMEM_TCP_INT(OID_AUTO, use_newreno,
 	CTLFLAG_RW | CTLFLAG_LOCKED, int, tcp_use_newreno, 0,
 	"Use TCP NewReno by default");
 
+SYSCTL_SKMEM_TCP_INT(OID_AUTO, use_bbr,
+	CTLFLAG_RW | CTLFLAG_LOCKED, int, tcp_use_bbr, 0,
+	"Use TCP BBR by default");
+
+SYSCTL_SKMEM_TCP_INT(OID_AUTO, pacing,
+	CTLFLAG_RW | CTLFLAG_LOCKED, static int, tcp_pacing, 0,
+	"Pace all connections on interfaces that honour departure times");
+
+SYSCTL_SKMEM_TCP_INT(OID_AUTO, pacing_ss_ratio,
+	CTLFLAG_RW | CTLFLAG_LOCKED, static int, tcp_pacing_ss_ratio, 200,
+	"Pacing rate in slow start, in percent of cwnd/srtt");
+
+SYSCTL_SKMEM_TCP_INT(OID_AUTO, pacing_ca_ratio,
+	CTLFLAG_RW | CTLFLAG_LOCKED, static int, tcp_pacing_ca_ratio, 120,
+	"Pacing rate in congestion avoidance, in percent of cwnd/srtt");
+
 static int tcp_check_cwnd_nonvalidated = 1;
 #if (DEBUG || DEVELOPMENT)
 SYSCTL_INT(_net_inet_tcp, OID_AUTO, cwnd_nonvalidated,
@@ -140,6 +171,7 @@ tcp_cc_init(void)
 	tcp_cc_algo_list[TCP_CC_ALGO_NEWRENO_INDEX] = &tcp_cc_newreno;
 	tcp_cc_algo_list[TCP_CC_ALGO_BACKGROUND_INDEX] = &tcp_cc_ledbat;
 	tcp_cc_algo_list[TCP_CC_ALGO_CUBIC_INDEX] = &tcp_cc_cubic;
+	tcp_cc_algo_list[TCP_CC_ALGO_BBR_INDEX] = &tcp_cc_bbr;
 
 	tcp_cc_control_register();
 }
@@ -262,6 +294,18 @@ tcp_ccdbg_trace(struct tcpcb *tp, struct tcphdr *th, int32_t event)
 			dbg_state.u.ledbat_state.led_base_rtt =
 			    get_base_rtt(tp);
 			break;
+		    case TCP_CC_ALGO_BBR_INDEX:
+			dbg_state.u.bbr_state.ccd_max_bw =
+			    tp->t_ccstate->bbr_max_bw;
+			dbg_state.u.bbr_state.ccd_min_rtt =
+			    tp->t_ccstate->bbr_min_rtt;
+			dbg_state.u.bbr_state.ccd_pacing_rate =
+			    tp->t_pacing_rate;
+			dbg_state.u.bbr_state.ccd_pacing_gain =
+			    tp->t_ccstate->bbr_pacing_gain;
+			dbg_state.u.bbr_state.ccd_mode =
+			    tp->t_ccstate->bbr_mode;
+			break;
 		    default:
 			break;
 		}
@@ -375,7 +419,8 @@ tcp_cc_delay_ack(struct tcpcb *tp, struct tcphdr *th)
 void
 tcp_cc_allocate_state(struct tcpcb *tp)
 {
-	if (tp->tcp_cc_index == TCP_CC_ALGO_CUBIC_INDEX &&
+	if ((tp->tcp_cc_index == TCP_CC_ALGO_CUBIC_INDEX ||
+	    tp->tcp_cc_index == TCP_CC_ALGO_BBR_INDEX) &&
 		tp->t_ccstate == NULL) {
 		tp->t_ccstate = (struct tcp_ccstate *)zalloc(tcp_cc_zone);
 
@@ -482,3 +527,138 @@ tcp_clear_pipeack_state(struct tcpcb *tp)
 	tp->t_pipeack_ind = 0;
 	tp->t_lossflightsize = 0;
 }
+
+/* The algorithm new connections use, unless they are background */
+int
+tcp_cc_default_index(void)
+{
+	if (tcp_use_bbr)
+		return (TCP_CC_ALGO_BBR_INDEX);
+	if (tcp_use_newreno)
+		return (TCP_CC_ALGO_NEWRENO_INDEX);
+	return (TCP_CC_ALGO_CUBIC_INDEX);
+}
+
+/*
+ * Find a foreground algorithm by name for TCP_CONGESTION_ALGO. The
+ * background algorithm is picked through the traffic class instead.
+ */
+int
+tcp_cc_lookup(const char *name)
+{
+	int i;
+
+	for (i = TCP_CC_ALGO_NONE + 1; i < TCP_CC_ALGO_COUNT; i++) {
+		if (i == TCP_CC_ALGO_BACKGROUND_INDEX)
+			continue;
+		if (strncmp(tcp_cc_algo_list[i]->name, name,
+		    TCP_CA_NAME_MAX) == 0)
+			return (i);
+	}
+	return (TCP_CC_ALGO_NONE);
+}
+
+/*
+ * Pacing is a token bucket filled at t_pacing_rate. It holds at most one
+ * fast timer quantum worth of data, so that the connection does not burst
+ * more than what it would send between two runs of the pacing timer.
+ */
+int32_t
+tcp_pacing_budget(struct tcpcb *tp)
+{
+	u_int64_t tokens, burst;
+
+	burst = ((u_int64_t)tp->t_pacing_rate * TCP_TIMER_10MS_QUANTUM) /
+	    TCP_RETRANSHZ;
+	if (burst < 2 * tp->t_maxseg)
+		burst = 2 * tp->t_maxseg;
+	tokens = tp->t_pacing_tokens + ((u_int64_t)tp->t_pacing_rate *
+	    (u_int32_t)(tcp_now - tp->t_pacing_ts)) / TCP_RETRANSHZ;
+	if (tokens > burst)
+		tokens = burst;
+
+	tp->t_pacing_tokens = (u_int32_t)tokens;
+	tp->t_pacing_ts = tcp_now;
+	return ((int32_t)tp->t_pacing_tokens);
+}
+
+void
+tcp_pacing_consume(struct tcpcb *tp, int32_t len)
+{
+	if ((u_int32_t)len >= tp->t_pacing_tokens)
+		tp->t_pacing_tokens = 0;
+	else
+		tp->t_pacing_tokens -= len;
+}
+
+/* Arm the pacing timer for when the next segment can go out */
+void
+tcp_pacing_hold(struct tcpcb *tp)
+{
+	u_int64_t wait = 1;
+
+	if (tp->t_timer[TCPT_PACE] != 0 || tp->t_pacing_rate == 0)
+		return;
+	if (tp->t_maxseg > tp->t_pacing_tokens)
+		wait = ((u_int64_t)(tp->t_maxseg - tp->t_pacing_tokens) *
+		    TCP_RETRANSHZ) / tp->t_pacing_rate;
+	if (wait == 0)
+		wait = 1;
+	else if (wait > TCP_TIMER_100MS_QUANTUM)
+		wait = TCP_TIMER_100MS_QUANTUM;
+	tp->t_timer[TCPT_PACE] = OFFSET_FROM_START(tp, (u_int32_t)wait);
+}
+
+/*
+ * Rate the connection is paced at: the one set by the congestion control
+ * algorithm, else, when net.inet.tcp.pacing is set, a multiple of
+ * cwnd/srtt so that the window is spread over the round trip.
+ */
+u_int32_t
+tcp_pacing_rate(struct tcpcb *tp)
+{
+	u_int64_t rate;
+	u_int32_t srtt, ratio;
+
+	if (tp->t_pacing_rate != 0)
+		return (tp->t_pacing_rate);
+	if (tcp_pacing == 0 || tp->t_srtt == 0)
+		return (0);
+
+	srtt = tp->t_srtt >> TCP_RTT_SHIFT;
+	if (srtt == 0)
+		srtt = 1;
+	ratio = (tp->snd_cwnd < tp->snd_ssthresh) ? tcp_pacing_ss_ratio :
+	    tcp_pacing_ca_ratio;
+	rate = ((u_int64_t)tp->snd_cwnd * TCP_RETRANSHZ * ratio) /
+	    (100 * srtt);
+	return ((rate > UINT32_MAX) ? UINT32_MAX : (u_int32_t)rate);
+}
+
+/* Whether the send queue of the interface holds packets until they are due */
+boolean_t
+tcp_pacing_txtime_capable(struct ifnet *ifp)
+{
+	return (ifp != NULL && !(ifp->if_flags & IFF_LOOPBACK) &&
+	    (ifp->if_eflags & IFEF_TXSTART) &&
+	    IFCQ_TXTIME_CAPABLE(&ifp->if_snd));
+}
+
+/*
+ * Earliest departure time, in nanoseconds of uptime, of a segment of len
+ * bytes paced at rate; 0 if it can leave right away. Each segment pushes
+ * the next one back by its transmission time at the pacing rate, and an
+ * idle connection does not bank any credit.
+ */
+u_int64_t
+tcp_pacing_txtime(struct tcpcb *tp, u_int32_t rate, int32_t len)
+{
+	struct timespec now_ts;
+	u_int64_t now, txtime;
+
+	nanouptime(&now_ts);
+	now = (now_ts.tv_sec * NSEC_PER_SEC) + now_ts.tv_nsec;
+	txtime = (tp->t_pacing_next > now) ? tp->t_pacing_next : now;
+	tp->t_pacing_next = txtime + ((u_int64_t)len * NSEC_PER_SEC) / rate;
+	return ((txtime > now) ? txtime : 0);
+}
@@ -70,12 +70,15 @@
 #define	TCP_CC_ALGO_NEWRENO_INDEX	1
 #define	TCP_CC_ALGO_BACKGROUND_INDEX	2 /* CC for background transport */
 #define	TCP_CC_ALGO_CUBIC_INDEX		3 /* default CC algorithm */
-#define	TCP_CC_ALGO_COUNT		4 /* Count of CC algorithms */
+#define	TCP_CC_ALGO_BBR_INDEX		4 /* model based, paced CC */
+#define	TCP_CC_ALGO_COUNT		5 /* Count of CC algorithms */
 
 #define TCP_CA_NAME_MAX 16		/* Maximum characters in the name of a CC algorithm */
 
 extern int tcp_recv_bg;
 
+struct ifnet;
+
 /*
  * Structure to hold definition various actions defined by a congestion 
  * control algorithm for TCP. This can be used to change the congestion
@@ -153,6 +156,15 @@ extern uint32_t tcp_cc_is_cwnd_nonvalidated(struct tcpcb *tp);
 extern void tcp_cc_adjust_nonvalidated_cwnd(struct tcpcb *tp);
 extern u_int32_t tcp_get_max_pipeack(struct tcpcb *tp);
 extern void tcp_clear_pipeack_state(struct tcpcb *tp);
+extern int tcp_cc_default_index(void);
+extern int tcp_cc_lookup(const char *name);
+extern int32_t tcp_pacing_budget(struct tcpcb *tp);
+extern void tcp_pacing_consume(struct tcpcb *tp, int32_t len);
+extern void tcp_pacing_hold(struct tcpcb *tp);
+extern u_int32_t tcp_pacing_rate(struct tcpcb *tp);
+extern boolean_t tcp_pacing_txtime_capable(struct ifnet *ifp);
+extern u_int64_t tcp_pacing_txtime(struct tcpcb *tp, u_int32_t rate,
+    int32_t len);
 
 #endif /* KERNEL */
 #endif /* _NETINET_CC_H_ */
@@ -179,6 +179,10 @@ SYSCTL_SKMEM_TCP_INT(OID_AUTO, tcp_lq_overflow,
     CTLFLAG_RW | CTLFLAG_LOCKED, int, tcp_lq_overflow, 1,
     "Listen Queue Overflow");
 
+SYSCTL_SKMEM_TCP_INT(OID_AUTO, syn_overflow_keepinit,
+    CTLFLAG_RW | CTLFLAG_LOCKED, static int, tcp_syn_overflow_keepinit, 4,
+    "Seconds to complete a connection accepted while the listen queue overflows");
+
 SYSCTL_SKMEM_TCP_INT(OID_AUTO, recvbg, CTLFLAG_RW | CTLFLAG_LOCKED,
     int, tcp_recv_bg, 0, "Receive background");
 
@@ -388,7 +392,6 @@ static void tcp_newreno_partial_ack(struct tcpcb *tp, struct tcphdr *th);
 static void update_base_rtt(struct tcpcb *tp, uint32_t rtt);
 void tcp_set_background_cc(struct socket *so);
 void tcp_set_foreground_cc(struct socket *so);
-static void tcp_set_new_cc(struct socket *so, uint16_t cc_index);
 static void tcp_bwmeas_check(struct tcpcb *tp);
 
 #if TRAFFIC_MGT
@@ -1873,7 +1876,7 @@ tcp_input(struct mbuf *m, int off0)
 #if INET6
 	struct in6_addr laddr6;
 #endif
-	int dropsocket = 0;
+	int dropsocket = 0, lq_overflow = 0;
 	int iss = 0, nosock = 0;
 	u_int32_t tiwin, sack_bytes_acked = 0;
 	struct tcpopt to;		/* options in this segment */
@@ -2492,6 +2495,7 @@ findpcb:
 			}
 			if (so2 == 0) {
 				tcpstat.tcps_listendrop++;
+				lq_overflow = 1;
 				if (tcp_dropdropablreq(so)) {
 					if (so->so_filt)
 						so2 = sonewconn(so, 0, (struct sockaddr*)&from);
@@ -2637,6 +2641,13 @@ findpcb:
 				tp->t_notsent_lowat = tp0->t_notsent_lowat;
 			tp->t_inpcb->inp_flags2 |=
 			    tp0->t_inpcb->inp_flags2 & INP2_KEEPALIVE_OFFLOAD;
+			if (tp0->t_cc_user_index != TCP_CC_ALGO_NONE) {
+				tp->t_cc_user_index = tp0->t_cc_user_index;
+				if (tp->tcp_cc_index !=
+				    TCP_CC_ALGO_BACKGROUND_INDEX)
+					tcp_set_new_cc(so,
+					    tp->t_cc_user_index);
+			}
 
 			/* now drop the reference on the listener */
 			socket_unlock(oso, 1);
@@ -3258,6 +3269,21 @@ findpcb:
 		tp->t_state = TCPS_SYN_RECEIVED;
 		tp->t_timer[TCPT_KEEP] = OFFSET_FROM_START(tp,
 			TCP_CONN_KEEPINIT(tp));
+		/*
+		 * When the listen queue is overflowing, most of the embryonic
+		 * connections in it are typically from a SYN flood and will
+		 * never complete.  Let this one expire after a couple of
+		 * SYN-ACK retransmits rather than after tcp_keepinit, so the
+		 * queue turns over and keeps room for clients that do finish
+		 * the handshake, and tcp_dropdropablreq() has fewer entries
+		 * to pick from.
+		 */
+		if (lq_overflow && tcp_syn_overflow_keepinit > 0 &&
+		    tcp_syn_overflow_keepinit * TCP_RETRANSHZ <
+		    TCP_CONN_KEEPINIT(tp)) {
+			tp->t_timer[TCPT_KEEP] = OFFSET_FROM_START(tp,
+			    tcp_syn_overflow_keepinit * TCP_RETRANSHZ);
+		}
 		dropsocket = 0;		/* committed to socket */
 
 		if (inp->inp_flowhash == 0)
@@ -6353,13 +6379,16 @@ tcp_set_background_cc(struct socket *so)
 void
 tcp_set_foreground_cc(struct socket *so)
 {
-	if (tcp_use_newreno)
-		tcp_set_new_cc(so, TCP_CC_ALGO_NEWRENO_INDEX);
+	struct tcpcb *tp = sototcpcb(so);
+
+	/* keep the algorithm the application asked for */
+	if (tp->t_cc_user_index != TCP_CC_ALGO_NONE)
+		tcp_set_new_cc(so, tp->t_cc_user_index);
 	else
-		tcp_set_new_cc(so, TCP_CC_ALGO_CUBIC_INDEX);
+		tcp_set_new_cc(so, tcp_cc_default_index());
 }
 
-static void
+void
 tcp_set_new_cc(struct socket *so, uint16_t cc_index)
 {
 	struct inpcb *inp = sotoinpcb(so);
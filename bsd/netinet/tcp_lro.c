@@ -48,7 +48,12 @@
 #include <netinet/tcp_var.h>
 #include <netinet/tcp_lro.h>
 #include <netinet/lro_ext.h>
+#include <net/flowhash.h>
 #include <kern/locks.h>
+#include <kern/zalloc.h>
+#include <libkern/OSAtomic.h>
+#include <machine/machine_routines.h>
+#include <dev/random/randomdev.h>
 
 unsigned int lrocount = 0; /* A counter used for debugging only */
 unsigned int lro_seq_outoforder = 0; /* Counter for debugging */
@@ -66,18 +71,25 @@ unsigned int coalesc_time = LRO_MX_TIME_TO_BUFFER;
 SYSCTL_INT(_net_inet_tcp, OID_AUTO, lro_time, CTLFLAG_RW | CTLFLAG_LOCKED,
 		&coalesc_time, 0, "Max coalescing time");
 
-struct lro_flow lro_flow_list[TCP_LRO_NUM_FLOWS]; 
+unsigned int lro_max_flows = TCP_LRO_MAX_FLOWS;
+SYSCTL_INT(_net_inet_tcp, OID_AUTO, lro_max_flows, CTLFLAG_RW | CTLFLAG_LOCKED,
+		&lro_max_flows, 0, "Max number of flows tracked for coalescing");
 
-char lro_flow_map[TCP_LRO_FLOW_MAP]; 
+static struct lro_table *lro_tables;	/* one flow table per CPU */
+static u_int32_t lro_table_mask;	/* number of tables - 1 */
+static u_int32_t lro_table_shift;	/* log2 of the number of tables */
+static u_int32_t lro_bucket_mask;	/* hash buckets per table - 1 */
+static u_int32_t lro_hash_seed;
+
+static struct zone *lro_flow_zone;	/* zone for struct lro_flow */
 
 static lck_attr_t *tcp_lro_mtx_attr = NULL;		/* mutex attributes */
 static lck_grp_t *tcp_lro_mtx_grp = NULL;		/* mutex group */
 static lck_grp_attr_t *tcp_lro_mtx_grp_attr = NULL;	/* mutex group attrs */
-decl_lck_mtx_data( ,tcp_lro_lock);	/* Used to synchronize updates */
 
 unsigned int lro_byte_count = 0;
 
-uint64_t lro_deadline = 0; /* LRO's sense of time - protected by tcp_lro_lock */
+uint64_t lro_deadline = 0; /* LRO's sense of time */
 uint32_t lro_timer_set = 0;
 
 /* Some LRO stats */
@@ -89,7 +101,7 @@ extern u_int32_t kipf_count;
 static void	tcp_lro_timer_proc(void*, void*);
 static void	lro_update_stats(struct mbuf*);
 static void	lro_update_flush_stats(struct mbuf *);
-static void	tcp_lro_flush_flows(void);
+static void	tcp_lro_flush_tables(thread_t, boolean_t);
 static void	tcp_lro_sched_timer(uint64_t);
 static void	lro_proto_input(struct mbuf *);
 
@@ -97,23 +109,71 @@ static struct mbuf *lro_tcp_xsum_validate(struct mbuf*,  struct ip *,
 				struct tcphdr*);
 static struct mbuf *tcp_lro_process_pkt(struct mbuf*, int);
 
+#define	LRO_TABLE(hash)		(&lro_tables[(hash) & lro_table_mask])
+#define	LRO_BUCKET(lt, hash)	\
+	(&(lt)->lt_hash[((hash) >> lro_table_shift) & lro_bucket_mask])
+
 void
 tcp_lro_init(void)
 {
-	int i;
+	struct lro_table *lt;
+	u_int32_t ntables, nbuckets, i, j;
+
+	/* one flow table per CPU, rounded up to a power of 2 */
+	ntables = 1;
+	while (ntables < (u_int32_t)ml_get_max_cpus() &&
+	    ntables < TCP_LRO_MAX_TABLES) {
+		ntables <<= 1;
+		lro_table_shift++;
+	}
+	lro_table_mask = ntables - 1;
 
-	bzero(lro_flow_list, sizeof (struct lro_flow) * TCP_LRO_NUM_FLOWS);
-	for (i = 0; i < TCP_LRO_FLOW_MAP; i++) {
-		lro_flow_map[i] = TCP_LRO_FLOW_UNINIT;
+	/* aim for an average chain length of one with the default limit */
+	nbuckets = 1;
+	while ((nbuckets * ntables) < TCP_LRO_MAX_FLOWS) {
+		nbuckets <<= 1;
+	}
+	lro_bucket_mask = nbuckets - 1;
+
+	lro_tables = _MALLOC(sizeof (struct lro_table) * ntables, M_TEMP,
+	    M_WAITOK | M_ZERO);
+	if (lro_tables == NULL) {
+		panic_plain("%s: unable to allocate lro flow tables", __func__);
 	}
 
 	/*
-	 * allocate lock group attribute, group and attribute for tcp_lro_lock
+	 * allocate lock group attribute, group and attribute for the
+	 * flow table locks
 	 */
 	tcp_lro_mtx_grp_attr = lck_grp_attr_alloc_init();
 	tcp_lro_mtx_grp = lck_grp_alloc_init("tcplro", tcp_lro_mtx_grp_attr);
 	tcp_lro_mtx_attr = lck_attr_alloc_init();
-	lck_mtx_init(&tcp_lro_lock, tcp_lro_mtx_grp, tcp_lro_mtx_attr);
+
+	for (i = 0; i < ntables; i++) {
+		lt = &lro_tables[i];
+		lck_mtx_init(&lt->lt_lock, tcp_lro_mtx_grp, tcp_lro_mtx_attr);
+		lt->lt_hash = _MALLOC(sizeof (*lt->lt_hash) * nbuckets,
+		    M_TEMP, M_WAITOK | M_ZERO);
+		if (lt->lt_hash == NULL) {
+			panic_plain("%s: unable to allocate lro hash", __func__);
+		}
+		for (j = 0; j < nbuckets; j++) {
+			LIST_INIT(&lt->lt_hash[j]);
+		}
+		TAILQ_INIT(&lt->lt_lru);
+		TAILQ_INIT(&lt->lt_pending);
+	}
+
+	lro_flow_zone = zinit(sizeof (struct lro_flow),
+	    4 * TCP_LRO_MAX_FLOWS * sizeof (struct lro_flow), 0,
+	    "tcp_lro_flow");
+	if (lro_flow_zone == NULL) {
+		panic_plain("%s: unable to allocate lro flow zone", __func__);
+	}
+	zone_change(lro_flow_zone, Z_CALLERACCT, FALSE);
+	zone_change(lro_flow_zone, Z_EXPAND, TRUE);
+
+	lro_hash_seed = RandomULong();
 
 	tcp_lro_timer = thread_call_allocate(tcp_lro_timer_proc, NULL);
 	if (tcp_lro_timer == NULL) {
@@ -123,95 +183,113 @@ tcp_lro_init(void)
 	return;
 }
 
+static inline u_int32_t
+tcp_lro_hash(struct in_addr faddr, struct in_addr laddr,
+			unsigned short fport, unsigned short lport)
+{
+	struct lro_flow_key key;
+
+	key.lk_faddr = faddr;
+	key.lk_laddr = laddr;
+	key.lk_fport = fport;
+	key.lk_lport = lport;
+	return (net_flowhash(&key, sizeof (key), lro_hash_seed));
+}
+
+/*
+ * Must be called with the table lock held.
+ */
+static struct lro_flow *
+tcp_lro_lookup(struct lro_table *lt, u_int32_t hash, struct in_addr faddr,
+			struct in_addr laddr, unsigned short fport,
+			unsigned short lport)
+{
+	struct lro_flow *flow;
+
+	LIST_FOREACH(flow, LRO_BUCKET(lt, hash), lr_hash_link) {
+		if ((flow->lr_hash == hash) &&
+		    (flow->lr_faddr.s_addr == faddr.s_addr) &&
+		    (flow->lr_laddr.s_addr == laddr.s_addr) &&
+		    (flow->lr_fport == fport) &&
+		    (flow->lr_lport == lport)) {
+			return (flow);
+		}
+	}
+	return (NULL);
+}
+
 static int
-tcp_lro_matching_tuple(struct ip* ip_hdr, struct tcphdr *tcp_hdr, int *hash, 
-			int *flow_id )
+tcp_lro_matching_tuple(struct lro_table *lt, u_int32_t hash,
+			struct ip* ip_hdr, struct tcphdr *tcp_hdr,
+			struct lro_flow **flowp)
 {
 	struct lro_flow *flow;
 	tcp_seq seqnum;
-	unsigned int off = 0;
-	int payload_len = 0;
-
-	*hash = LRO_HASH(ip_hdr->ip_src.s_addr, ip_hdr->ip_dst.s_addr, 
-		tcp_hdr->th_sport, tcp_hdr->th_dport, (TCP_LRO_FLOW_MAP - 1));
 
-	*flow_id = lro_flow_map[*hash];
-	if (*flow_id == TCP_LRO_FLOW_NOTFOUND) {
+	flow = tcp_lro_lookup(lt, hash, ip_hdr->ip_src, ip_hdr->ip_dst,
+	    tcp_hdr->th_sport, tcp_hdr->th_dport);
+	*flowp = flow;
+	if (flow == NULL) {
 		return TCP_LRO_NAN;
 	}
 
 	seqnum = tcp_hdr->th_seq;
-	off = tcp_hdr->th_off << 2;
-	payload_len = ip_hdr->ip_len - off;
 
-	flow = &lro_flow_list[*flow_id];
-
-	if ((flow->lr_faddr.s_addr == ip_hdr->ip_src.s_addr) &&
-			(flow->lr_laddr.s_addr == ip_hdr->ip_dst.s_addr) &&
-			(flow->lr_fport == tcp_hdr->th_sport) &&
-			(flow->lr_lport == tcp_hdr->th_dport)) {
-		if (flow->lr_tcphdr == NULL) {
-			if (ntohl(seqnum) == flow->lr_seq) {
-				return TCP_LRO_COALESCE;
-			}
-			if (lrodebug >= 4) {
-				printf("%s: seqnum = %x, lr_seq = %x\n",
-					__func__, ntohl(seqnum), flow->lr_seq);
-			}
-			lro_seq_mismatch++;
-			if (SEQ_GT(ntohl(seqnum), flow->lr_seq)) {
-				lro_seq_outoforder++;
-				/* 
-				 * Whenever we receive out of order packets it
-				 * signals loss and recovery and LRO doesn't 
-				 * let flows recover quickly. So eject.
-				 */
-				 flow->lr_flags |= LRO_EJECT_REQ;
-
-			}
-			return TCP_LRO_NAN;
+	if (flow->lr_tcphdr == NULL) {
+		if (ntohl(seqnum) == flow->lr_seq) {
+			return TCP_LRO_COALESCE;
 		}
-
-		if (flow->lr_flags & LRO_EJECT_REQ) {
-			if (lrodebug)
-				printf("%s: eject. \n", __func__);
-			return TCP_LRO_EJECT_FLOW;
+		if (lrodebug >= 4) {
+			printf("%s: seqnum = %x, lr_seq = %x\n",
+				__func__, ntohl(seqnum), flow->lr_seq);
 		}
-		if (SEQ_GT(tcp_hdr->th_ack, flow->lr_tcphdr->th_ack)) { 
-			if (lrodebug) {
-				printf("%s: th_ack = %x flow_ack = %x \n", 
-					__func__, tcp_hdr->th_ack, 
-					flow->lr_tcphdr->th_ack);
-			}
-			return TCP_LRO_EJECT_FLOW;
+		lro_seq_mismatch++;
+		if (SEQ_GT(ntohl(seqnum), flow->lr_seq)) {
+			lro_seq_outoforder++;
+			/* 
+			 * Whenever we receive out of order packets it
+			 * signals loss and recovery and LRO doesn't 
+			 * let flows recover quickly. So eject.
+			 */
+			 flow->lr_flags |= LRO_EJECT_REQ;
+
 		}
+		return TCP_LRO_NAN;
+	}
 
-		if (ntohl(seqnum) == (ntohl(lro_flow_list[*flow_id].lr_tcphdr->th_seq) + lro_flow_list[*flow_id].lr_len)) { 
-			return TCP_LRO_COALESCE;
-		} else {
-			/* LRO does not handle loss recovery well, eject */
-			flow->lr_flags |= LRO_EJECT_REQ;
-			return TCP_LRO_EJECT_FLOW;
+	if (flow->lr_flags & LRO_EJECT_REQ) {
+		if (lrodebug)
+			printf("%s: eject. \n", __func__);
+		return TCP_LRO_EJECT_FLOW;
+	}
+	if (SEQ_GT(tcp_hdr->th_ack, flow->lr_tcphdr->th_ack)) { 
+		if (lrodebug) {
+			printf("%s: th_ack = %x flow_ack = %x \n", 
+				__func__, tcp_hdr->th_ack, 
+				flow->lr_tcphdr->th_ack);
 		}
+		return TCP_LRO_EJECT_FLOW;
+	}
+
+	if (ntohl(seqnum) == (ntohl(flow->lr_tcphdr->th_seq) + flow->lr_len)) { 
+		return TCP_LRO_COALESCE;
+	} else {
+		/* LRO does not handle loss recovery well, eject */
+		flow->lr_flags |= LRO_EJECT_REQ;
+		return TCP_LRO_EJECT_FLOW;
 	}
-	if (lrodebug) printf("tcp_lro_matching_tuple: collision \n");
-	return TCP_LRO_COLLISION;
 }
 
 static void
-tcp_lro_init_flow(int flow_id, struct ip* ip_hdr, struct tcphdr *tcp_hdr, 
-			int hash, u_int32_t timestamp, int payload_len)
+tcp_lro_init_flow(struct lro_flow *flow, struct ip* ip_hdr,
+			struct tcphdr *tcp_hdr, u_int32_t hash,
+			u_int32_t timestamp, int payload_len)
 {
-	struct lro_flow *flow = NULL;
-
-	flow = &lro_flow_list[flow_id];
-
-	flow->lr_hash_map = hash;
+	flow->lr_hash = hash;
 	flow->lr_faddr.s_addr = ip_hdr->ip_src.s_addr;
 	flow->lr_laddr.s_addr = ip_hdr->ip_dst.s_addr;
 	flow->lr_fport = tcp_hdr->th_sport;
 	flow->lr_lport = tcp_hdr->th_dport;
-	lro_flow_map[hash] = flow_id;
 	flow->lr_timestamp = timestamp;
 	flow->lr_seq = ntohl(tcp_hdr->th_seq) + payload_len;
 	flow->lr_flags = 0;
@@ -219,15 +297,14 @@ tcp_lro_init_flow(int flow_id, struct ip* ip_hdr, struct tcphdr *tcp_hdr,
 }
 
 static void
-tcp_lro_coalesce(int flow_id, struct mbuf *lro_mb, struct tcphdr *tcphdr, 
+tcp_lro_coalesce(struct lro_table *lt, struct lro_flow *flow,
+			struct mbuf *lro_mb, struct tcphdr *tcphdr,
 			int payload_len, int drop_hdrlen, struct tcpopt *topt, 
 			u_int32_t* tsval, u_int32_t* tsecr, int thflags)
 {
-	struct lro_flow *flow = NULL;
 	struct mbuf *last;
 	struct ip *ip = NULL;
 
-	flow =  &lro_flow_list[flow_id];
 	if (flow->lr_mhead) {
 		if (lrodebug) 
 			printf("%s: lr_mhead %x %d \n", __func__, flow->lr_seq,
@@ -302,6 +379,15 @@ tcp_lro_coalesce(int flow_id, struct mbuf *lro_mb, struct tcphdr *tcphdr,
 			flow->lr_len = payload_len;
 			calculate_tcp_clock();
 			flow->lr_timestamp = tcp_now;
+
+			/*
+			 * The chain is pushed up when the thread that
+			 * started it finishes its input batch; the timer
+			 * only catches chains started outside of one.
+			 */
+			flow->lr_owner = current_thread();
+			TAILQ_INSERT_TAIL(&lt->lt_pending, flow, lr_pend_link);
+			lt->lt_npending++;
 			tcp_lro_sched_timer(0);
 		}	
 		flow->lr_seq = ntohl(tcphdr->th_seq) + payload_len;
@@ -309,101 +395,93 @@ tcp_lro_coalesce(int flow_id, struct mbuf *lro_mb, struct tcphdr *tcphdr,
 	if (lro_mb) { 
 		tcpstat.tcps_coalesced_pack++;
 	}	
+
+	/* keep active flows away from the eviction end of the table */
+	if (TAILQ_FIRST(&lt->lt_lru) != flow) {
+		TAILQ_REMOVE(&lt->lt_lru, flow, lr_lru_link);
+		TAILQ_INSERT_HEAD(&lt->lt_lru, flow, lr_lru_link);
+	}
 	return;
 }
 
-static struct mbuf *
-tcp_lro_eject_flow(int flow_id)
+static struct mbuf*
+tcp_lro_eject_coalesced_pkt(struct lro_table *lt, struct lro_flow *flow)
 {
 	struct mbuf *mb = NULL;
 
-	mb = lro_flow_list[flow_id].lr_mhead;
-	ASSERT(lro_flow_map[lro_flow_list[flow_id].lr_hash_map] == flow_id);
-	lro_flow_map[lro_flow_list[flow_id].lr_hash_map] = TCP_LRO_FLOW_UNINIT;
-	bzero(&lro_flow_list[flow_id], sizeof(struct lro_flow));
-	
+	mb = flow->lr_mhead;
+	if (mb != NULL) {
+		TAILQ_REMOVE(&lt->lt_pending, flow, lr_pend_link);
+		lt->lt_npending--;
+		flow->lr_owner = THREAD_NULL;
+	}
+	flow->lr_mhead = flow->lr_mtail = NULL;
+	flow->lr_tcphdr = NULL;
 	return mb;
 }
 
-static struct mbuf*
-tcp_lro_eject_coalesced_pkt(int flow_id)
+static struct mbuf *
+tcp_lro_eject_flow(struct lro_table *lt, struct lro_flow *flow)
 {
 	struct mbuf *mb = NULL;
-	mb = lro_flow_list[flow_id].lr_mhead;
-	lro_flow_list[flow_id].lr_mhead = 
-		lro_flow_list[flow_id].lr_mtail = NULL;
-	lro_flow_list[flow_id].lr_tcphdr = NULL;
+
+	mb = tcp_lro_eject_coalesced_pkt(lt, flow);
+	LIST_REMOVE(flow, lr_hash_link);
+	TAILQ_REMOVE(&lt->lt_lru, flow, lr_lru_link);
+	lt->lt_nflows--;
+	zfree(lro_flow_zone, flow);
+	
 	return mb;
 }
 
-static struct mbuf*
-tcp_lro_insert_flow(struct mbuf *lro_mb, struct ip *ip_hdr, 
-			struct tcphdr *tcp_hdr, int payload_len, 
-			int drop_hdrlen, int hash, struct tcpopt *topt, 
-			u_int32_t *tsval, u_int32_t *tsecr)
+/*
+ * Must be called with the table lock held, as a full mutex.  When the
+ * table is at its share of lro_max_flows, the least recently used flow
+ * that is not holding a chain is recycled; chains are never ejected from
+ * here since TCP calls in with a socket lock held.
+ */
+static struct lro_flow *
+tcp_lro_insert_flow(struct lro_table *lt, u_int32_t hash, struct ip *ip_hdr,
+			struct tcphdr *tcp_hdr, int payload_len)
 {
-	int i;
-	int slot_available = 0;
-	int candidate_flow = 0; 
-	u_int32_t oldest_timestamp;
-	struct mbuf *mb = NULL;
-	int collision = 0;
-
-	oldest_timestamp = tcp_now;
-	
-	/* handle collision */
-	if (lro_flow_map[hash] != TCP_LRO_FLOW_UNINIT) {
-		if (lrodebug) {
-			collision = 1;
-		}
-		candidate_flow = lro_flow_map[hash];
-		tcpstat.tcps_flowtbl_collision++;
-		goto kick_flow;
-	}
+	struct lro_flow *flow = NULL;
+	u_int32_t limit;
 
-	for (i = 0; i < TCP_LRO_NUM_FLOWS; i++) {
-		if (lro_flow_list[i].lr_mhead == NULL) {
-			candidate_flow = i;
-			slot_available = 1;
-			break;
-		}
-		if (oldest_timestamp >= lro_flow_list[i].lr_timestamp) {
-			candidate_flow = i;
-			oldest_timestamp = lro_flow_list[i].lr_timestamp;
-		}
+	limit = MAX(lro_max_flows >> lro_table_shift, 1);
+	if (lt->lt_nflows < limit) {
+		flow = zalloc_noblock(lro_flow_zone);
 	}
-
-	if (!slot_available) {
+	if (flow == NULL) {
 		tcpstat.tcps_flowtbl_full++;
-kick_flow:
-		/* kick the oldest flow */
-		mb = tcp_lro_eject_flow(candidate_flow);
-
-		if (lrodebug) {
-			if (!slot_available) {
+		TAILQ_FOREACH_REVERSE(flow, &lt->lt_lru, lro_lru, lr_lru_link) {
+			if (flow->lr_mhead == NULL)
+				break;
+		}
+		if (flow == NULL) {
+			if (lrodebug) {
 				printf("%s: slot unavailable.\n",__func__);
 			}
-			if (collision) {
-				printf("%s: collision.\n",__func__);
-			}
+			return (NULL);
 		}
-	} else {
-		candidate_flow = i; /* this is now the flow to be used */
-
+		LIST_REMOVE(flow, lr_hash_link);
+		TAILQ_REMOVE(&lt->lt_lru, flow, lr_lru_link);
+		lt->lt_nflows--;
 	}
+	bzero(flow, sizeof (*flow));
 
-	tcp_lro_init_flow(candidate_flow, ip_hdr, tcp_hdr, hash, 
-				tcp_now, payload_len);
-	tcp_lro_coalesce(candidate_flow, lro_mb, tcp_hdr, payload_len, 
-				drop_hdrlen, topt, tsval, tsecr, 0);
-	return mb;
+	tcp_lro_init_flow(flow, ip_hdr, tcp_hdr, hash, tcp_now, payload_len);
+	LIST_INSERT_HEAD(LRO_BUCKET(lt, hash), flow, lr_hash_link);
+	TAILQ_INSERT_HEAD(&lt->lt_lru, flow, lr_lru_link);
+	lt->lt_nflows++;
+	return (flow);
 }
 
 struct mbuf*
 tcp_lro_process_pkt(struct mbuf *lro_mb, int drop_hdrlen)
 {
-	int flow_id = TCP_LRO_FLOW_UNINIT;
-	int hash;
+	struct lro_flow *flow = NULL;
+	struct lro_table *lt;
+	u_int32_t hash;
 	unsigned int off = 0;
 	int eject_flow = 0;
 	int optlen;
@@ -508,43 +586,46 @@ tcp_lro_process_pkt(struct mbuf *lro_mb, int drop_hdrlen)
 		eject_flow = 1;
 	}
 
-	lck_mtx_lock_spin(&tcp_lro_lock);
+	hash = tcp_lro_hash(ip_hdr->ip_src, ip_hdr->ip_dst,
+	    tcp_hdr->th_sport, tcp_hdr->th_dport);
+	lt = LRO_TABLE(hash);
 
-	retval = tcp_lro_matching_tuple(ip_hdr, tcp_hdr, &hash, &flow_id);
+	lck_mtx_lock_spin(&lt->lt_lock);
+
+	retval = tcp_lro_matching_tuple(lt, hash, ip_hdr, tcp_hdr, &flow);
 
 	switch (retval) {
 	case TCP_LRO_NAN:
-		lck_mtx_unlock(&tcp_lro_lock);
-		ret_response = TCP_LRO_FLOW_NOTFOUND;
+		lck_mtx_unlock(&lt->lt_lock);
+		ret_response = TCP_LRO_NAN;
 		break;
 
 	case TCP_LRO_COALESCE:
 		if ((payload_len != 0) && (unknown_tcpopts == 0) && 
 			(tcpflags == 0) && (ecn != IPTOS_ECN_CE) && (to.to_flags & TOF_TS)) { 
-			tcp_lro_coalesce(flow_id, lro_mb, tcp_hdr, payload_len,
+			tcp_lro_coalesce(lt, flow, lro_mb, tcp_hdr, payload_len,
 				drop_hdrlen, &to, 
 				(to.to_flags & TOF_TS) ? (u_int32_t *)(void *)(optp + 4) : NULL,
 				(to.to_flags & TOF_TS) ? (u_int32_t *)(void *)(optp + 8) : NULL,
 				thflags);
 			if (lrodebug >= 2) { 
-				printf("tcp_lro_process_pkt: coalesce len = %d. flow_id = %d payload_len = %d drop_hdrlen = %d optlen = %d lport = %d seqnum = %x.\n",
-					lro_flow_list[flow_id].lr_len, flow_id, 
+				printf("tcp_lro_process_pkt: coalesce len = %d. hash = %x payload_len = %d drop_hdrlen = %d optlen = %d lport = %d seqnum = %x.\n",
+					flow->lr_len, hash, 
 					payload_len, drop_hdrlen, optlen,
-					ntohs(lro_flow_list[flow_id].lr_lport),
+					ntohs(flow->lr_lport),
 					ntohl(tcp_hdr->th_seq));
 			}
-			if (lro_flow_list[flow_id].lr_mhead->m_pkthdr.lro_npkts >= coalesc_sz) {
+			if (flow->lr_mhead->m_pkthdr.lro_npkts >= coalesc_sz) {
 				eject_flow = 1;
 			}
 			coalesced = 1;
 		}
 		if (eject_flow) {
-			mb = tcp_lro_eject_coalesced_pkt(flow_id);
-			lro_flow_list[flow_id].lr_seq = ntohl(tcp_hdr->th_seq) +
-								payload_len;
+			mb = tcp_lro_eject_coalesced_pkt(lt, flow);
+			flow->lr_seq = ntohl(tcp_hdr->th_seq) + payload_len;
 			calculate_tcp_clock();					
-			u_int8_t timestamp = tcp_now - lro_flow_list[flow_id].lr_timestamp;					
-			lck_mtx_unlock(&tcp_lro_lock);
+			u_int8_t timestamp = tcp_now - flow->lr_timestamp;
+			lck_mtx_unlock(&lt->lt_lock);
 			if (mb) {
 				mb->m_pkthdr.lro_elapsed = timestamp;
 				lro_proto_input(mb);
@@ -556,15 +637,15 @@ tcp_lro_process_pkt(struct mbuf *lro_mb, int drop_hdrlen)
 				lro_proto_input(lro_mb);
 			}
 		} else {
-			lck_mtx_unlock(&tcp_lro_lock);
+			lck_mtx_unlock(&lt->lt_lock);
 		}
 		break;
 
 	case TCP_LRO_EJECT_FLOW:
-		mb = tcp_lro_eject_coalesced_pkt(flow_id);
+		mb = tcp_lro_eject_coalesced_pkt(lt, flow);
 		calculate_tcp_clock();
-		u_int8_t timestamp = tcp_now - lro_flow_list[flow_id].lr_timestamp;
-		lck_mtx_unlock(&tcp_lro_lock);
+		u_int8_t timestamp = tcp_now - flow->lr_timestamp;
+		lck_mtx_unlock(&lt->lt_lock);
 		if (mb) {
 			if (lrodebug) 
 				printf("tcp_lro_process_pkt eject_flow, len = %d\n", mb->m_pkthdr.len);
@@ -575,18 +656,13 @@ tcp_lro_process_pkt(struct mbuf *lro_mb, int drop_hdrlen)
 		lro_proto_input(lro_mb);
 		break;
 
-	case TCP_LRO_COLLISION:
-		lck_mtx_unlock(&tcp_lro_lock);
-		ret_response = TCP_LRO_FLOW_NOTFOUND;
-		break;
-
 	default:
-		lck_mtx_unlock(&tcp_lro_lock);
+		lck_mtx_unlock(&lt->lt_lock);
 		panic_plain("%s: unrecognized type %d", __func__, retval);
 		break; 
 	}
 
-	if (ret_response == TCP_LRO_FLOW_NOTFOUND) {
+	if (ret_response == TCP_LRO_NAN) {
 		lro_proto_input(lro_mb);
 	}
 	return (NULL);
@@ -597,76 +673,103 @@ tcp_lro_timer_proc(void *arg1, void *arg2)
 {
 #pragma unused(arg1, arg2)
 
-	lck_mtx_lock_spin(&tcp_lro_lock);
 	lro_timer_set = 0;
-	lck_mtx_unlock(&tcp_lro_lock);
-	tcp_lro_flush_flows();
+	tcp_lro_flush_tables(THREAD_NULL, TRUE);
 }
 
+/*
+ * Push up the coalesced chains started by "owner", or all of them when
+ * owner is THREAD_NULL.  With "remove" the flows are dropped from the
+ * tables as well, so that idle flows do not linger; otherwise the flow
+ * state is kept and the next batch carries on coalescing.
+ */
 static void
-tcp_lro_flush_flows(void)
+tcp_lro_flush_tables(thread_t owner, boolean_t remove)
 {
-	int i = 0;
-	struct mbuf *mb;
-	struct lro_flow *flow;
+	struct mbuf *mb, *mhead = NULL, **mtailp = &mhead;
+	struct lro_flow *flow, *tflow;
+	struct lro_table *lt;
 	int tcpclock_updated = 0;
+	u_int32_t i;
+
+	for (i = 0; i <= lro_table_mask; i++) {
+		lt = &lro_tables[i];
+		if (lt->lt_npending == 0) {
+			continue;
+		}
 
-	lck_mtx_lock(&tcp_lro_lock);
+		lck_mtx_lock(&lt->lt_lock);
+		TAILQ_FOREACH_SAFE(flow, &lt->lt_pending, lr_pend_link, tflow) {
+			if (owner != THREAD_NULL && flow->lr_owner != owner) {
+				continue;
+			}
 
-	while (i < TCP_LRO_NUM_FLOWS) {
-		flow = &lro_flow_list[i];
-		if (flow->lr_mhead != NULL) {
-			
 			if (!tcpclock_updated) {
 				calculate_tcp_clock();
 				tcpclock_updated = 1;
 			}
 
 			if (lrodebug >= 2) 
-				printf("tcp_lro_flush_flows: len =%d n_pkts = %d %d %d \n",
+				printf("tcp_lro_flush_tables: len =%d n_pkts = %d %d %d \n",
 					flow->lr_len, 
 					flow->lr_mhead->m_pkthdr.lro_npkts, 
 					flow->lr_timestamp, tcp_now);
 
 			u_int8_t timestamp = tcp_now - flow->lr_timestamp;
 
-			mb = tcp_lro_eject_flow(i);
-
-			if (mb) {
-				mb->m_pkthdr.lro_elapsed = timestamp;
-				lck_mtx_unlock(&tcp_lro_lock);
-				lro_update_flush_stats(mb);
-				lro_proto_input(mb);
-				lck_mtx_lock(&tcp_lro_lock);
+			if (remove) {
+				mb = tcp_lro_eject_flow(lt, flow);
+			} else {
+				mb = tcp_lro_eject_coalesced_pkt(lt, flow);
 			}
+			mb->m_pkthdr.lro_elapsed = timestamp;
+			*mtailp = mb;
+			mtailp = &mb->m_nextpkt;
 		}
-		i++;
+		lck_mtx_unlock(&lt->lt_lock);
+	}
+
+	while ((mb = mhead) != NULL) {
+		mhead = mb->m_nextpkt;
+		mb->m_nextpkt = NULL;
+		lro_update_flush_stats(mb);
+		lro_proto_input(mb);
 	}
-	lck_mtx_unlock(&tcp_lro_lock);
 }
 
 /*
- * Must be called with tcp_lro_lock held.
+ * Called by DLIL once it has handed an input batch to the protocols, to
+ * push up what the calling thread coalesced from that batch.
+ */
+void
+tcp_lro_flush(void)
+{
+	tcp_lro_flush_tables(current_thread(), FALSE);
+}
+
+/*
  * The hint is non-zero for longer waits. The wait time dictated by coalesc_time
  * takes precedence, so lro_timer_set is not set for the hint case
  */
 static void
 tcp_lro_sched_timer(uint64_t hint)
 {
-	if (lro_timer_set) {
+	uint64_t deadline;
+
+	if (lro_timer_set || !OSCompareAndSwap(0, 1, &lro_timer_set)) {
 		return;
 	}
 
-	lro_timer_set = 1;
 	if (!hint) {
 		/* the intent is to wake up every coalesc_time msecs */
 		clock_interval_to_deadline(coalesc_time, 
-			(NSEC_PER_SEC / TCP_RETRANSHZ), &lro_deadline);
+			(NSEC_PER_SEC / TCP_RETRANSHZ), &deadline);
 	} else {
 		clock_interval_to_deadline(hint, NSEC_PER_SEC / TCP_RETRANSHZ,
-                        &lro_deadline);
+                        &deadline);
 	}
-	thread_call_enter_delayed(tcp_lro_timer, lro_deadline);
+	lro_deadline = deadline;
+	thread_call_enter_delayed(tcp_lro_timer, deadline);
 }
 
 struct mbuf*
@@ -771,50 +874,42 @@ lro_tcp_xsum_validate(struct mbuf *m, struct ip *ip, struct tcphdr * th)
 int
 tcp_start_coalescing(struct ip *ip_hdr, struct tcphdr *tcp_hdr, int tlen) 
 {
-	int hash;
-	int flow_id;
-	struct mbuf *eject_mb;
+	struct lro_table *lt;
 	struct lro_flow *lf;
-
-	hash = LRO_HASH(ip_hdr->ip_src.s_addr, ip_hdr->ip_dst.s_addr, 
-		tcp_hdr->th_sport, tcp_hdr->th_dport,
-		(TCP_LRO_FLOW_MAP - 1));
-
-	
-	lck_mtx_lock_spin(&tcp_lro_lock);
-	flow_id = lro_flow_map[hash];
-	if (flow_id != TCP_LRO_FLOW_NOTFOUND) {
-		lf = &lro_flow_list[flow_id];
-		if ((lf->lr_faddr.s_addr == ip_hdr->ip_src.s_addr) &&
-		    (lf->lr_laddr.s_addr == ip_hdr->ip_dst.s_addr) &&
-		    (lf->lr_fport == tcp_hdr->th_sport) &&
-		    (lf->lr_lport == tcp_hdr->th_dport)) {
-		    	if ((lf->lr_tcphdr == NULL) &&
-		    		(lf->lr_seq != (tcp_hdr->th_seq + tlen))) {
-				lf->lr_seq = tcp_hdr->th_seq + tlen;
-			}	
-			lf->lr_flags &= ~LRO_EJECT_REQ;
-		}
-		lck_mtx_unlock(&tcp_lro_lock); 
+	u_int32_t hash;
+
+	hash = tcp_lro_hash(ip_hdr->ip_src, ip_hdr->ip_dst,
+	    tcp_hdr->th_sport, tcp_hdr->th_dport);
+	lt = LRO_TABLE(hash);
+
+	/* the full mutex, as a new flow may have to be allocated */
+	lck_mtx_lock(&lt->lt_lock);
+	lf = tcp_lro_lookup(lt, hash, ip_hdr->ip_src, ip_hdr->ip_dst,
+	    tcp_hdr->th_sport, tcp_hdr->th_dport);
+	if (lf != NULL) {
+		if ((lf->lr_tcphdr == NULL) &&
+		    (lf->lr_seq != (tcp_hdr->th_seq + tlen))) {
+			lf->lr_seq = tcp_hdr->th_seq + tlen;
+		}	
+		lf->lr_flags &= ~LRO_EJECT_REQ;
+		lck_mtx_unlock(&lt->lt_lock); 
 		return 0;
 	}
 
 	HTONL(tcp_hdr->th_seq);
 	HTONL(tcp_hdr->th_ack);
-	eject_mb = 
-		tcp_lro_insert_flow(NULL, ip_hdr, tcp_hdr, tlen, 0, hash, 
-		NULL, NULL, NULL);
+	lf = tcp_lro_insert_flow(lt, hash, ip_hdr, tcp_hdr, tlen);
 
-	lck_mtx_unlock(&tcp_lro_lock);
+	lck_mtx_unlock(&lt->lt_lock);
 
 	NTOHL(tcp_hdr->th_seq);
 	NTOHL(tcp_hdr->th_ack);
 	if (lrodebug >= 3) {
-		printf("%s: src = %x dst = %x sport = %d dport = %d seq %x \n",
+		printf("%s: src = %x dst = %x sport = %d dport = %d seq %x %s\n",
 			__func__, ip_hdr->ip_src.s_addr, ip_hdr->ip_dst.s_addr,
-			tcp_hdr->th_sport, tcp_hdr->th_dport, tcp_hdr->th_seq);
+			tcp_hdr->th_sport, tcp_hdr->th_dport, tcp_hdr->th_seq,
+			(lf == NULL) ? "(table full)" : "");
 	}
-	ASSERT(eject_mb == NULL);
 	return 0;
 }
 
@@ -826,29 +921,22 @@ int
 tcp_lro_remove_state(struct in_addr saddr, struct in_addr daddr, 
 		unsigned short sport, unsigned short dport)
 {
-	int hash, flow_id;
+	struct lro_table *lt;
 	struct lro_flow *lf;
+	u_int32_t hash;
 
-	hash = LRO_HASH(daddr.s_addr, saddr.s_addr, dport, sport,
-		(TCP_LRO_FLOW_MAP - 1));
-	lck_mtx_lock_spin(&tcp_lro_lock);
-	flow_id = lro_flow_map[hash];
-	if (flow_id == TCP_LRO_FLOW_UNINIT) {
-		lck_mtx_unlock(&tcp_lro_lock);
-		return 0;
-	}
-	lf = &lro_flow_list[flow_id];
-	if ((lf->lr_faddr.s_addr == daddr.s_addr) && 
-	    (lf->lr_laddr.s_addr == saddr.s_addr) &&
-	    (lf->lr_fport == dport) &&
-	    (lf->lr_lport == sport)) {
+	hash = tcp_lro_hash(daddr, saddr, dport, sport);
+	lt = LRO_TABLE(hash);
+	lck_mtx_lock_spin(&lt->lt_lock);
+	lf = tcp_lro_lookup(lt, hash, daddr, saddr, dport, sport);
+	if (lf != NULL) {
 		if (lrodebug) {
 			printf("%s: %x %x\n", __func__, 
 				lf->lr_flags, lf->lr_seq);
 		}
 		lf->lr_flags |= LRO_EJECT_REQ;
 	}
-	lck_mtx_unlock(&tcp_lro_lock);
+	lck_mtx_unlock(&lt->lt_lock);
 	return 0;
 }
 
@@ -856,26 +944,18 @@ void
 tcp_update_lro_seq(__uint32_t rcv_nxt, struct in_addr saddr, struct in_addr daddr,
 		unsigned short sport, unsigned short dport)
 {
-	int hash, flow_id;
+	struct lro_table *lt;
 	struct lro_flow *lf;
+	u_int32_t hash;
 
-	hash = LRO_HASH(daddr.s_addr, saddr.s_addr, dport, sport, 
-		(TCP_LRO_FLOW_MAP - 1));
-	lck_mtx_lock_spin(&tcp_lro_lock);
-	flow_id = lro_flow_map[hash];
-	if (flow_id == TCP_LRO_FLOW_UNINIT) {
-		lck_mtx_unlock(&tcp_lro_lock);
-		return;
-	}
-	lf = &lro_flow_list[flow_id];
-	if ((lf->lr_faddr.s_addr == daddr.s_addr) &&
-	    (lf->lr_laddr.s_addr == saddr.s_addr) &&
-	    (lf->lr_fport == dport) &&
-	    (lf->lr_lport == sport) &&
-	    (lf->lr_tcphdr == NULL)) {
+	hash = tcp_lro_hash(daddr, saddr, dport, sport);
+	lt = LRO_TABLE(hash);
+	lck_mtx_lock_spin(&lt->lt_lock);
+	lf = tcp_lro_lookup(lt, hash, daddr, saddr, dport, sport);
+	if ((lf != NULL) && (lf->lr_tcphdr == NULL)) {
 		lf->lr_seq = (tcp_seq)rcv_nxt;
 	}
-	lck_mtx_unlock(&tcp_lro_lock);
+	lck_mtx_unlock(&lt->lt_lock);
 	return;
 }
 
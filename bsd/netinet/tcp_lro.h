@@ -31,15 +31,27 @@
 
 #ifdef BSD_KERNEL_PRIVATE
 
-#define TCP_LRO_NUM_FLOWS (16)	/* must be <= 255 for char lro_flow_map */
-#define TCP_LRO_FLOW_MAP  (1024)
+#include <sys/queue.h>
+
+/*
+ * Flows are kept in a set of independently locked flow tables, one per
+ * CPU (rounded up to a power of 2).  A flow is assigned to a table and to
+ * a bucket within that table by the hash of its 4-tuple, so packets of
+ * unrelated flows received on different CPUs do not contend for a lock.
+ */
+#define TCP_LRO_MAX_TABLES	(64)	/* upper bound on flow tables */
+#define TCP_LRO_MAX_FLOWS	(4096)	/* default bound on tracked flows */
 
 struct lro_flow {
+	LIST_ENTRY(lro_flow)	lr_hash_link;	/* hash bucket linkage */
+	TAILQ_ENTRY(lro_flow)	lr_lru_link;	/* table LRU linkage */
+	TAILQ_ENTRY(lro_flow)	lr_pend_link;	/* pending flush linkage */
 	struct mbuf		*lr_mhead;	/* coalesced mbuf chain head */
 	struct mbuf		*lr_mtail;	/* coalesced mbuf chain tail */
 	struct tcphdr		*lr_tcphdr;	/* ptr to TCP hdr in frame */
 	u_int32_t		*lr_tsval;	/* address of tsval in frame */
 	u_int32_t		*lr_tsecr;	/* tsecr field in TCP header */
+	thread_t		lr_owner;	/* thread that started lr_mhead */
 	tcp_seq			lr_seq;		/* next expected seq num */
 	unsigned int	 	lr_len;		/* length of LRO frame */
 	struct in_addr		lr_faddr;	/* foreign address */
@@ -47,16 +59,29 @@ struct lro_flow {
 	unsigned short int 	lr_fport;	/* foreign port */
 	unsigned short int	lr_lport;	/* local port */
 	u_int32_t		lr_timestamp;	/* for ejecting the flow */
-	unsigned short int	lr_hash_map;	/* back pointer to hash map */
-	unsigned short int	lr_flags;	/* pad */
+	u_int32_t		lr_hash;	/* hash of the 4-tuple */
+	unsigned short int	lr_flags;	/* see below */
 } __attribute__((aligned(8)));
 
 /* lr_flags - only 16 bits available */
 #define LRO_EJECT_REQ	0x1 
 
+/* Hash key, laid out so that it can be hashed without padding */
+struct lro_flow_key {
+	struct in_addr		lk_faddr;
+	struct in_addr		lk_laddr;
+	unsigned short int	lk_fport;
+	unsigned short int	lk_lport;
+};
 
-#define TCP_LRO_FLOW_UNINIT TCP_LRO_NUM_FLOWS+1
-#define TCP_LRO_FLOW_NOTFOUND TCP_LRO_FLOW_UNINIT
+struct lro_table {
+	decl_lck_mtx_data(, lt_lock);		/* protects the table */
+	LIST_HEAD(, lro_flow)	*lt_hash;	/* hash buckets */
+	TAILQ_HEAD(lro_lru, lro_flow) lt_lru;	/* all flows, MRU first */
+	TAILQ_HEAD(, lro_flow)	lt_pending;	/* flows holding a chain */
+	u_int32_t		lt_nflows;	/* flows in the table */
+	u_int32_t		lt_npending;	/* flows on lt_pending */
+};
 
 /* Max packets to be coalesced before pushing to app */
 #define LRO_MX_COALESCE_PKTS (8)
@@ -70,12 +95,11 @@ struct lro_flow {
  * Max amount of time to wait before flushing flows in msecs.
  * Units are in msecs. 
  * This number has been carefully chosen and should be altered with care.
+ * Flows are normally flushed when DLIL finishes an input batch; the timer
+ * only catches chains started outside of a batch.
  */
 #define LRO_MX_TIME_TO_BUFFER 10
 
-/* similar to INP_PCBHASH */
-#define LRO_HASH(faddr, laddr, fport, lport, mask) \
-	(((faddr) ^ ((laddr) >> 16) ^ ntohs((lport) ^ (fport))) & (mask))
 #endif
 
 #endif /* TCP_LRO_H_ */
@@ -595,6 +595,12 @@ tcp_output(struct tcpcb *tp)
 	boolean_t wifi = FALSE;
 	boolean_t wired = FALSE;
 	boolean_t sack_rescue_rxt = FALSE;
+	boolean_t pacing_txtime = FALSE;
+	boolean_t sum_in_copy = FALSE;
+	u_int16_t paysum = 0;
+	struct ifnet *outifp;
+	u_int32_t pacing_rate = 0;
+	u_int64_t txtime;
 	int sotc = so->so_traffic_class;
 
 	/*
@@ -650,6 +656,7 @@ again:
 #if MPTCP
 	mptcp_acknow = FALSE;
 #endif
+	sum_in_copy = FALSE;
 
 	KERNEL_DEBUG(DBG_FNC_TCP_OUTPUT | DBG_FUNC_START, 0,0,0,0,0);
 
@@ -1069,6 +1076,9 @@ after_sack_rexmit:
 	 *	   have data to make use of it);
 	 *	3. our send window (slow start and congestion controlled) is
 	 *	   larger than sent but unacknowledged data in send buffer.
+	 * Grow it to twice the amount of data the connection can have in
+	 * flight, its bandwidth-delay product, rather than by a fixed
+	 * increment each time.
 	 */
 	if (tcp_do_autosendbuf == 1 &&
 	    !INP_WAIT_FOR_IF_FEEDBACK(inp) && !IN_FASTRECOVERY(tp) &&
@@ -1077,9 +1087,12 @@ after_sack_rexmit:
 		if ((tp->snd_wnd / 4 * 5) >= so->so_snd.sb_hiwat &&
 		    so->so_snd.sb_cc >= (so->so_snd.sb_hiwat / 8 * 7) &&
 		    sendwin >= (so->so_snd.sb_cc - (tp->snd_nxt - tp->snd_una))) {
+			u_int32_t newsize;
+
+			newsize = max(so->so_snd.sb_hiwat + tcp_autosndbuf_inc,
+			    2 * min(tp->snd_cwnd, tp->snd_wnd));
 			if (sbreserve(&so->so_snd,
-			    min(so->so_snd.sb_hiwat + tcp_autosndbuf_inc,
-			    tcp_autosndbuf_max)) == 1) {
+			    min(newsize, tcp_autosndbuf_max)) == 1) {
 				so->so_snd.sb_idealsize = so->so_snd.sb_hiwat;
 			}
 		}
@@ -1204,6 +1217,41 @@ after_sack_rexmit:
 		}
 	}
 
+	/*
+	 * If the connection is paced and the outgoing interface honours
+	 * departure times, the segments are stamped with one below and
+	 * the interface queue spaces them out; only keep TSO bursts to
+	 * about a millisecond worth of data at the pacing rate. Otherwise,
+	 * if the congestion control algorithm paces this connection, send
+	 * no more than the pacing budget allows. The pacing timer will
+	 * call us again once the budget has been refilled.
+	 */
+	pacing_rate = tcp_pacing_rate(tp);
+	pacing_txtime = (pacing_rate != 0 &&
+	    tcp_pacing_txtime_capable(inp->inp_last_outifp));
+	if (len > 0 && pacing_txtime) {
+		int32_t burst = max(pacing_rate / 1000, 2 * tp->t_maxseg);
+
+		if (len > burst) {
+			len = burst - (burst % tp->t_maxseg);
+			sendalot = 1;
+		}
+	} else if (len > 0 && tp->t_pacing_rate != 0 &&
+	    !(tp->t_flagsext & (TF_FORCE | TF_SENT_TLPROBE))) {
+		int32_t budget = tcp_pacing_budget(tp);
+
+		if (len > budget) {
+			if (budget >= (int32_t)tp->t_maxseg)
+				len = budget - (budget % tp->t_maxseg);
+			else
+				len = 0;
+			if (len <= (int32_t)tp->t_maxseg)
+				tso = 0;
+			sendalot = 0;
+			tcp_pacing_hold(tp);
+		}
+	}
+
 	if (sack_rxmit) {
 		if (SEQ_LT(p->rxmit + len, tp->snd_una + so->so_snd.sb_cc))
 			flags &= ~TH_FIN;
@@ -1419,7 +1467,7 @@ after_sack_rexmit:
 	 * otherwise force out a byte.
 	 */
 	if (so->so_snd.sb_cc && tp->t_timer[TCPT_REXMT] == 0 &&
-	    tp->t_timer[TCPT_PERSIST] == 0) {
+	    tp->t_timer[TCPT_PERSIST] == 0 && tp->t_timer[TCPT_PACE] == 0) {
 		TCP_RESET_REXMT_STATE(tp);
 		tcp_setpersist(tp);
 	}
@@ -1863,7 +1911,15 @@ send:
 	 * be transmitted, and initialize the header from
 	 * the template for sends on this connection.
 	 */
+	txtime = 0;
 	if (len) {
+		if (pacing_txtime) {
+			if (!(tp->t_flagsext & (TF_FORCE | TF_SENT_TLPROBE)))
+				txtime = tcp_pacing_txtime(tp, pacing_rate,
+				    len);
+		} else if (tp->t_pacing_rate != 0) {
+			tcp_pacing_consume(tp, len);
+		}
 		tp->t_pmtud_lastseg_size = len + optlen + ipoptlen;
 		if ((tp->t_flagsext & TF_FORCE) && len == 1)
 			tcpstat.tcps_sndprobe++;
@@ -1948,8 +2004,22 @@ send:
 				error = 0; /* should we return an error? */
 				goto out;
 			}
-			m_copydata(so->so_snd.sb_mb, off, (int) len,
-			    mtod(m, caddr_t) + hdrlen);
+			/*
+			 * Without transmit checksum offload the payload
+			 * would be read again to checksum it in ip_output;
+			 * sum it while it is copied instead.
+			 */
+			outifp = inp->inp_last_outifp;
+			if (outifp != NULL && (!hwcksum_tx ||
+			    !(outifp->if_hwassist &
+			    (isipv6 ? CSUM_TCPIPV6 : CSUM_TCP)))) {
+				paysum = m_copydata_sum(so->so_snd.sb_mb, off,
+				    len, mtod(m, caddr_t) + hdrlen);
+				sum_in_copy = TRUE;
+			} else {
+				m_copydata(so->so_snd.sb_mb, off, (int) len,
+				    mtod(m, caddr_t) + hdrlen);
+			}
 			m->m_len += len;
 		} else {
 			uint32_t copymode;
@@ -2200,6 +2270,16 @@ send:
 				htons((u_short)(optlen + len)));
 	}
 
+	/*
+	 * The payload was summed as it was copied; complete the checksum
+	 * over the header, which holds the pseudo header sum in th_sum.
+	 */
+	if (sum_in_copy) {
+		th->th_sum = ~in_addword(b_sum16(th,
+		    sizeof (struct tcphdr) + optlen), paysum);
+		m->m_pkthdr.csum_flags &= ~(CSUM_TCP | CSUM_TCPIPV6);
+	}
+
 	/*
 	 * Enable TSO and specify the size of the segments.
 	 * The TCP pseudo header checksum is always provided.
@@ -2434,6 +2514,7 @@ timer:
 	m->m_pkthdr.pkt_flowid = inp->inp_flowhash;
 	m->m_pkthdr.pkt_flags |= (PKTF_FLOW_ID | PKTF_FLOW_LOCALSRC | PKTF_FLOW_ADV);
 	m->m_pkthdr.pkt_proto = IPPROTO_TCP;
+	m->m_pkthdr.pkt_txtime = txtime;
 	m->m_pkthdr.tx_tcp_pid = so->last_pid;
 	if (so->so_flags & SOF_DELEGATED)
 		m->m_pkthdr.tx_tcp_e_pid = so->e_pid;
@@ -161,9 +161,12 @@
 static tcp_cc tcp_ccgen;
 extern int tcp_lq_overflow;
 
-extern struct tcptimerlist tcp_timer_list;
+extern struct tcptimerlist tcp_timer_lists[TCP_TIMERLIST_NSHARDS];
 extern struct tcptailq tcp_tw_tailq;
 
+/* spreads new connections across the timer lists */
+static SInt32 tcp_timer_list_rotor;
+
 SYSCTL_SKMEM_TCP_INT(TCPCTL_MSSDFLT, mssdflt, CTLFLAG_RW | CTLFLAG_LOCKED,
 	int, tcp_mssdflt, TCP_MSS, "Default TCP Maximum Segment Size");
 
@@ -247,6 +250,10 @@ SYSCTL_INT(_net_inet_tcp, OID_AUTO, isn_reseed_interval,
 SYSCTL_SKMEM_TCP_INT(OID_AUTO, rtt_min, CTLFLAG_RW | CTLFLAG_LOCKED,
 	int, tcp_TCPTV_MIN, 100, "min rtt value allowed");
 
+SYSCTL_SKMEM_TCP_INT(OID_AUTO, rtt_cache_minsamples,
+	CTLFLAG_RW | CTLFLAG_LOCKED, static int, tcp_rtt_cache_minsamples, 4,
+	"RTT samples a connection needs before it seeds its route's metrics");
+
 SYSCTL_SKMEM_TCP_INT(OID_AUTO, rexmt_slop, CTLFLAG_RW,
 	int, tcp_rexmt_slop, TCPTV_REXMTSLOP, "Slop added to retransmit timeout");
 
@@ -460,6 +467,7 @@ tcp_init(struct protosw *pp, struct domain *dp)
 	static int tcp_initialized = 0;
 	vm_size_t str_size;
 	struct inpcbinfo *pcbinfo;
+	int i;
 
 	VERIFY((pp->pr_flags & (PR_INITIALIZED|PR_ATTACHED)) == PR_ATTACHED);
 
@@ -598,23 +606,31 @@ tcp_init(struct protosw *pp, struct domain *dp)
 	/* Initialize time wait and timer lists */
 	TAILQ_INIT(&tcp_tw_tailq);
 
-	bzero(&tcp_timer_list, sizeof(tcp_timer_list));
-	LIST_INIT(&tcp_timer_list.lhead);
+	bzero(tcp_timer_lists, sizeof(tcp_timer_lists));
 	/*
-	 * allocate lock group attribute, group and attribute for
-	 * the tcp timer list
+	 * allocate lock group attribute, group and attribute shared by
+	 * the tcp timer lists
 	 */
-	tcp_timer_list.mtx_grp_attr = lck_grp_attr_alloc_init();
-	tcp_timer_list.mtx_grp = lck_grp_alloc_init("tcptimerlist",
-	    tcp_timer_list.mtx_grp_attr);
-	tcp_timer_list.mtx_attr = lck_attr_alloc_init();
-	if ((tcp_timer_list.mtx = lck_mtx_alloc_init(tcp_timer_list.mtx_grp,
-	    tcp_timer_list.mtx_attr)) == NULL) {
-		panic("failed to allocate memory for tcp_timer_list.mtx\n");
-	};
-	tcp_timer_list.call = thread_call_allocate(tcp_run_timerlist, NULL);
-	if (tcp_timer_list.call == NULL) {
-		panic("failed to allocate call entry 1 in tcp_init\n");
+	tcp_timer_lists[0].mtx_grp_attr = lck_grp_attr_alloc_init();
+	tcp_timer_lists[0].mtx_grp = lck_grp_alloc_init("tcptimerlist",
+	    tcp_timer_lists[0].mtx_grp_attr);
+	tcp_timer_lists[0].mtx_attr = lck_attr_alloc_init();
+	for (i = 0; i < TCP_TIMERLIST_NSHARDS; i++) {
+		struct tcptimerlist *listp = &tcp_timer_lists[i];
+
+		LIST_INIT(&listp->lhead);
+		listp->index = i;
+		listp->mtx_grp_attr = tcp_timer_lists[0].mtx_grp_attr;
+		listp->mtx_grp = tcp_timer_lists[0].mtx_grp;
+		listp->mtx_attr = tcp_timer_lists[0].mtx_attr;
+		if ((listp->mtx = lck_mtx_alloc_init(listp->mtx_grp,
+		    listp->mtx_attr)) == NULL) {
+			panic("failed to allocate memory for tcp_timer_lists.mtx\n");
+		};
+		listp->call = thread_call_allocate(tcp_run_timerlist, listp);
+		if (listp->call == NULL) {
+			panic("failed to allocate call entry 1 in tcp_init\n");
+		}
 	}
 
 	/*
@@ -636,11 +652,17 @@ tcp_init(struct protosw *pp, struct domain *dp)
 
 	/*
 	 * If more than 60 MB of mbuf pool is available, increase the
-	 * maximum allowed receive and send socket buffer size.
+	 * maximum allowed receive and send socket buffer size, in
+	 * proportion to the pool so that connections with a large
+	 * bandwidth-delay product can fill their path.
 	 */
 	if (nmbclusters > 30720) {
-		tcp_autorcvbuf_max = 2 * 1024 * 1024;
-		tcp_autosndbuf_max = 2 * 1024 * 1024;
+		uint32_t sbmax = ((nmbclusters >> 6) << MCLSHIFT);
+
+		sbmax = max(sbmax, 2 * 1024 * 1024);
+		sbmax = min(sbmax, TCP_AUTOSB_MAX);
+		tcp_autorcvbuf_max = sbmax;
+		tcp_autosndbuf_max = sbmax;
 
 		SYSCTL_SKMEM_UPDATE_FIELD(tcp.autorcvbufmax, tcp_autorcvbuf_max);
 		SYSCTL_SKMEM_UPDATE_FIELD(tcp.autosndbufmax, tcp_autosndbuf_max);
@@ -1082,11 +1104,7 @@ tcp_newtcpcb(struct inpcb *inp)
 	tp->t_rttmin = tcp_TCPTV_MIN;
 	tp->t_rxtcur = TCPTV_RTOBASE;
 
-	if (tcp_use_newreno)
-		/* use newreno by default */
-		tp->tcp_cc_index = TCP_CC_ALGO_NEWRENO_INDEX;
-	else
-		tp->tcp_cc_index = TCP_CC_ALGO_CUBIC_INDEX;
+	tp->tcp_cc_index = tcp_cc_default_index();
 
 	tcp_cc_allocate_state(tp);
 
@@ -1098,6 +1116,8 @@ tcp_newtcpcb(struct inpcb *inp)
 	tp->snd_ssthresh_prev = TCP_MAXWIN << TCP_MAX_WINSHIFT;
 	tp->t_rcvtime = tcp_now;
 	tp->tentry.timer_start = tcp_now;
+	tp->tentry.list = (uint16_t)((uint32_t)OSIncrementAtomic(
+	    &tcp_timer_list_rotor) % TCP_TIMERLIST_NSHARDS);
 	tp->t_persist_timeout = tcp_max_persist_timeout;
 	tp->t_persist_stop = 0;
 	tp->t_flagsext |= TF_RCVUNACK_WAITSS;
@@ -1355,7 +1375,7 @@ tcp_close(struct tcpcb *tp)
 #endif /* INET6 */
 	struct route *ro;
 	struct rtentry *rt;
-	int dosavessthresh;
+	int dosavessthresh, converged;
 	struct ifnet_stats_per_flow ifs;
 
 	/* tcp_close was called previously, bail */
@@ -1403,10 +1423,19 @@ tcp_close(struct tcpcb *tp)
 	 * to within 5% of the correct value; fewer samples and
 	 * we could save a very bogus rtt.
 	 *
+	 * Short-lived connections, such as RPCs, rarely get that many
+	 * samples though, and would then never seed the route and each
+	 * start over from the default RTO.  Let them contribute once they
+	 * have tcp_rtt_cache_minsamples samples, but only with a quarter
+	 * of the weight of a converged estimate.  They don't update the
+	 * ssthresh.
+	 *
 	 * Don't update the default route's characteristics and don't
 	 * update anything that the user "locked".
 	 */
-	if (tp->t_rttupdated >= 16) {
+	converged = (tp->t_rttupdated >= 16);
+	if (converged || (tcp_rtt_cache_minsamples > 0 &&
+	    tp->t_rttupdated >= (u_int32_t)tcp_rtt_cache_minsamples)) {
 		u_int32_t i = 0;
 
 #if INET6
@@ -1434,7 +1463,7 @@ tcp_close(struct tcpcb *tp)
 		if ((rt->rt_rmx.rmx_locks & RTV_RTT) == 0) {
 			i = tp->t_srtt *
 			    (RTM_RTTUNIT / (TCP_RETRANSHZ * TCP_RTT_SCALE));
-			if (rt->rt_rmx.rmx_rtt && i)
+			if (rt->rt_rmx.rmx_rtt && i && converged)
 				/*
 				 * filter this update to half the old & half
 				 * the new values, converting scale.
@@ -1443,6 +1472,9 @@ tcp_close(struct tcpcb *tp)
 				 */
 				rt->rt_rmx.rmx_rtt =
 				    (rt->rt_rmx.rmx_rtt + i) / 2;
+			else if (rt->rt_rmx.rmx_rtt && i)
+				rt->rt_rmx.rmx_rtt =
+				    (3 * rt->rt_rmx.rmx_rtt + i) / 4;
 			else
 				rt->rt_rmx.rmx_rtt = i;
 			tcpstat.tcps_cachedrtt++;
@@ -1450,9 +1482,12 @@ tcp_close(struct tcpcb *tp)
 		if ((rt->rt_rmx.rmx_locks & RTV_RTTVAR) == 0) {
 			i = tp->t_rttvar *
 			    (RTM_RTTUNIT / (TCP_RETRANSHZ * TCP_RTTVAR_SCALE));
-			if (rt->rt_rmx.rmx_rttvar && i)
+			if (rt->rt_rmx.rmx_rttvar && i && converged)
 				rt->rt_rmx.rmx_rttvar =
 				    (rt->rt_rmx.rmx_rttvar + i) / 2;
+			else if (rt->rt_rmx.rmx_rttvar && i)
+				rt->rt_rmx.rmx_rttvar =
+				    (3 * rt->rt_rmx.rmx_rttvar + i) / 4;
 			else
 				rt->rt_rmx.rmx_rttvar = i;
 			tcpstat.tcps_cachedrttvar++;
@@ -1476,9 +1511,10 @@ tcp_close(struct tcpcb *tp)
 			dosavessthresh = (i < rt->rt_rmx.rmx_sendpipe / 2);
 		else
 			dosavessthresh = (i < so->so_snd.sb_hiwat / 2);
-		if (((rt->rt_rmx.rmx_locks & RTV_SSTHRESH) == 0 &&
+		if (converged &&
+		    (((rt->rt_rmx.rmx_locks & RTV_SSTHRESH) == 0 &&
 		    i != 0 && rt->rt_rmx.rmx_ssthresh != 0) ||
-		    dosavessthresh) {
+		    dosavessthresh)) {
 			/*
 			 * convert the limit from user data bytes to
 			 * packets then to packet data bytes.
@@ -115,8 +115,11 @@
  */
 #define	TCP_SLEEP_TOO_LONG	(10 * 60 * 1000) /* 10 minutes in ms */
 
-/* tcp timer list */
-struct tcptimerlist tcp_timer_list;
+/*
+ * tcp timer lists: each connection stays on the list picked when its
+ * tcpcb was created, and each list runs from its own thread call.
+ */
+struct tcptimerlist tcp_timer_lists[TCP_TIMERLIST_NSHARDS];
 
 /* List of pcbs in timewait state, protected by tcbinfo's ipi_lock */
 struct tcptailq tcp_tw_tailq;
@@ -293,7 +296,7 @@ int	tcp_jack_rxmt = TCP_RETRANSHZ / 2;
 static boolean_t tcp_itimer_done = FALSE;
 
 static void tcp_remove_timer(struct tcpcb *tp);
-static void tcp_sched_timerlist(uint32_t offset);
+static void tcp_sched_timerlist(struct tcptimerlist *listp, uint32_t offset);
 static u_int32_t tcp_run_conn_timer(struct tcpcb *tp, u_int16_t *mode,
     u_int16_t probe_if_index);
 static void tcp_sched_timers(struct tcpcb *tp);
@@ -382,6 +385,9 @@ struct tcp_last_report_stats {
 /* Returns true if the timer is on the timer list */
 #define TIMER_IS_ON_LIST(tp) ((tp)->t_flags & TF_TIMER_ONLIST)
 
+/* Timer list of a connection */
+#define TIMER_LIST(tp) (&tcp_timer_lists[(tp)->tentry.list])
+
 /* Run the TCP timerlist atleast once every hour */
 #define TCP_TIMERLIST_MAX_OFFSET (60 * 60 * TCP_RETRANSHZ)
 
@@ -1450,6 +1456,14 @@ fc_output:
 		}
 		break;
 
+	/*
+	 * Pacing timer: send what the refilled pacing budget allows.
+	 */
+	case TCPT_PACE:
+		if (tp->t_state >= TCPS_ESTABLISHED && tp->t_pacing_rate != 0)
+			(void) tcp_output(tp);
+		break;
+
 #if MPTCP
 	case TCPT_JACK_RXMT:
 		if ((tp->t_state == TCPS_ESTABLISHED) &&
@@ -1588,7 +1602,7 @@ fc_output:
 void
 tcp_remove_timer(struct tcpcb *tp)
 {
-	struct tcptimerlist *listp = &tcp_timer_list;
+	struct tcptimerlist *listp = TIMER_LIST(tp);
 
 	socket_lock_assert_owned(tp->t_inpcb->inp_socket);
 	if (!(TIMER_IS_ON_LIST(tp))) {
@@ -1622,9 +1636,9 @@ tcp_remove_timer(struct tcpcb *tp)
  */
 
 static boolean_t
-need_to_resched_timerlist(u_int32_t runtime, u_int16_t mode)
+need_to_resched_timerlist(struct tcptimerlist *listp, u_int32_t runtime,
+    u_int16_t mode)
 {
-	struct tcptimerlist *listp = &tcp_timer_list;
 	int32_t diff;
 
 	/*
@@ -1658,10 +1672,9 @@ need_to_resched_timerlist(u_int32_t runtime, u_int16_t mode)
 }
 
 void
-tcp_sched_timerlist(uint32_t offset)
+tcp_sched_timerlist(struct tcptimerlist *listp, uint32_t offset)
 {
 	uint64_t deadline = 0;
-	struct tcptimerlist *listp = &tcp_timer_list;
 
 	LCK_MTX_ASSERT(listp->mtx, LCK_MTX_ASSERT_OWNED);
 
@@ -1826,15 +1839,17 @@ done:
 void
 tcp_run_timerlist(void * arg1, void * arg2)
 {
-#pragma unused(arg1, arg2)
+#pragma unused(arg2)
 	struct tcptimerentry *te, *next_te;
-	struct tcptimerlist *listp = &tcp_timer_list;
+	struct tcptimerlist *listp = arg1;
 	struct tcpcb *tp;
 	uint32_t next_timer = 0; /* offset of the next timer on the list */
 	u_int16_t te_mode = 0;	/* modes of all active timers in a tcpcb */
 	u_int16_t list_mode = 0; /* cumulative of modes of all tcpcbs */
 	uint32_t active_count = 0;
+	uint64_t start_time, run_nsecs;
 
+	start_time = mach_absolute_time();
 	calculate_tcp_clock();
 
 	lck_mtx_lock(listp->mtx);
@@ -1969,13 +1984,13 @@ tcp_run_timerlist(void * arg1, void * arg2)
 			next_timer = max(next_timer,
 				TCP_TIMER_500MS_QUANTUM);
 
-		tcp_sched_timerlist(next_timer);
+		tcp_sched_timerlist(listp, next_timer);
 	} else {
 		/*
 		 * No need to reschedule this timer, but always run
 		 * periodically at a much higher granularity.
 		 */
-		tcp_sched_timerlist(TCP_TIMERLIST_MAX_OFFSET);
+		tcp_sched_timerlist(listp, TCP_TIMERLIST_MAX_OFFSET);
 	}
 
 	listp->running = FALSE;
@@ -1983,6 +1998,12 @@ tcp_run_timerlist(void * arg1, void * arg2)
 	listp->pref_offset = 0;
 	listp->probe_if_index = 0;
 
+	absolutetime_to_nanoseconds(mach_absolute_time() - start_time,
+	    &run_nsecs);
+	tcpstat.tcps_timer_list_runs[listp->index]++;
+	tcpstat.tcps_timer_list_run_usecs[listp->index] +=
+	    run_nsecs / NSEC_PER_USEC;
+
 	lck_mtx_unlock(listp->mtx);
 }
 
@@ -1996,7 +2017,7 @@ tcp_sched_timers(struct tcpcb *tp)
 	struct tcptimerentry *te = &tp->tentry;
 	u_int16_t index = te->index;
 	u_int16_t mode = te->mode;
-	struct tcptimerlist *listp = &tcp_timer_list;
+	struct tcptimerlist *listp = TIMER_LIST(tp);
 	int32_t offset = 0;
 	boolean_t list_locked = FALSE;
 
@@ -2048,7 +2069,7 @@ tcp_sched_timers(struct tcpcb *tp)
 	 * Timer entry is currently on the list, check if the list needs
 	 * to be rescheduled.
 	 */
-	if (need_to_resched_timerlist(te->runtime, mode)) {
+	if (need_to_resched_timerlist(listp, te->runtime, mode)) {
 		tcp_resched_timerlist++;
 
 		if (!list_locked) {
@@ -2101,7 +2122,7 @@ schedule:
 		listp->idleruns = 0;
 		offset = min(offset, TCP_TIMER_100MS_QUANTUM);
 	}
-	tcp_sched_timerlist(offset);
+	tcp_sched_timerlist(listp, offset);
 
 done:
 	if (list_locked)
@@ -2405,14 +2426,10 @@ tcp_report_stats(void)
 #undef	stat
 }
 
-void
-tcp_interface_send_probe(u_int16_t probe_if_index)
+static void
+tcp_timerlist_send_probe(struct tcptimerlist *listp, u_int16_t probe_if_index)
 {
 	int32_t offset = 0;
-	struct tcptimerlist *listp = &tcp_timer_list;
-
-	/* Make sure TCP clock is up to date */
-	calculate_tcp_clock();
 
 	lck_mtx_lock(listp->mtx);
 	if (listp->probe_if_index > 0) {
@@ -2440,11 +2457,22 @@ tcp_interface_send_probe(u_int16_t probe_if_index)
 	listp->mode = TCP_TIMERLIST_10MS_MODE;
 	listp->idleruns = 0;
 
-	tcp_sched_timerlist(offset);
+	tcp_sched_timerlist(listp, offset);
 
 done:
 	lck_mtx_unlock(listp->mtx);
-	return;
+}
+
+void
+tcp_interface_send_probe(u_int16_t probe_if_index)
+{
+	int i;
+
+	/* Make sure TCP clock is up to date */
+	calculate_tcp_clock();
+
+	for (i = 0; i < TCP_TIMERLIST_NSHARDS; i++)
+		tcp_timerlist_send_probe(&tcp_timer_lists[i], probe_if_index);
 }
 
 /*
@@ -2511,8 +2539,9 @@ void
 tcp_probe_connectivity(struct ifnet *ifp, u_int32_t enable)
 {
 	int32_t offset;
-	struct tcptimerlist *listp = &tcp_timer_list;
+	struct tcptimerlist *listp;
 	struct inpcbinfo *pcbinfo = &tcbinfo;
+	int i;
 	struct inpcb *inp, *nxt;
 
 	if (ifp == NULL)
@@ -2552,29 +2581,32 @@ tcp_probe_connectivity(struct ifnet *ifp, u_int32_t enable)
 	}
 	lck_rw_done(pcbinfo->ipi_lock);
 
-	lck_mtx_lock(listp->mtx);
-	if (listp->running) {
-		listp->pref_mode |= TCP_TIMERLIST_10MS_MODE;
-		goto done;
-	}
+	for (i = 0; i < TCP_TIMERLIST_NSHARDS; i++) {
+		listp = &tcp_timer_lists[i];
 
-	/* Reschedule within the next 10ms */
-	offset = TCP_TIMER_10MS_QUANTUM;
-	if (listp->scheduled) {
-		int32_t diff;
-		diff = timer_diff(listp->runtime, 0, tcp_now, offset);
-		if (diff <= 0) {
-			/* The timer will fire sooner than what's needed */
-			goto done;
+		lck_mtx_lock(listp->mtx);
+		if (listp->running) {
+			listp->pref_mode |= TCP_TIMERLIST_10MS_MODE;
+			goto next;
 		}
-	}
-	listp->mode = TCP_TIMERLIST_10MS_MODE;
-	listp->idleruns = 0;
 
-	tcp_sched_timerlist(offset);
-done:
-	lck_mtx_unlock(listp->mtx);
-	return;
+		/* Reschedule within the next 10ms */
+		offset = TCP_TIMER_10MS_QUANTUM;
+		if (listp->scheduled) {
+			int32_t diff;
+			diff = timer_diff(listp->runtime, 0, tcp_now, offset);
+			if (diff <= 0) {
+				/* The timer will fire sooner than what's needed */
+				goto next;
+			}
+		}
+		listp->mode = TCP_TIMERLIST_10MS_MODE;
+		listp->idleruns = 0;
+
+		tcp_sched_timerlist(listp, offset);
+next:
+		lck_mtx_unlock(listp->mtx);
+	}
 }
 
 inline void
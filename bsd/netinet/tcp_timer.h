@@ -72,6 +72,9 @@
 /* Keep the external definition the same for binary compatibility */
 #define TCPT_NTIMERS_EXT	4
 
+/* Number of TCP timer lists, connections are spread across them */
+#define TCP_TIMERLIST_NSHARDS	8
+
 /*
  * Definitions of the TCP timers.
  *
@@ -81,6 +84,10 @@
  * timeout will send the last unacknowledged segment to generate more acks
  * with SACK information which can be used for fast-retransmiting the lost
  * packets. This will fire in the order of 10ms.
+ *
+ * The TCPT_PACE timer is used by congestion control algorithms that pace
+ * their transmissions. When the pacing budget of a connection is used up,
+ * it is set to when the budget allows the next segment to go out.
  * 
  * The TCPT_REXMT timer is used to force retransmissions.
  * The TCP has the TCPT_REXMT timer set whenever segments
@@ -127,16 +134,17 @@
 
 #define	TCPT_PTO	0	/* Probe timeout */
 #define	TCPT_DELAYFR	1	/* Delay recovery if there is reordering */
-#define	TCPT_REXMT	2	/* retransmit */
-#define	TCPT_DELACK	3	/* delayed ack */
-#define	TCPT_PERSIST	4	/* retransmit persistence */
-#define	TCPT_KEEP	5	/* keep alive */
-#define	TCPT_2MSL	6	/* 2*msl quiet time timer */
+#define	TCPT_PACE	2	/* resume sending after pacing */
+#define	TCPT_REXMT	3	/* retransmit */
+#define	TCPT_DELACK	4	/* delayed ack */
+#define	TCPT_PERSIST	5	/* retransmit persistence */
+#define	TCPT_KEEP	6	/* keep alive */
+#define	TCPT_2MSL	7	/* 2*msl quiet time timer */
 #if MPTCP
-#define TCPT_JACK_RXMT	7	/* retransmit timer for join ack */
-#define TCPT_MAX	7
+#define TCPT_JACK_RXMT	8	/* retransmit timer for join ack */
+#define TCPT_MAX	8
 #else /* MPTCP */
-#define	TCPT_MAX	6
+#define	TCPT_MAX	7
 #endif /* !MPTCP */
 
 #define	TCPT_NONE	(TCPT_MAX + 1)	
@@ -224,7 +232,8 @@ static char *tcptimers[] =
  * Rexmt and delayed ack timers are considered as fast timers which run 
  * in the order of 100ms.
  *
- * Probe timeout is a quick timer which will run in the order of 10ms.
+ * Probe timeout and pacing are quick timers which will run in the order
+ * of 10ms.
  */
 #define	IS_TIMER_HZ_500MS(i)	((i) >= TCPT_PERSIST)
 #define	IS_TIMER_HZ_100MS(i)	((i) >= TCPT_REXMT && (i) < TCPT_PERSIST) 
@@ -238,6 +247,7 @@ struct tcptimerentry {
 	uint16_t index;		/* index of lowest timer that needs to run first */
 	uint16_t mode;		/* Bit-wise OR of timers that are active */
 	uint32_t runtime;	/* deadline at which the first timer has to fire */
+	uint16_t list;		/* index of the timer list this entry goes on */
 };
 
 LIST_HEAD(timerlisthead, tcptimerentry);
@@ -266,6 +276,7 @@ struct tcptimerlist {
 	uint32_t idleruns;	/* Number of times the list has been idle in fast mode */
 	struct tcptimerentry *next_te;	/* next timer entry pointer to process */
 	u_int16_t probe_if_index; /* Interface index that needs to send probes */
+	u_int16_t index;	/* index of this list in tcp_timer_lists */
 
 };
 
@@ -1642,6 +1642,11 @@ tcp_fill_info(struct tcpcb *tp, struct tcp_info *ti)
 		ti->tcpi_reordered_pkts = tp->t_reordered_pkts;
 		ti->tcpi_dsack_sent = tp->t_dsack_sent;
 		ti->tcpi_dsack_recvd = tp->t_dsack_recvd;
+
+		ti->tcpi_snd_sbhiwat = inp->inp_socket->so_snd.sb_hiwat;
+		ti->tcpi_snd_sbideal = inp->inp_socket->so_snd.sb_idealsize;
+		ti->tcpi_rcv_sbhiwat = inp->inp_socket->so_rcv.sb_hiwat;
+		ti->tcpi_rcv_sbideal = inp->inp_socket->so_rcv.sb_idealsize;
 	}
 }
 
@@ -2398,6 +2403,25 @@ tcp_ctloutput(struct socket *so, struct sockopt *sopt)
 				tp->t_rxt_minimum_timeout *= TCP_RETRANSHZ;
 			}
 			break;
+		case TCP_CONGESTION_ALGO: {
+			char name[TCP_CA_NAME_MAX];
+			int cc_index;
+
+			bzero(name, sizeof(name));
+			error = sooptcopyin(sopt, name, sizeof(name) - 1, 1);
+			if (error)
+				break;
+			cc_index = tcp_cc_lookup(name);
+			if (cc_index == TCP_CC_ALGO_NONE) {
+				error = ENOENT;
+				break;
+			}
+			tp->t_cc_user_index = cc_index;
+			/* a background socket switches when it goes foreground */
+			if (tp->tcp_cc_index != TCP_CC_ALGO_BACKGROUND_INDEX)
+				tcp_set_new_cc(so, cc_index);
+			break;
+		}
 		default:
 			error = ENOPROTOOPT;
 			break;
@@ -2568,6 +2592,13 @@ tcp_ctloutput(struct socket *so, struct sockopt *sopt)
 		case TCP_RXT_MINIMUM_TIMEOUT:
 			optval = tp->t_rxt_minimum_timeout / TCP_RETRANSHZ;
 			break;
+		case TCP_CONGESTION_ALGO: {
+			char name[TCP_CA_NAME_MAX];
+
+			strlcpy(name, CC_ALGO(tp)->name, sizeof(name));
+			error = sooptcopyout(sopt, name, strlen(name) + 1);
+			goto done;
+		}
 		default:
 			error = ENOPROTOOPT;
 			break;
@@ -242,6 +242,47 @@ struct tcp_ccstate {
 #define cub_target_win __u__._cubic_state_.tc_target_win
 #define cub_avg_lastmax __u__._cubic_state_.tc_avg_lastmax
 #define cub_mean_dev __u__._cubic_state_.tc_mean_deviation
+		struct tcp_bbr_state {
+#define	TCP_BBR_BW_ROUNDS	10
+			u_int32_t tb_bw[TCP_BBR_BW_ROUNDS]; /* delivery rate per round */
+			u_int32_t tb_max_bw;	/* max of tb_bw, bytes per second */
+			u_int32_t tb_full_bw;	/* bw at last growth check in startup */
+			u_int32_t tb_min_rtt;	/* min rtt in ms */
+			u_int32_t tb_min_rtt_ts; /* TS of the min rtt sample */
+			u_int32_t tb_rttupdated; /* t_rttupdated at last sample */
+			u_int32_t tb_round;	/* count of round trips */
+			tcp_seq   tb_round_end;	/* ack that ends the current round */
+			tcp_seq   tb_round_una;	/* snd_una at start of the round */
+			u_int32_t tb_round_ts;	/* TS at start of the round */
+			u_int32_t tb_cycle_ts;	/* TS at start of the gain cycle phase */
+			u_int32_t tb_probe_rtt_done; /* TS to leave probe rtt */
+			u_int32_t tb_prior_cwnd; /* cwnd before recovery or probe rtt */
+			u_int16_t tb_pacing_gain; /* in units of 1/256 */
+			u_int16_t tb_cwnd_gain;	/* in units of 1/256 */
+			u_int8_t  tb_mode;	/* startup, drain, probe bw or probe rtt */
+			u_int8_t  tb_cycle_idx;	/* phase of the probe bw gain cycle */
+			u_int8_t  tb_full_bw_cnt; /* rounds without bw growth */
+			u_int8_t  tb_app_limited; /* round was limited by the sender */
+		} _bbr_state_;
+#define bbr_bw __u__._bbr_state_.tb_bw
+#define bbr_max_bw __u__._bbr_state_.tb_max_bw
+#define bbr_full_bw __u__._bbr_state_.tb_full_bw
+#define bbr_min_rtt __u__._bbr_state_.tb_min_rtt
+#define bbr_min_rtt_ts __u__._bbr_state_.tb_min_rtt_ts
+#define bbr_rttupdated __u__._bbr_state_.tb_rttupdated
+#define bbr_round __u__._bbr_state_.tb_round
+#define bbr_round_end __u__._bbr_state_.tb_round_end
+#define bbr_round_una __u__._bbr_state_.tb_round_una
+#define bbr_round_ts __u__._bbr_state_.tb_round_ts
+#define bbr_cycle_ts __u__._bbr_state_.tb_cycle_ts
+#define bbr_probe_rtt_done __u__._bbr_state_.tb_probe_rtt_done
+#define bbr_prior_cwnd __u__._bbr_state_.tb_prior_cwnd
+#define bbr_pacing_gain __u__._bbr_state_.tb_pacing_gain
+#define bbr_cwnd_gain __u__._bbr_state_.tb_cwnd_gain
+#define bbr_mode __u__._bbr_state_.tb_mode
+#define bbr_cycle_idx __u__._bbr_state_.tb_cycle_idx
+#define bbr_full_bw_cnt __u__._bbr_state_.tb_full_bw_cnt
+#define bbr_app_limited __u__._bbr_state_.tb_app_limited
 	} __u__;
 };
 
@@ -288,7 +329,7 @@ struct tcpcb {
 #define	TF_CLOSING	0x8000000	/* pending tcp close */
 #define TF_TSO		0x10000000	/* TCP Segment Offloading is enable on this connection */
 #define TF_BLACKHOLE	0x20000000	/* Path MTU Discovery Black Hole detection */
-#define TF_TIMER_ONLIST 0x40000000	/* pcb is on tcp_timer_list */
+#define TF_TIMER_ONLIST 0x40000000	/* pcb is on a tcp_timer_lists list */
 #define TF_STRETCHACK	0x80000000	/* receiver is going to delay acks */
 
 	tcp_seq	snd_una;		/* send unacknowledged */
@@ -354,6 +395,7 @@ struct tcpcb {
 	u_int8_t	request_r_scale; /* pending window scaling */
 	u_int8_t	requested_s_scale;
 	u_int8_t	tcp_cc_index;	/* index of congestion control algorithm */
+	u_int8_t	t_cc_user_index; /* algorithm chosen with TCP_CONGESTION_ALGO */
 	u_int8_t	t_adaptive_rtimo;	/* Read timeout used as a multiple of RTT */
 	u_int8_t	t_adaptive_wtimo;	/* Write timeout used as a multiple of RTT */
 	u_int8_t	t_stretchack_delayed;	/* stretch ack delayed */
@@ -501,6 +543,11 @@ struct tcpcb {
 	tcp_seq		t_idleat;		/* rcv_nxt at idle time */
 	TAILQ_ENTRY(tcpcb) t_twentry;		/* link for time wait queue */
 	struct tcp_ccstate	*t_ccstate;	/* congestion control related state */
+/* Pacing state, the rate is set by the congestion control algorithm */
+	u_int32_t	t_pacing_rate;		/* bytes per second, 0 when not paced */
+	u_int32_t	t_pacing_tokens;	/* bytes that can be sent right away */
+	u_int32_t	t_pacing_ts;		/* tcp_now at the last refill */
+	u_int64_t	t_pacing_next;		/* departure time of the next segment */
 /* Tail loss probe related state */
 	tcp_seq		t_tlphighrxt;		/* snd_nxt after PTO */
 	u_int32_t	t_tlpstart;		/* timestamp at PTO */
@@ -720,6 +767,12 @@ extern int tcprexmtthresh;
 	mptcp_reset_rexmit_state((_tp_)); \
 } while(0);
 
+/*
+ * Upper bound for the default autotuning socket buffer limits, kept well
+ * within what sbreserve() allows under the default sb_max.
+ */
+#define	TCP_AUTOSB_MAX	(4 * 1024 * 1024)
+
 #define	TCP_AUTORCVBUF_MAX(_ifp_) (((_ifp_) != NULL && (IFNET_IS_CELLULAR((_ifp_))) && ((_ifp_)->if_eflags & IFEF_3CA)) ? \
 		(tcp_autorcvbuf_max << 1) : tcp_autorcvbuf_max)
 
@@ -1207,6 +1260,10 @@ struct	tcpstat {
 	u_int32_t	tcps_mptcp_wifi_proxy;		/* Total number of new subflows that fell back to regular TCP on cell */
 	u_int32_t	tcps_mptcp_cell_proxy;		/* Total number of new subflows that fell back to regular TCP on WiFi */
 	u_int32_t	tcps_mptcp_triggered_cell;	/* Total number of times an MPTCP-connection triggered cell bringup */
+
+	/* TCP timer list statistics, per timer list */
+	u_int32_t	tcps_timer_list_runs[TCP_TIMERLIST_NSHARDS];	/* Number of runs of the timer list */
+	u_int64_t	tcps_timer_list_run_usecs[TCP_TIMERLIST_NSHARDS]; /* Time spent running the timer list */
 };
 
 
@@ -1534,6 +1591,7 @@ extern int tcp_do_rfc3465;
 extern int tcp_do_rfc3465_lim2;
 extern int maxseg_unacked;
 extern int tcp_use_newreno;
+extern int tcp_use_bbr;
 extern struct zone *tcp_reass_zone;
 extern struct zone *tcp_rxt_seg_zone;
 extern int tcp_ecn_outbound;
@@ -1616,6 +1674,7 @@ extern int32_t timer_diff(uint32_t t1, uint32_t toff1, uint32_t t2, uint32_t tof
 
 extern void tcp_set_background_cc(struct socket *);
 extern void tcp_set_foreground_cc(struct socket *);
+extern void tcp_set_new_cc(struct socket *, uint16_t);
 extern void tcp_set_recv_bg(struct socket *);
 extern void tcp_clear_recv_bg(struct socket *);
 extern boolean_t tcp_sack_byte_islost(struct tcpcb *tp);
@@ -242,9 +242,11 @@ struct pr_usrreqs udp_usrreqs = {
 	.pru_disconnectx =	udp_disconnectx,
 	.pru_peeraddr =		in_getpeeraddr,
 	.pru_send =		udp_send,
+	.pru_send_list =	udp_send_list,
 	.pru_shutdown =		udp_shutdown,
 	.pru_sockaddr =		in_getsockaddr,
 	.pru_sosend =		sosend,
+	.pru_sosend_list =	sosend_list,
 	.pru_soreceive =	soreceive,
 	.pru_soreceive_list =	soreceive_list,
 };
@@ -2341,6 +2343,37 @@ udp_send(struct socket *so, int flags, struct mbuf *m,
 	return (udp_output(inp, m, addr, control, p));
 }
 
+/*
+ * Send a list of datagrams, linked by m_nextpkt, on a connected socket
+ * for sosend_list().  Shared with UDP over IPv6, each datagram goes
+ * through the socket's pru_send.
+ */
+int
+udp_send_list(struct socket *so, int flags, struct mbuf *m,
+    struct sockaddr *addr, struct mbuf *control, struct proc *p)
+{
+	struct mbuf *nextpkt;
+	int error = 0;
+
+	if (addr != NULL || control != NULL) {
+		if (control != NULL)
+			m_freem(control);
+		error = EINVAL;
+	}
+
+	while (m != NULL && error == 0) {
+		nextpkt = m->m_nextpkt;
+		m->m_nextpkt = NULL;
+		error = (*so->so_proto->pr_usrreqs->pru_send)(so, flags, m,
+		    NULL, NULL, p);
+		m = nextpkt;
+	}
+	if (m != NULL)
+		m_freem_list(m);
+
+	return (error);
+}
+
 int
 udp_shutdown(struct socket *so)
 {
@@ -172,6 +172,8 @@ extern int udp_connectx_common(struct socket *, int, struct sockaddr *,
     sae_connid_t *, uint32_t, void *, uint32_t, struct uio*, user_ssize_t *);
 extern void udp_notify(struct inpcb *inp, int errno);
 extern int udp_shutdown(struct socket *so);
+extern int udp_send_list(struct socket *, int, struct mbuf *,
+    struct sockaddr *, struct mbuf *, struct proc *);
 extern int udp_lock(struct socket *, int, void *);
 extern int udp_unlock(struct socket *, int, void *);
 extern lck_mtx_t *udp_getlock(struct socket *, int);
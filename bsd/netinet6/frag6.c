@@ -123,7 +123,14 @@ static lck_grp_t	*ip6qlock_grp;
 static lck_grp_attr_t	*ip6qlock_grp_attr;
 
 /* IPv6 fragment reassembly queues (protected by ip6qlock) */
-static struct ip6q ip6q;		/* ip6 reassembly queues */
+#define	IP6REASS_NHASH_LOG2	6
+#define	IP6REASS_NHASH		(1 << IP6REASS_NHASH_LOG2)
+#define	IP6REASS_HMASK		(IP6REASS_NHASH - 1)
+#define	IP6REASS_HASH(src, id) \
+	((((src)->s6_addr32[3] ^ ((src)->s6_addr32[3] >> 16)) ^ \
+	((id) ^ ((id) >> 16))) & IP6REASS_HMASK)
+
+static struct ip6q ip6q[IP6REASS_NHASH];	/* ip6 reassembly queues */
 static int ip6_maxfragpackets;		/* max packets in reass queues */
 static u_int32_t frag6_nfragpackets;	/* # of packets in reass queues */
 static int ip6_maxfrags;		/* max fragments in reass queues */
@@ -157,6 +164,8 @@ SYSCTL_PROC(_net_inet6_ip6, IPV6CTL_MAXFRAGS, maxfrags,
 void
 frag6_init(void)
 {
+	int i;
+
 	/* ip6q_alloc() uses mbufs for IPv6 fragment queue structures */
 	_CASSERT(sizeof (struct ip6q) <= _MLEN);
 	/* ip6af_alloc() uses mbufs for IPv6 fragment queue structures */
@@ -169,8 +178,9 @@ frag6_init(void)
 	lck_mtx_init(&ip6qlock, ip6qlock_grp, ip6qlock_attr);
 
 	lck_mtx_lock(&ip6qlock);
-	/* Initialize IPv6 reassembly queue. */
-	ip6q.ip6q_next = ip6q.ip6q_prev = &ip6q;
+	/* Initialize IPv6 reassembly queues. */
+	for (i = 0; i < IP6REASS_NHASH; i++)
+		ip6q[i].ip6q_next = ip6q[i].ip6q_prev = &ip6q[i];
 
 	/* same limits as IPv4 */
 	ip6_maxfragpackets = nmbclusters / 32;
@@ -280,7 +290,7 @@ frag6_input(struct mbuf **mp, int *offp, int proto)
 	struct mbuf *m = *mp, *t;
 	struct ip6_hdr *ip6;
 	struct ip6_frag *ip6f;
-	struct ip6q *q6;
+	struct ip6q *q6, *head;
 	struct ip6asfrag *af6, *ip6af, *af6dwn;
 	int offset = *offp, nxt, i, next;
 	int first_frag = 0;
@@ -450,13 +460,14 @@ frag6_input(struct mbuf **mp, int *offp, int proto)
 	lck_mtx_lock(&ip6qlock);
 	locked = 1;
 
-	for (q6 = ip6q.ip6q_next; q6 != &ip6q; q6 = q6->ip6q_next)
+	head = &ip6q[IP6REASS_HASH(&ip6->ip6_src, ip6f->ip6f_ident)];
+	for (q6 = head->ip6q_next; q6 != head; q6 = q6->ip6q_next)
 		if (ip6f->ip6f_ident == q6->ip6q_ident &&
 		    IN6_ARE_ADDR_EQUAL(&ip6->ip6_src, &q6->ip6q_src) &&
 		    IN6_ARE_ADDR_EQUAL(&ip6->ip6_dst, &q6->ip6q_dst))
 			break;
 
-	if (q6 == &ip6q) {
+	if (q6 == head) {
 		/*
 		 * the first fragment to arrive, create a reassembly queue.
 		 */
@@ -466,7 +477,7 @@ frag6_input(struct mbuf **mp, int *offp, int proto)
 		if (q6 == NULL)
 			goto dropfrag;
 
-		frag6_insque(q6, &ip6q);
+		frag6_insque(q6, head);
 		frag6_nfragpackets++;
 
 		/* ip6q_nxt will be filled afterwards, from 1st fragment */
@@ -712,9 +723,9 @@ insert:
 	frag6_nfrags++;
 	q6->ip6q_nfrag++;
 #if 0 /* xxx */
-	if (q6 != ip6q.ip6q_next) {
+	if (q6 != head->ip6q_next) {
 		frag6_remque(q6);
-		frag6_insque(q6, &ip6q);
+		frag6_insque(q6, head);
 	}
 #endif
 	next = 0;
@@ -982,6 +993,7 @@ frag6_timeout(void *arg)
 #pragma unused(arg)
 	struct fq6_head dfq6, diq6;
 	struct ip6q *q6;
+	int i;
 
 	MBUFQ_INIT(&dfq6);	/* for deferred frees */
 	MBUFQ_INIT(&diq6);	/* for deferred ICMP time exceeded errors */
@@ -994,9 +1006,9 @@ frag6_timeout(void *arg)
 	net_update_uptime();
 
 	lck_mtx_lock(&ip6qlock);
-	q6 = ip6q.ip6q_next;
-	if (q6)
-		while (q6 != &ip6q) {
+	for (i = 0; i < IP6REASS_NHASH; i++) {
+		q6 = ip6q[i].ip6q_next;
+		while (q6 != &ip6q[i]) {
 			--q6->ip6q_ttl;
 			q6 = q6->ip6q_next;
 			if (q6->ip6q_prev->ip6q_ttl == 0) {
@@ -1005,17 +1017,21 @@ frag6_timeout(void *arg)
 				frag6_freef(q6->ip6q_prev, &dfq6, &diq6);
 			}
 		}
+	}
 	/*
 	 * If we are over the maximum number of fragments
 	 * (due to the limit being lowered), drain off
-	 * enough to get down to the new limit.
+	 * enough to get down to the new limit, oldest
+	 * first within each queue.
 	 */
 	if (ip6_maxfragpackets >= 0) {
-		while (frag6_nfragpackets > (unsigned)ip6_maxfragpackets &&
-		    ip6q.ip6q_prev) {
-			ip6stat.ip6s_fragoverflow++;
-			/* XXX in6_ifstat_inc(ifp, ifs6_reass_fail) */
-			frag6_freef(ip6q.ip6q_prev, &dfq6, &diq6);
+		for (i = 0; i < IP6REASS_NHASH; i++) {
+			while (frag6_nfragpackets > (unsigned)ip6_maxfragpackets &&
+			    ip6q[i].ip6q_prev != &ip6q[i]) {
+				ip6stat.ip6s_fragoverflow++;
+				/* XXX in6_ifstat_inc(ifp, ifs6_reass_fail) */
+				frag6_freef(ip6q[i].ip6q_prev, &dfq6, &diq6);
+			}
 		}
 	}
 	/* re-arm the purge timer if there's work to do */
@@ -1051,15 +1067,18 @@ void
 frag6_drain(void)
 {
 	struct fq6_head dfq6, diq6;
+	int i;
 
 	MBUFQ_INIT(&dfq6);	/* for deferred frees */
 	MBUFQ_INIT(&diq6);	/* for deferred ICMP time exceeded errors */
 
 	lck_mtx_lock(&ip6qlock);
-	while (ip6q.ip6q_next != &ip6q) {
-		ip6stat.ip6s_fragdropped++;
-		/* XXX in6_ifstat_inc(ifp, ifs6_reass_fail) */
-		frag6_freef(ip6q.ip6q_next, &dfq6, &diq6);
+	for (i = 0; i < IP6REASS_NHASH; i++) {
+		while (ip6q[i].ip6q_next != &ip6q[i]) {
+			ip6stat.ip6s_fragdropped++;
+			/* XXX in6_ifstat_inc(ifp, ifs6_reass_fail) */
+			frag6_freef(ip6q[i].ip6q_next, &dfq6, &diq6);
+		}
 	}
 	lck_mtx_unlock(&ip6qlock);
 
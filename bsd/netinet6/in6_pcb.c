@@ -1240,8 +1240,12 @@ in6_pcblookup_hash(struct inpcbinfo *pcbinfo, struct in6_addr *faddr,
 		}
 	}
 	if (wildcard) {
+		struct inpcb *local_exact = NULL;
 		struct inpcb *local_wild = NULL;
+		u_int32_t lb_hash;
 
+		lb_hash = inp_reuseport_lb_hash(AF_INET6, faddr, fport,
+		    laddr, lport);
 		head = &pcbinfo->ipi_hashbase[INP_PCBHASH(INADDR_ANY, lport, 0,
 		    pcbinfo->ipi_hashmask)];
 		LIST_FOREACH(inp, head, inp_hash) {
@@ -1255,6 +1259,12 @@ in6_pcblookup_hash(struct inpcbinfo *pcbinfo, struct in6_addr *faddr,
 			    inp->inp_lport == lport) {
 				if (IN6_ARE_ADDR_EQUAL(&inp->in6p_laddr,
 				    laddr)) {
+					if (inp_reuseport_lb_member(inp)) {
+						local_exact =
+						    inp_reuseport_lb_select(
+						    local_exact, inp, lb_hash);
+						continue;
+					}
 					if (in_pcb_checkstate(inp, WNT_ACQUIRE,
 					    0) != WNT_STOPUSING) {
 						lck_rw_done(pcbinfo->ipi_lock);
@@ -1266,10 +1276,13 @@ in6_pcblookup_hash(struct inpcbinfo *pcbinfo, struct in6_addr *faddr,
 					}
 				} else if (IN6_IS_ADDR_UNSPECIFIED(
 				    &inp->in6p_laddr)) {
-					local_wild = inp;
+					local_wild = inp_reuseport_lb_select(
+					    local_wild, inp, lb_hash);
 				}
 			}
 		}
+		if (local_exact != NULL)
+			local_wild = local_exact;
 		if (local_wild && in_pcb_checkstate(local_wild,
 		    WNT_ACQUIRE, 0) != WNT_STOPUSING) {
 			lck_rw_done(pcbinfo->ipi_lock);
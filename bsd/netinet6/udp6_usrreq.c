@@ -181,9 +181,11 @@ struct pr_usrreqs udp6_usrreqs = {
 	.pru_disconnectx =	udp6_disconnectx,
 	.pru_peeraddr =		in6_mapped_peeraddr,
 	.pru_send =		udp6_send,
+	.pru_send_list =	udp_send_list,
 	.pru_shutdown =		udp_shutdown,
 	.pru_sockaddr =		in6_mapped_sockaddr,
 	.pru_sosend =		sosend,
+	.pru_sosend_list =	sosend_list,
 	.pru_soreceive =	soreceive,
 	.pru_soreceive_list =	soreceive_list,
 };
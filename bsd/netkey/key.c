@@ -1315,6 +1315,35 @@ key_allocsa_extended(u_int family,
 	 * search a valid state list for inbound packet.
 	 * the search order is not important.
 	 */
+	/*
+	 * build the destination to compare SAs against once, outside
+	 * of sadb_mutex, rather than for every candidate.
+	 */
+	switch (family) {
+		case AF_INET:
+			bzero(&sin, sizeof(sin));
+			sin.sin_family = AF_INET;
+			sin.sin_len = sizeof(sin);
+			bcopy(dst, &sin.sin_addr,
+				  sizeof(sin.sin_addr));
+			break;
+		case AF_INET6:
+			bzero(&sin6, sizeof(sin6));
+			sin6.sin6_family = AF_INET6;
+			sin6.sin6_len = sizeof(sin6);
+			bcopy(dst, &sin6.sin6_addr,
+				  sizeof(sin6.sin6_addr));
+			if (IN6_IS_SCOPE_LINKLOCAL(&sin6.sin6_addr)) {
+				/* kame fake scopeid */
+				sin6.sin6_scope_id =
+				ntohs(sin6.sin6_addr.s6_addr16[1]);
+				sin6.sin6_addr.s6_addr16[1] = 0;
+			}
+			break;
+		default:
+			break;
+	}
+
 	match = NULL;
 	matchidx = arraysize;
 	lck_mtx_lock(sadb_mutex);
@@ -1381,28 +1410,12 @@ key_allocsa_extended(u_int family,
 		/* check dst address */
 		switch (family) {
 			case AF_INET:
-				bzero(&sin, sizeof(sin));
-				sin.sin_family = AF_INET;
-				sin.sin_len = sizeof(sin);
-				bcopy(dst, &sin.sin_addr,
-					  sizeof(sin.sin_addr));
 				if (key_sockaddrcmp((struct sockaddr*)&sin,
 									(struct sockaddr *)&sav->sah->saidx.dst, 0) != 0)
 					continue;
 				
 				break;
 			case AF_INET6:
-				bzero(&sin6, sizeof(sin6));
-				sin6.sin6_family = AF_INET6;
-				sin6.sin6_len = sizeof(sin6);
-				bcopy(dst, &sin6.sin6_addr,
-					  sizeof(sin6.sin6_addr));
-				if (IN6_IS_SCOPE_LINKLOCAL(&sin6.sin6_addr)) {
-					/* kame fake scopeid */
-					sin6.sin6_scope_id =
-					ntohs(sin6.sin6_addr.s6_addr16[1]);
-					sin6.sin6_addr.s6_addr16[1] = 0;
-				}
 				if (key_sockaddrcmp((struct sockaddr*)&sin6,
 									(struct sockaddr *)&sav->sah->saidx.dst, 0) != 0)
 					continue;
@@ -1415,6 +1428,9 @@ key_allocsa_extended(u_int family,
 		
 		match = sav;
 		matchidx = tmpidx;
+		/* nothing can be preferred over the first valid state */
+		if (matchidx == 0)
+			break;
 	}
 	if (match)
 		goto found;
@@ -366,6 +366,7 @@ struct user_nfs_args {
 #define NFS_MIATTR_ORIG_ARGS		1	/* original mount args passed into mount call */
 #define NFS_MIATTR_CUR_ARGS 		2	/* current mount args values */
 #define NFS_MIATTR_CUR_LOC_INDEX	3	/* current fs location index */
+#define NFS_MIATTR_CACHE_STATS		4	/* attribute and lookup cache hits/misses */
 
 /* NFS mount info flags */
 #define NFS_MIFLAG_DEAD		0	/* mount is dead */
@@ -997,6 +998,7 @@ extern int nfs_tprintf_initial_delay, nfs_tprintf_delay;
 extern int nfsiod_thread_count, nfsiod_thread_max, nfs_max_async_writes;
 extern int nfs_idmap_ctrl, nfs_callback_port;
 extern int nfs_is_mobile, nfs_readlink_nocache, nfs_root_steals_ctx;
+extern int nfs_attrcache_deleg;
 extern uint32_t nfs_squishy_flags;
 extern uint32_t nfs_debug_ctl;
 
@@ -1041,6 +1043,7 @@ struct nfsrv_sock {
 	int		ns_reccnt;
 	u_int32_t		ns_sref;
 	time_t		ns_timestamp;		/* socket timestamp */
+	u_quad_t	ns_waitstart;		/* time queued on nfsrv_sockwait (usec) */
 	lck_mtx_t	ns_wgmutex;		/* mutex for write gather fields */
 	u_quad_t	ns_wgtime;		/* next Write deadline (usec) */
 	LIST_HEAD(, nfsrv_descript) ns_tq;	/* Write gather lists */
@@ -189,6 +189,8 @@ nfsrv_is_initialized(void)
 void
 nfsrv_init(void)
 {
+	int i;
+
 	/* make sure we init only once */
 	if (!OSCompareAndSwap(NFSRV_NOT_INITIALIZED, NFSRV_INITIALIZING, &nfsrv_initted)) {
 		/* wait until initialization is complete */
@@ -216,9 +218,10 @@ nfsrv_init(void)
 	/* init active user list mutex structures */
 	nfsrv_active_user_mutex_group = lck_grp_alloc_init("nfs-active-user-mutex", LCK_GRP_ATTR_NULL);
 
-	/* init nfs server request cache mutex */
+	/* init nfs server request cache mutexes */
 	nfsrv_reqcache_lck_grp = lck_grp_alloc_init("nfsrv_reqcache", LCK_GRP_ATTR_NULL);
-	nfsrv_reqcache_mutex = lck_mtx_alloc_init(nfsrv_reqcache_lck_grp, LCK_ATTR_NULL);
+	for (i = 0; i < NFSRVCACHE_SHARDS; i++)
+		nfsrv_reqcache_mutex[i] = lck_mtx_alloc_init(nfsrv_reqcache_lck_grp, LCK_ATTR_NULL);
 
 #if CONFIG_FSE
 	/* init NFS server file modified event generation */
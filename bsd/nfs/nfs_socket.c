@@ -5084,6 +5084,10 @@ nfs_sigintr(struct nfsmount *nmp, struct nfsreq *req, thread_t thd, int nmplocke
  * Necessary for STREAM sockets to ensure you get an entire rpc request/reply
  * and also to avoid race conditions between the processes with nfs requests
  * in progress when a reconnect is necessary.
+ *
+ * Waiters sleep on nm_sndwaiters and are handed the lock one at a time:
+ * with many RPCs in flight, waking all of them on every unlock only to
+ * have all but one go back to sleep swamps the send path.
  */
 int
 nfs_sndlock(struct nfsreq *req)
@@ -5104,10 +5108,11 @@ nfs_sndlock(struct nfsreq *req)
 	while (*statep & NFSSTA_SNDLOCK) {
 		if ((error = nfs_sigintr(nmp, req, req->r_thread, 1)))
 			break;
-		*statep |= NFSSTA_WANTSND;
 		if (nfs_noremotehang(req->r_thread))
 			ts.tv_sec = 1;
-		msleep(statep, &nmp->nm_lock, slpflag | (PZERO - 1), "nfsndlck", &ts);
+		nmp->nm_sndwaiters++;
+		msleep(&nmp->nm_sndwaiters, &nmp->nm_lock, slpflag | (PZERO - 1), "nfsndlck", &ts);
+		nmp->nm_sndwaiters--;
 		if (slpflag == PCATCH) {
 			slpflag = 0;
 			ts.tv_sec = 2;
@@ -5115,6 +5120,9 @@ nfs_sndlock(struct nfsreq *req)
 	}
 	if (!error)
 		*statep |= NFSSTA_SNDLOCK;
+	else if (!(*statep & NFSSTA_SNDLOCK) && nmp->nm_sndwaiters)
+		/* we may have been handed the lock; pass it on */
+		wakeup_one((caddr_t)&nmp->nm_sndwaiters);
 	lck_mtx_unlock(&nmp->nm_lock);
 	return (error);
 }
@@ -5126,7 +5134,7 @@ void
 nfs_sndunlock(struct nfsreq *req)
 {
 	struct nfsmount *nmp = req->r_nmp;
-	int *statep, wake = 0;
+	int *statep, wake = 0, wake_one = 0;
 
 	if (!nmp)
 		return;
@@ -5136,12 +5144,16 @@ nfs_sndunlock(struct nfsreq *req)
 		panic("nfs sndunlock");
 	*statep &= ~(NFSSTA_SNDLOCK|NFSSTA_SENDING);
 	if (*statep & NFSSTA_WANTSND) {
+		/* nfs_disconnect() waiting for the send to complete */
 		*statep &= ~NFSSTA_WANTSND;
 		wake = 1;
 	}
+	wake_one = (nmp->nm_sndwaiters != 0);
 	lck_mtx_unlock(&nmp->nm_lock);
 	if (wake)
 		wakeup(statep);
+	if (wake_one)
+		wakeup_one((caddr_t)&nmp->nm_sndwaiters);
 }
 
 int
@@ -6403,6 +6415,10 @@ nfsrv_wakenfsd(struct nfsrv_sock *slp)
 	lck_rw_lock_exclusive(&slp->ns_rwlock);
 	/* if there's work to do on this socket, make sure it's queued up */
 	if ((slp->ns_flag & SLP_WORKTODO) && !(slp->ns_flag & SLP_QUEUED)) {
+		struct timeval now;
+
+		microuptime(&now);
+		slp->ns_waitstart = (u_quad_t)now.tv_sec * 1000000 + now.tv_usec;
 		TAILQ_INSERT_TAIL(&nfsrv_sockwait, slp, ns_svcq);
 		slp->ns_flag |= SLP_WAITQ;
 	}
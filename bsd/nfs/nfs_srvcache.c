@@ -89,17 +89,29 @@
 #include <nfs/nfsrvcache.h>
 
 extern int nfsv2_procid[NFS_NPROCS];
-static int nfsrv_reqcache_count;
 int nfsrv_reqcache_size = NFSRVCACHESIZ;
 
-#define	NFSRCHASH(xid) \
-	(&nfsrv_reqcache_hashtbl[((xid) + ((xid) >> 24)) & nfsrv_reqcache_hash])
-LIST_HEAD(nfsrv_reqcache_hash, nfsrvcache) *nfsrv_reqcache_hashtbl;
-TAILQ_HEAD(nfsrv_reqcache_lru, nfsrvcache) nfsrv_reqcache_lruhead;
-u_long nfsrv_reqcache_hash;
+/*
+ * The cache is split into NFSRVCACHE_SHARDS independently locked shards,
+ * picked by the low bits of the xid, so that nfsd threads working on
+ * different requests don't all serialize on one mutex.  Each shard has
+ * its own hash table, LRU list and share of nfsrv_reqcache_size.
+ */
+struct nfsrv_reqcache_shard {
+	LIST_HEAD(nfsrv_reqcache_hash, nfsrvcache) *rcs_hashtbl;
+	u_long		rcs_hash;
+	TAILQ_HEAD(nfsrv_reqcache_lru, nfsrvcache) rcs_lruhead;
+	int		rcs_count;
+	int		rcs_size;
+};
+static struct nfsrv_reqcache_shard nfsrv_reqcache[NFSRVCACHE_SHARDS];
+
+#define	NFSRCSHARD(xid)		((xid) & (NFSRVCACHE_SHARDS - 1))
+#define	NFSRCHASH(rcs, xid) \
+	(&(rcs)->rcs_hashtbl[(((xid) / NFSRVCACHE_SHARDS) + ((xid) >> 24)) & (rcs)->rcs_hash])
 
 lck_grp_t *nfsrv_reqcache_lck_grp;
-lck_mtx_t *nfsrv_reqcache_mutex;
+lck_mtx_t *nfsrv_reqcache_mutex[NFSRVCACHE_SHARDS];
 
 /*
  * Static array that defines which nfs rpc's are nonidempotent
@@ -158,14 +170,22 @@ static int nfsv2_repstat[NFS_NPROCS] = {
 void
 nfsrv_initcache(void)
 {
+	struct nfsrv_reqcache_shard *rcs;
+	int i, size;
+
 	if (nfsrv_reqcache_size <= 0)
 		return;
 
-	lck_mtx_lock(nfsrv_reqcache_mutex);
-	/* init nfs server request cache hash table */
-	nfsrv_reqcache_hashtbl = hashinit(nfsrv_reqcache_size, M_NFSD, &nfsrv_reqcache_hash);
-	TAILQ_INIT(&nfsrv_reqcache_lruhead);
-	lck_mtx_unlock(nfsrv_reqcache_mutex);
+	size = MAX(nfsrv_reqcache_size / NFSRVCACHE_SHARDS, 1);
+	for (i = 0; i < NFSRVCACHE_SHARDS; i++) {
+		rcs = &nfsrv_reqcache[i];
+		lck_mtx_lock(nfsrv_reqcache_mutex[i]);
+		/* init nfs server request cache hash table */
+		rcs->rcs_hashtbl = hashinit(size, M_NFSD, &rcs->rcs_hash);
+		TAILQ_INIT(&rcs->rcs_lruhead);
+		rcs->rcs_size = size;
+		lck_mtx_unlock(nfsrv_reqcache_mutex[i]);
+	}
 }
 
 /*
@@ -222,9 +242,11 @@ nfsrv_getcache(
 	struct nfsrv_sock *slp,
 	mbuf_t *mrepp)
 {
+	struct nfsrv_reqcache_shard *rcs;
 	struct nfsrvcache *rp;
 	struct nfsm_chain nmrep;
 	struct sockaddr *saddr;
+	lck_mtx_t *mtx;
 	int ret, error;
 
 	/*
@@ -233,22 +255,29 @@ nfsrv_getcache(
 	 */
 	if (!nd->nd_nam2)
 		return (RC_DOIT);
-	lck_mtx_lock(nfsrv_reqcache_mutex);
+	rcs = &nfsrv_reqcache[NFSRCSHARD(nd->nd_retxid)];
+	mtx = nfsrv_reqcache_mutex[NFSRCSHARD(nd->nd_retxid)];
+	lck_mtx_lock(mtx);
+	if (rcs->rcs_hashtbl == NULL) {
+		/* cache disabled */
+		lck_mtx_unlock(mtx);
+		return (RC_DOIT);
+	}
 loop:
-	for (rp = NFSRCHASH(nd->nd_retxid)->lh_first; rp != 0;
+	for (rp = NFSRCHASH(rcs, nd->nd_retxid)->lh_first; rp != 0;
 	    rp = rp->rc_hash.le_next) {
 	    if (nd->nd_retxid == rp->rc_xid && nd->nd_procnum == rp->rc_proc &&
 		netaddr_match(rp->rc_family, &rp->rc_haddr, nd->nd_nam)) {
 			if ((rp->rc_flag & RC_LOCKED) != 0) {
 				rp->rc_flag |= RC_WANTED;
-				msleep(rp, nfsrv_reqcache_mutex, PZERO-1, "nfsrc", NULL);
+				msleep(rp, mtx, PZERO-1, "nfsrc", NULL);
 				goto loop;
 			}
 			rp->rc_flag |= RC_LOCKED;
 			/* If not at end of LRU chain, move it there */
 			if (rp->rc_lru.tqe_next) {
-				TAILQ_REMOVE(&nfsrv_reqcache_lruhead, rp, rc_lru);
-				TAILQ_INSERT_TAIL(&nfsrv_reqcache_lruhead, rp, rc_lru);
+				TAILQ_REMOVE(&rcs->rcs_lruhead, rp, rc_lru);
+				TAILQ_INSERT_TAIL(&rcs->rcs_lruhead, rp, rc_lru);
 			}
 			if (rp->rc_state == RC_UNUSED)
 				panic("nfsrv cache");
@@ -286,17 +315,17 @@ loop:
 				rp->rc_flag &= ~RC_WANTED;
 				wakeup(rp);
 			}
-			lck_mtx_unlock(nfsrv_reqcache_mutex);
+			lck_mtx_unlock(mtx);
 			return (ret);
 		}
 	}
 	OSAddAtomic64(1, &nfsstats.srvcache_misses);
-	if (nfsrv_reqcache_count < nfsrv_reqcache_size) {
+	if (rcs->rcs_count < rcs->rcs_size) {
 		/* try to allocate a new entry */
 		MALLOC(rp, struct nfsrvcache *, sizeof *rp, M_NFSD, M_WAITOK);
 		if (rp) {
 			bzero((char *)rp, sizeof *rp);
-			nfsrv_reqcache_count++;
+			rcs->rcs_count++;
 			rp->rc_flag = RC_LOCKED;
 		}
 	} else {
@@ -304,28 +333,28 @@ loop:
 	}
 	if (!rp) {
 		/* try to reuse the least recently used entry */
-		rp = nfsrv_reqcache_lruhead.tqh_first;
+		rp = rcs->rcs_lruhead.tqh_first;
 		if (!rp) {
 			/* no entry to reuse? */
 			/* OK, we just won't be able to cache this request */
-			lck_mtx_unlock(nfsrv_reqcache_mutex);
+			lck_mtx_unlock(mtx);
 			return (RC_DOIT);
 		}
 		while ((rp->rc_flag & RC_LOCKED) != 0) {
 			rp->rc_flag |= RC_WANTED;
-			msleep(rp, nfsrv_reqcache_mutex, PZERO-1, "nfsrc", NULL);
-			rp = nfsrv_reqcache_lruhead.tqh_first;
+			msleep(rp, mtx, PZERO-1, "nfsrc", NULL);
+			rp = rcs->rcs_lruhead.tqh_first;
 		}
 		rp->rc_flag |= RC_LOCKED;
 		LIST_REMOVE(rp, rc_hash);
-		TAILQ_REMOVE(&nfsrv_reqcache_lruhead, rp, rc_lru);
+		TAILQ_REMOVE(&rcs->rcs_lruhead, rp, rc_lru);
 		if (rp->rc_flag & RC_REPMBUF)
 			mbuf_freem(rp->rc_reply);
 		if (rp->rc_flag & RC_NAM)
 			mbuf_freem(rp->rc_nam);
 		rp->rc_flag &= (RC_LOCKED | RC_WANTED);
 	}
-	TAILQ_INSERT_TAIL(&nfsrv_reqcache_lruhead, rp, rc_lru);
+	TAILQ_INSERT_TAIL(&rcs->rcs_lruhead, rp, rc_lru);
 	rp->rc_state = RC_INPROG;
 	rp->rc_xid = nd->nd_retxid;
 	saddr = mbuf_data(nd->nd_nam);
@@ -348,13 +377,13 @@ loop:
 		break;
 	};
 	rp->rc_proc = nd->nd_procnum;
-	LIST_INSERT_HEAD(NFSRCHASH(nd->nd_retxid), rp, rc_hash);
+	LIST_INSERT_HEAD(NFSRCHASH(rcs, nd->nd_retxid), rp, rc_hash);
 	rp->rc_flag &= ~RC_LOCKED;
 	if (rp->rc_flag & RC_WANTED) {
 		rp->rc_flag &= ~RC_WANTED;
 		wakeup(rp);
 	}
-	lck_mtx_unlock(nfsrv_reqcache_mutex);
+	lck_mtx_unlock(mtx);
 	return (RC_DOIT);
 }
 
@@ -367,20 +396,28 @@ nfsrv_updatecache(
 	int repvalid,
 	mbuf_t repmbuf)
 {
+	struct nfsrv_reqcache_shard *rcs;
 	struct nfsrvcache *rp;
+	lck_mtx_t *mtx;
 	int error;
 
 	if (!nd->nd_nam2)
 		return;
-	lck_mtx_lock(nfsrv_reqcache_mutex);
+	rcs = &nfsrv_reqcache[NFSRCSHARD(nd->nd_retxid)];
+	mtx = nfsrv_reqcache_mutex[NFSRCSHARD(nd->nd_retxid)];
+	lck_mtx_lock(mtx);
+	if (rcs->rcs_hashtbl == NULL) {
+		lck_mtx_unlock(mtx);
+		return;
+	}
 loop:
-	for (rp = NFSRCHASH(nd->nd_retxid)->lh_first; rp != 0;
+	for (rp = NFSRCHASH(rcs, nd->nd_retxid)->lh_first; rp != 0;
 	    rp = rp->rc_hash.le_next) {
 	    if (nd->nd_retxid == rp->rc_xid && nd->nd_procnum == rp->rc_proc &&
 		netaddr_match(rp->rc_family, &rp->rc_haddr, nd->nd_nam)) {
 			if ((rp->rc_flag & RC_LOCKED) != 0) {
 				rp->rc_flag |= RC_WANTED;
-				msleep(rp, nfsrv_reqcache_mutex, PZERO-1, "nfsrc", NULL);
+				msleep(rp, mtx, PZERO-1, "nfsrc", NULL);
 				goto loop;
 			}
 			rp->rc_flag |= RC_LOCKED;
@@ -417,11 +454,11 @@ loop:
 				rp->rc_flag &= ~RC_WANTED;
 				wakeup(rp);
 			}
-			lck_mtx_unlock(nfsrv_reqcache_mutex);
+			lck_mtx_unlock(mtx);
 			return;
 		}
 	}
-	lck_mtx_unlock(nfsrv_reqcache_mutex);
+	lck_mtx_unlock(mtx);
 }
 
 /*
@@ -430,18 +467,26 @@ loop:
 void
 nfsrv_cleancache(void)
 {
+	struct nfsrv_reqcache_shard *rcs;
 	struct nfsrvcache *rp, *nextrp;
+	int i;
 
-	lck_mtx_lock(nfsrv_reqcache_mutex);
-	for (rp = nfsrv_reqcache_lruhead.tqh_first; rp != 0; rp = nextrp) {
-		nextrp = rp->rc_lru.tqe_next;
-		LIST_REMOVE(rp, rc_hash);
-		TAILQ_REMOVE(&nfsrv_reqcache_lruhead, rp, rc_lru);
-		_FREE(rp, M_NFSD);
+	for (i = 0; i < NFSRVCACHE_SHARDS; i++) {
+		rcs = &nfsrv_reqcache[i];
+		lck_mtx_lock(nfsrv_reqcache_mutex[i]);
+		for (rp = rcs->rcs_lruhead.tqh_first; rp != 0; rp = nextrp) {
+			nextrp = rp->rc_lru.tqe_next;
+			LIST_REMOVE(rp, rc_hash);
+			TAILQ_REMOVE(&rcs->rcs_lruhead, rp, rc_lru);
+			_FREE(rp, M_NFSD);
+		}
+		rcs->rcs_count = 0;
+		if (rcs->rcs_hashtbl) {
+			FREE(rcs->rcs_hashtbl, M_TEMP);
+			rcs->rcs_hashtbl = NULL;
+		}
+		lck_mtx_unlock(nfsrv_reqcache_mutex[i]);
 	}
-	nfsrv_reqcache_count = 0;
-	FREE(nfsrv_reqcache_hashtbl, M_TEMP);
-	lck_mtx_unlock(nfsrv_reqcache_mutex);
 }
 
 #endif /* NFSSERVER */
@@ -1672,22 +1672,31 @@ nfs_getattrcache(nfsnode_t np, struct nfs_vattr *nvaper, int flags)
 	int32_t timeo;
 	struct nfsmount *nmp;
 
+	nmp = NFSTONMP(np);
+
 	/* Check if the attributes are valid. */
 	if (!NATTRVALID(np) || ((flags & NGA_ACL) && !NACLVALID(np))) {
 		FSDBG(528, np, 0, 0xffffff01, ENOENT);
 		OSAddAtomic64(1, &nfsstats.attrcache_misses);
+		if (!nfs_mount_gone(nmp))
+			OSAddAtomic64(1, &nmp->nm_attrcache_misses);
 		return (ENOENT);
 	}
 
-	nmp = NFSTONMP(np);
 	if (nfs_mount_gone(nmp))
 		return (ENXIO);
 	/*
 	 * Verify the cached attributes haven't timed out.
 	 * If the server isn't responding, skip the check
 	 * and return cached attributes.
+	 * While we hold a delegation the server will recall it before
+	 * anyone else can change the file, so the attributes can't go
+	 * stale unless the delegation is on its way back.
 	 */
-	if (!nfs_use_cache(nmp)) {
+	if (!nfs_use_cache(nmp) &&
+	    ((flags & NGA_ACL) || !nfs_attrcache_deleg || (nmp->nm_vers < NFS_VER4) ||
+	     !(np->n_openflags & N_DELEG_MASK) ||
+	     (np->n_openflags & (N_DELEG_RETURN|N_DELEG_RETURNING)))) {
 		microuptime(&nowup);
 		if (np->n_attrstamp > nowup.tv_sec) {
 			printf("NFS: Attribute time stamp is in the future by %ld seconds. Invalidating cache\n",
@@ -1700,11 +1709,13 @@ nfs_getattrcache(nfsnode_t np, struct nfs_vattr *nvaper, int flags)
 		if ((nowup.tv_sec - np->n_attrstamp) >= timeo) {
 			FSDBG(528, np, 0, 0xffffff02, ENOENT);
 			OSAddAtomic64(1, &nfsstats.attrcache_misses);
+			OSAddAtomic64(1, &nmp->nm_attrcache_misses);
 			return (ENOENT);
 		}
 		if ((flags & NGA_ACL) && ((nowup.tv_sec - np->n_aclstamp) >= timeo)) {
 			FSDBG(528, np, 0, 0xffffff02, ENOENT);
 			OSAddAtomic64(1, &nfsstats.attrcache_misses);
+			OSAddAtomic64(1, &nmp->nm_attrcache_misses);
 			return (ENOENT);
 		}
 	}
@@ -1712,6 +1723,7 @@ nfs_getattrcache(nfsnode_t np, struct nfs_vattr *nvaper, int flags)
 	nvap = &np->n_vattr;
 	FSDBG(528, np, nvap->nva_size, np->n_size, 0xcace);
 	OSAddAtomic64(1, &nfsstats.attrcache_hits);
+	OSAddAtomic64(1, &nmp->nm_attrcache_hits);
 
 	if (nvap->nva_type != VREG) {
 		np->n_size = nvap->nva_size;
@@ -134,6 +134,11 @@ static int nfsrv_sock_tcp_cnt = 0;
 #define NFSD_MIN_IDLE_TIMEOUT 30
 static int nfsrv_sock_idle_timeout = 3600; /* One hour */
 
+/* how long sockets with work sit on nfsrv_sockwait before an nfsd picks them up */
+static uint64_t nfsrv_sockwait_count = 0;
+static uint64_t nfsrv_sockwait_usec = 0;
+static uint64_t nfsrv_sockwait_max_usec = 0;
+
 int	nfssvc_export(user_addr_t argp);
 int	nfssvc_nfsd(void);
 int	nfssvc_addsock(socket_t, mbuf_t);
@@ -164,6 +169,7 @@ SYSCTL_INT(_vfs_generic_nfs_client, OID_AUTO, max_async_writes, CTLFLAG_RW | CTL
 SYSCTL_INT(_vfs_generic_nfs_client, OID_AUTO, access_delete, CTLFLAG_RW | CTLFLAG_LOCKED, &nfs_access_delete, 0, "");
 SYSCTL_INT(_vfs_generic_nfs_client, OID_AUTO, access_dotzfs, CTLFLAG_RW | CTLFLAG_LOCKED, &nfs_access_dotzfs, 0, "");
 SYSCTL_INT(_vfs_generic_nfs_client, OID_AUTO, access_for_getattr, CTLFLAG_RW | CTLFLAG_LOCKED, &nfs_access_for_getattr, 0, "");
+SYSCTL_INT(_vfs_generic_nfs_client, OID_AUTO, attrcache_deleg, CTLFLAG_RW | CTLFLAG_LOCKED, &nfs_attrcache_deleg, 0, "");
 SYSCTL_INT(_vfs_generic_nfs_client, OID_AUTO, idmap_ctrl, CTLFLAG_RW | CTLFLAG_LOCKED, &nfs_idmap_ctrl, 0, "");
 SYSCTL_INT(_vfs_generic_nfs_client, OID_AUTO, callback_port, CTLFLAG_RW | CTLFLAG_LOCKED, &nfs_callback_port, 0, "");
 SYSCTL_INT(_vfs_generic_nfs_client, OID_AUTO, is_mobile, CTLFLAG_RW | CTLFLAG_LOCKED, &nfs_is_mobile, 0, "");
@@ -192,6 +198,9 @@ SYSCTL_INT(_vfs_generic_nfs_server, OID_AUTO, nfsd_thread_max, CTLFLAG_RW | CTLF
 SYSCTL_INT(_vfs_generic_nfs_server, OID_AUTO, nfsd_thread_count, CTLFLAG_RD | CTLFLAG_LOCKED, &nfsd_thread_count, 0, "");
 SYSCTL_INT(_vfs_generic_nfs_server, OID_AUTO, nfsd_sock_idle_timeout, CTLFLAG_RW | CTLFLAG_LOCKED, &nfsrv_sock_idle_timeout, 0, "");
 SYSCTL_INT(_vfs_generic_nfs_server, OID_AUTO, nfsd_tcp_connections, CTLFLAG_RD | CTLFLAG_LOCKED, &nfsrv_sock_tcp_cnt, 0, "");
+SYSCTL_QUAD(_vfs_generic_nfs_server, OID_AUTO, sockwait_count, CTLFLAG_RD | CTLFLAG_LOCKED, &nfsrv_sockwait_count, "");
+SYSCTL_QUAD(_vfs_generic_nfs_server, OID_AUTO, sockwait_usec, CTLFLAG_RD | CTLFLAG_LOCKED, &nfsrv_sockwait_usec, "");
+SYSCTL_QUAD(_vfs_generic_nfs_server, OID_AUTO, sockwait_max_usec, CTLFLAG_RD | CTLFLAG_LOCKED, &nfsrv_sockwait_max_usec, "");
 #ifdef NFS_UC_Q_DEBUG
 SYSCTL_INT(_vfs_generic_nfs_server, OID_AUTO, use_upcall_svc, CTLFLAG_RW | CTLFLAG_LOCKED, &nfsrv_uc_use_proxy, 0, "");
 SYSCTL_INT(_vfs_generic_nfs_server, OID_AUTO, upcall_queue_limit, CTLFLAG_RW | CTLFLAG_LOCKED, &nfsrv_uc_queue_limit, 0, "");
@@ -1004,6 +1013,25 @@ nfssvc_addsock(socket_t so, mbuf_t mynam)
 	return (0);
 }
 
+/*
+ * Account for the time a socket spent on the wait queue before an nfsd
+ * got to it.  Called with nfsd_mutex held.
+ */
+static void
+nfsrv_sockwait_done(struct nfsrv_sock *slp)
+{
+	struct timeval now;
+	uint64_t waited;
+
+	microuptime(&now);
+	waited = (u_quad_t)now.tv_sec * 1000000 + now.tv_usec;
+	waited = (waited > slp->ns_waitstart) ? waited - slp->ns_waitstart : 0;
+	nfsrv_sockwait_count++;
+	nfsrv_sockwait_usec += waited;
+	if (waited > nfsrv_sockwait_max_usec)
+		nfsrv_sockwait_max_usec = waited;
+}
+
 /*
  * nfssvc_nfsd()
  *
@@ -1121,8 +1149,10 @@ nfssvc_nfsd(void)
 					/* remove from the head of the queue */
 					TAILQ_REMOVE(&nfsrv_sockwait, slp, ns_svcq);
 					slp->ns_flag &= ~SLP_WAITQ;
-					if ((slp->ns_flag & SLP_VALID) && (slp->ns_flag & SLP_WORKTODO))
+					if ((slp->ns_flag & SLP_VALID) && (slp->ns_flag & SLP_WORKTODO)) {
+						nfsrv_sockwait_done(slp);
 						break;
+					}
 					/* nothing to do, so skip this socket */
 					lck_rw_done(&slp->ns_rwlock);
 				}
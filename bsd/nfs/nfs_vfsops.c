@@ -166,6 +166,7 @@ int nfs_access_cache_timeout = NFS_MAXATTRTIMO;
 int nfs_access_delete = 1; /* too many servers get this wrong - workaround on by default */
 int nfs_access_dotzfs = 1;
 int nfs_access_for_getattr = 0;
+int nfs_attrcache_deleg = 1;
 int nfs_allow_async = 0;
 int nfs_statfs_rate_limit = NFS_DEFSTATFSRATELIMIT;
 int nfs_lockd_mounts = 0;
@@ -5163,6 +5164,7 @@ nfs_mountinfo_assemble(struct nfsmount *nmp, struct xdrbuf *xb)
 	NFS_BITMAP_SET(miattrs, NFS_MIATTR_ORIG_ARGS);
 	NFS_BITMAP_SET(miattrs, NFS_MIATTR_CUR_ARGS);
 	NFS_BITMAP_SET(miattrs, NFS_MIATTR_CUR_LOC_INDEX);
+	NFS_BITMAP_SET(miattrs, NFS_MIATTR_CACHE_STATS);
 	NFS_BITMAP_ZERO(miflags_mask, NFS_MIFLAG_BITMAP_LEN);
 	NFS_BITMAP_ZERO(miflags, NFS_MIFLAG_BITMAP_LEN);
 	NFS_BITMAP_SET(miflags_mask, NFS_MIFLAG_DEAD);
@@ -5412,6 +5414,12 @@ nfs_mountinfo_assemble(struct nfsmount *nmp, struct xdrbuf *xb)
 	xb_add_32(error, &xbinfo, nmp->nm_locations.nl_current.nli_serv);
 	xb_add_32(error, &xbinfo, nmp->nm_locations.nl_current.nli_addr);
 
+	/* NFS_MIATTR_CACHE_STATS */
+	xb_add_64(error, &xbinfo, nmp->nm_attrcache_hits);
+	xb_add_64(error, &xbinfo, nmp->nm_attrcache_misses);
+	xb_add_64(error, &xbinfo, nmp->nm_lookupcache_hits);
+	xb_add_64(error, &xbinfo, nmp->nm_lookupcache_misses);
+
 	xb_build_done(error, &xbinfo);
 
 	/* update opaque counts */
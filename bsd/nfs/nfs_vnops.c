@@ -2328,6 +2328,7 @@ nfs_vnop_lookup(
 	case -1:
 		/* cache hit, not really an error */
 		OSAddAtomic64(1, &nfsstats.lookupcache_hits);
+		OSAddAtomic64(1, &nmp->nm_lookupcache_hits);
 
 		nfs_node_clear_busy(dnp);
 		busyerror = ENOENT;
@@ -2380,6 +2381,7 @@ nfs_vnop_lookup(
 	newvp = NULLVP;
 
 	OSAddAtomic64(1, &nfsstats.lookupcache_misses);
+	OSAddAtomic64(1, &nmp->nm_lookupcache_misses);
 
 	error = nmp->nm_funcs->nf_lookup_rpc_async(dnp, cnp->cn_nameptr, cnp->cn_namelen, ctx, &req);
 	nfsmout_if(error);
@@ -263,6 +263,7 @@ struct nfsmount {
 	char *	nm_sprinc;		/* Kerberos principal of the server */
 	int	nm_ref;			/* Reference count on this mount */
 	int	nm_state;		/* Internal state flags */
+	int	nm_sndwaiters;		/* threads waiting for the send lock */
 	int	nm_vers;		/* NFS version */
 	uint32_t nm_minor_vers;		/* minor version of above */
 	uint32_t nm_min_vers;		/* minimum packed version to try */
@@ -332,6 +333,10 @@ struct nfsmount {
 	struct nfsiod *nm_niod;		/* nfsiod processing this mount */
 	TAILQ_ENTRY(nfsmount) nm_iodlink; /* chain of mounts awaiting nfsiod */
 	int	nm_asyncwrites;		/* outstanding async I/O writes */
+	uint64_t nm_attrcache_hits;	/* attribute cache hits on this mount */
+	uint64_t nm_attrcache_misses;	/* attribute cache misses on this mount */
+	uint64_t nm_lookupcache_hits;	/* name cache hits on this mount */
+	uint64_t nm_lookupcache_misses;	/* name cache misses on this mount */
 	/* socket state */
 	uint8_t	nm_sofamily;		/* (preferred) protocol family of socket */
 	uint8_t	nm_sotype;		/* (preferred) type of socket */
@@ -84,6 +84,7 @@ union nethostaddr {
 };
 
 #define	NFSRVCACHESIZ	64
+#define	NFSRVCACHE_SHARDS	8	/* independently locked parts of the cache (power of 2) */
 
 struct nfsrvcache {
 	TAILQ_ENTRY(nfsrvcache) rc_lru;		/* LRU chain */
@@ -126,7 +127,7 @@ struct nfsrvcache {
 #define	RC_NAM		0x40
 
 extern lck_grp_t *nfsrv_reqcache_lck_grp;
-extern lck_mtx_t *nfsrv_reqcache_mutex;
+extern lck_mtx_t *nfsrv_reqcache_mutex[NFSRVCACHE_SHARDS];
 
 #endif /* __APPLE_API_PRIVATE */
 #endif /* _NFS_NFSRVCACHE_H_ */
@@ -125,6 +125,7 @@ WORKQ_SYSCTL_USECS(wq_max_timer_interval, WQ_MAX_TIMER_INTERVAL_USECS);
 static uint32_t wq_max_threads              = WORKQUEUE_MAXTHREADS;
 static uint32_t wq_max_constrained_threads  = WORKQUEUE_MAXTHREADS / 8;
 static uint32_t wq_init_constrained_limit   = 1;
+static uint32_t wq_max_spare_threads        = WQ_MAX_SPARE_THREADS;
 static uint16_t wq_death_max_load;
 static uint32_t wq_max_parallelism[WORKQ_NUM_QOS_BUCKETS];
 
@@ -149,6 +150,9 @@ SYSCTL_INT(_kern, OID_AUTO, wq_max_threads, CTLFLAG_RW | CTLFLAG_LOCKED,
 SYSCTL_INT(_kern, OID_AUTO, wq_max_constrained_threads, CTLFLAG_RW | CTLFLAG_LOCKED,
 		&wq_max_constrained_threads, 0, "");
 
+SYSCTL_INT(_kern, OID_AUTO, wq_max_spare_threads, CTLFLAG_RW | CTLFLAG_LOCKED,
+		&wq_max_spare_threads, 0, "");
+
 #pragma mark p_wqptr
 
 #define WQPTR_IS_INITING_VALUE ((struct workqueue *)~(uintptr_t)0)
@@ -366,6 +370,23 @@ _wq_thactive_aggregate_downto_qos(struct workqueue *wq, wq_thactive_t v,
 	return count;
 }
 
+/*
+ * Count the threads bound to a request at or above a given QoS, whether they
+ * are running or blocked, as the cooperative admission check does.
+ */
+static inline uint32_t
+_wq_thscheduled_downto_qos(struct workqueue *wq, thread_qos_t qos)
+{
+	uint32_t count = 0;
+
+	assert(WORKQ_THREAD_QOS_MIN <= qos && qos <= WORKQ_THREAD_QOS_MAX);
+
+	for (int i = _wq_bucket(qos); i < WORKQ_NUM_QOS_BUCKETS; i++) {
+		count += wq->wq_thscheduled_count[i];
+	}
+	return count;
+}
+
 #pragma mark wq_flags
 
 static inline uint32_t
@@ -876,6 +897,26 @@ out:
 	return false;
 }
 
+/**
+ * Create idle threads ahead of the requests still pending, up to
+ * wq_max_spare_threads of them, so that a burst of requests finds threads
+ * to wake up instead of serializing behind one thread creation each.
+ *
+ * - called with workq lock held, from the thread creation thread call
+ * - dropped and retaken around thread creation
+ * - return with workq lock held
+ */
+static void
+workq_add_spare_threads(proc_t p, struct workqueue *wq)
+{
+	while (wq->wq_thidlecount < MIN(wq->wq_reqcount, wq_max_spare_threads) &&
+			wq->wq_nthreads < wq_max_threads && !_wq_exiting(wq)) {
+		if (!workq_add_new_idle_thread(p, wq)) {
+			break;
+		}
+	}
+}
+
 #define WORKQ_UNPARK_FOR_DEATH_WAS_IDLE 0x1
 
 __attribute__((noreturn, noinline))
@@ -1383,6 +1424,7 @@ workq_add_new_threads_call(void *_p, void *flags)
 
 	/* This can drop the workqueue lock, and take it again */
 	workq_schedule_creator(p, wq, WORKQ_THREADREQ_CAN_CREATE_THREADS);
+	workq_add_spare_threads(p, wq);
 
 	workq_unlock(wq);
 
@@ -1428,6 +1470,11 @@ workq_sched_callback(int type, thread_t thread)
 			/*
 			 * No pending request at the moment we could unblock, move on.
 			 */
+		} else if (_wq_flags(wq) & WQ_COOPERATIVE) {
+			/*
+			 * A cooperative pool doesn't widen when its threads block,
+			 * the blocked thread still holds its share of the concurrency.
+			 */
 		} else if (qos < req_qos) {
 			/*
 			 * The blocking thread is at a lower QoS than the highest currently
@@ -2690,6 +2737,21 @@ workq_kernreturn(struct proc *p, struct workq_kernreturn_args *uap, int32_t *ret
 		*retval = should_narrow;
 		break;
 	}
+	case WQOPS_SETUP_COOPERATIVE: {
+		/*
+		 * arg2 = unused
+		 * arg3 = unused
+		 *
+		 * There is no way back, the runtime is expected to opt in once
+		 * before it requests any thread.
+		 */
+		if (wq == NULL) {
+			error = EINVAL;
+			break;
+		}
+		os_atomic_or(&wq->wq_flags, WQ_COOPERATIVE, relaxed);
+		break;
+	}
 	default:
 		error = EINVAL;
 		break;
@@ -2816,18 +2878,39 @@ workq_constrained_allowance(struct workqueue *wq, thread_qos_t at_qos,
 
 	uint32_t busycount, thactive_count;
 
-	thactive_count = _wq_thactive_aggregate_downto_qos(wq, _wq_thactive(wq),
-			at_qos, &busycount, NULL);
+	if (_wq_flags(wq) & WQ_COOPERATIVE) {
+		/*
+		 * In a cooperative pool, every thread bound to a request counts
+		 * until it returns to the kernel, even while blocked, so that the
+		 * pool never grows wider than the parallelism of its QoS.
+		 */
+		thactive_count = _wq_thscheduled_downto_qos(wq, at_qos);
+		busycount = 0;
+		may_start_timer = false;
 
-	if (uth && uth->uu_workq_pri.qos_bucket != WORKQ_THREAD_QOS_MANAGER &&
-			at_qos <= uth->uu_workq_pri.qos_bucket) {
 		/*
-		 * Don't count this thread as currently active, but only if it's not
-		 * a manager thread, as _wq_thactive_aggregate_downto_qos ignores active
-		 * managers.
+		 * Don't count this thread as scheduled, the creator never is.
 		 */
-		assert(thactive_count > 0);
-		thactive_count--;
+		if (uth && uth != wq->wq_creator &&
+				uth->uu_workq_pri.qos_bucket != WORKQ_THREAD_QOS_MANAGER &&
+				at_qos <= uth->uu_workq_pri.qos_bucket) {
+			assert(thactive_count > 0);
+			thactive_count--;
+		}
+	} else {
+		thactive_count = _wq_thactive_aggregate_downto_qos(wq,
+				_wq_thactive(wq), at_qos, &busycount, NULL);
+
+		if (uth && uth->uu_workq_pri.qos_bucket != WORKQ_THREAD_QOS_MANAGER &&
+				at_qos <= uth->uu_workq_pri.qos_bucket) {
+			/*
+			 * Don't count this thread as currently active, but only if it's
+			 * not a manager thread, as _wq_thactive_aggregate_downto_qos
+			 * ignores active managers.
+			 */
+			assert(thactive_count > 0);
+			thactive_count--;
+		}
 	}
 
 	count = wq_max_parallelism[_wq_bucket(at_qos)];
@@ -3105,6 +3188,13 @@ again:
 			/* This can drop the workqueue lock, and take it again */
 			workq_schedule_immediate_thread_creation(wq);
 		} else if (workq_add_new_idle_thread(p, wq)) {
+			/*
+			 * More requests are waiting than this thread will serve,
+			 * have the thread call create the spares off this path.
+			 */
+			if (wq->wq_reqcount > 1 && wq_max_spare_threads > 1) {
+				workq_schedule_immediate_thread_creation(wq);
+			}
 			goto again;
 		} else {
 			workq_schedule_delayed_thread_creation(wq, 0);
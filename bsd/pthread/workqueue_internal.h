@@ -139,6 +139,8 @@ typedef enum {
 	WQ_DELAYED_CALL_PENDED      = 0x0020,
 	WQ_IMMEDIATE_CALL_SCHEDULED = 0x0040,
 	WQ_IMMEDIATE_CALL_PENDED    = 0x0080,
+
+	WQ_COOPERATIVE              = 0x0100,
 } workq_state_flags_t;
 
 TAILQ_HEAD(workq_uthread_head, uthread);
@@ -189,6 +191,7 @@ static_assert(offsetof(struct workqueue, wq_lock) >= sizeof(struct queue_entry),
 #define WQ_STALLED_WINDOW_USECS		200
 #define WQ_REDUCE_POOL_WINDOW_USECS	5000000
 #define	WQ_MAX_TIMER_INTERVAL_USECS	50000
+#define WQ_MAX_SPARE_THREADS		4
 
 #pragma mark definitions
 
@@ -43,6 +43,7 @@
 #define WQOPS_SET_EVENT_MANAGER_PRIORITY 0x80	/* max() in the provided priority in the the priority of the event manager */
 #define WQOPS_THREAD_WORKLOOP_RETURN 0x100	/* parks the thread after delivering the passed kevent array */
 #define WQOPS_SHOULD_NARROW 0x200	/* checks whether we should narrow our concurrency */
+#define WQOPS_SETUP_COOPERATIVE 0x400	/* blocked constrained threads keep their share of the concurrency */
 
 /* flag values for upcall flags field, only 8 bits per struct threadlist */
 #define WQ_FLAG_THREAD_PRIO_SCHED		0x00008000
@@ -64,6 +65,8 @@
 /* kqueue_workloop_ctl commands */
 #define KQ_WORKLOOP_CREATE				0x01
 #define KQ_WORKLOOP_DESTROY				0x02
+#define KQ_WORKLOOP_RING_ATTACH			0x03
+#define KQ_WORKLOOP_RING_WAIT			0x04
 
 /* indicate which fields of kq_workloop_create params are valid */
 #define KQ_WORKLOOP_CREATE_SCHED_PRI	0x01
@@ -78,6 +81,9 @@ struct kqueue_workloop_params {
 	int kqwlp_sched_pol;
 	int kqwlp_cpu_percent;
 	int kqwlp_cpu_refillms;
+	uint32_t kqwlp_ring_entries;	/* RING_ATTACH [in]: power of 2 */
+	uint32_t kqwlp_reserved;
+	uint64_t kqwlp_ring_addr;	/* RING_ATTACH [out]: struct kevent_ring */
 } __attribute__((packed));
 
 _Static_assert(offsetof(struct kqueue_workloop_params, kqwlp_version) == 0,
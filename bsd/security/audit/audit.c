@@ -588,10 +588,14 @@ audit_commit(struct kaudit_record *ar, int error, int retval)
 	while (audit_q_len >= audit_qctrl.aq_hiwater)
 		cv_wait(&audit_watermark_cv, &audit_mtx);
 
+	/*
+	 * The worker only waits for an empty queue, and takes all of it
+	 * at once, so it only needs waking for the first record.
+	 */
 	TAILQ_INSERT_TAIL(&audit_q, ar, k_q);
-	audit_q_len++;
+	if (audit_q_len++ == 0)
+		cv_signal(&audit_worker_cv);
 	audit_pre_q_len--;
-	cv_signal(&audit_worker_cv);
 	mtx_unlock(&audit_mtx);
 }
 
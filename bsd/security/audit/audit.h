@@ -377,6 +377,8 @@ extern au_event_t sys_au_event[];
 
 #else /* !CONFIG_AUDIT */
 
+#define	AUDIT_ENABLED()		0
+
 #define	AUDIT_ARG(op, args...)	do {					\
 } while (0)
 
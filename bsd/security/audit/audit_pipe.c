@@ -70,7 +70,8 @@ static MALLOC_DEFINE(M_AUDIT_PIPE_PRESELECT, "audit_pipe_presel",
 #define	AUDIT_PIPE_QLIMIT_MAX		(1024)
 
 /*
- * Description of an entry in an audit_pipe.
+ * Description of an entry in an audit_pipe.  The record is allocated along
+ * with the entry and immediately follows it.
  */
 struct audit_pipe_entry {
 	void				*ape_record;
@@ -258,7 +259,6 @@ static void
 audit_pipe_entry_free(struct audit_pipe_entry *ape)
 {
 
-	free(ape->ape_record, M_AUDIT_PIPE_ENTRY);
 	free(ape, M_AUDIT_PIPE_ENTRY);
 }
 
@@ -448,8 +448,8 @@ audit_pipe_preselect(au_id_t auid, au_event_t event, au_class_t class,
 }
 
 /*
- * Append individual record to a queue -- allocate queue-local buffer, and
- * add to the queue.  If the queue is full or we can't allocate memory, drop
+ * Append individual record to a queue -- allocate a queue-local entry with
+ * room for the record, and add it to the queue.  If the queue is full or we can't allocate memory, drop
  * the newest record.
  */
 static void
@@ -465,21 +465,14 @@ audit_pipe_append(struct audit_pipe *ap, void *record, u_int record_len)
 		return;
 	}
 
-	ape = malloc(sizeof(*ape), M_AUDIT_PIPE_ENTRY, M_NOWAIT | M_ZERO);
+	ape = malloc(sizeof(*ape) + record_len, M_AUDIT_PIPE_ENTRY, M_NOWAIT);
 	if (ape == NULL) {
 		ap->ap_drops++;
 		audit_pipe_drops++;
 		return;
 	}
 
-	ape->ape_record = malloc(record_len, M_AUDIT_PIPE_ENTRY, M_NOWAIT);
-	if (ape->ape_record == NULL) {
-		free(ape, M_AUDIT_PIPE_ENTRY);
-		ap->ap_drops++;
-		audit_pipe_drops++;
-		return;
-	}
-
+	ape->ape_record = ape + 1;
 	bcopy(record, ape->ape_record, record_len);
 	ape->ape_record_len = record_len;
 
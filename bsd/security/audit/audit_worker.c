@@ -444,14 +444,9 @@ audit_worker(void)
 		 * signal any waiting processes that they may wake up and
 		 * continue generating records.
 		 */
-		lowater_signal = 0;
-		while ((ar = TAILQ_FIRST(&audit_q))) {
-			TAILQ_REMOVE(&audit_q, ar, k_q);
-			audit_q_len--;
-			if (audit_q_len == audit_qctrl.aq_lowater)
-				lowater_signal++;
-			TAILQ_INSERT_TAIL(&ar_worklist, ar, k_q);
-		}
+		lowater_signal = (audit_q_len > audit_qctrl.aq_lowater);
+		TAILQ_CONCAT(&ar_worklist, &audit_q, k_q);
+		audit_q_len = 0;
 		if (lowater_signal)
 			cv_broadcast(&audit_watermark_cv);
 
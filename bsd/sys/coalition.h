@@ -49,6 +49,7 @@ int coalition_reap(uint64_t cid, uint32_t flags);
 int coalition_info_resource_usage(uint64_t cid, struct coalition_resource_usage *cru, size_t sz);
 int coalition_info_set_name(uint64_t cid, const char *name, size_t size);
 int coalition_info_set_efficiency(uint64_t cid, uint64_t flags);
+int coalition_info_set_cpu_quota(uint64_t cid, uint64_t quota_ns, uint64_t period_ns);
 
 #else /* KERNEL */
 
@@ -36,6 +36,26 @@ typedef	volatile struct	commpage_timeofday_data{
 	uint64_t	Ticks_scale;
 	uint64_t	Ticks_per_sec;
 } new_commpage_timeofday_data_t;
+
+/*
+ * Runtime of the thread last dispatched on a CPU, published at
+ * _COMM_PAGE_THREAD_USAGE + cpu * sizeof(commpage_thread_usage_t) for
+ * threads that opted in with the kern.thread_commpage_usage sysctl.
+ *
+ * ctu_gen is odd while the kernel updates the entry.  A thread reads the
+ * cpu number, the entry's ctu_gen, the fields and mach_absolute_time(),
+ * and then ctu_gen and the cpu number again: if either changed, ctu_gen was
+ * odd or ctu_thread_id isn't its own thread id, the thread was preempted
+ * or migrated and must retry.  Otherwise its runtime is
+ * ctu_runtime + (now - ctu_dispatch), in mach_absolute_time() units.
+ */
+typedef volatile struct commpage_thread_usage {
+	uint32_t	ctu_gen;
+	uint32_t	ctu_c_switch;		/* context switches of the thread */
+	uint64_t	ctu_thread_id;		/* unique id of the thread, 0 if none */
+	uint64_t	ctu_runtime;		/* user + system time as of ctu_dispatch */
+	uint64_t	ctu_dispatch;		/* mach_absolute_time() of the dispatch */
+} commpage_thread_usage_t;
 #endif
 
 #endif
@@ -64,6 +64,7 @@ enum {
     DECMPDBG_FETCH_UNCOMPRESSED_DATA    = DECMPDBG_CODE(2), /* 0x03120008 */
     DECMPDBG_FREE_COMPRESSED_DATA       = DECMPDBG_CODE(4), /* 0x03120010 */
     DECMPDBG_FILE_IS_COMPRESSED         = DECMPDBG_CODE(5), /* 0x03120014 */
+    DECMPDBG_FETCH_PIECE                = DECMPDBG_CODE(6), /* 0x03120018 */
 };
 
 #define MAX_DECMPFS_XATTR_SIZE 3802
@@ -158,6 +158,33 @@ struct kevent_qos_s {
 	uint64_t	ext[4];		/* filter-specific extensions */
 };
 
+/*
+ * Shared delivery ring of a workloop (see KQ_WORKLOOP_RING_ATTACH).
+ *
+ * Once a ring is attached, EV_CLEAR knotes of filters that support it
+ * (currently EVFILT_USER) are posted into the ring when they fire
+ * instead of being queued on the workloop, and can be consumed without
+ * entering the kernel:
+ *
+ *	while (ring->kr_head != ring->kr_tail) {	// load-acquire kr_tail
+ *		ev = ring->kr_events[ring->kr_head & ring->kr_mask];
+ *		ring->kr_head++;			// store-release kr_head
+ *	}
+ *
+ * When the ring is full events are queued on the workloop as usual and
+ * kr_overflows is bumped, so that the consumer knows to drain it with
+ * kevent_id().  KQ_WORKLOOP_RING_WAIT blocks until the ring is non empty.
+ */
+struct kevent_ring {
+	volatile uint32_t	kr_head;	/* next entry to consume [user] */
+	volatile uint32_t	kr_tail;	/* next entry to produce [kernel] */
+	uint32_t		kr_mask;	/* number of entries - 1 */
+	uint32_t		kr_flags;
+	volatile uint64_t	kr_overflows;	/* events queued on the workloop instead */
+	uint64_t		kr_reserved[5];
+	struct kevent_qos_s	kr_events[];
+};
+
 /*
  * Type definition for names/ids of dynamically allocated kqueues.
  */
@@ -952,6 +979,7 @@ struct filterops {
 	bool    f_isfd;		      /* true if ident == filedescriptor */
 	bool    f_adjusts_qos;    /* true if the filter can override the knote */
 	bool    f_extended_codes; /* hooks return extended codes */
+	bool    f_ring_safe;      /* f_process never blocks, can run with the kq lock held */
 
 	int     (*f_attach)(struct knote *kn, struct kevent_internal_s *kev);
 	void    (*f_detach)(struct knote *kn);
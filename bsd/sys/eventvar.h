@@ -167,6 +167,8 @@ struct kqueue {
 #define KQ_DRAIN          0x200  /* kq is draining */
 #define KQ_WAKEUP         0x400  /* kq awakened while processing */
 #define KQ_DYNAMIC        0x800  /* kqueue is dynamically managed */
+#define KQ_POLLCACHE      0x1000 /* kqueue caches a poll() set */
+#define KQ_POLLSTALE      0x2000 /* a knote of the cached poll() set was dropped */
 /*
  * kqfile - definition of a typical kqueue opened as a file descriptor
  *          via the kqueue() system call.
@@ -302,6 +304,11 @@ struct kqworkloop {
 	uint64_t         kqwl_params;                     /* additional parameters */
 	struct turnstile *kqwl_turnstile;                 /* turnstile for sync IPC/waiters */
 	SLIST_ENTRY(kqworkloop) kqwl_hashlink;            /* linkage for search list */
+	struct kevent_ring *kqwl_ring;                    /* shared delivery ring (or NULL) */
+	vm_size_t        kqwl_ring_size;                  /* size of the ring allocation */
+	uint32_t         kqwl_ring_mask;                  /* kernel copy of kr_mask */
+	uint32_t         kqwl_ring_tail;                  /* kernel copy of kr_tail */
+	uint32_t         kqwl_ring_waiters;               /* threads in KQ_WORKLOOP_RING_WAIT */
 #if CONFIG_WORKLOOP_DEBUG
 #define KQWL_HISTORY_COUNT 32
 #define KQWL_HISTORY_WRITE_ENTRY(kqwl, ...) ({ \
@@ -367,6 +374,8 @@ extern workq_threadreq_param_t kqueue_threadreq_workloop_param(workq_threadreq_t
 
 extern struct kqueue *kqueue_alloc(struct proc *, unsigned int);
 extern void kqueue_dealloc(struct kqueue *);
+extern void kqueue_pollcache_begin(struct kqueue *);
+extern boolean_t kqueue_pollcache_valid(struct kqueue *);
 
 extern void knotes_dealloc(struct proc *);
 extern void kqworkloops_dealloc(struct proc *);
@@ -368,6 +368,11 @@
 
 #define F_TRIM_ACTIVE_FILE	100 /* Trim an active file */
 
+#ifdef PRIVATE
+#define F_GETRAHEADSTATS	101	/* Get the read ahead statistics of the file */
+#define F_GETWBSTATS		102	/* Get the write behind statistics of the file */
+#endif
+
 // FS-specific fcntl()'s numbers begin at 0x00010000 and go up
 #define FCNTL_FS_SPECIFIC_BASE  0x00010000
 
@@ -618,6 +623,26 @@ typedef struct ftrimactivefile {
 	off_t fta_length; /* IN: size of the region */
 } ftrimactivefile_t;
 
+#ifdef PRIVATE
+/* fraheadstats_t used by F_GETRAHEADSTATS */
+typedef struct fraheadstats {
+	uint64_t fra_prefetched;	/* OUT: pages read ahead */
+	uint64_t fra_hits;		/* OUT: read ahead pages the readers asked for */
+	uint64_t fra_wasted;		/* OUT: read ahead pages the readers did not ask for */
+	uint32_t fra_streams;		/* OUT: read streams currently tracked */
+	uint32_t fra_strided;		/* OUT: read aheads issued for strided streams */
+} fraheadstats_t;
+
+/* fwbstats_t used by F_GETWBSTATS */
+typedef struct fwbstats {
+	uint64_t fwb_sparse_switches;	/* OUT: switches to sparse dirty page tracking */
+	uint64_t fwb_sparse_ios;	/* OUT: I/Os pushed from the sparse map */
+	uint64_t fwb_sparse_pages;	/* OUT: pages pushed from the sparse map */
+	uint32_t fwb_clusters;		/* OUT: write behind clusters currently held */
+	uint32_t fwb_sparse;		/* OUT: dirty pages currently tracked sparsely */
+} fwbstats_t;
+#endif
+
 /* fbootstraptransfer_t used by F_READBOOTSTRAP and F_WRITEBOOTSTRAP commands */
 
 typedef struct fbootstraptransfer {
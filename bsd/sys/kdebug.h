@@ -451,11 +451,14 @@ extern void kdebug_reset(void);
 #define	MACH_UNPROMOTED            0x36 /* thread unpromoted due to mutex priority promotion */
 #define	MACH_PROMOTED_UPDATE       0x37 /* thread already promoted, but promotion priority changed */
 #define	MACH_QUIESCENT_COUNTER     0x38 /* quiescent counter tick */
+#define	MACH_SMR_RECLAIM           0x39 /* deferred smr frees reclaimed */
+#define	MACH_WORK_INTERVAL_OVERRUN 0x3a /* work interval finished past its deadline */
 
 /* Variants for MACH_MULTIQ_DEQUEUE */
 #define MACH_MULTIQ_BOUND     1
 #define MACH_MULTIQ_GROUP     2
 #define MACH_MULTIQ_GLOBAL    3
+#define MACH_MULTIQ_STARVED   4
 
 /* Arguments for vm_fault (DBG_MACH_VM) */
 #define DBG_ZERO_FILL_FAULT   1
@@ -734,6 +737,9 @@ extern void kdebug_reset(void);
 #define BSD_PROC_EXEC              3  /* process spawn / exec */
 #define BSD_PROC_EXITREASON_CREATE 4  /* exit reason creation */
 #define BSD_PROC_EXITREASON_COMMIT 5  /* exit reason commited to a proc */
+#define BSD_PROC_EXEC_LOAD         6  /* exec: load_machfile() */
+#define BSD_PROC_EXEC_DYLD         7  /* exec: dynamic linker loaded */
+#define BSD_PROC_EXEC_CODESIGN     8  /* exec: code signature loaded */
 
 /* Codes for BSD subcode class DBG_BSD_MEMSTAT */
 #define BSD_MEMSTAT_SCAN             1  /* memorystatus thread awake */
@@ -940,6 +946,7 @@ extern void kdebug_reset(void);
 /* Codes for TURNSTILE_PRIORITY_OPERATIONS */
 #define TURNSTILE_PRIORITY_CHANGE               0x1
 #define THREAD_USER_PROMOTION_CHANGE            0x2
+#define TURNSTILE_PRIORITY_CHAIN_WALK           0x3
 
 /* Codes for TURNSTILE_FREELIST_OPERATIONS */
 #define TURNSTILE_PREPARE                       0x1
@@ -1628,6 +1635,8 @@ kdbg_set_timestamp_and_cpu(kd_buf *kp, uint64_t thetime, int cpu)
 #define KDBG_LOCKINIT   (1U << 7)
 /* word size of the kernel */
 #define KDBG_LP64       (1U << 8)
+/* processes with kdebug bit set in proc bypass the event filters */
+#define KDBG_PIDVERBOSE (1U << 9)
 
 /* bits for kd_ctrl_page.flags and kbufinfo_t.flags */
 
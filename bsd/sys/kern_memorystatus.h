@@ -289,6 +289,8 @@ int memorystatus_control(uint32_t command, int32_t pid, uint32_t flags, void *bu
 #endif /* DEVELOPMENT || DEBUG */
 #endif /* CONFIG_FREEZE */
 
+#define MEMORYSTATUS_CMD_GET_PRESSURE_FORECAST        21   /* Return the memory pressure forecast, see memorystatus_pressure_forecast_t */
+
 /* Commands that act on a group of processes */
 #define MEMORYSTATUS_CMD_GRP_SET_PROPERTIES           100
 
@@ -376,6 +378,22 @@ typedef struct memorystatus_memlimit_properties {
 
 #define MEMORYSTATUS_MEMLIMIT_ATTR_FATAL	0x1	/* if set, exceeding the memlimit is fatal */
 
+/*
+ * For use with memorystatus_control:
+ * MEMORYSTATUS_CMD_GET_PRESSURE_FORECAST
+ */
+typedef struct memorystatus_pressure_forecast {
+	uint32_t level;			/* current pressure level, as a NOTE_MEMORYSTATUS_PRESSURE_* value */
+	uint32_t forecast_level;	/* level expected within the forecast horizon */
+	uint64_t available_pages;	/* memory available before the critical threshold applies */
+	uint64_t critical_pages;	/* critical threshold */
+	int64_t  trend;			/* smoothed change in available pages per second */
+	uint32_t secs_to_critical;	/* at the current trend, UINT32_MAX if not declining */
+	uint32_t horizon_secs;		/* pressure is raised early within this horizon, 0 if disabled */
+	uint32_t refault_rate;		/* compressor working set refaults per second */
+	uint32_t early_warnings;	/* times pressure was raised on the forecast alone */
+} memorystatus_pressure_forecast_t;
+
 #ifdef XNU_KERNEL_PRIVATE
 
 /*
@@ -488,6 +506,7 @@ void memorystatus_fast_jetsam_override(boolean_t enable_override);
 #endif /* CONFIG_JETSAM */
 
 boolean_t memorystatus_kill_on_zone_map_exhaustion(pid_t pid);
+void memorystatus_on_zone_map_warning(void);
 boolean_t memorystatus_kill_on_VM_compressor_space_shortage(boolean_t async);
 void memorystatus_pages_update(unsigned int pages_avail);
 
@@ -1903,6 +1903,11 @@ extern errno_t mbuf_get_flowid(mbuf_t mbuf, u_int16_t *flowid);
 /*!
 	@function mbuf_set_flowid
 	@discussion Set the flow ID of the packet .
+		On input, drivers with multiple receive queues may set the
+		flow ID to the packet's RSS hash or receive queue index
+		before calling ifnet_input or ifnet_input_extended; when
+		DLIL input steering threads are configured, such packets
+		are spread across them by flow ID.
 	@param mbuf The mbuf representing the packet.
 	@param flowid The flow ID to be set.
 	@result 0 upon success otherwise the errno error. If the mbuf
@@ -89,7 +89,16 @@ extern "C" {
 #define	LS_LCK_RW_LOCK_EXCL_TO_SHARED_DOWNGRADE	37
 #define	LS_LCK_RW_LOCK_EXCL_TO_SHARED_ILK_SPIN	38
 
-#define	LS_NPROBES			40
+/*
+ * Read-mostly locks only have distinct probes for what the underlying
+ * rw lock doesn't already report.
+ */
+#define	LS_LCK_RM_LOCK_SHARED_ACQUIRE		40
+#define	LS_LCK_RM_LOCK_EXCL_ACQUIRE		41
+#define	LS_LCK_RM_LOCK_EXCL_BLOCK		42
+#define	LS_LCK_RM_DONE_RELEASE			43
+
+#define	LS_NPROBES			44
 #define LS_LCK_INVALID			LS_NPROBES
 
 /*
@@ -115,6 +124,9 @@ extern "C" {
 #define	LS_LCK_RW_TRY_LOCK_SHARED	"lck_rw_try_lock_shared"
 #define	LS_LCK_RW_LOCK_SHARED_TO_EXCL	"lck_rw_shared_to_exclusive"
 #define	LS_LCK_RW_LOCK_EXCL_TO_SHARED	"lck_rw_exclusive_to_shared"
+#define	LS_LCK_RM_LOCK_SHARED		"lck_rm_lock_shared"
+#define	LS_LCK_RM_LOCK_EXCL		"lck_rm_lock_exclusive"
+#define	LS_LCK_RM_DONE			"lck_rm_done"
 
 #define	LS_ACQUIRE			"acquire"
 #define	LS_RELEASE			"release"
@@ -312,8 +312,8 @@ struct driver_mtag_ {
  *
  * Care must be taken to ensure that they are mutually exclusive, e.g.
  * IPSec policy ID implies no TCP segment offload (which is fine given
- * that the former is used on the virtual ipsec interface that does
- * not advertise the TSO capability.)
+ * that the virtual ipsec interface segments TSO frames in software
+ * before they reach IPSec.)
  */
 struct proto_mtag_ {
 	union {
@@ -434,6 +434,7 @@ struct pkthdr {
 #define	bufstatus_sndbuf	_pkt_bsr.sndbuf_data
 	};
 	u_int64_t pkt_timestamp;	/* enqueue time */
+	u_int64_t pkt_txtime;		/* earliest departure time, 0 if none */
 
 	/*
 	 * Tags (external and built-in)
@@ -1125,7 +1126,13 @@ typedef struct mb_class_stat {
 	u_int32_t	mbcl_mc_wretry_cnt;  /* # of wait retries */
 	u_int32_t	mbcl_mc_nwretry_cnt; /* # of no-wait retry attempts */
 	u_int32_t	mbcl_peak_reported; /* last usage peak reported */
-	u_int32_t	mbcl_reserved[7];    /* for future use */
+	/*
+	 * Lock contention statistics
+	 */
+	u_int32_t	mbcl_slab_contention; /* # of contended slab locks */
+	u_int32_t	mbcl_mc_bkt_contention; /* # of contended bucket locks */
+	u_int32_t	mbcl_mc_batch_cnt; /* # of batched CPU cache refills */
+	u_int32_t	mbcl_reserved[4];    /* for future use */
 } mb_class_stat_t;
 
 #define	MCS_DISABLED	0	/* cache is permanently disabled */
@@ -1517,6 +1524,8 @@ __private_extern__ mbuf_traffic_class_t m_get_traffic_class(struct mbuf *);
 __private_extern__ u_int16_t m_adj_sum16(struct mbuf *, u_int32_t,
     u_int32_t, u_int32_t, u_int32_t);
 __private_extern__ u_int16_t m_sum16(struct mbuf *, u_int32_t, u_int32_t);
+__private_extern__ u_int16_t m_copydata_sum(struct mbuf *, u_int32_t,
+    u_int32_t, void *);
 
 __private_extern__ void m_set_ext(struct mbuf *, struct ext_ref *,
     m_ext_free_func_t, caddr_t);
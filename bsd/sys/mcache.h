@@ -225,12 +225,19 @@ extern "C" {
  * exhausted all possible schemes to fulfill the request, including doing
  * reclaims and/or purges, before returning to the caller.
  *
+ * MCR_BATCH is passed by the CPU layer to the slab allocation callback of
+ * an MCF_BATCHREFILL cache, when it asks for a bucket's worth of objects
+ * beyond what the caller needs.  Only the first object is subject to the
+ * other request flags; the rest should be taken from whatever the slab
+ * layer has at hand, without blocking, populating or counting failures.
+ *
  * Regular mcache clients should only use MCR_SLEEP or MCR_NOSLEEP.
  */
 #define	MCR_SLEEP	0x0000		/* same as M_WAITOK */
 #define	MCR_NOSLEEP	0x0001		/* same as M_NOWAIT */
 #define	MCR_FAILOK	0x0100		/* private, for internal use only */
 #define	MCR_TRYHARD	0x0200		/* private, for internal use only */
+#define	MCR_BATCH	0x0400		/* private, for internal use only */
 #define	MCR_USR1	0x1000		/* private, for internal use only */
 
 #define	MCR_NONBLOCKING	(MCR_NOSLEEP | MCR_FAILOK | MCR_TRYHARD)
@@ -304,6 +311,7 @@ typedef struct mcache {
 	u_int32_t	mc_wretry_cnt;	/* # of wait retries */
 	u_int32_t	mc_nwretry_cnt;	/* # of no-wait retry attempts */
 	u_int32_t	mc_nwfail_cnt;	/* # of no-wait retries that failed */
+	u_int32_t	mc_batch_cnt;	/* # of CPU refills from slab batches */
 	decl_lck_mtx_data(, mc_sync_lock); /* protects purges and reenables */
 	lck_attr_t	*mc_sync_lock_attr;
 	lck_grp_t	*mc_sync_lock_grp;
@@ -344,10 +352,12 @@ typedef struct mcache {
 #define	MCF_NOCPUCACHE	0x00000010	/* disable CPU layer caching */
 #define	MCF_NOLEAKLOG	0x00000100	/* disable leak logging */
 #define	MCF_EXPLEAKLOG	0x00000200	/* expose leak info to user space */
+#define	MCF_BATCHREFILL	0x00000400	/* refill CPU layer in slab batches */
 
 #define	MCF_DEBUG	(MCF_VERIFY | MCF_TRACE)
 #define	MCF_FLAGS_MASK	\
-	(MCF_DEBUG | MCF_NOCPUCACHE | MCF_NOLEAKLOG | MCF_EXPLEAKLOG)
+	(MCF_DEBUG | MCF_NOCPUCACHE | MCF_NOLEAKLOG | MCF_EXPLEAKLOG | \
+	    MCF_BATCHREFILL)
 
 /* Valid values for notify callback */
 #define	MCN_RETRYALLOC	0x00000001	/* Allocation should be retried */
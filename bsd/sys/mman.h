@@ -193,6 +193,7 @@
 #define MADV_FREE_REUSE		8	/* caller wants to reuse those pages */
 #define MADV_CAN_REUSE		9
 #define MADV_PAGEOUT		10	/* page out now (internal only) */
+#define MADV_FAULTAROUND	11	/* map resident neighbouring pages on fault */
 
 /*
  * Return bits from mincore
@@ -81,6 +81,7 @@ extern struct	msgbuf *msgbufp;
 extern struct	msgbuf *aslbufp;
 extern void log_putc(char);
 extern void log_putc_locked(struct msgbuf *, char);
+extern void log_puts_locked(struct msgbuf *, const char *, size_t);
 extern int log_setsize(int size);
 extern int log_dmesg(user_addr_t, uint32_t, int32_t *);
 __END_DECLS
@@ -292,6 +292,8 @@ struct	nchstats {
         long	ncs_enters;
         long	ncs_deletes;
         long	ncs_badvid;
+	long	ncs_lockless;		/* paths walked without the namecache lock */
+	long	ncs_lockless_retries;	/* lockless walks that had to be revalidated */
 };
 #endif /* BSD_KERNEL_PRIVATE */
 
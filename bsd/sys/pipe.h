@@ -93,6 +93,19 @@
 
 #define PIPENPAGES	(BIG_PIPE_SIZE / PAGE_SIZE + 1)
 
+/*
+ * Writes of at least PIPE_DIRECT_MIN bytes from a single user buffer are
+ * handed to the reader through a kernel mapping of the writer's pages,
+ * PIPE_DIRECT_MAX bytes at a time.
+ */
+#ifndef PIPE_DIRECT_MIN
+#define PIPE_DIRECT_MIN	BIG_PIPE_SIZE
+#endif
+
+#ifndef PIPE_DIRECT_MAX
+#define PIPE_DIRECT_MAX	(1024 * 1024)
+#endif
+
 /*
  * Pipe buffer information.
  * Separate in, out, cnt are used to simplify calculations.
@@ -107,19 +120,6 @@ struct pipebuf {
 };
 
 
-#ifdef PIPE_DIRECT
-/*
- * Information to support direct transfers between processes for pipes.
- */
-struct pipemapping {
-	vm_offset_t	kva;		/* kernel virtual address */
-	vm_size_t	cnt;		/* number of chars in buffer */
-	vm_size_t	pos;		/* current position of transfer */
-	int		npages;		/* number of pages */
-	vm_page_t	ms[PIPENPAGES];	/* pages in source process */
-};
-#endif
-
 /*
  * Bits in pipe_state.
  */
@@ -143,15 +143,25 @@ struct pipemapping {
 
 struct label;
 
+/*
+ * Information to support direct transfers between processes for pipes:
+ * a copy of the writer's data mapped in the kernel map until the reader
+ * has consumed it.  Direct write is active when PIPE_DIRECTW is set.
+ */
+struct pipemapping {
+	vm_offset_t	kva;		/* kernel virtual address of the data */
+	vm_size_t	size;		/* size of the data */
+	vm_size_t	cnt;		/* number of chars left to transfer */
+	vm_size_t	pos;		/* current position of transfer */
+};
+
 /*
  * Per-pipe data structure.
  * Two of these are linked together to produce bi-directional pipes.
  */
 struct pipe {
 	struct	pipebuf pipe_buffer;	/* data storage */
-#ifdef PIPE_DIRECT
 	struct	pipemapping pipe_map;	/* pipe mapping for direct I/O */
-#endif
 	struct	selinfo pipe_sel;	/* for compat with select */
 	pid_t	pipe_pgid;		/* information for async I/O */
 	struct	pipe *pipe_peer;	/* link with other direction */
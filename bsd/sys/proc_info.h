@@ -936,6 +936,20 @@ struct proc_fileportinfo {
 #define PROC_INFO_CALL_CANUSEFGHW        0xc
 #define PROC_INFO_CALL_PIDDYNKQUEUEINFO  0xd
 #define PROC_INFO_CALL_UDATA_INFO        0xe
+#define PROC_INFO_CALL_SNAPSHOT          0xf
+
+/*
+ * flags for PROC_INFO_CALL_SNAPSHOT: which information to return for each
+ * process, in a KCDATA_BUFFER_BEGIN_PROCINFO kcdata buffer
+ */
+#define PROC_SNAPSHOT_BSDSHORTINFO       0x1 /* PROCINFO_KCTYPE_BSDSHORTINFO */
+#define PROC_SNAPSHOT_UNIQIDENTIFIERINFO 0x2 /* PROCINFO_KCTYPE_UNIQIDENTIFIERINFO */
+#define PROC_SNAPSHOT_TASKINFO           0x4 /* PROCINFO_KCTYPE_TASKINFO */
+#define PROC_SNAPSHOT_THREADINFO         0x8 /* PROCINFO_KCTYPE_THREADIDS and PROCINFO_KCTYPE_THREADINFO */
+#define PROC_SNAPSHOT_ALL                0xf
+
+/* largest buffer used by a PROC_INFO_CALL_SNAPSHOT call */
+#define PROC_SNAPSHOT_MAXSIZE            (16 * 1024 * 1024)
 #endif /* PRIVATE */
 
 #ifdef XNU_KERNEL_PRIVATE
@@ -82,6 +82,7 @@
 
 __BEGIN_DECLS
 #include <kern/locks.h>
+#include <kern/smr.h>
 #if PSYNCH
 #include <kern/thread_call.h>
 #endif /* PSYNCH */
@@ -219,7 +220,7 @@ struct	proc {
 	LIST_HEAD(, proc) p_children;		/* Pointer to list of children. (LL)*/
 	TAILQ_HEAD( , uthread) p_uthlist; 	/* List of uthreads  (PL) */
 
-	LIST_ENTRY(proc) p_hash;		/* Hash chain. (LL)*/
+	LIST_ENTRY(proc) p_hash;		/* Hash chain. (LL, smr_system readers)*/
 	TAILQ_HEAD( ,eventqelt) p_evlist;	/* (PL) */
 
 #if CONFIG_PERSONAS
@@ -247,7 +248,7 @@ struct	proc {
 	unsigned int	p_lflag;		/* local flags  (PL) */
 	unsigned int	p_listflag;		/* list flags (LL) */
 	unsigned int	p_ladvflag;		/* local adv flags (atomic) */
-	int		p_refcount;		/* number of outstanding users(LL) */
+	uint32_t	p_refcount;		/* number of outstanding users and P_REF_LOCKED (LL, atomic) */
 	int		p_childrencnt;		/* children holding ref on parent (LL) */
 	int		p_parentref;		/* children lookup ref on parent (LL) */
 	pid_t		p_oppid;	 	/* Save parent pid during ptrace. XXX */
@@ -410,6 +411,8 @@ struct	proc {
 #if !CONFIG_EMBEDDED
 	uint64_t	p_user_data;			/* general-purpose storage for userland-provided data */
 #endif /* !CONFIG_EMBEDDED */
+
+	struct smr_node	p_smr;			/* deferred free once out of the pid hash, see proc_free() */
 };
 
 #define PGRPID_DEAD 0xdeaddead
@@ -436,6 +439,16 @@ struct	proc {
 #define P_LIST_EXITCOUNT 		0x00100000	/* counted for process exit */
 #define P_LIST_REFWAIT   		0x00200000	/* wait to take a ref */
  
+/*
+ * p_refcount; references can be taken without the proc_list_lock only while
+ * P_REF_LOCKED is clear, which it is unless one of P_LIST_REF_LOCKED is set
+ * or the process is a zombie.
+ */
+#define P_REF_COUNT_MASK		0x7fffffffU
+#define P_REF_LOCKED			0x80000000U	/* proc_ref_locked() decides */
+#define P_LIST_REF_LOCKED		(P_LIST_INCREATE | P_LIST_EXITED | P_LIST_DEAD | \
+					 P_LIST_DRAIN | P_LIST_DRAINWAIT | P_LIST_REFWAIT)
+
 
 /* local flags */
 #define	P_LDELAYTERM	0x00000001	/* */
@@ -722,6 +735,9 @@ extern void vfork_exit_internal(struct proc *p, int rv, int forced);
 extern void proc_reparentlocked(struct proc *child, struct proc * newparent, int cansignal, int locked);
 
 extern proc_t proc_findinternal(int pid, int locked);
+extern void proc_ref_update_locked(proc_t p);
+extern void pidhash_insert_locked(proc_t p);
+extern void proc_free(proc_t p);
 extern proc_t proc_findthread(thread_t thread);
 extern void proc_refdrain(proc_t);
 extern proc_t proc_refdrain_with_refwait(proc_t p, boolean_t get_ref_and_allow_wait);
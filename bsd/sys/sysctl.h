@@ -619,7 +619,8 @@ SYSCTL_DECL(_hw_features);
 #define KERN_KDSET_TYPEFILTER 22
 #define KERN_KDBUFWAIT        23
 #define KERN_KDCPUMAP         24
-/* 25 - 26 unused */
+#define KERN_KDCPULOST        25
+#define KERN_KDPIDVERBOSE     26
 #define KERN_KDWRITEMAP_V3    27
 #define KERN_KDWRITETR_V3     28
 
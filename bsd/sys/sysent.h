@@ -35,6 +35,8 @@
 #ifdef KERNEL_PRIVATE
 #ifdef __APPLE_API_PRIVATE
 
+#include <sys/syscall.h>
+
 typedef	int32_t	sy_call_t(struct proc *, void *, int *);
 #if CONFIG_REQUIRES_U32_MUNGING
 typedef	void	sy_munge_t(void *);
@@ -79,6 +81,29 @@ extern unsigned int nsysent;
 #define _SYSCALL_RET_SSIZE_T	6	
 #define _SYSCALL_RET_UINT64_T	7
 
+/*
+ * System calls that take no arguments and only read state of the calling
+ * process or thread: they don't use the credential, can't block, sleep,
+ * fail with ERESTART or issue I/O.  The syscall dispatchers may skip the
+ * credential update and the cancellation and I/O throttling bookkeeping
+ * around them, and when auditing is off, the audit hooks.
+ */
+static inline int
+syscall_is_light(unsigned int code)
+{
+	switch (code) {
+	case SYS_getpid:
+	case SYS_getppid:
+	case SYS_getpgrp:
+	case SYS_issetugid:
+	case SYS_thread_selfid:
+	case SYS_thread_selfusage:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
 #endif /* __APPLE_API_PRIVATE */
 #endif /* KERNEL_PRIVATE */
 
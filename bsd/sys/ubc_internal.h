@@ -76,11 +76,24 @@ struct cl_wextent {
         int		io_flags;
 };
 
+#define CL_RA_STREAMS	4		/* read streams tracked per file */
+
 struct cl_readahead {
 	lck_mtx_t	cl_lockr;
 	daddr64_t	cl_lastr;			/* last block read by client */
 	daddr64_t	cl_maxra;			/* last block prefetched by the read ahead */
 	int		cl_ralen;			/* length of last prefetch */
+	daddr64_t	cl_lastb;			/* first block of the last read by client */
+	daddr64_t	cl_stride;			/* distance between the last two reads */
+	uint32_t	cl_lastuse;			/* cl_rausegen at the last read */
+};
+
+struct cl_rastreams {
+	struct cl_readahead cl_streams[CL_RA_STREAMS];	/* one context per read stream */
+	uint32_t	cl_rausegen;			/* generation of the last read, for recycling */
+	uint64_t	cl_raprefetched;		/* pages read ahead */
+	uint64_t	cl_rahits;			/* read ahead pages asked for by readers */
+	uint64_t	cl_rastrided;			/* read aheads issued for strided streams */
 };
 
 struct cl_writebehind {
@@ -92,6 +105,9 @@ struct cl_writebehind {
 	int		cl_sparse_wait;			/* synchronous push is in progress */
 	int		cl_number;			/* number of packed write behind clusters currently valid */
 	struct cl_wextent cl_clusters[MAX_CLUSTERS];	/* packed write behind clusters */
+	uint64_t	cl_sparse_switches;		/* switches to the sparse cluster map */
+	uint64_t	cl_sparse_ios;			/* I/Os pushed from the sparse cluster map */
+	uint64_t	cl_sparse_pages;		/* pages pushed from the sparse cluster map */
 };
 
 struct cs_hash;
@@ -140,7 +156,7 @@ struct ubc_info {
 	uint32_t		ui_flags;	/* flags */
 	uint32_t		cs_add_gen;	/* generation count when csblob was validated */
 
-        struct	cl_readahead   *cl_rahead;	/* cluster read ahead context */
+        struct	cl_rastreams   *cl_rahead;	/* cluster read ahead contexts */
         struct	cl_writebehind *cl_wbehind;	/* cluster write behind context */
 
 	struct timespec		cs_mtime;	/* modify time of file when
@@ -179,6 +195,10 @@ __private_extern__ void	ubc_destroy_named(vnode_t);
 
 /* internal only */
 __private_extern__ void	cluster_release(struct ubc_info *);
+struct fraheadstats;
+__private_extern__ void	cluster_get_rahead_stats(vnode_t, struct fraheadstats *);
+struct fwbstats;
+__private_extern__ void	cluster_get_wbehind_stats(vnode_t, struct fwbstats *);
 __private_extern__ uint32_t cluster_throttle_io_limit(vnode_t, uint32_t *);
 
 
@@ -87,7 +87,7 @@ struct label;
  * it or copies of it be exported outside.
  */
 struct ucred {
-	TAILQ_ENTRY(ucred)	cr_link; /* never modify this without KAUTH_CRED_HASH_LOCK */
+	TAILQ_ENTRY(ucred)	cr_link; /* never modify this without its bucket's KAUTH_CRED_HASH_LOCK */
 	u_long	cr_ref;			/* reference count */
 	
 struct posix_cred {
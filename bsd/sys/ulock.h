@@ -78,9 +78,17 @@ extern int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
 
 /*
  * operation bits [15, 8] contain the flags for __ulock_wake
+ *
+ * @const ULF_WAKE_REQUEUE
+ * Only valid for UL_COMPARE_AND_WAIT: wake one waiter, and leave the other
+ * waiters asleep until the UL_COMPARE_AND_WAIT word at wake_value (typically
+ * the mutex protecting a condition) is woken up and has no waiters of its
+ * own, at which point they are released one at a time.  The caller must
+ * have marked that word as contended so that its unlock calls __ulock_wake.
  */
 #define ULF_WAKE_ALL					0x00000100
 #define ULF_WAKE_THREAD					0x00000200
+#define ULF_WAKE_REQUEUE				0x00000400
 
 /*
  * operation bits [23, 16] contain the flags for __ulock_wait
@@ -114,6 +122,7 @@ extern int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
 
 #define ULF_WAKE_MASK		(ULF_WAKE_ALL | \
 							 ULF_WAKE_THREAD | \
+							 ULF_WAKE_REQUEUE | \
 							 ULF_NO_ERRNO)
 
 #endif /* PRIVATE */
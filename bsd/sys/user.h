@@ -221,6 +221,9 @@ struct uthread {
 	void * uu_userstate;
 	struct waitq_set *uu_wqset;		/* waitq state cached across select calls */
 	size_t uu_wqstate_sz;			/* ...size of uu_wqset buffer */
+	struct kqueue *uu_pollkq;		/* kqueue cached across poll calls */
+	struct pollfd *uu_pollset;		/* ...the set registered in it */
+	u_int uu_pollnfds;			/* ...number of entries in uu_pollset */
 	int uu_flag;
 	sigset_t uu_siglist;				/* signals pending for the thread */
 	sigset_t uu_sigwait;				/*  sigwait on this thread*/
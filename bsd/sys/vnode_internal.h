@@ -282,6 +282,8 @@ struct fd_vn_data {
 	off_t     fv_soff;   /* Starting FS offset for this buffer */
 	off_t     fv_eoff;   /* Ending FS offset for this buffer */
 	int       fv_eofflag;/* Does fv_eoff represent EOF ? */
+	caddr_t   fv_attrbuf; /* ATTR_MAX_BUFFER sized buffer to pack an entry's attributes */
+	caddr_t   fv_namebuf; /* MAXPATHLEN sized buffer for an entry's name */
 };
 
 /*
@@ -487,7 +489,10 @@ void	name_cache_unlock(void);
 void	cache_enter_with_gen(vnode_t dvp, vnode_t vp, struct componentname *cnp, int gen);
 const char *cache_enter_create(vnode_t dvp, vnode_t vp, struct componentname *cnp);
 
+void	cache_lookup_lockless_quiesce(void);
+
 extern int nc_disabled; 	
+extern int nc_lockless_lookup;
 
 #define	vnode_lock_convert(v)	lck_mtx_convert_spin(&(v)->v_lock)
 
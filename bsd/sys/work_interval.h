@@ -218,6 +218,28 @@ int     work_interval_join_port(mach_port_t port);
  */
 int     work_interval_leave(void);
 
+/*
+ * Declare that each instance of the work interval needs at most
+ * 'budget' of CPU time every 'period', both in mach absolute time units.
+ * The threads that joined the interval are then scheduled as realtime
+ * threads, earliest deadline first, in the order of their periods.
+ *
+ * The total budget admitted across the system is limited, and this fails
+ * with EBUSY if the interval doesn't fit.  A budget of 0 takes the work
+ * interval out of realtime scheduling.
+ *
+ * Only the process which created the work interval may set its budget,
+ * from a thread that has joined it.
+ */
+int     work_interval_set_budget(work_interval_t interval_handle,
+                                 uint64_t period, uint64_t budget);
+
+/*
+ * Number of times the work interval was notified with a finish time
+ * past its deadline.
+ */
+int     work_interval_get_overruns(work_interval_t interval_handle, uint64_t *overruns);
+
 #endif /* !KERNEL */
 
 #if PRIVATE
@@ -228,6 +250,8 @@ int     work_interval_leave(void);
 #define WORK_INTERVAL_OPERATION_NOTIFY  0x00000003      /* arg is a work_interval_notification_t */
 #define WORK_INTERVAL_OPERATION_CREATE2 0x00000004      /* arg is a work_interval_create_params */
 #define WORK_INTERVAL_OPERATION_JOIN    0x00000005      /* arg is a port_name */
+#define WORK_INTERVAL_OPERATION_SET_BUDGET 0x00000006   /* arg is a work_interval_budget */
+#define WORK_INTERVAL_OPERATION_GET_OVERRUNS 0x00000007 /* arg is a uint64_t */
 
 struct work_interval_notification {
 	uint64_t	start;
@@ -245,6 +269,11 @@ struct work_interval_create_params {
 	uint32_t        wicp_create_flags;
 };
 
+struct work_interval_budget {
+	uint64_t        wib_period;
+	uint64_t        wib_budget;
+};
+
 
 int     __work_interval_ctl(uint32_t operation, uint64_t work_interval_id, void *arg, size_t len);
 
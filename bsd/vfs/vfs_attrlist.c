@@ -3497,7 +3497,15 @@ readdirattr(vnode_t dvp, struct fd_vn_data *fvd, uio_t auio,
 		return (error);
 	}
 
-	MALLOC(kern_attr_buf, caddr_t, kern_attr_buf_siz, M_TEMP, M_WAITOK);
+	/*
+	 * The buffer is kept with the directory's enumeration state so that
+	 * a scan doesn't allocate and free it on every call.
+	 */
+	if (!fvd->fv_attrbuf) {
+		MALLOC(fvd->fv_attrbuf, caddr_t, ATTR_MAX_BUFFER, M_FD_DIRBUF,
+		    M_WAITOK);
+	}
+	kern_attr_buf = fvd->fv_attrbuf;
 
 	while (uio_resid(auio) > (user_ssize_t)MIN_BUF_SIZE_REQUIRED) {
 		struct direntry *dp;
@@ -3536,8 +3544,11 @@ readdirattr(vnode_t dvp, struct fd_vn_data *fvd, uio_t auio,
 		 */
 		if (dp->d_name[dp->d_namlen] != '\0') {
 			if (!max_path_name_buf) {
-				MALLOC(max_path_name_buf, caddr_t, MAXPATHLEN,
-				    M_TEMP, M_WAITOK);
+				if (!fvd->fv_namebuf) {
+					MALLOC(fvd->fv_namebuf, caddr_t,
+					    MAXPATHLEN, M_FD_DIRBUF, M_WAITOK);
+				}
+				max_path_name_buf = fvd->fv_namebuf;
 			}
 			bcopy(dp->d_name, max_path_name_buf, dp->d_namlen);
 			max_path_name_buf[dp->d_namlen] = '\0';
@@ -3669,15 +3680,6 @@ readdirattr(vnode_t dvp, struct fd_vn_data *fvd, uio_t auio,
 		direntry_done(fvd);
 	}
 
-	if (max_path_name_buf) {
-		FREE(max_path_name_buf, M_TEMP);
-	}
-
-	/*
-	 * At this point, kern_attr_buf is always allocated
-	 */
-	FREE(kern_attr_buf, M_TEMP);
-
 	/*
 	 * Always set the offset to the last succesful offset
 	 * returned by VNOP_READDIR.
@@ -3864,8 +3866,12 @@ getattrlistbulk(proc_t p, struct getattrlistbulk_args *uap, int32_t *retval)
 			count = 0;
 
 			VATTR_INIT(&va);
-			MALLOC(va_name, char *, MAXPATHLEN, M_TEMP,
-			    M_WAITOK | M_ZERO);
+			if (!fvdata->fv_namebuf) {
+				MALLOC(fvdata->fv_namebuf, caddr_t, MAXPATHLEN,
+				    M_FD_DIRBUF, M_WAITOK);
+			}
+			va_name = fvdata->fv_namebuf;
+			va_name[0] = '\0';
 			va.va_name = va_name;
 
 			(void)getattrlist_setupvattr_all(&al, &va, VNON, NULL,
@@ -3880,8 +3886,6 @@ getattrlistbulk(proc_t p, struct getattrlistbulk_args *uap, int32_t *retval)
 			    options, &eofflag, &count, ctx);
 			ut->uu_flag &= ~UT_KERN_RAGE_VNODES;
 
-			FREE(va_name, M_TEMP);
-
 			/*
 			 * cache state of eofflag.
 			 */
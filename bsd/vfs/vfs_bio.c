@@ -153,6 +153,14 @@ u_long	bufhash;
 
 static buf_t	incore_locked(vnode_t vp, daddr64_t blkno, struct bufhashhdr *dp);
 
+/*
+ * Unlocked peek at a hash chain, for lookups that can do without the
+ * answer being stable: an empty chain means the block isn't cached, and
+ * buf_mtxp need not be taken to find that out.  Only the chain head is
+ * read, no buffer is dereferenced.
+ */
+#define	BUFHASH_EMPTY(dp)	(*(struct buf * volatile *)&(dp)->lh_first == NULL)
+
 /* Definitions for the buffer stats. */
 struct bufstats bufstats;
 
@@ -2847,6 +2855,9 @@ incore(vnode_t vp, daddr64_t blkno)
 
 	dp = BUFHASH(vp, blkno);
 
+	if (BUFHASH_EMPTY(dp))
+	        return (FALSE);
+
 	lck_mtx_lock_spin(buf_mtxp);
 
 	if (incore_locked(vp, blkno, dp))
@@ -2883,6 +2894,9 @@ buf_wait_for_shadow_io(vnode_t vp, daddr64_t blkno)
 
 	dp = BUFHASH(vp, blkno);
 
+	if (BUFHASH_EMPTY(dp))
+		return;
+
 	lck_mtx_lock_spin(buf_mtxp);
 
 	for (;;) {
@@ -2927,6 +2941,14 @@ buf_getblk(vnode_t vp, daddr64_t blkno, int size, int slpflag, int slptimeo, int
 	ret_only_valid = operation & BLK_ONLYVALID;
 	operation &= ~BLK_ONLYVALID;
 	dp = BUFHASH(vp, blkno);
+
+	if (ret_only_valid && BUFHASH_EMPTY(dp)) {
+		/*
+		 * nothing cached on this chain... a buffer created
+		 * concurrently isn't valid yet anyway
+		 */
+		return (NULL);
+	}
 start:
 	lck_mtx_lock_spin(buf_mtxp);
 
@@ -83,6 +83,9 @@
 #include <sys/user.h>
 #include <sys/paths.h>
 #include <os/overflow.h>
+#include <machine/atomic.h>
+#include <kern/cpu_number.h>
+#include <kern/clock.h>
 
 #if CONFIG_MACF
 #include <security/mac_framework.h>
@@ -103,6 +106,20 @@
  * Upon reaching the last segment of a path, if the reference
  * is for DELETE, or NOCACHE is set (rewrite), and the
  * name is located in the cache, it will be dropped.
+ *
+ * All of the name cache state is protected by namecache_rw_lock.  In
+ * addition, each hash chain is protected by one of the nchash_mtx_locks,
+ * which writers take (with the namecache lock held exclusive) whenever
+ * they link or unlink an entry.  This lets cache_lookup_path() walk a
+ * path without taking the namecache lock at all: every hash chain is
+ * searched with only its bucket lock held, and everything else read
+ * along the way (v_parent, v_cred, v_authorized_actions, ...) is
+ * validated against namecache_seq, which is odd whenever the namecache
+ * lock is held exclusive and bumped again when it is dropped.  When the
+ * validation fails the walk is retried, and eventually falls back to
+ * holding the namecache lock shared.  Vnodes are never freed, so reading
+ * a stale one is harmless; mounts are, so mount teardown waits for the
+ * lockless readers in flight with cache_lookup_lockless_quiesce().
  */
 
 /*
@@ -117,6 +134,7 @@ int 	desiredNodes;
 int 	desiredNegNodes;
 int	ncs_negtotal;
 int	nc_disabled = 0;
+int	nc_lockless_lookup = 1;		/* kern.namecache_lockless */
 TAILQ_HEAD(, namecache) nchead;		/* chain of all name cache entries */
 TAILQ_HEAD(, namecache) neghead;	/* chain of only negative cache entries */
 
@@ -125,22 +143,24 @@ TAILQ_HEAD(, namecache) neghead;	/* chain of only negative cache entries */
 
 struct	nchstats nchstats;		/* cache effectiveness statistics */
 
+/*
+ * The statistics are updated atomically so that they can be collected
+ * while holding the namecache lock shared, or no lock at all.
+ */
 #define	NCHSTAT(v) {		\
-        nchstats.v++;		\
+        os_atomic_inc(&nchstats.v, relaxed);	\
 }
-#define NAME_CACHE_LOCK()		name_cache_lock()
-#define NAME_CACHE_UNLOCK()		name_cache_unlock()
-#define	NAME_CACHE_LOCK_SHARED()	name_cache_lock()
 
 #else
 
 #define NCHSTAT(v)
+
+#endif
+
 #define NAME_CACHE_LOCK()		name_cache_lock()
 #define NAME_CACHE_UNLOCK()		name_cache_unlock()
 #define	NAME_CACHE_LOCK_SHARED()	name_cache_lock_shared()
 
-#endif
-
 
 /* vars for name cache list lock */
 lck_grp_t * namecache_lck_grp;
@@ -158,8 +178,33 @@ lck_rw_t  * strtable_rw_lock;
 
 lck_mtx_t strcache_mtx_locks[NUM_STRCACHE_LOCKS];
 
+#define NUM_NCHASH_LOCKS 1024
+
+lck_mtx_t nchash_mtx_locks[NUM_NCHASH_LOCKS];
+
+/*
+ * Sequence count validating lockless lookups, odd while a writer
+ * holds the namecache lock exclusive.
+ */
+static uint32_t namecache_seq;
+
+/*
+ * Number of lockless lookups in flight, spread over a few cache lines
+ * indexed by cpu number so that readers don't contend with each other.
+ */
+#define NC_LOCKLESS_SLOTS	64
+#define NC_LOCKLESS_RETRIES	3
+
+static struct {
+	uint32_t	ncl_readers;
+} __attribute__((aligned(64))) nc_lockless_slots[NC_LOCKLESS_SLOTS];
+
 
 static vnode_t cache_lookup_locked(vnode_t dvp, struct componentname *cnp);
+static vnode_t cache_lookup_lockless(vnode_t dvp, struct componentname *cnp);
+static boolean_t cache_lookup_lockless_begin(uint32_t *seqp, int *slotp);
+static boolean_t cache_lookup_lockless_validate(uint32_t seq);
+static void cache_lookup_lockless_end(int slot);
 static const char *add_name_internal(const char *, uint32_t, u_int, boolean_t, u_int);
 static void init_string_table(void);
 static void cache_delete(struct namecache *, int);
@@ -179,6 +224,9 @@ static unsigned int crc32tab[256];
 #define NCHHASH(dvp, hash_val) \
 	(&nchashtbl[(dvp->v_id ^ (hash_val)) & nchashmask])
 
+#define NCHASHLOCK(ncpp) \
+	(&nchash_mtx_locks[((ncpp) - nchashtbl) & (NUM_NCHASH_LOCKS - 1)])
+
 /*
  * This function tries to check if a directory vp is a subdirectory of dvp
  * only from valid v_parent pointers. It is called with the name cache lock
@@ -1277,6 +1325,10 @@ cache_lookup_path(struct nameidata *ndp, struct componentname *cnp, vnode_t dp,
 	unsigned int	hash;
 	int		error = 0;
 	boolean_t	dotdotchecked = FALSE;
+	boolean_t	lockless = FALSE;
+	uint32_t	seq = 0;
+	int		slot = 0;
+	int		retries = 0;
 
 #if CONFIG_TRIGGERS
 	vnode_t 	trigger_vp;
@@ -1285,7 +1337,16 @@ cache_lookup_path(struct nameidata *ndp, struct componentname *cnp, vnode_t dp,
 	ucred = vfs_context_ucred(ctx);
 	ndp->ni_flag &= ~(NAMEI_TRAILINGSLASH);
 
-	NAME_CACHE_LOCK_SHARED();
+	/*
+	 * Try to walk the path without the namecache lock first,
+	 * see the comment at the top of this file.
+	 */
+	if (nc_lockless_lookup && cache_lookup_lockless_begin(&seq, &slot))
+		lockless = TRUE;
+	else
+		NAME_CACHE_LOCK_SHARED();
+
+	vid = dp->v_id;
 
 	if ( dp->v_mount && (dp->v_mount->mnt_kern_flag & (MNTK_AUTH_OPAQUE | MNTK_AUTH_CACHE_TTL)) ) {
 		ttl_enabled = TRUE;
@@ -1368,6 +1429,7 @@ cache_lookup_path(struct nameidata *ndp, struct componentname *cnp, vnode_t dp,
 skiprsrcfork:
 #endif
 
+relookup:
 #if CONFIG_MACF
 
 		/*
@@ -1380,7 +1442,10 @@ skiprsrcfork:
 		if (!(cnp->cn_flags & DONOTAUTH)) {
 			error = mac_vnode_check_lookup(ctx, dp, cnp);
 			if (error) {
-				NAME_CACHE_UNLOCK();
+				if (lockless)
+					cache_lookup_lockless_end(slot);
+				else
+					NAME_CACHE_UNLOCK();
 				goto errorout;
 			}
 		}
@@ -1392,7 +1457,8 @@ skiprsrcfork:
 		}
 
 		/*
-		 * NAME_CACHE_LOCK holds these fields stable
+		 * NAME_CACHE_LOCK holds these fields stable (or
+		 * namecache_seq validates them for lockless lookups)
 		 *
 		 * We can't cache KAUTH_VNODE_SEARCHBYANYONE for root correctly
 		 * so we make an ugly check for root here. root is always
@@ -1481,6 +1547,16 @@ skiprsrcfork:
 				boolean_t defer = FALSE;
 				boolean_t is_subdir = FALSE;
 
+				/*
+				 * Walking up the v_parent chain while renames
+				 * are in progress can go around in circles,
+				 * so this needs the namecache lock.
+				 */
+				if (lockless) {
+					retries = NC_LOCKLESS_RETRIES;
+					goto lockless_retry;
+				}
+
 				defer = cache_check_vnode_issubdir(tvp,
 				    ndp->ni_rootdir, &is_subdir, &tvp);
 
@@ -1507,7 +1583,11 @@ skiprsrcfork:
 				vp = dp->v_parent;
 			}
 		} else {
-			if ( (vp = cache_lookup_locked(dp, cnp)) == NULLVP)
+			if (lockless)
+				vp = cache_lookup_lockless(dp, cnp);
+			else
+				vp = cache_lookup_locked(dp, cnp);
+			if (vp == NULLVP)
 				break;
 
 			if ( (vp->v_flag & VISHARDLINK) ) {
@@ -1546,6 +1626,19 @@ skiprsrcfork:
 #endif /* CONFIG_TRIGGERS */
 
 
+		if (lockless) {
+			int nvid = vp->v_id;
+
+			/*
+			 * Make sure nothing we based the decision to move
+			 * on to vp on has changed before committing to it.
+			 */
+			if (!cache_lookup_lockless_validate(seq))
+				goto lockless_retry;
+			vid = nvid;
+		} else {
+			vid = vp->v_id;
+		}
 		dp = vp;
 		vp = NULLVP;
 
@@ -1558,9 +1651,44 @@ skiprsrcfork:
 	}
 	if (vp != NULLVP)
 	        vvid = vp->v_id;
-	vid = dp->v_id;
-	
-	NAME_CACHE_UNLOCK();
+
+	if (lockless) {
+		if (!cache_lookup_lockless_validate(seq)) {
+lockless_retry:
+			/*
+			 * Something changed under us: reconsider the
+			 * current component with a fresh snapshot or,
+			 * if that keeps failing, under the namecache lock.
+			 * dp itself was validated when we moved onto it.
+			 */
+			NCHSTAT(ncs_lockless_retries);
+			vp = NULLVP;
+			*dp_authorized = 0;
+			dotdotchecked = FALSE;
+
+			seq = os_atomic_load(&namecache_seq, acquire);
+			if (++retries > NC_LOCKLESS_RETRIES || (seq & 1)) {
+				NAME_CACHE_LOCK_SHARED();
+				cache_lookup_lockless_end(slot);
+				lockless = FALSE;
+			}
+			if (dp->v_id == vid)
+				goto relookup;
+			/*
+			 * dp was recycled, vnode_getwithvid_drainok()
+			 * will fail below and the lookup will be redriven.
+			 */
+			if (lockless)
+				cache_lookup_lockless_end(slot);
+			else
+				NAME_CACHE_UNLOCK();
+		} else {
+			NCHSTAT(ncs_lockless);
+			cache_lookup_lockless_end(slot);
+		}
+	} else {
+		NAME_CACHE_UNLOCK();
+	}
 
 	if ((vp != NULLVP) && (vp->v_type != VLNK) &&
 	    ((cnp->cn_flags & (ISLASTCN | LOCKPARENT | WANTPARENT | SAVESTART)) == ISLASTCN)) {
@@ -1710,6 +1838,126 @@ cache_lookup_locked(vnode_t dvp, struct componentname *cnp)
 }
 
 
+/*
+ * Same as cache_lookup_locked(), for callers that don't hold the namecache
+ * lock: the hash chain is searched with its bucket lock held, which keeps
+ * the entries on it and their names alive.  The vnode returned is only a
+ * hint until the caller validates its snapshot of namecache_seq.
+ */
+static vnode_t
+cache_lookup_lockless(vnode_t dvp, struct componentname *cnp)
+{
+	struct namecache *ncp;
+	struct nchashhead *ncpp;
+	lck_mtx_t *lck;
+	long namelen = cnp->cn_namelen;
+	unsigned int hashval = cnp->cn_hash;
+	uint32_t dvid = dvp->v_id;
+	u_long mask, idx;
+	vnode_t vp = NULLVP;
+
+	if (nc_disabled) {
+		return NULL;
+	}
+
+	/*
+	 * resize_namecache() holds all of the bucket locks while it
+	 * switches tables, so the table is stable once we hold the lock
+	 * of the bucket we computed, as long as the mask didn't change.
+	 */
+	for (;;) {
+		mask = os_atomic_load(&nchashmask, relaxed);
+		idx = (dvid ^ hashval) & mask;
+		lck = &nchash_mtx_locks[idx & (NUM_NCHASH_LOCKS - 1)];
+
+		lck_mtx_lock_spin(lck);
+		if (mask == nchashmask)
+			break;
+		lck_mtx_unlock(lck);
+	}
+
+	ncpp = &nchashtbl[idx];
+	LIST_FOREACH(ncp, ncpp, nc_hash) {
+	        if ((ncp->nc_dvp == dvp) && (ncp->nc_hashval == hashval)) {
+			if (strncmp(ncp->nc_name, cnp->cn_nameptr, namelen) == 0 && ncp->nc_name[namelen] == 0)
+			        break;
+		}
+	}
+	if (ncp != NULL)
+		vp = ncp->nc_vp;
+	lck_mtx_unlock(lck);
+
+	if (ncp == NULL) {
+		NCHSTAT(ncs_miss);
+		return (NULL);
+	}
+	NCHSTAT(ncs_goodhits);
+
+	return (vp);
+}
+
+/*
+ * Start a lockless lookup: record ourselves as a reader in flight and take
+ * a snapshot of namecache_seq.  Fails if a writer currently holds the
+ * namecache lock, in which case the caller should take the lock shared.
+ */
+static boolean_t
+cache_lookup_lockless_begin(uint32_t *seqp, int *slotp)
+{
+	int slot = cpu_number() & (NC_LOCKLESS_SLOTS - 1);
+	uint32_t seq;
+
+	os_atomic_inc(&nc_lockless_slots[slot].ncl_readers, relaxed);
+	/* pairs with the fence in cache_lookup_lockless_quiesce() */
+	os_atomic_thread_fence(seq_cst);
+
+	seq = os_atomic_load(&namecache_seq, acquire);
+	if (seq & 1) {
+		os_atomic_dec(&nc_lockless_slots[slot].ncl_readers, release);
+		return (FALSE);
+	}
+
+	*seqp = seq;
+	*slotp = slot;
+	return (TRUE);
+}
+
+/*
+ * Returns whether nothing protected by the namecache lock changed
+ * since seq was sampled.
+ */
+static boolean_t
+cache_lookup_lockless_validate(uint32_t seq)
+{
+	os_atomic_thread_fence(acquire);
+	return (os_atomic_load(&namecache_seq, relaxed) == seq);
+}
+
+static void
+cache_lookup_lockless_end(int slot)
+{
+	os_atomic_dec(&nc_lockless_slots[slot].ncl_readers, release);
+}
+
+/*
+ * Wait for all the lookups that might have started walking the name cache
+ * without the namecache lock to be done.  Used before freeing a mount, whose
+ * fields lockless readers may still be looking at through stale vnodes.
+ */
+void
+cache_lookup_lockless_quiesce(void)
+{
+	int i;
+
+	os_atomic_thread_fence(seq_cst);
+
+	for (i = 0; i < NC_LOCKLESS_SLOTS; i++) {
+		while (os_atomic_load(&nc_lockless_slots[i].ncl_readers, acquire) != 0)
+			delay(1);
+	}
+}
+
+
 unsigned int hash_string(const char *cp, int len);
 //
 // Have to take a len argument because we may only need to
@@ -1814,11 +2062,7 @@ relook:
 		NAME_CACHE_UNLOCK();
 
 		if (vnode_getwithvid(vp, vid)) {
-#if COLLECT_STATS
-		        NAME_CACHE_LOCK();
 			NCHSTAT(ncs_badvid);
-			NAME_CACHE_UNLOCK();
-#endif
 			return (0);
 		}
 		*vpp = vp;
@@ -2010,7 +2254,12 @@ cache_enter_locked(struct vnode *dvp, struct vnode *vp, struct componentname *cn
 	 */
 	TAILQ_INSERT_TAIL(&nchead, ncp, nc_entry);
 
-	ncpp = NCHHASH(dvp, cnp->cn_hash);
+	/*
+	 * hash on the name we actually recorded, so that the
+	 * entry can be found (and its bucket lock recomputed)
+	 * from nc_dvp and nc_hashval alone
+	 */
+	ncpp = NCHHASH(dvp, ncp->nc_hashval);
 #if DIAGNOSTIC
 	{
 		struct namecache *p;
@@ -2023,7 +2272,9 @@ cache_enter_locked(struct vnode *dvp, struct vnode *vp, struct componentname *cn
 	/*
 	 * make us available to be found via lookup
 	 */
+	lck_mtx_lock_spin(NCHASHLOCK(ncpp));
 	LIST_INSERT_HEAD(ncpp, ncp, nc_hash);
+	lck_mtx_unlock(NCHASHLOCK(ncpp));
 
 	if (vp) {
 	       /*
@@ -2044,9 +2295,22 @@ cache_enter_locked(struct vnode *dvp, struct vnode *vp, struct componentname *cn
 		       /*
 			* if we've reached our desired limit
 			* of negative cache entries, delete
-			* the oldest
+			* the oldest one hashing to the same
+			* bucket (entries are inserted at the
+			* head of the chain), so that a burst of
+			* misses in one directory doesn't flush
+			* the negative entries of everybody else...
+			* fall back to the globally oldest one
 			*/
-		        negp = TAILQ_FIRST(&neghead);
+			struct namecache *p;
+
+			negp = NULL;
+			for (p = LIST_NEXT(ncp, nc_hash); p != NULL; p = LIST_NEXT(p, nc_hash)) {
+				if (p->nc_vp == NULLVP)
+					negp = p;
+			}
+			if (negp == NULL)
+				negp = TAILQ_FIRST(&neghead);
 			cache_delete(negp, 1);
 		}
 	}
@@ -2138,6 +2402,9 @@ nchinit(void)
 
 	for (i = 0; i < NUM_STRCACHE_LOCKS; i++)
 		lck_mtx_init(&strcache_mtx_locks[i], strcache_lck_grp, strcache_lck_attr);
+
+	for (i = 0; i < NUM_NCHASH_LOCKS; i++)
+		lck_mtx_init(&nchash_mtx_locks[i], namecache_lck_grp, namecache_lck_attr);
 }
 
 void
@@ -2150,11 +2417,23 @@ void
 name_cache_lock(void)
 {
 	lck_rw_lock_exclusive(namecache_rw_lock);
+	/*
+	 * Let the lockless lookups know that what they are
+	 * looking at may change from now on.
+	 */
+	os_atomic_inc(&namecache_seq, relaxed);
+	os_atomic_thread_fence(release);
 }
 
 void
 name_cache_unlock(void)
 {
+	/*
+	 * namecache_seq is only ever odd while the lock is held
+	 * exclusive, so if it's odd now, that exclusive owner is us.
+	 */
+	if (os_atomic_load(&namecache_seq, relaxed) & 1)
+		os_atomic_inc(&namecache_seq, release);
 	lck_rw_done(namecache_rw_lock);
 }
 
@@ -2168,7 +2447,7 @@ resize_namecache(int newsize)
     struct namecache 	*entry, *next;
     uint32_t		i, hashval;
     int			dNodes, dNegNodes, nelements;
-    u_long		new_size, old_size;
+    u_long		new_size, old_size, new_mask;
 
     if (newsize < 0)
         return EINVAL;
@@ -2184,17 +2463,22 @@ resize_namecache(int newsize)
         return EINVAL;
     }
 
-    new_table = hashinit(nelements, M_CACHE, &nchashmask);
-    new_size  = nchashmask + 1;
+    new_table = hashinit(nelements, M_CACHE, &new_mask);
+    new_size  = new_mask + 1;
 
     if (new_table == NULL) {
         return ENOMEM;
     }
 
     NAME_CACHE_LOCK();
+    // keep the lockless lookups out of both tables
+    for (i = 0; i < NUM_NCHASH_LOCKS; i++)
+        lck_mtx_lock(&nchash_mtx_locks[i]);
+
     // do the switch!
     old_table = nchashtbl;
     nchashtbl = new_table;
+    nchashmask = new_mask;
     old_size  = nchash;
     nchash    = new_size;
 
@@ -2218,7 +2502,9 @@ resize_namecache(int newsize)
     }
     desiredNodes = dNodes;
     desiredNegNodes = dNegNodes;
-    
+
+    for (i = 0; i < NUM_NCHASH_LOCKS; i++)
+        lck_mtx_unlock(&nchash_mtx_locks[i]);
     NAME_CACHE_UNLOCK();
     FREE(old_table, M_CACHE);
 
@@ -2228,6 +2514,8 @@ resize_namecache(int newsize)
 static void
 cache_delete(struct namecache *ncp, int free_entry)
 {
+	struct nchashhead *ncpp;
+
         NCHSTAT(ncs_deletes);
 
         if (ncp->nc_vp) {
@@ -2238,7 +2526,10 @@ cache_delete(struct namecache *ncp, int free_entry)
 	}
         TAILQ_REMOVE(&(ncp->nc_dvp->v_ncchildren), ncp, nc_child);
 
+	ncpp = NCHHASH(ncp->nc_dvp, ncp->nc_hashval);
+	lck_mtx_lock_spin(NCHASHLOCK(ncpp));
 	LIST_REMOVE(ncp, nc_hash);
+	lck_mtx_unlock(NCHASHLOCK(ncpp));
 	/*
 	 * this field is used to indicate
 	 * that the entry is in use and
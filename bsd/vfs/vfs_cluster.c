@@ -228,7 +228,7 @@ static int	sparse_cluster_add(struct cl_writebehind *, void **cmapp, vnode_t vp,
 				   int (*)(buf_t, void *), void *callback_arg, boolean_t vm_initiated);
 
 static kern_return_t vfs_drt_mark_pages(void **cmapp, off_t offset, u_int length, u_int *setcountp);
-static kern_return_t vfs_drt_get_cluster(void **cmapp, off_t *offsetp, u_int *lengthp);
+static kern_return_t vfs_drt_get_cluster(void **cmapp, off_t *offsetp, u_int *lengthp, u_int maxlength);
 static kern_return_t vfs_drt_control(void **cmapp, int op_type);
 
 
@@ -386,55 +386,126 @@ cluster_max_io_size(mount_t mp, int type)
 #define CLW_IOPASSIVE	0x08
 
 /*
- * if the read ahead context doesn't yet exist,
- * allocate and initialize it...
+ * if the read ahead contexts don't yet exist,
+ * allocate and initialize them...
  * the vnode lock serializes multiple callers
  * during the actual assignment... first one
  * to grab the lock wins... the other callers
  * will release the now unnecessary storage
- * 
- * once the context is present, try to grab (but don't block on)
+ *
+ * a file has CL_RA_STREAMS read ahead contexts,
+ * one per sequential (or strided) stream of reads,
+ * so that readers scanning different regions of the
+ * same file in parallel don't keep resetting each
+ * other's read ahead... a read picks the context of
+ * the stream it continues, if any... otherwise it
+ * takes an unused context, or else the context not
+ * reading ahead whose last read started closest below
+ * it (which is how a strided stream finds its own
+ * context again), or failing that, the least
+ * recently used one
+ *
+ * once the context is chosen, try to grab (but don't block on)
  * the lock associated with it... if someone
  * else currently owns it, than the read
- * will run without read-ahead.  this allows
- * multiple readers to run in parallel and
- * since there's only 1 read ahead context,
- * there's no real loss in only allowing 1
- * reader to have read-ahead enabled.
+ * will run without read-ahead.
  */
+static void
+cluster_free_rastreams(struct cl_rastreams *rasp)
+{
+	int	i;
+
+	for (i = 0; i < CL_RA_STREAMS; i++)
+	        lck_mtx_destroy(&rasp->cl_streams[i].cl_lockr, cl_mtx_grp);
+	FREE_ZONE((void *)rasp, sizeof *rasp, M_CLRDAHEAD);
+}
+
 static struct cl_readahead *
-cluster_get_rap(vnode_t vp)
+cluster_get_rap(vnode_t vp, daddr64_t b_addr)
 {
         struct ubc_info		*ubc;
+	struct cl_rastreams	*rasp;
 	struct cl_readahead	*rap;
+	struct cl_readahead	*unused = NULL;
+	struct cl_readahead	*near = NULL;
+	struct cl_readahead	*lru = NULL;
+	int			i;
 
 	ubc = vp->v_ubcinfo;
 
-        if ((rap = ubc->cl_rahead) == NULL) {
-	        MALLOC_ZONE(rap, struct cl_readahead *, sizeof *rap, M_CLRDAHEAD, M_WAITOK);
+        if ((rasp = ubc->cl_rahead) == NULL) {
+	        MALLOC_ZONE(rasp, struct cl_rastreams *, sizeof *rasp, M_CLRDAHEAD, M_WAITOK);
 
-		bzero(rap, sizeof *rap);
-		rap->cl_lastr = -1;
-		lck_mtx_init(&rap->cl_lockr, cl_mtx_grp, cl_mtx_attr);
+		bzero(rasp, sizeof *rasp);
+		for (i = 0; i < CL_RA_STREAMS; i++) {
+		        rasp->cl_streams[i].cl_lastr = -1;
+			lck_mtx_init(&rasp->cl_streams[i].cl_lockr, cl_mtx_grp, cl_mtx_attr);
+		}
 
 		vnode_lock(vp);
 		
 		if (ubc->cl_rahead == NULL)
-		        ubc->cl_rahead = rap;
+		        ubc->cl_rahead = rasp;
 		else {
-		        lck_mtx_destroy(&rap->cl_lockr, cl_mtx_grp);
-		        FREE_ZONE((void *)rap, sizeof *rap, M_CLRDAHEAD);
-			rap = ubc->cl_rahead;
+		        cluster_free_rastreams(rasp);
+			rasp = ubc->cl_rahead;
 		}
 		vnode_unlock(vp);
 	}
-	if (lck_mtx_try_lock(&rap->cl_lockr) == TRUE)
+	for (i = 0; i < CL_RA_STREAMS; i++) {
+	        rap = &rasp->cl_streams[i];
+
+		if (rap->cl_lastr != -1 &&
+		    (b_addr == rap->cl_lastr || b_addr == (rap->cl_lastr + 1) ||
+		     (rap->cl_stride && b_addr == (rap->cl_lastb + rap->cl_stride))))
+		        goto found;
+
+		if (rap->cl_lastr == -1) {
+		        if (unused == NULL)
+			        unused = rap;
+			continue;
+		}
+		if (rap->cl_ralen == 0 && rap->cl_lastb < b_addr && (near == NULL || rap->cl_lastb > near->cl_lastb))
+		        near = rap;
+		if (lru == NULL || (int32_t)(rap->cl_lastuse - lru->cl_lastuse) < 0)
+		        lru = rap;
+	}
+	if ((rap = unused) == NULL && (rap = near) == NULL)
+	        rap = lru;
+found:
+	if (lck_mtx_try_lock(&rap->cl_lockr) == TRUE) {
+	        rap->cl_lastuse = OSIncrementAtomic((SInt32 *)&rasp->cl_rausegen) + 1;
 	        return(rap);
+	}
 	
 	return ((struct cl_readahead *)NULL);
 }
 
 
+__private_extern__ void
+cluster_get_rahead_stats(vnode_t vp, struct fraheadstats *stats)
+{
+	struct cl_rastreams	*rasp;
+	int			i;
+
+	bzero(stats, sizeof *stats);
+
+	if (!UBCINFOEXISTS(vp) || (rasp = vp->v_ubcinfo->cl_rahead) == NULL)
+	        return;
+
+	stats->fra_prefetched = rasp->cl_raprefetched;
+	stats->fra_hits = rasp->cl_rahits;
+	if (stats->fra_prefetched > stats->fra_hits)
+	        stats->fra_wasted = stats->fra_prefetched - stats->fra_hits;
+	stats->fra_strided = (uint32_t)rasp->cl_rastrided;
+
+	for (i = 0; i < CL_RA_STREAMS; i++) {
+	        if (rasp->cl_streams[i].cl_lastr != -1)
+		        stats->fra_streams++;
+	}
+}
+
+
 /*
  * if the write behind context doesn't yet exist,
  * and CLW_ALLOCATE is specified, allocate and initialize it...
@@ -484,6 +555,31 @@ cluster_get_wbp(vnode_t vp, int flags)
 }
 
 
+/*
+ * report the write behind statistics of vp for F_GETWBSTATS
+ */
+__private_extern__ void
+cluster_get_wbehind_stats(vnode_t vp, struct fwbstats *stats)
+{
+	struct cl_writebehind	*wbp;
+
+	bzero(stats, sizeof *stats);
+
+	if (!UBCINFOEXISTS(vp) || (wbp = cluster_get_wbp(vp, 0)) == NULL)
+	        return;
+
+	lck_mtx_lock(&wbp->cl_lockw);
+
+	stats->fwb_clusters = wbp->cl_number;
+	stats->fwb_sparse = (wbp->cl_scmap != NULL);
+	stats->fwb_sparse_switches = wbp->cl_sparse_switches;
+	stats->fwb_sparse_ios = wbp->cl_sparse_ios;
+	stats->fwb_sparse_pages = wbp->cl_sparse_pages;
+
+	lck_mtx_unlock(&wbp->cl_lockw);
+}
+
+
 static void
 cluster_syncup(vnode_t vp, off_t newEOF, int (*callback)(buf_t, void *), void *callback_arg, int flags)
 {
@@ -1962,6 +2058,17 @@ cluster_read_prefetch(vnode_t vp, off_t f_offset, u_int size, off_t filesize, in
 
 
 
+static void
+cluster_rahead_account(vnode_t vp, int pages, boolean_t strided)
+{
+	struct cl_rastreams	*rasp = vp->v_ubcinfo->cl_rahead;
+
+	OSAddAtomic64(pages, (SInt64 *)&rasp->cl_raprefetched);
+	if (strided)
+	        OSIncrementAtomic64((SInt64 *)&rasp->cl_rastrided);
+}
+
+
 static void
 cluster_read_ahead(vnode_t vp, struct cl_extent *extent, off_t filesize, struct cl_readahead *rap, int (*callback)(buf_t, void *), void *callback_arg,
 		   int bflag)
@@ -1980,19 +2087,54 @@ cluster_read_ahead(vnode_t vp, struct cl_extent *extent, off_t filesize, struct
 			     rap->cl_ralen, (int)rap->cl_maxra, (int)rap->cl_lastr, 0, 0);
 		return;
 	}
+	max_prefetch = MAX_PREFETCH(vp, cluster_max_io_size(vp->v_mount, CL_READ), disk_conditioner_mount_is_ssd(vp->v_mount));
+
+	if (max_prefetch > speculative_prefetch_max)
+		max_prefetch = speculative_prefetch_max;
+
 	if (rap->cl_lastr == -1 || (extent->b_addr != rap->cl_lastr && extent->b_addr != (rap->cl_lastr + 1))) {
+	        daddr64_t stride = 0;
+	        daddr64_t read_size;
+
 	        rap->cl_ralen = 0;
 		rap->cl_maxra = 0;
 
+		if (rap->cl_lastr != -1)
+		        stride = extent->b_addr - rap->cl_lastb;
+		read_size = (extent->e_addr + 1) - extent->b_addr;
+
+		if (stride > 0 && stride == rap->cl_stride && read_size < stride && max_prefetch > PAGE_SIZE) {
+		        /*
+			 * the last reads were the same distance apart...
+			 * read ahead the extent the next one should hit
+			 */
+		        if (read_size > max_prefetch / PAGE_SIZE)
+			        read_size = max_prefetch / PAGE_SIZE;
+			r_addr = extent->b_addr + stride;
+			f_offset = (off_t)(r_addr * PAGE_SIZE_64);
+
+			size_of_prefetch = 0;
+
+			if (f_offset < filesize)
+			        ubc_range_op(vp, f_offset, f_offset + PAGE_SIZE_64, UPL_ROP_PRESENT, &size_of_prefetch);
+
+			if (f_offset < filesize && size_of_prefetch == 0) {
+			        size_of_prefetch = cluster_read_prefetch(vp, f_offset, read_size * PAGE_SIZE, filesize, callback, callback_arg, bflag);
+
+				if (size_of_prefetch) {
+				        rap->cl_maxra = (r_addr + size_of_prefetch) - 1;
+					cluster_rahead_account(vp, size_of_prefetch, TRUE);
+				}
+			}
+		}
+		rap->cl_stride = stride;
+
 		KERNEL_DEBUG((FSDBG_CODE(DBG_FSRW, 48)) | DBG_FUNC_END,
 			     rap->cl_ralen, (int)rap->cl_maxra, (int)rap->cl_lastr, 1, 0);
 
 		return;
 	}
-	max_prefetch = MAX_PREFETCH(vp, cluster_max_io_size(vp->v_mount, CL_READ), disk_conditioner_mount_is_ssd(vp->v_mount));
-
-	if (max_prefetch > speculative_prefetch_max)
-		max_prefetch = speculative_prefetch_max;
+	rap->cl_stride = 0;
 
 	if (max_prefetch <= PAGE_SIZE) {
 		KERNEL_DEBUG((FSDBG_CODE(DBG_FSRW, 48)) | DBG_FUNC_END,
@@ -2034,8 +2176,10 @@ cluster_read_ahead(vnode_t vp, struct cl_extent *extent, off_t filesize, struct
 		}
 		size_of_prefetch = cluster_read_prefetch(vp, f_offset, rap->cl_ralen * PAGE_SIZE, filesize, callback, callback_arg, bflag);
 
-		if (size_of_prefetch)
+		if (size_of_prefetch) {
 		        rap->cl_maxra = (r_addr + size_of_prefetch) - 1;
+			cluster_rahead_account(vp, size_of_prefetch, FALSE);
+		}
 	}
 	KERNEL_DEBUG((FSDBG_CODE(DBG_FSRW, 48)) | DBG_FUNC_END,
 		     rap->cl_ralen, (int)rap->cl_maxra, (int)rap->cl_lastr, 4, 0);
@@ -3853,11 +3997,21 @@ cluster_read_copy(vnode_t vp, struct uio *uio, u_int32_t io_req_size, off_t file
 
 			max_rd_size = THROTTLE_MAX_IOSIZE;
 		}
-	        if ((rap = cluster_get_rap(vp)) == NULL)
+	        if ((rap = cluster_get_rap(vp, uio->uio_offset / PAGE_SIZE_64)) == NULL)
 		        rd_ahead_enabled = 0;
 		else {
 			extent.b_addr = uio->uio_offset / PAGE_SIZE_64;
 			extent.e_addr = (last_request_offset - 1) / PAGE_SIZE_64;
+
+			if (rap->cl_maxra && extent.b_addr <= rap->cl_maxra &&
+			    (rap->cl_lastr == extent.b_addr || (rap->cl_lastr + 1) == extent.b_addr ||
+			     (rap->cl_stride && (rap->cl_lastb + rap->cl_stride) == extent.b_addr))) {
+			        /*
+				 * this read picks up pages the read ahead brought in
+				 */
+			        OSAddAtomic64((int32_t)(min(extent.e_addr, rap->cl_maxra) - extent.b_addr + 1),
+					      (SInt64 *)&vp->v_ubcinfo->cl_rahead->cl_rahits);
+			}
 		}
 	}
 	if (rap != NULL && rap->cl_ralen && (rap->cl_lastr == extent.b_addr || (rap->cl_lastr + 1) == extent.b_addr)) {
@@ -3961,6 +4115,7 @@ cluster_read_copy(vnode_t vp, struct uio *uio, u_int32_t io_req_size, off_t file
 				        if (extent.e_addr < rap->cl_lastr)
 					        rap->cl_maxra = 0;
 					rap->cl_lastr = extent.e_addr;
+					rap->cl_lastb = extent.b_addr;
 				}
 			        break;
 			}
@@ -4174,6 +4329,7 @@ cluster_read_copy(vnode_t vp, struct uio *uio, u_int32_t io_req_size, off_t file
 				        if (extent.e_addr < rap->cl_lastr)
 					        rap->cl_maxra = 0;
 					rap->cl_lastr = extent.e_addr;
+					rap->cl_lastb = extent.b_addr;
 				}
 			}
 			if (iolock_inited == TRUE)
@@ -5541,7 +5697,7 @@ __private_extern__ void
 cluster_release(struct ubc_info *ubc)
 {
         struct cl_writebehind *wbp;
-	struct cl_readahead   *rap;
+	struct cl_rastreams   *rasp;
 
 	if ((wbp = ubc->cl_wbehind)) {
 
@@ -5553,20 +5709,18 @@ cluster_release(struct ubc_info *ubc)
 	        KERNEL_DEBUG((FSDBG_CODE(DBG_FSRW, 81)) | DBG_FUNC_START, ubc, 0, 0, 0, 0);
 	}
 
-	rap = ubc->cl_rahead;
+	rasp = ubc->cl_rahead;
 
 	if (wbp != NULL) {
 	        lck_mtx_destroy(&wbp->cl_lockw, cl_mtx_grp);
 	        FREE_ZONE((void *)wbp, sizeof *wbp, M_CLWRBEHIND);
 	}
-	if ((rap = ubc->cl_rahead)) {
-	        lck_mtx_destroy(&rap->cl_lockr, cl_mtx_grp);
-	        FREE_ZONE((void *)rap, sizeof *rap, M_CLRDAHEAD);
-	}
+	if ((rasp = ubc->cl_rahead))
+	        cluster_free_rastreams(rasp);
 	ubc->cl_rahead  = NULL;
 	ubc->cl_wbehind = NULL;
 
-	KERNEL_DEBUG((FSDBG_CODE(DBG_FSRW, 81)) | DBG_FUNC_END, ubc, rap, wbp, 0, 0);
+	KERNEL_DEBUG((FSDBG_CODE(DBG_FSRW, 81)) | DBG_FUNC_END, ubc, rasp, wbp, 0, 0);
 }
 
 
@@ -5955,6 +6109,8 @@ sparse_cluster_switch(struct cl_writebehind *wbp, vnode_t vp, off_t EOF, int (*c
 
 	KERNEL_DEBUG((FSDBG_CODE(DBG_FSRW, 78)) | DBG_FUNC_START, kdebug_vnode(vp), wbp->cl_scmap, wbp->cl_number, 0, 0);
 
+	wbp->cl_sparse_switches++;
+
 	for (cl_index = 0; cl_index < wbp->cl_number; cl_index++) {
 	        int	  flags;
 		struct cl_extent cl;
@@ -6007,9 +6163,12 @@ sparse_cluster_push(struct cl_writebehind *wbp, void **scmap, vnode_t vp, off_t
 	for (;;) {
 		int retval;
 
-	        if (vfs_drt_get_cluster(scmap, &offset, &length) != KERN_SUCCESS)
+	        if (vfs_drt_get_cluster(scmap, &offset, &length, MAX_CLUSTER_SIZE(vp)) != KERN_SUCCESS)
 			break;
 
+		OSIncrementAtomic64((SInt64 *)&wbp->cl_sparse_ios);
+		OSAddAtomic64(length / PAGE_SIZE, (SInt64 *)&wbp->cl_sparse_pages);
+
 		if (vm_initiated == TRUE)
 		        lck_mtx_unlock(&wbp->cl_lockw);
 
@@ -6532,6 +6691,7 @@ struct vfs_drt_clustermap {
 	u_int32_t		scm_buckets;	/* number of occupied buckets */
 	u_int32_t		scm_lastclean;	/* last entry we cleaned */
 	u_int32_t		scm_iskips;	/* number of slot skips */
+	u_int64_t		scm_nextaddr;	/* where the next cluster is looked for */
 
 	struct vfs_drt_hashentry scm_hashtable[0];
 };
@@ -6657,6 +6817,7 @@ vfs_drt_alloc_map(struct vfs_drt_clustermap **cmapp)
 	cmap->scm_buckets = 0;
 	cmap->scm_lastclean = 0;
 	cmap->scm_iskips = 0;
+	cmap->scm_nextaddr = (ocmap != NULL) ? ocmap->scm_nextaddr : 0;
 	for (i = 0; i < cmap->scm_modulus; i++) {
 	        DRT_HASH_CLEAR(cmap, i);
 		DRT_HASH_VACATE(cmap, i);
@@ -6964,7 +7125,9 @@ vfs_drt_unmark_pages(void **cmapp, off_t offset, u_int length)
 #endif
 
 /*
- * Get a cluster of dirty pages.
+ * Get a cluster of dirty pages.  Successive calls return the clusters in
+ * ascending file order, and a run of dirty pages that crosses from one
+ * hashtable entry into the next is returned as a single cluster.
  *
  * This is a public interface.
  *
@@ -6978,36 +7141,80 @@ vfs_drt_unmark_pages(void **cmapp, off_t offset, u_int length)
  * lengthp
  *	Returns the length in bytes of the cluster of dirty pages.
  *
+ * maxlength
+ *	Upper bound on the length of the cluster, in bytes.
+ *
  * Returns success if a cluster was found.  If KERN_FAILURE is returned, there
  * are no dirty pages meeting the minmum size criteria.  Private storage will
  * be released if there are no more dirty pages left in the map
  *
  */
 static kern_return_t
-vfs_drt_get_cluster(void **cmapp, off_t *offsetp, u_int *lengthp)
+vfs_drt_get_cluster(void **cmapp, off_t *offsetp, u_int *lengthp, u_int maxlength)
 {
 	struct vfs_drt_clustermap *cmap;
-	u_int64_t	offset;
+	u_int64_t	offset, addr, best_addr = 0, wrap_addr = 0;
 	u_int		length;
 	u_int32_t	j;
-	int		index, i, fs, ls;
+	int		index, i, fs, ls, start, best = -1, best_start = 0, wrap = -1;
 
 	/* sanity */
 	if ((cmapp == NULL) || (*cmapp == NULL))
 		return(KERN_FAILURE);
 	cmap = *cmapp;
 
-	/* walk the hashtable */
-	for (offset = 0, j = 0; j < cmap->scm_modulus; offset += (DRT_BITVECTOR_PAGES * PAGE_SIZE), j++) {
-	        index = DRT_HASH(cmap, offset);
+	/*
+	 * walk the hashtable for the lowest dirty entry past the point the
+	 * last cluster ended at, so that a series of pushes goes out in
+	 * ascending file order... once past the last one, wrap around to
+	 * the lowest dirty entry in the map
+	 */
+	for (j = 0; j < cmap->scm_modulus; j++) {
 
-	        if (DRT_HASH_VACANT(cmap, index) || (DRT_HASH_GET_COUNT(cmap, index) == 0))
+	        if (DRT_HASH_VACANT(cmap, j) || (DRT_HASH_GET_COUNT(cmap, j) == 0))
+			continue;
+		addr = DRT_HASH_GET_ADDRESS(cmap, j);
+
+		if (wrap == -1 || addr < wrap_addr) {
+		        wrap = j;
+			wrap_addr = addr;
+		}
+		if (addr + (DRT_BITVECTOR_PAGES * PAGE_SIZE) <= cmap->scm_nextaddr)
+			continue;
+		if (best != -1 && addr >= best_addr)
 			continue;
 
+		start = 0;
+		if (addr < cmap->scm_nextaddr) {
+		        /*
+			 * the entry the last cluster ended in...
+			 * only consider the pages beyond that point
+			 */
+			start = (int)((cmap->scm_nextaddr - addr) / PAGE_SIZE);
+
+			for (i = start; i < DRT_BITVECTOR_PAGES; i++) {
+			        if (DRT_HASH_TEST_BIT(cmap, j, i))
+				        break;
+			}
+			if (i == DRT_BITVECTOR_PAGES)
+			        continue;
+		}
+		best = j;
+		best_addr = addr;
+		best_start = start;
+	}
+	if (best == -1 && wrap != -1) {
+	        best = wrap;
+		best_addr = wrap_addr;
+		best_start = 0;
+	}
+	if (best != -1) {
+	        index = best;
+
 		/* scan the bitfield for a string of bits */
 		fs = -1;
 
-		for (i = 0; i < DRT_BITVECTOR_PAGES; i++) {
+		for (i = best_start; i < DRT_BITVECTOR_PAGES; i++) {
 		        if (DRT_HASH_TEST_BIT(cmap, index, i)) {
 			        fs = i;
 				break;
@@ -7018,16 +7225,33 @@ vfs_drt_get_cluster(void **cmapp, off_t *offsetp, u_int *lengthp)
 		        panic("vfs_drt: entry summary count > 0 but no bits set in map, cmap = %p, index = %d, count = %lld",
 			      cmap, index, DRT_HASH_GET_COUNT(cmap, index));
 		}
-		for (ls = 0; i < DRT_BITVECTOR_PAGES; i++, ls++) {
-			if (!DRT_HASH_TEST_BIT(cmap, index, i))
+		offset = best_addr + (PAGE_SIZE * fs);
+		length = 0;
+
+		for (;;) {
+		        for (ls = 0; i < DRT_BITVECTOR_PAGES && length + (ls * PAGE_SIZE) < maxlength; i++, ls++) {
+			        if (!DRT_HASH_TEST_BIT(cmap, index, i))
+				        break;
+			}
+			/* mark pages clean */
+			vfs_drt_do_mark_pages(cmapp, offset + length, ls * PAGE_SIZE, NULL, 0);
+			cmap = *cmapp;
+			cmap->scm_lastclean = index;
+			length += ls * PAGE_SIZE;
+
+			if (i < DRT_BITVECTOR_PAGES || length >= maxlength)
+			        break;
+			/*
+			 * the run goes to the end of the entry... if the
+			 * following entry starts out dirty, carry on into
+			 * it so that the pages go out in one I/O
+			 */
+			if (vfs_drt_search_index(cmap, offset + length, &index) != KERN_SUCCESS ||
+			    DRT_HASH_GET_COUNT(cmap, index) == 0 || !DRT_HASH_TEST_BIT(cmap, index, 0))
 			        break;
+			i = 0;
 		}
-		
-		/* compute offset and length, mark pages clean */
-		offset = DRT_HASH_GET_ADDRESS(cmap, index) + (PAGE_SIZE * fs);
-		length = ls * PAGE_SIZE;
-		vfs_drt_do_mark_pages(cmapp, offset, length, NULL, 0);
-		cmap->scm_lastclean = index;
+		cmap->scm_nextaddr = offset + length;
 
 		/* return successful */
 		*offsetp = (off_t)offset;
@@ -7079,6 +7303,7 @@ vfs_drt_control(void **cmapp, int op_type)
 
 	case 1:
 	        cmap->scm_lastclean = 0;
+	        cmap->scm_nextaddr = 0;
 	        break;
 	}
 	return(KERN_SUCCESS);
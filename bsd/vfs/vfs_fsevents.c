@@ -339,21 +339,44 @@ static struct timeval last_print;
 //
 // These variables are used to track coalescing multiple identical
 // events for the same vnode/pathname.  If we get the same event
-// type and same vnode/pathname as the previous event, we just drop
-// the event since it's superfluous.  This improves some micro-
-// benchmarks considerably and actually has a real-world impact on
-// tests like a Finder copy where multiple stat-changed events can
-// get coalesced.
+// type and same vnode/pathname as one of the last few events that
+// are still queued, we just drop the event since it's superfluous.
+// This improves some micro-benchmarks considerably and actually has
+// a real-world impact on tests like a Finder copy where multiple
+// stat-changed events can get coalesced, or a build where several
+// files are written to in an interleaved fashion.
 //
-static int     last_event_type=-1;
-static void   *last_ptr=NULL;
-static char    last_str[MAXPATHLEN];
-static int     last_nlen=0;
-static int     last_vid=-1;
-static uint64_t last_coalesced_time=0;
-static void   *last_event_ptr=NULL;
-int            last_coalesced = 0;
-static mach_timebase_info_data_t    sTimebaseInfo = { 0, 0 };
+#define KFSE_COALESCE_SLOTS	8
+
+static struct kfse_coalesce {
+    kfs_event  *kfse;          // the queued event, NULL if the slot is free
+    int         type;
+    void       *ptr;
+    int         vid;
+    int         nlen;
+    uint64_t    abstime;
+    char        str[MAXPATHLEN];
+} kfse_coalesce[KFSE_COALESCE_SLOTS];
+static int      kfse_coalesce_next=0;
+static uint64_t kfse_coalesce_window=0;   // 1 second, in absolute time units
+int             last_coalesced = 0;
+
+//
+// Forget the coalescing state of an event that is being delivered
+// or released: a later identical event has to be reported again.
+//
+static void
+kfse_uncoalesce(kfs_event *kfse)
+{
+    int i;
+
+    for(i=0; i < KFSE_COALESCE_SLOTS; i++) {
+	if (kfse_coalesce[i].kfse == kfse) {
+	    kfse_coalesce[i].kfse = NULL;
+	}
+    }
+}
+
 
 
 int
@@ -369,6 +392,7 @@ add_fsevent(int type, vfs_context_t ctx, ...)
     uint64_t          now, elapsed;
     char             *pathbuff=NULL;
     int               pathbuff_len;
+    struct kfse_coalesce *coalesce_slot=NULL;
 
 
 
@@ -401,13 +425,13 @@ add_fsevent(int type, vfs_context_t ctx, ...)
     if (type != FSE_CREATE_FILE && type != FSE_DELETE && type != FSE_RENAME && type != FSE_EXCHANGE && type != FSE_CHOWN && type != FSE_DOCID_CHANGED && type != FSE_DOCID_CREATED && type != FSE_CLONE) {
 	void *ptr=NULL;
 	int   vid=0, was_str=0, nlen=0;
+	struct kfse_coalesce *slot;
 
 	for(arg_type=va_arg(ap, int32_t); arg_type != FSE_ARG_DONE; arg_type=va_arg(ap, int32_t)) {
 	    switch(arg_type) {
 		case FSE_ARG_VNODE: {
 		    ptr = va_arg(ap, void *);
 		    vid = vnode_vid((struct vnode *)ptr);
-		    last_str[0] = '\0';
 		    break;
 		}
 		case FSE_ARG_STRING: {
@@ -422,45 +446,56 @@ add_fsevent(int type, vfs_context_t ctx, ...)
 	    }
 	}
 
-	if ( sTimebaseInfo.denom == 0 ) {
-	    (void) clock_timebase_info(&sTimebaseInfo);
+	if (kfse_coalesce_window == 0) {
+	    nanoseconds_to_absolutetime(NSEC_PER_SEC, &kfse_coalesce_window);
 	}
-	
-	elapsed = (now - last_coalesced_time);
-	if (sTimebaseInfo.denom != sTimebaseInfo.numer) {
-	    if (sTimebaseInfo.denom == 1) {
-		elapsed *= sTimebaseInfo.numer;
-	    } else {
-		// this could overflow... the worst that will happen is that we'll
-		// send (or not send) an extra event so I'm not going to worry about
-		// doing the math right like dtrace_abs_to_nano() does.
-		elapsed = (elapsed * sTimebaseInfo.numer) / (uint64_t)sTimebaseInfo.denom;
+
+	coalesce_slot = NULL;
+	for(i=0; i < KFSE_COALESCE_SLOTS; i++) {
+	    slot = &kfse_coalesce[i];
+
+	    if (slot->kfse == NULL) {
+		if (coalesce_slot == NULL) {
+		    coalesce_slot = slot;
+		}
+		continue;
+	    }
+	    if (slot->type == type
+		&& (now - slot->abstime) < kfse_coalesce_window
+		&&
+		((vid && vid == slot->vid && slot->ptr == ptr)
+		  ||
+		 (was_str && slot->str[0] && slot->nlen == nlen && ptr && strcmp(slot->str, ptr) == 0))
+	       ) {
+
+		last_coalesced++;
+		unlock_fs_event_list();
+		va_end(ap);
+
+		return 0;
 	    }
 	}
-	
-	if (type == last_event_type
-            && (elapsed < 1000000000)
-	    && 
-	    ((vid && vid == last_vid && last_ptr == ptr)
-	      ||
-	     (last_str[0] && last_nlen == nlen && ptr && strcmp(last_str, ptr) == 0))
-	   ) {
-	    
-	    last_coalesced++;
-	    unlock_fs_event_list();
-	    va_end(ap);
 
-	    return 0;
+	//
+	// remember this event so that identical ones that follow
+	// while it is queued can be dropped.  the slot is only
+	// armed (slot->kfse set) once the event is allocated.
+	//
+	if (coalesce_slot == NULL) {
+	    coalesce_slot = &kfse_coalesce[kfse_coalesce_next];
+	    kfse_coalesce_next = (kfse_coalesce_next + 1) % KFSE_COALESCE_SLOTS;
+	}
+	coalesce_slot->kfse = NULL;
+	coalesce_slot->ptr = ptr;
+	if (was_str) {
+	    strlcpy(coalesce_slot->str, ptr, sizeof(coalesce_slot->str));
 	} else {
-	    last_ptr = ptr;
-	    if (was_str) {
-		strlcpy(last_str, ptr, sizeof(last_str));
-	    }
-	    last_nlen = nlen;
-	    last_vid = vid;
-	    last_event_type = type;
-	    last_coalesced_time = now;
+	    coalesce_slot->str[0] = '\0';
 	}
+	coalesce_slot->nlen = nlen;
+	coalesce_slot->vid = vid;
+	coalesce_slot->type = type;
+	coalesce_slot->abstime = now;
     }
     va_start(ap, ctx);
 
@@ -538,7 +573,9 @@ add_fsevent(int type, vfs_context_t ctx, ...)
     kfse->refcount = 1;
     OSBitOrAtomic16(KFSE_BEING_CREATED, &kfse->flags);
 
-    last_event_ptr = kfse;
+    if (coalesce_slot) {
+	coalesce_slot->kfse = kfse;
+    }
     kfse->type     = type;
     kfse->abstime  = now;
     kfse->pid      = p->p_pid;
@@ -844,11 +881,7 @@ release_event_ref(kfs_event *kfse)
     }
 
     lock_fs_event_list();
-    if (last_event_ptr == kfse) {
-	    last_event_ptr = NULL;
-	    last_event_type = -1;
-	    last_coalesced_time = 0;
-    }
+    kfse_uncoalesce(kfse);
 
     if (kfse->refcount < 0) {
 	panic("release_event_ref: bogus kfse refcount %d\n", kfse->refcount);
@@ -1577,11 +1610,7 @@ fmod_watch(fs_event_watcher *watcher, struct uio *uio)
 	  } else {
 
 	    skipped = 0;
-	    if (last_event_ptr == kfse) {
-		last_event_ptr = NULL;
-		last_event_type = -1;
-		last_coalesced_time = 0;
-	    }
+	    kfse_uncoalesce(kfse);
 	    error = copy_out_kfse(watcher, kfse, uio);
 	    if (error != 0) {
 		// if an event won't fit or encountered an error while
@@ -1297,6 +1297,24 @@ int async_work_handled = 0;
 int dead_vnode_wanted = 0;
 int dead_vnode_waited = 0;
 
+/*
+ * Once the vnode table is full, new_vnode() has to reclaim a vnode itself,
+ * under the caller's nose, before it can hand one out.  To keep that off
+ * the allocation path the async work thread maintains a reserve of dead
+ * vnodes: when fewer than vnode_reclaim_reserve slots are left, new_vnode()
+ * kicks the thread, which reclaims from the head of the rage and free lists
+ * until the reserve is back. new_vnode() only reclaims synchronously when
+ * the reserve runs dry.
+ */
+int vnode_reclaim_reserve = 64;
+static int vnode_reclaim_wanted = 0;		/* reclaims left for the async thread */
+static uint64_t vnode_reclaims_async = 0;
+static uint64_t vnode_reclaims_sync = 0;
+static uint64_t vnode_reclaim_sync_nsecs = 0;
+
+#define VNODE_RESERVE_LOW()	\
+	((numvnodes - deadvnodes) + vnode_reclaim_reserve > desiredvnodes)
+
 /*
  * Move a vnode from one mount queue to another.
  */
@@ -3918,6 +3936,14 @@ SYSCTL_INT(_vfs_generic, VFS_MAXTYPENUM, maxtypenum,
 		   CTLFLAG_RD | CTLFLAG_KERN | CTLFLAG_LOCKED,
 		   &maxvfstypenum, 0, "");
 SYSCTL_INT(_vfs_generic, OID_AUTO, sync_timeout, CTLFLAG_RW | CTLFLAG_LOCKED, &sync_timeout_seconds, 0, "");
+SYSCTL_INT(_vfs_generic, OID_AUTO, vnode_reclaim_reserve, CTLFLAG_RW | CTLFLAG_LOCKED,
+		   &vnode_reclaim_reserve, 0, "dead vnodes kept in reserve once the vnode table is full");
+SYSCTL_QUAD(_vfs_generic, OID_AUTO, vnode_reclaims_async, CTLFLAG_RD | CTLFLAG_LOCKED,
+		   &vnode_reclaims_async, "vnodes reclaimed in the background");
+SYSCTL_QUAD(_vfs_generic, OID_AUTO, vnode_reclaims_sync, CTLFLAG_RD | CTLFLAG_LOCKED,
+		   &vnode_reclaims_sync, "vnode allocations that reclaimed synchronously");
+SYSCTL_QUAD(_vfs_generic, OID_AUTO, vnode_reclaim_sync_nsecs, CTLFLAG_RD | CTLFLAG_LOCKED,
+		   &vnode_reclaim_sync_nsecs, "time spent reclaiming synchronously, in nanoseconds");
 SYSCTL_NODE(_vfs_generic, VFS_CONF, conf,
 		   CTLFLAG_RD | CTLFLAG_LOCKED,
 		   sysctl_vfs_generic_conf, "");
@@ -4065,6 +4091,48 @@ process_vp(vnode_t vp, int want_vp, int *deferred)
 	return (vp);
 }
 
+/*
+ * Pick the vnode the async thread reclaims next to refill the reserve,
+ * following the same order new_vnode() steals in.
+ * Called with the vnode list lock held.
+ */
+static vnode_t
+vnode_reclaim_candidate(void)
+{
+	struct timeval current_tv;
+
+	if ( !TAILQ_EMPTY(&vnode_rage_list)) {
+		microuptime(&current_tv);
+		if (ragevnodes >= rage_limit ||
+		    (current_tv.tv_sec - rage_tv.tv_sec) >= RAGE_TIME_LIMIT)
+			return (TAILQ_FIRST(&vnode_rage_list));
+	}
+	return (TAILQ_FIRST(&vnode_free_list));
+}
+
+/*
+ * Kick the async thread if the dead vnode reserve is running low.
+ */
+static void
+vnode_reclaim_kick(void)
+{
+	boolean_t need_wakeup = FALSE;
+
+	if (vnode_reclaim_reserve <= 0 || vnode_reclaim_wanted != 0 ||
+	    !VNODE_RESERVE_LOW())
+		return;
+
+	vnode_list_lock();
+	if (vnode_reclaim_wanted == 0 && VNODE_RESERVE_LOW()) {
+		vnode_reclaim_wanted = vnode_reclaim_reserve;
+		need_wakeup = TRUE;
+	}
+	vnode_list_unlock();
+
+	if (need_wakeup == TRUE)
+		wakeup(&vnode_async_work_list);
+}
+
 __attribute__((noreturn))
 static void
 async_work_continue(void)
@@ -4080,6 +4148,21 @@ async_work_continue(void)
 		vnode_list_lock();
 
 		if ( TAILQ_EMPTY(q) ) {
+			if (vnode_reclaim_wanted > 0) {
+				vnode_reclaim_wanted--;
+				if (VNODE_RESERVE_LOW() &&
+				    (vp = vnode_reclaim_candidate()) != NULLVP) {
+					vnode_reclaims_async++;
+					vp = process_vp(vp, 0, &deferred);
+					if (vp != NULLVP) {
+						/* already reclaimed; it belongs on the dead list */
+						vnode_list_add(vp);
+						vnode_unlock(vp);
+					}
+					continue;
+				}
+				vnode_reclaim_wanted = 0;
+			}
 			assert_wait(q, (THREAD_UNINT));
 	
 			vnode_list_unlock();
@@ -4111,6 +4194,7 @@ new_vnode(vnode_t *vpp)
         struct timeval initial_tv;
         struct timeval current_tv;
 	proc_t  curproc = current_proc();
+	uint64_t reclaim_start = 0;
 
 	initial_tv.tv_sec = 0;
 retry:
@@ -4306,6 +4390,9 @@ retry:
 		return (ENFILE);
 	}
 steal_this_vp:
+	if (reclaim_start == 0 && !(vp->v_listflag & VLIST_DEAD))
+		reclaim_start = mach_absolute_time();
+
 	if ((vp = process_vp(vp, 1, &deferred)) == NULLVP) {
 		if (deferred) {
 			int	elapsed_msecs;
@@ -4359,6 +4446,14 @@ steal_this_vp:
 	}
 	OSAddAtomicLong(1, &num_reusedvnodes);
 
+	if (reclaim_start != 0) {
+		uint64_t nsecs;
+
+		absolutetime_to_nanoseconds(mach_absolute_time() - reclaim_start, &nsecs);
+		OSIncrementAtomic64((SInt64 *)&vnode_reclaims_sync);
+		OSAddAtomic64(nsecs, (SInt64 *)&vnode_reclaim_sync_nsecs);
+	}
+
 
 #if CONFIG_MACF
 	/*
@@ -4392,6 +4487,8 @@ steal_this_vp:
 done:
 	*vpp = vp;
 
+	vnode_reclaim_kick();
+
 	return (0);
 }
 
@@ -1205,6 +1205,8 @@ out1:
 		if (mp->mnt_crossref)
 			mount_dropcrossref(mp, vp, 0);
 		else {
+			/* lockless namecache lookups may still be looking at mp */
+			cache_lookup_lockless_quiesce();
 			mount_lock_destroy(mp);
 #if CONFIG_MACF
 			mac_mount_label_destroy(mp);
@@ -2220,6 +2222,7 @@ out:
 				vnode_put(pvp);
 			}
 		} else if (mp->mnt_flag & MNT_ROOTFS) {
+				cache_lookup_lockless_quiesce();
 				mount_lock_destroy(mp);
 #if CONFIG_MACF
 				mac_mount_label_destroy(mp);
@@ -2307,6 +2310,8 @@ mount_dropcrossref(mount_t mp, vnode_t dp, int need_put)
 			vnode_put_locked(dp);
 		vnode_unlock(dp);
 
+		/* lockless namecache lookups may still be looking at mp */
+		cache_lookup_lockless_quiesce();
 		mount_lock_destroy(mp);
 #if CONFIG_MACF
 		mac_mount_label_destroy(mp);
@@ -3499,6 +3504,10 @@ fg_vn_data_free(void *fgvndata)
 
 	if (fvdata->fv_buf)
 		FREE(fvdata->fv_buf, M_FD_DIRBUF);
+	if (fvdata->fv_attrbuf)
+		FREE(fvdata->fv_attrbuf, M_FD_DIRBUF);
+	if (fvdata->fv_namebuf)
+		FREE(fvdata->fv_namebuf, M_FD_DIRBUF);
 	lck_mtx_destroy(&fvdata->fv_lock, fd_vn_lck_grp);
 	FREE(fvdata, M_FD_VN_DATA);
 }
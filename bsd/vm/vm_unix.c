@@ -192,6 +192,75 @@ SYSCTL_INT(_vm, OID_AUTO, cs_executable_mem_entry, CTLFLAG_RD | CTLFLAG_LOCKED,
 SYSCTL_INT(_vm, OID_AUTO, cs_executable_wire, CTLFLAG_RD | CTLFLAG_LOCKED, &cs_executable_wire, 0, "");
 #endif /* CONFIG_EMBEDDED */
 
+extern unsigned int vm_fault_around_enabled;
+extern unsigned int vm_fault_around_pages;
+extern uint64_t vm_fault_around_faults;
+extern uint64_t vm_fault_around_mapped;
+SYSCTL_UINT(_vm, OID_AUTO, fault_around_enabled, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_fault_around_enabled, 0, "");
+SYSCTL_UINT(_vm, OID_AUTO, fault_around_pages, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_fault_around_pages, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, fault_around_faults, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_fault_around_faults, "");
+SYSCTL_QUAD(_vm, OID_AUTO, fault_around_mapped, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_fault_around_mapped, "");
+
+extern unsigned int vm_fault_wire_batch_max;
+extern uint64_t vm_fault_wire_batch_runs;
+extern uint64_t vm_fault_wire_batch_pages;
+SYSCTL_UINT(_vm, OID_AUTO, fault_wire_batch_max, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_fault_wire_batch_max, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, fault_wire_batch_runs, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_fault_wire_batch_runs, "");
+SYSCTL_QUAD(_vm, OID_AUTO, fault_wire_batch_pages, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_fault_wire_batch_pages, "");
+
+extern unsigned int vm_object_collapse_async_depth;
+extern uint64_t vm_object_collapse_async_queued;
+extern uint64_t vm_object_collapse_async_dropped;
+extern uint64_t vm_object_collapse_async_done;
+SYSCTL_UINT(_vm, OID_AUTO, object_collapse_async_depth, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_object_collapse_async_depth, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, object_collapse_async_queued, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_object_collapse_async_queued, "");
+SYSCTL_QUAD(_vm, OID_AUTO, object_collapse_async_dropped, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_object_collapse_async_dropped, "");
+SYSCTL_QUAD(_vm, OID_AUTO, object_collapse_async_done, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_object_collapse_async_done, "");
+
+extern unsigned int vm_object_reap_exit_min_pages;
+extern uint64_t vm_object_reap_exit_async;
+SYSCTL_UINT(_vm, OID_AUTO, object_reap_exit_min_pages, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_object_reap_exit_min_pages, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, object_reap_exit_async, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_object_reap_exit_async, "");
+
+extern unsigned int vm_page_prezero_max;
+extern unsigned int vm_page_prezero_count;
+extern uint64_t vm_page_prezero_hits;
+extern uint64_t vm_page_prezero_misses;
+extern uint64_t vm_page_prezero_zeroed;
+extern uint64_t vm_page_prezero_drained;
+SYSCTL_UINT(_vm, OID_AUTO, page_prezero_max, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_page_prezero_max, 0, "");
+SYSCTL_UINT(_vm, OID_AUTO, page_prezero_count, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_page_prezero_count, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, page_prezero_hits, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_page_prezero_hits, "");
+SYSCTL_QUAD(_vm, OID_AUTO, page_prezero_misses, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_page_prezero_misses, "");
+SYSCTL_QUAD(_vm, OID_AUTO, page_prezero_zeroed, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_page_prezero_zeroed, "");
+SYSCTL_QUAD(_vm, OID_AUTO, page_prezero_drained, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_page_prezero_drained, "");
+
+extern uint64_t vm_free_magazine_refills;
+extern uint64_t vm_free_magazine_refill_pages;
+SYSCTL_QUAD(_vm, OID_AUTO, free_magazine_refills, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_free_magazine_refills, "");
+SYSCTL_QUAD(_vm, OID_AUTO, free_magazine_refill_pages, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_free_magazine_refill_pages, "");
+
+extern unsigned int vm_map_transparent_superpages;
+extern vm_map_size_t vm_map_transparent_superpage_min;
+extern uint64_t vm_map_transparent_superpage_maps;
+extern uint64_t vm_map_transparent_superpage_bytes;
+extern uint64_t vm_map_transparent_superpage_fallbacks;
+SYSCTL_UINT(_vm, OID_AUTO, transparent_superpages, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_map_transparent_superpages, 0, "");
+SYSCTL_QUAD(_vm, OID_AUTO, transparent_superpage_min, CTLFLAG_RW | CTLFLAG_LOCKED, &vm_map_transparent_superpage_min, "");
+SYSCTL_QUAD(_vm, OID_AUTO, transparent_superpage_maps, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_map_transparent_superpage_maps, "");
+SYSCTL_QUAD(_vm, OID_AUTO, transparent_superpage_bytes, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_map_transparent_superpage_bytes, "");
+SYSCTL_QUAD(_vm, OID_AUTO, transparent_superpage_fallbacks, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_map_transparent_superpage_fallbacks, "");
+
+extern uint64_t vm_map_pmap_nested;
+extern uint64_t vm_map_pmap_nest_failed;
+extern uint64_t vm_map_pmap_unnested_bytes;
+SYSCTL_QUAD(_vm, OID_AUTO, pmap_nested, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_map_pmap_nested, "");
+SYSCTL_QUAD(_vm, OID_AUTO, pmap_nest_failed, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_map_pmap_nest_failed, "");
+SYSCTL_QUAD(_vm, OID_AUTO, pmap_unnested_bytes, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_map_pmap_unnested_bytes, "");
+
+extern uint64_t vm_map_fork_protect_skipped;
+SYSCTL_QUAD(_vm, OID_AUTO, fork_protect_skipped, CTLFLAG_RD | CTLFLAG_LOCKED, &vm_map_fork_protect_skipped, "");
+
 #if DEVELOPMENT || DEBUG
 extern int radar_20146450;
 SYSCTL_INT(_vm, OID_AUTO, radar_20146450, CTLFLAG_RW | CTLFLAG_LOCKED, &radar_20146450, 0, "");
@@ -2022,6 +2091,16 @@ SYSCTL_ULONG(_vm, OID_AUTO, pages_freed, CTLFLAG_RD | CTLFLAG_LOCKED,
 
 SYSCTL_INT(_vm, OID_AUTO, pageout_purged_objects, CTLFLAG_RD | CTLFLAG_LOCKED,
 	   &vm_pageout_debug.vm_pageout_purged_objects, 0, "System purged object count");
+
+extern unsigned int vm_purgeable_purge_batch_max;
+extern unsigned int vm_purgeable_purge_batches;
+extern unsigned int vm_purgeable_purge_batch_objects;
+SYSCTL_UINT(_vm, OID_AUTO, purge_batch_max, CTLFLAG_RW | CTLFLAG_LOCKED,
+	    &vm_purgeable_purge_batch_max, 0, "Most objects purged per batch under pressure");
+SYSCTL_UINT(_vm, OID_AUTO, purge_batches, CTLFLAG_RD | CTLFLAG_LOCKED,
+	    &vm_purgeable_purge_batches, 0, "Purges that reclaimed more than one object");
+SYSCTL_UINT(_vm, OID_AUTO, purge_batch_objects, CTLFLAG_RD | CTLFLAG_LOCKED,
+	    &vm_purgeable_purge_batch_objects, 0, "Objects purged by multi-object purges");
 SYSCTL_UINT(_vm, OID_AUTO, pageout_cleaned_busy, CTLFLAG_RD | CTLFLAG_LOCKED,
 	    &vm_pageout_debug.vm_pageout_cleaned_busy, 0, "Cleaned pages busy (deactivated)");
 SYSCTL_UINT(_vm, OID_AUTO, pageout_cleaned_nolock, CTLFLAG_RD | CTLFLAG_LOCKED,
@@ -43,7 +43,8 @@ enum
 
     kIODMAMapOptionNoCacheStore = 0x00000010,	// Memory in descriptor 
     kIODMAMapOptionOnChip       = 0x00000020,	// Indicates DMA is on South Bridge
-    kIODMAMapOptionIterateOnly  = 0x00000040	// DMACommand will be used as a cursor only
+    kIODMAMapOptionIterateOnly  = 0x00000040,	// DMACommand will be used as a cursor only
+    kIODMAMapOptionPersistent   = 0x00000080	// Keep mappings across complete()
 };
 
 /**************************** class IODMACommand ***************************/
@@ -89,6 +90,7 @@ public:
     @constant kNonCoherent	Used by drivers for non-coherent transfers, implies unmapped memmory
     @constant kMapped		Allow a driver to define addressing size
     @constant kBypassed		Allow drivers to bypass any mapper
+    @constant kPersistent	Keep the mapper allocation of the last few memory descriptors and ranges prepared after complete(), see flushMappingCache
     @constant kMaxMappingOptions	Internal use only
 */
     enum MappingOptions {
@@ -100,7 +102,8 @@ public:
 
 	kNoCacheStore = kIODMAMapOptionNoCacheStore,	// Memory in descriptor 
 	kOnChip       = kIODMAMapOptionOnChip,	        // Indicates DMA is on South Bridge
-	kIterateOnly  = kIODMAMapOptionIterateOnly	// DMACommand will be used as a cursor only
+	kIterateOnly  = kIODMAMapOptionIterateOnly,	// DMACommand will be used as a cursor only
+	kPersistent   = kIODMAMapOptionPersistent	// Keep mappings across complete()
     };
 
     struct SegmentOptions {
@@ -502,6 +505,13 @@ public:
     uint32_t getAlignmentLength(void);
     uint32_t getAlignmentInternalSegments(void);
 
+/*! @function flushMappingCache
+    @abstract Drops the mappings kept by a kPersistent DMA command.
+    @discussion A DMA command created with the kPersistent mapping option keeps the mapper allocation of a prepared range when it is completed, and reuses it when the same range of the same memory descriptor is prepared again, saving a map and unmap, and the I/O TLB invalidation that goes with it, per transfer.  The command keeps the memory descriptor retained and prepared for as long as its mapping is kept; the least recently used mapping is dropped when the command needs room for a new one.  Drivers must flush the cache of a memory descriptor before changing its memory, and flush it or free the command to let it be unwired.  Changing the mapper or the addressing restrictions of the command flushes its cache.
+    @param memory Memory descriptor whose mappings are dropped, or 0 for all of them.
+    @result An IOReturn code.  kIOReturnBusy if the DMA command is currently prepared. */
+    IOReturn flushMappingCache(const IOMemoryDescriptor * memory = 0);
+
 
 /*! @function initWithRefCon
     @abstract Secondary initializer for the IODMACommand class. 
@@ -88,5 +88,76 @@ typedef struct _IODataQueueAppendix {
  */
 #define DATA_QUEUE_MEMORY_APPENDIX_SIZE (sizeof(IODataQueueAppendix))
 
+/*!
+ * @typedef IODataQueueDrainCallback
+ * @abstract Called by IODataQueueDrain for every entry it dequeues.
+ * @param refcon The refcon passed to IODataQueueDrain.
+ * @param data The entry data, only valid for the duration of the call.
+ * @param dataSize The size of the entry data.
+ */
+typedef void (*IODataQueueDrainCallback)(void *refcon, void *data, UInt32 dataSize);
+
+/*!
+ * @function IODataQueueDrain
+ * @abstract Dequeues up to maxEntries entries from a data queue in a single pass.
+ * @discussion The entries are handed to the callback in place, without being copied, and the head is only moved past all of them once the callback returned for the last one; a consumer woken up by a data available notification can thus handle a whole batch for the cost of a single update of the shared head.  As with a regular dequeue, the consumer must call this until it returns 0 before waiting for the next notification.
+ * @param dataQueue The mapped IODataQueueMemory of the queue, as returned by IOSharedDataQueue::getMemoryDescriptor.
+ * @param maxEntries Maximum number of entries to dequeue.
+ * @param callback Function called for every entry.
+ * @param refcon Passed to callback.
+ * @result Returns the number of entries dequeued.
+ */
+static __inline__ UInt32
+IODataQueueDrain(IODataQueueMemory *dataQueue, UInt32 maxEntries,
+                 IODataQueueDrainCallback callback, void *refcon)
+{
+    IODataQueueEntry *  entry;
+    UInt32              queueSize = dataQueue->queueSize;
+    UInt32              headOffset;
+    UInt32              tailOffset;
+    UInt32              entrySize;
+    UInt32              count = 0;
+
+    headOffset = __c11_atomic_load((_Atomic UInt32 *)&dataQueue->head, __ATOMIC_RELAXED);
+    tailOffset = __c11_atomic_load((_Atomic UInt32 *)&dataQueue->tail, __ATOMIC_ACQUIRE);
+
+    while (count < maxEntries && headOffset != tailOffset && headOffset <= queueSize) {
+        entry = (IODataQueueEntry *)((char *)dataQueue->queue + headOffset);
+
+        // No room for a header, or for the data, at the end: the entry wrapped
+        if ((headOffset > UINT32_MAX - DATA_QUEUE_ENTRY_HEADER_SIZE) ||
+            (headOffset + DATA_QUEUE_ENTRY_HEADER_SIZE > queueSize) ||
+            (headOffset + DATA_QUEUE_ENTRY_HEADER_SIZE > UINT32_MAX - entry->size) ||
+            (headOffset + entry->size + DATA_QUEUE_ENTRY_HEADER_SIZE > queueSize)) {
+            entry      = dataQueue->queue;
+            headOffset = 0;
+        }
+
+        entrySize = entry->size;
+        if ((entrySize > UINT32_MAX - DATA_QUEUE_ENTRY_HEADER_SIZE) ||
+            (entrySize + DATA_QUEUE_ENTRY_HEADER_SIZE > queueSize - headOffset)) {
+            break;
+        }
+
+        callback(refcon, &entry->data, entrySize);
+        headOffset += entrySize + DATA_QUEUE_ENTRY_HEADER_SIZE;
+        count++;
+
+        if (headOffset == tailOffset) {
+            tailOffset = __c11_atomic_load((_Atomic UInt32 *)&dataQueue->tail, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    if (count) {
+        __c11_atomic_store((_Atomic UInt32 *)&dataQueue->head, headOffset, __ATOMIC_RELEASE);
+        if (headOffset == tailOffset) {
+            // Pairs with the barrier in IOSharedDataQueue::enqueue, see IOSharedDataQueue::dequeue
+            __c11_atomic_thread_fence(__ATOMIC_SEQ_CST);
+        }
+    }
+
+    return count;
+}
+
 #endif /* _IOKIT_IODATAQUEUESHARED_H */
 
@@ -107,7 +107,12 @@ struct IOHibernateImageHeader
 
     uint8_t     bridgeBootSessionUUID[16];
 
-    uint32_t	reserved[54];		// make sizeof == 512
+    uint32_t	imageWriteTime;		// ms
+    uint32_t	imageCompressTime;	// ms
+    uint32_t	imageCryptTime;		// ms
+    uint32_t	lz4PageCount;
+
+    uint32_t	reserved[50];		// make sizeof == 512
     uint32_t	booterTime0;
     uint32_t	booterTime1;
     uint32_t	booterTime2;
@@ -293,7 +298,15 @@ struct hibernate_statistics_t
     uint32_t hidReadyTime;
 
     uint32_t wakeCapability;
-    uint32_t resvA[15];
+
+    uint32_t imageWriteDuration;
+    uint32_t imageCompressDuration;
+    uint32_t imageCryptDuration;
+    uint32_t kernelImageIODuration;
+    uint32_t kernelImageDecompressDuration;
+    uint32_t kernelImageCryptDuration;
+    uint32_t lz4Pages;
+    uint32_t resvA[8];
 };
 typedef struct hibernate_statistics_t hibernate_statistics_t;
 
@@ -475,6 +488,7 @@ enum
     kIOHibernateModeRestart	= 0x00000040,
     kIOHibernateModeSSDInvert	= 0x00000080,
     kIOHibernateModeFileResize	= 0x00000100,
+    kIOHibernateModeLZ4		= 0x00000200,
 };
 
 // IOHibernateImageHeader.signature
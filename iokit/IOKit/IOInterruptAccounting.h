@@ -46,7 +46,7 @@
  * careful to ensure that the defined number of statistics matches (or is greater than) the actual number
  * of statistics, to avoid channel ID collisions... because that would be bad.
  */
-#define IA_NUM_INTERRUPT_ACCOUNTING_STATISTICS (10)
+#define IA_NUM_INTERRUPT_ACCOUNTING_STATISTICS (12)
 
 /*
  * Channel ID related definitions.  These serve to denote the namespace of interrupt accounting in the
@@ -131,6 +131,14 @@
  * Idle Exits: The number of times that this interrupt forced a CPU out of the idle loop (the CPU
  *   had to exit an idle state to handle the interrupt, but it did not need to go through the reset
  *   path).
+ *
+ * Poll Count: The number of times the workloop action of an IOPollingInterruptEventSource was run
+ *   again, without a new interrupt, because the previous pass used up its whole budget.  Passes
+ *   started by an interrupt are counted by the second level count.
+ *
+ * Polled Completions: The aggregate number of completions reported by those extra passes; compared
+ *   against the first level count this shows how much work was picked up by polling rather than by
+ *   taking an interrupt.
  */
 enum {
     kInterruptAccountingFirstLevelCountIndex = 0, /* Number of times we invoked the top level handler */
@@ -143,6 +151,8 @@ enum {
     kInterruptAccountingPackageWakeupsIndex, /* Number of times this interrupt woke up the package */
     kInterruptAccountingCPUWakeupsIndex, /* Number of times this interrupt woke up a CPU */
     kInterruptAccountingIdleExitsIndex, /* Number of times this interrupt forced a CPU out of the idle loop */
+    kInterruptAccountingPollCountIndex, /* Number of times we polled the workloop action with the interrupt still masked */
+    kInterruptAccountingPolledCompletionsIndex, /* Number of completions handled by those polls */
     kInterruptAccountingInvalidStatisticIndex /* Sentinel value for checking for a nonsensical index */
 };
 
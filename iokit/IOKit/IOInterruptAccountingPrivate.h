@@ -104,6 +104,8 @@ extern uint32_t gInterruptAccountingStatisticBitmask;
 #define kInterruptAccountingChannelNamePackageWakeups        ("          Package wakeups caused by this interrupt")
 #define kInterruptAccountingChannelNameCPUWakeups            ("              CPU wakeups caused by this interrupt")
 #define kInterruptAccountingChannelNameIdleExits             ("               Idle exits caused by this interrupt")
+#define kInterruptAccountingChannelNamePollCount             ("          Polls run while the interrupt was masked")
+#define kInterruptAccountingChannelNamePolledCompletions     ("                    Completions handled by polling")
 
 static const char * const kInterruptAccountingStatisticNameArray[IA_NUM_INTERRUPT_ACCOUNTING_STATISTICS] = {
     [kInterruptAccountingFirstLevelCountIndex] = kInterruptAccountingChannelNameFirstLevelCount,
@@ -116,6 +118,8 @@ static const char * const kInterruptAccountingStatisticNameArray[IA_NUM_INTERRUP
     [kInterruptAccountingPackageWakeupsIndex] = kInterruptAccountingChannelNamePackageWakeups,
     [kInterruptAccountingCPUWakeupsIndex] = kInterruptAccountingChannelNameCPUWakeups,
     [kInterruptAccountingIdleExitsIndex] = kInterruptAccountingChannelNameIdleExits,
+    [kInterruptAccountingPollCountIndex] = kInterruptAccountingChannelNamePollCount,
+    [kInterruptAccountingPolledCompletionsIndex] = kInterruptAccountingChannelNamePolledCompletions,
 };
 
 /*
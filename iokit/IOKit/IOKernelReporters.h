@@ -111,6 +111,13 @@ typedef OSDictionary IOReportLegendEntry;
    the call spin-waiting for the lock.  Clients holding their own
    spin locks should carefully consider the impact of IOReporting's
    (small) additional latency before calling it while holding a spin lock.
+
+   Reporters created with IOSimpleReporter::withPerCPU() and
+   IOHistogramReporter::withPerCPU() keep the values updated by
+   incrementValue() and tallyValue() in per-CPU storage instead, updated
+   without taking the reporter lock, and merge them into the channel only
+   when the channel is read or updateReport() is called.  They suit
+   paths hot enough that the lock is too costly.
  
    The documentation for each method indicates any concurrency guarantees.
  */
@@ -807,6 +814,29 @@ public:
                                   IOReportCategories categories,
                                   IOReportUnit unit);
     
+/*! @function   IOSimpleReporter::withPerCPU
+    @abstract   create an initialized simple reporter with per-CPU channel values
+
+    @param  reportingService - IOService associated with all channels
+    @param  categories - The category in which the report should be classified
+    @param  unit - The unit for the quantity recorded by the reporter object
+    @param  maxPerCPUChannels - Number of channels, in the order they are added, to give per-CPU storage
+    @result     On success, an instance of IOSimpleReporter, else NULL
+
+    @discussion
+        Creates an instance of IOSimpleReporter whose first maxPerCPUChannels
+        channels are incremented in per-CPU storage by incrementValue(), without
+        taking the reporter lock.  setValue(), getValue() and updateReport() take
+        the lock and fold the per-CPU increments into the channel value.
+        Channels added beyond maxPerCPUChannels behave as with ::with().
+
+    Locking: SAFE to call concurrently (no static globals), MAY BLOCK.
+*/
+    static IOSimpleReporter* withPerCPU(IOService *reportingService,
+                                        IOReportCategories categories,
+                                        IOReportUnit unit,
+                                        int maxPerCPUChannels);
+    
 /*! @function   IOSimpleReporter::setValue
     @abstract   Thread safely set a channel's value
 
@@ -861,9 +891,36 @@ protected:
     virtual bool initWith(IOService *reportingService,
                           IOReportCategories categories,
                           IOReportUnit unit);
+
+/*! @function   IOSimpleReporter::handleAddChannelSwap
+    @abstract   Override IOReporter::handleAddChannelSwap to give the new channel per-CPU storage, if any is left
+*/
+    virtual IOReturn handleAddChannelSwap(uint64_t channel_id,
+                                          const OSSymbol *symChannelName) APPLE_KEXT_OVERRIDE;
+
+/*! @function   IOSimpleReporter::updateChannelValues
+    @abstract   Override IOReporter::updateChannelValues to fold the per-CPU increments into the channel
+*/
+    virtual IOReturn updateChannelValues(int channel_index) APPLE_KEXT_OVERRIDE;
+
+/*! @function   IOSimpleReporter::free
+    @abstract   Releases the object and all its resources.
+*/
+    virtual void free(void) APPLE_KEXT_OVERRIDE;
     
 private:
-    
+
+    bool initPerCPU(int maxPerCPUChannels);
+    int findPerCPUChannel(uint64_t channel_id);
+    void mergePerCPUValues(int channel_index);
+
+    int64_t            *_perCPUValues;
+    size_t              _perCPURowSize;
+    unsigned int        _perCPUCount;
+    int                 _perCPUChannels;
+    uint64_t           *_perCPUChannelIDs;
+    int64_t            *_perCPUMerged;
+    int                 _perCPUChannelCount;
 };
 
 
@@ -1486,6 +1543,24 @@ FIXME: need more explanation of the config
                                      int nSegments,
                                      IOHistogramSegmentConfig *config);
 
+/*! @function   IOHistogramReporter::withPerCPU
+    @abstract   Creates a histogram reporter tallying values in per-CPU storage
+
+    @discussion
+        Takes the same parameters as ::with().  tallyValue() updates the
+        calling CPU's copy of the buckets with interrupts disabled rather
+        than under the reporter lock, and updateReport() merges the copies.
+        A report may miss a tally still being recorded on another CPU, which
+        the next report includes.  overrideBucketValues() is not supported.
+*/
+    static IOHistogramReporter* withPerCPU(IOService *reportingService,
+                                           IOReportCategories categories,
+                                           uint64_t channelID,
+                                           const char *channelName,
+                                           IOReportUnit unit,
+                                           int nSegments,
+                                           IOHistogramSegmentConfig *config);
+
 /*! @function   IOHistogramReporter::addChannel
     @abstract   Override IOReporter::addChannel(*) to return an error
 
@@ -1510,6 +1585,8 @@ FIXME: need more explanation of the config
         to by bucket. No sanity check is performed on the data. If the index
         is out of bounds, kIOReturnBadArgument is returned.
 
+        Returns kIOReturnUnsupported for a reporter created by ::withPerCPU().
+
     Locking: same-instance concurrency SAFE, WILL NOT BLOCK
 */
 
@@ -1575,14 +1652,26 @@ protected:
     Locking: same-instance concurrency SAFE, MAY BLOCK
 */
     IOReportLegendEntry* handleCreateLegend(void) APPLE_KEXT_OVERRIDE;
+
+/*! @function   IOHistogramReporter::updateChannelValues
+    @abstract   Override IOReporter::updateChannelValues to merge the per-CPU buckets
+*/
+    virtual IOReturn updateChannelValues(int channel_index) APPLE_KEXT_OVERRIDE;
     
     
 private:
+
+    bool initPerCPU(void);
+    int findBucket(int64_t value);
     
     int                         _segmentCount;
     int64_t                    *_bucketBounds;
     int                         _bucketCount;
     IOHistogramSegmentConfig   *_histogramSegmentsConfig;
+
+    IOHistogramReportValues    *_perCPUBuckets;
+    size_t                      _perCPURowSize;
+    unsigned int                _perCPUCount;
 };
 
 
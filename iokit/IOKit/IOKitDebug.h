@@ -86,6 +86,7 @@ enum {
     kIOWaitQuietPanics  =         0x00800000ULL,
     kIOWaitQuietBeforeRoot =      0x01000000ULL,
     kIOTrackingBoot     =         0x02000000ULL,
+    kOSRefStats         =         0x08000000ULL,  // Count retains, releases and contended updates per class
 
     _kIODebugTopFlag    = 0x8000000000000000ULL   // force enum to be 64 bits
 };
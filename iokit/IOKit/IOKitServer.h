@@ -113,6 +113,46 @@ enum {
     kIOCatalogServiceTerminate
 };
 
+// iokit_user_client_trap() batched external methods
+/*!
+    @enum IOConnectMethodBatch trap index, limits and options.
+    @constant kIOConnectMethodBatchTrapIndex  Trap index handled by IOKit rather than the user client: runs a batch of external methods with one trap, p1 is the address of an array of IOConnectMethodBatchEntry, p2 the number of entries, p3 the address and p4 the size of the buffer holding the structure inputs and outputs of the entries, and p5 the options.
+    @constant kIOConnectMethodBatchMaxCount  Maximum number of entries in a batch.
+    @constant kIOConnectMethodBatchMaxDataSize  Maximum size of the structure buffer of a batch.
+    @constant kIOConnectMethodBatchMaxScalarCount  Maximum number of scalar inputs or outputs of an entry.
+    @constant kIOConnectMethodBatchMaxStructSize  Maximum size of the structure input or output of an entry.
+    @constant kIOConnectMethodBatchStopOnError  Stops at the first entry that does not return kIOReturnSuccess, the entries after it return kIOReturnAborted.
+*/
+enum {
+    kIOConnectMethodBatchTrapIndex      = 0xffffffff,
+    kIOConnectMethodBatchMaxCount       = 64,
+    kIOConnectMethodBatchMaxDataSize    = 65536,
+    kIOConnectMethodBatchMaxScalarCount = 16,
+    kIOConnectMethodBatchMaxStructSize  = 4096
+};
+
+enum {
+    kIOConnectMethodBatchStopOnError    = 0x00000001
+};
+
+/*!
+    @struct IOConnectMethodBatchEntry
+    @abstract One external method call of a batch.
+    @discussion The structure input and output of an entry are given as ranges of the batch's structure buffer, which must not overlap.  On return the kernel has set result, scalarOutputCount, structureOutputSize and the outputs, as IOConnectCallMethod would have.
+*/
+typedef struct IOConnectMethodBatchEntry {
+    uint32_t    selector;
+    int32_t     result;
+    uint32_t    scalarInputCount;
+    uint32_t    scalarOutputCount;
+    uint32_t    structureInputOffset;
+    uint32_t    structureInputSize;
+    uint32_t    structureOutputOffset;
+    uint32_t    structureOutputSize;
+    uint64_t    scalarInput[kIOConnectMethodBatchMaxScalarCount];
+    uint64_t    scalarOutput[kIOConnectMethodBatchMaxScalarCount];
+} IOConnectMethodBatchEntry;
+
 
 #ifdef XNU_KERNEL_PRIVATE
 
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#ifndef _IOKIT_IOMAPPERIOVMALLOCATOR_H
+#define _IOKIT_IOMAPPERIOVMALLOCATOR_H
+
+#include <libkern/c++/OSObject.h>
+#include <IOKit/IOLocks.h>
+#include <IOKit/IORangeAllocator.h>
+
+/*! @defined kIOMapperIOVMDefaultFlushBatch
+    @discussion Number of deallocations queued before the flush action is called when no batch size is given. */
+#define kIOMapperIOVMDefaultFlushBatch	256
+
+struct IOMapperIOVMStatistics
+{
+    uint64_t allocations;
+    uint64_t cacheHits;
+    uint64_t deallocations;
+    uint64_t flushes;
+};
+
+/*! @class IOMapperIOVMAllocator
+    @abstract An allocator of I/O virtual address space for IOMapper implementations.
+    @discussion An IOMapperIOVMAllocator hands out ranges of a mapper's I/O virtual address space, in units of the mapper's choosing, usually its page size.  Ranges are kept in per-CPU caches of a few size classes, so that the allocations and deallocations done for every I/O rarely take a shared lock; sizes are rounded up to their size class.  The free space is otherwise kept in an IORangeAllocator.
+<br><br>
+    A deallocated range may still be cached in the mapper's I/O TLB, so it is not reused right away: deallocations are queued until kIOMapperIOVMDefaultFlushBatch of them, or the batch size given, are pending, at which point the allocator calls the mapper's flush action once to invalidate the I/O TLB, and only then makes the ranges available again.  The mapper must have removed the translations of a range before deallocating it.  Allocation and deallocation may block and must be called from thread context.
+*/
+class IOMapperIOVMAllocator : public OSObject
+{
+    OSDeclareDefaultStructors(IOMapperIOVMAllocator)
+
+public:
+/*! @typedef FlushAction
+    @discussion 'C' pointer prototype of the function called to invalidate the I/O TLB.  On return the mapper's hardware must no longer use any translation removed before the call.  It is never called concurrently for an allocator.
+    @param target Target of the allocator, as passed to withRange.
+    @param sender The allocator. */
+    typedef void (*FlushAction)(OSObject * target, IOMapperIOVMAllocator * sender);
+
+protected:
+    IORangeAllocator *		ranges;
+    OSObject *			target;
+    FlushAction			action;
+    UInt32			cpuCount;
+    struct IOMapperIOVMCPUCache * cpuCaches;
+
+    IOSimpleLock *		pendingLock;
+    IOLock *			flushLock;
+    UInt32			flushBatch;
+    UInt32			pendingCount;
+    struct IOMapperIOVMRange *	pending;
+    struct IOMapperIOVMRange *	flushing;
+
+    SInt64			allocations;
+    SInt64			cacheHits;
+    SInt64			deallocations;
+    SInt64			flushes;
+
+/*! @struct ExpansionData
+    @discussion This structure will be used to expand the capablilties of the IOMapperIOVMAllocator in the future.
+*/
+    struct ExpansionData { };
+
+/*! @var reserved
+    Reserved for future use.  (Internal use only)
+*/
+    ExpansionData * reserved;
+
+    virtual void free() APPLE_KEXT_OVERRIDE;
+
+public:
+/*! @function withRange
+    @abstract Factory method for IOMapperIOVMAllocator.
+    @param start First unit of the address space to allocate from.
+    @param size Number of units of the address space.
+    @param target First parameter passed to the flush action.
+    @param action Function invalidating the mapper's I/O TLB.
+    @param flushBatch Number of deallocations queued before the flush action is called, 0 for kIOMapperIOVMDefaultFlushBatch.
+    @result Returns the new allocator, to be released by the caller, or zero on failure. */
+    static IOMapperIOVMAllocator * withRange(IORangeScalar start, IORangeScalar size,
+					     OSObject * target, FlushAction action,
+					     UInt32 flushBatch = 0);
+
+/*! @function init
+    @abstract Standard initializer for IOMapperIOVMAllocator, see withRange. */
+    virtual bool init(IORangeScalar start, IORangeScalar size,
+		      OSObject * target, FlushAction action,
+		      UInt32 flushBatch);
+
+/*! @function allocate
+    @abstract Allocates a range of the address space.
+    @discussion Ranges of the cached size classes, with no alignment beyond their size class, usually come from the calling CPU's cache.  When the free space is exhausted the pending deallocations are flushed and the caches emptied before giving up.
+    @param size Number of units requested.
+    @param result The first unit of the range is returned here on success.
+    @param alignment Alignment required in units, 0 or 1 for none.
+    @result Returns true if the allocation was successful, else false. */
+    virtual bool allocate(IORangeScalar size, IORangeScalar * result,
+			  IORangeScalar alignment = 0);
+
+/*! @function deallocate
+    @abstract Queues a range for reuse after the next I/O TLB invalidation.
+    @discussion May call the flush action before returning, if the queue of pending deallocations is full.
+    @param start The first unit of the range, as returned by allocate.
+    @param size The size passed to allocate. */
+    virtual void deallocate(IORangeScalar start, IORangeScalar size);
+
+/*! @function flush
+    @abstract Calls the flush action, if any deallocation is pending, and makes the pending ranges available.
+    @discussion Mappers wanting to bound the time a deallocated range stays in the I/O TLB can call this from a timer. */
+    virtual void flush(void);
+
+/*! @function getStatistics
+    @abstract Returns the counts of allocations, of those served by a CPU cache, of deallocations and of flush actions called. */
+    void getStatistics(IOMapperIOVMStatistics * stats) const;
+
+private:
+    void cacheRange(IORangeScalar start, IORangeScalar size);
+    void drainCaches(void);
+
+    OSMetaClassDeclareReservedUnused(IOMapperIOVMAllocator, 0);
+    OSMetaClassDeclareReservedUnused(IOMapperIOVMAllocator, 1);
+    OSMetaClassDeclareReservedUnused(IOMapperIOVMAllocator, 2);
+    OSMetaClassDeclareReservedUnused(IOMapperIOVMAllocator, 3);
+};
+
+#endif /* !_IOKIT_IOMAPPERIOVMALLOCATOR_H */
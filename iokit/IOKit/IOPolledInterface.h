@@ -51,6 +51,10 @@ enum
 #define kIOPolledInterfaceActiveKey  "IOPolledInterfaceActive"
 #define kIOPolledInterfaceStackKey   "IOPolledInterfaceStack"
 
+// OSNumber published alongside kIOPolledInterfaceSupportKey by pollers that
+// accept more than one outstanding startIO(), each with its own completion
+#define kIOPolledInterfaceQueueDepthKey "IOPolledInterfaceQueueDepth"
+
 enum
 {
     kIOPolledWrite = 1,
@@ -155,6 +159,7 @@ struct IOPolledFileIOVars
     IOByteCount 			bufferSize;
     IOByteCount 			bufferOffset;
     IOByteCount 			bufferHalf;
+    uint32_t				bufferCount;
     IOByteCount				extentRemaining;
     IOByteCount				lastRead;
     IOByteCount				readEnd;
@@ -166,6 +171,8 @@ struct IOPolledFileIOVars
     uint64_t				encryptEnd;
     uint64_t                            cryptBytes;
     AbsoluteTime                        cryptTime;
+    uint64_t                            ioBytes;
+    AbsoluteTime                        ioWaitTime;
     IOPolledFileExtent * 		extentMap;
     IOPolledFileExtent * 		currentExtent;
     bool				allocated;
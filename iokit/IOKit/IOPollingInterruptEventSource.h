@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#ifndef _IOKIT_IOPOLLINGINTERRUPTEVENTSOURCE_H
+#define _IOKIT_IOPOLLINGINTERRUPTEVENTSOURCE_H
+
+#include <IOKit/IOInterruptEventSource.h>
+
+class IOService;
+
+/*! @defined kIOPollingInterruptDefaultBudget
+    @discussion Number of completions a poll action is asked to handle per pass when no budget is given. */
+#define kIOPollingInterruptDefaultBudget	64
+
+/*! @class IOPollingInterruptEventSource : public IOInterruptEventSource
+    @abstract Polling varient of the $link IOInterruptEventSource.
+    @discussion An interrupt event source for devices that complete work faster than it is worth taking an interrupt for every completion.  The interrupt is masked at primary interrupt time, whatever its type, and the work loop then calls the client's poll action with a budget.  As long as the action uses up its whole budget the interrupt stays masked and the work loop keeps polling, giving the other event sources of the work loop a turn between passes; the first pass that completes less work than its budget re-enables the interrupt.
+<br><br>
+    Under load most completions are therefore picked up by polling, with a single interrupt per burst, while an idle device still gets interrupt latency.  The kInterruptAccountingPollCountIndex and kInterruptAccountingPolledCompletionsIndex statistics report how much work was done by polling.
+<br><br>
+    The interrupt controller must latch an edge triggered interrupt raised while it is masked and deliver it once re-enabled, as it does for the masking done by a level triggered IOInterruptEventSource; otherwise a completion posted between the last pass and the re-enable would go unnoticed until the next interrupt.
+*/
+class IOPollingInterruptEventSource : public IOInterruptEventSource
+{
+    OSDeclareDefaultStructors(IOPollingInterruptEventSource)
+
+public:
+/*! @typedef PollAction
+    @discussion 'C' pointer prototype of functions that are called in a single threaded context to poll the device for completions.
+    @param owner Pointer to client instance.
+    @param sender Pointer to generation interrupt event source.
+    @param budget Maximum number of completions to handle in this pass.
+    @result Number of completions handled; returning budget or more asks to be polled again. */
+    typedef UInt32 (*PollAction)(OSObject *owner, IOPollingInterruptEventSource *sender, UInt32 budget);
+
+private:
+    // Hide the superclass initializers
+    virtual bool init(OSObject *inOwner,
+		      IOInterruptEventSource::Action inAction = 0,
+		      IOService *inProvider = 0,
+		      int inIntIndex = 0) APPLE_KEXT_OVERRIDE;
+
+    static IOInterruptEventSource *
+	interruptEventSource(OSObject *inOwner,
+			     IOInterruptEventSource::Action inAction = 0,
+			     IOService *inProvider = 0,
+			     int inIntIndex = 0);
+
+protected:
+/*! @var pollBudget Number of completions passed to the poll action per pass. */
+    UInt32 pollBudget;
+
+/*! @var polling Is the interrupt held masked because the last pass used up its budget. */
+    bool polling;
+
+/*! @struct ExpansionData
+    @discussion This structure will be used to expand the capablilties of the IOPollingInterruptEventSource in the future.
+    */
+    struct ExpansionData { };
+
+/*! @var reserved
+    Reserved for future use.  (Internal use only)  */
+    APPLE_KEXT_WSHADOW_PUSH;
+    ExpansionData *reserved;
+    APPLE_KEXT_WSHADOW_POP;
+
+/*! @function checkForWork
+    @abstract Calls the poll action, then either keeps polling or re-enables the interrupt.
+    @result Return true while the interrupt is left masked for another pass. */
+    virtual bool checkForWork() APPLE_KEXT_OVERRIDE;
+
+public:
+/*! @function pollingInterruptEventSource
+    @abstract Factory function for IOPollingInterruptEventSources creation and initialisation.  See $link init.
+    @param owner Owning client of the new event source.
+    @param action 'C' Function to call to poll the device.
+    @param provider IOService that represents the interrupt source.
+    @param intIndex The index of the interrupt within the provider's interrupt sources.  Defaults to 0.
+    @param budget Completions to handle per pass.  Defaults to kIOPollingInterruptDefaultBudget.
+    @result A new interrupt event source if successfully created and initialised, 0 otherwise.  */
+    static IOPollingInterruptEventSource *
+	pollingInterruptEventSource(OSObject *owner,
+				    PollAction action,
+				    IOService *provider,
+				    int intIndex = 0,
+				    UInt32 budget = kIOPollingInterruptDefaultBudget);
+
+/*! @function init
+    @abstract Primary initialiser for the IOPollingInterruptEventSource class.
+    @param owner Owning client of the new event source.
+    @param action 'C' Function to call to poll the device.
+    @param provider IOService that represents the interrupt source.
+    @param intIndex The index of the interrupt within the provider's interrupt sources.
+    @param budget Completions to handle per pass, must not be 0.
+    @result true if the inherited classes and this instance initialise
+successfully.  */
+    virtual bool init(OSObject *owner,
+		      PollAction action,
+		      IOService *provider,
+		      int intIndex,
+		      UInt32 budget);
+
+/*! @function setPollBudget
+    @abstract Set'ter for $link pollBudget, used from the next pass on.
+    @param budget Completions to handle per pass, 0 is ignored. */
+    virtual void setPollBudget(UInt32 budget);
+
+/*! @function getPollBudget
+    @abstract Get'ter for $link pollBudget variable.
+    @result value of pollBudget. */
+    virtual UInt32 getPollBudget() const;
+
+/*! @function isPolling
+    @abstract Get'ter for $link polling variable.
+    @result true if the interrupt is masked while the work loop polls the device. */
+    virtual bool isPolling() const;
+
+/*! @function normalInterruptOccurred
+    @abstract Override $link IOInterruptEventSource::normalInterruptOccured to mask edge triggered interrupts as well. */
+    virtual void normalInterruptOccurred(void *self, IOService *prov, int ind) APPLE_KEXT_OVERRIDE;
+
+private:
+    OSMetaClassDeclareReservedUnused(IOPollingInterruptEventSource, 0);
+    OSMetaClassDeclareReservedUnused(IOPollingInterruptEventSource, 1);
+    OSMetaClassDeclareReservedUnused(IOPollingInterruptEventSource, 2);
+    OSMetaClassDeclareReservedUnused(IOPollingInterruptEventSource, 3);
+};
+
+#endif /* !_IOKIT_IOPOLLINGINTERRUPTEVENTSOURCE_H */
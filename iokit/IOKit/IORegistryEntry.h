@@ -866,6 +866,7 @@ private:
         IORegCursor  	     *	next;
         IORegistryEntry      *	current;
         OSIterator 	     *	iter;
+        OSIterator 	     *	live;
     };
     IORegCursor 		start;
     IORegCursor 	  *	where;
@@ -1393,6 +1393,7 @@ private:
     void doServiceMatch( IOOptionBits options );
     APPLE_KEXT_COMPATIBILITY_VIRTUAL
     void doServiceTerminate( IOOptionBits options );
+    void startCandidates( OSOrderedSet * startList );
 
 private:
 
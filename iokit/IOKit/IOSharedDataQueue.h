@@ -51,7 +51,9 @@ typedef struct _IODataQueueEntry IODataQueueEntry;
  *
  * <br>Each data entry can be variable sized, but the entire size of the queue data region (including overhead for each entry) must be specified up front.
  *
- * <br>In order for the IODataQueue instance to notify the user process that data is available, a notification mach port must be set.  When the queue is empty and a new entry is added, a message is sent to the specified port.
+ * <br>Kernel code posting from several contexts at once, e.g. from a filter interrupt routine and from a work loop, can use enqueueConcurrent() instead of enqueue(): producers then reserve their space with an atomic operation and need no lock of their own.  The two must not be mixed on the same queue.
+ *
+ * <br>In order for the IODataQueue instance to notify the user process that data is available, a notification mach port must be set.  When the queue is empty and a new entry is added, a message is sent to the specified port.  With setNotificationCoalescing() the message can instead be held back until several entries are queued or a timeout expires, so that a busy producer wakes the user process once per batch.
  *
  * <br>In order to make the data queue memory available to a user process, the method getMemoryDescriptor() must be used to get an IOMemoryDescriptor instance that can be mapped into a user process.  Typically, the clientMemoryForType() method on an IOUserClient instance will be used to request the IOMemoryDescriptor and then return it to be mapped into the user process.
  */
@@ -61,6 +63,12 @@ class IOSharedDataQueue : public IODataQueue
 
     struct ExpansionData { 
         UInt32 queueSize;
+        UInt32 reserveTail;
+        UInt32 publishTail;
+        UInt32 notifyThreshold;
+        UInt32 notifyPending;
+        UInt64 notifyInterval;
+        struct thread_call * notifyCall;
     };
     /*! @var reserved
         Reserved for future use.  (Internal use only)  */
@@ -86,6 +94,10 @@ protected:
      */
     Boolean setQueueSize(UInt32 size);
 
+private:
+    void dataAvailable(Boolean wasEmpty, UInt32 count);
+    static void notifyTimeout(void *param0, void *param1);
+
 public:
     /*!
      * @function withCapacity
@@ -151,6 +163,27 @@ public:
      */
     virtual Boolean enqueue(void *data, UInt32 dataSize) APPLE_KEXT_OVERRIDE;
 
+    /*!
+     * @function enqueueConcurrent
+     * @abstract Enqueues a batch of entries on the queue, safe against other concurrent callers.
+     * @discussion This method adds count entries to the queue, in order, as a single operation: either all of them are queued or, if there isn't enough room for all of them, none is.  Space is reserved with a compare and swap on a private copy of the tail, so any number of producers, including ones running in primary interrupt context, may call this concurrently; the entries are made visible to the consumer in reservation order.  Interrupts are disabled on the calling CPU while the entries are copied, the batch should therefore be kept small.<br>  This method must not be mixed with enqueue() on the same queue.
+     * @param data Array of count pointers to the data to be added to the queue.
+     * @param dataSize Array of count sizes of the data pointed to by the entries of data.
+     * @param count Number of entries to add.
+     * @result Returns true on success and false on failure.  Typically failure means that the queue is full.
+     */
+    Boolean enqueueConcurrent(void * const data[], const UInt32 dataSize[], UInt32 count);
+
+    /*!
+     * @function setNotificationCoalescing
+     * @abstract Batches the data available notifications sent to the user process.
+     * @discussion Once the queue becomes non empty, the notification is only sent once the given number of entries has been queued, or timeoutUS microseconds later, whichever comes first.  The user process must drain the queue until it is empty before waiting for the next notification, as it already has to.  A threshold of 0 or 1 restores the default of a notification for every transition from empty.
+     * @param entries Number of entries to queue before notifying.
+     * @param timeoutUS Upper bound on the delay of a notification, in microseconds.  Must not be 0 if entries is greater than 1.
+     * @result Returns kIOReturnSuccess, kIOReturnBadArgument or kIOReturnNoMemory.
+     */
+    IOReturn setNotificationCoalescing(UInt32 entries, UInt32 timeoutUS);
+
 #ifdef PRIVATE
     /* workaround for queue.h redefine, please do not use */
     __inline__ Boolean enqueue_tail(void *data, UInt32 dataSize) { return (IOSharedDataQueue::enqueue(data, dataSize)); }
@@ -34,7 +34,7 @@
 #define IOSTATISTICS_SIG_WORKLOOP   'IOSW'
 
 /* Update when the binary format changes */
-#define IOSTATISTICS_VER  			0x2
+#define IOSTATISTICS_VER  			0x3
 
 enum {
 	kIOStatisticsDriverNameLength  = 64,
@@ -103,6 +103,8 @@ typedef struct IOStatisticsCommandQueues {
 typedef struct IOStatisticsUserClients {
 	uint32_t created;
 	uint32_t clientCalls;
+	uint64_t clientCallTime;	/* ns */
+	uint64_t clientCallTimeMax;	/* ns */
 } IOStatisticsUserClients;
 
 /* General mode */
@@ -176,6 +176,8 @@ typedef struct IOUserClientCounter {
 	SLIST_ENTRY(IOUserClientCounter) link;
 	ClassNode *parentClass;
 	uint32_t clientCalls;
+	uint64_t clientCallTime;
+	uint64_t clientCallTimeMax;
 } IOUserClientCounter;
 
 class IOStatistics {
@@ -343,6 +345,7 @@ public:
 
 	/* UserClient */
 	static void countUserClientCall(IOUserClient *client);
+	static void countUserClientCallTime(IOUserClient *client, uint64_t elapsed);
 };
 
 #else
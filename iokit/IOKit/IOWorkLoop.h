@@ -270,6 +270,7 @@ protected:
     friend class IOEventSource;
     friend class IOTimerEventSource;
     friend class IOCommandGate;
+    friend class IOWorkLoopPool;
 #if IOKITSTATS
     friend class IOStatistics;
 #endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#ifndef __IOKIT_IOWORKLOOPPOOL_H
+#define __IOKIT_IOWORKLOOPPOOL_H
+
+#include <libkern/c++/OSObject.h>
+#include <IOKit/IOWorkLoop.h>
+
+class IOEventSource;
+
+/*! @class IOWorkLoopPool
+    @discussion An IOWorkLoopPool gives a driver several threads of control while keeping the single threaded model of IOWorkLoop within each serialization domain.  Every domain is an ordinary IOWorkLoop with its own thread and gate: event sources added to a domain, including IOCommandGates, are serialized against each other exactly as on a single work loop, while event sources in different domains run concurrently.
+<br><br>
+	A high throughput driver would typically put each hardware queue, with its interrupt event source and command gate, in a domain of its own, and keep the provider-facing state in domain 0.  Work that must be serialized against every domain, such as a controller reset, can be run with runActionExclusive().
+*/
+class IOWorkLoopPool : public OSObject
+{
+    OSDeclareDefaultStructors(IOWorkLoopPool)
+
+protected:
+/*! @var domains
+    Array of the per domain work loops.
+*/
+    IOWorkLoop **domains;
+
+/*! @var domainCount
+    Number of entries in domains.
+*/
+    UInt32 domainCount;
+
+/*! @struct ExpansionData
+    @discussion This structure will be used to expand the capablilties of the IOWorkLoopPool in the future.
+*/
+    struct ExpansionData { };
+
+/*! @var reserved
+    Reserved for future use.  (Internal use only)
+*/
+    ExpansionData *reserved;
+
+/*! @function free
+    @discussion Releases the work loop of every domain.  Event sources still attached to them are released by the work loops as usual.
+*/
+    virtual void free() APPLE_KEXT_OVERRIDE;
+
+public:
+
+/*! @function workLoopPool
+    @abstract Factory member function to construct and intialize a work loop pool.
+    @param count Number of serialization domains, each served by its own thread.
+    @param options Options passed to IOWorkLoop::workLoopWithOptions for every domain.
+    @result Returns a work loop pool if constructed successfully, 0 otherwise.
+*/
+    static IOWorkLoopPool *workLoopPool(UInt32 count, IOOptionBits options = 0);
+
+/*! @function initWithDomains
+    @discussion Initializes a work loop pool, creating the work loop of every domain.
+    @param count Number of serialization domains, each served by its own thread.
+    @param options Options passed to IOWorkLoop::workLoopWithOptions for every domain.
+    @result Returns true if initialized successfully, false otherwise.
+*/
+    virtual bool initWithDomains(UInt32 count, IOOptionBits options);
+
+/*! @function getDomainCount
+    @result Returns the number of serialization domains.
+*/
+    virtual UInt32 getDomainCount() const;
+
+/*! @function getWorkLoop
+    @abstract Gets the work loop serving a serialization domain.
+    @discussion The returned work loop is not retained; it is a regular IOWorkLoop and can be handed to code expecting one, e.g. returned from IOService::getWorkLoop for domain 0.
+    @param domain Index of the domain, less than getDomainCount().
+    @result Returns the work loop of the domain, 0 if domain is out of range.
+*/
+    virtual IOWorkLoop *getWorkLoop(UInt32 domain) const;
+
+/*! @function addEventSource
+    @discussion Add an event source to the work loop of a serialization domain, see IOWorkLoop::addEventSource.
+    @param newEvent Pointer to IOEventSource subclass to add.
+    @param domain Index of the domain the event source is serialized with.
+    @result Returns kIOReturnBadArgument if domain is out of range, otherwise the result of IOWorkLoop::addEventSource.
+*/
+    virtual IOReturn addEventSource(IOEventSource *newEvent, UInt32 domain);
+
+/*! @function removeEventSource
+    @discussion Remove an event source from the domain it was added to, see IOWorkLoop::removeEventSource.
+    @param toRemove Pointer to IOEventSource subclass to remove.
+    @result Returns kIOReturnBadArgument if toRemove isn't attached to a domain of this pool, otherwise the result of IOWorkLoop::removeEventSource.
+*/
+    virtual IOReturn removeEventSource(IOEventSource *toRemove);
+
+/*! @function runActionExclusive
+    @abstract Single thread a call to an action with every domain of the pool.
+    @discussion Closes the gate of every domain, in increasing domain order, calls the action and opens the gates again.  The gates being recursive, this may be called from a thread already holding the gate of domain 0, but not from one holding the gate of any other domain: that would take the gates out of order and could deadlock.
+    @param action Pointer to function to be executed with all the domains' gates held.
+    @param arg0 Parameter for action parameter, defaults to 0.
+    @param arg1 Parameter for action parameter, defaults to 0.
+    @param arg2 Parameter for action parameter, defaults to 0.
+    @param arg3 Parameter for action parameter, defaults to 0.
+    @result Returns the value of the Action callout.
+*/
+    virtual IOReturn runActionExclusive(IOWorkLoop::Action action, OSObject *target,
+			       void *arg0 = 0, void *arg1 = 0,
+			       void *arg2 = 0, void *arg3 = 0);
+
+protected:
+    OSMetaClassDeclareReservedUnused(IOWorkLoopPool, 0);
+    OSMetaClassDeclareReservedUnused(IOWorkLoopPool, 1);
+    OSMetaClassDeclareReservedUnused(IOWorkLoopPool, 2);
+    OSMetaClassDeclareReservedUnused(IOWorkLoopPool, 3);
+};
+
+#endif /* !__IOKIT_IOWORKLOOPPOOL_H */
@@ -58,6 +58,8 @@ extern "C" {
 #include <IOKit/IOLib.h>
 #include <IOKit/assert.h>
 
+#include "IOKitKernelInternal.h"
+
 #if PRAGMA_MARK
 #pragma mark Internal Declarations
 #endif
@@ -69,6 +71,7 @@ const OSSymbol * gIOClassKey;
 const OSSymbol * gIOProbeScoreKey;
 const OSSymbol * gIOModuleIdentifierKey;
 IORWLock         * gIOCatalogLock;
+IOMatchingStatistics gIOMatchingStatistics;
 
 #if PRAGMA_MARK
 #pragma mark Utility functions
@@ -193,6 +196,78 @@ void IOCatalogue::free( void )
     panic("");
 }
 
+/*********************************************************************
+* Cheap checks of the most common matching keys, done once per service
+* rather than once per personality by matchPassive().  Names are still
+* compared by the service's compareNames(), so families overriding it see
+* no difference; a single name is only compared once per service.
+*********************************************************************/
+struct IOCatalogueMatchIndex
+{
+    IOService    * service;
+    OSDictionary * names;
+    OSDictionary * properties;
+};
+
+static bool
+matchIndexPersonality(IOCatalogueMatchIndex * index, OSDictionary * personality)
+{
+    OSObject     * obj;
+    OSObject     * result;
+    OSString     * str;
+    OSCollection * collection;
+    OSIterator   * iter;
+    OSDictionary * nextDict;
+    bool           match;
+
+    obj = personality->getObject(gIONameMatchKey);
+    if ((str = OSDynamicCast(OSString, obj)))
+    {
+        result = index->names->getObject(str);
+        if (result) match = (kOSBooleanTrue == result);
+        else
+        {
+            match = index->service->compareNames(str);
+            index->names->setObject(str, match ? kOSBooleanTrue : kOSBooleanFalse);
+        }
+        if (!match) return (false);
+    }
+    else if (obj && !index->service->compareNames(obj)) return (false);
+
+    obj = personality->getObject(gIOPropertyMatchKey);
+    if (obj)
+    {
+        if (!index->properties)
+        {
+            index->properties = index->service->dictionaryWithProperties();
+            if (!index->properties) return (true);
+        }
+        if ((nextDict = OSDynamicCast(OSDictionary, obj)))
+        {
+            if (!index->properties->isEqualTo(nextDict, nextDict)) return (false);
+        }
+        else if ((collection = OSDynamicCast(OSCollection, obj)))
+        {
+            match = false;
+            iter = OSCollectionIterator::withCollection(collection);
+            if (!iter) return (true);
+            while ((obj = iter->getNextObject()))
+            {
+                if ((nextDict = OSDynamicCast(OSDictionary, obj))
+                  && index->properties->isEqualTo(nextDict, nextDict))
+                {
+                    match = true;
+                    break;
+                }
+            }
+            iter->release();
+            if (!match) return (false);
+        }
+    }
+
+    return (true);
+}
+
 /*********************************************************************
 *********************************************************************/
 OSOrderedSet *
@@ -203,13 +278,21 @@ IOCatalogue::findDrivers(
     OSDictionary         * nextTable;
     OSOrderedSet         * set;
     OSArray              * array;
+    OSArray              * candidates;
     const OSMetaClass    * meta;
     unsigned int           idx;
+    IOCatalogueMatchIndex  index;
+    SInt64                 pruned;
 
     set = OSOrderedSet::withCapacity( 1, IOServiceOrdering,
                                       (void *)gIOProbeScoreKey );
     if( !set )
 	return( 0 );
+    candidates = OSArray::withCapacity( 16 );
+    if( !candidates ) {
+	set->release();
+	return( 0 );
+    }
 
     IORWLockRead(lock);
 
@@ -217,10 +300,7 @@ IOCatalogue::findDrivers(
     while (meta)
     {
     	array = (OSArray *) personalities->getObject(meta->getClassNameSymbol());
-	if (array) for (idx = 0; (nextTable = (OSDictionary *) array->getObject(idx)); idx++)
-	{
-            set->setObject(nextTable);
-	}
+	if (array) candidates->merge(array);
 	if (meta == &IOService::gMetaClass) break;
 	meta = meta->getSuperClass();
     }
@@ -229,6 +309,29 @@ IOCatalogue::findDrivers(
 
     IORWLockUnlock(lock);
 
+    // compareNames() may call into the family, don't hold the catalogue
+    index.service    = service;
+    index.names      = OSDictionary::withCapacity( 16 );
+    index.properties = 0;
+    pruned = 0;
+
+    for (idx = 0; (nextTable = (OSDictionary *) candidates->getObject(idx)); idx++)
+    {
+	if (index.names && !matchIndexPersonality(&index, nextTable))
+	{
+	    pruned++;
+	    continue;
+	}
+	set->setObject(nextTable);
+    }
+
+    OSAddAtomic64(idx, &gIOMatchingStatistics.candidates);
+    OSAddAtomic64(pruned, &gIOMatchingStatistics.pruned);
+
+    OSSafeReleaseNULL(index.names);
+    OSSafeReleaseNULL(index.properties);
+    candidates->release();
+
     return( set );
 }
 
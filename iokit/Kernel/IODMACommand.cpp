@@ -61,6 +61,8 @@ enum
 #define fState         reserved->fState
 #define fMDSummary     reserved->fMDSummary
 
+IODMAMapStatistics gIODMAMapStatistics;
+
 
 #if 1
 // no direction => OutIn
@@ -283,6 +285,12 @@ IODMACommand::setSpecification(SegmentFunction        outSegFunc,
 	mapper = IOMapper::gSystem;
     }
 
+    // a kept mapping must still fit the command's restrictions
+    if ((mapper != fMapper) || (numAddressBits != fNumAddressBits)
+      || ((alignment ? alignment : 1) - 1 != fAlignMask)
+      || !(kPersistent & mappingOptions))
+	flushMappingCache();
+
     fNumSegments     = 0;
     fOutSeg	     = outSegFunc;
     fNumAddressBits  = numAddressBits;
@@ -330,7 +338,11 @@ IODMACommand::setSpecification(SegmentFunction        outSegFunc,
 void
 IODMACommand::free()
 {
-    if (reserved) IODelete(reserved, IODMACommandInternal, 1);
+    if (reserved)
+    {
+	if (!fActive) flushMappingCache();
+	IODelete(reserved, IODMACommandInternal, 1);
+    }
 
     if (fMapper) fMapper->release();
 
@@ -783,6 +795,56 @@ IODMACommand::prepareWithSpecification(SegmentFunction	outSegFunc,
     					offset, length, flushCache, synchronize));
 }
 
+static IODMACommandMapCacheEntry *
+IODMACommandMapCacheLookup(IODMACommandInternal * state, const IOMemoryDescriptor * md)
+{
+    IODMACommandMapCacheEntry * entry;
+
+    for (UInt32 idx = 0; idx < kIODMACommandMapCacheEntries; idx++)
+    {
+	entry = &state->fMapCache[idx];
+	if ((md == entry->fMemory)
+	  && (state->fPreparedOffset == entry->fOffset)
+	  && (state->fPreparedLength == entry->fLength)) return (entry);
+    }
+
+    return (NULL);
+}
+
+static IODMACommandMapCacheEntry *
+IODMACommandMapCacheVictim(IODMACommandInternal * state)
+{
+    IODMACommandMapCacheEntry * entry;
+    IODMACommandMapCacheEntry * victim = NULL;
+
+    for (UInt32 idx = 0; idx < kIODMACommandMapCacheEntries; idx++)
+    {
+	entry = &state->fMapCache[idx];
+	if (!entry->fMemory) return (entry);
+	if (!victim || (entry->fLastUse < victim->fLastUse)) victim = entry;
+    }
+
+    return (victim);
+}
+
+static void
+IODMACommandMapCacheDrop(IODMACommand * command, IOMapper * mapper,
+			 IODMACommandMapCacheEntry * entry)
+{
+    IOMDDMAMapArgs mapArgs;
+
+    bzero(&mapArgs, sizeof(mapArgs));
+    mapArgs.fMapper      = mapper;
+    mapArgs.fCommand     = command;
+    mapArgs.fAlloc       = entry->fAlloc;
+    mapArgs.fAllocLength = entry->fAllocLength;
+    mapArgs.fOffset      = entry->fOffset;
+    entry->fMemory->dmaCommandOperation(kIOMDDMAUnmap, &mapArgs, sizeof(mapArgs));
+
+    const_cast<IOMemoryDescriptor *>(entry->fMemory)->complete();
+    entry->fMemory->release();
+    bzero(entry, sizeof(*entry));
+}
 
 IOReturn 
 IODMACommand::prepare(UInt64 offset, UInt64 length, bool flushCache, bool synchronize)
@@ -823,6 +885,7 @@ IODMACommand::prepare(UInt64 offset, UInt64 length, bool flushCache, bool synchr
 	state->fLocalMapperAlloc       = 0;
 	state->fLocalMapperAllocValid  = false;
 	state->fLocalMapperAllocLength = 0;
+	state->fMapCached              = false;
 
 	state->fSourceAlignMask = fAlignMask;
 	if (fMapper)
@@ -854,7 +917,23 @@ IODMACommand::prepare(UInt64 offset, UInt64 length, bool flushCache, bool synchr
 	    }
 	}
 
-	if (fMapper)
+	// bounce buffers are per prepare, their mappings can't be kept
+	IODMACommandMapCacheEntry * entry;
+	bool persistent = (fMapper && (kPersistent & mappingOptions)
+			   && !state->fCopyMD && !state->fIterateOnly);
+
+	entry = persistent ? IODMACommandMapCacheLookup(state, fMemory) : NULL;
+	if (entry)
+	{
+	    entry->fLastUse = ++state->fMapCacheClock;
+	    state->fLocalMapperAlloc       = entry->fAlloc;
+	    state->fLocalMapperAllocValid  = true;
+	    state->fLocalMapperAllocLength = entry->fAllocLength;
+	    state->fMapContig              = entry->fMapContig;
+	    state->fMapCached              = true;
+	    OSIncrementAtomic64(&gIODMAMapStatistics.cacheHits);
+	}
+	else if (fMapper)
 	{
 	    IOMDDMAMapArgs mapArgs;
 	    bzero(&mapArgs, sizeof(mapArgs));
@@ -879,6 +958,29 @@ IODMACommand::prepare(UInt64 offset, UInt64 length, bool flushCache, bool synchr
 		state->fLocalMapperAllocValid  = true;
 		state->fLocalMapperAllocLength = mapArgs.fAllocLength;
 		state->fMapContig = mapArgs.fMapContig;
+		if (persistent)
+		{
+		    OSIncrementAtomic64(&gIODMAMapStatistics.cacheMisses);
+		    entry = IODMACommandMapCacheVictim(state);
+		    if (entry->fMemory)
+		    {
+			OSIncrementAtomic64(&gIODMAMapStatistics.cacheEvictions);
+			IODMACommandMapCacheDrop(this, fMapper, entry);
+		    }
+		    // the cache keeps the memory wired for as long as it is mapped
+		    if (kIOReturnSuccess == const_cast<IOMemoryDescriptor *>(fMemory)->prepare())
+		    {
+			fMemory->retain();
+			entry->fMemory      = fMemory;
+			entry->fOffset      = state->fPreparedOffset;
+			entry->fLength      = state->fPreparedLength;
+			entry->fAlloc       = mapArgs.fAlloc;
+			entry->fAllocLength = mapArgs.fAllocLength;
+			entry->fMapContig   = mapArgs.fMapContig;
+			entry->fLastUse     = ++state->fMapCacheClock;
+			state->fMapCached   = true;
+		    }
+		}
 	    }
 	    if (NULL != IOMapper::gSystem) ret = kIOReturnSuccess;
 	}
@@ -923,7 +1025,15 @@ IODMACommand::complete(bool invalidateCache, bool synchronize)
 		ret = walkAll(op);
 	}
 
-	if (state->fLocalMapperAllocValid)
+	if (state->fMapCached)
+	{
+	    // the mapping stays with the cache entry
+	    state->fLocalMapperAlloc       = 0;
+	    state->fLocalMapperAllocValid  = false;
+	    state->fLocalMapperAllocLength = 0;
+	    state->fMapCached              = false;
+	}
+	else if (state->fLocalMapperAllocValid)
     	{
 	    IOMDDMAMapArgs mapArgs;
 	    bzero(&mapArgs, sizeof(mapArgs));
@@ -952,6 +1062,25 @@ IODMACommand::complete(bool invalidateCache, bool synchronize)
     return ret;
 }
 
+IOReturn
+IODMACommand::flushMappingCache(const IOMemoryDescriptor * memory)
+{
+    IODMACommandInternal      * state = fInternalState;
+    IODMACommandMapCacheEntry * entry;
+
+    if (fActive) return (kIOReturnBusy);
+
+    for (UInt32 idx = 0; idx < kIODMACommandMapCacheEntries; idx++)
+    {
+	entry = &state->fMapCache[idx];
+	if (!entry->fMemory) continue;
+	if (memory && (memory != entry->fMemory)) continue;
+	IODMACommandMapCacheDrop(this, fMapper, entry);
+    }
+
+    return (kIOReturnSuccess);
+}
+
 IOReturn
 IODMACommand::getPreparedOffsetAndLength(UInt64 * offset, UInt64 * length)
 {
@@ -180,6 +180,13 @@ to restrict I/O ops.
 extern "C" addr64_t		kvtophys(vm_offset_t va);
 extern "C" ppnum_t		pmap_find_phys(pmap_t pmap, addr64_t va);
 
+// vm/lz4.h isn't C++ clean; the hash table is LZ4_COMPRESS_HASH_ENTRIES lz4_hash_entry_t's
+#define kIOHibernateLZ4ScratchSize	(1024 * 2 * sizeof(uint32_t))
+extern "C" size_t		lz4raw_encode_buffer(uint8_t * dst_buffer, size_t dst_size,
+						const uint8_t * src_buffer, size_t src_size, void * hash_table);
+extern "C" size_t		lz4raw_decode_buffer(uint8_t * dst_buffer, size_t dst_size,
+						const uint8_t * src_buffer, size_t src_size, void * work);
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #define	DISABLE_TRIM		0
@@ -455,7 +462,7 @@ IOHibernateSystemSleep(void)
     do
     {
         vars->srcBuffer = IOBufferMemoryDescriptor::withOptions(kIODirectionOutIn,
-				    2 * page_size + WKdm_SCRATCH_BUF_SIZE_INTERNAL, page_size);
+				    2 * page_size + WKdm_SCRATCH_BUF_SIZE_INTERNAL + kIOHibernateLZ4ScratchSize, page_size);
 
 	vars->handoffBuffer = IOBufferMemoryDescriptor::withOptions(kIODirectionOutIn,
 				    ptoa_64(gIOHibernateHandoffPageCount), page_size);
@@ -1474,6 +1481,7 @@ hibernate_write_image(void)
     uint8_t *	 data;
     uint8_t *	 compressed;
     uint8_t *	 scratch;
+    uint8_t *	 lz4scratch;
     IOByteCount  pageCompressedSize;
     uint64_t	 compressedSize, uncompressedSize;
     uint64_t	 image1Size = 0;
@@ -1481,7 +1489,8 @@ hibernate_write_image(void)
     bool	 iterDone, pollerOpen, needEncrypt;
     uint32_t	 restore1Sum, sum, sum1, sum2;
     int          wkresult;
-    uint32_t	 tag;
+    size_t       lz4result;
+    uint32_t	 tag, tagFlags;
     uint32_t	 pageType;
     uint32_t	 pageAndCount[2];
     addr64_t     phys64;
@@ -1502,6 +1511,7 @@ hibernate_write_image(void)
     uint32_t	 wiredPagesClear;
     uint32_t	 svPageCount;
     uint32_t	 zvPageCount;
+    uint32_t	 lz4PageCount;
 
     IOPolledFileCryptVars _cryptvars;
     IOPolledFileCryptVars * cryptvars = 0;
@@ -1511,6 +1521,7 @@ hibernate_write_image(void)
     wiredPagesClear     = 0;
     svPageCount         = 0;
     zvPageCount         = 0;
+    lz4PageCount        = 0;
 
     if (!vars->fileVars
     || !vars->fileVars->pollers
@@ -1816,6 +1827,7 @@ hibernate_write_image(void)
         src = (uint8_t *) vars->srcBuffer->getBytesNoCopy();
 	compressed = src + page_size;
         scratch    = compressed + page_size;
+        lz4scratch = scratch + WKdm_SCRATCH_BUF_SIZE_INTERNAL;
 
         pagesDone  = 0;
         lastBlob   = 0;
@@ -1925,6 +1937,19 @@ hibernate_write_image(void)
 						 (WK_word*) scratch,
 						 page_size - 4);
 
+                    // LZ4 finds byte oriented redundancy WKdm can't; image2 is only ever read back by the kernel
+                    tagFlags = 0;
+                    if ((-1 == wkresult) && (kUnwiredEncrypt == pageType) && (kIOHibernateModeLZ4 & gIOHibernateMode))
+                    {
+                        lz4result = lz4raw_encode_buffer(compressed, page_size - 4, src, page_size, lz4scratch);
+                        if (lz4result)
+                        {
+                            wkresult = (int) lz4result;
+                            tagFlags = kIOHibernateTagLZ4;
+                            lz4PageCount++;
+                        }
+                    }
+
                     clock_get_uptime(&endTime);
                     ADD_ABSOLUTETIME(&compTime, &endTime);
                     SUB_ABSOLUTETIME(&compTime, &startTime);
@@ -1950,7 +1975,7 @@ hibernate_write_image(void)
 			    data = src;
 		    }
 
-                    tag = pageCompressedSize | kIOHibernateTagSignature;
+                    tag = pageCompressedSize | tagFlags | kIOHibernateTagSignature;
                     err = IOHibernatePolledFileWrite(vars->fileVars, (const uint8_t *) &tag, sizeof(tag), cryptvars);
                     if (kIOReturnSuccess != err)
                         break;
@@ -2047,6 +2072,17 @@ hibernate_write_image(void)
 	header->compression     = (compressedSize << 8) / uncompressedSize;
 	gIOHibernateCompression = header->compression;
 
+	// per phase timing, for hibernate statistics on wake
+	clock_get_uptime(&endTime);
+	SUB_ABSOLUTETIME(&endTime, &allTime);
+	absolutetime_to_nanoseconds(endTime, &nsec);
+	header->imageWriteTime    = nsec / 1000000ULL;
+	absolutetime_to_nanoseconds(compTime, &nsec);
+	header->imageCompressTime = nsec / 1000000ULL;
+	absolutetime_to_nanoseconds(vars->fileVars->cryptTime, &nsec);
+	header->imageCryptTime    = nsec / 1000000ULL;
+	header->lz4PageCount      = lz4PageCount;
+
         count = vars->fileVars->fileExtents->getLength();
         if (count > sizeof(header->fileExtentMap))
         {
@@ -2079,6 +2115,13 @@ hibernate_write_image(void)
     absolutetime_to_nanoseconds(endTime, &nsec);
     HIBLOG("all time: %qd ms, ", nsec / 1000000ULL);
 
+    HIBLOG("io bytes: %qd %qd Mb/s, queue depth %d, ",
+		vars->fileVars->ioBytes,
+		nsec ? (((vars->fileVars->ioBytes * 1000000000ULL) / 1024 / 1024) / nsec) : 0,
+		vars->fileVars->bufferCount - 1);
+    absolutetime_to_nanoseconds(vars->fileVars->ioWaitTime, &nsec);
+    HIBLOG("io wait time: %qd ms, ", nsec / 1000000ULL);
+
     absolutetime_to_nanoseconds(compTime, &nsec);
     HIBLOG("comp bytes: %qd time: %qd ms %qd Mb/s, ",
 		compBytes,
@@ -2097,8 +2140,8 @@ hibernate_write_image(void)
                uncompressedSize ? ((int) ((compressedSize * 100ULL) / uncompressedSize)) : 0,
                sum1, sum2);
 
-    HIBLOG("svPageCount %d, zvPageCount %d, wiredPagesEncrypted %d, wiredPagesClear %d, dirtyPagesEncrypted %d\n",
-	   svPageCount, zvPageCount, wiredPagesEncrypted, wiredPagesClear, dirtyPagesEncrypted);
+    HIBLOG("svPageCount %d, zvPageCount %d, lz4PageCount %d, wiredPagesEncrypted %d, wiredPagesClear %d, dirtyPagesEncrypted %d\n",
+	   svPageCount, zvPageCount, lz4PageCount, wiredPagesEncrypted, wiredPagesClear, dirtyPagesEncrypted);
 
     if (pollerOpen)
         IOPolledFilePollersClose(vars->fileVars, (kIOReturnSuccess == err) ? kIOPolledBeforeSleepState : kIOPolledBeforeSleepStateAborted );
@@ -2151,6 +2194,7 @@ hibernate_machine_init(void)
     uint32_t     sum;
     uint32_t     pagesDone;
     uint32_t     pagesRead = 0;
+    uint32_t     lz4Pages = 0;
     AbsoluteTime startTime, compTime;
     AbsoluteTime allTime, endTime;
     AbsoluteTime startIOTime, endIOTime;
@@ -2195,6 +2239,10 @@ hibernate_machine_init(void)
     gIOHibernateStats->imageSize   = gIOHibernateCurrentHeader->imageSize;
     gIOHibernateStats->image1Pages = pagesDone;
 
+    gIOHibernateStats->imageWriteDuration    = gIOHibernateCurrentHeader->imageWriteTime;
+    gIOHibernateStats->imageCompressDuration = gIOHibernateCurrentHeader->imageCompressTime;
+    gIOHibernateStats->imageCryptDuration    = gIOHibernateCurrentHeader->imageCryptTime;
+
 	/* HIBERNATE_stats */
 	KDBG(IOKDBG_CODE(DBG_HIBERNATE, 14), gIOHibernateStats->smcStart,
 			gIOHibernateStats->booterStart, gIOHibernateStats->booterDuration,
@@ -2397,7 +2445,7 @@ hibernate_machine_init(void)
 		break;
 
 	    compressedSize = kIOHibernateTagLength & tag;
-	    if (kIOHibernateTagSignature != (tag & ~kIOHibernateTagLength))
+	    if (kIOHibernateTagSignature != (tag & ~(kIOHibernateTagLength | kIOHibernateTagLZ4)))
 	    {
 		err = kIOReturnIPCError;
 		break;
@@ -2411,7 +2459,15 @@ hibernate_machine_init(void)
 		decoOffset = page_size;
 		clock_get_uptime(&startTime);
 
-		if (compressedSize == 4) {
+		if (kIOHibernateTagLZ4 & tag) {
+		    if (page_size != lz4raw_decode_buffer(compressed, page_size, src, compressedSize, NULL))
+		    {
+			err = kIOReturnIPCError;
+			break;
+		    }
+		    lz4Pages++;
+		}
+		else if (compressedSize == 4) {
 		    int i;
 		    uint32_t *s, *d;
 
@@ -2485,18 +2541,22 @@ hibernate_machine_init(void)
 
     gIOHibernateStats->kernelImageReadDuration = nsec / 1000000ULL;
     gIOHibernateStats->imagePages              = pagesDone;
+    gIOHibernateStats->kernelImageIODuration   = nsecIO / 1000000ULL;
+    gIOHibernateStats->lz4Pages                = lz4Pages;
 
     HIBLOG("hibernate_machine_init pagesDone %d sum2 %x, time: %d ms, disk(0x%x) %qd Mb/s, ",
 		pagesDone, sum, gIOHibernateStats->kernelImageReadDuration, kDefaultIOSize,
 		nsecIO ? ((((gIOHibernateCurrentHeader->imageSize - gIOHibernateCurrentHeader->image1Size) * 1000000000ULL) / 1024 / 1024) / nsecIO) : 0);
 
     absolutetime_to_nanoseconds(compTime, &nsec);
+    gIOHibernateStats->kernelImageDecompressDuration = nsec / 1000000ULL;
     HIBLOG("comp bytes: %qd time: %qd ms %qd Mb/s, ",
 		compBytes,
 		nsec / 1000000ULL,
 		nsec ? (((compBytes * 1000000000ULL) / 1024 / 1024) / nsec) : 0);
 
     absolutetime_to_nanoseconds(vars->fileVars->cryptTime, &nsec);
+    gIOHibernateStats->kernelImageCryptDuration = nsec / 1000000ULL;
     HIBLOG("crypt bytes: %qd time: %qd ms %qd Mb/s\n",
 		vars->fileVars->cryptBytes,
 		nsec / 1000000ULL,
@@ -66,6 +66,7 @@ typedef struct IOHibernateVars IOHibernateVars;
 enum
 {
     kIOHibernateTagSignature = 0x53000000,
+    kIOHibernateTagLZ4       = 0x00800000,	// page compressed with LZ4 rather than WKdm, image2 only
     kIOHibernateTagLength    = 0x00001fff,
 };
 
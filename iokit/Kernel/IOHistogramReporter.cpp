@@ -29,6 +29,11 @@
 #define __STDC_LIMIT_MACROS     // what are the C++ equivalents?
 #include <stdint.h>
 
+extern "C" {
+#include <machine/machine_routines.h>
+#include <kern/cpu_number.h>
+}
+
 #include <IOKit/IOKernelReportStructs.h>
 #include <IOKit/IOKernelReporters.h>
 #include "IOReporterDefs.h"
@@ -69,6 +74,29 @@ IOHistogramReporter::with(IOService *reportingService,
 }
 
 
+/* static */
+IOHistogramReporter*
+IOHistogramReporter::withPerCPU(IOService *reportingService,
+                                IOReportCategories categories,
+                                uint64_t channelID,
+                                const char *channelName,
+                                IOReportUnit unit,
+                                int nSegments,
+                                IOHistogramSegmentConfig *config)
+{
+    IOHistogramReporter *reporter;
+
+    reporter = IOHistogramReporter::with(reportingService, categories,
+                                         channelID, channelName,
+                                         unit, nSegments, config);
+    if (reporter && !reporter->initPerCPU()) {
+        OSSafeReleaseNULL(reporter);
+    }
+
+    return reporter;
+}
+
+
 bool
 IOHistogramReporter::initWith(IOService *reportingService,
                               IOReportCategories categories,
@@ -252,9 +280,50 @@ finish:
 }
 
 
+bool
+IOHistogramReporter::initPerCPU(void)
+{
+    bool result = false;
+    IOReturn res;        // for PREFL_MEMOP
+    size_t bucketsSize;
+    unsigned int cpu;
+    int cnt;
+    IOHistogramReportValues *row;
+
+    PREFL_MEMOP_FAIL(_bucketCount, IOHistogramReportValues);
+
+    // ::free() sizes the buffer with these
+    _perCPUCount = ml_get_max_cpus();
+    _perCPURowSize = IOREPORTER_PERCPU_ROW_SIZE((size_t)_bucketCount * sizeof(IOHistogramReportValues));
+
+    bucketsSize = _perCPUCount * _perCPURowSize;
+    _perCPUBuckets = (IOHistogramReportValues *)IOMallocAligned(bucketsSize, IOREPORTER_PERCPU_ALIGN);
+    if (!_perCPUBuckets)        goto finish;
+    memset(_perCPUBuckets, 0, bucketsSize);
+
+    for (cpu = 0; cpu < _perCPUCount; cpu++) {
+        row = (IOHistogramReportValues *)((uint8_t *)_perCPUBuckets + cpu * _perCPURowSize);
+        for (cnt = 0; cnt < _bucketCount; cnt++) {
+            row[cnt].bucket_min = kIOReportInvalidIntValue;
+            row[cnt].bucket_max = kIOReportInvalidIntValue;
+            row[cnt].bucket_sum = kIOReportInvalidIntValue;
+        }
+    }
+
+    // success
+    result = true;
+
+finish:
+    return result;
+}
+
+
 void
 IOHistogramReporter::free(void)
 {
+    if (_perCPUBuckets) {
+        IOFreeAligned(_perCPUBuckets, _perCPUCount * _perCPURowSize);
+    }
     if (_bucketBounds) {
         PREFL_MEMOP_PANIC(_nElements, int64_t);
         IOFree(_bucketBounds, (size_t)_nElements * sizeof(int64_t));
@@ -312,6 +381,10 @@ IOHistogramReporter::overrideBucketValues(unsigned int index,
 {
     IOReturn result;
     IOHistogramReportValues bucket;
+
+    // the per-CPU buckets would overwrite it at the next merge
+    if (_perCPUBuckets)     return kIOReturnUnsupported;
+
     lockReporter();
 
     if (index >= (unsigned int)_bucketCount) {
@@ -331,39 +404,113 @@ finish:
 }
 
 int
-IOHistogramReporter::tallyValue(int64_t value)
+IOHistogramReporter::findBucket(int64_t value)
 {
-    int result = -1;
-    int cnt = 0, element_index = 0;
-    IOHistogramReportValues hist_values;
-    
-    lockReporter();
-    
+    int cnt;
+
     // Iterate over _bucketCount minus one to make last bucket of infinite width
     for (cnt = 0; cnt < _bucketCount - 1; cnt++) {
         if (value <= _bucketBounds[cnt]) break;
     }
+
+    return cnt;
+}
+
+
+static void
+IOHistogramTally(IOHistogramReportValues *hist_values, int64_t value)
+{
+    // init stats on first hit
+    if (hist_values->bucket_hits == 0) {
+        hist_values->bucket_min = hist_values->bucket_max = value;
+        hist_values->bucket_sum = 0;     // += is below
+    }
+
+    // update all values
+    if (value < hist_values->bucket_min) {
+        hist_values->bucket_min = value;
+    } else if (value > hist_values->bucket_max) {
+        hist_values->bucket_max = value;
+    }
+    hist_values->bucket_sum += value;
+    hist_values->bucket_hits++;
+}
+
+
+IOReturn
+IOHistogramReporter::updateChannelValues(int channel_index)
+{
+    IOHistogramReportValues hist_values, *bucket;
+    unsigned int cpu;
+    int cnt;
+
+    IOREPORTER_CHECK_LOCK();
+
+    if (!_perCPUBuckets)      return kIOReturnSuccess;
+
+    // The per-CPU buckets hold all tallies ever made, so the channel is
+    // rebuilt from them rather than updated.
+    for (cnt = 0; cnt < _bucketCount; cnt++) {
+        hist_values.bucket_hits = 0;
+        hist_values.bucket_min = kIOReportInvalidIntValue;
+        hist_values.bucket_max = kIOReportInvalidIntValue;
+        hist_values.bucket_sum = kIOReportInvalidIntValue;
+
+        for (cpu = 0; cpu < _perCPUCount; cpu++) {
+            bucket = (IOHistogramReportValues *)((uint8_t *)_perCPUBuckets + cpu * _perCPURowSize) + cnt;
+            if (bucket->bucket_hits == 0)     continue;
+
+            if (hist_values.bucket_hits == 0) {
+                hist_values.bucket_min = bucket->bucket_min;
+                hist_values.bucket_max = bucket->bucket_max;
+                hist_values.bucket_sum = 0;
+            }
+            if (bucket->bucket_min < hist_values.bucket_min) {
+                hist_values.bucket_min = bucket->bucket_min;
+            }
+            if (bucket->bucket_max > hist_values.bucket_max) {
+                hist_values.bucket_max = bucket->bucket_max;
+            }
+            hist_values.bucket_sum += bucket->bucket_sum;
+            hist_values.bucket_hits += bucket->bucket_hits;
+        }
+
+        if (setElementValues(cnt, (IOReportElementValues *)&hist_values) != kIOReturnSuccess) {
+            return kIOReturnError;
+        }
+    }
+
+    return kIOReturnSuccess;
+}
+
+
+int
+IOHistogramReporter::tallyValue(int64_t value)
+{
+    int result = -1;
+    int element_index = 0;
+    IOHistogramReportValues hist_values;
+    IOHistogramReportValues *row;
+    boolean_t istate;
+
+    element_index = findBucket(value);
+
+    if (_perCPUBuckets) {
+        // only this CPU writes its row, interrupts off keeps it that way
+        istate = ml_set_interrupts_enabled(FALSE);
+        row = (IOHistogramReportValues *)((uint8_t *)_perCPUBuckets + (cpu_number() % _perCPUCount) * _perCPURowSize);
+        IOHistogramTally(&row[element_index], value);
+        ml_set_interrupts_enabled(istate);
+        return element_index;
+    }
     
-    element_index = cnt;
+    lockReporter();
     
     if (copyElementValues(element_index, (IOReportElementValues *)&hist_values) != kIOReturnSuccess) {
         goto finish;
     }
     
-    // init stats on first hit
-    if (hist_values.bucket_hits == 0) {
-        hist_values.bucket_min = hist_values.bucket_max = value;
-        hist_values.bucket_sum = 0;     // += is below
-    }
-
-    // update all values
-    if (value < hist_values.bucket_min) {
-        hist_values.bucket_min = value;
-    } else if (value > hist_values.bucket_max) {
-        hist_values.bucket_max = value;
-    }
-    hist_values.bucket_sum += value;
-    hist_values.bucket_hits++;
+    IOHistogramTally(&hist_values, value);
     
     if (setElementValues(element_index, (IOReportElementValues *)&hist_values)
                 != kIOReturnSuccess) {
@@ -37,7 +37,9 @@ uint32_t gInterruptAccountingStatisticBitmask =
 	IA_GET_ENABLE_BIT(kInterruptAccountingSecondLevelSystemTimeIndex) |
 #endif
 	IA_GET_ENABLE_BIT(kInterruptAccountingFirstLevelCountIndex) |
-	IA_GET_ENABLE_BIT(kInterruptAccountingSecondLevelCountIndex);
+	IA_GET_ENABLE_BIT(kInterruptAccountingSecondLevelCountIndex) |
+	IA_GET_ENABLE_BIT(kInterruptAccountingPollCountIndex) |
+	IA_GET_ENABLE_BIT(kInterruptAccountingPolledCompletionsIndex);
 
 IOLock * gInterruptAccountingDataListLock = NULL;
 queue_head_t gInterruptAccountingDataList;
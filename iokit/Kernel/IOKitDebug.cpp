@@ -192,6 +192,7 @@ void IOKitDiagnostics::updateOffset( OSDictionary * dict,
 bool IOKitDiagnostics::serialize(OSSerialize *s) const
 {
     OSDictionary *      dict;
+    OSObject *          obj;
     bool                ok;
 
     dict = OSDictionary::withCapacity( 5 );
@@ -203,6 +204,25 @@ bool IOKitDiagnostics::serialize(OSSerialize *s) const
     updateOffset( dict, debug_iomalloc_size, "IOMalloc allocation" );
     updateOffset( dict, debug_iomallocpageable_size, "Pageable allocation" );
 
+    updateOffset( dict, gIOMatchingStatistics.candidates, "Matching candidates" );
+    updateOffset( dict, gIOMatchingStatistics.pruned, "Matching candidates pruned" );
+    updateOffset( dict, gIOMatchingStatistics.evaluated, "Matching candidates evaluated" );
+    updateOffset( dict, gIOMatchingStatistics.matched, "Matching candidates matched" );
+
+    updateOffset( dict, gIODMAMapStatistics.cacheHits, "DMA map cache hits" );
+    updateOffset( dict, gIODMAMapStatistics.cacheMisses, "DMA map cache misses" );
+    updateOffset( dict, gIODMAMapStatistics.cacheEvictions, "DMA map cache evictions" );
+    updateOffset( dict, gIODMAMapStatistics.unmaps, "DMA unmaps" );
+
+    if( (obj = IOServiceCopyStartStatistics())) {
+        dict->setObject( "Driver start statistics", obj );
+        obj->release();
+    }
+    if( (obj = IOServiceCopyStartTimeline())) {
+        dict->setObject( "Driver start timeline", obj );
+        obj->release();
+    }
+
     OSMetaClass::serializeClassDictionary(dict);
 
     ok = dict->serialize( s );
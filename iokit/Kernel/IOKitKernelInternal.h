@@ -113,6 +113,29 @@ __END_DECLS
        (type)(uintptr_t)(expr_); })
 
 
+// Mapping kept by a kPersistent IODMACommand after complete()
+struct IODMACommandMapCacheEntry
+{
+    const IOMemoryDescriptor * fMemory;
+    UInt64 fOffset;
+    UInt64 fLength;
+    UInt64 fAlloc;
+    UInt64 fAllocLength;
+    UInt64 fLastUse;
+    UInt8  fMapContig;
+};
+
+enum { kIODMACommandMapCacheEntries = 4 };
+
+struct IODMAMapStatistics
+{
+    SInt64 cacheHits;
+    SInt64 cacheMisses;
+    SInt64 cacheEvictions;
+    SInt64 unmaps;
+};
+extern IODMAMapStatistics gIODMAMapStatistics;
+
 struct IODMACommandInternal
 {
     IOMDDMAWalkSegmentState      fState;
@@ -135,6 +158,7 @@ struct IODMACommandInternal
     UInt8  fIOVMAddrValid;
     UInt8  fForceDoubleBuffer;
     UInt8  fSetActiveNoMapper;
+    UInt8  fMapCached;
 
     vm_page_t fCopyPageAlloc;
     vm_page_t fCopyNext;
@@ -149,6 +173,9 @@ struct IODMACommandInternal
 
     IOService * fDevice;
 
+    UInt64                    fMapCacheClock;
+    IODMACommandMapCacheEntry fMapCache[kIODMACommandMapCacheEntries];
+
     // IODMAEventSource use
     IOReturn fStatus;
     UInt64   fActualByteCount;
@@ -230,6 +257,20 @@ extern const  OSSymbol * gAKSGetKey;
 
 void IOScreenLockTimeUpdate(clock_sec_t secs);
 
+OSDictionary * IOServiceCopyStartStatistics(void);
+OSArray *      IOServiceCopyStartTimeline(void);
+
+// Personalities seen by IOCatalogue::findDrivers(service), how many the
+// name and property prefilter dropped, and how the rest fared in matchPassive
+struct IOMatchingStatistics
+{
+    SInt64 candidates;
+    SInt64 pruned;
+    SInt64 evaluated;
+    SInt64 matched;
+};
+extern IOMatchingStatistics gIOMatchingStatistics;
+
 void     IOCPUInitialize(void);
 IOReturn IOInstallServicePlatformActions(IOService * service);
 IOReturn IORemoveServicePlatformActions(IOService * service);
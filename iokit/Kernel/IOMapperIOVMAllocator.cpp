@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+extern "C" {
+#include <machine/machine_routines.h>
+#include <kern/cpu_number.h>
+}
+
+#include <IOKit/IOMapperIOVMAllocator.h>
+#include <IOKit/IOLib.h>
+#include <libkern/OSAtomic.h>
+
+#define super OSObject
+
+OSDefineMetaClassAndStructors(IOMapperIOVMAllocator, OSObject);
+
+OSMetaClassDefineReservedUnused(IOMapperIOVMAllocator, 0);
+OSMetaClassDefineReservedUnused(IOMapperIOVMAllocator, 1);
+OSMetaClassDefineReservedUnused(IOMapperIOVMAllocator, 2);
+OSMetaClassDefineReservedUnused(IOMapperIOVMAllocator, 3);
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+// Sizes of 1 to 128 units are cached, in power of two classes
+enum { kIOMapperIOVMSizeClasses = 8 };
+enum { kIOMapperIOVMMagazineSize = 16 };
+
+struct IOMapperIOVMMagazine
+{
+    UInt32        count;
+    IORangeScalar ranges[kIOMapperIOVMMagazineSize];
+};
+
+// A CPU takes from its loaded magazine, and swaps in the previous one when
+// it runs empty or full, so an alloc/free pattern on the boundary of a
+// magazine doesn't go to the range allocator every time.
+struct IOMapperIOVMCPUCache
+{
+    IOSimpleLock *       lock;
+    IOMapperIOVMMagazine loaded[kIOMapperIOVMSizeClasses];
+    IOMapperIOVMMagazine previous[kIOMapperIOVMSizeClasses];
+};
+
+struct IOMapperIOVMRange
+{
+    IORangeScalar start;
+    IORangeScalar size;
+};
+
+static int
+IOMapperIOVMSizeClass(IORangeScalar size)
+{
+    int sizeClass;
+
+    for (sizeClass = 0; sizeClass < kIOMapperIOVMSizeClasses; sizeClass++)
+    {
+	if (size <= (1ULL << sizeClass)) return (sizeClass);
+    }
+
+    return (-1);
+}
+
+static void
+IOMapperIOVMSwap(IOMapperIOVMMagazine * a, IOMapperIOVMMagazine * b)
+{
+    IOMapperIOVMMagazine temp;
+
+    temp = *a;
+    *a   = *b;
+    *b   = temp;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+IOMapperIOVMAllocator *
+IOMapperIOVMAllocator::withRange(IORangeScalar start, IORangeScalar size,
+				 OSObject * target, FlushAction action,
+				 UInt32 flushBatch)
+{
+    IOMapperIOVMAllocator * me = new IOMapperIOVMAllocator;
+
+    if (me && !me->init(start, size, target, action, flushBatch))
+    {
+	me->release();
+	return (0);
+    }
+
+    return (me);
+}
+
+bool
+IOMapperIOVMAllocator::init(IORangeScalar start, IORangeScalar size,
+			    OSObject * inTarget, FlushAction inAction,
+			    UInt32 inFlushBatch)
+{
+    if (!super::init()) return (false);
+
+    if (!size || !inAction) return (false);
+
+    target     = inTarget;
+    action     = inAction;
+    flushBatch = inFlushBatch ? inFlushBatch : kIOMapperIOVMDefaultFlushBatch;
+
+    ranges = IORangeAllocator::withRange(0, 1, 64, IORangeAllocator::kLocking);
+    if (!ranges) return (false);
+    ranges->deallocate(start, size);
+
+    cpuCount  = ml_get_max_cpus();
+    cpuCaches = IONew(IOMapperIOVMCPUCache, cpuCount);
+    if (!cpuCaches) return (false);
+    bzero(cpuCaches, cpuCount * sizeof(IOMapperIOVMCPUCache));
+    for (UInt32 cpu = 0; cpu < cpuCount; cpu++)
+    {
+	cpuCaches[cpu].lock = IOSimpleLockAlloc();
+	if (!cpuCaches[cpu].lock) return (false);
+    }
+
+    pendingLock = IOSimpleLockAlloc();
+    flushLock   = IOLockAlloc();
+    pending     = IONew(IOMapperIOVMRange, flushBatch);
+    flushing    = IONew(IOMapperIOVMRange, flushBatch);
+    if (!pendingLock || !flushLock || !pending || !flushing) return (false);
+
+    return (true);
+}
+
+void
+IOMapperIOVMAllocator::free()
+{
+    // the mapper's translations go with it, nothing left to invalidate
+    if (cpuCaches)
+    {
+	for (UInt32 cpu = 0; cpu < cpuCount; cpu++)
+	{
+	    if (cpuCaches[cpu].lock) IOSimpleLockFree(cpuCaches[cpu].lock);
+	}
+	IODelete(cpuCaches, IOMapperIOVMCPUCache, cpuCount);
+	cpuCaches = 0;
+    }
+    if (pending)     IODelete(pending, IOMapperIOVMRange, flushBatch);
+    if (flushing)    IODelete(flushing, IOMapperIOVMRange, flushBatch);
+    if (pendingLock) IOSimpleLockFree(pendingLock);
+    if (flushLock)   IOLockFree(flushLock);
+    if (ranges)      ranges->release();
+
+    super::free();
+}
+
+bool
+IOMapperIOVMAllocator::allocate(IORangeScalar size, IORangeScalar * result,
+				IORangeScalar alignment)
+{
+    IOMapperIOVMCPUCache * cache;
+    IOMapperIOVMMagazine * magazine;
+    int                    sizeClass;
+    bool                   ok;
+
+    OSIncrementAtomic64(&allocations);
+
+    sizeClass = IOMapperIOVMSizeClass(size);
+    if (sizeClass >= 0)
+    {
+	// cached or not, a range of a size class has the class' size
+	size = (1ULL << sizeClass);
+
+	if (alignment <= 1)
+	{
+	    cache = &cpuCaches[cpu_number() % cpuCount];
+	    IOSimpleLockLock(cache->lock);
+	    magazine = &cache->loaded[sizeClass];
+	    if (!magazine->count) IOMapperIOVMSwap(magazine, &cache->previous[sizeClass]);
+	    ok = (0 != magazine->count);
+	    if (ok) *result = magazine->ranges[--magazine->count];
+	    IOSimpleLockUnlock(cache->lock);
+
+	    if (ok)
+	    {
+		OSIncrementAtomic64(&cacheHits);
+		return (true);
+	    }
+	}
+    }
+
+    if (ranges->allocate(size, result, alignment)) return (true);
+
+    // reclaim what is waiting for an invalidation, then what other CPUs hold
+    flush();
+    if (ranges->allocate(size, result, alignment)) return (true);
+
+    drainCaches();
+    return (ranges->allocate(size, result, alignment));
+}
+
+void
+IOMapperIOVMAllocator::deallocate(IORangeScalar start, IORangeScalar size)
+{
+    bool queued;
+    bool full;
+
+    OSIncrementAtomic64(&deallocations);
+
+    do
+    {
+	IOSimpleLockLock(pendingLock);
+	queued = (pendingCount < flushBatch);
+	if (queued)
+	{
+	    pending[pendingCount].start = start;
+	    pending[pendingCount].size  = size;
+	    pendingCount++;
+	}
+	full = (pendingCount == flushBatch);
+	IOSimpleLockUnlock(pendingLock);
+
+	if (full) flush();
+    }
+    while (!queued);
+}
+
+void
+IOMapperIOVMAllocator::flush(void)
+{
+    IOMapperIOVMRange * swap;
+    UInt32              count;
+
+    IOLockLock(flushLock);
+
+    IOSimpleLockLock(pendingLock);
+    count        = pendingCount;
+    swap         = flushing;
+    flushing     = pending;
+    pending      = swap;
+    pendingCount = 0;
+    IOSimpleLockUnlock(pendingLock);
+
+    if (count)
+    {
+	// one invalidation covers the whole batch
+	(*action)(target, this);
+	OSIncrementAtomic64(&flushes);
+
+	for (UInt32 idx = 0; idx < count; idx++)
+	    cacheRange(flushing[idx].start, flushing[idx].size);
+    }
+
+    IOLockUnlock(flushLock);
+}
+
+void
+IOMapperIOVMAllocator::cacheRange(IORangeScalar start, IORangeScalar size)
+{
+    IOMapperIOVMCPUCache * cache;
+    IOMapperIOVMMagazine * magazine;
+    IOMapperIOVMMagazine   spill;
+    int                    sizeClass;
+
+    sizeClass = IOMapperIOVMSizeClass(size);
+    if (sizeClass < 0)
+    {
+	ranges->deallocate(start, size);
+	return;
+    }
+
+    spill.count = 0;
+    cache = &cpuCaches[cpu_number() % cpuCount];
+    IOSimpleLockLock(cache->lock);
+    magazine = &cache->loaded[sizeClass];
+    if (kIOMapperIOVMMagazineSize == magazine->count)
+    {
+	IOMapperIOVMSwap(magazine, &cache->previous[sizeClass]);
+	if (kIOMapperIOVMMagazineSize == magazine->count)
+	{
+	    spill = *magazine;
+	    magazine->count = 0;
+	}
+    }
+    magazine->ranges[magazine->count++] = start;
+    IOSimpleLockUnlock(cache->lock);
+
+    // the range allocator takes a mutex, give it the spill unlocked
+    for (UInt32 idx = 0; idx < spill.count; idx++)
+	ranges->deallocate(spill.ranges[idx], (1ULL << sizeClass));
+}
+
+void
+IOMapperIOVMAllocator::drainCaches(void)
+{
+    IOMapperIOVMCPUCache * cache;
+    IOMapperIOVMMagazine   spill;
+
+    for (UInt32 cpu = 0; cpu < cpuCount; cpu++)
+    {
+	cache = &cpuCaches[cpu];
+	for (int sizeClass = 0; sizeClass < kIOMapperIOVMSizeClasses; sizeClass++)
+	{
+	    for (int which = 0; which < 2; which++)
+	    {
+		IOSimpleLockLock(cache->lock);
+		if (which) { spill = cache->previous[sizeClass]; cache->previous[sizeClass].count = 0; }
+		else       { spill = cache->loaded[sizeClass];   cache->loaded[sizeClass].count   = 0; }
+		IOSimpleLockUnlock(cache->lock);
+
+		for (UInt32 idx = 0; idx < spill.count; idx++)
+		    ranges->deallocate(spill.ranges[idx], (1ULL << sizeClass));
+	    }
+	}
+    }
+}
+
+void
+IOMapperIOVMAllocator::getStatistics(IOMapperIOVMStatistics * stats) const
+{
+    stats->allocations   = allocations;
+    stats->cacheHits     = cacheHits;
+    stats->deallocations = deallocations;
+    stats->flushes       = flushes;
+}
@@ -3390,6 +3390,7 @@ IOReturn IOMemoryDescriptor::dmaUnmap(
 
     if (!mapLength) return (kIOReturnSuccess);
 
+    OSIncrementAtomic64(&gIODMAMapStatistics.unmaps);
     ret = mapper->iovmUnmapMemory(this, command, mapAddress, mapLength);
 
     if ((alloc = mapper->fAllocName))
@@ -69,6 +69,10 @@ OSMetaClassDefineReservedUnused(IOPolledInterface, 15);
 
 enum { kDefaultIOSize = 128*1024 };
 
+// Writes keep up to the queue depth in flight, from one more buffer than that.
+// Reads and flushes keep to one at a time.
+enum { kIOPolledMaxQueueDepth = 8 };
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 class IOPolledFilePollers : public OSObject
@@ -80,9 +84,13 @@ public:
     OSArray                  * pollers;
     IOBufferMemoryDescriptor * ioBuffer;
     bool                 abortable;
-    bool                 io;
     IOReturn		 ioStatus;
     uint32_t             openCount;
+    uint32_t             queueDepth;
+    uint32_t             ioCount;
+    uint32_t             ioHead;
+    uint32_t             ioQueue[kIOPolledMaxQueueDepth];
+    IOReturn             ioSlotStatus[kIOPolledMaxQueueDepth + 1];
 
     static IOPolledFilePollers * copyPollers(IOService * media);
 };
@@ -100,6 +108,8 @@ IOPolledFilePollers::copyPollers(IOService * media)
     OSObject        * obj;
     IORegistryEntry * next;
     IORegistryEntry * child;
+    OSNumber        * depth;
+    uint32_t          maxDepth;
 
     if ((obj = media->copyProperty(kIOPolledInterfaceStackKey)))
     {
@@ -118,6 +128,11 @@ IOPolledFilePollers::copyPollers(IOService * media)
 	    break;
 	}
 
+	if (!PE_parse_boot_argn("polledqdepth", &maxDepth, sizeof(maxDepth))
+	 || !maxDepth || (maxDepth > kIOPolledMaxQueueDepth))
+	    maxDepth = kIOPolledMaxQueueDepth;
+	vars->queueDepth = maxDepth;
+
 	next = vars->media = media;
 	do
 	{
@@ -131,8 +146,17 @@ IOPolledFilePollers::copyPollers(IOService * media)
 		break;
 	    }
 	    else if ((poller = OSDynamicCast(IOPolledInterface, obj)))
+	    {
 		vars->pollers->setObject(poller);
 
+		// the stack goes as deep as its shallowest poller
+		depth = OSDynamicCast(OSNumber, next->getProperty(kIOPolledInterfaceQueueDepthKey));
+		if (!depth || !depth->unsigned32BitValue())
+		    vars->queueDepth = 1;
+		else if (depth->unsigned32BitValue() < vars->queueDepth)
+		    vars->queueDepth = depth->unsigned32BitValue();
+	    }
+
 	    if ((service = OSDynamicCast(IOService, next)) 
 		&& service->getDeviceMemory()
 		&& !vars->pollers->getCount())	break;
@@ -158,7 +182,13 @@ IOPolledFilePollers::copyPollers(IOService * media)
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 static IOReturn 
-IOPolledFilePollersIODone(IOPolledFilePollers * vars, bool abortable);
+IOPolledFilePollersIOWait(IOPolledFilePollers * vars, bool abortable, uint32_t outstanding);
+
+static inline IOReturn
+IOPolledFilePollersIODone(IOPolledFilePollers * vars, bool abortable)
+{
+    return (IOPolledFilePollersIOWait(vars, abortable, 0));
+}
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
@@ -202,7 +232,8 @@ IOPolledFilePollersOpen(IOPolledFileIOVars * filevars, uint32_t state, bool abor
     if (kIOPolledAfterSleepState == state)
     {
         vars->ioStatus = 0;
-	vars->io = false;
+	vars->ioCount  = 0;
+	vars->ioHead   = 0;
     }
     (void) IOPolledFilePollersIODone(vars, false);
 
@@ -212,7 +243,7 @@ IOPolledFilePollersOpen(IOPolledFileIOVars * filevars, uint32_t state, bool abor
         if (!ioBuffer)
         {
 	    vars->ioBuffer = ioBuffer = IOBufferMemoryDescriptor::withOptions(kIODirectionInOut, 
-							    2 * kDefaultIOSize, page_size);
+							    (vars->queueDepth + 1) * kDefaultIOSize, page_size);
 	    if (!ioBuffer) return (kIOReturnNoMemory);
         }
     }
@@ -341,16 +372,17 @@ IOPolledIOComplete(void *   target,
 		   IOReturn status,
 		   UInt64   actualByteCount)
 {
-    IOPolledFilePollers * vars = (IOPolledFilePollers *) parameter;
+    IOPolledFilePollers * vars = (IOPolledFilePollers *) target;
+    uint32_t              slot = (uint32_t) (uintptr_t) parameter;
 
-    vars->ioStatus = status;
+    vars->ioSlotStatus[slot] = status;
 }
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 static IOReturn
 IOStartPolledIO(IOPolledFilePollers * vars, 
-                    uint32_t operation, uint32_t bufferOffset, 
+                    uint32_t operation, uint32_t slot, uint32_t bufferOffset,
 		    uint64_t deviceOffset, uint64_t length)
 {
     IOReturn            err;
@@ -360,15 +392,20 @@ IOStartPolledIO(IOPolledFilePollers * vars,
     err = vars->ioStatus;
     if (kIOReturnSuccess != err) return (err);
 
-    completion.target    = 0;
+    assert(vars->ioCount < vars->queueDepth);
+
+    completion.target    = vars;
     completion.action    = &IOPolledIOComplete;
-    completion.parameter = vars;
+    completion.parameter = (void *) (uintptr_t) slot;
 
-    vars->ioStatus = -1;
+    vars->ioSlotStatus[slot] = -1;
 
     poller = (IOPolledInterface *) vars->pollers->getObject(0);
     err = poller->startIO(operation, bufferOffset, deviceOffset, length, completion);
-    if (err) {
+    if (!err) {
+	vars->ioQueue[(vars->ioHead + vars->ioCount) % kIOPolledMaxQueueDepth] = slot;
+	vars->ioCount++;
+    } else {
 	if (kernel_debugger_entry_count) {
             HIBLOG("IOPolledInterface::startIO[%d] 0x%x\n", 0, err);
 	} else {
@@ -381,22 +418,32 @@ IOStartPolledIO(IOPolledFilePollers * vars,
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+// Polls until no more than outstanding I/Os remain in flight, retiring them oldest first.
 static IOReturn
-IOPolledFilePollersIODone(IOPolledFilePollers * vars, bool abortable)
+IOPolledFilePollersIOWait(IOPolledFilePollers * vars, bool abortable, uint32_t outstanding)
 {
     IOReturn            err = kIOReturnSuccess;
     int32_t		idx = 0;
     IOPolledInterface * poller;
     AbsoluteTime        deadline;
+    uint32_t            slot;
 
-    if (!vars->io) return (kIOReturnSuccess);
+    if (vars->ioCount <= outstanding) return (kIOReturnSuccess);
 
     abortable &= vars->abortable;
 
     clock_interval_to_deadline(2000, kMillisecondScale, &deadline);
 
-    while (-1 == vars->ioStatus)
+    while (vars->ioCount > outstanding)
     {
+	slot = vars->ioQueue[vars->ioHead];
+	if (-1 != vars->ioSlotStatus[slot])
+	{
+	    if (kIOReturnSuccess == vars->ioStatus) vars->ioStatus = vars->ioSlotStatus[slot];
+	    vars->ioHead = (vars->ioHead + 1) % kIOPolledMaxQueueDepth;
+	    vars->ioCount--;
+	    continue;
+	}
         for (idx = 0; 
 	    (poller = (IOPolledInterface *) vars->pollers->getObject(idx));
              idx++)
@@ -411,10 +458,9 @@ IOPolledFilePollersIODone(IOPolledFilePollers * vars, bool abortable)
         if ((false) && (kIOReturnSuccess == err) && (mach_absolute_time() > AbsoluteTime_to_scalar(&deadline)))
     	{
 	    HIBLOG("IOPolledInterface::forced timeout\n");
-	    vars->ioStatus = kIOReturnTimeout;
+	    vars->ioSlotStatus[slot] = kIOReturnTimeout;
     	}
     }
-    vars->io = false;
 
 #if HIBERNATION
     if ((kIOReturnSuccess == err) && abortable && hibernate_should_abort())
@@ -788,11 +834,13 @@ IOPolledFilePollersSetup(IOPolledFileIOVars * vars,
 	{
 	    vars->pollers->openCount++;
 	}
-	vars->pollers->io  = false;
 	vars->buffer       = (uint8_t *) vars->pollers->ioBuffer->getBytesNoCopy();
 	vars->bufferHalf   = 0;
 	vars->bufferOffset = 0;
-	vars->bufferSize   = (vars->pollers->ioBuffer->getLength() >> 1);
+	vars->bufferCount  = vars->pollers->queueDepth + 1;
+	vars->bufferSize   = (vars->pollers->ioBuffer->getLength() / vars->bufferCount);
+	vars->ioBytes      = 0;
+	AbsoluteTime_to_scalar(&vars->ioWaitTime) = 0;
 
         if (vars->maxiobytes < vars->bufferSize) vars->bufferSize = vars->maxiobytes;
     }
@@ -930,20 +978,27 @@ IOPolledFileWrite(IOPolledFileIOVars * vars,
             }
 #endif /* CRYPTO */
 
-	    err = IOPolledFilePollersIODone(vars->pollers, true);
+	    // make room in the queue, the buffer after this one is never in flight
+	    AbsoluteTime startTime, endTime;
+	    clock_get_uptime(&startTime);
+	    err = IOPolledFilePollersIOWait(vars->pollers, true, vars->bufferCount - 2);
+	    clock_get_uptime(&endTime);
+	    ADD_ABSOLUTETIME(&vars->ioWaitTime, &endTime);
+	    SUB_ABSOLUTETIME(&vars->ioWaitTime, &startTime);
 	    if (kIOReturnSuccess != err)
 		break;
 
 if (vars->position & (vars->blockSize - 1)) HIBLOG("misaligned file pos %qx\n", vars->position);
 //if (length != vars->bufferSize) HIBLOG("short write of %qx ends@ %qx\n", length, offset + length);
 
-	    err = IOStartPolledIO(vars->pollers, kIOPolledWrite, vars->bufferHalf, offset, length);
+	    err = IOStartPolledIO(vars->pollers, kIOPolledWrite, vars->bufferHalf / vars->bufferSize,
+				  vars->bufferHalf, offset, length);
 	    if (kIOReturnSuccess != err) {
                 HIBLOGFROMPANIC("IOPolledFileWrite(0x%p, 0x%p, %llu, 0x%p) : IOStartPolledIO(0x%p, kIOPolledWrite, %llu, 0x%llx, %d) returned 0x%x\n",
                     vars, bytes, (uint64_t) original_size, cryptvars, vars->pollers, (uint64_t) vars->bufferHalf, offset, length, err);
                 break;
 	    }
-	    vars->pollers->io = true;
+	    vars->ioBytes += length;
 
 	    vars->extentRemaining -= vars->bufferOffset;
 	    if (!vars->extentRemaining)
@@ -953,7 +1008,9 @@ if (vars->position & (vars->blockSize - 1)) HIBLOG("misaligned file pos %qx\n",
 		vars->extentPosition  = vars->position;
 	    }
 
-	    vars->bufferHalf = vars->bufferHalf ? 0 : vars->bufferSize;
+	    vars->bufferHalf += vars->bufferSize;
+	    if (vars->bufferHalf >= (vars->bufferCount * vars->bufferSize))
+		vars->bufferHalf = 0;
 	    vars->bufferOffset = 0;
 	    if (vars->bufferSize <= vars->extentRemaining)
 		vars->bufferLimit = vars->bufferSize;
@@ -986,13 +1043,12 @@ IOPolledFileFlush(IOPolledFileIOVars * vars)
     if (kIOReturnSuccess != err)
 	    return err;
 
-    err = IOStartPolledIO(vars->pollers, kIOPolledFlush, 0, 0, 0);
+    err = IOStartPolledIO(vars->pollers, kIOPolledFlush, 0, 0, 0, 0);
     if (kIOReturnSuccess != err) {
 	    HIBLOGFROMPANIC("IOPolledFileFlush(0x%p) : IOStartPolledIO(0x%p, kIOPolledFlush, 0, 0, 0) returned 0x%x\n",
                     vars, vars->pollers, err);
 	    return err;
     }
-    vars->pollers->io = true;
 
     return err;
 }
@@ -1030,7 +1086,7 @@ IOPolledFileRead(IOPolledFileIOVars * vars,
 
 	if ((vars->bufferOffset == vars->bufferLimit) && (vars->position < vars->readEnd))
 	{
-	    if (!vars->pollers->io) cryptvars = 0;
+	    if (!vars->pollers->ioCount) cryptvars = 0;
 	    err = IOPolledFilePollersIODone(vars->pollers, true);
 	    if (kIOReturnSuccess != err)
 		break;
@@ -1068,10 +1124,11 @@ if (vars->position & (vars->blockSize - 1)) HIBLOG("misaligned file pos %qx\n",
 	    if (length)
 	    {
 //if (length != vars->bufferSize) HIBLOG("short read of %qx ends@ %qx\n", length, offset + length);
-		err = IOStartPolledIO(vars->pollers, kIOPolledRead, vars->bufferHalf, offset, length);
+		err = IOStartPolledIO(vars->pollers, kIOPolledRead, vars->bufferHalf / vars->bufferSize,
+				      vars->bufferHalf, offset, length);
 		if (kIOReturnSuccess != err)
 		    break;
-		vars->pollers->io = true;
+		vars->ioBytes += length;
 	    }
 
 	    vars->bufferHalf = vars->bufferHalf ? 0 : vars->bufferSize;
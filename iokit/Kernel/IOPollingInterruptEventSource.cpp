@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#include <IOKit/IOPollingInterruptEventSource.h>
+#include <IOKit/IOService.h>
+#include <IOKit/IOKitDebug.h>
+#include <IOKit/IOTimeStamp.h>
+#include <IOKit/IOWorkLoop.h>
+#include <IOKit/IOInterruptAccountingPrivate.h>
+
+#if IOKITSTATS
+
+#define IOStatisticsCheckForWork() \
+do { \
+	IOStatistics::countInterruptCheckForWork(IOEventSource::reserved->counter); \
+} while (0)
+
+#else
+
+#define IOStatisticsCheckForWork()
+
+#endif /* IOKITSTATS */
+
+#define super IOInterruptEventSource
+
+OSDefineMetaClassAndStructors
+    (IOPollingInterruptEventSource, IOInterruptEventSource)
+OSMetaClassDefineReservedUnused(IOPollingInterruptEventSource, 0);
+OSMetaClassDefineReservedUnused(IOPollingInterruptEventSource, 1);
+OSMetaClassDefineReservedUnused(IOPollingInterruptEventSource, 2);
+OSMetaClassDefineReservedUnused(IOPollingInterruptEventSource, 3);
+
+/*
+ * Implement the call throughs for the private protection conversion
+ */
+bool IOPollingInterruptEventSource::init(OSObject *inOwner,
+                                         Action inAction,
+                                         IOService *inProvider,
+                                         int inIntIndex)
+{
+    return false;
+}
+
+IOInterruptEventSource *
+IOPollingInterruptEventSource::interruptEventSource(OSObject *inOwner,
+                                                    Action inAction,
+                                                    IOService *inProvider,
+                                                    int inIntIndex)
+{
+    return 0;
+}
+
+bool
+IOPollingInterruptEventSource::init(OSObject *inOwner,
+                                    PollAction inAction,
+                                    IOService *inProvider,
+                                    int inIntIndex,
+                                    UInt32 inBudget)
+{
+    // Without an interrupt to mask there is nothing to poll for
+    if (!inAction || !inProvider || !inBudget)
+        return false;
+
+    if ( !super::init(inOwner, (Action) inAction, inProvider, inIntIndex) )
+        return false;
+
+    pollBudget = inBudget;
+    polling = false;
+
+    return true;
+}
+
+IOPollingInterruptEventSource *IOPollingInterruptEventSource
+::pollingInterruptEventSource(OSObject *inOwner,
+                              PollAction inAction,
+                              IOService *inProvider,
+                              int inIntIndex,
+                              UInt32 inBudget)
+{
+    IOPollingInterruptEventSource *me = new IOPollingInterruptEventSource;
+
+    if (me
+    && !me->init(inOwner, inAction, inProvider, inIntIndex, inBudget)) {
+        me->release();
+        return 0;
+    }
+
+    return me;
+}
+
+void IOPollingInterruptEventSource::setPollBudget(UInt32 inBudget)
+{
+    if (inBudget)
+        pollBudget = inBudget;
+}
+
+UInt32 IOPollingInterruptEventSource::getPollBudget() const
+{
+    return pollBudget;
+}
+
+bool IOPollingInterruptEventSource::isPolling() const
+{
+    return polling;
+}
+
+void IOPollingInterruptEventSource::normalInterruptOccurred
+    (void *refcon, IOService *prov, int source)
+{
+    // Polling needs the interrupt masked until the device runs dry
+    if (prov)
+        super::disableInterruptOccurred(refcon, prov, source);
+    else
+        super::normalInterruptOccurred(refcon, prov, source);
+}
+
+bool IOPollingInterruptEventSource::checkForWork()
+{
+    uint64_t startSystemTime = 0;
+    uint64_t endSystemTime = 0;
+    uint64_t startCPUTime = 0;
+    uint64_t endCPUTime = 0;
+    unsigned int cacheProdCount = producerCount;
+    bool interrupted = (cacheProdCount != consumerCount);
+    UInt32 budget = pollBudget;
+    UInt32 done;
+    PollAction pollAction = (PollAction) action;
+    IOInterruptAccountingData *statistics = IOInterruptEventSource::reserved->statistics;
+	bool trace = (gIOKitTrace & kIOTraceIntEventSource) ? true : false;
+
+    IOStatisticsCheckForWork();
+
+    if (!interrupted && !polling)
+	return false;
+
+    /*
+     * The interrupt was disabled by the client while we were polling:
+     * stop and leave it disabled, as the regular event source does.
+     */
+    if (!enabled) {
+	consumerCount = cacheProdCount;
+	polling = false;
+	return false;
+    }
+
+	if (trace)
+		IOTimeStampStartConstant(IODBG_INTES(IOINTES_ACTION),
+					 VM_KERNEL_ADDRHIDE(pollAction), VM_KERNEL_ADDRHIDE(owner),
+					 VM_KERNEL_ADDRHIDE(this), VM_KERNEL_ADDRHIDE(workLoop));
+
+    if (statistics) {
+	if (IA_GET_STATISTIC_ENABLED(kInterruptAccountingSecondLevelSystemTimeIndex)) {
+	    startSystemTime = mach_absolute_time();
+	}
+
+	if (IA_GET_STATISTIC_ENABLED(kInterruptAccountingSecondLevelCPUTimeIndex)) {
+	    startCPUTime = thread_get_runtime_self();
+	}
+    }
+
+    done = (*pollAction)(owner, this, budget);
+
+    if (statistics) {
+	/*
+	 * A pass started by an interrupt counts as a second level invocation;
+	 * the passes that follow without one are what polling bought us.
+	 */
+	if (interrupted) {
+	    if (IA_GET_STATISTIC_ENABLED(kInterruptAccountingSecondLevelCountIndex)) {
+		IA_ADD_VALUE(&statistics->interruptStatistics[kInterruptAccountingSecondLevelCountIndex], 1);
+	    }
+	} else {
+	    if (IA_GET_STATISTIC_ENABLED(kInterruptAccountingPollCountIndex)) {
+		IA_ADD_VALUE(&statistics->interruptStatistics[kInterruptAccountingPollCountIndex], 1);
+	    }
+
+	    if (IA_GET_STATISTIC_ENABLED(kInterruptAccountingPolledCompletionsIndex)) {
+		IA_ADD_VALUE(&statistics->interruptStatistics[kInterruptAccountingPolledCompletionsIndex], done);
+	    }
+	}
+
+	if (IA_GET_STATISTIC_ENABLED(kInterruptAccountingSecondLevelCPUTimeIndex)) {
+	    endCPUTime = thread_get_runtime_self();
+	    IA_ADD_VALUE(&statistics->interruptStatistics[kInterruptAccountingSecondLevelCPUTimeIndex], endCPUTime - startCPUTime);
+	}
+
+	if (IA_GET_STATISTIC_ENABLED(kInterruptAccountingSecondLevelSystemTimeIndex)) {
+	    endSystemTime = mach_absolute_time();
+	    IA_ADD_VALUE(&statistics->interruptStatistics[kInterruptAccountingSecondLevelSystemTimeIndex], endSystemTime - startSystemTime);
+	}
+    }
+
+	if (trace)
+		IOTimeStampEndConstant(IODBG_INTES(IOINTES_ACTION),
+				       VM_KERNEL_ADDRHIDE(pollAction), VM_KERNEL_ADDRHIDE(owner),
+				       VM_KERNEL_ADDRHIDE(this), VM_KERNEL_ADDRHIDE(workLoop));
+
+    consumerCount = cacheProdCount;
+
+    /*
+     * The budget was used up, there is likely more: keep the interrupt
+     * masked and have the work loop come back to us after giving its
+     * other event sources a turn.
+     */
+    if (done >= budget) {
+	polling = true;
+	return true;
+    }
+
+    polling = false;
+    if (!explicitDisable)
+	enable();
+
+    return false;
+}
@@ -2020,8 +2020,8 @@ bool IORegistryIterator::isValid( void )
     ok = (0 == (kIORegistryIteratorInvalidFlag & options));
 
     while( ok && next) {
-	if( where->iter)
-            ok = where->iter->isValid();
+	if( where->live)
+            ok = where->live->isValid();
 	next = next->next;
     }
     UNLOCK;
@@ -2039,6 +2039,7 @@ void IORegistryIterator::enterEntry( const IORegistryPlane * enterPlane )
 
     if( where) {
         where->iter = 0;
+        where->live = 0;
         where->next = prev;
         where->current = prev->current;
         plane = enterPlane;
@@ -2060,6 +2061,10 @@ bool IORegistryIterator::exitEntry( void )
         if( where->current)// && (where != &start))
             where->current->release();
     }
+    if( where->live) {
+	where->live->release();
+	where->live = 0;
+    }
 
     if( where != &start) {
 	gone = where;
@@ -2100,18 +2105,26 @@ IORegistryEntry * IORegistryIterator::getNextObjectFlat( void )
 {
     IORegistryEntry * 	next = 0;
     OSArray *		links = 0;
-
-    RLOCK;
+    OSArray *		copy;
 
     if( (0 == where->iter)) {
-	// just entered - create new iter
+	// just entered - create new iter over a copy of the links, so that
+	// the rest of this level can be walked without the registry lock;
+	// the live set is only kept to tell whether the copy went stale
+	RLOCK;
 	if( isValid()
         &&  where->current
         &&  (links = ( (options & kIORegistryIterateParents) ?
                         where->current->getParentSetReference( plane ) :
-                        where->current->getChildSetReference( plane ) )) )
+                        where->current->getChildSetReference( plane ) ))
+	&&  (copy = OSArray::withArray( links ))) {
 
-            where->iter = OSCollectionIterator::withCollection( links );
+            where->iter = OSCollectionIterator::withCollection( copy );
+	    copy->release();
+	    if( where->iter)
+		where->live = OSCollectionIterator::withCollection( links );
+	}
+	UNLOCK;
 
     } else
 	// next sibling - release current
@@ -2124,14 +2137,16 @@ IORegistryEntry * IORegistryIterator::getNextObjectFlat( void )
 
         if( next)
             next->retain();
-        else if( !where->iter->isValid())
-            options |= kIORegistryIteratorInvalidFlag;
+        else {
+	    RLOCK;
+	    if( !where->live || !where->live->isValid())
+		options |= kIORegistryIteratorInvalidFlag;
+	    UNLOCK;
+	}
     }
 
     where->current = next;
 
-    UNLOCK;
-
     return( next);
 }
 
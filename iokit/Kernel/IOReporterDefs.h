@@ -110,5 +110,10 @@ do {                                                                    \
     }                                                                   \
 } while(0)                                                              \
 
+// per-CPU rows are padded to a cache line so CPUs don't share one
+#define IOREPORTER_PERCPU_ALIGN         64
+#define IOREPORTER_PERCPU_ROW_SIZE(__size)                              \
+    (((size_t)(__size) + IOREPORTER_PERCPU_ALIGN - 1) & ~((size_t)IOREPORTER_PERCPU_ALIGN - 1))
+
 #endif /* ! _IOEPORTERDEFS_H */
 
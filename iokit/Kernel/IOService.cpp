@@ -189,6 +189,7 @@ static int			gNumConfigThreads;
 static int			gNumWaitingThreads;
 static IOLock *			gIOServiceBusyLock;
 bool				gCPUsRunning;
+static bool			gIOParallelStart;
 
 static thread_t			gIOTerminateThread;
 static thread_t			gIOTerminateWorkerThread;
@@ -198,6 +199,32 @@ static OSArray *		gIOStopList;
 static OSArray *		gIOStopProviderList;
 static OSArray *		gIOFinalizeList;
 
+// Probe and start times, by driver class and as a timeline of starts
+struct IOServiceStartStats {
+    uint64_t	probeCount;
+    uint64_t	probeTime;
+    uint64_t	startCount;
+    uint64_t	startTime;
+    uint64_t	startFailures;
+};
+
+struct IOServiceStartRecord {
+    const OSSymbol *	className;
+    uint64_t		serviceID;
+    uint64_t		providerID;
+    uint64_t		parentID;
+    uint64_t		begin;
+    uint64_t		end;
+    bool		critical;
+};
+
+enum { kIOServiceStartTimelineCount = 1024 };
+
+static IOLock *			gIOStartStatsLock;
+static OSDictionary *		gIOStartStats;
+static IOServiceStartRecord	gIOStartTimeline[kIOServiceStartTimelineCount];
+static uint32_t			gIOStartTimelineCount;
+
 static SInt32			gIOConsoleUsersSeed;
 static OSData *			gIOConsoleUsersSeedValue;
 
@@ -419,6 +446,13 @@ void IOService::initialize( void )
     gJobsLock	= IOLockAlloc();
     gJobs 	= OSOrderedSet::withCapacity( 10 );
 
+    gIOStartStatsLock = IOLockAlloc();
+    gIOStartStats     = OSDictionary::withCapacity( 64 );
+
+    int parallelStart = 0;
+    if( PE_parse_boot_argn( "ioparallelstart", &parallelStart, sizeof(parallelStart) ))
+        gIOParallelStart = (0 != parallelStart);
+
     gIOServiceBusyLock = IOLockAlloc();
 
     gIOConsoleUsersLock = IOLockAlloc();
@@ -430,7 +464,8 @@ void IOService::initialize( void )
     IORegistryEntry::getRegistryRoot()->setProperty(gIOConsoleLockedKey, kOSBooleanTrue);
 
     assert( gIOServiceBusyLock && gJobs && gJobsLock && gIOConsoleUsersLock
-    		&& gIOConsoleLockCallout && (err == KERN_SUCCESS) );
+    		&& gIOConsoleLockCallout && (err == KERN_SUCCESS)
+		&& gIOStartStatsLock && gIOStartStats );
 
     gIOResources = IOResources::resources();
     assert( gIOResources );
@@ -955,7 +990,8 @@ IOReturn IOService::catalogNewDrivers( OSOrderedSet * newTables )
 }
 
  _IOServiceJob * _IOServiceJob::startJob( IOService * nub, int type,
-						IOOptionBits options )
+						IOOptionBits options,
+						OSOrderedSet * startList )
 {
     _IOServiceJob *	job;
 
@@ -969,7 +1005,10 @@ IOReturn IOService::catalogNewDrivers( OSOrderedSet * newTables )
         job->type	= type;
         job->nub	= nub;
 	job->options	= options;
+	job->startList	= startList;
         nub->retain();			// thread will release()
+	if( startList)
+	    startList->retain();	// thread will release()
         pingConfig( job );
     }
 
@@ -3231,6 +3270,182 @@ bool IOService::invokeNotifiers(OSArray ** willSend)
 }
 
 
+/*
+ * Probe and start time accounting
+ */
+
+static IOServiceStartStats *
+IOServiceGetStartStats( IOService * inst )
+{
+    const char *	className = inst->getMetaClass()->getClassName();
+    OSData *		data;
+    IOServiceStartStats	zero;
+
+    data = (OSData *) gIOStartStats->getObject( className );
+    if( !data) {
+	bzero( &zero, sizeof(zero) );
+	data = OSData::withBytes( &zero, sizeof(zero) );
+	if( !data)
+	    return( 0 );
+	gIOStartStats->setObject( className, data );
+	data->release();
+    }
+
+    return( (IOServiceStartStats *) data->getBytesNoCopy() );
+}
+
+static void
+IOServiceRecordProbe( IOService * inst, uint64_t elapsed )
+{
+    IOServiceStartStats * stats;
+
+    IOLockLock( gIOStartStatsLock );
+    if( (stats = IOServiceGetStartStats( inst ))) {
+	stats->probeCount++;
+	stats->probeTime += elapsed;
+    }
+    IOLockUnlock( gIOStartStatsLock );
+}
+
+static void
+IOServiceRecordStart( IOService * nub, IOService * service,
+		      uint64_t begin, uint64_t end, bool ok )
+{
+    IOServiceStartStats *	stats;
+    IOServiceStartRecord *	record;
+    IORegistryEntry *		parent;
+    uint64_t			parentID;
+
+    // getProvider() may take the registry lock, never under ours
+    parent = nub->getProvider();
+    parentID = parent ? parent->getRegistryEntryID() : 0;
+
+    IOLockLock( gIOStartStatsLock );
+    if( (stats = IOServiceGetStartStats( service ))) {
+	stats->startCount++;
+	stats->startTime += end - begin;
+	if( !ok)
+	    stats->startFailures++;
+    }
+
+    // the timeline only keeps the first starts, i.e. those of boot
+    if( ok && (gIOStartTimelineCount < kIOServiceStartTimelineCount)) {
+	record = &gIOStartTimeline[gIOStartTimelineCount++];
+	record->className  = OSSymbol::withCString( service->getMetaClass()->getClassName() );
+	record->serviceID  = service->getRegistryEntryID();
+	record->providerID = nub->getRegistryEntryID();
+	record->parentID   = parentID;
+	record->begin      = begin;
+	record->end        = end;
+    }
+    IOLockUnlock( gIOStartStatsLock );
+}
+
+static void
+IOServiceSetNumber( OSDictionary * dict, const char * key, uint64_t value )
+{
+    OSNumber * num;
+
+    if( (num = OSNumber::withNumber( value, 64 ))) {
+	dict->setObject( key, num );
+	num->release();
+    }
+}
+
+static uint64_t
+IOServiceAbsToNS( uint64_t abstime )
+{
+    uint64_t nano;
+
+    absolutetime_to_nanoseconds( abstime, &nano );
+    return( nano );
+}
+
+OSDictionary * IOServiceCopyStartStatistics( void )
+{
+    OSDictionary *		result;
+    OSDictionary *		entry;
+    OSCollectionIterator *	iter;
+    const OSSymbol *		className;
+    IOServiceStartStats *	stats;
+
+    IOLockLock( gIOStartStatsLock );
+
+    result = OSDictionary::withCapacity( gIOStartStats->getCount() );
+    iter = OSCollectionIterator::withCollection( gIOStartStats );
+    if( result && iter) {
+	while( (className = (const OSSymbol *) iter->getNextObject())) {
+	    stats = (IOServiceStartStats *)
+		    ((OSData *) gIOStartStats->getObject( className ))->getBytesNoCopy();
+	    if( !(entry = OSDictionary::withCapacity( 5 )))
+		break;
+	    IOServiceSetNumber( entry, "ProbeCount", stats->probeCount );
+	    IOServiceSetNumber( entry, "ProbeTime", IOServiceAbsToNS( stats->probeTime ));
+	    IOServiceSetNumber( entry, "StartCount", stats->startCount );
+	    IOServiceSetNumber( entry, "StartTime", IOServiceAbsToNS( stats->startTime ));
+	    IOServiceSetNumber( entry, "StartFailures", stats->startFailures );
+	    result->setObject( className, entry );
+	    entry->release();
+	}
+    }
+    if( iter)
+	iter->release();
+
+    IOLockUnlock( gIOStartStatsLock );
+
+    return( result );
+}
+
+OSArray * IOServiceCopyStartTimeline( void )
+{
+    OSArray *			result;
+    OSDictionary *		entry;
+    IOServiceStartRecord *	record;
+    uint32_t			count, idx, last, parent;
+
+    IOLockLock( gIOStartStatsLock );
+
+    count = gIOStartTimelineCount;
+
+    // walk back from the last start to end, through the drivers that
+    // published the nub each was started on: that chain bounds boot time
+    for( last = 0, idx = 0; idx < count; idx++) {
+	gIOStartTimeline[idx].critical = false;
+	if( gIOStartTimeline[idx].end > gIOStartTimeline[last].end)
+	    last = idx;
+    }
+    while( count && !gIOStartTimeline[last].critical) {
+	gIOStartTimeline[last].critical = true;
+	for( parent = 0; parent < count; parent++) {
+	    if( gIOStartTimeline[parent].serviceID == gIOStartTimeline[last].parentID)
+		break;
+	}
+	if( parent == count)
+	    break;
+	last = parent;
+    }
+
+    result = OSArray::withCapacity( count );
+    for( idx = 0; result && (idx < count); idx++) {
+	record = &gIOStartTimeline[idx];
+	if( !(entry = OSDictionary::withCapacity( 6 )))
+	    break;
+	if( record->className)
+	    entry->setObject( gIOClassKey, record->className );
+	IOServiceSetNumber( entry, "IORegistryEntryID", record->serviceID );
+	IOServiceSetNumber( entry, "ProviderID", record->providerID );
+	IOServiceSetNumber( entry, "Start", IOServiceAbsToNS( record->begin ));
+	IOServiceSetNumber( entry, "End", IOServiceAbsToNS( record->end ));
+	entry->setObject( "CriticalPath", record->critical ? kOSBooleanTrue : kOSBooleanFalse );
+	result->setObject( entry );
+	entry->release();
+    }
+
+    IOLockUnlock( gIOStartStatsLock );
+
+    return( result );
+}
+
 /*
  * Alloc and probe matching classes,
  * called on the provider instance
@@ -3252,7 +3467,6 @@ void IOService::probeCandidates( OSOrderedSet * matches )
     OSIterator		*	iter;
     _IOServiceNotifier 	*		notify;
     OSObject 		*	nextMatch = 0;
-    bool			started;
     bool			needReloc = false;
 #if IOMATCHDEBUG
     SInt64			debugFlags;
@@ -3312,8 +3526,10 @@ void IOService::probeCandidates( OSOrderedSet * matches )
 	    props->setCapacityIncrement(1);		
 
 	    // check the nub matches
+	    OSIncrementAtomic64( &gIOMatchingStatistics.evaluated );
 	    if( false == matchPassive(props, kIOServiceChangesOK | kIOServiceClassDone))
 		continue;
+	    OSIncrementAtomic64( &gIOMatchingStatistics.matched );
 
             // Check to see if driver reloc has been loaded.
             needReloc = (false == gIOCatalogue->isModuleLoaded( match ));
@@ -3407,7 +3623,9 @@ void IOService::probeCandidates( OSOrderedSet * matches )
                         inst->getMetaClass()->getClassName(), getName());
 #endif
     
+                uint64_t probeTime = mach_absolute_time();
                 newInst = inst->probe( this, &score );
+                IOServiceRecordProbe( inst, mach_absolute_time() - probeTime );
                 inst->detach( this );
                 if( 0 == newInst) {
 #if IOMATCHDEBUG
@@ -3456,6 +3674,10 @@ void IOService::probeCandidates( OSOrderedSet * matches )
 
     iter = OSCollectionIterator::withCollection( startDict );
     if( iter) {
+	bool parallel = (gIOParallelStart
+			&& (startDict->getCount() > 1)
+			&& (0 == (__state[1] & kIOServiceSynchronousState)));
+
 	while( (category = (const OSSymbol *) iter->getNextObject())) {
 
 	    startList = (OSOrderedSet *) startDict->getObject( category );
@@ -3463,32 +3685,16 @@ void IOService::probeCandidates( OSOrderedSet * matches )
 	    if( !startList)
 		continue;
 
-            started = false;
-            while( true // (!started)
-		   && (inst = (IOService *)startList->getFirstObject())) {
-
-		inst->retain();
-		startList->removeObject(inst);
-
-#if IOMATCHDEBUG
-                debugFlags = getDebugFlags( inst );
+	    // match categories don't depend on each other, each can be started
+	    // on a config thread of its own; we stay busy until they are done
+	    if( parallel) {
+		adjustBusy( 1 );
+		if( _IOServiceJob::startJob( this, kStartCategoryJob, 0, startList ))
+		    continue;
+		adjustBusy( -1 );
+	    }
 
-                if( debugFlags & kIOLogStart) {
-                    if( started)
-                        LOG( "match category exists, skipping " );
-                    LOG( "%s::start(%s) <%d>\n", inst->getName(),
-                         getName(), inst->getRetainCount());
-                }
-#endif
-                if( false == started)
-                    started = startCandidate( inst );
-#if IOMATCHDEBUG
-                if( (debugFlags & kIOLogStart) && (false == started))
-                    LOG( "%s::start(%s) <%d> failed\n", inst->getName(), getName(),
-                         inst->getRetainCount());
-#endif
-		inst->release();
-            }
+	    startCandidates( startList );
         }
 	iter->release();
     }
@@ -3534,6 +3740,46 @@ void IOService::probeCandidates( OSOrderedSet * matches )
 	startDict->release();
 }
 
+/*
+ * Start the best (until success) of the probed instances
+ * of a match category
+ */
+
+void IOService::startCandidates( OSOrderedSet * startList )
+{
+    IOService *	inst;
+    bool	started = false;
+#if IOMATCHDEBUG
+    SInt64	debugFlags;
+#endif
+
+    while( true // (!started)
+	   && (inst = (IOService *)startList->getFirstObject())) {
+
+	inst->retain();
+	startList->removeObject(inst);
+
+#if IOMATCHDEBUG
+	debugFlags = getDebugFlags( inst );
+
+	if( debugFlags & kIOLogStart) {
+	    if( started)
+		LOG( "match category exists, skipping " );
+	    LOG( "%s::start(%s) <%d>\n", inst->getName(),
+		 getName(), inst->getRetainCount());
+	}
+#endif
+	if( false == started)
+	    started = startCandidate( inst );
+#if IOMATCHDEBUG
+	if( (debugFlags & kIOLogStart) && (false == started))
+	    LOG( "%s::start(%s) <%d> failed\n", inst->getName(), getName(),
+		 inst->getRetainCount());
+#endif
+	inst->release();
+    }
+}
+
 /*
  * Start a previously attached & probed instance,
  * called on exporting object instance
@@ -3559,15 +3805,15 @@ bool IOService::startCandidate( IOService * service )
 	AbsoluteTime endTime;
 	UInt64       nano;
 
-	if (kIOLogStart & gIOKitDebug)
-	    clock_get_uptime(&startTime);
+	clock_get_uptime(&startTime);
 
         ok = service->start(this);
 
+	clock_get_uptime(&endTime);
+	IOServiceRecordStart( this, service, startTime, endTime, ok );
+
 	if (kIOLogStart & gIOKitDebug)
 	{
-	    clock_get_uptime(&endTime);
-    
 	    if (CMP_ABSOLUTETIME(&endTime, &startTime) > 0)
 	    {
 		SUB_ABSOLUTETIME(&endTime, &startTime);
@@ -4166,6 +4412,12 @@ void _IOConfigThread::main(void * arg, wait_result_t result)
 		nub->doServiceMatch( job->options );
 		break;
 
+	    case kStartCategoryJob:
+		nub->startCandidates( job->startList );
+		job->startList->release();
+		nub->adjustBusy( -1 );
+		break;
+
             default:
                 LOG("config(%p): strange type (%d)\n",
 			IOSERVICE_OBFUSCATE(IOThreadSelf()), job->type );
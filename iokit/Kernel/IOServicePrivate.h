@@ -163,6 +163,7 @@ enum {
 
 enum {
     kMatchNubJob	= 10,
+    kStartCategoryJob	= 11,
 };
 
 class _IOServiceJob : public OSObject
@@ -175,9 +176,11 @@ public:
     int			type;
     IOService *		nub;
     IOOptionBits	options;
+    OSOrderedSet *	startList;
 
     static _IOServiceJob * startJob( IOService * nub, int type,
-                          IOOptionBits options = 0 );
+                          IOOptionBits options = 0,
+                          OSOrderedSet * startList = 0 );
     static void pingConfig( class _IOServiceJob * job );
 
 };
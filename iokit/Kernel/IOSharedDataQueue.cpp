@@ -31,6 +31,10 @@
 #include <IOKit/IOLib.h>
 #include <IOKit/IOMemoryDescriptor.h>
 
+__BEGIN_DECLS
+#include <kern/thread_call.h>
+__END_DECLS
+
 #ifdef enqueue
 #undef enqueue
 #endif
@@ -84,6 +88,7 @@ Boolean IOSharedDataQueue::initWithCapacity(UInt32 size)
     if (!_reserved) {
         return false;
     }
+    bzero(_reserved, sizeof(struct ExpansionData));
 
     if (size > UINT32_MAX - DATA_QUEUE_MEMORY_HEADER_SIZE - DATA_QUEUE_MEMORY_APPENDIX_SIZE) {
         return false;
@@ -136,6 +141,10 @@ void IOSharedDataQueue::free()
     }
 
     if (_reserved) {
+        if (_reserved->notifyCall) {
+            thread_call_cancel_wait(_reserved->notifyCall);
+            thread_call_free(_reserved->notifyCall);
+        }
         IOFree (_reserved, sizeof(struct ExpansionData));
         _reserved = NULL;
     } 
@@ -302,13 +311,198 @@ Boolean IOSharedDataQueue::enqueue(void * data, UInt32 dataSize)
 		head = __c11_atomic_load((_Atomic UInt32 *)&dataQueue->head, __ATOMIC_RELAXED);
 	}
 
-	if (tail == head) {
-		// Send notification (via mach message) that data is now available.
-		sendDataAvailableNotification();
-	}
+	// Send notification (via mach message) that data is now available.
+	dataAvailable(tail == head, 1);
 	return true;
 }
 
+//
+// Walks the layout enqueue() would give count entries starting at tail,
+// writing them out if write is set.  Returns false if they don't all fit
+// without the tail catching up to the head.
+//
+static Boolean
+IOSharedDataQueueLayout(IODataQueueMemory * dataQueue, UInt32 queueSize,
+                        UInt32 head, UInt32 * tail, Boolean write,
+                        void * const data[], const UInt32 dataSize[], UInt32 count)
+{
+    UInt32             cur = *tail;
+    UInt32             entrySize;
+    IODataQueueEntry * entry;
+
+    for (UInt32 i = 0; i < count; i++) {
+        if (dataSize[i] > UINT32_MAX - DATA_QUEUE_ENTRY_HEADER_SIZE) {
+            return false;
+        }
+        entrySize = dataSize[i] + DATA_QUEUE_ENTRY_HEADER_SIZE;
+
+        if (cur >= head) {
+            if ((entrySize <= UINT32_MAX - cur) && ((cur + entrySize) <= queueSize)) {
+                entry = (IODataQueueEntry *)((UInt8 *)dataQueue->queue + cur);
+                cur += entrySize;
+            } else if (head > entrySize) {
+                // Wrap around, leaving the size where the dequeuer looks for it
+                if (write && (queueSize - cur) >= DATA_QUEUE_ENTRY_HEADER_SIZE) {
+                    ((IODataQueueEntry *)((UInt8 *)dataQueue->queue + cur))->size = dataSize[i];
+                }
+                entry = dataQueue->queue;
+                cur = entrySize;
+            } else {
+                return false;    // queue is full
+            }
+        } else if ((head - cur) > entrySize) {
+            entry = (IODataQueueEntry *)((UInt8 *)dataQueue->queue + cur);
+            cur += entrySize;
+        } else {
+            return false;    // queue is full
+        }
+
+        if (write) {
+            entry->size = dataSize[i];
+            memcpy(&entry->data, data[i], dataSize[i]);
+        }
+    }
+
+    *tail = cur;
+    return true;
+}
+
+Boolean IOSharedDataQueue::enqueueConcurrent(void * const data[], const UInt32 dataSize[], UInt32 count)
+{
+    UInt32      head;
+    UInt32      tail;
+    UInt32      newTail;
+    UInt32      queueSize = getQueueSize();
+    boolean_t   istate;
+
+    if (!dataQueue || !count || !data || !dataSize) {
+        return false;
+    }
+
+    //
+    // A producer holding a reservation it hasn't published yet stalls the
+    // ones after it, so it must not be interrupted by one of them on its
+    // own CPU.  The tails used here are kept out of the shared memory so
+    // that user space can't make us spin.
+    //
+    istate = ml_set_interrupts_enabled(FALSE);
+
+    do {
+        tail = __c11_atomic_load((_Atomic UInt32 *)&_reserved->reserveTail, __ATOMIC_RELAXED);
+        head = __c11_atomic_load((_Atomic UInt32 *)&dataQueue->head, __ATOMIC_ACQUIRE);
+
+        newTail = tail;
+        if (queueSize < tail || queueSize < head ||
+            !IOSharedDataQueueLayout(dataQueue, queueSize, head, &newTail, false, data, dataSize, count)) {
+            ml_set_interrupts_enabled(istate);
+            return false;
+        }
+    } while (!__c11_atomic_compare_exchange_weak((_Atomic UInt32 *)&_reserved->reserveTail,
+                 &tail, newTail, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    // The head can only have moved forward, the space we reserved is ours
+    newTail = tail;
+    IOSharedDataQueueLayout(dataQueue, queueSize, head, &newTail, true, data, dataSize, count);
+
+    // Wait for the producers ahead of us, then publish in order
+    while (__c11_atomic_load((_Atomic UInt32 *)&_reserved->publishTail, __ATOMIC_ACQUIRE) != tail) {
+        continue;
+    }
+    __c11_atomic_store((_Atomic UInt32 *)&dataQueue->tail, newTail, __ATOMIC_RELEASE);
+    __c11_atomic_store((_Atomic UInt32 *)&_reserved->publishTail, newTail, __ATOMIC_RELEASE);
+
+    // Pairs with the barrier in ::dequeue, see ::enqueue
+    __c11_atomic_thread_fence(__ATOMIC_SEQ_CST);
+    head = __c11_atomic_load((_Atomic UInt32 *)&dataQueue->head, __ATOMIC_RELAXED);
+
+    ml_set_interrupts_enabled(istate);
+
+    dataAvailable(tail == head, count);
+    return true;
+}
+
+IOReturn IOSharedDataQueue::setNotificationCoalescing(UInt32 entries, UInt32 timeoutUS)
+{
+    if (!_reserved) {
+        return kIOReturnNoMemory;
+    }
+
+    if (entries <= 1) {
+        _reserved->notifyThreshold = 0;
+        return kIOReturnSuccess;
+    }
+
+    if (!timeoutUS) {
+        return kIOReturnBadArgument;
+    }
+
+    if (!_reserved->notifyCall) {
+        _reserved->notifyCall = thread_call_allocate(&IOSharedDataQueue::notifyTimeout, this);
+        if (!_reserved->notifyCall) {
+            return kIOReturnNoMemory;
+        }
+    }
+
+    nanoseconds_to_absolutetime(timeoutUS * 1000ULL, &_reserved->notifyInterval);
+    _reserved->notifyThreshold = entries;
+
+    return kIOReturnSuccess;
+}
+
+void IOSharedDataQueue::dataAvailable(Boolean wasEmpty, UInt32 count)
+{
+    UInt32 threshold = _reserved->notifyThreshold;
+    UInt32 pending;
+
+    if (!threshold) {
+        if (wasEmpty) {
+            sendDataAvailableNotification();
+        }
+        return;
+    }
+
+    //
+    // The user process only waits once it found the queue empty, so only
+    // entries queued since then need counting; whoever takes the count
+    // back to zero, a producer crossing the threshold or the timeout,
+    // sends the notification.
+    //
+    if (wasEmpty) {
+        __c11_atomic_store((_Atomic UInt32 *)&_reserved->notifyPending, count, __ATOMIC_RELAXED);
+        pending = count;
+        if (pending < threshold) {
+            thread_call_enter_delayed(_reserved->notifyCall, mach_absolute_time() + _reserved->notifyInterval);
+            return;
+        }
+    } else {
+        // Nothing to count once the notification for this batch went out
+        pending = __c11_atomic_load((_Atomic UInt32 *)&_reserved->notifyPending, __ATOMIC_RELAXED);
+        do {
+            if (!pending) {
+                return;
+            }
+        } while (!__c11_atomic_compare_exchange_weak((_Atomic UInt32 *)&_reserved->notifyPending,
+                     &pending, pending + count, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        if (pending >= threshold || pending + count < threshold) {
+            return;
+        }
+    }
+
+    if (__c11_atomic_exchange((_Atomic UInt32 *)&_reserved->notifyPending, 0, __ATOMIC_RELAXED)) {
+        thread_call_cancel(_reserved->notifyCall);
+        sendDataAvailableNotification();
+    }
+}
+
+void IOSharedDataQueue::notifyTimeout(void *param0, void */*param1*/)
+{
+    IOSharedDataQueue * me = (IOSharedDataQueue *) param0;
+
+    if (__c11_atomic_exchange((_Atomic UInt32 *)&me->_reserved->notifyPending, 0, __ATOMIC_RELAXED)) {
+        me->sendDataAvailableNotification();
+    }
+}
+
 Boolean IOSharedDataQueue::dequeue(void *data, UInt32 *dataSize)
 {
     Boolean             retVal          = TRUE;
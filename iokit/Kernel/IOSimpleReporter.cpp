@@ -26,8 +26,14 @@
  * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
  */
 
+extern "C" {
+#include <machine/machine_routines.h>
+#include <kern/cpu_number.h>
+}
+
 #include <IOKit/IOKernelReportStructs.h>
 #include <IOKit/IOKernelReporters.h>
+#include <libkern/OSAtomic.h>
 #include "IOReporterDefs.h"
 
 #define super IOReporter
@@ -62,6 +68,23 @@ finish:
     return rval;
 }
 
+/* static */
+IOSimpleReporter*
+IOSimpleReporter::withPerCPU(IOService *reportingService,
+                             IOReportCategories categories,
+                             IOReportUnit unit,
+                             int maxPerCPUChannels)
+{
+    IOSimpleReporter *reporter;
+
+    reporter = IOSimpleReporter::with(reportingService, categories, unit);
+    if (reporter && !reporter->initPerCPU(maxPerCPUChannels)) {
+        OSSafeReleaseNULL(reporter);
+    }
+
+    return reporter;
+}
+
 bool
 IOSimpleReporter::initWith(IOService *reportingService,
                            IOReportCategories categories,
@@ -79,6 +102,133 @@ IOSimpleReporter::initWith(IOService *reportingService,
 }
 
 
+bool
+IOSimpleReporter::initPerCPU(int maxPerCPUChannels)
+{
+    bool result = false;
+    IOReturn res;        // for PREFL_MEMOP
+    size_t valuesSize;
+
+    PREFL_MEMOP_FAIL(maxPerCPUChannels, uint64_t);
+
+    // ::free() sizes the buffers with these
+    _perCPUChannels = maxPerCPUChannels;
+    _perCPUCount = ml_get_max_cpus();
+    _perCPURowSize = IOREPORTER_PERCPU_ROW_SIZE((size_t)maxPerCPUChannels * sizeof(int64_t));
+
+    _perCPUChannelIDs = (uint64_t *)IOMalloc((size_t)_perCPUChannels * sizeof(uint64_t));
+    if (!_perCPUChannelIDs)     goto finish;
+
+    _perCPUMerged = (int64_t *)IOMalloc((size_t)_perCPUChannels * sizeof(int64_t));
+    if (!_perCPUMerged)         goto finish;
+    memset(_perCPUMerged, 0, (size_t)_perCPUChannels * sizeof(int64_t));
+
+    valuesSize = _perCPUCount * _perCPURowSize;
+    _perCPUValues = (int64_t *)IOMallocAligned(valuesSize, IOREPORTER_PERCPU_ALIGN);
+    if (!_perCPUValues)         goto finish;
+    memset(_perCPUValues, 0, valuesSize);
+
+    // success
+    result = true;
+
+finish:
+    return result;
+}
+
+
+void
+IOSimpleReporter::free(void)
+{
+    if (_perCPUValues) {
+        IOFreeAligned(_perCPUValues, _perCPUCount * _perCPURowSize);
+    }
+    if (_perCPUMerged) {
+        IOFree(_perCPUMerged, (size_t)_perCPUChannels * sizeof(int64_t));
+    }
+    if (_perCPUChannelIDs) {
+        IOFree(_perCPUChannelIDs, (size_t)_perCPUChannels * sizeof(uint64_t));
+    }
+
+    super::free();
+}
+
+
+IOReturn
+IOSimpleReporter::handleAddChannelSwap(uint64_t channel_id,
+                                       const OSSymbol *symChannelName)
+{
+    IOReturn res;
+    int index;
+
+    res = super::handleAddChannelSwap(channel_id, symChannelName);
+    if (res != kIOReturnSuccess || !_perCPUValues)      goto finish;
+
+    // channels get per-CPU storage in the order they are added
+    index = _nChannels - 1;
+    if (index >= _perCPUChannels)                       goto finish;
+
+    _perCPUChannelIDs[index] = channel_id;
+    __c11_atomic_store((_Atomic int *)&_perCPUChannelCount, index + 1, __ATOMIC_RELEASE);
+
+finish:
+    return res;
+}
+
+
+int
+IOSimpleReporter::findPerCPUChannel(uint64_t channel_id)
+{
+    int count, index;
+
+    if (!_perCPUValues)     return -1;
+
+    count = __c11_atomic_load((_Atomic int *)&_perCPUChannelCount, __ATOMIC_ACQUIRE);
+    for (index = 0; index < count; index++) {
+        if (_perCPUChannelIDs[index] == channel_id)     return index;
+    }
+
+    return -1;
+}
+
+
+// Fold what was added on every CPU since the last merge into the channel.
+// The per-CPU counters are never reset, only read, so there is nothing to
+// race with the lock-free increments.
+void
+IOSimpleReporter::mergePerCPUValues(int channel_index)
+{
+    IOSimpleReportValues simple_values;
+    int64_t total = 0;
+    unsigned int cpu;
+
+    IOREPORTER_CHECK_LOCK();
+
+    if (!_perCPUValues || channel_index < 0 || channel_index >= _perCPUChannels) return;
+
+    for (cpu = 0; cpu < _perCPUCount; cpu++) {
+        total += ((int64_t *)((uint8_t *)_perCPUValues + cpu * _perCPURowSize))[channel_index];
+    }
+    if (total == _perCPUMerged[channel_index])      return;
+
+    if (copyElementValues(channel_index, (IOReportElementValues *)&simple_values) != kIOReturnSuccess) {
+        return;
+    }
+    simple_values.simple_value += total - _perCPUMerged[channel_index];
+    if (setElementValues(channel_index, (IOReportElementValues *)&simple_values) == kIOReturnSuccess) {
+        _perCPUMerged[channel_index] = total;
+    }
+}
+
+
+IOReturn
+IOSimpleReporter::updateChannelValues(int channel_index)
+{
+    mergePerCPUValues(channel_index);
+
+    return kIOReturnSuccess;
+}
+
+
 IOReturn
 IOSimpleReporter::setValue(uint64_t channel_id,
                            int64_t value)
@@ -94,6 +244,8 @@ IOSimpleReporter::setValue(uint64_t channel_id,
         goto finish;
     }
 
+    // increments made before the new value must not be added to it later
+    mergePerCPUValues(element_index);
 
     if (copyElementValues(element_index, (IOReportElementValues *)&simple_values) != kIOReturnSuccess) {
         res = kIOReturnBadArgument;
@@ -116,6 +268,14 @@ IOSimpleReporter::incrementValue(uint64_t channel_id,
     IOReturn res = kIOReturnError;
     IOSimpleReportValues simple_values;
     int element_index = 0;
+    int64_t *value;
+
+    element_index = findPerCPUChannel(channel_id);
+    if (element_index >= 0) {
+        value = (int64_t *)((uint8_t *)_perCPUValues + (cpu_number() % _perCPUCount) * _perCPURowSize);
+        OSAddAtomic64(increment, &value[element_index]);
+        return kIOReturnSuccess;
+    }
     
     lockReporter();
     
@@ -149,6 +309,7 @@ IOSimpleReporter::getValue(uint64_t channel_id)
     
     if (getFirstElementIndex(channel_id, &index) == kIOReturnSuccess) {
         
+        mergePerCPUValues(index);
         values = (IOSimpleReportValues *)getElementValues(index);
         
         if (values != NULL)
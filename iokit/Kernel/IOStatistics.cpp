@@ -941,7 +941,14 @@ uint32_t IOStatistics::copyCounterStatistics(IOStatisticsCounter *stats)
 
 			/* User client counters */
 			SLIST_FOREACH(userClientCounter, &ce->userClientList, link) {
+				uint64_t ns;
+
 				uc->clientCalls += userClientCounter->clientCalls;
+				absolutetime_to_nanoseconds(userClientCounter->clientCallTime, &ns);
+				uc->clientCallTime += ns;
+				absolutetime_to_nanoseconds(userClientCounter->clientCallTimeMax, &ns);
+				if (ns > uc->clientCallTimeMax)
+					uc->clientCallTimeMax = ns;
 				uc->created++;
 			}
 
@@ -1211,6 +1218,23 @@ void IOStatistics::countUserClientCall(IOUserClient *client) {
 	}
 }
 
+void IOStatistics::countUserClientCallTime(IOUserClient *client, uint64_t elapsed) {
+	IOUserClient::ExpansionData *data;
+	IOUserClientCounter *counter;
+	uint64_t max;
+
+	if (!(data = client->reserved) || !(counter = data->counter)) {
+		return;
+	}
+
+	OSAddAtomic64(elapsed, (SInt64 *) &counter->clientCallTime);
+	do {
+		max = counter->clientCallTimeMax;
+		if (elapsed <= max)
+			break;
+	} while (!OSCompareAndSwap64(max, elapsed, &counter->clientCallTimeMax));
+}
+
 KextNode *IOStatistics::getKextNodeFromBacktrace(boolean_t write) {
 	const uint32_t btMin = 3;
 
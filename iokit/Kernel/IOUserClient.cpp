@@ -96,11 +96,21 @@ do { \
 	IOStatistics::countUserClientCall(client); \
 } while (0)
 
+#define IOStatisticsClientCallStart() \
+	uint64_t statisticsCallStart = mach_absolute_time()
+
+#define IOStatisticsClientCallEnd() \
+do { \
+	IOStatistics::countUserClientCallTime(client, mach_absolute_time() - statisticsCallStart); \
+} while (0)
+
 #else
 
 #define IOStatisticsRegisterCounter()
 #define IOStatisticsUnregisterCounter()
 #define IOStatisticsClientCall()
+#define IOStatisticsClientCallStart()
+#define IOStatisticsClientCallEnd()
 
 #endif /* IOKITSTATS */
 
@@ -3991,7 +4001,9 @@ kern_return_t is_io_connect_method
     args.structureOutputDescriptorSize = ool_output_size ? *ool_output_size : 0;
 
     IOStatisticsClientCall();
+    IOStatisticsClientCallStart();
     ret = client->externalMethod( selector, &args );
+    IOStatisticsClientCallEnd();
 
     *scalar_outputCnt = args.scalarOutputCount;
     *inband_outputCnt = args.structureOutputSize;
@@ -5268,6 +5280,117 @@ kern_return_t is_io_catalog_reset(
     return kIOReturnSuccess;
 }
 
+static bool
+IOConnectMethodBatchRangeValid(uint32_t offset, uint32_t size, uint32_t dataSize)
+{
+    if (size > kIOConnectMethodBatchMaxStructSize) return (false);
+    return ((offset <= dataSize) && (size <= (dataSize - offset)));
+}
+
+/*
+ * Runs the external methods of a kIOConnectMethodBatchTrapIndex trap.  The
+ * entries and the structure buffer are copied in and out once for the whole
+ * batch, rather than once per call as with a MIG io_connect_method message;
+ * a single entry batch is the cheap path for scalar and small structure calls.
+ * Calls needing out of line memory or an async reference still go through MIG.
+ */
+static IOReturn
+IOConnectMethodBatch(IOUserClient * client, struct iokit_user_client_trap_args * args)
+{
+    user_addr_t                 entriesAddr = (user_addr_t)(uintptr_t) args->p1;
+    uint32_t                    count       = (uint32_t)(uintptr_t) args->p2;
+    user_addr_t                 dataAddr    = (user_addr_t)(uintptr_t) args->p3;
+    uint32_t                    dataSize    = (uint32_t)(uintptr_t) args->p4;
+    IOOptionBits                options     = (IOOptionBits)(uintptr_t) args->p5;
+    IOConnectMethodBatchEntry * entries;
+    IOConnectMethodBatchEntry * entry;
+    uint8_t *                   data = 0;
+    vm_size_t                   entriesSize;
+    IOExternalMethodArguments   methodArgs;
+    IOReturn                    ret = kIOReturnSuccess;
+    uint32_t                    idx;
+
+    if (!count || (count > kIOConnectMethodBatchMaxCount))      return (kIOReturnBadArgument);
+    if (dataSize > kIOConnectMethodBatchMaxDataSize)            return (kIOReturnBadArgument);
+    if (options & ~kIOConnectMethodBatchStopOnError)            return (kIOReturnBadArgument);
+
+    entriesSize = count * sizeof(IOConnectMethodBatchEntry);
+    entries = (typeof(entries)) IOMalloc(entriesSize);
+    if (!entries) return (kIOReturnNoMemory);
+    if (dataSize)
+    {
+	data = (typeof(data)) IOMalloc(dataSize);
+	if (!data)
+	{
+	    IOFree(entries, entriesSize);
+	    return (kIOReturnNoMemory);
+	}
+    }
+
+    if (copyin(entriesAddr, entries, entriesSize)
+      || (dataSize && copyin(dataAddr, data, dataSize))) ret = kIOReturnVMError;
+
+    for (idx = 0; (kIOReturnSuccess == ret) && (idx < count); idx++)
+    {
+	entry = &entries[idx];
+
+	if ((entry->scalarInputCount > kIOConnectMethodBatchMaxScalarCount)
+	  || (entry->scalarOutputCount > kIOConnectMethodBatchMaxScalarCount)
+	  || !IOConnectMethodBatchRangeValid(entry->structureInputOffset, entry->structureInputSize, dataSize)
+	  || !IOConnectMethodBatchRangeValid(entry->structureOutputOffset, entry->structureOutputSize, dataSize)
+	  || (entry->structureInputSize && entry->structureOutputSize
+	    && (entry->structureInputOffset < (entry->structureOutputOffset + entry->structureOutputSize))
+	    && (entry->structureOutputOffset < (entry->structureInputOffset + entry->structureInputSize))))
+	{
+	    entry->result = kIOReturnBadArgument;
+	}
+	else
+	{
+	    bzero(&methodArgs, sizeof(methodArgs));
+	    methodArgs.version  = kIOExternalMethodArgumentsCurrentVersion;
+	    methodArgs.selector = entry->selector;
+
+	    methodArgs.asyncWakePort = MACH_PORT_NULL;
+
+	    methodArgs.scalarInput        = &entry->scalarInput[0];
+	    methodArgs.scalarInputCount   = entry->scalarInputCount;
+	    methodArgs.structureInput     = data ? (data + entry->structureInputOffset) : 0;
+	    methodArgs.structureInputSize = entry->structureInputSize;
+
+	    bzero(&entry->scalarOutput[0], sizeof(entry->scalarOutput));
+	    methodArgs.scalarOutput        = &entry->scalarOutput[0];
+	    methodArgs.scalarOutputCount   = entry->scalarOutputCount;
+	    methodArgs.structureOutput     = data ? (data + entry->structureOutputOffset) : 0;
+	    methodArgs.structureOutputSize = entry->structureOutputSize;
+
+	    IOStatisticsClientCall();
+	    IOStatisticsClientCallStart();
+	    entry->result = client->externalMethod(entry->selector, &methodArgs);
+	    IOStatisticsClientCallEnd();
+
+	    if (methodArgs.scalarOutputCount < entry->scalarOutputCount)
+		entry->scalarOutputCount = methodArgs.scalarOutputCount;
+	    if (methodArgs.structureOutputSize < entry->structureOutputSize)
+		entry->structureOutputSize = methodArgs.structureOutputSize;
+	}
+
+	if ((kIOReturnSuccess != entry->result) && (kIOConnectMethodBatchStopOnError & options))
+	{
+	    while (++idx < count) entries[idx].result = kIOReturnAborted;
+	    break;
+	}
+    }
+
+    if ((kIOReturnSuccess == ret)
+      && (copyout(entries, entriesAddr, entriesSize)
+	|| (dataSize && copyout(data, dataAddr, dataSize)))) ret = kIOReturnVMError;
+
+    if (data) IOFree(data, dataSize);
+    IOFree(entries, entriesSize);
+
+    return (ret);
+}
+
 kern_return_t iokit_user_client_trap(struct iokit_user_client_trap_args *args)
 {
     kern_return_t result = kIOReturnBadArgument;
@@ -5278,6 +5401,12 @@ kern_return_t iokit_user_client_trap(struct iokit_user_client_trap_args *args)
         IOExternalTrap *trap;
         IOService *target = NULL;
 
+        if (kIOConnectMethodBatchTrapIndex == args->index) {
+            result = IOConnectMethodBatch(userClient, args);
+            iokit_remove_connect_reference(userClient);
+            return result;
+        }
+
         trap = userClient->getTargetAndTrapForIndex(&target, args->index);
 
         if (trap && target) {
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#include <IOKit/IOWorkLoopPool.h>
+#include <IOKit/IOEventSource.h>
+#include <IOKit/IOLib.h>
+
+#define super OSObject
+
+OSDefineMetaClassAndStructors(IOWorkLoopPool, OSObject);
+
+OSMetaClassDefineReservedUnused(IOWorkLoopPool, 0);
+OSMetaClassDefineReservedUnused(IOWorkLoopPool, 1);
+OSMetaClassDefineReservedUnused(IOWorkLoopPool, 2);
+OSMetaClassDefineReservedUnused(IOWorkLoopPool, 3);
+
+// Upper bound on the number of domains, about one per hardware queue
+#define kIOWorkLoopPoolMaxDomains	64
+
+IOWorkLoopPool *
+IOWorkLoopPool::workLoopPool(UInt32 count, IOOptionBits options)
+{
+    IOWorkLoopPool *me = new IOWorkLoopPool;
+
+    if (me && !me->initWithDomains(count, options)) {
+	me->release();
+	return 0;
+    }
+
+    return me;
+}
+
+bool IOWorkLoopPool::initWithDomains(UInt32 count, IOOptionBits options)
+{
+    if (!super::init())
+	return false;
+
+    if (!count || count > kIOWorkLoopPoolMaxDomains)
+	return false;
+
+    domains = IONew(IOWorkLoop *, count);
+    if (!domains)
+	return false;
+    bzero(domains, count * sizeof(IOWorkLoop *));
+    domainCount = count;
+
+    for (UInt32 i = 0; i < count; i++) {
+	domains[i] = IOWorkLoop::workLoopWithOptions(options);
+	if (!domains[i])
+	    return false;
+    }
+
+    return true;
+}
+
+void IOWorkLoopPool::free()
+{
+    if (domains) {
+	for (UInt32 i = 0; i < domainCount; i++) {
+	    if (domains[i])
+		domains[i]->release();
+	}
+	IODelete(domains, IOWorkLoop *, domainCount);
+	domains = 0;
+    }
+
+    super::free();
+}
+
+UInt32 IOWorkLoopPool::getDomainCount() const
+{
+    return domainCount;
+}
+
+IOWorkLoop *IOWorkLoopPool::getWorkLoop(UInt32 domain) const
+{
+    if (domain >= domainCount)
+	return 0;
+
+    return domains[domain];
+}
+
+IOReturn IOWorkLoopPool::addEventSource(IOEventSource *newEvent, UInt32 domain)
+{
+    if (!newEvent || domain >= domainCount)
+	return kIOReturnBadArgument;
+
+    return domains[domain]->addEventSource(newEvent);
+}
+
+IOReturn IOWorkLoopPool::removeEventSource(IOEventSource *toRemove)
+{
+    IOWorkLoop *wl;
+
+    if (!toRemove || !(wl = toRemove->getWorkLoop()))
+	return kIOReturnBadArgument;
+
+    for (UInt32 i = 0; i < domainCount; i++) {
+	if (domains[i] == wl)
+	    return wl->removeEventSource(toRemove);
+    }
+
+    return kIOReturnBadArgument;
+}
+
+IOReturn IOWorkLoopPool::runActionExclusive(IOWorkLoop::Action inAction,
+					    OSObject *target,
+					    void *arg0, void *arg1,
+					    void *arg2, void *arg3)
+{
+    IOReturn res;
+    bool missing = false;
+
+    // Holding a gate other than a prefix of the domain order means taking
+    // the others would invert the order every other caller uses.
+    for (UInt32 i = 0; i < domainCount; i++) {
+	if (!domains[i]->inGate())
+	    missing = true;
+	else if (missing)
+	    return kIOReturnNotPermitted;
+    }
+
+    for (UInt32 i = 0; i < domainCount; i++)
+	domains[i]->closeGate();
+
+    res = (*inAction)(target, arg0, arg1, arg2, arg3);
+
+    for (UInt32 i = domainCount; i-- > 0; )
+	domains[i]->openGate();
+
+    return res;
+}
@@ -123,6 +123,7 @@
 #include <IOKit/IOLocks.h>
 #include <IOKit/IOLocksPrivate.h>
 #include <IOKit/IOMapper.h>
+#include <IOKit/IOMapperIOVMAllocator.h>
 #include <IOKit/IOMemoryCursor.h>
 #include <IOKit/IOMemoryDescriptor.h>
 #include <IOKit/IOMessage.h>
@@ -185,6 +186,7 @@
 #include <IOKit/IOInterruptEventSource.h>
 #include <IOKit/IOCommandGate.h>
 #include <IOKit/IOPlatformExpert.h>
+#include <IOKit/IOMapperIOVMAllocator.h>
 #include <libkern/Block.h>
 #include <libkern/Block_private.h>
 
@@ -297,6 +299,379 @@ OSCollectionTest(int newValue)
     return (0);
 }
 
+static int
+OSDictionaryTest(int newValue)
+{
+    enum { kKeys = 256 };
+    const OSSymbol * keys[kKeys];
+    OSDictionary *   dict;
+    OSDictionary *   copy;
+    OSNumber *       num;
+    char             name[32];
+    uint64_t         deadline, lookups;
+    uint32_t         idx;
+    bool             ok;
+
+    dict = OSDictionary::withCapacity(4);
+    assert(dict);
+    for (idx = 0; idx < kKeys; idx++)
+    {
+	snprintf(name, sizeof(name), "OSDictionaryTest%d", idx);
+	keys[idx] = OSSymbol::withCString(name);
+	num = OSNumber::withNumber(idx, 32);
+	ok = dict->setObject(keys[idx], num);
+	assert(ok);
+	num->release();
+    }
+    for (idx = 0; idx < kKeys; idx++)
+    {
+	num = OSDynamicCast(OSNumber, dict->getObject(keys[idx]));
+	assert(num && (idx == num->unsigned32BitValue()));
+    }
+
+    // removal keeps the order of the others, as iteration sees it
+    for (idx = 0; idx < kKeys; idx += 2) dict->removeObject(keys[idx]);
+    assert((kKeys / 2) == dict->getCount());
+    idx = 1;
+    dict->iterateObjects(^bool(const OSSymbol * key, OSObject * obj) {
+	assert(key == keys[idx]);
+	idx += 2;
+	return (false);
+    });
+    for (idx = 0; idx < kKeys; idx++)
+    {
+	assert((0 != (idx & 1)) == (NULL != dict->getObject(keys[idx])));
+    }
+
+    copy = OSDictionary::withDictionary(dict);
+    assert(copy);
+    assert(copy->isEqualTo(dict));
+    copy->release();
+
+    clock_interval_to_deadline(100, kMillisecondScale, &deadline);
+    for (lookups = 0; mach_absolute_time() < deadline; lookups++)
+    {
+	dict->getObject(keys[lookups % kKeys]);
+    }
+
+    IOLog("OSDictionaryTest: %qd lookups/100ms in %d keys\n", lookups, dict->getCount());
+
+    dict->release();
+    for (idx = 0; idx < kKeys; idx++) keys[idx]->release();
+
+    return (0);
+}
+
+static int
+OSUnserializeXMLTest(int newValue)
+{
+    enum { kEntries = 512 };
+    OSDictionary * dict;
+    OSDictionary * entry;
+    OSObject *     value;
+    OSSerialize *  s;
+    OSObject *     parsed;
+    OSString *     errorString;
+    uint8_t        bytes[256];
+    char           name[64];
+    uint64_t       deadline, parses;
+    uint32_t       idx;
+    bool           ok;
+
+    // something shaped like the prelinked info, many small dictionaries
+    dict = OSDictionary::withCapacity(kEntries);
+    assert(dict);
+    for (idx = 0; idx < sizeof(bytes); idx++) bytes[idx] = idx;
+    for (idx = 0; idx < kEntries; idx++)
+    {
+	entry = OSDictionary::withCapacity(8);
+	snprintf(name, sizeof(name), "com.apple.driver.OSUnserializeXMLTest%d", idx);
+	value = OSString::withCString(name);
+	entry->setObject("CFBundleIdentifier", value);
+	value->release();
+	value = OSNumber::withNumber(idx, 32);
+	entry->setObject("OSBundleCompatibleVersion", value);
+	value->release();
+	value = OSString::withCString("IOResources & <IOPlatformExpert>");
+	entry->setObject("IOProviderClass", value);
+	value->release();
+	value = OSData::withBytes(bytes, sizeof(bytes));
+	entry->setObject("OSBundleExecutableLoadAddress", value);
+	value->release();
+	entry->setObject("OSKernelResource", (idx & 1) ? kOSBooleanTrue : kOSBooleanFalse);
+	dict->setObject(name, entry);
+	entry->release();
+    }
+
+    s = OSSerialize::withCapacity(4096);
+    assert(s);
+    ok = dict->serialize(s);
+    assert(ok);
+
+    errorString = 0;
+    parsed = OSUnserializeXML(s->text(), &errorString);
+    assert(parsed && !errorString);
+    ok = dict->isEqualTo(parsed);
+    assert(ok);
+    parsed->release();
+
+    clock_interval_to_deadline(100, kMillisecondScale, &deadline);
+    for (parses = 0; mach_absolute_time() < deadline; parses++)
+    {
+	parsed = OSUnserializeXML(s->text());
+	assert(parsed);
+	parsed->release();
+    }
+
+    IOLog("OSUnserializeXMLTest: %qd parses/100ms of %d bytes\n", parses, s->getLength());
+
+    s->release();
+    dict->release();
+
+    return (0);
+}
+
+struct OSObjectRefTestState
+{
+    OSObject *        object;
+    uint64_t          deadline;
+    volatile SInt64   ops;
+    volatile SInt32   running;
+};
+
+static void
+OSObjectRefTestThread(void * arg, wait_result_t wres __unused)
+{
+    OSObjectRefTestState * state = (typeof(state)) arg;
+    SInt64                 ops;
+
+    for (ops = 0; mach_absolute_time() < state->deadline; ops += 2)
+    {
+	state->object->retain();
+	state->object->release();
+    }
+    OSAddAtomic64(ops, &state->ops);
+    OSDecrementAtomic(&state->running);
+}
+
+static int
+OSObjectRefTest(int newValue)
+{
+    enum { kThreads = 4 };
+    OSObjectRefTestState state;
+    thread_t             thread;
+    kern_return_t        kr;
+    uint32_t             idx;
+
+    // one object hammered from several CPUs, as with a shared provider
+    state.object  = OSString::withCString("OSObjectRefTest");
+    assert(state.object);
+    state.ops     = 0;
+    state.running = kThreads;
+    clock_interval_to_deadline(100, kMillisecondScale, &state.deadline);
+    for (idx = 0; idx < kThreads; idx++)
+    {
+	kr = kernel_thread_start(&OSObjectRefTestThread, &state, &thread);
+	assert(KERN_SUCCESS == kr);
+	thread_deallocate(thread);
+    }
+    while (state.running) IOSleep(10);
+
+    assert(1 == state.object->getRetainCount());
+    IOLog("OSObjectRefTest: %qd retains+releases/100ms on %d threads\n", state.ops, kThreads);
+    state.object->release();
+
+    return (0);
+}
+
+static int
+OSSymbolTest(int newValue)
+{
+    enum { kSymbols = 512 };
+    const OSSymbol * symbols[kSymbols];
+    const OSSymbol * sym;
+    char             name[32];
+    uint64_t         deadline, lookups, creates;
+    uint32_t         idx;
+
+    // similar keys, that used to land in a handful of buckets
+    for (idx = 0; idx < kSymbols; idx++)
+    {
+	snprintf(name, sizeof(name), "IOPCI%dMatch", idx);
+	symbols[idx] = OSSymbol::withCString(name);
+	assert(symbols[idx]);
+    }
+    for (idx = 0; idx < kSymbols; idx++)
+    {
+	snprintf(name, sizeof(name), "IOPCI%dMatch", idx);
+	sym = OSSymbol::withCString(name);
+	assert(sym == symbols[idx]);
+	assert(sym->isEqualTo(name));
+	sym->release();
+    }
+
+    clock_interval_to_deadline(100, kMillisecondScale, &deadline);
+    for (lookups = 0; mach_absolute_time() < deadline; lookups++)
+    {
+	sym = OSSymbol::withCString(symbols[lookups % kSymbols]->getCStringNoCopy());
+	sym->release();
+    }
+
+    // the last release frees the symbol, the next lookup creates it again
+    clock_interval_to_deadline(100, kMillisecondScale, &deadline);
+    for (creates = 0; mach_absolute_time() < deadline; creates++)
+    {
+	snprintf(name, sizeof(name), "OSSymbolTest%qd", creates % kSymbols);
+	sym = OSSymbol::withCString(name);
+	assert(sym);
+	sym->release();
+    }
+
+    for (idx = 0; idx < kSymbols; idx++) symbols[idx]->release();
+
+    IOLog("OSSymbolTest: %qd lookups/100ms, %qd creates/100ms\n", lookups, creates);
+
+    return (0);
+}
+
+static uint32_t gIOMapperIOVMTestFlushes;
+
+static void
+IOMapperIOVMTestFlush(OSObject * target, IOMapperIOVMAllocator * sender)
+{
+    gIOMapperIOVMTestFlushes++;
+}
+
+static int
+IOMapperIOVMAllocatorTest(int newValue)
+{
+    enum { kOutstanding = 64, kRangeSize = 1 << 20 };
+    IORangeScalar           starts[kOutstanding];
+    IORangeScalar           sizes[kOutstanding];
+    IOMapperIOVMAllocator * iovm;
+    IORangeAllocator *      ranges;
+    IOMapperIOVMStatistics  stats;
+    uint64_t                deadline, ops[2];
+    uint32_t                pass, idx, other;
+    bool                    ok;
+
+    iovm = IOMapperIOVMAllocator::withRange(1, kRangeSize, NULL, &IOMapperIOVMTestFlush);
+    assert(iovm);
+    ranges = IORangeAllocator::withRange(0, 1, 64, IORangeAllocator::kLocking);
+    assert(ranges);
+    ranges->deallocate(1, kRangeSize);
+
+    // the same I/O like pattern, with the caches and straight on the range allocator
+    for (pass = 0; pass < 2; pass++)
+    {
+	for (idx = 0; idx < kOutstanding; idx++)
+	{
+	    sizes[idx] = 1 + (idx & 15);
+	    ok = pass ? ranges->allocate(sizes[idx], &starts[idx])
+		      : iovm->allocate(sizes[idx], &starts[idx]);
+	    assert(ok);
+	}
+	clock_interval_to_deadline(100, kMillisecondScale, &deadline);
+	for (ops[pass] = 0; mach_absolute_time() < deadline; ops[pass]++)
+	{
+	    idx = ops[pass] % kOutstanding;
+	    if (pass) ranges->deallocate(starts[idx], sizes[idx]);
+	    else      iovm->deallocate(starts[idx], sizes[idx]);
+	    sizes[idx] = 1 + (ops[pass] % 16);
+	    ok = pass ? ranges->allocate(sizes[idx], &starts[idx])
+		      : iovm->allocate(sizes[idx], &starts[idx]);
+	    assert(ok);
+	}
+	for (idx = 0; idx < kOutstanding; idx++)
+	{
+	    for (other = idx + 1; other < kOutstanding; other++)
+	    {
+		assert(((starts[idx] + sizes[idx]) <= starts[other])
+		    || ((starts[other] + sizes[other]) <= starts[idx]));
+	    }
+	    if (pass) ranges->deallocate(starts[idx], sizes[idx]);
+	    else      iovm->deallocate(starts[idx], sizes[idx]);
+	}
+    }
+
+    iovm->flush();
+    iovm->getStatistics(&stats);
+    assert(stats.flushes == gIOMapperIOVMTestFlushes);
+    assert(stats.flushes <= (stats.deallocations / kIOMapperIOVMDefaultFlushBatch) + 1);
+
+    IOLog("IOMapperIOVMAllocatorTest: %qd ops/100ms cached (%qd hits, %qd flushes), %qd ops/100ms IORangeAllocator\n",
+	  ops[0], stats.cacheHits, stats.flushes, ops[1]);
+
+    iovm->release();
+    ranges->release();
+
+    return (0);
+}
+
+static int
+IOReporterPerCPUTest(int newValue)
+{
+    enum { kChannels = 2 };
+    IOSimpleReporter *    reporters[2];
+    IOHistogramReporter * histogram;
+    IOHistogramSegmentConfig config;
+    uint64_t              deadline, ops[2];
+    uint32_t              pass, channel;
+    IOReturn              err;
+    int                   bucket;
+
+    // per-CPU and locked, the same increments must give the same values
+    for (pass = 0; pass < 2; pass++)
+    {
+	reporters[pass] = pass ? IOSimpleReporter::with(IOService::getPlatform(), kIOReportCategoryDebug, kIOReportUnitNone)
+			       : IOSimpleReporter::withPerCPU(IOService::getPlatform(), kIOReportCategoryDebug, kIOReportUnitNone, kChannels);
+	assert(reporters[pass]);
+	for (channel = 0; channel < kChannels + 1; channel++)
+	{
+	    err = reporters[pass]->addChannel(channel);
+	    assert(kIOReturnSuccess == err);
+	}
+	clock_interval_to_deadline(100, kMillisecondScale, &deadline);
+	for (ops[pass] = 0; mach_absolute_time() < deadline; ops[pass]++)
+	{
+	    err = reporters[pass]->incrementValue(ops[pass] % (kChannels + 1), 1);
+	    assert(kIOReturnSuccess == err);
+	}
+	for (channel = 0; channel < kChannels + 1; channel++)
+	{
+	    assert(reporters[pass]->getValue(channel) == (int64_t)((ops[pass] + kChannels - channel) / (kChannels + 1)));
+	}
+	err = reporters[pass]->setValue(0, 5);
+	assert(kIOReturnSuccess == err);
+	err = reporters[pass]->incrementValue(0, 2);
+	assert(kIOReturnSuccess == err);
+	assert(7 == reporters[pass]->getValue(0));
+	err = reporters[pass]->incrementValue(kChannels + 1, 1);
+	assert(kIOReturnBadArgument == err);
+	reporters[pass]->release();
+    }
+
+    config.base_bucket_width    = 10;
+    config.scale_flag           = 0;
+    config.segment_bucket_count = 4;
+    histogram = IOHistogramReporter::withPerCPU(IOService::getPlatform(), kIOReportCategoryDebug,
+						0, "IOReporterPerCPUTest", kIOReportUnitNone, 1, &config);
+    assert(histogram);
+    bucket = histogram->tallyValue(5);
+    assert(0 == bucket);
+    bucket = histogram->tallyValue(15);
+    assert(1 == bucket);
+    bucket = histogram->tallyValue(100);
+    assert(3 == bucket);
+    err = histogram->overrideBucketValues(0, 0, 0, 0, 0);
+    assert(kIOReturnUnsupported == err);
+    histogram->release();
+
+    IOLog("IOReporterPerCPUTest: %qd increments/100ms per-CPU, %qd increments/100ms locked\n", ops[0], ops[1]);
+
+    return (0);
+}
+
 #if 0
 #include <IOKit/IOUserClient.h>
 class TestUserClient : public IOUserClient
@@ -432,6 +807,18 @@ sysctl_iokittest(__unused struct sysctl_oid *oidp, __unused void *arg1, __unused
 	assert(KERN_SUCCESS == error);
 	error = OSCollectionTest(newValue);
 	assert(KERN_SUCCESS == error);
+	error = OSObjectRefTest(newValue);
+	assert(KERN_SUCCESS == error);
+	error = OSSymbolTest(newValue);
+	assert(KERN_SUCCESS == error);
+	error = OSDictionaryTest(newValue);
+	assert(KERN_SUCCESS == error);
+	error = OSUnserializeXMLTest(newValue);
+	assert(KERN_SUCCESS == error);
+	error = IOMapperIOVMAllocatorTest(newValue);
+	assert(KERN_SUCCESS == error);
+	error = IOReporterPerCPUTest(newValue);
+	assert(KERN_SUCCESS == error);
 	error = IOMemoryDescriptorTest(newValue);
 	assert(KERN_SUCCESS == error);
     }
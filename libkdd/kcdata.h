@@ -420,11 +420,25 @@ struct kcdata_type_definition {
                                                         /* type-range: 0x1000-0x103f */
 #define KCDATA_BUFFER_BEGIN_XNUPOST_CONFIG 0x1e21c09fu  /* owner: osfmk/tests/kernel_tests.c */
                                                         /* type-range: 0x1040-0x105f */
+#define KCDATA_BUFFER_BEGIN_PROCINFO 0x7c31b5e4u        /* owner: sys/proc_info.h */
+                                                        /* type-range: 0x1060-0x107f */
 
-/* next type range number available 0x1060 */
+/* next type range number available 0x1080 */
 /**************** definitions for XNUPOST *********************/
 #define XNUPOST_KCTYPE_TESTCONFIG		0x1040
 
+/**************** definitions for proc_info snapshots *********************/
+#define PROCINFO_KCTYPE_SNAPSHOT_FLAGS      0x1060u /* uint64_t, PROCINFO_SNAPSHOT_* */
+#define PROCINFO_KCCONTAINER_PROC           0x1061u /* identifier is the pid */
+#define PROCINFO_KCTYPE_BSDSHORTINFO        0x1062u /* struct proc_bsdshortinfo */
+#define PROCINFO_KCTYPE_UNIQIDENTIFIERINFO  0x1063u /* struct proc_uniqidentifierinfo */
+#define PROCINFO_KCTYPE_TASKINFO            0x1064u /* struct proc_taskinfo */
+#define PROCINFO_KCTYPE_THREADIDS           0x1065u /* uint64_t[], thread ids */
+#define PROCINFO_KCTYPE_THREADINFO          0x1066u /* struct proc_threadinfo[], in the order of PROCINFO_KCTYPE_THREADIDS */
+
+/* the buffer was too small for all the processes */
+#define PROCINFO_SNAPSHOT_TRUNCATED 0x1
+
 /**************** definitions for stackshot *********************/
 
 /* This value must always match IO_NUM_PRIORITIES defined in thread_info.h */
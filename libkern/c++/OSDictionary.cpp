@@ -52,6 +52,126 @@ OSMetaClassDefineReservedUnused(OSDictionary, 7);
 #define EXT_CAST(obj) \
     reinterpret_cast<OSObject *>(const_cast<OSMetaClassBase *>(obj))
 
+/*
+ * Past kOSDictionaryHashThreshold keys, an unsorted dictionary also keeps an
+ * open addressed index of its keys, so lookups don't scan the entries.  The
+ * entry array stays the dictionary, in insertion order, as iteration and
+ * serialization see it; the index only maps a key to its entry.  It is kept
+ * at most half full, and dropped below half the threshold.
+ */
+#define kOSDictionaryHashThreshold	32
+#define kOSDictionaryHashMinSize	64
+
+struct OSDictionary::ExpansionData
+{
+    unsigned int * index;	// entry number + 1, 0 for a free slot
+    unsigned int   indexSize;	// power of 2
+};
+
+static inline unsigned int
+OSDictionaryHashKey(const OSSymbol * key, unsigned int indexSize)
+{
+    // symbols are unique, so the pointer is the key
+    uint64_t hash = ((uint64_t)(uintptr_t) key) * 0x9E3779B97F4A7C15ULL;
+
+    return ((unsigned int)(hash >> 32) & (indexSize - 1));
+}
+
+bool OSDictionary::findKey(const OSSymbol *aKey, unsigned int *index) const
+{
+    unsigned int i, slot, entry;
+    bool exists;
+
+    if (fOptions & kSort) {
+    	i = OSSymbol::bsearch(aKey, &dictionary[0], count, sizeof(dictionary[0]));
+	exists = (i < count) && (aKey == dictionary[i].key);
+    } else if (reserved && reserved->index) {
+	for (exists = false, i = count, slot = OSDictionaryHashKey(aKey, reserved->indexSize);
+	     (entry = reserved->index[slot]);
+	     slot = (slot + 1) & (reserved->indexSize - 1)) {
+	    if ((exists = (aKey == dictionary[entry - 1].key))) {
+		i = entry - 1;
+		break;
+	    }
+	}
+    } else for (exists = false, i = 0; i < count; i++) {
+        if ((exists = (aKey == dictionary[i].key))) break;
+    }
+
+    // for a missing key, where it would be inserted
+    *index = i;
+    return exists;
+}
+
+void OSDictionary::indexKey(unsigned int index)
+{
+    unsigned int slot;
+
+    for (slot = OSDictionaryHashKey(dictionary[index].key, reserved->indexSize);
+	 reserved->index[slot];
+	 slot = (slot + 1) & (reserved->indexSize - 1)) {}
+
+    reserved->index[slot] = index + 1;
+}
+
+void OSDictionary::freeIndex(void)
+{
+    if (!reserved)
+	return;
+
+    if (reserved->index) {
+	kfree(reserved->index, reserved->indexSize * sizeof(unsigned int));
+	OSCONTAINER_ACCUMSIZE( -(reserved->indexSize * sizeof(unsigned int)) );
+    }
+    kfree(reserved, sizeof(ExpansionData));
+    OSCONTAINER_ACCUMSIZE( -sizeof(ExpansionData) );
+    reserved = 0;
+}
+
+// Without an index lookups are linear, so a failed allocation is not an error
+void OSDictionary::rebuildIndex(void)
+{
+    unsigned int newSize;
+
+    if ((fOptions & kSort) || (count < (kOSDictionaryHashThreshold / 2))) {
+	freeIndex();
+	return;
+    }
+
+    for (newSize = kOSDictionaryHashMinSize; newSize < (2 * count); newSize <<= 1) {
+	if (newSize > (UINT_MAX / (2 * sizeof(unsigned int)))) {
+	    freeIndex();
+	    return;
+	}
+    }
+
+    if (!reserved) {
+	reserved = (ExpansionData *) kalloc_container(sizeof(ExpansionData));
+	if (!reserved)
+	    return;
+	bzero(reserved, sizeof(ExpansionData));
+	OSCONTAINER_ACCUMSIZE(sizeof(ExpansionData));
+    }
+
+    if (reserved->indexSize != newSize) {
+	if (reserved->index) {
+	    kfree(reserved->index, reserved->indexSize * sizeof(unsigned int));
+	    OSCONTAINER_ACCUMSIZE( -(reserved->indexSize * sizeof(unsigned int)) );
+	}
+	reserved->indexSize = newSize;
+	reserved->index = (unsigned int *) kalloc_container(newSize * sizeof(unsigned int));
+	if (!reserved->index) {
+	    freeIndex();
+	    return;
+	}
+	OSCONTAINER_ACCUMSIZE(newSize * sizeof(unsigned int));
+    }
+
+    bzero(reserved->index, newSize * sizeof(unsigned int));
+    for (unsigned int i = 0; i < count; i++)
+	indexKey(i);
+}
+
 bool OSDictionary::initWithCapacity(unsigned int inCapacity)
 {
     if (!super::init())
@@ -181,6 +301,9 @@ bool OSDictionary::initWithDictionary(const OSDictionary *dict,
         dictionary[i].value->taggedRetain(OSTypeID(OSCollection));
     }
 
+    if (count >= kOSDictionaryHashThreshold)
+        rebuildIndex();
+
     return true;
 }
 
@@ -247,6 +370,7 @@ void OSDictionary::free()
         kfree(dictionary, capacity * sizeof(dictEntry));
         OSCONTAINER_ACCUMSIZE( -(capacity * sizeof(dictEntry)) );
     }
+    freeIndex();
 
     super::free();
 }
@@ -314,6 +438,7 @@ void OSDictionary::flushCollection()
         dictionary[i].value->taggedRelease(OSTypeID(OSCollection));
     }
     count = 0;
+    freeIndex();
 }
 
 bool OSDictionary::
@@ -327,12 +452,7 @@ setObject(const OSSymbol *aKey, const OSMetaClassBase *anObject, bool onlyAdd)
 
     // if the key exists, replace the object
 
-    if (fOptions & kSort) {
-    	i = OSSymbol::bsearch(aKey, &dictionary[0], count, sizeof(dictionary[0]));
-	exists = (i < count) && (aKey == dictionary[i].key);
-    } else for (exists = false, i = 0; i < count; i++) {
-        if ((exists = (aKey == dictionary[i].key))) break;
-    }
+    exists = findKey(aKey, &i);
 
     if (exists) {
 
@@ -363,6 +483,12 @@ setObject(const OSSymbol *aKey, const OSMetaClassBase *anObject, bool onlyAdd)
     dictionary[i].value = anObject;
     count++;
 
+    // unsorted keys are appended, so no other entry moved
+    if (reserved && reserved->index && ((2 * count) <= reserved->indexSize))
+        indexKey(i);
+    else if (!(fOptions & kSort) && (count >= kOSDictionaryHashThreshold))
+        rebuildIndex();
+
     return true;
 }
 
@@ -382,12 +508,7 @@ void OSDictionary::removeObject(const OSSymbol *aKey)
 
     // if the key exists, remove the object
 
-    if (fOptions & kSort) {
-    	i = OSSymbol::bsearch(aKey, &dictionary[0], count, sizeof(dictionary[0]));
-	exists = (i < count) && (aKey == dictionary[i].key);
-    } else for (exists = false, i = 0; i < count; i++) {
-        if ((exists = (aKey == dictionary[i].key))) break;
-    }
+    exists = findKey(aKey, &i);
 
     if (exists) {
 	dictEntry oldEntry = dictionary[i];
@@ -396,6 +517,8 @@ void OSDictionary::removeObject(const OSSymbol *aKey)
 
 	count--;
 	bcopy(&dictionary[i+1], &dictionary[i], (count - i) * sizeof(dictionary[0]));
+	if (reserved)
+	    rebuildIndex();
 
 	oldEntry.key->taggedRelease(OSTypeID(OSCollection));
 	oldEntry.value->taggedRelease(OSTypeID(OSCollection));
@@ -441,12 +564,7 @@ OSObject *OSDictionary::getObject(const OSSymbol *aKey) const
 
     // if the key exists, return the object
 
-    if (fOptions & kSort) {
-    	i = OSSymbol::bsearch(aKey, &dictionary[0], count, sizeof(dictionary[0]));
-	exists = (i < count) && (aKey == dictionary[i].key);
-    } else for (exists = false, i = 0; i < count; i++) {
-        if ((exists = (aKey == dictionary[i].key))) break;
-    }
+    exists = findKey(aKey, &i);
 
     if (exists) {
 	return (const_cast<OSObject *> ((const OSObject *)dictionary[i].value));
@@ -635,6 +753,10 @@ bool OSDictionary::serialize(OSSerialize *s) const
 unsigned OSDictionary::setOptions(unsigned options, unsigned mask, void *)
 {
     unsigned old = super::setOptions(options, mask);
+    if ((old ^ options) & mask & kSort) {
+	// sorted dictionaries insert in the middle, and don't need the index
+	rebuildIndex();
+    }
     if ((old ^ options) & mask) {
 
 	// Value changed need to recurse over all of the child collections
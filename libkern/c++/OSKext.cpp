@@ -5347,6 +5347,7 @@ OSKext::loadExecutable()
     OSString            * versString         = NULL;  // do not release
     const char          * versCString        = NULL;  // do not free
     const char          * string             = NULL;  // do not free
+    uint64_t              linkStart;
     unsigned int          i;
 
    /* We need the version string for a variety of bits below.
@@ -5527,11 +5528,13 @@ OSKext::loadExecutable()
    /* After this call, the linkedExecutable instance variable
     * should exist.
     */
+    linkStart = mach_absolute_time();
     kxldResult = kxld_link_file(sKxldContext,
         (u_char *)theExecutable->getBytesNoCopy(),
         theExecutable->getLength(),
         getIdentifierCString(), this, kxlddeps, num_kxlddeps,
         (u_char **)kxldHeaderPtr, (kxld_addr_t *)&kmod_info);
+    absolutetime_to_nanoseconds(mach_absolute_time() - linkStart, &linkTime);
 
     if (kxldResult != KERN_SUCCESS) {
         // xxx - add kxldResult here?
@@ -6312,6 +6315,7 @@ OSKext::start(bool startDependenciesFlag)
     kern_return_t                       (* startfunc)(kmod_info_t *, void *);
     unsigned int                        i, count;
     void                              * kmodStartData = NULL; 
+    uint64_t                            callStart;
 
     if (isStarted() || isInterface() || isKernelComponent()) {
         result = kOSReturnSuccess;
@@ -6393,10 +6397,12 @@ OSKext::start(bool startDependenciesFlag)
 
     // Drop a log message so logd can grab the needed information to decode this kext
     OSKextLogKextInfo(this, kmod_info->address, kmod_info->size, firehose_tracepoint_code_load);
+    callStart = mach_absolute_time();
     result = OSRuntimeInitializeCPP(this);
     if (result == KERN_SUCCESS) {
         result = startfunc(kmod_info, kmodStartData);
     }
+    absolutetime_to_nanoseconds(mach_absolute_time() - callStart, &startTime);
 
     flags.starting = 0;
 
@@ -6412,6 +6418,11 @@ OSKext::start(bool startDependenciesFlag)
             kOSKextLogLoadFlag,
             "Kext %s is now started.",
             getIdentifierCString()); 
+        OSKextLog(this,
+            kOSKextLogDetailLevel |
+            kOSKextLogLoadFlag,
+            "Kext %s linked in %llu us, started in %llu us.",
+            getIdentifierCString(), linkTime / NSEC_PER_USEC, startTime / NSEC_PER_USEC); 
     } else {
         invokeOrCancelRequestCallbacks(
             /* result not actually used */ kOSKextReturnStartStopError,
@@ -9269,6 +9280,26 @@ OSKext::copyInfo(OSArray * infoKeys)
         OSSafeReleaseNULL(scratchNumber);
     }
     
+   /* LinkTime, StartTime, in nanoseconds; zero if prelinked or not started.
+    */
+    if (!infoKeys || _OSArrayContainsCString(infoKeys, kOSBundleLinkTimeKey)) {
+        scratchNumber = OSNumber::withNumber(linkTime, 8 * sizeof(linkTime));
+        if (!scratchNumber) {
+            goto finish;
+        }
+        result->setObject(kOSBundleLinkTimeKey, scratchNumber);
+        OSSafeReleaseNULL(scratchNumber);
+    }
+
+    if (!infoKeys || _OSArrayContainsCString(infoKeys, kOSBundleStartTimeKey)) {
+        scratchNumber = OSNumber::withNumber(startTime, 8 * sizeof(startTime));
+        if (!scratchNumber) {
+            goto finish;
+        }
+        result->setObject(kOSBundleStartTimeKey, scratchNumber);
+        OSSafeReleaseNULL(scratchNumber);
+    }
+
    /* LoadAddress, LoadSize.
     */
     if (!infoKeys ||
@@ -114,6 +114,10 @@ struct ExpansionData {
 #if IOTRACKING
     IOTrackingQueue * tracking;
 #endif
+    // kOSRefStats
+    uint64_t          retains;
+    uint64_t          releases;
+    uint64_t          contended;
 };
 
 
@@ -1304,6 +1308,7 @@ void
 OSMetaClass::serializeClassDictionary(OSDictionary * serializeDictionary)
 {
     OSDictionary * classDict = NULL;
+    OSDictionary * refDict   = NULL;
 
     IOLockLock(sAllClassesLock);
 
@@ -1312,6 +1317,11 @@ OSMetaClass::serializeClassDictionary(OSDictionary * serializeDictionary)
         goto finish;
     }
 
+    // per class retain/release traffic, when counted
+    if (kOSRefStats & gIOKitDebug) {
+        refDict = OSDictionary::withCapacity(sAllClassesDict->getCount());
+    }
+
     do {
         OSCollectionIterator * classes;
         const OSSymbol * className;
@@ -1331,14 +1341,33 @@ OSMetaClass::serializeClassDictionary(OSDictionary * serializeDictionary)
                 classDict->setObject(className, count);
                 count->release();
             }
+
+            if (refDict && (meta->reserved->retains || meta->reserved->releases)) {
+                OSDictionary * refs = OSDictionary::withCapacity(3);
+                if (refs) {
+                    count = OSNumber::withNumber(meta->reserved->retains, 64);
+                    if (count) { refs->setObject("Retains", count); count->release(); }
+                    count = OSNumber::withNumber(meta->reserved->releases, 64);
+                    if (count) { refs->setObject("Releases", count); count->release(); }
+                    count = OSNumber::withNumber(meta->reserved->contended, 64);
+                    if (count) { refs->setObject("Contended", count); count->release(); }
+                    refDict->setObject(className, refs);
+                    refs->release();
+                }
+            }
         }
         classes->release();
 
         serializeDictionary->setObject("Classes", classDict);
+
+        if (refDict) {
+            serializeDictionary->setObject("ClassReferences", refDict);
+        }
     } while (0);
 
 finish:
     OSSafeReleaseNULL(classDict);
+    OSSafeReleaseNULL(refDict);
 
     IOLockUnlock(sAllClassesLock);
 
@@ -1346,6 +1375,23 @@ finish:
 }
 
 
+/*********************************************************************
+* Counted against the object's class only, retains of a subclass
+* instance don't add up into its superclasses.
+*********************************************************************/
+void
+OSMetaClass::countReference(bool release, uint32_t retries) const
+{
+    if (release) {
+        OSIncrementAtomic64((SInt64 *) &reserved->releases);
+    } else {
+        OSIncrementAtomic64((SInt64 *) &reserved->retains);
+    }
+    if (retries) {
+        OSAddAtomic64(retries, (SInt64 *) &reserved->contended);
+    }
+}
+
 /*********************************************************************
 *********************************************************************/
 
@@ -98,12 +98,17 @@ void OSObject::taggedRetain(const void *tag) const
     UInt32 inc = 1;
     UInt32 origCount;
     UInt32 newCount;
+    const OSMetaClass *meta = NULL;
+    UInt32 attempts = 0;
 
     // Increment the collection bucket.
     if ((const void *) OSTypeID(OSCollection) == tag)
 	inc |= (1UL<<16);
 
+    if (kOSRefStats & gIOKitDebug) meta = getMetaClass();
+
     do {
+	attempts++;
 	origCount = *countP;
         if ( ((UInt16) origCount | 0x1) == 0xffff ) {
             const char *msg;
@@ -132,6 +137,33 @@ void OSObject::taggedRetain(const void *tag) const
 
 	newCount = origCount + inc;
     } while (!OSCompareAndSwap(origCount, newCount, const_cast<UInt32 *>(countP)));
+
+    if (meta) meta->countReference(false, attempts - 1);
+}
+
+bool OSObject::taggedTryRetain(const void *tag) const
+{
+    volatile UInt32 *countP = (volatile UInt32 *) &retainCount;
+    UInt32 inc = 1;
+    UInt32 origCount;
+    UInt32 newCount;
+
+    // Increment the collection bucket.
+    if ((const void *) OSTypeID(OSCollection) == tag)
+	inc |= (1UL<<16);
+
+    do {
+	origCount = *countP;
+        if ( ((UInt16) origCount | 0x1) == 0xffff ) {
+            // 0xffff: the object is being freed, too late to revive it.
+            // 0xfffe: the count is pegged, the object will never be freed.
+            return ((origCount & 0x1) == 0);
+        }
+
+	newCount = origCount + inc;
+    } while (!OSCompareAndSwap(origCount, newCount, const_cast<UInt32 *>(countP)));
+
+    return true;
 }
 
 void OSObject::taggedRelease(const void *tag) const
@@ -146,12 +178,18 @@ void OSObject::taggedRelease(const void *tag, const int when) const
     UInt32 origCount;
     UInt32 newCount;
     UInt32 actualCount;
+    const OSMetaClass *meta = NULL;
+    UInt32 attempts = 0;
 
     // Increment the collection bucket.
     if ((const void *) OSTypeID(OSCollection) == tag)
 	dec |= (1UL<<16);
 
+    // Look the class up while our reference still keeps the object alive
+    if (kOSRefStats & gIOKitDebug) meta = getMetaClass();
+
     do {
+	attempts++;
 	origCount = *countP;
         
         if ( ((UInt16) origCount | 0x1) == 0xffff ) {
@@ -184,6 +222,8 @@ void OSObject::taggedRelease(const void *tag, const int when) const
 
     } while (!OSCompareAndSwap(origCount, newCount, const_cast<UInt32 *>(countP)));
 
+    if (meta) meta->countReference(true, attempts - 1);
+
     //
     // This panic means that we have just attempted to release an object
     // whose retain count has gone to less than the number of collections
@@ -76,6 +76,8 @@ bool OSSerialize::addBinary(const void * bits, size_t size)
 	{
 	   newCapacity = (((newCapacity - 1) / capacityIncrement) + 1) * capacityIncrement;
 	   if (newCapacity < capacity) return (false);
+	   // grow geometrically so large payloads aren't copied on every increment
+	   if ((newCapacity < (2 * capacity)) && (capacity < (UINT_MAX / 2))) newCapacity = 2 * capacity;
 	   if (newCapacity > ensureCapacity(newCapacity)) return (false);
     }
 
@@ -101,6 +103,8 @@ bool OSSerialize::addBinaryObject(const OSMetaClassBase * o, uint32_t key,
 	{
 	   newCapacity = (((newCapacity - 1) / capacityIncrement) + 1) * capacityIncrement;
 	   if (newCapacity < capacity) return (false);
+	   // grow geometrically so large payloads aren't copied on every increment
+	   if ((newCapacity < (2 * capacity)) && (capacity < (UINT_MAX / 2))) newCapacity = 2 * capacity;
 	   if (newCapacity > ensureCapacity(newCapacity)) return (false);
     }
 
@@ -242,7 +246,8 @@ bool OSSerialize::binarySerialize(const OSMetaClassBase *o)
         if (v##Capacity >= v##CapacityMax) ok = false;                                  \
         else																			\
         {																			    \
-            uint32_t ncap = v##Capacity + 64;										    \
+            uint32_t ncap = v##Capacity ? (2 * v##Capacity) : 64;                       \
+            if (ncap > v##CapacityMax) ncap = v##CapacityMax;                           \
             typeof(v##Array) nbuf = (typeof(v##Array)) kalloc_container(ncap * sizeof(o)); \
             if (!nbuf) ok = false;													    \
             else															            \
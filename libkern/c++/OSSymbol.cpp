@@ -68,22 +68,30 @@ private:
     Bucket *buckets;
     unsigned int nBuckets;
     unsigned int count;
-    lck_mtx_t *poolGate;
+    lck_rw_t *poolGate;
 
     static inline void hashSymbol(const char *s,
                                   unsigned int *hashP,
                                   unsigned int *lenP)
     {
-        unsigned int hash = 0;
+        unsigned int hash = 2166136261U;
         unsigned int len = 0;
 
-        /* Unroll the loop. */
-        for (;;) {
-            if (!*s) break; len++; hash ^= *s++;
-            if (!*s) break; len++; hash ^= *s++ <<  8;
-            if (!*s) break; len++; hash ^= *s++ << 16;
-            if (!*s) break; len++; hash ^= *s++ << 24;
+        /*
+         * FNV-1a, then the murmur3 finalizer: keys differing in a few
+         * bytes, like IOPCIMatch and IOPCIClassMatch, must not share the
+         * low bits the bucket index is taken from.
+         */
+        for (; *s; s++, len++) {
+            hash ^= (unsigned char) *s;
+            hash *= 16777619U;
         }
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bU;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35U;
+        hash ^= hash >> 16;
+
         *lenP = len;
         *hashP = hash;
     }
@@ -93,6 +101,7 @@ private:
 
     void reconstructSymbols(void);
     void reconstructSymbols(bool grow);
+    void linkSymbol(OSSymbol *sym);
 
 public:
     static void *operator new(size_t size);
@@ -104,8 +113,11 @@ public:
 
     bool init();
 
-    inline void closeGate() { lck_mtx_lock(poolGate); }
-    inline void openGate()  { lck_mtx_unlock(poolGate); }
+    // Lookups share the gate, only changes to the pool take it exclusive
+    inline void closeReadGate()  { lck_rw_lock_shared(poolGate); }
+    inline void openReadGate()   { lck_rw_unlock_shared(poolGate); }
+    inline void closeWriteGate() { lck_rw_lock_exclusive(poolGate); }
+    inline void openWriteGate()  { lck_rw_unlock_exclusive(poolGate); }
 
     OSSymbol *findSymbol(const char *cString) const;
     OSSymbol *insertSymbol(OSSymbol *sym);
@@ -144,7 +156,7 @@ bool OSSymbolPool::init()
 
     bzero(buckets, nBuckets * sizeof(Bucket));
 
-    poolGate = lck_mtx_alloc_init(IOLockGroup, LCK_ATTR_NULL);
+    poolGate = lck_rw_alloc_init(IOLockGroup, LCK_ATTR_NULL);
 
     return poolGate != 0;
 }
@@ -173,7 +185,7 @@ OSSymbolPool::~OSSymbolPool()
     }
 
     if (poolGate)
-        lck_mtx_free(poolGate, IOLockGroup);
+        lck_rw_free(poolGate, IOLockGroup);
 }
 
 unsigned long OSSymbolPool::log2(unsigned int x)
@@ -249,11 +261,46 @@ void OSSymbolPool::reconstructSymbols(bool grow)
     /* @@@ gvdl: Zero test and panic if can't set up pool */
     bzero(buckets, nBuckets * sizeof(Bucket));
 
+    // symbols waiting for the gate in free() are still in, so no dedup
     state = old.initHashState();
     while ( (insert = old.nextHashState(&state)) )
-        insertSymbol(insert);
+        linkSymbol(insert);
+}
+
+void OSSymbolPool::linkSymbol(OSSymbol *sym)
+{
+    Bucket *thisBucket;
+    unsigned int j, inLen, hash;
+    OSSymbol **list;
+
+    hashSymbol(sym->string, &hash, &inLen);
+    thisBucket = &buckets[hash % nBuckets];
+    j = thisBucket->count++;
+    count++;
+
+    if (!j) {
+        thisBucket->symbolP = (OSSymbol **) sym;
+        return;
+    }
+
+    list = (OSSymbol **) kalloc_tag((j + 1) * sizeof(OSSymbol *), VM_KERN_MEMORY_LIBKERN);
+    OSMETA_ACCUMSIZE((j + 1) * sizeof(OSSymbol *));
+    /* @@@ gvdl: Zero test and panic if can't set up pool */
+    list[0] = sym;
+    if (j == 1)
+        list[1] = (OSSymbol *) thisBucket->symbolP;
+    else {
+        bcopy(thisBucket->symbolP, list + 1, j * sizeof(OSSymbol *));
+        kfree(thisBucket->symbolP, j * sizeof(OSSymbol *));
+        OSMETA_ACCUMSIZE(-(j * sizeof(OSSymbol *)));
+    }
+    thisBucket->symbolP = list;
 }
 
+/*
+ * Returns the symbol retained.  A symbol whose last reference is gone stays
+ * in the pool until its free() gets the write gate, and is skipped.
+ */
 OSSymbol *OSSymbolPool::findSymbol(const char *cString) const
 {
     Bucket *thisBucket;
@@ -271,7 +318,8 @@ OSSymbol *OSSymbolPool::findSymbol(const char *cString) const
         probeSymbol = (OSSymbol *) thisBucket->symbolP;
 
         if (inLen == probeSymbol->length
-        &&  (strncmp(probeSymbol->string, cString, probeSymbol->length) == 0))
+        &&  (strncmp(probeSymbol->string, cString, probeSymbol->length) == 0)
+        &&  probeSymbol->taggedTryRetain(0))
             return probeSymbol;
 	return 0;
     }
@@ -279,13 +327,15 @@ OSSymbol *OSSymbolPool::findSymbol(const char *cString) const
     for (list = thisBucket->symbolP; j--; list++) {
         probeSymbol = *list;
         if (inLen == probeSymbol->length
-        &&  (strncmp(probeSymbol->string, cString, probeSymbol->length) == 0))
+        &&  (strncmp(probeSymbol->string, cString, probeSymbol->length) == 0)
+        &&  probeSymbol->taggedTryRetain(0))
             return probeSymbol;
     }
 
     return 0;
 }
 
+// Returns sym once inserted, or the equal symbol already in the pool, retained
 OSSymbol *OSSymbolPool::insertSymbol(OSSymbol *sym)
 {
     const char *cString = sym->string;
@@ -308,7 +358,8 @@ OSSymbol *OSSymbolPool::insertSymbol(OSSymbol *sym)
         probeSymbol = (OSSymbol *) thisBucket->symbolP;
 
         if (inLen == probeSymbol->length
-        &&  strncmp(probeSymbol->string, cString, probeSymbol->length) == 0)
+        &&  strncmp(probeSymbol->string, cString, probeSymbol->length) == 0
+        &&  probeSymbol->taggedTryRetain(0))
             return probeSymbol;
 
         list = (OSSymbol **) kalloc_tag(2 * sizeof(OSSymbol *), VM_KERN_MEMORY_LIBKERN);
@@ -327,7 +378,8 @@ OSSymbol *OSSymbolPool::insertSymbol(OSSymbol *sym)
     for (list = thisBucket->symbolP; j--; list++) {
         probeSymbol = *list;
         if (inLen == probeSymbol->length
-        &&  strncmp(probeSymbol->string, cString, probeSymbol->length) == 0)
+        &&  strncmp(probeSymbol->string, cString, probeSymbol->length) == 0
+        &&  probeSymbol->taggedTryRetain(0))
             return probeSymbol;
     }
 
@@ -479,61 +531,52 @@ const OSSymbol *OSSymbol::withString(const OSString *aString)
 
 const OSSymbol *OSSymbol::withCString(const char *cString)
 {
-    pool->closeGate();
-
+    pool->closeReadGate();
     OSSymbol *oldSymb = pool->findSymbol(cString);
-    if (!oldSymb) {
-        OSSymbol *newSymb = new OSSymbol;
-        if (!newSymb) {
-            pool->openGate();
-            return newSymb;
-        }
-
-	if (newSymb->OSString::initWithCString(cString))
-	    oldSymb = pool->insertSymbol(newSymb);
-        
-        if (newSymb == oldSymb) {
-            pool->openGate();
-            return newSymb;	// return the newly created & inserted symbol.
-        }
-        else
-            // Somebody else inserted the new symbol so free our copy
-	    newSymb->OSString::free();
+    pool->openReadGate();
+    if (oldSymb)
+        return oldSymb;
+
+    // Build the new symbol outside of the gate, most lookups find one
+    OSSymbol *newSymb = new OSSymbol;
+    if (!newSymb)
+        return newSymb;
+
+    if (newSymb->OSString::initWithCString(cString)) {
+        pool->closeWriteGate();
+        oldSymb = pool->insertSymbol(newSymb);
+        pool->openWriteGate();
     }
-    
-    if (oldSymb) oldSymb->retain();    // Retain the old symbol before releasing the lock.
 
-    pool->openGate();
+    if (newSymb != oldSymb)
+        // Somebody else inserted the new symbol so free our copy
+        newSymb->OSString::free();
+
     return oldSymb;
 }
 
 const OSSymbol *OSSymbol::withCStringNoCopy(const char *cString)
 {
-    pool->closeGate();
-
+    pool->closeReadGate();
     OSSymbol *oldSymb = pool->findSymbol(cString);
-    if (!oldSymb) {
-        OSSymbol *newSymb = new OSSymbol;
-        if (!newSymb) {
-            pool->openGate();
-            return newSymb;
-        }
-
-	if (newSymb->OSString::initWithCStringNoCopy(cString))
-	    oldSymb = pool->insertSymbol(newSymb);
-        
-        if (newSymb == oldSymb) {
-            pool->openGate();
-            return newSymb;	// return the newly created & inserted symbol.
-        }
-        else
-            // Somebody else inserted the new symbol so free our copy
-	    newSymb->OSString::free();
+    pool->openReadGate();
+    if (oldSymb)
+        return oldSymb;
+
+    OSSymbol *newSymb = new OSSymbol;
+    if (!newSymb)
+        return newSymb;
+
+    if (newSymb->OSString::initWithCStringNoCopy(cString)) {
+        pool->closeWriteGate();
+        oldSymb = pool->insertSymbol(newSymb);
+        pool->openWriteGate();
     }
-    
-    oldSymb->retain();	// Retain the old symbol before releasing the lock.
 
-    pool->openGate();
+    if (newSymb != oldSymb)
+        // Somebody else inserted the new symbol so free our copy
+        newSymb->OSString::free();
+
     return oldSymb;
 }
 
@@ -542,14 +585,14 @@ void OSSymbol::checkForPageUnload(void *startAddr, void *endAddr)
     OSSymbol *probeSymbol;
     OSSymbolPoolState state;
 
-    pool->closeGate();
+    pool->closeWriteGate();
     state = pool->initHashState();
     while ( (probeSymbol = pool->nextHashState(&state)) ) {
         if (probeSymbol->string >= startAddr && probeSymbol->string < endAddr) {
 	    probeSymbol->OSString::initWithCString(probeSymbol->string);
         }
     }
-    pool->openGate();
+    pool->openWriteGate();
 }
 
 void OSSymbol::taggedRelease(const void *tag) const
@@ -559,14 +602,19 @@ void OSSymbol::taggedRelease(const void *tag) const
 
 void OSSymbol::taggedRelease(const void *tag, const int when) const
 {
-    pool->closeGate();
     super::taggedRelease(tag, when);
-    pool->openGate();
 }
 
+/*
+ * Lookups that found this symbol before the last release hold the read
+ * gate, and fail to retain it; once it is removed under the write gate no
+ * lookup can see it, so it can be freed.
+ */
 void OSSymbol::free()
 {
+    pool->closeWriteGate();
     pool->removeSymbol(this);
+    pool->openWriteGate();
     super::free();
 }
 
@@ -512,6 +512,7 @@ getString(parser_state_t *state)
 	int c = currentChar();
 	int start, length, i, j;
 	char * tempString;
+	bool escaped = false;
 
 	start = state->parseBufferIndex;
 	/* find end of string */
@@ -521,6 +522,7 @@ getString(parser_state_t *state)
 		if (c == '<') {
 			break;
 		}
+		if (c == '&') escaped = true;
 		c = nextChar();
 	}
 
@@ -535,6 +537,13 @@ getString(parser_state_t *state)
 		goto error;
 	}
 
+	// most strings have no entities, copy them in one go
+	if (!escaped) {
+		bcopy(&state->parseBuffer[start], tempString, length);
+		tempString[length] = 0;
+		return tempString;
+	}
+
 	// copy out string in tempString
 	// "&amp;" -> '&', "&lt;" -> '<', "&gt;" -> '>'
 
@@ -671,7 +680,8 @@ getCFEncodedData(parser_state_t *state, unsigned int *size)
         acc += __CFPLDataDecodeTable[c];
         if (0 == (cntr & 0x3)) {
             if (tmpbuflen <= tmpbufpos + 2) {
-                tmpbuflen += DATA_ALLOC_SIZE;
+                // double, so large data isn't copied for every page decoded
+                tmpbuflen = tmpbuflen ? (2 * tmpbuflen) : DATA_ALLOC_SIZE;
 		tmpbuf = (unsigned char *)realloc(tmpbuf, tmpbuflen);
             }
             tmpbuf[tmpbufpos++] = (acc >> 16) & 0xff;
@@ -694,9 +704,10 @@ static void *
 getHexData(parser_state_t *state, unsigned int *size)
 {
     int c;
-    unsigned char *d, *start, *lastStart;
+    unsigned char *d, *start;
+    int capacity = DATA_ALLOC_SIZE;
 
-    start = lastStart = d = (unsigned char *)malloc(DATA_ALLOC_SIZE);
+    start = d = (unsigned char *)malloc(capacity);
     c = currentChar();
 
     while (c != '<') {
@@ -728,10 +739,11 @@ getHexData(parser_state_t *state, unsigned int *size)
 	}
 	
 	d++;
-	if ((d - lastStart) >= DATA_ALLOC_SIZE) {
+	if ((d - start) >= capacity) {
 	    int oldsize = d - start;
-	    start = (unsigned char *)realloc(start, oldsize + DATA_ALLOC_SIZE);
-	    d = lastStart = start + oldsize;
+	    capacity *= 2;
+	    start = (unsigned char *)realloc(start, capacity);
+	    d = start + oldsize;
 	}
 	c = nextChar();
     }
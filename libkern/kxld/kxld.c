@@ -66,6 +66,10 @@ struct kxld_context {
     KXLDDict defined_cxx_symbols_by_value;
     KXLDDict obsolete_symbols_by_name;
     KXLDDict vtables_by_name;
+    u_int num_defined_symbols;          // Sizes at the end of the last link,
+    u_int num_defined_cxx_symbols;      // most of which are the kernel's, so
+    u_int num_obsolete_symbols;         // the next link can size its
+    u_int num_vtables;                  // dictionaries without resizing
     KXLDFlags flags;
     KXLDAllocateCallback allocate_callback;
     cpu_type_t cputype;
@@ -454,19 +458,22 @@ init_context(KXLDContext *context, u_int ndependencies)
     require_noerr(rval, finish);
 
     rval = kxld_dict_init(&context->defined_symbols_by_name, 
-        kxld_dict_string_hash, kxld_dict_string_cmp, 0);
+        kxld_dict_string_hash, kxld_dict_string_cmp, 
+        context->num_defined_symbols);
     require_noerr(rval, finish);
 
     rval = kxld_dict_init(&context->defined_cxx_symbols_by_value, 
-        kxld_dict_kxldaddr_hash, kxld_dict_kxldaddr_cmp, 0);
+        kxld_dict_kxldaddr_hash, kxld_dict_kxldaddr_cmp, 
+        context->num_defined_cxx_symbols);
     require_noerr(rval, finish);
 
     rval = kxld_dict_init(&context->obsolete_symbols_by_name, 
-        kxld_dict_string_hash, kxld_dict_string_cmp, 0);
+        kxld_dict_string_hash, kxld_dict_string_cmp, 
+        context->num_obsolete_symbols);
     require_noerr(rval, finish);
 
     rval = kxld_dict_init(&context->vtables_by_name, kxld_dict_string_hash,
-        kxld_dict_string_cmp, 0);
+        kxld_dict_string_cmp, context->num_vtables);
     require_noerr(rval, finish);
 
     rval = KERN_SUCCESS;
@@ -697,6 +704,14 @@ clear_context(KXLDContext *context)
     }
     kxld_array_reset(&context->dependencies);
 
+    context->num_defined_symbols = 
+        kxld_dict_get_num_entries(&context->defined_symbols_by_name);
+    context->num_defined_cxx_symbols = 
+        kxld_dict_get_num_entries(&context->defined_cxx_symbols_by_value);
+    context->num_obsolete_symbols = 
+        kxld_dict_get_num_entries(&context->obsolete_symbols_by_name);
+    context->num_vtables = kxld_dict_get_num_entries(&context->vtables_by_name);
+
     kxld_dict_clear(&context->defined_symbols_by_name);
     kxld_dict_clear(&context->defined_cxx_symbols_by_value);
     kxld_dict_clear(&context->obsolete_symbols_by_name);
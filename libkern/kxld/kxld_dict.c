@@ -61,6 +61,7 @@ struct dict_entry {
     const void *key;
     void *value;
     DictEntryState state;
+    u_int base;                 // Bucket the key hashed to, skips most compares
 };
 
 /*******************************************************************************
@@ -70,8 +71,9 @@ struct dict_entry {
 static kern_return_t get_locate_index(const KXLDDict *dict, const void *key, 
     u_int *idx);
 static kern_return_t get_insert_index(const KXLDDict *dict, const void *key, 
-    u_int *idx);
+    u_int *idx, u_int *base);
 static kern_return_t resize_dict(KXLDDict *dict);
+static inline DictEntry * get_bucket(const KXLDDict *dict, u_int idx);
 
 /*******************************************************************************
 *******************************************************************************/
@@ -196,15 +198,20 @@ get_locate_index(const KXLDDict *dict, const void *key, u_int *_idx)
 
     base = idx = dict->hash(dict, key);
     
-    /* Iterate until we match the key, wrap, or hit an empty bucket */
-    entry = kxld_array_get_item(&dict->buckets, idx);
-    while (!dict->cmp(entry->key, key)) {
+    /* Iterate until we match the key, wrap, or hit an empty bucket.  A key
+     * can only be in a bucket that records its hash, so only those are
+     * compared.
+     */
+    entry = get_bucket(dict, idx);
+    while (entry->state != USED || entry->base != base ||
+        !dict->cmp(entry->key, key)) 
+    {
         if (entry->state == EMPTY) goto finish;
 
         idx = (idx + 1) % dict->buckets.nitems;
         if (idx == base) goto finish;
 
-        entry = kxld_array_get_item(&dict->buckets, idx);
+        entry = get_bucket(dict, idx);
     }
 
     check(idx < dict->buckets.nitems);
@@ -224,6 +231,7 @@ kxld_dict_insert(KXLDDict *dict, const void *key, void *value)
     kern_return_t rval = KERN_FAILURE;
     DictEntry *entry = NULL;
     u_int idx = 0;
+    u_int base = 0;
     
     check(dict);
     check(key);
@@ -241,17 +249,18 @@ kxld_dict_insert(KXLDDict *dict, const void *key, void *value)
     /* If this function returns FULL after we've already resized appropriately
      * something is very wrong and we should return an error.
      */
-    rval = get_insert_index(dict, key, &idx);
+    rval = get_insert_index(dict, key, &idx, &base);
     require_noerr(rval, finish);
     
     /* Insert the new key-value pair into the bucket, but only count it as a 
      * new entry if we are not overwriting an existing entry.
      */
-    entry = kxld_array_get_item(&dict->buckets, idx);
+    entry = get_bucket(dict, idx);
     if (entry->state != USED) {
         dict->num_entries++;
         entry->key = key;
         entry->state = USED;
+        entry->base = base;
     }
     entry->value = value;
 
@@ -311,7 +320,8 @@ finish:
 * Simple function to find the first empty cell
 *******************************************************************************/
 static kern_return_t
-get_insert_index(const KXLDDict *dict, const void *key, u_int *r_index)
+get_insert_index(const KXLDDict *dict, const void *key, u_int *r_index,
+    u_int *r_base)
 {
     kern_return_t rval = KERN_FAILURE;
     DictEntry *entry = NULL;
@@ -322,20 +332,38 @@ get_insert_index(const KXLDDict *dict, const void *key, u_int *r_index)
     /* Iterate through the buckets until we find an EMPTY bucket, a DELETED
      * bucket, or a key match.
      */
-    entry = kxld_array_get_item(&dict->buckets, idx);
-    while (entry->state == USED && !dict->cmp(entry->key, key)) {
+    entry = get_bucket(dict, idx);
+    while (entry->state == USED && 
+        (entry->base != base || !dict->cmp(entry->key, key))) 
+    {
         idx = (idx + 1) % dict->buckets.nitems;
         require_action(base != idx, finish, rval=KERN_FAILURE);
-        entry = kxld_array_get_item(&dict->buckets, idx);
+        entry = get_bucket(dict, idx);
     }
     
     *r_index = idx;
+    *r_base = base;
     rval = KERN_SUCCESS;
     
 finish:
     return rval;
 }
 
+/*******************************************************************************
+* The buckets are normally a single pool, sized at init or resize, so index it
+* directly rather than walking the pool list for every probe.
+*******************************************************************************/
+static inline DictEntry *
+get_bucket(const KXLDDict *dict, u_int idx)
+{
+    if (dict->buckets.npools == 1) {
+        return (DictEntry *) (void *) (STAILQ_FIRST(&dict->buckets.pools)->buffer +
+            (idx * sizeof(DictEntry)));
+    }
+
+    return kxld_array_get_item(&dict->buckets, idx);
+}
+
 /*******************************************************************************
 *******************************************************************************/
 void
@@ -142,6 +142,8 @@ typedef uint8_t OSKextExcludeLevel;
 #define kOSBundleDependenciesKey                "OSBundleDependencies"
 #define kOSBundleRetainCountKey                 "OSBundleRetainCount"
 #define kOSBundleCacheLoadAddressKey            "OSBundleCacheLoadAddress"
+#define kOSBundleLinkTimeKey                    "OSBundleLinkTime"
+#define kOSBundleStartTimeKey                   "OSBundleStartTime"
 // Kernel TEXT encompasses kexts
 #define kOSBundleKextsInKernelTextKey           "OSBundleKextsInKernelText"
 // OSKextCopyLoadedKextInfo includes non-started kexts when present:
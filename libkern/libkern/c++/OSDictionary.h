@@ -116,6 +116,9 @@ class OSDictionary : public OSCollection
 
     OSDeclareDefaultStructors(OSDictionary)
 
+    // Hash index of a large dictionary, see OSDictionary.cpp
+    struct ExpansionData;
+
 #if APPLE_KEXT_ALIGN_CONTAINERS
 
 protected:
@@ -128,6 +131,8 @@ protected:
     };
     dictEntry    * dictionary;
 
+    ExpansionData * reserved;
+
 #else /* APPLE_KEXT_ALIGN_CONTAINERS */
 
 protected:
@@ -140,8 +145,6 @@ protected:
     unsigned int   capacity;
     unsigned int   capacityIncrement;
 
-    struct ExpansionData { };
-
    /* Reserved for future use.  (Internal use only)  */
     ExpansionData * reserved;
 
@@ -967,6 +970,12 @@ public:
 
 #endif /* __BLOCKS__ */
 
+private:
+    bool findKey(const OSSymbol * aKey, unsigned int * index) const;
+    void indexKey(unsigned int index);
+    void rebuildIndex(void);
+    void freeIndex(void);
+
     OSMetaClassDeclareReservedUnused(OSDictionary, 0);
     OSMetaClassDeclareReservedUnused(OSDictionary, 1);
     OSMetaClassDeclareReservedUnused(OSDictionary, 2);
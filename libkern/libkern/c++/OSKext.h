@@ -294,6 +294,8 @@ private:
     uuid_t instance_uuid;
     OSKextAccount * account;
     uint32_t builtinKmodIdx;
+    uint64_t linkTime;                   // ns in kxld_link_file
+    uint64_t startTime;                  // ns in the module start routine
 
 #if PRAGMA_MARK
 /**************************************/
@@ -2090,6 +2090,8 @@ void className ::_RESERVED ## className ## index ()             \
     static void printInstanceCounts();
     static void serializeClassDictionary(OSDictionary * dict);
 #ifdef XNU_KERNEL_PRIVATE
+public:
+    void countReference(bool release, uint32_t retries) const;
 #if IOTRACKING
 public:
     static void * trackedNew(size_t size);
@@ -232,6 +232,24 @@ protected:
     */
     virtual void taggedRelease(const void * tag, const int freeWhen) const APPLE_KEXT_OVERRIDE;
 
+#ifdef XNU_KERNEL_PRIVATE
+   /* Not to be included in headerdoc.
+    *
+    * @function taggedTryRetain
+    *
+    * @abstract
+    * Retains a tagged reference to an object unless it is being freed.
+    *
+    * @result
+    * <code>false</code> if the last reference was already released.
+    *
+    * @discussion
+    * For lookup tables that hold objects without a reference of their own,
+    * such as the OSSymbol pool, and only remove them from <code>free</code>.
+    */
+    bool taggedTryRetain(const void * tag) const;
+#endif /* XNU_KERNEL_PRIVATE */
+
 
    /*!
     * @function init
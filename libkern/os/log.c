@@ -79,6 +79,16 @@ uint32_t oslog_p_boot_dropped_msgcount = 0;
 uint32_t oslog_s_total_msgcount = 0;
 uint32_t oslog_s_error_count = 0;
 uint32_t oslog_s_metadata_msgcount = 0;
+uint32_t oslog_s_lock_wait_count = 0;
+
+/* Messages too long to be formatted before taking the log lock */
+uint32_t oslog_msgbuf_locked_format_count = 0;
+
+/*
+ * Messages for the msgbuf are formatted on the stack before the log lock is
+ * taken; longer ones are formatted under the lock as before.
+ */
+#define OSLOG_MSGBUF_LINE_MAX 256
 
 static bool oslog_boot_done = false;
 extern boolean_t early_boot_complete;
@@ -203,7 +213,17 @@ static void
 _os_log_to_msgbuf_internal(const char *format, va_list args, bool safe, bool logging)
 {
     static int msgbufreplay = -1;
+    char line[OSLOG_MSGBUF_LINE_MAX];
     va_list args_copy;
+    int line_len;
+
+    va_copy(args_copy, args);
+    line_len = vsnprintf_log(line, sizeof(line), format, args_copy);
+    va_end(args_copy);
+
+    if (line_len >= (int)sizeof(line)) {
+        (void)hw_atomic_add(&oslog_msgbuf_locked_format_count, 1);
+    }
 
 #if DEVELOPMENT || DEBUG
     if (safe) {
@@ -264,9 +284,13 @@ _os_log_to_msgbuf_internal(const char *format, va_list args, bool safe, bool log
         bsd_log_lock();
     }
 
-    va_copy(args_copy, args);
-    vprintf_log_locked(format, args_copy);
-    va_end(args_copy);
+    if (line_len >= 0 && line_len < (int)sizeof(line)) {
+        log_puts_locked(msgbufp, line, line_len);
+    } else {
+        va_copy(args_copy, args);
+        vprintf_log_locked(format, args_copy);
+        va_end(args_copy);
+    }
 
 #if DEVELOPMENT || DEBUG
     if (safe) {
@@ -444,7 +468,10 @@ _firehose_trace(firehose_stream_t stream, firehose_tracepoint_id_u ftid,
 
 	if (oslog_stream_open && (stream != firehose_stream_metadata)) {
 
-		lck_spin_lock(&oslog_stream_lock);
+		if (!lck_spin_try_lock(&oslog_stream_lock)) {
+			(void)hw_atomic_add(&oslog_s_lock_wait_count, 1);
+			lck_spin_lock(&oslog_stream_lock);
+		}
 		if (!oslog_stream_open) {
 			lck_spin_unlock(&oslog_stream_lock);
 			goto out;
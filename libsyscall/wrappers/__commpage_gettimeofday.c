@@ -32,14 +32,21 @@ int __commpage_gettimeofday(struct timeval *);
 __attribute__((visibility("hidden")))
 int __commpage_gettimeofday_internal(struct timeval *tp, uint64_t *tbr_out);
 
+__attribute__((visibility("hidden")))
+int __commpage_gettimespec_internal(struct timespec *tp, uint64_t *tbr_out);
+
 int
 __commpage_gettimeofday(struct timeval *tp)
 {
 	return __commpage_gettimeofday_internal(tp, NULL);
 }
 
-int
-__commpage_gettimeofday_internal(struct timeval *tp, uint64_t *tbr_out)
+/*
+ * Returns the time of day as seconds and a 64 bit fraction of a second,
+ * or 1 if the commpage timestamp can't be used and a syscall is needed.
+ */
+static int
+__commpage_timeofday_frac(uint64_t *sec_out, uint64_t *frac_out, uint64_t *tbr_out)
 {
 	uint64_t now, over;
 	uint64_t delta,frac;
@@ -48,6 +55,7 @@ __commpage_gettimeofday_internal(struct timeval *tp, uint64_t *tbr_out)
 	uint64_t TimeStamp_frac;
 	uint64_t Tick_scale;
 	uint64_t Ticks_per_sec;
+	uint64_t sec;
 
 	volatile uint64_t *gtod_TimeStamp_tick_p;
 	volatile uint64_t *gtod_TimeStamp_sec_p;
@@ -99,28 +107,64 @@ __commpage_gettimeofday_internal(struct timeval *tp, uint64_t *tbr_out)
 		return(1);
 	}
 
-	tp->tv_sec = (__darwin_time_t)TimeStamp_sec;
+	sec = TimeStamp_sec;
 
 	over = multi_overflow(Tick_scale, delta);
 	if(over){
-		tp->tv_sec += over;
+		sec += over;
 	}
 
 	/* Sum scale*delta to TimeStamp_frac, if it overflows increment sec */
 	frac = TimeStamp_frac;
 	frac += Tick_scale * delta;
 	if( TimeStamp_frac > frac )
-		tp->tv_sec++;
+		sec++;
+
+	*sec_out = sec;
+	*frac_out = frac;
+	if (tbr_out) {
+		*tbr_out = now;
+	}
+
+	return(0);
+}
+
+int
+__commpage_gettimeofday_internal(struct timeval *tp, uint64_t *tbr_out)
+{
+	uint64_t sec, frac;
 
+	if (__commpage_timeofday_frac(&sec, &frac, tbr_out))
+		return(1);
+
+	tp->tv_sec = (__darwin_time_t)sec;
 	/*
 	 * Convert frac (64 bit frac of a sec) to usec
 	 * usec = frac * USEC_PER_SEC / 2^64
 	 */
 	tp->tv_usec = ((uint64_t)1000000 * (uint32_t)(frac >> 32)) >> 32;
 
-	if (tbr_out) {
-		*tbr_out = now;
-	}
+	return(0);
+}
+
+/*
+ * Same as __commpage_gettimeofday_internal(), with the nanoseconds
+ * gettimeofday() would truncate.
+ */
+int
+__commpage_gettimespec_internal(struct timespec *tp, uint64_t *tbr_out)
+{
+	uint64_t sec, frac;
+
+	if (__commpage_timeofday_frac(&sec, &frac, tbr_out))
+		return(1);
+
+	tp->tv_sec = (__darwin_time_t)sec;
+	/*
+	 * Convert frac (64 bit frac of a sec) to nsec
+	 * nsec = frac * NSEC_PER_SEC / 2^64
+	 */
+	tp->tv_nsec = (long)(((uint64_t)NSEC_PER_SEC * (uint32_t)(frac >> 32)) >> 32);
 
 	return(0);
 }
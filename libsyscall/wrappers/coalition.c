@@ -61,3 +61,13 @@ int coalition_info_set_efficiency(uint64_t cid, uint64_t flags)
     size_t size = sizeof(flags);
     return __coalition_info(COALITION_INFO_SET_EFFICIENCY, &cid, (void *)&flags, &size);
 }
+
+int coalition_info_set_cpu_quota(uint64_t cid, uint64_t quota_ns, uint64_t period_ns)
+{
+	struct coalition_cpu_quota ccq = {
+		.quota_ns = quota_ns,
+		.period_ns = period_ns,
+	};
+	size_t size = sizeof(ccq);
+	return __coalition_info(COALITION_INFO_SET_CPU_QUOTA, &cid, (void *)&ccq, &size);
+}
@@ -126,6 +126,17 @@ proc_listcoalitions(int flavor, int coaltype, void *buffer, int buffersize)
 	return retval;
 }
 
+int
+proc_snapshot(uint32_t type, uint32_t typeinfo, uint64_t flags, void *buffer, int buffersize)
+{
+	int retval;
+
+	if ((retval = __proc_info(PROC_INFO_CALL_SNAPSHOT, type, typeinfo, flags, buffer, buffersize)) == -1)
+		return 0;
+
+	return retval;
+}
+
 int
 proc_pid_rusage(int pid, int flavor, rusage_info_t *buffer)
 {
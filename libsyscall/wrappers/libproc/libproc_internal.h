@@ -160,6 +160,14 @@ int proc_pidoriginatorinfo(int flavor,  void *buffer, int buffersize) __OSX_AVAI
 
 int proc_listcoalitions(int flavor, int coaltype, void *buffer, int buffersize) __OSX_AVAILABLE_STARTING(__MAC_10_11, __IPHONE_8_3);
 
+/*
+ * Fills buffer with a kcdata snapshot of the information selected by flags
+ * (PROC_SNAPSHOT_*) about the processes proc_listpids() would list for type
+ * and typeinfo.  Returns the size of the snapshot, or with a NULL buffer
+ * the size of buffer likely to be needed; 0 with errno set on failure.
+ */
+int proc_snapshot(uint32_t type, uint32_t typeinfo, uint64_t flags, void *buffer, int buffersize) __OSX_AVAILABLE_STARTING(__MAC_10_14, __IPHONE_12_0);
+
 #if !TARGET_IPHONE_SIMULATOR
 
 #define PROC_SUPPRESS_SUCCESS                (0)
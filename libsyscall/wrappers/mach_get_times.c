@@ -28,7 +28,7 @@
 #include <machine/cpu_capabilities.h>
 
 // From __commpage_gettimeofday.c
-extern int __commpage_gettimeofday_internal(struct timeval *tp, uint64_t *tbr_out);
+extern int __commpage_gettimespec_internal(struct timespec *tp, uint64_t *tbr_out);
 extern kern_return_t _mach_continuous_time(uint64_t* absolute_time, uint64_t* cont_time);
 // From mach_continuous_time.c
 extern uint64_t _mach_continuous_time_base(void);
@@ -58,7 +58,7 @@ mach_get_times(uint64_t* absolute_time, uint64_t* cont_time, struct timespec *tp
 		 * This call has the necessary memory barriers for this retry loop,
 		 * since it is implemented with a retry loop of its own.
 		 */
-		if (__commpage_gettimeofday_internal(&tv, &tbr)) {
+		if (__commpage_gettimespec_internal(tp, &tbr)) {
 			tbr = 0;
 			if (__gettimeofday_with_mach(&tv, NULL, &tbr) < 0) {
 				return KERN_FAILURE;
@@ -70,6 +70,8 @@ mach_get_times(uint64_t* absolute_time, uint64_t* cont_time, struct timespec *tp
 				__builtin_trap();
 #endif
 			}
+			tp->tv_sec = tv.tv_sec;
+			tp->tv_nsec = tv.tv_usec * NSEC_PER_USEC;
 		}
 
 		continuous_time_base_post = _mach_continuous_time_base();
@@ -77,8 +79,6 @@ mach_get_times(uint64_t* absolute_time, uint64_t* cont_time, struct timespec *tp
 
 	if (absolute_time) *absolute_time = tbr;
 	if (cont_time) *cont_time = continuous_time_base_prior + tbr;
-	tp->tv_sec = tv.tv_sec;
-	tp->tv_nsec = tv.tv_usec * NSEC_PER_USEC;
 
 	return KERN_SUCCESS;
 }
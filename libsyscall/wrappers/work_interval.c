@@ -114,6 +114,35 @@ work_interval_notify_simple(work_interval_t interval_handle, uint64_t start,
 	                            deadline, next_start, 0);
 }
 
+int
+work_interval_set_budget(work_interval_t interval_handle, uint64_t period,
+                         uint64_t budget)
+{
+	if (interval_handle == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct work_interval_budget wib = {
+		.wib_period = period,
+		.wib_budget = budget,
+	};
+
+	return __work_interval_ctl(WORK_INTERVAL_OPERATION_SET_BUDGET,
+	                           interval_handle->work_interval_id, &wib, sizeof(wib));
+}
+
+int
+work_interval_get_overruns(work_interval_t interval_handle, uint64_t *overruns)
+{
+	if (interval_handle == NULL || overruns == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return __work_interval_ctl(WORK_INTERVAL_OPERATION_GET_OVERRUNS,
+	                           interval_handle->work_interval_id, overruns, sizeof(*overruns));
+}
 
 int
 work_interval_destroy(work_interval_t interval_handle)
@@ -477,3 +477,38 @@ commpage_increment_cpu_quiescent_counter(void)
 	return old_gen;
 }
 
+/*
+ * publish the runtime of the thread being dispatched on a cpu,
+ * or clear the cpu's entry when called with a thread_id of 0
+ */
+void
+commpage_update_thread_usage(int cpu, uint64_t thread_id, uint32_t c_switch,
+    uint64_t runtime, uint64_t timestamp)
+{
+	commpage_thread_usage_t *ctu;
+	uint32_t gen;
+
+	if (!commPagePtr || cpu < 0 || cpu >= _COMM_PAGE_THREAD_USAGE_CPUS)
+		return;
+
+	ctu = (commpage_thread_usage_t *)(_COMM_PAGE_THREAD_USAGE + _COMM_PAGE_RW_OFFSET) + cpu;
+
+	/* nothing to clear if no opted-in thread ran here since */
+	if (thread_id == 0 && ctu->ctu_thread_id == 0)
+		return;
+
+	/*
+	 * Readers retry on a torn read, so the 64bit fields can be stored
+	 * with two 32bit stores on 32bit architectures.
+	 */
+	gen = ctu->ctu_gen;
+	atomic_store_explicit((_Atomic uint32_t *)(uintptr_t)&ctu->ctu_gen,
+		gen + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	ctu->ctu_thread_id = thread_id;
+	ctu->ctu_c_switch = c_switch;
+	ctu->ctu_runtime = runtime;
+	ctu->ctu_dispatch = timestamp;
+	atomic_store_explicit((_Atomic uint32_t *)(uintptr_t)&ctu->ctu_gen,
+		gen + 2, memory_order_release);
+}
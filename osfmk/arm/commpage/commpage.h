@@ -47,5 +47,6 @@ extern	void	commpage_update_multiuser_config(uint32_t);
 extern  void    commpage_update_boottime(uint64_t boottime_usec);
 extern	void	commpage_set_remotetime_params(double rate, uint64_t base_local_ts, uint64_t base_remote_ts);
 extern uint64_t commpage_increment_cpu_quiescent_counter(void);
+extern	void	commpage_update_thread_usage(int cpu, uint64_t thread_id, uint32_t c_switch, uint64_t runtime, uint64_t timestamp);
 
 #endif /* _ARM_COMMPAGE_H */
@@ -206,6 +206,9 @@ extern vm_address_t				_get_commpage_priv_address(void);
 // aligning to 128 bytes for cacheline/fabric size
 #define _COMM_PAGE_CPU_QUIESCENT_COUNTER        (_COMM_PAGE_START_ADDRESS+0x180)        // uint64_t, but reserve the whole 128 (0x80) bytes
 
+#define _COMM_PAGE_THREAD_USAGE			(_COMM_PAGE_START_ADDRESS+0x200)	// commpage_thread_usage_t[_COMM_PAGE_THREAD_USAGE_CPUS], indexed by cpu number
+#define _COMM_PAGE_THREAD_USAGE_CPUS		8					// [0x200,0x300), the cpu number userspace can read has 3 bits
+
 #define _COMM_PAGE_END				(_COMM_PAGE_START_ADDRESS+0x1000)	// end of common page
 
 #endif /* _ARM_CPU_CAPABILITIES_H */
@@ -2472,6 +2472,73 @@ lck_mtx_lock(lck_mtx_t *lock)
 	lck_mtx_lock_contended(lock, thread, FALSE);
 }
 
+#if	__SMP__
+/*
+ *	Routine:	lck_mtx_lock_spinwait_arm
+ *
+ *	Spin waiting for a contended mutex to be released, as long as
+ *	its owner is running on another core and for no longer than the
+ *	adaptive spin window (see lck_mtx_spin_window()).  The owner is
+ *	only looked at with the interlock held, which it needs in order to
+ *	unlock, so it is sampled every quarter window rather than on every
+ *	iteration.  Returns without the mutex: the caller acquires it, or
+ *	blocks, under the interlock.
+ */
+static void
+lck_mtx_lock_spinwait_arm(lck_mtx_t *lock)
+{
+	uint64_t	start_time, cur_time;
+	uint64_t	deadline, check_owner_deadline;
+	uint64_t	spin_window;
+	uintptr_t	state;
+	thread_t	holder;
+	processor_t	processor;
+	boolean_t	on_core;
+	int		loopcount = 0;
+
+	start_time = cur_time = mach_absolute_time();
+	spin_window = lck_mtx_spin_window();
+	deadline = start_time + spin_window;
+	check_owner_deadline = start_time;
+
+	for ( ; ; ) {
+		state = ordered_load_mtx(lock);
+		if (LCK_MTX_STATE_TO_THREAD(state) == NULL)
+			break;
+
+		if (cur_time >= check_owner_deadline &&
+		    !(state & LCK_ILOCK) && interlock_try(lock)) {
+			state = ordered_load_mtx(lock);
+			holder = LCK_MTX_STATE_TO_THREAD(state);
+			on_core = TRUE;
+			if (holder != NULL && holder != (thread_t)LCK_MTX_SPIN_TAG) {
+				processor = holder->last_processor;
+				on_core = (processor != PROCESSOR_NULL) &&
+				    (processor->active_thread == holder) &&
+				    !(holder->state & TH_IDLE);
+			}
+			interlock_unlock(lock);
+
+			if (!on_core) {
+				if (loopcount == 0)
+					return;		/* don't count a spin we never did */
+				break;
+			}
+			check_owner_deadline = cur_time + (spin_window / 4);
+		}
+
+		cur_time = mach_absolute_time();
+		if (cur_time >= deadline)
+			break;
+
+		cpu_pause();
+		loopcount++;
+	}
+
+	lck_mtx_spin_update(mach_absolute_time() - start_time);
+}
+#endif	/* __SMP__ */
+
 /*
 	This is the slow version of mutex locking.
  */
@@ -2485,7 +2552,10 @@ lck_mtx_lock_contended(lck_mtx_t *lock, thread_t thread, boolean_t interlocked)
 	if (interlocked)
 		goto interlock_held;
 
-	/* TODO: short-duration spin for on-core contention <rdar://problem/10234625> */
+#if	__SMP__
+	/* short-duration spin while the owner is on core */
+	lck_mtx_lock_spinwait_arm(lock);
+#endif
 
 	/* Loop waiting until I see that the mutex is unowned */
 	for ( ; ; ) {
@@ -98,6 +98,9 @@
  *     by system.
  *   CORPSEINFO_ALLOCATION_SIZE: is the default size of vm allocation. If in future there is much more
  *     data to be put in, then please re-tune this parameter.
+ *   boot-arg: corpse_footprint_budget_mb bounds the combined footprint of the tasks whose maps are
+ *     held by corpses in flight (default: a quarter of memory). A corpse that would go over the
+ *     budget is still generated, but without a copy of the crashed task's map.
  * 
  * Debugging/Visibility
  * ====================
@@ -112,6 +115,10 @@
  *   With holding off memory for inspection, it creates vm pressure which might not be desirable
  *   on low memory devices. There are limits to max corpses being inspected at a time which is
  *   marked by TOTAL_CORPSES_ALLOWED.
+ *   The corpse map is a copy-on-write fork of the crashed task's map, so it pins the pages the
+ *   crashed task had resident until the corpse is released. The footprint of every forked map is
+ *   charged against corpse_footprint_budget; the amount charged is visible through the
+ *   kern.corpse_footprint_inflight sysctl.
  * 
  */
 
@@ -130,6 +137,7 @@
 #include <kern/kern_cdata.h>
 #include <mach/mach_vm.h>
 #include <kern/exc_guard.h>
+#include <libkern/OSAtomic.h>
 
 #if CONFIG_MACF
 #include <security/mac_mach_internal.h>
@@ -152,6 +160,12 @@ static _Atomic uint32_t inflight_corpses;
 unsigned long  total_corpses_created = 0;
 boolean_t corpse_enabled_config = TRUE;
 
+/* footprint of the maps held by corpses in flight, and its bound */
+static _Atomic uint64_t inflight_corpse_footprint;
+uint64_t corpse_footprint_inflight = 0;
+uint64_t corpse_footprint_budget = 0;
+uint64_t corpse_footprint_over_budget = 0;
+
 /* bootarg to turn on corpse forking for EXC_RESOURCE */
 int exc_via_corpse_forking = 1;
 
@@ -174,6 +188,7 @@ void corpses_init(){
 	char temp_buf[20];
 	int exc_corpse_forking;
 	int fatal_memkill;
+	uint32_t footprint_budget_mb;
 	if (PE_parse_boot_argn("-no_corpses", temp_buf, sizeof(temp_buf))) {
 		corpse_enabled_config = FALSE;
 	}
@@ -183,6 +198,11 @@ void corpses_init(){
 	if (PE_parse_boot_argn("corpse_for_fatal_memkill", &fatal_memkill, sizeof(fatal_memkill))) {
 		corpse_for_fatal_memkill = fatal_memkill;
 	}
+	if (PE_parse_boot_argn("corpse_footprint_budget_mb", &footprint_budget_mb, sizeof(footprint_budget_mb))) {
+		corpse_footprint_budget = (uint64_t)footprint_budget_mb << 20;
+	} else {
+		corpse_footprint_budget = max_mem / 4;
+	}
 }
 
 /*
@@ -203,6 +223,61 @@ total_corpses_count(void)
 	return gate.corpses;
 }
 
+/*
+ * Routine: task_corpse_footprint_charge
+ *          Charge the footprint of the crashed task to the corpse budget
+ *          before its map is forked into the corpse.
+ * Returns: TRUE if the budget allows for the map to be held by the corpse.
+ */
+boolean_t
+task_corpse_footprint_charge(task_t corpse_task, task_t task)
+{
+	uint64_t footprint, oldval, newval;
+
+	assert(corpse_task->corpse_footprint == 0);
+	footprint = get_task_phys_footprint(task);
+
+	oldval = atomic_load_explicit(&inflight_corpse_footprint, memory_order_relaxed);
+	for (;;) {
+		newval = oldval + footprint;
+		if (newval > corpse_footprint_budget) {
+			OSIncrementAtomic64((volatile SInt64 *)&corpse_footprint_over_budget);
+			return FALSE;
+		}
+		// this reloads the value in oldval
+		if (atomic_compare_exchange_strong_explicit(&inflight_corpse_footprint,
+				&oldval, newval, memory_order_relaxed,
+				memory_order_relaxed)) {
+			break;
+		}
+	}
+	corpse_task->corpse_footprint = footprint;
+	corpse_footprint_inflight = newval;
+	return TRUE;
+}
+
+/*
+ * Routine: task_corpse_footprint_uncharge
+ *          Give back the footprint charged for a corpse's map.
+ */
+void
+task_corpse_footprint_uncharge(task_t corpse_task)
+{
+	uint64_t footprint = corpse_task->corpse_footprint;
+	uint64_t oldval;
+
+	if (footprint == 0) {
+		return;
+	}
+	corpse_task->corpse_footprint = 0;
+	oldval = atomic_fetch_sub_explicit(&inflight_corpse_footprint, footprint,
+			memory_order_relaxed);
+	if (oldval < footprint) {
+		panic("corpse footprint over-release");
+	}
+	corpse_footprint_inflight = oldval - footprint;
+}
+
 /*
  * Routine: task_crashinfo_get_ref()
  *          Grab a slot at creating a corpse.
@@ -76,6 +76,8 @@ extern kern_return_t task_crashinfo_destroy(kcdata_descriptor_t data);
 extern void corpses_init(void);
 
 extern unsigned long total_corpses_count(void);
+extern boolean_t task_corpse_footprint_charge(task_t corpse_task, task_t task);
+extern void task_corpse_footprint_uncharge(task_t corpse_task);
 extern boolean_t corpses_enabled(void);
 
 extern kern_return_t task_generate_corpse_internal(
@@ -906,6 +906,51 @@ commpage_update_boottime(uint64_t boottime)
 	}
 }
 
+static void
+commpage_update_thread_usage_one(char *cp, int cpu, uint64_t thread_id,
+    uint32_t c_switch, uint64_t runtime, uint64_t timestamp)
+{
+	commpage_thread_usage_t *ctu;
+	uint32_t gen;
+
+	cp += (_COMM_PAGE_THREAD_USAGE - _COMM_PAGE32_START_ADDRESS);
+	ctu = (commpage_thread_usage_t *)(uintptr_t)cp + cpu;
+
+	/* nothing to clear if no opted-in thread ran here since */
+	if (thread_id == 0 && ctu->ctu_thread_id == 0)
+		return;
+
+	gen = ctu->ctu_gen;
+	atomic_store_explicit((_Atomic uint32_t *)(uintptr_t)&ctu->ctu_gen,
+		gen + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	ctu->ctu_thread_id = thread_id;
+	ctu->ctu_c_switch = c_switch;
+	ctu->ctu_runtime = runtime;
+	ctu->ctu_dispatch = timestamp;
+	atomic_store_explicit((_Atomic uint32_t *)(uintptr_t)&ctu->ctu_gen,
+		gen + 2, memory_order_release);
+}
+
+/*
+ * publish the runtime of the thread being dispatched on a cpu,
+ * or clear the cpu's entry when called with a thread_id of 0
+ */
+void
+commpage_update_thread_usage(int cpu, uint64_t thread_id, uint32_t c_switch,
+    uint64_t runtime, uint64_t timestamp)
+{
+	if (cpu < 0 || cpu >= _COMM_PAGE_THREAD_USAGE_CPUS)
+		return;
+
+	if (commPagePtr32)
+		commpage_update_thread_usage_one(commPagePtr32, cpu, thread_id,
+			c_switch, runtime, timestamp);
+	if (commPagePtr64)
+		commpage_update_thread_usage_one(commPagePtr64, cpu, thread_id,
+			c_switch, runtime, timestamp);
+}
+
 
 extern user32_addr_t commpage_text32_location;
 extern user64_addr_t commpage_text64_location;
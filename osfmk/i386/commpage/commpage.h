@@ -157,6 +157,7 @@ extern  void	commpage_update_mach_continuous_time(uint64_t sleeptime);
 extern  void	commpage_update_boottime(uint64_t boottime_usec);
 extern	void	commpage_update_kdebug_state(void);
 extern	void	commpage_update_atm_diagnostic_config(uint32_t);
+extern	void	commpage_update_thread_usage(int cpu, uint64_t thread_id, uint32_t c_switch, uint64_t runtime, uint64_t timestamp);
 
 extern	uint32_t	commpage_is_in_pfz32(uint32_t);
 extern	uint32_t	commpage_is_in_pfz64(addr64_t);
@@ -220,6 +220,10 @@ int _NumCPUs( void )
 #define _COMM_PAGE_BOOTTIME_USEC	(_COMM_PAGE_START_ADDRESS+0x0C8)	/* uint64_t boottime */
 #define _COMM_PAGE_NEWTIMEOFDAY_DATA	(_COMM_PAGE_START_ADDRESS+0x0D0) 	/* used by gettimeofday(). Currently, sizeof(new_commpage_timeofday_data_t) = 40 */
 
+/* Align following entries to next cache line */
+#define _COMM_PAGE_THREAD_USAGE		(_COMM_PAGE_START_ADDRESS+0x100)	/* commpage_thread_usage_t[_COMM_PAGE_THREAD_USAGE_CPUS], indexed by cpu number */
+#define _COMM_PAGE_THREAD_USAGE_CPUS	64					/* [0x100,0x900) */
+
 #define _COMM_PAGE_END			(_COMM_PAGE_START_ADDRESS+0xfff)	/* end of common page */
 
 /* Warning: kernel commpage.h has a matching c typedef for the following.  They must be kept in sync.  */
@@ -137,8 +137,10 @@ typedef struct {
  */
 typedef struct {
 	pcid_t			cpu_pcid_free_hint;
+	pcid_t			cpu_pcid_next;		/* next tag to recycle */
+	uint64_t		cpu_pcid_allocations;	/* tags assigned to an address space */
+	uint64_t		cpu_pcid_recycles;	/* ... taken from a live address space */
 #define	PMAP_PCID_MAX_PCID      (0x800)
-	pcid_ref_t		cpu_pcid_refcounts[PMAP_PCID_MAX_PCID];
 	pmap_t			cpu_pcid_last_pmap_dispatched[PMAP_PCID_MAX_PCID];
 } pcid_cdata_t;
 
@@ -3303,14 +3303,17 @@ lck_mtx_lock_spinwait_x86(
 	uint64_t	overall_deadline;
 	uint64_t	check_owner_deadline;
 	uint64_t	cur_time;
+	uint64_t	start_time;
+	uint64_t	spin_window;
 	lck_mtx_spinwait_ret_type_t		retval = LCK_MTX_SPINWAIT_SPUN;
 	int		loopcount = 0;
 
 	KERNEL_DEBUG(MACHDBG_CODE(DBG_MACH_LOCKS, LCK_MTX_LCK_SPIN_CODE) | DBG_FUNC_START,
 		     trace_lck, VM_KERNEL_UNSLIDE_OR_PERM(mutex->lck_mtx_owner), mutex->lck_mtx_waiters, 0, 0);
 
-	cur_time = mach_absolute_time();
-	overall_deadline = cur_time + MutexSpin;
+	start_time = cur_time = mach_absolute_time();
+	spin_window = lck_mtx_spin_window();
+	overall_deadline = cur_time + spin_window;
 	check_owner_deadline = cur_time;
 
 	/*
@@ -3319,7 +3322,7 @@ lck_mtx_lock_spinwait_x86(
 	 *   - its locked as a spin lock, and
 	 *   - owner is running on another processor, and
 	 *   - owner (processor) is not idling, and
-	 *   - we haven't spun for long enough.
+	 *   - we haven't spun for longer than the adaptive window.
 	 */
 	do {
 		if (__probable(lck_mtx_lock_grab_mutex(mutex))) {
@@ -3362,7 +3365,7 @@ lck_mtx_lock_spinwait_x86(
 				}
 				lck_mtx_interlock_unlock_enable_interrupts(mutex, istate);
 
-				check_owner_deadline = cur_time + (MutexSpin / 4);
+				check_owner_deadline = cur_time + (spin_window / 4);
 			}
 		}
 		cpu_pause();
@@ -3371,11 +3374,12 @@ lck_mtx_lock_spinwait_x86(
 
 	} while (TRUE);
 
+	if (retval != LCK_MTX_SPINWAIT_NO_SPIN)
+		lck_mtx_spin_update(mach_absolute_time() - start_time);
+
 #if	CONFIG_DTRACE
 	/*
-	 * We've already kept a count via overall_deadline of how long we spun.
-	 * If dtrace is active, then we compute backwards to decide how
-	 * long we spun.
+	 * We've already kept a count via start_time of how long we spun.
 	 *
 	 * Note that we record a different probe id depending on whether
 	 * this is a direct or indirect mutex.  This allows us to 
@@ -3384,10 +3388,10 @@ lck_mtx_lock_spinwait_x86(
 	 */
 	if (__probable(mutex->lck_mtx_is_ext == 0)) {
 		LOCKSTAT_RECORD(LS_LCK_MTX_LOCK_SPIN, mutex,
-			mach_absolute_time() - (overall_deadline - MutexSpin));
+			mach_absolute_time() - start_time);
 	} else {
 		LOCKSTAT_RECORD(LS_LCK_MTX_EXT_LOCK_SPIN, mutex,
-			mach_absolute_time() - (overall_deadline - MutexSpin));
+			mach_absolute_time() - start_time);
 	}
 	/* The lockstat acquire event is recorded by the assembly code beneath us. */
 #endif
@@ -3438,6 +3442,7 @@ lck_mtx_lock_wait_x86 (
 		sleep_start = mach_absolute_time();
 	}
 #endif
+	uint64_t contention_start = lck_mtx_contention_begin();
 	thread_t self = current_thread();
 	assert(self->waiting_for_mutex == NULL);
 
@@ -3520,6 +3525,11 @@ lck_mtx_lock_wait_x86 (
 	             trace_lck, VM_KERNEL_UNSLIDE_OR_PERM(mutex->lck_mtx_owner),
 	             mutex->lck_mtx_waiters, mutex->lck_mtx_pri, 0);
 
+	if (contention_start) {
+		lck_mtx_contention_end(mutex, mutex->lck_mtx_is_ext ?
+		    ((lck_mtx_ext_t *)mutex)->lck_mtx_grp : LCK_GRP_NULL, contention_start);
+	}
+
 #if	CONFIG_DTRACE
 	/*
 	 * Record the Dtrace lockstat probe for blocking, block time
@@ -38,10 +38,10 @@ void	pmap_destroy_pcid_sync(pmap_t);
 void	pmap_pcid_lazy_flush(pmap_t);
 void	pmap_pcid_activate(pmap_t, int, boolean_t, boolean_t);
 pcid_t	pcid_for_pmap_cpu_tuple(pmap_t, thread_t, int);
+void	pmap_pcid_stats(uint64_t *, uint64_t *, uint64_t *);
 
 #define PMAP_INVALID ((pmap_t)0xDEAD7347)
 #define PMAP_PCID_INVALID_PCID	(0xDEAD)
-#define	PMAP_PCID_MAX_REFCOUNT (0xF0)
 #define	PMAP_PCID_MIN_PCID (1)
 
 extern uint32_t pmap_pcid_ncpus;
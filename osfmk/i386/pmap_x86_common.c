@@ -54,8 +54,24 @@ void		pmap_reusable_range(
 			pt_entry_t	*epte,
 			boolean_t	reusable);
 
+static void	pmap_remove_range_internal(
+			pmap_t		pmap,
+			vm_map_offset_t	va,
+			pt_entry_t	*spte,
+			pt_entry_t	*epte,
+			int		options,
+			boolean_t	flushed);
+
 uint32_t pmap_update_clear_pte_count;
 
+/*
+ * pmap_remove_options() invalidates all the PTEs it removes between two
+ * preemption points and then shoots them down with a single TLB flush,
+ * instead of one flush (and one round of IPIs) per page table page.
+ */
+uint64_t pmap_remove_flushes = 0;		/* TLB flushes issued by pmap_remove */
+uint64_t pmap_remove_flushes_coalesced = 0;	/* per page table page flushes saved */
+
 /*
  * The Intel platform can nest at the PDE level, so NBPDE (i.e. 2MB) at a time,
  * on a NBPDE boundary.
@@ -1151,6 +1167,25 @@ pmap_remove_range_options(
 	pt_entry_t		*spte,
 	pt_entry_t		*epte,
 	int			options)
+{
+	pmap_remove_range_internal(pmap, start_vaddr, spte, epte,
+				   options, FALSE);
+}
+
+/*
+ *	If "flushed" is TRUE, the caller already invalidated the valid
+ *	PTEs in the range and flushed them from all TLBs, with the pmap
+ *	locked throughout; the invalidation pass below then finds nothing
+ *	left to shoot down.
+ */
+static void
+pmap_remove_range_internal(
+	pmap_t			pmap,
+	vm_map_offset_t		start_vaddr,
+	pt_entry_t		*spte,
+	pt_entry_t		*epte,
+	int			options,
+	boolean_t		flushed)
 {
 	pt_entry_t		*cpte;
 	pv_hashed_entry_t       pvh_et = PV_HASHED_ENTRY_NULL;
@@ -1234,7 +1269,8 @@ pmap_remove_range_options(
 
 	/* propagate the invalidates to other CPUs */
 
-	PMAP_UPDATE_TLBS(pmap, start_vaddr, vaddr);
+	if (!flushed)
+		PMAP_UPDATE_TLBS(pmap, start_vaddr, vaddr);
 
 	for (cpte = spte, vaddr = start_vaddr;
 	     cpte < epte;
@@ -1436,6 +1472,49 @@ pmap_remove(
 	pmap_remove_options(map, s64, e64, PMAP_OPTIONS_REMOVE);
 }
 
+/*
+ *	Find the PTEs mapping [s64, l64), a range within a single page
+ *	table page, or the PDE itself if it maps a superpage.  Returns
+ *	PMAP_CHUNK_NONE if nothing is mapped there.  The pmap must be
+ *	locked.
+ */
+#define PMAP_CHUNK_NONE		0
+#define PMAP_CHUNK_PTES		1
+#define PMAP_CHUNK_SUPERPAGE	2
+
+static int
+pmap_remove_chunk(
+	pmap_t		map,
+	addr64_t	s64,
+	addr64_t	l64,
+	pt_entry_t	**spte,
+	pt_entry_t	**epte)
+{
+	pt_entry_t	*pde;
+
+	pde = pmap_pde(map, s64);
+
+	if (pde == NULL || (*pde & PTE_VALID_MASK(is_ept_pmap(map))) == 0)
+		return PMAP_CHUNK_NONE;
+
+	if (*pde & PTE_PS) {
+		/*
+		 * If we're removing a superpage, pmap_remove_range()
+		 * must work on level 2 instead of level 1; and we're
+		 * only passing a single level 2 entry instead of a
+		 * level 1 range.
+		 */
+		*spte = pde;
+		*epte = pde + 1; /* excluded */
+		return PMAP_CHUNK_SUPERPAGE;
+	}
+	*spte = pmap_pte(map, (s64 & ~(pde_mapped_size - 1)));
+	*spte = &(*spte)[ptenum(s64)];
+	*epte = &(*spte)[intel_btop(l64 - s64)];
+
+	return PMAP_CHUNK_PTES;
+}
+
 void
 pmap_remove_options(
 	pmap_t		map,
@@ -1443,10 +1522,12 @@ pmap_remove_options(
 	addr64_t	e64,
 	int		options)
 {
-	pt_entry_t     *pde;
 	pt_entry_t     *spte, *epte;
-	addr64_t        l64;
-	uint64_t        deadline;
+	addr64_t        l64, c64, batch_s64;
+	uint64_t        deadline, batch_deadline;
+	unsigned int	batch_chunks;
+	boolean_t	batch_found;
+	int		chunk;
 	boolean_t	is_ept;
 
 	pmap_intr_assert();
@@ -1497,30 +1578,55 @@ pmap_remove_options(
 	deadline = rdtsc64() + max_preemption_latency_tsc;
 
 	while (s64 < e64) {
-		l64 = (s64 + pde_mapped_size) & ~(pde_mapped_size - 1);
-		if (l64 > e64)
-			l64 = e64;
-		pde = pmap_pde(map, s64);
+		/*
+		 * Invalidate the PTEs of as many page table pages as fit
+		 * in half the preemption latency budget, shoot them all
+		 * down at once, then do the actual removal.
+		 */
+		batch_s64 = s64;
+		batch_deadline = rdtsc64() + (max_preemption_latency_tsc / 2);
+		batch_chunks = 0;
+		batch_found = FALSE;
 
-		if (pde && (*pde & PTE_VALID_MASK(is_ept))) {
-			if (*pde & PTE_PS) {
-				/*
-				 * If we're removing a superpage, pmap_remove_range()
-				 * must work on level 2 instead of level 1; and we're
-				 * only passing a single level 2 entry instead of a
-				 * level 1 range.
-				 */
-				spte = pde;
-				epte = spte+1; /* excluded */
-			} else {
-				spte = pmap_pte(map, (s64 & ~(pde_mapped_size - 1)));
-				spte = &spte[ptenum(s64)];
-				epte = &spte[intel_btop(l64 - s64)];
+		do {
+			l64 = (s64 + pde_mapped_size) & ~(pde_mapped_size - 1);
+			if (l64 > e64)
+				l64 = e64;
+			/*
+			 * superpages are left to pmap_remove_range(),
+			 * which finds their PDE through the valid bit
+			 */
+			if (pmap_remove_chunk(map, s64, l64, &spte, &epte) == PMAP_CHUNK_PTES) {
+				for (; spte < epte; spte++) {
+					if (pte_to_pa(*spte) != 0 &&
+					    (*spte & PTE_VALID_MASK(is_ept))) {
+						pmap_update_pte(spte, PTE_VALID_MASK(is_ept), 0);
+						batch_found = TRUE;
+					}
+				}
+				batch_chunks++;
+			}
+			s64 = l64;
+		} while (s64 < e64 && rdtsc64() < batch_deadline);
+
+		if (batch_found) {
+			PMAP_UPDATE_TLBS(map, batch_s64, s64);
+
+			pmap_remove_flushes++;
+			if (batch_chunks > 1)
+				pmap_remove_flushes_coalesced += batch_chunks - 1;
+		}
+
+		for (l64 = batch_s64; l64 < s64; l64 = c64) {
+			c64 = (l64 + pde_mapped_size) & ~(pde_mapped_size - 1);
+			if (c64 > s64)
+				c64 = s64;
+			chunk = pmap_remove_chunk(map, l64, c64, &spte, &epte);
+			if (chunk != PMAP_CHUNK_NONE) {
+				pmap_remove_range_internal(map, l64, spte, epte,
+							   options, chunk == PMAP_CHUNK_PTES);
 			}
-			pmap_remove_range_options(map, s64, spte, epte,
-						  options);
 		}
-		s64 = l64;
 
 		if (s64 < e64 && rdtsc64() >= deadline) {
 			PMAP_UNLOCK(map)
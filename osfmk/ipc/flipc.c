@@ -417,15 +417,17 @@ flipc_node_retire(mach_node_t node)
 
 /*  The node layer calls flipc_msg_to_remote_node() to fetch the next message
  *  for <node>.  This function will block until a message is available or the
- *  node is terminated, in which case it returns MNL_MSG_NULL.
+ *  node is terminated, in which case it returns MNL_MSG_NULL.  If <flags>
+ *  has FLIPC_MSG_NOWAIT, MNL_MSG_NULL is returned instead of blocking.
  */
 mnl_msg_t
 flipc_msg_to_remote_node(mach_node_t  to_node,
-                         uint32_t     flags __unused)
+                         uint32_t     flags)
 {
     mach_port_seqno_t msgoff;
     ipc_kmsg_t kmsg = IKM_NULL;
     mnl_msg_t fmsg = MNL_MSG_NULL;
+    mach_msg_option_t option = MACH_PEEK_MSG;
 
     assert(to_node != localnode);
     assert(get_preemption_level()==0);
@@ -433,12 +435,18 @@ flipc_msg_to_remote_node(mach_node_t  to_node,
     ipc_mqueue_t portset_mq = &to_node->proxy_port_set->ips_messages;
     ipc_mqueue_t port_mq = IMQ_NULL;
 
+    if (flags & FLIPC_MSG_NOWAIT)
+        option |= MACH_RCV_TIMEOUT;
+
     while (!to_node->dead) {
         /* Fetch next message from proxy port */
-        ipc_mqueue_receive(portset_mq, MACH_PEEK_MSG, 0, 0, THREAD_ABORTSAFE);
+        ipc_mqueue_receive(portset_mq, option, 0, 0, THREAD_ABORTSAFE);
 
         thread_t thread = current_thread();
-        if (thread->ith_state == MACH_PEEK_READY) {
+        if ((flags & FLIPC_MSG_NOWAIT) &&
+            thread->ith_state == MACH_RCV_TIMED_OUT) {
+            return MNL_MSG_NULL;
+        } else if (thread->ith_state == MACH_PEEK_READY) {
             port_mq = thread->ith_peekq;
             thread->ith_peekq = IMQ_NULL;
         } else {
@@ -493,10 +501,10 @@ flipc_msg_to_remote_node(mach_node_t  to_node,
             *(ipc_kmsg_t*)((vm_offset_t)fmsg-sizeof(vm_offset_t)) = kmsg;
         }
 
-        if (MNL_MSG_VALID(fmsg))
+        if (MNL_MSG_VALID(fmsg) || (flags & FLIPC_MSG_NOWAIT))
             break;
     }
-    assert(MNL_MSG_VALID(fmsg));
+    assert(MNL_MSG_VALID(fmsg) || (flags & FLIPC_MSG_NOWAIT));
     return fmsg;
 }
 
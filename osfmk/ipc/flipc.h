@@ -123,11 +123,14 @@ typedef struct flipc_ack_msg {
 
 /*  The node layer calls flipc_msg_to_remote_node() to fetch the next message
  *  for <to_node>.  This function will block until a message is available or the
- *  node is terminated, in which case it returns MNL_MSG_NULL.
+ *  node is terminated, in which case it returns MNL_MSG_NULL.  If <flags> has
+ *  FLIPC_MSG_NOWAIT, MNL_MSG_NULL is also returned when no message is queued.
  */
 mnl_msg_t flipc_msg_to_remote_node(mach_node_t  to_node,
                                    uint32_t     flags);
 
+#define FLIPC_MSG_NOWAIT        (0x1UL) // Don't block if no message is queued
+
 /*  The node layer calls flipc_msg_to_remote_node() to post the next message
  *  from <from_node>.  This function will block until a message is available
  *  or the node is terminated, in which case it returns MNL_MSG_NULL.
@@ -717,6 +717,7 @@ ipc_entry_grow_table(
 		space->is_low_mod = osize;
 		hi_mod = space->is_high_mod;
 		space->is_high_mod = 0;
+		space->is_grow_rescans += hi_mod - low_mod + 1;
 		is_write_unlock(space);
 #if IPC_ENTRY_GROW_STATS
 		rescan_count++;
@@ -745,6 +746,7 @@ ipc_entry_grow_table(
 	space->is_table_size = size;
 	space->is_table_next = nits;
 	space->is_table_free += size - osize;
+	space->is_grow_count++;
 
 	is_done_growing(space);
 	is_write_unlock(space);
@@ -41,6 +41,7 @@
 #include <kern/queue.h>
 #include <kern/task.h>
 #include <kern/policy_internal.h>
+#include <machine/atomic.h>
 
 #include <sys/kdebug.h>
 
@@ -73,15 +74,43 @@ static boolean_t ipc_importance_delayed_drop_call_requested = FALSE;
 
 static lck_spin_t ipc_importance_lock_data;	/* single lock for now */
 
+/*
+ * Acquisitions of the importance lock, and how many of them had to wait.
+ * Only updated with the lock held (kern.ipc_importance_lock_*).
+ */
+uint64_t ipc_importance_lock_count;
+uint64_t ipc_importance_lock_contended;
+
+/* receive vouchers that were the sent voucher rather than a new one */
+uint64_t ipc_importance_voucher_reused;
+
+static inline void
+ipc_importance_lock_counted(void)
+{
+	if (!lck_spin_try_lock(&ipc_importance_lock_data)) {
+		lck_spin_lock(&ipc_importance_lock_data);
+		ipc_importance_lock_contended++;
+	}
+	ipc_importance_lock_count++;
+}
+
+static inline boolean_t
+ipc_importance_lock_try_counted(void)
+{
+	if (!lck_spin_try_lock(&ipc_importance_lock_data))
+		return FALSE;
+	ipc_importance_lock_count++;
+	return TRUE;
+}
 
 #define ipc_importance_lock_init() \
 	lck_spin_init(&ipc_importance_lock_data, &ipc_lck_grp, &ipc_lck_attr)
 #define ipc_importance_lock_destroy() \
 	lck_spin_destroy(&ipc_importance_lock_data, &ipc_lck_grp)
 #define	ipc_importance_lock() \
-	lck_spin_lock(&ipc_importance_lock_data)
+	ipc_importance_lock_counted()
 #define	ipc_importance_lock_try() \
-	lck_spin_try_lock(&ipc_importance_lock_data)
+	ipc_importance_lock_try_counted()
 #define	ipc_importance_unlock() \
 	lck_spin_unlock(&ipc_importance_lock_data)
 #define ipc_importance_assert_held() \
@@ -3170,6 +3199,26 @@ ipc_importance_receive(
 
 		assert(IIE_NULL == kmsg->ikm_importance);
 
+		/*
+		 * Without an inherit object, a sent voucher that carries no
+		 * importance is already the voucher we would create: keep it
+		 * rather than going through the recipe lookup and hashing.
+		 */
+		if (III_NULL == inherit && IP_VALID(kmsg->ikm_voucher)) {
+			mach_voucher_attr_value_handle_t vals[MACH_VOUCHER_ATTR_VALUE_MAX_NESTED];
+			mach_voucher_attr_value_handle_array_size_t val_count;
+			ipc_voucher_t sent_voucher = (ipc_voucher_t)kmsg->ikm_voucher->ip_kobject;
+
+			val_count = MACH_VOUCHER_ATTR_VALUE_MAX_NESTED;
+			kr = mach_voucher_attr_control_get_values(ipc_importance_control,
+								  sent_voucher, vals, &val_count);
+			if (KERN_SUCCESS == kr && 0 == val_count) {
+				kmsg->ikm_header->msgh_bits |= (MACH_MSG_TYPE_MOVE_SEND << 16);
+				os_atomic_inc(&ipc_importance_voucher_reused, relaxed);
+				goto out;
+			}
+		}
+
 		/*
 		 * Only create a new voucher if we have an inherit object
 		 * (from the ikm_importance field of the incoming message), OR
@@ -3238,6 +3287,7 @@ ipc_importance_receive(
 		}
 	}
 
+out:
 #if IMPORTANCE_TRACE
 	if (-1 < impresult)
 		KERNEL_DEBUG_CONSTANT_IST(KDEBUG_TRACE, (IMPORTANCE_CODE(IMP_MSG, IMP_MSG_DELV)) | DBG_FUNC_NONE,
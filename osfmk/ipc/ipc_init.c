@@ -142,7 +142,11 @@ static lck_grp_attr_t	ipc_lck_grp_attr;
 void
 ipc_bootstrap(void)
 {
+	static const char *ipc_kmsg_zone_names[IKM_ZONE_CLASSES] = {
+		"ipc kmsgs", "ipc kmsgs.1024", "ipc kmsgs.4096",
+	};
 	kern_return_t kr;
+	unsigned int i;
 	
 	lck_grp_attr_setdefault(&ipc_lck_grp_attr);
 	lck_grp_init(&ipc_lck_grp, "ipc", &ipc_lck_grp_attr);
@@ -190,6 +194,21 @@ ipc_bootstrap(void)
 			      "ipc kmsgs");
 	zone_change(ipc_kmsg_zone, Z_CALLERACCT, FALSE);
 	zone_change(ipc_kmsg_zone, Z_CACHING_ENABLED, TRUE);
+	ipc_kmsg_zones[0] = ipc_kmsg_zone;
+
+	/*
+	 * And the zones for the larger kmsg size classes, also cached
+	 * per-processor.  These see less traffic, so only budget for
+	 * one queued message per port.
+	 */
+	for (i = 1; i < IKM_ZONE_CLASSES; i++) {
+		vm_size_t size = ipc_kmsg_zone_sizes[i];
+
+		ipc_kmsg_zones[i] = zinit(size, ipc_port_max * size, size,
+					  ipc_kmsg_zone_names[i]);
+		zone_change(ipc_kmsg_zones[i], Z_CALLERACCT, FALSE);
+		zone_change(ipc_kmsg_zones[i], Z_CACHING_ENABLED, TRUE);
+	}
 
 	/* create special spaces */
 
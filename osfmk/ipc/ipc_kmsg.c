@@ -510,6 +510,19 @@ extern vm_size_t	msg_ool_size_small;
 
 #define MSG_OOL_SIZE_SMALL	msg_ool_size_small
 
+/*
+ * Out-of-line memory transfer strategies, see ipc_kmsg_copyin_ool_descriptor().
+ *
+ * Regions that are deallocated by the sender and cover whole pages are
+ * moved into the copy object (the source entries are stolen) rather than
+ * copied into a kernel buffer, whatever their size.  ipc_ool_steal can
+ * be cleared to fall back to the size-only policy.
+ */
+int		ipc_ool_steal = 1;
+uint64_t	ipc_ool_physical_count;		/* copied into kernel buffers */
+uint64_t	ipc_ool_cow_count;		/* virtually copied (copy-on-write) */
+uint64_t	ipc_ool_steal_count;		/* source pages moved, not copied */
+
 #if defined(__LP64__)
 #define MAP_SIZE_DIFFERS(map)	(map->max_offset < MACH_VM_MAX_ADDRESS)
 #define OTHER_OOL_DESCRIPTOR	mach_msg_ool_descriptor32_t
@@ -831,6 +844,14 @@ void ipc_kmsg_trace_send(ipc_kmsg_t kmsg,
 /* zone for cached ipc_kmsg_t structures */
 zone_t			ipc_kmsg_zone;
 
+/* cached zones for each kmsg size class, smallest first */
+zone_t			ipc_kmsg_zones[IKM_ZONE_CLASSES];
+const mach_msg_size_t	ipc_kmsg_zone_sizes[IKM_ZONE_CLASSES] = {
+	IKM_SAVED_KMSG_SIZE,
+	1024,
+	4096,
+};
+
 /*
  * Forward declarations
  */
@@ -878,6 +899,7 @@ ipc_kmsg_alloc(
 {
 	mach_msg_size_t max_expanded_size;
 	ipc_kmsg_t kmsg;
+	unsigned int i;
 
 	/*
 	 * LP64support -
@@ -911,11 +933,19 @@ ipc_kmsg_alloc(
 	} else
 	  max_expanded_size = msg_and_trailer_size;
 
-	if (max_expanded_size < IKM_SAVED_MSG_SIZE)
-		max_expanded_size = IKM_SAVED_MSG_SIZE; 	/* round up for ikm_cache */
+	/*
+	 * Round up to the smallest size class that fits, so that the
+	 * buffer comes out of that class' per-processor zone cache.
+	 */
+	for (i = 0; i < IKM_ZONE_CLASSES; i++) {
+		if (max_expanded_size <= ikm_less_overhead(ipc_kmsg_zone_sizes[i])) {
+			max_expanded_size = ikm_less_overhead(ipc_kmsg_zone_sizes[i]);
+			break;
+		}
+	}
 
-	if (max_expanded_size == IKM_SAVED_MSG_SIZE) {
-		kmsg = (ipc_kmsg_t)zalloc(ipc_kmsg_zone);
+	if (i < IKM_ZONE_CLASSES) {
+		kmsg = (ipc_kmsg_t)zalloc(ipc_kmsg_zones[i]);
 	} else {
 		kmsg = (ipc_kmsg_t)kalloc(ikm_plus_overhead(max_expanded_size));
 	}
@@ -946,6 +976,7 @@ ipc_kmsg_free(
 {
 	mach_msg_size_t size = kmsg->ikm_size;
 	ipc_port_t port;
+	unsigned int i;
 
 	assert(!IP_VALID(kmsg->ikm_voucher));
 
@@ -972,9 +1003,11 @@ ipc_kmsg_free(
 		ip_release(port); /* May be last reference */
 	}
 
-	if (kmsg->ikm_size == IKM_SAVED_MSG_SIZE) {
-		zfree(ipc_kmsg_zone, kmsg);
-		return;
+	for (i = 0; i < IKM_ZONE_CLASSES; i++) {
+		if (size == ikm_less_overhead(ipc_kmsg_zone_sizes[i])) {
+			zfree(ipc_kmsg_zones[i], kmsg);
+			return;
+		}
 	}
 	kfree(kmsg, ikm_plus_overhead(size));
 }
@@ -2729,6 +2762,7 @@ ipc_kmsg_copyin_ool_descriptor(
         dsc->address = NULL;
     } else if ((length >= MSG_OOL_SIZE_SMALL) &&
             (copy_options == MACH_MSG_PHYSICAL_COPY) && !dealloc) {
+        OSIncrementAtomic64((volatile SInt64 *)&ipc_ool_physical_count);
 
         /*
          * If the request is a physical copy and the source
@@ -2763,17 +2797,34 @@ ipc_kmsg_copyin_ool_descriptor(
         *paddr += round_page(length);
         *space_needed -= round_page(length);
     } else {
+        int flags = dealloc ? VM_MAP_COPYIN_SRC_DESTROY : 0;
+        kern_return_t kr;
 
         /*
          * Make a vm_map_copy_t of the of the data.  If the
          * data is small, this will do an optimized physical
          * copy.  Otherwise, it will do a virtual copy.
          *
+         * If the sender gives up whole pages, always take the
+         * virtual path: the entries are moved over without
+         * copying the data or setting up copy-on-write faults
+         * for a mapping that is about to go away.
+         *
          * NOTE: A virtual copy is OK if the original is being
          * deallocted, even if a physical copy was requested.
          */
-        kern_return_t kr = vm_map_copyin(map, addr, 
-                (vm_map_size_t)length, dealloc, copy);
+        if (dealloc && ipc_ool_steal &&
+            page_aligned(addr) && page_aligned(length)) {
+            flags |= VM_MAP_COPYIN_ENTRY_LIST;
+            OSIncrementAtomic64((volatile SInt64 *)&ipc_ool_steal_count);
+        } else if (length < MSG_OOL_SIZE_SMALL) {
+            OSIncrementAtomic64((volatile SInt64 *)&ipc_ool_physical_count);
+        } else {
+            OSIncrementAtomic64((volatile SInt64 *)&ipc_ool_cow_count);
+        }
+
+        kr = vm_map_copyin_internal(map, addr,
+                (vm_map_size_t)length, flags, copy);
         if (kr != KERN_SUCCESS) {
             *mr = (kr == KERN_RESOURCE_SHORTAGE) ?
                 MACH_MSG_VM_KERNEL :
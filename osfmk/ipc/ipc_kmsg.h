@@ -138,6 +138,15 @@ extern zone_t ipc_kmsg_zone;
 #define	IKM_SAVED_KMSG_SIZE	256
 #define	IKM_SAVED_MSG_SIZE	ikm_less_overhead(IKM_SAVED_KMSG_SIZE)
 
+/*
+ *	Larger kernel message buffers are rounded up to one of a few size
+ *	classes, each backed by its own per-processor cached zone.  The
+ *	first class is ipc_kmsg_zone.  Sizes include overhead.
+ */
+#define	IKM_ZONE_CLASSES	3
+extern zone_t ipc_kmsg_zones[IKM_ZONE_CLASSES];
+extern const mach_msg_size_t ipc_kmsg_zone_sizes[IKM_ZONE_CLASSES];
+
 #define	ikm_prealloc_inuse_port(kmsg)					\
 	((kmsg)->ikm_prealloc)
 
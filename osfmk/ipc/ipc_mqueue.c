@@ -1075,9 +1075,11 @@ ipc_mqueue_receive_on_thread(
 			 * iteration logic to leave both the port_mq and the
 			 * set mqueue locked.
 			 *
-			 * TODO: previously, we would place this port at the
-			 *       back of the prepost list...
+			 * Place this port at the back of the prepost list so
+			 * that the other ports of the set get their turn.
 			 */
+			if (!(option & MACH_PEEK_MSG))
+				waitq_set_rotate_preposts(&mqueue->imq_set_queue);
 			imq_unlock(mqueue);
 
 			/*
@@ -269,6 +269,8 @@ ipc_space_create(
 	space->is_task = NULL;
 	space->is_low_mod = new_size;
 	space->is_high_mod = 0;
+	space->is_grow_count = 0;
+	space->is_grow_rescans = 0;
 	space->is_node_id = HOST_LOCAL_NODE; /* HOST_LOCAL_NODE, except proxy spaces */
 
 	*spacep = space;
@@ -308,6 +310,8 @@ ipc_space_create_special(
 	space->is_table_next = 0;
 	space->is_low_mod    = 0;
 	space->is_high_mod   = 0;
+	space->is_grow_count = 0;
+	space->is_grow_rescans = 0;
 	space->is_node_id = HOST_LOCAL_NODE; /* HOST_LOCAL_NODE, except proxy spaces */
 
 	*spacep = space;
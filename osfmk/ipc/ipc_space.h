@@ -122,6 +122,8 @@ struct ipc_space {
 	struct ipc_table_size *is_table_next; /* info for larger table */
 	ipc_entry_num_t is_low_mod;	/* lowest modified entry during growth */
 	ipc_entry_num_t is_high_mod;	/* highest modified entry during growth */
+	natural_t is_grow_count;	/* number of times the table grew */
+	natural_t is_grow_rescans;	/* entries copied again as they changed during growth */
 	struct bool_gen bool_gen;       /* state for boolean RNG */
 	unsigned int is_entropy[IS_ENTROPY_CNT]; /* pool of entropy taken from RNG */
 	int is_node_id;			/* HOST_LOCAL_NODE, or remote node if proxy space */
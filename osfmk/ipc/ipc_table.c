@@ -118,6 +118,35 @@ ipc_table_fill(
 	}
 }
 
+/*
+ * Growing a space copies its whole table, so with the fixed increments
+ * ipc_table_fill ends with, a space with many names has copied its table
+ * many times over by the time it is full.  Make every size at least half
+ * again as large as the previous one, which keeps the copying linear in
+ * the number of names, up to the largest size of the table, so that
+ * spaces can hold as many names as before.
+ */
+static void
+ipc_table_grow_geometric(
+	ipc_table_size_t	its,	     /* array to adjust */
+	unsigned int		num,	     /* size of array */
+	vm_size_t		elemsize)    /* size of elements */
+{
+	ipc_table_elems_t max = its[num - 1].its_size;
+	unsigned int index;
+	vm_size_t size;
+
+	for (index = 1; index < num; index++) {
+		size = (its[index - 1].its_size + its[index - 1].its_size / 2) * elemsize;
+		if (size >= PAGE_MAX_SIZE)
+			size = (size + PAGE_MAX_MASK) & ~((vm_size_t)PAGE_MAX_MASK);
+		if (size / elemsize > its[index].its_size)
+			its[index].its_size = (ipc_table_elems_t)(size / elemsize);
+		if (its[index].its_size > max)
+			its[index].its_size = max;
+	}
+}
+
 void
 ipc_table_init(void)
 {
@@ -128,6 +157,8 @@ ipc_table_init(void)
 
 	ipc_table_fill(ipc_table_entries, ipc_table_entries_size - 1,
 		       16, sizeof(struct ipc_entry));
+	ipc_table_grow_geometric(ipc_table_entries, ipc_table_entries_size - 1,
+		       sizeof(struct ipc_entry));
 
 	/* the last two elements should have the same size */
 
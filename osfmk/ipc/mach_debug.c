@@ -342,8 +342,8 @@ mach_port_space_basic_info(
 	infop->iisb_table_size = space->is_table_size;
 	infop->iisb_table_next = space->is_table_next->its_size;
 	infop->iisb_table_inuse = space->is_table_size - space->is_table_free - 1;
-	infop->iisb_reserved[0] = 0;
-	infop->iisb_reserved[1] = 0;
+	infop->iisb_grow_count = space->is_grow_count;
+	infop->iisb_grow_rescans = space->is_grow_rescans;
 
 	is_read_unlock(space);
 
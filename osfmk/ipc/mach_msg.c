@@ -489,6 +489,65 @@ mach_msg_receive_continue(void)
 }
 
 
+/*
+ *	Routine:	mach_msg_send_user
+ *	Purpose:
+ *		Copy in a message from the current task and send it.
+ *		On a send failure the message is copied back out.
+ *	Conditions:
+ *		Nothing locked.
+ *	Returns:
+ *		All of mach_msg_send error codes.
+ */
+
+static mach_msg_return_t
+mach_msg_send_user(
+	mach_vm_address_t	msg_addr,
+	mach_msg_size_t		send_size,
+	mach_msg_option_t	*optionp,
+	mach_msg_timeout_t	msg_timeout,
+	mach_msg_priority_t	override)
+{
+	ipc_space_t space = current_space();
+	vm_map_t map = current_map();
+	ipc_kmsg_t kmsg;
+	mach_msg_return_t mr;
+
+	KDBG(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_INFO) | DBG_FUNC_START);
+
+	mr = ipc_kmsg_get(msg_addr, send_size, &kmsg);
+
+	if (mr != MACH_MSG_SUCCESS) {
+		KDBG(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_INFO) | DBG_FUNC_END, mr);
+		return mr;
+	}
+
+	KERNEL_DEBUG_CONSTANT(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_LINK) | DBG_FUNC_NONE,
+			      (uintptr_t)msg_addr,
+			      VM_KERNEL_ADDRPERM((uintptr_t)kmsg),
+			      0, 0,
+			      0);
+
+	mr = ipc_kmsg_copyin(kmsg, space, map, override, optionp);
+
+	if (mr != MACH_MSG_SUCCESS) {
+		ipc_kmsg_free(kmsg);
+		KDBG(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_INFO) | DBG_FUNC_END, mr);
+		return mr;
+	}
+
+	mr = ipc_kmsg_send(kmsg, *optionp, msg_timeout);
+
+	if (mr != MACH_MSG_SUCCESS) {
+		mr |= ipc_kmsg_copyout_pseudo(kmsg, space, map, MACH_MSG_BODY_NULL);
+		(void) ipc_kmsg_put(kmsg, *optionp, msg_addr, send_size, 0, NULL);
+		KDBG(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_INFO) | DBG_FUNC_END, mr);
+		return mr;
+	}
+
+	return MACH_MSG_SUCCESS;
+}
+
 /*
  *	Routine:	mach_msg_overwrite_trap [mach trap]
  *	Purpose:
@@ -514,47 +573,15 @@ mach_msg_overwrite_trap(
 	__unused mach_port_seqno_t temp_seqno = 0;
 
 	mach_msg_return_t  mr = MACH_MSG_SUCCESS;
-	vm_map_t map = current_map();
 
 	/* Only accept options allowed by the user */
 	option &= MACH_MSG_OPTION_USER;
 
 	if (option & MACH_SEND_MSG) {
-		ipc_space_t space = current_space();
-		ipc_kmsg_t kmsg;
-
-		KDBG(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_INFO) | DBG_FUNC_START);
-
-		mr = ipc_kmsg_get(msg_addr, send_size, &kmsg);
-
-		if (mr != MACH_MSG_SUCCESS) {
-			KDBG(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_INFO) | DBG_FUNC_END, mr);
-			return mr;
-		}
-
-		KERNEL_DEBUG_CONSTANT(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_LINK) | DBG_FUNC_NONE,
-				      (uintptr_t)msg_addr,
-				      VM_KERNEL_ADDRPERM((uintptr_t)kmsg),
-				      0, 0,
-				      0);
-
-		mr = ipc_kmsg_copyin(kmsg, space, map, override, &option);
-
-		if (mr != MACH_MSG_SUCCESS) {
-			ipc_kmsg_free(kmsg);
-			KDBG(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_INFO) | DBG_FUNC_END, mr);
+		mr = mach_msg_send_user(msg_addr, send_size, &option,
+		    msg_timeout, override);
+		if (mr != MACH_MSG_SUCCESS)
 			return mr;
-		}
-
-		mr = ipc_kmsg_send(kmsg, option, msg_timeout);
-
-		if (mr != MACH_MSG_SUCCESS) {
-			mr |= ipc_kmsg_copyout_pseudo(kmsg, space, map, MACH_MSG_BODY_NULL);
-			(void) ipc_kmsg_put(kmsg, option, msg_addr, send_size, 0, NULL);
-			KDBG(MACHDBG_CODE(DBG_MACH_IPC,MACH_IPC_KMSG_INFO) | DBG_FUNC_END, mr);
-			return mr;
-		}
-
 	}
 
 	if (option & MACH_RCV_MSG) {
@@ -603,6 +630,68 @@ mach_msg_overwrite_trap(
 	return MACH_MSG_SUCCESS;
 }
 
+/*
+ *	Routine:	mach_msg_send_vector_trap [mach trap]
+ *	Purpose:
+ *		Send each message of an array of messages, all with the
+ *		same send options, timeout and override, saving the cost
+ *		of a trap per message for fan-out senders.  The messages
+ *		are sent in order; the result for each is stored in its
+ *		entry, and a failed send does not stop the ones after it.
+ *	Conditions:
+ *		Nothing locked.
+ *	Returns:
+ *		MACH_MSG_SUCCESS	Every entry was processed; see
+ *					msgv_return for per-message results.
+ *		MACH_SEND_INVALID_DATA	Bad count or options, or the array
+ *					could not be read or updated.
+ */
+
+#define	MACH_MSG_VECTOR_CHUNK	16
+
+mach_msg_return_t
+mach_msg_send_vector_trap(
+	struct mach_msg_send_vector_trap_args *args)
+{
+	mach_vm_address_t	vector_addr = args->vector;
+	mach_msg_size_t		count = args->count;
+	mach_msg_option_t	option = args->option;
+	mach_msg_timeout_t	msg_timeout = args->timeout;
+	mach_msg_priority_t	override = args->override;
+	mach_msg_vector_t	vec[MACH_MSG_VECTOR_CHUNK];
+	mach_msg_size_t		i, n;
+
+	/* Only accept options allowed by the user, and no receive */
+	option &= MACH_MSG_OPTION_USER;
+	if ((option & (MACH_SEND_MSG | MACH_RCV_MSG)) != MACH_SEND_MSG ||
+	    count > MACH_MSG_VECTOR_MAX)
+		return MACH_SEND_INVALID_DATA;
+
+	while (count > 0) {
+		n = MIN(count, MACH_MSG_VECTOR_CHUNK);
+
+		if (copyin(vector_addr, (char *)vec, n * sizeof (vec[0])))
+			return MACH_SEND_INVALID_DATA;
+
+		for (i = 0; i < n; i++) {
+			/* copyin may adjust the options for this message */
+			mach_msg_option_t msg_option = option;
+
+			vec[i].msgv_return = mach_msg_send_user(vec[i].msgv_msg,
+			    vec[i].msgv_send_size, &msg_option, msg_timeout,
+			    override);
+		}
+
+		if (copyout((char *)vec, vector_addr, n * sizeof (vec[0])))
+			return MACH_SEND_INVALID_DATA;
+
+		vector_addr += n * sizeof (vec[0]);
+		count -= n;
+	}
+
+	return MACH_MSG_SUCCESS;
+}
+
 /*
  *	Routine:	mach_msg_rcv_link_special_reply_port
  *	Purpose:
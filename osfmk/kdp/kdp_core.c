@@ -35,6 +35,7 @@
 #include <vm/vm_protos.h>
 #include <vm/vm_kern.h>
 #include <vm/vm_map.h>
+#include <vm/vm_page.h>
 #include <machine/cpu_capabilities.h>
 #include <libsa/types.h>
 #include <libkern/kernel_mach_header.h>
@@ -125,6 +126,13 @@ static z_stream	   kdp_core_zs;
 
 static uint64_t    kdp_core_total_size;
 static uint64_t    kdp_core_total_size_sent_uncomp;
+
+/*
+ * Pages sitting on a free queue hold nothing worth keeping; leave them out
+ * of the core unless the "kdp_core_free_pages" boot-arg asks for them.
+ */
+static boolean_t   kdp_core_elide_free = TRUE;
+static uint64_t    kdp_core_free_elided;
 #if CONFIG_EMBEDDED
 struct xnu_hw_shmem_dbg_command_info *hwsd_info = NULL;
 
@@ -684,6 +692,67 @@ extern struct vm_object pmap_object_store;
 #endif
 extern vm_offset_t c_buffers;
 extern vm_size_t   c_buffers_size;
+extern vm_page_t   vm_page_array_boundary;
+
+/*
+ * Find the vm_page of a physical page without taking any locks.  On arm the
+ * page array is indexed by physical page; on x86 it is mostly in ascending
+ * order, so follow the last hit and fall back to a binary search.  Anything
+ * that isn't found is simply kept in the core.
+ */
+static vm_page_t
+kdp_core_vm_page(ppnum_t ppn)
+{
+    vm_page_t m = VM_PAGE_NULL;
+#if defined(__arm__) || defined(__arm64__)
+    if (ppn >= vm_first_phys_ppnum)
+    {
+	m = &vm_pages[ppn - vm_first_phys_ppnum];
+    }
+#else
+    static vm_page_t hint = VM_PAGE_NULL;
+    vm_page_t        lo, hi;
+
+    if (hint != VM_PAGE_NULL)
+    {
+	m = hint + 1;
+	if ((m >= vm_page_array_boundary) || (VM_PAGE_GET_PHYS_PAGE(m) != ppn)) m = VM_PAGE_NULL;
+    }
+    for (lo = vm_pages, hi = vm_page_array_boundary; (m == VM_PAGE_NULL) && (lo < hi); )
+    {
+	vm_page_t mid = lo + (hi - lo) / 2;
+
+	if (VM_PAGE_GET_PHYS_PAGE(mid) == ppn)     m = mid;
+	else if (VM_PAGE_GET_PHYS_PAGE(mid) < ppn) lo = mid + 1;
+	else                                       hi = mid;
+    }
+    if (m != VM_PAGE_NULL) hint = m;
+#endif
+    if ((m == VM_PAGE_NULL) || (m >= vm_page_array_boundary) || (VM_PAGE_GET_PHYS_PAGE(m) != ppn)) return (VM_PAGE_NULL);
+
+    return (m);
+}
+
+static boolean_t
+kdp_core_page_is_free(ppnum_t ppn)
+{
+    vm_page_t m;
+
+    if (!kdp_core_elide_free) return (FALSE);
+
+    m = kdp_core_vm_page(ppn);
+    if (m == VM_PAGE_NULL) return (FALSE);
+
+    switch (m->vmp_q_state)
+    {
+	case VM_PAGE_ON_FREE_Q:
+	case VM_PAGE_ON_FREE_LOCAL_Q:
+	case VM_PAGE_ON_FREE_LOPAGE_Q:
+	    return (TRUE);
+	default:
+	    return (FALSE);
+    }
+}
 
 ppnum_t
 kernel_pmap_present_mapping(uint64_t vaddr, uint64_t * pvincr, uintptr_t * pvphysaddr)
@@ -833,6 +902,13 @@ pmap_traverse_present_mappings(pmap_t __unused pmap,
 		/* not something we want */
 		ppn = 0;
 	    }
+	    else if (((vcur < debug_start) || (vcur >= debug_end))
+		&& kdp_core_page_is_free(ppn))
+	    {
+		/* contents are stale */
+		kdp_core_free_elided++;
+		ppn = 0;
+	    }
 	}
 
 	if (ppn != 0) {
@@ -941,6 +1017,7 @@ kern_dump_save_summary(__unused void *refcon, core_save_summary_cb callback, voi
 	uint64_t thread_state_size = 0, thread_count = 0;
 	kern_return_t ret;
 
+	kdp_core_free_elided = 0;
 	ret = pmap_traverse_present_mappings(kernel_pmap,
 			VM_MIN_KERNEL_AND_KEXT_ADDRESS,
 			VM_MAX_KERNEL_ADDRESS,
@@ -950,6 +1027,10 @@ kern_dump_save_summary(__unused void *refcon, core_save_summary_cb callback, voi
 		kern_coredump_log(context, "save_summary: pmap traversal failed: %d\n", ret);
 		return ret;
 	}
+	if (kdp_core_free_elided) {
+		kern_coredump_log(context, "leaving out %llu free pages (%llu MB)\n",
+				kdp_core_free_elided, (kdp_core_free_elided * PAGE_SIZE_64) >> 20);
+	}
 
 	kern_collectth_state_size(&thread_count, &thread_state_size);
 
@@ -1450,6 +1531,7 @@ kdp_core_init(void)
 {
 	int wbits = 12;
 	int memlevel = 3;
+	int keep_free = 0;
 	kern_return_t kr;
 #if CONFIG_EMBEDDED
 	int i = 0;
@@ -1460,6 +1542,7 @@ kdp_core_init(void)
 	kern_coredump_callback_config core_config = { };
 
 	if (kdp_core_zs.zalloc) return;
+	if (PE_parse_boot_argn("kdp_core_free_pages", &keep_free, sizeof (keep_free)) && keep_free) kdp_core_elide_free = FALSE;
 	kdp_core_zsize = round_page(NETBUF + zlib_deflate_memory_size(wbits, memlevel));
 	printf("kdp_core zlib memory 0x%lx\n", kdp_core_zsize);
 	kr = kmem_alloc(kernel_map, &kdp_core_zmem, kdp_core_zsize, VM_KERN_MEMORY_DIAG);
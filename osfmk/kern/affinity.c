@@ -30,6 +30,7 @@
 #include <kern/task.h>
 #include <kern/kalloc.h>
 #include <machine/cpu_affinity.h>
+#include <libkern/OSAtomic.h>
 
 /*
  * Affinity involves 2 objects:
@@ -62,6 +63,8 @@ struct affinity_space {
 	lck_mtx_t		aspc_lock;
 	uint32_t		aspc_task_count;
 	queue_head_t	aspc_affinities;
+	uint64_t		aspc_pset_switches;	/* from retired sets */
+	uint64_t		aspc_pset_misses;	/* from retired sets */
 };
 typedef struct affinity_space *affinity_space_t;
 
@@ -264,7 +267,8 @@ task_affinity_deallocate(task_t	task)
 
 /*
  * task_affinity_info()
- * Return affinity tag info (number, min, max) for the task.
+ * Return affinity tag info (number, min, max) for the task, and how often
+ * threads in its affinity sets changed pset or ran off their set's pset.
  *
  * Conditions: task is locked.
  */
@@ -278,12 +282,17 @@ task_affinity_info(
 	affinity_space_t		aspc;
 	task_affinity_tag_info_t	info;
 
-	*task_info_count = TASK_AFFINITY_TAG_INFO_COUNT;
+	if (*task_info_count >= TASK_AFFINITY_TAG_INFO_REV1_COUNT)
+		*task_info_count = TASK_AFFINITY_TAG_INFO_REV1_COUNT;
+	else
+		*task_info_count = TASK_AFFINITY_TAG_INFO_REV0_COUNT;
 	info = (task_affinity_tag_info_t) task_info_out;
 	info->set_count = 0;
 	info->task_count = 0;
 	info->min = THREAD_AFFINITY_TAG_NULL;
 	info->max = THREAD_AFFINITY_TAG_NULL;
+	info->pset_switches = 0;
+	info->pset_misses = 0;
 
 	aspc = task->affinity_space;
 	if (aspc) {
@@ -297,8 +306,12 @@ task_affinity_info(
 			if (info->max == THREAD_AFFINITY_TAG_NULL ||
 			    aset->aset_tag > (uint32_t) info->max)
 				info->max = aset->aset_tag;
+			info->pset_switches += aset->aset_pset_switches;
+			info->pset_misses += aset->aset_pset_misses;
 		}
 		info->task_count = aspc->aspc_task_count;
+		info->pset_switches += aspc->aspc_pset_switches;
+		info->pset_misses += aspc->aspc_pset_misses;
 		lck_mtx_unlock(&aspc->aspc_lock);
 	}
 	return KERN_SUCCESS;
@@ -367,6 +380,26 @@ thread_affinity_exec(thread_t thread)
 		thread_affinity_terminate(thread);
 }
 
+/*
+ * thread_affinity_dispatch()
+ * Account for a thread in an affinity set being dispatched on a processor,
+ * before thread->last_processor is updated: count the runs that change pset
+ * and the runs away from the pset the set was placed on.
+ * Called with the thread locked.
+ */
+void
+thread_affinity_dispatch(thread_t thread, processor_t processor)
+{
+	affinity_set_t	aset = thread->affinity_set;
+	processor_t	last_processor = thread->last_processor;
+
+	if (last_processor != PROCESSOR_NULL &&
+	    last_processor->processor_set != processor->processor_set)
+		OSIncrementAtomic64((volatile SInt64 *) &aset->aset_pset_switches);
+	if (aset->aset_pset != processor->processor_set)
+		OSIncrementAtomic64((volatile SInt64 *) &aset->aset_pset_misses);
+}
+
 /*
  * Create an empty affinity namespace data structure.
  */
@@ -479,6 +512,9 @@ affinity_set_remove(affinity_set_t aset, thread_t thread)
 	if (queue_empty(&aset->aset_threads)) {
 		queue_remove(&aset->aset_space->aspc_affinities,
 				aset, affinity_set_t, aset_affinities);
+		/* keep the retired set's counts in the namespace totals */
+		aset->aset_space->aspc_pset_switches += aset->aset_pset_switches;
+		aset->aset_space->aspc_pset_misses += aset->aset_pset_misses;
 		assert(aset->aset_thread_count == 0);
 		aset->aset_tag = THREAD_AFFINITY_TAG_NULL;
 		aset->aset_num = 0;
@@ -566,6 +602,8 @@ affinity_set_place(affinity_space_t aspc, affinity_set_t new_aset)
 	}
 	new_aset->aset_num = i_least_occupied;
 	new_aset->aset_pset = ml_affinity_to_pset(i_least_occupied);
+	new_aset->aset_pset_switches = 0;
+	new_aset->aset_pset_misses = 0;
 
 	/* Add the new affinity set to the group */
 	new_aset->aset_space = aspc;
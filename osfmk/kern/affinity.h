@@ -51,11 +51,15 @@ struct affinity_set {
 	uint32_t	aset_tag;		/* user-assigned tag */
 	uint32_t	aset_num;		/* kernel-assigned affinity */
 	processor_set_t	aset_pset;		/* processor set */
+	uint64_t	aset_pset_switches;	/* member pset changes */
+	uint64_t	aset_pset_misses;	/* member runs off aset_pset */
 };
 
 extern boolean_t	thread_affinity_is_supported(void);
 extern void		thread_affinity_dup(thread_t parent, thread_t child);
 extern void		thread_affinity_terminate(thread_t thread);
+extern void		thread_affinity_dispatch(thread_t thread,
+					processor_t processor);
 extern void		task_affinity_create(
 					task_t,
 					task_t);
@@ -69,6 +69,7 @@
 #endif
 #include <kern/waitq.h>
 #include <kern/ledger.h>
+#include <kern/coalition.h>
 #include <kern/machine.h>
 #include <kperf/kperf_kpc.h>
 #include <mach/policy.h>
@@ -236,6 +237,11 @@ ast_taken_user(void)
 		kperf_kpc_thread_ast(thread);
 	}
 
+	if (reasons & AST_CPU_QUOTA) {
+		thread_ast_clear(thread, AST_CPU_QUOTA);
+		task_coalition_cpu_quota_throttle(thread);
+	}
+
 	if (reasons & AST_KEVENT) {
 		thread_ast_clear(thread, AST_KEVENT);
 		uint16_t bits = atomic_exchange(&thread->kevent_ast_bits, 0);
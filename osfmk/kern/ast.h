@@ -118,7 +118,8 @@ typedef uint32_t ast_t;
 #define AST_BSD			0x80
 #define AST_KPERF		0x100   /* kernel profiling */
 #define	AST_MACF		0x200	/* MACF user ret pending */
-/* 0x400, 0x800 unused */
+#define AST_CPU_QUOTA		0x400	/* coalition went over its CPU quota */
+/* 0x800 unused */
 #define AST_GUARD		0x1000
 #define AST_TELEMETRY_USER	0x2000	/* telemetry sample requested on interrupt from userspace */
 #define AST_TELEMETRY_KERNEL	0x4000	/* telemetry sample requested on interrupt from kernel */
@@ -140,7 +141,7 @@ typedef uint32_t ast_t;
 		AST_TELEMETRY_PMI | AST_TELEMETRY_IO)
 
 /* Per-thread ASTs follow the thread at context-switch time. */
-#define AST_PER_THREAD	(AST_APC | AST_BSD | AST_MACF | AST_LEDGER | AST_GUARD | AST_TELEMETRY_ALL | AST_KEVENT)
+#define AST_PER_THREAD	(AST_APC | AST_BSD | AST_MACF | AST_LEDGER | AST_GUARD | AST_TELEMETRY_ALL | AST_KEVENT | AST_CPU_QUOTA)
 
 /* Handle AST_URGENT detected while in the kernel */
 extern void ast_taken_kernel(void);
@@ -63,9 +63,23 @@
 #define ELEMENT_HASH_BUCKET_COUNT (256)
 #define BTLOG_HASHELEMINDEX_NONE BTLOG_RECORDINDEX_NONE
 
+/*
+ * Records are also hashed by bthash so that finding the record for a stack
+ * doesn't walk the whole active list. Both tables are sized to about a quarter
+ * of what they index, and never below ELEMENT_HASH_BUCKET_COUNT buckets.
+ */
+#define BTLOG_HASH_LOAD_FACTOR (4)
+
 #define ZELEMS_DEFAULT	(8000)
 size_t	zelems_count = 0;
 
+/*
+ * With btlog_sample=N only about one element in N is tracked. The choice is
+ * made on the element address, so every operation on a tracked element is
+ * logged and an untracked one never takes the lock.
+ */
+static uint32_t btlog_sample_factor = 0;
+
 typedef uint32_t btlog_recordindex_t; /* only 24 bits used */
 
 /*
@@ -85,6 +99,7 @@ typedef struct btlog_record {
     			operation:8;
     uint32_t		ref_count;
     uint32_t		bthash;
+    btlog_recordindex_t	hash_next; /* next record in the same bthash bucket */
     struct _element_record_queue	element_record_queue;
     void		*bt[]; /* variable sized, based on btlog_t params */
 } btlog_record_t;
@@ -115,14 +130,18 @@ struct btlog {
     btlog_recordindex_t tail;
     btlog_recordindex_t activerecord;
     btlog_recordindex_t	freelist_records;
+    btlog_recordindex_t	*record_hashtbl; /* records by bthash, chained through hash_next */
+    uint32_t		record_hash_mask;
 
     size_t              active_record_count;
     size_t          	active_element_count;
     btlog_element_t 	*freelist_elements;
     union {
-		btlog_element_t			**elem_recindex_hashtbl; /* LEAKS mode: We use an array of ELEMENT_HASH_BUCKET_COUNT buckets. */
+		btlog_element_t			**elem_recindex_hashtbl; /* LEAKS mode: We use an array of elem_hash_mask + 1 buckets. */
 		struct _element_hash_queue	*element_hash_queue; /* CORRUPTION mode: We use a single hash bucket i.e. queue */
     } elem_linkage_un;
+    uint32_t		elem_hash_mask; /* LEAKS mode: number of elem_recindex_hashtbl buckets - 1 */
+    uint32_t		sample_factor; /* track one element in this many, 0 or 1 for all of them */
 
     decl_simple_lock_data(,btlog_lock);
     boolean_t	caller_will_remove_entries_for_element; /* If TRUE, this means that the caller is interested in keeping track of abandoned / leaked elements.
@@ -154,9 +173,9 @@ lookup_btrecord_byhash(btlog_t *btlog, uint32_t md5_hash, void *bt[], size_t btc
 	assert(btcount);
 	assert(bt);
 
-	recindex = btlog->head;
-	record = lookup_btrecord(btlog, recindex);
+	recindex = btlog->record_hashtbl[md5_hash & btlog->record_hash_mask];
 	while (recindex != BTLOG_RECORDINDEX_NONE) {
+		record = lookup_btrecord(btlog, recindex);
 		assert(record->bthash);
 		assert(! TAILQ_EMPTY(&record->element_record_queue));
 		if (record->bthash == md5_hash) {
@@ -196,22 +215,60 @@ lookup_btrecord_byhash(btlog_t *btlog, uint32_t md5_hash, void *bt[], size_t btc
 			}
 		}
 next:
-		recindex = record->next;
-		record = lookup_btrecord(btlog, recindex);
+		recindex = record->hash_next;
 	}
 
 	return recindex;
 }
 
+/* Assumes btlog is already locked */
+static void
+btlog_record_hash_remove(btlog_t *btlog, btlog_recordindex_t recindex)
+{
+	btlog_record_t		*record = lookup_btrecord(btlog, recindex);
+	btlog_recordindex_t	*linkp = &btlog->record_hashtbl[record->bthash & btlog->record_hash_mask];
+
+	while (*linkp != BTLOG_RECORDINDEX_NONE) {
+		if (*linkp == recindex) {
+			*linkp = record->hash_next;
+			record->hash_next = BTLOG_RECORDINDEX_NONE;
+			return;
+		}
+		linkp = &lookup_btrecord(btlog, *linkp)->hash_next;
+	}
+
+	panic("BTLog: record %u missing from its hash bucket in btlog (0x%lx)\n", recindex, (uintptr_t) btlog);
+}
+
+static uint32_t
+btlog_hash_bucket_count(size_t entries)
+{
+	uint32_t count = ELEMENT_HASH_BUCKET_COUNT;
+
+	while (count < entries / BTLOG_HASH_LOAD_FACTOR && count < (BTLOG_MAX_RECORDS + 1) / 2) {
+		count <<= 1;
+	}
+	return count;
+}
+
+static boolean_t
+btlog_element_sampled(btlog_t *btlog, uintptr_t elem)
+{
+	if (btlog->sample_factor <= 1) {
+		return TRUE;
+	}
+	return ((((uint32_t)(elem >> 4) * 2654435761U) >> 16) % btlog->sample_factor) == 0;
+}
+
 uint32_t
 calculate_hashidx_for_element(uintptr_t elem, btlog_t *btlog)
 {
 	if (btlog->caller_will_remove_entries_for_element) {
 		uint32_t addr = 0;
 
-		addr = (uint32_t) ((elem & 0xFF00) >> 0x8);
+		addr = (uint32_t) ((elem >> 4) ^ (elem >> 12) ^ (elem >> 20));
 
-		return addr;
+		return addr & btlog->elem_hash_mask;
 	} else {
 		return 0;
 	}
@@ -235,7 +292,9 @@ btlog_create(size_t numrecords,
 {
 	btlog_t *btlog;
 	vm_size_t buffersize_needed = 0, elemsize_needed = 0;
-	vm_address_t buffer = 0, elem_buffer = 0, elem_hash_buffer = 0;
+	vm_address_t buffer = 0, elem_buffer = 0, elem_hash_buffer = 0, record_hash_buffer = 0;
+	vm_size_t elem_hash_size = 0, record_hash_size = 0;
+	uint32_t elem_buckets = 0, record_buckets = 0;
 	size_t i = 0;
 	kern_return_t ret;
 	size_t btrecord_size = 0;
@@ -270,6 +329,10 @@ btlog_create(size_t numrecords,
 			 */
 			printf("Set number of log elements per btlog to: %ld\n", zelems_count);
 		}
+
+		if (PE_parse_boot_argn("btlog_sample", &btlog_sample_factor, sizeof(btlog_sample_factor)) == TRUE) {
+			printf("Tracking one element in %u per btlog\n", btlog_sample_factor);
+		}
 	}
 	elemsize_needed = sizeof(btlog_element_t) * zelems_count;
 	elemsize_needed = round_page(elemsize_needed);
@@ -278,6 +341,15 @@ btlog_create(size_t numrecords,
 	numrecords = MIN(BTLOG_MAX_RECORDS,
 					 (buffersize_needed - sizeof(btlog_t))/btrecord_size);
 
+	if (caller_will_remove_entries_for_element == TRUE) {
+		elem_buckets = btlog_hash_bucket_count(zelems_count);
+		elem_hash_size = elem_buckets * sizeof(btlog_element_t*);
+	} else {
+		elem_hash_size = 2 * sizeof(btlog_element_t*);
+	}
+	record_buckets = btlog_hash_bucket_count(numrecords);
+	record_hash_size = record_buckets * sizeof(btlog_recordindex_t);
+
 	if (kmem_alloc_ready) {
 		ret = kmem_alloc(kernel_map, &buffer, buffersize_needed, VM_KERN_MEMORY_DIAG);
 		if (ret != KERN_SUCCESS)
@@ -290,29 +362,36 @@ btlog_create(size_t numrecords,
 			return NULL;
 		}
 
-		if (caller_will_remove_entries_for_element == TRUE) {
-			ret = kmem_alloc(kernel_map, &elem_hash_buffer, ELEMENT_HASH_BUCKET_COUNT * sizeof(btlog_element_t*), VM_KERN_MEMORY_DIAG);
-		} else {
-			ret = kmem_alloc(kernel_map, &elem_hash_buffer, 2 * sizeof(btlog_element_t*), VM_KERN_MEMORY_DIAG);
+		ret = kmem_alloc(kernel_map, &elem_hash_buffer, elem_hash_size, VM_KERN_MEMORY_DIAG);
+
+		if (ret != KERN_SUCCESS) {
+			kmem_free(kernel_map, buffer, buffersize_needed);
+			buffer = 0;
+
+			kmem_free(kernel_map, elem_buffer, elemsize_needed);
+			elem_buffer = 0;
+			return NULL;
 		}
 
+		ret = kmem_alloc(kernel_map, &record_hash_buffer, record_hash_size, VM_KERN_MEMORY_DIAG);
+
 		if (ret != KERN_SUCCESS) {
 			kmem_free(kernel_map, buffer, buffersize_needed);
 			buffer = 0;
 
 			kmem_free(kernel_map, elem_buffer, elemsize_needed);
 			elem_buffer = 0;
+
+			kmem_free(kernel_map, elem_hash_buffer, elem_hash_size);
+			elem_hash_buffer = 0;
 			return NULL;
 		}
 
 	} else {
 		buffer = (vm_address_t)pmap_steal_memory(buffersize_needed);
 		elem_buffer = (vm_address_t)pmap_steal_memory(elemsize_needed);
-		if (caller_will_remove_entries_for_element == TRUE) {
-			elem_hash_buffer = (vm_address_t)pmap_steal_memory(ELEMENT_HASH_BUCKET_COUNT * sizeof(btlog_element_t*));
-		} else {
-			elem_hash_buffer = (vm_address_t)pmap_steal_memory(2 * sizeof(btlog_element_t*));
-		}
+		elem_hash_buffer = (vm_address_t)pmap_steal_memory(elem_hash_size);
+		record_hash_buffer = (vm_address_t)pmap_steal_memory(record_hash_size);
 		ret = KERN_SUCCESS;
 	}
 
@@ -324,14 +403,25 @@ btlog_create(size_t numrecords,
 	simple_lock_init(&btlog->btlog_lock, 0);
 
 	btlog->caller_will_remove_entries_for_element = caller_will_remove_entries_for_element;
+	btlog->sample_factor = btlog_sample_factor;
 
 	if (caller_will_remove_entries_for_element == TRUE) {
 		btlog->elem_linkage_un.elem_recindex_hashtbl = (btlog_element_t **)elem_hash_buffer;
+		btlog->elem_hash_mask = elem_buckets - 1;
+		for (i=0; i < elem_buckets; i++) {
+			btlog->elem_linkage_un.elem_recindex_hashtbl[i]=0;
+		}
 	} else {
 		btlog->elem_linkage_un.element_hash_queue = (struct _element_hash_queue*) elem_hash_buffer;
 		TAILQ_INIT(btlog->elem_linkage_un.element_hash_queue);
 	}
 
+	btlog->record_hashtbl = (btlog_recordindex_t *)record_hash_buffer;
+	btlog->record_hash_mask = record_buckets - 1;
+	for (i=0; i < record_buckets; i++) {
+		btlog->record_hashtbl[i] = BTLOG_RECORDINDEX_NONE;
+	}
+
 	btlog->btrecords = (uintptr_t)(buffer + sizeof(btlog_t));
 	btlog->btrecord_btdepth = record_btdepth;
 	btlog->btrecord_size = btrecord_size;
@@ -341,10 +431,6 @@ btlog_create(size_t numrecords,
 	btlog->active_record_count = 0;
 	btlog->activerecord = BTLOG_RECORDINDEX_NONE;
 
-	for (i=0; i < ELEMENT_HASH_BUCKET_COUNT; i++) {
-		btlog->elem_linkage_un.elem_recindex_hashtbl[i]=0;
-	}
-
 	/* populate freelist_records with all records in order */
 	btlog->freelist_records = 0;
 	for (i=0; i < (numrecords - 1); i++) {
@@ -394,6 +480,7 @@ btlog_add_record_to_freelist(btlog_t *btlog, btlog_recordindex_t recindex)
 
 	assert(TAILQ_EMPTY(&record->element_record_queue));
 
+	btlog_record_hash_remove(btlog, recindex);
 	record->bthash = 0;
 
 	precindex = btlog->head;
@@ -634,14 +721,18 @@ btlog_add_entry(btlog_t *btlog,
 	if (g_crypto_funcs == NULL)
 		return;
 
-	btlog_lock(btlog);
+	if (!btlog_element_sampled(btlog, (uintptr_t)element))
+		return;
 
+	/* the stack is ours, hash it before taking the lock */
 	MD5Init(&btlog_ctx);
 	for (i=0; i < MIN(btcount, btlog->btrecord_btdepth); i++) {
 		MD5Update(&btlog_ctx, (u_char *) &bt[i], sizeof(bt[i]));
 	}
 	MD5Final((u_char *) &md5_buffer, &btlog_ctx);
 
+	btlog_lock(btlog);
+
 	recindex = lookup_btrecord_byhash(btlog, md5_buffer[0], bt, btcount);
 
 	if (recindex != BTLOG_RECORDINDEX_NONE) {
@@ -668,6 +759,9 @@ retry:
 		record->ref_count = 1;
 		TAILQ_INIT(&record->element_record_queue);
 
+		record->hash_next = btlog->record_hashtbl[record->bthash & btlog->record_hash_mask];
+		btlog->record_hashtbl[record->bthash & btlog->record_hash_mask] = recindex;
+
 		for (i=0; i < MIN(btcount, btlog->btrecord_btdepth); i++) {
 			record->bt[i] = bt[i];
 		}
@@ -724,6 +818,9 @@ btlog_remove_entries_for_element(btlog_t *btlog,
 	if (g_crypto_funcs == NULL)
 		return;
 
+	if (!btlog_element_sampled(btlog, (uintptr_t)element))
+		return;
+
 	btlog_lock(btlog);
 
 	hashidx = calculate_hashidx_for_element((uintptr_t) element, btlog);
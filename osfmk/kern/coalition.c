@@ -40,6 +40,11 @@
 #include <kern/zalloc.h>
 
 #include <libkern/OSAtomic.h>
+#include <machine/atomic.h>
+#if MONOTONIC
+#include <kern/monotonic.h>
+#include <machine/monotonic.h>
+#endif /* MONOTONIC */
 
 #include <mach/coalition_notification_server.h>
 #include <mach/host_priv.h>
@@ -184,6 +189,8 @@ struct i_resource_coalition {
 	uint64_t logical_invalidated_writes;
 	uint64_t logical_metadata_writes;
 	uint64_t cpu_ptime;
+	uint64_t cpu_instructions;
+	uint64_t cpu_cycles;
 	uint64_t cpu_time_eqos[COALITION_NUM_THREAD_QOS_TYPES];      /* cpu time per effective QoS class */
 	uint64_t cpu_time_rqos[COALITION_NUM_THREAD_QOS_TYPES];      /* cpu time per requested QoS class */
 
@@ -199,6 +206,17 @@ struct i_resource_coalition {
 	uint64_t time_nonempty;
 
 	queue_head_t tasks;         /* List of active tasks in the coalition */
+
+	/*
+	 * CPU bandwidth quota, charged at quantum expiration.
+	 * These are only accessed atomically, never under the coalition lock.
+	 */
+	uint64_t cpu_quota;              /* abs time per period, 0 if unlimited */
+	uint64_t cpu_quota_period;       /* abs time */
+	uint64_t cpu_quota_period_start;
+	uint64_t cpu_quota_runtime;      /* abs time used in the current period */
+	uint64_t cpu_throttled_time;     /* abs time threads waited for the next period */
+	uint64_t cpu_throttle_count;
 };
 
 /*
@@ -389,6 +407,26 @@ i_coal_resource_adopt_task(coalition_t coal, task_t task)
 	return KERN_SUCCESS;
 }
 
+/*
+ * Add a task's instruction and cycle counts, including those of its live
+ * threads, to the given totals.  Takes the task lock, like task_energy().
+ */
+static void
+i_coal_resource_add_fixed_counts(task_t task, uint64_t *instrs, uint64_t *cycles)
+{
+#if MONOTONIC
+	uint64_t counts[MT_CORE_NFIXED] = {};
+
+	mt_fixed_task_counts(task, counts);
+#ifdef MT_CORE_INSTRS
+	*instrs += counts[MT_CORE_INSTRS];
+#endif /* defined(MT_CORE_INSTRS) */
+	*cycles += counts[MT_CORE_CYCLES];
+#else /* MONOTONIC */
+#pragma unused(task, instrs, cycles)
+#endif /* !MONOTONIC */
+}
+
 static kern_return_t
 i_coal_resource_remove_task(coalition_t coal, task_t task)
 {
@@ -432,6 +470,7 @@ i_coal_resource_remove_task(coalition_t coal, task_t task)
 		cr->logical_invalidated_writes += task->task_invalidated_writes;
 		cr->logical_metadata_writes += task->task_metadata_writes;
 		cr->cpu_ptime += task_cpu_ptime(task);
+		i_coal_resource_add_fixed_counts(task, &cr->cpu_instructions, &cr->cpu_cycles);
 		task_update_cpu_time_qos_stats(task, cr->cpu_time_eqos, cr->cpu_time_rqos);
 	}
 
@@ -518,6 +557,8 @@ coalition_resource_usage_internal(coalition_t coal, struct coalition_resource_us
 	int64_t energy_billed_to_me = 0;
 	int64_t energy_billed_to_others = 0;
 	uint64_t cpu_ptime = coal->r.cpu_ptime;
+	uint64_t cpu_instructions = coal->r.cpu_instructions;
+	uint64_t cpu_cycles = coal->r.cpu_cycles;
 	uint64_t cpu_time_eqos[COALITION_NUM_THREAD_QOS_TYPES];
 	memcpy(cpu_time_eqos, coal->r.cpu_time_eqos, sizeof(cpu_time_eqos));
 	uint64_t cpu_time_rqos[COALITION_NUM_THREAD_QOS_TYPES];
@@ -549,6 +590,7 @@ coalition_resource_usage_internal(coalition_t coal, struct coalition_resource_us
 		logical_invalidated_writes += task->task_invalidated_writes;
 		logical_metadata_writes += task->task_metadata_writes;
 		cpu_ptime += task_cpu_ptime(task);
+		i_coal_resource_add_fixed_counts(task, &cpu_instructions, &cpu_cycles);
 		task_update_cpu_time_qos_stats(task, cpu_time_eqos, cpu_time_rqos);
 	}
 
@@ -616,8 +658,13 @@ coalition_resource_usage_internal(coalition_t coal, struct coalition_resource_us
 	cru_out->logical_invalidated_writes = logical_invalidated_writes;
 	cru_out->logical_metadata_writes = logical_metadata_writes;
 	cru_out->cpu_ptime = cpu_ptime;
+	cru_out->cpu_instructions = cpu_instructions;
+	cru_out->cpu_cycles = cpu_cycles;
 	cru_out->cpu_time_eqos_len = COALITION_NUM_THREAD_QOS_TYPES;
 	memcpy(cru_out->cpu_time_eqos, cpu_time_eqos, sizeof(cru_out->cpu_time_eqos));
+	absolutetime_to_nanoseconds(os_atomic_load(&coal->r.cpu_throttled_time, relaxed),
+	                            &cru_out->cpu_throttled_time);
+	cru_out->cpu_throttle_count = os_atomic_load(&coal->r.cpu_throttle_count, relaxed);
 	ledger_dereference(sum_ledger);
 	sum_ledger = LEDGER_NULL;
 
@@ -1197,6 +1244,107 @@ void coalition_set_efficient(coalition_t coal)
 }
 
 
+/*
+ * coalition_set_cpu_quota
+ * Limit the CPU time the threads of a resource coalition use to
+ * quota_ns in every period_ns, or lift the limit if quota_ns is 0.
+ */
+kern_return_t
+coalition_set_cpu_quota(coalition_t coal, uint64_t quota_ns, uint64_t period_ns)
+{
+	uint64_t quota, period;
+
+	if (coal->type != COALITION_TYPE_RESOURCE)
+		return KERN_INVALID_ARGUMENT;
+	if (quota_ns != 0 && period_ns == 0)
+		return KERN_INVALID_ARGUMENT;
+
+	nanoseconds_to_absolutetime(quota_ns, &quota);
+	nanoseconds_to_absolutetime(period_ns, &period);
+
+	/* the lock only serializes concurrent setters */
+	coalition_lock(coal);
+	os_atomic_store(&coal->r.cpu_quota, 0, relaxed);
+	os_atomic_store(&coal->r.cpu_quota_period, period, relaxed);
+	os_atomic_store(&coal->r.cpu_quota_period_start, mach_absolute_time(), relaxed);
+	os_atomic_store(&coal->r.cpu_quota_runtime, 0, relaxed);
+	os_atomic_store(&coal->r.cpu_quota, quota, release);
+	coalition_unlock(coal);
+
+	/* let the throttled threads look at the new quota */
+	thread_wakeup((event_t)&coal->r.cpu_quota_period_start);
+
+	return KERN_SUCCESS;
+}
+
+/*
+ * task_coalition_cpu_quota_charge
+ * Charge runtime to the resource coalition of the task, starting a new
+ * period if the current one is over.  Returns TRUE when the coalition
+ * has gone over its quota for the period.
+ *
+ * Called at quantum expiration, at splsched: this takes no locks.
+ * A charge racing with the start of a period may land in either one.
+ */
+boolean_t
+task_coalition_cpu_quota_charge(task_t task, uint64_t runtime, uint64_t now)
+{
+	coalition_t coal = task->coalition[COALITION_TYPE_RESOURCE];
+	uint64_t quota, period, start;
+
+	if (coal == COALITION_NULL)
+		return FALSE;
+
+	quota = os_atomic_load(&coal->r.cpu_quota, acquire);
+	if (quota == 0)
+		return FALSE;
+
+	period = os_atomic_load(&coal->r.cpu_quota_period, relaxed);
+	start = os_atomic_load(&coal->r.cpu_quota_period_start, relaxed);
+	if (now - start >= period) {
+		uint64_t new_start = now - (now - start) % period;
+
+		if (os_atomic_cmpxchg(&coal->r.cpu_quota_period_start, start, new_start, relaxed))
+			os_atomic_store(&coal->r.cpu_quota_runtime, 0, relaxed);
+	}
+
+	return os_atomic_add(&coal->r.cpu_quota_runtime, runtime, relaxed) > quota;
+}
+
+/*
+ * task_coalition_cpu_quota_throttle
+ * Called at AST context on the way back to user space: wait for the
+ * next period if the thread's resource coalition is still over quota.
+ */
+void
+task_coalition_cpu_quota_throttle(thread_t thread)
+{
+	coalition_t coal = thread->task->coalition[COALITION_TYPE_RESOURCE];
+	uint64_t quota, period, start, now;
+	wait_result_t wr;
+
+	if (coal == COALITION_NULL)
+		return;
+
+	quota = os_atomic_load(&coal->r.cpu_quota, acquire);
+	if (quota == 0)
+		return;
+
+	period = os_atomic_load(&coal->r.cpu_quota_period, relaxed);
+	start = os_atomic_load(&coal->r.cpu_quota_period_start, relaxed);
+	now = mach_absolute_time();
+	if (now - start >= period || os_atomic_load(&coal->r.cpu_quota_runtime, relaxed) <= quota)
+		return;
+
+	wr = assert_wait_deadline((event_t)&coal->r.cpu_quota_period_start,
+	                          THREAD_INTERRUPTIBLE, start + period);
+	if (wr == THREAD_WAITING)
+		(void)thread_block(THREAD_CONTINUE_NULL);
+
+	os_atomic_add(&coal->r.cpu_throttled_time, mach_absolute_time() - now, relaxed);
+	os_atomic_inc(&coal->r.cpu_throttle_count, relaxed);
+}
+
 void coalition_for_each_task(coalition_t coal, void *ctx,
 			     void (*callback)(coalition_t, void *, task_t))
 {
@@ -79,6 +79,15 @@ void coalition_for_each_task(coalition_t coal, void *ctx,
 
 void coalition_set_efficient(coalition_t coal);
 
+/*
+ * CPU bandwidth quotas of resource coalitions: threads are charged at
+ * quantum expiration and wait for the next period on their way back to
+ * user space once the coalition went over its quota.
+ */
+kern_return_t coalition_set_cpu_quota(coalition_t coal, uint64_t quota_ns, uint64_t period_ns);
+boolean_t task_coalition_cpu_quota_charge(task_t task, uint64_t runtime, uint64_t now);
+void task_coalition_cpu_quota_throttle(thread_t thread);
+
 typedef void (*coalition_iterate_fn_t)(void*, int, coalition_t);
 kern_return_t coalition_iterate_stackshot(coalition_iterate_fn_t callout, void *arg, uint32_t coalition_type);
 
@@ -168,6 +177,18 @@ static inline uint32_t task_coalition_focal_count(__unused task_t task)
 	return 0;
 }
 
+static inline boolean_t task_coalition_cpu_quota_charge(__unused task_t task,
+							__unused uint64_t runtime,
+							__unused uint64_t now)
+{
+	return FALSE;
+}
+
+static inline void task_coalition_cpu_quota_throttle(__unused thread_t thread)
+{
+	return;
+}
+
 static inline void coalition_for_each_task(__unused coalition_t coal,
 					   __unused void *ctx,
 					   __unused void (*callback)(coalition_t, void *, task_t))
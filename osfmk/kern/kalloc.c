@@ -74,11 +74,14 @@
 #include <kern/zalloc.h>
 #include <kern/kalloc.h>
 #include <kern/ledger.h>
+#include <mach_debug/zone_info.h>
 #include <vm/vm_kern.h>
 #include <vm/vm_object.h>
 #include <vm/vm_map.h>
+#include <libkern/OSAtomic.h>
 #include <libkern/OSMalloc.h>
 #include <sys/kdebug.h>
+#include <pexpert/pexpert.h>
 
 #include <san/kasan.h>
 
@@ -219,6 +222,20 @@ static const struct kalloc_zone_config {
 
 #define MAX_K_ZONE (int)(sizeof(k_zone_config) / sizeof(k_zone_config[0]))
 
+/*
+ * Extra size classes can be added at boot with kalloc_zones=<size>,...,
+ * typically picked from the allocation profile below: a zone just above
+ * a common request size saves rounding it up to the next configured one.
+ * Sizes are rounded up to KALLOC_MINALIGN; sizes already configured or
+ * not below kalloc_max are ignored.  k_zone_cfg[] is the sorted result.
+ */
+#define KALLOC_EXTRA_ZONES	8
+#define MAX_K_ZONE_CFG		(MAX_K_ZONE + KALLOC_EXTRA_ZONES)
+
+static struct kalloc_zone_config k_zone_cfg[MAX_K_ZONE_CFG];
+static char k_zone_extra_names[KALLOC_EXTRA_ZONES][sizeof("kalloc.65536")];
+static int k_zone_count;
+
 /*
  * Many kalloc() allocations are for small structures containing a few
  * pointers and longs - the k_zone_dlut[] direct lookup table, indexed by
@@ -239,7 +256,31 @@ static int8_t k_zone_dlut[N_K_ZDLUT];	/* table of indices into k_zone[] */
  */
 static int k_zindex_start;
 
-static zone_t k_zone[MAX_K_ZONE];
+static zone_t k_zone[MAX_K_ZONE_CFG];
+
+#if CONFIG_ZCACHE
+/* Set to 0 via the zcc_kalloc boot-arg to disable per-cpu caching of the kalloc zones */
+static int kalloc_zone_caching;
+#endif /* CONFIG_ZCACHE */
+
+/*
+ * Allocation profiler, enabled with the kalloc_profile boot-arg: counts
+ * zone backed kalloc() requests by allocation site tag and size (rounded
+ * up to KALLOC_MINALIGN) in a fixed size hash table.  mach_memory_info()
+ * reports each pair as a VM_KERN_SITE_KALLOC entry with the bytes
+ * requested and the bytes lost to rounding them up to their zone.
+ */
+#define KALLOC_PROFILE_ENTRIES	4096	/* power of 2 */
+#define KALLOC_PROFILE_PROBES	16
+
+struct kalloc_profile_entry {
+	uint32_t	kpe_key;	/* 1 + (tag << 16 | size / KALLOC_MINALIGN), 0 if free */
+	uint32_t	kpe_pad;
+	uint64_t	kpe_count;
+};
+
+static struct kalloc_profile_entry *kalloc_profile_table;
+uint64_t kalloc_profile_dropped;	/* requests that found no free entry */
 
 /* #define KALLOC_DEBUG		1 */
 
@@ -268,6 +309,134 @@ void OSMalloc_init(void);
 void OSMalloc_Tagref(OSMallocTag	tag);
 void OSMalloc_Tagrele(OSMallocTag	tag);
 
+static void
+kalloc_zone_config_init(void)
+{
+	char arg[128], *cp;
+	int i, size;
+
+	for (i = 0; i < MAX_K_ZONE; i++)
+		k_zone_cfg[i] = k_zone_config[i];
+	k_zone_count = MAX_K_ZONE;
+
+	if (!PE_parse_boot_arg_str("kalloc_zones", arg, sizeof (arg)))
+		return;
+
+	for (cp = arg; *cp != '\0' && k_zone_count < MAX_K_ZONE_CFG; ) {
+		for (size = 0; *cp >= '0' && *cp <= '9'; cp++) {
+			if (size < KiB(64))
+				size = size * 10 + (*cp - '0');
+		}
+		while (*cp != '\0' && (*cp < '0' || *cp > '9'))
+			cp++;
+
+		size = (size + KALLOC_MINALIGN - 1) & ~(KALLOC_MINALIGN - 1);
+		if (size == 0 || (vm_size_t)size >= kalloc_max)
+			continue;
+		for (i = 0; i < k_zone_count && k_zone_cfg[i].kzc_size < size; i++)
+			continue;
+		if (i < k_zone_count && k_zone_cfg[i].kzc_size == size)
+			continue;
+
+		memmove(&k_zone_cfg[i + 1], &k_zone_cfg[i],
+		    (k_zone_count - i) * sizeof (k_zone_cfg[0]));
+		snprintf(k_zone_extra_names[k_zone_count - MAX_K_ZONE],
+		    sizeof (k_zone_extra_names[0]), "kalloc.%d", size);
+		k_zone_cfg[i].kzc_size = size;
+		k_zone_cfg[i].kzc_name = k_zone_extra_names[k_zone_count - MAX_K_ZONE];
+		k_zone_count++;
+		printf("kalloc_init: added kalloc.%d\n", size);
+	}
+}
+
+static void
+kalloc_profile_init(void)
+{
+	vm_offset_t addr;
+	int enable = 0;
+
+	if (!PE_parse_boot_argn("kalloc_profile", &enable, sizeof (enable)) || !enable)
+		return;
+
+	if (kmem_alloc_flags(kernel_map, &addr,
+	    KALLOC_PROFILE_ENTRIES * sizeof (struct kalloc_profile_entry),
+	    VM_KERN_MEMORY_DIAG, KMA_ZERO) != KERN_SUCCESS) {
+		printf("kalloc_init: no memory for the allocation profile\n");
+		return;
+	}
+	kalloc_profile_table = (struct kalloc_profile_entry *)addr;
+}
+
+static void
+kalloc_profile_record(vm_allocation_site_t *site, vm_size_t size)
+{
+	struct kalloc_profile_entry *kpe;
+	vm_tag_t tag;
+	uint32_t key, idx, n;
+
+	tag = site ? vm_tag_alloc(site) : VM_KERN_MEMORY_KALLOC;
+	key = (((uint32_t)tag << 16) | (uint32_t)INDEX_ZDLUT(size)) + 1;
+	idx = key * 2654435761U;
+
+	for (n = 0; n < KALLOC_PROFILE_PROBES; n++, idx++) {
+		kpe = &kalloc_profile_table[idx & (KALLOC_PROFILE_ENTRIES - 1)];
+		if (kpe->kpe_key != key &&
+		    !(kpe->kpe_key == 0 && OSCompareAndSwap(0, key, &kpe->kpe_key)) &&
+		    kpe->kpe_key != key)
+			continue;
+		OSIncrementAtomic64((SInt64 *)&kpe->kpe_count);
+		return;
+	}
+	OSIncrementAtomic64((SInt64 *)&kalloc_profile_dropped);
+}
+
+uint32_t
+kalloc_profile_estimate(void)
+{
+	uint32_t i, count = 0;
+
+	if (kalloc_profile_table == NULL)
+		return 0;
+	for (i = 0; i < KALLOC_PROFILE_ENTRIES; i++) {
+		if (kalloc_profile_table[i].kpe_key != 0)
+			count++;
+	}
+	return count;
+}
+
+/*
+ * Fill in info[idx..num_info) with the profile entries, returns the index
+ * of the first entry left unused.
+ */
+uint32_t
+kalloc_profile_diagnose(mach_memory_info_t *info, uint32_t idx, uint32_t num_info)
+{
+	struct kalloc_profile_entry *kpe;
+	vm_size_t size;
+	uint64_t count;
+	uint32_t i, key;
+
+	if (kalloc_profile_table == NULL)
+		return idx;
+
+	for (i = 0; i < KALLOC_PROFILE_ENTRIES && idx < num_info; i++) {
+		kpe = &kalloc_profile_table[i];
+		if ((key = kpe->kpe_key) == 0 || (count = kpe->kpe_count) == 0)
+			continue;
+		key--;
+		size = (key & 0xffff) * KALLOC_MINALIGN;
+
+		bzero(&info[idx], sizeof (info[idx]));
+		info[idx].flags = VM_KERN_SITE_KALLOC | VM_KERN_SITE_HIDE;
+		info[idx].tag = (uint16_t)(key >> 16);
+		info[idx].site = size;
+		info[idx].size = count * size;
+		info[idx].collectable_bytes = count * (kalloc_bucket_size(size) - size);
+		idx++;
+	}
+	return idx;
+}
+
 /*
  *	Initialize the memory allocator.  This should be called only
  *	once on a system wide basis (i.e. first processor to get here
@@ -330,11 +499,20 @@ kalloc_init(
 	kalloc_kernmap_size = (kalloc_max * 16) + 1;
 	kalloc_largest_allocated = kalloc_kernmap_size;
 
+	kalloc_zone_config_init();
+	kalloc_profile_init();
+
+#if CONFIG_ZCACHE
+	/* zcc_kalloc=0: don't put a per-cpu cache in front of the kalloc zones. */
+	if (!PE_parse_boot_argn("zcc_kalloc", &kalloc_zone_caching, sizeof (kalloc_zone_caching)))
+		kalloc_zone_caching = 1;
+#endif /* CONFIG_ZCACHE */
+
 	/*
 	 * Allocate a zone for each size we are going to handle.
 	 */
-	for (int i = 0; i < MAX_K_ZONE && (size = k_zone_config[i].kzc_size) < kalloc_max; i++) {
-		k_zone[i] = zinit(size, size, size, k_zone_config[i].kzc_name);
+	for (int i = 0; i < k_zone_count && (size = k_zone_cfg[i].kzc_size) < kalloc_max; i++) {
+		k_zone[i] = zinit(size, size, size, k_zone_cfg[i].kzc_name);
 
 		/*
 		 * Don't charge the caller for the allocation, as we aren't sure how
@@ -342,9 +520,16 @@ kalloc_init(
 		 */
 		zone_change(k_zone[i], Z_CALLERACCT, FALSE);
 #if VM_MAX_TAG_ZONES
-		if (zone_tagging_on) zone_change(k_zone[i], Z_TAGS_ENABLED, TRUE);
+		if (zone_tagging_on && i < VM_MAX_TAG_ZONES) zone_change(k_zone[i], Z_TAGS_ENABLED, TRUE);
 #endif
 		zone_change(k_zone[i], Z_KASAN_QUARANTINE, FALSE);
+#if CONFIG_ZCACHE
+		/*
+		 * The kalloc zones are among the most contended zone locks in
+		 * the system, so they get per-cpu caching by default.
+		 */
+		if (kalloc_zone_caching) zone_change(k_zone[i], Z_CACHING_ENABLED, TRUE);
+#endif /* CONFIG_ZCACHE */
 	}
 
 	/*
@@ -354,7 +539,7 @@ kalloc_init(
 	for (int i = 0; i <= N_K_ZDLUT; i++, size += KALLOC_MINALIGN) {
 		int zindex = 0;
 
-		while ((vm_size_t)k_zone_config[zindex].kzc_size < size)
+		while ((vm_size_t)k_zone_cfg[zindex].kzc_size < size)
 			zindex++;
 
 		if (i == N_K_ZDLUT) {
@@ -373,8 +558,8 @@ kalloc_init(
 	 * Useful when debugging/tweaking the array of zone sizes.
 	 * Cache misses probably more critical than compare-branches!
 	 */
-	for (int i = 0; i < MAX_K_ZONE; i++) {
-		vm_size_t testsize = (vm_size_t)k_zone_config[i].kzc_size - 1;
+	for (int i = 0; i < k_zone_count; i++) {
+		vm_size_t testsize = (vm_size_t)k_zone_cfg[i].kzc_size - 1;
 		int compare = 0;
 		int zindex;
 
@@ -389,7 +574,7 @@ kalloc_init(
 			compare += 2;	/* 'if' (F), 'if' (T) */
 
 			zindex = k_zindex_start;
-			while ((vm_size_t)k_zone_config[zindex].kzc_size < testsize) {
+			while ((vm_size_t)k_zone_cfg[zindex].kzc_size < testsize) {
 				zindex++;
 				compare++;	/* 'while' (T) */
 			}
@@ -424,18 +609,18 @@ get_zone_dlut(vm_size_t size)
 	return (k_zone[zindex]);
 }
 
-/* As above, but linear search k_zone_config[] for the next zone that fits. */
+/* As above, but linear search k_zone_cfg[] for the next zone that fits. */
 
 static __inline zone_t
 get_zone_search(vm_size_t size, int zindex)
 {
 	assert(size < kalloc_max_prerounded);
 
-	while ((vm_size_t)k_zone_config[zindex].kzc_size < size)
+	while ((vm_size_t)k_zone_cfg[zindex].kzc_size < size)
 		zindex++;
 
-	assert(zindex < MAX_K_ZONE &&
-	    (vm_size_t)k_zone_config[zindex].kzc_size < kalloc_max);
+	assert(zindex < k_zone_count &&
+	    (vm_size_t)k_zone_cfg[zindex].kzc_size < kalloc_max);
 
 	return (k_zone[zindex]);
 }
@@ -682,6 +867,9 @@ kalloc_canblock(
 
 	assert(size <= z->elem_size);
 
+	if (__improbable(kalloc_profile_table != NULL))
+		kalloc_profile_record(site, *psize);
+
 #if VM_MAX_TAG_ZONES
     if (z->tags && site)
     {
@@ -177,6 +177,13 @@ extern void		kalloc_fake_zone_info(
 extern vm_size_t kalloc_max_prerounded;
 extern vm_size_t kalloc_large_total;
 
+struct mach_memory_info;
+extern uint32_t		kalloc_profile_estimate(void);
+extern uint32_t		kalloc_profile_diagnose(
+				struct mach_memory_info	*info,
+				uint32_t		idx,
+				uint32_t		num_info);
+
 #endif	/* MACH_KERNEL_PRIVATE */
 
 #endif	/* _KERN_KALLOC_H_ */
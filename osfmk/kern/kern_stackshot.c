@@ -232,6 +232,17 @@ SECURITY_READ_ONLY_LATE(static uint32_t) max_tracebuf_size = SANE_TRACEBUF_SIZE;
 #define STACKSHOT_SUPP_SIZE (16 * 1024) /* Minimum stackshot size */
 #define TASK_UUID_AVG_SIZE (16 * sizeof(uuid_t)) /* Average space consumed by UUIDs/task */
 
+/*
+ * Percentage applied to the thread/task based size estimate, learned from
+ * the last full stackshot, so that the next one starts out with a buffer
+ * that fits rather than doubling its way up and retaking the snapshot.
+ * Protected by the stackshot subsystem mutex.
+ */
+#define STACKSHOT_ESTIMATE_ADJ_MIN	100
+#define STACKSHOT_ESTIMATE_ADJ_MAX	1000
+#define STACKSHOT_ESTIMATE_HEADROOM	25	/* percent over the last stackshot */
+static uint32_t stackshot_estimate_adj = STACKSHOT_ESTIMATE_ADJ_MIN;
+
 /*
  * Initialize the mutex governing access to the stack snapshot subsystem
  * and other stackshot related bits.
@@ -449,17 +460,30 @@ exit:
  * Return the estimated size of a stackshot based on the
  * number of currently running threads and tasks.
  */
-uint32_t
-get_stackshot_estsize(uint32_t prev_size_hint)
+static uint64_t
+stackshot_raw_estsize(void)
 {
 	vm_size_t thread_total;
 	vm_size_t task_total;
-	uint32_t estimated_size;
 
 	thread_total = (threads_count * sizeof(struct thread_snapshot));
 	task_total = (tasks_count  * (sizeof(struct task_snapshot) + TASK_UUID_AVG_SIZE));
 
-	estimated_size = (uint32_t) VM_MAP_ROUND_PAGE((thread_total + task_total + STACKSHOT_SUPP_SIZE), PAGE_MASK);
+	return thread_total + task_total + STACKSHOT_SUPP_SIZE;
+}
+
+uint32_t
+get_stackshot_estsize(uint32_t prev_size_hint)
+{
+	uint64_t adjusted;
+	uint32_t estimated_size;
+
+	adjusted = (stackshot_raw_estsize() * stackshot_estimate_adj) / 100;
+	if (adjusted > max_tracebuf_size) {
+		adjusted = max_tracebuf_size;
+	}
+
+	estimated_size = (uint32_t) VM_MAP_ROUND_PAGE(adjusted, PAGE_MASK);
 	if (estimated_size < prev_size_hint) {
 		estimated_size = (uint32_t) VM_MAP_ROUND_PAGE(prev_size_hint, PAGE_MASK);
 	}
@@ -710,6 +734,23 @@ kern_stack_snapshot_internal(int stackshot_config_version, void *stackshot_confi
 		}
 
 		assert(bytes_traced <= stackshotbuf_size);
+
+		/*
+		 * Only full stackshots say anything about how big the next
+		 * one will be; single-pid and delta stackshots are smaller.
+		 */
+		if (pid == -1 && !(flags & STACKSHOT_COLLECT_DELTA_SNAPSHOT)) {
+			uint64_t adj = ((uint64_t)bytes_traced * 100) / stackshot_raw_estsize() +
+			    STACKSHOT_ESTIMATE_HEADROOM;
+
+			if (adj < STACKSHOT_ESTIMATE_ADJ_MIN) {
+				adj = STACKSHOT_ESTIMATE_ADJ_MIN;
+			} else if (adj > STACKSHOT_ESTIMATE_ADJ_MAX) {
+				adj = STACKSHOT_ESTIMATE_ADJ_MAX;
+			}
+			stackshot_estimate_adj = (uint32_t)adj;
+		}
+
 		if (!(flags & STACKSHOT_SAVE_IN_KERNEL_BUFFER)) {
 			error = stackshot_remap_buffer(stackshotbuf, bytes_traced, out_buffer_addr, out_size_addr);
 			goto error_exit;
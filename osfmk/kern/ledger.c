@@ -40,6 +40,8 @@
 #include <kern/queue.h>
 #include <kern/policy_internal.h>
 
+#include <machine/machine_routines.h>
+
 #include <sys/errno.h>
 
 #include <libkern/OSAtomic.h>
@@ -48,6 +50,8 @@
 
 #include <vm/pmap.h>
 
+#include <pexpert/pexpert.h>
+
 /*
  * Ledger entry flags. Bits in second nibble (masked by 0xF0) are used for
  * ledger actions (LEDGER_ACTION_BLOCK, etc).
@@ -63,6 +67,10 @@
 #define LF_PANIC_ON_NEGATIVE	0x8000	/* panic if it goes negative */
 #define LF_TRACK_CREDIT_ONLY	0x10000	/* only update "credit" */
 
+/* entries with any of these need to see every update as it happens */
+#define LF_DEFER_MASK	(LEDGER_ACTION_MASK | LF_WAKE_NEEDED | LF_REFILL_SCHEDULED | \
+			 LF_TRACKING_MAX | LF_PANIC_ON_NEGATIVE)
+
 /* Determine whether a ledger entry exists and has been initialized and active */
 #define	ENTRY_VALID(l, e)					\
 	(((l) != NULL) && ((e) >= 0) && ((e) < (l)->l_size) &&	\
@@ -134,6 +142,13 @@ struct ledger_template {
 }
 
 static int ledger_cnt = 0;
+
+/*
+ * Number of updates a thread may accumulate for one entry of its task's
+ * ledger before folding them in, 0 to update the entry every time.
+ */
+#define LEDGER_DEFER_DEFAULT	16
+static uint32_t ledger_defer_max = LEDGER_DEFER_DEFAULT;
 /* ledger ast helper functions */
 static uint32_t ledger_check_needblock(ledger_t l, uint64_t now);
 static kern_return_t ledger_perform_blocking(ledger_t l);
@@ -176,6 +191,8 @@ void
 ledger_init(void)
 {
         lck_grp_init(&ledger_lck_grp, "ledger", LCK_GRP_ATTR_NULL);
+        PE_parse_boot_argn("ledger_defer", &ledger_defer_max,
+            sizeof (ledger_defer_max));
 }
 
 ledger_template_t
@@ -752,6 +769,64 @@ ledger_check_new_balance(thread_t thread, ledger_t ledger, int entry)
 	ledger_entry_check_new_balance(thread, ledger, entry, le);
 }
 
+/*
+ * Fold the updates the thread has accumulated into its task's ledger.
+ */
+void
+ledger_thread_fold(thread_t thread)
+{
+	struct ledger_entry *le;
+
+	if (thread->t_ledger_defer_count == 0)
+		return;
+
+	le = &thread->t_ledger->l_entries[thread->t_ledger_defer_entry];
+	if (thread->t_ledger_defer_credit != 0)
+		OSAddAtomic64(thread->t_ledger_defer_credit, &le->le_credit);
+	if (thread->t_ledger_defer_debit != 0)
+		OSAddAtomic64(thread->t_ledger_defer_debit, &le->le_debit);
+	lprintf(("%p Fold %lld %lld\n", thread, thread->t_ledger_defer_credit,
+	    thread->t_ledger_defer_debit));
+
+	thread->t_ledger_defer_count = 0;
+	thread->t_ledger_defer_credit = 0;
+	thread->t_ledger_defer_debit = 0;
+}
+
+/*
+ * Entries of a task's ledger are updated by all of its threads, so the
+ * entries that have no limit, refill, callback or maximum to track let the
+ * current thread accumulate its updates and fold them in every
+ * ledger_defer_max updates, or when it moves on to another entry.  Readers
+ * may miss up to ledger_defer_max - 1 updates per thread of the task, an
+ * entry getting a limit may miss as many before it is first checked.
+ *
+ * Returns true if the update was accumulated.
+ */
+static inline bool
+ledger_entry_defer(thread_t thread, ledger_t ledger, int entry,
+                   struct ledger_entry *le, ledger_amount_t credit, ledger_amount_t debit)
+{
+	if (ledger_defer_max == 0 || thread != current_thread() ||
+	    ledger != thread->t_ledger || ml_at_interrupt_context())
+		return (false);
+
+	if ((le->le_flags & LF_DEFER_MASK) || (le->le_limit != LEDGER_LIMIT_INFINITY))
+		return (false);
+
+	if (thread->t_ledger_defer_entry != entry) {
+		ledger_thread_fold(thread);
+		thread->t_ledger_defer_entry = entry;
+	}
+
+	thread->t_ledger_defer_credit += credit;
+	thread->t_ledger_defer_debit += debit;
+	if (++thread->t_ledger_defer_count >= ledger_defer_max)
+		ledger_thread_fold(thread);
+
+	return (true);
+}
+
 /*
  * Add value to an entry in a ledger for a specific thread.
  */
@@ -769,6 +844,9 @@ ledger_credit_thread(thread_t thread, ledger_t ledger, int entry, ledger_amount_
 
 	le = &ledger->l_entries[entry];
 
+	if (ledger_entry_defer(thread, ledger, entry, le, amount, 0))
+		return (KERN_SUCCESS);
+
 	old = OSAddAtomic64(amount, &le->le_credit);
 	new = old + amount;
 	lprintf(("%p Credit %lld->%lld\n", thread, old, new));
@@ -1240,9 +1318,13 @@ ledger_debit_thread(thread_t thread, ledger_t ledger, int entry, ledger_amount_t
 
 	if (le->le_flags & LF_TRACK_CREDIT_ONLY) {
 		assert(le->le_debit == 0);
+		if (ledger_entry_defer(thread, ledger, entry, le, -amount, 0))
+			return (KERN_SUCCESS);
 		old = OSAddAtomic64(-amount, &le->le_credit);
 		new = old - amount;
 	} else {
+		if (ledger_entry_defer(thread, ledger, entry, le, 0, amount))
+			return (KERN_SUCCESS);
 		old = OSAddAtomic64(amount, &le->le_debit);
 		new = old + amount;
 	}
@@ -189,6 +189,7 @@ extern kern_return_t ledger_credit_thread(thread_t thread, ledger_t ledger,
                                           int entry, ledger_amount_t amount);
 extern kern_return_t ledger_debit_thread(thread_t thread, ledger_t ledger,
                                          int entry, ledger_amount_t amount);
+extern void ledger_thread_fold(thread_t thread);
 extern kern_return_t ledger_zero_balance(ledger_t ledger, int entry);
 extern kern_return_t ledger_get_entries(ledger_t ledger, int entry,
 	ledger_amount_t *credit, ledger_amount_t *debit);
@@ -66,6 +66,7 @@
 
 #include <kern/locks.h>
 #include <kern/misc_protos.h>
+#include <kern/cpu_number.h>
 #include <kern/kalloc.h>
 #include <kern/thread.h>
 #include <kern/processor.h>
@@ -74,8 +75,17 @@
 #include <libkern/section_keywords.h>
 #include <machine/atomic.h>
 #include <machine/machine_cpu.h>
+#include <machine/machine_routines.h>
 #include <string.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <i386/mp.h>
+#endif
+
+#if defined (__arm__) || defined (__arm64__)
+#include <arm/cpu_data_internal.h>
+#endif
+
 #include <sys/kdebug.h>
 
 #if	CONFIG_DTRACE
@@ -92,6 +102,7 @@
 #define	LCK_MTX_SLEEP_DEADLINE_CODE	1
 #define	LCK_MTX_LCK_WAIT_CODE		2
 #define	LCK_MTX_UNLCK_WAKEUP_CODE	3
+#define	LCK_MTX_CONTENTION_CODE		0x30
 
 #if MACH_LDEBUG
 #define ALIGN_TEST(p,t) do{if((uintptr_t)p&(sizeof(t)-1)) __builtin_trap();}while(0)
@@ -922,6 +933,108 @@ lck_mtx_sleep_deadline(
 	return res;
 }
 
+/*
+ * Adaptive mutex spinning
+ *
+ * Contended acquirers spin while the owner is running on a core, for up
+ * to twice the running average of how long earlier spinners actually
+ * waited (plus a small floor), never more than MutexSpin.  A spinner that
+ * times out feeds its full window back into the average, so locks that
+ * are held long push the window open toward MutexSpin, and short hold
+ * times pull it back down quickly.  Updates are unsynchronized: a
+ * concurrent update only loses a sample.
+ *
+ * When spinning doesn't pay off, the waiter blocks in lck_mtx_lock_wait()
+ * which promotes the owner to the waiter's priority.
+ */
+int		lck_mtx_adaptive_spin = 1;	/* 0: always spin for MutexSpin */
+uint64_t	lck_mtx_spin_avg;		/* in absolute time units */
+
+uint64_t
+lck_mtx_spin_window(void)
+{
+	uint64_t window;
+
+	if (!lck_mtx_adaptive_spin)
+		return MutexSpin;
+
+	window = 2 * lck_mtx_spin_avg + (MutexSpin >> 4);
+	return MIN(window, MutexSpin);
+}
+
+void
+lck_mtx_spin_update(uint64_t spun)
+{
+	uint64_t avg = lck_mtx_spin_avg;
+
+	if (spun > MutexSpin)
+		spun = MutexSpin;
+	if (spun >= avg)
+		avg += (spun - avg) >> 3;
+	else
+		avg -= (avg - spun) >> 3;
+	lck_mtx_spin_avg = avg;
+}
+
+/*
+ * Sampled mutex contention
+ *
+ * One in lck_mtx_contention_rate waits for a mutex is timed from the
+ * moment the waiter blocks until it is woken, into a log2 histogram of
+ * wait times in nanoseconds, and traced as LCK_MTX_CONTENTION_CODE with
+ * the lock and the wait time, so that kperf can be triggered on it to
+ * find the contended call sites.  For mutexes with an extended lock, the
+ * time is also added to the lock group's wait statistics.  Only the
+ * blocking path looks at the rate, so an uncontended acquire pays nothing
+ * when sampling is disabled (the default).  The sample counter is not
+ * synchronized: a concurrent update only shifts the next sample.
+ */
+uint32_t	lck_mtx_contention_rate = 0;	/* 0: disabled */
+uint64_t	lck_mtx_contention_hist[LCK_MTX_CONTENTION_BUCKETS];
+static uint32_t	lck_mtx_contention_count;
+
+uint64_t
+lck_mtx_contention_begin(void)
+{
+	uint32_t rate = lck_mtx_contention_rate;
+
+	if (__probable(rate == 0))
+		return 0;
+	if (++lck_mtx_contention_count < rate)
+		return 0;
+	lck_mtx_contention_count = 0;
+	return mach_absolute_time();
+}
+
+void
+lck_mtx_contention_end(
+	lck_mtx_t	*lck,
+	lck_grp_t	*grp,
+	uint64_t	start)
+{
+	uint64_t waited = mach_absolute_time() - start;
+	uint64_t ns;
+	unsigned int bucket = 0;
+
+	absolutetime_to_nanoseconds(waited, &ns);
+	while (ns >>= 1)
+		bucket++;
+	if (bucket >= LCK_MTX_CONTENTION_BUCKETS)
+		bucket = LCK_MTX_CONTENTION_BUCKETS - 1;
+	os_atomic_inc(&lck_mtx_contention_hist[bucket], relaxed);
+
+	if (grp != LCK_GRP_NULL) {
+		lck_grp_mtx_stat_t *stat = &grp->lck_grp_stat.lck_grp_mtx_stat;
+
+		os_atomic_add(&stat->lck_grp_mtx_wait_cum, waited, relaxed);
+		if (waited > stat->lck_grp_mtx_wait_max)
+			stat->lck_grp_mtx_wait_max = waited;
+	}
+
+	KERNEL_DEBUG(MACHDBG_CODE(DBG_MACH_LOCKS, LCK_MTX_CONTENTION_CODE),
+	             unslide_for_kdebug(lck), waited, 0, 0, 0);
+}
+
 /*
  * Lock Boosting Invariants:
  *
@@ -993,6 +1106,8 @@ lck_mtx_lock_wait (
 	}
 #endif
 
+	uint64_t		contention_start = lck_mtx_contention_begin();
+
 	if (lck->lck_mtx_tag != LCK_MTX_TAG_INDIRECT)
 		mutex = lck;
 	else
@@ -1058,6 +1173,10 @@ lck_mtx_lock_wait (
 	assert(mutex->lck_mtx_waiters > 0);
 
 	KERNEL_DEBUG(MACHDBG_CODE(DBG_MACH_LOCKS, LCK_MTX_LCK_WAIT_CODE) | DBG_FUNC_END, 0, 0, 0, 0, 0);
+	if (contention_start) {
+		lck_mtx_contention_end(lck, (lck->lck_mtx_tag == LCK_MTX_TAG_INDIRECT) ?
+		    lck->lck_mtx_ptr->lck_mtx_grp : LCK_GRP_NULL, contention_start);
+	}
 #if	CONFIG_DTRACE
 	/*
 	 * Record the DTrace lockstat probe for blocking, block time
@@ -1646,6 +1765,204 @@ host_lockgroup_info(
 	return(KERN_SUCCESS);
 }
 
+/*
+ * Read-mostly locks
+ *
+ * A reader bumps the reader count of the processor it runs on, then
+ * checks for a writer.  A writer publishes itself in lck_rm_owner, then
+ * waits for the sum of all the counts to drop to zero.  Both sides use
+ * a full barrier between their store and their load, so either the
+ * reader sees the writer and backs off, or the writer sees the reader
+ * and waits for it.
+ *
+ * Readers that back off take the embedded lck_rw_t shared, which the
+ * writer holds exclusive: they wait for the writer to be done, and
+ * then take their count with no writer around.  That rw lock also
+ * serializes writers.
+ *
+ * A reader may migrate while holding the lock and release it on another
+ * processor, so individual counts can go negative: only the sum matters.
+ */
+#define LCK_RM_CACHE_LINE_SIZE	128
+
+struct lck_rm_pcpu {
+	volatile int		lrp_readers;
+} __attribute__((aligned(LCK_RM_CACHE_LINE_SIZE)));
+
+void
+lck_rm_init(
+	lck_rm_t	*lck,
+	lck_grp_t	*grp,
+	lck_attr_t	*attr)
+{
+	vm_size_t size;
+
+	lck_rw_init(&lck->lck_rm_rw, grp, attr);
+	lck->lck_rm_owner = THREAD_NULL;
+	lck->lck_rm_ncpus = MAX_CPUS;
+
+	size = lck->lck_rm_ncpus * sizeof(struct lck_rm_pcpu);
+	lck->lck_rm_pcpu = kalloc(size);
+	if (lck->lck_rm_pcpu == NULL)
+		panic("lck_rm_init: no memory for %d cpu counts", lck->lck_rm_ncpus);
+	bzero(lck->lck_rm_pcpu, size);
+}
+
+void
+lck_rm_destroy(
+	lck_rm_t	*lck,
+	lck_grp_t	*grp)
+{
+	if (lck->lck_rm_pcpu == NULL)
+		return;
+#if MACH_LDEBUG
+	lck_rm_assert(lck, LCK_RM_ASSERT_NOTHELD);
+#endif
+	kfree(lck->lck_rm_pcpu, lck->lck_rm_ncpus * sizeof(struct lck_rm_pcpu));
+	lck->lck_rm_pcpu = NULL;
+	lck_rw_destroy(&lck->lck_rm_rw, grp);
+}
+
+static int
+lck_rm_readers(lck_rm_t *lck)
+{
+	unsigned int i;
+	int readers = 0;
+
+	for (i = 0; i < lck->lck_rm_ncpus; i++)
+		readers += os_atomic_load(&lck->lck_rm_pcpu[i].lrp_readers, relaxed);
+	return readers;
+}
+
+void
+lck_rm_lock_shared(
+	lck_rm_t	*lck)
+{
+	struct lck_rm_pcpu *pcpu;
+
+	disable_preemption();
+	pcpu = &lck->lck_rm_pcpu[cpu_number()];
+	os_atomic_inc(&pcpu->lrp_readers, relaxed);
+	os_atomic_thread_fence(seq_cst);
+	if (__probable(lck->lck_rm_owner == THREAD_NULL)) {
+		enable_preemption();
+#if	CONFIG_DTRACE
+		LOCKSTAT_RECORD(LS_LCK_RM_LOCK_SHARED_ACQUIRE, lck, 0);
+#endif
+		return;
+	}
+
+	/* a writer is coming: get out of its way and queue up behind it */
+	os_atomic_dec(&pcpu->lrp_readers, seq_cst);
+	enable_preemption();
+	thread_wakeup((event_t)&lck->lck_rm_owner);
+
+	lck_rw_lock_shared(&lck->lck_rm_rw);
+	disable_preemption();
+	os_atomic_inc(&lck->lck_rm_pcpu[cpu_number()].lrp_readers, relaxed);
+	enable_preemption();
+	lck_rw_unlock_shared(&lck->lck_rm_rw);
+#if	CONFIG_DTRACE
+	LOCKSTAT_RECORD(LS_LCK_RM_LOCK_SHARED_ACQUIRE, lck, 1);
+#endif
+}
+
+void
+lck_rm_unlock_shared(
+	lck_rm_t	*lck)
+{
+	disable_preemption();
+	os_atomic_dec(&lck->lck_rm_pcpu[cpu_number()].lrp_readers, seq_cst);
+	enable_preemption();
+	if (__improbable(lck->lck_rm_owner != THREAD_NULL))
+		thread_wakeup((event_t)&lck->lck_rm_owner);
+#if	CONFIG_DTRACE
+	LOCKSTAT_RECORD(LS_LCK_RM_DONE_RELEASE, lck, 0);
+#endif
+}
+
+void
+lck_rm_lock_exclusive(
+	lck_rm_t	*lck)
+{
+#if	CONFIG_DTRACE
+	uint64_t start = 0;
+#endif
+
+	lck_rw_lock_exclusive(&lck->lck_rm_rw);
+	os_atomic_store(&lck->lck_rm_owner, current_thread(), relaxed);
+	os_atomic_thread_fence(seq_cst);
+
+	while (lck_rm_readers(lck) != 0) {
+#if	CONFIG_DTRACE
+		if (start == 0 && lockstat_probemap[LS_LCK_RM_LOCK_EXCL_BLOCK])
+			start = mach_absolute_time();
+#endif
+		assert_wait((event_t)&lck->lck_rm_owner, THREAD_UNINT);
+		if (lck_rm_readers(lck) == 0) {
+			clear_wait(current_thread(), THREAD_AWAKENED);
+			break;
+		}
+		thread_block(THREAD_CONTINUE_NULL);
+	}
+
+#if	CONFIG_DTRACE
+	if (start != 0)
+		LOCKSTAT_RECORD(LS_LCK_RM_LOCK_EXCL_BLOCK, lck, mach_absolute_time() - start);
+	LOCKSTAT_RECORD(LS_LCK_RM_LOCK_EXCL_ACQUIRE, lck, 0);
+#endif
+}
+
+void
+lck_rm_unlock_exclusive(
+	lck_rm_t	*lck)
+{
+	assert(lck->lck_rm_owner == current_thread());
+	os_atomic_store(&lck->lck_rm_owner, THREAD_NULL, release);
+	lck_rw_unlock_exclusive(&lck->lck_rm_rw);
+#if	CONFIG_DTRACE
+	LOCKSTAT_RECORD(LS_LCK_RM_DONE_RELEASE, lck, 1);
+#endif
+}
+
+lck_rw_type_t
+lck_rm_done(
+	lck_rm_t	*lck)
+{
+	if (lck->lck_rm_owner == current_thread()) {
+		lck_rm_unlock_exclusive(lck);
+		return LCK_RW_TYPE_EXCLUSIVE;
+	}
+	lck_rm_unlock_shared(lck);
+	return LCK_RW_TYPE_SHARED;
+}
+
+void
+lck_rm_assert(
+	lck_rm_t	*lck,
+	unsigned int	type)
+{
+	thread_t owner = lck->lck_rm_owner;
+
+	switch (type) {
+	case LCK_RM_ASSERT_HELD:
+		if (owner == current_thread() || lck_rm_readers(lck) > 0)
+			return;
+		break;
+	case LCK_RM_ASSERT_EXCLUSIVE:
+		if (owner == current_thread())
+			return;
+		break;
+	case LCK_RM_ASSERT_NOTHELD:
+		if (owner != current_thread())
+			return;
+		break;
+	default:
+		break;
+	}
+	panic("lck_rm_assert(): lock %p, owner %p, type %u", lck, owner, type);
+}
+
 /*
  * Atomic primitives, prototyped in kern/simple_lock.h
  * Noret versions are more efficient on some architectures
@@ -79,9 +79,10 @@ typedef struct {
 	uint64_t			lck_grp_mtx_held_cnt;
 	uint64_t			lck_grp_mtx_miss_cnt;
 	uint64_t			lck_grp_mtx_wait_cnt;
-	/* Rest currently unused */
+	/* Currently unused */
 	uint64_t			lck_grp_mtx_held_max;
 	uint64_t			lck_grp_mtx_held_cum;
+	/* Sampled waits of extended mutexes, see lck_mtx_contention_end */
 	uint64_t			lck_grp_mtx_wait_max;
 	uint64_t			lck_grp_mtx_wait_cum;
 } lck_grp_mtx_stat_t;
@@ -428,6 +429,26 @@ extern boolean_t		lck_mtx_ilk_try_lock(
 
 extern void lck_mtx_wakeup_adjust_pri(thread_t thread, integer_t priority);
 
+/* adaptive spinning, see locks.c */
+extern int				lck_mtx_adaptive_spin;
+extern uint64_t				lck_mtx_spin_avg;
+extern uint64_t				lck_mtx_spin_window(void);
+extern void				lck_mtx_spin_update(
+									uint64_t		spun);
+
+/* sampled contention, see locks.c */
+extern uint64_t				lck_mtx_contention_begin(void);
+extern void				lck_mtx_contention_end(
+									lck_mtx_t		*lck,
+									lck_grp_t		*grp,
+									uint64_t		start);
+
+#endif
+
+#ifdef XNU_KERNEL_PRIVATE
+#define LCK_MTX_CONTENTION_BUCKETS	32
+extern uint32_t				lck_mtx_contention_rate;
+extern uint64_t				lck_mtx_contention_hist[LCK_MTX_CONTENTION_BUCKETS];
 #endif
 
 #define decl_lck_rw_data(class,name)     class lck_rw_t name;
@@ -541,6 +562,69 @@ extern boolean_t		lck_rw_try_lock_exclusive(
 									lck_rw_t		*lck);
 #endif
 
+#ifdef	XNU_KERNEL_PRIVATE
+/*
+ * Read-mostly locks
+ *
+ * Shared acquisitions only touch a per-cpu reader count, so readers on
+ * different processors don't contend on a cache line. Exclusive acquisitions
+ * are expensive: they wait for all the readers to drain and may block.
+ * Shared holders may block, but may not recursively take the lock shared.
+ */
+struct lck_rm_pcpu;
+
+typedef struct _lck_rm_ {
+	lck_rw_t			lck_rm_rw;	/* writers, and readers while a writer is active */
+	thread_t volatile		lck_rm_owner;	/* writer waiting for or holding the lock */
+	unsigned int			lck_rm_ncpus;
+	struct lck_rm_pcpu		*lck_rm_pcpu;	/* per-cpu reader counts */
+} lck_rm_t;
+
+#define decl_lck_rm_data(class,name)     class lck_rm_t name;
+
+#define LCK_RM_ASSERT_HELD	0x01
+#define LCK_RM_ASSERT_EXCLUSIVE	0x02
+#define LCK_RM_ASSERT_NOTHELD	0x03
+
+extern void				lck_rm_init(
+									lck_rm_t		*lck,
+									lck_grp_t		*grp,
+									lck_attr_t		*attr);
+
+extern void				lck_rm_destroy(
+									lck_rm_t		*lck,
+									lck_grp_t		*grp);
+
+extern void				lck_rm_lock_shared(
+									lck_rm_t		*lck);
+
+extern void				lck_rm_unlock_shared(
+									lck_rm_t		*lck);
+
+extern void				lck_rm_lock_exclusive(
+									lck_rm_t		*lck);
+
+extern void				lck_rm_unlock_exclusive(
+									lck_rm_t		*lck);
+
+extern lck_rw_type_t	lck_rm_done(
+									lck_rm_t		*lck);
+
+/*
+ * Readers aren't tracked individually: LCK_RM_ASSERT_HELD only checks that
+ * the caller holds the lock exclusive or that some thread holds it shared.
+ */
+extern void				lck_rm_assert(
+									lck_rm_t		*lck,
+									unsigned int		type);
+
+#if MACH_ASSERT
+#define LCK_RM_ASSERT(lck,type) lck_rm_assert((lck),(type))
+#else /* MACH_ASSERT */
+#define LCK_RM_ASSERT(lck,type)
+#endif /* MACH_ASSERT */
+#endif	/* XNU_KERNEL_PRIVATE */
+
 __END_DECLS
 
 #endif /* _KERN_LOCKS_H_ */
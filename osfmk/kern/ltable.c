@@ -26,6 +26,7 @@
  * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
  */
 #include <kern/cpu_data.h>
+#include <kern/cpu_number.h>
 #include <kern/kern_types.h>
 #include <kern/locks.h>
 #include <kern/ltable.h>
@@ -34,6 +35,13 @@
 #include <pexpert/pexpert.h>
 #include <vm/vm_kern.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <i386/mp.h>
+#endif
+
+#if defined (__arm__) || defined (__arm64__)
+#include <arm/cpu_data_internal.h>
+#endif
 
 #define	P2ROUNDUP(x, align) (-(-((uint32_t)(x)) & -(align)))
 #define ROUNDDOWN(x,y)	(((x)/(y))*(y))
@@ -55,6 +63,26 @@ static lck_grp_t  g_lt_lck_grp;
 uint64_t g_lt_idx_max = LT_IDX_MAX;
 #endif
 
+/*
+ * Per-CPU element caches
+ *
+ * Each processor keeps a few free elements of every table, linked through
+ * 'lt_next_idx', so that most allocations and frees don't contend on the
+ * head of the table's free list.  The caches exchange elements with the
+ * free list LT_CACHE_BATCH at a time.  Cached elements are neither used
+ * nor available to other processors: they're counted in 'cached_elem'.
+ */
+#define LT_CACHE_LINE_SIZE  128
+#define LT_CACHE_BATCH      16
+#define LT_CACHE_MAX        (2 * LT_CACHE_BATCH)
+
+struct lt_cache {
+	uint32_t head;   /* index of the first cached element, or LT_IDX_MAX */
+	uint32_t avail;
+	uint64_t hits;
+	uint64_t misses;
+} __attribute__((aligned(LT_CACHE_LINE_SIZE)));
+
 
 /* construct a link table element from an offset and mask into a slab */
 #define lt_elem_ofst_slab(slab, slab_msk, ofst) \
@@ -179,6 +207,8 @@ void ltable_init(struct link_table *table, const char *name,
 	zone_t slab_zone;
 	size_t max_tbl_sz;
 	struct lt_elem *e, **base;
+	struct lt_cache *cache;
+	vm_size_t cache_sz;
 
 #ifndef CONFIG_LTABLE_STATS
 	/* the element size _must_ be a power of two! */
@@ -260,6 +290,16 @@ void ltable_init(struct link_table *table, const char *name,
 	e = lt_elem_ofst_slab(base[0], slab_msk, (slab_elem - 1) * elem_sz);
 	e->lt_next_idx = LT_IDX_MAX;
 
+	/* allocate the per-cpu caches of free elements, initially empty */
+	cache_sz = P2ROUNDUP(MAX_CPUS * sizeof(struct lt_cache), PAGE_SIZE);
+	kr = kernel_memory_allocate(kernel_map, (vm_offset_t *)&cache,
+				    cache_sz, 0, KMA_NOPAGEWAIT | KMA_ZERO, VM_KERN_MEMORY_LTABLE);
+	if (kr != KERN_SUCCESS)
+		panic("Cannot initialize %s table caches: "
+		      "kernel_memory_allocate failed:%d\n", name, kr);
+	for (int i = 0; i < MAX_CPUS; i++)
+		cache[i].head = LT_IDX_MAX;
+
 	lck_mtx_init(&table->lock, &g_lt_lck_grp, LCK_ATTR_NULL);
 
 	table->slab_sz = slab_sz;
@@ -271,6 +311,8 @@ void ltable_init(struct link_table *table, const char *name,
 	table->elem_sz = elem_sz;
 	table->nelem = slab_elem;
 	table->used_elem = 0;
+	table->cached_elem = 0;
+	table->cache = cache;
 	table->elem_sz = elem_sz;
 	table->poison = poison;
 
@@ -294,26 +336,19 @@ void ltable_init(struct link_table *table, const char *name,
 }
 
 
-/**
- * ltable_grow: grow a link table by adding another 'slab' of table elements
- *
+/*
  * Conditions:
- *	table mutex is unlocked
+ *	table mutex is locked
  *	calling thread can block
  */
-void ltable_grow(struct link_table *table, uint32_t min_free)
+static void ltable_grow_locked(struct link_table *table, uint32_t min_free)
 {
 	struct lt_elem *slab, **slot;
 	struct lt_elem *e = NULL, *first_new_elem, *last_new_elem;
 	struct ltable_id free_id;
 	uint32_t free_elem;
 
-	assert(get_preemption_level() == 0);
-	assert(table && table->slab_zone);
-
-	lck_mtx_lock(&table->lock);
-
-	free_elem = table->nelem - table->used_elem;
+	free_elem = ltable_nfree(table);
 
 	/*
 	 * If the caller just wanted to ensure a minimum number of elements,
@@ -322,10 +357,8 @@ void ltable_grow(struct link_table *table, uint32_t min_free)
 	 * priority thread who acquired the lock and grew the table before we
 	 * got here.
 	 */
-	if (free_elem > min_free) {
-		lck_mtx_unlock(&table->lock);
+	if (free_elem > min_free)
 		return;
-	}
 
 	/* we are now committed to table growth */
 	ltdbg_v("BEGIN");
@@ -335,9 +368,8 @@ void ltable_grow(struct link_table *table, uint32_t min_free)
 		 * before we panic, check one more time to see if any other
 		 * threads have free'd from space in the table.
 		 */
-		if ((table->nelem - table->used_elem) > 0) {
+		if (ltable_nfree(table) > 0) {
 			/* there's at least 1 free element: don't panic yet */
-			lck_mtx_unlock(&table->lock);
 			return;
 		}
 		panic("No more room to grow table: %p (nelem: %d, used: %d)",
@@ -399,12 +431,51 @@ void ltable_grow(struct link_table *table, uint32_t min_free)
 		last_new_elem->lt_next_idx = free_id.idx;
 	}
 	OSMemoryBarrier();
+}
 
+/**
+ * ltable_grow: grow a link table by adding another 'slab' of table elements
+ *
+ * Conditions:
+ *	table mutex is unlocked
+ *	calling thread can block
+ */
+void ltable_grow(struct link_table *table, uint32_t min_free)
+{
+	assert(get_preemption_level() == 0);
+	assert(table && table->slab_zone);
+
+	lck_mtx_lock(&table->lock);
+	ltable_grow_locked(table, min_free);
 	lck_mtx_unlock(&table->lock);
+}
 
-	return;
+/**
+ * ltable_try_grow: grow a link table, unless another thread already is
+ *
+ * Conditions:
+ *	table mutex is unlocked
+ *	calling thread can block
+ */
+void ltable_try_grow(struct link_table *table, uint32_t min_free)
+{
+	assert(get_preemption_level() == 0);
+	assert(table && table->slab_zone);
+
+	if (!lck_mtx_try_lock(&table->lock)) {
+		/*
+		 * Whoever holds the lock is growing the table: allocate from
+		 * what's left in the meantime rather than wait for the slab.
+		 */
+		if (ltable_nfree(table) > 0)
+			return;
+		lck_mtx_lock(&table->lock);
+	}
+	ltable_grow_locked(table, min_free);
+	lck_mtx_unlock(&table->lock);
 }
 
+
 #if DEVELOPMENT || DEBUG
 
 int
@@ -420,23 +491,114 @@ ltable_nelem(struct link_table *table)
 
 	return nelem;
 }
+
+void
+ltable_cache_stats(struct link_table *table, uint64_t *hits, uint64_t *misses)
+{
+	*hits = 0;
+	*misses = 0;
+	for (int i = 0; i < MAX_CPUS; i++) {
+		*hits += table->cache[i].hits;
+		*misses += table->cache[i].misses;
+	}
+}
 #endif
 
-/**
- * ltable_alloc_elem: allocate one or more elements from a given table
- *
- * The returned element(s) will be of type 'type', but will remain invalid.
- *
- * If the caller has disabled preemption, then this function may (rarely) spin
- * waiting either for another thread to either release 'nelem' table elements,
- * or grow the table.
- *
- * If the caller can block, then this function may (rarely) block while
- * the table grows to meet the demand for 'nelem' element(s).
+/*
+ * Push the list of free elements 'head' ... 'tail' onto the free list
+ * of 'table'.
  */
-__attribute__((noinline))
-struct lt_elem *ltable_alloc_elem(struct link_table *table, int type,
-				  int nelem, int nattempts)
+static void ltable_free_list_push(struct link_table *table,
+                                  struct lt_elem *head, struct lt_elem *tail)
+{
+	struct ltable_id free_id;
+
+again:
+	free_id = table->free_list;
+	if (free_id.idx >= table->nelem)
+		tail->lt_next_idx = LT_IDX_MAX;
+	else
+		tail->lt_next_idx = free_id.idx;
+
+	/* store barrier */
+	OSMemoryBarrier();
+	if (OSCompareAndSwap64(free_id.id, head->lt_id.id,
+			       &table->free_list.id) == FALSE)
+		goto again;
+}
+
+/*
+ * Take 'nelem' free elements from the current processor's cache.
+ * Returns NULL if the cache doesn't hold that many.
+ */
+static struct lt_elem *ltable_cache_alloc(struct link_table *table, int nelem)
+{
+	struct lt_cache *cache;
+	struct lt_elem *head, *tail;
+
+	disable_preemption();
+	cache = &table->cache[cpu_number()];
+	if (cache->avail < (uint32_t)nelem) {
+		cache->misses++;
+		enable_preemption();
+		return NULL;
+	}
+
+	head = tail = lt_elem_idx(table, cache->head);
+	for (int i = 1; i < nelem; i++)
+		tail = lt_elem_idx(table, tail->lt_next_idx);
+	cache->head = tail->lt_next_idx;
+	cache->avail -= nelem;
+	cache->hits++;
+	enable_preemption();
+
+	tail->lt_next_idx = LT_IDX_MAX;
+	OSAddAtomic(-nelem, &table->cached_elem);
+	return head;
+}
+
+/*
+ * Put the list of free elements 'head' ... 'tail' in the current
+ * processor's cache.  If that would overfill it, its oldest batch of
+ * elements goes back to the free list.
+ */
+static void ltable_cache_free(struct link_table *table, struct lt_elem *head,
+                              struct lt_elem *tail, int nelem)
+{
+	struct lt_cache *cache;
+	struct lt_elem *flush = NULL, *flush_tail = NULL;
+	int nflush = 0;
+
+	if (nelem > LT_CACHE_BATCH) {
+		ltable_free_list_push(table, head, tail);
+		return;
+	}
+
+	disable_preemption();
+	cache = &table->cache[cpu_number()];
+	if (cache->avail + nelem > LT_CACHE_MAX) {
+		flush = flush_tail = lt_elem_idx(table, cache->head);
+		for (nflush = 1; nflush < LT_CACHE_BATCH; nflush++)
+			flush_tail = lt_elem_idx(table, flush_tail->lt_next_idx);
+		cache->head = flush_tail->lt_next_idx;
+		cache->avail -= nflush;
+	}
+	tail->lt_next_idx = cache->head;
+	cache->head = head->lt_id.idx;
+	cache->avail += nelem;
+	enable_preemption();
+
+	OSAddAtomic(nelem - nflush, &table->cached_elem);
+	if (flush != NULL)
+		ltable_free_list_push(table, flush, flush_tail);
+}
+
+/*
+ * Take 'nelem' elements off the free list of 'table', growing the table
+ * if needed.  The elements are returned as a list, still free.
+ */
+static struct lt_elem *ltable_alloc_list(struct link_table *table,
+                                         int nelem, int nattempts)
 {
 	int nspins = 0, ntries = 0, nalloc = 0;
 	uint32_t table_size;
@@ -445,12 +607,6 @@ struct lt_elem *ltable_alloc_elem(struct link_table *table, int type,
 
 	static const int max_retries = 500;
 
-	if (type != LT_ELEM && type != LT_LINK && type != LT_RESERVED)
-		panic("link_table_aloc of invalid elem type:%d from table @%p",
-		      type, table);
-
-	assert(nelem > 0);
-
 	/*
 	 * If the callers only wants to try a certain number of times, make it
 	 * look like we've already made (MAX - nattempts) tries at allocation
@@ -472,15 +628,15 @@ try_again:
 			return NULL;
 		}
 
-		if (table->used_elem + nelem >= table_size)
-			panic("No more room to grow table: 0x%p size:%d, used:%d, requested elem:%d",
-			      table, table_size, table->used_elem, nelem);
+		if (table->used_elem + table->cached_elem + nelem >= table_size)
+			panic("No more room to grow table: 0x%p size:%d, used:%d, cached:%d, requested elem:%d",
+			      table, table_size, table->used_elem, table->cached_elem, nelem);
 		if (nelem == 1)
-			panic("Too many alloc retries: %d, table:%p, type:%d, nelem:%d",
-			      ntries, table, type, nelem);
+			panic("Too many alloc retries: %d, table:%p, nelem:%d",
+			      ntries, table, nelem);
 		/* don't panic: try allocating one-at-a-time */
 		while (nelem > 0) {
-			tmp = ltable_alloc_elem(table, type, 1, nattempts);
+			tmp = ltable_alloc_list(table, 1, nattempts);
 			if (elem)
 				lt_elem_list_link(table, tmp, elem);
 			elem = tmp;
@@ -493,7 +649,7 @@ try_again:
 	nalloc = 0;
 	table_size = table->nelem;
 
-	if (table->used_elem + nelem >= table_size) {
+	if (table->used_elem + table->cached_elem + nelem >= table_size) {
 		if (get_preemption_level() != 0) {
 #if CONFIG_LTABLE_STATS
 			table->nspins += 1;
@@ -548,15 +704,68 @@ try_again:
 
 	/*
 	 * After the CAS, we know that we own free_id, and it points to a
-	 * valid table entry (checked above). Grab the table pointer and
-	 * reset some values.
+	 * valid table entry (checked above).  End the list of allocated
+	 * elements and return its first element.
 	 */
-	OSAddAtomic(nelem, &table->used_elem);
-
-	/* end the list of allocated elements */
 	elem->lt_next_idx = LT_IDX_MAX;
-	/* reset 'elem' to point to the first allocated element */
-	elem = lt_elem_idx(table, free_id.idx);
+	return lt_elem_idx(table, free_id.idx);
+}
+
+/**
+ * ltable_alloc_elem: allocate one or more elements from a given table
+ *
+ * The returned element(s) will be of type 'type', but will remain invalid.
+ *
+ * If the caller has disabled preemption, then this function may (rarely) spin
+ * waiting either for another thread to either release 'nelem' table elements,
+ * or grow the table.
+ *
+ * If the caller can block, then this function may (rarely) block while
+ * the table grows to meet the demand for 'nelem' element(s).
+ */
+__attribute__((noinline))
+struct lt_elem *ltable_alloc_elem(struct link_table *table, int type,
+				  int nelem, int nattempts)
+{
+	struct lt_elem *elem, *tail, *rest;
+	int nalloc;
+
+	if (type != LT_ELEM && type != LT_LINK && type != LT_RESERVED)
+		panic("link_table_aloc of invalid elem type:%d from table @%p",
+		      type, table);
+
+	assert(nelem > 0);
+
+	elem = ltable_cache_alloc(table, nelem);
+	if (elem == NULL) {
+		/*
+		 * Refill the cache along with this allocation, unless the
+		 * table is running low: what's left of it is better left
+		 * to the other processors.
+		 */
+		nalloc = nelem;
+		if (nelem <= LT_CACHE_BATCH &&
+		    ltable_nfree(table) > LT_CACHE_MAX + (uint32_t)nelem)
+			nalloc += LT_CACHE_BATCH;
+
+		elem = ltable_alloc_list(table, nalloc, nattempts);
+		if (elem == NULL)
+			return NULL;
+
+		if (nalloc > nelem) {
+			tail = elem;
+			for (int i = 1; i < nelem; i++)
+				tail = lt_elem_idx(table, tail->lt_next_idx);
+			rest = lt_elem_idx(table, tail->lt_next_idx);
+			tail->lt_next_idx = LT_IDX_MAX;
+
+			for (tail = rest; tail->lt_next_idx != LT_IDX_MAX; )
+				tail = lt_elem_idx(table, tail->lt_next_idx);
+			ltable_cache_free(table, rest, tail, nalloc - nelem);
+		}
+	}
+
+	OSAddAtomic(nelem, &table->used_elem);
 
 	/*
 	 * Update the generation count, and return the element(s)
@@ -566,6 +775,7 @@ try_again:
 	 * subsequently marks the element as valid, then the put
 	 * will simply drop the reference.
 	 */
+	nalloc = nelem;
 	for (struct lt_elem *tmp = elem; ; ) {
 		assert(!lt_bits_valid(tmp->lt_bits) &&
 		       (lt_bits_refcnt(tmp->lt_bits) == 0));
@@ -650,8 +860,6 @@ void ltable_realloc_elem(struct link_table *table, struct lt_elem *elem, int typ
  */
 static void ltable_free_elem(struct link_table *table, struct lt_elem *elem)
 {
-	struct ltable_id next_id;
-
 	assert(lt_elem_in_range(elem, table) &&
 	       !lt_bits_valid(elem->lt_bits) &&
 	       (lt_bits_refcnt(elem->lt_bits) == 0));
@@ -670,18 +878,7 @@ static void ltable_free_elem(struct link_table *table, struct lt_elem *elem)
 	if (table->poison)
 		(table->poison)(table, elem);
 
-again:
-	next_id = table->free_list;
-	if (next_id.idx >= table->nelem)
-		elem->lt_next_idx = LT_IDX_MAX;
-	else
-		elem->lt_next_idx = next_id.idx;
-
-	/* store barrier */
-	OSMemoryBarrier();
-	if (OSCompareAndSwap64(next_id.id, elem->lt_id.id,
-			       &table->free_list.id) == FALSE)
-		goto again;
+	ltable_cache_free(table, elem, elem, 1);
 }
 
 
@@ -968,7 +1165,6 @@ int lt_elem_list_release(struct link_table *table, struct lt_elem *head,
                          int __assert_only type)
 {
 	struct lt_elem *elem;
-	struct ltable_id free_id;
 	int nelem = 0;
 
 	if (!head)
@@ -992,23 +1188,10 @@ int lt_elem_list_release(struct link_table *table, struct lt_elem *head,
 
 	/*
 	 * 'elem' now points to the end of our list, and 'head' points to the
-	 * beginning. We want to atomically swap the free list pointer with
-	 * the 'head' and ensure that 'elem' points to the previous free list
-	 * head.
+	 * beginning: hand the whole list back to this processor's cache (or
+	 * to the table's free list if it's too long to cache).
 	 */
-
-again:
-	free_id = table->free_list;
-	if (free_id.idx >= table->nelem)
-		elem->lt_next_idx = LT_IDX_MAX;
-	else
-		elem->lt_next_idx = free_id.idx;
-
-	/* store barrier */
-	OSMemoryBarrier();
-	if (OSCompareAndSwap64(free_id.id, head->lt_id.id,
-			       &table->free_list.id) == FALSE)
-		goto again;
+	ltable_cache_free(table, head, elem, nelem);
 
 	OSAddAtomic(-nelem, &table->used_elem);
 	return nelem;
@@ -116,6 +116,8 @@ enum lt_elem_type {
 struct link_table;
 typedef void (*ltable_poison_func)(struct link_table *, struct lt_elem *);
 
+struct lt_cache;
+
 /*
  * link_table structure
  *
@@ -139,6 +141,8 @@ struct link_table {
 
 	uint32_t         nelem;
 	uint32_t         used_elem;
+	uint32_t         cached_elem; /* free, but held by a per-cpu cache */
+	struct lt_cache *cache;       /* per-cpu caches of free elements */
 	zone_t           slab_zone;
 
 	ltable_poison_func poison;
@@ -191,6 +195,34 @@ extern void ltable_init(struct link_table *table, const char *name,
 extern void ltable_grow(struct link_table *table, uint32_t min_free);
 
 
+/**
+ * ltable_try_grow: grow a link table, unless another thread already is
+ *
+ * Unlike ltable_grow(), this doesn't wait for the thread growing the table
+ * as long as there are free elements left to allocate from.
+ *
+ * Conditions:
+ *	table mutex is unlocked
+ *	calling thread can block
+ */
+extern void ltable_try_grow(struct link_table *table, uint32_t min_free);
+
+
+/**
+ * ltable_nfree: number of elements available to all processors
+ *
+ * This doesn't account for the elements cached by each processor, which
+ * only that processor can allocate.  The values aren't read under any lock,
+ * so the result is only a hint.
+ */
+static inline uint32_t ltable_nfree(struct link_table *table)
+{
+	uint32_t used = table->used_elem + table->cached_elem;
+
+	return (used < table->nelem) ? table->nelem - used : 0;
+}
+
+
 /**
  * ltable_alloc_elem: allocate one or more elements from a given table
  *
@@ -215,6 +247,14 @@ struct lt_elem *ltable_alloc_elem(struct link_table *table, int type,
  */
 extern
 int ltable_nelem(struct link_table *table);
+
+/**
+ * ltable_cache_stats: returns how many allocations were satisfied from,
+ * or missed, the per-cpu caches of this table.
+ */
+extern
+void ltable_cache_stats(struct link_table *table,
+			uint64_t *hits, uint64_t *misses);
 #endif
 
 /**
@@ -41,6 +41,7 @@
 #include <kern/kern_types.h>
 #include <kern/assert.h>
 
+#include <kern/clock.h>
 #include <kern/host.h>
 #include <kern/kalloc.h>
 #include <kern/mach_node_link.h>
@@ -96,6 +97,7 @@ static void mach_node_publish(mach_node_t node);
 
 static mach_node_t mach_node_alloc_init(mach_node_id_t node_id);
 static kern_return_t mach_node_register(mach_node_t node);
+static void mnl_msg_handoff(mach_node_t node, mnl_msg_t msgs[], int count);
 
 
 /*	mach_node_init() is run lazily when a node link driver registers
@@ -755,10 +757,13 @@ unlock:
  *    flags     Currently unused; 0 should be passed
  */
 void
-mnl_msg_from_node(mnl_node_info_t   node    __unused,
+mnl_msg_from_node(mnl_node_info_t   node,
                   mnl_msg_t         msg,
                   uint32_t          flags   __unused)
 {
+	mach_node_t mnode = (mach_node_t)node;
+	uint64_t start = mach_absolute_time();
+
 	assert(MNL_MSG_VALID(msg));
 	assert(MACH_NODE_ID_VALID(msg->node_id));
 	assert(MNL_NODE_VALID(node));
@@ -781,6 +786,12 @@ mnl_msg_from_node(mnl_node_info_t   node    __unused,
 #endif
 			break;
 	}
+
+	MACH_NODE_LOCK(mnode);
+	mnode->link_stats.rx_msgs++;
+	mnode->link_stats.rx_bytes += MNL_MSG_SIZE + msg->size;
+	mnode->link_stats.rx_time += mach_absolute_time() - start;
+	MACH_NODE_UNLOCK(mnode);
 }
 
 
@@ -795,16 +806,87 @@ mnl_msg_from_node(mnl_node_info_t   node    __unused,
  *    flags     Currently unused; 0 should be passed
  */
 mnl_msg_t
-mnl_msg_to_node(mnl_node_info_t node    __unused,
+mnl_msg_to_node(mnl_node_info_t node,
                 uint32_t        flags   __unused)
 {
+	mnl_msg_t msg;
+
 	assert(MNL_NODE_VALID(node));
 
 #if DEBUG
     thread_set_thread_name(current_thread(), "MNL_Link");
 #endif
 
-	return flipc_msg_to_remote_node((mach_node_t)node, 0);
+	msg = flipc_msg_to_remote_node((mach_node_t)node, 0);
+	if (MNL_MSG_VALID(msg))
+		mnl_msg_handoff((mach_node_t)node, &msg, 1);
+	return msg;
+}
+
+
+/*  The link driver calls this to fetch up to <count> messages to transmit in
+ *  one go.  This function will block until at least one message is available,
+ *  then collect whatever else is already queued without blocking again.
+ *  Each message returned must be passed to mnl_msg_complete() once sent.
+ *
+ *  Arguments:
+ *    node      Pointer to the node's mnl_node structure
+ *    msgs      Array receiving the messages to transmit
+ *    count     Number of entries in <msgs>
+ *    flags     Currently unused; 0 should be passed
+ *
+ *  Return values:
+ *    0:        The link is to be terminated
+ *    *:        Number of messages stored in <msgs>
+ */
+int
+mnl_msg_to_node_batch(mnl_node_info_t   node,
+                      mnl_msg_t         msgs[],
+                      int               count,
+                      uint32_t          flags   __unused)
+{
+	mach_node_t mnode = (mach_node_t)node;
+	int n = 0;
+
+	assert(MNL_NODE_VALID(node));
+
+	if (count <= 0)
+		return 0;
+
+#if DEBUG
+    thread_set_thread_name(current_thread(), "MNL_Link");
+#endif
+
+	msgs[n] = flipc_msg_to_remote_node(mnode, 0);
+	while (MNL_MSG_VALID(msgs[n]) && ++n < count)
+		msgs[n] = flipc_msg_to_remote_node(mnode, FLIPC_MSG_NOWAIT);
+
+	if (n > 0)
+		mnl_msg_handoff(mnode, msgs, n);
+	return n;
+}
+
+
+/*  Accounts for <count> messages being handed to the link driver of <node>.
+ *  The hand-off time of each message is subtracted from tx_time and its
+ *  completion time added back by mnl_msg_complete(), so that tx_time sums
+ *  the latency of the messages without a per-message timestamp; see
+ *  mnl_get_link_stats() for the messages still in flight.
+ */
+static void
+mnl_msg_handoff(mach_node_t node, mnl_msg_t msgs[], int count)
+{
+	uint64_t bytes = 0;
+
+	for (int i = 0; i < count; i++)
+		bytes += MNL_MSG_SIZE + msgs[i]->size;
+
+	MACH_NODE_LOCK(node);
+	node->link_stats.tx_batches++;
+	node->link_stats.tx_msgs += count;
+	node->link_stats.tx_bytes += bytes;
+	node->link_stats.tx_time -= count * mach_absolute_time();
+	MACH_NODE_UNLOCK(node);
 }
 
 
@@ -817,10 +899,19 @@ mnl_msg_to_node(mnl_node_info_t node    __unused,
  *    flags     Currently unused; 0 should be passed
  */
 void
-mnl_msg_complete(mnl_node_info_t    node    __unused,
+mnl_msg_complete(mnl_node_info_t    node,
                  mnl_msg_t          msg,
                  uint32_t           flags)
 {
+    mach_node_t mnode = (mach_node_t)node;
+
+    if (MACH_NODE_VALID(mnode)) {
+        MACH_NODE_LOCK(mnode);
+        mnode->link_stats.tx_time += mach_absolute_time();
+        mnode->link_stats.tx_completed++;
+        MACH_NODE_UNLOCK(mnode);
+    }
+
     switch (msg->sub) {
         case MACH_NODE_SUB_NODE:
             mnl_msg_free(msg, flags);
@@ -838,6 +929,40 @@ mnl_msg_complete(mnl_node_info_t    node    __unused,
     }
 }
 
+
+/*  The link driver calls this to read a snapshot of the counters of the link
+ *  to <node>.
+ *
+ *  Arguments:
+ *    node      Pointer to the node's mnl_node structure
+ *    stats     Filled in with the link's counters
+ *    flags     Currently unused; 0 should be passed
+ *
+ *  Return values:
+ *    KERN_SUCCESS:           <stats> was filled in.
+ *    KERN_INVALID_ARGUMENT:  An argument value was not allowed.
+ */
+kern_return_t
+mnl_get_link_stats(mnl_node_info_t  node,
+                   mnl_link_stats_t stats,
+                   uint32_t         flags   __unused)
+{
+	mach_node_t mnode = (mach_node_t)node;
+
+	if (!MACH_NODE_VALID(mnode) || stats == NULL)
+		return KERN_INVALID_ARGUMENT;
+
+	MACH_NODE_LOCK(mnode);
+	*stats = mnode->link_stats;
+	MACH_NODE_UNLOCK(mnode);
+
+	/* tx_time still holds -(hand-off time) of the messages in flight */
+	stats->tx_time += (stats->tx_msgs - stats->tx_completed) *
+	                  mach_absolute_time();
+
+	return KERN_SUCCESS;
+}
+
 #else // MACH_FLIPC not configured, so provide KPI stubs
 
 mnl_msg_t
@@ -892,6 +1017,15 @@ mnl_msg_to_node(mnl_node_info_t node __unused, uint32_t flags __unused)
     return MNL_MSG_NULL;
 }
 
+int
+mnl_msg_to_node_batch(mnl_node_info_t   node    __unused,
+                      mnl_msg_t         msgs[]  __unused,
+                      int               count   __unused,
+                      uint32_t          flags   __unused)
+{
+    return 0;
+}
+
 void
 mnl_msg_complete(mnl_node_info_t    node    __unused,
                  mnl_msg_t          msg     __unused,
@@ -900,4 +1034,12 @@ mnl_msg_complete(mnl_node_info_t    node    __unused,
     return;
 }
 
+kern_return_t
+mnl_get_link_stats(mnl_node_info_t  node    __unused,
+                   mnl_link_stats_t stats   __unused,
+                   uint32_t         flags   __unused)
+{
+    return KERN_FAILURE;
+}
+
 #endif // MACH_FLIPC
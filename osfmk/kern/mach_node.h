@@ -125,6 +125,9 @@ struct mach_node {
     /* Misc */
     int             proto_vers;     // Protocol version in use for this node
     mach_node_t     antecedent;     // Pointer to prior encarnation of this node id
+
+    /* Link counters, see mnl_get_link_stats() */
+    struct mnl_link_stats link_stats;
 };
 
 extern mach_node_t  localnode;      // This node's mach_node_t struct
@@ -247,6 +247,30 @@ mnl_msg_t mnl_msg_to_node(mnl_node_info_t   node,
                           uint32_t          flags);
 
 
+/*  The link driver calls this to fetch up to <count> messages to transmit in
+ *  one go, so that a transport which can post several buffers at once (a
+ *  shared memory ring, an RDMA queue pair) doesn't take a round trip through
+ *  the mach_node layer per message.  This function will block until at least
+ *  one message is available, then collect whatever else is already queued
+ *  without blocking again.  Each message returned must be passed to
+ *  mnl_msg_complete() once it has been sent.
+ *
+ *  Arguments:
+ *    node      Pointer to the node's mnl_node structure
+ *    msgs      Array receiving the messages to transmit
+ *    count     Number of entries in <msgs>
+ *    flags     Currently unused; 0 should be passed
+ *
+ *  Return values:
+ *    0:        The link is to be terminated
+ *    *:        Number of messages stored in <msgs>
+ */
+int mnl_msg_to_node_batch(mnl_node_info_t   node,
+                          mnl_msg_t         msgs[],
+                          int               count,
+                          uint32_t          flags);
+
+
 /*  The link driver calls this to indicate that the specified msg buffer has
  *  been sent over the link and can be deallocated.
  *
@@ -259,6 +283,45 @@ void mnl_msg_complete(mnl_node_info_t   node,
                       mnl_msg_t         msg,
                       uint32_t          flags);
 
+
+/*** Mach Node Link Statistics Section ***/
+
+/*  Counters kept by the mach_node layer for each link, in both directions.
+ *  Sizes include the mnl_msg header.  Times are in mach_absolute_time()
+ *  units; <tx_time> is the time between messages being handed to the link
+ *  driver and their completion, <rx_time> the time spent delivering incoming
+ *  messages to their ports.  tx_time / tx_completed is a fair estimate of
+ *  the link's latency when few messages are in flight.
+ */
+typedef struct mnl_link_stats {
+    uint64_t    tx_msgs;        // Messages handed to the link driver
+    uint64_t    tx_bytes;       // Bytes handed to the link driver
+    uint64_t    tx_batches;     // Calls to mnl_msg_to_node[_batch]()
+    uint64_t    tx_completed;   // Messages passed to mnl_msg_complete()
+    uint64_t    tx_time;        // Total time from hand-off to completion,
+                                // or to now for the messages in flight
+    uint64_t    rx_msgs;        // Messages delivered by the link driver
+    uint64_t    rx_bytes;       // Bytes delivered by the link driver
+    uint64_t    rx_time;        // Total time spent delivering messages
+} *mnl_link_stats_t;
+
+
+/*  The link driver calls this to read a snapshot of the counters of the link
+ *  to <node>, e.g. to report the throughput and latency of its transport.
+ *
+ *  Arguments:
+ *    node      Pointer to the node's mnl_node structure
+ *    stats     Filled in with the link's counters
+ *    flags     Currently unused; 0 should be passed
+ *
+ *  Return values:
+ *    KERN_SUCCESS:           <stats> was filled in.
+ *    KERN_INVALID_ARGUMENT:  An argument value was not allowed.
+ */
+kern_return_t mnl_get_link_stats(mnl_node_info_t    node,
+                                 mnl_link_stats_t   stats,
+                                 uint32_t           flags);
+
 __END_DECLS
 
 #endif  /* KERNEL_PRIVATE */
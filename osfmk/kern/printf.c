@@ -728,10 +728,16 @@ printf_init(void)
 	bsd_log_init();
 }
 
+/* times bsd_log_lock() found the log already locked */
+uint32_t bsd_log_lock_wait_count = 0;
+
 void
 bsd_log_lock(void)
 {
-	simple_lock(&bsd_log_spinlock);
+	if (!simple_lock_try(&bsd_log_spinlock)) {
+		(void)hw_atomic_add(&bsd_log_lock_wait_count, 1);
+		simple_lock(&bsd_log_spinlock);
+	}
 }
 
 void
@@ -74,6 +74,8 @@
 #include <kern/thread.h>
 #include <kern/processor.h>
 #include <kern/ledger.h>
+#include <kern/coalition.h>
+#include <kern/ast.h>
 #include <machine/machparam.h>
 #include <kern/machine.h>
 
@@ -140,6 +142,16 @@ thread_quantum_expire(
 	commpage_update_mach_approximate_time(ctime);
 #endif
 
+	/*
+	 * Charge the quantum to the coalition's CPU quota too; going over
+	 * makes the thread wait on its way back to user space.
+	 */
+	if (thread->task != kernel_task &&
+	    task_coalition_cpu_quota_charge(thread->task, thread->quantum_remaining, ctime)) {
+		thread_ast_set(thread, AST_CPU_QUOTA);
+		ast_propagate(thread);
+	}
+
 #if MONOTONIC
 	mt_sched_update(thread);
 #endif /* MONOTONIC */
@@ -178,7 +178,7 @@ typedef struct sched_entry {
 	queue_chain_t           entry_links;
 	int16_t                 sched_pri;      /* scheduled (current) priority */
 	int16_t                 runq;
-	int32_t 		pad;
+	uint32_t                enqueue_tick;   /* sched_tick the entry was last enqueued at */
 } *sched_entry_t;
 
 typedef run_queue_t entry_queue_t;                      /* A run queue that holds sched_entries instead of threads */
@@ -192,6 +192,8 @@ struct sched_group {
 	struct sched_entry      entries[NRQS];
 	struct run_queue        runq;
 	queue_chain_t           sched_groups;
+	uint64_t                usage;          /* decayed CPU time charged to the group (pset lock) */
+	uint32_t                usage_tick;     /* sched_tick the usage was last decayed at */
 };
 
 /*
@@ -224,6 +226,31 @@ static integer_t        drain_depth_limit;
 #define DEFAULT_DRAIN_CEILING BASEPRI_FOREGROUND
 static integer_t        drain_ceiling;
 
+/*
+ * Clutch mode: threads at the same priority are shared between their
+ * groups by recent CPU usage rather than in FIFO order, and groups that
+ * have been kept off the processor for longer than the starvation window
+ * by higher priority ones get a turn.
+ */
+static boolean_t        group_fairness = FALSE;
+
+/*
+ * How many sched_ticks an entry can wait behind higher priorities
+ * before it runs ahead of them.  Zero disables starvation avoidance.
+ */
+#define DEFAULT_STARVATION_WINDOW 2
+static uint32_t         starvation_window;
+static uint32_t         starvation_scan_tick;
+
+/*
+ * Don't look further than this many entries into a priority level
+ * for the least busy group.
+ */
+#define FAIRNESS_SCAN_LIMIT 8
+
+/* A group's usage is halved every (1 << SCHED_GROUP_USAGE_DECAY_SHIFT) sched_ticks */
+#define SCHED_GROUP_USAGE_DECAY_SHIFT SCHED_TICK_SHIFT
+
 static struct zone      *sched_group_zone;
 
 static uint64_t         num_sched_groups = 0;
@@ -290,6 +317,9 @@ sched_multiq_initial_thread_sched_mode(task_t parent_task);
 static bool
 sched_multiq_thread_avoid_processor(processor_t processor, thread_t thread);
 
+static void
+sched_clutch_init(void);
+
 const struct sched_dispatch_table sched_multiq_dispatch = {
 	.sched_name                                     = "multiq",
 	.init                                           = sched_multiq_init,
@@ -338,6 +368,54 @@ const struct sched_dispatch_table sched_multiq_dispatch = {
 	.thread_should_yield                            = sched_thread_should_yield,
 };
 
+const struct sched_dispatch_table sched_clutch_dispatch = {
+	.sched_name                                     = "clutch",
+	.init                                           = sched_clutch_init,
+	.timebase_init                                  = sched_timeshare_timebase_init,
+	.processor_init                                 = sched_multiq_processor_init,
+	.pset_init                                      = sched_multiq_pset_init,
+	.maintenance_continuation                       = sched_timeshare_maintenance_continue,
+	.choose_thread                                  = sched_multiq_choose_thread,
+	.steal_thread_enabled                           = FALSE,
+	.steal_thread                                   = sched_multiq_steal_thread,
+	.compute_timeshare_priority                     = sched_compute_timeshare_priority,
+	.choose_processor                               = choose_processor,
+	.processor_enqueue                              = sched_multiq_processor_enqueue,
+	.processor_queue_shutdown                       = sched_multiq_processor_queue_shutdown,
+	.processor_queue_remove                         = sched_multiq_processor_queue_remove,
+	.processor_queue_empty                          = sched_multiq_processor_queue_empty,
+	.priority_is_urgent                             = priority_is_urgent,
+	.processor_csw_check                            = sched_multiq_processor_csw_check,
+	.processor_queue_has_priority                   = sched_multiq_processor_queue_has_priority,
+	.initial_quantum_size                           = sched_timeshare_initial_quantum_size,
+	.initial_thread_sched_mode                      = sched_multiq_initial_thread_sched_mode,
+	.can_update_priority                            = can_update_priority,
+	.update_priority                                = update_priority,
+	.lightweight_update_priority                    = lightweight_update_priority,
+	.quantum_expire                                 = sched_multiq_quantum_expire,
+	.processor_runq_count                           = sched_multiq_runq_count,
+	.processor_runq_stats_count_sum                 = sched_multiq_runq_stats_count_sum,
+	.processor_bound_count                          = sched_multiq_processor_bound_count,
+	.thread_update_scan                             = sched_multiq_thread_update_scan,
+	.direct_dispatch_to_idle_processors             = FALSE,
+	.multiple_psets_enabled                         = FALSE,
+	.sched_groups_enabled                           = TRUE,
+	.avoid_processor_enabled                        = TRUE,
+	.thread_avoid_processor                         = sched_multiq_thread_avoid_processor,
+	.processor_balance                              = sched_SMT_balance,
+
+	.rt_runq                                        = sched_rtglobal_runq,
+	.rt_init                                        = sched_rtglobal_init,
+	.rt_queue_shutdown                              = sched_rtglobal_queue_shutdown,
+	.rt_runq_scan                                   = sched_rtglobal_runq_scan,
+	.rt_runq_count_sum                              = sched_rtglobal_runq_count_sum,
+
+	.qos_max_parallelism                            = sched_qos_max_parallelism,
+	.check_spill                                    = sched_check_spill,
+	.ipi_policy                                     = sched_ipi_policy,
+	.thread_should_yield                            = sched_thread_should_yield,
+};
+
 
 static void
 sched_multiq_init(void)
@@ -382,6 +460,20 @@ sched_multiq_init(void)
 	sched_timeshare_init();
 }
 
+static void
+sched_clutch_init(void)
+{
+	group_fairness = TRUE;
+
+	if (!PE_parse_boot_argn("clutch_starvation_window", &starvation_window, sizeof(starvation_window))) {
+		starvation_window = DEFAULT_STARVATION_WINDOW;
+	}
+
+	printf("clutch scheduler config: starvation window %d\n", starvation_window);
+
+	sched_multiq_init();
+}
+
 static void
 sched_multiq_processor_init(processor_t processor)
 {
@@ -421,6 +513,7 @@ sched_group_create(void)
 		sched_group->entries[i].runq = 0;
 		sched_group->entries[i].sched_pri = i;
 	}
+	sched_group->usage_tick = sched_tick;
 
 	lck_mtx_lock(&sched_groups_lock);
 	queue_enter(&sched_groups, sched_group, sched_group_t, sched_groups);
@@ -486,6 +579,23 @@ group_for_entry(sched_entry_t entry)
 	return group;
 }	
 
+/*
+ * Decay and return the CPU time charged to the group.
+ * pset is locked.
+ */
+static uint64_t
+sched_group_usage(sched_group_t group)
+{
+	uint32_t periods = (sched_tick - group->usage_tick) >> SCHED_GROUP_USAGE_DECAY_SHIFT;
+
+	if (periods != 0) {
+		group->usage = (periods < 64) ? (group->usage >> periods) : 0;
+		group->usage_tick += periods << SCHED_GROUP_USAGE_DECAY_SHIFT;
+	}
+
+	return group->usage;
+}
+
 /* Peek at the head of the runqueue */
 static sched_entry_t
 entry_queue_first_entry(entry_queue_t rq)
@@ -686,6 +796,7 @@ entry_queue_enqueue_entry(
 	rq->count++;
 
 	entry->runq = MULTIQ_ERUNQ;
+	entry->enqueue_tick = sched_tick;
 
 	return (result);
 }
@@ -917,6 +1028,107 @@ sched_global_deep_drain_dequeue_thread(entry_queue_t main_entryq)
 	return thread;
 }
 
+/*
+ * Dequeue the first thread at the entry's priority in its group,
+ * and cycle the entry to the end of its level if there are more.
+ */
+static thread_t
+sched_entry_dequeue_thread(
+                           entry_queue_t main_entryq,
+                           sched_entry_t entry)
+{
+	sched_group_t group = group_for_entry(entry);
+	integer_t thread_pri = entry->sched_pri;
+	boolean_t pri_level_empty;
+	thread_t thread;
+
+	thread = qe_queue_first(&group->runq.queues[thread_pri], struct thread, runq_links);
+	assert(thread != THREAD_NULL);
+
+	pri_level_empty = group_run_queue_remove_thread(&group->runq, thread, thread_pri);
+
+	entry_queue_remove_entry(main_entryq, entry);
+	if (!pri_level_empty) {
+		entry_queue_enqueue_entry(main_entryq, entry, SCHED_TAILQ);
+	}
+
+	return thread;
+}
+
+/*
+ * Find an entry at or above priority that has waited longer than the
+ * starvation window behind higher priorities.  Levels above UI priority
+ * are strict and are never passed over.  Only looks once per sched_tick,
+ * which bounds both the cost and the share starved entries take.
+ */
+static sched_entry_t
+sched_clutch_starved_entry(
+                           entry_queue_t main_entryq,
+                           int           priority)
+{
+	if (starvation_window == 0 || starvation_scan_tick == sched_tick ||
+	    main_entryq->highq > BASEPRI_FOREGROUND)
+		return SCHED_ENTRY_NULL;
+
+	starvation_scan_tick = sched_tick;
+
+	for (int pri = bitmap_next(main_entryq->bitmap, main_entryq->highq);
+	     pri >= priority;
+	     pri = bitmap_next(main_entryq->bitmap, pri)) {
+		sched_entry_t entry = qe_queue_first(&main_entryq->queues[pri],
+		                                     struct sched_entry, entry_links);
+
+		if (sched_tick - entry->enqueue_tick >= starvation_window)
+			return entry;
+	}
+
+	return SCHED_ENTRY_NULL;
+}
+
+/*
+ * Pick the entry of the least busy group among the first few at
+ * the highest priority level.
+ */
+static sched_entry_t
+sched_clutch_fair_entry(entry_queue_t main_entryq)
+{
+	queue_t queue = &main_entryq->queues[main_entryq->highq];
+	sched_entry_t entry, best = SCHED_ENTRY_NULL;
+	uint64_t best_usage = UINT64_MAX;
+	int scanned = 0;
+
+	qe_foreach_element(entry, queue, entry_links) {
+		uint64_t usage = sched_group_usage(group_for_entry(entry));
+
+		if (usage < best_usage) {
+			best = entry;
+			best_usage = usage;
+		}
+		if (++scanned == FAIRNESS_SCAN_LIMIT)
+			break;
+	}
+
+	assert(best != SCHED_ENTRY_NULL);
+	return best;
+}
+
+static thread_t
+sched_clutch_dequeue_thread(
+                            entry_queue_t main_entryq,
+                            int           priority)
+{
+	sched_entry_t entry = sched_clutch_starved_entry(main_entryq, priority);
+
+	if (entry != SCHED_ENTRY_NULL) {
+		KERNEL_DEBUG_CONSTANT_IST(KDEBUG_TRACE,
+		    MACHDBG_CODE(DBG_MACH_SCHED, MACH_MULTIQ_DEQUEUE) | DBG_FUNC_NONE,
+		    MACH_MULTIQ_STARVED, main_entryq->highq, entry->sched_pri, 0, 0);
+	} else {
+		entry = sched_clutch_fair_entry(main_entryq);
+	}
+
+	return sched_entry_dequeue_thread(main_entryq, entry);
+}
 
 static thread_t
 sched_group_dequeue_thread(
@@ -1117,7 +1329,9 @@ sched_multiq_choose_thread(
 	    MACH_MULTIQ_GLOBAL, main_entryq->highq, group->runq.highq, 0, 0);
 
 	/* Couldn't pull from local runq, pull from global runq instead */
-	if (deep_drain) {
+	if (group_fairness) {
+		return sched_clutch_dequeue_thread(main_entryq, priority);
+	} else if (deep_drain) {
 		return sched_global_deep_drain_dequeue_thread(main_entryq);
 	} else {
 		return sched_global_dequeue_thread(main_entryq);
@@ -1165,22 +1379,35 @@ sched_multiq_processor_enqueue(
 void
 sched_multiq_quantum_expire(thread_t thread)
 {
-	if (deep_drain) {
-		/*
-		 * Move the entry at this priority to the end of the queue,
-		 * to allow the next task a shot at running.
-		 */
-
+	if (deep_drain || group_fairness) {
 		processor_t processor = thread->last_processor;
 		processor_set_t pset = processor->processor_set;
 		entry_queue_t entryq = multiq_main_entryq(processor);
 
 		pset_lock(pset);
 
-		sched_entry_t entry = group_entry_for_pri(thread->sched_group, processor->current_pri);
+		if (deep_drain) {
+			/*
+			 * Move the entry at this priority to the end of the queue,
+			 * to allow the next task a shot at running.
+			 */
+			sched_entry_t entry = group_entry_for_pri(thread->sched_group, processor->current_pri);
+
+			if (entry->runq == MULTIQ_ERUNQ) {
+				entry_queue_change_entry(entryq, entry, SCHED_TAILQ);
+			}
+		}
+
+		if (group_fairness) {
+			/*
+			 * Charge the group for the quantum it used up.  Threads that
+			 * block before their quantum ends aren't charged, which keeps
+			 * interactive groups ahead of the ones that compute.
+			 */
+			sched_group_t group = thread->sched_group;
 
-		if (entry->runq == MULTIQ_ERUNQ) {
-			entry_queue_change_entry(entryq, entry, SCHED_TAILQ);
+			(void)sched_group_usage(group);
+			group->usage += SCHED(initial_quantum_size)(thread);
 		}
 
 		pset_unlock(pset);
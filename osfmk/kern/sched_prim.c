@@ -108,6 +108,8 @@
 #include <kern/policy_internal.h>
 #include <kern/cpu_quiesce.h>
 
+#include <machine/commpage.h>
+
 #include <vm/pmap.h>
 #include <vm/vm_kern.h>
 #include <vm/vm_map.h>
@@ -332,6 +334,8 @@ sched_init_override(void)
 			sched_current_dispatch = &sched_multiq_dispatch;
 		} else if (0 == strcmp(sched_arg, sched_dualq_dispatch.sched_name)) {
 			sched_current_dispatch = &sched_dualq_dispatch;
+		} else if (0 == strcmp(sched_arg, sched_clutch_dispatch.sched_name)) {
+			sched_current_dispatch = &sched_clutch_dispatch;
 #endif
 		} else {
 #if defined(CONFIG_SCHED_TRADITIONAL)
@@ -2323,6 +2327,8 @@ thread_invoke(
 					thread->ps_switch++;
 				thread->p_switch++;
 			}
+			if (thread->affinity_set != AFFINITY_SET_NULL)
+				thread_affinity_dispatch(thread, processor);
 			thread->last_processor = processor;
 			thread->c_switch++;
 			ast_context(thread);
@@ -2455,6 +2461,8 @@ need_stack:
 			thread->ps_switch++;
 		thread->p_switch++;
 	}
+	if (thread->affinity_set != AFFINITY_SET_NULL)
+		thread_affinity_dispatch(thread, processor);
 	thread->last_processor = processor;
 	thread->c_switch++;
 	ast_context(thread);
@@ -2638,6 +2646,34 @@ thread_csw_callout(
 		same_pri_latency, old, new);
 }
 
+/*
+ *	thread_update_runq_latency:
+ *
+ *	Account for the time a thread spent between being made
+ *	runnable and going on core, for THREAD_SCHED_LATENCY_INFO.
+ *
+ *	Called at splsched with the thread locked.
+ */
+static void
+thread_update_runq_latency(
+	thread_t		thread,
+	uint64_t		latency)
+{
+	uint64_t	ns, us;
+	unsigned int	bucket = 0;
+
+	absolutetime_to_nanoseconds(latency, &ns);
+
+	thread->runq_latency_count++;
+	thread->runq_latency_total += ns;
+	if (ns > thread->runq_latency_max)
+		thread->runq_latency_max = ns;
+
+	us = ns / NSEC_PER_USEC;
+	while ((us >>= 1) != 0 && bucket < THREAD_SCHED_LATENCY_BUCKETS - 1)
+		bucket++;
+	thread->runq_latency_hist[bucket]++;
+}
 
 /*
  *	thread_dispatch:
@@ -2835,6 +2871,9 @@ thread_dispatch(
 					}
 				}
 
+				if (reason & AST_PREEMPT)
+					thread->preempt_count++;
+
 				if (reason & AST_QUANTUM)
 					options |= SCHED_TAILQ;
 				else if (reason & AST_PREEMPT)
@@ -2948,6 +2987,8 @@ thread_dispatch(
 		latency = processor->last_dispatch - self->last_made_runnable_time;
 		assert(latency >= self->same_pri_latency);
 
+		thread_update_runq_latency(self, latency);
+
 		urgency = thread_get_urgency(self, &arg1, &arg2);
 
 		thread_tell_urgency(urgency, arg1, arg2, latency, self);
@@ -2979,6 +3020,16 @@ thread_dispatch(
 	self->reason = AST_NONE;
 	processor->starting_pri = self->sched_pri;
 
+	/*
+	 * Publish the runtime of an opted-in thread in the commpage entry of
+	 * this cpu, and clear the entry of whoever ran here before otherwise.
+	 */
+	commpage_update_thread_usage(cpu_number(),
+	    (self->options & TH_OPT_COMMPAGE_USAGE) ? self->thread_id : 0,
+	    self->c_switch,
+	    timer_grab(&self->user_timer) + timer_grab(&self->system_timer),
+	    processor->last_dispatch);
+
 	thread_unlock(self);
 
 	machine_thread_going_on_core(self, urgency, latency, self->same_pri_latency,
@@ -771,6 +771,7 @@ extern const struct sched_dispatch_table sched_traditional_with_pset_runqueue_di
 #if defined(CONFIG_SCHED_MULTIQ)
 extern const struct sched_dispatch_table sched_multiq_dispatch;
 extern const struct sched_dispatch_table sched_dualq_dispatch;
+extern const struct sched_dispatch_table sched_clutch_dispatch;
 #endif
 
 #if defined(CONFIG_SCHED_PROTO)
@@ -689,8 +689,8 @@ sched_traditional_steal_thread(processor_set_t pset)
 	thread_t        thread;
 
 	do {
-		uint64_t active_map = (pset->cpu_state_map[PROCESSOR_RUNNING] |
-				       pset->cpu_state_map[PROCESSOR_DISPATCHING]);
+		uint64_t active_map = (cset->cpu_state_map[PROCESSOR_RUNNING] |
+				       cset->cpu_state_map[PROCESSOR_DISPATCHING]);
 		for (int cpuid = lsb_first(active_map); cpuid >= 0; cpuid = lsb_next(active_map, cpuid)) {
 			processor = processor_array[cpuid];
 			if (runq_for_processor(processor)->count > 0) {
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#include <machine/atomic.h>
+#include <machine/machine_routines.h>
+
+#include <kern/clock.h>
+#include <kern/cpu_number.h>
+#include <kern/kalloc.h>
+#include <kern/misc_protos.h>
+#include <kern/sched_prim.h>
+#include <kern/zalloc.h>
+
+#include <kern/smr.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <i386/mp.h>
+#endif
+
+#if defined (__arm__) || defined (__arm64__)
+#include <arm/cpu_data_internal.h>
+#endif
+
+#include <sys/kdebug.h>
+
+/*
+ * Safe memory reclamation, see kern/smr.h
+ *
+ * Ordering
+ *
+ * A reader publishes the write sequence it observed in its processor slot,
+ * then issues a full barrier before looking at the protected data.
+ * A writer unlinks an object, advances the write sequence with release
+ * semantics, and issues a full barrier before scanning the slots.
+ *
+ * If the scan misses a reader's slot, then that reader's accesses come
+ * after the unlink and it can't find the object.  If the reader observed
+ * the advanced sequence, its acquire load also orders it after the
+ * unlink.  Otherwise its slot holds an older sequence, which holds the
+ * object back until the reader leaves.
+ *
+ * The cpu_quiesce counter can't serve as the grace period here: it is only
+ * built on arm, and its checkins happen from the quantum timer, which can
+ * interrupt a read section.  Its guarantees are only about userspace.
+ *
+ * Reclamation
+ *
+ * smr_call() queues nodes on their domain in retirement order, and arms a
+ * thread call that runs the callbacks of every node whose goal has been
+ * reached, then rearms itself if nodes are still pending.
+ */
+
+#define SMR_CACHE_LINE_SIZE	128
+#define SMR_RECLAIM_DELAY_US	1000	/* between reclamation passes */
+#define SMR_RECLAIM_MAX		1024	/* nodes queued before reclaiming early */
+
+struct smr_pcpu {
+	volatile smr_seq_t	c_seq;		/* SMR_SEQ_INVALID when not in a section */
+} __attribute__((aligned(SMR_CACHE_LINE_SIZE)));
+
+struct smr smr_system;
+
+/* records for zfree_smr() */
+struct smr_zfree {
+	struct smr_node		szf_node;
+	zone_t			szf_zone;
+	void			*szf_elem;
+};
+
+static zone_t smr_zfree_zone;
+
+static void smr_reclaim(thread_call_param_t p0, thread_call_param_t p1);
+
+static void
+smr_reclaim_arm(smr_t smr)
+{
+	uint64_t deadline;
+
+	clock_interval_to_deadline(SMR_RECLAIM_DELAY_US, NSEC_PER_USEC, &deadline);
+	thread_call_enter_delayed(smr->smr_tcall, deadline);
+}
+
+void
+smr_init(smr_t smr, const char *name)
+{
+	vm_size_t size;
+
+	smr->smr_wr_seq = SMR_SEQ_INIT;
+	smr->smr_rd_seq = SMR_SEQ_INIT;
+	smr->smr_ncpus = MAX_CPUS;
+	smr->smr_name = name;
+
+	size = smr->smr_ncpus * sizeof(struct smr_pcpu);
+	smr->smr_pcpu = kalloc(size);
+	if (smr->smr_pcpu == NULL)
+		panic("smr_init: no memory for %s", name);
+	bzero(smr->smr_pcpu, size);
+
+	simple_lock_init(&smr->smr_lock, 0);
+	smr->smr_head = NULL;
+	smr->smr_tailp = &smr->smr_head;
+	smr->smr_pending = 0;
+	smr->smr_armed = FALSE;
+	smr->smr_tcall = thread_call_allocate_with_options(smr_reclaim, smr,
+	    THREAD_CALL_PRIORITY_KERNEL, THREAD_CALL_OPTIONS_ONCE);
+}
+
+void
+smr_bootstrap(void)
+{
+	smr_init(&smr_system, "system");
+
+	smr_zfree_zone = zinit(sizeof(struct smr_zfree),
+	    1024 * 1024 * sizeof(struct smr_zfree), 0, "smr zfree");
+	zone_change(smr_zfree_zone, Z_CALLERACCT, FALSE);
+	zone_change(smr_zfree_zone, Z_NOENCRYPT, TRUE);
+}
+
+void
+smr_enter(smr_t smr)
+{
+	struct smr_pcpu *pcpu;
+
+	disable_preemption();
+	pcpu = &smr->smr_pcpu[cpu_number()];
+	assert(pcpu->c_seq == SMR_SEQ_INVALID);
+
+	os_atomic_store(&pcpu->c_seq, os_atomic_load(&smr->smr_wr_seq, acquire), relaxed);
+	os_atomic_thread_fence(seq_cst);
+}
+
+void
+smr_leave(smr_t smr)
+{
+	struct smr_pcpu *pcpu = &smr->smr_pcpu[cpu_number()];
+
+	assert(pcpu->c_seq != SMR_SEQ_INVALID);
+	os_atomic_store(&pcpu->c_seq, SMR_SEQ_INVALID, release);
+	enable_preemption();
+}
+
+/*
+ * Retire the current state: returns the goal that smr_poll() has to
+ * reach for objects unlinked before this call to be safe to free.
+ */
+smr_seq_t
+smr_advance(smr_t smr)
+{
+	smr_seq_t goal;
+
+	goal = os_atomic_add(&smr->smr_wr_seq, SMR_SEQ_INC, release);
+	os_atomic_thread_fence(seq_cst);
+	return goal;
+}
+
+bool
+smr_poll(smr_t smr, smr_seq_t goal)
+{
+	smr_seq_t rd_seq, wr_seq, min_seq, c_seq, new_seq;
+	unsigned int i;
+
+	rd_seq = os_atomic_load(&smr->smr_rd_seq, acquire);
+	if (SMR_SEQ_GEQ(rd_seq, goal))
+		return true;
+
+	os_atomic_thread_fence(seq_cst);
+
+	wr_seq = os_atomic_load(&smr->smr_wr_seq, relaxed);
+	min_seq = wr_seq;
+	for (i = 0; i < smr->smr_ncpus; i++) {
+		c_seq = os_atomic_load(&smr->smr_pcpu[i].c_seq, relaxed);
+		if (c_seq != SMR_SEQ_INVALID && SMR_SEQ_LT(c_seq, min_seq))
+			min_seq = c_seq;
+	}
+
+	/* publish how far we got, for the benefit of later polls */
+	os_atomic_rmw_loop(&smr->smr_rd_seq, rd_seq, new_seq, release, {
+		if (SMR_SEQ_GEQ(rd_seq, min_seq))
+			os_atomic_rmw_loop_give_up(break);
+		new_seq = min_seq;
+	});
+
+	return SMR_SEQ_GEQ(min_seq, goal);
+}
+
+/*
+ * Wait for all the read sections in progress to be done.
+ * Must not be called from within a read section.
+ */
+void
+smr_synchronize(smr_t smr)
+{
+	smr_seq_t goal = smr_advance(smr);
+
+	while (!smr_poll(smr, goal)) {
+		if (get_preemption_level() == 0 && ml_get_interrupts_enabled())
+			delay(1);
+		else
+			cpu_pause();
+	}
+}
+
+void
+smr_call(smr_t smr, struct smr_node *node, smr_cb_t cb)
+{
+	boolean_t arm, reclaim_now;
+
+	node->smrn_next = NULL;
+	node->smrn_cb = cb;
+	node->smrn_time = mach_absolute_time();
+	node->smrn_goal = smr_advance(smr);
+
+	simple_lock(&smr->smr_lock);
+	*smr->smr_tailp = node;
+	smr->smr_tailp = &node->smrn_next;
+	reclaim_now = (++smr->smr_pending >= SMR_RECLAIM_MAX);
+	arm = !smr->smr_armed;
+	smr->smr_armed = TRUE;
+	simple_unlock(&smr->smr_lock);
+
+	if (reclaim_now) {
+		thread_call_enter(smr->smr_tcall);
+	} else if (arm) {
+		smr_reclaim_arm(smr);
+	}
+}
+
+static void
+smr_reclaim(thread_call_param_t p0, __unused thread_call_param_t p1)
+{
+	smr_t smr = p0;
+	struct smr_node *node, *next, *head, *last = NULL;
+	uint32_t pending, count = 0;
+	uint64_t now, max_latency = 0;
+
+	simple_lock(&smr->smr_lock);
+	head = smr->smr_head;
+	pending = smr->smr_pending;
+	simple_unlock(&smr->smr_lock);
+
+	/*
+	 * Find the prefix of the list whose goals have been reached.  Only
+	 * this thread call removes nodes, and the links of the nodes that
+	 * were queued when we sampled the list don't change, so they can be
+	 * walked without the lock.
+	 */
+	for (node = head; count < pending; node = node->smrn_next) {
+		if (!smr_poll(smr, node->smrn_goal))
+			break;
+		last = node;
+		if (++count == pending)
+			break;
+	}
+
+	simple_lock(&smr->smr_lock);
+	if (count > 0) {
+		smr->smr_head = last->smrn_next;
+		if (smr->smr_head == NULL)
+			smr->smr_tailp = &smr->smr_head;
+		last->smrn_next = NULL;
+		smr->smr_pending -= count;
+	}
+	smr->smr_armed = (smr->smr_head != NULL);
+	simple_unlock(&smr->smr_lock);
+
+	if (count > 0) {
+		now = mach_absolute_time();
+		for (node = head; node != NULL; node = next) {
+			next = node->smrn_next;
+			if (now - node->smrn_time > max_latency)
+				max_latency = now - node->smrn_time;
+			node->smrn_cb(node);
+		}
+
+		KDBG(MACHDBG_CODE(DBG_MACH_SCHED, MACH_SMR_RECLAIM),
+		    VM_KERNEL_ADDRHIDE(smr), count, max_latency,
+		    os_atomic_load(&smr->smr_wr_seq, relaxed));
+	}
+
+	if (smr->smr_armed)
+		smr_reclaim_arm(smr);
+}
+
+static void
+zfree_smr_cb(struct smr_node *node)
+{
+	struct smr_zfree *szf = (struct smr_zfree *)node;
+
+	zfree(szf->szf_zone, szf->szf_elem);
+	zfree(smr_zfree_zone, szf);
+}
+
+void
+zfree_smr(zone_t zone, void *elem)
+{
+	struct smr_zfree *szf;
+
+	szf = zalloc_noblock(smr_zfree_zone);
+	if (szf == NULL) {
+		/* can't queue it: wait for the readers instead */
+		smr_synchronize(&smr_system);
+		zfree(zone, elem);
+		return;
+	}
+
+	szf->szf_zone = zone;
+	szf->szf_elem = elem;
+	smr_call(&smr_system, &szf->szf_node, zfree_smr_cb);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2018 Apple Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#ifndef _KERN_SMR_H_
+#define _KERN_SMR_H_
+
+#ifdef XNU_KERNEL_PRIVATE
+
+#include <sys/cdefs.h>
+#include <stdbool.h>
+#include <mach/mach_types.h>
+#include <kern/kern_types.h>
+#include <kern/simple_lock.h>
+#include <kern/thread_call.h>
+
+__BEGIN_DECLS
+
+/*
+ * Safe memory reclamation
+ *
+ * Readers bracket lockless accesses to shared data with smr_enter() and
+ * smr_leave().  Read sections run with preemption disabled, must not
+ * block and do not nest.
+ *
+ * Writers unlink an object so that new readers can't find it, then either
+ * wait for every read section that might still see it to end with
+ * smr_synchronize(), or defer freeing it with smr_call() or zfree_smr().
+ *
+ * Each domain keeps a write sequence, advanced by every deferred free,
+ * and each processor publishes the write sequence it observed when it
+ * entered its current read section.  An object retired at sequence S can
+ * be reclaimed once no processor is in a section that started before S.
+ */
+
+typedef uint32_t smr_seq_t;
+
+#define SMR_SEQ_INVALID		((smr_seq_t)0)
+#define SMR_SEQ_INIT		((smr_seq_t)1)
+#define SMR_SEQ_INC		((smr_seq_t)2)
+
+#define SMR_SEQ_LT(a, b)	((int32_t)((a) - (b)) < 0)
+#define SMR_SEQ_LEQ(a, b)	((int32_t)((a) - (b)) <= 0)
+#define SMR_SEQ_GEQ(a, b)	((int32_t)((a) - (b)) >= 0)
+
+struct smr_node;
+typedef void (*smr_cb_t)(struct smr_node *);
+
+/* embedded in objects whose reclamation is deferred with smr_call() */
+struct smr_node {
+	struct smr_node		*smrn_next;
+	smr_cb_t		smrn_cb;
+	smr_seq_t		smrn_goal;
+	uint32_t		smrn_pad;
+	uint64_t		smrn_time;	/* when it was retired */
+};
+
+struct smr_pcpu;
+
+struct smr {
+	volatile smr_seq_t	smr_wr_seq;	/* sequence of the last retired object */
+	volatile smr_seq_t	smr_rd_seq;	/* all sections before this one are done */
+	unsigned int		smr_ncpus;
+	struct smr_pcpu		*smr_pcpu;
+	const char		*smr_name;
+
+	decl_simple_lock_data(,	smr_lock)	/* protects the deferred list */
+	struct smr_node		*smr_head;
+	struct smr_node		**smr_tailp;
+	uint32_t		smr_pending;
+	boolean_t		smr_armed;
+	thread_call_t		smr_tcall;
+};
+typedef struct smr *smr_t;
+
+/* default domain, used by zfree_smr() */
+extern struct smr smr_system;
+
+/* sets up smr_system, once thread calls are available */
+extern void smr_bootstrap(void);
+
+/* additional domains can be set up after smr_bootstrap() */
+extern void smr_init(smr_t smr, const char *name);
+
+extern void smr_enter(smr_t smr);
+extern void smr_leave(smr_t smr);
+
+extern smr_seq_t smr_advance(smr_t smr);
+extern bool smr_poll(smr_t smr, smr_seq_t goal);
+extern void smr_synchronize(smr_t smr);
+
+extern void smr_call(smr_t smr, struct smr_node *node, smr_cb_t cb);
+
+/*
+ * Free a zone element once all the current smr_system read sections
+ * are done.  The element must already be unreachable by new readers.
+ */
+extern void zfree_smr(zone_t zone, void *elem);
+
+__END_DECLS
+
+#endif /* XNU_KERNEL_PRIVATE */
+
+#endif /* _KERN_SMR_H_ */
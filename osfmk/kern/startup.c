@@ -91,6 +91,7 @@
 #if CONFIG_SCHED_SFI
 #include <kern/sfi.h>
 #endif
+#include <kern/smr.h>
 #include <kern/startup.h>
 #include <kern/task.h>
 #include <kern/thread.h>
@@ -474,12 +475,22 @@ kernel_bootstrap_thread(void)
 	/* Create kernel map entry reserve */
 	vm_kernel_reserved_entry_init();
 
+	/* Background reclaim of free zone pages */
+	kernel_bootstrap_thread_log("zone_reclaim_init");
+	zone_reclaim_init();
+
 	/*
 	 * Thread callout service.
 	 */
 	kernel_bootstrap_thread_log("thread_call_initialize");
 	thread_call_initialize();
 
+	/*
+	 * Safe memory reclamation, needs thread calls.
+	 */
+	kernel_bootstrap_thread_log("smr_bootstrap");
+	smr_bootstrap();
+
 	/*
 	 * Remain on current processor as
 	 * additional processors come online.
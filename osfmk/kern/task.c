@@ -1191,6 +1191,7 @@ task_create_internal(
 #ifdef MACH_BSD
 	new_task->bsd_info = NULL;
 	new_task->corpse_info = NULL;
+	new_task->corpse_footprint = 0;
 #endif /* MACH_BSD */
 
 #if CONFIG_MACF
@@ -1346,6 +1347,10 @@ task_create_internal(
 		new_task->faults = 0;
 		new_task->pageins = 0;
 		new_task->cow_faults = 0;
+		new_task->fault_around_faults = 0;
+		new_task->fault_around_candidates = 0;
+		new_task->fault_around_pages = 0;
+		bzero(new_task->shadow_depth, sizeof (new_task->shadow_depth));
 		new_task->messages_sent = 0;
 		new_task->messages_received = 0;
 		new_task->syscalls_mach = 0;
@@ -1476,6 +1481,11 @@ task_rollup_accounting_info(task_t to_task, task_t from_task)
 	to_task->faults = from_task->faults;
 	to_task->pageins = from_task->pageins;
 	to_task->cow_faults = from_task->cow_faults;
+	to_task->fault_around_faults = from_task->fault_around_faults;
+	to_task->fault_around_candidates = from_task->fault_around_candidates;
+	to_task->fault_around_pages = from_task->fault_around_pages;
+	bcopy(from_task->shadow_depth, to_task->shadow_depth,
+	      sizeof (to_task->shadow_depth));
 	to_task->messages_sent = from_task->messages_sent;
 	to_task->messages_received = from_task->messages_received;
 	to_task->syscalls_mach = from_task->syscalls_mach;
@@ -1670,6 +1680,7 @@ task_deallocate(
 
 #if MACH_BSD
 	/* clean up collected information since last reference to task is gone */
+	task_corpse_footprint_uncharge(task);
 	if (task->corpse_info) {
 		void *corpse_info_kernel = kcdata_memory_get_begin_addr(task->corpse_info);
 		task_crashinfo_destroy(task->corpse_info);
@@ -2125,8 +2136,12 @@ task_duplicate_map_and_threads(
 		return KERN_FAILURE;
 	}
 
-	/* Check with VM if vm_map_fork is allowed for this task */
-	if (memorystatus_allowed_vm_map_fork(task)) {
+	/*
+	 * Check with VM if vm_map_fork is allowed for this task, and that
+	 * holding on to its pages stays within the corpse footprint budget.
+	 */
+	if (memorystatus_allowed_vm_map_fork(task) &&
+	    task_corpse_footprint_charge(new_task, task)) {
 
 		/* Setup new task's vmmap, switch from parent task's map to it COW map */
 		oldmap = new_task->map;
@@ -4254,7 +4269,7 @@ task_info(
 	}
 	case TASK_AFFINITY_TAG_INFO:
 	{
-		if (*task_info_count < TASK_AFFINITY_TAG_INFO_COUNT) {
+		if (*task_info_count < TASK_AFFINITY_TAG_INFO_REV0_COUNT) {
 		    error = KERN_INVALID_ARGUMENT;
 		    break;
 		}
@@ -4392,6 +4407,17 @@ task_info(
 			vm_info->max_address = map->max_offset;
 			*task_info_count = TASK_VM_INFO_REV2_COUNT;
 		}
+		if (original_task_info_count >= TASK_VM_INFO_REV3_COUNT) {
+			vm_info->fault_around_faults = task->fault_around_faults;
+			vm_info->fault_around_candidates = task->fault_around_candidates;
+			vm_info->fault_around_pages = task->fault_around_pages;
+			*task_info_count = TASK_VM_INFO_REV3_COUNT;
+		}
+		if (original_task_info_count >= TASK_VM_INFO_REV4_COUNT) {
+			bcopy(task->shadow_depth, vm_info->shadow_depth,
+			      sizeof (vm_info->shadow_depth));
+			*task_info_count = TASK_VM_INFO_REV4_COUNT;
+		}
 
 		if (task != kernel_task) {
 			vm_map_unlock_read(map);
@@ -222,6 +222,10 @@ struct task {
 	integer_t faults;              /* faults counter */
         integer_t pageins;             /* pageins counter */
         integer_t cow_faults;          /* copy on write fault counter */
+	uint64_t  fault_around_faults;     /* faults that looked at resident neighbours */
+	uint64_t  fault_around_candidates; /* neighbouring pages looked at */
+	uint64_t  fault_around_pages;      /* neighbouring pages mapped by fault-around */
+	uint64_t  shadow_depth[TASK_VM_INFO_SHADOW_DEPTH_BUCKETS]; /* faults by shadow chain depth */
         integer_t messages_sent;       /* messages sent counter */
         integer_t messages_received;   /* messages received counter */
         integer_t syscalls_mach;       /* mach system call counter */
@@ -234,6 +238,7 @@ struct task {
 	void *bsd_info;
 #endif  
 	kcdata_descriptor_t		corpse_info;
+	uint64_t			corpse_footprint;	/* bytes charged to the corpse footprint budget */
 	uint64_t			crashed_thread_id;
 	queue_chain_t			corpse_tasks;
 #ifdef CONFIG_MACF
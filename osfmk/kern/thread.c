@@ -93,6 +93,7 @@
 #include <machine/thread.h>
 #include <machine/pal_routines.h>
 #include <machine/limits.h>
+#include <machine/commpage.h>
 
 #include <kern/kern_types.h>
 #include <kern/kalloc.h>
@@ -302,6 +303,12 @@ thread_bootstrap(void)
 	thread_template.last_basepri_change_time = THREAD_NOT_RUNNABLE;
 	thread_template.same_pri_latency = 0;
 
+	thread_template.runq_latency_count = 0;
+	thread_template.runq_latency_total = 0;
+	thread_template.runq_latency_max = 0;
+	thread_template.preempt_count = 0;
+	bzero(thread_template.runq_latency_hist, sizeof(thread_template.runq_latency_hist));
+
 	thread_template.computation_metered = 0;
 	thread_template.computation_epoch = 0;
 
@@ -385,6 +392,10 @@ thread_bootstrap(void)
 	thread_template.syscalls_mach = 0;
 
 	thread_template.t_ledger = LEDGER_NULL;
+	thread_template.t_ledger_defer_entry = 0;
+	thread_template.t_ledger_defer_count = 0;
+	thread_template.t_ledger_defer_credit = 0;
+	thread_template.t_ledger_defer_debit = 0;
 	thread_template.t_threadledger = LEDGER_NULL;
 	thread_template.t_bankledger = LEDGER_NULL;
 	thread_template.t_deduct_bank_ledger_time = 0;
@@ -537,6 +548,9 @@ thread_terminate_self(void)
 
 	bank_swap_thread_bank_ledger(thread, NULL);
 
+	/* the task's ledger must be exact once its last thread is gone */
+	ledger_thread_fold(thread);
+
 	if (kdebug_enable && bsd_hasthreadname(thread->uthread)) {
 		char threadname[MAXTHREADNAMESIZE];
 		bsd_getthreadname(thread->uthread, threadname);
@@ -768,8 +782,10 @@ thread_deallocate_complete(
 	}
 #endif /* MACH_BSD */
 
-	if (thread->t_ledger)
+	if (thread->t_ledger) {
+		ledger_thread_fold(thread);
 		ledger_dereference(thread->t_ledger);
+	}
 	if (thread->t_threadledger)
 		ledger_dereference(thread->t_threadledger);
 
@@ -2123,6 +2139,32 @@ thread_info_internal(
 		return (KERN_SUCCESS);
 	}
 	else
+	if (flavor == THREAD_SCHED_LATENCY_INFO) {
+		thread_sched_latency_info_t	latency_info;
+
+		if (*thread_info_count < THREAD_SCHED_LATENCY_INFO_COUNT)
+			return (KERN_INVALID_ARGUMENT);
+
+		latency_info = (thread_sched_latency_info_t) thread_info_out;
+
+		s = splsched();
+		thread_lock(thread);
+
+		latency_info->runnable_count = thread->runq_latency_count;
+		latency_info->runnable_time = thread->runq_latency_total;
+		latency_info->runnable_max = thread->runq_latency_max;
+		latency_info->preemptions = thread->preempt_count;
+		memcpy(latency_info->latency_hist, thread->runq_latency_hist,
+		       sizeof(latency_info->latency_hist));
+
+		thread_unlock(thread);
+		splx(s);
+
+		*thread_info_count = THREAD_SCHED_LATENCY_INFO_COUNT;
+
+		return (KERN_SUCCESS);
+	}
+	else
 	if (flavor == THREAD_DEBUG_INFO_INTERNAL) {
 #if DEVELOPMENT || DEBUG
 		thread_debug_info_internal_t dbg_info;
@@ -2204,6 +2246,48 @@ uint64_t thread_get_runtime_self(void)
 	return runtime;
 }
 
+/*
+ * Opt the current thread in or out of publishing its runtime in the
+ * commpage entry of the cpu it runs on, see commpage_thread_usage_t.
+ * The entries are readable by every process, so only threads that ask
+ * for it publish anything.
+ */
+void
+thread_set_commpage_usage(boolean_t enable)
+{
+	thread_t thread = current_thread();
+	processor_t processor;
+	uint64_t now;
+	spl_t s;
+
+	s = splsched();
+	thread_lock(thread);
+
+	if (enable) {
+		thread->options |= TH_OPT_COMMPAGE_USAGE;
+	} else {
+		thread->options &= ~TH_OPT_COMMPAGE_USAGE;
+	}
+
+	/* don't wait for the next dispatch to fill in or clear this cpu's entry */
+	processor = current_processor();
+	now = mach_absolute_time();
+	timer_update(PROCESSOR_DATA(processor, thread_timer), now);
+	commpage_update_thread_usage(cpu_number(), enable ? thread->thread_id : 0,
+	    thread->c_switch,
+	    timer_grab(&thread->user_timer) + timer_grab(&thread->system_timer),
+	    now);
+
+	thread_unlock(thread);
+	splx(s);
+}
+
+boolean_t
+thread_get_commpage_usage(void)
+{
+	return (current_thread()->options & TH_OPT_COMMPAGE_USAGE) ? TRUE : FALSE;
+}
+
 kern_return_t
 thread_assign(
 	__unused thread_t			thread,
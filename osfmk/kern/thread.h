@@ -201,6 +201,7 @@ struct thread {
 #define TH_OPT_HONOR_QLIMIT	0x0400		/* Thread will honor qlimit while sending mach_msg, regardless of MACH_SEND_ALWAYS */
 #define TH_OPT_SEND_IMPORTANCE	0x0800		/* Thread will allow importance donation from kernel rpc */
 #define TH_OPT_ZONE_GC		0x1000		/* zone_gc() called on this thread */
+#define TH_OPT_COMMPAGE_USAGE	0x2000		/* Thread publishes its runtime in the commpage */
 
 	boolean_t			wake_active;	/* wake event on stop */
 	int					at_safe_point;	/* thread_abort_safely allowed */
@@ -314,6 +315,13 @@ struct thread {
 	uint64_t			same_pri_latency;
 #define THREAD_NOT_RUNNABLE (~0ULL)
 
+	/* run queue latency, see thread_sched_latency_info */
+	uint64_t			runq_latency_count;
+	uint64_t			runq_latency_total;	/* in ns */
+	uint64_t			runq_latency_max;	/* in ns */
+	uint64_t			preempt_count;
+	uint32_t			runq_latency_hist[THREAD_SCHED_LATENCY_BUCKETS];
+
 
 #if defined(CONFIG_SCHED_MULTIQ)
 	sched_group_t			sched_group;
@@ -534,6 +542,10 @@ struct thread {
 	uint32_t		syscalls_unix;
 	uint32_t		syscalls_mach;
 	ledger_t		t_ledger;
+	int			t_ledger_defer_entry;		/* entry of t_ledger with updates to fold */
+	uint32_t		t_ledger_defer_count;		/* number of updates not folded yet */
+	ledger_amount_t		t_ledger_defer_credit;
+	ledger_amount_t		t_ledger_defer_debit;
 	ledger_t		t_threadledger;	/* per thread ledger */
 	ledger_t		t_bankledger;  		     /* ledger to charge someone */
 	uint64_t		t_deduct_bank_ledger_time;   /* cpu time to be deducted from bank ledger */
@@ -1019,6 +1031,10 @@ extern void			thread_read_times(
 
 extern uint64_t		thread_get_runtime_self(void);
 
+extern void			thread_set_commpage_usage(boolean_t enable);
+
+extern boolean_t		thread_get_commpage_usage(void);
+
 extern void			thread_setuserstack(
 						thread_t		thread,
 						mach_vm_offset_t	user_stack);
@@ -47,6 +47,7 @@
 
 #include <libkern/OSAtomic.h>
 #include <kern/timer_queue.h>
+#include <machine/atomic.h>
 
 #include <sys/kdebug.h>
 #if CONFIG_DTRACE
@@ -89,6 +90,11 @@ static struct thread_call_group {
 
 	thread_call_group_flags_t flags;
 
+	lck_mtx_t		tcg_lock;	/* the group, its queues and its calls */
+
+	/* time from becoming pending to being invoked: bucket b is < (1us << b) */
+	uint64_t		tcg_latency[THREAD_CALL_LATENCY_BUCKETS];
+
 } thread_call_groups[THREAD_CALL_INDEX_MAX] = {
 	[THREAD_CALL_INDEX_HIGH] = {
 		.tcg_name               = "high",
@@ -148,7 +154,7 @@ typedef struct thread_call_group	*thread_call_group_t;
 #define THREAD_CALL_MACH_FACTOR_CAP	3
 #define THREAD_CALL_GROUP_MAX_THREADS	500
 
-static boolean_t		thread_call_daemon_awake;
+static boolean_t		thread_call_daemon_awake = TRUE;
 static thread_call_data_t	internal_call_storage[INTERNAL_CALL_COUNT];
 static queue_head_t		thread_call_internal_queue;
 int						thread_call_internal_queue_count = 0;
@@ -179,31 +185,35 @@ static boolean_t		thread_call_enter_delayed_internal(thread_call_t call,
 extern void thread_call_delayed_timer(timer_call_param_t p0, timer_call_param_t p1);
 
 lck_grp_t               thread_call_lck_grp;
-lck_mtx_t               thread_call_lock_data;
 
-#define thread_call_lock_spin()			\
-	lck_mtx_lock_spin_always(&thread_call_lock_data)
+/*
+ * Each group has its own lock, which also covers the calls in that group
+ * (a call never changes group).  The internal call storage is only used
+ * for HIGH group calls and is covered by that group's lock.
+ */
+#define thread_call_lock_spin(group)		\
+	lck_mtx_lock_spin_always(&(group)->tcg_lock)
 
-#define thread_call_unlock()			\
-	lck_mtx_unlock_always(&thread_call_lock_data)
+#define thread_call_unlock(group)		\
+	lck_mtx_unlock_always(&(group)->tcg_lock)
 
 #define tc_deadline tc_call.deadline
 
 extern boolean_t	mach_timer_coalescing_enabled;
 
 static inline spl_t
-disable_ints_and_lock(void)
+disable_ints_and_lock(thread_call_group_t group)
 {
 	spl_t s = splsched();
-	thread_call_lock_spin();
+	thread_call_lock_spin(group);
 
 	return s;
 }
 
 static inline void
-enable_ints_and_unlock(spl_t s)
+enable_ints_and_unlock(thread_call_group_t group, spl_t s)
 {
-	thread_call_unlock();
+	thread_call_unlock(group);
 	splx(s);
 }
 
@@ -274,9 +284,29 @@ thread_call_get_flavor(thread_call_t call)
 	return (call->tc_flags & THREAD_CALL_CONTINUOUS) ? TCF_CONTINUOUS : TCF_ABSOLUTE;
 }
 
+/* Lock held */
+static inline void
+thread_call_latency_record(thread_call_group_t group, thread_call_t call)
+{
+	uint64_t latency_ns, latency_us;
+	int bucket;
+
+	absolutetime_to_nanoseconds(mach_absolute_time() - call->tc_pending_timestamp,
+	                            &latency_ns);
+	latency_us = latency_ns / NSEC_PER_USEC;
+
+	bucket = (latency_us == 0) ? 0 : 64 - __builtin_clzll(latency_us);
+	if (bucket >= THREAD_CALL_LATENCY_BUCKETS)
+		bucket = THREAD_CALL_LATENCY_BUCKETS - 1;
+
+	group->tcg_latency[bucket]++;
+}
+
 static void
 thread_call_group_setup(thread_call_group_t group)
 {
+	lck_mtx_init(&group->tcg_lock, &thread_call_lck_grp, LCK_ATTR_NULL);
+
 	queue_init(&group->pending_queue);
 	queue_init(&group->delayed_queues[TCF_ABSOLUTE]);
 	queue_init(&group->delayed_queues[TCF_CONTINUOUS]);
@@ -343,7 +373,6 @@ thread_call_initialize(void)
 	zone_change(thread_call_zone, Z_NOENCRYPT, TRUE);
 
 	lck_grp_init(&thread_call_lck_grp, "thread_call", LCK_GRP_ATTR_NULL);
-	lck_mtx_init(&thread_call_lock_data, &thread_call_lck_grp, LCK_ATTR_NULL);
 
 	nanotime_to_absolutetime(0, THREAD_CALL_DEALLOC_INTERVAL_NS, &thread_call_dealloc_interval_abs);
 	waitq_init(&daemon_waitq, SYNC_POLICY_DISABLE_IRQ | SYNC_POLICY_FIFO);
@@ -351,7 +380,8 @@ thread_call_initialize(void)
 	for (uint32_t i = 0; i < THREAD_CALL_INDEX_MAX; i++)
 		thread_call_group_setup(&thread_call_groups[i]);
 
-	spl_t s = disable_ints_and_lock();
+	thread_call_group_t high_group = &thread_call_groups[THREAD_CALL_INDEX_HIGH];
+	spl_t s = disable_ints_and_lock(high_group);
 
 	queue_init(&thread_call_internal_queue);
 	for (
@@ -363,9 +393,7 @@ thread_call_initialize(void)
 		thread_call_internal_queue_count++;
 	}
 
-	thread_call_daemon_awake = TRUE;
-
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(high_group, s);
 
 	thread_t thread;
 	kern_return_t result;
@@ -398,7 +426,7 @@ thread_call_setup(
  *
  *	Allocate an internal callout entry.
  *
- *	Called with thread_call_lock held.
+ *	Called with the HIGH group's lock held.
  */
 static __inline__ thread_call_t
 _internal_call_allocate(thread_call_func_t func, thread_call_param_t param0)
@@ -427,7 +455,8 @@ _internal_call_allocate(thread_call_func_t func, thread_call_param_t param0)
  *	safe to call on a non-internal entry, in which
  *	case nothing happens.
  *
- * 	Called with thread_call_lock held.
+ * 	Called with the lock of the call's group held,
+ * 	which is the HIGH group for an internal entry.
  */
 static __inline__ void
 _internal_call_release(thread_call_t call)
@@ -449,7 +478,7 @@ _internal_call_release(thread_call_t call)
  *	Returns TRUE if the entry was already
  *	on a queue.
  *
- *	Called with thread_call_lock held.
+ *	Called with the group's lock held.
  */
 static __inline__ boolean_t
 _pending_call_enqueue(thread_call_t             call,
@@ -470,6 +499,9 @@ _pending_call_enqueue(thread_call_t             call,
 
 	queue_head_t *old_queue = call_entry_enqueue_tail(CE(call), &group->pending_queue);
 
+	if (old_queue != &group->pending_queue)
+		call->tc_pending_timestamp = mach_absolute_time();
+
 	if (old_queue == NULL) {
 		call->tc_submit_count++;
 	} else if (old_queue != &group->pending_queue &&
@@ -495,7 +527,7 @@ _pending_call_enqueue(thread_call_t             call,
  *	Returns TRUE if the entry was already
  *	on a queue.
  *
- *	Called with thread_call_lock held.
+ *	Called with the group's lock held.
  */
 static boolean_t
 _delayed_call_enqueue(
@@ -543,7 +575,7 @@ _delayed_call_enqueue(
  *
  *	Returns TRUE if the entry was on a queue.
  *
- *	Called with thread_call_lock held.
+ *	Called with the group's lock held.
  */
 static __inline__ boolean_t
 _call_dequeue(
@@ -579,7 +611,7 @@ _call_dequeue(
  * Returns true if the timer was armed/re-armed, false if it was left unset
  * Caller should cancel the timer if need be.
  *
- * Called with thread_call_lock held.
+ * Called with the group's lock held.
  */
 static bool
 _arm_delayed_call_timer(thread_call_t           new_call,
@@ -632,7 +664,7 @@ _arm_delayed_call_timer(thread_call_t           new_call,
  *	Returns TRUE if any matching entries
  *	were found.
  *
- *	Called with thread_call_lock held.
+ *	Called with the group's lock held.
  */
 static boolean_t
 _cancel_func_from_queue(thread_call_func_t      func,
@@ -720,11 +752,11 @@ thread_call_func_cancel(
 
 	assert(func != NULL);
 
-	spl_t s = disable_ints_and_lock();
-
 	/* Function-only thread calls are only kept in the default HIGH group */
 	thread_call_group_t group = &thread_call_groups[THREAD_CALL_INDEX_HIGH];
 
+	spl_t s = disable_ints_and_lock(group);
+
 	if (cancel_all) {
 		/* exhaustively search every queue, and return true if any search found something */
 		result = _cancel_func_from_queue(func, param, group, cancel_all, &group->pending_queue) |
@@ -737,7 +769,7 @@ thread_call_func_cancel(
 		         _cancel_func_from_queue(func, param, group, cancel_all, &group->delayed_queues[TCF_CONTINUOUS]);
 	}
 
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 
 	return (result);
 }
@@ -873,11 +905,13 @@ boolean_t
 thread_call_free(
 		thread_call_t		call)
 {
-	spl_t s = disable_ints_and_lock();
+	thread_call_group_t group = thread_call_get_group(call);
+
+	spl_t s = disable_ints_and_lock(group);
 
 	if (call->tc_call.queue != NULL ||
 	   ((call->tc_flags & THREAD_CALL_RESCHEDULE) != 0)) {
-		thread_call_unlock();
+		thread_call_unlock(group);
 		splx(s);
 
 		return (FALSE);
@@ -893,7 +927,7 @@ thread_call_free(
 		thread_call_wait_once_locked(call, s);
 		/* thread call lock has been unlocked */
 	} else {
-		enable_ints_and_unlock(s);
+		enable_ints_and_unlock(group, s);
 	}
 
 	if (refs == 0) {
@@ -933,7 +967,7 @@ thread_call_enter1(
 
 	group = thread_call_get_group(call);
 
-	spl_t s = disable_ints_and_lock();
+	spl_t s = disable_ints_and_lock(group);
 
 	if (call->tc_call.queue != &group->pending_queue) {
 		result = _pending_call_enqueue(call, group);
@@ -941,7 +975,7 @@ thread_call_enter1(
 
 	call->tc_call.param1 = param1;
 
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 
 	return (result);
 }
@@ -1022,7 +1056,13 @@ thread_call_enter_delayed_internal(
 	/* direct mapping between thread_call, timer_call, and timeout_urgency values */
 	urgency = (flags & TIMEOUT_URGENCY_MASK);
 
-	spl_t s = disable_ints_and_lock();
+	/* internal calls are in the HIGH group, see thread_call_setup() */
+	if (call == NULL)
+		group = &thread_call_groups[THREAD_CALL_INDEX_HIGH];
+	else
+		group = thread_call_get_group(call);
+
+	spl_t s = disable_ints_and_lock(group);
 
 	if (call == NULL) {
 		/* allocate a structure out of internal storage, as a convenience for BSD callers */
@@ -1030,7 +1070,7 @@ thread_call_enter_delayed_internal(
 	}
 
 	assert(call->tc_call.func != NULL);
-	group = thread_call_get_group(call);
+	assert(group == thread_call_get_group(call));
 
 	/* TODO: assert that call is not enqueued before flipping the flag */
 	if (flavor == TCF_CONTINUOUS) {
@@ -1076,14 +1116,14 @@ thread_call_enter_delayed_internal(
 	            (unsigned) (call->tc_ttd & 0xFFFFFFFF), call);
 #endif
 
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 
 	return (result);
 }
 
 /*
  * Remove a callout entry from the queue
- * Called with thread_call_lock held
+ * Called with the group's lock held
  */
 static boolean_t
 thread_call_cancel_locked(thread_call_t call)
@@ -1133,11 +1173,13 @@ thread_call_cancel_locked(thread_call_t call)
 boolean_t
 thread_call_cancel(thread_call_t call)
 {
-	spl_t s = disable_ints_and_lock();
+	thread_call_group_t group = thread_call_get_group(call);
+
+	spl_t s = disable_ints_and_lock(group);
 
 	boolean_t result = thread_call_cancel_locked(call);
 
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 
 	return result;
 }
@@ -1163,7 +1205,9 @@ thread_call_cancel_wait(thread_call_t call)
 		panic("thread_call_cancel_wait: deadlock waiting on self from inside call: %p to function %p",
 		      call, call->tc_call.func);
 
-	spl_t s = disable_ints_and_lock();
+	thread_call_group_t group = thread_call_get_group(call);
+
+	spl_t s = disable_ints_and_lock(group);
 
 	boolean_t canceled = thread_call_cancel_locked(call);
 
@@ -1187,7 +1231,7 @@ thread_call_cancel_wait(thread_call_t call)
 			thread_call_wait_locked(call, s);
 			/* thread call lock unlocked */
 		} else {
-			enable_ints_and_unlock(s);
+			enable_ints_and_unlock(group, s);
 		}
 	}
 
@@ -1203,7 +1247,7 @@ thread_call_cancel_wait(thread_call_t call)
  *	the daemon thread in order to
  *	create additional call threads.
  *
- *	Called with thread_call_lock held.
+ *	Called with the group's lock held.
  *
  *	For high-priority group, only does wakeup/creation if there are no threads
  *	running.
@@ -1227,8 +1271,8 @@ thread_call_wake(
 				}
 			}
 		} else {
-			if (!thread_call_daemon_awake && thread_call_group_should_add_thread(group)) {
-				thread_call_daemon_awake = TRUE;
+			if (!thread_call_daemon_awake && thread_call_group_should_add_thread(group) &&
+			    os_atomic_cmpxchg(&thread_call_daemon_awake, FALSE, TRUE, relaxed)) {
 				waitq_wakeup64_one(&daemon_waitq, NO_EVENT64,
 						   THREAD_AWAKENED, WAITQ_ALL_PRIORITIES);
 			}
@@ -1251,7 +1295,7 @@ sched_call_thread(
 	group = thread->thc_state.thc_group;
 	assert((group - &thread_call_groups[0]) < THREAD_CALL_INDEX_MAX);
 
-	thread_call_lock_spin();
+	thread_call_lock_spin(group);
 
 	switch (type) {
 
@@ -1270,7 +1314,7 @@ sched_call_thread(
 			break;
 	}
 
-	thread_call_unlock();
+	thread_call_unlock(group);
 }
 
 /* 
@@ -1334,22 +1378,21 @@ thread_call_finish(thread_call_t call, thread_call_group_t group, spl_t *s)
 
 		assert(call->tc_finish_count == call->tc_submit_count);
 
-		enable_ints_and_unlock(*s);
+		enable_ints_and_unlock(group, *s);
 
 		zfree(thread_call_zone, call);
 
-		*s = disable_ints_and_lock();
+		*s = disable_ints_and_lock(group);
 	}
 
 	if ((flags & THREAD_CALL_WAIT) != 0) {
 		/*
 		 * Dropping lock here because the sched call for the
-		 * high-pri group can take the big lock from under
-		 * a thread lock.
+		 * group can take its lock from under a thread lock.
 		 */
-		thread_call_unlock();
+		thread_call_unlock(group);
 		thread_wakeup((event_t)call);
-		thread_call_lock_spin();
+		thread_call_lock_spin(group);
 		/* THREAD_CALL_SIGNAL call may have been freed */
 	}
 
@@ -1422,7 +1465,7 @@ thread_call_thread(
 		panic("thread_terminate() returned?");
 	}
 
-	spl_t s = disable_ints_and_lock();
+	spl_t s = disable_ints_and_lock(group);
 
 	self->thc_state.thc_group = group;
 	thread_sched_call(self, sched_call_thread);
@@ -1436,6 +1479,8 @@ thread_call_thread(
 		assert(call != NULL);
 		group->pending_count--;
 
+		thread_call_latency_record(group, call);
+
 		func = call->tc_call.func;
 		param0 = call->tc_call.param0;
 		param1 = call->tc_call.param1;
@@ -1455,7 +1500,7 @@ thread_call_thread(
 		} else
 			canwait = FALSE;
 
-		enable_ints_and_unlock(s);
+		enable_ints_and_unlock(group, s);
 
 		thread_call_invoke(func, param0, param1, call);
 
@@ -1465,7 +1510,7 @@ thread_call_thread(
 					pl, (void *)VM_KERNEL_UNSLIDE(func), param0, param1);
 		}
 
-		s = disable_ints_and_lock();
+		s = disable_ints_and_lock(group);
 
 		if (canwait) {
 			/* Frees if so desired */
@@ -1511,7 +1556,7 @@ thread_call_thread(
 			panic("kcall worker unable to assert wait?");
 		}
 
-		enable_ints_and_unlock(s);
+		enable_ints_and_unlock(group, s);
 
 		thread_block_parameter((thread_continue_t)thread_call_thread, group);
 	} else {
@@ -1520,14 +1565,14 @@ thread_call_thread(
 
 			waitq_assert_wait64(&group->idle_waitq, NO_EVENT64, THREAD_UNINT, 0); /* Interrupted means to exit */
 
-			enable_ints_and_unlock(s);
+			enable_ints_and_unlock(group, s);
 
 			thread_block_parameter((thread_continue_t)thread_call_thread, group);
 			/* NOTREACHED */
 		}
 	}
 
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 
 	thread_terminate(self);
 	/* NOTREACHED */
@@ -1541,15 +1586,26 @@ thread_call_thread(
 static void
 thread_call_daemon_continue(__unused void *arg)
 {
-	spl_t s = disable_ints_and_lock();
+	spl_t s;
+
+	/*
+	 * Groups are scanned under their own lock: clear the awake flag
+	 * first, so that a group that needs a thread after we looked at it
+	 * sets it again (see thread_call_wake()) and we scan once more.
+	 */
+again:
+	os_atomic_store(&thread_call_daemon_awake, FALSE, relaxed);
 
 	/* Starting at zero happens to be high-priority first. */
 	for (int i = 0; i < THREAD_CALL_INDEX_MAX; i++) {
 		thread_call_group_t group = &thread_call_groups[i];
+
+		s = disable_ints_and_lock(group);
+
 		while (thread_call_group_should_add_thread(group)) {
 			group->active_count++;
 
-			enable_ints_and_unlock(s);
+			enable_ints_and_unlock(group, s);
 
 			kern_return_t kr = thread_call_thread_create(group);
 			if (kr != KERN_SUCCESS) {
@@ -1558,19 +1614,27 @@ thread_call_daemon_continue(__unused void *arg)
 				 * We can try again later.
 				 */
 				delay(10000); /* 10 ms */
-				s = disable_ints_and_lock();
 				goto out;
 			}
 
-			s = disable_ints_and_lock();
+			s = disable_ints_and_lock(group);
 		}
+
+		enable_ints_and_unlock(group, s);
 	}
 
 out:
-	thread_call_daemon_awake = FALSE;
+	s = splsched();
 	waitq_assert_wait64(&daemon_waitq, NO_EVENT64, THREAD_UNINT, 0);
 
-	enable_ints_and_unlock(s);
+	/* a group asked for a thread while we were scanning */
+	if (os_atomic_load(&thread_call_daemon_awake, relaxed)) {
+		clear_wait(current_thread(), THREAD_AWAKENED);
+		splx(s);
+		goto again;
+	}
+
+	splx(s);
 
 	thread_block_parameter((thread_continue_t)thread_call_daemon_continue, NULL);
 	/* NOTREACHED */
@@ -1625,7 +1689,7 @@ thread_call_delayed_timer(timer_call_param_t p0, timer_call_param_t p1)
 	boolean_t       restart;
 	boolean_t       repend;
 
-	thread_call_lock_spin();
+	thread_call_lock_spin(group);
 
 	if (flavor == TCF_CONTINUOUS)
 		now = mach_continuous_time();
@@ -1676,9 +1740,9 @@ thread_call_delayed_timer(timer_call_param_t p0, timer_call_param_t p1)
 					thread_call_param_t param1 = call->tc_call.param1;
 
 					call->tc_flags |= THREAD_CALL_RUNNING;
-					thread_call_unlock();
+					thread_call_unlock(group);
 					thread_call_invoke(func, param0, param1, call);
-					thread_call_lock_spin();
+					thread_call_lock_spin(group);
 
 					repend = thread_call_finish(call, group, NULL);
                 } while (repend);
@@ -1694,7 +1758,7 @@ thread_call_delayed_timer(timer_call_param_t p0, timer_call_param_t p1)
 
 	_arm_delayed_call_timer(call, group, flavor);
 
-	thread_call_unlock();
+	thread_call_unlock(group);
 }
 
 static void
@@ -1704,7 +1768,7 @@ thread_call_delayed_timer_rescan(thread_call_group_t group,
 	thread_call_t call;
 	uint64_t now;
 
-	spl_t s = disable_ints_and_lock();
+	spl_t s = disable_ints_and_lock(group);
 
 	assert(ml_timer_forced_evaluation() == TRUE);
 
@@ -1734,7 +1798,7 @@ thread_call_delayed_timer_rescan(thread_call_group_t group,
 
 	_arm_delayed_call_timer(NULL, group, flavor);
 
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 }
 
 void
@@ -1760,7 +1824,7 @@ thread_call_dealloc_timer(
 	kern_return_t res;
 	boolean_t terminated = FALSE;
 
-	thread_call_lock_spin();
+	thread_call_lock_spin(group);
 
 	assert((group->flags & TCG_DEALLOC_ACTIVE) == TCG_DEALLOC_ACTIVE);
 
@@ -1796,7 +1860,7 @@ thread_call_dealloc_timer(
 		thread_call_start_deallocate_timer(group);
 	}
 
-	thread_call_unlock();
+	thread_call_unlock(group);
 }
 
 /*
@@ -1815,11 +1879,13 @@ thread_call_dealloc_timer(
 static boolean_t
 thread_call_wait_once_locked(thread_call_t call, spl_t s)
 {
+	thread_call_group_t group = thread_call_get_group(call);
+
 	assert(call->tc_flags & THREAD_CALL_ALLOC);
 	assert(call->tc_flags & THREAD_CALL_ONCE);
 
 	if ((call->tc_flags & THREAD_CALL_RUNNING) == 0) {
-		enable_ints_and_unlock(s);
+		enable_ints_and_unlock(group, s);
 		return FALSE;
 	}
 
@@ -1830,7 +1896,7 @@ thread_call_wait_once_locked(thread_call_t call, spl_t s)
 	if (res != THREAD_WAITING)
 		panic("Unable to assert wait: %d", res);
 
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 
 	res = thread_block(THREAD_CONTINUE_NULL);
 	if (res != THREAD_AWAKENED)
@@ -1865,7 +1931,7 @@ thread_call_wait_once(thread_call_t call)
 		panic("thread_call_wait_once: deadlock waiting on self from inside call: %p to function %p",
 		      call, call->tc_call.func);
 
-	spl_t s = disable_ints_and_lock();
+	spl_t s = disable_ints_and_lock(thread_call_get_group(call));
 
 	boolean_t waited = thread_call_wait_once_locked(call, s);
 	/* thread call lock unlocked */
@@ -1880,11 +1946,12 @@ thread_call_wait_once(thread_call_t call)
  * Just waits for the finish count to catch up to the submit count we find
  * at the beginning of our wait.
  *
- * Called with thread_call_lock held.  Returns with lock released.
+ * Called with the group's lock held.  Returns with lock released.
  */
 static void
 thread_call_wait_locked(thread_call_t call, spl_t s)
 {
+	thread_call_group_t group = thread_call_get_group(call);
 	uint64_t submit_count;
 	wait_result_t res;
 
@@ -1899,16 +1966,16 @@ thread_call_wait_locked(thread_call_t call, spl_t s)
 		if (res != THREAD_WAITING)
 			panic("Unable to assert wait: %d", res);
 
-		enable_ints_and_unlock(s);
+		enable_ints_and_unlock(group, s);
 
 		res = thread_block(THREAD_CONTINUE_NULL);
 		if (res != THREAD_AWAKENED)
 			panic("Awoken with %d?", res);
 
-		s = disable_ints_and_lock();
+		s = disable_ints_and_lock(group);
 	}
 
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 }
 
 /*
@@ -1918,11 +1985,12 @@ thread_call_wait_locked(thread_call_t call, spl_t s)
 boolean_t
 thread_call_isactive(thread_call_t call) 
 {
+	thread_call_group_t group = thread_call_get_group(call);
 	boolean_t active;
 
-	spl_t s = disable_ints_and_lock();
+	spl_t s = disable_ints_and_lock(group);
 	active = (call->tc_submit_count > call->tc_finish_count);
-	enable_ints_and_unlock(s);
+	enable_ints_and_unlock(group, s);
 
 	return active;
 }
@@ -1934,16 +2002,45 @@ thread_call_isactive(thread_call_t call)
 void
 adjust_cont_time_thread_calls(void)
 {
-	spl_t s = disable_ints_and_lock();
-
 	for (int i = 0; i < THREAD_CALL_INDEX_MAX; i++) {
 		thread_call_group_t group = &thread_call_groups[i];
+		spl_t s = disable_ints_and_lock(group);
 
 		/* only the continuous timers need to be re-armed */
 
 		_arm_delayed_call_timer(NULL, group, TCF_CONTINUOUS);
+		enable_ints_and_unlock(group, s);
+	}
+}
+
+/*
+ * thread_call_latency_histograms
+ *
+ * Copy the latency histogram of each group, in group index order,
+ * into 'hist'.  Returns the number of entries copied, or the number
+ * 'hist' needs to have if it is NULL.
+ */
+size_t
+thread_call_latency_histograms(uint64_t *hist, size_t count)
+{
+	size_t n = 0;
+
+	if (hist == NULL)
+		return THREAD_CALL_INDEX_MAX * THREAD_CALL_LATENCY_BUCKETS;
+
+	for (int i = 0; i < THREAD_CALL_INDEX_MAX; i++) {
+		thread_call_group_t group = &thread_call_groups[i];
+
+		if (n + THREAD_CALL_LATENCY_BUCKETS > count)
+			break;
+
+		spl_t s = disable_ints_and_lock(group);
+		memcpy(&hist[n], group->tcg_latency, sizeof(group->tcg_latency));
+		enable_ints_and_unlock(group, s);
+
+		n += THREAD_CALL_LATENCY_BUCKETS;
 	}
 
-	enable_ints_and_unlock(s);
+	return n;
 }
 
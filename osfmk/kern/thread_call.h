@@ -362,6 +362,7 @@ struct thread_call {
 	uint64_t			tc_finish_count;
 	uint64_t			tc_ttd;                 /* Time to deadline at creation */
 	uint64_t			tc_soft_deadline;
+	uint64_t			tc_pending_timestamp;   /* When put on the pending queue */
 	thread_call_index_t		tc_index;
 	uint32_t			tc_flags;
 	int32_t				tc_refs;
@@ -428,6 +429,18 @@ extern boolean_t	thread_call_func_cancel(
  */
 void 				adjust_cont_time_thread_calls(void);
 
+/*
+ * Histograms of the time calls spend pending before they run, one per
+ * thread call group: bucket b counts the calls that waited less than
+ * (1us << b), the last bucket everything longer.
+ */
+#define THREAD_CALL_LATENCY_BUCKETS	16
+
+/* Copies the histograms of all groups; a NULL hist returns the count needed */
+extern size_t		thread_call_latency_histograms(
+						uint64_t		*hist,
+						size_t			count);
+
 __END_DECLS
 
 #endif	/* XNU_KERNEL_PRIVATE */
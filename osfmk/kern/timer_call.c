@@ -118,6 +118,29 @@ lck_grp_attr_t          timer_longterm_lck_grp_attr;
 /* Sentinel for "scan limit exceeded": */
 #define TIMER_LONGTERM_SCAN_AGAIN	0
 
+/*
+ * Longterm timers are kept on a two-level hashed timer wheel, indexed by
+ * soft deadline, so that arming and cancelling them stay O(1) and the
+ * escalation scan only visits the timers becoming due, rather than every
+ * longterm timer each time the threshold timer fires.
+ *
+ * Level 0 has a slot per granule of the current period, a period being
+ * TIMER_WHEEL_SLOTS granules.  Level 1 has a slot per period, hashed for
+ * timers due more than TIMER_WHEEL_SLOTS periods out.  The slots of a
+ * period are cascaded into level 0 when the cursor enters it.  Timers
+ * on the wheel are on the longterm mpqueue as far as the rest of this
+ * file is concerned: its lock protects the slots and its count.
+ */
+#define TIMER_WHEEL_SLOTS		64
+#define TIMER_WHEEL_GRANULE		(250 * NSEC_PER_MSEC)
+
+typedef struct {
+	uint32_t	shift;		/* log2 of the granule, in abstime */
+	uint64_t	cursor;		/* level 0 slots before this are empty */
+	uint64_t	cascades;	/* num level 1 timers moved to level 0 */
+	queue_head_t	slots[2][TIMER_WHEEL_SLOTS];
+} timer_wheel_t;
+
 typedef struct {
 	uint64_t	interval;	/* longterm timer interval */
 	uint64_t	margin;		/* fudge factor (10% of interval */
@@ -144,6 +167,7 @@ typedef struct {
 	uint64_t	scan_limit;	/* maximum scan time */
 	uint64_t	scan_interval;	/* interval between LT "escalation" scans */
 	uint64_t	scan_pauses;	/* num scans exceeding time limit */
+	timer_wheel_t	wheel;		/* the longterm timers, by deadline */
 } timer_longterm_t;
 
 timer_longterm_t		timer_longterm = {
@@ -1233,6 +1257,126 @@ timer_queue_trace(
 	splx(s);
 }
 
+/*
+ * Timer wheel, see timer_wheel_t.
+ * The longterm queue is locked by the callers of all these routines.
+ */
+static queue_head_t *
+timer_wheel_slot(timer_wheel_t *tw, uint64_t deadline)
+{
+	uint64_t	granule = deadline >> tw->shift;
+	uint64_t	cursor = tw->cursor >> tw->shift;
+
+	if (granule <= cursor)
+		return &tw->slots[0][cursor % TIMER_WHEEL_SLOTS];
+	if (granule / TIMER_WHEEL_SLOTS == cursor / TIMER_WHEEL_SLOTS)
+		return &tw->slots[0][granule % TIMER_WHEEL_SLOTS];
+	return &tw->slots[1][(granule / TIMER_WHEEL_SLOTS) % TIMER_WHEEL_SLOTS];
+}
+
+static void
+timer_wheel_enqueue(timer_wheel_t *tw, timer_call_t call, uint64_t now)
+{
+	assert(TCE(call)->queue == NULL);
+
+	/* restart an empty wheel from the current time */
+	if (timer_longterm_queue->count == 0)
+		tw->cursor = now;
+
+	enqueue_tail(timer_wheel_slot(tw, call->soft_deadline), qe(TCE(call)));
+	TCE(call)->queue = QUEUE(timer_longterm_queue);
+	timer_longterm_queue->count++;
+}
+
+/*
+ * Move the level 1 timers of the period the cursor just entered to their
+ * level 0 slots.  Their call locks aren't needed: the links and
+ * soft deadlines of queued timers only change with the queue locked.
+ */
+static void
+timer_wheel_cascade(timer_wheel_t *tw, uint64_t period)
+{
+	queue_head_t	*slot = &tw->slots[1][period % TIMER_WHEEL_SLOTS];
+	queue_entry_t	qe, next;
+	timer_call_t	call;
+
+	for (qe = queue_first(slot); !queue_end(slot, qe); qe = next) {
+		call = TIMER_CALL(qe);
+		next = queue_next(qe);
+		if ((call->soft_deadline >> tw->shift) / TIMER_WHEEL_SLOTS > period)
+			continue;
+		(void) remque(qe);
+		enqueue_tail(timer_wheel_slot(tw, call->soft_deadline), qe);
+		tw->cascades++;
+	}
+}
+
+/*
+ * Find the soonest timer in the slots after the cursor, for the next
+ * threshold deadline.  If there aren't any within a rotation of the level
+ * 1 slots, return the start of the next rotation to cascade the rest.
+ */
+static void
+timer_wheel_next(timer_longterm_t *tlp)
+{
+	timer_wheel_t	*tw = &tlp->wheel;
+	uint64_t	cursor = tw->cursor >> tw->shift;
+	uint64_t	period = cursor / TIMER_WHEEL_SLOTS;
+	uint64_t	granule, p;
+	queue_head_t	*slot;
+	queue_entry_t	qe;
+	timer_call_t	call;
+
+	for (granule = cursor + 1; granule / TIMER_WHEEL_SLOTS == period; granule++) {
+		slot = &tw->slots[0][granule % TIMER_WHEEL_SLOTS];
+		qe_foreach(qe, slot) {
+			call = TIMER_CALL(qe);
+			if (call->soft_deadline < tlp->threshold.deadline) {
+				tlp->threshold.deadline = call->soft_deadline;
+				tlp->threshold.call = call;
+			}
+		}
+		if (tlp->threshold.deadline != TIMER_LONGTERM_NONE)
+			return;
+	}
+
+	for (p = period + 1; p <= period + TIMER_WHEEL_SLOTS; p++) {
+		slot = &tw->slots[1][p % TIMER_WHEEL_SLOTS];
+		qe_foreach(qe, slot) {
+			call = TIMER_CALL(qe);
+			if ((call->soft_deadline >> tw->shift) / TIMER_WHEEL_SLOTS != p)
+				continue;
+			if (call->soft_deadline < tlp->threshold.deadline) {
+				tlp->threshold.deadline = call->soft_deadline;
+				tlp->threshold.call = call;
+			}
+		}
+		if (tlp->threshold.deadline != TIMER_LONGTERM_NONE)
+			return;
+	}
+
+	if (timer_longterm_queue->count != 0) {
+		p = period + TIMER_WHEEL_SLOTS;
+		tlp->threshold.deadline = (p * TIMER_WHEEL_SLOTS) << tw->shift;
+		tlp->threshold.call = NULL;
+	}
+}
+
+static void
+timer_wheel_init(timer_wheel_t *tw)
+{
+	uint64_t	granule;
+
+	nanoseconds_to_absolutetime(TIMER_WHEEL_GRANULE, &granule);
+	for (tw->shift = 0; (2ULL << tw->shift) <= granule; tw->shift++)
+		continue;
+	tw->cursor = 0;
+
+	for (int level = 0; level < 2; level++)
+		for (int i = 0; i < TIMER_WHEEL_SLOTS; i++)
+			queue_init(&tw->slots[level][i]);
+}
+
 void
 timer_longterm_dequeued_locked(timer_call_t call)
 {
@@ -1291,7 +1435,7 @@ timer_longterm_enqueue_unlocked(timer_call_t	call,
 	call->ttd = ttd;
 	call->soft_deadline = soft_deadline;
 	call->flags = callout_flags;
-	timer_call_entry_enqueue_tail(call, timer_longterm_queue);
+	timer_wheel_enqueue(&tlp->wheel, call, now);
 	
 	tlp->enqueues++;
 
@@ -1323,12 +1467,12 @@ timer_longterm_enqueue_unlocked(timer_call_t	call,
 }
 
 /*
- * Scan for timers below the longterm threshold.
+ * Scan a slot of the timer wheel for timers below the longterm threshold.
  * Move these to the local timer queue (of the boot processor on which the
  * calling thread is running).
  * Both the local (boot) queue and the longterm queue are locked.
  * The scan is similar to the timer migrate sequence but is performed by
- * successively examining each timer on the longterm queue:
+ * successively examining each timer in the slot:
  *  - if within the short-term threshold
  *    - enter on the local queue (unless being deleted), 
  *  - otherwise:
@@ -1336,35 +1480,22 @@ timer_longterm_enqueue_unlocked(timer_call_t	call,
  * The total scan time is limited to TIMER_LONGTERM_SCAN_LIMIT. Should this be
  * exceeded, we abort and reschedule again so that we don't shut others from
  * the timer queues. Longterm timers firing late is not critical.
+ * Returns FALSE if the scan was aborted.
  */
-void
-timer_longterm_scan(timer_longterm_t	*tlp,
-		    uint64_t		time_start)
+static boolean_t
+timer_longterm_scan_slot(timer_longterm_t	*tlp,
+			 queue_head_t		*slot,
+			 mpqueue_head_t		*timer_master_queue,
+			 uint64_t		threshold,
+			 uint64_t		time_start,
+			 uint64_t		time_limit)
 {
 	queue_entry_t	qe;
 	timer_call_t	call;
-	uint64_t	threshold;
 	uint64_t	deadline;
-	uint64_t	time_limit = time_start + tlp->scan_limit;
-	mpqueue_head_t	*timer_master_queue;
-
-	assert(!ml_get_interrupts_enabled());
-	assert(cpu_number() == master_cpu);
 
-	if (tlp->threshold.interval != TIMER_LONGTERM_NONE)
-		threshold = time_start + tlp->threshold.interval;
-
-	tlp->threshold.deadline = TIMER_LONGTERM_NONE;
-	tlp->threshold.call = NULL;
-
-	if (queue_empty(&timer_longterm_queue->head))
-		return;
-
-	timer_master_queue = timer_queue_cpu(master_cpu);
-	timer_queue_lock_spin(timer_master_queue);
-
-	qe = queue_first(&timer_longterm_queue->head);
-	while (!queue_end(&timer_longterm_queue->head, qe)) {
+	qe = queue_first(slot);
+	while (!queue_end(slot, qe)) {
 		call = TIMER_CALL(qe);
 		deadline = call->soft_deadline;
 		qe = queue_next(qe);
@@ -1426,10 +1557,79 @@ timer_longterm_scan(timer_longterm_t	*tlp,
 			tlp->scan_pauses++;
 			DBG("timer_longterm_scan() paused %llu, qlen: %llu\n",
 			    time_limit, tlp->queue.count); 
-			break;
+			return FALSE;
 		}
 	}
 
+	return TRUE;
+}
+
+/*
+ * Scan for timers below the longterm threshold: advance the wheel cursor
+ * up to the threshold, escalating the timers of each level 0 slot on the
+ * way and cascading level 1 slots as it enters their period.  Then look
+ * for the soonest remaining timer, to set the next threshold deadline.
+ */
+void
+timer_longterm_scan(timer_longterm_t	*tlp,
+		    uint64_t		time_start)
+{
+	timer_wheel_t	*tw = &tlp->wheel;
+	uint64_t	threshold;
+	uint64_t	granule;
+	uint64_t	time_limit = time_start + tlp->scan_limit;
+	mpqueue_head_t	*timer_master_queue;
+
+	assert(!ml_get_interrupts_enabled());
+	assert(cpu_number() == master_cpu);
+
+	if (tlp->threshold.interval != TIMER_LONGTERM_NONE)
+		threshold = time_start + tlp->threshold.interval;
+	else
+		threshold = TIMER_LONGTERM_NONE;
+
+	tlp->threshold.deadline = TIMER_LONGTERM_NONE;
+	tlp->threshold.call = NULL;
+
+	if (timer_longterm_queue->count == 0)
+		return;
+
+	timer_master_queue = timer_queue_cpu(master_cpu);
+	timer_queue_lock_spin(timer_master_queue);
+
+	if (threshold == TIMER_LONGTERM_NONE) {
+		/* the longterm queue is being disabled: escalate everything */
+		for (int level = 0; level < 2; level++) {
+			for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+				if (!timer_longterm_scan_slot(tlp,
+				    &tw->slots[level][i], timer_master_queue,
+				    threshold, time_start, time_limit))
+					goto out;
+			}
+		}
+		goto out;
+	}
+
+	for (;;) {
+		granule = tw->cursor >> tw->shift;
+		if (!timer_longterm_scan_slot(tlp,
+		    &tw->slots[0][granule % TIMER_WHEEL_SLOTS],
+		    timer_master_queue, threshold, time_start, time_limit))
+			goto out;
+
+		/* stay on the slot the threshold falls in */
+		if (((granule + 1) << tw->shift) > threshold)
+			break;
+
+		tw->cursor = (granule + 1) << tw->shift;
+		if ((granule + 1) % TIMER_WHEEL_SLOTS == 0)
+			timer_wheel_cascade(tw, (granule + 1) / TIMER_WHEEL_SLOTS);
+	}
+
+	/* timers left in the cursor's slot are the soonest */
+	if (tlp->threshold.deadline == TIMER_LONGTERM_NONE)
+		timer_wheel_next(tlp);
+out:
 	timer_queue_unlock(timer_master_queue);
 }
 
@@ -1570,6 +1770,7 @@ timer_longterm_init(void)
 		     "timer_longterm", &timer_longterm_lck_grp_attr);
 	mpqueue_init(&tlp->queue,
 		     &timer_longterm_lck_grp, &timer_longterm_lck_attr);
+	timer_wheel_init(&tlp->wheel);
 
 	timer_call_setup(&tlp->threshold.timer,
 			 timer_longterm_callout, (timer_call_param_t) tlp);
@@ -1657,7 +1858,7 @@ timer_master_scan(timer_longterm_t	*tlp,
 		if (deadline > threshold) {
 			/* move from master to longterm */
 			timer_call_entry_dequeue(call);
-			timer_call_entry_enqueue_tail(call, timer_longterm_queue);
+			timer_wheel_enqueue(&tlp->wheel, call, now);
 			if (deadline < tlp->threshold.deadline) {
 				tlp->threshold.deadline = deadline;
 				tlp->threshold.call = call;
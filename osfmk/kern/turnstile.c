@@ -1999,6 +1999,35 @@ turnstile_workq_proprietor_of_max_turnstile(
 }
 
 
+/*
+ * Name: turnstile_trace_priority_chain_walk
+ *
+ * Description: Trace the number of hops a priority propagation took,
+ *              and how many of them went through a thread.
+ *
+ * Arg1: inheritor the propagation started from
+ * Arg2: inheritor flags
+ * Arg3: total_hop: number of hops visited
+ * Arg4: thread_hop: number of thread hops visited
+ *
+ * Returns: None.
+ */
+static inline void
+turnstile_trace_priority_chain_walk(
+	turnstile_inheritor_t inheritor,
+	turnstile_update_flags_t turnstile_flags,
+	int total_hop,
+	int thread_hop)
+{
+	KERNEL_DEBUG_CONSTANT_IST(KDEBUG_TRACE,
+		(TURNSTILE_CODE(TURNSTILE_PRIORITY_OPERATIONS,
+		(TURNSTILE_PRIORITY_CHAIN_WALK))) | DBG_FUNC_NONE,
+		VM_KERNEL_UNSLIDE_OR_PERM(inheritor),
+		turnstile_flags,
+		total_hop,
+		thread_hop, 0);
+}
+
 /*
  * Name: turnstile_update_inheritor_priority_chain
  *
@@ -2068,6 +2097,8 @@ turnstile_update_inheritor_priority_chain(
 				turnstile_update_inheritor_workq_priority_chain(turnstile, s);
 				turnstile_stats_update(total_hop + 1, TSU_NO_PRI_CHANGE_NEEDED | tsu_flags,
 					NULL);
+				turnstile_trace_priority_chain_walk(inheritor, turnstile_flags,
+					total_hop + 1, thread_hop);
 				return;
 
 			} else {
@@ -2082,6 +2113,8 @@ turnstile_update_inheritor_priority_chain(
 	}
 
 	splx(s);
+	turnstile_trace_priority_chain_walk(inheritor, turnstile_flags,
+		total_hop, thread_hop);
 	return;
 }
 
@@ -2395,6 +2428,16 @@ thread_update_waiting_turnstile_priority_chain(
 		return;
 	}
 
+	/*
+	 * The turnstile lock is taken before the thread lock, but trying it
+	 * with the thread lock held can't deadlock: when it succeeds, the
+	 * thread couldn't have left the waitq in between, and the hop
+	 * doesn't need to drop and retake the thread lock.
+	 */
+	if (waitq_lock_try(&waiting_turnstile->ts_waitq)) {
+		goto locked;
+	}
+
 	/* take a reference on thread, turnstile and snapshot of gencount */
 	turnstile_gencount = turnstile_get_gencount(waiting_turnstile);
 	turnstile_reference(waiting_turnstile);
@@ -2426,6 +2469,7 @@ thread_update_waiting_turnstile_priority_chain(
 	thread_deallocate_safe(thread);
 	turnstile_deallocate_safe(waiting_turnstile);
 
+locked:
 	/* adjust thread's position on turnstile waitq */
 	needs_update = turnstile_update_thread_promotion_locked(waiting_turnstile, thread);
 
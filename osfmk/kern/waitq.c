@@ -66,6 +66,7 @@
 #include <kern/kern_types.h>
 #include <kern/ltable.h>
 #include <kern/mach_param.h>
+#include <kern/misc_protos.h>
 #include <kern/queue.h>
 #include <kern/sched_prim.h>
 #include <kern/simple_lock.h>
@@ -76,9 +77,18 @@
 #include <kern/turnstile.h>
 
 #include <libkern/OSAtomic.h>
+#include <machine/atomic.h>
 #include <mach/sync_policy.h>
 #include <vm/vm_kern.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <i386/mp.h>
+#endif
+
+#if defined (__arm__) || defined (__arm64__)
+#include <arm/cpu_data_internal.h>
+#endif
+
 #include <sys/kdebug.h>
 
 #if defined(KEEP_WAITQ_LINK_STATS) || defined(KEEP_WAITQ_PREPOST_STATS)
@@ -336,7 +346,7 @@ static void wql_init(void)
 
 static void wql_ensure_free_space(void)
 {
-	if (g_wqlinktable.nelem - g_wqlinktable.used_elem < g_min_free_table_elem) {
+	if (ltable_nfree(&g_wqlinktable) < g_min_free_table_elem) {
 		/*
 		 * we don't hold locks on these values, so check for underflow
 		 */
@@ -344,7 +354,7 @@ static void wql_ensure_free_space(void)
 			wqdbg_v("Forcing table growth: nelem=%d, used=%d, min_free=%d",
 				g_wqlinktable.nelem, g_wqlinktable.used_elem,
 				g_min_free_table_elem);
-			ltable_grow(&g_wqlinktable, g_min_free_table_elem);
+			ltable_try_grow(&g_wqlinktable, g_min_free_table_elem);
 		}
 	}
 }
@@ -755,7 +765,7 @@ static void wq_prepost_ensure_free_space(void)
 	/*
 	 * Now ensure that we have a sufficient amount of free table space
 	 */
-	free_elem = g_prepost_table.nelem - g_prepost_table.used_elem;
+	free_elem = ltable_nfree(&g_prepost_table);
 	min_free = g_min_free_table_elem + g_min_free_cache;
 	if (free_elem < min_free) {
 		/*
@@ -765,7 +775,7 @@ static void wq_prepost_ensure_free_space(void)
 			wqdbg_v("Forcing table growth: nelem=%d, used=%d, min_free=%d+%d",
 				g_prepost_table.nelem, g_prepost_table.used_elem,
 				g_min_free_table_elem, g_min_free_cache);
-			ltable_grow(&g_prepost_table, min_free);
+			ltable_try_grow(&g_prepost_table, min_free);
 		}
 	}
 }
@@ -1328,6 +1338,15 @@ static int wq_is_preposted_on_set(struct waitq *waitq, struct waitq_set *wqset)
 	    wqset->wqset_prepost_id == waitq->waitq_prepost_id)
 		return 1;
 
+	/*
+	 * A waitq without a prepost object can't be on any prepost list:
+	 * clearing its prepost invalidated every post that pointed to it.
+	 * Skip the walk so going from empty to non-empty stays O(1), the
+	 * receive side culls the stale posts (see waitq_set_rotate_preposts).
+	 */
+	if (waitq->waitq_prepost_id == 0)
+		return 0;
+
 	/* use full prepost iteration: always trim the list */
 	pctx.posting_wq = waitq;
 	pctx.did_prepost = 0;
@@ -1580,6 +1599,20 @@ static struct waitq g_boot_waitq;
 static struct waitq *global_waitqs = &g_boot_waitq;
 static uint32_t g_num_waitqs = 1;
 
+/*
+ * Number of threads queued on each global waitq.  It is updated with the
+ * queue locked, and read without the lock by wakeups so that waking up an
+ * event nobody waits on doesn't touch the queue lock at all.
+ */
+static uint32_t g_boot_nwaiters;
+static volatile uint32_t *g_waitq_nwaiters = &g_boot_nwaiters;
+
+/* skip wakeups of empty global waitqs without locking them */
+int waitq_lockless_wakeup = 1;
+
+/* global waitqs to allocate per possible processor, at least */
+#define WAITQ_QUEUES_PER_CPU	64
+
 /*
  * Zero out the used MSBs of the event.
  */
@@ -1701,6 +1734,33 @@ int waitq_is_global(struct waitq *waitq)
 	return 0;
 }
 
+static __inline__ volatile uint32_t *waitq_global_nwaiters(struct waitq *waitq)
+{
+	uint32_t idx;
+
+	idx = (uint32_t)(((uintptr_t)waitq - (uintptr_t)global_waitqs) / sizeof(*waitq));
+	assert(idx < g_num_waitqs);
+	return &g_waitq_nwaiters[idx];
+}
+
+/*
+ * Returns FALSE when a global waitq is known to have no waiters, without
+ * taking its lock.
+ *
+ * The barrier orders the caller's update of the state the waiters test
+ * before the load of the count.  It pairs with the one in
+ * waitq_thread_insert(): either this sees the waiter queued, or the waiter
+ * sees the new state when it checks it after assert_wait().
+ */
+static __inline__ boolean_t waitq_global_may_have_waiters(struct waitq *waitq)
+{
+	if (!waitq_lockless_wakeup || !waitq_is_global(waitq))
+		return TRUE;
+
+	os_atomic_thread_fence(seq_cst);
+	return os_atomic_load(waitq_global_nwaiters(waitq), relaxed) != 0;
+}
+
 int waitq_irq_safe(struct waitq *waitq)
 {
 	/* global wait queues have this bit set on initialization */
@@ -1729,6 +1789,15 @@ static uint32_t waitq_hash_size(void)
 		return (hsize);
 
 	queues = thread_max / 5;
+
+	/*
+	 * The queues are locked by every wait and wakeup on an event that hashes
+	 * to them: keep enough of them that processors rarely share one.  This
+	 * runs before the processors are registered, so use the most there
+	 * can be.
+	 */
+	if (queues < MAX_CPUS * WAITQ_QUEUES_PER_CPU)
+		queues = MAX_CPUS * WAITQ_QUEUES_PER_CPU;
 	hsize = P2ROUNDUP(queues * sizeof(struct waitq), PAGE_SIZE);
 
 	return hsize;
@@ -1774,6 +1843,14 @@ static inline void waitq_thread_insert(struct waitq *wq,
 		} else {
 			enqueue_head(&wq->waitq_queue, &thread->wait_links);
 		}
+
+		if (waitq_is_global(wq)) {
+			volatile uint32_t *nwaiters = waitq_global_nwaiters(wq);
+
+			/* see waitq_global_may_have_waiters() */
+			os_atomic_store(nwaiters, *nwaiters + 1, relaxed);
+			os_atomic_thread_fence(seq_cst);
+		}
 	}
 }
 
@@ -1790,6 +1867,13 @@ static inline void waitq_thread_remove(struct waitq *wq,
 				PRIORITY_QUEUE_SCHED_PRI_MAX_HEAP_COMPARE);
 	} else {
 		remqueue(&(thread->wait_links));
+
+		if (waitq_is_global(wq)) {
+			volatile uint32_t *nwaiters = waitq_global_nwaiters(wq);
+
+			assert(*nwaiters > 0);
+			os_atomic_store(nwaiters, *nwaiters - 1, relaxed);
+		}
 	}
 }
 
@@ -1846,6 +1930,13 @@ void waitq_bootstrap(void)
 	memset(g_waitq_stats, 0, whsize);
 #endif
 
+	whsize = P2ROUNDUP(g_num_waitqs * sizeof(uint32_t), PAGE_SIZE);
+	kret = kernel_memory_allocate(kernel_map, (vm_offset_t *)&g_waitq_nwaiters,
+				      whsize, 0, KMA_KOBJECT|KMA_NOPAGEWAIT|KMA_ZERO, VM_KERN_MEMORY_WAITQ);
+	if (kret != KERN_SUCCESS || g_waitq_nwaiters == NULL)
+		panic("kernel_memory_allocate() failed to alloc g_waitq_nwaiters"
+		      ", error: %d, whsize: 0x%x", kret, whsize);
+
 	for (uint32_t i = 0; i < g_num_waitqs; i++) {
 		waitq_init(&global_waitqs[i], SYNC_POLICY_FIFO|SYNC_POLICY_DISABLE_IRQ);
 	}
@@ -2085,7 +2176,8 @@ static thread_t waitq_queue_iterate_locked(struct waitq *safeq, struct waitq *wa
 						*(args->spl) = (safeq != waitq) ? spl : splsched();
 					thread_lock(t);
 					thread_clear_waitq_state(t);
-					re_queue_tail(args->threadq, &t->wait_links);
+					waitq_thread_remove(safeq, t);
+					enqueue_tail(args->threadq, &t->wait_links);
 				}
 				/* only enqueue up to 'max' threads */
 				if (*nthreads >= max_threads && max_threads > 0)
@@ -3407,6 +3499,48 @@ sysctl_helper_waitq_set_nelem(void)
 	return ltable_nelem(&g_wqlinktable);
 }
 
+/*
+ * Describe the occupancy of the link or prepost table and the efficiency
+ * of its per-cpu caches, returns the length of the string in 'buf'.
+ */
+int
+sysctl_helper_waitq_table_stats(int prepost, char *buf, int buf_size)
+{
+	struct link_table *table = prepost ? &g_prepost_table : &g_wqlinktable;
+	uint32_t nelem, used, cached, nfree;
+	uint64_t hits, misses;
+
+	nelem = table->nelem;
+	used = table->used_elem;
+	cached = table->cached_elem;
+	nfree = ltable_nfree(table);
+	ltable_cache_stats(table, &hits, &misses);
+
+	return snprintf(buf, buf_size,
+	    "elements %u, used %u, cached %u, free %u, "
+	    "cache hits %llu, cache misses %llu, hit rate %llu%%\n",
+	    nelem, used, cached, nfree, hits, misses,
+	    (hits + misses) ? (hits * 100) / (hits + misses) : 0);
+}
+
+/*
+ * Time 'iter' wakeups of an event nobody waits on, returns nanoseconds.
+ */
+uint64_t
+sysctl_helper_waitq_wakeup_test(int iter)
+{
+	int event;
+	uint64_t start, elapsed, ns;
+
+	start = mach_absolute_time();
+	for (int i = 0; i < iter; i++)
+		thread_wakeup((event_t)&event);
+	elapsed = mach_absolute_time() - start;
+
+	absolutetime_to_nanoseconds(elapsed, &ns);
+	return ns;
+}
+
 #endif
 
 /**
@@ -5179,6 +5313,37 @@ int waitq_set_iterate_preposts(struct waitq_set *wqset,
 					 wqset_iterate_prepost_cb);
 }
 
+/**
+ * move the first prepost of the given wqset to the back of its list
+ *
+ * Conditions:
+ * 	'wqset' is locked
+ *
+ * Notes:
+ *	Called once the waitq at the head of the list has been serviced so
+ *	that the next one gets its turn, and the invalid posts behind it
+ *	get to the head where the next iteration culls them.
+ *	The list is circular, this is O(1).
+ */
+void waitq_set_rotate_preposts(struct waitq_set *wqset)
+{
+	struct wq_prepost *wqp;
+
+	assert(waitq_held(&wqset->wqset_q));
+
+	if (!wqset->wqset_q.waitq_prepost || !wqset->wqset_prepost_id)
+		return;
+
+	wqp = wq_prepost_get(wqset->wqset_prepost_id);
+	if (!wqp)
+		return;
+
+	if (wqp_type(wqp) == WQP_POST)
+		wqset->wqset_prepost_id = wqp->wqp_post.wqp_next_id;
+
+	wq_prepost_put(wqp);
+}
+
 
 /* ----------------------------------------------------------------------
  *
@@ -5276,6 +5441,11 @@ kern_return_t waitq_wakeup64_one(struct waitq *waitq, event64_t wake_event,
 	if (!waitq_valid(waitq))
 		panic("Invalid waitq: %p", waitq);
 
+	if (!waitq_global_may_have_waiters(waitq)) {
+		waitq_stats_count_fail(waitq);
+		return KERN_NOT_WAITING;
+	}
+
 	if (!waitq_irq_safe(waitq)) {
 		/* reserve preposts in addition to locking the waitq */
 		reserved_preposts = waitq_prepost_reserve(waitq, 0, WAITQ_KEEP_LOCKED);
@@ -5320,6 +5490,11 @@ kern_return_t waitq_wakeup64_all(struct waitq *waitq,
 	if (!waitq_valid(waitq))
 		panic("Invalid waitq: %p", waitq);
 
+	if (!waitq_global_may_have_waiters(waitq)) {
+		waitq_stats_count_fail(waitq);
+		return KERN_NOT_WAITING;
+	}
+
 	if (!waitq_irq_safe(waitq)) {
 		/* reserve preposts in addition to locking waitq */
 		reserved_preposts = waitq_prepost_reserve(waitq, 0,
@@ -5415,6 +5590,11 @@ waitq_wakeup64_identify(struct waitq    *waitq,
 	if (!waitq_valid(waitq))
 		panic("Invalid waitq: %p", waitq);
 
+	if (!waitq_global_may_have_waiters(waitq)) {
+		waitq_stats_count_fail(waitq);
+		return THREAD_NULL;
+	}
+
 	if (!waitq_irq_safe(waitq)) {
 		/* reserve preposts in addition to locking waitq */
 		reserved_preposts = waitq_prepost_reserve(waitq, 0, WAITQ_KEEP_LOCKED);
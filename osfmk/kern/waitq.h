@@ -373,6 +373,9 @@ extern int waitq_iterate_sets(struct waitq *waitq, void *ctx,
 extern int waitq_set_iterate_preposts(struct waitq_set *wqset,
 				      void *ctx, waitq_iterator_t it);
 
+/* move the first waitq that preposted to wqset to the back of the list */
+extern void waitq_set_rotate_preposts(struct waitq_set *wqset);
+
 /*
  * prepost reservation
  */
@@ -424,6 +427,8 @@ extern kern_return_t waitq_set_free(struct waitq_set *wqset);
 
 #if DEVELOPMENT || DEBUG
 extern int sysctl_helper_waitq_set_nelem(void);
+extern uint64_t sysctl_helper_waitq_wakeup_test(int iter);
+extern int sysctl_helper_waitq_table_stats(int prepost, char *buf, int buf_size);
 #if CONFIG_WAITQ_DEBUG
 extern uint64_t wqset_id(struct waitq_set *wqset);
 
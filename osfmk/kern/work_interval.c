@@ -34,6 +34,7 @@
 #include <kern/thread.h>
 #include <kern/sched_prim.h>
 #include <kern/machine.h>
+#include <kern/processor.h>
 #include <kern/thread_group.h>
 #include <kern/ipc_kobject.h>
 #include <kern/task.h>
@@ -42,6 +43,9 @@
 
 #include <mach/kern_return.h>
 #include <mach/notify.h>
+#include <mach/thread_policy.h>
+
+#include <sys/kdebug.h>
 
 #include <stdatomic.h>
 
@@ -81,8 +85,76 @@ struct work_interval {
 	uint32_t wi_creator_pid;
 	int wi_creator_pidversion;
 
+	/*
+	 * Declared CPU budget per period, in abs time, and the share of a
+	 * CPU it was admitted for, in parts per million.  Written by the
+	 * creator with a joined thread, so at most one at a time.
+	 */
+	uint64_t wi_period;
+	uint64_t wi_budget;
+	uint32_t wi_utilization;
+	_Atomic uint64_t wi_overruns;
 };
 
+/*
+ * Admission control: the budgets of all work intervals may add up to at
+ * most this share of every available CPU, in parts per million, leaving
+ * the rest for everything that isn't realtime.
+ */
+#define WORK_INTERVAL_UTIL_SCALE        1000000
+#define WORK_INTERVAL_ADMISSION_LIMIT   (WORK_INTERVAL_UTIL_SCALE * 3 / 4)
+
+static _Atomic uint64_t work_interval_admitted_utilization;
+
+static bool
+work_interval_admit(uint32_t old_utilization, uint32_t new_utilization)
+{
+	uint64_t limit = (uint64_t)WORK_INTERVAL_ADMISSION_LIMIT * processor_avail_count;
+	uint64_t admitted = atomic_load_explicit(&work_interval_admitted_utilization,
+	                                         memory_order_relaxed);
+	uint64_t wanted;
+
+	do {
+		wanted = admitted - old_utilization + new_utilization;
+		if (new_utilization > old_utilization && wanted > limit)
+			return false;
+	} while (!atomic_compare_exchange_weak_explicit(&work_interval_admitted_utilization,
+	                                                &admitted, wanted,
+	                                                memory_order_relaxed,
+	                                                memory_order_relaxed));
+
+	return true;
+}
+
+/*
+ * Schedule the thread by the budget of the work interval it joined:
+ * realtime with the interval's period as its constraint, so that the
+ * deadline-sorted realtime runqueue runs the intervals earliest
+ * deadline first.  Without a budget, the thread goes back to timeshare.
+ */
+static kern_return_t
+work_interval_thread_set_policy(thread_t thread, struct work_interval *work_interval)
+{
+	if (work_interval->wi_budget == 0) {
+		struct thread_standard_policy standard = {};
+
+		return thread_policy_set_internal(thread, THREAD_STANDARD_POLICY,
+		                                  (thread_policy_t)&standard,
+		                                  THREAD_STANDARD_POLICY_COUNT);
+	}
+
+	struct thread_time_constraint_policy constraint = {
+		.period         = (uint32_t)work_interval->wi_period,
+		.computation    = (uint32_t)work_interval->wi_budget,
+		.constraint     = (uint32_t)work_interval->wi_period,
+		.preemptible    = TRUE,
+	};
+
+	return thread_policy_set_internal(thread, THREAD_TIME_CONSTRAINT_POLICY,
+	                                  (thread_policy_t)&constraint,
+	                                  THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+}
+
 static inline void
 wi_retain(struct work_interval *work_interval)
 {
@@ -101,7 +173,8 @@ wi_release(struct work_interval *work_interval)
 	assert(old_count > 0);
 
 	if (old_count == 1) {
-
+		if (work_interval->wi_utilization != 0)
+			(void)work_interval_admit(work_interval->wi_utilization, 0);
 
 		kfree(work_interval, sizeof(struct work_interval));
 	}
@@ -294,6 +367,13 @@ thread_set_work_interval(thread_t thread,
 	/* transfer +1 ref to thread */
 	thread->th_work_interval = work_interval;
 
+	if (work_interval != NULL && work_interval->wi_budget != 0) {
+		(void)work_interval_thread_set_policy(thread, work_interval);
+	} else if (old_th_wi != NULL && old_th_wi->wi_budget != 0 && thread->active) {
+		/* leaving a budgeted interval: back to timeshare */
+		struct work_interval no_budget = {};
+		(void)work_interval_thread_set_policy(thread, &no_budget);
+	}
 
 	if (old_th_wi != NULL)
 		wi_release(old_th_wi);
@@ -330,6 +410,16 @@ kern_work_interval_notify(thread_t thread, struct kern_work_interval_args* kwi_a
 		return (KERN_INVALID_ARGUMENT);
 	}
 
+	if (work_interval->wi_budget != 0 && kwi_args->finish > kwi_args->deadline) {
+		uint64_t overruns = atomic_fetch_add_explicit(&work_interval->wi_overruns,
+		                                              1, memory_order_relaxed) + 1;
+
+		KERNEL_DEBUG_CONSTANT_IST(KDEBUG_TRACE,
+		    MACHDBG_CODE(DBG_MACH_SCHED, MACH_WORK_INTERVAL_OVERRUN) | DBG_FUNC_NONE,
+		    work_interval->wi_id, kwi_args->finish - kwi_args->deadline,
+		    overruns, 0, 0);
+	}
+
 	spl_t s = splsched();
 
 
@@ -344,6 +434,81 @@ kern_work_interval_notify(thread_t thread, struct kern_work_interval_args* kwi_a
 	return (KERN_SUCCESS);
 }
 
+/*
+ * Look up the work interval the thread joined, on behalf of its creator.
+ */
+static struct work_interval *
+work_interval_for_creator(thread_t thread, uint64_t work_interval_id)
+{
+	struct work_interval *work_interval = thread->th_work_interval;
+	task_t task = current_task();
+
+	if (work_interval == NULL ||
+	    work_interval->wi_id != work_interval_id)
+		return NULL;
+
+	if (work_interval->wi_creator_uniqueid   != get_task_uniqueid(task) ||
+	    work_interval->wi_creator_pidversion != get_task_version(task))
+		return NULL;
+
+	return work_interval;
+}
+
+kern_return_t
+kern_work_interval_set_budget(thread_t thread, uint64_t work_interval_id,
+                              uint64_t period, uint64_t budget)
+{
+	assert(thread == current_thread());
+
+	struct work_interval *work_interval = work_interval_for_creator(thread, work_interval_id);
+	uint32_t utilization = 0;
+
+	if (work_interval == NULL)
+		return KERN_INVALID_ARGUMENT;
+
+	if (budget != 0) {
+		if (period == 0 || budget > period || period > UINT32_MAX)
+			return KERN_INVALID_ARGUMENT;
+		utilization = (uint32_t)((budget * WORK_INTERVAL_UTIL_SCALE + period - 1) / period);
+	}
+
+	if (!work_interval_admit(work_interval->wi_utilization, utilization))
+		return KERN_RESOURCE_SHORTAGE;
+
+	uint64_t old_period = work_interval->wi_period;
+	uint64_t old_budget = work_interval->wi_budget;
+	uint32_t old_utilization = work_interval->wi_utilization;
+
+	work_interval->wi_period = period;
+	work_interval->wi_budget = budget;
+	work_interval->wi_utilization = utilization;
+
+	/* the realtime policy checks the budget against the quantum limits */
+	kern_return_t kr = work_interval_thread_set_policy(thread, work_interval);
+	if (kr != KERN_SUCCESS) {
+		work_interval->wi_period = old_period;
+		work_interval->wi_budget = old_budget;
+		work_interval->wi_utilization = old_utilization;
+		(void)work_interval_admit(utilization, old_utilization);
+		return KERN_INVALID_ARGUMENT;
+	}
+
+	return KERN_SUCCESS;
+}
+
+kern_return_t
+kern_work_interval_get_overruns(thread_t thread, uint64_t work_interval_id,
+                                uint64_t *overruns)
+{
+	struct work_interval *work_interval = work_interval_for_creator(thread, work_interval_id);
+
+	if (work_interval == NULL)
+		return KERN_INVALID_ARGUMENT;
+
+	*overruns = atomic_load_explicit(&work_interval->wi_overruns, memory_order_relaxed);
+	return KERN_SUCCESS;
+}
+
 /* Start at 1, 0 is not a valid work interval ID */
 static _Atomic uint64_t unique_work_interval_id = 1;
 
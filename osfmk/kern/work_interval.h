@@ -72,6 +72,14 @@ kern_work_interval_join(thread_t thread, mach_port_name_t port_name);
 extern kern_return_t
 kern_work_interval_notify(thread_t thread, struct kern_work_interval_args* kwi_args);
 
+extern kern_return_t
+kern_work_interval_set_budget(thread_t thread, uint64_t work_interval_id,
+                              uint64_t period, uint64_t budget);
+
+extern kern_return_t
+kern_work_interval_get_overruns(thread_t thread, uint64_t work_interval_id,
+                                uint64_t *overruns);
+
 #ifdef MACH_KERNEL_PRIVATE
 
 extern void work_interval_port_notify(mach_msg_header_t *msg);
@@ -486,6 +486,7 @@ vm_map_copy_t create_vm_map_copy(vm_offset_t start_addr, vm_size_t total_size, v
 boolean_t get_zone_info(zone_t z, mach_zone_name_t *zn, mach_zone_info_t *zi);
 boolean_t is_zone_map_nearing_exhaustion(void);
 extern void vm_pageout_garbage_collect(int collect);
+static void zone_map_check_exhaustion(void);
 
 static inline void *
 page_metadata_get_freelist(struct zone_page_metadata *page_meta)
@@ -1449,6 +1450,35 @@ static thread_call_data_t call_async_alloc;
  */
 #define ZONE_ELEMENT_ALIGNMENT 32
 
+/*
+ * When the elements of a zone_map chunk leave slack at its end, the first
+ * element is staggered by a multiple of ZONE_COLOR_SIZE chosen from the
+ * chunk address, so that the same element of every chunk doesn't land in
+ * the same cache sets. The offset is recomputed, never stored.
+ */
+#define ZONE_COLOR_SIZE 64
+
+boolean_t zone_coloring = TRUE;		/* -no-zcolor disables it */
+
+static inline vm_offset_t
+zone_chunk_color(zone_t zone, vm_offset_t chunk, vm_size_t size)
+{
+	vm_size_t ncolors;
+
+	if (!zone_coloring)
+		return 0;
+#if VM_MAX_TAG_ZONES
+	/* tag tracking indexes elements from the start of each page */
+	if (__improbable(zone->tags))
+		return 0;
+#endif /* VM_MAX_TAG_ZONES */
+
+	ncolors = (size % zone->elem_size) / ZONE_COLOR_SIZE + 1;
+	if (ncolors == 1)
+		return 0;
+	return ((atop(chunk) / atop(size)) % ncolors) * ZONE_COLOR_SIZE;
+}
+
 #define zone_wakeup(zone) thread_wakeup((event_t)(zone))
 #define zone_sleep(zone)				\
 	(void) lck_mtx_sleep(&(zone)->lock, LCK_SLEEP_SPIN_ALWAYS, (event_t)(zone), THREAD_UNINT);
@@ -1484,6 +1514,48 @@ lck_mtx_ext_t   zone_gc_lck_ext;
 boolean_t zone_gc_allowed = TRUE;
 boolean_t panic_include_zprint = FALSE;
 
+/*
+ *	Background reclaim
+ *
+ *	Rather than leaving all-free pages in place until memory pressure
+ *	makes zone_gc() walk every zone, a zone that collects more than
+ *	ZONE_RECLAIM_KEEP_ALLOCS allocation chunks worth of all-free pages
+ *	queues itself for the zone reclaim thread.  That thread runs at
+ *	throttled priority and gives the excess back to the zone map
+ *	ZONE_RECLAIM_BATCH_PAGES at a time, so that neither the zone lock
+ *	nor zone_gc_lock is held for long.
+ */
+#define ZONE_RECLAIM_KEEP_ALLOCS	4
+#define ZONE_RECLAIM_BATCH_PAGES	8
+
+static thread_t		zone_reclaim_thread = THREAD_NULL;
+static volatile SInt32	zone_reclaim_requests = 0;
+static boolean_t	zone_map_warned = FALSE;
+unsigned int		zone_reclaim_wakeups, zone_reclaim_pages;
+
+static void
+zone_reclaim_wakeup(void)
+{
+	OSIncrementAtomic(&zone_reclaim_requests);
+	thread_wakeup((event_t) &zone_reclaim_requests);
+}
+
+/*
+ * Called with the zone locked after a free. Pages zcram()'d in are left alone,
+ * zprealloc() and zfill() reserve them on purpose.
+ */
+static inline void
+zone_reclaim_check(zone_t z)
+{
+	if (__improbable(z->count_all_free_pages > z->reclaim_free_pages) &&
+	    z->collectable && !z->reclaim_pending) {
+		z->reclaim_pending = TRUE;
+		if (zone_reclaim_thread != THREAD_NULL) {
+			zone_reclaim_wakeup();
+		}
+	}
+}
+
 mach_memory_info_t *panic_kext_memory_info = NULL;
 vm_size_t panic_kext_memory_size = 0;
 
@@ -2309,6 +2381,8 @@ zinit(
 	z->count = 0;
 	z->countfree = 0;
 	z->count_all_free_pages = 0;
+	z->reclaim_free_pages = (int)(ZONE_RECLAIM_KEEP_ALLOCS * atop(alloc));
+	z->reclaim_pending = FALSE;
 	z->sum_count = 0LL;
 	z->doing_alloc_without_vm_priv = FALSE;
 	z->doing_alloc_with_vm_priv = FALSE;
@@ -2532,9 +2606,7 @@ zone_replenish_thread(zone_t z)
 				zflags |= KMA_NOENCRYPT;
 				
 			/* Trigger jetsams via the vm_pageout_garbage_collect thread if we're running out of zone memory */
-			if (is_zone_map_nearing_exhaustion()) {
-				thread_wakeup((event_t) &vm_pageout_garbage_collect);
-			}
+			zone_map_check_exhaustion();
 
 			kr = kernel_memory_allocate(zone_map, &space, alloc_size, 0, zflags, VM_KERN_MEMORY_ZONE);
 
@@ -2618,8 +2690,10 @@ zdestroy(zone_t z)
 	}
 #endif /* CONFIG_ZCACHE */
 
-	/* Dump all the free elements */
+	/* Dump all the free elements, waiting out any reclaim batch of this zone */
+	lck_mtx_lock(&zone_gc_lock);
 	drop_free_elements(z);
+	lck_mtx_unlock(&zone_gc_lock);
 
 #if	CONFIG_GZALLOC
 	/* If the zone is gzalloc managed dump all the elements in the free cache */
@@ -2806,7 +2880,8 @@ zcram(
 		}
 	} else {
 		element_count = (unsigned int)(size / elem_size);
-		random_free_to_zone(zone, newmem, 0, element_count, entropy_buffer);	
+		random_free_to_zone(zone, newmem, zone_chunk_color(zone, newmem, size),
+		    element_count, entropy_buffer);
 	}
 	unlock_zone(zone);
 	
@@ -2836,9 +2911,7 @@ zfill(
 	assert(!zone->allows_foreign);
 
 	/* Trigger jetsams via the vm_pageout_garbage_collect thread if we're running out of zone memory */
-	if (is_zone_map_nearing_exhaustion()) {
-		thread_wakeup((event_t) &vm_pageout_garbage_collect);
-	}
+	zone_map_check_exhaustion();
 
 	kr = kernel_memory_allocate(zone_map, &memory, nalloc * alloc_size, 0, KMA_KOBJECT, VM_KERN_MEMORY_ZONE);
 	if (kr != KERN_SUCCESS) {
@@ -2894,6 +2967,11 @@ zone_bootstrap(void)
 	}
 #endif
 
+	/* place zone_map chunk elements from the start of the chunk */
+	if (PE_parse_boot_argn("-no-zcolor", temp_buf, sizeof(temp_buf))) {
+		zone_coloring = FALSE;
+	}
+
 	simple_lock_init(&all_zones_lock, 0);
 
 	num_zones_in_use = 0;
@@ -2941,6 +3019,14 @@ zone_bootstrap(void)
  */
 unsigned int zone_map_jetsam_limit = ZONE_MAP_JETSAM_LIMIT_DEFAULT;
 
+/*
+ * Reclaim all free zone pages and warn memorystatus once the zone map reaches X% of its
+ * jetsam limit, where X=zone_map_warning_limit. Can be set via boot-arg "zone_map_warning_limit".
+ */
+#define ZONE_MAP_WARNING_LIMIT_DEFAULT 90
+
+unsigned int zone_map_warning_limit = ZONE_MAP_WARNING_LIMIT_DEFAULT;
+
 /*
  * Returns pid of the task with the largest number of VM map entries.
  */
@@ -2952,6 +3038,11 @@ extern pid_t find_largest_process_vm_map_entries(void);
  */
 boolean_t memorystatus_kill_on_zone_map_exhaustion(pid_t pid);
 
+/*
+ * Callout to memorystatus when the zone map crosses its warning limit.
+ */
+void memorystatus_on_zone_map_warning(void);
+
 void get_zone_map_size(uint64_t *current_size, uint64_t *capacity)
 {
 	*current_size = zone_map->size;
@@ -2975,6 +3066,32 @@ boolean_t is_zone_map_nearing_exhaustion(void)
 	return FALSE;
 }
 
+static boolean_t is_zone_map_past_warning(void)
+{
+	uint64_t size = zone_map->size;
+	uint64_t capacity = vm_map_max(zone_map) - vm_map_min(zone_map);
+	if (size > ((capacity * zone_map_jetsam_limit * zone_map_warning_limit) / (100 * 100))) {
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Called before growing a zone. Past the jetsam limit the vm_pageout_garbage_collect
+ * thread gets to kill processes; past the warning limit the zone reclaim thread empties
+ * the free pages of every zone and lets memorystatus know, so that it rarely comes to that.
+ */
+static void
+zone_map_check_exhaustion(void)
+{
+	if (is_zone_map_nearing_exhaustion()) {
+		thread_wakeup((event_t) &vm_pageout_garbage_collect);
+	} else if (!zone_map_warned && zone_reclaim_thread != THREAD_NULL &&
+	    is_zone_map_past_warning()) {
+		zone_reclaim_wakeup();
+	}
+}
+
 extern zone_t vm_map_entry_zone;
 extern zone_t vm_object_zone;
 
@@ -3102,6 +3219,11 @@ zone_init(
 	if (PE_parse_boot_argn("zone_map_jetsam_limit", &jetsam_limit_temp, sizeof (jetsam_limit_temp)) &&
 			jetsam_limit_temp > 0 && jetsam_limit_temp <= 100)
 		zone_map_jetsam_limit = jetsam_limit_temp;
+
+	int warning_limit_temp = 0;
+	if (PE_parse_boot_argn("zone_map_warning_limit", &warning_limit_temp, sizeof (warning_limit_temp)) &&
+			warning_limit_temp > 0 && warning_limit_temp <= 100)
+		zone_map_warning_limit = warning_limit_temp;
 }
 
 #pragma mark -
@@ -3371,9 +3493,7 @@ zalloc_internal(
 					zflags |= KMA_NOENCRYPT;
 				
 				/* Trigger jetsams via the vm_pageout_garbage_collect thread if we're running out of zone memory */
-				if (is_zone_map_nearing_exhaustion()) {
-					thread_wakeup((event_t) &vm_pageout_garbage_collect);
-				}
+				zone_map_check_exhaustion();
 
 				retval = kernel_memory_allocate(zone_map, &space, alloc_size, 0, zflags, VM_KERN_MEMORY_ZONE);
 				if (retval == KERN_SUCCESS) {
@@ -3558,6 +3678,7 @@ zfree_direct(zone_t zone, vm_offset_t elem)
 {
 	boolean_t	poison = zfree_poison_element(zone, elem);
 	free_to_zone(zone, elem, poison);
+	zone_reclaim_check(zone);
 }
 
 
@@ -3791,6 +3912,7 @@ zfree(
 	    }
 #endif /* VM_MAX_TAG_ZONES */
 		free_to_zone(zone, elem, poison);
+		zone_reclaim_check(zone);
 	}
 
 	if (__improbable(zone->count < 0)) {
@@ -3922,6 +4044,33 @@ zone_free_count(zone_t zone)
 	return(free_count);
 }
 
+/* Gives the pages on a list snatched from a zone's all_free queue back to the zone map. */
+static unsigned int
+zone_free_page_list(zone_t z, queue_head_t *page_meta_head)
+{
+	unsigned int				total_freed_pages = 0;
+	struct zone_page_metadata	*page_meta;
+
+	while ((page_meta = (struct zone_page_metadata *)dequeue_head(page_meta_head)) != NULL) {
+		vm_address_t        free_page_address;
+		/* Free the pages for metadata and account for them */
+		free_page_address = get_zone_page(page_meta);
+		ZONE_PAGE_COUNT_DECR(z, page_meta->page_count);
+		total_freed_pages += page_meta->page_count;
+#if KASAN_ZALLOC
+		kasan_poison_range(free_page_address, page_meta->page_count * PAGE_SIZE, ASAN_VALID);
+#endif
+#if VM_MAX_TAG_ZONES
+        if (z->tags) ztMemoryRemove(z, free_page_address, (page_meta->page_count * PAGE_SIZE));
+#endif /* VM_MAX_TAG_ZONES */
+		kmem_free(zone_map, free_page_address, (page_meta->page_count * PAGE_SIZE));
+		if (current_thread()->options & TH_OPT_ZONE_GC) {
+			thread_yield_to_preemption();
+		}
+	}
+	return total_freed_pages;
+}
+
 /* Drops the elements in the free queue of a zone. Called by zone_gc() on each zone, and when a zone is zdestroy'ed. */
 void
 drop_free_elements(zone_t z)
@@ -3946,6 +4095,7 @@ drop_free_elements(zone_t z)
 	queue_new_head(&z->pages.all_free, &page_meta_head, struct zone_page_metadata *, pages);
 	queue_init(&z->pages.all_free);
 	z->count_all_free_pages = 0;
+	z->reclaim_pending = FALSE;
 	unlock_zone(z);
 
 	/* Iterate through all elements to find out size and count of elements we snatched */
@@ -3961,32 +4111,133 @@ drop_free_elements(zone_t z)
 	z->countfree -= size_freed/elt_size;
 	unlock_zone(z);
 
-	while ((page_meta = (struct zone_page_metadata *)dequeue_head(&page_meta_head)) != NULL) {
-		vm_address_t        free_page_address;
-		/* Free the pages for metadata and account for them */
-		free_page_address = get_zone_page(page_meta);
-		ZONE_PAGE_COUNT_DECR(z, page_meta->page_count);
-		total_freed_pages += page_meta->page_count;
-		old_all_free_count -= page_meta->page_count;
-#if KASAN_ZALLOC
-		kasan_poison_range(free_page_address, page_meta->page_count * PAGE_SIZE, ASAN_VALID);
-#endif
-#if VM_MAX_TAG_ZONES
-        if (z->tags) ztMemoryRemove(z, free_page_address, (page_meta->page_count * PAGE_SIZE));
-#endif /* VM_MAX_TAG_ZONES */
-		kmem_free(zone_map, free_page_address, (page_meta->page_count * PAGE_SIZE));
-		if (current_thread()->options & TH_OPT_ZONE_GC) {
-			thread_yield_to_preemption();
-		}
-	}
+	total_freed_pages = zone_free_page_list(z, &page_meta_head);
 
 	/* We freed all the pages from the all_free list for this zone */
-	assert(old_all_free_count == 0);
+	assert(old_all_free_count == total_freed_pages);
 
 	if (zalloc_debug & ZALLOC_DEBUG_ZONEGC)
 		kprintf("zone_gc() of zone %s freed %lu elements, %d pages\n", z->zone_name, (unsigned long)size_freed/elt_size, total_freed_pages);
 }
 
+/*
+ * Frees the all-free pages of a zone beyond the first keep_pages, in batches of
+ * ZONE_RECLAIM_BATCH_PAGES. zone_gc_lock is only held for one batch at a time, so
+ * zone_gc() never waits long for us, and it keeps zdestroy() from racing a batch.
+ */
+static void
+zone_reclaim(zone_t z, int keep_pages)
+{
+	struct zone_page_metadata	*page_meta;
+	queue_head_t				page_meta_head;
+	unsigned int				batch_pages;
+	boolean_t					more;
+
+	do {
+		queue_init(&page_meta_head);
+		lck_mtx_lock(&zone_gc_lock);
+		lock_zone(z);
+		if (!z->zone_valid) {
+			unlock_zone(z);
+			lck_mtx_unlock(&zone_gc_lock);
+			return;
+		}
+		for (batch_pages = 0; batch_pages < ZONE_RECLAIM_BATCH_PAGES &&
+		    z->count_all_free_pages > keep_pages; batch_pages += page_meta->page_count) {
+			page_meta = (struct zone_page_metadata *)dequeue_head(&z->pages.all_free);
+			assert(from_zone_map((vm_address_t)page_meta, sizeof(*page_meta)));
+			z->count_all_free_pages -= page_meta->page_count;
+			z->cur_size -= z->elem_size * page_meta->free_count;
+			z->countfree -= page_meta->free_count;
+			enqueue_tail(&page_meta_head, &page_meta->pages);
+		}
+		more = (z->count_all_free_pages > keep_pages);
+		if (z->count_all_free_pages <= z->reclaim_free_pages) {
+			z->reclaim_pending = FALSE;
+		}
+		unlock_zone(z);
+
+		zone_reclaim_pages += zone_free_page_list(z, &page_meta_head);
+		lck_mtx_unlock(&zone_gc_lock);
+
+		if (more) {
+			thread_yield_to_preemption();
+		}
+	} while (more);
+}
+
+/*
+ * Throttled priority thread which trims the zones that asked for it, and every
+ * zone once the zone map is past its warning limit.
+ */
+__attribute__((noreturn))
+static void
+zone_reclaim_thread_loop(void)
+{
+	unsigned int	max_zones, i;
+	SInt32			requests;
+	boolean_t		warning;
+	zone_t			z;
+
+	for (;;) {
+		requests = zone_reclaim_requests;
+		warning = is_zone_map_past_warning();
+
+		simple_lock(&all_zones_lock);
+		max_zones = num_zones;
+		simple_unlock(&all_zones_lock);
+
+		for (i = 0; i < max_zones; i++) {
+			z = &(zone_array[i]);
+
+			if (!z->collectable || z->count_all_free_pages == 0 ||
+			    !(warning || z->reclaim_pending)) {
+				continue;
+			}
+			zone_reclaim(z, warning ? 0 : z->reclaim_free_pages);
+		}
+
+		/* Only a zone map that stays past the limit after giving back its free pages warrants a warning */
+		if (warning && is_zone_map_past_warning()) {
+			if (!zone_map_warned) {
+				zone_map_warned = TRUE;
+				printf("zone_map_warning: Zone map size %lld, capacity %lld [warning limit %d%% of jetsam limit %d%%]\n",
+				    (uint64_t)zone_map->size, (uint64_t)(vm_map_max(zone_map) - vm_map_min(zone_map)),
+				    zone_map_warning_limit, zone_map_jetsam_limit);
+				memorystatus_on_zone_map_warning();
+			}
+		} else {
+			zone_map_warned = FALSE;
+		}
+
+		assert_wait((event_t) &zone_reclaim_requests, THREAD_UNINT);
+		if (requests != zone_reclaim_requests) {
+			clear_wait(current_thread(), THREAD_AWAKENED);
+		} else {
+			thread_block(THREAD_CONTINUE_NULL);
+		}
+		zone_reclaim_wakeups++;
+	}
+}
+
+void
+zone_reclaim_init(void)
+{
+	thread_t thread;
+	kern_return_t tres;
+
+	tres = kernel_thread_start_priority((thread_continue_t)zone_reclaim_thread_loop, NULL, MAXPRI_THROTTLE, &thread);
+	if (tres != KERN_SUCCESS) {
+		panic("zone_reclaim_init, thread create: 0x%x", tres);
+	}
+	thread_set_thread_name(thread, "zone_reclaim");
+
+	/* Zones may have gone over their threshold before there was a thread to wake */
+	zone_reclaim_thread = thread;
+	zone_reclaim_wakeup();
+	thread_deallocate(thread);
+}
+
 /*	Zone garbage collection
  *
  *	zone_gc will walk through all the free elements in all the
@@ -4382,6 +4633,57 @@ get_zones_collectable_bytes(void)
 	return zones_collectable_bytes;
 }
 
+#if CONFIG_ZCACHE
+
+/*
+ * Returns the number of zones that currently have a per-cpu cache, so that
+ * the kern.zcache_stats sysctl can size its buffer.
+ */
+unsigned int
+get_zcache_zone_count(void)
+{
+	unsigned int i, max_zones, cached_zones = 0;
+
+	simple_lock(&all_zones_lock);
+	max_zones = (unsigned int)(num_zones);
+	simple_unlock(&all_zones_lock);
+
+	for (i = 0; i < max_zones; i++) {
+		if (zone_array[i].zone_valid && zone_caching_enabled(&zone_array[i])) {
+			cached_zones++;
+		}
+	}
+
+	return cached_zones;
+}
+
+/*
+ * Fills in up to max_stats entries of per-zone cache statistics and returns
+ * the number of entries written.
+ */
+unsigned int
+get_zcache_stats(struct zcache_zone_stats *stats, unsigned int max_stats)
+{
+	unsigned int i, max_zones, cached_zones = 0;
+
+	simple_lock(&all_zones_lock);
+	max_zones = (unsigned int)(num_zones);
+	simple_unlock(&all_zones_lock);
+
+	for (i = 0; i < max_zones && cached_zones < max_stats; i++) {
+		zone_t z = &zone_array[i];
+
+		if (!z->zone_valid || !zone_caching_enabled(z)) {
+			continue;
+		}
+		zcache_get_stats(z, &stats[cached_zones++]);
+	}
+
+	return cached_zones;
+}
+
+#endif /* CONFIG_ZCACHE */
+
 kern_return_t
 mach_zone_get_zlog_zones(
 	host_priv_t				host,
@@ -4659,6 +4961,12 @@ zone_copy_all_allocations_inqueue(zone_t z, queue_head_t * queue, uintptr_t * el
             bytesAvail -= metaSize;
             elements   += metaSize;
         }
+        else
+        {
+            metaSize    = zone_chunk_color(z, elements, bytesAvail);
+            bytesAvail -= metaSize;
+            elements   += metaSize;
+        }
         numElements = bytesAvail / z->elem_size;
         // construct array of all possible elements
         for (idx = 0; idx < numElements; idx++)
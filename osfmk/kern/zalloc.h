@@ -121,6 +121,7 @@ struct zone {
 	int		count;		/* Number of elements used now */
 	int		countfree;	/* Number of free elements */
 	int 	count_all_free_pages;  /* Number of pages collectable by GC */
+	int	reclaim_free_pages;	/* all-free pages kept back from background reclaim */
 	lck_attr_t      lock_attr;	/* zone lock attribute */
 	decl_lck_mtx_data(,lock)	/* zone lock */
 	lck_mtx_ext_t   lock_ext;	/* placeholder for indirect mutex */
@@ -155,7 +156,8 @@ struct zone {
 	/* boolean_t */ zone_valid         :1,
 	/* boolean_t */ cpu_cache_enable_when_ready  :1,
 	/* boolean_t */ cpu_cache_enabled  :1,
-	/* future    */ _reserved          :3;
+	/* boolean_t */ reclaim_pending    :1,	/* queued for the zone reclaim thread */
+	/* future    */ _reserved          :2;
 
 	int		index;		/* index into zone_info arrays for this zone */
 	const char	*zone_name;	/* a name for the zone */
@@ -203,6 +205,9 @@ extern void		zone_gc(boolean_t consider_jetsams);
 extern void		consider_zone_gc(boolean_t consider_jetsams);
 extern void		drop_free_elements(zone_t z);
 
+/* Start the thread that trims all-free pages from zones in the background */
+extern void		zone_reclaim_init(void);
+
 /* Debug logging for zone-map-exhaustion jetsams. */
 extern void		get_zone_map_size(uint64_t *current_size, uint64_t *capacity);
 extern void		get_largest_zone_info(char *zone_name, size_t zone_name_len, uint64_t *zone_size);
@@ -364,6 +369,31 @@ extern int get_zleak_state(void);
 
 #endif	/* CONFIG_ZLEAKS */
 
+#if CONFIG_ZCACHE
+
+/*
+ * Statistics reported for every cached zone by the kern.zcache_stats sysctl.
+ * The hit counts cover operations satisfied without touching the zone
+ * allocator, the miss counts cover the ones that had to fill or drain an
+ * entire magazine from or to the zone.
+ */
+struct zcache_zone_stats {
+	char		zcs_zone_name[ZONE_NAME_MAX_LEN];	/* name of the cached zone */
+	uint64_t	zcs_alloc_hits;			/* allocations satisfied by the cache */
+	uint64_t	zcs_alloc_misses;		/* allocations that had to fill a magazine */
+	uint64_t	zcs_free_hits;			/* frees absorbed by the cache */
+	uint64_t	zcs_free_misses;		/* frees that had to drain a magazine */
+	uint64_t	zcs_depot_resizes;		/* number of times the magazine size grew */
+	uint32_t	zcs_magazine_size;		/* current adaptive magazine size */
+	uint32_t	zcs_depot_full;			/* full magazines currently in the depot */
+};
+
+/* support for the kern.zcache_stats sysctl */
+extern unsigned int get_zcache_stats(struct zcache_zone_stats *stats, unsigned int max_stats);
+extern unsigned int get_zcache_zone_count(void);
+
+#endif	/* CONFIG_ZCACHE */
+
 #ifndef VM_MAX_TAG_ZONES
 #error MAX_TAG_ZONES
 #endif
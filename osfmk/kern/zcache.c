@@ -41,12 +41,15 @@
 #endif
 
 #define DEFAULT_MAGAZINE_SIZE	8		/* Default number of elements for all magazines allocated from the magazine_zone */
+#define DEFAULT_MAGAZINE_MAX_SIZE	32	/* Default upper bound the magazine size of a zone is allowed to grow to */
 #define DEFAULT_DEPOT_SIZE	8		/* Default number of elements for the array zcc_depot_list */
 #define ZCC_MAX_CPU_CACHE_LINE_SIZE	64	/* We should use a platform specific macro for this in the future, right now this is the max cache line size for all platforms*/
+#define ZCC_DEPOT_CONTENTION_RESIZE	16	/* Number of contended depot lock acquisitions after which the magazine size of a zone is grown */
 
 lck_grp_t	zcache_locks_grp;			/* lock group for depot_lock */
 zone_t 		magazine_zone;				/* zone to allocate zcc_magazine structs from */
-uint16_t 	magazine_element_count = 0;		/* Size of array in magazine determined by boot-arg or default */
+uint16_t 	magazine_element_count = 0;		/* Initial number of usable elements in a magazine determined by boot-arg or default */
+uint16_t 	magazine_element_max = 0;		/* Size of array in magazine determined by boot-arg or default */
 uint16_t 	depot_element_count = 0;		/* Size of depot lists determined by boot-arg or default */
 bool 		zone_cache_ready = FALSE;		/* Flag to check if zone caching has been set up by zcache_bootstrap */
 uintptr_t	zcache_canary = 0; 			/* Canary used for the caching layer to prevent UaF attacks */
@@ -66,6 +69,10 @@ struct zcc_magazine {
 struct zcc_per_cpu_cache {
 	struct zcc_magazine *current; 		/* Magazine from which we will always try to allocate from and free to first */
 	struct zcc_magazine *previous;		/* Dedicated magazine for a quick reload and to prevent thrashing wen we swap with the depot */
+	uint64_t zcc_alloc_hits;		/* Allocations satisfied by the per-cpu or depot layers */
+	uint64_t zcc_alloc_misses;		/* Allocations that had to fall through to the zone allocator */
+	uint64_t zcc_free_hits;			/* Frees absorbed by the per-cpu or depot layers */
+	uint64_t zcc_free_misses;		/* Frees that had to drain a magazine to the zone allocator */
 } __attribute__(( aligned(ZCC_MAX_CPU_CACHE_LINE_SIZE) ));	/* we want to align this to a cache line size so it does not thrash when multiple cpus want to access their caches in paralell */
 
 
@@ -83,6 +90,9 @@ struct zcc_per_cpu_cache {
 struct zone_cache {
 	lck_mtx_t zcc_depot_lock; 				/* Lock for the depot layer of caching */
 	struct zcc_per_cpu_cache zcc_per_cpu_caches[MAX_CPUS]; 	/* An array of caches, one for each CPU */
+	uint32_t zcc_magazine_size;				/* Number of elements currently usable in an empty magazine (protected by depot lock) */
+	uint32_t zcc_depot_contention;				/* Contended depot lock acquisitions since the last resize (protected by depot lock) */
+	uint64_t zcc_depot_resizes;				/* Number of times the magazine size was grown */
 	int zcc_depot_index;					/* marks the point in the array where empty magazines begin */
 	struct zcc_magazine *zcc_depot_list[0]; 		/* Stores full and empty magazines in the depot layer */
 };
@@ -102,6 +112,7 @@ void zcache_mag_depot_swap_for_free(struct zone_cache *depot, struct zcc_per_cpu
 void zcache_mag_depot_swap(struct zone_cache *depot, struct zcc_per_cpu_cache *cache, boolean_t load_full);
 void zcache_canary_add(zone_t zone, void *addr);
 void zcache_canary_validate(zone_t zone, void *addr);
+void zcache_depot_lock(struct zone_cache *zcache);
 
 /*
  * zcache_ready
@@ -146,7 +157,17 @@ void zcache_bootstrap(void)
 	if (! PE_parse_boot_argn("zcc_magazine_element_count", &magazine_element_count, sizeof (uint16_t)))
 		magazine_element_count = DEFAULT_MAGAZINE_SIZE;
 
-	int magazine_size = sizeof(struct zcc_magazine) + magazine_element_count * sizeof(void *);
+	/* use boot-arg for custom upper bound on the adaptive magazine size */
+	if (! PE_parse_boot_argn("zcc_magazine_element_max", &magazine_element_max, sizeof (uint16_t)))
+		magazine_element_max = DEFAULT_MAGAZINE_MAX_SIZE;
+
+	if (magazine_element_count == 0)
+		magazine_element_count = 1;
+	if (magazine_element_max < magazine_element_count)
+		magazine_element_max = magazine_element_count;
+
+	/* Magazines are always sized for the largest capacity a zone may adapt to */
+	int magazine_size = sizeof(struct zcc_magazine) + magazine_element_max * sizeof(void *);
 
 	magazine_zone = zinit(magazine_size, 100000 * magazine_size , magazine_size, "zcc_magazine_zone");
 
@@ -196,6 +217,11 @@ void zcache_bootstrap(void)
 
  		zcache_mag_init(temp_cache->zcc_per_cpu_caches[i].current, magazine_element_count);
  		zcache_mag_init(temp_cache->zcc_per_cpu_caches[i].previous, magazine_element_count);
+
+		temp_cache->zcc_per_cpu_caches[i].zcc_alloc_hits = 0;
+		temp_cache->zcc_per_cpu_caches[i].zcc_alloc_misses = 0;
+		temp_cache->zcc_per_cpu_caches[i].zcc_free_hits = 0;
+		temp_cache->zcc_per_cpu_caches[i].zcc_free_misses = 0;
  	}
 
  	/* Initialize the lock on the depot layer */
@@ -211,6 +237,9 @@ void zcache_bootstrap(void)
 	}
 
 	temp_cache->zcc_depot_index = 0;
+	temp_cache->zcc_magazine_size = magazine_element_count;
+	temp_cache->zcc_depot_contention = 0;
+	temp_cache->zcc_depot_resizes = 0;
 
  	lock_zone(zone);
 	zone->zcache = temp_cache;
@@ -259,6 +288,13 @@ void zcache_drain_depot(zone_t zone)
 	lck_mtx_lock_spin_always(&(zcache->zcc_depot_lock));
 	/* Mark the depot as available again */
 	zcache->zcc_depot_index = 0;
+	/*
+	 * We are under memory pressure: shrink the magazine size back towards
+	 * its initial value so that the caches hold on to fewer elements.
+	 * Magazines pick up the new size the next time they are empty.
+	 */
+	zcache->zcc_magazine_size = MAX(zcache->zcc_magazine_size / 2, magazine_element_count);
+	zcache->zcc_depot_contention = 0;
 	lck_mtx_unlock(&(zcache->zcc_depot_lock));
 }
 
@@ -294,18 +330,24 @@ bool zcache_free_to_cpu_cache(zone_t zone, void *addr)
 		zcache_swap_magazines(&per_cpu_cache->previous, &per_cpu_cache->current);
 		goto free_to_current;
 	} else{
-		lck_mtx_lock_spin_always(&(zcache->zcc_depot_lock));
+		uint32_t magazine_size;
+
+		zcache_depot_lock(zcache);
 		if (zcache_depot_available(zcache) && (zcache->zcc_depot_index < depot_element_count)) {
 			/* If able, rotate in a new empty magazine from the depot and retry */
 			zcache_mag_depot_swap_for_free(zcache, per_cpu_cache);
 			lck_mtx_unlock(&(zcache->zcc_depot_lock));
 			goto free_to_current;
 		}
+		magazine_size = zcache->zcc_magazine_size;
 		lck_mtx_unlock(&(zcache->zcc_depot_lock));
 		/* Attempt to free an entire magazine of elements */
+		per_cpu_cache->zcc_free_misses++;
 		zcache_mag_drain(zone, per_cpu_cache->current);
 		if(zcache_mag_has_space(per_cpu_cache->current)){
-			goto free_to_current;
+			/* The magazine is now empty, let it pick up the current adaptive size */
+			zcache_mag_init(per_cpu_cache->current, magazine_size);
+			goto free_to_current_counted;
 		}
 	}
 
@@ -314,6 +356,8 @@ bool zcache_free_to_cpu_cache(zone_t zone, void *addr)
 	return FALSE;
 
 free_to_current:
+	per_cpu_cache->zcc_free_hits++;
+free_to_current_counted:
 	assert(zcache_mag_has_space(per_cpu_cache->current));
 	zcache_canary_add(zone, addr);
 	zcache_mag_push(per_cpu_cache->current, addr);
@@ -358,17 +402,22 @@ vm_offset_t zcache_alloc_from_cpu_cache(zone_t zone)
 		zcache_swap_magazines(&per_cpu_cache->previous, &per_cpu_cache->current);
 		goto allocate_from_current;
 	} else {
-		lck_mtx_lock_spin_always(&(zcache->zcc_depot_lock));
+		uint32_t magazine_size;
+
+		zcache_depot_lock(zcache);
 		if (zcache_depot_available(zcache) && (zcache->zcc_depot_index > 0)) {
 			/* If able, rotate in a full magazine from the depot */
 			zcache_mag_depot_swap_for_alloc(zcache, per_cpu_cache);
 			lck_mtx_unlock(&(zcache->zcc_depot_lock));
 			goto allocate_from_current;
 		}
+		magazine_size = zcache->zcc_magazine_size;
 		lck_mtx_unlock(&(zcache->zcc_depot_lock));
 		/* Attempt to allocate an entire magazine of elements */
+		per_cpu_cache->zcc_alloc_misses++;
+		zcache_mag_init(per_cpu_cache->current, magazine_size);
 		if(zcache_mag_fill(zone, per_cpu_cache->current)){
-			goto allocate_from_current;
+			goto allocate_from_current_counted;
 		}
 	}
 
@@ -377,6 +426,8 @@ vm_offset_t zcache_alloc_from_cpu_cache(zone_t zone)
 	return (vm_offset_t) NULL;
 
 allocate_from_current:
+	per_cpu_cache->zcc_alloc_hits++;
+allocate_from_current_counted:
 	ret = zcache_mag_pop(per_cpu_cache->current);
 	assert(ret != NULL);
 	zcache_canary_validate(zone, ret);
@@ -594,6 +645,66 @@ void zcache_mag_depot_swap_for_free(struct zone_cache *zcache, struct zcc_per_cp
 	assert(zcache->zcc_depot_index < depot_element_count);
 	zcache_swap_magazines(&cache->current, &zcache->zcc_depot_list[zcache->zcc_depot_index]);
 	zcache->zcc_depot_index ++;
+	/* The magazine we got back is empty, so it can adopt the current adaptive size */
+	zcache_mag_init(cache->current, zcache->zcc_magazine_size);
+}
+
+/*
+ * zcache_depot_lock
+ *
+ * Description: Takes the depot lock of a zone cache. Contended acquisitions
+ *		are counted, and once enough of them have been seen the
+ *		magazine size of the zone is grown so that the per-cpu layer
+ *		absorbs more operations between trips to the depot.
+ *
+ * Parameters:	zcache	pointer to the zone_cache whose depot should be locked
+ *
+ */
+void zcache_depot_lock(struct zone_cache *zcache)
+{
+	if (lck_mtx_try_lock_spin_always(&(zcache->zcc_depot_lock)))
+		return;
+
+	lck_mtx_lock_spin_always(&(zcache->zcc_depot_lock));
+	if (++zcache->zcc_depot_contention >= ZCC_DEPOT_CONTENTION_RESIZE) {
+		zcache->zcc_depot_contention = 0;
+		if (zcache->zcc_magazine_size < magazine_element_max) {
+			zcache->zcc_magazine_size = MIN(zcache->zcc_magazine_size * 2, magazine_element_max);
+			zcache->zcc_depot_resizes++;
+		}
+	}
+}
+
+/*
+ * zcache_get_stats
+ *
+ * Description: Aggregates the per-cpu hit and miss counters of a zone cache
+ *
+ * Parameters:	zone	pointer to zone for which to collect statistics
+ *		stats	pointer to structure to fill in
+ *
+ * Precondition: check that caching is enabled for zone
+ */
+void zcache_get_stats(zone_t zone, struct zcache_zone_stats *stats)
+{
+	struct zone_cache *zcache = zone->zcache;
+	int i;
+
+	bzero(stats, sizeof(*stats));
+	strlcpy(stats->zcs_zone_name, zone->zone_name, sizeof(stats->zcs_zone_name));
+
+	for (i = 0; i < MAX_CPUS; i++) {
+		struct zcc_per_cpu_cache *per_cpu_cache = &zcache->zcc_per_cpu_caches[i];
+
+		stats->zcs_alloc_hits += per_cpu_cache->zcc_alloc_hits;
+		stats->zcs_alloc_misses += per_cpu_cache->zcc_alloc_misses;
+		stats->zcs_free_hits += per_cpu_cache->zcc_free_hits;
+		stats->zcs_free_misses += per_cpu_cache->zcc_free_misses;
+	}
+
+	stats->zcs_magazine_size = zcache->zcc_magazine_size;
+	stats->zcs_depot_full = MAX(zcache->zcc_depot_index, 0);
+	stats->zcs_depot_resizes = zcache->zcc_depot_resizes;
 }
 
 /*
@@ -100,17 +100,35 @@
  * 	Caching must be enabled explicitly, by calling zone_change() with the
  * Z_CACHING_ENABLED flag, for every zone you want to cache elements for. Zones
  * which are good candidates for this are ones with highly contended zone locks.
+ * All of the kalloc.* zones are cached by default (see kalloc_init()).
  *
- * Some good potential candidates are kalloc.16, kalloc.48, Vm objects, VM map
- * entries, ipc vouchers, and ipc ports.
+ * Some other good potential candidates are Vm objects, VM map entries, ipc
+ * vouchers, and ipc ports.
+ *
+ * 	The number of elements a magazine holds adapts to the contention seen
+ * on the depot lock: every ZCC_DEPOT_CONTENTION_RESIZE contended acquisitions
+ * double the magazine size of the zone up to zcc_magazine_element_max, and
+ * every zone_gc() pass halves it again down to zcc_magazine_element_count.
+ * Magazines only change size while they are empty.
+ *
+ *	Per-zone hit and miss counts can be read through the kern.zcache_stats
+ * sysctl, as an array of struct zcache_zone_stats.
  *
  *
  * Some factors can be tuned by boot-arg:
  *  zcc_enable_for_zone_name 	name of a single zone to enable caching for
  *				(replace space characters with '.')
  *
- *  zcc_magazine_element_count	integer value for magazine size used for all
- *				zones (default 8 is used if not specified)
+ *  zcc_kalloc			set to 0 to stop caching the kalloc.* zones
+ *				by default
+ *
+ *  zcc_magazine_element_count	integer value for the initial magazine size
+ *				used for all zones (default 8 is used if not
+ *				specified)
+ *
+ *  zcc_magazine_element_max	integer value for the largest magazine size a
+ *				zone can adapt to (default 32 is used if not
+ *				specified)
  *
  *  zcc_depot_element_count	integer value for how many full and empty
  *				magazines to store in the depot, if N specified
@@ -121,6 +139,9 @@
 #include <vm/vm_kern.h>
 
 
+struct zcache_zone_stats;
+
+
 /*
  * zcache_ready
  *
@@ -190,3 +211,16 @@ vm_offset_t	zcache_alloc_from_cpu_cache(zone_t zone);
  *
  */
 void 		zcache_drain_depot(zone_t zone);
+
+
+/*
+ * zcache_get_stats
+ *
+ * Description: Aggregates the per-cpu hit and miss counters of a zone cache
+ *
+ * Parameters:	zone	pointer to zone for which to collect statistics
+ *		stats	pointer to structure to fill in
+ *
+ * Precondition: check that caching is enabled for zone
+ */
+void		zcache_get_stats(zone_t zone, struct zcache_zone_stats *stats);
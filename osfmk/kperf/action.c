@@ -43,6 +43,7 @@
 #include <vm/vm_pageout.h>
 
 #include <kperf/action.h>
+#include <kperf/aggregate.h>
 #include <kperf/ast.h>
 #include <kperf/buffer.h>
 #include <kperf/callstack.h>
@@ -286,7 +287,9 @@ log_sample:
 		kperf_thread_snapshot_log(&(sbuf->th_snapshot));
 	}
 	if (sample_what & SAMPLER_KSTACK) {
-		kperf_kcallstack_log(&sbuf->kcallstack);
+		if (!kperf_aggregate_callstack(&sbuf->kcallstack)) {
+			kperf_kcallstack_log(&sbuf->kcallstack);
+		}
 	}
 	if (sample_what & SAMPLER_TH_INSCYC) {
 		kperf_thread_inscyc_log(context);
@@ -315,7 +318,9 @@ log_sample:
 			}
 		} else {
 			if (sample_what & SAMPLER_USTACK) {
-				kperf_ucallstack_log(&(sbuf->ucallstack));
+				if (!kperf_aggregate_callstack(&sbuf->ucallstack)) {
+					kperf_ucallstack_log(&(sbuf->ucallstack));
+				}
 			}
 
 			if (sample_what & SAMPLER_TH_DISPATCH) {
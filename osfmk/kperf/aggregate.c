@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2018 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#include <stdint.h>
+
+#include <kern/assert.h>
+#include <kern/cpu_number.h>
+#include <kern/kalloc.h>
+#include <kern/locks.h>
+#include <kern/machine.h>
+#include <libkern/libkern.h>
+#include <machine/machine_routines.h>
+#include <mach/vm_param.h>
+#include <sys/errno.h>
+
+#include <kperf/aggregate.h>
+#include <kperf/buffer.h>
+#include <kperf/callstack.h>
+#include <kperf/kperf.h>
+
+#define KPERF_AGGREGATE_BUCKETS (128)
+/* how far to look for a callstack, or the least sampled one to evict */
+#define KPERF_AGGREGATE_PROBES  (4)
+
+struct kperf_aggregate_entry {
+	uint64_t count;
+	uint32_t hash;
+	uint32_t flags;
+	uint32_t nframes;
+	uint64_t frames[KPERF_AGGREGATE_MAX_FRAMES];
+};
+
+struct kperf_aggregate_table {
+	lck_spin_t lock;
+	struct kperf_aggregate_entry entries[KPERF_AGGREGATE_BUCKETS];
+};
+
+static int kperf_aggregate_enabled = 0;
+
+/*
+ * The tables are only allocated the first time aggregation is enabled, and
+ * are kept afterwards, as samples pended to the AST can still be taken after
+ * sampling stops.
+ */
+static struct kperf_aggregate_table *kperf_aggregate_tables = NULL;
+static unsigned int kperf_aggregate_ntables = 0;
+
+static uint32_t
+kperf_aggregate_hash(uint64_t *frames, uint32_t nframes, uint32_t flags)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261U ^ flags;
+
+	for (uint32_t i = 0; i < nframes; i++) {
+		hash = (hash ^ (uint32_t)frames[i]) * 16777619U;
+		hash = (hash ^ (uint32_t)(frames[i] >> 32)) * 16777619U;
+	}
+	return hash;
+}
+
+static void
+kperf_aggregate_log_entry(struct kperf_aggregate_entry *entry)
+{
+	BUF_DATA(PERF_CS_AGG, entry->count, entry->hash, entry->flags,
+			entry->nframes);
+	kperf_callstack_log_frames(entry->flags, entry->nframes, entry->frames);
+}
+
+bool
+kperf_aggregate_callstack(struct callstack *cs)
+{
+	struct kperf_aggregate_table *table;
+	struct kperf_aggregate_entry *entry, *victim = NULL;
+	uint64_t frames[KPERF_AGGREGATE_MAX_FRAMES];
+	uint32_t nframes = cs->nframes;
+	uint32_t flags, hash;
+	unsigned int ncpu;
+
+	if (!kperf_aggregate_enabled) {
+		return false;
+	}
+	if (!(cs->flags & CALLSTACK_VALID) || nframes == 0 ||
+			nframes > KPERF_AGGREGATE_MAX_FRAMES) {
+		return false;
+	}
+
+	assert(ml_get_interrupts_enabled() == FALSE);
+	ncpu = cpu_number();
+	if (ncpu >= kperf_aggregate_ntables) {
+		return false;
+	}
+
+	/* compare and log the frames the way the logging would scrub them */
+	if (cs->flags & CALLSTACK_KERNEL_WORDS) {
+		uintptr_t *words = (uintptr_t *)cs->frames;
+		bool kern = cs->flags & CALLSTACK_KERNEL;
+		for (uint32_t i = 0; i < nframes; i++) {
+			frames[i] = kern ? VM_KERNEL_UNSLIDE(words[i]) : words[i];
+		}
+	} else {
+		memcpy(frames, cs->frames, nframes * sizeof(frames[0]));
+	}
+	flags = cs->flags & ~CALLSTACK_KERNEL_WORDS;
+	hash = kperf_aggregate_hash(frames, nframes, flags);
+
+	table = &kperf_aggregate_tables[ncpu];
+	lck_spin_lock(&table->lock);
+
+	for (unsigned int i = 0; i < KPERF_AGGREGATE_PROBES; i++) {
+		entry = &table->entries[(hash + i) % KPERF_AGGREGATE_BUCKETS];
+		if (entry->count == 0) {
+			victim = entry;
+			break;
+		}
+		if (entry->hash == hash && entry->flags == flags &&
+				entry->nframes == nframes &&
+				memcmp(entry->frames, frames, nframes * sizeof(frames[0])) == 0) {
+			entry->count++;
+			lck_spin_unlock(&table->lock);
+			return true;
+		}
+		if (victim == NULL || entry->count < victim->count) {
+			victim = entry;
+		}
+	}
+
+	if (victim->count != 0) {
+		kperf_aggregate_log_entry(victim);
+	}
+	victim->count = 1;
+	victim->hash = hash;
+	victim->flags = flags;
+	victim->nframes = nframes;
+	memcpy(victim->frames, frames, nframes * sizeof(frames[0]));
+
+	lck_spin_unlock(&table->lock);
+	return true;
+}
+
+static void
+kperf_aggregate_drain(bool log)
+{
+	for (unsigned int i = 0; i < kperf_aggregate_ntables; i++) {
+		struct kperf_aggregate_table *table = &kperf_aggregate_tables[i];
+
+		boolean_t intrs_en = ml_set_interrupts_enabled(FALSE);
+		lck_spin_lock(&table->lock);
+		for (unsigned int j = 0; j < KPERF_AGGREGATE_BUCKETS; j++) {
+			struct kperf_aggregate_entry *entry = &table->entries[j];
+			if (entry->count != 0) {
+				if (log) {
+					kperf_aggregate_log_entry(entry);
+				}
+				entry->count = 0;
+			}
+		}
+		lck_spin_unlock(&table->lock);
+		ml_set_interrupts_enabled(intrs_en);
+	}
+}
+
+void
+kperf_aggregate_flush(void)
+{
+	kperf_aggregate_drain(true);
+}
+
+void
+kperf_aggregate_reset(void)
+{
+	kperf_aggregate_enabled = 0;
+	kperf_aggregate_drain(false);
+}
+
+int
+kperf_aggregate_get_enabled(void)
+{
+	return kperf_aggregate_enabled;
+}
+
+int
+kperf_aggregate_set_enabled(int enabled)
+{
+	if (enabled && kperf_aggregate_tables == NULL) {
+		unsigned int ntables = machine_info.logical_cpu_max;
+		struct kperf_aggregate_table *tables;
+
+		tables = kalloc_tag(ntables * sizeof(*tables), VM_KERN_MEMORY_DIAG);
+		if (tables == NULL) {
+			return ENOMEM;
+		}
+		bzero(tables, ntables * sizeof(*tables));
+		for (unsigned int i = 0; i < ntables; i++) {
+			lck_spin_init(&tables[i].lock, &kperf_lck_grp, LCK_ATTR_NULL);
+		}
+
+		kperf_aggregate_tables = tables;
+		kperf_aggregate_ntables = ntables;
+	}
+
+	if (enabled) {
+		kperf_aggregate_enabled = 1;
+	} else if (kperf_aggregate_enabled) {
+		/* log what was counted so far, so disabling doesn't lose samples */
+		kperf_aggregate_enabled = 0;
+		kperf_aggregate_flush();
+	}
+	return 0;
+}
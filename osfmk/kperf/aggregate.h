@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2018 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. The rights granted to you under the License
+ * may not be used to create, or enable the creation or redistribution of,
+ * unlawful or unlicensed copies of an Apple operating system, or to
+ * circumvent, violate, or enable the circumvention or violation of, any
+ * terms of an Apple operating system software license agreement.
+ *
+ * Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_OSREFERENCE_LICENSE_HEADER_END@
+ */
+
+#ifndef KPERF_AGGREGATE_H
+#define KPERF_AGGREGATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct callstack;
+
+/*
+ * Callstack aggregation counts the callstacks sampled on each CPU in a hash
+ * table instead of logging every one of them.  A callstack is logged once,
+ * preceded by a PERF_CS_AGG event holding the number of times it was
+ * sampled, when it is evicted from its table or the tables are flushed.
+ */
+
+/* callstacks deeper than this are logged as usual */
+#define KPERF_AGGREGATE_MAX_FRAMES (32)
+
+void kperf_aggregate_reset(void);
+bool kperf_aggregate_callstack(struct callstack *cs);
+void kperf_aggregate_flush(void);
+
+/* accessors for configuration */
+int kperf_aggregate_get_enabled(void);
+int kperf_aggregate_set_enabled(int enabled);
+
+#endif /* !defined(KPERF_AGGREGATE_H) */
@@ -92,6 +92,7 @@
 #define PERF_CS_ERROR      PERF_CS_CODE(7)
 #define PERF_CS_BACKTRACE  PERF_CS_CODE(8)
 #define PERF_CS_LOG        PERF_CS_CODE(9)
+#define PERF_CS_AGG        PERF_CS_CODE(10)
 
 #define PERF_TM_CODE(code) PERF_CODE(PERF_TIMER, code)
 #define PERF_TM_FIRE       PERF_TM_CODE(0)
@@ -377,6 +377,26 @@ scrub_frame(uint64_t *bt, int n_frames, int frame)
 	}
 }
 
+static void
+callstack_log_frames(uint32_t dcode, unsigned int nframes, uint64_t *frames)
+{
+	/* how many batches of 4 */
+	unsigned int n = nframes / 4;
+	unsigned int ovf = nframes % 4;
+	if (ovf != 0) {
+		n++;
+	}
+
+	for (unsigned int i = 0; i < n; i++) {
+		unsigned int j = i * 4;
+		BUF_DATA(dcode,
+			scrub_frame(frames, nframes, j + 0),
+			scrub_frame(frames, nframes, j + 1),
+			scrub_frame(frames, nframes, j + 2),
+			scrub_frame(frames, nframes, j + 3));
+	}
+}
+
 static void
 callstack_log(struct callstack *cs, uint32_t hcode, uint32_t dcode)
 {
@@ -406,15 +426,7 @@ callstack_log(struct callstack *cs, uint32_t hcode, uint32_t dcode)
 				scrub_word(frames, nframes, j + 3, kern));
 		}
 	} else {
-		for (unsigned int i = 0; i < n; i++) {
-			uint64_t *frames = cs->frames;
-			unsigned int j = i * 4;
-			BUF_DATA(dcode,
-				scrub_frame(frames, nframes, j + 0),
-				scrub_frame(frames, nframes, j + 1),
-				scrub_frame(frames, nframes, j + 2),
-				scrub_frame(frames, nframes, j + 3));
-		}
+		callstack_log_frames(dcode, nframes, cs->frames);
 	}
 
 	BUF_VERB(PERF_CS_LOG | DBG_FUNC_END, cs->flags, cs->nframes);
@@ -432,6 +444,23 @@ kperf_ucallstack_log( struct callstack *cs )
 	callstack_log(cs, PERF_CS_UHDR, PERF_CS_UDATA);
 }
 
+/*
+ * Log frames that have already been scrubbed, like the ones kept by callstack
+ * aggregation.
+ */
+void
+kperf_callstack_log_frames(uint32_t flags, uint32_t nframes, uint64_t *frames)
+{
+	bool kern = flags & CALLSTACK_KERNEL;
+
+	assert(!(flags & CALLSTACK_KERNEL_WORDS));
+
+	BUF_VERB(PERF_CS_LOG | DBG_FUNC_START, flags, nframes);
+	BUF_DATA(kern ? PERF_CS_KHDR : PERF_CS_UHDR, flags, nframes);
+	callstack_log_frames(kern ? PERF_CS_KDATA : PERF_CS_UDATA, nframes, frames);
+	BUF_VERB(PERF_CS_LOG | DBG_FUNC_END, flags, nframes);
+}
+
 int
 kperf_ucallstack_pend(struct kperf_context * context, uint32_t depth)
 {
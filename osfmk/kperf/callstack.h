@@ -64,4 +64,7 @@ void kperf_ucallstack_sample(struct callstack *cs, struct kperf_context *);
 int kperf_ucallstack_pend(struct kperf_context *, uint32_t depth);
 void kperf_ucallstack_log(struct callstack *cs);
 
+void kperf_callstack_log_frames(uint32_t flags, uint32_t nframes,
+		uint64_t *frames);
+
 #endif /* !defined(KPERF_CALLSTACK_H) */
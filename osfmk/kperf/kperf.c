@@ -34,6 +34,7 @@
 #include <sys/ktrace.h>
 
 #include <kperf/action.h>
+#include <kperf/aggregate.h>
 #include <kperf/buffer.h>
 #include <kperf/kdebug_trigger.h>
 #include <kperf/kperf.h>
@@ -145,6 +146,7 @@ kperf_reset(void)
 
 	/* cleanup miscellaneous configuration first */
 	kperf_lazy_reset();
+	kperf_aggregate_reset();
 	(void)kperf_kdbg_cswitch_set(0);
 	(void)kperf_set_lightweight_pet(0);
 	kperf_kdebug_reset();
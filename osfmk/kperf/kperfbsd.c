@@ -38,6 +38,7 @@
 #include <sys/kauth.h>
 
 #include <kperf/action.h>
+#include <kperf/aggregate.h>
 #include <kperf/context.h>
 #include <kperf/kdebug_trigger.h>
 #include <kperf/kperf.h>
@@ -81,6 +82,9 @@ enum kperf_request {
 	REQ_LAZY_WAIT_ACTION,
 	REQ_LAZY_CPU_TIME_THRESHOLD,
 	REQ_LAZY_CPU_ACTION,
+
+	REQ_AGGREGATE_ENABLED,
+	REQ_AGGREGATE_FLUSH,
 };
 
 int kperf_debug_level = 0;
@@ -471,6 +475,30 @@ sysctl_lazy_cpu_action(struct sysctl_req *req)
 		kperf_lazy_set_cpu_action);
 }
 
+static int
+sysctl_aggregate_enabled(struct sysctl_req *req)
+{
+	return kperf_sysctl_get_set_int(req, kperf_aggregate_get_enabled,
+		kperf_aggregate_set_enabled);
+}
+
+static int
+sysctl_aggregate_flush(struct sysctl_req *req)
+{
+	int should_flush = 0;
+
+	int error = sysctl_io_number(req, should_flush, sizeof(should_flush),
+		&should_flush, NULL);
+	if (error) {
+		return error;
+	}
+
+	if (should_flush) {
+		kperf_aggregate_flush();
+	}
+	return 0;
+}
+
 static int
 kperf_sysctl SYSCTL_HANDLER_ARGS
 {
@@ -563,6 +591,12 @@ kperf_sysctl SYSCTL_HANDLER_ARGS
 	case REQ_LAZY_CPU_ACTION:
 		ret = sysctl_lazy_cpu_action(req);
         break;
+	case REQ_AGGREGATE_ENABLED:
+		ret = sysctl_aggregate_enabled(req);
+		break;
+	case REQ_AGGREGATE_FLUSH:
+		ret = sysctl_aggregate_flush(req);
+		break;
 	default:
 		ret = ENOENT;
 		break;
@@ -743,6 +777,23 @@ SYSCTL_PROC(_kperf_lazy, OID_AUTO, cpu_action,
             sizeof(uint64_t), kperf_sysctl, "UQ",
             "Which action to fire for lazy CPU samples");
 
+/* callstack aggregation */
+
+SYSCTL_NODE(_kperf, OID_AUTO, aggregate, CTLFLAG_RW | CTLFLAG_LOCKED, 0,
+            "aggregate");
+
+SYSCTL_PROC(_kperf_aggregate, OID_AUTO, enabled,
+            CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_ANYBODY | CTLFLAG_MASKED
+            | CTLFLAG_LOCKED,
+            (void *)REQ_AGGREGATE_ENABLED,
+            sizeof(int), kperf_sysctl, "I",
+            "Whether sampled callstacks are counted instead of logged");
+
+SYSCTL_PROC(_kperf_aggregate, OID_AUTO, flush,
+            CTLFLAG_RW | CTLFLAG_ANYBODY | CTLFLAG_MASKED | CTLFLAG_LOCKED,
+            (void *)REQ_AGGREGATE_FLUSH,
+            0, kperf_sysctl, "-", "Log and clear the aggregated callstacks");
+
 /* misc */
 
 SYSCTL_PROC(_kperf, OID_AUTO, sampling,
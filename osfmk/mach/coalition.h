@@ -143,6 +143,10 @@ struct coalition_resource_usage {
 	uint64_t cpu_ptime;
 	uint64_t cpu_time_eqos_len;	/* Stores the number of thread QoS types */
 	uint64_t cpu_time_eqos[COALITION_NUM_THREAD_QOS_TYPES];
+	uint64_t cpu_throttled_time;	/* ns threads waited for the CPU quota to refill */
+	uint64_t cpu_throttle_count;
+	uint64_t cpu_instructions;	/* fixed counter totals, 0 without monotonic */
+	uint64_t cpu_cycles;
 };
 
 #ifdef PRIVATE
@@ -157,9 +161,19 @@ struct coalition_resource_usage {
 #define COALITION_INFO_RESOURCE_USAGE 1
 #define COALITION_INFO_SET_NAME 2
 #define COALITION_INFO_SET_EFFICIENCY 3
+#define COALITION_INFO_SET_CPU_QUOTA 4
 
 #define COALITION_EFFICIENCY_VALID_FLAGS    (COALITION_FLAGS_EFFICIENT)
 
+/*
+ * CPU time the threads of a resource coalition may use in each period,
+ * summed over all CPUs.  A quota of 0 removes the limit.
+ */
+struct coalition_cpu_quota {
+	uint64_t quota_ns;
+	uint64_t period_ns;
+};
+
 /* structure returned from libproc coalition listing interface */
 struct procinfo_coalinfo {
 	uint64_t coalition_id;
@@ -81,6 +81,20 @@
 
 __BEGIN_DECLS
 
+#ifdef	PRIVATE
+/*
+ * One entry of the array handed to mach_msg_send_vector_trap(): a message
+ * to send, and on return the result of sending it.
+ */
+typedef struct mach_msg_vector {
+	mach_vm_address_t	msgv_msg;	/* (in) message to send */
+	mach_msg_size_t		msgv_send_size;	/* (in) its size */
+	mach_msg_return_t	msgv_return;	/* (out) send result */
+} mach_msg_vector_t;
+
+#define	MACH_MSG_VECTOR_MAX	1024	/* max entries per trap */
+#endif	/* PRIVATE */
+
 #ifndef	KERNEL
 
 #ifdef	PRIVATE
@@ -113,6 +127,13 @@ extern mach_msg_return_t mach_msg_overwrite_trap(
 				mach_msg_header_t *rcv_msg,
 				mach_msg_size_t rcv_limit);
 
+extern mach_msg_return_t mach_msg_send_vector_trap(
+				mach_msg_vector_t *vector,
+				mach_msg_size_t count,
+				mach_msg_option_t option,
+				mach_msg_timeout_t timeout,
+				mach_msg_priority_t override);
+
 extern kern_return_t semaphore_signal_trap(
 				mach_port_name_t signal_name);
 					      
@@ -431,6 +452,16 @@ extern mach_msg_return_t mach_msg_trap(
 extern mach_msg_return_t mach_msg_overwrite_trap(
 				struct mach_msg_overwrite_trap_args *args);
 
+struct mach_msg_send_vector_trap_args {
+	PAD_ARG_(user_addr_t, vector);
+	PAD_ARG_(mach_msg_size_t, count);
+	PAD_ARG_(mach_msg_option_t, option);
+	PAD_ARG_(mach_msg_timeout_t, timeout);
+	PAD_ARG_(mach_msg_priority_t, override);
+};
+extern mach_msg_return_t mach_msg_send_vector_trap(
+				struct mach_msg_send_vector_trap_args *args);
+
 struct semaphore_signal_trap_args {
 	PAD_ARG_(mach_port_name_t, signal_name);
 };
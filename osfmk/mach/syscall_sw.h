@@ -104,6 +104,7 @@ kernel_trap(thread_self_trap,-27,0)
 kernel_trap(task_self_trap,-28,0)
 kernel_trap(host_self_trap,-29,0)
 
+kernel_trap(mach_msg_send_vector_trap,-30,5)
 kernel_trap(mach_msg_trap,-31,7)
 kernel_trap(mach_msg_overwrite_trap,-32,9)
 kernel_trap(semaphore_signal_trap, -33, 1)
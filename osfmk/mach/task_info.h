@@ -270,11 +270,16 @@ struct task_affinity_tag_info {
 	integer_t		min;
 	integer_t		max;
 	integer_t		task_count;
+	uint64_t		pset_switches;	/* set members changing pset */
+	uint64_t		pset_misses;	/* set members run off their pset */
 };
 typedef struct task_affinity_tag_info	task_affinity_tag_info_data_t;
 typedef struct task_affinity_tag_info	*task_affinity_tag_info_t;
 #define TASK_AFFINITY_TAG_INFO_COUNT	\
 		(sizeof(task_affinity_tag_info_data_t) / sizeof(natural_t))
+#define TASK_AFFINITY_TAG_INFO_REV1_COUNT TASK_AFFINITY_TAG_INFO_COUNT
+#define TASK_AFFINITY_TAG_INFO_REV0_COUNT /* doesn't include pset counters */ \
+		(TASK_AFFINITY_TAG_INFO_REV1_COUNT - 4)
 
 #define TASK_DYLD_INFO			17
 
@@ -362,6 +367,8 @@ typedef struct task_power_info	*task_power_info_t;
 
 #define TASK_VM_INFO		22
 #define TASK_VM_INFO_PURGEABLE	23
+
+#define TASK_VM_INFO_SHADOW_DEPTH_BUCKETS 8
 struct task_vm_info {
         mach_vm_size_t  virtual_size;	    /* virtual memory size (bytes) */
 	integer_t	region_count;	    /* number of memory regions */
@@ -390,12 +397,25 @@ struct task_vm_info {
 	/* added for rev2 */
 	mach_vm_address_t	min_address;
 	mach_vm_address_t	max_address;
+
+	/* added for rev3 */
+	uint64_t	fault_around_faults;	/* faults that looked at neighbours */
+	uint64_t	fault_around_candidates; /* neighbouring pages looked at */
+	uint64_t	fault_around_pages;	/* neighbouring pages mapped */
+	/* rev4 */
+	uint64_t	shadow_depth[TASK_VM_INFO_SHADOW_DEPTH_BUCKETS];
+			/* faults by shadow objects walked: 0, 1, 2-3, ..., 64+ */
 };
 typedef struct task_vm_info	task_vm_info_data_t;
 typedef struct task_vm_info	*task_vm_info_t;
 #define TASK_VM_INFO_COUNT	((mach_msg_type_number_t) \
 		(sizeof (task_vm_info_data_t) / sizeof (natural_t)))
-#define TASK_VM_INFO_REV2_COUNT TASK_VM_INFO_COUNT
+#define TASK_VM_INFO_REV4_COUNT TASK_VM_INFO_COUNT
+#define TASK_VM_INFO_REV3_COUNT /* doesn't include shadow depths */ \
+	((mach_msg_type_number_t) (TASK_VM_INFO_REV4_COUNT - \
+	    (TASK_VM_INFO_SHADOW_DEPTH_BUCKETS * 2)))
+#define TASK_VM_INFO_REV2_COUNT /* doesn't include fault-around counters */ \
+	((mach_msg_type_number_t) (TASK_VM_INFO_REV3_COUNT - 6))
 #define TASK_VM_INFO_REV1_COUNT /* doesn't include min and max address */ \
 	((mach_msg_type_number_t) (TASK_VM_INFO_REV2_COUNT - 4))
 #define TASK_VM_INFO_REV0_COUNT /* doesn't include phys_footprint */ \
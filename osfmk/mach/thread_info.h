@@ -182,6 +182,31 @@ typedef struct thread_debug_info_internal  thread_debug_info_internal_data_t;
 
 #endif /* PRIVATE */
 
+#define THREAD_SCHED_LATENCY_INFO 7	/* time spent waiting to run */
+
+#if PRIVATE
+/*
+ * Bucket i of the histogram counts the waits of 2^i to 2^(i+1) microseconds,
+ * the first bucket also counts shorter waits and the last one longer waits.
+ */
+#define THREAD_SCHED_LATENCY_BUCKETS 16
+
+struct thread_sched_latency_info {
+	uint64_t	runnable_count;		/* times the thread went on core after being made runnable */
+	uint64_t	runnable_time;		/* total time waiting to go on core, in ns */
+	uint64_t	runnable_max;		/* longest such wait, in ns */
+	uint64_t	preemptions;		/* times the thread was preempted */
+	uint32_t	latency_hist[THREAD_SCHED_LATENCY_BUCKETS];
+};
+
+typedef struct thread_sched_latency_info *thread_sched_latency_info_t;
+typedef struct thread_sched_latency_info  thread_sched_latency_info_data_t;
+
+#define THREAD_SCHED_LATENCY_INFO_COUNT  ((mach_msg_type_number_t)		\
+			(sizeof (thread_sched_latency_info_data_t) / sizeof (natural_t)))
+
+#endif /* PRIVATE */
+
 #define IO_NUM_PRIORITIES	4
 
 #define UPDATE_IO_STATS(info, size)				\
@@ -629,6 +629,7 @@ typedef struct {
 #define VM_KERN_SITE_HIDE		0x00000200	/* no zprint */
 #define VM_KERN_SITE_NAMED		0x00000400
 #define VM_KERN_SITE_ZONE		0x00000800
+#define VM_KERN_SITE_KALLOC		0x00001000	/* kalloc_profile size entry */
 
 #define VM_KERN_COUNT_MANAGED		0
 #define VM_KERN_COUNT_RESERVED		1
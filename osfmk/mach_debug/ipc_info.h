@@ -89,7 +89,8 @@ typedef struct ipc_info_space_basic {
 	natural_t iisb_table_size;	/* size of table */
 	natural_t iisb_table_next;	/* next possible size of table */
 	natural_t iisb_table_inuse;	/* number of entries in use */
-	natural_t iisb_reserved[2];	/* future expansion */
+	natural_t iisb_grow_count;	/* number of times the table grew */
+	natural_t iisb_grow_rescans;	/* entries copied again during growth */
 } ipc_info_space_basic_t;
 
 typedef struct ipc_info_name {
@@ -245,6 +245,71 @@ uint32_t	c_segment_svp_nonzero_decompressions;
 
 uint32_t	c_segment_noncompressible_pages;
 
+/*
+ * Duplicate page sampling: with vm_compressor_dup_scan set, the
+ * compressed data of every page is hashed into a small direct-mapped
+ * table of recent hashes, and a page whose hash and size match an
+ * entry is counted as a likely duplicate of a page already in the
+ * compressor.  Compressed slots can't be shared (each c_slot points
+ * back at the single c_slot_mapping that owns it, which compaction
+ * and swapin rely on), so this only measures how much memory a
+ * content-hash dedup would save, and what the hashing costs, before
+ * anyone commits to changing the slot format.
+ */
+#define C_DUP_HASH_SIZE		(1 << 12)
+#define C_DUP_HASH_MASK		(C_DUP_HASH_SIZE - 1)
+
+uint32_t	vm_compressor_dup_scan = 0;
+uint64_t	vm_compressor_dup_checks __attribute__((aligned(8))) = 0;
+uint64_t	vm_compressor_dup_candidates __attribute__((aligned(8))) = 0;
+uint64_t	vm_compressor_dup_candidate_bytes __attribute__((aligned(8))) = 0;
+uint64_t	vm_compressor_dup_check_ns __attribute__((aligned(8))) = 0;
+
+static uint64_t	c_dup_hash_table[C_DUP_HASH_SIZE];
+
+static uint32_t
+c_dup_hash(const char *cp, uint32_t len)
+{
+	const uint32_t	*wp = (const uint32_t *)(const void *)cp;
+	uint64_t	hash = 0xcbf29ce484222325ULL;
+	uint32_t	i;
+
+	for (i = 0; i < len / sizeof(uint32_t); i++)
+		hash = (hash ^ wp[i]) * 0x100000001b3ULL;
+	for (i *= sizeof(uint32_t); i < len; i++)
+		hash = (hash ^ (unsigned char)cp[i]) * 0x100000001b3ULL;
+
+	return ((uint32_t)(hash ^ (hash >> 32)));
+}
+
+/*
+ * look the compressed data "cp" up in the duplicate sampling table,
+ * and record it there
+ */
+static void
+c_dup_scan(const char *cp, uint32_t c_size, uint32_t c_rounded_size)
+{
+	uint64_t	start, elapsed_ns;
+	uint64_t	record;
+	uint32_t	hash;
+
+	start = mach_absolute_time();
+
+	hash = c_dup_hash(cp, c_size);
+	record = ((uint64_t)hash << 32) | c_size;
+
+	if (c_dup_hash_table[hash & C_DUP_HASH_MASK] == record) {
+		OSAddAtomic64(1, (SInt64 *)&vm_compressor_dup_candidates);
+		OSAddAtomic64(c_rounded_size, (SInt64 *)&vm_compressor_dup_candidate_bytes);
+	} else
+		c_dup_hash_table[hash & C_DUP_HASH_MASK] = record;
+
+	absolutetime_to_nanoseconds(mach_absolute_time() - start, &elapsed_ns);
+
+	OSAddAtomic64(1, (SInt64 *)&vm_compressor_dup_checks);
+	OSAddAtomic64(elapsed_ns, (SInt64 *)&vm_compressor_dup_check_ns);
+}
+
 uint32_t	c_segment_pages_compressed;
 uint32_t	c_segment_pages_compressed_limit;
 uint32_t	c_segment_pages_compressed_nearing_limit;
@@ -298,6 +363,31 @@ uint32_t	swapout_target_age = 0;
 uint32_t	age_of_decompressions_during_sample_period[DECOMPRESSION_SAMPLE_MAX_AGE];
 uint32_t	overage_decompressions_during_sample_period = 0;
 
+/*
+ * Refault distance for compressed pages: the number of pages compressed
+ * between the creation of a page's segment and its decompression.  A
+ * page that comes back within fewer compressions than there are
+ * resident anonymous pages is part of the working set.  When such
+ * refaults alone exceed the thrashing rate, the compressor is evicting
+ * memory that's in use and VM pressure is raised to warning, rather
+ * than waiting for the age-based detection to ask jetsam for help.
+ */
+#define	C_COMPRESSOR_CLOCK()	((uint32_t)(c_segment_input_bytes >> PAGE_SHIFT))
+
+uint32_t	sample_period_workingset_refault_count = 0;
+uint64_t	vm_compressor_refaults = 0;
+uint64_t	vm_compressor_refaults_workingset = 0;
+boolean_t	vm_compressor_workingset_thrashing = FALSE;
+
+/*
+ * minor compaction statistics: memory given back to the VM, and how
+ * long c_list_lock is held picking segments to compact
+ */
+uint64_t	vm_compressor_minor_compaction_bytes_reclaimed __attribute__((aligned(8))) = 0;
+uint64_t	vm_compressor_minor_compaction_lock_hold_ns __attribute__((aligned(8))) = 0;
+uint64_t	vm_compressor_minor_compaction_lock_hold_max_ns = 0;
+uint64_t	vm_compressor_minor_compaction_skipped_busy = 0;
+
 
 void		do_fastwake_warmup(queue_head_t *, boolean_t);
 boolean_t	fastwake_warmup = FALSE;
@@ -1172,6 +1262,7 @@ c_seg_switch_state(c_segment_t c_seg, int new_state, boolean_t insert_head)
 				
 					c_first = (c_segment_t)queue_first(&c_age_list_head);
 					c_seg->c_creation_ts = c_first->c_creation_ts;
+					c_seg->c_creation_compressions = c_first->c_creation_compressions;
 				}
 				queue_enter_first(&c_age_list_head, c_seg, c_segment_t, c_age_list);
 			}
@@ -1415,6 +1506,8 @@ c_seg_minor_compaction_and_unlock(c_segment_t c_seg, boolean_t clear_busy)
 	c_seg_validate(c_seg, FALSE);
 #endif
 	if (c_seg->c_bytes_used == 0) {
+		OSAddAtomic64(C_SEG_OFFSET_TO_BYTES(c_seg->c_populated_offset),
+		    (SInt64 *)&vm_compressor_minor_compaction_bytes_reclaimed);
 		c_seg_free(c_seg);
 		return (1);
 	}
@@ -1480,6 +1573,8 @@ c_seg_minor_compaction_and_unlock(c_segment_t c_seg, boolean_t clear_busy)
 		gc_ptr = &c_seg->c_store.c_buffer[c_seg->c_populated_offset];
 
 		kernel_memory_depopulate(compressor_map, (vm_offset_t)gc_ptr, gc_size, KMA_COMPRESSOR);
+
+		OSAddAtomic64(gc_size, (SInt64 *)&vm_compressor_minor_compaction_bytes_reclaimed);
 	}
 
 #if DEVELOPMENT || DEBUG
@@ -1765,6 +1860,7 @@ compute_swapout_target_age(void)
 			     sample_period_decompression_count - last_eval_decompression_count, 0, 1, 0);
 
 		swapout_target_age = 0;
+		vm_compressor_workingset_thrashing = FALSE;
 
 		compressor_need_sample_reset = TRUE;
 		need_eval_reset = TRUE;
@@ -1778,6 +1874,9 @@ compute_swapout_target_age(void)
 		KERNEL_DEBUG(0xe0400020 | DBG_FUNC_END, swapout_target_age, 0, 0, 5, 0);
 		goto done;
 	}
+	vm_compressor_workingset_thrashing =
+	    (sample_period_workingset_refault_count > ((compressor_thrashing_threshold_per_10msecs * elapsed_msecs_in_sample) / 10)) ? TRUE : FALSE;
+
 	if (sample_period_decompression_count > ((compressor_thrashing_threshold_per_10msecs * elapsed_msecs_in_sample) / 10)) {
 
 		uint64_t	running_total;
@@ -1832,6 +1931,7 @@ done:
 	if (compressor_need_sample_reset == TRUE) {
 		bzero(age_of_decompressions_during_sample_period, sizeof(age_of_decompressions_during_sample_period));
 		overage_decompressions_during_sample_period = 0;
+		sample_period_workingset_refault_count = 0;
 
 		start_of_sample_period_sec = cur_ts_sec;
 		start_of_sample_period_nsec = cur_ts_nsec;
@@ -2010,6 +2110,17 @@ uint32_t vm_run_compactor_already_running = 0;
 uint32_t vm_run_compactor_empty_minor_q = 0;
 uint32_t vm_run_compactor_did_compact = 0;
 uint32_t vm_run_compactor_waited = 0;
+uint32_t vm_run_compactor_helped = 0;
+
+/*
+ * While the compactor/swapper thread is busy, up to vm_compactor_helpers_max
+ * callers of vm_run_compactor may drain the minor compaction queue alongside
+ * it instead of returning... each segment is claimed with C_SEG_BUSY and
+ * pulled off the queue before c_list_lock is dropped, so helpers never work
+ * on the same segment.  Setting it to 0 restores the single compactor.
+ */
+uint32_t vm_compactor_helpers_max = 2;
+uint32_t vm_compactor_helpers_running = 0;
 
 void
 vm_run_compactor(void)
@@ -2028,7 +2139,16 @@ vm_run_compactor(void)
 	if (compaction_swapper_running) {
 
 		if (vm_pageout_state.vm_restricted_to_single_processor == FALSE) {
-			vm_run_compactor_already_running++;
+
+			if (vm_compactor_helpers_running < vm_compactor_helpers_max) {
+				vm_run_compactor_helped++;
+				vm_compactor_helpers_running++;
+
+				vm_compressor_do_delayed_compactions(FALSE);
+
+				vm_compactor_helpers_running--;
+			} else
+				vm_run_compactor_already_running++;
 
 			lck_mtx_unlock_always(c_list_lock);
 			return;
@@ -2197,34 +2317,86 @@ vm_consider_waking_compactor_swapper(void)
 #define	C_SWAPOUT_LIMIT			4
 #define	DELAYED_COMPACTIONS_PER_PASS	30
 
+/*
+ * account for the time c_list_lock was held while picking
+ * the next segment to minor compact
+ */
+static void
+vm_compressor_minor_compaction_lock_held(uint64_t start)
+{
+	uint64_t	held;
+
+	absolutetime_to_nanoseconds(mach_absolute_time() - start, &held);
+
+	OSAddAtomic64(held, (SInt64 *)&vm_compressor_minor_compaction_lock_hold_ns);
+
+	if (held > vm_compressor_minor_compaction_lock_hold_max_ns)
+		vm_compressor_minor_compaction_lock_hold_max_ns = held;
+}
+
 void
 vm_compressor_do_delayed_compactions(boolean_t flush_all)
 {
 	c_segment_t	c_seg;
 	int		number_compacted = 0;
 	boolean_t	needs_to_swap = FALSE;
+	uint64_t	lock_start;
 
 
 #if !CONFIG_EMBEDDED
 	LCK_MTX_ASSERT(c_list_lock, LCK_MTX_ASSERT_OWNED);
 #endif /* !CONFIG_EMBEDDED */
 
+	lock_start = mach_absolute_time();
+
 	while (!queue_empty(&c_minor_list_head) && needs_to_swap == FALSE) {
 		
 		c_seg = (c_segment_t)queue_first(&c_minor_list_head);
 		
 		lck_mtx_lock_spin_always(&c_seg->c_lock);
 
-		if (c_seg->c_busy) {
+		/*
+		 * with several threads compacting, a busy segment is most
+		 * likely being worked on by one of them... skip past it
+		 * rather than serializing behind it
+		 */
+		while (c_seg->c_busy) {
+			c_segment_t	c_seg_next;
+
+			c_seg_next = (c_segment_t)queue_next(&c_seg->c_list);
+			lck_mtx_unlock_always(&c_seg->c_lock);
+
+			if (queue_end(&c_minor_list_head, (queue_entry_t)c_seg_next)) {
+				c_seg = NULL;
+				break;
+			}
+			vm_compressor_minor_compaction_skipped_busy++;
+
+			c_seg = c_seg_next;
+			lck_mtx_lock_spin_always(&c_seg->c_lock);
+		}
+		if (c_seg == NULL) {
+			/*
+			 * every segment left on the queue is busy...
+			 * wait for the first one as before
+			 */
+			c_seg = (c_segment_t)queue_first(&c_minor_list_head);
+
+			lck_mtx_lock_spin_always(&c_seg->c_lock);
+
+			vm_compressor_minor_compaction_lock_held(lock_start);
 
 			lck_mtx_unlock_always(c_list_lock);
 			c_seg_wait_on_busy(c_seg);
 			lck_mtx_lock_spin_always(c_list_lock);
 
+			lock_start = mach_absolute_time();
 			continue;
 		}
 		C_SEG_BUSY(c_seg);
 
+		vm_compressor_minor_compaction_lock_held(lock_start);
+
 		c_seg_do_minor_compaction_and_unlock(c_seg, TRUE, FALSE, TRUE);
 
 		if (VM_CONFIG_SWAP_IS_ACTIVE && (number_compacted++ > DELAYED_COMPACTIONS_PER_PASS)) {
@@ -2235,7 +2407,10 @@ vm_compressor_do_delayed_compactions(boolean_t flush_all)
 			number_compacted = 0;
 		}
 		lck_mtx_lock_spin_always(c_list_lock);
+
+		lock_start = mach_absolute_time();
 	}
+	vm_compressor_minor_compaction_lock_held(lock_start);
 }
 
 
@@ -2747,6 +2922,15 @@ vm_compressor_compact_and_swap(boolean_t flush_all)
 			if (c_seg_major_compact_ok(c_seg, c_seg_next) == FALSE)
 				break;
 
+			if (c_seg->c_freezer_only) {
+				/*
+				 * about to take in other segments' data...
+				 * it's no longer exclusive to one task
+				 */
+				lck_mtx_lock_spin_always(&c_seg->c_lock);
+				c_seg->c_freezer_only = 0;
+				lck_mtx_unlock_always(&c_seg->c_lock);
+			}
 			lck_mtx_lock_spin_always(&c_seg_next->c_lock);
 
 			if (c_seg_next->c_busy) {
@@ -2937,6 +3121,10 @@ c_seg_allocate(c_segment_t *current_chead)
 		c_seg->c_state = C_IS_EMPTY;
 		c_seg->c_firstemptyslot = C_SLOT_MAX_INDEX;
 		c_seg->c_mysegno = c_segno;
+		c_seg->c_worker_id = vm_pageout_compressor_worker_id((void **)current_chead);
+#if CONFIG_FREEZE
+		c_seg->c_freezer_only = (current_chead == (c_segment_t *)&freezer_chead);
+#endif /* CONFIG_FREEZE */
 
 		lck_mtx_lock_spin_always(c_list_lock);
 		c_empty_count++;
@@ -2996,6 +3184,8 @@ c_current_seg_filled(c_segment_t c_seg, c_segment_t *current_chead)
 	clock_nsec_t	nsec;
 	boolean_t	head_insert = FALSE;
 
+	OSAddAtomic64(1, &vm_compressor_worker_stats[c_seg->c_worker_id].vmcw_segments_filled);
+
 	unused_bytes = trunc_page_32(C_SEG_OFFSET_TO_BYTES(c_seg->c_populated_offset - c_seg->c_nextoffset));
 
 #ifndef _OPEN_SOURCE
@@ -3063,6 +3253,7 @@ c_current_seg_filled(c_segment_t c_seg, c_segment_t *current_chead)
 
 	clock_get_system_nanotime(&sec, &nsec);
 	c_seg->c_creation_ts = (uint32_t)sec;
+	c_seg->c_creation_compressions = C_COMPRESSOR_CLOCK();
 
 	lck_mtx_lock_spin_always(c_list_lock);
 
@@ -3454,6 +3645,9 @@ retry:
 #endif
 	c_rounded_size = (c_size + C_SEG_OFFSET_ALIGNMENT_MASK) & ~C_SEG_OFFSET_ALIGNMENT_MASK;
 
+	if (__improbable(vm_compressor_dup_scan))
+		c_dup_scan((char *)&c_seg->c_store.c_buffer[cs->c_offset], c_size, c_rounded_size);
+
 	PACK_C_SIZE(cs, c_size);
 	c_seg->c_bytes_used += c_rounded_size;
 	c_seg->c_nextoffset += C_SEG_BYTES_TO_OFFSET(c_rounded_size);
@@ -3464,6 +3658,9 @@ retry:
 	slot_ptr->s_cseg = c_seg->c_mysegno + 1; 
 
 sv_compression:
+	OSAddAtomic64(1, &vm_compressor_worker_stats[c_seg->c_worker_id].vmcw_compressions);
+	OSAddAtomic64(c_rounded_size, &vm_compressor_worker_stats[c_seg->c_worker_id].vmcw_compressed_bytes);
+
 	if (c_seg->c_nextoffset >= C_SEG_OFF_LIMIT || c_seg->c_nextslot >= C_SLOT_MAX_INDEX) {
 		c_current_seg_filled(c_seg, current_chead);
 		assert(*current_chead == NULL);
@@ -3769,6 +3966,9 @@ bypass_busy_check:
 #endif
 		}
 #endif
+		if (__probable(!kdp_mode))
+			OSAddAtomic64(1, &vm_compressor_worker_stats[c_seg->c_worker_id].vmcw_decompressions);
+
 		if (c_seg->c_swappedin_ts == 0 && !kdp_mode) {
 
 			clock_get_system_nanotime(&cur_ts_sec, &cur_ts_nsec);
@@ -3781,6 +3981,14 @@ bypass_busy_check:
 
 			OSAddAtomic(1, &sample_period_decompression_count);
 		}
+		if (!kdp_mode) {
+			/* this also covers segments that were swapped out and back in */
+			OSIncrementAtomic64((SInt64 *)&vm_compressor_refaults);
+			if (C_COMPRESSOR_CLOCK() - c_seg->c_creation_compressions < vm_page_pageable_internal_count) {
+				OSIncrementAtomic64((SInt64 *)&vm_compressor_refaults_workingset);
+				OSAddAtomic(1, &sample_period_workingset_refault_count);
+			}
+		}
 	}
 	if (flags & C_KEEP) {
 		*zeroslot = 0;
@@ -4084,6 +4292,9 @@ vm_compressor_finished_filling(
 }
 
 
+/* previously frozen pages vm_compressor_relocate() found already packed */
+uint64_t	c_freezer_relocations_skipped = 0;
+
 /*
  * This routine is used to transfer the compressed chunks from
  * the c_seg/cindx pointed to by slot_p into a new c_seg headed
@@ -4178,6 +4389,23 @@ Relookup_src:
 
 		goto out;
 	}
+	if (c_seg_src->c_freezer_only) {
+		/*
+		 * Left behind by a previous freeze of this task and
+		 * still holding nothing but its data: it is already
+		 * packed, so only the pages compressed since then
+		 * need to be moved.
+		 */
+		c_freezer_relocations_skipped++;
+
+		PAGE_REPLACEMENT_DISALLOWED(FALSE);
+
+		lck_mtx_unlock_always(&c_seg_src->c_lock);
+
+		c_seg_src = NULL;
+
+		goto out;
+	}
 
 	if (c_seg_src->c_busy) {
 
@@ -139,9 +139,11 @@ struct c_segment {
 
 		        c_state:4,		/* what state is the segment in which dictates which q to find it on */
 		        c_overage_swap:1,
-	                c_reserved:3;
+		        c_freezer_only:1,	/* filled by the freezer, holds a single task's data */
+	                c_reserved:2;
 
 	uint32_t	c_creation_ts;
+	uint32_t	c_creation_compressions;	/* compressor clock (pages compressed) at creation */
 	uint64_t	c_generation_id;
 
         int32_t		c_bytes_used;
@@ -154,6 +156,7 @@ struct c_segment {
 	uint32_t	c_populated_offset;
 
 	uint32_t	c_swappedin_ts;
+	uint16_t	c_worker_id;	/* compressor worker that filled this segment */
 
 	union {
 		int32_t *c_buffer;
@@ -80,6 +80,9 @@ compressor_tuneables_t vmctune = {
 	.lz4_run_preselection_threshold = ~0U,
 	.lz4_run_continue_bytes = 0,
 	.lz4_profitable_bytes = 0,
+	.cclass_enabled = 1,
+	.cclass_raw_collision_pct = 150,
+	.cclass_text_pct = 90,
 };
 
 compressor_state_t vmcstate = {
@@ -102,6 +105,19 @@ enum compressor_preselect_t {
 	CPRESELWK = 2,
 };
 
+enum compressor_class_t {
+	CCLASS_UNDECIDED = 0,	/* leave it to the history based preselection */
+	CCLASS_SV = 1,		/* page is a single repeated 64 bit value */
+	CCLASS_RAW = 2,		/* byte distribution looks random, store uncompressed */
+	CCLASS_LZ4 = 3,		/* byte oriented (text like) content */
+};
+
+/*
+ * number of bytes sampled by the pre-classifier... keeps the histogram
+ * pass at a fixed cost independent of the page size
+ */
+#define CCLASS_SAMPLES	(512)
+
 vm_compressor_mode_t vm_compressor_current_codec = VM_COMPRESSOR_DEFAULT_CODEC;
 
 boolean_t vm_compressor_force_sw_wkdm = FALSE;
@@ -165,6 +181,65 @@ static inline enum compressor_preselect_t compressor_preselect(void) {
 	return CPRESELWK;
 }
 
+/*
+ * Cheap content pre-scan run ahead of any compression attempt.
+ *
+ * The single value check walks the page as 64 bit words, bailing at the
+ * first mismatch, so it costs next to nothing on ordinary pages.  The
+ * rest of the classification is done on a fixed size byte sample: a
+ * 256 bin histogram whose pairwise collision count is compared with what
+ * uniformly random bytes would give (n * (n - 1) / 256).  Pages that
+ * don't collide noticeably more often than random data (already
+ * compressed media, encrypted buffers, JIT output full of immediates)
+ * are stored raw rather than paying for a WKdm and an LZ4 attempt that
+ * would both fail.  Pages that are mostly printable bytes go straight to
+ * LZ4, which beats WKdm's word oriented dictionary on that content.
+ *
+ * The loops are plain integer code over aligned words so the compiler
+ * can vectorize them without the codec having to manage SIMD state.
+ */
+static inline enum compressor_class_t compressor_classify(const uint8_t *in) {
+	const uint64_t *in64 = (const uint64_t *)(uintptr_t)in;
+	uint16_t hist[256];
+	uint32_t collisions = 0, expected, text = 0;
+	uint64_t first = in64[0];
+	unsigned int i, stride;
+
+	VM_COMPRESSOR_STAT(compressor_stats.cclass_scans++);
+
+	for (i = 1; i < PAGE_SIZE / sizeof(uint64_t); i++) {
+		if (in64[i] != first)
+			break;
+	}
+	if (i == PAGE_SIZE / sizeof(uint64_t) && (uint32_t)first == (uint32_t)(first >> 32)) {
+		VM_COMPRESSOR_STAT(compressor_stats.cclass_sv++);
+		return CCLASS_SV;
+	}
+
+	bzero(hist, sizeof(hist));
+	stride = PAGE_SIZE / CCLASS_SAMPLES;
+
+	for (i = 0; i < PAGE_SIZE; i += stride) {
+		uint8_t b = in[i + ((i / stride) % stride)];
+
+		collisions += hist[b]++;
+		if (b >= 0x20 && b < 0x7f)
+			text++;
+	}
+	expected = (CCLASS_SAMPLES * (CCLASS_SAMPLES - 1) / 2) / 256;
+
+	if (collisions * 100 <= expected * vmctune.cclass_raw_collision_pct) {
+		VM_COMPRESSOR_STAT(compressor_stats.cclass_raw++);
+		return CCLASS_RAW;
+	}
+	if (text * 100 >= CCLASS_SAMPLES * vmctune.cclass_text_pct) {
+		VM_COMPRESSOR_STAT(compressor_stats.cclass_lz4++);
+		return CCLASS_LZ4;
+	}
+	VM_COMPRESSOR_STAT(compressor_stats.cclass_undecided++);
+	return CCLASS_UNDECIDED;
+}
+
 static inline void compressor_selector_update(int lz4sz, int didwk, int wksz) {
 	VM_COMPRESSOR_STAT(compressor_stats.lz4_compressions++);
 
@@ -281,10 +356,33 @@ static inline int WKdmC(WK_word* src_buf, WK_word* dest_buf, WK_word* scratch, b
 
 int metacompressor(const uint8_t *in, uint8_t *cdst, int32_t outbufsz, uint16_t *codec, void *cscratchin, boolean_t *incomp_copy) {
 	int sz = -1;
-	int dowk = FALSE, dolz4 = FALSE, skiplz4 = FALSE;
+	int dowk = FALSE, dolz4 = FALSE, skiplz4 = FALSE, classified = FALSE;
 	int insize = PAGE_SIZE;
 	compressor_encode_scratch_t *cscratch = cscratchin;
 
+	if (vmctune.cclass_enabled) {
+		enum compressor_class_t cclass = compressor_classify(in);
+
+		if (cclass == CCLASS_SV) {
+			/*
+			 * hand it back as a WKdm single value page, the caller
+			 * takes care of the hash insert or the 4 byte store
+			 */
+			*codec = CCWK;
+			VM_COMPRESSOR_STAT(compressor_stats.wk_sv_compressions++);
+			sz = 0;
+			goto cexit;
+		} else if (cclass == CCLASS_RAW) {
+			*codec = CCWK;
+			*incomp_copy = FALSE;
+			goto cexit;
+		} else if (cclass == CCLASS_LZ4 && vm_compressor_current_codec == CMODE_HYB) {
+			dolz4 = TRUE;
+			classified = TRUE;
+			goto lz4compress;
+		}
+	}
+
 	if (vm_compressor_current_codec == CMODE_WK) {
 		dowk = TRUE;
 	} else if (vm_compressor_current_codec == CMODE_LZ4) {
@@ -348,7 +446,21 @@ lz4compress:
 
 		sz = (int) lz4raw_encode_buffer(cdst, outbufsz, in, insize, &cscratch->lz4state[0]);
 
-		compressor_selector_update(sz, dowk, wksz);
+		if (classified) {
+			/*
+			 * don't let classifier picks feed the history based
+			 * run/failure heuristics, they weren't selected by them
+			 */
+			VM_COMPRESSOR_STAT(compressor_stats.lz4_compressions++);
+			if (sz == 0) {
+				VM_COMPRESSOR_STAT(compressor_stats.cclass_lz4_failures++);
+				VM_COMPRESSOR_STAT(compressor_stats.lz4_compression_failures++);
+			} else {
+				VM_COMPRESSOR_STAT(compressor_stats.lz4_compressed_bytes+=sz);
+			}
+		} else {
+			compressor_selector_update(sz, dowk, wksz);
+		}
 		if (sz == 0) {
 			sz = -1;
 			goto cexit;
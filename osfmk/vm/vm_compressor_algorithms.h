@@ -72,6 +72,13 @@ typedef struct {
 
 	uint64_t wk_decompressed_bytes;
 	uint64_t wk_sv_decompressions;
+
+	uint64_t cclass_scans;
+	uint64_t cclass_sv;
+	uint64_t cclass_raw;
+	uint64_t cclass_lz4;
+	uint64_t cclass_lz4_failures;
+	uint64_t cclass_undecided;
 } compressor_stats_t;
 
 extern compressor_stats_t compressor_stats;
@@ -86,6 +93,9 @@ typedef struct {
 	uint32_t lz4_run_preselection_threshold;
 	uint32_t lz4_run_continue_bytes;
 	uint32_t lz4_profitable_bytes;
+	uint32_t cclass_enabled;
+	uint32_t cclass_raw_collision_pct;
+	uint32_t cclass_text_pct;
 } compressor_tuneables_t;
 
 extern compressor_tuneables_t vmctune;
@@ -55,6 +55,7 @@ int		vm_swapfile_gc_thread_running = 0;
 
 int64_t		vm_swappin_avail = 0;
 boolean_t	vm_swappin_enabled = FALSE;
+boolean_t	vm_swapfile_on_ssd = FALSE;
 unsigned int	vm_swapfile_total_segs_alloced = 0;
 unsigned int	vm_swapfile_total_segs_used = 0;
 
@@ -499,7 +500,9 @@ vm_compaction_swapper_do_init(void)
 
 		if (vp) {
 			
-			if (vnode_pager_isSSD(vp) == FALSE) {
+			if (vnode_pager_isSSD(vp) == TRUE)
+				vm_swapfile_on_ssd = TRUE;
+			else {
 			        /*
 				 * swap files live on an HDD, so let's make sure to start swapping
 				 * much earlier since we're not worried about SSD write-wear and 
@@ -816,7 +819,17 @@ vm_swapfile_gc_thread(void)
 #define   VM_SWAPOUT_LIMIT_T1P  4
 #define   VM_SWAPOUT_LIMIT_T0P  6
 #define   VM_SWAPOUT_LIMIT_T0   8
-#define   VM_SWAPOUT_LIMIT_MAX  8
+
+/*
+ * Once the swapper is unthrottled, flash can absorb many more segment
+ * writes in flight than a disk; keep its queue deeper so swapout isn't
+ * limited by per-I/O latency.
+ */
+#define   VM_SWAPOUT_SSD_SCALE  4
+#define   VM_SWAPOUT_LIMIT_MAX  (VM_SWAPOUT_LIMIT_T0 * VM_SWAPOUT_SSD_SCALE)
+
+#define   VM_SWAPOUT_LIMIT_UNTHROTTLED(limit)	\
+	(vm_swapfile_on_ssd ? (limit) * VM_SWAPOUT_SSD_SCALE : (limit))
 
 #define   VM_SWAPOUT_START      0
 #define   VM_SWAPOUT_T2_PASSIVE 1
@@ -863,7 +876,7 @@ vm_swapout_thread_throttle_adjust(void)
 							TASK_POLICY_INTERNAL, TASK_POLICY_IO, vm_swapper_throttle);
 			proc_set_thread_policy_with_tid(kernel_task, vm_swapout_thread_id,
 							TASK_POLICY_INTERNAL, TASK_POLICY_PASSIVE_IO, TASK_POLICY_ENABLE);
-			vm_swapout_limit = VM_SWAPOUT_LIMIT_T0P;
+			vm_swapout_limit = VM_SWAPOUT_LIMIT_UNTHROTTLED(VM_SWAPOUT_LIMIT_T0P);
 			vm_swapout_state = VM_SWAPOUT_T0_PASSIVE;
 
 			break;
@@ -891,7 +904,7 @@ vm_swapout_thread_throttle_adjust(void)
 							TASK_POLICY_INTERNAL, TASK_POLICY_IO, vm_swapper_throttle);
 			proc_set_thread_policy_with_tid(kernel_task, vm_swapout_thread_id,
 							TASK_POLICY_INTERNAL, TASK_POLICY_PASSIVE_IO, TASK_POLICY_ENABLE);
-			vm_swapout_limit = VM_SWAPOUT_LIMIT_T0P;
+			vm_swapout_limit = VM_SWAPOUT_LIMIT_UNTHROTTLED(VM_SWAPOUT_LIMIT_T0P);
 			vm_swapout_state = VM_SWAPOUT_T0_PASSIVE;
 
 			break;
@@ -930,7 +943,7 @@ vm_swapout_thread_throttle_adjust(void)
 
 			proc_set_thread_policy_with_tid(kernel_task, vm_swapout_thread_id,
 							TASK_POLICY_INTERNAL, TASK_POLICY_PASSIVE_IO, TASK_POLICY_DISABLE);
-			vm_swapout_limit = VM_SWAPOUT_LIMIT_T0;
+			vm_swapout_limit = VM_SWAPOUT_LIMIT_UNTHROTTLED(VM_SWAPOUT_LIMIT_T0);
 			vm_swapout_state = VM_SWAPOUT_T0;
 		}
 		break;
@@ -942,7 +955,7 @@ vm_swapout_thread_throttle_adjust(void)
 
 			proc_set_thread_policy_with_tid(kernel_task, vm_swapout_thread_id,
 							TASK_POLICY_INTERNAL, TASK_POLICY_PASSIVE_IO, TASK_POLICY_ENABLE);
-			vm_swapout_limit = VM_SWAPOUT_LIMIT_T0P;
+			vm_swapout_limit = VM_SWAPOUT_LIMIT_UNTHROTTLED(VM_SWAPOUT_LIMIT_T0P);
 			vm_swapout_state = VM_SWAPOUT_T0_PASSIVE;
 		}
 		break;
@@ -164,6 +164,15 @@ static kern_return_t vm_fault_wire_fast(
 				vm_map_offset_t	pmap_addr,
 				ppnum_t		*physpage_p);
 
+static unsigned int vm_fault_wire_batch(
+				vm_map_t	map,
+				vm_map_offset_t	va,
+				vm_map_offset_t	end_addr,
+				vm_tag_t	wire_tag,
+				vm_map_entry_t	entry,
+				pmap_t		pmap,
+				vm_map_offset_t	pmap_addr);
+
 static kern_return_t vm_fault_internal(
 		vm_map_t	map,
 		vm_map_offset_t	vaddr,
@@ -767,11 +776,16 @@ vm_fault_zero_page(vm_page_t m, boolean_t no_zero_fill)
 
 	if (no_zero_fill == TRUE) {
 		my_fault = DBG_NZF_PAGE_FAULT;
+		m->vmp_zeroed = FALSE;
 
 		if (m->vmp_absent && m->vmp_busy)
 			return (my_fault);
 	} else {
-		vm_page_zero_fill(m);
+		/* pages from the pre-zeroed pool need no zeroing */
+		if (m->vmp_zeroed)
+			m->vmp_zeroed = FALSE;
+		else
+			vm_page_zero_fill(m);
 
 		VM_STAT_INCR(zero_fill_count);
 		DTRACE_VM2(zfod, int, 1, (uint64_t *), NULL);
@@ -1902,7 +1916,7 @@ dont_look_for_page:
 			        return (error);
 
 			if (m == VM_PAGE_NULL) {
-				m = vm_page_grab_options(grab_options);
+				m = vm_page_grab_options(grab_options | VM_PAGE_GRAB_ZEROED);
 
 				if (m == VM_PAGE_NULL) {
 					vm_fault_cleanup(object, VM_PAGE_NULL);
@@ -3024,7 +3038,11 @@ MACRO_END
 
 			if (vm_page_local_q &&
 			    (*type_of_fault == DBG_COW_FAULT ||
-			     *type_of_fault == DBG_ZERO_FILL_FAULT) ) {
+			     *type_of_fault == DBG_ZERO_FILL_FAULT ||
+			     ((*type_of_fault == DBG_COMPRESSOR_FAULT ||
+			       *type_of_fault == DBG_COMPRESSOR_SWAPIN_FAULT) &&
+			      object->internal &&
+			      m->vmp_q_state == VM_PAGE_NOT_ON_Q))) {
 				struct vpl	*lq;
 				uint32_t	lid;
 
@@ -3379,6 +3397,119 @@ unsigned long vm_fault_collapse_total = 0;
 unsigned long vm_fault_collapse_skipped = 0;
 
 
+/*
+ * Fault-around: when a fault is resolved from a resident page at the top
+ * of a file backed object, also enter the other resident pages of the
+ * naturally aligned "vm_fault_around_pages" window around it while the
+ * object lock is still held.  Sequential access to mmap'd files then
+ * takes one trap per window instead of one per page.
+ *
+ * Enabled per map entry via madvise(MADV_FAULTAROUND), or for every
+ * file mapping with the vm.fault_around_enabled sysctl.
+ */
+unsigned int vm_fault_around_enabled = 0;
+unsigned int vm_fault_around_pages = 16;
+uint64_t vm_fault_around_faults = 0;
+uint64_t vm_fault_around_mapped = 0;
+
+#define VM_FAULT_AROUND_MAX_PAGES	64
+
+/*
+ * object (locked shared or exclusive) holds the page that was just
+ * entered at "vaddr"/"offset"; the map is locked for read.  Neighbours
+ * are only entered read-only so that writes still go through the fault
+ * path for dirty tracking, and only if nothing is mapped at their address
+ * yet.  Pages that are busy, unusual, or still need code signing
+ * validation are left for a real fault to deal with.
+ */
+static int
+vm_fault_around(
+	pmap_t			pmap,
+	vm_map_offset_t		vaddr,
+	vm_object_t		object,
+	vm_object_offset_t	offset,
+	vm_prot_t		prot,
+	vm_object_fault_info_t	fault_info,
+	int			*candidates)
+{
+	vm_object_offset_t	window, start, end, cur;
+	vm_map_offset_t		cur_vaddr;
+	vm_page_t		m;
+	boolean_t		need_retry;
+	int			type_of_fault;
+	int			entered = 0;
+	kern_return_t		kr;
+
+	*candidates = 0;
+
+	if (vm_fault_around_pages <= 1 || pmap_has_prot_policy(prot))
+		return (0);
+
+	window = (vm_object_offset_t)MIN(vm_fault_around_pages, VM_FAULT_AROUND_MAX_PAGES) * PAGE_SIZE;
+
+	start = offset - MIN(vaddr % window, offset - fault_info->lo_offset);
+	end = MIN(start + window, fault_info->hi_offset);
+
+	prot &= ~VM_PROT_WRITE;
+
+	for (cur = start; cur < end; cur += PAGE_SIZE) {
+		if (cur == offset)
+			continue;
+
+		cur_vaddr = vaddr + (cur - offset);
+		(*candidates)++;
+
+		m = vm_page_lookup(object, cur);
+
+		if (m == VM_PAGE_NULL || m->vmp_busy || m->vmp_laundry || m->vmp_cleaning ||
+		    (m->vmp_unusual && (m->vmp_error || m->vmp_restart || m->vmp_private || m->vmp_absent)) ||
+		    VM_PAGE_GET_PHYS_PAGE(m) == vm_page_guard_addr)
+			continue;
+
+		if (VM_FAULT_NEED_CS_VALIDATION(pmap, m, object))
+			continue;
+
+		if (pmap_find_phys(pmap, cur_vaddr) != 0)
+			continue;
+
+		need_retry = FALSE;
+		type_of_fault = DBG_CACHE_HIT_FAULT;
+
+		kr = vm_fault_enter(m, pmap, cur_vaddr, prot, VM_PROT_READ,
+				    FALSE, FALSE, VM_KERN_MEMORY_NONE,
+				    fault_info, &need_retry, &type_of_fault);
+
+		if (kr != KERN_SUCCESS || need_retry == TRUE) {
+			/*
+			 * the pmap would have to block to expand... that's
+			 * the real fault's business, not ours
+			 */
+			break;
+		}
+		entered++;
+	}
+	return (entered);
+}
+
+
+/*
+ * Account a fault that walked "depth" shadow objects past the top
+ * object in the faulting task's log2 histogram (0, 1, 2-3, ..., 64+),
+ * reported by TASK_VM_INFO.
+ */
+static void
+vm_fault_shadow_depth(
+	unsigned int	depth)
+{
+	int	bucket;
+
+	bucket = fls(depth);
+	if (bucket >= TASK_VM_INFO_SHADOW_DEPTH_BUCKETS)
+		bucket = TASK_VM_INFO_SHADOW_DEPTH_BUCKETS - 1;
+
+	current_task()->shadow_depth[bucket]++;
+}
+
 kern_return_t
 vm_fault_external(
 	vm_map_t	map,
@@ -3454,6 +3585,8 @@ vm_fault_internal(
 	int			object_lock_type = 0;
 	int			cur_object_lock_type;
 	vm_object_t		top_object = VM_OBJECT_NULL;
+	int			top_object_lock_type = 0;
+	unsigned int		shadow_depth = 0;
 	vm_object_t		written_on_object = VM_OBJECT_NULL;
 	memory_object_t		written_on_pager = NULL;
 	vm_object_offset_t	written_on_offset = 0;
@@ -3462,6 +3595,7 @@ vm_fault_internal(
 	int			grab_options;
 	vm_map_offset_t		trace_vaddr;
 	vm_map_offset_t		trace_real_vaddr;
+	boolean_t		fault_around = FALSE;
 #if DEVELOPMENT || DEBUG
 	vm_map_offset_t		real_vaddr;
 
@@ -3655,6 +3789,7 @@ RetryFault:
 
 	cur_object = object;
 	cur_offset = offset;
+	shadow_depth = 0;
 
 	grab_options = 0;
 #if CONFIG_SECLUDED_MEMORY
@@ -3928,6 +4063,7 @@ upgrade_for_validation:
 					 * is and we'll release it later.
 					 */
 					top_object = object;
+					top_object_lock_type = object_lock_type;
 
 					/*
 					 * switch to the object that has the new page
@@ -3951,6 +4087,18 @@ FastPmapEnter:
 				else
 					need_retry_ptr = NULL;
 
+				/*
+				 * fault-around only applies to pages found at
+				 * the top of a file backed object mapped
+				 * directly (no submap) in a user map
+				 */
+				fault_around = ((fault_info.fault_around || vm_fault_around_enabled) &&
+						top_object == VM_OBJECT_NULL &&
+						map == original_map && map != kernel_map &&
+						caller_pmap == PMAP_NULL && physpage_p == NULL &&
+						!wired && !change_wiring &&
+						!m_object->internal);
+
 				if (caller_pmap) {
 				        kr = vm_fault_enter(m,
 							    caller_pmap,
@@ -4002,7 +4150,11 @@ FastPmapEnter:
 					}
 				}
 
+				vm_fault_shadow_depth(shadow_depth);
+
 				if (top_object != VM_OBJECT_NULL) {
+					vm_object_collapse_async(top_object, shadow_depth,
+					    top_object_lock_type == OBJECT_LOCK_EXCLUSIVE);
 					/*
 					 * It's safe to drop the top object
 					 * now that we've done our
@@ -4014,6 +4166,9 @@ FastPmapEnter:
 					 */
 					vm_object_unlock(top_object);
 					top_object = VM_OBJECT_NULL;
+				} else {
+					vm_object_collapse_async(object, shadow_depth,
+					    object_lock_type == OBJECT_LOCK_EXCLUSIVE);
 				}
 
 				if (need_collapse == TRUE)
@@ -4030,6 +4185,20 @@ FastPmapEnter:
 
 					vm_fault_deactivate_behind(m_object, cur_offset, fault_info.behavior);
 				}
+				if (fault_around == TRUE && kr == KERN_SUCCESS && need_retry == FALSE) {
+					int	fa_candidates;
+					int	fa_mapped;
+
+					fa_mapped = vm_fault_around(pmap, vaddr, m_object, m->vmp_offset,
+								    prot, &fault_info, &fa_candidates);
+
+					current_task()->fault_around_faults++;
+					current_task()->fault_around_candidates += fa_candidates;
+					current_task()->fault_around_pages += fa_mapped;
+
+					OSAddAtomic64(1, &vm_fault_around_faults);
+					OSAddAtomic64(fa_mapped, &vm_fault_around_mapped);
+				}
 				/*
 				 * That's it, clean up and return.
 				 */
@@ -4407,6 +4576,7 @@ FastPmapEnter:
 					if (cur_object != object) {
 						if (insert_cur_object) {
 							top_object = object;
+							top_object_lock_type = object_lock_type;
 							/*
 							 * switch to the object that has the new page
 							 */
@@ -4468,7 +4638,7 @@ FastPmapEnter:
 						goto RetryFault;
 					}
 				}
-				m = vm_page_alloc(object, offset);
+				m = vm_page_grab_options(grab_options | VM_PAGE_GRAB_ZEROED);
 				m_object = NULL;
 
 				if (m == VM_PAGE_NULL) {
@@ -4478,6 +4648,7 @@ FastPmapEnter:
 					 */
 					break;
 				}
+				vm_page_insert(m, object, offset);
 				m_object = object;
 
 				/*
@@ -4511,6 +4682,7 @@ FastPmapEnter:
 				vm_object_unlock(cur_object);
 
 			cur_object = new_object;
+			shadow_depth++;
 
 			continue;
 		}
@@ -4539,6 +4711,8 @@ FastPmapEnter:
 		        vm_object_lock(object);
 		}
 	}
+	vm_fault_shadow_depth(shadow_depth);
+	vm_object_collapse_async(object, shadow_depth, TRUE);
 
 handle_copy_delay:
 	vm_map_unlock_read(map);
@@ -5158,6 +5332,13 @@ vm_fault_wire(
 	 */
 
 	for (va = entry->vme_start; va < end_addr; va += PAGE_SIZE) {
+		if (physpage_p == NULL) {
+			va += ptoa_64(vm_fault_wire_batch(map, va, end_addr,
+						wire_tag, entry, pmap,
+						pmap_addr + (va - entry->vme_start)));
+			if (va >= end_addr)
+				break;
+		}
 		rc = vm_fault_wire_fast(map, va, prot, wire_tag, entry, pmap,
 					pmap_addr + (va - entry->vme_start),
 					physpage_p);
@@ -5570,6 +5751,179 @@ done:
 
 }
 
+/*
+ *	Routine:	vm_fault_wire_batch
+ *	Purpose:
+ *		Wire the run of pages starting at "va" that needs no
+ *		fault handling: pages resident in the top object and, for
+ *		anonymous memory with nothing behind it, zero-filled
+ *		pages.  The object lock is taken once for up to
+ *		vm_fault_wire_batch_max pages and the page queues lock
+ *		once per VM_FAULT_WIRE_BATCH pages, instead of both once
+ *		per page.  Stops at the first page that needs anything
+ *		else, which is then left to vm_fault_wire_fast() and
+ *		vm_fault_internal().
+ *
+ *		Returns the number of pages wired and entered in the pmap.
+ *		Same locking as vm_fault_wire_fast().
+ */
+#define VM_FAULT_WIRE_BATCH	64
+
+unsigned int	vm_fault_wire_batch_max = 4096;
+uint64_t	vm_fault_wire_batch_runs = 0;
+uint64_t	vm_fault_wire_batch_pages = 0;
+
+static unsigned int
+vm_fault_wire_batch(
+	vm_map_t	map,
+	vm_map_offset_t	va,
+	vm_map_offset_t	end_addr,
+	vm_tag_t	wire_tag,
+	vm_map_entry_t	entry,
+	pmap_t		pmap,
+	vm_map_offset_t	pmap_addr)
+{
+	vm_page_t		pages[VM_FAULT_WIRE_BATCH];
+	uint64_t		zero_filled;
+	vm_object_t		object;
+	vm_object_offset_t	offset;
+	vm_prot_t		prot;
+	vm_page_t		m;
+	boolean_t		can_zero_fill;
+	unsigned int		wired;
+	int			count, entered, i;
+	int			type_of_fault;
+	kern_return_t		kr;
+	struct vm_object_fault_info fault_info = {};
+
+	if (entry->is_sub_map || vm_fault_wire_batch_max == 0)
+		return 0;
+
+	object = VME_OBJECT(entry);
+	offset = (va - entry->vme_start) + VME_OFFSET(entry);
+	prot = entry->protection;
+
+	fault_info.user_tag = VME_ALIAS(entry);
+	fault_info.pmap_options = 0;
+	if (entry->iokit_acct || !entry->use_pmap) {
+		fault_info.pmap_options |= PMAP_OPTIONS_ALT_ACCT;
+	}
+
+	vm_object_lock(object);
+
+	if ((object->copy != VM_OBJECT_NULL) && (prot & VM_PROT_WRITE)) {
+		vm_object_unlock(object);
+		return 0;
+	}
+	vm_object_reference_locked(object);
+	vm_object_paging_begin(object);
+
+	/*
+	 * a missing page can only be zero-filled here if it can't be
+	 * in the compressor or in a backing object
+	 */
+	can_zero_fill = (object->internal &&
+			 !map->no_zero_fill &&
+			 object->shadow == VM_OBJECT_NULL &&
+			 !object->shadow_severed &&
+			 !object->pager_created &&
+			 object->purgable == VM_PURGABLE_DENY &&
+			 object != kernel_object &&
+			 object != compressor_object &&
+			 object != vm_submap_object);
+
+	wired = 0;
+	kr = KERN_SUCCESS;
+
+	while (kr == KERN_SUCCESS && wired < vm_fault_wire_batch_max) {
+		/*
+		 * gather the next run of pages and mark them busy
+		 */
+		zero_filled = 0;
+
+		for (count = 0;
+		     count < VM_FAULT_WIRE_BATCH &&
+		     va + ptoa_64(wired + count) < end_addr &&
+		     wired + count < vm_fault_wire_batch_max;
+		     count++) {
+			m = vm_page_lookup(object, offset + ptoa_64(count));
+
+			if (m == VM_PAGE_NULL) {
+				if (!can_zero_fill ||
+				    offset + ptoa_64(count) >= object->vo_size ||
+				    vm_page_throttled(FALSE))
+					break;
+				m = vm_page_alloc(object, offset + ptoa_64(count));
+
+				if (m == VM_PAGE_NULL)
+					break;
+				(void) vm_fault_zero_page(m, FALSE);
+				zero_filled |= (1ULL << count);
+			} else {
+				if (m->vmp_busy || m->vmp_fictitious ||
+				    (m->vmp_unusual && (m->vmp_error || m->vmp_restart || m->vmp_absent)))
+					break;
+				m->vmp_busy = TRUE;
+			}
+			pages[count] = m;
+		}
+		if (count == 0)
+			break;
+
+		vm_page_lockspin_queues();
+		for (i = 0; i < count; i++)
+			vm_page_wire(pages[i], wire_tag, TRUE);
+		vm_page_unlock_queues();
+
+		for (entered = 0; entered < count; entered++) {
+			type_of_fault = (zero_filled & (1ULL << entered)) ?
+			    DBG_ZERO_FILL_FAULT : DBG_CACHE_HIT_FAULT;
+
+			kr = vm_fault_enter(pages[entered],
+					    pmap,
+					    pmap_addr + ptoa_64(wired + entered),
+					    prot,
+					    prot,
+					    TRUE,  /* wired */
+					    FALSE, /* change_wiring */
+					    wire_tag,
+					    &fault_info,
+					    NULL,
+					    &type_of_fault);
+			if (kr != KERN_SUCCESS)
+				break;
+		}
+		if (entered < count) {
+			vm_page_lockspin_queues();
+			for (i = entered; i < count; i++)
+				vm_page_unwire(pages[i], TRUE);
+			vm_page_unlock_queues();
+		}
+		for (i = 0; i < count; i++)
+			PAGE_WAKEUP_DONE(pages[i]);
+
+		wired += entered;
+		offset += ptoa_64(entered);
+
+		if (entered < VM_FAULT_WIRE_BATCH)
+			break;
+	}
+
+	vm_object_paging_end(object);
+	vm_object_unlock(object);
+	vm_object_deallocate(object);
+
+	if (wired) {
+		VM_STAT_INCR_BY(faults, wired);
+		if (current_task() != TASK_NULL)
+			current_task()->faults += wired;
+
+		OSIncrementAtomic64((SInt64 *)&vm_fault_wire_batch_runs);
+		OSAddAtomic64(wired, (SInt64 *)&vm_fault_wire_batch_pages);
+	}
+	return wired;
+}
+
 /*
  *	Routine:	vm_fault_copy_cleanup
  *	Purpose:
@@ -1861,6 +1861,7 @@ vm_map_find_space(
 	new_entry->used_for_jit = FALSE;
 	new_entry->pmap_cs_associated = FALSE;
 	new_entry->zero_wired_pages = FALSE;
+	new_entry->vme_fault_around = FALSE;
 	new_entry->iokit_acct = FALSE;
 	new_entry->vme_resilient_codesign = FALSE;
 	new_entry->vme_resilient_media = FALSE;
@@ -2068,6 +2069,78 @@ vm_memory_malloc_no_cow(
 	return FALSE;
 }
 
+/*
+ * Page table sharing for nested submaps (the shared region): how many
+ * times a task's pmap got to use the submap's page tables, how often
+ * pmap_nest() refused, and how much of the nested ranges had to be
+ * unnested again (e.g. for a copy-on-write fault in the submap).
+ */
+uint64_t vm_map_pmap_nested = 0;
+uint64_t vm_map_pmap_nest_failed = 0;
+uint64_t vm_map_pmap_unnested_bytes = 0;
+
+/*
+ * Transparent superpages: large anonymous allocations made anywhere in
+ * a user map are first attempted with VM_FLAGS_SUPERPAGE_SIZE_2MB, and
+ * fall back to base pages if no contiguous memory is available.  Like
+ * explicit superpages, such memory is wired and not inherited across
+ * fork(), so this is off by default and only meant for dedicated
+ * machines running a few processes with very large heaps.
+ */
+unsigned int vm_map_transparent_superpages = 0;
+vm_map_size_t vm_map_transparent_superpage_min = 64 * 1024 * 1024;
+uint64_t vm_map_transparent_superpage_maps = 0;
+uint64_t vm_map_transparent_superpage_bytes = 0;
+uint64_t vm_map_transparent_superpage_fallbacks = 0;
+
+/*
+ * Returns the superpage flag to try for an anonymous allocation of
+ * "size" bytes with "flags" in "map", or 0 if it isn't eligible.
+ */
+int
+vm_map_transparent_superpage_flags(
+	vm_map_t	map,
+	vm_map_size_t	size,
+	int		flags)
+{
+#ifdef __x86_64__
+	if (!vm_map_transparent_superpages ||
+	    map == kernel_map ||
+	    map->pmap == kernel_pmap ||
+	    VM_MAP_PAGE_SIZE(map) != PAGE_SIZE)
+		return 0;
+	if (!(flags & VM_FLAGS_ANYWHERE) ||
+	    (flags & (VM_FLAGS_SUPERPAGE_MASK | VM_FLAGS_PURGABLE)))
+		return 0;
+	if (size < vm_map_transparent_superpage_min ||
+	    (size & (SUPERPAGE_SIZE - 1)))
+		return 0;
+	return VM_FLAGS_SUPERPAGE_SIZE_2MB;
+#else
+	(void) map;
+	(void) size;
+	(void) flags;
+	return 0;
+#endif /* __x86_64__ */
+}
+
+/*
+ * Account for the outcome of an allocation that was attempted with
+ * the flag returned by vm_map_transparent_superpage_flags().
+ */
+void
+vm_map_transparent_superpage_result(
+	vm_map_size_t	size,
+	kern_return_t	kr)
+{
+	if (kr == KERN_SUCCESS) {
+		OSIncrementAtomic64((SInt64 *)&vm_map_transparent_superpage_maps);
+		OSAddAtomic64(size, (SInt64 *)&vm_map_transparent_superpage_bytes);
+	} else {
+		OSIncrementAtomic64((SInt64 *)&vm_map_transparent_superpage_fallbacks);
+	}
+}
+
 /*
  *	Routine:	vm_map_enter
  *
@@ -2767,6 +2840,7 @@ StartAgain: ;
 		    */
 		   (!entry->map_aligned || !clear_map_aligned) &&
 		   (!entry->zero_wired_pages) &&
+		   (!entry->vme_fault_around) &&
 		   (!entry->used_for_jit && !entry_for_jit) &&
 		   (!entry->pmap_cs_associated) &&
 		   (entry->iokit_acct == iokit_acct) &&
@@ -2941,10 +3015,12 @@ StartAgain: ;
 						       (long long)tmp_start,
 						       (long long)tmp_end,
 						       kr);
+						OSIncrementAtomic64((SInt64 *)&vm_map_pmap_nest_failed);
 					} else {
 						/* we're now nested ! */
 						new_entry->use_pmap = TRUE;
 						pmap_empty = FALSE;
+						OSIncrementAtomic64((SInt64 *)&vm_map_pmap_nested);
 					}
 				}
 #endif /* NO_NESTED_PMAP */
@@ -5141,6 +5217,8 @@ vm_map_clip_unnest(
 	pmap_unnest(map->pmap,
 		    entry->vme_start,
 		    entry->vme_end - entry->vme_start);
+	OSAddAtomic64(entry->vme_end - entry->vme_start,
+		      (SInt64 *)&vm_map_pmap_unnested_bytes);
 	if ((map->mapped_in_other_pmaps) && (map->map_refcnt)) {
 		/* clean up parent map/maps */
 		vm_map_submap_pmap_clean(
@@ -5590,6 +5668,8 @@ vm_map_protect(
 	vm_prot_t			new_max;
 	int				pmap_options = 0;
 	kern_return_t			kr;
+	pmap_flush_context		pmap_flush_context_storage;
+	boolean_t			delayed_pmap_flush = FALSE;
 
 	XPR(XPR_VM_MAP,
 	    "vm_map_protect, 0x%X start 0x%X end 0x%X, new 0x%X %d",
@@ -5793,6 +5873,13 @@ vm_map_protect(
 		vm_map_clip_start(map, current, start);
 	}
 
+	/*
+	 * Protections are lowered entry by entry but the TLBs are
+	 * only flushed once, after the last entry, and before we
+	 * drop the map lock.
+	 */
+	pmap_flush_context_init(&pmap_flush_context_storage);
+
 	while ((current != vm_map_to_entry(map)) &&
 	       (current->vme_start < end)) {
 
@@ -5896,13 +5983,17 @@ vm_map_protect(
 						     current->vme_start,
 						     current->vme_end,
 						     prot,
-						     pmap_options,
-						     NULL);
+						     pmap_options | PMAP_OPTIONS_NOFLUSH,
+						     (void *)&pmap_flush_context_storage);
+				delayed_pmap_flush = TRUE;
 			}
 		}
 		current = current->vme_next;
 	}
 
+	if (delayed_pmap_flush == TRUE)
+		pmap_flush(&pmap_flush_context_storage);
+
 	current = entry;
 	while ((current != vm_map_to_entry(map)) &&
 	       (current->vme_start <= end)) {
@@ -12197,6 +12288,9 @@ vm_map_fork_copy(
 	return TRUE;
 }
 
+/* copy-on-write entries fork didn't have to write-protect */
+uint64_t vm_map_fork_protect_skipped = 0;
+
 /*
  *	vm_map_fork:
  *
@@ -12375,17 +12469,37 @@ vm_map_fork(
 
 				assert(!pmap_has_prot_policy(prot));
 
-				vm_object_pmap_protect(
-					VME_OBJECT(old_entry),
-					VME_OFFSET(old_entry),
-					(old_entry->vme_end -
-					 old_entry->vme_start),
-					((old_entry->is_shared
-					  || old_map->mapped_in_other_pmaps)
-					 ? PMAP_NULL :
-					 old_map->pmap),
-					old_entry->vme_start,
-					prot);
+				if (!old_entry->is_shared &&
+				    !old_map->mapped_in_other_pmaps &&
+				    VME_OBJECT(old_entry)->resident_page_count == 0) {
+					/*
+					 * Only faults on this entry can map
+					 * its pages writable in old_map's
+					 * pmap, and those are entered with
+					 * old_map locked, which we hold
+					 * exclusively: with no resident page
+					 * in the top object, there's nothing
+					 * writable to write-protect.  Pages
+					 * from the shadow chain are already
+					 * mapped read-only.  Saves walking
+					 * the page tables of mappings whose
+					 * memory has all been compressed or
+					 * paged out.
+					 */
+					vm_map_fork_protect_skipped++;
+				} else {
+					vm_object_pmap_protect(
+						VME_OBJECT(old_entry),
+						VME_OFFSET(old_entry),
+						(old_entry->vme_end -
+						 old_entry->vme_start),
+						((old_entry->is_shared
+						  || old_map->mapped_in_other_pmaps)
+						 ? PMAP_NULL :
+						 old_map->pmap),
+						old_entry->vme_start,
+						prot);
+				}
 
 				assert(old_entry->wired_count == 0);
 				old_entry->needs_copy = TRUE;
@@ -13015,16 +13129,24 @@ submap_recurse:
 	 *	Create an object if necessary.
 	 */
 	if (VME_OBJECT(entry) == VM_OBJECT_NULL) {
+		vm_object_t	new_object;
+
+		/*
+		 * Allocate the object before upgrading the map lock: the
+		 * exclusive hold stalls every other fault and mapping
+		 * change in this map, so keep it to setting the pointer.
+		 */
+		new_object = vm_object_allocate(
+			(vm_map_size_t)(entry->vme_end - entry->vme_start));
 
 		if (vm_map_lock_read_to_write(map)) {
+			/* the map lock was dropped: the entry may be gone */
+			vm_object_deallocate(new_object);
 			vm_map_lock_read(map);
 			goto RetryLookup;
 		}
 
-		VME_OBJECT_SET(entry,
-			       vm_object_allocate(
-				       (vm_map_size_t)(entry->vme_end -
-						       entry->vme_start)));
+		VME_OBJECT_SET(entry, new_object);
 		VME_OFFSET_SET(entry, 0);
 		assert(entry->use_pmap);
 		vm_map_lock_write_to_read(map);
@@ -13055,6 +13177,7 @@ submap_recurse:
 		fault_info->hi_offset =
 			(entry->vme_end - entry->vme_start) + VME_OFFSET(entry);
 		fault_info->no_cache  = entry->no_cache;
+		fault_info->fault_around = entry->vme_fault_around;
 		fault_info->stealth = FALSE;
 		fault_info->io_sync = FALSE;
 		if (entry->used_for_jit ||
@@ -14332,6 +14455,7 @@ vm_map_simplify_entry(
 	    (prev_entry->permanent == this_entry->permanent) &&
 	    (prev_entry->map_aligned == this_entry->map_aligned) &&
 	    (prev_entry->zero_wired_pages == this_entry->zero_wired_pages) &&
+	    (prev_entry->vme_fault_around == this_entry->vme_fault_around) &&
 	    (prev_entry->used_for_jit == this_entry->used_for_jit) &&
 	    (prev_entry->pmap_cs_associated == this_entry->pmap_cs_associated) &&
 	    /* from_reserved_zone: OK if that field doesn't match */
@@ -14608,6 +14732,7 @@ vm_map_behavior_set(
 	case VM_BEHAVIOR_SEQUENTIAL:
 	case VM_BEHAVIOR_RSEQNTL:
 	case VM_BEHAVIOR_ZERO_WIRED_PAGES:
+	case VM_BEHAVIOR_FAULTAROUND:
 		vm_map_lock(map);
 
 		/*
@@ -14634,8 +14759,14 @@ vm_map_behavior_set(
 
 			if( new_behavior == VM_BEHAVIOR_ZERO_WIRED_PAGES ) {
 				entry->zero_wired_pages = TRUE;
+			} else if (new_behavior == VM_BEHAVIOR_FAULTAROUND) {
+				entry->vme_fault_around = TRUE;
 			} else {
 				entry->behavior = new_behavior;
+				/* MADV_NORMAL and MADV_RANDOM also turn fault-around back off */
+				if (new_behavior == VM_BEHAVIOR_DEFAULT ||
+				    new_behavior == VM_BEHAVIOR_RANDOM)
+					entry->vme_fault_around = FALSE;
 			}
 			entry = entry->vme_next;
 		}
@@ -14775,6 +14906,49 @@ vm_map_willneed(
 			continue;
 		}
 
+		/*
+		 * Shared anonymous memory, i.e. POSIX and System V shared
+		 * memory and MAP_SHARED|MAP_ANON mappings, has no pager to
+		 * read ahead from, but a large shared arena otherwise takes
+		 * a zero-fill fault on every page as it is first touched.
+		 * Fault the range in now instead.  Private anonymous memory
+		 * keeps ignoring the advice.
+		 */
+		if (!entry->is_sub_map &&
+		    entry->inheritance == VM_INHERIT_SHARE &&
+		    VME_OBJECT(entry) != VM_OBJECT_NULL &&
+		    VME_OBJECT(entry)->internal) {
+			vm_map_offset_t	addr;
+			vm_prot_t	fault_type;
+
+			fault_type = entry->protection &
+			    (VM_PROT_READ | VM_PROT_WRITE);
+			vm_map_unlock_read(map);
+
+			for (addr = start; addr < start + len;
+			    addr += VM_MAP_PAGE_SIZE(map)) {
+				if (pmap_find_phys(map->pmap, addr) != 0)
+					continue;
+				kr = vm_fault(map, addr, fault_type, FALSE,
+				    VM_KERN_MEMORY_NONE, THREAD_UNINT, NULL, 0);
+				if (kr != KERN_SUCCESS) {
+					/* it's only advice */
+					return KERN_SUCCESS;
+				}
+			}
+
+			start += len;
+			if (start >= end) {
+				return KERN_SUCCESS;
+			}
+			vm_map_lock_read(map);
+			if (! vm_map_lookup_entry(map, start, &entry)) {
+				vm_map_unlock_read(map);
+				return KERN_INVALID_ADDRESS;
+			}
+			continue;
+		}
+
 		/*
 		 * Find the file object backing this map entry.  If there is
 		 * none, then we simply ignore the "will need" advice for this
@@ -15387,6 +15561,7 @@ vm_map_entry_insert(
 	}
 	VME_ALIAS_SET(new_entry, alias);
 	new_entry->zero_wired_pages = FALSE;
+	new_entry->vme_fault_around = FALSE;
 	new_entry->no_cache = no_cache;
 	new_entry->permanent = permanent;
 	if (superpage_size)
@@ -343,7 +343,8 @@ struct vm_map_entry {
 	/* boolean_t */ vme_resilient_codesign:1,
 	/* boolean_t */ vme_resilient_media:1,
 	/* boolean_t */ vme_atomic:1, /* entry cannot be split/coalesced */
-		__unused:4;
+	/* boolean_t */ vme_fault_around:1, /* map resident neighbours on fault */
+		__unused:3;
 ;
 
 	unsigned short		wired_count;	/* can be paged if = 0 */
@@ -70,17 +70,43 @@ void vm_map_store_walk_rb( vm_map_t map, vm_map_entry_t *wrong_vme, vm_map_entry
 
 boolean_t vm_map_store_lookup_entry_rb( vm_map_t map, vm_map_offset_t address, vm_map_entry_t *vm_entry)
 {
-	struct vm_map_header hdr = map->hdr;
-	struct vm_map_store *rb_entry = RB_ROOT(&(hdr.rb_head_store));
-	vm_map_entry_t cur = vm_map_to_entry(map);
+	struct vm_map_store *rb_entry = RB_ROOT(&(map->hdr.rb_head_store));
+	vm_map_entry_t cur = map->hint;
 	vm_map_entry_t prev = VM_MAP_ENTRY_NULL;
+	vm_map_entry_t next;
+
+	/*
+	 * Lookups tend to hit the entry last looked up or the one
+	 * right after it (faults walking a region, clipping around
+	 * a previous lookup), so check those before descending
+	 * the tree.
+	 */
+	if (cur != vm_map_to_entry(map) && address >= cur->vme_start) {
+		if (address < cur->vme_end) {
+			*vm_entry = cur;
+			return TRUE;
+		}
+		next = cur->vme_next;
+		if (next == vm_map_to_entry(map) || address < next->vme_start) {
+			*vm_entry = cur;
+			return FALSE;
+		}
+		if (address < next->vme_end) {
+			SAVE_HINT_MAP_READ(map, next);
+			*vm_entry = next;
+			return TRUE;
+		}
+	}
 
+	cur = vm_map_to_entry(map);
 	while (rb_entry != (struct vm_map_store*)NULL) {
        		cur =  VME_FOR_STORE(rb_entry);
 		if(cur == VM_MAP_ENTRY_NULL)
 			panic("no entry");
 		if (address >= cur->vme_start) {
 			if (address < cur->vme_end) {
+				if (map->hint != cur)
+					SAVE_HINT_MAP_READ(map, cur);
 				*vm_entry = cur;
 				return TRUE;
 			}
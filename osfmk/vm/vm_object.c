@@ -88,6 +88,7 @@
 #include <kern/processor.h>
 #include <kern/misc_protos.h>
 #include <kern/policy_internal.h>
+#include <kern/thread_call.h>
 
 #include <vm/memory_object.h>
 #include <vm/vm_compressor_pager.h>
@@ -300,6 +301,15 @@ static queue_head_t vm_object_reaper_queue; /* protected by vm_object_reaper_loc
 unsigned int vm_object_reap_count = 0;
 unsigned int vm_object_reap_count_async = 0;
 
+/*
+ * An exiting task that drops the last reference on a large anonymous
+ * object leaves freeing its pages to the reaper thread, rather than
+ * keep its parent waiting in wait4() while every page is freed.
+ * 0 disables this.
+ */
+unsigned int vm_object_reap_exit_min_pages = 16384;
+uint64_t vm_object_reap_exit_async = 0;
+
 #define vm_object_reaper_lock()		\
 		lck_mtx_lock(&vm_object_reaper_lock_data)
 #define vm_object_reaper_lock_spin()		\
@@ -671,6 +681,8 @@ vm_object_reaper_init(void)
 		panic("failed to launch vm_object_reaper_thread kr=0x%x", kr);
 	}
 	thread_deallocate(thread);
+
+	vm_object_collapse_async_init();
 }
 
 __private_extern__ void
@@ -1394,6 +1406,24 @@ vm_object_terminate(
 		vm_object_unlock(shadow_object);
 	}
 
+	if (vm_object_reap_exit_min_pages != 0 &&
+	    object->internal &&
+	    !object->pageout &&
+	    object->resident_page_count >= vm_object_reap_exit_min_pages &&
+	    VM_OBJECT_OWNER(object) == TASK_NULL &&
+	    current_task() != kernel_task &&
+	    !current_task()->active) {
+		/*
+		 * The map of an exiting task is being torn down; its
+		 * mappings of this object are already gone, so nothing
+		 * but the reaper will look at it again.
+		 */
+		OSAddAtomic64(1, &vm_object_reap_exit_async);
+		vm_object_reap_async(object);
+		vm_object_unlock(object);
+		return KERN_FAILURE;
+	}
+
 	if (object->paging_in_progress != 0 ||
 	    object->activity_in_progress != 0) {
 		/*
@@ -5021,6 +5051,120 @@ retry:
 	*/
 }
 
+/*
+ *	Asynchronous collapse of deep shadow chains.
+ *
+ *	Faults that walk a deep shadow chain hand the top object to
+ *	vm_object_collapse_async(), which takes a reference on it and
+ *	queues it for a thread call to collapse, so the fault path doesn't
+ *	pay for it.  Chains often become collapsible long after they were
+ *	built (e.g. once the other children of a forking server exit) and
+ *	nothing else revisits them then.
+ */
+#define VM_OBJECT_COLLAPSE_ASYNC_MAX	32
+
+unsigned int	vm_object_collapse_async_depth = 4;
+uint64_t	vm_object_collapse_async_queued = 0;
+uint64_t	vm_object_collapse_async_dropped = 0;
+uint64_t	vm_object_collapse_async_done = 0;
+
+static vm_object_t	vm_object_collapse_async_queue[VM_OBJECT_COLLAPSE_ASYNC_MAX];
+static int		vm_object_collapse_async_count = 0;
+static boolean_t	vm_object_collapse_async_inited = FALSE;
+static thread_call_data_t vm_object_collapse_async_call;
+static lck_mtx_t	vm_object_collapse_async_lock_data;
+static lck_mtx_ext_t	vm_object_collapse_async_lock_data_ext;
+
+#define vm_object_collapse_async_lock()		\
+		lck_mtx_lock_spin(&vm_object_collapse_async_lock_data)
+#define vm_object_collapse_async_unlock()	\
+		lck_mtx_unlock(&vm_object_collapse_async_lock_data)
+
+static void
+vm_object_collapse_async_thread_call(
+	__unused thread_call_param_t	p0,
+	__unused thread_call_param_t	p1)
+{
+	vm_object_t	object;
+
+	for (;;) {
+		vm_object_collapse_async_lock();
+		if (vm_object_collapse_async_count == 0) {
+			vm_object_collapse_async_unlock();
+			break;
+		}
+		object = vm_object_collapse_async_queue[--vm_object_collapse_async_count];
+		vm_object_collapse_async_unlock();
+
+		vm_object_lock(object);
+		vm_object_collapse(object, 0, TRUE);
+		vm_object_unlock(object);
+
+		OSIncrementAtomic64((SInt64 *)&vm_object_collapse_async_done);
+
+		vm_object_deallocate(object);
+	}
+}
+
+__private_extern__ void
+vm_object_collapse_async_init(void)
+{
+	lck_mtx_init_ext(&vm_object_collapse_async_lock_data,
+		&vm_object_collapse_async_lock_data_ext,
+		&vm_object_lck_grp,
+		&vm_object_lck_attr);
+	thread_call_setup(&vm_object_collapse_async_call,
+			  vm_object_collapse_async_thread_call, NULL);
+	vm_object_collapse_async_inited = TRUE;
+}
+
+/*
+ *	Queue "object", the top of a shadow chain "depth" objects deep,
+ *	for an asynchronous collapse.  Called with the object locked,
+ *	exclusive if "exclusive" is TRUE and shared otherwise.
+ */
+__private_extern__ void
+vm_object_collapse_async(
+	vm_object_t	object,
+	unsigned int	depth,
+	boolean_t	exclusive)
+{
+	int		i;
+
+	if (vm_object_collapse_async_inited == FALSE ||
+	    vm_object_collapse_async_depth == 0 ||
+	    depth < vm_object_collapse_async_depth ||
+	    !vm_object_collapse_allowed)
+		return;
+
+	vm_object_collapse_async_lock();
+
+	for (i = 0; i < vm_object_collapse_async_count; i++) {
+		if (vm_object_collapse_async_queue[i] == object) {
+			vm_object_collapse_async_unlock();
+			return;
+		}
+	}
+	if (vm_object_collapse_async_count == VM_OBJECT_COLLAPSE_ASYNC_MAX) {
+		vm_object_collapse_async_unlock();
+
+		OSIncrementAtomic64((SInt64 *)&vm_object_collapse_async_dropped);
+		return;
+	}
+	if (exclusive)
+		vm_object_reference_locked(object);
+	else
+		vm_object_reference_shared(object);
+
+	vm_object_collapse_async_queue[vm_object_collapse_async_count++] = object;
+
+	vm_object_collapse_async_unlock();
+
+	OSIncrementAtomic64((SInt64 *)&vm_object_collapse_async_queued);
+
+	thread_call_enter(&vm_object_collapse_async_call);
+}
+
 /*
  *	Routine:	vm_object_page_remove: [internal]
  *	Purpose:
@@ -128,7 +128,8 @@ struct vm_object_fault_info {
 	/* boolean_t */ pmap_cs_associated:1,
 	/* boolean_t */	mark_zf_absent:1,
 	/* boolean_t */ batch_pmap_op:1,
-		__vm_object_fault_info_unused_bits:25;
+	/* boolean_t */ fault_around:1,
+		__vm_object_fault_info_unused_bits:24;
 	int		pmap_options;
 };
 
@@ -748,6 +749,13 @@ __private_extern__ void		vm_object_collapse(
 					vm_object_offset_t	offset,
 					boolean_t		can_bypass);
 
+__private_extern__ void		vm_object_collapse_async_init(void);
+
+__private_extern__ void		vm_object_collapse_async(
+					vm_object_t		object,
+					unsigned int		depth,
+					boolean_t		exclusive);
+
 __private_extern__ boolean_t	vm_object_copy_quickly(
 				vm_object_t		*_object,
 				vm_object_offset_t	src_offset,
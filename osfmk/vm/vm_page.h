@@ -270,7 +270,8 @@ struct vm_page {
 	                vmp_reusable:1,
 	                vmp_lopage:1,
 	                vmp_written_by_kernel:1, /* page was written by kernel (i.e. decompressed) */
-	                vmp_unused_object_bits:8;
+	                vmp_zeroed:1,         /* page came from the pre-zeroed pool and is still all zeroes (O) */
+	                vmp_unused_object_bits:7;
 
 #if    !defined(__arm__) && !defined(__arm64__)
 	ppnum_t         vmp_phys_page;        /* Physical page number of the page */
@@ -1231,6 +1232,10 @@ extern vm_page_t	vm_page_grab_options(int flags);
 #if CONFIG_SECLUDED_MEMORY
 #define VM_PAGE_GRAB_SECLUDED	0x00000001
 #endif /* CONFIG_SECLUDED_MEMORY */
+#define VM_PAGE_GRAB_ZEROED	0x00000002	/* prefer a page from the pre-zeroed pool */
+
+extern void		vm_page_prezero_init(void);
+extern void		vm_page_prezero_drain(void);
 
 extern vm_page_t	vm_page_grablo(void);
 
@@ -285,6 +285,24 @@ struct cq {
 
 struct cq ciq[MAX_COMPRESSOR_THREAD_COUNT];
 
+vmcw_stats_t vm_compressor_worker_stats[MAX_COMPRESSOR_THREAD_COUNT + 1];
+
+/*
+ * Map a c_seg fill head back to the compressor worker that owns it.
+ * Fill heads that don't belong to one of the compressor threads
+ * (freezer, compaction, swapin) map to VM_COMPRESSOR_WORKER_OTHER.
+ */
+int
+vm_pageout_compressor_worker_id(void **current_chead)
+{
+	uintptr_t	addr = (uintptr_t)current_chead;
+
+	if (addr < (uintptr_t)&ciq[0] || addr >= (uintptr_t)&ciq[MAX_COMPRESSOR_THREAD_COUNT])
+		return (VM_COMPRESSOR_WORKER_OTHER);
+
+	return ((int)((addr - (uintptr_t)&ciq[0]) / sizeof(struct cq)));
+}
+
 
 #if VM_PRESSURE_EVENTS
 void vm_pressure_thread(void);
@@ -1857,6 +1875,18 @@ vm_pageout_scan(void)
 	/* Ask the pmap layer to return any pages it no longer needs. */
 	uint64_t pmap_wired_pages_freed = pmap_release_pages_fast();
 
+	/*
+	 * Pages batched up on the per-cpu local queues aren't visible
+	 * to the scan or counted as active until they're transferred,
+	 * so push them all to the global active queue first.
+	 */
+	if (vm_page_local_q) {
+		uint32_t lid;
+
+		for (lid = 0; lid < vm_page_local_q_count; lid++)
+			vm_page_reactivate_local(lid, TRUE, FALSE);
+	}
+
 	vm_page_lock_queues();
 
 	vm_page_wire_count -= pmap_wired_pages_freed;
@@ -2031,6 +2061,8 @@ return_from_scan:
 #endif /* VM_PRESSURE_EVENTS */
 
 		if (available_for_purge || force_purge) {
+			unsigned int	purge_target = 1;
+			int		purged_count;
 
 		        if (object != NULL) {
 			        vm_object_unlock(object);
@@ -2039,9 +2071,17 @@ return_from_scan:
 
 			memoryshot(VM_PAGEOUT_PURGEONE, DBG_FUNC_START);
 
+			/*
+			 * under memory pressure, keep purging until the free
+			 * target is met rather than one object per pass, so
+			 * that lots of small purgeable objects go quickly
+			 */
+			if (force_purge && vm_page_free_count < vm_page_free_target)
+				purge_target = vm_page_free_target - vm_page_free_count;
+
 			VM_DEBUG_EVENT(vm_pageout_purgeone, VM_PAGEOUT_PURGEONE, DBG_FUNC_START, vm_page_free_count, 0, 0, 0);
-			if (vm_purgeable_object_purge_one(force_purge, C_DONT_BLOCK)) {
-			        VM_PAGEOUT_DEBUG(vm_pageout_purged_objects, 1);
+			if ((purged_count = vm_purgeable_object_purge_batch(force_purge, C_DONT_BLOCK, purge_target))) {
+			        VM_PAGEOUT_DEBUG(vm_pageout_purged_objects, purged_count);
 				VM_DEBUG_EVENT(vm_pageout_purgeone, VM_PAGEOUT_PURGEONE, DBG_FUNC_END, vm_page_free_count, 0, 0, 0);
 				memoryshot(VM_PAGEOUT_PURGEONE, DBG_FUNC_END);
 				continue;
@@ -3308,6 +3348,7 @@ vm_pageout_continue(void)
 	lck_mtx_unlock(&vm_page_queue_free_lock);
 #endif /* CONFIG_EMBEDDED */
 
+	vm_page_prezero_drain();
 	vm_pageout_scan();
 	/*
 	 * we hold both the vm_page_queue_free_lock
@@ -3934,6 +3975,102 @@ extern unsigned int 	memorystatus_level;
 
 boolean_t vm_pressure_events_enabled = FALSE;
 
+/*
+ * Memory pressure forecast: available memory is sampled from
+ * vm_pressure_response() and its rate of change smoothed, along with
+ * the rate of compressor working set refaults.  If, at the current
+ * trend, available memory would reach the critical threshold within
+ * vm_pressure_forecast_horizon_secs, pressure is raised to warning
+ * early so that clients get notified, and purgeable memory purged,
+ * while there is still time, rather than once the compressor thrashes.
+ * A horizon of 0 disables the forecast.
+ */
+#define VM_PRESSURE_FORECAST_SAMPLE_MSECS	250
+
+uint32_t	vm_pressure_forecast_horizon_secs = 5;
+int64_t		vm_pressure_forecast_trend = 0;		/* available pages per second */
+uint32_t	vm_pressure_forecast_secs_to_critical = UINT32_MAX;
+uint32_t	vm_pressure_forecast_refault_rate = 0;	/* working set refaults per second */
+uint32_t	vm_pressure_forecast_early_warnings = 0;
+uint64_t	vm_pressure_forecast_available_pages = 0;	/* at the last sample */
+uint64_t	vm_pressure_forecast_critical_pages = 0;
+
+static uint64_t	vm_pressure_forecast_last_ts = 0;
+static uint64_t	vm_pressure_forecast_last_available = 0;
+static uint64_t	vm_pressure_forecast_last_refaults = 0;
+
+extern uint64_t	vm_compressor_refaults_workingset;
+
+static uint64_t
+vm_pressure_forecast_available(void)
+{
+	if (VM_CONFIG_COMPRESSOR_IS_ACTIVE)
+		return ((uint64_t) AVAILABLE_NON_COMPRESSED_MEMORY);
+	return ((uint64_t) memorystatus_available_pages);
+}
+
+static uint64_t
+vm_pressure_forecast_critical(void)
+{
+	if (VM_CONFIG_COMPRESSOR_IS_ACTIVE)
+		return ((12 * VM_PAGE_COMPRESSOR_SWAP_UNTHROTTLE_THRESHOLD) / 10);
+	return ((uint64_t) memorystatus_available_pages_critical);
+}
+
+static void
+vm_pressure_forecast_update(void)
+{
+	uint64_t	now, elapsed_ns;
+	uint64_t	available, critical, refaults;
+	int64_t		rate;
+
+	now = mach_absolute_time();
+	available = vm_pressure_forecast_available();
+	refaults = vm_compressor_refaults_workingset;
+
+	if (vm_pressure_forecast_last_ts == 0) {
+		vm_pressure_forecast_last_ts = now;
+		vm_pressure_forecast_last_available = available;
+		vm_pressure_forecast_last_refaults = refaults;
+		return;
+	}
+	absolutetime_to_nanoseconds(now - vm_pressure_forecast_last_ts, &elapsed_ns);
+
+	if (elapsed_ns < VM_PRESSURE_FORECAST_SAMPLE_MSECS * NSEC_PER_MSEC)
+		return;
+
+	rate = (((int64_t)available - (int64_t)vm_pressure_forecast_last_available) * (int64_t)NSEC_PER_SEC) / (int64_t)elapsed_ns;
+	vm_pressure_forecast_trend = (3 * vm_pressure_forecast_trend + rate) / 4;
+	vm_pressure_forecast_refault_rate = (uint32_t)(((refaults - vm_pressure_forecast_last_refaults) * NSEC_PER_SEC) / elapsed_ns);
+
+	vm_pressure_forecast_last_ts = now;
+	vm_pressure_forecast_last_available = available;
+	vm_pressure_forecast_last_refaults = refaults;
+
+	critical = vm_pressure_forecast_critical();
+
+	vm_pressure_forecast_available_pages = available;
+	vm_pressure_forecast_critical_pages = critical;
+
+	if (available <= critical)
+		vm_pressure_forecast_secs_to_critical = 0;
+	else if (vm_pressure_forecast_trend >= 0)
+		vm_pressure_forecast_secs_to_critical = UINT32_MAX;
+	else
+		vm_pressure_forecast_secs_to_critical = (uint32_t) MIN((available - critical) / (uint64_t)(-vm_pressure_forecast_trend), UINT32_MAX);
+}
+
+/*
+ * TRUE if available memory is on course to reach the critical
+ * threshold within the forecast horizon.
+ */
+static boolean_t
+vm_pressure_forecast_imminent(void)
+{
+	return (vm_pressure_forecast_horizon_secs != 0 &&
+		vm_pressure_forecast_secs_to_critical < vm_pressure_forecast_horizon_secs);
+}
+
 void
 vm_pressure_response(void)
 {
@@ -3963,6 +4100,8 @@ vm_pressure_response(void)
 #endif /* CONFIG_SECLUDED_MEMORY */
 	memorystatus_level = (unsigned int) ((available_memory * 100) / total_pages);
 
+	vm_pressure_forecast_update();
+
 	if (memorystatus_manual_testing_on) {
 		return;
 	}
@@ -4392,6 +4531,7 @@ vm_pageout(void)
 #endif
 
 	vm_object_reaper_init();
+	vm_page_prezero_init();
 
 
 	bzero(&vm_config, sizeof(vm_config));
@@ -4498,6 +4638,7 @@ vm_pageout_internal_start(void)
 {
 	kern_return_t	result;
 	int		i;
+	int		threads_per_core = 0;
 	host_basic_info_data_t hinfo;
 
 	assert (VM_CONFIG_COMPRESSOR_IS_PRESENT);
@@ -4519,6 +4660,18 @@ vm_pageout_internal_start(void)
 	PE_parse_boot_argn("vmcomp_threads", &vm_pageout_state.vm_compressor_thread_count,
 			   sizeof(vm_pageout_state.vm_compressor_thread_count));
 
+	/*
+	 * vmcomp_threads_per_core=1 runs one compressor worker per physical
+	 * core so that compression throughput scales with the machine when
+	 * memory pressure spikes... each worker fills its own c_seg, so the
+	 * workers only meet on the pageout queue and the c_list_lock
+	 * (capped below at max_cpus - 1 and MAX_COMPRESSOR_THREAD_COUNT)
+	 */
+	PE_parse_boot_argn("vmcomp_threads_per_core", &threads_per_core, sizeof(threads_per_core));
+
+	if (threads_per_core)
+		vm_pageout_state.vm_compressor_thread_count = hinfo.physical_cpu;
+
 	if (vm_pageout_state.vm_compressor_thread_count >= hinfo.max_cpus)
 		vm_pageout_state.vm_compressor_thread_count = hinfo.max_cpus - 1;
 	if (vm_pageout_state.vm_compressor_thread_count <= 0)
@@ -9777,10 +9930,15 @@ int  upl_ubc_alias_get(upl_t upl, uintptr_t * al, uintptr_t * al2)
  * Upward trajectory.
  */
 extern boolean_t vm_compressor_low_on_space(void);
+extern boolean_t vm_compressor_workingset_thrashing;
 
 boolean_t
 VM_PRESSURE_NORMAL_TO_WARNING(void)	{
 
+	if (vm_pressure_forecast_imminent()) {
+		vm_pressure_forecast_early_warnings++;
+		return TRUE;
+	}
 	if ( !VM_CONFIG_COMPRESSOR_IS_ACTIVE) {
 
 		/* Available pages below our threshold */
@@ -9796,6 +9954,8 @@ VM_PRESSURE_NORMAL_TO_WARNING(void)	{
 		return FALSE;
 
 	} else {
+		if (vm_compressor_workingset_thrashing)
+			return TRUE;
 		return ((AVAILABLE_NON_COMPRESSED_MEMORY < VM_PAGE_COMPRESSOR_COMPACT_THRESHOLD) ? 1 : 0);
 	}
 }
@@ -9821,6 +9981,9 @@ VM_PRESSURE_WARNING_TO_CRITICAL(void) {
 boolean_t
 VM_PRESSURE_WARNING_TO_NORMAL(void) {
 
+	if (vm_pressure_forecast_imminent())
+		return FALSE;
+
 	if ( !VM_CONFIG_COMPRESSOR_IS_ACTIVE) {
 
 		/* Available pages above our threshold */
@@ -9830,6 +9993,8 @@ VM_PRESSURE_WARNING_TO_NORMAL(void) {
 		}
 		return FALSE;
 	} else {
+		if (vm_compressor_workingset_thrashing)
+			return FALSE;
 		return ((AVAILABLE_NON_COMPRESSED_MEMORY > ((12 * VM_PAGE_COMPRESSOR_COMPACT_THRESHOLD) / 10)) ? 1 : 0);
 	}
 }
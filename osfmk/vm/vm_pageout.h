@@ -747,7 +747,27 @@ extern struct vm_pageout_debug vm_pageout_debug;
 #define VM_PAGEOUT_DEBUG(member, value)
 #endif
 
-#define MAX_COMPRESSOR_THREAD_COUNT      8
+#define MAX_COMPRESSOR_THREAD_COUNT      32
+
+/*
+ * Per compressor worker counters.  Each worker owns the c_segs it fills,
+ * so compressions are charged to the filling worker and decompressions
+ * to the worker that filled the segment the data lives in.  Segments
+ * filled outside of the compressor threads (freezer, compaction,
+ * swapin) are charged to the VM_COMPRESSOR_WORKER_OTHER slot.
+ */
+#define VM_COMPRESSOR_WORKER_OTHER       MAX_COMPRESSOR_THREAD_COUNT
+
+typedef struct vmcw_stats_s {
+	uint64_t vmcw_compressions;
+	uint64_t vmcw_compressed_bytes;
+	uint64_t vmcw_decompressions;
+	uint64_t vmcw_segments_filled;
+} __attribute__((aligned(64))) vmcw_stats_t;
+
+extern vmcw_stats_t vm_compressor_worker_stats[MAX_COMPRESSOR_THREAD_COUNT + 1];
+
+extern int vm_pageout_compressor_worker_id(void **current_chead);
 
 #if DEVELOPMENT || DEBUG
 typedef struct vmct_stats_s {
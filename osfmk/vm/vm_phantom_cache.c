@@ -64,6 +64,20 @@ uint32_t	sample_period_ghost_added_count_ssd = 0;
 uint32_t	sample_period_ghost_found_count = 0;
 uint32_t	sample_period_ghost_found_count_ssd = 0;
 
+/*
+ * Refault distance: the ghost ring is filled in eviction order, so the
+ * number of entries added since a ghost was created approximates how
+ * many file pages were evicted between this page's eviction and its
+ * refault.  A page that comes back within fewer evictions than there
+ * are pageable file pages would have stayed resident had it been
+ * considered part of the working set, so it is given its reference
+ * bit back and survives the next pass of the inactive queue.
+ */
+uint32_t	phantom_cache_workingset_activate = 1;
+uint64_t	phantom_cache_refaults = 0;
+uint64_t	phantom_cache_refaults_workingset = 0;
+uint64_t	phantom_cache_refault_distance = 0;	/* sum, in ghost entries */
+
 uint32_t	vm_phantom_object_id = 1;
 #define		VM_PHANTOM_OBJECT_ID_AFTER_WRAP	1000000
 
@@ -320,12 +334,29 @@ vm_phantom_cache_update(vm_page_t m)
 	pg_mask = pg_masks[(m->vmp_offset >> PAGE_SHIFT) & VM_GHOST_PAGE_MASK];
 	
 	if ( (vpce = vm_phantom_cache_lookup_ghost(m, pg_mask)) ) {
+		uint32_t	ghost_index, distance;
 
 		vpce->g_pages_held &= ~pg_mask;
 
 		phantom_cache_stats.pcs_updated_phantom_state++;
 		vm_pageout_vminfo.vm_phantom_cache_found_ghost++;
 
+		/* ring slots run from 1 to vm_phantom_cache_num_entries - 1 */
+		ghost_index = (uint32_t)(vpce - vm_phantom_cache);
+		if (vm_phantom_cache_nindx >= ghost_index)
+			distance = vm_phantom_cache_nindx - ghost_index;
+		else
+			distance = vm_phantom_cache_nindx + (vm_phantom_cache_num_entries - 1) - ghost_index;
+
+		phantom_cache_refaults++;
+		phantom_cache_refault_distance += distance;
+
+		if (distance < vm_page_pageable_external_count) {
+			phantom_cache_refaults_workingset++;
+			if (phantom_cache_workingset_activate)
+				m->vmp_reference = TRUE;
+		}
+
 		if (object->phantom_isssd)
 			OSAddAtomic(1, &sample_period_ghost_found_count_ssd);
 		else
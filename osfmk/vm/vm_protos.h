@@ -630,6 +630,14 @@ extern void 		memory_object_mark_eligible_for_secluded(
 
 #define MAX_PAGE_RANGE_QUERY	(1ULL * 1024 * 1024 * 1024) /* 1 GB */
 
+extern int vm_map_transparent_superpage_flags(
+	vm_map_t		map,
+	vm_map_size_t		size,
+	int			flags);
+extern void vm_map_transparent_superpage_result(
+	vm_map_size_t		size,
+	kern_return_t		kr);
+
 extern kern_return_t mach_make_memory_entry_internal(
 	vm_map_t		target_map,
 	memory_object_size_t	*size,
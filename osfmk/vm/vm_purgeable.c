@@ -80,6 +80,14 @@ int             available_for_purge = 0;	/* increase when ripe token
 static int token_q_allocating = 0;		/* flag for singlethreading 
 						 * allocator */
 
+/*
+ * upper bound on the number of objects vm_purgeable_object_purge_batch()
+ * purges before handing control back to its caller
+ */
+unsigned int	vm_purgeable_purge_batch_max = 32;
+unsigned int	vm_purgeable_purge_batches = 0;
+unsigned int	vm_purgeable_purge_batch_objects = 0;
+
 struct purgeable_q purgeable_queues[PURGEABLE_Q_TYPE_MAX];
 queue_head_t purgeable_nonvolatile_queue;
 int purgeable_nonvolatile_count;
@@ -1019,6 +1027,42 @@ purge_now:
 	return TRUE;
 }
 
+/*
+ * Purge eligible objects, in the order vm_purgeable_object_purge_one()
+ * picks them, until at least "target_pages" resident pages have been
+ * reclaimed or vm_purgeable_purge_batch_max objects have been purged.
+ * Lets a caller that is short on memory get through many small
+ * purgeable objects in one go instead of coming back for each one.
+ * Returns the number of objects purged.
+ * Called with the page queue lock held.
+ */
+int
+vm_purgeable_object_purge_batch(
+	int		force_purge_below_group,
+	int		flags,
+	unsigned int	target_pages)
+{
+	unsigned long	pages_purged_start;
+	int		purged_count = 0;
+
+	LCK_MTX_ASSERT(&vm_page_queue_lock, LCK_MTX_ASSERT_OWNED);
+
+	pages_purged_start = vm_pageout_vminfo.vm_pageout_pages_purged;
+
+	do {
+		if (!vm_purgeable_object_purge_one(force_purge_below_group, flags))
+			break;
+		purged_count++;
+	} while ((unsigned int)purged_count < vm_purgeable_purge_batch_max &&
+		 vm_pageout_vminfo.vm_pageout_pages_purged - pages_purged_start < target_pages);
+
+	if (purged_count > 1) {
+		vm_purgeable_purge_batches++;
+		vm_purgeable_purge_batch_objects += purged_count;
+	}
+	return purged_count;
+}
+
 /* Called with object lock held */
 void
 vm_purgeable_object_add(vm_object_t object, purgeable_q_t queue, int group)
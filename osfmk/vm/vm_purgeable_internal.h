@@ -102,6 +102,10 @@ void vm_purgeable_q_advance_all(void);
 /* returns TRUE if an object was purged, otherwise FALSE. */
 boolean_t vm_purgeable_object_purge_one(int force_purge_below_group, int flags);
 
+/* purges eligible objects until target_pages pages have been reclaimed. */
+/* returns the number of objects purged. */
+int vm_purgeable_object_purge_batch(int force_purge_below_group, int flags, unsigned int target_pages);
+
 /* purge all volatile objects now */
 void vm_purgeable_object_purge_all(void);
 
@@ -300,6 +300,8 @@ unsigned int	vm_colors;
 unsigned int    vm_color_mask;			/* mask is == (vm_colors-1) */
 unsigned int	vm_cache_geometry_colors = 0;	/* set by hw dependent code during startup */
 unsigned int	vm_free_magazine_refill_limit = 0;
+uint64_t	vm_free_magazine_refills = 0;		/* per-cpu free lists refilled from the global queues */
+uint64_t	vm_free_magazine_refill_pages = 0;	/* pages moved by those refills */
 
 
 struct vm_page_queue_free_head {
@@ -736,6 +738,7 @@ vm_page_bootstrap(
 	m->vmp_reusable = FALSE;
 	m->vmp_xpmapped = FALSE;
 	m->vmp_written_by_kernel = FALSE;
+	m->vmp_zeroed = FALSE;
 	m->vmp_unused_object_bits = 0;
 
 	/*
@@ -2780,6 +2783,156 @@ vm_page_grab(void)
 	return vm_page_grab_options(0);
 }
 
+/*
+ * Pre-zeroed page pool.
+ *
+ * While free memory is plentiful, a thread running at throttled
+ * priority (so only on otherwise idle cores) zeroes free pages ahead
+ * of time.  Zero-fill faults ask for one with VM_PAGE_GRAB_ZEROED and
+ * skip vm_page_zero_fill() when they get it.  Pooled pages are off all
+ * the queues, busy and marked vmp_zeroed; the pageout daemon returns
+ * them to the free list before it starts a scan.
+ */
+#if CONFIG_EMBEDDED
+unsigned int	vm_page_prezero_max = 256;
+#else
+unsigned int	vm_page_prezero_max = 1024;
+#endif
+unsigned int	vm_page_prezero_count = 0;
+uint64_t	vm_page_prezero_hits = 0;
+uint64_t	vm_page_prezero_misses = 0;
+uint64_t	vm_page_prezero_zeroed = 0;
+uint64_t	vm_page_prezero_drained = 0;
+
+static vm_page_t	vm_page_prezero_list = VM_PAGE_NULL;
+static boolean_t	vm_page_prezero_inited = FALSE;
+static boolean_t	vm_page_prezero_running = FALSE;
+decl_lck_mtx_data(static, vm_page_prezero_lock);
+
+static void vm_page_prezero_thread(void);
+
+#define VM_PAGE_PREZERO_CAN_FILL()					\
+	(vm_page_prezero_count < vm_page_prezero_max &&			\
+	 vm_page_free_count > vm_page_free_target + vm_page_prezero_max)
+
+static void
+vm_page_prezero_wakeup(void)
+{
+	if (!vm_page_prezero_running && VM_PAGE_PREZERO_CAN_FILL())
+		thread_wakeup((event_t)&vm_page_prezero_list);
+}
+
+static vm_page_t
+vm_page_prezero_get(void)
+{
+	vm_page_t	mem = VM_PAGE_NULL;
+
+	if (vm_page_prezero_count != 0) {
+		lck_mtx_lock_spin(&vm_page_prezero_lock);
+		if ((mem = vm_page_prezero_list) != VM_PAGE_NULL) {
+			vm_page_prezero_list = mem->vmp_snext;
+			vm_page_prezero_count--;
+		}
+		lck_mtx_unlock(&vm_page_prezero_lock);
+	}
+	if (mem == VM_PAGE_NULL) {
+		OSIncrementAtomic64((SInt64 *)&vm_page_prezero_misses);
+		vm_page_prezero_wakeup();
+		return VM_PAGE_NULL;
+	}
+	OSIncrementAtomic64((SInt64 *)&vm_page_prezero_hits);
+	if (vm_page_prezero_count < vm_page_prezero_max / 2)
+		vm_page_prezero_wakeup();
+
+	VM_PAGE_ZERO_PAGEQ_ENTRY(mem);
+	assert(mem->vmp_q_state == VM_PAGE_NOT_ON_Q);
+	assert(mem->vmp_zeroed);
+	assert(mem->vmp_busy);
+	assert(!mem->vmp_pmapped);
+
+	disable_preemption();
+	PROCESSOR_DATA(current_processor(), page_grab_count) += 1;
+	enable_preemption();
+#if CONFIG_BACKGROUND_QUEUE
+	vm_page_assign_background_state(mem);
+#endif
+	return mem;
+}
+
+static void
+vm_page_prezero_thread(void)
+{
+	vm_page_t	mem;
+
+	vm_page_prezero_running = TRUE;
+
+	while (VM_PAGE_PREZERO_CAN_FILL()) {
+		if ((mem = vm_page_grab()) == VM_PAGE_NULL)
+			break;
+		pmap_zero_page(VM_PAGE_GET_PHYS_PAGE(mem));
+		mem->vmp_zeroed = TRUE;
+
+		lck_mtx_lock_spin(&vm_page_prezero_lock);
+		mem->vmp_snext = vm_page_prezero_list;
+		vm_page_prezero_list = mem;
+		vm_page_prezero_count++;
+		lck_mtx_unlock(&vm_page_prezero_lock);
+		vm_page_prezero_zeroed++;
+	}
+	vm_page_prezero_running = FALSE;
+
+	assert_wait((event_t)&vm_page_prezero_list, THREAD_UNINT);
+	thread_block((thread_continue_t)vm_page_prezero_thread);
+	/*NOTREACHED*/
+}
+
+void
+vm_page_prezero_init(void)
+{
+	kern_return_t	result;
+	thread_t	thread;
+
+	lck_mtx_init(&vm_page_prezero_lock, &vm_page_lck_grp_free, &vm_page_lck_attr);
+	vm_page_prezero_inited = TRUE;
+
+	result = kernel_thread_start_priority((thread_continue_t)vm_page_prezero_thread,
+					      NULL, MAXPRI_THROTTLE, &thread);
+	if (result != KERN_SUCCESS)
+		panic("vm_page_prezero_thread: create failed");
+
+	thread_set_thread_name(thread, "VM_prezero");
+	thread_deallocate(thread);
+}
+
+/*
+ * Give the pooled pages back to the free list: called by the pageout
+ * daemon, the pool must not hold on to memory the system is short of.
+ */
+void
+vm_page_prezero_drain(void)
+{
+	vm_page_t	mem, list;
+	unsigned int	count;
+
+	if (!vm_page_prezero_inited || vm_page_prezero_count == 0)
+		return;
+
+	lck_mtx_lock_spin(&vm_page_prezero_lock);
+	list = vm_page_prezero_list;
+	count = vm_page_prezero_count;
+	vm_page_prezero_list = VM_PAGE_NULL;
+	vm_page_prezero_count = 0;
+	lck_mtx_unlock(&vm_page_prezero_lock);
+
+	while ((mem = list) != VM_PAGE_NULL) {
+		list = mem->vmp_snext;
+		VM_PAGE_ZERO_PAGEQ_ENTRY(mem);
+		mem->vmp_zeroed = FALSE;
+		vm_page_release(mem, FALSE);
+	}
+	OSAddAtomic64(count, (SInt64 *)&vm_page_prezero_drained);
+}
+
 #if HIBERNATION
 boolean_t       hibernate_rebuild_needed = FALSE;
 #endif /* HIBERNATION */
@@ -2790,6 +2943,11 @@ vm_page_grab_options(
 {
 	vm_page_t	mem;
 
+	if ((grab_options & VM_PAGE_GRAB_ZEROED) && vm_page_prezero_inited &&
+	    (mem = vm_page_prezero_get()) != VM_PAGE_NULL) {
+		VM_DEBUG_EVENT(vm_page_grab, VM_PAGE_GRAB, DBG_FUNC_NONE, grab_options, 0, 0, 0);
+		return mem;
+	}
 	disable_preemption();
 
 	if ((mem = PROCESSOR_DATA(current_processor(), free_pages))) {
@@ -2925,6 +3083,8 @@ return_page_from_cpu_list:
 		color = PROCESSOR_DATA(current_processor(), start_color);
 		head = tail = NULL;
 
+		vm_free_magazine_refills++;
+		vm_free_magazine_refill_pages += pages_to_steal;
 		vm_page_free_count -= pages_to_steal;
 		clump_end = sub_count = 0;
 
@@ -8904,6 +9064,8 @@ process_account(mach_memory_info_t * info, unsigned int num_info, uint64_t zones
 	}
 	lck_spin_unlock(&vm_allocation_sites_lock);
 
+	(void) kalloc_profile_diagnose(info, nextinfo, num_info);
+
     return (0);
 }
 
@@ -8935,6 +9097,7 @@ vm_page_diagnose_estimate(void)
     /* some slop for new tags created */
     count += 8;
     count += VM_KERN_COUNTER_COUNT;
+    count += kalloc_profile_estimate();
 
     return (count);
 }
@@ -158,6 +158,7 @@ mach_vm_allocate_kernel(
 	vm_map_size_t	map_size;
 	kern_return_t	result;
 	boolean_t	anywhere;
+	int		superpage_flags;
 
 	/* filter out any kernel-only flags */
 	if (flags & ~VM_FLAGS_USER_ALLOCATE)
@@ -194,6 +195,31 @@ mach_vm_allocate_kernel(
 	  return(KERN_INVALID_ARGUMENT);
 	}
 
+	superpage_flags = vm_map_transparent_superpage_flags(map, map_size, flags);
+	if (superpage_flags) {
+		vm_map_offset_t sp_addr = map_addr;
+
+		result = vm_map_enter(
+				map,
+				&sp_addr,
+				map_size,
+				(vm_map_offset_t)0,
+				flags | superpage_flags,
+				VM_MAP_KERNEL_FLAGS_NONE,
+				tag,
+				VM_OBJECT_NULL,
+				(vm_object_offset_t)0,
+				FALSE,
+				VM_PROT_DEFAULT,
+				VM_PROT_ALL,
+				VM_INHERIT_DEFAULT);
+		vm_map_transparent_superpage_result(map_size, result);
+		if (result == KERN_SUCCESS) {
+			*addr = sp_addr;
+			return(result);
+		}
+	}
+
 	result = vm_map_enter(
 			map,
 			&map_addr,
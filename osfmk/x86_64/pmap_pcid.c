@@ -38,19 +38,26 @@
  * PCID (Process context identifier) aka tagged TLB support.
  * On processors with this feature, unless disabled via the -pmap_pcid_disable
  * boot-arg, the following algorithm is in effect:
- * Each processor maintains an array of tag refcounts indexed by tag.
+ * Each processor maintains an array of tag owners indexed by tag.
  * Each address space maintains an array of tags indexed by CPU number.
  * Each address space maintains a coherency vector, indexed by CPU
  * indicating that the TLB state for that address space has a pending
  * invalidation.
- * On a context switch, a refcounted tag is lazily assigned to the newly
- * dispatched (CPU, address space) tuple.
+ * On a context switch, a tag is lazily assigned to the newly
+ * dispatched (CPU, address space) tuple, and the address space keeps that
+ * tag for as long as the processor records it as the tag's owner.
  * When an inactive address space is invalidated on a remote CPU, it is marked
  * for invalidation upon the next dispatch. Some invalidations are
  * also processed at the user/kernel boundary.
  * Provisions are made for the case where a CPU is overcommmitted, i.e.
  * more active address spaces exist than the number of logical tags
- * provided for by the processor architecture (currently 4096).
+ * provided for by the processor architecture (currently 4096, split
+ * between the kernel and user halves of each address space): free tags
+ * are used first, then tags are taken back round-robin from their
+ * owners, oldest assignment first.  A recycled tag is flushed once when
+ * it is handed to its new owner, and the previous owner notices it lost
+ * the tag on its next dispatch.  Address spaces sharing a tag would
+ * instead flush on every switch between them.
  * The algorithm assumes the processor remaps the logical tags
  * to physical TLB context IDs in an LRU fashion for efficiency. (DRK '10)
  */
@@ -136,7 +143,8 @@ void	pmap_pcid_configure(void) {
 		    cpu_datap(ccpu)->cpu_pmap_pcid_coherentp_kernel =
 		    &(kernel_pmap->pmap_pcid_coherency_vector[ccpu]);
 		cpu_datap(ccpu)->cpu_pcid_data = &pcid_data[ccpu];
-		cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_refcounts[0] = 1;
+		cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_last_pmap_dispatched[0] = kernel_pmap;
+		cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_next = PMAP_PCID_MIN_PCID;
 	}
 }
 
@@ -165,74 +173,56 @@ void pmap_pcid_initialize_kernel(pmap_t p) {
 	}
 }
 
+/*
+ * Pick a tag for an address space about to be dispatched on "ccpu" for
+ * the first time, or since it lost its previous tag; the caller records
+ * the address space as the tag's owner and flushes the tag.  Runs on
+ * "ccpu" with preemption disabled.
+ */
 pcid_t	pmap_pcid_allocate_pcid(int ccpu) {
-	int i;
-	pcid_ref_t 	cur_min = 0xFF;
-	uint32_t	cur_min_index = ~1;
-	pcid_ref_t	*cpu_pcid_refcounts = &cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_refcounts[0];
-	pcid_ref_t	old_count;
-
-	if ((i = cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_free_hint) != 0) {
-		if (cpu_pcid_refcounts[i] == 0) {
-			(void)__sync_fetch_and_add(&cpu_pcid_refcounts[i], 1);
-			cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_free_hint = 0;
-			return i;
-		}
-	}
-	/* Linear scan to discover free slot, with hint. Room for optimization
-	 * but with intelligent prefetchers this should be
-	 * adequately performant, as it is invoked
-	 * only on first dispatch of a new address space onto
-	 * a given processor. DRKTODO: use larger loads and
-	 * zero byte discovery -- any pattern != ~1 should
-	 * signify a free slot.
-	 */
-	for (i = PMAP_PCID_MIN_PCID; i < PMAP_PCID_MAX_PCID; i++) {
-		pcid_ref_t cur_refcount = cpu_pcid_refcounts[i];
+	pcid_cdata_t	*pcdata = cpu_datap(ccpu)->cpu_pcid_data;
+	pmap_t		owner;
+	pcid_t		i;
 
-		pmap_assert(cur_refcount < PMAP_PCID_MAX_REFCOUNT);
+	pcdata->cpu_pcid_allocations++;
 
-		if (cur_refcount == 0) {
-			(void)__sync_fetch_and_add(&cpu_pcid_refcounts[i], 1);
+	if ((i = pcdata->cpu_pcid_free_hint) != 0) {
+		pcdata->cpu_pcid_free_hint = 0;
+		owner = pcdata->cpu_pcid_last_pmap_dispatched[i];
+		if (owner == PMAP_NULL || owner == PMAP_INVALID)
 			return i;
-		} else {
-			if (cur_refcount < cur_min) {
-				cur_min_index = i;
-				cur_min = cur_refcount;
-			}
-		}
 	}
-	pmap_assert(cur_min_index > 0 && cur_min_index < PMAP_PCID_MAX_PCID);
-	/* Consider "rebalancing" tags actively in highly oversubscribed cases
-	 * perhaps selecting tags with lower activity.
+	/* Otherwise take the next tag round-robin, i.e. the one assigned
+	 * longest ago; its owner, if still alive, gets a new tag on its next
+	 * dispatch here.
 	 */
+	i = pcdata->cpu_pcid_next;
+	pmap_assert(i >= PMAP_PCID_MIN_PCID && i < PMAP_PCID_MAX_PCID);
+
+	pcdata->cpu_pcid_next = (i + 1 < PMAP_PCID_MAX_PCID) ? i + 1 : PMAP_PCID_MIN_PCID;
 
-	old_count = __sync_fetch_and_add(&cpu_pcid_refcounts[cur_min_index], 1);
-	pmap_assert(old_count < PMAP_PCID_MAX_REFCOUNT);
-	return (cur_min_index);
+	owner = pcdata->cpu_pcid_last_pmap_dispatched[i];
+	if (owner != PMAP_NULL && owner != PMAP_INVALID)
+		pcdata->cpu_pcid_recycles++;
+
+	return (i);
 }
 
 void	pmap_pcid_deallocate_pcid(int ccpu, pmap_t tpmap) {
 	pcid_t pcid;
-	pmap_t lp;
-	pcid_ref_t prior_count;
 
 	pcid = tpmap->pmap_pcid_cpus[ccpu];
 	pmap_assert(pcid != PMAP_PCID_INVALID_PCID);
 	if (pcid == PMAP_PCID_INVALID_PCID)
 		return;
 
-	lp = cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_last_pmap_dispatched[pcid];
 	pmap_assert(pcid > 0 && pcid < PMAP_PCID_MAX_PCID);
-	pmap_assert(cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_refcounts[pcid] >= 1);
-
-	if (lp == tpmap)
-		(void)__sync_bool_compare_and_swap(&cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_last_pmap_dispatched[pcid], tpmap, PMAP_INVALID);
 
-	if ((prior_count = __sync_fetch_and_sub(&cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_refcounts[pcid], 1)) == 1) {
-		    cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_free_hint = pcid;
-	}
-	pmap_assert(prior_count <= PMAP_PCID_MAX_REFCOUNT);
+	/* The tag may have been recycled already, so only give it up
+	 * if we still own it.
+	 */
+	if (__sync_bool_compare_and_swap(&cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_last_pmap_dispatched[pcid], tpmap, PMAP_INVALID))
+		cpu_datap(ccpu)->cpu_pcid_data->cpu_pcid_free_hint = pcid;
 }
 
 void	pmap_destroy_pcid_sync(pmap_t p) {
@@ -263,13 +253,15 @@ uint64_t pcid_record_array[PCID_RECORD_SIZE];
 
 void	pmap_pcid_activate(pmap_t tpmap, int ccpu, boolean_t nopagezero, boolean_t copyio) {
 	pcid_t		new_pcid = tpmap->pmap_pcid_cpus[ccpu];
-	pmap_t		last_pmap;
 	boolean_t	pcid_conflict = FALSE, pending_flush = FALSE;
 	pcid_cdata_t	*pcdata = cpu_datap(ccpu)->cpu_pcid_data;
 
 	pmap_assert(cpu_datap(ccpu)->cpu_pmap_pcid_enabled);
-	if (__improbable(new_pcid == PMAP_PCID_INVALID_PCID)) {
+	if (__improbable(new_pcid == PMAP_PCID_INVALID_PCID ||
+	    (tpmap != kernel_pmap && pcdata->cpu_pcid_last_pmap_dispatched[new_pcid] != tpmap))) {
+		/* first dispatch here, or our tag was recycled */
 		new_pcid = tpmap->pmap_pcid_cpus[ccpu] = pmap_pcid_allocate_pcid(ccpu);
+		pcid_conflict = TRUE;
 	}
 
 	pmap_assert(new_pcid != PMAP_PCID_INVALID_PCID);
@@ -279,10 +271,6 @@ void	pmap_pcid_activate(pmap_t tpmap, int ccpu, boolean_t nopagezero, boolean_t
 	cpu_datap(ccpu)->cpu_active_pcid = new_pcid;
 
 	pending_flush = (tpmap->pmap_pcid_coherency_vector[ccpu] != 0);
-	if (__probable(pending_flush == FALSE)) {
-		last_pmap = pcdata->cpu_pcid_last_pmap_dispatched[new_pcid];
-		pcid_conflict = ((last_pmap != NULL) && (tpmap != last_pmap));
-	}
 	if (__improbable(pending_flush || pcid_conflict)) {
 		pmap_pcid_validate_cpu(tpmap, ccpu);
 	}
@@ -313,6 +301,10 @@ void	pmap_pcid_activate(pmap_t tpmap, int ccpu, boolean_t nopagezero, boolean_t
 	}
 
 	uint64_t preserve = !(pending_flush || pcid_conflict);
+	if (preserve)
+		cpu_datap(ccpu)->cpu_pmap_pcid_preserves++;
+	else
+		cpu_datap(ccpu)->cpu_pmap_pcid_flushes++;
 	set_cr3_composed(ncr3, new_pcid, preserve);
 #if DEBUG
 	cpu_datap(ccpu)->cpu_pcid_last_cr3 = ncr3 | new_pcid | preserve << 63;
@@ -349,3 +341,20 @@ void	pmap_pcid_activate(pmap_t tpmap, int ccpu, boolean_t nopagezero, boolean_t
 	KERNEL_DEBUG_CONSTANT(0x9c1d0000, tpmap, new_pcid, pending_flush, pcid_conflict, 0);
 #endif
 }
+
+/*
+ * Sum the per-processor tag assignment and recycling counts, and the
+ * TLB flushes taken on dispatch, for sysctl.
+ */
+void	pmap_pcid_stats(uint64_t *allocations, uint64_t *recycles, uint64_t *flushes) {
+	unsigned int i;
+
+	*allocations = *recycles = *flushes = 0;
+	for (i = 0; i < real_ncpus; i++) {
+		if (cpu_datap(i) == NULL || cpu_datap(i)->cpu_pcid_data == NULL)
+			continue;
+		*allocations += cpu_datap(i)->cpu_pcid_data->cpu_pcid_allocations;
+		*recycles += cpu_datap(i)->cpu_pcid_data->cpu_pcid_recycles;
+		*flushes += cpu_datap(i)->cpu_pmap_pcid_flushes;
+	}
+}
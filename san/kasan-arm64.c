@@ -323,8 +323,8 @@ kasan_bootstrap(boot_args *args, vm_offset_t pgtable)
 	kasan_map_shadow_early(excepstack_virt, excepstack_size, false);
 }
 
-bool
-kasan_is_shadow_mapped(uintptr_t shadowp)
+static uint64_t *
+kasan_shadow_pte(uintptr_t shadowp)
 {
 	uint64_t *pte;
 	uint64_t *base = cpu_tte;
@@ -336,7 +336,7 @@ kasan_is_shadow_mapped(uintptr_t shadowp)
 	/* lookup L1 entry */
 	pte = base + ((shadowp & ARM_TT_L1_INDEX_MASK) >> ARM_TT_L1_SHIFT);
 	if (!(*pte & ARM_TTE_VALID)) {
-		return false;
+		return NULL;
 	}
 	base = (uint64_t *)phystokv(*pte & ARM_TTE_TABLE_MASK);
 #endif
@@ -344,15 +344,36 @@ kasan_is_shadow_mapped(uintptr_t shadowp)
 	/* lookup L2 entry */
 	pte = base + ((shadowp & ARM_TT_L2_INDEX_MASK) >> ARM_TT_L2_SHIFT);
 	if (!(*pte & ARM_TTE_VALID)) {
-		return false;
+		return NULL;
 	}
 	base = (uint64_t *)phystokv(*pte & ARM_TTE_TABLE_MASK);
 
 	/* lookup L3 entry */
 	pte = base + ((shadowp & ARM_TT_L3_INDEX_MASK) >> ARM_TT_L3_SHIFT);
 	if (!(*pte & ARM_PTE_TYPE_VALID)) {
+		return NULL;
+	}
+
+	return pte;
+}
+
+bool
+kasan_is_shadow_mapped(uintptr_t shadowp)
+{
+	return kasan_shadow_pte(shadowp) != NULL;
+}
+
+/*
+ * Populated unless kasan_map_shadow() would still have to map it, or upgrade
+ * the read-only zero page to a real one.
+ */
+bool
+kasan_is_shadow_populated(uintptr_t shadowp, bool is_zero)
+{
+	uint64_t *pte = kasan_shadow_pte(shadowp);
+	if (pte == NULL) {
 		return false;
 	}
 
-	return true;
+	return is_zero || (((*pte) & ARM_PTE_APMASK) != ARM_PTE_AP(AP_RONA));
 }
@@ -30,6 +30,7 @@
 #include <string.h>
 #include <vm/vm_map.h>
 #include <kern/assert.h>
+#include <kern/clock.h>
 #include <kern/locks.h>
 #include <kern/kalloc.h>
 #include <kern/simple_lock.h>
@@ -649,6 +650,36 @@ kasan_test(int testno, int fail)
 	printf("KASan: TEST SUMMARY %d/%d passed\n", pass, total);
 }
 
+#define KASAN_BENCH_ITERATIONS 1000
+
+/*
+ * Time kasan_check_range() over a freshly unpoisoned heap buffer, returning the
+ * average cost of one check in nanoseconds.
+ */
+uint64_t
+kasan_bench(vm_size_t size)
+{
+	uint64_t start, elapsed, ns;
+	void *buf;
+	int i;
+
+	buf = kalloc(size);
+	if (!buf) {
+		return 0;
+	}
+
+	start = mach_absolute_time();
+	for (i = 0; i < KASAN_BENCH_ITERATIONS; i++) {
+		kasan_check_range(buf, size, TYPE_MEMR);
+	}
+	elapsed = mach_absolute_time() - start;
+
+	kfree(buf, size);
+
+	absolutetime_to_nanoseconds(elapsed, &ns);
+	return ns / KASAN_BENCH_ITERATIONS;
+}
+
 void
 kasan_handle_test(void)
 {
@@ -374,3 +374,13 @@ kasan_is_shadow_mapped(uintptr_t shadowp)
 
 	return false;
 }
+
+/*
+ * kasan_map_shadow() never upgrades an existing mapping here, so any mapped
+ * shadow page counts as populated.
+ */
+bool
+kasan_is_shadow_populated(uintptr_t shadowp, __unused bool is_zero)
+{
+	return kasan_is_shadow_mapped(shadowp);
+}
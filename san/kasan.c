@@ -184,18 +184,15 @@ kasan_poison(vm_offset_t base, vm_size_t size, vm_size_t leftrz, vm_size_t right
 	/*
 	 * poison the redzones and unpoison the valid bytes
 	 */
-	for (; i < leftrz; i++) {
-		shadow[i] = l_flags;
-	}
-	for (; i < leftrz + size; i++) {
-		shadow[i] = ASAN_VALID; /* XXX: should not be necessary */
-	}
+	__nosan_memset(shadow, l_flags, leftrz);
+	__nosan_memset(shadow + leftrz, ASAN_VALID, size); /* XXX: should not be necessary */
+	i = leftrz + size;
 	if (partial && (i < total)) {
 		shadow[i] = partial;
 		i++;
 	}
-	for (; i < total; i++) {
-		shadow[i] = r_flags;
+	if (i < total) {
+		__nosan_memset(shadow + i, r_flags, total - i);
 	}
 }
 
@@ -540,16 +537,41 @@ kasan_range_poisoned(vm_offset_t base, vm_size_t size, vm_offset_t *first_invali
 	base &= ~(vm_offset_t)0x07;
 
 	shadow = SHADOW_FOR_ADDRESS(base);
-	vm_size_t limit = (size + 7) / 8;
+	vm_size_t full = size / 8;
+	uint8_t partial = size & 0x07;
 
 	/* XXX: to make debugging easier, catch unmapped shadow here */
 
-	for (i = 0; i < limit; i++, size -= 8) {
-		assert(size > 0);
+	/*
+	 * Every granule but a trailing partial one must be fully valid, so check
+	 * those shadow bytes a word (or four) at a time once aligned, and fall
+	 * back to single bytes to find the first bad one.
+	 */
+	for (i = 0; i < full && ((uintptr_t)(shadow + i) & 0x07); i++) {
+		if (shadow[i] != 0) {
+			goto fail;
+		}
+	}
+	for (; i + 32 <= full; i += 32) {
+		const uint64_t *w = (const uint64_t *)(shadow + i);
+		if ((w[0] | w[1] | w[2] | w[3]) != 0) {
+			break;
+		}
+	}
+	for (; i + 8 <= full; i += 8) {
+		if (*(const uint64_t *)(shadow + i) != 0) {
+			break;
+		}
+	}
+	for (; i < full; i++) {
+		if (shadow[i] != 0) {
+			goto fail;
+		}
+	}
+
+	if (partial) {
 		uint8_t s = shadow[i];
-		if (s == 0 || (size < 8 && s >= size && s <= 7)) {
-			/* valid */
-		} else {
+		if (s != 0 && (s < partial || s > 7)) {
 			goto fail;
 		}
 	}
@@ -743,6 +765,27 @@ kasan_init(void)
 	kasan_enabled = 1;
 }
 
+/*
+ * Return true if kasan_map_shadow() would leave the whole shadow of the range
+ * alone. Shadow page tables are only ever added to, so a populated answer can
+ * be trusted without holding kasan_vm_lock.
+ */
+static bool
+kasan_shadow_populated(vm_offset_t address, vm_size_t size, bool is_zero)
+{
+	size = (size + 0x7UL) & ~0x7UL;
+	vm_offset_t shadow_base = vm_map_trunc_page(SHADOW_FOR_ADDRESS(address), HW_PAGE_MASK);
+	vm_offset_t shadow_top = vm_map_round_page(SHADOW_FOR_ADDRESS(address + size), HW_PAGE_MASK);
+
+	for (; shadow_base < shadow_top; shadow_base += HW_PAGE_SIZE) {
+		if (!kasan_is_shadow_populated(shadow_base, is_zero)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static void NOINLINE
 kasan_notify_address_internal(vm_offset_t address, vm_size_t size, bool is_zero)
 {
@@ -762,6 +805,12 @@ kasan_notify_address_internal(vm_offset_t address, vm_size_t size, bool is_zero)
 		return;
 	}
 
+	if (kasan_shadow_populated(address, size, is_zero)) {
+		/* common case: the shadow is already there, don't serialize on the lock */
+		kasan_debug_touch_mappings(address, size);
+		return;
+	}
+
 	boolean_t flags;
 	kasan_lock(&flags);
 	kasan_map_shadow(address, size, is_zero);
@@ -1360,6 +1409,26 @@ sysctl_fakestack_enable(__unused struct sysctl_oid *oidp, __unused void *arg1, i
 	return err;
 }
 
+static uint64_t kasan_bench_ns;
+
+static int
+sysctl_kasan_bench(__unused struct sysctl_oid *oidp, __unused void *arg1, int __unused arg2, struct sysctl_req *req)
+{
+	int size = 0;
+	int ch;
+	int err;
+	err = sysctl_io_number(req, 0, sizeof(int), &size, &ch);
+
+	if (!err && ch) {
+		if (size <= 0 || size > KASAN_BENCH_MAX_SIZE) {
+			return EINVAL;
+		}
+		kasan_bench_ns = kasan_bench((vm_size_t)size);
+	}
+
+	return err;
+}
+
 SYSCTL_DECL(kasan);
 SYSCTL_NODE(_kern, OID_AUTO, kasan, CTLFLAG_RW | CTLFLAG_LOCKED, 0, "");
 
@@ -1388,3 +1457,8 @@ SYSCTL_PROC(_kern_kasan, OID_AUTO, test,
 SYSCTL_PROC(_kern_kasan, OID_AUTO, fail,
 		CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_LOCKED,
 		0, 1, sysctl_kasan_test, "I", "");
+
+SYSCTL_PROC(_kern_kasan, OID_AUTO, bench,
+		CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_LOCKED,
+		0, 0, sysctl_kasan_bench, "I", "");
+SYSCTL_QUAD(_kern_kasan, OID_AUTO, bench_ns, CTLFLAG_RD | CTLFLAG_LOCKED, &kasan_bench_ns, "");
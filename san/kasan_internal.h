@@ -48,6 +48,9 @@ typedef uintptr_t uptr;
 #define QUARANTINE_ENTRIES 5000
 #define QUARANTINE_MAXSIZE MiB(10)
 
+/* largest buffer kern.kasan.bench will time checks over */
+#define KASAN_BENCH_MAX_SIZE MiB(1)
+
 /*
  * The amount of physical memory stolen by KASan at boot to back the shadow memory
  * and page tables. Larger memory systems need to steal proportionally less.
@@ -139,6 +142,7 @@ bool kasan_range_poisoned(vm_offset_t base, vm_size_t size, vm_offset_t *first_i
 void kasan_check_range(const void *x, size_t sz, access_t);
 void kasan_test(int testno, int fail);
 void kasan_handle_test(void);
+uint64_t kasan_bench(vm_size_t size);
 void kasan_free_internal(void **addrp, vm_size_t *sizep, int type, zone_t *, vm_size_t user_size, int locked, bool doquarantine);
 void kasan_poison(vm_offset_t base, vm_size_t size, vm_size_t leftrz, vm_size_t rightrz, uint8_t flags);
 void kasan_lock(boolean_t *b);
@@ -155,6 +159,7 @@ void kasan_dybl_unload_kext(uintptr_t addr);
 /* arch-specific interface */
 void kasan_arch_init(void);
 bool kasan_is_shadow_mapped(uintptr_t shadowp);
+bool kasan_is_shadow_populated(uintptr_t shadowp, bool is_zero);
 
 extern vm_address_t kernel_vbase;
 extern vm_address_t kernel_vtop;
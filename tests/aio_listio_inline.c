@@ -0,0 +1,70 @@
+#include <darwintest.h>
+
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.aio"));
+
+#define NREQS   16
+#define REQSIZE 4096
+
+T_DECL(aio_listio_wait_batch,
+       "lio_listio(LIO_WAIT) completes a batch of reads and writes")
+{
+	char path[] = "/tmp/aio_listio_inline.XXXXXX";
+	struct aiocb cbs[NREQS], *list[NREQS];
+	char *bufs;
+	int inline_enabled = 0;
+	size_t size = sizeof(inline_enabled);
+	int fd, i;
+
+	if (sysctlbyname("kern.aio_listio_inline", &inline_enabled, &size, NULL, 0) == 0) {
+		T_LOG("kern.aio_listio_inline = %d", inline_enabled);
+	}
+
+	fd = mkstemp(path);
+	T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	unlink(path);
+
+	bufs = malloc(NREQS * REQSIZE);
+	T_QUIET; T_ASSERT_NOTNULL(bufs, "malloc");
+
+	/* write a batch, one distinct pattern per request */
+	for (i = 0; i < NREQS; i++) {
+		memset(bufs + i * REQSIZE, 'a' + i, REQSIZE);
+		memset(&cbs[i], 0, sizeof(cbs[i]));
+		cbs[i].aio_fildes = fd;
+		cbs[i].aio_offset = (off_t)i * REQSIZE;
+		cbs[i].aio_buf = bufs + i * REQSIZE;
+		cbs[i].aio_nbytes = REQSIZE;
+		cbs[i].aio_lio_opcode = LIO_WRITE;
+		list[i] = &cbs[i];
+	}
+	T_ASSERT_POSIX_SUCCESS(lio_listio(LIO_WAIT, list, NREQS, NULL), "lio_listio(LIO_WRITE)");
+	for (i = 0; i < NREQS; i++) {
+		T_QUIET; T_ASSERT_EQ(aio_error(&cbs[i]), 0, "write %d succeeded", i);
+		T_QUIET; T_ASSERT_EQ(aio_return(&cbs[i]), (ssize_t)REQSIZE, "write %d is complete", i);
+	}
+
+	/* and read it back */
+	memset(bufs, 0, NREQS * REQSIZE);
+	for (i = 0; i < NREQS; i++) {
+		cbs[i].aio_lio_opcode = LIO_READ;
+	}
+	T_ASSERT_POSIX_SUCCESS(lio_listio(LIO_WAIT, list, NREQS, NULL), "lio_listio(LIO_READ)");
+	for (i = 0; i < NREQS; i++) {
+		T_QUIET; T_ASSERT_EQ(aio_error(&cbs[i]), 0, "read %d succeeded", i);
+		T_QUIET; T_ASSERT_EQ(aio_return(&cbs[i]), (ssize_t)REQSIZE, "read %d is complete", i);
+		T_QUIET; T_ASSERT_EQ(bufs[i * REQSIZE], (char)('a' + i), "read %d returned its data", i);
+		T_QUIET; T_ASSERT_EQ(bufs[(i + 1) * REQSIZE - 1], (char)('a' + i), "read %d returned its data", i);
+	}
+	T_PASS("batch of %d reads and writes completed", NREQS);
+
+	free(bufs);
+	close(fd);
+}
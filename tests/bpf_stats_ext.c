@@ -0,0 +1,84 @@
+#define PRIVATE
+#include <net/bpf.h>
+#undef PRIVATE
+
+#include <darwintest.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.net"));
+
+/*
+ * Capture a datagram on lo0 and check the per descriptor statistics
+ * returned by BIOCGSTATSEXT.
+ */
+
+static int
+bpf_open(void)
+{
+	char path[32];
+	int i, fd;
+
+	for (i = 0; i < 256; i++) {
+		snprintf(path, sizeof(path), "/dev/bpf%d", i);
+		if ((fd = open(path, O_RDWR)) >= 0) {
+			return fd;
+		}
+		if (errno != EBUSY) {
+			break;
+		}
+	}
+	T_ASSERT_FAIL("no bpf device available: %s", strerror(errno));
+	return -1;
+}
+
+T_DECL(bpf_stats_ext, "bpf drop and read delay statistics",
+    T_META_ASROOT(true))
+{
+	struct sockaddr_in sin = {
+		.sin_len = sizeof(sin),
+		.sin_family = AF_INET,
+		.sin_port = htons(9),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	struct bpf_stat_ext bse;
+	struct ifreq ifr;
+	u_int bufsize, one = 1;
+	char *buf;
+	int fd, s;
+
+	fd = bpf_open();
+	memset(&ifr, 0, sizeof(ifr));
+	strlcpy(ifr.ifr_name, "lo0", sizeof(ifr.ifr_name));
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(ioctl(fd, BIOCSETIF, &ifr), "BIOCSETIF");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(ioctl(fd, BIOCIMMEDIATE, &one),
+	    "BIOCIMMEDIATE");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(ioctl(fd, BIOCGBLEN, &bufsize), "BIOCGBLEN");
+	buf = malloc(bufsize);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(s = socket(PF_INET, SOCK_DGRAM, 0), "socket");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sendto(s, "bpf", 3, 0,
+	    (struct sockaddr *)&sin, sizeof(sin)), "sendto");
+	T_ASSERT_POSIX_SUCCESS(read(fd, buf, bufsize), "read");
+
+	T_ASSERT_POSIX_SUCCESS(ioctl(fd, BIOCGSTATSEXT, &bse), "BIOCGSTATSEXT");
+	T_EXPECT_GT(bse.bse_recv, 0ULL, "packets received");
+	T_EXPECT_GE(bse.bse_reads, 1ULL, "buffers read");
+	T_EXPECT_EQ(bse.bse_drop, bse.bse_drop_reading + bse.bse_drop_full +
+	    bse.bse_drop_headdrop, "drops add up");
+	T_EXPECT_LE(bse.bse_delay_avg, bse.bse_delay_max, "average delay");
+
+	close(s);
+	close(fd);
+	free(buf);
+}
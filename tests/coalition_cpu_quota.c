@@ -0,0 +1,80 @@
+#include <darwintest.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <spawn_private.h>
+#include <stdint.h>
+#include <sys/coalition.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.scheduler"), T_META_ASROOT(true));
+
+extern char **environ;
+
+static uint64_t
+create_resource_coalition(void)
+{
+	uint32_t flags = 0;
+	uint64_t cid;
+
+	COALITION_CREATE_FLAGS_SET_TYPE(flags, COALITION_TYPE_RESOURCE);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(coalition_create(&cid, flags), "coalition_create");
+	return cid;
+}
+
+static void
+destroy_coalition(uint64_t cid)
+{
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(coalition_terminate(cid, 0), "coalition_terminate");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(coalition_reap(cid, 0), "coalition_reap");
+}
+
+T_DECL(coalition_cpu_quota_invalid, "CPU quotas need a period")
+{
+	uint64_t cid = create_resource_coalition();
+
+	T_EXPECT_POSIX_FAILURE(coalition_info_set_cpu_quota(cid, 1000000, 0), EINVAL,
+	    "a quota without a period is rejected");
+	T_EXPECT_POSIX_SUCCESS(coalition_info_set_cpu_quota(cid, 0, 0),
+	    "lifting the limit needs no period");
+
+	destroy_coalition(cid);
+}
+
+T_DECL(coalition_cpu_quota_throttles, "threads over their coalition's CPU quota wait",
+    T_META_CHECK_LEAKS(false))
+{
+	struct coalition_resource_usage cru = {};
+	char *args[] = { "/bin/sh", "-c", "while :; do :; done", NULL };
+	posix_spawnattr_t attr;
+	uint64_t cid;
+	pid_t pid;
+	int status;
+
+	cid = create_resource_coalition();
+	/* 10ms of CPU every 100ms */
+	T_ASSERT_POSIX_SUCCESS(coalition_info_set_cpu_quota(cid, 10000000, 100000000),
+	    "coalition_info_set_cpu_quota");
+
+	T_QUIET; T_ASSERT_POSIX_ZERO(posix_spawnattr_init(&attr), "posix_spawnattr_init");
+	T_QUIET; T_ASSERT_POSIX_ZERO(posix_spawnattr_setcoalition_np(&attr, cid,
+	    COALITION_TYPE_RESOURCE, COALITION_TASKROLE_LEADER), "posix_spawnattr_setcoalition_np");
+	T_QUIET; T_ASSERT_POSIX_ZERO(posix_spawn(&pid, args[0], NULL, &attr, args, environ),
+	    "posix_spawn");
+	posix_spawnattr_destroy(&attr);
+
+	sleep(1);
+
+	T_ASSERT_POSIX_SUCCESS(coalition_info_resource_usage(cid, &cru, sizeof(cru)),
+	    "coalition_info_resource_usage");
+	T_LOG("throttled %llu times for %llu ns", cru.cpu_throttle_count, cru.cpu_throttled_time);
+	T_EXPECT_GT(cru.cpu_throttle_count, 0ULL, "the spinning child was throttled");
+	T_EXPECT_GT(cru.cpu_throttled_time, 500000000ULL,
+	    "the child spent most of the second waiting for its quota");
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(kill(pid, SIGKILL), "kill");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(waitpid(pid, &status, 0), "waitpid");
+	destroy_coalition(cid);
+}
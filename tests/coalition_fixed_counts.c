@@ -0,0 +1,82 @@
+#include <darwintest.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <spawn_private.h>
+#include <stdint.h>
+#include <sys/coalition.h>
+#include <sys/sysctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.monotonic"), T_META_ASROOT(true),
+    T_META_CHECK_LEAKS(false));
+
+extern char **environ;
+
+static void
+skip_if_unsupported(void)
+{
+	int supported = 0;
+	size_t supported_size = sizeof(supported);
+
+	if (sysctlbyname("kern.monotonic.supported", &supported, &supported_size,
+	    NULL, 0) < 0) {
+		T_WITH_ERRNO;
+		T_SKIP("could not find \"kern.monotonic.supported\" sysctl");
+	}
+	if (!supported) {
+		T_SKIP("monotonic is not supported on this platform");
+	}
+}
+
+static void
+resource_usage(uint64_t cid, struct coalition_resource_usage *cru)
+{
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(coalition_info_resource_usage(cid, cru, sizeof(*cru)),
+	    "coalition_info_resource_usage");
+}
+
+T_DECL(coalition_fixed_counts, "coalitions report their tasks' instructions and cycles")
+{
+	struct coalition_resource_usage live = {}, dead = {};
+	char *args[] = { "/bin/sh", "-c", "while :; do :; done", NULL };
+	posix_spawnattr_t attr;
+	uint32_t flags = 0;
+	uint64_t cid;
+	pid_t pid;
+	int status;
+
+	skip_if_unsupported();
+
+	COALITION_CREATE_FLAGS_SET_TYPE(flags, COALITION_TYPE_RESOURCE);
+	T_ASSERT_POSIX_SUCCESS(coalition_create(&cid, flags), "coalition_create");
+
+	T_QUIET; T_ASSERT_POSIX_ZERO(posix_spawnattr_init(&attr), "posix_spawnattr_init");
+	T_QUIET; T_ASSERT_POSIX_ZERO(posix_spawnattr_setcoalition_np(&attr, cid,
+	    COALITION_TYPE_RESOURCE, COALITION_TASKROLE_LEADER), "posix_spawnattr_setcoalition_np");
+	T_QUIET; T_ASSERT_POSIX_ZERO(posix_spawn(&pid, args[0], NULL, &attr, args, environ),
+	    "posix_spawn");
+	posix_spawnattr_destroy(&attr);
+
+	sleep(1);
+
+	resource_usage(cid, &live);
+	T_LOG("live: %llu instructions, %llu cycles", live.cpu_instructions, live.cpu_cycles);
+	T_EXPECT_GT(live.cpu_cycles, 0ULL, "the running child's cycles are counted");
+	T_EXPECT_GT(live.cpu_instructions, 0ULL, "the running child's instructions are counted");
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(kill(pid, SIGKILL), "kill");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(waitpid(pid, &status, 0), "waitpid");
+
+	resource_usage(cid, &dead);
+	T_LOG("exited: %llu instructions, %llu cycles", dead.cpu_instructions, dead.cpu_cycles);
+	T_EXPECT_GE(dead.cpu_cycles, live.cpu_cycles,
+	    "the child's cycles stay with the coalition after it exits");
+	T_EXPECT_GE(dead.cpu_instructions, live.cpu_instructions,
+	    "the child's instructions stay with the coalition after it exits");
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(coalition_terminate(cid, 0), "coalition_terminate");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(coalition_reap(cid, 0), "coalition_reap");
+}
@@ -0,0 +1,70 @@
+#include <darwintest.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.vfs"));
+
+#define TIERS   4
+#define BUCKETS 24
+#define IO_SIZE (64 * 1024)
+#define IO_COUNT 32
+
+static uint64_t
+latency_samples(void)
+{
+	uint64_t hist[TIERS][BUCKETS];
+	size_t size = sizeof(hist);
+	uint64_t n = 0;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("debug.lowpri_throttle_latency_hist",
+	    hist, &size, NULL, 0), "debug.lowpri_throttle_latency_hist");
+	T_QUIET; T_ASSERT_EQ(size, sizeof(hist), "histogram size");
+	for (int t = 0; t < TIERS; t++) {
+		for (int b = 0; b < BUCKETS; b++) {
+			n += hist[t][b];
+		}
+	}
+	return n;
+}
+
+T_DECL(io_latency_hist, "uncached I/O is accounted in the per-tier latency histograms")
+{
+	char path[] = "/tmp/io_latency_hist.XXXXXX";
+	uint64_t before, after;
+	char *buf;
+	int fd;
+
+	before = latency_samples();
+
+	fd = mkstemp(path);
+	T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	unlink(path);
+	T_ASSERT_POSIX_SUCCESS(fcntl(fd, F_NOCACHE, 1), "F_NOCACHE");
+
+	buf = malloc(IO_SIZE);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	memset(buf, 0x5a, IO_SIZE);
+	for (int i = 0; i < IO_COUNT; i++) {
+		T_QUIET; T_ASSERT_EQ(pwrite(fd, buf, IO_SIZE, (off_t)i * IO_SIZE),
+		    (ssize_t)IO_SIZE, "pwrite");
+	}
+	T_ASSERT_POSIX_SUCCESS(fsync(fd), "fsync");
+	for (int i = 0; i < IO_COUNT; i++) {
+		T_QUIET; T_ASSERT_EQ(pread(fd, buf, IO_SIZE, (off_t)i * IO_SIZE),
+		    (ssize_t)IO_SIZE, "pread");
+	}
+
+	after = latency_samples();
+	T_LOG("%llu I/Os accounted", after - before);
+	T_EXPECT_GT(after, before, "the I/Os were accounted");
+
+	free(buf);
+	close(fd);
+}
@@ -0,0 +1,38 @@
+#include <darwintest.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.ipc"));
+
+static uint64_t
+importance_counter(const char *name)
+{
+	uint64_t value = 0;
+	size_t size = sizeof(value);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname(name, &value, &size, NULL, 0),
+	    "%s", name);
+	return value;
+}
+
+T_DECL(ipc_importance_lock_counters, "the importance lock counts its acquisitions")
+{
+	uint64_t count, contended, later;
+	size_t size = sizeof(count);
+
+	if (sysctlbyname("kern.ipc_importance_lock_count", &count, &size, NULL, 0) != 0) {
+		T_QUIET; T_ASSERT_EQ(errno, ENOENT, "kern.ipc_importance_lock_count");
+		T_SKIP("importance inheritance isn't configured");
+	}
+
+	contended = importance_counter("kern.ipc_importance_lock_contended");
+	later = importance_counter("kern.ipc_importance_lock_count");
+
+	T_LOG("importance lock taken %llu times, %llu of them contended",
+	    later, contended);
+	T_EXPECT_GE(later, count, "the acquisition count doesn't go backwards");
+	T_EXPECT_LE(contended, later, "contended acquisitions are acquisitions");
+	(void)importance_counter("kern.ipc_importance_voucher_reused");
+}
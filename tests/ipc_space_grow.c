@@ -0,0 +1,52 @@
+#include <darwintest.h>
+
+#include <mach/mach.h>
+#include <mach_debug/ipc_info.h>
+#include <stdlib.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.ipc"));
+
+#define GROW_PORTS 100000
+
+T_DECL(ipc_space_grow, "the port name table of a space grows geometrically",
+    T_META_CHECK_LEAKS(false))
+{
+	ipc_info_space_basic_t before, after;
+	mach_port_t *ports;
+	kern_return_t kr;
+
+	kr = mach_port_space_basic_info(mach_task_self(), &before);
+	if (kr == KERN_FAILURE) {
+		T_SKIP("mach_port_space_basic_info isn't supported on this kernel");
+	}
+	T_ASSERT_MACH_SUCCESS(kr, "mach_port_space_basic_info");
+
+	ports = calloc(GROW_PORTS, sizeof(ports[0]));
+	T_QUIET; T_ASSERT_NOTNULL(ports, "calloc");
+
+	for (int i = 0; i < GROW_PORTS; i++) {
+		T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_allocate(mach_task_self(),
+		    MACH_PORT_RIGHT_RECEIVE, &ports[i]), "mach_port_allocate");
+	}
+
+	T_ASSERT_MACH_SUCCESS(mach_port_space_basic_info(mach_task_self(), &after),
+	    "mach_port_space_basic_info");
+	T_LOG("table size %u -> %u, grown %u times, %u entries copied again",
+	    before.iisb_table_size, after.iisb_table_size,
+	    after.iisb_grow_count - before.iisb_grow_count,
+	    after.iisb_grow_rescans - before.iisb_grow_rescans);
+
+	T_EXPECT_GE(after.iisb_table_size, before.iisb_table_size + GROW_PORTS,
+	    "the table has room for the ports");
+	T_EXPECT_GT(after.iisb_grow_count, before.iisb_grow_count,
+	    "the table grew");
+	/* fixed increments take well over 40 growths to get there */
+	T_EXPECT_LE(after.iisb_grow_count, 32U,
+	    "the table grew by a factor rather than by fixed increments");
+
+	for (int i = 0; i < GROW_PORTS; i++) {
+		T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_mod_refs(mach_task_self(),
+		    ports[i], MACH_PORT_RIGHT_RECEIVE, -1), "mach_port_mod_refs");
+	}
+	free(ports);
+}
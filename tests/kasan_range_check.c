@@ -0,0 +1,36 @@
+#include <darwintest.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.kasan"));
+
+static const int bench_sizes[] = { 16, 256, 4096, 65536, 1024 * 1024 };
+
+T_DECL(perf_kasan_range_check, "cost of a KASan shadow check over a range",
+    T_META_TAG_PERF, T_META_ASROOT(true))
+{
+	uint64_t ns;
+	size_t size = sizeof(ns);
+	char name[64];
+
+	if (sysctlbyname("kern.kasan.bench_ns", &ns, &size, NULL, 0) != 0) {
+		T_QUIET; T_ASSERT_EQ(errno, ENOENT, "kern.kasan.bench_ns");
+		T_SKIP("not a KASan kernel");
+	}
+
+	for (size_t i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+		int len = bench_sizes[i];
+
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.kasan.bench",
+		    NULL, NULL, &len, sizeof(len)), "kern.kasan.bench %d", len);
+		size = sizeof(ns);
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.kasan.bench_ns",
+		    &ns, &size, NULL, 0), "kern.kasan.bench_ns");
+
+		snprintf(name, sizeof(name), "kasan_check_range_%d", len);
+		T_PERF(name, (double)ns, "ns", "average kasan_check_range() time");
+	}
+}
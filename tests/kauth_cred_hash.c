@@ -0,0 +1,67 @@
+#include <darwintest.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/kauth.h>
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define CRED_THREADS 8
+#define CRED_ITERATIONS 10000
+
+extern int pthread_setugid_np(uid_t, gid_t);
+
+static int
+cred_hash_stat(const char *name)
+{
+	int value = -1;
+	size_t size = sizeof(value);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname(name, &value, &size, NULL, 0),
+	    "sysctlbyname(%s)", name);
+	return value;
+}
+
+static void *
+cred_churn(void *arg)
+{
+	uid_t uid = (uid_t)(uintptr_t)arg;
+
+	/*
+	 * Each thread flips between its own credential and the process', so
+	 * the threads look up and release distinct credentials concurrently.
+	 */
+	for (int i = 0; i < CRED_ITERATIONS; i++) {
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(pthread_setugid_np(uid, uid),
+		    "pthread_setugid_np(%d)", uid);
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(pthread_setugid_np(KAUTH_UID_NONE,
+		    KAUTH_GID_NONE), "pthread_setugid_np(KAUTH_UID_NONE)");
+	}
+
+	return NULL;
+}
+
+T_DECL(kauth_cred_hash_stats, "the credential hash reports its size and longest chain",
+    T_META_ASROOT(true))
+{
+	pthread_t threads[CRED_THREADS];
+	int count, maxchain;
+
+	for (int i = 0; i < CRED_THREADS; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&threads[i], NULL,
+		    cred_churn, (void *)(uintptr_t)(5000 + i)), "pthread_create");
+	}
+	for (int i = 0; i < CRED_THREADS; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(threads[i], NULL),
+		    "pthread_join");
+	}
+
+	count = cred_hash_stat("kern.cred_hash_count");
+	maxchain = cred_hash_stat("kern.cred_hash_maxchain");
+	T_LOG("%d credentials, longest chain %d", count, maxchain);
+
+	T_EXPECT_GT(count, 0, "the credential hash is not empty");
+	T_EXPECT_GT(maxchain, 0, "the longest chain is not empty");
+	T_EXPECT_LE(maxchain, count, "no chain is longer than the hash");
+}
@@ -13,6 +13,7 @@
 #include <mach/task.h>
 #include <os/assumes.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/kdebug.h>
 #include <sys/kdebug_signpost.h>
 #include <sys/sysctl.h>
@@ -741,6 +742,71 @@ T_DECL(kernel_events_noprocfilt,
 	dispatch_main();
 }
 
+#define VERBOSE_DEBUGID (0xfedfed10U)
+#define VERBOSE_NEVENTS (1000)
+
+static void
+kdebug_control(int op, int value, void *buf, size_t *size)
+{
+	int mib[] = { CTL_KERN, KERN_KDEBUG, op, value };
+	T_QUIET;
+	T_ASSERT_POSIX_SUCCESS(sysctl(mib, 4, buf, size, NULL, 0),
+			"kdebug sysctl %d", op);
+}
+
+static void
+kdebug_reset(void)
+{
+	kdebug_control(KERN_KDREMOVE, 0, NULL, NULL);
+}
+
+T_DECL(pid_verbose,
+		"ensure a process traced at full verbosity bypasses the typefilter")
+{
+	uint8_t typefilter[KDBG_TYPEFILTER_BITMAP_SIZE] = { 0 };
+	size_t size = sizeof(typefilter);
+	kd_regtype kdr = {
+		.type = KDBG_TYPENONE,
+		.value1 = (unsigned int)getpid(),
+		.value2 = 1,
+	};
+	size_t kdrsize = sizeof(kdr);
+	kd_buf *events;
+	size_t nevents;
+	unsigned int seen = 0;
+
+	T_ATEND(kdebug_reset);
+	kdebug_reset();
+	kdebug_control(KERN_KDSETBUF, VERBOSE_NEVENTS * 10, NULL, NULL);
+	kdebug_control(KERN_KDSETUP, 0, NULL, NULL);
+
+	/* reject everything but the trace system events */
+	memset(&typefilter[DBG_TRACE * 256 / 8], 0xff, 256 / 8);
+	kdebug_control(KERN_KDSET_TYPEFILTER, 0, typefilter, &size);
+	kdebug_control(KERN_KDPIDVERBOSE, 0, &kdr, &kdrsize);
+
+	kdebug_control(KERN_KDENABLE, KDEBUG_ENABLE_TRACE, NULL, NULL);
+	for (unsigned int i = 0; i < VERBOSE_NEVENTS; i++) {
+		kdebug_trace(VERBOSE_DEBUGID, i, 0, 0, 0);
+	}
+	kdebug_control(KERN_KDENABLE, 0, NULL, NULL);
+
+	nevents = VERBOSE_NEVENTS * 10;
+	events = calloc(nevents, sizeof(*events));
+	T_QUIET; T_ASSERT_NOTNULL(events, "allocated event buffer");
+	size = nevents * sizeof(*events);
+	kdebug_control(KERN_KDREADTR, 0, events, &size);
+	for (size_t i = 0; i < size; i++) {
+		if ((events[i].debugid & KDBG_EVENTID_MASK) == VERBOSE_DEBUGID) {
+			seen++;
+		}
+	}
+	free(events);
+
+	T_EXPECT_EQ(seen, VERBOSE_NEVENTS,
+			"events of the verbose process seen despite the typefilter");
+}
+
 static volatile bool continue_abuse = true;
 
 #define STRESS_DEBUGID (0xfeedfac0)
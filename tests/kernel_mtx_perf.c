@@ -220,6 +220,61 @@ test_from_kernel_lock_unlock_uncontended(void)
 	free(buff);
 }
 
+/*
+ * Run the contended loop test with adaptive mutex spinning turned on or off
+ * and report wall clock throughput, along with the cpu time each lock/unlock
+ * pair cost, since spinning trades the latter for the former.
+ */
+static void
+test_from_kernel_contended_throughput(int adaptive)
+{
+	int ret, old_adaptive;
+	uint64_t run, tot;
+	size_t size, old_size;
+	char iter[35];
+	char name_string[60];
+	char *buff, *buff_p;
+	const char *mode = adaptive ? "adaptive spin" : "fixed spin";
+
+	old_size = sizeof(old_adaptive);
+	ret = sysctlbyname("kern.lck_mtx_adaptive_spin", &old_adaptive, &old_size,
+	    &adaptive, sizeof(adaptive));
+	if (ret != 0) {
+		T_SKIP("kern.lck_mtx_adaptive_spin not available");
+	}
+
+	T_LOG("Testing contended mutex throughput from kernel with %s.\n", mode);
+
+	size = 1000;
+	buff = calloc(size, sizeof(char));
+	T_QUIET;T_ASSERT_NOTNULL(buff, "Allocating buffer fo sysctl");
+
+	snprintf(iter, sizeof(iter), "%d", ITER);
+	ret = sysctlbyname("kern.test_mtx_contended", buff, &size, iter, sizeof(iter));
+	T_ASSERT_POSIX_SUCCESS(ret, "sysctlbyname kern.test_mtx_contended");
+
+	(void)sysctlbyname("kern.lck_mtx_adaptive_spin", NULL, NULL,
+	    &old_adaptive, sizeof(old_adaptive));
+
+	buff_p = strstr(buff, "STATS OUTER LOOP");
+	T_QUIET;T_ASSERT_NOTNULL(buff_p, "contended outer loop stats not found");
+
+	buff_p = strstr(buff_p, "total time ");
+	T_QUIET;T_ASSERT_NOTNULL(buff_p, "contended loop total time not found");
+	sscanf(buff_p, "total time %llu ns total run time %llu", &tot, &run);
+	T_QUIET;T_ASSERT_GT(tot, 0ULL, "contended loop total time");
+
+	snprintf(name_string, sizeof(name_string), "contended throughput %s", mode);
+	T_PERF(name_string, (double)ITER * 1000000000.0 / tot, "ops/s",
+	    "lock/unlock pairs per second with two contending threads");
+
+	snprintf(name_string, sizeof(name_string), "contended cpu time %s", mode);
+	T_PERF(name_string, run / ITER, "ns",
+	    "cpu time per lock/unlock pair with two contending threads");
+
+	free(buff);
+}
+
 extern char **environ;
 static void
 fix_cpu_frequency(void)
@@ -304,3 +359,13 @@ T_DECL(kernel_mtx_perf_test,
 	test_from_kernel_lock_unlock_contended();
 }
 
+T_DECL(kernel_mtx_contended_throughput_test,
+	"Kernel mutex contended throughput with fixed and adaptive spinning",
+	T_META_ASROOT(YES), T_META_CHECK_LEAKS(NO))
+{
+	fix_cpu_frequency();
+
+	test_from_kernel_contended_throughput(0);
+	test_from_kernel_contended_throughput(1);
+}
+
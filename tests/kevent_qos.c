@@ -24,6 +24,11 @@
 #include <crt_externs.h>
 #include <mach/mach_port.h>
 #include <mach/mach_sync_ipc.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <darwintest_perf.h>
 
 T_GLOBAL_META(T_META_NAMESPACE("xnu.kevent_qos"));
 
@@ -1765,3 +1770,153 @@ TEST_QOS("server_kevent_id", "qos_client_send_2sync_msg_with_link_check_incorrec
 	QOS_CLASS_DEFAULT, "default",
 	QOS_CLASS_DEFAULT, "default",
 	QOS_CLASS_DEFAULT, "default")
+
+/*
+ * Shared ring delivery for workloops.
+ *
+ * Compare the cost of firing a batch of EV_CLEAR EVFILT_USER knotes and
+ * collecting the events through kevent_qos() with collecting them from the
+ * ring attached with KQ_WORKLOOP_RING_ATTACH, which needs no syscall.
+ */
+#define KQ_WORKLOOP_RING_ATTACH 0x03
+
+/* Mirrors struct kqueue_workloop_params in bsd/pthread/workqueue_syscalls.h */
+struct ring_workloop_params {
+	int kqwlp_version;
+	int kqwlp_flags;
+	uint64_t kqwlp_id;
+	int kqwlp_sched_pri;
+	int kqwlp_sched_pol;
+	int kqwlp_cpu_percent;
+	int kqwlp_cpu_refillms;
+	uint32_t kqwlp_ring_entries;
+	uint32_t kqwlp_reserved;
+	uint64_t kqwlp_ring_addr;
+} __attribute__((packed));
+
+#define RING_WORKLOOP_ID  0x4b52494e47ULL
+#define RING_ENTRIES      1024
+#define RING_BATCH        64
+
+static void
+ring_populate_batch(struct kevent_qos_s *kev, uint16_t flags, uint32_t fflags)
+{
+	for (int i = 0; i < RING_BATCH; i++) {
+		memset(&kev[i], 0, sizeof(kev[i]));
+		kev[i].ident = (uint64_t)i + 1;
+		kev[i].filter = EVFILT_USER;
+		kev[i].flags = flags;
+		kev[i].fflags = fflags;
+	}
+}
+
+static struct kevent_ring *
+ring_workloop_setup(void)
+{
+	struct kevent_qos_s kev[RING_BATCH];
+	struct ring_workloop_params params = {
+		.kqwlp_version = sizeof(params),
+		.kqwlp_id = RING_WORKLOOP_ID,
+		.kqwlp_ring_entries = RING_ENTRIES,
+	};
+	int ret;
+
+	ring_populate_batch(kev, EV_ADD | EV_ENABLE | EV_CLEAR, 0);
+	ret = kevent_id(RING_WORKLOOP_ID, kev, RING_BATCH, kev, RING_BATCH, NULL,
+			NULL, KEVENT_FLAG_WORKLOOP | KEVENT_FLAG_ERROR_EVENTS);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(ret, "kevent_id(EV_ADD)");
+	T_QUIET; T_ASSERT_EQ(ret, 0, "no registration errors");
+
+	ret = syscall(SYS_kqueue_workloop_ctl, KQ_WORKLOOP_RING_ATTACH, 0,
+			&params, sizeof(params));
+	if (ret == -1 && errno == EINVAL) {
+		T_SKIP("workloop rings are not supported");
+	}
+	T_ASSERT_POSIX_SUCCESS(ret, "KQ_WORKLOOP_RING_ATTACH");
+	T_QUIET; T_ASSERT_NE(params.kqwlp_ring_addr, 0ULL, "ring was mapped");
+
+	return (struct kevent_ring *)(uintptr_t)params.kqwlp_ring_addr;
+}
+
+static int
+ring_drain(struct kevent_ring *ring)
+{
+	uint32_t head = ring->kr_head;
+	uint32_t tail = atomic_load_explicit((_Atomic uint32_t *)&ring->kr_tail,
+			memory_order_acquire);
+	int n = 0;
+
+	while (head != tail) {
+		struct kevent_qos_s *kev = &ring->kr_events[head & ring->kr_mask];
+		T_QUIET; T_ASSERT_EQ(kev->filter, EVFILT_USER, "ring event filter");
+		head++;
+		n++;
+	}
+	atomic_store_explicit((_Atomic uint32_t *)&ring->kr_head, head,
+			memory_order_release);
+	return n;
+}
+
+T_DECL(kevent_workloop_ring_delivery,
+		"EV_CLEAR EVFILT_USER activations are posted to the workloop ring",
+		T_META_CHECK_LEAKS(false))
+{
+	struct kevent_qos_s kev[RING_BATCH];
+	struct kevent_ring *ring = ring_workloop_setup();
+	int ret;
+
+	T_ASSERT_EQ(ring->kr_mask, (uint32_t)RING_ENTRIES - 1, "ring mask");
+
+	ring_populate_batch(kev, 0, NOTE_TRIGGER);
+	ret = kevent_id(RING_WORKLOOP_ID, kev, RING_BATCH, kev, RING_BATCH, NULL,
+			NULL, KEVENT_FLAG_WORKLOOP | KEVENT_FLAG_ERROR_EVENTS |
+			KEVENT_FLAG_DYNAMIC_KQ_MUST_EXIST);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(ret, "kevent_id(NOTE_TRIGGER)");
+
+	T_EXPECT_EQ(ring_drain(ring), RING_BATCH, "one ring entry per activation");
+	T_EXPECT_EQ(ring->kr_overflows, 0ULL, "no overflow into the workloop queue");
+}
+
+T_DECL(kevent_workloop_ring_perf,
+		"Throughput of batched EVFILT_USER delivery: ring vs. kevent_qos()",
+		T_META_TAG_PERF, T_META_CHECK_LEAKS(false))
+{
+	struct kevent_qos_s kev[RING_BATCH], out[RING_BATCH];
+	struct kevent_ring *ring = ring_workloop_setup();
+	dt_stat_time_t s;
+	int kq, ret;
+
+	kq = kqueue();
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(kq, "kqueue");
+	ring_populate_batch(kev, EV_ADD | EV_ENABLE | EV_CLEAR, 0);
+	ret = kevent_qos(kq, kev, RING_BATCH, NULL, 0, NULL, NULL, 0);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(ret, "kevent_qos(EV_ADD)");
+
+	ring_populate_batch(kev, 0, NOTE_TRIGGER);
+
+	s = dt_stat_time_create("kevent_qos batch of %d", RING_BATCH);
+	while (!dt_stat_stable(s)) {
+		T_STAT_MEASURE(s) {
+			ret = kevent_qos(kq, kev, RING_BATCH, NULL, 0, NULL, NULL, 0);
+			ret = kevent_qos(kq, NULL, 0, out, RING_BATCH, NULL, NULL,
+					KEVENT_FLAG_IMMEDIATE);
+		}
+		T_QUIET; T_ASSERT_EQ(ret, RING_BATCH, "kevent_qos drained the batch");
+	}
+	dt_stat_finalize(s);
+
+	s = dt_stat_time_create("workloop ring batch of %d", RING_BATCH);
+	while (!dt_stat_stable(s)) {
+		T_STAT_MEASURE(s) {
+			ret = kevent_id(RING_WORKLOOP_ID, kev, RING_BATCH, out, RING_BATCH,
+					NULL, NULL, KEVENT_FLAG_WORKLOOP | KEVENT_FLAG_ERROR_EVENTS |
+					KEVENT_FLAG_DYNAMIC_KQ_MUST_EXIST);
+			ret = ring_drain(ring);
+		}
+		T_QUIET; T_ASSERT_EQ(ret, RING_BATCH, "ring drained the batch");
+	}
+	dt_stat_finalize(s);
+
+	T_EXPECT_EQ(ring->kr_overflows, 0ULL, "no overflow into the workloop queue");
+	close(kq);
+}
@@ -1,6 +1,8 @@
 #include <darwintest.h>
 #include <inttypes.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include <kperf/kpc.h>
 
@@ -66,3 +68,54 @@ T_DECL(fixed_thread_counters,
 	free(ctrs_a);
 	free(ctrs_b);
 }
+
+T_DECL(thread_selfcounts_kpc,
+		"test that a thread can read its own kpc counters without privileges",
+		T_META_ASROOT(YES))
+{
+	extern int thread_selfcounts(int type, void *buf, size_t nbytes);
+	uint32_t ctrs_cnt;
+	uint64_t *ctrs_a;
+	uint64_t *ctrs_b;
+	int err;
+
+	T_SETUPBEGIN;
+
+	ctrs_cnt = kpc_get_counter_count(KPC_CLASS_FIXED_MASK);
+	if (ctrs_cnt == 0) {
+		T_SKIP("no fixed counters available");
+	}
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(kpc_force_all_ctrs_set(1), NULL);
+	T_ASSERT_POSIX_SUCCESS(kpc_set_counting(KPC_CLASS_FIXED_MASK),
+			"kpc_set_counting");
+	T_ASSERT_POSIX_SUCCESS(kpc_set_thread_counting(KPC_CLASS_FIXED_MASK),
+			"kpc_set_thread_counting");
+
+	/* let the AST allocate this thread's counter buffer */
+	(void)kpc_get_thread_counters(0, 0, NULL);
+
+	T_SETUPEND;
+
+	ctrs_a = calloc(ctrs_cnt, sizeof(uint64_t));
+	T_QUIET; T_ASSERT_NOTNULL(ctrs_a, NULL);
+	ctrs_b = calloc(ctrs_cnt, sizeof(uint64_t));
+	T_QUIET; T_ASSERT_NOTNULL(ctrs_b, NULL);
+
+	T_ASSERT_POSIX_ZERO(seteuid(-2), "drop privileges");
+
+	err = thread_selfcounts(2, ctrs_a, ctrs_cnt * sizeof(uint64_t));
+	T_ASSERT_POSIX_ZERO(err, "thread_selfcounts");
+	err = thread_selfcounts(2, ctrs_b, ctrs_cnt * sizeof(uint64_t));
+	T_ASSERT_POSIX_ZERO(err, "thread_selfcounts");
+
+	T_QUIET; T_ASSERT_POSIX_ZERO(seteuid(0), "restore privileges");
+
+	for (uint32_t i = 0; i < ctrs_cnt; i++) {
+		T_QUIET; T_EXPECT_LT(ctrs_a[i], ctrs_b[i],
+				"counter %d is increasing", i);
+	}
+
+	free(ctrs_a);
+	free(ctrs_b);
+}
@@ -0,0 +1,121 @@
+#include <darwintest.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void
+set_lock(int fd, int cmd, short type, off_t start, off_t len)
+{
+	struct flock fl = {
+		.l_start = start,
+		.l_len = len,
+		.l_type = type,
+		.l_whence = SEEK_SET,
+	};
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(fcntl(fd, cmd, &fl),
+	    "fcntl(%d, type %d, [%lld, %lld))", cmd, type, start, start + len);
+}
+
+static int
+acquired_within(int pipefd, int timeout_ms)
+{
+	struct pollfd pfd = { .fd = pipefd, .events = POLLIN };
+	int n;
+
+	n = poll(&pfd, 1, timeout_ms);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(n, "poll");
+	return n;
+}
+
+T_DECL(lockf_shrink_wakeup,
+    "a waiter is granted its range once the part of a lock it overlaps is released")
+{
+	char path[] = "/tmp/lockf_shrink_wakeup.XXXXXX";
+	int fd, pipefds[2], status;
+	pid_t pid;
+	char c;
+
+	fd = mkstemp(path);
+	T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(unlink(path), "unlink");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(pipe(pipefds), "pipe");
+
+	set_lock(fd, F_SETLK, F_WRLCK, 0, 100);
+
+	pid = fork();
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(pid, "fork");
+	if (pid == 0) {
+		set_lock(fd, F_SETLKW, F_WRLCK, 50, 10);
+		c = 'x';
+		T_QUIET; T_ASSERT_EQ(write(pipefds[1], &c, 1), 1L, "write");
+		exit(0);
+	}
+
+	/* releasing a part the child doesn't want leaves it blocked */
+	T_EXPECT_EQ(acquired_within(pipefds[0], 100), 0, "child waits for [50, 60)");
+	set_lock(fd, F_SETLK, F_UNLCK, 0, 10);
+	T_EXPECT_EQ(acquired_within(pipefds[0], 100), 0,
+	    "child still waits once [0, 10) is released");
+
+	/* splitting the lock around the child's range releases it */
+	set_lock(fd, F_SETLK, F_UNLCK, 40, 30);
+	T_EXPECT_EQ(acquired_within(pipefds[0], 10000), 1,
+	    "child is granted [50, 60) once [40, 70) is released");
+
+	T_QUIET; T_ASSERT_EQ(read(pipefds[0], &c, 1), 1L, "read");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(waitpid(pid, &status, 0), "waitpid");
+	T_EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child exited");
+
+	set_lock(fd, F_SETLK, F_UNLCK, 0, 0);
+	close(pipefds[0]);
+	close(pipefds[1]);
+	close(fd);
+}
+
+T_DECL(lockf_split_tail_wakeup,
+    "a waiter on the tail of a split lock is granted its range when the tail is released")
+{
+	char path[] = "/tmp/lockf_split_tail_wakeup.XXXXXX";
+	int fd, pipefds[2], status;
+	pid_t pid;
+	char c;
+
+	fd = mkstemp(path);
+	T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(unlink(path), "unlink");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(pipe(pipefds), "pipe");
+
+	set_lock(fd, F_SETLK, F_WRLCK, 0, 100);
+
+	pid = fork();
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(pid, "fork");
+	if (pid == 0) {
+		set_lock(fd, F_SETLKW, F_WRLCK, 80, 10);
+		c = 'x';
+		T_QUIET; T_ASSERT_EQ(write(pipefds[1], &c, 1), 1L, "write");
+		exit(0);
+	}
+
+	/* the child now waits on the tail, a new lock split from the original */
+	T_EXPECT_EQ(acquired_within(pipefds[0], 100), 0, "child waits for [80, 90)");
+	set_lock(fd, F_SETLK, F_UNLCK, 40, 10);
+	T_EXPECT_EQ(acquired_within(pipefds[0], 100), 0,
+	    "child still waits once [40, 50) is released");
+
+	set_lock(fd, F_SETLK, F_UNLCK, 50, 50);
+	T_EXPECT_EQ(acquired_within(pipefds[0], 10000), 1,
+	    "child is granted [80, 90) once the tail is released");
+
+	T_QUIET; T_ASSERT_EQ(read(pipefds[0], &c, 1), 1L, "read");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(waitpid(pid, &status, 0), "waitpid");
+	T_EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child exited");
+
+	set_lock(fd, F_SETLK, F_UNLCK, 0, 0);
+	close(pipefds[0]);
+	close(pipefds[1]);
+	close(fd);
+}
@@ -0,0 +1,46 @@
+#include <stdint.h>
+#include <sys/event.h>
+#include <sys/kern_memorystatus.h>
+#include <sys/sysctl.h>
+
+#include <darwintest.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.vm"),
+	T_META_CHECK_LEAKS(false)
+);
+
+/*
+ * Read the memory pressure forecast with MEMORYSTATUS_CMD_GET_PRESSURE_FORECAST
+ * and check that it is consistent with itself.
+ */
+
+T_DECL(memorystatus_pressure_forecast, "memory pressure forecast",
+    T_META_ASROOT(true))
+{
+	memorystatus_pressure_forecast_t forecast;
+	uint32_t horizon;
+	size_t len = sizeof(horizon);
+
+	T_ASSERT_POSIX_SUCCESS(memorystatus_control(MEMORYSTATUS_CMD_GET_PRESSURE_FORECAST,
+	    0, 0, &forecast, sizeof(forecast)), "MEMORYSTATUS_CMD_GET_PRESSURE_FORECAST");
+	T_LOG("level %u forecast %u available %llu critical %llu trend %lld secs_to_critical %u",
+	    forecast.level, forecast.forecast_level, forecast.available_pages,
+	    forecast.critical_pages, forecast.trend, forecast.secs_to_critical);
+
+	T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.memorystatus_pressure_forecast_horizon",
+	    &horizon, &len, NULL, 0), "kern.memorystatus_pressure_forecast_horizon");
+	T_EXPECT_EQ(forecast.horizon_secs, horizon, "horizon matches the sysctl");
+
+	if (forecast.trend >= 0 && forecast.available_pages > forecast.critical_pages) {
+		T_EXPECT_EQ(forecast.secs_to_critical, UINT32_MAX,
+		    "no time to critical when memory isn't declining");
+	}
+	if (forecast.secs_to_critical == 0) {
+		T_EXPECT_EQ(forecast.forecast_level, (uint32_t)NOTE_MEMORYSTATUS_PRESSURE_CRITICAL,
+		    "forecast is critical at the threshold");
+	}
+
+	T_EXPECT_EQ(memorystatus_control(MEMORYSTATUS_CMD_GET_PRESSURE_FORECAST,
+	    0, 0, &forecast, sizeof(forecast) - 1), -1, "short buffer is rejected");
+}
@@ -72,6 +72,8 @@ static mach_zone_info_array_t zone_info_array = NULL;
 static mach_zone_name_t largest_zone_name;
 static mach_zone_info_t largest_zone_info;
 
+static unsigned int zone_map_warnings;
+
 static char testpath[PATH_MAX];
 static pid_t child_pids[MAX_CHILD_PROCS];
 static pthread_mutex_t test_ending_mtx;
@@ -85,6 +87,18 @@ static void spawn_child_process(void);
 static void run_test(void);
 static bool verify_generic_jetsam_criteria(void);
 static bool vme_zone_compares_to_vm_objects(void);
+static unsigned int get_zone_map_warnings(void)
+{
+	int ret;
+	unsigned int warnings = 0;
+	size_t warnings_size = sizeof(warnings);
+
+	ret = sysctlbyname("kern.memorystatus_zone_map_warnings", &warnings, &warnings_size, NULL, 0);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(ret, "sysctl kern.memorystatus_zone_map_warnings failed");
+
+	return warnings;
+}
+
 static void print_zone_map_size(void);
 static void query_zone_info(void);
 static void print_zone_info(mach_zone_name_t *zn, mach_zone_info_t *zi);
@@ -353,6 +367,9 @@ static void setup_ktrace_session(void)
 			}
 
 			T_ASSERT_TRUE(received_jetsam_event, "Received zone-map-exhaustion jetsam event as expected");
+
+			/* The zone map crosses its warning limit on the way to the jetsam limit */
+			T_EXPECT_GT(get_zone_map_warnings(), zone_map_warnings, "memorystatus was warned before zone-map-exhaustion jetsams");
 		}
 	});
 	T_QUIET; T_ASSERT_POSIX_ZERO(ret, "ktrace_events_single");
@@ -437,6 +454,8 @@ static void run_test(void)
 
 	zone_info_array = (mach_zone_info_array_t) calloc((unsigned long)current_test.num_zones, sizeof *zone_info_array);
 
+	zone_map_warnings = get_zone_map_warnings();
+
 	print_zone_map_size();
 
 	/*
@@ -534,3 +534,41 @@ T_DECL(setup_utun, "This test sets up a utun interface")
 	setup_utun_test();
 	setup_tunsock();
 }
+
+static void
+check_sw_offload(void)
+{
+	uint32_t sw_offload_tx = 0;
+	size_t len = sizeof(sw_offload_tx);
+	char ifname[IFXNAMSIZ];
+	struct ifreq ifr;
+	int tunsock;
+
+	if (sysctlbyname("net.link.generic.system.sw_offload_tx", &sw_offload_tx, &len, NULL, 0) != 0 ||
+			sw_offload_tx == 0) {
+		T_SKIP("software transmit offload not enabled");
+	}
+
+	T_ASSERT_GE(tunsock = create_tunsock(false, false, false), 0, NULL);
+	tunsock_get_ifname(tunsock, ifname);
+
+	memset(&ifr, 0, sizeof(ifr));
+	strlcpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name));
+	T_QUIET; T_WITH_ERRNO; T_ASSERT_POSIX_ZERO(ioctl(tunsock, SIOCGIFCAP, (caddr_t)&ifr), NULL);
+	T_EXPECT_EQ(ifr.ifr_curcap & IFCAP_TSO, IFCAP_TSO, "%s advertises TSO", ifname);
+	T_EXPECT_NE(ifr.ifr_curcap & IFCAP_TXCSUM, 0, "%s advertises checksum offload", ifname);
+
+	T_QUIET; T_WITH_ERRNO; T_EXPECT_POSIX_ZERO(close(tunsock), NULL);
+}
+
+T_DECL(ipsec_sw_offload, "This test checks that ipsec advertises software TSO and checksum offload")
+{
+	setup_ipsec_test();
+	check_sw_offload();
+}
+
+T_DECL(utun_sw_offload, "This test checks that utun advertises software TSO and checksum offload")
+{
+	setup_utun_test();
+	check_sw_offload();
+}
@@ -0,0 +1,138 @@
+#define PRIVATE
+#include <net/ntstat.h>
+#undef PRIVATE
+
+#include <darwintest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/kern_control.h>
+#include <sys/socket.h>
+#include <sys/sys_domain.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.net"));
+
+/*
+ * Query all TCP sources twice with NSTAT_MSG_HDR_FLAG_CHANGED_ONLY: the
+ * second query must leave out the idle connections reported by the first.
+ */
+
+static int
+nstat_open(void)
+{
+	struct ctl_info info;
+	struct sockaddr_ctl sc;
+	int s, bufsize = 1024 * 1024;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(s = socket(PF_SYSTEM, SOCK_DGRAM,
+	    SYSPROTO_CONTROL), "socket(SYSPROTO_CONTROL)");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(setsockopt(s, SOL_SOCKET, SO_RCVBUF,
+	    &bufsize, sizeof(bufsize)), "setsockopt(SO_RCVBUF)");
+
+	memset(&info, 0, sizeof(info));
+	strlcpy(info.ctl_name, NET_STAT_CONTROL_NAME, sizeof(info.ctl_name));
+	T_QUIET; T_ASSERT_POSIX_ZERO(ioctl(s, CTLIOCGINFO, &info), "CTLIOCGINFO");
+
+	memset(&sc, 0, sizeof(sc));
+	sc.sc_len = sizeof(sc);
+	sc.sc_family = AF_SYSTEM;
+	sc.ss_sysaddr = AF_SYS_CONTROL;
+	sc.sc_id = info.ctl_id;
+	T_QUIET; T_ASSERT_POSIX_ZERO(connect(s, (struct sockaddr *)&sc,
+	    sizeof(sc)), "connect(%s)", NET_STAT_CONTROL_NAME);
+	return s;
+}
+
+/* returns the number of counts messages received before the reply */
+static int
+nstat_wait(int s, u_int64_t context)
+{
+	static char buf[16384];
+	int counts = 0;
+
+	for (;;) {
+		ssize_t n, off;
+
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(n = recv(s, buf, sizeof(buf), 0),
+		    "recv");
+		for (off = 0; off + (ssize_t)sizeof(nstat_msg_hdr) <= n;) {
+			nstat_msg_hdr *hdr = (nstat_msg_hdr *)(void *)(buf + off);
+
+			T_QUIET; T_ASSERT_GE((int)hdr->length,
+			    (int)sizeof(nstat_msg_hdr), "message length");
+			if (hdr->type == NSTAT_MSG_TYPE_SRC_COUNTS) {
+				counts++;
+			} else if (hdr->context == context) {
+				T_QUIET; T_ASSERT_EQ(hdr->type,
+				    (u_int32_t)NSTAT_MSG_TYPE_SUCCESS, "reply");
+				return counts;
+			}
+			off += hdr->length;
+		}
+	}
+}
+
+static int
+nstat_query_changed(int s, u_int64_t context)
+{
+	nstat_msg_query_src_req req;
+
+	memset(&req, 0, sizeof(req));
+	req.hdr.type = NSTAT_MSG_TYPE_QUERY_SRC;
+	req.hdr.length = sizeof(req);
+	req.hdr.context = context;
+	req.hdr.flags = NSTAT_MSG_HDR_FLAG_SUPPORTS_AGGREGATE |
+	    NSTAT_MSG_HDR_FLAG_CHANGED_ONLY;
+	req.srcref = NSTAT_SRC_REF_ALL;
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(send(s, &req, sizeof(req), 0),
+	    "send(NSTAT_MSG_TYPE_QUERY_SRC)");
+	return nstat_wait(s, context);
+}
+
+T_DECL(ntstat_changed_only, "ntstat only reports sources that changed",
+    T_META_ASROOT(true))
+{
+	struct sockaddr_in sin = {
+		.sin_len = sizeof(sin),
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(sin);
+	nstat_msg_add_all_srcs add;
+	int s, l, c, a, first, second;
+
+	/* an idle connection for the first query to report */
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(l = socket(PF_INET, SOCK_STREAM, 0), "socket");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(bind(l, (struct sockaddr *)&sin,
+	    sizeof(sin)), "bind");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(listen(l, 1), "listen");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(getsockname(l, (struct sockaddr *)&sin,
+	    &len), "getsockname");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(c = socket(PF_INET, SOCK_STREAM, 0), "socket");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(connect(c, (struct sockaddr *)&sin,
+	    sizeof(sin)), "connect");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(a = accept(l, NULL, NULL), "accept");
+
+	s = nstat_open();
+	memset(&add, 0, sizeof(add));
+	add.hdr.type = NSTAT_MSG_TYPE_ADD_ALL_SRCS;
+	add.hdr.length = sizeof(add);
+	add.hdr.context = 1;
+	add.provider = NSTAT_PROVIDER_TCP_KERNEL;
+	add.filter = NSTAT_FILTER_SUPPRESS_SRC_ADDED;
+	T_ASSERT_POSIX_SUCCESS(send(s, &add, sizeof(add), 0),
+	    "send(NSTAT_MSG_TYPE_ADD_ALL_SRCS)");
+	(void) nstat_wait(s, 1);
+
+	first = nstat_query_changed(s, 2);
+	T_EXPECT_GE(first, 2, "first query reports the connection");
+	second = nstat_query_changed(s, 3);
+	T_EXPECT_LT(second, first, "second query leaves out idle sources");
+
+	close(s);
+	close(a);
+	close(c);
+	close(l);
+}
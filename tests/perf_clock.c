@@ -0,0 +1,107 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Measure reading every user-visible clock, next to the traps the clocks
+ * read from the commpage would otherwise take.
+ */
+
+static const struct {
+	clockid_t clock;
+	const char *name;
+} perf_clocks[] = {
+	{ CLOCK_REALTIME, "CLOCK_REALTIME" },
+	{ CLOCK_MONOTONIC, "CLOCK_MONOTONIC" },
+	{ CLOCK_MONOTONIC_RAW, "CLOCK_MONOTONIC_RAW" },
+	{ CLOCK_MONOTONIC_RAW_APPROX, "CLOCK_MONOTONIC_RAW_APPROX" },
+	{ CLOCK_UPTIME_RAW, "CLOCK_UPTIME_RAW" },
+	{ CLOCK_UPTIME_RAW_APPROX, "CLOCK_UPTIME_RAW_APPROX" },
+	{ CLOCK_PROCESS_CPUTIME_ID, "CLOCK_PROCESS_CPUTIME_ID" },
+	{ CLOCK_THREAD_CPUTIME_ID, "CLOCK_THREAD_CPUTIME_ID" },
+};
+
+T_DECL(perf_clock_gettime, "clock_gettime_nsec_np() of every clock")
+{
+	for (size_t i = 0; i < sizeof(perf_clocks) / sizeof(perf_clocks[0]); i++) {
+		dt_stat_time_t s = dt_stat_time_create("%s", perf_clocks[i].name);
+		T_STAT_MEASURE_LOOP(s) {
+			(void)clock_gettime_nsec_np(perf_clocks[i].clock);
+		}
+		dt_stat_finalize(s);
+	}
+}
+
+T_DECL(perf_mach_time, "mach time functions read from the commpage")
+{
+	uint64_t absolute, continuous;
+	struct timespec ts;
+
+	dt_stat_time_t s = dt_stat_time_create("mach_absolute_time");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)mach_absolute_time();
+	}
+	dt_stat_finalize(s);
+
+	s = dt_stat_time_create("mach_approximate_time");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)mach_approximate_time();
+	}
+	dt_stat_finalize(s);
+
+	s = dt_stat_time_create("mach_continuous_time");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)mach_continuous_time();
+	}
+	dt_stat_finalize(s);
+
+	s = dt_stat_time_create("mach_continuous_approximate_time");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)mach_continuous_approximate_time();
+	}
+	dt_stat_finalize(s);
+
+	s = dt_stat_time_create("mach_get_times");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)mach_get_times(&absolute, &continuous, &ts);
+	}
+	dt_stat_finalize(s);
+}
+
+T_DECL(perf_clock_traps, "traps reading the clocks")
+{
+	mach_msg_type_number_t count;
+	thread_basic_info_data_t info;
+	mach_port_t thread = mach_thread_self();
+	struct timeval tv;
+
+	dt_stat_time_t s = dt_stat_time_create("gettimeofday_syscall");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)syscall(SYS_gettimeofday, &tv, NULL, NULL);
+	}
+	dt_stat_finalize(s);
+
+	s = dt_stat_time_create("thread_info_basic");
+	T_STAT_MEASURE_LOOP(s) {
+		count = THREAD_BASIC_INFO_COUNT;
+		(void)thread_info(thread, THREAD_BASIC_INFO,
+		    (thread_info_t)&info, &count);
+	}
+	dt_stat_finalize(s);
+
+	(void)mach_port_deallocate(mach_task_self(), thread);
+}
@@ -33,14 +33,17 @@ T_GLOBAL_META(
 struct test_case {
 	int wired_mem;
 	int threads;
+	int resident_mem;
 };
 
 static struct test_case test_cases[] = {
-	{0, 0},
-	{0, 10},
-	{1000000, 0},
+	{0, 0, 0},
+	{0, 10, 0},
+	{1000000, 0, 0},
+	{0, 0, 256 << 20},
 #if !TARGET_OS_WATCH
-	{10000000, 0}
+	{10000000, 0, 0},
+	{0, 0, 1 << 30},
 #endif
 };
 
@@ -68,19 +71,21 @@ static void cleanup(void) {
 }
 
 static dt_stat_time_t
-create_stat(int proc_wired_mem, int nthreads)
+create_stat(int proc_wired_mem, int nthreads, int proc_resident_mem)
 {
 	dt_stat_time_t dst = dt_stat_time_create("time");
 	T_ASSERT_NOTNULL(dst, "created time statistic");
 
 	dt_stat_set_variable((dt_stat_t)dst, "proc_threads", nthreads);
 	dt_stat_set_variable((dt_stat_t)dst, "proc_wired_mem", proc_wired_mem);;
+	dt_stat_set_variable((dt_stat_t)dst, "proc_resident_mem", proc_resident_mem);
 
 	return dst;
 }
 
 T_DECL(exit, "exit(2) time from syscall start to end", T_META_TIMEOUT(TEST_TIMEOUT)) {
-	s = create_stat(test_cases[consumer_i].wired_mem, test_cases[consumer_i].threads);
+	s = create_stat(test_cases[consumer_i].wired_mem, test_cases[consumer_i].threads,
+	    test_cases[consumer_i].resident_mem);
 
 	begin_ts = malloc(sizeof(uint64_t) * PID_MAX);
 	T_ASSERT_NOTNULL(begin_ts, "created pid array");
@@ -116,7 +121,8 @@ T_DECL(exit, "exit(2) time from syscall start to end", T_META_TIMEOUT(TEST_TIMEO
 			ktrace_end(session, 1);
 		}
 		else {
-			s = create_stat(test_cases[consumer_i].wired_mem, test_cases[consumer_i].threads);
+			s = create_stat(test_cases[consumer_i].wired_mem, test_cases[consumer_i].threads,
+			    test_cases[consumer_i].resident_mem);
 		}
 	});
 
@@ -151,7 +157,7 @@ T_DECL(exit, "exit(2) time from syscall start to end", T_META_TIMEOUT(TEST_TIMEO
 	// Spawn processes continuously until the test is over
 
 	__block void (^spawn_process)(void) = Block_copy(^(void) {
-		char nthreads_buf[32], mem_buf[32];
+		char nthreads_buf[32], mem_buf[32], resident_buf[32];
 
 		if (producer_i >= TEST_CASES_COUNT || !tracing_on) {
 			return;
@@ -159,13 +165,15 @@ T_DECL(exit, "exit(2) time from syscall start to end", T_META_TIMEOUT(TEST_TIMEO
 
 		snprintf(nthreads_buf, 32, "%d", test_cases[producer_i].threads);
 		snprintf(mem_buf, 32, "%d", test_cases[producer_i].wired_mem);
+		snprintf(resident_buf, 32, "%d", test_cases[producer_i].resident_mem);
 
-		char *args[] = {EXIT_BINARY_PATH, nthreads_buf, mem_buf, NULL};
+		char *args[] = {EXIT_BINARY_PATH, nthreads_buf, mem_buf, resident_buf, NULL};
 		int status;
 
 		pid_t pid;
 		int bret = posix_spawn(&pid, args[0], NULL, NULL, args, NULL);
-		T_ASSERT_POSIX_ZERO(bret, "spawned process with pid %d (threads=%s mem=%s)", pid, nthreads_buf, mem_buf);
+		T_ASSERT_POSIX_ZERO(bret, "spawned process with pid %d (threads=%s mem=%s resident=%s)",
+		    pid, nthreads_buf, mem_buf, resident_buf);
 
 		bret = waitpid(pid, &status, 0);
 		T_QUIET; T_ASSERT_POSIX_SUCCESS(bret, "waited for process %d\n", pid);
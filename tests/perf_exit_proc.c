@@ -60,10 +60,30 @@ static int allocate_and_wire_memory(mach_vm_size_t size) {
 	return 0;
 }
 
+static int allocate_and_touch_memory(mach_vm_size_t size) {
+	int err;
+	mach_vm_address_t addr;
+
+	if (size <= 0)
+		return 0;
+
+	err = mach_vm_allocate(mach_task_self(), &addr, size, VM_FLAGS_ANYWHERE);
+	if (err != KERN_SUCCESS) {
+		printf("mach_vm_allocate returned non-zero: %s\n", mach_error_string(err));
+		return err;
+	}
+	for (mach_vm_size_t off = 0; off < size; off += vm_page_size) {
+		*(volatile char *)(addr + off) = 1;
+	}
+
+	return 0;
+}
+
 int main(int argc, char *argv[]) {
 	int nthreads = 0;
 	int err;
 	mach_vm_size_t wired_mem = 0;
+	mach_vm_size_t resident_mem = 0;
 
 	if (argc > 1) {
 		nthreads = (int)strtoul(argv[1], NULL, 10);
@@ -71,12 +91,20 @@ int main(int argc, char *argv[]) {
 	if (argc > 2) {
 		wired_mem = (mach_vm_size_t)strtoul(argv[2], NULL, 10);
 	}
+	if (argc > 3) {
+		resident_mem = (mach_vm_size_t)strtoul(argv[3], NULL, 10);
+	}
 	
 	err = allocate_and_wire_memory(wired_mem);
 	if (err) {
 		return err;
 	}
 
+	err = allocate_and_touch_memory(resident_mem);
+	if (err) {
+		return err;
+	}
+
 	err = run_additional_threads(nthreads);
 	if (err) {
 		return err;
@@ -0,0 +1,177 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.io"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Read latency over the buffered, uncached and mmap paths, for sequential
+ * and random 4k reads, plus uncached random reads at a few AIO queue depths.
+ * Run it on a volume throttled with the disk conditioner to see how the
+ * paths behave on slower media.
+ */
+
+#define FILE_SIZE   (64 * 1024 * 1024)
+#define IO_SIZE     4096
+#define NBLOCKS     (FILE_SIZE / IO_SIZE)
+#define MAX_QDEPTH  16
+
+static char test_path[] = "/tmp/perf_io_patterns.XXXXXX";
+
+static void
+cleanup_test_file(void)
+{
+	unlink(test_path);
+}
+
+static int
+create_test_file(void)
+{
+	char *buf;
+	int fd;
+
+	fd = mkstemp(test_path);
+	T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	T_ATEND(cleanup_test_file);
+
+	buf = malloc(1024 * 1024);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	for (size_t i = 0; i < 1024 * 1024; i++) {
+		buf[i] = (char)random();
+	}
+	for (int i = 0; i < FILE_SIZE / (1024 * 1024); i++) {
+		T_QUIET; T_ASSERT_EQ(write(fd, buf, 1024 * 1024), (ssize_t)(1024 * 1024),
+		    "write test file");
+	}
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(fsync(fd), "fsync");
+	free(buf);
+	return fd;
+}
+
+static off_t
+next_offset(bool random_io, uint64_t i)
+{
+	if (random_io) {
+		return (off_t)(arc4random_uniform(NBLOCKS)) * IO_SIZE;
+	}
+	return (off_t)(i % NBLOCKS) * IO_SIZE;
+}
+
+static void
+measure_pread(int fd, bool random_io, const char *name)
+{
+	char buf[IO_SIZE];
+	uint64_t i = 0;
+
+	dt_stat_time_t s = dt_stat_time_create("%s", name);
+	T_STAT_MEASURE_LOOP(s) {
+		T_QUIET; T_ASSERT_EQ(pread(fd, buf, IO_SIZE, next_offset(random_io, i++)),
+		    (ssize_t)IO_SIZE, "pread");
+	}
+	dt_stat_finalize(s);
+}
+
+static void
+measure_mmap(int fd, bool random_io, const char *name)
+{
+	volatile char *base;
+	uint64_t i = 0;
+	char c = 0;
+
+	base = mmap(NULL, FILE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+	T_ASSERT_NE((void *)base, MAP_FAILED, "mmap");
+
+	/* drop the clean cached pages so the reads fault from the disk */
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(msync((void *)base, FILE_SIZE, MS_INVALIDATE),
+	    "msync(MS_INVALIDATE)");
+
+	dt_stat_time_t s = dt_stat_time_create("%s", name);
+	T_STAT_MEASURE_LOOP(s) {
+		c ^= base[next_offset(random_io, i++)];
+	}
+	dt_stat_finalize(s);
+	(void)c;
+
+	munmap((void *)base, FILE_SIZE);
+}
+
+T_DECL(perf_io_read_paths, "4k read latency over the buffered, uncached and mmap paths")
+{
+	int fd = create_test_file();
+	int nocache_fd;
+
+	measure_pread(fd, false, "seq_read_buffered");
+	measure_pread(fd, true, "rand_read_buffered");
+
+	nocache_fd = open(test_path, O_RDONLY);
+	T_ASSERT_POSIX_SUCCESS(nocache_fd, "open");
+	T_ASSERT_POSIX_SUCCESS(fcntl(nocache_fd, F_NOCACHE, 1), "F_NOCACHE");
+	T_ASSERT_POSIX_SUCCESS(fcntl(nocache_fd, F_RDAHEAD, 0), "F_RDAHEAD off");
+	measure_pread(nocache_fd, false, "seq_read_nocache");
+	measure_pread(nocache_fd, true, "rand_read_nocache");
+	close(nocache_fd);
+
+	measure_mmap(fd, false, "seq_read_mmap");
+	measure_mmap(fd, true, "rand_read_mmap");
+
+	close(fd);
+}
+
+T_DECL(perf_io_aio_qdepth, "uncached random 4k reads at several AIO queue depths")
+{
+	static const int qdepths[] = { 1, 4, MAX_QDEPTH };
+	struct aiocb cbs[MAX_QDEPTH], *list[MAX_QDEPTH];
+	char name[64];
+	char *bufs;
+	int fd;
+
+	fd = create_test_file();
+	T_ASSERT_POSIX_SUCCESS(fcntl(fd, F_NOCACHE, 1), "F_NOCACHE");
+
+	bufs = malloc(MAX_QDEPTH * IO_SIZE);
+	T_QUIET; T_ASSERT_NOTNULL(bufs, "malloc");
+
+	for (size_t q = 0; q < sizeof(qdepths) / sizeof(qdepths[0]); q++) {
+		int qd = qdepths[q];
+
+		snprintf(name, sizeof(name), "aio_rand_read_qd%d", qd);
+		dt_stat_time_t s = dt_stat_time_create("%s", name);
+		T_STAT_MEASURE_LOOP(s) {
+			for (int i = 0; i < qd; i++) {
+				memset(&cbs[i], 0, sizeof(cbs[i]));
+				cbs[i].aio_fildes = fd;
+				cbs[i].aio_offset = next_offset(true, 0);
+				cbs[i].aio_buf = bufs + i * IO_SIZE;
+				cbs[i].aio_nbytes = IO_SIZE;
+				cbs[i].aio_lio_opcode = LIO_READ;
+				list[i] = &cbs[i];
+			}
+			T_QUIET; T_ASSERT_POSIX_SUCCESS(lio_listio(LIO_WAIT, list, qd, NULL),
+			    "lio_listio");
+			for (int i = 0; i < qd; i++) {
+				T_QUIET; T_ASSERT_EQ(aio_return(&cbs[i]), (ssize_t)IO_SIZE,
+				    "read %d is complete", i);
+			}
+		}
+		dt_stat_finalize(s);
+	}
+
+	free(bufs);
+	close(fd);
+}
@@ -64,6 +64,27 @@ static void _sysctl_nowrap(bool is_nowrap) {
 	}
 }
 
+static uint64_t _sysctl_cpulost(void) {
+	int mib[] = { CTL_KERN, KERN_KDEBUG, KERN_KDCPULOST };
+	uint64_t *lost, total = 0;
+	size_t needed = 0;
+	if (sysctl(mib, 3, NULL, &needed, NULL, 0)) {
+		T_FAIL("KERN_KDCPULOST sysctl failed");
+		return 0;
+	}
+	lost = malloc(needed);
+	T_QUIET; T_ASSERT_NOTNULL(lost, "malloc");
+	if (sysctl(mib, 3, lost, &needed, NULL, 0)) {
+		T_FAIL("KERN_KDCPULOST sysctl failed");
+	}
+	for (size_t cpu = 0; cpu < needed / sizeof(uint64_t); cpu++) {
+		T_LOG("cpu %zu lost %llu events", cpu, lost[cpu]);
+		total += lost[cpu];
+	}
+	free(lost);
+	return total;
+}
+
 static void enable_tracing(bool value) {
 	_sysctl_enable(value ? KDEBUG_ENABLE_TRACE : 0);
 }
@@ -166,3 +187,10 @@ T_DECL(kdebug_trace_kdbg_enabled_typefilter_reject,
        "Test the latency of kdebug_trace while kernel tracing is enabled with a typefilter that rejects the event") {
 	test("kdebug_trace_kdbg_enabled_typefilter_reject", ^{ enable_tracing(true); enable_typefilter_all_reject(); }, loop_kdebug_trace);
 }
+
+T_DECL(kdebug_trace_kdbg_enabled_lost,
+       "Test the latency of kdebug_trace while kernel tracing wraps its buffers, and report the events lost per CPU") {
+	test("kdebug_trace_kdbg_enabled_lost", ^{ enable_tracing(true); }, loop_kdebug_trace);
+	enable_tracing(false);
+	T_EXPECT_GT(_sysctl_cpulost(), 0ULL, "wrapping the trace buffers loses events");
+}
@@ -0,0 +1,136 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Measure fcntl() byte-range lock and unlock of one small range, the way
+ * databases lock pages and WAL slots, while many other ranges of the file
+ * are held, and while other threads lock their own ranges through open
+ * file description locks.
+ */
+
+#define LOCKF_THREADS 4
+#define LOCKF_THREAD_OPS 100000
+
+static void
+set_lock(int fd, int cmd, short type, off_t start, off_t len)
+{
+	struct flock fl = {
+		.l_start = start,
+		.l_len = len,
+		.l_type = type,
+		.l_whence = SEEK_SET,
+	};
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(fcntl(fd, cmd, &fl), "fcntl");
+}
+
+static int
+lockf_file(void)
+{
+	char path[] = "/tmp/perf_lockf.XXXXXX";
+	int fd;
+
+	fd = mkstemp(path);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(unlink(path), "unlink");
+	return fd;
+}
+
+static void
+lockf_held_ranges(int held)
+{
+	char name[64];
+	int fd = lockf_file();
+
+	/* leave a gap between ranges so that they don't coalesce */
+	for (int i = 0; i < held; i++) {
+		set_lock(fd, F_SETLK, F_WRLCK, 2 * i, 1);
+	}
+
+	snprintf(name, sizeof(name), "lock_unlock_%d_held", held);
+	dt_stat_time_t s = dt_stat_time_create(name);
+	while (!dt_stat_stable(s)) {
+		T_STAT_MEASURE(s) {
+			set_lock(fd, F_SETLK, F_WRLCK, 2 * held, 1);
+			set_lock(fd, F_SETLK, F_UNLCK, 2 * held, 1);
+		}
+	}
+	dt_stat_finalize(s);
+
+	close(fd);
+}
+
+T_DECL(lockf_lock_unlock_few, "lock and unlock a range with 16 ranges held")
+{
+	lockf_held_ranges(16);
+}
+
+T_DECL(lockf_lock_unlock_many, "lock and unlock a range with 4096 ranges held")
+{
+	lockf_held_ranges(4096);
+}
+
+struct lockf_thread_args {
+	int fd;
+	off_t start;
+};
+
+static void *
+lockf_thread(void *arg)
+{
+	struct lockf_thread_args *ta = arg;
+
+	for (int i = 0; i < LOCKF_THREAD_OPS; i++) {
+		set_lock(ta->fd, F_OFD_SETLKW, F_WRLCK, ta->start, 16);
+		set_lock(ta->fd, F_OFD_SETLK, F_UNLCK, ta->start, 16);
+	}
+	return NULL;
+}
+
+T_DECL(lockf_threads, "threads locking their own ranges of a shared file")
+{
+	struct lockf_thread_args args[LOCKF_THREADS];
+	pthread_t threads[LOCKF_THREADS];
+	char path[] = "/tmp/perf_lockf_threads.XXXXXX";
+	int fd;
+
+	fd = mkstemp(path);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+
+	dt_stat_time_t s = dt_stat_time_create("lock_unlock_%d_threads", LOCKF_THREADS);
+	while (!dt_stat_stable(s)) {
+		T_STAT_MEASURE(s) {
+			for (int i = 0; i < LOCKF_THREADS; i++) {
+				/* each thread locks through its own open file description */
+				args[i].fd = open(path, O_RDWR);
+				T_QUIET; T_ASSERT_POSIX_SUCCESS(args[i].fd, "open");
+				args[i].start = 16 * i;
+				T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&threads[i], NULL,
+				    lockf_thread, &args[i]), "pthread_create");
+			}
+			for (int i = 0; i < LOCKF_THREADS; i++) {
+				T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(threads[i], NULL),
+				    "pthread_join");
+				close(args[i].fd);
+			}
+		}
+	}
+	dt_stat_finalize(s);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(unlink(path), "unlink");
+	close(fd);
+}
@@ -0,0 +1,223 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.net"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Stack-only network benchmarks over lo0: UDP request/response across a
+ * growing number of flows, which exercises the pcb lookup, plus TCP
+ * request/response latency and TCP streaming throughput.
+ */
+
+#define MAX_FLOWS   4096
+#define PACKET_SIZE 64
+#define STREAM_SIZE (64 * 1024)
+
+static void
+loopback_addr(struct sockaddr_in *sin, in_port_t port)
+{
+	memset(sin, 0, sizeof(*sin));
+	sin->sin_len = sizeof(*sin);
+	sin->sin_family = AF_INET;
+	sin->sin_port = port;
+	sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+static int
+bound_socket(int type, struct sockaddr_in *sin)
+{
+	socklen_t len = sizeof(*sin);
+	int s;
+
+	s = socket(AF_INET, type, 0);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(s, "socket");
+	loopback_addr(sin, 0);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(bind(s, (struct sockaddr *)sin, sizeof(*sin)), "bind");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(getsockname(s, (struct sockaddr *)sin, &len), "getsockname");
+	return s;
+}
+
+static void
+tcp_pair(int *client, int *server)
+{
+	struct sockaddr_in sin;
+	int one = 1;
+	int l;
+
+	l = bound_socket(SOCK_STREAM, &sin);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(listen(l, 1), "listen");
+
+	*client = socket(AF_INET, SOCK_STREAM, 0);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(*client, "socket");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(connect(*client, (struct sockaddr *)&sin, sizeof(sin)),
+	    "connect");
+	*server = accept(l, NULL, NULL);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(*server, "accept");
+	close(l);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(setsockopt(*client, IPPROTO_TCP, TCP_NODELAY,
+	    &one, sizeof(one)), "TCP_NODELAY");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(setsockopt(*server, IPPROTO_TCP, TCP_NODELAY,
+	    &one, sizeof(one)), "TCP_NODELAY");
+}
+
+static void
+read_fully(int s, char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = read(s, buf, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		T_QUIET; T_ASSERT_GT(n, 0L, "read");
+		buf += n;
+		len -= (size_t)n;
+	}
+}
+
+T_DECL(perf_udp_flows, "UDP request/response over lo0 spread across many flows")
+{
+	static const int nflows[] = { 1, 64, 1024, MAX_FLOWS };
+	struct sockaddr_in sin, *addrs;
+	struct rlimit rl;
+	char buf[PACKET_SIZE];
+	int *socks;
+	int sender;
+
+	T_ASSERT_POSIX_SUCCESS(getrlimit(RLIMIT_NOFILE, &rl), "getrlimit");
+	if (rl.rlim_cur < MAX_FLOWS + 64) {
+		rl.rlim_cur = MAX_FLOWS + 64;
+		T_ASSERT_POSIX_SUCCESS(setrlimit(RLIMIT_NOFILE, &rl), "setrlimit");
+	}
+
+	socks = calloc(MAX_FLOWS, sizeof(*socks));
+	addrs = calloc(MAX_FLOWS, sizeof(*addrs));
+	T_QUIET; T_ASSERT_NOTNULL(socks, "calloc");
+	T_QUIET; T_ASSERT_NOTNULL(addrs, "calloc");
+
+	sender = bound_socket(SOCK_DGRAM, &sin);
+	memset(buf, 0, sizeof(buf));
+
+	int created = 0;
+	for (size_t f = 0; f < sizeof(nflows) / sizeof(nflows[0]); f++) {
+		int n = nflows[f];
+		int i = 0;
+
+		for (; created < n; created++) {
+			socks[created] = bound_socket(SOCK_DGRAM, &addrs[created]);
+		}
+
+		dt_stat_time_t s = dt_stat_time_create("udp_rr_flows_%d", n);
+		T_STAT_MEASURE_LOOP(s) {
+			T_QUIET; T_ASSERT_EQ(sendto(sender, buf, sizeof(buf), 0,
+			    (struct sockaddr *)&addrs[i], sizeof(addrs[i])), (ssize_t)sizeof(buf),
+			    "sendto");
+			T_QUIET; T_ASSERT_EQ(recv(socks[i], buf, sizeof(buf), 0), (ssize_t)sizeof(buf),
+			    "recv");
+			i = (i + 1) % n;
+		}
+		dt_stat_finalize(s);
+	}
+
+	for (int i = 0; i < created; i++) {
+		close(socks[i]);
+	}
+	close(sender);
+	free(addrs);
+	free(socks);
+}
+
+T_DECL(perf_tcp_rr, "TCP request/response latency over lo0")
+{
+	char buf[PACKET_SIZE];
+	int client, server;
+
+	tcp_pair(&client, &server);
+	memset(buf, 0, sizeof(buf));
+
+	dt_stat_time_t s = dt_stat_time_create("tcp_rr_64");
+	T_STAT_MEASURE_LOOP(s) {
+		T_QUIET; T_ASSERT_EQ(write(client, buf, sizeof(buf)), (ssize_t)sizeof(buf), "write");
+		read_fully(server, buf, sizeof(buf));
+		T_QUIET; T_ASSERT_EQ(write(server, buf, sizeof(buf)), (ssize_t)sizeof(buf), "write");
+		read_fully(client, buf, sizeof(buf));
+	}
+	dt_stat_finalize(s);
+
+	close(client);
+	close(server);
+}
+
+static void *
+drain_socket(void *arg)
+{
+	int s = *(int *)arg;
+	char buf[STREAM_SIZE];
+
+	for (;;) {
+		ssize_t n = read(s, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+T_DECL(perf_tcp_stream, "TCP streaming over lo0 with a reader on the other end")
+{
+	pthread_t reader;
+	int client, server;
+	char *buf;
+
+	tcp_pair(&client, &server);
+
+	buf = malloc(STREAM_SIZE);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	memset(buf, 'x', STREAM_SIZE);
+
+	T_ASSERT_POSIX_ZERO(pthread_create(&reader, NULL, drain_socket, &server),
+	    "pthread_create");
+
+	dt_stat_time_t s = dt_stat_time_create("tcp_stream_64k");
+	T_STAT_MEASURE_LOOP(s) {
+		size_t left = STREAM_SIZE;
+		char *p = buf;
+
+		while (left > 0) {
+			ssize_t n = write(client, p, left);
+			if (n < 0) {
+				T_QUIET; T_ASSERT_EQ(errno, EINTR, "write");
+				continue;
+			}
+			p += n;
+			left -= (size_t)n;
+		}
+	}
+	dt_stat_finalize(s);
+
+	close(client);
+	T_ASSERT_POSIX_ZERO(pthread_join(reader, NULL), "pthread_join");
+	close(server);
+	free(buf);
+}
@@ -0,0 +1,101 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <libproc.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <sys/proc_info.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Measure proc_pidinfo() of one process, the way monitoring tools poll
+ * every pid, from several threads at once, each lookup finding the pid
+ * and dropping its reference on the process, while other threads fork
+ * and reap children that come and go from the pid hash.
+ */
+
+#define PROC_FIND_THREADS 4
+#define PROC_FIND_THREAD_OPS 100000
+
+static volatile int proc_find_done;
+
+static void *
+proc_find_thread(void *arg)
+{
+	pid_t pid = (pid_t)(uintptr_t)arg;
+	struct proc_bsdinfo pbsd;
+
+	for (int i = 0; i < PROC_FIND_THREAD_OPS; i++) {
+		T_QUIET; T_ASSERT_EQ(proc_pidinfo(pid, PROC_PIDTBSDINFO, 0,
+		    &pbsd, sizeof(pbsd)), (int)sizeof(pbsd), "proc_pidinfo");
+	}
+	return NULL;
+}
+
+static void *
+proc_churn_thread(__unused void *arg)
+{
+	char *args[] = { "/usr/bin/true", NULL };
+	pid_t child;
+	int status;
+
+	while (!proc_find_done) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(posix_spawn(&child, args[0], NULL,
+		    NULL, args, NULL), "posix_spawn");
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(waitpid(child, &status, 0), "waitpid");
+	}
+	return NULL;
+}
+
+static void
+proc_find_threads(pid_t pid, int churn)
+{
+	pthread_t threads[PROC_FIND_THREADS];
+	pthread_t churner;
+
+	dt_stat_time_t s = dt_stat_time_create(churn ?
+	    "pidinfo_%d_threads_churn" : "pidinfo_%d_threads", PROC_FIND_THREADS);
+	while (!dt_stat_stable(s)) {
+		proc_find_done = 0;
+		if (churn) {
+			T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&churner, NULL,
+			    proc_churn_thread, NULL), "pthread_create");
+		}
+		T_STAT_MEASURE(s) {
+			for (int i = 0; i < PROC_FIND_THREADS; i++) {
+				T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&threads[i], NULL,
+				    proc_find_thread, (void *)(uintptr_t)pid), "pthread_create");
+			}
+			for (int i = 0; i < PROC_FIND_THREADS; i++) {
+				T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(threads[i], NULL),
+				    "pthread_join");
+			}
+		}
+		proc_find_done = 1;
+		if (churn) {
+			T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(churner, NULL),
+			    "pthread_join");
+		}
+	}
+	dt_stat_finalize(s);
+}
+
+T_DECL(proc_find_threads, "threads looking up the same pid")
+{
+	proc_find_threads(getpid(), 0);
+}
+
+T_DECL(proc_find_threads_churn, "threads looking up a pid while processes come and go")
+{
+	proc_find_threads(getpid(), 1);
+}
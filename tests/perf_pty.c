@@ -0,0 +1,91 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <util.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Measure streaming output through a pty, the way build logs go from a
+ * job writing to its terminal to the process reading the master side.
+ */
+
+#define CHUNK_SIZE (16 * 1024)
+
+static void *
+drain_master(void *arg)
+{
+	int master = *(int *)arg;
+	char buf[CHUNK_SIZE];
+
+	for (;;) {
+		ssize_t n = read(master, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+static void
+write_all(int fd, const char *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = write(fd, buf, len);
+		if (n < 0) {
+			T_QUIET; T_ASSERT_EQ(errno, EINTR, "write to the slave");
+			continue;
+		}
+		buf += n;
+		len -= (size_t)n;
+	}
+}
+
+T_DECL(perf_pty_throughput, "writing to a pty slave with a reader on the master")
+{
+	struct termios tio;
+	pthread_t reader;
+	int master, slave;
+	char *buf;
+
+	T_ASSERT_POSIX_SUCCESS(openpty(&master, &slave, NULL, NULL, NULL), "openpty");
+
+	/* raw mode with a high speed, so output isn't post-processed or trickled */
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(tcgetattr(slave, &tio), "tcgetattr");
+	cfmakeraw(&tio);
+	cfsetspeed(&tio, B230400);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(tcsetattr(slave, TCSANOW, &tio), "tcsetattr");
+
+	buf = malloc(CHUNK_SIZE);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	memset(buf, 'x', CHUNK_SIZE);
+
+	T_ASSERT_POSIX_ZERO(pthread_create(&reader, NULL, drain_master, &master),
+	    "pthread_create");
+
+	dt_stat_time_t s = dt_stat_time_create("pty_write_16k");
+	T_STAT_MEASURE_LOOP(s) {
+		write_all(slave, buf, CHUNK_SIZE);
+	}
+	dt_stat_finalize(s);
+
+	close(slave);
+	T_ASSERT_POSIX_ZERO(pthread_join(reader, NULL), "pthread_join");
+	close(master);
+	free(buf);
+}
@@ -0,0 +1,122 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <mach/mach.h>
+#include <mach/semaphore.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Measure cross-thread wakeup latency while every processor is kept busy
+ * making threads runnable, the load under which run queue and pset lock
+ * contention in thread_setrun() and work stealing show up.
+ */
+
+struct pingpong {
+	semaphore_t ping;
+	semaphore_t pong;
+};
+
+static _Atomic bool done;
+
+static void *
+ponger(void *arg)
+{
+	struct pingpong *pp = arg;
+
+	for (;;) {
+		semaphore_wait(pp->ping);
+		semaphore_signal(pp->pong);
+		if (atomic_load(&done)) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+static void *
+background_pinger(void *arg)
+{
+	struct pingpong *pp = arg;
+
+	while (!atomic_load(&done)) {
+		semaphore_signal(pp->ping);
+		semaphore_wait(pp->pong);
+	}
+	semaphore_signal(pp->ping);
+	return NULL;
+}
+
+static void
+pingpong_init(struct pingpong *pp)
+{
+	T_QUIET; T_ASSERT_MACH_SUCCESS(semaphore_create(mach_task_self(), &pp->ping,
+	    SYNC_POLICY_FIFO, 0), "semaphore_create");
+	T_QUIET; T_ASSERT_MACH_SUCCESS(semaphore_create(mach_task_self(), &pp->pong,
+	    SYNC_POLICY_FIFO, 0), "semaphore_create");
+}
+
+T_DECL(sched_wakeup_latency_loaded,
+       "semaphore ping-pong latency with all processors waking threads")
+{
+	struct pingpong measured, *bg;
+	pthread_t measured_thread, *bg_threads;
+	char sched[32] = "";
+	size_t size = sizeof(sched);
+	int ncpu = 0, npairs, i;
+
+	size = sizeof(ncpu);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("hw.ncpu", &ncpu, &size, NULL, 0),
+	    "sysctl hw.ncpu");
+	size = sizeof(sched);
+	if (sysctlbyname("kern.sched", sched, &size, NULL, 0) == 0) {
+		T_LOG("scheduler: %s", sched);
+	}
+
+	/* two background pairs per processor keep every run queue busy */
+	npairs = ncpu * 2;
+	bg = calloc(npairs, sizeof(*bg));
+	bg_threads = calloc(npairs * 2, sizeof(*bg_threads));
+	T_QUIET; T_ASSERT_NOTNULL(bg, "calloc");
+	T_QUIET; T_ASSERT_NOTNULL(bg_threads, "calloc");
+
+	for (i = 0; i < npairs; i++) {
+		pingpong_init(&bg[i]);
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&bg_threads[2 * i], NULL,
+		    ponger, &bg[i]), "pthread_create");
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&bg_threads[2 * i + 1], NULL,
+		    background_pinger, &bg[i]), "pthread_create");
+	}
+
+	pingpong_init(&measured);
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&measured_thread, NULL, ponger,
+	    &measured), "pthread_create");
+
+	dt_stat_time_t s = dt_stat_time_create("round_trip_time");
+	while (!dt_stat_stable(s)) {
+		T_STAT_MEASURE(s) {
+			semaphore_signal(measured.ping);
+			semaphore_wait(measured.pong);
+		}
+	}
+	dt_stat_finalize(s);
+
+	atomic_store(&done, true);
+	semaphore_signal(measured.ping);
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(measured_thread, NULL), "pthread_join");
+	for (i = 0; i < npairs * 2; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(bg_threads[i], NULL), "pthread_join");
+	}
+	free(bg_threads);
+	free(bg);
+}
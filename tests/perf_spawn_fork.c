@@ -3,8 +3,13 @@
 #endif
 #include <darwintest.h>
 
+#include <dispatch/dispatch.h>
+#include <ktrace/session.h>
+#include <mach/mach.h>
 #include <spawn.h>
 #include <stdlib.h>
+#include <sys/kdebug.h>
+#include <sys/sysctl.h>
 #include <unistd.h>
 
 T_GLOBAL_META(
@@ -74,3 +79,157 @@ T_DECL(fork, "fork latency") {
 		dt_stat_finalize(s);
 	}
 }
+
+/*
+ * Fork latency with a big address space: "dense" touches every page of
+ * a large allocation, "sparse" reserves a much larger one and touches
+ * one page in every 2MB of it.
+ */
+#define LARGE_DENSE_SIZE	(1ULL << 30)
+#define LARGE_SPARSE_SIZE	(32ULL << 30)
+#define LARGE_SPARSE_STRIDE	(2ULL << 20)
+
+static void
+fork_large(mach_vm_size_t size, mach_vm_size_t stride)
+{
+	mach_vm_address_t addr = 0;
+	mach_vm_size_t off;
+	kern_return_t kr;
+
+	kr = mach_vm_allocate(mach_task_self(), &addr, size, VM_FLAGS_ANYWHERE);
+	T_QUIET; T_ASSERT_MACH_SUCCESS(kr, "mach_vm_allocate(%llu)", size);
+	for (off = 0; off < size; off += stride) {
+		*(volatile char *)(addr + off) = 1;
+	}
+
+	{
+		dt_stat_time_t s = dt_stat_time_create("time");
+		FORK_MEASURE_LOOP(s);
+		dt_stat_finalize(s);
+	}
+
+	(void)mach_vm_deallocate(mach_task_self(), addr, size);
+}
+
+T_DECL(fork_large_dense, "fork latency with 1GB resident") {
+	fork_large(LARGE_DENSE_SIZE, PAGE_SIZE);
+}
+
+T_DECL(fork_large_sparse, "fork latency with 32GB sparsely touched") {
+	fork_large(LARGE_SPARSE_SIZE, LARGE_SPARSE_STRIDE);
+}
+
+static uint64_t
+sysctl_quad(const char *name)
+{
+	uint64_t value = 0;
+	size_t len = sizeof(value);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname(name, &value, &len, NULL, 0),
+	    "sysctlbyname(%s)", name);
+	return value;
+}
+
+/*
+ * How much of the shared region each new process gets to map through the
+ * shared region's own page tables: the fewer bytes unnested per spawn,
+ * the fewer page table pages and soft faults it costs.
+ */
+T_DECL(posix_spawn_shared_region_unnest, "shared region bytes unnested per posix_spawn") {
+	char *args[] = {"/usr/bin/true", NULL};
+	dt_stat_t s = dt_stat_create("bytes", "unnested_per_spawn");
+	uint64_t nested_before, nested_after;
+	int err, status;
+	pid_t pid;
+
+	nested_before = sysctl_quad("vm.pmap_nested");
+	while (!dt_stat_stable(s)) {
+		uint64_t before = sysctl_quad("vm.pmap_unnested_bytes");
+
+		err = posix_spawn(&pid, args[0], NULL, NULL, args, NULL);
+		if (err) {
+			T_FAIL("posix_spawn returned %d", err);
+		}
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			T_FAIL("Child process of posix_spawn failed to run");
+		}
+		dt_stat_add(s, (double)(sysctl_quad("vm.pmap_unnested_bytes") - before));
+	}
+	dt_stat_finalize(s);
+
+	nested_after = sysctl_quad("vm.pmap_nested");
+	T_EXPECT_GT(nested_after, nested_before, "spawned processes nest the shared region");
+}
+
+/*
+ * Break the kernel side of posix_spawn down with the exec tracepoints:
+ * all of load_machfile(), and within it loading the code signatures (of
+ * the binary and of dyld) and the dynamic linker.
+ */
+#define EXEC_PHASES 3
+#define EXEC_SPAWNS 200
+
+static const struct {
+	const char *name;
+	uint32_t code;
+} exec_phases[EXEC_PHASES] = {
+	{ "load_machfile", BSD_PROC_EXEC_LOAD },
+	{ "code_signature", BSD_PROC_EXEC_CODESIGN },
+	{ "dylinker", BSD_PROC_EXEC_DYLD },
+};
+
+T_DECL(posix_spawn_exec_phases, "time spent in the phases of exec",
+    T_META_ASROOT(true))
+{
+	__block uint64_t phase_start[EXEC_PHASES] = { 0 };
+	__block dt_stat_time_t stats[EXEC_PHASES];
+	ktrace_session_t session;
+	dispatch_queue_t q;
+
+	session = ktrace_session_create();
+	T_QUIET; T_ASSERT_NOTNULL(session, "ktrace_session_create");
+	ktrace_set_execnames_enabled(session, KTRACE_FEATURE_DISABLED);
+	ktrace_filter_process(session, "true");
+
+	for (int i = 0; i < EXEC_PHASES; i++) {
+		stats[i] = dt_stat_time_create("%s", exec_phases[i].name);
+		ktrace_events_single(session,
+		    BSDDBG_CODE(DBG_BSD_PROC, exec_phases[i].code) | DBG_FUNC_START,
+		    ^(ktrace_event_t e) {
+			phase_start[i] = e->timestamp;
+		});
+		ktrace_events_single(session,
+		    BSDDBG_CODE(DBG_BSD_PROC, exec_phases[i].code) | DBG_FUNC_END,
+		    ^(ktrace_event_t e) {
+			if (phase_start[i] != 0 && phase_start[i] <= e->timestamp) {
+				dt_stat_mach_time_add(stats[i], e->timestamp - phase_start[i]);
+			}
+			phase_start[i] = 0;
+		});
+	}
+
+	ktrace_set_completion_handler(session, ^{
+		for (int i = 0; i < EXEC_PHASES; i++) {
+			dt_stat_finalize(stats[i]);
+		}
+		ktrace_session_destroy(session);
+		T_END;
+	});
+
+	q = dispatch_queue_create("perf_spawn_fork.exec_phases", NULL);
+	T_ASSERT_POSIX_ZERO(ktrace_start(session, q), "ktrace_start");
+
+	for (int i = 0; i < EXEC_SPAWNS; i++) {
+		char *args[] = {"/usr/bin/true", NULL};
+		int err, status;
+		pid_t pid;
+
+		err = posix_spawn(&pid, args[0], NULL, NULL, args, NULL);
+		T_QUIET; T_ASSERT_POSIX_ZERO(err, "posix_spawn");
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(waitpid(pid, &status, 0), "waitpid");
+	}
+
+	ktrace_end(session, 1);
+	dispatch_main();
+}
@@ -0,0 +1,120 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <mach/mach.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Measure the cost of entering and leaving the kernel: system calls that
+ * take the lightweight dispatch, one that goes through the full one, a
+ * Mach trap, and a null mach_msg() RPC to a server thread.
+ */
+
+T_DECL(syscall_null_light, "null system call taking the lightweight dispatch")
+{
+	dt_stat_time_t s = dt_stat_time_create("getppid");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)syscall(SYS_getppid);
+	}
+	dt_stat_finalize(s);
+
+	s = dt_stat_time_create("thread_selfid");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)syscall(SYS_thread_selfid);
+	}
+	dt_stat_finalize(s);
+}
+
+T_DECL(syscall_null, "null system call taking the full dispatch")
+{
+	dt_stat_time_t s = dt_stat_time_create("getuid");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)syscall(SYS_getuid);
+	}
+	dt_stat_finalize(s);
+}
+
+T_DECL(mach_trap_null, "null Mach trap")
+{
+	int pid;
+
+	dt_stat_time_t s = dt_stat_time_create("pid_for_task");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)pid_for_task(mach_task_self(), &pid);
+	}
+	dt_stat_finalize(s);
+}
+
+struct null_rpc_msg {
+	mach_msg_header_t header;
+	mach_msg_trailer_t trailer;
+};
+
+static void *
+null_rpc_server(void *arg)
+{
+	mach_port_t port = (mach_port_t)(uintptr_t)arg;
+	struct null_rpc_msg msg;
+	mach_msg_return_t mr;
+
+	for (;;) {
+		mr = mach_msg(&msg.header, MACH_RCV_MSG, 0, sizeof(msg), port,
+		    MACH_MSG_TIMEOUT_NONE, MACH_PORT_NULL);
+		if (mr != MACH_MSG_SUCCESS) {
+			break;
+		}
+		msg.header.msgh_bits = MACH_MSGH_BITS(MACH_MSGH_BITS_REMOTE(msg.header.msgh_bits), 0);
+		msg.header.msgh_local_port = MACH_PORT_NULL;
+		msg.header.msgh_size = sizeof(msg.header);
+		(void)mach_msg(&msg.header, MACH_SEND_MSG, sizeof(msg.header), 0,
+		    MACH_PORT_NULL, MACH_MSG_TIMEOUT_NONE, MACH_PORT_NULL);
+	}
+	return NULL;
+}
+
+T_DECL(mach_msg_null_rpc, "null mach_msg() RPC to a server thread")
+{
+	mach_port_t port, reply;
+	struct null_rpc_msg msg;
+	pthread_t server;
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_allocate(mach_task_self(),
+	    MACH_PORT_RIGHT_RECEIVE, &port), "mach_port_allocate");
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_insert_right(mach_task_self(),
+	    port, port, MACH_MSG_TYPE_MAKE_SEND), "mach_port_insert_right");
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_allocate(mach_task_self(),
+	    MACH_PORT_RIGHT_RECEIVE, &reply), "mach_port_allocate");
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&server, NULL,
+	    null_rpc_server, (void *)(uintptr_t)port), "pthread_create");
+
+	dt_stat_time_t s = dt_stat_time_create("mach_msg_null_rpc");
+	T_STAT_MEASURE_LOOP(s) {
+		msg.header.msgh_bits = MACH_MSGH_BITS(MACH_MSG_TYPE_COPY_SEND,
+		    MACH_MSG_TYPE_MAKE_SEND_ONCE);
+		msg.header.msgh_size = sizeof(msg.header);
+		msg.header.msgh_remote_port = port;
+		msg.header.msgh_local_port = reply;
+		msg.header.msgh_voucher_port = MACH_PORT_NULL;
+		msg.header.msgh_id = 0;
+		T_QUIET; T_ASSERT_MACH_SUCCESS(mach_msg(&msg.header,
+		    MACH_SEND_MSG | MACH_RCV_MSG, sizeof(msg.header), sizeof(msg),
+		    reply, MACH_MSG_TIMEOUT_NONE, MACH_PORT_NULL), "mach_msg");
+	}
+	dt_stat_finalize(s);
+
+	/* the server's receive fails once the port is gone */
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_mod_refs(mach_task_self(), port,
+	    MACH_PORT_RIGHT_RECEIVE, -1), "mach_port_mod_refs");
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(server, NULL), "pthread_join");
+}
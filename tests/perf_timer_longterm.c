@@ -0,0 +1,104 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <mach/mach.h>
+#include <mach/semaphore.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Measure the cost of arming and cancelling long-dated timers while many
+ * others are pending: each round trip below arms and cancels the wait
+ * timer of a thread blocked with a timeout well past the longterm
+ * threshold, and the parked threads keep theirs armed meanwhile.
+ */
+
+#define NPARKED		1000
+#define LONG_TIMEOUT	{ .tv_sec = 60, .tv_nsec = 0 }
+
+static semaphore_t park;
+static _Atomic bool done;
+
+static void *
+parked_thread(__unused void *arg)
+{
+	mach_timespec_t timeout = LONG_TIMEOUT;
+
+	while (!atomic_load(&done)) {
+		(void) semaphore_timedwait(park, timeout);
+	}
+	return NULL;
+}
+
+struct pingpong {
+	semaphore_t ping;
+	semaphore_t pong;
+};
+
+static void *
+ponger(void *arg)
+{
+	struct pingpong *pp = arg;
+	mach_timespec_t timeout = LONG_TIMEOUT;
+
+	while (!atomic_load(&done)) {
+		if (semaphore_timedwait(pp->ping, timeout) == KERN_SUCCESS) {
+			semaphore_signal(pp->pong);
+		}
+	}
+	return NULL;
+}
+
+T_DECL(timer_longterm_arm_cancel,
+       "round trips through waits with long timeouts, with many timers pending")
+{
+	struct pingpong pp;
+	pthread_t pong_thread, *parked;
+	mach_timespec_t timeout = LONG_TIMEOUT;
+	int i;
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(semaphore_create(mach_task_self(), &park,
+	    SYNC_POLICY_FIFO, 0), "semaphore_create");
+	T_QUIET; T_ASSERT_MACH_SUCCESS(semaphore_create(mach_task_self(), &pp.ping,
+	    SYNC_POLICY_FIFO, 0), "semaphore_create");
+	T_QUIET; T_ASSERT_MACH_SUCCESS(semaphore_create(mach_task_self(), &pp.pong,
+	    SYNC_POLICY_FIFO, 0), "semaphore_create");
+
+	parked = calloc(NPARKED, sizeof(*parked));
+	T_QUIET; T_ASSERT_NOTNULL(parked, "calloc");
+	for (i = 0; i < NPARKED; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&parked[i], NULL,
+		    parked_thread, NULL), "pthread_create");
+	}
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&pong_thread, NULL, ponger,
+	    &pp), "pthread_create");
+
+	dt_stat_time_t s = dt_stat_time_create("round_trip_time");
+	while (!dt_stat_stable(s)) {
+		T_STAT_MEASURE(s) {
+			semaphore_signal(pp.ping);
+			(void) semaphore_timedwait(pp.pong, timeout);
+		}
+	}
+	dt_stat_finalize(s);
+
+	atomic_store(&done, true);
+	for (i = 0; i < NPARKED; i++) {
+		semaphore_signal(park);
+	}
+	semaphore_signal(pp.ping);
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(pong_thread, NULL), "pthread_join");
+	for (i = 0; i < NPARKED; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(parked[i], NULL), "pthread_join");
+	}
+	free(parked);
+}
@@ -0,0 +1,117 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_TAG_PERF
+);
+
+/*
+ * Measure the round trip time of messages bounced between the two ends of
+ * a stream socketpair, the cost local services pay per request through
+ * uipc_send().  Both directions are exercised so that half of the sends
+ * are made by the socket with the higher lock address.
+ */
+
+struct echo_args {
+	int fd;
+	size_t size;
+};
+
+static void
+full_write(int fd, const char *buf, size_t size)
+{
+	while (size > 0) {
+		ssize_t n = write(fd, buf, size);
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(n, "write");
+		buf += n;
+		size -= (size_t)n;
+	}
+}
+
+static bool
+full_read(int fd, char *buf, size_t size)
+{
+	while (size > 0) {
+		ssize_t n = read(fd, buf, size);
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(n, "read");
+		if (n == 0) {
+			return false;
+		}
+		buf += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+static void *
+echo_thread(void *arg)
+{
+	struct echo_args *ea = arg;
+	char *buf = malloc(ea->size);
+
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	while (full_read(ea->fd, buf, ea->size)) {
+		full_write(ea->fd, buf, ea->size);
+	}
+	free(buf);
+	return NULL;
+}
+
+static void
+unix_socket_pingpong(size_t size)
+{
+	struct echo_args ea;
+	pthread_t thread;
+	char *buf, name[64];
+	int fds[2];
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(socketpair(AF_UNIX, SOCK_STREAM, 0, fds),
+	    "socketpair");
+	buf = malloc(size);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	memset(buf, 'x', size);
+
+	ea.fd = fds[1];
+	ea.size = size;
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&thread, NULL, echo_thread, &ea),
+	    "pthread_create");
+
+	snprintf(name, sizeof(name), "round_trip_time_%zu", size);
+	dt_stat_time_t s = dt_stat_time_create(name);
+	while (!dt_stat_stable(s)) {
+		T_STAT_MEASURE(s) {
+			full_write(fds[0], buf, size);
+			(void)full_read(fds[0], buf, size);
+		}
+	}
+	dt_stat_finalize(s);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(shutdown(fds[0], SHUT_WR), "shutdown");
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(thread, NULL), "pthread_join");
+	close(fds[0]);
+	close(fds[1]);
+	free(buf);
+}
+
+T_DECL(unix_socket_pingpong_small,
+       "round trip time of 64 byte messages over a unix domain socketpair")
+{
+	unix_socket_pingpong(64);
+}
+
+T_DECL(unix_socket_pingpong_large,
+       "round trip time of 16KB messages over a unix domain socketpair")
+{
+	unix_socket_pingpong(16 * 1024);
+}
@@ -0,0 +1,58 @@
+#ifdef T_NAMESPACE
+#undef T_NAMESPACE
+#endif
+#include <darwintest.h>
+
+#include <stdint.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(
+	T_META_NAMESPACE("xnu.perf"),
+	T_META_CHECK_LEAKS(false),
+	T_META_ASROOT(true),
+	T_META_TAG_PERF
+);
+
+/*
+ * Compare the cost of waking up an event nobody waits on, with and without
+ * the lockless check of the global waitq waiter counts.
+ */
+
+#define ITER 100000
+
+static void
+measure_wakeups(int lockless, const char *name)
+{
+	int iter = ITER;
+	uint64_t ns;
+	size_t size;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.waitq_lockless_wakeup",
+	    NULL, NULL, &lockless, sizeof(lockless)), "sysctl kern.waitq_lockless_wakeup");
+
+	dt_stat_t s = dt_stat_create("ns", name);
+	while (!dt_stat_stable(s)) {
+		size = sizeof(ns);
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.waitq_wakeup_test",
+		    &ns, &size, &iter, sizeof(iter)), "sysctl kern.waitq_wakeup_test");
+		dt_stat_add(s, (double)ns / ITER);
+	}
+	dt_stat_finalize(s);
+}
+
+T_DECL(waitq_wakeup_no_waiters,
+       "cost of thread_wakeup() on an event with no waiters")
+{
+	int lockless = 0;
+	size_t size = sizeof(lockless);
+
+	if (sysctlbyname("kern.waitq_lockless_wakeup", &lockless, &size, NULL, 0) != 0) {
+		T_SKIP("kern.waitq_lockless_wakeup not available on this kernel");
+	}
+
+	measure_wakeups(0, "wakeup_locked");
+	measure_wakeups(1, "wakeup_lockless");
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.waitq_lockless_wakeup",
+	    NULL, NULL, &lockless, sizeof(lockless)), "restore kern.waitq_lockless_wakeup");
+}
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/event.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -930,3 +931,110 @@ PAIR_DECL(tty, PTY_PAIR)
 PAIR_DECL(pipe, PIPE_PAIR)
 PAIR_DECL(fifo, FIFO_PAIR)
 PAIR_DECL(socket, SOCKET_PAIR)
+
+#pragma mark poll sets
+
+/*
+ * poll() keeps the knotes of a thread's last set across calls, check that
+ * repeated calls on the same set see readiness change in both directions
+ * and descriptors being replaced, and measure a large set with a single
+ * ready descriptor.
+ */
+
+#define POLL_SET_PIPES 512
+
+static struct pollfd poll_set[POLL_SET_PIPES];
+static int poll_set_wr[POLL_SET_PIPES];
+
+static void
+poll_set_init(void)
+{
+	struct rlimit rl;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(getrlimit(RLIMIT_NOFILE, &rl), NULL);
+	if (rl.rlim_cur < 2 * POLL_SET_PIPES + 64) {
+		rl.rlim_cur = 2 * POLL_SET_PIPES + 64;
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(setrlimit(RLIMIT_NOFILE, &rl), NULL);
+	}
+
+	for (int i = 0; i < POLL_SET_PIPES; i++) {
+		int fds[2];
+
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(pipe(fds), NULL);
+		poll_set[i].fd = fds[0];
+		poll_set[i].events = POLLIN;
+		poll_set_wr[i] = fds[1];
+	}
+}
+
+static int
+poll_set_ready(int expected)
+{
+	int n = poll(poll_set, POLL_SET_PIPES, 0);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(n, "poll");
+	for (int i = 0; i < POLL_SET_PIPES; i++) {
+		if (i == expected) {
+			T_QUIET; T_ASSERT_EQ(poll_set[i].revents, POLLIN,
+			    "pipe %d is readable", i);
+		} else {
+			T_QUIET; T_ASSERT_EQ(poll_set[i].revents, 0,
+			    "pipe %d is not readable", i);
+		}
+	}
+	return n;
+}
+
+T_DECL(poll_cached_set, "repeated poll calls on the same set")
+{
+	char c = 'x';
+	int fds[2];
+
+	poll_set_init();
+
+	T_ASSERT_EQ(poll_set_ready(-1), 0, "nothing ready");
+
+	for (int i = 0; i < POLL_SET_PIPES; i += 7) {
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(write(poll_set_wr[i], &c, 1), NULL);
+		T_QUIET; T_ASSERT_EQ(poll_set_ready(i), 1, "one ready");
+		T_QUIET; T_ASSERT_EQ(poll_set_ready(i), 1, "still ready");
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(read(poll_set[i].fd, &c, 1), NULL);
+		T_QUIET; T_ASSERT_EQ(poll_set_ready(-1), 0, "none ready once read");
+	}
+	T_PASS("readiness followed the pipes");
+
+	/* replace a descriptor of the set behind poll's back */
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(pipe(fds), NULL);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(write(fds[1], &c, 1), NULL);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(dup2(fds[0], poll_set[3].fd), NULL);
+	close(poll_set_wr[3]);
+	poll_set_wr[3] = fds[1];
+	close(fds[0]);
+	T_ASSERT_EQ(poll_set_ready(3), 1, "replaced descriptor is polled");
+
+	/* and close one: the set must report it invalid */
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(read(poll_set[3].fd, &c, 1), NULL);
+	close(poll_set[5].fd);
+	T_ASSERT_EQ(poll(poll_set, POLL_SET_PIPES, 0), 1, "closed descriptor");
+	T_ASSERT_EQ(poll_set[5].revents, POLLNVAL, "closed descriptor is invalid");
+}
+
+T_DECL(poll_large_set_perf, "poll on a large set with one ready descriptor",
+    T_META_TAG_PERF)
+{
+	char c = 'x';
+
+	poll_set_init();
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(write(poll_set_wr[POLL_SET_PIPES / 2],
+	    &c, 1), NULL);
+
+	dt_stat_time_t s = dt_stat_time_create("poll_%d_fds", POLL_SET_PIPES);
+	while (!dt_stat_stable(s)) {
+		T_STAT_MEASURE(s) {
+			(void)poll(poll_set, POLL_SET_PIPES, 0);
+		}
+	}
+	dt_stat_finalize(s);
+
+	T_ASSERT_EQ(poll_set_ready(POLL_SET_PIPES / 2), 1, "one ready");
+}
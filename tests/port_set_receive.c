@@ -0,0 +1,102 @@
+#include <darwintest.h>
+
+#include <mach/mach.h>
+#include <stdlib.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.ipc"));
+
+#define PSET_PORTS 4096
+
+struct pset_msg {
+	mach_msg_header_t header;
+	mach_msg_trailer_t trailer;
+};
+
+static mach_port_t
+pset_add_port(mach_port_t pset)
+{
+	mach_port_t port;
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_allocate(mach_task_self(),
+	    MACH_PORT_RIGHT_RECEIVE, &port), "mach_port_allocate");
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_insert_right(mach_task_self(),
+	    port, port, MACH_MSG_TYPE_MAKE_SEND), "mach_port_insert_right");
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_insert_member(mach_task_self(),
+	    port, pset), "mach_port_insert_member");
+	return port;
+}
+
+static void
+pset_send(mach_port_t port)
+{
+	mach_msg_header_t header = {
+		.msgh_bits = MACH_MSGH_BITS(MACH_MSG_TYPE_COPY_SEND, 0),
+		.msgh_size = sizeof(header),
+		.msgh_remote_port = port,
+	};
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_msg(&header, MACH_SEND_MSG,
+	    sizeof(header), 0, MACH_PORT_NULL, MACH_MSG_TIMEOUT_NONE,
+	    MACH_PORT_NULL), "mach_msg send");
+}
+
+static mach_port_t
+pset_receive(mach_port_t pset)
+{
+	struct pset_msg msg;
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_msg(&msg.header,
+	    MACH_RCV_MSG | MACH_RCV_TIMEOUT, 0, sizeof(msg), pset, 0,
+	    MACH_PORT_NULL), "mach_msg receive");
+	return msg.header.msgh_local_port;
+}
+
+T_DECL(port_set_receive_round_robin,
+    "receiving on a port set takes turns among the ports with messages")
+{
+	mach_port_t pset, busy, other;
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_allocate(mach_task_self(),
+	    MACH_PORT_RIGHT_PORT_SET, &pset), "mach_port_allocate");
+	busy = pset_add_port(pset);
+	other = pset_add_port(pset);
+
+	pset_send(busy);
+	pset_send(busy);
+	pset_send(other);
+
+	T_EXPECT_EQ(pset_receive(pset), busy, "first message is from the port that posted first");
+	T_EXPECT_EQ(pset_receive(pset), other, "second message is from the other port");
+	T_EXPECT_EQ(pset_receive(pset), busy, "third message is from the first port again");
+}
+
+T_DECL(perf_port_set_receive, "receiving on a port set with thousands of members",
+    T_META_TAG_PERF, T_META_CHECK_LEAKS(false))
+{
+	mach_port_t pset, *ports;
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_allocate(mach_task_self(),
+	    MACH_PORT_RIGHT_PORT_SET, &pset), "mach_port_allocate");
+	ports = calloc(PSET_PORTS, sizeof(ports[0]));
+	T_QUIET; T_ASSERT_NOTNULL(ports, "calloc");
+	for (int i = 0; i < PSET_PORTS; i++) {
+		ports[i] = pset_add_port(pset);
+	}
+
+	/* one port of the set is busy, the others come and go */
+	int i = 0;
+	dt_stat_time_t s = dt_stat_time_create("send_receive_on_port_set");
+	T_STAT_MEASURE_LOOP(s) {
+		pset_send(ports[0]);
+		pset_send(ports[1 + i++ % (PSET_PORTS - 1)]);
+		(void)pset_receive(pset);
+		(void)pset_receive(pset);
+	}
+	dt_stat_finalize(s);
+
+	for (i = 0; i < PSET_PORTS; i++) {
+		T_QUIET; T_ASSERT_MACH_SUCCESS(mach_port_mod_refs(mach_task_self(),
+		    ports[i], MACH_PORT_RIGHT_RECEIVE, -1), "mach_port_mod_refs");
+	}
+	free(ports);
+}
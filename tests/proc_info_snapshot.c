@@ -0,0 +1,155 @@
+#include <darwintest.h>
+#include "../bsd/sys/proc_info.h"
+#include "../libsyscall/wrappers/libproc/libproc.h"
+#include "../libsyscall/wrappers/libproc/libproc_internal.h"
+#include "../osfmk/kern/kcdata.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.proc_info"));
+
+#define SNAPSHOT_THREADS 3
+
+static void *
+snapshot_sleeper(__unused void *arg)
+{
+	pause();
+	return NULL;
+}
+
+static void *
+take_snapshot(uint64_t flags, int *sizep)
+{
+	int size;
+	void *buf;
+
+	size = proc_snapshot(PROC_ALL_PIDS, 0, flags, NULL, 0);
+	T_QUIET; T_ASSERT_GT(size, 0, "proc_snapshot size estimate");
+
+	buf = malloc((size_t)size);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+
+	*sizep = proc_snapshot(PROC_ALL_PIDS, 0, flags, buf, size);
+	T_QUIET; T_ASSERT_GT(*sizep, 0, "proc_snapshot");
+	return buf;
+}
+
+T_DECL(proc_snapshot_self, "proc_snapshot reports the calling process and its threads")
+{
+	pthread_t threads[SNAPSHOT_THREADS];
+	struct proc_taskinfo *ptinfo = NULL;
+	struct proc_bsdshortinfo *pbsd = NULL;
+	uint32_t nthreadids = 0, nthreadinfos = 0;
+	uint64_t snapshot_flags = ~0ULL;
+	uint64_t *tids = NULL;
+	int nprocs = 0, size;
+	int in_self = 0;
+	void *buf;
+
+	for (int i = 0; i < SNAPSHOT_THREADS; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&threads[i], NULL,
+		    snapshot_sleeper, NULL), "pthread_create");
+	}
+
+	buf = take_snapshot(PROC_SNAPSHOT_ALL, &size);
+
+	kcdata_iter_t iter = kcdata_iter(buf, (unsigned long)size);
+	T_ASSERT_EQ(kcdata_iter_type(iter), KCDATA_BUFFER_BEGIN_PROCINFO,
+	    "snapshot is a procinfo kcdata buffer");
+	iter = kcdata_iter_next(iter);
+
+	KCDATA_ITER_FOREACH(iter) {
+		switch (kcdata_iter_type(iter)) {
+		case PROCINFO_KCTYPE_SNAPSHOT_FLAGS:
+			snapshot_flags = *(uint64_t *)kcdata_iter_payload(iter);
+			break;
+		case KCDATA_TYPE_CONTAINER_BEGIN:
+			if (kcdata_iter_container_type(iter) != PROCINFO_KCCONTAINER_PROC) {
+				break;
+			}
+			nprocs++;
+			in_self = (kcdata_iter_container_id(iter) == (uint64_t)getpid());
+			break;
+		case KCDATA_TYPE_CONTAINER_END:
+			in_self = 0;
+			break;
+		case PROCINFO_KCTYPE_BSDSHORTINFO:
+			if (in_self) {
+				pbsd = kcdata_iter_payload(iter);
+			}
+			break;
+		case PROCINFO_KCTYPE_TASKINFO:
+			if (in_self) {
+				ptinfo = kcdata_iter_payload(iter);
+			}
+			break;
+		case KCDATA_TYPE_ARRAY:
+			T_QUIET; T_ASSERT_TRUE(kcdata_iter_array_valid(iter), "array is valid");
+			if (!in_self) {
+				break;
+			}
+			if (kcdata_iter_array_elem_type(iter) == PROCINFO_KCTYPE_THREADIDS) {
+				nthreadids = kcdata_iter_array_elem_count(iter);
+				tids = kcdata_iter_payload(iter);
+			} else if (kcdata_iter_array_elem_type(iter) == PROCINFO_KCTYPE_THREADINFO) {
+				nthreadinfos = kcdata_iter_array_elem_count(iter);
+			}
+			break;
+		}
+	}
+	T_QUIET; T_ASSERT_FALSE(KCDATA_ITER_FOREACH_FAILED(iter), "snapshot parses");
+
+	T_EXPECT_EQ(snapshot_flags, 0ULL, "snapshot isn't truncated");
+	T_EXPECT_GT(nprocs, 1, "snapshot has more than one process");
+
+	T_ASSERT_NOTNULL(pbsd, "snapshot has the short bsd info of the process");
+	T_EXPECT_EQ(pbsd->pbsi_pid, (uint32_t)getpid(), "short bsd info has the pid");
+	T_EXPECT_EQ(pbsd->pbsi_ppid, (uint32_t)getppid(), "short bsd info has the ppid");
+
+	T_ASSERT_NOTNULL(ptinfo, "snapshot has the task info of the process");
+	T_EXPECT_GE(ptinfo->pti_threadnum, SNAPSHOT_THREADS + 1, "task info counts the threads");
+
+	T_EXPECT_GE(nthreadids, (uint32_t)(SNAPSHOT_THREADS + 1), "snapshot lists the threads");
+	T_EXPECT_EQ(nthreadinfos, nthreadids, "snapshot has the info of every thread listed");
+
+	uint64_t self_tid;
+	int found = 0;
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_threadid_np(NULL, &self_tid), "pthread_threadid_np");
+	for (uint32_t i = 0; tids && i < nthreadids; i++) {
+		if (tids[i] == self_tid) {
+			found = 1;
+		}
+	}
+	T_EXPECT_TRUE(found, "snapshot lists the calling thread");
+
+	free(buf);
+}
+
+T_DECL(proc_snapshot_truncated, "proc_snapshot flags a snapshot that doesn't fit")
+{
+	uint64_t snapshot_flags = 0;
+	char buf[1024];
+	int size;
+
+	size = proc_snapshot(PROC_ALL_PIDS, 0, PROC_SNAPSHOT_ALL, buf, sizeof(buf));
+	T_ASSERT_GT(size, 0, "proc_snapshot with a small buffer");
+	T_ASSERT_LE(size, (int)sizeof(buf), "snapshot fits in the buffer");
+
+	kcdata_iter_t iter = kcdata_iter(buf, (unsigned long)size);
+	iter = kcdata_iter_find_type(iter, PROCINFO_KCTYPE_SNAPSHOT_FLAGS);
+	T_ASSERT_TRUE(kcdata_iter_valid(iter), "snapshot has flags");
+	snapshot_flags = *(uint64_t *)kcdata_iter_payload(iter);
+	T_EXPECT_TRUE(snapshot_flags & PROCINFO_SNAPSHOT_TRUNCATED, "snapshot is truncated");
+}
+
+T_DECL(proc_snapshot_invalid, "proc_snapshot rejects unknown flags")
+{
+	char buf[1024];
+
+	T_EXPECT_EQ(proc_snapshot(PROC_ALL_PIDS, 0, 0, buf, sizeof(buf)), 0, "no flags");
+	T_EXPECT_EQ(errno, EINVAL, "no flags fail with EINVAL");
+	T_EXPECT_EQ(proc_snapshot(PROC_ALL_PIDS, 0, ~0ULL, buf, sizeof(buf)), 0, "unknown flags");
+	T_EXPECT_EQ(errno, EINVAL, "unknown flags fail with EINVAL");
+}
@@ -0,0 +1,45 @@
+#include <darwintest.h>
+
+#include <mach/mach.h>
+#include <mach/thread_info.h>
+#include <stdint.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.scheduler"));
+
+T_DECL(thread_sched_latency_info,
+		"check that a thread's run queue latency is accounted")
+{
+	thread_sched_latency_info_data_t before, after;
+	mach_msg_type_number_t count;
+	kern_return_t kr;
+	uint64_t hist_total = 0;
+
+	count = THREAD_SCHED_LATENCY_INFO_COUNT;
+	kr = thread_info(mach_thread_self(), THREAD_SCHED_LATENCY_INFO,
+			(thread_info_t)&before, &count);
+	T_ASSERT_MACH_SUCCESS(kr, "thread_info(THREAD_SCHED_LATENCY_INFO)");
+
+	/* each sleep makes the thread runnable again when it ends */
+	for (int i = 0; i < 10; i++) {
+		usleep(1000);
+	}
+
+	count = THREAD_SCHED_LATENCY_INFO_COUNT;
+	kr = thread_info(mach_thread_self(), THREAD_SCHED_LATENCY_INFO,
+			(thread_info_t)&after, &count);
+	T_ASSERT_MACH_SUCCESS(kr, "thread_info(THREAD_SCHED_LATENCY_INFO)");
+
+	T_EXPECT_GE(after.runnable_count, before.runnable_count + 10,
+			"thread went on core after each sleep");
+	T_EXPECT_GE(after.runnable_time, before.runnable_time,
+			"total latency does not decrease");
+	T_EXPECT_LE(after.runnable_max, after.runnable_time,
+			"longest latency is part of the total");
+
+	for (int i = 0; i < THREAD_SCHED_LATENCY_BUCKETS; i++) {
+		hist_total += after.latency_hist[i];
+	}
+	T_EXPECT_EQ(hist_total, after.runnable_count,
+			"histogram counts every latency once");
+}
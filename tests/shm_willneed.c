@@ -0,0 +1,52 @@
+#include <darwintest.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.vm"));
+
+#define NPAGES 256
+
+static int
+resident_pages(void *addr, size_t len)
+{
+	char vec[NPAGES];
+	int i, n = 0;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(mincore(addr, len, vec), "mincore");
+	for (i = 0; i < NPAGES; i++) {
+		if (vec[i] & MINCORE_INCORE) {
+			n++;
+		}
+	}
+	return n;
+}
+
+T_DECL(shm_madvise_willneed,
+       "madvise(MADV_WILLNEED) populates a POSIX shared memory mapping")
+{
+	size_t len = NPAGES * (size_t)PAGE_SIZE;
+	char name[32];
+	void *addr;
+	int fd;
+
+	snprintf(name, sizeof(name), "/shm_willneed.%d", getpid());
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	T_ASSERT_POSIX_SUCCESS(fd, "shm_open");
+	shm_unlink(name);
+	T_ASSERT_POSIX_SUCCESS(ftruncate(fd, (off_t)len), "ftruncate");
+
+	addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	T_ASSERT_NE(addr, MAP_FAILED, "mmap");
+	T_EXPECT_EQ(resident_pages(addr, len), 0, "nothing is resident before the advice");
+
+	T_ASSERT_POSIX_SUCCESS(madvise(addr, len, MADV_WILLNEED), "madvise(MADV_WILLNEED)");
+	T_EXPECT_EQ(resident_pages(addr, len), NPAGES, "the whole mapping is resident after the advice");
+
+	munmap(addr, len);
+	close(fd);
+}
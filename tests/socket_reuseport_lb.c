@@ -0,0 +1,98 @@
+#include <darwintest.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/sysctl.h>
+#include <unistd.h>
+
+/*
+ * Connections to a port shared by several SO_REUSEPORT listeners should
+ * be spread across them.
+ */
+
+#define NLISTENERS	4
+#define NCONNS		64
+
+static int
+listener_open(uint16_t *port)
+{
+	struct sockaddr_in sin = {
+		.sin_len = sizeof(sin),
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(sin);
+	int s, on = 1;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(s = socket(PF_INET, SOCK_STREAM, 0), "socket");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(setsockopt(s, SOL_SOCKET, SO_REUSEPORT,
+	    &on, sizeof(on)), "setsockopt(SO_REUSEPORT)");
+	sin.sin_port = htons(*port);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(bind(s, (struct sockaddr *)&sin,
+	    sizeof(sin)), "bind");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(listen(s, NCONNS), "listen");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(fcntl(s, F_SETFL, O_NONBLOCK), "fcntl");
+	if (*port == 0) {
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(getsockname(s,
+		    (struct sockaddr *)&sin, &len), "getsockname");
+		*port = ntohs(sin.sin_port);
+	}
+	return s;
+}
+
+T_DECL(socket_reuseport_lb,
+       "connections are spread across SO_REUSEPORT listeners")
+{
+	struct sockaddr_in sin = {
+		.sin_len = sizeof(sin),
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	int listeners[NLISTENERS], conns[NCONNS], accepted[NLISTENERS] = { 0 };
+	int lb = 0, used = 0, total = 0, i, j, s;
+	size_t size = sizeof(lb);
+	uint16_t port = 0;
+
+	if (sysctlbyname("net.inet.ip.reuseport_lb", &lb, &size, NULL, 0) != 0 ||
+	    lb == 0) {
+		T_SKIP("SO_REUSEPORT load balancing not enabled");
+	}
+
+	for (i = 0; i < NLISTENERS; i++) {
+		listeners[i] = listener_open(&port);
+	}
+
+	sin.sin_port = htons(port);
+	for (i = 0; i < NCONNS; i++) {
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(conns[i] = socket(PF_INET,
+		    SOCK_STREAM, 0), "socket");
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(connect(conns[i],
+		    (struct sockaddr *)&sin, sizeof(sin)), "connect");
+	}
+
+	for (i = 0; i < NLISTENERS; i++) {
+		while ((s = accept(listeners[i], NULL, NULL)) >= 0) {
+			accepted[i]++;
+			close(s);
+		}
+		T_QUIET; T_ASSERT_EQ(errno, EWOULDBLOCK, "accept");
+		T_LOG("listener %d accepted %d connections", i, accepted[i]);
+		total += accepted[i];
+		if (accepted[i] > 0) {
+			used++;
+		}
+	}
+
+	T_EXPECT_EQ(total, NCONNS, "all connections accepted");
+	T_EXPECT_GT(used, 1, "connections spread across listeners");
+
+	for (j = 0; j < NCONNS; j++) {
+		close(conns[j]);
+	}
+	for (i = 0; i < NLISTENERS; i++) {
+		close(listeners[i]);
+	}
+}
@@ -727,6 +727,74 @@ T_DECL(perf_delta_process, "test delta stackshot performance targeted at a proce
 	stackshot_perf(SHOULD_REUSE_SIZE_HINT | SHOULD_USE_DELTA | SHOULD_TARGET_SELF);
 }
 
+static pthread_mutex_t parked_threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t parked_threads_cond = PTHREAD_COND_INITIALIZER;
+static bool parked_threads_release;
+
+static void *
+parked_thread(__unused void *arg)
+{
+	pthread_mutex_lock(&parked_threads_lock);
+	while (!parked_threads_release) {
+		pthread_cond_wait(&parked_threads_cond, &parked_threads_lock);
+	}
+	pthread_mutex_unlock(&parked_threads_lock);
+	return NULL;
+}
+
+/*
+ * Measure stackshot latency with thread_count idle threads added to the
+ * system, to see how the cost scales with threads that have nothing new.
+ */
+static void
+stackshot_perf_threads(unsigned int thread_count, unsigned int options)
+{
+	pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+	T_QUIET; T_ASSERT_NOTNULL(threads, "allocated thread array");
+
+	parked_threads_release = false;
+	for (unsigned int i = 0; i < thread_count; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&threads[i], NULL, parked_thread, NULL),
+				"pthread_create");
+	}
+	T_LOG("parked %u threads", thread_count);
+
+	stackshot_perf(options);
+
+	pthread_mutex_lock(&parked_threads_lock);
+	parked_threads_release = true;
+	pthread_cond_broadcast(&parked_threads_cond);
+	pthread_mutex_unlock(&parked_threads_lock);
+	for (unsigned int i = 0; i < thread_count; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(threads[i], NULL), "pthread_join");
+	}
+	free(threads);
+}
+
+T_DECL(perf_threads_1000, "test stackshot performance with 1000 extra threads",
+		T_META_TAG_PERF)
+{
+	stackshot_perf_threads(1000, SHOULD_REUSE_SIZE_HINT);
+}
+
+T_DECL(perf_threads_2000, "test stackshot performance with 2000 extra threads",
+		T_META_TAG_PERF)
+{
+	stackshot_perf_threads(2000, SHOULD_REUSE_SIZE_HINT);
+}
+
+T_DECL(perf_delta_threads_1000, "test delta stackshot performance with 1000 extra threads",
+		T_META_TAG_PERF)
+{
+	stackshot_perf_threads(1000, SHOULD_REUSE_SIZE_HINT | SHOULD_USE_DELTA);
+}
+
+T_DECL(perf_delta_threads_2000, "test delta stackshot performance with 2000 extra threads",
+		T_META_TAG_PERF)
+{
+	stackshot_perf_threads(2000, SHOULD_REUSE_SIZE_HINT | SHOULD_USE_DELTA);
+}
+
 static uint64_t
 stackshot_timestamp(void *ssbuf, size_t sslen)
 {
@@ -369,10 +369,21 @@ T_DECL(task_affinity_tag_info, "tests task_affinity_tag_info", T_META_ASROOT(tru
 	T_ASSERT_FALSE(affinity_tag_info_data.min != 0 || affinity_tag_info_data.max != 0,
 	               "task_info call returns non-zero min or max value");
 
+	T_ASSERT_EQ(affinity_tag_info_data.pset_switches, 0ULL, "no affinity set members changed pset");
+
+	/*
+	 * Callers built before the pset counters were added still get the
+	 * original fields.
+	 */
+	count = TASK_AFFINITY_TAG_INFO_REV0_COUNT;
+	err = task_info(mach_task_self(), TASK_AFFINITY_TAG_INFO, (task_info_t)&affinity_tag_info_data, &count);
+	T_ASSERT_MACH_SUCCESS(err, "verify task_info call with the revision 0 count succeeded");
+	T_ASSERT_EQ(count, (mach_msg_type_number_t)TASK_AFFINITY_TAG_INFO_REV0_COUNT, "task_info returns the revision 0 count");
+
 	/*
 	* This is a negative case.
 	*/
-	count--;
+	count = TASK_AFFINITY_TAG_INFO_REV0_COUNT - 1;
 	err = task_info(mach_task_self(), TASK_AFFINITY_TAG_INFO, (task_info_t)&affinity_tag_info_data, &count);
 	T_ASSERT_MACH_ERROR(err, KERN_INVALID_ARGUMENT,
 	                    "Negative test case: task_info should verify that count is at least equal to what is defined in API.");
@@ -0,0 +1,111 @@
+#define PRIVATE
+#include <netinet/tcp.h>
+#undef PRIVATE
+
+#include <darwintest.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+ * Select the congestion control algorithm of a connection with
+ * TCP_CONGESTION_ALGO, and move data over loopback with the paced one.
+ */
+
+#define XFER_SIZE	(4 * 1024 * 1024)
+
+static void
+check_algo(int s, const char *expected)
+{
+	char name[TCP_CC_NAME_MAX];
+	socklen_t len = sizeof(name);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(getsockopt(s, IPPROTO_TCP,
+	    TCP_CONGESTION_ALGO, name, &len), "getsockopt(TCP_CONGESTION_ALGO)");
+	T_EXPECT_EQ_STR(name, expected, "congestion control algorithm");
+}
+
+static void *
+sink(void *arg)
+{
+	int s = *(int *)arg;
+	char buf[16384];
+	size_t total = 0;
+	ssize_t n;
+
+	while ((n = read(s, buf, sizeof(buf))) > 0) {
+		total += n;
+	}
+	return (void *)total;
+}
+
+T_DECL(tcp_congestion_algo, "per connection congestion control selection")
+{
+	struct sockaddr_in sin = {
+		.sin_len = sizeof(sin),
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t len = sizeof(sin);
+	int l, c, a;
+	char *buf;
+	size_t sent = 0;
+	void *received;
+	pthread_t thread;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(l = socket(PF_INET, SOCK_STREAM, 0), "socket");
+	T_EXPECT_EQ(setsockopt(l, IPPROTO_TCP, TCP_CONGESTION_ALGO,
+	    "nonexistent", sizeof("nonexistent")), -1,
+	    "unknown algorithm is rejected");
+	T_EXPECT_EQ(errno, ENOENT, "with ENOENT");
+	T_ASSERT_POSIX_SUCCESS(setsockopt(l, IPPROTO_TCP, TCP_CONGESTION_ALGO,
+	    "bbr", sizeof("bbr")), "setsockopt(TCP_CONGESTION_ALGO, bbr)");
+	check_algo(l, "bbr");
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(bind(l, (struct sockaddr *)&sin,
+	    sizeof(sin)), "bind");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(listen(l, 1), "listen");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(getsockname(l, (struct sockaddr *)&sin,
+	    &len), "getsockname");
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(c = socket(PF_INET, SOCK_STREAM, 0), "socket");
+	T_ASSERT_POSIX_SUCCESS(setsockopt(c, IPPROTO_TCP, TCP_CONGESTION_ALGO,
+	    "bbr", sizeof("bbr")), "setsockopt(TCP_CONGESTION_ALGO, bbr)");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(connect(c, (struct sockaddr *)&sin,
+	    sizeof(sin)), "connect");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(a = accept(l, NULL, NULL), "accept");
+
+	/* accepted connections inherit the choice of the listener */
+	check_algo(a, "bbr");
+	check_algo(c, "bbr");
+
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&thread, NULL, sink, &a),
+	    "pthread_create");
+
+	buf = malloc(XFER_SIZE);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	memset(buf, 'b', XFER_SIZE);
+	while (sent < XFER_SIZE) {
+		ssize_t n = write(c, buf + sent, XFER_SIZE - sent);
+
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(n, "write");
+		sent += n;
+	}
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(shutdown(c, SHUT_WR), "shutdown");
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(thread, &received), "pthread_join");
+	T_EXPECT_EQ((size_t)received, (size_t)XFER_SIZE, "all data received");
+
+	T_ASSERT_POSIX_SUCCESS(setsockopt(c, IPPROTO_TCP, TCP_CONGESTION_ALGO,
+	    "cubic", sizeof("cubic")), "switch to cubic");
+	check_algo(c, "cubic");
+
+	free(buf);
+	close(a);
+	close(c);
+	close(l);
+}
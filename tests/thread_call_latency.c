@@ -0,0 +1,41 @@
+#include <darwintest.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.scheduler"));
+
+#define THREAD_CALL_LATENCY_BUCKETS 16
+
+T_DECL(thread_call_latency, "thread call groups histogram how long calls stay pending")
+{
+	uint64_t *hist;
+	size_t size = 0;
+
+	if (sysctlbyname("kern.timer.thread_call_latency", NULL, &size, NULL, 0) != 0) {
+		T_QUIET; T_ASSERT_EQ(errno, ENOENT, "kern.timer.thread_call_latency");
+		T_SKIP("thread call latency histograms aren't supported on this kernel");
+	}
+	T_QUIET; T_ASSERT_GT(size, (size_t)0, "the histograms aren't empty");
+	T_ASSERT_EQ(size % (THREAD_CALL_LATENCY_BUCKETS * sizeof(uint64_t)), (size_t)0,
+	    "each group has %d buckets", THREAD_CALL_LATENCY_BUCKETS);
+
+	hist = malloc(size);
+	T_QUIET; T_ASSERT_NOTNULL(hist, "malloc");
+	T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.timer.thread_call_latency",
+	    hist, &size, NULL, 0), "kern.timer.thread_call_latency");
+
+	uint64_t total = 0;
+	for (size_t g = 0; g < size / sizeof(uint64_t) / THREAD_CALL_LATENCY_BUCKETS; g++) {
+		uint64_t *b = &hist[g * THREAD_CALL_LATENCY_BUCKETS];
+		T_LOG("group %zu: <1us %llu, <2us %llu, <4us %llu, <8us %llu, ... >=32ms %llu",
+		    g, b[0], b[1], b[2], b[3], b[THREAD_CALL_LATENCY_BUCKETS - 1]);
+		for (int i = 0; i < THREAD_CALL_LATENCY_BUCKETS; i++) {
+			total += b[i];
+		}
+	}
+	T_EXPECT_GT(total, 0ULL, "some thread calls have run since boot");
+	free(hist);
+}
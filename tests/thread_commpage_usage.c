@@ -0,0 +1,172 @@
+#include <System/machine/cpu_capabilities.h>
+
+#include <darwintest.h>
+
+#include <mach/mach_time.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/sysctl.h>
+#include <time.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.scheduler"));
+
+#ifndef _COMM_PAGE_THREAD_USAGE
+
+T_DECL(thread_commpage_usage, "the commpage has the runtime of opted-in threads")
+{
+	T_SKIP("_COMM_PAGE_THREAD_USAGE doesn't exist on this system");
+}
+
+#else /* _COMM_PAGE_THREAD_USAGE */
+
+static mach_timebase_info_data_t timebase_info;
+
+static unsigned int
+cpu_number(void)
+{
+#if defined(__arm__)
+	uintptr_t p;
+	__asm__("mrc	p15, 0, %[p], c13, c0, 3" : [p] "=&r" (p));
+	return (unsigned int)(p & 0x3ul);
+#elif defined(__arm64__)
+	uint64_t p;
+	__asm__("mrs	%[p], TPIDRRO_EL0" : [p] "=&r" (p));
+	return (unsigned int)p & 0x7;
+#elif defined(__x86_64__) || defined(__i386__)
+	struct { uintptr_t p1, p2; } p;
+	__asm__("sidt %[p]" : [p] "=&m" (p));
+	return (unsigned int)(p.p1 & 0xfff);
+#endif
+}
+
+static void
+set_commpage_usage(int enable)
+{
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.thread_commpage_usage",
+	    NULL, NULL, &enable, sizeof(enable)), "kern.thread_commpage_usage=%d", enable);
+}
+
+/*
+ * Runtime of the calling thread in mach_absolute_time() units, following
+ * the protocol of commpage_thread_usage_t, or 0 after too many retries.
+ */
+static uint64_t
+commpage_thread_runtime(uint64_t thread_id, uint32_t *c_switch)
+{
+	commpage_thread_usage_t *ctu;
+	uint64_t runtime, now;
+	unsigned int cpu;
+	uint32_t gen;
+
+	for (int tries = 0; tries < 100; tries++) {
+		cpu = cpu_number();
+		if (cpu >= _COMM_PAGE_THREAD_USAGE_CPUS) {
+			return 0;
+		}
+		ctu = (commpage_thread_usage_t *)(uintptr_t)_COMM_PAGE_THREAD_USAGE + cpu;
+
+		gen = __atomic_load_n(&ctu->ctu_gen, __ATOMIC_ACQUIRE);
+		if (gen & 1) {
+			continue;
+		}
+		if (ctu->ctu_thread_id != thread_id) {
+			continue;
+		}
+		runtime = ctu->ctu_runtime;
+		now = mach_absolute_time();
+		runtime += now - ctu->ctu_dispatch;
+		if (c_switch) {
+			*c_switch = ctu->ctu_c_switch;
+		}
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (ctu->ctu_gen == gen && cpu_number() == cpu) {
+			return runtime;
+		}
+	}
+	return 0;
+}
+
+static uint64_t
+abs_to_nsec(uint64_t abstime)
+{
+	return abstime * timebase_info.numer / timebase_info.denom;
+}
+
+static void
+spin(uint64_t nsec)
+{
+	uint64_t end = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID) + nsec;
+
+	while (clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID) < end) {
+	}
+}
+
+T_DECL(thread_commpage_usage, "the commpage has the runtime of opted-in threads")
+{
+	uint64_t thread_id, before, runtime, after;
+	uint32_t c_switch = 0, first_c_switch = 0;
+	int enabled = 0;
+	size_t size = sizeof(enabled);
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_timebase_info(&timebase_info), "mach_timebase_info");
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_threadid_np(NULL, &thread_id), "pthread_threadid_np");
+
+	T_ASSERT_POSIX_SUCCESS(sysctlbyname("kern.thread_commpage_usage", &enabled,
+	    &size, NULL, 0), "kern.thread_commpage_usage");
+	T_EXPECT_EQ(enabled, 0, "threads don't publish their runtime by default");
+
+	set_commpage_usage(1);
+
+	T_ASSERT_NE(commpage_thread_runtime(thread_id, &first_c_switch), 0ULL,
+	    "the thread's runtime is in the commpage");
+
+	for (int i = 0; i < 100; i++) {
+		spin(100 * NSEC_PER_USEC);
+		if (i % 10 == 0) {
+			usleep(1000);
+		}
+
+		before = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+		runtime = abs_to_nsec(commpage_thread_runtime(thread_id, &c_switch));
+		after = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+
+		T_QUIET; T_ASSERT_NE(runtime, 0ULL, "commpage runtime");
+		/* allow for the rounding of abs_to_nsec() */
+		T_QUIET; T_EXPECT_GE(runtime + NSEC_PER_USEC, before,
+		    "commpage runtime isn't behind CLOCK_THREAD_CPUTIME_ID");
+		T_QUIET; T_EXPECT_LE(runtime, after + NSEC_PER_USEC,
+		    "commpage runtime isn't ahead of CLOCK_THREAD_CPUTIME_ID");
+	}
+	T_EXPECT_GT(c_switch, first_c_switch, "commpage counts the context switches");
+	T_PASS("commpage runtime matches CLOCK_THREAD_CPUTIME_ID");
+
+	set_commpage_usage(0);
+	T_EXPECT_EQ(commpage_thread_runtime(thread_id, NULL), 0ULL,
+	    "the runtime of a thread that opted out isn't in the commpage");
+}
+
+T_DECL(perf_thread_commpage_usage, "reading the thread runtime from the commpage",
+    T_META_TAG_PERF, T_META_CHECK_LEAKS(false))
+{
+	uint64_t thread_id;
+
+	T_QUIET; T_ASSERT_POSIX_ZERO(pthread_threadid_np(NULL, &thread_id), "pthread_threadid_np");
+	set_commpage_usage(1);
+
+	dt_stat_time_t s = dt_stat_time_create("commpage_thread_runtime");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)commpage_thread_runtime(thread_id, NULL);
+	}
+	dt_stat_finalize(s);
+
+	s = dt_stat_time_create("clock_gettime_thread_cputime");
+	T_STAT_MEASURE_LOOP(s) {
+		(void)clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+	}
+	dt_stat_finalize(s);
+
+	set_commpage_usage(0);
+}
+
+#endif /* _COMM_PAGE_THREAD_USAGE */
@@ -0,0 +1,103 @@
+#define PRIVATE
+#include <sys/socket.h>
+#undef PRIVATE
+
+#include <darwintest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Send and receive batches of datagrams over a connected UDP socket pair
+ * with sendmsg_x() and recvmsg_x().
+ */
+
+#define NDGRAMS		32
+#define DGRAM_SIZE	512
+
+static int
+udp_socket_connected(int peer, struct sockaddr_in *sin)
+{
+	socklen_t len = sizeof(*sin);
+	int s, bufsize = 4 * NDGRAMS * DGRAM_SIZE;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(s = socket(PF_INET, SOCK_DGRAM, 0), "socket");
+	/* sendmsg_x() needs room for the whole batch in the send buffer */
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(setsockopt(s, SOL_SOCKET, SO_SNDBUF,
+	    &bufsize, sizeof(bufsize)), "setsockopt(SO_SNDBUF)");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(setsockopt(s, SOL_SOCKET, SO_RCVBUF,
+	    &bufsize, sizeof(bufsize)), "setsockopt(SO_RCVBUF)");
+	sin->sin_port = 0;
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(bind(s, (struct sockaddr *)sin,
+	    sizeof(*sin)), "bind");
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(getsockname(s, (struct sockaddr *)sin,
+	    &len), "getsockname");
+	if (peer >= 0) {
+		struct sockaddr_in peer_sin;
+
+		len = sizeof(peer_sin);
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(getsockname(peer,
+		    (struct sockaddr *)&peer_sin, &len), "getsockname");
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(connect(s,
+		    (struct sockaddr *)&peer_sin, sizeof(peer_sin)), "connect");
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(connect(peer,
+		    (struct sockaddr *)sin, sizeof(*sin)), "connect");
+	}
+	return s;
+}
+
+T_DECL(udp_msgx, "batched UDP send and receive with sendmsg_x/recvmsg_x")
+{
+	static char sbuf[NDGRAMS][DGRAM_SIZE], rbuf[NDGRAMS][DGRAM_SIZE];
+	struct msghdr_x smsg[NDGRAMS], rmsg[NDGRAMS];
+	struct iovec siov[NDGRAMS], riov[NDGRAMS];
+	struct sockaddr_in sin = {
+		.sin_len = sizeof(sin),
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	int rcv, snd, i, received = 0;
+	ssize_t n;
+
+	rcv = udp_socket_connected(-1, &sin);
+	snd = udp_socket_connected(rcv, &sin);
+
+	memset(smsg, 0, sizeof(smsg));
+	memset(rmsg, 0, sizeof(rmsg));
+	for (i = 0; i < NDGRAMS; i++) {
+		memset(sbuf[i], 'a' + (i % 26), DGRAM_SIZE);
+		siov[i].iov_base = sbuf[i];
+		siov[i].iov_len = DGRAM_SIZE;
+		smsg[i].msg_iov = &siov[i];
+		smsg[i].msg_iovlen = 1;
+
+		riov[i].iov_base = rbuf[i];
+		riov[i].iov_len = DGRAM_SIZE;
+		rmsg[i].msg_iov = &riov[i];
+		rmsg[i].msg_iovlen = 1;
+	}
+
+	n = sendmsg_x(snd, smsg, NDGRAMS, 0);
+	T_ASSERT_POSIX_SUCCESS(n, "sendmsg_x");
+	T_EXPECT_EQ(n, (ssize_t)NDGRAMS, "all datagrams sent");
+
+	while (received < n) {
+		ssize_t r = recvmsg_x(rcv, &rmsg[received], NDGRAMS - received, 0);
+
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(r, "recvmsg_x");
+		T_QUIET; T_ASSERT_GT(r, (ssize_t)0, "received datagrams");
+		received += r;
+	}
+
+	for (i = 0; i < received; i++) {
+		T_QUIET; T_EXPECT_EQ(rmsg[i].msg_datalen, (size_t)DGRAM_SIZE,
+		    "datagram %d length", i);
+		T_QUIET; T_EXPECT_EQ(memcmp(rbuf[i], sbuf[i], DGRAM_SIZE), 0,
+		    "datagram %d contents", i);
+	}
+	T_PASS("received %d datagrams in order", received);
+
+	close(snd);
+	close(rcv);
+}
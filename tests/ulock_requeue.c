@@ -0,0 +1,90 @@
+#include <darwintest.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/ulock.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.ulock"));
+
+#define NWAITERS 8
+
+static _Atomic uint32_t cond_word;
+static _Atomic uint32_t mutex_word;
+static _Atomic int woken;
+
+static void *
+cond_waiter(void *arg __unused)
+{
+	while (atomic_load(&cond_word) == 0) {
+		__ulock_wait(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, &cond_word, 0, 0);
+	}
+	atomic_fetch_add(&woken, 1);
+	return NULL;
+}
+
+static void
+wait_for_woken(int expected)
+{
+	for (int i = 0; i < 100 && atomic_load(&woken) < expected; i++) {
+		usleep(10 * 1000);
+	}
+}
+
+T_DECL(ulock_wake_requeue,
+       "ULF_WAKE_REQUEUE releases one waiter per wakeup of the target ulock")
+{
+	pthread_t threads[NWAITERS];
+	int ret, i;
+
+	for (i = 0; i < NWAITERS; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_create(&threads[i], NULL, cond_waiter, NULL),
+		    "pthread_create");
+	}
+	/* let everyone block on the condition */
+	usleep(100 * 1000);
+
+	/* mark the mutex contended, then "broadcast" moving waiters onto it */
+	atomic_store(&mutex_word, 2);
+	atomic_store(&cond_word, 1);
+	ret = __ulock_wake(UL_COMPARE_AND_WAIT | ULF_WAKE_REQUEUE | ULF_NO_ERRNO,
+	    &cond_word, (uint64_t)(uintptr_t)&mutex_word);
+	T_ASSERT_EQ(ret, 0, "__ulock_wake(ULF_WAKE_REQUEUE)");
+
+	wait_for_woken(1);
+	usleep(50 * 1000);
+	T_EXPECT_EQ(atomic_load(&woken), 1, "only one waiter was woken by the requeue");
+
+	/* every uncontended wakeup of the mutex releases the next waiter */
+	for (i = 2; i <= NWAITERS; i++) {
+		ret = __ulock_wake(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, &mutex_word, 0);
+		T_QUIET; T_ASSERT_TRUE(ret == 0 || ret == -ENOENT, "__ulock_wake(mutex)");
+		wait_for_woken(i);
+		T_QUIET; T_ASSERT_EQ(atomic_load(&woken), i, "mutex wakeup %d released a waiter", i - 1);
+	}
+	T_PASS("all %d waiters were released through the mutex", NWAITERS);
+
+	for (i = 0; i < NWAITERS; i++) {
+		T_QUIET; T_ASSERT_POSIX_ZERO(pthread_join(threads[i], NULL), "pthread_join");
+	}
+}
+
+T_DECL(ulock_wake_requeue_invalid,
+       "ULF_WAKE_REQUEUE rejects invalid targets")
+{
+	int ret;
+
+	ret = __ulock_wake(UL_COMPARE_AND_WAIT | ULF_WAKE_REQUEUE | ULF_NO_ERRNO,
+	    &cond_word, (uint64_t)(uintptr_t)&cond_word);
+	T_EXPECT_EQ(ret, -EINVAL, "requeue onto itself");
+
+	ret = __ulock_wake(UL_COMPARE_AND_WAIT | ULF_WAKE_REQUEUE | ULF_WAKE_ALL | ULF_NO_ERRNO,
+	    &cond_word, (uint64_t)(uintptr_t)&mutex_word);
+	T_EXPECT_EQ(ret, -EINVAL, "requeue combined with ULF_WAKE_ALL");
+
+	ret = __ulock_wake(UL_UNFAIR_LOCK | ULF_WAKE_REQUEUE | ULF_NO_ERRNO,
+	    &cond_word, (uint64_t)(uintptr_t)&mutex_word);
+	T_EXPECT_EQ(ret, -EINVAL, "requeue of an unfair lock");
+}
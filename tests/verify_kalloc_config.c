@@ -4,6 +4,10 @@
 #include <mach_debug/mach_debug.h>
 #include <darwintest.h>
 
+#ifndef VM_KERN_SITE_KALLOC
+#define VM_KERN_SITE_KALLOC 0x00001000
+#endif
+
 T_GLOBAL_META(
 	T_META_NAMESPACE("xnu.vm"),
 	T_META_CHECK_LEAKS(false)
@@ -66,3 +70,48 @@ T_DECL( verify_kalloc_config,
 	run_test();
 }
 
+/*
+ * With the kalloc_profile boot-arg, mach_memory_info() also reports the
+ * requested kalloc sizes: each entry's bytes are a whole number of
+ * requests, and rounding never wastes a full zone element per request.
+ */
+T_DECL( verify_kalloc_profile,
+		"verifies the kalloc allocation profile entries",
+		T_META_ASROOT(true))
+{
+	kern_return_t kr;
+	mach_zone_name_t *name = NULL;
+	unsigned int nameCnt = 0;
+	mach_zone_info_t *info = NULL;
+	unsigned int infoCnt = 0;
+	mach_memory_info_t *wiredInfo = NULL;
+	unsigned int wiredInfoCnt = 0;
+	unsigned int i, entries = 0;
+
+	kr = mach_memory_info(mach_host_self(),
+			&name, &nameCnt, &info, &infoCnt,
+			&wiredInfo, &wiredInfoCnt);
+	T_QUIET; T_ASSERT_MACH_SUCCESS(kr, "mach_memory_info");
+
+	for (i = 0; i < wiredInfoCnt; i++) {
+		mach_memory_info_t *mi = &wiredInfo[i];
+		uint64_t count;
+
+		if (!(mi->flags & VM_KERN_SITE_KALLOC))
+			continue;
+		entries++;
+		T_QUIET; T_ASSERT_GT(mi->site, 0ULL, "request size");
+		T_QUIET; T_ASSERT_EQ(mi->size % mi->site, 0ULL, "whole number of requests");
+		count = mi->size / mi->site;
+		T_QUIET; T_ASSERT_LT(mi->collectable_bytes, count * (mi->site + 1) * 2,
+				"rounding waste of tag %d size %llu", mi->tag, mi->site);
+	}
+	if (entries == 0) {
+		T_SKIP("kalloc_profile boot-arg not set");
+	}
+	T_PASS("%u kalloc profile entries", entries);
+
+	vm_deallocate(mach_task_self(), (vm_address_t) name, (vm_size_t) (nameCnt * sizeof *name));
+	vm_deallocate(mach_task_self(), (vm_address_t) info, (vm_size_t) (infoCnt * sizeof *info));
+	vm_deallocate(mach_task_self(), (vm_address_t) wiredInfo, (vm_size_t) (wiredInfoCnt * sizeof *wiredInfo));
+}
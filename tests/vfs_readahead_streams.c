@@ -0,0 +1,60 @@
+#define PRIVATE
+#include <fcntl.h>
+#undef PRIVATE
+
+#include <darwintest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.vfs"));
+
+/*
+ * Interleave sequential reads of two regions of the same file: both
+ * streams must get their own read ahead context, as reported by
+ * F_GETRAHEADSTATS.
+ */
+
+#define FILE_SIZE	(8 * 1024 * 1024)
+#define READ_SIZE	(64 * 1024)
+
+T_DECL(vfs_readahead_streams, "read ahead tracks several streams per file")
+{
+	char path[] = "/tmp/vfs_readahead_streams.XXXXXX";
+	fraheadstats_t stats;
+	char *buf;
+	off_t off;
+	int fd;
+
+	fd = mkstemp(path);
+	T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	unlink(path);
+
+	buf = malloc(READ_SIZE);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	memset(buf, 'r', READ_SIZE);
+	for (off = 0; off < FILE_SIZE; off += READ_SIZE) {
+		T_QUIET; T_ASSERT_EQ(pwrite(fd, buf, READ_SIZE, off),
+		    (ssize_t)READ_SIZE, "pwrite");
+	}
+
+	for (off = 0; off < FILE_SIZE / 2; off += READ_SIZE) {
+		T_QUIET; T_ASSERT_EQ(pread(fd, buf, READ_SIZE, off),
+		    (ssize_t)READ_SIZE, "pread first half");
+		T_QUIET; T_ASSERT_EQ(pread(fd, buf, READ_SIZE, off + FILE_SIZE / 2),
+		    (ssize_t)READ_SIZE, "pread second half");
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	T_ASSERT_POSIX_SUCCESS(fcntl(fd, F_GETRAHEADSTATS, &stats),
+	    "fcntl(F_GETRAHEADSTATS)");
+	T_LOG("prefetched %llu hits %llu wasted %llu strided %u",
+	    stats.fra_prefetched, stats.fra_hits, stats.fra_wasted,
+	    stats.fra_strided);
+	T_EXPECT_GE(stats.fra_streams, 2U, "both streams are tracked");
+	T_EXPECT_EQ(stats.fra_wasted, stats.fra_prefetched > stats.fra_hits ?
+	    stats.fra_prefetched - stats.fra_hits : 0, "wasted pages add up");
+
+	free(buf);
+	close(fd);
+}
@@ -0,0 +1,57 @@
+#define PRIVATE
+#include <fcntl.h>
+#undef PRIVATE
+
+#include <darwintest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.vfs"));
+
+/*
+ * Scatter small cached writes over a file so that the write behind
+ * clusters overflow, then check what F_GETWBSTATS reports.
+ */
+
+#define FILE_SIZE	(64 * 1024 * 1024)
+#define WRITE_SIZE	4096
+#define NWRITES		4096
+
+T_DECL(vfs_wbstats, "write behind statistics are consistent")
+{
+	char path[] = "/tmp/vfs_wbstats.XXXXXX";
+	fwbstats_t stats;
+	char buf[WRITE_SIZE];
+	int fd, i;
+
+	fd = mkstemp(path);
+	T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	unlink(path);
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(ftruncate(fd, FILE_SIZE), "ftruncate");
+
+	memset(buf, 'w', sizeof(buf));
+	srandom(1);
+	for (i = 0; i < NWRITES; i++) {
+		off_t off = (random() % (FILE_SIZE / WRITE_SIZE)) * WRITE_SIZE;
+
+		T_QUIET; T_ASSERT_EQ(pwrite(fd, buf, sizeof(buf), off),
+		    (ssize_t)sizeof(buf), "pwrite");
+	}
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(fsync(fd), "fsync");
+
+	memset(&stats, 0, sizeof(stats));
+	T_ASSERT_POSIX_SUCCESS(fcntl(fd, F_GETWBSTATS, &stats),
+	    "fcntl(F_GETWBSTATS)");
+	T_LOG("switches %llu ios %llu pages %llu clusters %u sparse %u",
+	    stats.fwb_sparse_switches, stats.fwb_sparse_ios,
+	    stats.fwb_sparse_pages, stats.fwb_clusters, stats.fwb_sparse);
+	T_EXPECT_GE(stats.fwb_sparse_pages, stats.fwb_sparse_ios,
+	    "every sparse I/O pushes at least a page");
+	if (stats.fwb_sparse_ios != 0) {
+		T_EXPECT_GT(stats.fwb_sparse_switches, 0ULL,
+		    "sparse I/Os imply a switch to the sparse map");
+	}
+
+	close(fd);
+}
@@ -0,0 +1,77 @@
+#include <darwintest.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mach/mach.h>
+#include <sys/mman.h>
+
+#ifndef MADV_FAULTAROUND
+#define MADV_FAULTAROUND 11
+#endif
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.vm"));
+
+#define NPAGES 64
+
+static void
+get_fault_around_info(task_vm_info_data_t *info)
+{
+	mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+	kern_return_t kr;
+
+	kr = task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)info, &count);
+	T_QUIET; T_ASSERT_MACH_SUCCESS(kr, "task_info(TASK_VM_INFO)");
+	T_QUIET; T_ASSERT_GE(count, TASK_VM_INFO_REV3_COUNT, "kernel returned the rev3 counters");
+}
+
+T_DECL(vm_fault_around_madvise,
+       "madvise(MADV_FAULTAROUND) maps resident neighbours of a file backed fault")
+{
+	task_vm_info_data_t before, after;
+	char path[] = "/tmp/vm_fault_around.XXXXXX";
+	size_t len = NPAGES * (size_t)PAGE_SIZE;
+	volatile char *addr;
+	char *buf;
+	char sum = 0;
+	int fd, i;
+
+	fd = mkstemp(path);
+	T_ASSERT_POSIX_SUCCESS(fd, "mkstemp");
+	unlink(path);
+
+	/* writing the file leaves its pages resident in the UBC */
+	buf = malloc(len);
+	T_QUIET; T_ASSERT_NOTNULL(buf, "malloc");
+	memset(buf, 'a', len);
+	T_QUIET; T_ASSERT_EQ(write(fd, buf, len), (ssize_t)len, "write");
+	free(buf);
+
+	addr = mmap(NULL, len, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
+	T_ASSERT_NE((void *)addr, MAP_FAILED, "mmap");
+
+	T_ASSERT_POSIX_SUCCESS(madvise((void *)(uintptr_t)addr, len, MADV_FAULTAROUND),
+	    "madvise(MADV_FAULTAROUND)");
+
+	get_fault_around_info(&before);
+
+	for (i = 0; i < NPAGES; i++) {
+		sum += addr[i * PAGE_SIZE];
+	}
+	T_QUIET; T_ASSERT_EQ(sum, (char)('a' * NPAGES), "read back the file contents");
+
+	get_fault_around_info(&after);
+
+	T_EXPECT_GT(after.fault_around_faults, before.fault_around_faults,
+	    "faults on the advised range looked at neighbours");
+	T_EXPECT_GT(after.fault_around_pages, before.fault_around_pages,
+	    "resident neighbours were mapped by fault-around");
+	T_EXPECT_LE(after.fault_around_pages - before.fault_around_pages,
+	    after.fault_around_candidates - before.fault_around_candidates,
+	    "never maps more pages than it looked at");
+
+	munmap((void *)(uintptr_t)addr, len);
+	close(fd);
+}
@@ -0,0 +1,71 @@
+#include <darwintest.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mach/mach.h>
+#include <sys/mman.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.vm"));
+
+/*
+ * Zero-fill faults may be served from the pre-zeroed page pool: the
+ * pages must still read back as zeroes, and every such fault is counted
+ * either as a hit or as a miss of the pool.
+ */
+
+#define NPAGES 512
+
+static uint64_t
+get_quad(const char *name)
+{
+	uint64_t val = 0;
+	size_t len = sizeof(val);
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname(name, &val, &len, NULL, 0),
+	    "sysctlbyname(%s)", name);
+	return val;
+}
+
+T_DECL(vm_page_prezero,
+       "zero-fill faults served from the pre-zeroed pool read as zeroes")
+{
+	size_t len = NPAGES * (size_t)PAGE_SIZE;
+	uint64_t hits, misses;
+	volatile char *addr;
+	int pass, i, j;
+
+	for (pass = 0; pass < 2; pass++) {
+		hits = get_quad("vm.page_prezero_hits");
+		misses = get_quad("vm.page_prezero_misses");
+
+		addr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		    MAP_ANON | MAP_PRIVATE, -1, 0);
+		T_ASSERT_NE((void *)addr, MAP_FAILED, "mmap");
+
+		for (i = 0; i < NPAGES; i++) {
+			const volatile uint64_t *p;
+
+			p = (const volatile uint64_t *)(addr + i * PAGE_SIZE);
+			for (j = 0; j < (int)(PAGE_SIZE / sizeof(*p)); j++) {
+				if (p[j] != 0) {
+					T_ASSERT_FAIL("page %d is not zero at offset %d",
+					    i, j * (int)sizeof(*p));
+				}
+			}
+			addr[i * PAGE_SIZE] = 'z';
+		}
+
+		hits = get_quad("vm.page_prezero_hits") - hits;
+		misses = get_quad("vm.page_prezero_misses") - misses;
+		T_LOG("pass %d: %llu hits %llu misses", pass, hits, misses);
+		T_EXPECT_GT(hits + misses, 0ULL, "zero-fill faults asked the pool");
+
+		munmap((void *)(uintptr_t)addr, len);
+
+		/* give the pool thread a chance to refill */
+		sleep(1);
+	}
+}
@@ -0,0 +1,98 @@
+#include <darwintest.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mach/mach.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.vm"));
+
+/*
+ * Build a shadow chain two levels deep by forking twice, writing a
+ * page after each fork, then read untouched pages in the grandchild:
+ * those faults walk both shadow objects and must show up in the
+ * TASK_VM_INFO shadow depth histogram.
+ */
+
+#define NPAGES 32
+
+static int
+deep_faults(volatile char *addr)
+{
+	task_vm_info_data_t before, after;
+	mach_msg_type_number_t count;
+	uint64_t deep_before = 0, deep_after = 0;
+	char sum = 0;
+	int i;
+
+	count = TASK_VM_INFO_COUNT;
+	if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&before,
+	    &count) != KERN_SUCCESS || count < TASK_VM_INFO_REV4_COUNT) {
+		return 2;
+	}
+	for (i = 2; i < NPAGES; i++) {
+		sum += addr[i * PAGE_SIZE];
+	}
+	count = TASK_VM_INFO_COUNT;
+	if (task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&after,
+	    &count) != KERN_SUCCESS) {
+		return 2;
+	}
+	if (sum != (char)('s' * (NPAGES - 2))) {
+		return 3;
+	}
+	/* bucket 2 counts faults that walked 2-3 shadow objects */
+	for (i = 2; i < TASK_VM_INFO_SHADOW_DEPTH_BUCKETS; i++) {
+		deep_before += before.shadow_depth[i];
+		deep_after += after.shadow_depth[i];
+	}
+	return deep_after > deep_before ? 0 : 1;
+}
+
+static int
+wait_child(pid_t pid)
+{
+	int status;
+
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+		return 4;
+	}
+	return WEXITSTATUS(status);
+}
+
+T_DECL(vm_shadow_depth,
+       "TASK_VM_INFO reports faults walking deep shadow chains")
+{
+	size_t len = NPAGES * (size_t)PAGE_SIZE;
+	volatile char *addr;
+	pid_t pid;
+
+	addr = mmap(NULL, len, PROT_READ | PROT_WRITE,
+	    MAP_ANON | MAP_PRIVATE, -1, 0);
+	T_ASSERT_NE((void *)addr, MAP_FAILED, "mmap");
+	memset((void *)(uintptr_t)addr, 's', len);
+
+	pid = fork();
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(pid, "fork");
+	if (pid == 0) {
+		pid_t gpid;
+
+		addr[0] = 'c';
+		gpid = fork();
+		if (gpid < 0) {
+			_exit(5);
+		}
+		if (gpid == 0) {
+			addr[PAGE_SIZE] = 'g';
+			_exit(deep_faults(addr));
+		}
+		_exit(wait_child(gpid));
+	}
+
+	T_ASSERT_EQ(wait_child(pid), 0,
+	    "grandchild's faults were counted as walking the shadow chain");
+
+	munmap((void *)(uintptr_t)addr, len);
+}
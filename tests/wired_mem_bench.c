@@ -23,10 +23,14 @@
 
 #include <darwintest.h>
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/sysctl.h>
 #include <mach/mach.h>
+#include <mach/mach_time.h>
 #include <sys/utsname.h>
 #include <TargetConditionals.h>
 
@@ -98,3 +102,60 @@ T_DECL(wired_mem_bench,
 		    "Wired memory percentage is below allowable threshold (%llu bytes / %u pages / %llu total device memory)",
 		    (uint64_t)stat.wire_count * page_size, stat.wire_count, memsize);
 }
+
+/*
+ * Time mlock() and munlock() of multi-GB anonymous ranges, both freshly
+ * allocated (wiring zero-fills them) and already resident, to track the
+ * cost of wiring large buffers.
+ */
+static void
+wired_mem_bench_mlock(uint64_t size, int prefault)
+{
+	mach_timebase_info_data_t tb;
+	uint64_t memsize, start, wire_ns, unwire_ns;
+	size_t s = sizeof(memsize);
+	char name[64];
+	void *addr;
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(sysctlbyname("hw.memsize", &memsize, &s, NULL, 0),
+	    "sysctlbyname(\"hw.memsize\")");
+	if (size > memsize / 4) {
+		T_LOG("skipping %llu GB, device has %llu GB", size >> 30, memsize >> 30);
+		return;
+	}
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_timebase_info(&tb), "mach_timebase_info");
+
+	addr = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+	T_QUIET; T_ASSERT_NE(addr, MAP_FAILED, "mmap(%llu GB)", size >> 30);
+	if (prefault) {
+		memset(addr, 1, (size_t)size);
+	}
+
+	start = mach_absolute_time();
+	T_ASSERT_POSIX_SUCCESS(mlock(addr, (size_t)size), "mlock(%llu GB)", size >> 30);
+	wire_ns = (mach_absolute_time() - start) * tb.numer / tb.denom;
+
+	start = mach_absolute_time();
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(munlock(addr, (size_t)size), "munlock");
+	unwire_ns = (mach_absolute_time() - start) * tb.numer / tb.denom;
+
+	snprintf(name, sizeof(name), "mlock_%lluGB%s", size >> 30, prefault ? "_resident" : "");
+	T_PERF(name, (double)wire_ns / NSEC_PER_MSEC, "ms", "time to wire the range");
+	snprintf(name, sizeof(name), "munlock_%lluGB%s", size >> 30, prefault ? "_resident" : "");
+	T_PERF(name, (double)unwire_ns / NSEC_PER_MSEC, "ms", "time to unwire the range");
+
+	T_QUIET; T_ASSERT_POSIX_SUCCESS(munmap(addr, (size_t)size), "munmap");
+}
+
+T_DECL(wired_mem_bench_mlock,
+       "time wiring and unwiring multi-GB anonymous ranges",
+	T_META_CHECK_LEAKS(false),
+	T_META_ASROOT(true))
+{
+	uint64_t gb;
+
+	for (gb = 1; gb <= 16; gb *= 4) {
+		wired_mem_bench_mlock(gb << 30, 0);
+		wired_mem_bench_mlock(gb << 30, 1);
+	}
+}
@@ -11,6 +11,8 @@
 #include <pthread.h>
 
 #include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
 
 #include <darwintest.h>
 
@@ -120,3 +122,53 @@ T_DECL(work_interval, "work interval interface")
 
 }
 
+
+T_DECL(work_interval_budget, "work intervals with a CPU budget are scheduled as realtime")
+{
+	int ret = 0;
+	work_interval_t handle = NULL;
+	mach_timebase_info_data_t tb;
+	uint64_t overruns = 0;
+
+	T_QUIET; T_ASSERT_MACH_SUCCESS(mach_timebase_info(&tb), "mach_timebase_info");
+
+	/* 10ms periods with 2ms of work each */
+	uint64_t period = 10000000ULL * tb.denom / tb.numer;
+	uint64_t budget = 2000000ULL * tb.denom / tb.numer;
+
+	ret = work_interval_create(&handle, 0);
+	T_ASSERT_POSIX_SUCCESS(ret, "work_interval_create, no flags");
+
+	ret = work_interval_set_budget(handle, period, period + 1);
+	T_ASSERT_EQ(ret, -1, "a budget larger than its period is refused");
+	T_ASSERT_EQ(errno, EINVAL, "a budget larger than its period errno EINVAL");
+
+	ret = work_interval_set_budget(handle, period, budget);
+	T_ASSERT_POSIX_SUCCESS(ret, "work_interval_set_budget");
+
+	thread_time_constraint_policy_data_t policy;
+	mach_msg_type_number_t count = THREAD_TIME_CONSTRAINT_POLICY_COUNT;
+	boolean_t get_default = FALSE;
+	kern_return_t kr = thread_policy_get(mach_thread_self(), THREAD_TIME_CONSTRAINT_POLICY,
+	    (thread_policy_t)&policy, &count, &get_default);
+	T_ASSERT_MACH_SUCCESS(kr, "thread_policy_get");
+	T_EXPECT_FALSE(get_default, "the thread is realtime");
+	T_EXPECT_EQ((uint64_t)policy.computation, budget, "computation is the interval's budget");
+	T_EXPECT_EQ((uint64_t)policy.constraint, period, "constraint is the interval's period");
+
+	uint64_t now = mach_absolute_time();
+	ret = work_interval_notify(handle, now - 2 * period, now, now - period, now, 0);
+	T_ASSERT_POSIX_SUCCESS(ret, "work_interval_notify, past the deadline");
+	ret = work_interval_notify(handle, now - period, now, now + period, now + period, 0);
+	T_ASSERT_POSIX_SUCCESS(ret, "work_interval_notify, before the deadline");
+
+	ret = work_interval_get_overruns(handle, &overruns);
+	T_ASSERT_POSIX_SUCCESS(ret, "work_interval_get_overruns");
+	T_EXPECT_EQ(overruns, 1ULL, "only the late instance overran");
+
+	ret = work_interval_set_budget(handle, 0, 0);
+	T_ASSERT_POSIX_SUCCESS(ret, "work_interval_set_budget, no budget");
+
+	ret = work_interval_destroy(handle);
+	T_ASSERT_POSIX_SUCCESS(ret, "work_interval_destroy");
+}
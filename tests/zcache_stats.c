@@ -0,0 +1,69 @@
+#include <darwintest.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/sysctl.h>
+
+T_GLOBAL_META(T_META_NAMESPACE("xnu.vm"));
+
+/* Mirrors struct zcache_zone_stats in osfmk/kern/zalloc.h */
+struct zcache_zone_stats {
+	char		zcs_zone_name[80];
+	uint64_t	zcs_alloc_hits;
+	uint64_t	zcs_alloc_misses;
+	uint64_t	zcs_free_hits;
+	uint64_t	zcs_free_misses;
+	uint64_t	zcs_depot_resizes;
+	uint32_t	zcs_magazine_size;
+	uint32_t	zcs_depot_full;
+};
+
+T_DECL(zcache_kalloc_stats,
+       "Validate that the kalloc zones are cached and report hit/miss counts")
+{
+	struct zcache_zone_stats *stats;
+	size_t size = 0;
+	unsigned int i, count, kalloc_zones = 0;
+	uint64_t hits = 0;
+	int ret;
+
+	ret = sysctlbyname("kern.zcache_stats", NULL, &size, NULL, 0);
+	if (ret == -1 && errno == ENOENT) {
+		T_SKIP("kern.zcache_stats not available (no CONFIG_ZCACHE)");
+	}
+	T_ASSERT_POSIX_SUCCESS(ret, "sysctl kern.zcache_stats size");
+	T_QUIET; T_ASSERT_GT(size, (size_t)0, "at least one zone is cached");
+
+	/* generate some kalloc traffic through the file descriptor table and pipes */
+	for (i = 0; i < 1000; i++) {
+		int fds[2];
+		T_QUIET; T_ASSERT_POSIX_SUCCESS(pipe(fds), "pipe");
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	stats = malloc(size);
+	T_QUIET; T_ASSERT_NOTNULL(stats, "malloc");
+
+	ret = sysctlbyname("kern.zcache_stats", stats, &size, NULL, 0);
+	T_ASSERT_POSIX_SUCCESS(ret, "sysctl kern.zcache_stats");
+	T_QUIET; T_ASSERT_EQ(size % sizeof(*stats), (size_t)0, "whole number of entries");
+
+	count = (unsigned int)(size / sizeof(*stats));
+	for (i = 0; i < count; i++) {
+		T_QUIET; T_ASSERT_GT(stats[i].zcs_magazine_size, 0, "%s has a non-empty magazine size",
+		    stats[i].zcs_zone_name);
+		if (strncmp(stats[i].zcs_zone_name, "kalloc.", strlen("kalloc.")) == 0) {
+			kalloc_zones++;
+			hits += stats[i].zcs_alloc_hits + stats[i].zcs_free_hits;
+		}
+	}
+
+	T_EXPECT_GT(kalloc_zones, 0, "kalloc zones are cached by default");
+	T_EXPECT_GT(hits, 0ULL, "kalloc zone caches are being hit");
+
+	free(stats);
+}
@@ -76,6 +76,8 @@ static boolean_t	threaded = FALSE;
 static boolean_t	oneway = FALSE;
 static boolean_t	useset = FALSE;
 static boolean_t	save_perfdata = FALSE;
+static boolean_t	measure_latency = FALSE;
+static int		vector_count = 0;
 int			msg_type;
 int			num_ints;
 int			num_msgs;
@@ -95,6 +97,10 @@ struct port_args	*server_port_args;
 mach_timebase_info_data_t g_timebase;
 int64_t g_client_send_time = 0;
 
+/* log2 histogram of client round-trip times in usec, for -latency */
+#define LATENCY_BUCKETS	24
+int64_t g_rpc_latency_hist[LATENCY_BUCKETS];
+
 static inline uint64_t ns_to_abs(uint64_t ns)
 {
 	return ns * g_timebase.denom / g_timebase.numer;
@@ -109,6 +115,65 @@ static inline uint64_t abs_to_ns(uint64_t abs)
 void signal_handler(int sig) {
 }
 
+static void
+record_rpc_latency(uint64_t abs)
+{
+	uint64_t us = abs_to_ns(abs) / NSEC_PER_USEC;
+	int b = 0;
+
+	while (us) {
+		us >>= 1;
+		b++;
+	}
+	if (b >= LATENCY_BUCKETS)
+		b = LATENCY_BUCKETS - 1;
+	OSAtomicIncrement64(&g_rpc_latency_hist[b]);
+}
+
+/*
+ * Upper bound, in usec, of the bucket holding the pct_x10/1000 quantile
+ */
+static uint64_t
+latency_percentile(int64_t total, uint32_t pct_x10)
+{
+	int64_t rank = (total * pct_x10 + 999) / 1000;
+	int64_t seen = 0;
+	int b;
+
+	for (b = 0; b < LATENCY_BUCKETS - 1; b++) {
+		seen += g_rpc_latency_hist[b];
+		if (seen >= rank)
+			break;
+	}
+	return (1ULL << b) - 1;
+}
+
+static void
+print_rpc_latency(void)
+{
+	int64_t total = 0;
+	int b, last = 0;
+
+	for (b = 0; b < LATENCY_BUCKETS; b++) {
+		total += g_rpc_latency_hist[b];
+		if (g_rpc_latency_hist[b])
+			last = b;
+	}
+	if (total == 0)
+		return;
+
+	printf("  round-trip time (usec): p50 <= %llu, p90 <= %llu, p99 <= %llu, p99.9 <= %llu\n",
+	       latency_percentile(total, 500), latency_percentile(total, 900),
+	       latency_percentile(total, 990), latency_percentile(total, 999));
+	for (b = 0; b <= last; b++) {
+		if (b == 0)
+			printf("  %12s: %lld\n", "< 1", g_rpc_latency_hist[b]);
+		else
+			printf("  %5llu - %5llu: %lld\n", 1ULL << (b - 1), (1ULL << b) - 1,
+			       g_rpc_latency_hist[b]);
+	}
+}
+
 void usage(const char *progname) {
 	fprintf(stderr, "usage: %s [options]\n", progname);
 	fprintf(stderr, "where options are:\n");
@@ -117,8 +182,10 @@ void usage(const char *progname) {
 	fprintf(stderr, "    -threaded\t\tuse (p)threads\n");
 	fprintf(stderr, "    -verbose\t\tbe verbose (use multiple times to increase verbosity)\n");
 	fprintf(stderr, "    -oneway\t\tdo not request return reply\n");
+	fprintf(stderr, "    -vector num\t\tsend num messages per mach_msg_send_vector_trap (requires -oneway)\n");
 	fprintf(stderr, "    -count num\t\tnumber of messages to send\n");
 	fprintf(stderr, "    -perf   \t\tCreate perfdata files for metrics.\n");
+	fprintf(stderr, "    -latency\t\treport round-trip time percentiles (requires -threaded)\n");
 	fprintf(stderr, "    -type trivial|inline|complex\ttype of messages to send\n");
 	fprintf(stderr, "    -numints num\tnumber of 32-bit ints to send in messages\n");
 	fprintf(stderr, "    -servers num\tnumber of server threads to run\n");
@@ -135,6 +202,7 @@ void usage(const char *progname) {
 	fprintf(stderr, "    . not threaded\n");
 	fprintf(stderr, "    . not verbose\n");
 	fprintf(stderr, "    . not oneway\n");
+	fprintf(stderr, "    . one message per send\n");
 	fprintf(stderr, "    . client sends 100000 messages\n");
 	fprintf(stderr, "    . inline message type\n");
 	fprintf(stderr, "    . 64 32-bit integers in inline/complex messages\n");
@@ -184,9 +252,19 @@ void parse_args(int argc, char *argv[]) {
 		} else if (0 == strcmp("-oneway", argv[0])) {
 			oneway = TRUE;
 			argc--; argv++;
+		} else if (0 == strcmp("-vector", argv[0])) {
+			if (argc < 2) 
+				usage(progname);
+			vector_count = strtoul(argv[1], NULL, 0);
+			if (vector_count <= 0 || vector_count > MACH_MSG_VECTOR_MAX)
+				usage(progname);
+			argc -= 2; argv += 2;
 		} else if (0 == strcmp("-perf", argv[0])) {
 			save_perfdata = TRUE;
 			argc--; argv++;
+		} else if (0 == strcmp("-latency", argv[0])) {
+			measure_latency = TRUE;
+			argc--; argv++;
 		} else if (0 == strcmp("-type", argv[0])) {
 			if (argc < 2) 
 				usage(progname);
@@ -253,6 +331,16 @@ void parse_args(int argc, char *argv[]) {
 		}
 	}
 
+	if (vector_count && !oneway) {
+		fprintf(stderr, "Vectored sends require -oneway\n");
+		exit(1);
+	}
+
+	if (measure_latency && (oneway || !threaded)) {
+		fprintf(stderr, "Latency measurement requires -threaded and not -oneway\n");
+		exit(1);
+	}
+
 	if (stress_prepost) {
 		if (!threaded) {
 			fprintf(stderr, "Prepost stress test _must_ be threaded\n");
@@ -648,6 +736,8 @@ void *client(void *threadarg)
 	kern_return_t ret;
 	int server_num = (int)(uintptr_t)threadarg;
 	void *ints = malloc(sizeof(u_int32_t) * num_ints);
+	mach_msg_vector_t *vec = NULL;
+	int batch = 1, i;
 
 	if (verbose) 
 		printf("client(%d) started, server port name %s\n",
@@ -683,10 +773,16 @@ void *client(void *threadarg)
 			client_memory[i * PAGE_SIZE / sizeof(long)] = 0;
 	}
 
+	if (vector_count) {
+		vec = calloc(vector_count, sizeof(*vec));
+		if (vec == NULL)
+			err(1, "calloc");
+	}
+
 	uint64_t starttm, endtm;
 	
 	/* start message loop */
-	for (idx = 0; idx < num_msgs; idx++) {
+	for (idx = 0; idx < num_msgs; idx += batch) {
 		req = args.req_msg;
 		reply = args.reply_msg;
 
@@ -718,20 +814,50 @@ void *client(void *threadarg)
 		if (verbose > 2)
 			printf("client sending message %d to port %#x\n",
 			       idx, req->msgh_remote_port);
-		starttm = mach_absolute_time();
-		ret = mach_msg(req,  
-				MACH_SEND_MSG, 
-				args.req_size, 
-				0, 
-				MACH_PORT_NULL,  
-				MACH_MSG_TIMEOUT_NONE, 
-				MACH_PORT_NULL);
-		endtm = mach_absolute_time();
-		if (MACH_MSG_SUCCESS != ret) {
-			mach_error("mach_msg (send): ", ret);
-			fprintf(stderr, "bailing after %u iterations\n", idx);
-			exit(1);
-			break;
+		if (vector_count) {
+			/* the same request, sent batch times in one trap */
+			batch = MIN(vector_count, num_msgs - idx);
+			for (i = 0; i < batch; i++) {
+				vec[i].msgv_msg = (mach_vm_address_t)(uintptr_t)req;
+				vec[i].msgv_send_size = args.req_size;
+				vec[i].msgv_return = MACH_MSG_SUCCESS;
+			}
+			starttm = mach_absolute_time();
+			ret = mach_msg_send_vector_trap(vec, batch,
+					MACH_SEND_MSG,
+					MACH_MSG_TIMEOUT_NONE,
+					MACH_MSG_PRIORITY_UNSPECIFIED);
+			endtm = mach_absolute_time();
+			if (MACH_MSG_SUCCESS != ret) {
+				mach_error("mach_msg_send_vector_trap: ", ret);
+				fprintf(stderr, "bailing after %u iterations\n", idx);
+				exit(1);
+			}
+			for (i = 0; i < batch; i++) {
+				if (MACH_MSG_SUCCESS != vec[i].msgv_return) {
+					mach_error("mach_msg_send_vector_trap (send): ",
+							vec[i].msgv_return);
+					fprintf(stderr, "bailing after %u iterations\n",
+							idx + i);
+					exit(1);
+				}
+			}
+		} else {
+			starttm = mach_absolute_time();
+			ret = mach_msg(req,  
+					MACH_SEND_MSG, 
+					args.req_size, 
+					0, 
+					MACH_PORT_NULL,  
+					MACH_MSG_TIMEOUT_NONE, 
+					MACH_PORT_NULL);
+			endtm = mach_absolute_time();
+			if (MACH_MSG_SUCCESS != ret) {
+				mach_error("mach_msg (send): ", ret);
+				fprintf(stderr, "bailing after %u iterations\n", idx);
+				exit(1);
+				break;
+			}
 		}
 		if (stress_prepost)
 			OSAtomicAdd64(endtm - starttm, &g_client_send_time);
@@ -757,11 +883,14 @@ void *client(void *threadarg)
 			}
 			if (verbose > 2)
 				printf("client received reply %d\n", idx);
+			if (measure_latency)
+				record_rpc_latency(mach_absolute_time() - starttm);
 		}
 
 		client_work();
 	}
 
+	free(vec);
 	free(ints);
 	return NULL;
 }
@@ -966,6 +1095,9 @@ int main(int argc, char *argv[])
 		       dsecs * 1.0E6 / (double)totalmsg);
 	}
 
+	if (measure_latency)
+		print_rpc_latency();
+
 	return (0);
 
 }
@@ -0,0 +1,10 @@
+/*
+ * The arm and arm64 checksum routines are written in assembly; pull in
+ * the kernel's copy for test_cksum_helper.c.  x86 uses the C version.
+ */
+#define LIBSYSCALL_INTERFACE 1
+#if defined(__arm64__)
+#include "../../../bsd/dev/arm64/cpu_in_cksum.s"
+#elif defined(__arm__)
+#include "../../../bsd/dev/arm/cpu_in_cksum.s"
+#endif
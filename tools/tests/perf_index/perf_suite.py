@@ -0,0 +1,104 @@
+#!/usr/bin/python
+
+# Runs perf_index tests repeatedly on the local machine and reports the
+# distribution of the run times, as text or as JSON for regression tracking.
+
+import json
+import math
+import os
+import subprocess
+import sys
+
+# test type, job size; sized to take on the order of a second each
+_SUITE = [
+  ("syscall", 10000000),
+  ("stat", 2000000),
+  ("fd", 10000000),
+  ("mach_msg", 2000000),
+  ("kevent", 2000000),
+  ("spawn", 2000),
+  ("fault", 500000),
+  ("zfod", 500000),
+  ("udp", 500000),
+  ("file_create", 20000),
+]
+
+# two-sided 95% Student's t values, indexed by degrees of freedom
+_T95 = [0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+        2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+        2.042]
+
+def percentile(samples, pct):
+  # nearest-rank on sorted samples
+  rank = int(math.ceil(pct / 100.0 * len(samples)))
+  return samples[max(rank, 1) - 1]
+
+def summarize(samples):
+  samples = sorted(samples)
+  n = len(samples)
+  mean = sum(samples) / n
+  if n > 1:
+    stddev = math.sqrt(sum((s - mean) ** 2 for s in samples) / (n - 1))
+    t = _T95[n - 1] if n - 1 < len(_T95) else 1.960
+    ci = t * stddev / math.sqrt(n)
+  else:
+    stddev = 0.0
+    ci = 0.0
+  return {
+    "runs": n,
+    "mean": mean,
+    "stddev": stddev,
+    "ci95": ci,
+    "min": samples[0],
+    "median": percentile(samples, 50),
+    "p90": percentile(samples, 90),
+    "p99": percentile(samples, 99),
+    "max": samples[-1],
+  }
+
+def run_test(perf_index, test_type, threads, size):
+  out = subprocess.check_output([perf_index, test_type, str(threads), str(size)])
+  # perf_index prints the elapsed seconds last
+  return float(out.split()[-1])
+
+def main(runs, threads, as_json, tests):
+  perf_index = os.path.join(os.path.dirname(os.path.abspath(sys.argv[0])), "perf_index")
+  results = {}
+  for test_type, size in _SUITE:
+    if tests and test_type not in tests:
+      continue
+    samples = [run_test(perf_index, test_type, threads, size) for _ in range(runs)]
+    results[test_type] = summarize(samples)
+    results[test_type]["size"] = size
+    results[test_type]["threads"] = threads
+
+  if as_json:
+    sys.stdout.write(json.dumps(results, indent=2, sort_keys=True) + "\n")
+    return
+  for test_type in sorted(results):
+    r = results[test_type]
+    sys.stdout.write("%-12s median %.6f p90 %.6f p99 %.6f mean %.6f +/- %.6f (n=%d)\n" %
+                     (test_type, r["median"], r["p90"], r["p99"], r["mean"], r["ci95"], r["runs"]))
+
+def usage():
+  sys.stderr.write("usage: perf_suite.py [-j] runs threads [test ...]\n")
+  exit(1)
+
+if __name__ == "__main__":
+  argv = sys.argv[1:]
+  as_json = False
+  if len(argv) > 0 and argv[0] == "-j":
+    as_json = True
+    argv = argv[1:]
+  if len(argv) < 2:
+    usage()
+  try:
+    runs = int(argv[0])
+    threads = int(argv[1])
+  except ValueError:
+    usage()
+  if runs < 1 or threads < 1:
+    usage()
+
+  main(runs, threads, as_json, argv[2:])
@@ -0,0 +1,15 @@
+#include "perf_index.h"
+#include "fail.h"
+#include "test_cksum_helper.h"
+
+DECL_SETUP {
+    return test_cksum_setup(num_threads);
+}
+
+DECL_TEST {
+    return test_cksum_helper(thread_id, num_threads, length, TESTCKSUM);
+}
+
+DECL_CLEANUP {
+    return test_cksum_cleanup(num_threads);
+}
@@ -0,0 +1,36 @@
+#include "perf_index.h"
+#include "fail.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#define NUM_FDS 256
+
+static int fds[NUM_FDS];
+
+DECL_SETUP {
+    int i;
+
+    for(i=0; i<NUM_FDS; i++) {
+        fds[i] = open("/dev/null", O_RDONLY);
+        VERIFY(fds[i] >= 0, "open failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+DECL_TEST {
+    long long i;
+
+    for(i=0; i<length; i++) {
+        VERIFY(fcntl(fds[i % NUM_FDS], F_GETFL) >= 0, "fcntl failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+DECL_CLEANUP {
+    int i;
+
+    for(i=0; i<NUM_FDS; i++) {
+        close(fds[i]);
+    }
+    return PERFINDEX_SUCCESS;
+}
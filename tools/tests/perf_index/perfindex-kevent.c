@@ -0,0 +1,45 @@
+#include "perf_index.h"
+#include "fail.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/event.h>
+
+static int* kqs = NULL;
+
+DECL_SETUP {
+    struct kevent kev;
+    int i;
+
+    kqs = (int*)malloc(sizeof(int) * num_threads);
+    VERIFY(kqs, "malloc failed");
+
+    for(i=0; i<num_threads; i++) {
+        kqs[i] = kqueue();
+        VERIFY(kqs[i] >= 0, "kqueue failed");
+        EV_SET(&kev, 1, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, NULL);
+        VERIFY(kevent(kqs[i], &kev, 1, NULL, 0, NULL) == 0, "kevent add failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+/* trigger the event and collect it in the same call */
+DECL_TEST {
+    struct kevent kev, out;
+    long long i;
+
+    EV_SET(&kev, 1, EVFILT_USER, 0, NOTE_TRIGGER, 0, NULL);
+    for(i=0; i<length; i++) {
+        VERIFY(kevent(kqs[thread_id], &kev, 1, &out, 1, NULL) == 1, "kevent failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+DECL_CLEANUP {
+    int i;
+
+    for(i=0; i<num_threads; i++) {
+        close(kqs[i]);
+    }
+    free(kqs);
+    return PERFINDEX_SUCCESS;
+}
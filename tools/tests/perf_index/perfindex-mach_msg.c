@@ -0,0 +1,58 @@
+#include "perf_index.h"
+#include "fail.h"
+#include <stdlib.h>
+#include <mach/mach.h>
+
+typedef struct {
+    mach_msg_header_t header;
+    mach_msg_trailer_t trailer;
+} rpc_msg_t;
+
+static mach_port_t* ports = NULL;
+
+DECL_SETUP {
+    kern_return_t kr;
+    int i;
+
+    ports = (mach_port_t*)malloc(sizeof(mach_port_t) * num_threads);
+    VERIFY(ports, "malloc failed");
+
+    for(i=0; i<num_threads; i++) {
+        kr = mach_port_allocate(mach_task_self(), MACH_PORT_RIGHT_RECEIVE, &ports[i]);
+        VERIFY(kr == KERN_SUCCESS, "mach_port_allocate failed");
+        kr = mach_port_insert_right(mach_task_self(), ports[i], ports[i], MACH_MSG_TYPE_MAKE_SEND);
+        VERIFY(kr == KERN_SUCCESS, "mach_port_insert_right failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+/* send a message to our own port and receive it back in one mach_msg() */
+DECL_TEST {
+    rpc_msg_t msg;
+    mach_port_t port = ports[thread_id];
+    kern_return_t kr;
+    long long i;
+
+    for(i=0; i<length; i++) {
+        msg.header.msgh_bits = MACH_MSGH_BITS(MACH_MSG_TYPE_COPY_SEND, 0);
+        msg.header.msgh_size = sizeof(msg.header);
+        msg.header.msgh_remote_port = port;
+        msg.header.msgh_local_port = MACH_PORT_NULL;
+        msg.header.msgh_voucher_port = MACH_PORT_NULL;
+        msg.header.msgh_id = 0;
+        kr = mach_msg(&msg.header, MACH_SEND_MSG | MACH_RCV_MSG, sizeof(msg.header),
+                      sizeof(msg), port, MACH_MSG_TIMEOUT_NONE, MACH_PORT_NULL);
+        VERIFY(kr == MACH_MSG_SUCCESS, "mach_msg failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+DECL_CLEANUP {
+    int i;
+
+    for(i=0; i<num_threads; i++) {
+        mach_port_destroy(mach_task_self(), ports[i]);
+    }
+    free(ports);
+    return PERFINDEX_SUCCESS;
+}
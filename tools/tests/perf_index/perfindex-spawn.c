@@ -0,0 +1,20 @@
+#include "perf_index.h"
+#include "fail.h"
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+DECL_TEST {
+    char* spawn_argv[] = { "/usr/bin/true", NULL };
+    long long i;
+    pid_t pid;
+    int status;
+
+    for(i=0; i<length; i++) {
+        VERIFY(posix_spawn(&pid, spawn_argv[0], NULL, NULL, spawn_argv, environ) == 0, "posix_spawn failed");
+        VERIFY(waitpid(pid, &status, 0) == pid, "waitpid failed");
+        VERIFY(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
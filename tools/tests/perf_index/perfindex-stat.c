@@ -0,0 +1,58 @@
+#include "perf_index.h"
+#include "fail.h"
+#include "test_file_helper.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STAT_DEPTH 8
+
+char tempdir[MAXPATHLEN];
+char statpath[MAXPATHLEN];
+
+DECL_SETUP {
+    char* retval;
+    int i;
+    int fd;
+
+    retval = setup_tempdir(tempdir);
+    VERIFY(retval, "tempdir setup failed");
+
+    strlcpy(statpath, tempdir, sizeof(statpath));
+    for(i=0; i<STAT_DEPTH; i++) {
+        snprintf(statpath + strlen(statpath), sizeof(statpath) - strlen(statpath), "/d%d", i);
+        VERIFY(mkdir(statpath, 0755) == 0, "mkdir failed");
+    }
+    strlcat(statpath, "/file", sizeof(statpath));
+    fd = open(statpath, O_CREAT | O_EXCL | O_WRONLY, 0644);
+    VERIFY(fd >= 0, "open failed");
+    close(fd);
+
+    return PERFINDEX_SUCCESS;
+}
+
+DECL_TEST {
+    struct stat sb;
+    long long i;
+
+    for(i=0; i<length; i++) {
+        VERIFY(stat(statpath, &sb) == 0, "stat failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+DECL_CLEANUP {
+    int i;
+
+    VERIFY(unlink(statpath) == 0, "unlink failed");
+    for(i=0; i<STAT_DEPTH; i++) {
+        *strrchr(statpath, '/') = '\0';
+        VERIFY(rmdir(statpath) == 0, "rmdir failed");
+    }
+    VERIFY(cleanup_tempdir(tempdir) == 0, "cleanup_tempdir failed");
+
+    return PERFINDEX_SUCCESS;
+}
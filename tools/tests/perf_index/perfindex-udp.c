@@ -0,0 +1,63 @@
+#include "perf_index.h"
+#include "fail.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define PACKET_SIZE 64
+
+static int* socks = NULL;
+
+/* one connected socket pair on the loopback per thread */
+DECL_SETUP {
+    struct sockaddr_in sin;
+    socklen_t len;
+    int i;
+    int* s;
+
+    socks = (int*)malloc(sizeof(int) * 2 * num_threads);
+    VERIFY(socks, "malloc failed");
+
+    for(i=0; i<num_threads; i++) {
+        s = &socks[2*i];
+        s[0] = socket(AF_INET, SOCK_DGRAM, 0);
+        s[1] = socket(AF_INET, SOCK_DGRAM, 0);
+        VERIFY(s[0] >= 0 && s[1] >= 0, "socket failed");
+
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_len = sizeof(sin);
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        VERIFY(bind(s[1], (struct sockaddr*)&sin, sizeof(sin)) == 0, "bind failed");
+        len = sizeof(sin);
+        VERIFY(getsockname(s[1], (struct sockaddr*)&sin, &len) == 0, "getsockname failed");
+        VERIFY(connect(s[0], (struct sockaddr*)&sin, sizeof(sin)) == 0, "connect failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+DECL_TEST {
+    char buf[PACKET_SIZE];
+    int* s = &socks[2*thread_id];
+    long long i;
+
+    memset(buf, 0, sizeof(buf));
+    for(i=0; i<length; i++) {
+        VERIFY(send(s[0], buf, sizeof(buf), 0) == sizeof(buf), "send failed");
+        VERIFY(recv(s[1], buf, sizeof(buf), 0) == sizeof(buf), "recv failed");
+    }
+    return PERFINDEX_SUCCESS;
+}
+
+DECL_CLEANUP {
+    int i;
+
+    for(i=0; i<2*num_threads; i++) {
+        close(socks[i]);
+    }
+    free(socks);
+    return PERFINDEX_SUCCESS;
+}
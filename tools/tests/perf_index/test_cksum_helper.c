@@ -0,0 +1,84 @@
+/*
+ * Build the kernel's Internet checksum routines in user space, the same
+ * way libsyscall does, so that they can be timed in isolation.
+ */
+#define LIBSYSCALL_INTERFACE 1
+#include <sys/cdefs.h>
+#ifndef IS_P2ALIGNED
+#define IS_P2ALIGNED(v, a) ((((uintptr_t)(v)) & ((uintptr_t)(a) - 1)) == 0)
+#endif
+#include "../../../bsd/netinet/cpu_in_cksum_gen.c"
+#undef VERIFY
+
+#include "test_cksum_helper.h"
+#include "fail.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* used by the arm assembly versions to report a short mbuf chain */
+int fprintf_stderr(const char *fmt, ...);
+int fprintf_stderr(const char *fmt, ...) {
+  (void)fmt;
+  return 0;
+}
+
+/* checksum packet sized spans, like the network stack does */
+#define PKTSIZE 1448
+#define BUFSIZE (1L<<20)
+
+static uint8_t **srcbufs;
+static uint8_t **dstbufs;
+
+int test_cksum_setup(int num_threads) {
+  int i;
+
+  srcbufs = calloc(num_threads, sizeof(*srcbufs));
+  dstbufs = calloc(num_threads, sizeof(*dstbufs));
+  VERIFY(srcbufs != NULL && dstbufs != NULL, "calloc failed");
+
+  for(i=0; i<num_threads; i++) {
+    srcbufs[i] = malloc(BUFSIZE);
+    dstbufs[i] = malloc(BUFSIZE);
+    VERIFY(srcbufs[i] != NULL && dstbufs[i] != NULL, "malloc failed");
+    arc4random_buf(srcbufs[i], BUFSIZE);
+    memset(dstbufs[i], 0, BUFSIZE);
+  }
+
+  return PERFINDEX_SUCCESS;
+}
+
+int test_cksum_helper(int thread_id, int num_threads, long long length, cksumtype_t cksumtype) {
+  uint8_t *src = srcbufs[thread_id], *dst = dstbufs[thread_id];
+  long long left = length / num_threads;
+  volatile uint32_t sum = 0;
+  uint32_t len, off = 0;
+
+  while(left > 0) {
+    len = left < PKTSIZE ? (uint32_t)left : PKTSIZE;
+    if(off + len > BUFSIZE)
+      off = 0;
+    if(cksumtype == TESTCKSUM) {
+      sum += os_cpu_in_cksum(src + off, len, 0);
+    } else {
+      sum += os_cpu_copy_in_cksum(src + off, dst + off, len, 0);
+    }
+    off += len;
+    left -= len;
+  }
+
+  return PERFINDEX_SUCCESS;
+}
+
+int test_cksum_cleanup(int num_threads) {
+  int i;
+
+  for(i=0; i<num_threads; i++) {
+    free(srcbufs[i]);
+    free(dstbufs[i]);
+  }
+  free(srcbufs);
+  free(dstbufs);
+
+  return PERFINDEX_SUCCESS;
+}
@@ -0,0 +1,15 @@
+#ifndef __TEST_CKSUM_HELPER_H_
+#define __TEST_CKSUM_HELPER_H_
+
+#include <stdint.h>
+
+typedef enum {
+  TESTCKSUM,
+  TESTCOPYCKSUM
+} cksumtype_t;
+
+int test_cksum_setup(int num_threads);
+int test_cksum_helper(int thread_id, int num_threads, long long length, cksumtype_t cksumtype);
+int test_cksum_cleanup(int num_threads);
+
+#endif
@@ -120,6 +120,9 @@ static boolean_t                g_do_all_spin = FALSE;
 /* Every thread backgrounds temporarily before parking */
 static boolean_t                g_drop_priority = FALSE;
 
+/* Print a log2 histogram of the latencies along with the summary */
+static boolean_t                g_histogram = FALSE;
+
 /* One randomly chosen thread holds up the train for a certain duration. */
 static boolean_t                g_do_one_long_spin = FALSE;
 static uint32_t                 g_one_long_spin_id = 0;
@@ -568,6 +571,84 @@ compute_stats(uint64_t *values, uint64_t count, float *averagep, uint64_t *maxp,
 	*stddevp = _dev;
 }
 
+static int
+compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/*
+ * Nearest-rank percentile of a sorted array, pct in tenths of a percent
+ */
+static uint64_t
+percentile(uint64_t *sorted, uint64_t count, uint32_t pct_x10)
+{
+	uint64_t rank = (count * pct_x10 + 999) / 1000;
+
+	return sorted[rank ? rank - 1 : 0];
+}
+
+#define HISTOGRAM_BUCKETS 24
+
+static void
+print_histogram(uint64_t *values, uint64_t count)
+{
+	uint64_t buckets[HISTOGRAM_BUCKETS] = { 0 };
+	uint32_t i, last = 0;
+
+	for (uint64_t j = 0; j < count; j++) {
+		uint64_t us = values[j] / 1000;
+		uint32_t b = 0;
+
+		while (us) {
+			us >>= 1;
+			b++;
+		}
+		if (b >= HISTOGRAM_BUCKETS)
+			b = HISTOGRAM_BUCKETS - 1;
+		buckets[b]++;
+		last = b > last ? b : last;
+	}
+
+	for (i = 0; i <= last; i++) {
+		if (i == 0)
+			printf("       < 1 us:\t%llu\n", buckets[i]);
+		else
+			printf("%7llu-%llu us:\t%llu\n", 1ULL << (i - 1), (1ULL << i) - 1, buckets[i]);
+	}
+}
+
+static void
+print_results(const char *title, uint64_t *values, uint64_t count)
+{
+	uint64_t max, min;
+	float avg, stddev;
+	uint64_t *sorted;
+
+	compute_stats(values, count, &avg, &max, &min, &stddev);
+	printf("%s:\n", title);
+	printf("Max:\t\t%.2f us\n", ((float)max) / 1000.0);
+	printf("Min:\t\t%.2f us\n", ((float)min) / 1000.0);
+	printf("Avg:\t\t%.2f us\n", avg / 1000.0);
+	printf("Stddev:\t\t%.2f us\n", stddev / 1000.0);
+
+	sorted = malloc(sizeof(uint64_t) * count);
+	assert(sorted);
+	memcpy(sorted, values, sizeof(uint64_t) * count);
+	qsort(sorted, count, sizeof(uint64_t), compare_u64);
+	printf("P50:\t\t%.2f us\n", ((float)percentile(sorted, count, 500)) / 1000.0);
+	printf("P90:\t\t%.2f us\n", ((float)percentile(sorted, count, 900)) / 1000.0);
+	printf("P99:\t\t%.2f us\n", ((float)percentile(sorted, count, 990)) / 1000.0);
+	printf("P99.9:\t\t%.2f us\n", ((float)percentile(sorted, count, 999)) / 1000.0);
+	free(sorted);
+
+	if (g_histogram)
+		print_histogram(values, count);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -577,8 +658,6 @@ main(int argc, char **argv)
 	pthread_t	*threads;
 	uint64_t	*worst_latencies_ns;
 	uint64_t	*worst_latencies_from_first_ns;
-	uint64_t	max, min;
-	float		avg, stddev;
 
 	for (int i = 0; i < argc; i++)
 		if (strcmp(argv[i], "--switched_apptype") == 0)
@@ -773,21 +852,11 @@ main(int argc, char **argv)
 	if (g_churn_pri)
 		join_churn_threads();
 
-	compute_stats(worst_latencies_ns, g_iterations, &avg, &max, &min, &stddev);
-	printf("Results (from a stop):\n");
-	printf("Max:\t\t%.2f us\n", ((float)max) / 1000.0);
-	printf("Min:\t\t%.2f us\n", ((float)min) / 1000.0);
-	printf("Avg:\t\t%.2f us\n", avg / 1000.0);
-	printf("Stddev:\t\t%.2f us\n", stddev / 1000.0);
+	print_results("Results (from a stop)", worst_latencies_ns, g_iterations);
 
 	putchar('\n');
 
-	compute_stats(worst_latencies_from_first_ns, g_iterations, &avg, &max, &min, &stddev);
-	printf("Results (relative to first thread):\n");
-	printf("Max:\t\t%.2f us\n", ((float)max) / 1000.0);
-	printf("Min:\t\t%.2f us\n", ((float)min) / 1000.0);
-	printf("Avg:\t\t%.2f us\n", avg / 1000.0);
-	printf("Stddev:\t\t%.2f us\n", stddev / 1000.0);
+	print_results("Results (relative to first thread)", worst_latencies_from_first_ns, g_iterations);
 
 #if 0
 	for (uint32_t i = 0; i < g_iterations; i++) {
@@ -852,7 +921,8 @@ usage()
 	     "<realtime | timeshare | fixed> <iterations>\n\t\t"
 	     "[--trace <traceworthy latency in ns>] "
 	     "[--verbose] [--spin-one] [--spin-all] [--spin-time <nanos>] [--affinity]\n\t\t"
-	     "[--no-sleep] [--drop-priority] [--churn-pri <pri>] [--churn-count <n>]",
+	     "[--no-sleep] [--drop-priority] [--churn-pri <pri>] [--churn-count <n>]\n\t\t"
+	     "[--histogram]",
 	     getprogname());
 }
 
@@ -899,6 +969,7 @@ parse_args(int argc, char *argv[])
 		{ "no-sleep",           no_argument,            (int*)&g_do_sleep,              FALSE },
 		{ "drop-priority",      no_argument,            (int*)&g_drop_priority,         TRUE },
 		{ "verbose",            no_argument,            (int*)&g_verbose,               TRUE },
+		{ "histogram",          no_argument,            (int*)&g_histogram,             TRUE },
 		{ "help",               no_argument,            NULL,                           'h' },
 		{ NULL,                 0,                      NULL,                           0 }
 	};